@@ -0,0 +1,163 @@
+#!/bin/bash
+# Script to extract, and optionally rebuild, every firmware image in a list or a directory,
+# several images at a time, each in a working directory of its own.
+BINDIR=`dirname $0`
+. "$BINDIR/common.inc"
+
+JOBS=$(nproc 2>/dev/null || echo 1)
+JOB_MB="512"
+BUILD=""
+
+function usage()
+{
+	echo "Usage: $0 [-b] [-j jobs] [-m MB per job] <image list | image directory> <output directory>"
+	echo ""
+	echo "	-b	Also rebuild each image that extracted"
+	echo "	-j	Most jobs to run at once (default: $JOBS)"
+	echo "	-m	Memory a job needs; no job starts while less than this is available (default: $JOB_MB)"
+	exit 1
+}
+
+# Available memory in MB, or nothing if it can't be told
+function mem_available()
+{
+	awk '/^MemAvailable:/ { print int($2 / 1024) }' /proc/meminfo 2>/dev/null
+}
+
+# Runs one image, recording "<ok|failed> <seconds> <bytes> <image>" in its status file
+function run_job()
+{
+	local IMG="$1"
+	local JOBDIR="$2"
+	local START=$(date +%s.%N)
+	local STATUS="ok"
+
+	mkdir -p "$JOBDIR"
+
+	$JOB_PREFIX ./extract-firmware.sh "$IMG" "$JOBDIR/fmk" > "$JOBDIR/job.log" 2>&1
+	if [ $? -ne 0 ]; then
+		STATUS="failed"
+	elif [ "$BUILD" != "" ]; then
+		$JOB_PREFIX ./build-firmware.sh "$JOBDIR/fmk" >> "$JOBDIR/job.log" 2>&1
+		if [ $? -ne 0 ]; then
+			STATUS="failed"
+		fi
+	fi
+
+	echo "$STATUS $(echo "$(date +%s.%N) $START" | awk '{ printf "%.2f", $1 - $2 }') $(wc -c < "$IMG") $IMG" > "$JOBDIR/status"
+}
+
+while getopts "bj:m:h" OPT; do
+	case $OPT in
+		b)
+			BUILD="1";;
+		j)
+			JOBS="$OPTARG";;
+		m)
+			JOB_MB="$OPTARG";;
+		*)
+			usage;;
+	esac
+done
+shift $((OPTIND-1))
+
+SRC="$1"
+OUT="$2"
+
+if [ "$SRC" == "" ] || [ "$OUT" == "" ] || [ ! -e "$SRC" ]; then
+	usage
+fi
+
+SRC=$(readlink -f "$SRC")
+mkdir -p "$OUT" || exit 1
+OUT=$(readlink -f "$OUT")
+
+# Make sure we're operating out of the FMK directory
+cd $(dirname $(readlink -f $0))
+
+printf "Firmware Mod Kit (batch) $(cat firmware_mod_kit_version.txt), (c)2011-2013 Craig Heffner, Jeremy Collake\n\n"
+
+# Build the tools once here, rather than checking in every job
+Build_Tools
+export FMK_TOOLS_BUILT=1
+
+# The scripts extract and build file systems as root. Rather than sudo in every job, run each
+# job as root in a user namespace of its own where the kernel allows it; the files it creates
+# are still owned by the calling user outside. Otherwise ask for sudo once up front.
+JOB_PREFIX=""
+if [ "$(id -ru)" != "0" ]; then
+	if unshare -r true 2>/dev/null; then
+		JOB_PREFIX="unshare -r"
+	else
+		echo "User namespaces are not available, jobs will use sudo."
+		sudo -v || exit 1
+	fi
+fi
+
+if [ -d "$SRC" ]; then
+	IMAGES=$(find "$SRC" -type f | sort)
+else
+	IMAGES=$(grep -v '^[[:space:]]*$' "$SRC")
+fi
+
+echo "Processing $(echo "$IMAGES" | grep -c .) image(s), $JOBS at a time, into $OUT..."
+
+BATCH_START=$(date +%s.%N)
+N=0
+
+while read -r IMG
+do
+	if [ "$IMG" == "" ]; then
+		continue
+	fi
+
+	# Wait for a free slot, and for the memory a job needs unless nothing is running
+	while true
+	do
+		RUNNING=$(jobs -rp | wc -l)
+		MEM=$(mem_available)
+
+		if [ $RUNNING -lt $JOBS ] && ([ $RUNNING -eq 0 ] || [ "$MEM" == "" ] || [ $MEM -ge $JOB_MB ]); then
+			break
+		fi
+
+		wait -n
+	done
+
+	((N=$N+1))
+	JOBDIR="$OUT/$(printf "%05d" $N)-$(basename "$IMG")"
+	echo "[$N] $IMG"
+	run_job "$(readlink -f "$IMG")" "$JOBDIR" &
+done <<< "$IMAGES"
+
+wait
+
+# Aggregate the job results
+BATCHLOG="$OUT/batch.log"
+cat "$OUT"/*/status 2>/dev/null > "$BATCHLOG"
+
+echo "$(date +%s.%N) $BATCH_START" | awk -v statuslog="$BATCHLOG" -v jobs="$JOBS" '
+	{ elapsed = $1 - $2 }
+	END {
+		while ((getline line < statuslog) > 0) {
+			split(line, f, " ")
+			n++
+			bytes += f[3]
+			busy += f[2]
+			if (f[1] == "ok") ok++
+			else failed[++nfailed] = substr(line, index(line, f[4]))
+		}
+
+		printf "\n%d image(s): %d ok, %d failed\n", n, ok, nfailed
+		printf "%.2f MB in %.2f s, %.2f MB/s, %.2f images/s, %.2f job-seconds with up to %d at a time\n",
+			bytes / 1048576, elapsed, (elapsed > 0 ? bytes / 1048576 / elapsed : 0),
+			(elapsed > 0 ? n / elapsed : 0), busy, jobs
+		for (i = 1; i <= nfailed; i++)
+			printf "FAILED: %s\n", failed[i]
+	}' | tee -a "$BATCHLOG"
+
+if [ "$(grep -c '^failed ' "$BATCHLOG")" != "0" ]; then
+	exit 1
+fi
+
+exit 0
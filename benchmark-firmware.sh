@@ -0,0 +1,387 @@
+#!/bin/bash
+# End to end benchmark of extract-firmware.sh and build-firmware.sh, run by make bench. A fixed set
+# of sample images is made with the kit's own tools from a generated root file system, the same
+# bytes every time: TRX with squashfs-lzma, uImage with squashfs-xz, big endian cramfs, yaffs2 for
+# 2KiB page NAND and TP-Link with squashfs 4 lzma. Each is extracted and rebuilt under src/fmk-stat,
+# and the wall, CPU, peak RSS and I/O of every stage, the best of several runs, are written as JSON.
+#
+# With a baseline, the results of an earlier run saved with -s, every stage that got slower, bigger
+# or did more I/O by more than the threshold is reported and the script fails. Without one, the
+# first run is saved as the baseline.
+BINDIR=`dirname $0`
+. "$BINDIR/common.inc"
+
+BASELINE="bench-baseline.json"
+RESULTS="bench-results.json"
+RUNS="3"
+THRESHOLD="10"
+SAVE=""
+KEEP=""
+
+# Fixed times, inside the image and on the sample tree, so the samples don't change between runs
+EPOCH="1300000000"
+
+# Differences smaller than these are noise, whatever the percentage: seconds, KB and bytes
+MIN_SECONDS="0.05"
+MIN_RSS_KB="1024"
+MIN_IO_BYTES="65536"
+
+function usage()
+{
+	echo "Usage: $0 [-b baseline] [-o results] [-r runs] [-t percent] [-s] [-k]"
+	echo ""
+	echo "	-b	Baseline to compare against (default: $BASELINE)"
+	echo "	-o	Where to write the results (default: $RESULTS)"
+	echo "	-r	Runs of each stage, the fastest is kept (default: $RUNS)"
+	echo "	-t	Percentage a stage may get worse by before it counts as a regression (default: $THRESHOLD)"
+	echo "	-s	Save the results as the new baseline"
+	echo "	-k	Keep the sample images and working directories"
+	exit 1
+}
+
+while getopts "b:o:r:t:skh" OPT; do
+	case $OPT in
+		b)
+			BASELINE="$OPTARG";;
+		o)
+			RESULTS="$OPTARG";;
+		r)
+			RUNS="$OPTARG";;
+		t)
+			THRESHOLD="$OPTARG";;
+		s)
+			SAVE="1";;
+		k)
+			KEEP="1";;
+		*)
+			usage;;
+	esac
+done
+
+if ! [ "$RUNS" -ge 1 ] 2>/dev/null; then
+	usage
+fi
+
+# Relative to where the script was run from
+touch "$RESULTS" || exit 1
+RESULTS=$(readlink -f "$RESULTS")
+BASELINE=$(readlink -f "$BASELINE")
+
+# Make sure we're operating out of the FMK directory
+cd $(dirname $(readlink -f $0))
+
+printf "Firmware Mod Kit (benchmark) $(cat firmware_mod_kit_version.txt), (c)2011-2013 Craig Heffner, Jeremy Collake\n\n"
+
+# Built once up front, so no stage times a build of the tools
+Build_Tools
+export FMK_TOOLS_BUILT=1
+
+# Every extraction scans its image, rather than reusing the scan of an earlier run
+export FMK_SCAN_CACHE=""
+
+MKSQUASHFS_3_LZMA="./src/others/squashfs-3.2-r2-lzma/squashfs3.2-r2/squashfs-tools/mksquashfs"
+MKSQUASHFS_4="./src/others/squashfs-4.2/squashfs-tools/mksquashfs"
+
+for TOOL in ./src/fmk-stat ./src/fwscan ./src/asustrx ./src/cramfs-2.x/mkcramfs ./src/yaffs2utils/mkyaffs2 \
+	"$MKSQUASHFS_3_LZMA" "$MKSQUASHFS_4"
+do
+	if [ ! -x "$TOOL" ]; then
+		echo "$TOOL has not been built! Quitting..."
+		exit 1
+	fi
+done
+
+# As in batch-firmware.sh, the stages run as root in a user namespace where the kernel allows it
+JOB_PREFIX=""
+if [ "$(id -ru)" != "0" ]; then
+	if unshare -r true 2>/dev/null; then
+		JOB_PREFIX="unshare -r"
+	else
+		echo "User namespaces are not available, stages will use sudo."
+		sudo -v || exit 1
+	fi
+fi
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/fmk-bench.XXXXXX")
+if [ "$KEEP" == "" ]; then
+	trap 'rm -rf "$WORK"' EXIT
+else
+	echo "Keeping the samples and working directories in $WORK"
+fi
+
+SAMPLES="$WORK/samples"
+ROOT="$WORK/rootfs"
+mkdir -p "$SAMPLES" "$ROOT"/{bin,sbin,lib,etc/init.d,www/cgi-bin,usr/share}
+
+# Writes pseudo-random data from a Park-Miller generator, which every awk computes exactly, to the files
+# named on stdin as "<text|binary> <bytes> <path>". Text is lines of words, like scripts and pages;
+# binary is drawn from a small set of 4 byte tokens, which compresses about as well as code does.
+function generate()
+{
+	LC_ALL=C awk -v seed="$1" '
+		function next_rand() { x = (x * 16807) % 2147483647; return x }
+		BEGIN {
+			x = seed
+			nwords = split("if then else fi for do done case esac echo exit return config option " \
+				"interface device network wireless firewall zone lan wan proto dhcp static ipaddr " \
+				"netmask gateway dns option enabled disabled <div> </div> <table> <tr> <td> </td> " \
+				"</tr> var function document.getElementById value = ; { } ( ) \"\" 0 1 255 1500", words, " ")
+			for (i = 0; i < 256; i++) {
+				token[i] = ""
+				for (j = 0; j < 4; j++)
+					token[i] = token[i] sprintf("%c", 1 + next_rand() % 255)
+			}
+		}
+		{
+			kind = $1; size = $2; path = $3; out = ""
+			while (length(out) < size) {
+				if (kind == "text") {
+					n = 4 + next_rand() % 9
+					for (i = 0; i < n; i++)
+						out = out words[1 + next_rand() % nwords] (i < n - 1 ? " " : "\n")
+				} else {
+					chunk = ""
+					for (i = 0; i < 1024; i++)
+						chunk = chunk token[next_rand() % 256]
+					out = out chunk
+				}
+			}
+			printf "%s", substr(out, 1, size) > path
+			close(path)
+		}'
+}
+
+# Big and little endian 32 bit and big endian 16 bit values, for the headers written here
+function be32()
+{
+	printf "\\\\x%02x\\\\x%02x\\\\x%02x\\\\x%02x" $(($1 >> 24 & 255)) $(($1 >> 16 & 255)) $(($1 >> 8 & 255)) $(($1 & 255))
+}
+
+function le32()
+{
+	printf "\\\\x%02x\\\\x%02x\\\\x%02x\\\\x%02x" $(($1 & 255)) $(($1 >> 8 & 255)) $(($1 >> 16 & 255)) $(($1 >> 24 & 255))
+}
+
+function be16()
+{
+	printf "\\\\x%02x\\\\x%02x" $(($1 >> 8 & 255)) $(($1 & 255))
+}
+
+# A string in a zero filled field of the given size
+function field()
+{
+	printf "%s" "$1"
+	head -c $(($2 - ${#1})) /dev/zero
+}
+
+echo "Generating the sample images..."
+
+(
+	for N in $(seq 1 24); do echo "binary $((16384 + N * 8192)) $ROOT/bin/prog$N"; done
+	for N in $(seq 1 12); do echo "binary $((32768 + N * 24576)) $ROOT/lib/lib$N.so"; done
+	for N in $(seq 1 40); do echo "text $((512 + N * 97)) $ROOT/etc/conf$N"; done
+	for N in $(seq 1 12); do echo "text $((256 + N * 61)) $ROOT/etc/init.d/S${N}service"; done
+	for N in $(seq 1 240); do echo "text $((1024 + N * 131)) $ROOT/www/page$N.htm"; done
+	for N in $(seq 1 16); do echo "text $((2048 + N * 73)) $ROOT/www/cgi-bin/cgi$N"; done
+	for N in $(seq 1 24); do echo "text $((4096 + N * 257)) $ROOT/usr/share/data$N"; done
+) | generate 20110101
+generate 20110102 <<< "binary 917504 $WORK/kernel"
+
+for LINK in sh ls cat mount ifconfig; do ln -s prog1 "$ROOT/bin/$LINK"; done
+ln -s ../bin/prog1 "$ROOT/sbin/init"
+chmod 755 "$ROOT"/bin/prog* "$ROOT"/etc/init.d/* "$ROOT"/www/cgi-bin/*
+find "$ROOT" -exec touch -h -d @$EPOCH {} +
+
+MKSQ_LOG="$WORK/samples.log"
+
+# TRX: the kernel and a squashfs 3 lzma file system, with the creation time in its superblock fixed
+$MKSQUASHFS_3_LZMA "$ROOT" "$WORK/fs-sq3-lzma" -noappend -all-root -le > "$MKSQ_LOG" 2>&1 || exit 1
+printf "$(le32 $EPOCH)" | dd of="$WORK/fs-sq3-lzma" bs=1 seek=39 conv=notrunc 2>/dev/null
+./src/asustrx -o "$SAMPLES/trx-squashfs-lzma.bin" "$WORK/kernel" "$WORK/fs-sq3-lzma" >> "$MKSQ_LOG" 2>&1 || exit 1
+
+# uImage: the kernel behind its header, followed by a squashfs 4 xz file system
+SOURCE_DATE_EPOCH=$EPOCH $MKSQUASHFS_4 "$ROOT" "$WORK/fs-sq4-xz" -comp xz -noappend -all-root -reproducible \
+	-no-progress >> "$MKSQ_LOG" 2>&1 || exit 1
+KERNEL_SIZE=$(stat -c %s "$WORK/kernel")
+(
+	printf "$(be32 0x27051956)$(be32 0)$(be32 $EPOCH)$(be32 $KERNEL_SIZE)"
+	printf "$(be32 0x80000000)$(be32 0x80000000)$(be32 0)\\x05\\x05\\x02\\x03"
+	field "FMK benchmark" 32
+	cat "$WORK/kernel" "$WORK/fs-sq4-xz"
+) > "$SAMPLES/uimage-squashfs-xz.bin"
+
+# Big endian cramfs
+./src/cramfs-2.x/mkcramfs -B "$ROOT" "$SAMPLES/cramfs-be.bin" >> "$MKSQ_LOG" 2>&1 || exit 1
+
+# yaffs2 for NAND with 2KiB pages and 64 byte spares
+./src/yaffs2utils/mkyaffs2 -p 2048 -s 64 --all-root -t 1 "$ROOT" "$SAMPLES/yaffs2-nand.bin" >> "$MKSQ_LOG" 2>&1 || exit 1
+
+# TP-Link: the 512 byte header, the kernel and a squashfs 4 lzma file system
+SOURCE_DATE_EPOCH=$EPOCH $MKSQUASHFS_4 "$ROOT" "$WORK/fs-sq4-lzma" -comp lzma -noappend -all-root -reproducible \
+	-no-progress >> "$MKSQ_LOG" 2>&1 || exit 1
+FS_SIZE=$(stat -c %s "$WORK/fs-sq4-lzma")
+(
+	printf "$(be32 0x01000000)"
+	field "TP-LINK Technologies" 24
+	field "ver. 1.0" 36
+	printf "$(be32 0x10430001)$(be32 1)$(be32 0)"
+	head -c 16 /dev/zero
+	head -c 24 /dev/zero
+	printf "$(be32 0x80002000)$(be32 0x80002000)$(be32 $((512 + KERNEL_SIZE + FS_SIZE)))"
+	printf "$(be32 512)$(be32 $KERNEL_SIZE)$(be32 $((512 + KERNEL_SIZE)))$(be32 $FS_SIZE)$(be32 0)$(be32 0)"
+	printf "$(be16 3)$(be16 13)$(be16 1)"
+	head -c $((512 - 0x9e)) /dev/zero
+	cat "$WORK/kernel" "$WORK/fs-sq4-lzma"
+) > "$SAMPLES/tplink.bin"
+
+# The header checksums of the images put together here
+./src/fwscan -p "$SAMPLES/uimage-squashfs-xz.bin" "$SAMPLES/tplink.bin" > /dev/null
+if ! ./src/fwscan "$SAMPLES"/*.bin >> "$MKSQ_LOG" 2>&1; then
+	cat "$MKSQ_LOG"
+	echo "The sample images have bad checksums! Quitting..."
+	exit 1
+fi
+
+# Each stage of each image, RUNS times; fmk-stat appends a line of JSON per run to RUNLOG
+RUNLOG="$WORK/runs.log"
+FAILED=0
+
+for RUN in $(seq 1 $RUNS)
+do
+	for IMG in "$SAMPLES"/*.bin
+	do
+		NAME=$(basename "$IMG" .bin)
+		DIR="$WORK/$NAME-$RUN"
+
+		echo "[$RUN/$RUNS] $NAME"
+		./src/fmk-stat -o "$RUNLOG" -n "$NAME/extract" $JOB_PREFIX ./extract-firmware.sh "$IMG" "$DIR" \
+			> "$WORK/$NAME-$RUN.log" 2>&1
+		if [ $? -ne 0 ]; then
+			echo "FAILED: extracting $NAME, see $WORK/$NAME-$RUN.log"
+			FAILED=1
+			continue
+		fi
+
+		# The stage fails if no image was written
+		./src/fmk-stat -o "$RUNLOG" -n "$NAME/build" $JOB_PREFIX ./build-firmware.sh "$DIR" \
+			< /dev/null >> "$WORK/$NAME-$RUN.log" 2>&1
+		if [ $? -ne 0 ] || [ ! -s "$DIR/new-firmware.bin" ]; then
+			echo "FAILED: building $NAME, see $WORK/$NAME-$RUN.log"
+			FAILED=1
+		fi
+
+		if [ "$KEEP" == "" ]; then
+			$JOB_PREFIX rm -rf "$DIR"
+		fi
+	done
+done
+
+# The fastest run of each stage, with the hash of the sample tree and the sizes of the samples so
+# that a baseline made from other samples is told apart. The yaffs2 image has the change times of
+# the tree in it, which can't be set, so the images themselves differ from run to run
+{
+	echo "{"
+	echo "  \"version\": \"$(cat firmware_mod_kit_version.txt)\","
+	echo "  \"date\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\","
+	echo "  \"host\": \"$(uname -srm)\","
+	echo "  \"cpus\": $(nproc 2>/dev/null || echo 1),"
+	echo "  \"runs\": $RUNS,"
+	echo "  \"rootfs\": \"$(./src/fmk-treehash "$ROOT")\","
+	echo "  \"samples\": ["
+	for IMG in "$SAMPLES"/*.bin
+	do
+		echo "    {\"name\": \"$(basename "$IMG" .bin)\", \"bytes\": $(stat -c %s "$IMG")},"
+	done | sed '$ s/,$//'
+	echo "  ],"
+	echo "  \"stages\": ["
+	awk '
+		{
+			line = $0
+			sub(/^\{"name": "/, "", line)
+			name = substr(line, 1, index(line, "\"") - 1)
+			match($0, /"wall": [0-9.]+/)
+			wall = substr($0, RSTART + 8, RLENGTH - 8) + 0
+			if (!(name in best) || wall < bestwall[name]) {
+				if (!(name in best)) order[++n] = name
+				best[name] = $0
+				bestwall[name] = wall
+			}
+		}
+		END {
+			for (i = 1; i <= n; i++)
+				printf "    %s%s\n", best[order[i]], (i < n ? "," : "")
+		}' "$RUNLOG"
+	echo "  ]"
+	echo "}"
+} > "$RESULTS"
+
+echo ""
+echo "Results written to $RESULTS"
+
+# Prints the stages of a results file as "<name> <status> <wall> <cpu> <maxrss_kb> <io bytes>"
+function stage_table()
+{
+	awk '
+		/^    \{"name": .*"status": / {
+			line = $0
+			sub(/^    \{"name": "/, "", line)
+			name = substr(line, 1, index(line, "\"") - 1)
+			n = split($0, f, /[,{}] *"?|": /)
+			for (i = 1; i < n; i++) v[f[i]] = f[i + 1]
+			printf "%s %d %.3f %.3f %d %.0f\n", name, v["status"], v["wall"], v["user"] + v["sys"],
+				v["maxrss_kb"], v["rchar"] + v["wchar"]
+		}' "$1"
+}
+
+REGRESSED=0
+if [ -s "$BASELINE" ] && [ "$SAVE" == "" ]; then
+	echo "Compared with $BASELINE, $THRESHOLD% allowed:"
+	if [ "$(grep '"rootfs"\|"bytes"' "$BASELINE")" != "$(grep '"rootfs"\|"bytes"' "$RESULTS")" ]; then
+		echo "WARNING: the baseline was made from other sample images, the comparison may not mean much"
+	fi
+	stage_table "$BASELINE" > "$WORK/baseline.table"
+	stage_table "$RESULTS" | awk -v baseline="$WORK/baseline.table" -v threshold="$THRESHOLD" \
+		-v min_seconds="$MIN_SECONDS" -v min_rss="$MIN_RSS_KB" -v min_io="$MIN_IO_BYTES" '
+		BEGIN {
+			while ((getline line < baseline) > 0) {
+				split(line, f, " ")
+				base[f[1]] = line
+			}
+			split("wall cpu maxrss_kb io", metric, " ")
+			split(min_seconds " " min_seconds " " min_rss " " min_io, floor, " ")
+			printf "%-32s %-10s %14s %14s %9s\n", "stage", "metric", "baseline", "now", "change"
+		}
+		{
+			if (!($1 in base)) {
+				printf "%-32s not in the baseline\n", $1
+				next
+			}
+			split(base[$1], b, " ")
+			for (i = 1; i <= 4; i++) {
+				was = b[i + 2]; now = $(i + 2)
+				change = (was > 0 ? (now - was) * 100 / was : 0)
+				flag = ""
+				if (now - was > floor[i] && change > threshold) {
+					flag = "  REGRESSION"
+					regressed = 1
+				}
+				printf "%-32s %-10s %14s %14s %+8.1f%%%s\n", $1, metric[i], was, now, change, flag
+			}
+		}
+		END { exit regressed }'
+	REGRESSED=$?
+elif [ "$FAILED" -eq 0 ]; then
+	cp "$RESULTS" "$BASELINE" && echo "Saved as the baseline, $BASELINE"
+fi
+
+if [ $FAILED -ne 0 ]; then
+	echo "Some stages failed!"
+	exit 1
+fi
+
+if [ $REGRESSED -ne 0 ]; then
+	echo "Some stages regressed!"
+	exit 1
+fi
+
+exit 0
@@ -34,6 +34,14 @@ eval $(cat shared-ng.inc)
 eval $(cat $CONFLOG)
 FSOUT="$DIR/new-filesystem.$FS_TYPE"
 
+# A rootfs extracted without root has its owners and device nodes in $PSEUDO,
+# which mksquashfs puts back, so it doesn't need root to build either
+PSEUDO_FILE=""
+if [ -e "$PSEUDO" ]; then
+	PSEUDO_FILE="$PSEUDO"
+	SUDO=""
+fi
+
 printf "Firmware Mod Kit (build) ${VERSION}, (c)2011-2013 Craig Heffner, Jeremy Collake\n\n"
 
 if [ ! -d "$DIR" ]; then
@@ -44,135 +52,204 @@ fi
 # Always try to rebuild, let make decide if necessary
 Build_Tools
 
-echo "Building new $FS_TYPE file system... (this may take several minutes!)"
-
 # Clean up any previously created files
-rm -rf "$FWOUT" "$FSOUT"
-
-# Build the appropriate file system
-case $FS_TYPE in
-	"squashfs")
-		# Check for squashfs 4.0 realtek, which requires the -comp option to build lzma images.
-		if [ "$FS_COMPRESSION" == "lzma" ]; then
-			if [ "$(echo $MKFS | grep 'squashfs-4.0-realtek')" != "" ] || [ "$(echo $MKFS | grep 'squashfs-4.2')" != "" ]; then
-				COMP="-comp lzma"
-			else
-				COMP=""
+rm -rf "$FWOUT" "$FSOUT" "$DIR"/new-partition*
+
+# Build a file system image from a directory: build_fs <type> <directory> <image> <MKFS> <block size>
+# <compression> <endianess> <pseudo file> <bytes of room for it>. The room, if given, is checked
+# against an estimate of the size before building where the MKFS can estimate it
+function build_fs()
+{
+	local TYPE="$1" TREE="$2" OUT="$3" MKFS="$4" FS_BLOCKSIZE="$5" FS_COMPRESSION="$6" ENDIANESS="$7"
+	local PSEUDO_FILE="$8" FS_ROOM="$9" COMP="" BS="" S="$SUDO"
+
+	# Owners and device nodes in the pseudo file don't need root to build
+	if [ "$PSEUDO_FILE" != "" ]; then
+		S=""
+	fi
+
+	case $TYPE in
+		"squashfs")
+			# Check for squashfs 4.0 realtek, which requires the -comp option to build lzma images.
+			if [ "$FS_COMPRESSION" == "lzma" ]; then
+				if [ "$(echo $MKFS | grep 'squashfs-4.0-realtek')" != "" ] || [ "$(echo $MKFS | grep 'squashfs-4.2')" != "" ]; then
+					COMP="-comp lzma"
+				fi
 			fi
-		fi
 
-		# Mksquashfs 4.0 tools don't support the -le option; little endian is built by default
-		if [ "$(echo $MKFS | grep 'squashfs-4.')" != "" ] && [ "$ENDIANESS" == "-le" ];	then
-			ENDIANESS=""
-		fi
+			# Mksquashfs 4.0 tools don't support the -le option; little endian is built by default
+			if [ "$(echo $MKFS | grep 'squashfs-4.')" != "" ] && [ "$ENDIANESS" == "-le" ];	then
+				ENDIANESS=""
+			fi
 		
-		# Increasing the block size minimizes the resulting image size (larger dictionary). Max block size of 1MB.
-		if [ "$NEXT_PARAM" == "-min" ];	then
-			echo "Blocksize override (-min). Original used $((FS_BLOCKSIZE/1024))KB blocks. New firmware uses 1MB blocks."
-			FS_BLOCKSIZE="$((1024*1024))"
-		fi
+			# Increasing the block size minimizes the resulting image size (larger dictionary). Max block size of 1MB.
+			if [ "$NEXT_PARAM" == "-min" ];	then
+				echo "Blocksize override (-min). Original used $((FS_BLOCKSIZE/1024))KB blocks. New firmware uses 1MB blocks."
+				FS_BLOCKSIZE="$((1024*1024))"
+			fi
 
-		# if blocksize var exists, then add '-b' parameter
-                if [ "$FS_BLOCKSIZE" != "" ]; then
-			BS="-b $FS_BLOCKSIZE"
-			HR_BLOCKSIZE="$(($FS_BLOCKSIZE/1024))"
-			echo "Squashfs block size is $HR_BLOCKSIZE Kb"
-		fi
+			# if blocksize var exists, then add '-b' parameter
+	                if [ "$FS_BLOCKSIZE" != "" ]; then
+				BS="-b $FS_BLOCKSIZE"
+				HR_BLOCKSIZE="$(($FS_BLOCKSIZE/1024))"
+				echo "Squashfs block size is $HR_BLOCKSIZE Kb"
+			fi
 
-		$SUDO $MKFS "$ROOTFS" "$FSOUT" $ENDIANESS $BS $COMP -all-root
-		;;
-	"cramfs")
-		$SUDO $MKFS "$ROOTFS" "$FSOUT"
-		if [ "$ENDIANESS" == "-be" ]; then
-			mv "$FSOUT" "$FSOUT.le"
-			./src/cramfsswap/cramfsswap "$FSOUT.le" "$FSOUT"
-			rm -f "$FSOUT.le"
-		fi
-		;;
-	"yaffs")
-		$SUDO $MKFS "$ROOTFS" "$FSOUT"
-		echo "WARNING: YAFFS2 completely untested !! Hit any key to confirm ..."
-		pause
-		;;
-	*)
-		echo "Unsupported file system '$FS_TYPE'!"
-		;;
-esac
+			# The 4.2 mksquashfs estimates the size from a sample of the blocks in seconds, so a file
+			# system that can't fit where the old one was fails here rather than after a full build.
+			# The estimate is within a few percent, so only one well over the space left is refused
+			if [ "$(echo $MKFS | grep 'squashfs-4.2/')" != "" ] && [ "$FS_ROOM" != "" ]; then
+				FS_ESTIMATE=$($S $MKFS "$TREE" "$OUT" $ENDIANESS $BS $COMP ${PSEUDO_FILE:+-pf "$PSEUDO_FILE"} -all-root -estimate 2>/dev/null | awk '/^Estimated filesystem size/ { print $4 }')
+				if [ "$FS_ESTIMATE" != "" ] && [ $FS_ESTIMATE -gt $(($FS_ROOM + $FS_ROOM / 50)) ]; then
+					echo "ERROR: The new file system is estimated at $FS_ESTIMATE bytes, but only $FS_ROOM bytes are left for it!"
+					echo "       Try re-running with the -min option, or remove any unnecessary files."
+					echo "       Quitting..."
+					return 1
+				fi
+			fi
 
-if [ ! -e $FSOUT ]; then
-	echo "Failed to create new file system! Quitting..."
-	exit 1
+			$S $MKFS "$TREE" "$OUT" $ENDIANESS $BS $COMP ${PSEUDO_FILE:+-pf "$PSEUDO_FILE"} -all-root
+			;;
+		"cramfs")
+			# cramfs-2.x mkcramfs writes big-endian images itself (-B)
+			if [ "$ENDIANESS" == "-be" ] && [ "$(echo $MKFS | grep 'cramfs-2.x')" != "" ]; then
+				$S $MKFS -B "$TREE" "$OUT"
+			elif [ "$ENDIANESS" == "-be" ]; then
+				$S $MKFS "$TREE" "$OUT"
+				mv "$OUT" "$OUT.le"
+				./src/cramfsswap/cramfsswap "$OUT.le" "$OUT"
+				rm -f "$OUT.le"
+			else
+				$S $MKFS "$TREE" "$OUT"
+			fi
+			;;
+		"yaffs")
+			$S $MKFS "$TREE" "$OUT"
+			echo "WARNING: YAFFS2 completely untested !! Hit any key to confirm ..."
+			pause
+			;;
+		"jffs2")
+			# mkjffs2 writes either byte order itself, with 64KiB erase blocks by default
+			if [ "$ENDIANESS" == "-be" ]; then
+				JFFS2_OPTS="-b"
+			else
+				JFFS2_OPTS="-l"
+			fi
+			if [ "$FS_COMPRESSION" == "lzma" ]; then
+				JFFS2_OPTS="$JFFS2_OPTS -c lzma"
+			fi
+			if [ "$FS_BLOCKSIZE" != "" ]; then
+				JFFS2_OPTS="$JFFS2_OPTS -e $FS_BLOCKSIZE"
+			fi
+			$S $MKFS $JFFS2_OPTS "$TREE" "$OUT"
+			;;
+		*)
+			echo "Unsupported file system '$TYPE'!"
+			;;
+	esac
+	return 0
+}
+
+# The file systems extract-firmware.sh found before the rootfs are rebuilt, side by side, only
+# where their trees no longer hash as they were extracted; the others are left as they are in
+# the header image
+PARTITION_JOBS=""
+PARTITION_OPTS=()
+for ((N=0; N<${PARTITIONS:-1}-1; N++))
+do
+	eval P_MKFS=\${PARTITION${N}_MKFS} P_TREE=\${PARTITION${N}_TREE} P_TYPE=\${PARTITION${N}_TYPE}
+	P_DIR="$DIR/partition$N"
+	if [ "$P_MKFS" == "" ] || [ ! -d "$P_DIR" ] || [ "$($SUDO ./src/fmk-treehash "$P_DIR")" == "$P_TREE" ]; then
+		continue
+	fi
+
+	eval P_OFFSET=\${PARTITION${N}_OFFSET} P_SPACE=\${PARTITION${N}_SPACE} P_BLOCKSIZE=\${PARTITION${N}_BLOCKSIZE}
+	eval P_COMPRESSION=\${PARTITION${N}_COMPRESSION} P_ENDIANESS=\${PARTITION${N}_ENDIANESS}
+	P_OUT="$DIR/new-partition$N.$P_TYPE"
+	P_PSEUDO="$LOGS/partition$N.pseudo"
+	[ -e "$P_PSEUDO" ] || P_PSEUDO=""
+	rm -f "$P_OUT"
+
+	echo "Building new $P_TYPE file system for partition $N (logged to $LOGS/partition$N.build.log)..."
+	build_fs "$P_TYPE" "$P_DIR" "$P_OUT" "$P_MKFS" "$P_BLOCKSIZE" "$P_COMPRESSION" "$P_ENDIANESS" "$P_PSEUDO" "$P_SPACE" \
+		> "$LOGS/partition$N.build.log" 2>&1 < /dev/null &
+	PARTITION_JOBS="$PARTITION_JOBS $!"
+	PARTITION_OPTS+=(-p "$P_OFFSET:$P_SPACE:$P_OUT")
+done
+
+# The last file system built is reused while the rootfs tree, the MKFS tool and
+# the options it was built with are the same
+FS_KEY=""
+TREE_HASH=$($SUDO ./src/fmk-treehash "$ROOTFS")
+if [ $? -eq 0 ] && [ -e "$MKFS" ]; then
+	FS_KEY="$TREE_HASH $(md5sum < "$MKFS" | cut -d' ' -f1) $FS_TYPE $FS_BLOCKSIZE $FS_COMPRESSION $ENDIANESS"
+	if [ "$NEXT_PARAM" == "-min" ]; then
+		FS_KEY="$FS_KEY -min"
+	fi
+	if [ "$PSEUDO_FILE" != "" ]; then
+		FS_KEY="$FS_KEY $(md5sum < "$PSEUDO_FILE" | cut -d' ' -f1)"
+	fi
 fi
 
-# Append the new file system to the first part of the original firmware file
-cp $HEADER_IMAGE $FWOUT
-$SUDO cat $FSOUT >> $FWOUT
-
-# Calculate and create any filler bytes required between the end of the file system and the footer / EOF.
-CUR_SIZE=$(ls -l $FWOUT | awk '{print $5}')
-((FILLER_SIZE=$FW_SIZE-$CUR_SIZE-$FOOTER_SIZE))
-
-if [ "$FILLER_SIZE" -lt 0 ]; then
-	echo "ERROR: New firmware image will be larger than original image!"
-	echo "       Building firmware images larger than the original can brick your device!"
-	echo "       Try re-running with the -min option, or remove any unnecessary files."
-	echo "       REFUSING to create new firmware image."
-	echo ""
-	echo "       Original file size: $FW_SIZE"
-	echo "       Current file size:  $CUR_SIZE (plus footer of $FOOTER_SIZE bytes)"
-	echo ""
-	echo "       Quitting..."
-#	rm -f "$FWOUT" "$FSOUT"
-	exit 1
+if [ "$FS_KEY" != "" ] && [ -e "$FSCACHE" ] && [ "$(cat "$FSCACHELOG" 2>/dev/null)" == "$FS_KEY" ]; then
+	echo "Reusing the last $FS_TYPE file system, nothing it is built from has changed"
+	cp --reflink=auto "$FSCACHE" "$FSOUT"
 else
-	if [ "$NEXT_PARAM" != "-nopad" ]; then
-		echo "Remaining free bytes in firmware image: $FILLER_SIZE"
-		perl -e "print \"\xFF\"x$FILLER_SIZE" >> "$FWOUT"
-	else
-		echo "Padding of firmware image disabled via -nopad"
-	fi	
+	echo "Building new $FS_TYPE file system... (this may take several minutes!)"
+
+	FS_ROOM=""
+	if [ "$FW_SIZE" != "" ] && [ -e "$HEADER_IMAGE" ]; then
+		FS_ROOM=$(($FW_SIZE - $(wc -c < "$HEADER_IMAGE") - ${FOOTER_SIZE:-0}))
+	fi
+	build_fs "$FS_TYPE" "$ROOTFS" "$FSOUT" "$MKFS" "$FS_BLOCKSIZE" "$FS_COMPRESSION" "$ENDIANESS" "$PSEUDO_FILE" "$FS_ROOM" || exit 1
+
+	if [ -e "$FSOUT" ] && [ "$FS_KEY" != "" ]; then
+		cp --reflink=auto "$FSOUT" "$FSCACHE" && echo "$FS_KEY" > "$FSCACHELOG"
+	fi
 fi
 
-# Append the footer to the new firmware image, if there is any footer
-if [ "$FOOTER_SIZE" -gt "0" ]; then
-	cat $FOOTER_IMAGE >> "$FWOUT"
+if [ "$PARTITION_JOBS" != "" ]; then
+	wait $PARTITION_JOBS
+	for ((I=1; I<${#PARTITION_OPTS[@]}; I+=2))
+	do
+		P_OUT="${PARTITION_OPTS[$I]#*:*:}"
+		if [ ! -e "$P_OUT" ]; then
+			echo "Failed to create new file system $P_OUT (see $LOGS)! Quitting..."
+			exit 1
+		fi
+	done
 fi
 
-CHECKSUM_ERROR=0
+if [ ! -e $FSOUT ]; then
+	echo "Failed to create new file system! Quitting..."
+	exit 1
+fi
 
-# Calculate new checksum values for the firmware header
-# trx, dlob, uimage
-# Buffalo and some other post-processors obfuscate these images
-# so we must akways try prior to vendor processing below
-./src/crcalc/crcalc "$FWOUT" "$BINLOG"
-if [ $? -ne 0 ]; then		
-	CHECKSUM_ERROR=1
+# Assemble the header image, the new file system, any filler bytes needed to
+# keep the original size and the footer, and calculate new checksum values for
+# the firmware header(s) in place: trx, dlob, uimage, tp-link (inner image first
+# for those with a bootloader). Buffalo and some other post-processors obfuscate
+# these images so we must always try prior to vendor processing below.
+CHECKSUM_ERROR=0
+PAD_OPT=""
+if [ "$NEXT_PARAM" == "-nopad" ]; then
+	PAD_OPT="-nopad"
 fi
+./src/fmk-assemble $PAD_OPT "${PARTITION_OPTS[@]}" "$DIR" "$FSOUT" "$FWOUT"
+case $? in
+	0)
+		;;
+	1)
+		CHECKSUM_ERROR=1
+		;;
+	*)
+		exit 1
+		;;
+esac
 
 # Vendor specific post-processing
-# For some images, will apply checksum (TP-Link)
-# Others, will encrypt image (Buffalo)
+# Some images will be encrypted (Buffalo)
 case $HEADER_TYPE in
-	"tp-link")
-		printf "\nCorrecting TP-Link firmware image ... "
-		src/tpl-tool/src/tpl-tool -x "$FWOUT"
-		if [ $? -ne 0 ]; then				
-			CHECKSUM_ERROR=1
-			printf "ERROR"
-		else		
-			src/tpl-tool/src/tpl-tool -b "$FWOUT"
-			mv "$FWOUT-new" "$FWOUT"
-			src/tpl-tool/src/tpl-tool -s "$FWOUT"
-			if [ $? -ne 0 ]; then		
-				CHECKSUM_ERROR=1
-				printf "ERROR"				
-			else
-				printf "Done"
-				CHECKSUM_ERROR=0
-			fi
-		fi
-		rm -f "$FWOUT-header" "$FWOUT-kernel" "$FWOUT-rootfs"
-		;;
 	"buffalo")
 		printf "\nEncrypting Buffalo firmware image ... "
 		src/firmware-tools/buffalo-enc -i "$FWOUT" -o "$FWOUT.enc"
@@ -196,5 +273,6 @@ fi
 if [ -e "$FSOUT" ]; then
 	rm -f "$FSOUT"
 fi
+rm -f "$DIR"/new-partition*
 
 printf "\nNew firmware image has been saved to: $FWOUT\n"
@@ -0,0 +1,96 @@
+#!/bin/bash
+# Script to build several squashfs images that share most of their contents: one image of a base
+# tree, then one image per overlay tree, each the base with the overlay's files added or replaced.
+#
+# The base image is the store of compressed blocks the variants share. Each variant is built with
+# mksquashfs -base, which copies the blocks and fragments of every file whose path, size and mtime
+# match the base image as they are stored there, so only the overlay's files are compressed again.
+
+MKSQUASHFS="./src/others/squashfs-4.2/squashfs-tools/mksquashfs"
+MKSQUASHFS_OPTS=""
+
+function usage()
+{
+	echo "Usage: $0 [-m mksquashfs] [-o 'mksquashfs options'] <base directory> <output directory> <overlay directory>..."
+	echo ""
+	echo "	-m	The mksquashfs to build with (default: $MKSQUASHFS)"
+	echo "	-o	Options passed to every mksquashfs run, e.g. '-comp xz -b 262144 -all-root'"
+	echo ""
+	echo "Writes <output directory>/base.squashfs and <output directory>/<overlay name>.squashfs for each overlay."
+	exit 1
+}
+
+while getopts "m:o:h" OPT; do
+	case $OPT in
+		m)
+			MKSQUASHFS="$OPTARG";;
+		o)
+			MKSQUASHFS_OPTS="$OPTARG";;
+		*)
+			usage;;
+	esac
+done
+shift $((OPTIND-1))
+
+BASE="$1"
+OUT="$2"
+shift 2
+
+if [ "$BASE" == "" ] || [ "$OUT" == "" ] || [ $# -eq 0 ] || [ ! -d "$BASE" ]; then
+	usage
+fi
+
+BASE=$(readlink -f "$BASE")
+mkdir -p "$OUT" || exit 1
+OUT=$(readlink -f "$OUT")
+OVERLAYS=()
+for OVERLAY in "$@"
+do
+	if [ ! -d "$OVERLAY" ]; then
+		echo "Overlay $OVERLAY is not a directory!"
+		exit 1
+	fi
+	OVERLAYS+=("$(readlink -f "$OVERLAY")")
+done
+
+# Make sure we're operating out of the FMK directory
+cd $(dirname $(readlink -f $0))
+
+if [ ! -x "$MKSQUASHFS" ]; then
+	echo "$MKSQUASHFS not found, build it first!"
+	exit 1
+fi
+
+printf "Firmware Mod Kit (build-variants) $(cat firmware_mod_kit_version.txt), (c)2011-2013 Craig Heffner, Jeremy Collake\n\n"
+
+BASE_IMG="$OUT/base.squashfs"
+TREE="$OUT/.variant-tree"
+
+echo "Building the base image $BASE_IMG ..."
+$MKSQUASHFS "$BASE" "$BASE_IMG" -noappend $MKSQUASHFS_OPTS || exit 1
+
+for OVERLAY in "${OVERLAYS[@]}"
+do
+	IMG="$OUT/$(basename "$OVERLAY").squashfs"
+
+	# The variant's tree is the base hard linked, where it can be, so it takes no copying, with
+	# the overlay copied over it. Overlay files replace the links rather than writing through them
+	rm -rf "$TREE"
+	cp -al "$BASE" "$TREE" 2>/dev/null || (rm -rf "$TREE" && cp -a "$BASE" "$TREE")
+	if [ $? -ne 0 ] || ! cp -a --remove-destination "$OVERLAY/." "$TREE/"; then
+		echo "Failed to lay $OVERLAY over $BASE!"
+		rm -rf "$TREE"
+		exit 1
+	fi
+
+	echo "Building $IMG from $OVERLAY ..."
+	$MKSQUASHFS "$TREE" "$IMG" -noappend -base "$BASE_IMG" $MKSQUASHFS_OPTS
+	STATUS=$?
+	rm -rf "$TREE"
+	if [ $STATUS -ne 0 ]; then
+		exit 1
+	fi
+done
+
+echo "Built $(( ${#OVERLAYS[@]} + 1 )) image(s) in $OUT"
+exit 0
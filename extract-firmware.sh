@@ -19,6 +19,16 @@ fi
 IMG=$(readlink -f $IMG)
 DIR=$(readlink -f $DIR)
 
+# With FMK_INDEX=<index> set, the extractors add the files they write to that index
+# (see src/fmkindex/fmkindex.h) as files of the firmware rather than of rootfs.img
+if [ "${FMK_INDEX}" != "" ]; then
+	export FMK_INDEX=$(readlink -m "${FMK_INDEX}")
+	export FMK_INDEX_IMAGE="${IMG}"
+	if [ "${SUDO}" != "" ]; then
+		SUDO="sudo --preserve-env=FMK_INDEX,FMK_INDEX_IMAGE"
+	fi
+fi
+
 # Make sure we're operating out of the FMK directory
 cd $(dirname $(readlink -f $0))
 
@@ -45,168 +55,115 @@ fi
 
 Build_Tools
 
-# Get the size, in bytes, of the target firmware image
-FW_SIZE=$(ls -l "${IMG}" | cut -d' ' -f5)
-
-# Create output directories
-mkdir -p "${DIR}/logs"
-mkdir -p "${DIR}/image_parts"
-
-echo "Scanning firmware..."
-
-# Log binwalk results to the ${BINLOG} file, disable default filters, exclude invalid results,
-# and search only for trx, uimage, dlob, squashfs, and cramfs results.
-#${BINWALK} -f "${BINLOG}" -d -x invalid -y trx -y uimage -y dlob -y squashfs -y cramfs "${IMG}"
-${BINWALK} -f "${BINLOG}" "${IMG}"
-
-# Set Internal Field Separator (IFS) via two lines to newline only (bashism would be $'\n')
-IFS='
-'
-
-# Header image offset is ALWAYS 0. Header checksums are simply updated by build-ng.sh.
-HEADER_IMAGE_OFFSET=0
-
-# Loop through binwalk log file
-for LINE in IFS='
-'$(sort -n ${BINLOG} | grep -v -e '^DECIMAL' -e '^---')
- do
-	# Get decimal file offset and the first word of the description
-	OFFSET=$(echo ${LINE} | awk '{print $1}')
-	DESCRIPTION=$(echo ${LINE} | awk '{print tolower($3)}')
-
-	# Offset 0 is firmware header
-	if [ "${OFFSET}" = "0" ]; then
-		HEADER_OFFSET=${OFFSET}
-		HEADER_TYPE=${DESCRIPTION}
-		HEADER_SIZE=$(echo ${LINE} | sed -e 's/.*header size: //' | cut -d' ' -f1)
-		HEADER_IMAGE_SIZE=$(echo ${LINE} | sed -e 's/.*image size: //' | cut -d' ' -f1)
-
-	# Check to see if this line is a file system entry
-	elif [ "$(echo ${LINE} | grep -i filesystem)" != "" ]
-	 then
-		FS_OFFSET=${OFFSET}
-		FS_TYPE=${DESCRIPTION}
-
-		# Need to know endianess for re-assembly
-		if [ "$(echo ${LINE} | grep -i 'big endian')" != "" ]; then
-			ENDIANESS="-be"
-		else
-			ENDIANESS="-le"
-		fi
-
-		# Check for compression type of the file system. Default to LZMA
-		if [ "$(echo ${LINE} | grep -i 'gzip')" != "" ];  then
-			FS_COMPRESSION="gzip"
-		else
-			FS_COMPRESSION="lzma"
-		fi
-
-		# Check for a block size (used only by squashfs)
-		if [ "$(echo ${LINE} | grep -i 'blocksize')" != "" ]; then
-			set -f
-			IFS=,
-			for fsparam in ${LINE}
-			do
-				if [[ $fsparam = *blocksize* ]]; then
-				  fsparam="${fsparam##*blocksize: }"
-				  FS_BLOCKSIZE="${fsparam%* bytes}"
-				  break
-				fi
-			done
-		fi
-		set +f; unset IFS
-	fi
-done
-
-# Header image size is everything from the header image offset (0) up to the file system
-HEADER_IMAGE_SIZE=$((${FS_OFFSET}-${HEADER_IMAGE_OFFSET}))
-
-# Extract the header + image up to the file system
-echo "Extracting ${HEADER_IMAGE_SIZE} bytes of ${HEADER_TYPE} header image at offset ${HEADER_IMAGE_OFFSET}"
-dd if="${IMG}" bs=${HEADER_IMAGE_SIZE} skip=${HEADER_IMAGE_OFFSET} count=1 of="${HEADER_IMAGE}" 2>/dev/null
-
-if [ "${FS_OFFSET}" != "" ]; then
-	echo "Extracting ${FS_TYPE} file system at offset ${FS_OFFSET}"
-	dd if="${IMG}" bs=${FS_OFFSET} skip=1 of="${FSIMG}" 2>/dev/null
-else
-	echo "ERROR: No supported file system found! Aborting..."
+# Scan the image, split it into the header image, file system and footer, and log
+# the results (BINLOG, CONFLOG and the CRC state of the header image in CRCLOG, all of
+# which MANIFEST holds too for the native tools)
+./src/fmk-extract "${IMG}" "${DIR}"
+if [ ${?} -ne 0 ]; then
 	rm -rf "${DIR}"
 	exit 1
 fi
 
-FOOTER_SIZE=0
-FOOTER_OFFSET=0
-
-# Try to determine if there is a footer at the end of the firmware image.
-# Grab the last 10 lines of a hexdump of the firmware image, excluding the
-# last line in the hexdump. Reverse the line order and replace any lines
-# that start with '*' with the word 'FILLER'.
-for LINE in $(hexdump -C ${IMG} | tail -11 | head -10 | sed -n '1!G;h;$p' | sed -e 's/^*/FILLER/')
- do
-	if [ "${LINE}" = "FILLER" ]; then
-		break
-	else
-		FOOTER_SIZE=$((${FOOTER_SIZE}+16))
+eval $(cat ${CONFLOG})
+
+# Extract a file system image into a directory: extract_fs <type> <image> <directory> <endianess> <pseudo file>.
+# Progress goes to stderr and the MKFS line for build-firmware.sh to stdout. Returns 1 for a file
+# system type there is no extractor for and 2 when the extractor failed
+function extract_fs()
+{
+	case ${1} in
+		"squashfs")
+			echo "Extracting squashfs files..." 1>&2
+			# Without root, try first to unsquash as the calling user, the owners and device
+			# nodes going to the pseudo file for build-firmware.sh to put back
+			MKFS_VAR=""
+			if [ "${SUDO}" != "" ]; then
+				MKFS_VAR=$(./unsquashfs_all.sh "${2}" "${3}" "${5}" 2>/dev/null | grep MKFS)
+				if [ "${MKFS_VAR}" == "" ]; then
+					rm -rf "${3}" "${5}"
+				fi
+			fi
+			if [ "${MKFS_VAR}" == "" ]; then
+				MKFS_VAR=$(${SUDO} ./unsquashfs_all.sh "${2}" "${3}" 2>/dev/null | grep MKFS)
+			fi
+			[ "${MKFS_VAR}" == "" ] && return 2
+			echo "${MKFS_VAR}"
+			;;
+		"cramfs")
+			echo "Extracting CramFS file system..." 1>&2
+			MKFS_VAR=$(${SUDO} ./uncramfs_all.sh "${2}" "${3}" ${4} 2>/dev/null | grep MKFS)
+			[ "${MKFS_VAR}" == "" ] && return 2
+			echo "${MKFS_VAR}"
+			;;
+		"yaffs")
+			echo "Extracting YAFFS file system..." 1>&2
+			${SUDO} ./src/yaffs2utils/unyaffs2 "${2}" "${3}" 1>&2 2>/dev/null || return 2
+			echo "MKFS='./src/yaffs2utils/mkyaffs2'"
+			;;
+		"jffs2")
+			echo "Extracting JFFS2 file system..." 1>&2
+			# Straight into the directory; unjffs2 extracts to 'rootfs' in the working directory,
+			# which jobs running side by side would share
+			${SUDO} ./src/jffs2/jffs2extract "${2}" "${3}" 1>&2 2>/dev/null || return 2
+			echo "MKFS='./src/jffs2/mkjffs2'"
+			;;
+		*)
+			echo "Unsupported file system '${1}'!" 1>&2
+			return 1
+			;;
+	esac
+	return 0
+}
+
+# The file systems before the rootfs (PARTITION0 up to the rootfs's, the last) are extracted
+# into ${DIR}/partition<n> alongside it, each job getting its share of the processors
+PARTITION_JOBS=""
+if [ "${PARTITIONS:-1}" -gt 1 ]; then
+	export FMK_PROCESSORS=$(( $(nproc 2>/dev/null || echo 1) / ${PARTITIONS} ))
+	if [ ${FMK_PROCESSORS} -lt 1 ]; then
+		FMK_PROCESSORS=1
 	fi
-done
 
-# If a footer was found, dump it out
-if [ "${FOOTER_SIZE}" != "0" ]; then
-	FOOTER_OFFSET=$((${FW_SIZE}-${FOOTER_SIZE}))
-	echo "Extracting ${FOOTER_SIZE} byte footer from offset ${FOOTER_OFFSET}"
-	dd if="${IMG}" bs=1 skip=${FOOTER_OFFSET} count=${FOOTER_SIZE} of="${FOOTER_IMAGE}" 2>/dev/null
-else
-	FOOTER_OFFSET=${FW_SIZE}
+	for ((N=0; N<${PARTITIONS}-1; N++))
+	do
+		eval P_TYPE=\${PARTITION${N}_TYPE} P_ENDIANESS=\${PARTITION${N}_ENDIANESS}
+		echo "Extracting ${P_TYPE} partition ${N} to ${DIR}/partition${N} (logged to ${LOGS}/partition${N}.log)..."
+		(extract_fs "${P_TYPE}" "${IMAGE_PARTS}/partition${N}.img" "${DIR}/partition${N}" "${P_ENDIANESS}" \
+			"${LOGS}/partition${N}.pseudo" 2>"${LOGS}/partition${N}.log" | sed "s/^MKFS=/PARTITION${N}_MKFS=/" \
+			> "${LOGS}/partition${N}.mkfs") &
+		PARTITION_JOBS="${PARTITION_JOBS} ${!}"
+	done
 fi
 
-# Log the parsed values to the CONFLOG for use when re-building the firmware
-echo "FW_SIZE='${FW_SIZE}'" > ${CONFLOG}
-echo "HEADER_TYPE='${HEADER_TYPE}'" >> ${CONFLOG}
-echo "HEADER_SIZE='${HEADER_SIZE}'" >> ${CONFLOG}
-echo "HEADER_IMAGE_SIZE='${HEADER_IMAGE_SIZE}'" >> ${CONFLOG}
-echo "HEADER_IMAGE_OFFSET='${HEADER_IMAGE_OFFSET}'" >> ${CONFLOG}
-echo "FOOTER_SIZE='${FOOTER_SIZE}'" >> ${CONFLOG}
-echo "FOOTER_OFFSET='${FOOTER_OFFSET}'" >> ${CONFLOG}
-echo "FS_TYPE='${FS_TYPE}'" >> ${CONFLOG}
-echo "FS_OFFSET='${FS_OFFSET}'" >> ${CONFLOG}
-echo "FS_COMPRESSION='${FS_COMPRESSION}'" >> ${CONFLOG}
-echo "FS_BLOCKSIZE='${FS_BLOCKSIZE}'" >> ${CONFLOG}
-echo "ENDIANESS='${ENDIANESS}'" >> ${CONFLOG}
-
-# Extract the file system and save the MKFS variable to the CONFLOG
-case ${FS_TYPE} in
-	"squashfs")
-		echo "Extracting squashfs files..."
-		${SUDO} ./unsquashfs_all.sh "${FSIMG}" "${ROOTFS}" 2>/dev/null | grep MKFS >> "${CONFLOG}"
-		;;
-	"cramfs")
-		echo "Extracting CramFS file system..."
-		${SUDO} ./uncramfs_all.sh "${FSIMG}" "${ROOTFS}" ${ENDIANESS} 2>/dev/null | grep MKFS >> "${CONFLOG}"
-		;;
-	"yaffs")
-		echo "Extracting YAFFS file system..."
-		${SUDO} ./src/yaffs2utils/unyaffs2 "${FSIMG}" "${ROOTFS}" 2>/dev/null 
-		echo "MKFS='./src/yaffs2utils/mkyaffs2'" >> "${CONFLOG}"
-		;;
-	"jffs2")
-		echo "Extracting JFFS2 file system..."
-		${SUDO} ./src/jffs2/unjffs2 "${FSIMG}" 1>&2 2>/dev/null
-		# unjffs2 extracts to hard-coded directory of 'rootfs'
-		if [ -e "rootfs" ]
-		then
-			${SUDO} mv rootfs "${ROOTFS}"
+# Extract the rootfs and save the MKFS variable to the CONFLOG
+MKFS_VAR=$(extract_fs "${FS_TYPE}" "${FSIMG}" "${ROOTFS}" "${ENDIANESS}" "${PSEUDO}")
+STATUS=${?}
+[ "${MKFS_VAR}" != "" ] && echo "${MKFS_VAR}" >> "${CONFLOG}"
+
+# Then the partitions' MKFS lines, with the hash of each tree for build-firmware.sh to tell
+# which of them were changed and need rebuilding
+if [ "${PARTITION_JOBS}" != "" ]; then
+	wait ${PARTITION_JOBS}
+	for ((N=0; N<${PARTITIONS}-1; N++))
+	do
+		if [ -s "${LOGS}/partition${N}.mkfs" ] && [ -d "${DIR}/partition${N}" ]; then
+			cat "${LOGS}/partition${N}.mkfs" >> "${CONFLOG}"
+			echo "PARTITION${N}_TREE='$(${SUDO} ./src/fmk-treehash "${DIR}/partition${N}")'" >> "${CONFLOG}"
+		else
+			echo "WARNING: Partition ${N} could not be extracted, it is kept as it is (see ${LOGS}/partition${N}.log)"
 		fi
-		echo "MKFS='./src/jffs2/mkjffs2'" >> "${CONFLOG}"
-		;;
-	*)
-		echo "Unsupported file system '${FS_TYPE}'! Quitting..."
-		rm -rf "${DIR}"
-		exit 1
-		;;
-esac
+		rm -f "${LOGS}/partition${N}.mkfs"
+	done
+fi
+
+if [ ${STATUS} -eq 1 ]; then
+	echo "Unsupported file system '${FS_TYPE}'! Quitting..."
+	rm -rf "${DIR}"
+	exit 1
+fi
 
 # Check if file system extraction was successful
-if [ ${?} -eq 0 ]; then
+if [ ${STATUS} -eq 0 ] && [ "${MKFS_VAR}" != "" ]; then
 	echo "Firmware extraction successful!"
 	echo "Firmware parts can be found in '${DIR}/*'"
 else
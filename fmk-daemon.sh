@@ -0,0 +1,61 @@
+#!/bin/bash
+# Script to serve extract, build and list requests on a Unix socket, for services that run
+# the kit on many images. Talk to it with ./src/fmk-daemon -c <socket> <request...>.
+BINDIR=`dirname $0`
+. "$BINDIR/common.inc"
+
+JOBS=$(nproc 2>/dev/null || echo 1)
+
+function usage()
+{
+	echo "Usage: $0 [-j jobs] <socket>"
+	echo ""
+	echo "	-j	Most requests to run at once (default: $JOBS)"
+	echo ""
+	echo "Requests, one per connection:"
+	echo "	extract <image> <working directory>"
+	echo "	build <working directory> [-nopad | -min]"
+	echo "	list <working directory>"
+	exit 1
+}
+
+while getopts "j:h" OPT; do
+	case $OPT in
+		j)
+			JOBS="$OPTARG";;
+		*)
+			usage;;
+	esac
+done
+shift $((OPTIND-1))
+
+SOCKET="$1"
+
+if [ "$SOCKET" == "" ]; then
+	usage
+fi
+
+SOCKET=$(readlink -f "$SOCKET")
+
+# Make sure we're operating out of the FMK directory
+cd $(dirname $(readlink -f $0))
+
+printf "Firmware Mod Kit (daemon) $(cat firmware_mod_kit_version.txt), (c)2011-2013 Craig Heffner, Jeremy Collake\n\n"
+
+# Build the tools once here, rather than checking in every request
+Build_Tools
+export FMK_TOOLS_BUILT=1
+
+# As in batch-firmware.sh, run as root in a user namespace where the kernel allows it, so no
+# request stops to ask for a sudo password it has no terminal for
+PREFIX=""
+if [ "$(id -ru)" != "0" ]; then
+	if unshare -r true 2>/dev/null; then
+		PREFIX="unshare -r"
+	else
+		echo "User namespaces are not available, requests will use sudo."
+		sudo -v || exit 1
+	fi
+fi
+
+exec $PREFIX ./src/fmk-daemon -j "$JOBS" "$SOCKET"
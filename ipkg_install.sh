@@ -3,6 +3,7 @@
 # $Id: ipkg_install.sh 336 2012-08-04 00:12:14Z jeremy.collake@gmail.com $
 #
 . "./shared.inc"
+. "./common.inc"
 ### 20110225-MCT The VERSION is set in the shared.inc file from a single external source now.
 VERSION="${SHARED_VERSION}"
 #
@@ -39,18 +40,6 @@ VERSION="${SHARED_VERSION}"
 echo "$0 v$VERSION, (c)2006-2012 Jeremy Collake"
 echo " !!WARNING!!! This script is in early alpha stage of development"
 
-############################################333
-# CleanupTmp [base_dir] [package basename]
-#
-# basename=name w/o IPK (contrasts below labels)
-CleanupTmp()
-{	
-	echo " Cleanup" >> /dev/null 2>&1
-	rm -rf "$1/tmp" >> /dev/null 2>&1
-	rm -f "$1/$2" >> /dev/null 2>&1
-}
-
-
 ##################################################
 if [ ! $# = "2" ]; then
 	echo " Invalid usage"
@@ -65,72 +54,11 @@ if [ ! -e "$1" ]; then
 	exit 1
 fi
 
-OLD_DIR=`pwd`
-##################################################
-# notes:
-# OS X's tar utility doesn't like GZIP'd TARs .. (re: not TAR'd GZIPs ..),
-#  else we could just use tar (which under linux accepts GZIPs as well).
-#
-mkdir -p "$2/installed_packages/" >> ipkg_install.log 2>&1
-cp $1 "$2/installed_packages/"
-cd "$2/installed_packages"
-INSIDE_NAME=`echo "$BASE_NAME" | sed "s/.ipk/ /"`
-gunzip < "$BASE_NAME" > "$INSIDE_NAME"
-echo " Assuming contents bore $INSIDE_NAME"
-rm -rf tmp
-mkdir tmp
-tar -xf "$INSIDE_NAME" -C "tmp/"
-if [ $? != 0 ]; then
-	echo " ERROR: Extraction failed or incompatible format."
-	CleanupTmp "." "$INSIDE_NAME"
-	exit 1
-fi
 ##################################################
-echo " --------------------------------------------"
-echo " Examining control files $2/rootfs ..."
-echo " Pay attention to the dependencies as you"
-echo "  may need to install some of them ..."
-echo 
-tar -xzvf "tmp/control.tar.gz" -C "tmp/"
-if [ $? != "0" ] || [ ! -e "tmp/control" ]; then
-	echo " ERROR: Extraction failed of control files (missing from IPK?)"
-	CleanupTmp "." "$INSIDE_NAME"
-	cd "$OLD_DIR"
-	exit 1
-else
-	# todo: add proper dependency checking and more
-	#
-OLD_IFS="$IFS"
-IFS="NEWLINE"
-	cat "tmp/control"
-	for i in $( cat "tmp/control" | sed "s/N\/A/ /" ); do		
-		#echo " | $i"
-		if [ `expr "$i" : "Source"` = 7 ]; then			
-SOURCE_PATH=`echo $i | sed s/Source:/ /`
-			#echo " dbg: handling SOURCE of $SOURCE_PATH"
-			if [ `expr "$SOURCE_PATH" : "http://"` = 7 ] || [ `expr "$SOURCE_PATH" : "ftp://"` = 7 ]; then
-				echo " Found remote source .. downloading"
-				echo " !! THIS PART IS UNTESTED. WHO KNOWS IF IT WORKS ATM ;p"
-				wget "$SOURCE_PATH"
-			fi
-		fi
-	done
-fi
-IFS="$OLD_IFS"
-echo " --------------------------------------------"
-##################################################
-echo " Extracting data files to $2/rootfs ..."
-tar --overwrite -xzvf "tmp/data.tar.gz" -C "../rootfs" 
-# no longer do this, we'll let the user evaluate the tar output..
-#if [ "$?" != "0" ]; then
-#	echo " ERROR: Extraction failed of data.tar.gz - missing from IPK?"
-#	CleanupTmp "." "$INSIDE_NAME"
-#	cd "$OLD_DIR"
-#	exit 1
-#else
-	echo " Package installed !"	
-#fi
-##################################################
-CleanupTmp "." "$INSIDE_NAME"
-cd "$OLD_DIR"
-exit 0
+# fmk-ipkg unpacks data.tar.gz straight into the rootfs, prints the
+# control file, and lists the files installed in
+# installed_packages/<package>.list for ipkg_remove.sh
+#
+Build_Tools
+./src/fmk-ipkg install "$2" "$1"
+exit $?
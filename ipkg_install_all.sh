@@ -3,6 +3,7 @@
 # $Id: ipkg_install_all.sh 336 2012-08-04 00:12:14Z jeremy.collake@gmail.com $
 #
 . "./shared.inc"
+. "./common.inc"
 ### 20110225-MCT The VERSION is set in the shared.inc file from a single external source now.
 VERSION="${SHARED_VERSION}"
 #
@@ -42,6 +43,6 @@ if [ ! -e "$1" ]; then
 	exit 1
 fi
 ##################################################
-for i in $( ls "$1" ); do
-	./ipkg_install.sh $1/$i $2
-done
+# All of them in one run, read several at a time but installed in order
+Build_Tools
+./src/fmk-ipkg install "$2" "$1"/*
@@ -19,11 +19,32 @@ else
         SUDO=""
 fi
 
-mkdir "$DEST/rootfs.bak"
-cp -rf "$DEST/rootfs/*" "$DEST/rootfs.bak/"
-mkdir "$DEST/image_parts.bak"
-cp -rf "$DEST/image_parts/*" "$DEST/image_parts.bak/"
-$SUDO cp -rf "$SRC/rootfs" "$DEST/"
-$SUDO cp -rf "$SRC/image_parts" "$DEST/"
+# fmk-transplant clones file data where the file system can, and
+# copies the rest in parallel; cp -a does the same job more slowly
+BINDIR=`dirname $0`
+if [ -x "$BINDIR/../src/fmk-transplant" ]; then
+	COPY="$BINDIR/../src/fmk-transplant"
+elif [ -x "./src/fmk-transplant" ]; then
+	COPY="./src/fmk-transplant"
+else
+	COPY="cp -a"
+fi
+
+for PART in rootfs image_parts
+do
+	if [ -e "$DEST/$PART.bak" ]; then
+		echo "$DEST/$PART.bak already exists, move it out of the way first."
+		exit 1
+	fi
+done
+
+# The backups are just renames, the transplanted trees are fresh copies
+for PART in rootfs image_parts
+do
+	if [ -e "$DEST/$PART" ]; then
+		$SUDO mv "$DEST/$PART" "$DEST/$PART.bak" || exit 1
+	fi
+	$SUDO $COPY "$SRC/$PART" "$DEST/$PART" || exit 1
+done
 
 echo "All done! $SRC contents (but not format) transplanted to $DEST"
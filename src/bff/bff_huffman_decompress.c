@@ -55,9 +55,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "bff_unpack.h"
 #define	PACK_HEADER_LENGTH	1
 #define	HTREE_MAXLEVEL		24
 
+#define	UNPACK_TABLE_BITS	11	/* code bits resolved per lookup */
+#define	UNPACK_BUFSIZE		(256 * 1024)	/* input and output blocks */
+
 /*
  * unpack descriptor
  *
@@ -94,24 +100,33 @@ int maybe_errx(char*fmt,...) {
 }
 
 /*
- * Release resource allocated to an unpack descriptor.
- *
- * Caller is responsible to make sure that all of these pointers are
- * initialized (in our case, they all point to valid memory block).
- * We don't zero out pointers here because nobody else would ever
- * reference the memory block without scrubbing them.
+ * Release the tables allocated to an unpack descriptor.  Pointers not
+ * got to yet are NULL.
  */
 static void
-unpack_descriptor_fini(unpack_descriptor_t *unpackd)
+unpack_descriptor_free(unpack_descriptor_t *unpackd)
 {
 
 	free(unpackd->symbolsin);
 	free(unpackd->inodesin);
 	free(unpackd->symbol);
 	free(unpackd->tree);
+}
+
+/*
+ * Release resource allocated to an unpack descriptor, and the streams
+ * it opened.
+ */
+static void
+unpack_descriptor_fini(unpack_descriptor_t *unpackd)
+{
 
-	fclose(unpackd->fpIn);
-	fclose(unpackd->fpOut);
+	unpack_descriptor_free(unpackd);
+
+	if (unpackd->fpIn != NULL)
+		fclose(unpackd->fpIn);
+	if (unpackd->fpOut != NULL)
+		fclose(unpackd->fpOut);
 }
 
 /*
@@ -146,43 +161,24 @@ accepted_bytes(off_t *bytes_in, off_t newbytes)
 }
 
 /*
- * Read file header and construct the tree.  Also, prepare the buffered I/O
- * for decode routine.
- *
- * Return value is uncompressed size.
+ * Construct the tree from the level count and symbol tables, read from
+ * unpackd->fpIn, for a header giving 'levels' levels.  Returns 0, or -1
+ * for tables that cannot be decoded with.
  */
-static void
-unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
-    unpack_descriptor_t *unpackd)
+static int
+unpack_parse_tables(unpack_descriptor_t *unpackd, int levels, off_t *bytes_in)
 {
-	unsigned char hdr[PACK_HEADER_LENGTH];	/* buffer for header */
-	ssize_t bytesread;		/* Bytes read from the file */
 	int i, j, thisbyte;
 
-	/* Prepend the header buffer if we already read some data */
-	if (prelen != 0)
-		memcpy(hdr, pre, prelen);
-
-	/* Read in and fill the rest bytes of header */
-	bytesread = read(in, hdr + prelen, PACK_HEADER_LENGTH - prelen);
-	if (bytesread < 0)
-		maybe_err("Error reading pack header");
-
-	accepted_bytes(bytes_in, PACK_HEADER_LENGTH);
-
 	/* Reset uncompressed size */
 	unpackd->uncompressed_size = 0;
 
 	/* Get the levels of the tree */
-	unpackd->treelevels = hdr[0];
-	if (unpackd->treelevels > HTREE_MAXLEVEL || unpackd->treelevels < 1)
+	unpackd->treelevels = levels;
+	if (unpackd->treelevels > HTREE_MAXLEVEL || unpackd->treelevels < 1) {
 		maybe_errx("Huffman tree has insane levels");
-
-	/* Let libc take care for buffering from now on */
-	if ((unpackd->fpIn = fdopen(in, "r")) == NULL)
-		maybe_err("Can not fdopen() input stream");
-	if ((unpackd->fpOut = fdopen(out, "w")) == NULL)
-		maybe_err("Can not fdopen() output stream");
+		return (-1);
+	}
 
 	/* Allocate for the tables of bounds and the tree itself */
 	unpackd->inodesin =
@@ -192,8 +188,10 @@ unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
 	unpackd->tree =
 	    calloc(unpackd->treelevels, (sizeof (*(unpackd->tree))));
 	if (unpackd->inodesin == NULL || unpackd->symbolsin == NULL ||
-	    unpackd->tree == NULL)
+	    unpackd->tree == NULL) {
 		maybe_err("calloc");
+		return (-1);
+	}
 
 	/* We count from 0 so adjust to match array upper bound */
 	unpackd->treelevels--;
@@ -201,19 +199,25 @@ unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
 	/* Read the levels symbol count table and calculate total */
 	unpackd->symbol_size = 1;		/* EOB */
 	for (i = 0; i <= unpackd->treelevels; i++) {
-		if ((thisbyte = fgetc(unpackd->fpIn)) == EOF)
+		if ((thisbyte = fgetc(unpackd->fpIn)) == EOF) {
 			maybe_err("File appears to be truncated");
+			return (-1);
+		}
 		unpackd->symbolsin[i] = (unsigned char)thisbyte;
 		unpackd->symbol_size += unpackd->symbolsin[i];
 	}
 	accepted_bytes(bytes_in, unpackd->treelevels);
-	if (unpackd->symbol_size > 256)
+	if (unpackd->symbol_size > 256) {
 		maybe_errx("Bad symbol table");
+		return (-1);
+	}
 
 	/* Allocate for the symbol table, point symbol_eob at the beginning */
 	unpackd->symbol_eob = unpackd->symbol = calloc(1, unpackd->symbol_size);
-	if (unpackd->symbol == NULL)
+	if (unpackd->symbol == NULL) {
 		maybe_err("calloc");
+		return (-1);
+	}
 
 	/*
 	 * Read in the symbol table, which contain [2, 256] symbols.
@@ -228,8 +232,10 @@ unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
 	for (i = 0; i <= unpackd->treelevels; i++) {
 		unpackd->tree[i] = unpackd->symbol_eob;
 		for (j = 0; j < unpackd->symbolsin[i]; j++) {
-			if ((thisbyte = fgetc(unpackd->fpIn)) == EOF)
+			if ((thisbyte = fgetc(unpackd->fpIn)) == EOF) {
 				maybe_errx("Symbol table truncated");
+				return (-1);
+			}
 			*unpackd->symbol_eob++ = (char)thisbyte;
 		}
 		accepted_bytes(bytes_in, unpackd->symbolsin[i]);
@@ -243,85 +249,264 @@ unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
 	 * Calculate the internal nodes count table based on it.
 	 */
 	unpackd_fill_inodesin(unpackd, 0);
+
+	return (0);
+}
+
+/*
+ * Read file header and construct the tree.  Also, prepare the buffered I/O
+ * for decode routine.
+ *
+ * Returns 0, or -1 if the stream cannot be decoded.
+ */
+static int
+unpack_parse_header(int in, int out, char *pre, size_t prelen, off_t *bytes_in,
+    unpack_descriptor_t *unpackd)
+{
+	unsigned char hdr[PACK_HEADER_LENGTH];	/* buffer for header */
+	ssize_t bytesread;		/* Bytes read from the file */
+
+	/* Prepend the header buffer if we already read some data */
+	if (prelen != 0)
+		memcpy(hdr, pre, prelen);
+
+	/* Read in and fill the rest bytes of header */
+	bytesread = read(in, hdr + prelen, PACK_HEADER_LENGTH - prelen);
+	if (bytesread < 0)
+		maybe_err("Error reading pack header");
+
+	accepted_bytes(bytes_in, PACK_HEADER_LENGTH);
+
+	/* Let libc take care for buffering from now on */
+	if ((unpackd->fpIn = fdopen(in, "r")) == NULL)
+		maybe_err("Can not fdopen() input stream");
+	if ((unpackd->fpOut = fdopen(out, "w")) == NULL)
+		maybe_err("Can not fdopen() output stream");
+	if (unpackd->fpIn == NULL || unpackd->fpOut == NULL)
+		return (-1);
+
+	return (unpack_parse_tables(unpackd, hdr[0], bytes_in));
+}
+
+/*
+ * Input bits, most significant first, left aligned in a 64 bit buffer
+ * topped up from a large block read off the input stream.
+ */
+typedef struct {
+	FILE		*fp;
+	unsigned char	*buf;
+	size_t		pos, len;
+	uint64_t	bits;
+	int		count;		/* valid bits in 'bits' */
+	off_t		*bytes_in;
+} unpack_bits_t;
+
+/*
+ * Fill the bit buffer with as many whole bytes as fit.  Returns the
+ * number of valid bits, 0 once the input is exhausted.
+ */
+static int
+unpack_fill(unpack_bits_t *br)
+{
+
+	while (br->count <= 56) {
+		if (br->pos == br->len) {
+			br->len = fread(br->buf, 1, UNPACK_BUFSIZE, br->fp);
+			br->pos = 0;
+			if (br->len == 0)
+				break;
+			accepted_bytes(br->bytes_in, br->len);
+		}
+		br->bits |= (uint64_t)br->buf[br->pos++] << (56 - br->count);
+		br->count += 8;
+	}
+	return (br->count);
+}
+
+/*
+ * The decode table, indexed by the next UNPACK_TABLE_BITS bits of the
+ * stream.  A code that short is stored as its symbol's index in the
+ * symbol table << 8 | its length.  Longer codes store the code value
+ * their first bits walk to << 8, length 0, and finish a bit at a time.
+ * -1 is a code the tree has no room for.
+ */
+static void
+unpack_build_table(const unpack_descriptor_t *unpackd, int32_t *table)
+{
+	int v, b, thislevel, thiscode, inlevelindex;
+
+	for (v = 0; v < (1 << UNPACK_TABLE_BITS); v++) {
+		thislevel = 0;
+		thiscode = 0;
+		table[v] = -1;
+		for (b = UNPACK_TABLE_BITS - 1; b >= 0; b--) {
+			thiscode = (thiscode << 1) | ((v >> b) & 1);
+
+			if (thiscode >= unpackd->inodesin[thislevel]) {
+				inlevelindex =
+				    thiscode - unpackd->inodesin[thislevel];
+				if (inlevelindex < unpackd->symbolsin[thislevel])
+					table[v] = (unpackd->tree[thislevel] -
+					    unpackd->symbol + inlevelindex) << 8 |
+					    (UNPACK_TABLE_BITS - b);
+				break;
+			}
+			if (++thislevel > unpackd->treelevels)
+				break;
+		}
+		if (b < 0)
+			table[v] = thiscode << 8;
+	}
 }
 
 /*
  * Decode huffman stream, based on the huffman tree.
+ *
+ * Each step looks the next UNPACK_TABLE_BITS bits up in the decode
+ * table; only codes longer than that, and the last few bits of the
+ * input, walk the tree a bit at a time.  Symbols are gathered in a
+ * large block before being written out.
  */
 static void
 unpack_decode(unpack_descriptor_t *unpackd, off_t *bytes_in)
 {
-	int thislevel, thiscode, thisbyte, inlevelindex;
-	int i;
+	int thislevel, thiscode, inlevelindex, symidx, eobidx;
+	int32_t e;
 	off_t bytes_out = 0;
-	const char *thissymbol;	/* The symbol pointer decoded from stream */
+	int32_t *table;
+	unsigned char *obuf;
+	size_t opos = 0;
+	unpack_bits_t br;
+
+	table = malloc(sizeof(*table) << UNPACK_TABLE_BITS);
+	obuf = malloc(UNPACK_BUFSIZE);
+	memset(&br, 0, sizeof(br));
+	br.fp = unpackd->fpIn;
+	br.buf = malloc(UNPACK_BUFSIZE);
+	br.bytes_in = bytes_in;
+	if (table == NULL || obuf == NULL || br.buf == NULL) {
+		maybe_err("malloc");
+		goto finished;
+	}
 
-	/*
-	 * Decode huffman.  Fetch every bytes from the file, get it
-	 * into 'thiscode' bit-by-bit, then output the symbol we got
-	 * when one has been found.
-	 *
-	 * Assumption: sizeof(int) > ((max tree levels + 1) / 8).
-	 * bad things could happen if not.
-	 */
-	thislevel = 0;
-	thiscode = thisbyte = 0;
+	unpack_build_table(unpackd, table);
+	eobidx = unpackd->symbol_eob - unpackd->symbol;
 
-	while ((thisbyte = fgetc(unpackd->fpIn)) != EOF) {
-		accepted_bytes(bytes_in, 1);
+	for (;;) {
+		if (unpack_fill(&br) >= UNPACK_TABLE_BITS) {
+			e = table[br.bits >> (64 - UNPACK_TABLE_BITS)];
+			if (e < 0) {
+				maybe_errx("File corrupt");
+				goto finished;
+			}
+			if (e & 0xff) {
+				br.bits <<= e & 0xff;
+				br.count -= e & 0xff;
+				symidx = e >> 8;
+				goto symbol;
+			}
+			br.bits <<= UNPACK_TABLE_BITS;
+			br.count -= UNPACK_TABLE_BITS;
+			thislevel = UNPACK_TABLE_BITS;
+			thiscode = e >> 8;
+		} else {
+			thislevel = 0;
+			thiscode = 0;
+		}
 
-		/*
-		 * Split one bit from thisbyte, from highest to lowest,
-		 * feed the bit into thiscode, until we got a symbol from
-		 * the tree.
-		 */
-		for (i = 7; i >= 0; i--) {
-			thiscode = (thiscode << 1) | ((thisbyte >> i) & 1);
+		/* Walk the rest of the code one bit at a time */
+		for (;;) {
+			if (br.count == 0 && unpack_fill(&br) == 0)
+				goto finished;
+			thiscode = (thiscode << 1) | (int)(br.bits >> 63);
+			br.bits <<= 1;
+			br.count--;
 
-			/* Did we got a symbol? (referencing leaf node) */
 			if (thiscode >= unpackd->inodesin[thislevel]) {
 				inlevelindex =
 				    thiscode - unpackd->inodesin[thislevel];
-				if (inlevelindex > unpackd->symbolsin[thislevel])
+				if (inlevelindex >= unpackd->symbolsin[thislevel]) {
 					maybe_errx("File corrupt");
-
-				thissymbol =
-				    &(unpackd->tree[thislevel][inlevelindex]);
-				if (thissymbol == unpackd->symbol_eob)
 					goto finished;
+				}
+				symidx = unpackd->tree[thislevel] -
+				    unpackd->symbol + inlevelindex;
+				break;
+			}
+			if (++thislevel > unpackd->treelevels) {
+				maybe_errx("File corrupt");
+				goto finished;
+			}
+		}
 
-				fputc((*thissymbol), unpackd->fpOut);
-				bytes_out++;
+symbol:
+		if (symidx == eobidx)
+			break;
 
-				/* Prepare for next input */
-				thislevel = 0; thiscode = 0;
-			} else {
-				thislevel++;
-				if (thislevel > unpackd->treelevels)
-					maybe_errx("File corrupt");
-			}
+		obuf[opos++] = unpackd->symbol[symidx];
+		if (opos == UNPACK_BUFSIZE) {
+			fwrite(obuf, 1, opos, unpackd->fpOut);
+			bytes_out += opos;
+			opos = 0;
 		}
 	}
 
 finished:
+	if (opos) {
+		fwrite(obuf, 1, opos, unpackd->fpOut);
+		bytes_out += opos;
+	}
+	/* Whole bytes fetched past the EOB were not accepted */
+	if (bytes_in != NULL)
+		*bytes_in -= br.count / 8 + (br.len - br.pos);
+	free(table);
+	free(obuf);
+	free(br.buf);
+
 	if (bytes_out != unpackd->uncompressed_size)
 		maybe_errx("Premature EOF");
     unpackd->uncompressed_size=bytes_out;  // hack
 }
 
+/*
+ * Decode one pack(1) stream from in to out, which stay open.  Returns
+ * the uncompressed size, 0 if nothing could be decoded.
+ */
+off_t
+unpack_stream(FILE *in, FILE *out)
+{
+	unpack_descriptor_t	unpackd;
+	int			levels;
+
+	memset(&unpackd, 0, sizeof(unpackd));
+	unpackd.fpIn = in;
+	unpackd.fpOut = out;
+
+	if ((levels = fgetc(in)) != EOF &&
+	    unpack_parse_tables(&unpackd, levels, NULL) == 0)
+		unpack_decode(&unpackd, NULL);
+	unpack_descriptor_free(&unpackd);
+
+	return (unpackd.uncompressed_size);
+}
+
+#ifndef BFF_UNPACK_LIB
 /* Handler for pack(1)'ed file */
 static off_t
 unpack(int in, int out, char *pre, size_t prelen, off_t *bytes_in)
 {
 	unpack_descriptor_t	unpackd;
 
-	unpack_parse_header(dup(in), dup(out), pre, prelen, bytes_in, &unpackd);
-	unpack_decode(&unpackd, bytes_in);
+	memset(&unpackd, 0, sizeof(unpackd));
+	if (unpack_parse_header(dup(in), dup(out), pre, prelen, bytes_in,
+	    &unpackd) == 0)
+		unpack_decode(&unpackd, bytes_in);
 	unpack_descriptor_fini(&unpackd);
 
 	/* If we reached here, the unpack was successful */
 	return (unpackd.uncompressed_size);
 }
+
 void
 usage() {
     printf("Usage:\n    ./bff_huffman_decompress INFILE OUTFILE\n");
@@ -356,4 +541,4 @@ main(int argc,char**argv) {
     }
     return 0;
 }
-
+#endif
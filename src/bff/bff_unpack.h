@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * bff_unpack.h
+ */
+
+#ifndef BFF_UNPACK_H
+#define BFF_UNPACK_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+ * The pack(1) decoder of bff_huffman_decompress.c, for callers that have
+ * the packed data in a stream of their own.  Built with BFF_UNPACK_LIB
+ * defined, that file leaves out its main().
+ */
+extern off_t unpack_stream(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * bffextract.c
+ *
+ * Extracts every member of an AIX BFF backup, or of a single volume
+ * entry carved out of one, in one pass over the mapped file.  Members
+ * are laid out as bffxtractor.py reads them: a 64 byte header with the
+ * magic at 2 and the stored size at 56, the NUL terminated name padded
+ * to 8 bytes, 40 more header bytes, then the data, and the next member
+ * at the following 8 byte boundary.  Anything between members that does
+ * not look like one is skipped 8 bytes at a time.  Huffman packed
+ * members are decoded with bff_huffman_decompress.c's unpacker, spread
+ * over worker threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "bff_unpack.h"
+
+#define	BFF_MAGIC		0xEA6B
+#define	BFF_HUFFMAN_MAGIC	0xEA6C
+#define	BFF_MAGIC_2		0xEA6D
+#define	BFF_HEADER_SIZE		64
+#define	BFF_POST_HEADER_SIZE	40
+#define	BFF_NAME_MAX		4096
+
+struct bff_member {
+	char		*name;
+	const unsigned char *data;
+	size_t		size;
+	int		packed;
+};
+
+struct bff_queue {
+	struct bff_member *members;
+	size_t		count;
+	size_t		next;		/* next member for a worker */
+	pthread_mutex_t	lock;
+	int		errors;
+};
+
+static uint16_t
+get16le(const unsigned char *p)
+{
+
+	return (p[0] | p[1] << 8);
+}
+
+static uint32_t
+get32le(const unsigned char *p)
+{
+
+	return (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+}
+
+/*
+ * Create each directory leading up to path, and path itself if dir is
+ * set.  Existing ones are fine.
+ */
+static int
+mkdirs(const char *path, int dir)
+{
+	char buf[BFF_NAME_MAX];
+	char *p;
+
+	snprintf(buf, sizeof(buf), "%s", path);
+	for (p = buf + 1; *p; p++) {
+		if (*p != '/')
+			continue;
+		*p = '\0';
+		if (mkdir(buf, 0755) < 0 && errno != EEXIST)
+			return (-1);
+		*p = '/';
+	}
+	if (dir && mkdir(buf, 0755) < 0 && errno != EEXIST)
+		return (-1);
+	return (0);
+}
+
+/*
+ * Parse the member at off.  Returns the offset just past its data, or
+ * 0 if there is no sane member there.
+ */
+static size_t
+bff_parse(const unsigned char *img, size_t len, size_t off,
+    struct bff_member *m)
+{
+	const unsigned char *hdr = img + off;
+	const unsigned char *name, *nul;
+	size_t namelen, data;
+	unsigned magic;
+
+	if (len - off < BFF_HEADER_SIZE)
+		return (0);
+
+	magic = get16le(hdr + 2);
+	if (magic != BFF_MAGIC && magic != BFF_HUFFMAN_MAGIC &&
+	    magic != BFF_MAGIC_2)
+		return (0);
+
+	name = hdr + BFF_HEADER_SIZE;
+	nul = memchr(name, '\0', len - off - BFF_HEADER_SIZE < BFF_NAME_MAX ?
+	    len - off - BFF_HEADER_SIZE : BFF_NAME_MAX);
+	if (nul == NULL || nul == name)
+		return (0);
+	namelen = nul - name;
+
+	data = off + BFF_HEADER_SIZE + BFF_POST_HEADER_SIZE + namelen +
+	    (8 - namelen % 8);
+	m->size = get32le(hdr + 56);
+	if (data > len || m->size > len - data)
+		return (0);
+
+	m->name = strndup((const char *)name, namelen);
+	m->data = img + data;
+	m->packed = magic == BFF_HUFFMAN_MAGIC;
+	return (data + m->size);
+}
+
+/*
+ * Write one member out, decoding it first if packed.  Returns 0 or -1.
+ */
+static int
+bff_extract(const struct bff_member *m)
+{
+	FILE *in, *out;
+	int ret = 0;
+
+	if ((out = fopen(m->name, "w")) == NULL) {
+		fprintf(stderr, "[-] Could not create %s: %s\n", m->name,
+		    strerror(errno));
+		return (-1);
+	}
+
+	if (!m->packed) {
+		if (fwrite(m->data, 1, m->size, out) != m->size)
+			ret = -1;
+	} else if ((in = fmemopen((void *)m->data, m->size, "r")) == NULL) {
+		ret = -1;
+	} else {
+		if (unpack_stream(in, out) <= 0)
+			ret = -1;
+		fclose(in);
+	}
+
+	if (fclose(out) != 0)
+		ret = -1;
+	if (ret != 0)
+		fprintf(stderr, "[-] Extracting %s failed\n", m->name);
+	return (ret);
+}
+
+static void *
+bff_worker(void *arg)
+{
+	struct bff_queue *q = arg;
+	size_t i;
+
+	for (;;) {
+		pthread_mutex_lock(&q->lock);
+		i = q->next++;
+		pthread_mutex_unlock(&q->lock);
+		if (i >= q->count)
+			break;
+
+		if (bff_extract(&q->members[i]) != 0) {
+			pthread_mutex_lock(&q->lock);
+			q->errors++;
+			pthread_mutex_unlock(&q->lock);
+		}
+	}
+	return (NULL);
+}
+
+static void
+usage(void)
+{
+
+	fprintf(stderr, "Usage:\n    ./bffextract [-j jobs] [-d outdir] "
+	    "BFFFILE\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bff_queue q;
+	struct bff_member m;
+	pthread_t *threads;
+	unsigned char *img;
+	const char *outdir = NULL;
+	struct stat st;
+	size_t off, end, alloc = 0;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int fd, c, i, dirs = 0;
+
+	while ((c = getopt(argc, argv, "d:j:h")) != -1) {
+		switch (c) {
+		case 'd':
+			outdir = optarg;
+			break;
+		case 'j':
+			jobs = atol(optarg);
+			break;
+		default:
+			usage();
+			return (1);
+		}
+	}
+	if (optind != argc - 1) {
+		usage();
+		return (1);
+	}
+	if (jobs < 1)
+		jobs = 1;
+
+	if ((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "[-] Could *not* open input file\n");
+		return (1);
+	}
+	if (st.st_size == 0 || (img = mmap(NULL, st.st_size, PROT_READ,
+	    MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		fprintf(stderr, "[-] Could *not* map input file\n");
+		return (1);
+	}
+	close(fd);
+
+	if (outdir != NULL && (mkdirs(outdir, 1) < 0 || chdir(outdir) < 0)) {
+		fprintf(stderr, "[-] Could *not* enter %s\n", outdir);
+		return (1);
+	}
+
+	/*
+	 * Walk the members, making directories as they come so that the
+	 * workers only ever create files.
+	 */
+	memset(&q, 0, sizeof(q));
+	pthread_mutex_init(&q.lock, NULL);
+	for (off = 0; off < (size_t)st.st_size; off += 8) {
+		memset(&m, 0, sizeof(m));
+		if ((end = bff_parse(img, st.st_size, off, &m)) == 0)
+			continue;
+
+		/* Names are kept under the output directory */
+		while (m.name[0] == '/')
+			memmove(m.name, m.name + 1, strlen(m.name));
+
+		if (m.name[0] == '\0' || strstr(m.name, "..") != NULL) {
+			fprintf(stderr, "[!] Dangerous file path '%s', "
+			    "skipped\n", m.name);
+			free(m.name);
+		} else if (m.size == 0) {
+			printf("[+] Directory '%s'\n", m.name);
+			if (mkdirs(m.name, 1) < 0)
+				q.errors++;
+			free(m.name);
+			dirs++;
+		} else {
+			printf("[+] Extracting '%s'\n", m.name);
+			if (mkdirs(m.name, 0) < 0)
+				q.errors++;
+			if (q.count == alloc) {
+				alloc = alloc ? alloc * 2 : 64;
+				q.members = realloc(q.members,
+				    alloc * sizeof(*q.members));
+				if (q.members == NULL) {
+					fprintf(stderr, "[-] Out of memory\n");
+					return (1);
+				}
+			}
+			q.members[q.count++] = m;
+		}
+
+		/* Continue at the 8 byte boundary after the member */
+		off = ((end + 7) & ~(size_t)7) - 8;
+	}
+
+	if ((size_t)jobs > q.count)
+		jobs = q.count ? q.count : 1;
+	threads = calloc(jobs, sizeof(*threads));
+	if (threads == NULL)
+		return (1);
+	for (i = 0; i < jobs; i++)
+		if (pthread_create(&threads[i], NULL, bff_worker, &q) != 0)
+			break;
+	if (i == 0)
+		bff_worker(&q);
+	while (i--)
+		pthread_join(threads[i], NULL);
+
+	printf("[+] %zu files and %d directories, %d errors\n", q.count,
+	    dirs, q.errors);
+
+	for (off = 0; off < q.count; off++)
+		free(q.members[off].name);
+	free(q.members);
+	free(threads);
+	munmap(img, st.st_size);
+
+	return (q.errors ? 1 : 0);
+}
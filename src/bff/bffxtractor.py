@@ -3,6 +3,8 @@
 # It can't parse a BFF file itself, but expects the BFF volume entry to already 
 # be extracted to a file; it then extracts the original file from the volume entry 
 # file. Thus, it is best used with binwalk.
+# bffextract (see the Makefile) walks whole BFF images natively, decoding
+# packed members in parallel without a decompressor process per file.
 
 import os
 import sys
@@ -1,6 +1,33 @@
 import re
 from common import str2int, get_quoted_strings
 
+def _keyword_patterns(keywords, start, end):
+	'''
+	Compiles the smart keywords into the two patterns SmartSignature matches result strings against.
+
+	@keywords - The SmartSignature.KEYWORDS dictionary.
+	@start    - The keyword start delimiter.
+	@end      - The keyword end delimiter.
+
+	Returns a tuple of (find pattern, strip pattern, keyword index of each keyword name).
+	'''
+	names = {}
+	args = []
+	flags = []
+
+	for (name, keyword) in keywords.iteritems():
+		if keyword.endswith(end):
+			flags.append(re.escape(keyword[len(start):-len(end)]))
+			names[keyword[len(start):-len(end)]] = name
+		else:
+			args.append(re.escape(keyword[len(start):-1]))
+			names[keyword[len(start):-1]] = name
+
+	# Arguments run up to the end delimiter, or to the end of the string if there is none
+	find = re.compile('%s(?:(%s):([^%s]*)|(%s)%s)' % (re.escape(start), '|'.join(args), re.escape(end), '|'.join(flags), re.escape(end)))
+	strip = re.compile('%s(?:(%s):[^%s]*|(%s))%s' % (re.escape(start), '|'.join(args), re.escape(end), '|'.join(flags), re.escape(end)))
+	return (find, strip, names)
+
 class SmartSignature:
 	'''
 	Class for parsing smart signature tags in libmagic result strings.
@@ -31,6 +58,11 @@ class SmartSignature:
 		'exclude'		: '%sfilter-exclude%s' % (KEYWORD_DELIM_START, KEYWORD_DELIM_END),
 	}
 
+	# The keywords are compiled once, and each distinct result string is only matched against them once
+	(KEYWORD_REGEX, STRIP_REGEX, KEYWORD_NAMES) = _keyword_patterns(KEYWORDS, KEYWORD_DELIM_START, KEYWORD_DELIM_END)
+	RAW_SIZE_REGEX = re.compile('^-?[0-9]+$')
+	TAG_CACHE_SIZE = 1024
+
 	def __init__(self, filter, pre_filter_signatures=True):
 		'''
 		Class constructor.
@@ -43,6 +75,7 @@ class SmartSignature:
 		self.filter = filter
 		self.last_one_of_many = None
 		self.pre_filter_signatures = pre_filter_signatures
+		self.tag_cache = {}
 
 	def parse(self, data):
 		'''
@@ -62,9 +95,11 @@ class SmartSignature:
 			'adjust'	: 0,	# The relative offset to add to the reported offset
 		}
 
+		(valid, tags) = self._tags(data)
+
 		# If pre-filtering is disabled, or the result data is not valid (i.e., potentially malicious), 
 		# don't parse anything, just return the raw data as the description.
-		if not self.pre_filter_signatures or not self._is_valid(data):
+		if not self.pre_filter_signatures or not valid:
 			results['description'] = data
 		else:
 			# Parse the offset-adjust value. This is used to adjust the reported offset at which 
@@ -76,11 +111,11 @@ class SmartSignature:
 			# when extraction is enabled. If not specified, everything to the end of the file will be
 			# extracted (see Binwalk.scan).
 			try:
-				results['size'] = str2int(self._get_keyword_arg(data, 'filesize'))
+				results['size'] = str2int(tags.get('filesize', ''))
 			except:
 				pass
 
-			results['delay'] = self._get_keyword_arg(data, 'delay')
+			results['delay'] = tags.get('delay', '')
 
 			# Parse the string for the jump-to-offset keyword.
 			# This keyword is honored, even if this string result is one of many.
@@ -89,11 +124,43 @@ class SmartSignature:
 			# If this is one of many, don't do anything and leave description as a blank string.
 			# Else, strip all keyword tags from the string and process additional keywords as necessary.
 			if not self._one_of_many(data):
-				results['name'] = self._get_keyword_arg(data, 'filename').strip('"')
+				results['name'] = tags.get('filename', '').strip('"')
 				results['description'] = self._strip_tags(data)
 
 		return results
 
+	def _tags(self, data):
+		'''
+		Finds the smart keywords in a result string and validates them, once per distinct string.
+
+		@data - String result data, as returned by libmagic.
+
+		Returns a tuple of (valid, tags), where tags maps the index in KEYWORDS of each keyword present
+		to its first argument, or to a blank string for keywords that take none.
+		'''
+		try:
+			return self.tag_cache[data]
+		except KeyError:
+			pass
+
+		tags = {}
+		for match in self.KEYWORD_REGEX.finditer(data):
+			if match.group(1):
+				tags.setdefault(self.KEYWORD_NAMES[match.group(1)], match.group(2))
+			else:
+				tags.setdefault(self.KEYWORD_NAMES[match.group(3)], '')
+
+		# All strings printed from the target file should be placed in strings, else there is
+		# no way to distinguish between intended keywords and unintended keywords. If any keywords 
+		# are found inside of quoted data, consider the keywords invalid.
+		quoted_data = get_quoted_strings(data)
+		valid = not (tags and quoted_data and self.KEYWORD_REGEX.search(quoted_data))
+
+		if len(self.tag_cache) >= self.TAG_CACHE_SIZE:
+			self.tag_cache.clear()
+		self.tag_cache[data] = (valid, tags)
+		return (valid, tags)
+
 	def _is_valid(self, data):
 		'''
 		Validates that result data does not contain smart keywords in file-supplied strings.
@@ -103,19 +170,7 @@ class SmartSignature:
 		Returns True if data is OK.
 		Returns False if data is not OK.
 		'''
-		# All strings printed from the target file should be placed in strings, else there is
-		# no way to distinguish between intended keywords and unintended keywords. Get all the
-		# quoted strings.
-		quoted_data = get_quoted_strings(data)
-
-		# Check to see if there was any quoted data, and if so, if it contained the keyword starting delimiter
-		if quoted_data and self.KEYWORD_DELIM_START in quoted_data:
-			# If so, check to see if the quoted data contains any of our keywords.
-			# If any keywords are found inside of quoted data, consider the keywords invalid.
-			for (name, keyword) in self.KEYWORDS.iteritems():
-				if keyword in quoted_data:
-					return False
-		return True
+		return self._tags(data)[0]
 
 	def _one_of_many(self, data):
 		'''
@@ -130,7 +185,7 @@ class SmartSignature:
 			if self.last_one_of_many is not None and data.startswith(self.last_one_of_many):
 				return True
 		
-			if self.KEYWORDS['one-of-many'] in data:
+			if self._tags(data)[1].has_key('one-of-many'):
 				# Only match on the data before the first comma, as that is typically unique and static
 				self.last_one_of_many = data.split(',')[0]
 			else:
@@ -148,12 +203,7 @@ class SmartSignature:
 		Returns the argument string value on success.
 		Returns a blank string on failure.
 		'''
-		arg = ''
-
-		if self.KEYWORDS.has_key(keyword) and self.KEYWORDS[keyword] in data:
-			arg = data.split(self.KEYWORDS[keyword])[1].split(self.KEYWORD_DELIM_END)[0]
-
-		return arg
+		return self._tags(data)[1].get(keyword, '')
 
 	def _get_math_arg(self, data, keyword):
 		'''
@@ -214,7 +264,7 @@ class SmartSignature:
 				raw_size = self._get_keyword_arg(data, 'raw-size')
 	
 				# Is the raw string  length arg is a numeric value?
-				if re.match('^-?[0-9]+$', raw_size):
+				if self.RAW_SIZE_REGEX.match(raw_size):
 					# Replace all instances of raw-replace in data with raw_string[:raw_size]
 					# Also strip out everything after the raw-string keyword, including the keyword itself.
 					# Failure to do so may (will) result in non-printable characters and this string will be 
@@ -233,11 +283,13 @@ class SmartSignature:
 		Returns None if neither smart tags are present.
 		'''
 		# Validate keywords before checking for the include/exclude keywords.
-		if self.pre_filter_signatures and self._is_valid(data):
-			if self.KEYWORDS['exclude'] in data:
-				return False
-			elif self.KEYWORDS['include'] in data:
-				return True
+		if self.pre_filter_signatures:
+			(valid, tags) = self._tags(data)
+			if valid:
+				if tags.has_key('exclude'):
+					return False
+				elif tags.has_key('include'):
+					return True
 		return None
 
 	def _strip_tags(self, data):
@@ -249,11 +301,11 @@ class SmartSignature:
 		Returns a sanitized string.
 		'''
 		if self.pre_filter_signatures:
-			for (name, keyword) in self.KEYWORDS.iteritems():
-				start = data.find(keyword)
-				if start != -1:
-					end = data[start:].find(self.KEYWORD_DELIM_END)
-					if end != -1:
-						data = data.replace(data[start:start+end+1], "")
+			# Only the tag each keyword is first found with is stripped, wherever it appears
+			first = {}
+			for match in self.STRIP_REGEX.finditer(data):
+				first.setdefault(match.group(1) or match.group(2), match.group(0))
+			if first:
+				data = self.STRIP_REGEX.sub(lambda match: '' if first[match.group(1) or match.group(2)] == match.group(0) else match.group(0), data)
 		return data
 
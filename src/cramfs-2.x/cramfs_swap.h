@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * cramfs_swap.h
+ */
+
+#ifndef CRAMFS_SWAP_H
+#define CRAMFS_SWAP_H
+
+#include <byteswap.h>
+#include <endian.h>
+
+/*
+ * cramfs keeps its superblock words, inodes and block pointers in the
+ * byte order of the machine it is for.  These turn inodes of the other
+ * byte order into host order and back, so that mkcramfs -B can make
+ * big-endian images on little-endian hosts and cramfsck and uncramfs
+ * can read either.  The inode bitfields are laid out from the top bit
+ * down on big-endian and from the bottom up on little-endian, so the
+ * fields are repacked by hand rather than just byte swapped.  The
+ * 32-bit words are plain bswap_32().
+ */
+#if __BYTE_ORDER == __BIG_ENDIAN
+#define CRAMFS_HOST_BIG_ENDIAN 1
+#else
+#define CRAMFS_HOST_BIG_ENDIAN 0
+#endif
+
+static inline void cramfs_inode_to_host(struct cramfs_inode *inode)
+{
+	const unsigned char *b = (const unsigned char *) inode;
+	u32 mode, uid, size, gid, namelen, offset;
+
+	if (CRAMFS_HOST_BIG_ENDIAN) {
+		u32 w = b[8] | b[9] << 8 | b[10] << 16 | (u32) b[11] << 24;
+
+		mode = b[0] | b[1] << 8;
+		uid = b[2] | b[3] << 8;
+		size = b[4] | b[5] << 8 | b[6] << 16;
+		gid = b[7];
+		namelen = w & 0x3f;
+		offset = w >> 6;
+	} else {
+		u32 w = (u32) b[8] << 24 | b[9] << 16 | b[10] << 8 | b[11];
+
+		mode = b[0] << 8 | b[1];
+		uid = b[2] << 8 | b[3];
+		size = b[4] << 16 | b[5] << 8 | b[6];
+		gid = b[7];
+		namelen = w >> 26;
+		offset = w & 0x3ffffff;
+	}
+
+	inode->mode = mode;
+	inode->uid = uid;
+	inode->size = size;
+	inode->gid = gid;
+	inode->namelen = namelen;
+	inode->offset = offset;
+}
+
+static inline void cramfs_inode_from_host(struct cramfs_inode *inode)
+{
+	unsigned char *b = (unsigned char *) inode;
+	u32 mode = inode->mode, uid = inode->uid, size = inode->size;
+	u32 gid = inode->gid, namelen = inode->namelen, offset = inode->offset;
+	u32 w;
+
+	if (CRAMFS_HOST_BIG_ENDIAN) {
+		w = namelen | offset << 6;
+		b[0] = mode;
+		b[1] = mode >> 8;
+		b[2] = uid;
+		b[3] = uid >> 8;
+		b[4] = size;
+		b[5] = size >> 8;
+		b[6] = size >> 16;
+		b[8] = w;
+		b[9] = w >> 8;
+		b[10] = w >> 16;
+		b[11] = w >> 24;
+	} else {
+		w = namelen << 26 | offset;
+		b[0] = mode >> 8;
+		b[1] = mode;
+		b[2] = uid >> 8;
+		b[3] = uid;
+		b[4] = size >> 16;
+		b[5] = size >> 8;
+		b[6] = size;
+		b[8] = w >> 24;
+		b[9] = w >> 16;
+		b[10] = w >> 8;
+		b[11] = w;
+	}
+	b[7] = gid;
+}
+
+#endif
@@ -45,6 +45,7 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <errno.h>
 #include <string.h>
 #include <sys/sysmacros.h>
@@ -54,6 +55,12 @@
 #include <linux/fs.h>
 #include <linux/cramfs_fs.h>
 #include <zlib.h>
+#include <pthread.h>
+#include "../zbuf/zbuf.h"
+#include "../fmkstats/fmkstats.h"
+#include "../fmkindex/fmkindex.h"
+#include "../crc32/crc32buf.h"
+#include "cramfs_swap.h"
 
 /* Exit codes used by fsck-type programs */
 #define FSCK_OK          0	/* No errors */
@@ -67,15 +74,26 @@
 #define PAD_SIZE 512
 #define PAGE_CACHE_SIZE (4096)
 
+/* Images of mkcramfs -b have larger blocks, recorded in the flags */
+#define MAX_BLKSIZE (PAGE_CACHE_SIZE << (CRAMFS_FLAG_BLKSZ_MASK >> CRAMFS_FLAG_BLKSZ_SHIFT))
+static unsigned int blksize = PAGE_CACHE_SIZE;
+
 static const char *progname = "cramfsck";
 
 static int fd;			/* ROM image file descriptor */
 static char *filename;		/* ROM image filename */
 struct cramfs_super super;	/* just find the cramfs superblock once */
+static int swapped = 0;		/* image in the other byte order, e.g. mkcramfs -B */
 static int opt_verbose = 0;	/* 1 = verbose (-v), 2+ = very verbose (-vv) */
+static unsigned char *dictionary;	/* zlib preset dictionary (-D) */
+static unsigned int dict_size;
 #ifdef INCLUDE_FS_TESTS
 static int opt_extract = 0;		/* extract cramfs (-x) */
+static int opt_threads = 0;		/* file threads (-t), 0 for the CPUs */
 static char *extract_dir = "root";	/* extraction directory (-x) */
+static char *opt_cat = NULL;		/* file to write to stdout (-c) */
+static char *opt_list = NULL;		/* path to list (-l) */
+static char *opt_index = NULL;		/* path index file for -c and -l (-I) */
 static uid_t euid;			/* effective UID */
 
 /* (cramfs_super + start) <= start_dir < end_dir <= start_data <= end_data */
@@ -90,11 +108,38 @@ static unsigned long end_data = 0;	/* end of the data */
 #define ROMBUFFERMASK	(ROMBUFFERSIZE-1)
 static char read_buffer[ROMBUFFERSIZE * 2];
 static unsigned long read_buffer_block = ~0UL;
+static char *image;			/* the image, mmapped for -c and -l */
+static size_t image_length;
 
 /* Uncompressing data structures... */
-static char outbuffer[PAGE_CACHE_SIZE*2];
+static char outbuffer[MAX_BLKSIZE*2];
 static z_stream stream;
 
+/*
+ * Regular files found by the directory walk, checked and extracted by
+ * the file threads, each with its own z_stream.  Files are checked in
+ * the walk with -vv, so that its block trace stays in order.
+ */
+struct file_job {
+	char *path;
+	struct cramfs_inode inode;
+	struct file_job *next;
+};
+
+static struct file_job *job_head, **job_tail = &job_head;
+static int walk_done;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+
+/* Extracted inodes, whose owner, mode and times are set at the end */
+struct file_status {
+	char *path;
+	struct cramfs_inode inode;
+};
+
+static struct file_status *statuses;
+static int status_count, status_size;
+
 /* Prototypes */
 static void expand_fs(char *, struct cramfs_inode *);
 #endif /* INCLUDE_FS_TESTS */
@@ -104,11 +149,17 @@ static void usage(int status)
 {
 	FILE *stream = status ? stderr : stdout;
 
-	fprintf(stream, "usage: %s [-hv] [-x dir] file\n"
+	fprintf(stream, "usage: %s [-hv] [-x dir] [-t threads] [-D dictionary] file\n"
+		"       %s [-D dictionary] [-I index] -c path | -l path file\n"
 		" -h         print this help\n"
+		" -c path    write the file at path to stdout, without checking the image\n"
+		" -D dict    the zlib preset dictionary of mkcramfs -D\n"
+		" -I index   look paths up in index, made or remade if missing or stale\n"
+		" -l path    list the directory, or file, at path\n"
+		" -t threads check files with this many threads (default: number of CPUs)\n"
 		" -x dir     extract into dir\n"
 		" -v         be more verbose\n"
-		" file       file to test\n", progname);
+		" file       file to test\n", progname, progname);
 
 	exit(status);
 }
@@ -130,6 +181,32 @@ static void die(int status, int syserr, const char *fmt, ...)
 	exit(status);
 }
 
+static void read_dictionary(const char *file)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		die(FSCK_ERROR, 1, "open failed: %s", file);
+	}
+	if (fstat(fd, &st) < 0) {
+		die(FSCK_ERROR, 1, "fstat failed: %s", file);
+	}
+	if (st.st_size == 0 || st.st_size > 32768) {
+		die(FSCK_USAGE, 0, "dictionary must be 1 to 32768 bytes: %s", file);
+	}
+	dictionary = malloc(st.st_size);
+	if (!dictionary) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	if (read(fd, dictionary, st.st_size) != st.st_size) {
+		die(FSCK_ERROR, 1, "read failed: %s", file);
+	}
+	close(fd);
+	dict_size = st.st_size;
+}
+
 static void test_super(int *start, size_t *length) {
 	struct stat st;
 
@@ -162,7 +239,7 @@ static void test_super(int *start, size_t *length) {
 	if (read(fd, &super, sizeof(super)) != sizeof(super)) {
 		die(FSCK_ERROR, 1, "read failed: %s", filename);
 	}
-	if (super.magic == CRAMFS_MAGIC) {
+	if (super.magic == CRAMFS_MAGIC || super.magic == bswap_32(CRAMFS_MAGIC)) {
 		*start = 0;
 	}
 	else if (*length >= (PAD_SIZE + sizeof(super))) {
@@ -170,18 +247,45 @@ static void test_super(int *start, size_t *length) {
 		if (read(fd, &super, sizeof(super)) != sizeof(super)) {
 			die(FSCK_ERROR, 1, "read failed: %s", filename);
 		}
-		if (super.magic == CRAMFS_MAGIC) {
+		if (super.magic == CRAMFS_MAGIC || super.magic == bswap_32(CRAMFS_MAGIC)) {
 			*start = PAD_SIZE;
 		}
 	}
+	if (super.magic == bswap_32(CRAMFS_MAGIC)) {
+		swapped = 1;
+		super.magic = CRAMFS_MAGIC;
+		super.size = bswap_32(super.size);
+		super.flags = bswap_32(super.flags);
+		super.future = bswap_32(super.future);
+		super.fsid.crc = bswap_32(super.fsid.crc);
+		super.fsid.edition = bswap_32(super.fsid.edition);
+		super.fsid.blocks = bswap_32(super.fsid.blocks);
+		super.fsid.files = bswap_32(super.fsid.files);
+		cramfs_inode_to_host(&super.root);
+		if (opt_verbose) {
+			printf("%s: %s-endian\n", filename, CRAMFS_HOST_BIG_ENDIAN ? "little" : "big");
+		}
+	}
 
 	/* superblock tests */
 	if (super.magic != CRAMFS_MAGIC) {
 		die(FSCK_UNCORRECTED, 0, "superblock magic not found");
 	}
-	if (super.flags & ~CRAMFS_SUPPORTED_FLAGS) {
+	if (super.flags & ~(CRAMFS_SUPPORTED_FLAGS | CRAMFS_FLAG_BLKSZ_MASK | CRAMFS_FLAG_PRESET_DICT)) {
 		die(FSCK_ERROR, 0, "unsupported filesystem features");
 	}
+	blksize = PAGE_CACHE_SIZE << ((super.flags & CRAMFS_FLAG_BLKSZ_MASK) >> CRAMFS_FLAG_BLKSZ_SHIFT);
+	if (opt_verbose && blksize != PAGE_CACHE_SIZE) {
+		printf("%s: %u byte blocks\n", filename, blksize);
+	}
+	if (super.flags & CRAMFS_FLAG_PRESET_DICT) {
+		if (!dictionary) {
+			die(FSCK_ERROR, 0, "filesystem needs the preset dictionary with id 0x%08x (-D)", super.future);
+		}
+		if (adler32(adler32(0L, Z_NULL, 0), dictionary, dict_size) != super.future) {
+			die(FSCK_ERROR, 0, "dictionary doesn't match the filesystem's id 0x%08x", super.future);
+		}
+	}
 	if (super.size < PAGE_CACHE_SIZE) {
 		die(FSCK_UNCORRECTED, 0, "superblock size (%d) too small", super.size);
 	}
@@ -201,10 +305,77 @@ static void test_super(int *start, size_t *length) {
 	}
 }
 
+/*
+ * The image's CRC, taken in chunks of at least CRC_CHUNK_MIN bytes by up
+ * to -t threads.  Each chunk is checksummed from a zero register and the
+ * results joined in order with crc32_shift(), which gives the register
+ * of the whole as if it had been read straight through.
+ */
+#define CRC_CHUNK_MIN	(1 << 20)
+
+struct crc_chunk {
+	const unsigned char *buf;
+	size_t len;
+	u32 crc;
+	pthread_t thread;
+};
+
+static void *crc_thread(void *arg)
+{
+	struct crc_chunk *chunk = arg;
+
+	chunk->crc = crc32_update(0, chunk->buf, chunk->len);
+	return NULL;
+}
+
+static u32 crc_buffer(const unsigned char *buf, size_t len)
+{
+	struct crc_chunk *chunk;
+	size_t each;
+	u32 crc = 0xffffffff;
+	int n, nchunks = opt_threads ? opt_threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nchunks < 1)
+		nchunks = 1;
+	if (len / CRC_CHUNK_MIN < (size_t) nchunks)
+		nchunks = len / CRC_CHUNK_MIN;
+	if (nchunks <= 1)
+		return ~crc32_update(crc, buf, len);
+
+	chunk = malloc(nchunks * sizeof(*chunk));
+	if (!chunk) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	/* picks the implementation before the threads share it */
+	crc32_update(0, buf, 0);
+
+	each = len / nchunks;
+	for (n = 0; n < nchunks; n++) {
+		chunk[n].buf = buf + n * each;
+		chunk[n].len = n == nchunks - 1 ? len - n * each : each;
+		if (n == 0)
+			continue;
+		if (pthread_create(&chunk[n].thread, NULL, crc_thread, &chunk[n])) {
+			die(FSCK_ERROR, 0, "failed to create thread");
+		}
+	}
+	crc_thread(&chunk[0]);
+
+	for (n = 0; n < nchunks; n++) {
+		if (n)
+			pthread_join(chunk[n].thread, NULL);
+		crc = crc32_shift(crc, chunk[n].len) ^ chunk[n].crc;
+	}
+	free(chunk);
+
+	return ~crc;
+}
+
 static void test_crc(int start)
 {
 	void *buf;
 	u32 crc;
+	long long fmk_start;
 
 	if (!(super.flags & CRAMFS_FLAG_FSID_VERSION_2)) {
 #ifdef INCLUDE_FS_TESTS
@@ -214,6 +385,7 @@ static void test_crc(int start)
 #endif /* not INCLUDE_FS_TESTS */
 	}
 
+	FMK_STAGE_BEGIN(checksum, fmk_start);
 	crc = crc32(0L, Z_NULL, 0);
 
 	buf = mmap(NULL, super.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
@@ -225,8 +397,8 @@ static void test_crc(int start)
 		}
 	}
 	if (buf != MAP_FAILED) {
-		((struct cramfs_super *) (buf+start))->fsid.crc = crc32(0L, Z_NULL, 0);
-		crc = crc32(crc, buf+start, super.size-start);
+		((struct cramfs_super *) (buf+start))->fsid.crc = 0;
+		crc = crc_buffer(buf+start, super.size-start);
 		munmap(buf, super.size);
 	}
 	else {
@@ -258,6 +430,7 @@ static void test_crc(int start)
 		}
 		free(buf);
 	}
+	FMK_STAGE_END(checksum, fmk_start, super.size - start, 4);
 
 	if (crc != super.fsid.crc) {
 		die(FSCK_UNCORRECTED, 0, "crc error");
@@ -288,6 +461,9 @@ static void print_node(char type, struct cramfs_inode *i, char *name)
 static void *romfs_read(unsigned long offset)
 {
 	unsigned int block = offset >> ROMBUFFER_BITS;
+	if (image && offset + ROMBUFFERSIZE <= image_length) {
+		return image + offset;
+	}
 	if (block != read_buffer_block) {
 		read_buffer_block = block;
 		lseek(fd, block << ROMBUFFER_BITS, SEEK_SET);
@@ -309,7 +485,11 @@ static struct cramfs_inode *cramfs_iget(struct cramfs_inode * i)
 
 static struct cramfs_inode *iget(unsigned int ino)
 {
-	return cramfs_iget(romfs_read(ino));
+	struct cramfs_inode *inode = cramfs_iget(romfs_read(ino));
+
+	if (swapped)
+		cramfs_inode_to_host(inode);
+	return inode;
 }
 
 static void iput(struct cramfs_inode *inode)
@@ -335,58 +515,158 @@ static struct cramfs_inode *read_super(void)
 	return cramfs_iget(&super.root);
 }
 
-static int uncompress_block(void *src, int len)
+/* Blocks without a preset dictionary go through the zbuf backend */
+static int uncompress_block(z_stream *stream, char *outbuffer, void *src, unsigned long len)
 {
 	int err;
 
-	stream.next_in = src;
-	stream.avail_in = len;
+	if (!dictionary) {
+		unsigned long out = blksize*2;
 
-	stream.next_out = (unsigned char *) outbuffer;
-	stream.avail_out = PAGE_CACHE_SIZE*2;
+		if (len > blksize*2) {
+			die(FSCK_UNCORRECTED, 0, "data block too large");
+		}
+		err = zbuf_uncompress(outbuffer, &out, src, len);
+		if (err != Z_OK) {
+			die(FSCK_UNCORRECTED, 0, "decompression error %p(%lu): %s",
+			    src, len, zError(err));
+		}
+		return out;
+	}
 
-	inflateReset(&stream);
+	stream->next_in = src;
+	stream->avail_in = len;
 
-	if (len > PAGE_CACHE_SIZE*2) {
+	stream->next_out = (unsigned char *) outbuffer;
+	stream->avail_out = blksize*2;
+
+	inflateReset(stream);
+
+	if (len > blksize*2) {
 		die(FSCK_UNCORRECTED, 0, "data block too large");
 	}
-	err = inflate(&stream, Z_FINISH);
+	err = inflate(stream, Z_FINISH);
+	if (err == Z_NEED_DICT && dictionary) {
+		err = inflateSetDictionary(stream, dictionary, dict_size);
+		if (err == Z_OK)
+			err = inflate(stream, Z_FINISH);
+	}
 	if (err != Z_STREAM_END) {
-		die(FSCK_UNCORRECTED, 0, "decompression error %p(%d): %s",
-		    zError(err), src, len);
+		die(FSCK_UNCORRECTED, 0, "decompression error %p(%lu): %s",
+		    src, len, zError(err));
 	}
-	return stream.total_out;
+	return stream->total_out;
 }
 
-static void do_uncompress(char *path, int fd, unsigned long offset, unsigned long size)
+/* As read() at offset, for the file threads, which can't share romfs_read */
+static void romfs_pread(void *buf, unsigned long len, unsigned long offset)
 {
-	unsigned long curr = offset + 4 * ((size + PAGE_CACHE_SIZE - 1) / PAGE_CACHE_SIZE);
+	if (image && offset + len <= image_length) {
+		memcpy(buf, image + offset, len);
+		return;
+	}
+	while (len) {
+		ssize_t res = pread(fd, buf, len, offset);
+
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0) {
+			die(FSCK_ERROR, res < 0, "read failed: %s", filename);
+		}
+		buf = (char *) buf + res;
+		len -= res;
+		offset += res;
+	}
+}
+
+/* Returns non-zero iff the first LEN bytes from BEGIN are all NULs. */
+static int is_zero(char const *begin, unsigned len)
+{
+	const unsigned long *word;
+
+	for (; len && ((unsigned long) begin & (sizeof(long) - 1)); len--)
+		if (*begin++)
+			return 0;
+	word = (const unsigned long *) begin;
+	for (; len >= 4 * sizeof(long); len -= 4 * sizeof(long), word += 4)
+		if (word[0] | word[1] | word[2] | word[3])
+			return 0;
+	for (begin = (char const *) word; len; len--)
+		if (*begin++)
+			return 0;
+	return 1;
+}
+
+static void pwrite_all(char *path, int fd, char *buf, unsigned long len, off_t offset)
+{
+	while (len) {
+		ssize_t res = pwrite(fd, buf, len, offset);
+
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res < 0) {
+			die(FSCK_ERROR, 1, "write failed: %s", path);
+		}
+		buf += res;
+		len -= res;
+		offset += res;
+	}
+}
+
+/*
+ * Extracted files are sparse: holes and blocks that uncompress to zeros
+ * are skipped over rather than written, and the file is extended to its
+ * full size at the end.  hash, for FMK_INDEX, is given every block.
+ */
+static void do_uncompress(char *path, int fd, unsigned long offset, unsigned long size,
+	z_stream *stream, char *outbuffer, char *inbuffer, struct fmk_index_hash *hash)
+{
+	unsigned long blocks = (size + blksize - 1) / blksize;
+	unsigned long curr = offset + 4 * blocks;
+	unsigned long max_next = 0;
+	unsigned long file_size = size;
+	off_t pos = 0;
+	u32 *pointers;
+
+	pointers = malloc(4 * blocks);
+	if (!pointers) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	romfs_pread(pointers, 4 * blocks, offset);
 
 	do {
-		unsigned long out = PAGE_CACHE_SIZE;
-		unsigned long next = *(u32 *) romfs_read(offset);
+		unsigned long out = blksize;
+		unsigned long next = swapped ? bswap_32(*pointers) : *pointers;
 
-		if (next > end_data) {
-			end_data = next;
+		pointers++;
+
+		if (next > max_next) {
+			max_next = next;
 		}
 
-		offset += 4;
 		if (curr == next) {
 			if (opt_verbose > 1) {
-				printf("  hole at %ld (%d)\n", curr, PAGE_CACHE_SIZE);
+				printf("  hole at %ld (%u)\n", curr, blksize);
 			}
-			if (size < PAGE_CACHE_SIZE)
+			if (size < blksize)
 				out = size;
-			memset(outbuffer, 0x00, out);
 		}
 		else {
+			long long fmk_start;
+
 			if (opt_verbose > 1) {
 				printf("  uncompressing block at %ld to %ld (%ld)\n", curr, next, next - curr);
 			}
-			out = uncompress_block(romfs_read(curr), next - curr);
+			if (next < curr || next - curr > blksize*2) {
+				die(FSCK_UNCORRECTED, 0, "data block too large");
+			}
+			romfs_pread(inbuffer, next - curr, curr);
+			FMK_STAGE_BEGIN(decompress_block, fmk_start);
+			out = uncompress_block(stream, outbuffer, inbuffer, next - curr);
+			FMK_STAGE_END(decompress_block, fmk_start, next - curr, out);
 		}
-		if (size >= PAGE_CACHE_SIZE) {
-			if (out != PAGE_CACHE_SIZE) {
+		if (size >= blksize) {
+			if (out != blksize) {
 				die(FSCK_UNCORRECTED, 0, "non-block (%ld) bytes", out);
 			}
 		} else {
@@ -395,13 +675,29 @@ static void do_uncompress(char *path, int fd, unsigned long offset, unsigned lon
 			}
 		}
 		size -= out;
-		if (opt_extract) {
-			if (write(fd, outbuffer, out) < 0) {
-				die(FSCK_ERROR, 1, "write failed: %s", path);
-			}
+		if (hash && curr == next) {
+			fmk_index_zeros(hash, out);
+		}
+		else if (hash) {
+			fmk_index_data(hash, outbuffer, out);
+		}
+		if (opt_extract && curr != next && !is_zero(outbuffer, out)) {
+			pwrite_all(path, fd, outbuffer, out, pos);
 		}
+		pos += out;
 		curr = next;
 	} while (size);
+	free(pointers - blocks);
+
+	if (opt_extract && ftruncate(fd, file_size) < 0) {
+		die(FSCK_ERROR, 1, "ftruncate failed: %s", path);
+	}
+
+	pthread_mutex_lock(&job_mutex);
+	if (max_next > end_data) {
+		end_data = max_next;
+	}
+	pthread_mutex_unlock(&job_mutex);
 }
 
 static void change_file_status(char *path, struct cramfs_inode *i)
@@ -427,6 +723,110 @@ static void change_file_status(char *path, struct cramfs_inode *i)
 	}
 }
 
+/*
+ * Set once everything is extracted, so that files are complete and
+ * directories are no longer written to.
+ */
+static void queue_file_status(char *path, struct cramfs_inode *i)
+{
+	if (status_count == status_size) {
+		status_size = status_size ? status_size * 2 : 256;
+		statuses = realloc(statuses, status_size * sizeof(struct file_status));
+		if (!statuses) {
+			die(FSCK_ERROR, 1, "realloc failed");
+		}
+	}
+	statuses[status_count].path = strdup(path);
+	if (!statuses[status_count].path) {
+		die(FSCK_ERROR, 1, "strdup failed");
+	}
+	statuses[status_count].inode = *i;
+	status_count++;
+}
+
+static void set_file_status(void)
+{
+	int n;
+
+	for (n = 0; n < status_count; n++) {
+		change_file_status(statuses[n].path, &statuses[n].inode);
+		free(statuses[n].path);
+	}
+	free(statuses);
+}
+
+static void extract_file(char *path, struct cramfs_inode *i,
+	z_stream *stream, char *outbuffer, char *inbuffer)
+{
+	int fd = 0;
+	long long fmk_start;
+	struct fmk_index_hash hash;
+
+	FMK_STAGE_BEGIN(write_file, fmk_start);
+	if (opt_extract) {
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, i->mode);
+		if (fd < 0) {
+			die(FSCK_ERROR, 1, "open failed: %s", path);
+		}
+	}
+	if (fmk_index) {
+		fmk_index_start(&hash);
+	}
+	if (i->size) {
+		do_uncompress(path, fd, i->offset << 2, i->size, stream, outbuffer, inbuffer,
+			fmk_index ? &hash : NULL);
+	}
+	if (opt_extract) {
+		close(fd);
+	}
+	if (fmk_index) {
+		fmk_index_add(&hash, path + strlen(extract_dir), i->size, i->mode);
+	}
+	FMK_STAGE_END(write_file, fmk_start, i->size, opt_extract ? i->size : 0);
+}
+
+static void *file_thread(void *arg)
+{
+	z_stream stream;
+	char *outbuffer = malloc(blksize*2);
+	char *inbuffer = malloc(blksize*2);
+
+	(void) arg;
+	if (!outbuffer || !inbuffer) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit(&stream) != Z_OK) {
+		die(FSCK_ERROR, 0, "inflateInit failed");
+	}
+
+	for (;;) {
+		struct file_job *job;
+
+		pthread_mutex_lock(&job_mutex);
+		while (!job_head && !walk_done)
+			pthread_cond_wait(&job_cond, &job_mutex);
+		job = job_head;
+		if (job) {
+			job_head = job->next;
+			if (!job_head)
+				job_tail = &job_head;
+		}
+		pthread_mutex_unlock(&job_mutex);
+		if (!job)
+			break;
+
+		extract_file(job->path, &job->inode, &stream, outbuffer, inbuffer);
+		free(job->path);
+		free(job);
+	}
+
+	inflateEnd(&stream);
+	free(outbuffer);
+	free(inbuffer);
+	return NULL;
+}
+
 static void do_directory(char *path, struct cramfs_inode *i)
 {
 	int pathlen = strlen(path);
@@ -454,7 +854,7 @@ static void do_directory(char *path, struct cramfs_inode *i)
 		if (mkdir(path, i->mode) < 0) {
 			die(FSCK_ERROR, 1, "mkdir failed: %s", path);
 		}
-		change_file_status(path, i);
+		queue_file_status(path, i);
 	}
 	while (count > 0) {
 		struct cramfs_inode *child = iget(offset);
@@ -492,7 +892,7 @@ static void do_directory(char *path, struct cramfs_inode *i)
 static void do_file(char *path, struct cramfs_inode *i)
 {
 	unsigned long offset = i->offset << 2;
-	int fd = 0;
+	struct file_job *job;
 
 	if (offset == 0 && i->size != 0) {
 		die(FSCK_UNCORRECTED, 0, "file inode has zero offset and non-zero size");
@@ -507,18 +907,31 @@ static void do_file(char *path, struct cramfs_inode *i)
 		print_node('f', i, path);
 	}
 	if (opt_extract) {
-		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, i->mode);
-		if (fd < 0) {
-			die(FSCK_ERROR, 1, "open failed: %s", path);
-		}
+		queue_file_status(path, i);
 	}
-	if (i->size) {
-		do_uncompress(path, fd, offset, i->size);
+	if (opt_threads == 0) {
+		static char inbuffer[MAX_BLKSIZE*2];
+
+		extract_file(path, i, &stream, outbuffer, inbuffer);
+		return;
 	}
-	if (opt_extract) {
-		close(fd);
-		change_file_status(path, i);
+
+	job = malloc(sizeof(struct file_job));
+	if (!job) {
+		die(FSCK_ERROR, 1, "malloc failed");
 	}
+	job->path = strdup(path);
+	if (!job->path) {
+		die(FSCK_ERROR, 1, "strdup failed");
+	}
+	job->inode = *i;
+	job->next = NULL;
+
+	pthread_mutex_lock(&job_mutex);
+	*job_tail = job;
+	job_tail = &job->next;
+	pthread_cond_signal(&job_cond);
+	pthread_mutex_unlock(&job_mutex);
 }
 
 static void do_symlink(char *path, struct cramfs_inode *i)
@@ -528,6 +941,8 @@ static void do_symlink(char *path, struct cramfs_inode *i)
 	unsigned long next = *(u32 *) romfs_read(offset);
 	unsigned long size;
 
+	if (swapped)
+		next = bswap_32(next);
 	if (offset == 0) {
 		die(FSCK_UNCORRECTED, 0, "symbolic link has zero offset");
 	}
@@ -538,11 +953,13 @@ static void do_symlink(char *path, struct cramfs_inode *i)
 	if (offset < start_data) {
 		start_data = offset;
 	}
+	pthread_mutex_lock(&job_mutex);
 	if (next > end_data) {
 		end_data = next;
 	}
+	pthread_mutex_unlock(&job_mutex);
 
-	size = uncompress_block(romfs_read(curr), next - curr);
+	size = uncompress_block(&stream, outbuffer, romfs_read(curr), next - curr);
 	if (size != i->size) {
 		die(FSCK_UNCORRECTED, 0, "size error in symlink: %s", path);
 	}
@@ -561,7 +978,7 @@ static void do_symlink(char *path, struct cramfs_inode *i)
 		if (symlink(outbuffer, path) < 0) {
 			die(FSCK_ERROR, 1, "symlink failed: %s", path);
 		}
-		change_file_status(path, i);
+		queue_file_status(path, i);
 	}
 }
 
@@ -606,7 +1023,7 @@ static void do_special_inode(char *path, struct cramfs_inode *i)
 		if (mknod(path, i->mode, devtype) < 0) {
 			die(FSCK_ERROR, 1, "mknod failed: %s", path);
 		}
-		change_file_status(path, i);
+		queue_file_status(path, i);
 	}
 }
 
@@ -629,6 +1046,8 @@ static void expand_fs(char *path, struct cramfs_inode *inode)
 static void test_fs(int start)
 {
 	struct cramfs_inode *root;
+	pthread_t *threads;
+	int n;
 
 	root = read_super();
 	umask(0);
@@ -636,8 +1055,35 @@ static void test_fs(int start)
 	stream.next_in = NULL;
 	stream.avail_in = 0;
 	inflateInit(&stream);
+
+	if (opt_verbose > 1)
+		opt_threads = 0;
+	else if (opt_threads == 0)
+		opt_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (opt_threads < 0)
+		opt_threads = 1;
+	threads = malloc(opt_threads * sizeof(pthread_t) + 1);
+	if (!threads) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	for (n = 0; n < opt_threads; n++) {
+		if (pthread_create(&threads[n], NULL, file_thread, NULL) != 0) {
+			die(FSCK_ERROR, 0, "failed to create thread");
+		}
+	}
+
 	expand_fs(extract_dir, root);
+
+	pthread_mutex_lock(&job_mutex);
+	walk_done = 1;
+	pthread_cond_broadcast(&job_cond);
+	pthread_mutex_unlock(&job_mutex);
+	for (n = 0; n < opt_threads; n++)
+		pthread_join(threads[n], NULL);
+	free(threads);
 	inflateEnd(&stream);
+
+	set_file_status();
 	if (start_data != ~0UL) {
 		if (start_data < (sizeof(struct cramfs_super) + start)) {
 			die(FSCK_UNCORRECTED, 0, "directory data start (%ld) < sizeof(struct cramfs_super) + start (%ld)", start_data, sizeof(struct cramfs_super) + start);
@@ -653,6 +1099,321 @@ static void test_fs(int start)
 	}
 	iput(root);		/* free(root) */
 }
+
+/*
+ * -c and -l: find one path by reading only the directories on it, and
+ * uncompress only that file, so that single files can be pulled out of
+ * an image without checking or extracting the rest of it.
+ */
+
+/* The root inode, where iget() can read it like any other */
+static unsigned long root_inode(int start)
+{
+	return start + offsetof(struct cramfs_super, root);
+}
+
+/* Returns the inode offset of NAME (LEN bytes) in DIR, or 0 */
+static unsigned long find_entry(struct cramfs_inode *dir, const char *name, int len)
+{
+	unsigned long offset = dir->offset << 2;
+	int count = dir->size;
+
+	while (count > 0) {
+		struct cramfs_inode *child = iget(offset);
+		int namelen = child->namelen << 2;
+		char *entry;
+
+		iput(child);
+		if (namelen == 0) {
+			die(FSCK_UNCORRECTED, 0, "filename length is zero");
+		}
+		entry = romfs_read(offset + sizeof(struct cramfs_inode));
+		if (strnlen(entry, namelen) == (size_t) len && memcmp(entry, name, len) == 0)
+			return offset;
+		offset += sizeof(struct cramfs_inode) + namelen;
+		count -= sizeof(struct cramfs_inode) + namelen;
+	}
+	return 0;
+}
+
+static unsigned long lookup_path(int start, const char *path)
+{
+	unsigned long offset = root_inode(start);
+
+	for (;;) {
+		struct cramfs_inode *dir;
+		const char *end;
+
+		while (*path == '/')
+			path++;
+		if (!*path)
+			return offset;
+		end = strchrnul(path, '/');
+		dir = iget(offset);
+		offset = S_ISDIR(dir->mode) ? find_entry(dir, path, end - path) : 0;
+		iput(dir);
+		if (!offset)
+			return 0;
+		path = end;
+	}
+}
+
+/*
+ * The index is a text file of "offset /path" lines, after a header
+ * line with the superblock's crc, edition, size and file count, and the
+ * image's length, that must match for the index to be used.
+ */
+static void write_index_dir(FILE *index, char *path, struct cramfs_inode *dir)
+{
+	int pathlen = strlen(path);
+	int count = dir->size;
+	unsigned long offset = dir->offset << 2;
+	char *newpath = malloc(pathlen + 256);
+
+	if (!newpath) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	memcpy(newpath, path, pathlen);
+	newpath[pathlen++] = '/';
+	while (count > 0) {
+		struct cramfs_inode *child = iget(offset);
+		int newlen = child->namelen << 2;
+
+		if (newlen == 0) {
+			die(FSCK_UNCORRECTED, 0, "filename length is zero");
+		}
+		memcpy(newpath + pathlen, romfs_read(offset + sizeof(struct cramfs_inode)), newlen);
+		newpath[pathlen + newlen] = 0;
+		/* names with newlines are left for lookup_path() */
+		if (!strchr(newpath + pathlen, '\n')) {
+			fprintf(index, "%lu %s\n", offset, newpath);
+			if (S_ISDIR(child->mode))
+				write_index_dir(index, newpath, child);
+		}
+		offset += sizeof(struct cramfs_inode) + newlen;
+		count -= sizeof(struct cramfs_inode) + newlen;
+		iput(child);
+	}
+	free(newpath);
+}
+
+static void write_index(int start, const char *header)
+{
+	struct cramfs_inode *root = iget(root_inode(start));
+	char *tmp;
+	FILE *index;
+
+	/* written aside and renamed, for other queries reading it meanwhile */
+	if (asprintf(&tmp, "%s.%d", opt_index, (int) getpid()) < 0) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	index = fopen(tmp, "w");
+	if (!index) {
+		die(FSCK_ERROR, 1, "open failed: %s", tmp);
+	}
+	fputs(header, index);
+	fprintf(index, "%lu /\n", root_inode(start));
+	write_index_dir(index, "", root);
+	if (fclose(index) != 0) {
+		die(FSCK_ERROR, 1, "write failed: %s", tmp);
+	}
+	if (rename(tmp, opt_index) < 0) {
+		die(FSCK_ERROR, 1, "rename failed: %s", opt_index);
+	}
+	free(tmp);
+	iput(root);
+}
+
+static unsigned long index_lookup(int start, const char *path)
+{
+	char header[80], *norm, *line = NULL;
+	size_t line_size = 0;
+	unsigned long offset = 0;
+	const char *p;
+	int n = 0;
+	FILE *index;
+
+	snprintf(header, sizeof(header), "cramfs-index %08x %u %u %u %lu\n",
+		 super.fsid.crc, super.fsid.edition, super.size,
+		 super.fsid.files, (unsigned long) image_length);
+
+	/* as "/a/b", the way the index has it */
+	norm = malloc(strlen(path) + 2);
+	if (!norm) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	for (p = path; *p; p++) {
+		if (*p != '/' && (p == path || p[-1] == '/'))
+			norm[n++] = '/';
+		if (*p != '/')
+			norm[n++] = *p;
+	}
+	if (n == 0)
+		norm[n++] = '/';
+	norm[n] = 0;
+
+	index = fopen(opt_index, "r");
+	if (index && getline(&line, &line_size, index) > 0 && strcmp(line, header) == 0) {
+		ssize_t len;
+
+		while ((len = getline(&line, &line_size, index)) > 0) {
+			char *name;
+
+			if (line[len - 1] == '\n')
+				line[len - 1] = 0;
+			name = strchr(line, ' ');
+			if (name && strcmp(name + 1, norm) == 0) {
+				offset = strtoul(line, NULL, 10);
+				break;
+			}
+		}
+	}
+	else {
+		write_index(start, header);
+	}
+	if (index)
+		fclose(index);
+	free(line);
+	free(norm);
+
+	return offset ? offset : lookup_path(start, path);
+}
+
+static void write_all(char *buf, unsigned long len)
+{
+	while (len) {
+		ssize_t res = write(STDOUT_FILENO, buf, len);
+
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res < 0) {
+			die(FSCK_ERROR, 1, "write failed: stdout");
+		}
+		buf += res;
+		len -= res;
+	}
+}
+
+static void cat_file(struct cramfs_inode *i)
+{
+	static char inbuffer[MAX_BLKSIZE*2];
+	unsigned long size = i->size;
+	unsigned long blocks = (size + blksize - 1) / blksize;
+	unsigned long offset = i->offset << 2;
+	unsigned long curr = offset + 4 * blocks;
+	unsigned long b;
+	u32 *pointers;
+
+	pointers = malloc(4 * blocks + 1);
+	if (!pointers) {
+		die(FSCK_ERROR, 1, "malloc failed");
+	}
+	romfs_pread(pointers, 4 * blocks, offset);
+
+	for (b = 0; b < blocks; b++) {
+		unsigned long out = size < blksize ? size : blksize;
+		unsigned long next = swapped ? bswap_32(pointers[b]) : pointers[b];
+
+		if (curr == next) {
+			memset(outbuffer, 0x00, out);
+		}
+		else {
+			if (next < curr || next - curr > blksize*2) {
+				die(FSCK_UNCORRECTED, 0, "data block too large");
+			}
+			romfs_pread(inbuffer, next - curr, curr);
+			if ((unsigned long) uncompress_block(&stream, outbuffer, inbuffer, next - curr) != out) {
+				die(FSCK_UNCORRECTED, 0, "non-block bytes: %s", opt_cat);
+			}
+		}
+		write_all(outbuffer, out);
+		size -= out;
+		curr = next;
+	}
+	free(pointers);
+}
+
+static void list_node(struct cramfs_inode *i, char *name)
+{
+	char type = S_ISDIR(i->mode) ? 'd' : S_ISREG(i->mode) ? 'f' :
+		S_ISLNK(i->mode) ? 'l' : S_ISCHR(i->mode) ? 'c' :
+		S_ISBLK(i->mode) ? 'b' : S_ISFIFO(i->mode) ? 'p' : 's';
+
+	if (S_ISLNK(i->mode)) {
+		unsigned long offset = i->offset << 2;
+		unsigned long next = *(u32 *) romfs_read(offset);
+		unsigned long size;
+		char *str;
+
+		if (swapped)
+			next = bswap_32(next);
+		size = uncompress_block(&stream, outbuffer, romfs_read(offset + 4), next - offset - 4);
+		outbuffer[size] = 0;
+		if (asprintf(&str, "%s -> %s", name, outbuffer) < 0) {
+			die(FSCK_ERROR, 1, "malloc failed");
+		}
+		print_node(type, i, str);
+		free(str);
+	}
+	else {
+		print_node(type, i, name);
+	}
+}
+
+static void list_dir(struct cramfs_inode *dir)
+{
+	unsigned long offset = dir->offset << 2;
+	int count = dir->size;
+	char name[256];
+
+	while (count > 0) {
+		struct cramfs_inode *child = iget(offset);
+		int namelen = child->namelen << 2;
+
+		if (namelen == 0) {
+			die(FSCK_UNCORRECTED, 0, "filename length is zero");
+		}
+		memcpy(name, romfs_read(offset + sizeof(struct cramfs_inode)), namelen);
+		name[namelen] = 0;
+		list_node(child, name);
+		offset += sizeof(struct cramfs_inode) + namelen;
+		count -= sizeof(struct cramfs_inode) + namelen;
+		iput(child);
+	}
+}
+
+static void query_fs(int start)
+{
+	char *path = opt_cat ? opt_cat : opt_list;
+	struct cramfs_inode *i;
+	unsigned long offset;
+
+	image = mmap(NULL, image_length, PROT_READ, MAP_SHARED, fd, 0);
+	if (image == MAP_FAILED)
+		image = NULL;
+	inflateInit(&stream);
+
+	offset = opt_index ? index_lookup(start, path) : lookup_path(start, path);
+	if (!offset) {
+		die(FSCK_ERROR, 0, "no such file or directory: %s", path);
+	}
+	i = iget(offset);
+	if (opt_cat) {
+		if (!S_ISREG(i->mode)) {
+			die(FSCK_ERROR, 0, "not a regular file: %s", path);
+		}
+		fflush(stdout);
+		cat_file(i);
+	}
+	else if (S_ISDIR(i->mode)) {
+		list_dir(i);
+	}
+	else {
+		list_node(i, path);
+	}
+	iput(i);
+	inflateEnd(&stream);
+}
 #endif /* INCLUDE_FS_TESTS */
 
 int main(int argc, char **argv)
@@ -663,12 +1424,16 @@ int main(int argc, char **argv)
 
 	if (argc)
 		progname = argv[0];
+	fmk_stats_init("cramfsck");
 
 	/* command line options */
-	while ((c = getopt(argc, argv, "hx:v")) != EOF) {
+	while ((c = getopt(argc, argv, "hx:vc:D:I:l:t:")) != EOF) {
 		switch (c) {
 		case 'h':
 			usage(FSCK_OK);
+		case 'D':
+			read_dictionary(optarg);
+			break;
 		case 'x':
 #ifdef INCLUDE_FS_TESTS
 			opt_extract = 1;
@@ -677,17 +1442,50 @@ int main(int argc, char **argv)
 #else /* not INCLUDE_FS_TESTS */
 			die(FSCK_USAGE, 0, "compiled without -x support");
 #endif /* not INCLUDE_FS_TESTS */
+		case 'c':
+			opt_cat = optarg;
+			break;
+		case 'l':
+			opt_list = optarg;
+			break;
+		case 'I':
+			opt_index = optarg;
+			break;
 		case 'v':
 			opt_verbose++;
 			break;
+		case 't':
+			opt_threads = atoi(optarg);
+			if (opt_threads < 1)
+				usage(FSCK_USAGE);
+			break;
 		}
 	}
 
 	if ((argc - optind) != 1)
 		usage(FSCK_USAGE);
+	if ((opt_cat && opt_list) || ((opt_cat || opt_list) && opt_extract))
+		usage(FSCK_USAGE);
 	filename = argv[optind];
+	if (opt_extract) {
+		fmk_index_init("cramfsck", filename);
+	}
+
+	if (opt_verbose) {
+		if (dictionary)
+			printf("Decompressor: zlib %s, for the preset dictionary\n", zlibVersion());
+		else
+			printf("Decompressor: %s\n", zbuf_backend());
+	}
 
 	test_super(&start, &length);
+#ifdef INCLUDE_FS_TESTS
+	if (opt_cat || opt_list) {
+		image_length = length;
+		query_fs(start);
+		exit(FSCK_OK);
+	}
+#endif /* INCLUDE_FS_TESTS */
 	test_crc(start);
 #ifdef INCLUDE_FS_TESTS
 	test_fs(start);
@@ -79,6 +79,11 @@ struct cramfs_super {
 #define CRAMFS_FLAG_HOLES		0x00000100	/* support for holes */
 #define CRAMFS_FLAG_WRONG_SIGNATURE	0x00000200	/* reserved */
 #define CRAMFS_FLAG_SHIFTED_ROOT_OFFSET	0x00000400	/* shifted root fs */
+#define CRAMFS_FLAG_BLKSZ_MASK		0x00003800	/* log2(block size) - 12 */
+#define CRAMFS_FLAG_PRESET_DICT		0x00010000	/* zlib preset dictionary,
+							   its Adler-32 in future */
+
+#define CRAMFS_FLAG_BLKSZ_SHIFT		11
 
 /*
  * Valid values in super.flags.  Currently we refuse to mount
@@ -32,9 +32,16 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include <linux/cramfs_fs.h>
 #include <zlib.h>
+#include "cramfs_swap.h"
+#include "../zbuf/zbuf.h"
+#include "../fmkstats/fmkstats.h"
 
 /* Exit codes used by mkfs-type programs */
 #define MKFS_OK          0	/* No errors */
@@ -47,6 +54,9 @@
 /* The kernel assumes PAGE_CACHE_SIZE as block size. */
 #define PAGE_CACHE_SIZE (4096)
 
+/* The largest block size CRAMFS_FLAG_BLKSZ_MASK can record (-b) */
+#define MAX_BLKSIZE (PAGE_CACHE_SIZE << (CRAMFS_FLAG_BLKSZ_MASK >> CRAMFS_FLAG_BLKSZ_SHIFT))
+
 /*
  * The longest filename component to allow for in the input directory tree.
  * ext2fs (and many others) allow up to 255 bytes.  A couple of filesystems
@@ -75,6 +85,7 @@ static const char *progname = "mkcramfs";
 static unsigned int blksize = PAGE_CACHE_SIZE;
 static long total_blocks = 0, total_nodes = 1; /* pre-count the root node */
 static int image_length = 0;
+static unsigned long dir_size = 0;	/* upper bound of the directory structure */
 
 /*
  * If opt_holes is set, then mkcramfs can create explicit holes in the
@@ -93,6 +104,13 @@ static int opt_pad = 0;
 static int opt_verbose = 0;
 static char *opt_image = NULL;
 static char *opt_name = NULL;
+static int opt_threads = 0;
+static int opt_swap = 0;	/* -B on a little-endian host */
+static char *opt_sort = NULL;	/* file data layout priorities (-S) */
+
+/* zlib preset dictionary every block is compressed with (-D) */
+static unsigned char *dictionary = NULL;
+static unsigned int dict_size = 0;
 
 static int warn_dev, warn_gid, warn_namelen, warn_skip, warn_size, warn_uid;
 
@@ -110,6 +128,7 @@ struct entry {
 	void *uncompressed;
 	/* points to other identical file */
 	struct entry *same;
+	int priority;			/* data laid out highest first (-S) */
 	unsigned int offset;		/* pointer to compressed data in archive */
 	unsigned int dir_offset;	/* Where in the archive is the directory entry? */
 
@@ -123,18 +142,23 @@ static void usage(int status)
 {
 	FILE *stream = status ? stderr : stdout;
 
-	fprintf(stream, "usage: %s [-h] [-e edition] [-i file] [-n name] dirname outfile\n"
+	fprintf(stream, "usage: %s [-hB] [-b blksize] [-e edition] [-i file] [-n name] [-S sortfile] [-t threads] [-D dictionary] dirname outfile\n"
 		" -h         print this help\n"
+		" -B         make a big-endian image, whatever the host\n"
+		" -b blksize block size, a power of 2 up to %d (default %d; others need a patched kernel)\n"
+		" -D dict    compress with a zlib preset dictionary (not supported by the kernel)\n"
 		" -E         make all warnings errors (non-zero exit status)\n"
 		" -e edition set edition number (part of fsid)\n"
 		" -i file    insert a file image into the filesystem (requires >= 2.4.0)\n"
 		" -n name    set name of cramfs filesystem\n"
 		" -p         pad by %d bytes for boot code\n"
+		" -S file    lay file data out by the \"path priority\" lines in file, highest first\n"
 		" -s         sort directory entries (old option, ignored)\n"
+		" -t threads compress with this many threads (default: number of CPUs)\n"
 		" -v         be more verbose\n"
 		" -z         make explicit holes (requires >= 2.3.39)\n"
 		" dirname    root of the directory tree to be compressed\n"
-		" outfile    output file\n", progname, PAD_SIZE);
+		" outfile    output file\n", progname, MAX_BLKSIZE, PAGE_CACHE_SIZE, PAD_SIZE);
 
 	exit(status);
 }
@@ -156,6 +180,33 @@ static void die(int status, int syserr, const char *fmt, ...)
 	exit(status);
 }
 
+/* zlib only looks back 32kB, so that's the longest useful dictionary. */
+static void read_dictionary(const char *file)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		die(MKFS_ERROR, 1, "open failed: %s", file);
+	}
+	if (fstat(fd, &st) < 0) {
+		die(MKFS_ERROR, 1, "fstat failed: %s", file);
+	}
+	if (st.st_size == 0 || st.st_size > 32768) {
+		die(MKFS_USAGE, 0, "dictionary must be 1 to 32768 bytes: %s", file);
+	}
+	dictionary = malloc(st.st_size);
+	if (!dictionary) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
+	if (read(fd, dictionary, st.st_size) != st.st_size) {
+		die(MKFS_ERROR, 1, "read failed: %s", file);
+	}
+	close(fd);
+	dict_size = st.st_size;
+}
+
 static void map_entry(struct entry *entry)
 {
 	if (entry->path) {
@@ -180,39 +231,243 @@ static void unmap_entry(struct entry *entry)
 	}
 }
 
-static int find_identical_file(struct entry *orig, struct entry *newfile)
+/*
+ * Duplicate files are found by sorting the files by size, checksumming
+ * the contents of those whose size is shared, and comparing the bytes
+ * of those whose checksum is too.  A file is made to share the data of
+ * the first identical file in tree order, which is laid out at the
+ * highest -S priority of the files that share it.
+ */
+struct candidate {
+	struct entry *entry;
+	unsigned long index;	/* tree order */
+	u32 crc;
+};
+
+static struct candidate *candidates;
+static unsigned long candidate_count, candidate_size;
+
+static void find_candidates(struct entry *entry)
 {
-	if (orig == newfile)
-		return 1;
-	if (!orig)
-		return 0;
-	if (orig->size == newfile->size && (orig->path || orig->uncompressed))
-	{
-		map_entry(orig);
-		map_entry(newfile);
-		if (!memcmp(orig->uncompressed, newfile->uncompressed, orig->size))
-		{
-			newfile->same = orig;
-			unmap_entry(newfile);
-			unmap_entry(orig);
-			return 1;
+	for (; entry; entry = entry->next) {
+		if (entry->size && (entry->path || entry->uncompressed)) {
+			if (candidate_count == candidate_size) {
+				candidate_size = candidate_size ? candidate_size * 2 : 256;
+				candidates = realloc(candidates, candidate_size * sizeof(struct candidate));
+				if (!candidates) {
+					die(MKFS_ERROR, 1, "realloc failed");
+				}
+			}
+			candidates[candidate_count].entry = entry;
+			candidates[candidate_count].index = candidate_count;
+			candidates[candidate_count].crc = 0;
+			candidate_count++;
+		}
+		find_candidates(entry->child);
+	}
+}
+
+static int candidate_cmp(const void *a, const void *b)
+{
+	const struct candidate *x = a, *y = b;
+
+	if (x->entry->size != y->entry->size)
+		return x->entry->size < y->entry->size ? -1 : 1;
+	if (x->crc != y->crc)
+		return x->crc < y->crc ? -1 : 1;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static int identical_files(struct entry *orig, struct entry *newfile)
+{
+	int same;
+
+	map_entry(orig);
+	map_entry(newfile);
+	same = !memcmp(orig->uncompressed, newfile->uncompressed, orig->size);
+	unmap_entry(newfile);
+	unmap_entry(orig);
+	return same;
+}
+
+static void eliminate_doubles(struct entry *root)
+{
+	unsigned long i, j, start;
+
+	find_candidates(root);
+	qsort(candidates, candidate_count, sizeof(struct candidate), candidate_cmp);
+
+	for (i = 0; i < candidate_count; i++) {
+		struct entry *entry = candidates[i].entry;
+
+		if ((i == 0 || candidates[i - 1].entry->size != entry->size) &&
+		    (i + 1 == candidate_count || candidates[i + 1].entry->size != entry->size))
+			continue;
+		map_entry(entry);
+		candidates[i].crc = crc32(crc32(0L, Z_NULL, 0), entry->uncompressed, entry->size);
+		unmap_entry(entry);
+	}
+	qsort(candidates, candidate_count, sizeof(struct candidate), candidate_cmp);
+
+	for (start = 0; start < candidate_count; start = i) {
+		for (i = start + 1; i < candidate_count &&
+			     candidates[i].entry->size == candidates[start].entry->size &&
+			     candidates[i].crc == candidates[start].crc; i++) {
+			struct entry *newfile = candidates[i].entry;
+
+			for (j = start; j < i; j++) {
+				struct entry *orig = candidates[j].entry;
+
+				if (!orig->same && identical_files(orig, newfile)) {
+					newfile->same = orig;
+					break;
+				}
+			}
+		}
+	}
+	free(candidates);
+}
+
+/*
+ * -S: each line of the sort file is a path, relative to dirname, and a
+ * priority from -32768 to 32767, as for mksquashfs -sort.  File data is
+ * laid out highest priority first, in tree order among equals, so that
+ * the files read at boot can be put together.  A directory's priority
+ * is that of everything under it that isn't listed itself.
+ */
+struct sort_item {
+	char *path;
+	int priority;
+	int used;
+};
+
+static struct sort_item *sort_items;
+static int sort_count;
+
+static int sort_item_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct sort_item *) a)->path, ((const struct sort_item *) b)->path);
+}
+
+static void read_sort_file(const char *file, const char *dirname)
+{
+	FILE *f;
+	char *line = NULL;
+	size_t line_size = 0, dirlen = strlen(dirname);
+	int sort_size = 0, lineno = 0;
+	ssize_t len;
+
+	f = fopen(file, "r");
+	if (!f) {
+		die(MKFS_ERROR, 1, "open failed: %s", file);
+	}
+	while (dirlen > 1 && dirname[dirlen - 1] == '/')
+		dirlen--;
+	while ((len = getline(&line, &line_size, f)) >= 0) {
+		char *path = line, *p, *ep;
+		long priority;
+
+		lineno++;
+		while (len && isspace((unsigned char) line[len - 1]))
+			line[--len] = '\0';
+		if (len == 0 || line[0] == '#')
+			continue;
+		for (p = line + len; p > line && !isspace((unsigned char) p[-1]); p--)
+			;
+		errno = 0;
+		priority = strtol(p, &ep, 10);
+		if (p == line || errno || *p == '\0' || *ep != '\0' ||
+		    priority < -32768 || priority > 32767) {
+			die(MKFS_USAGE, 0, "%s:%d: expected a path and a priority", file, lineno);
+		}
+		while (p > line && isspace((unsigned char) p[-1]))
+			p--;
+		*p = '\0';
+
+		/* relative to dirname, whether or not it is given */
+		if (strncmp(path, dirname, dirlen) == 0 && (path[dirlen] == '/' || path[dirlen] == '\0'))
+			path += dirlen;
+		for (;;) {
+			if (path[0] == '/')
+				path++;
+			else if (path[0] == '.' && (path[1] == '/' || path[1] == '\0'))
+				path++;
+			else
+				break;
+		}
+		len = strlen(path);
+		while (len && path[len - 1] == '/')
+			path[--len] = '\0';
+
+		if (sort_count == sort_size) {
+			sort_size = sort_size ? sort_size * 2 : 256;
+			sort_items = realloc(sort_items, sort_size * sizeof(struct sort_item));
+			if (!sort_items) {
+				die(MKFS_ERROR, 1, "realloc failed");
+			}
 		}
-		unmap_entry(newfile);
-		unmap_entry(orig);
+		sort_items[sort_count].path = strdup(path);
+		if (!sort_items[sort_count].path) {
+			die(MKFS_ERROR, 1, "strdup failed");
+		}
+		sort_items[sort_count].priority = priority;
+		sort_items[sort_count].used = 0;
+		sort_count++;
 	}
-	return (find_identical_file(orig->child, newfile) ||
-		find_identical_file(orig->next, newfile));
+	free(line);
+	fclose(f);
+	qsort(sort_items, sort_count, sizeof(struct sort_item), sort_item_cmp);
+}
+
+static int sort_priority(const char *path, int priority)
+{
+	struct sort_item key, *item;
+
+	key.path = (char *) path;
+	item = bsearch(&key, sort_items, sort_count, sizeof(struct sort_item), sort_item_cmp);
+	if (!item)
+		return priority;
+	item->used = 1;
+	return item->priority;
 }
 
-static void eliminate_doubles(struct entry *root, struct entry *orig) {
-	if (orig) {
-		if (orig->size && (orig->path || orig->uncompressed))
-			find_identical_file(root, orig);
-		eliminate_doubles(root, orig->child);
-		eliminate_doubles(root, orig->next);
+static void set_priorities(struct entry *entry, char *path, size_t len, int priority)
+{
+	for (; entry; entry = entry->next) {
+		size_t namelen = strlen((char *) entry->name);
+
+		if (len + namelen + 2 > PATH_MAX) {
+			die(MKFS_ERROR, 0, "path too long for -S: %s", path);
+		}
+		memcpy(path + len, entry->name, namelen + 1);
+		entry->priority = sort_priority(path, priority);
+		if (entry->child) {
+			path[len + namelen] = '/';
+			set_priorities(entry->child, path, len + namelen + 1, entry->priority);
+		}
 	}
 }
 
+static void sort_entries(struct entry *root)
+{
+	char *path = malloc(PATH_MAX);
+	int i;
+
+	if (!path) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
+	root->priority = sort_priority("", 0);
+	set_priorities(root->child, path, 0, root->priority);
+	free(path);
+
+	for (i = 0; i < sort_count; i++) {
+		if (!sort_items[i].used)
+			fprintf(stderr, "warning: sort file path not found: %s\n", sort_items[i].path);
+		free(sort_items[i].path);
+	}
+	free(sort_items);
+}
+
 /*
  * We define our own sorting function instead of using alphasort which
  * uses strcoll and changes ordering based on locale information.
@@ -317,6 +572,7 @@ static unsigned int parse_directory(struct entry *root_entry, const char *name,
 			warn_gid = 1;
 		size = sizeof(struct cramfs_inode) + ((namelen + 3) & ~3);
 		*fslen_ub += size;
+		dir_size += size;
 		if (S_ISDIR(st.st_mode)) {
 			entry->size = parse_directory(root_entry, path, &entry->child, fslen_ub);
 		} else if (S_ISREG(st.st_mode)) {
@@ -386,6 +642,12 @@ static unsigned int write_superblock(struct entry *root, char *base, int size)
 		super->flags |= CRAMFS_FLAG_HOLES;
 	if (image_length > 0)
 		super->flags |= CRAMFS_FLAG_SHIFTED_ROOT_OFFSET;
+	if (blksize != PAGE_CACHE_SIZE)
+		super->flags |= (ffs(blksize) - ffs(PAGE_CACHE_SIZE)) << CRAMFS_FLAG_BLKSZ_SHIFT;
+	if (dictionary) {
+		super->flags |= CRAMFS_FLAG_PRESET_DICT;
+		super->future = adler32(adler32(0L, Z_NULL, 0), dictionary, dict_size);
+	}
 	super->size = size;
 	memcpy(super->signature, CRAMFS_SIGNATURE, sizeof(super->signature));
 
@@ -409,6 +671,34 @@ static unsigned int write_superblock(struct entry *root, char *base, int size)
 	return offset;
 }
 
+/*
+ * The header is laid out in host order.  For -B on a little-endian
+ * host its superblock and inodes are turned big-endian once it is
+ * complete, before it is checksummed.
+ */
+static void swap_header(char *base, unsigned int dir_start, unsigned int end)
+{
+	struct cramfs_super *super = (struct cramfs_super *) base;
+	unsigned int offset = dir_start;
+
+	super->magic = bswap_32(super->magic);
+	super->size = bswap_32(super->size);
+	super->flags = bswap_32(super->flags);
+	super->future = bswap_32(super->future);
+	super->fsid.crc = bswap_32(super->fsid.crc);
+	super->fsid.edition = bswap_32(super->fsid.edition);
+	super->fsid.blocks = bswap_32(super->fsid.blocks);
+	super->fsid.files = bswap_32(super->fsid.files);
+	cramfs_inode_from_host(&super->root);
+
+	while (offset < end) {
+		struct cramfs_inode *inode = (struct cramfs_inode *) (base + offset);
+
+		offset += sizeof(struct cramfs_inode) + (inode->namelen << 2);
+		cramfs_inode_from_host(inode);
+	}
+}
+
 static void set_data_offset(struct entry *entry, char *base, unsigned long offset)
 {
 	struct cramfs_inode *inode = (struct cramfs_inode *) (base + entry->dir_offset);
@@ -554,15 +844,316 @@ static unsigned int write_directory_structure(struct entry *entry, char *base, u
 static int is_zero(char const *begin, unsigned len)
 {
 	/* Returns non-zero iff the first LEN bytes from BEGIN are all NULs. */
-	return (len-- == 0 ||
-		(begin[0] == '\0' &&
-		 (len-- == 0 ||
-		  (begin[1] == '\0' &&
-		   (len-- == 0 ||
-		    (begin[2] == '\0' &&
-		     (len-- == 0 ||
-		      (begin[3] == '\0' &&
-		       memcmp(begin, begin + 4, len) == 0))))))));
+	const unsigned long *word;
+
+	/* a word, four at a time, once BEGIN is aligned */
+	for (; len && ((unsigned long) begin & (sizeof(long) - 1)); len--)
+		if (*begin++)
+			return 0;
+	word = (const unsigned long *) begin;
+	for (; len >= 4 * sizeof(long); len -= 4 * sizeof(long), word += 4)
+		if (word[0] | word[1] | word[2] | word[3])
+			return 0;
+	for (begin = (char const *) word; len; len--)
+		if (*begin++)
+			return 0;
+	return 1;
+}
+
+/* As compress2(), but starting from the preset dictionary. */
+static int compress_dict(z_stream *stream, char *dest, unsigned long *len, char *src, unsigned int size)
+{
+	int err;
+
+	deflateReset(stream);
+	err = deflateSetDictionary(stream, dictionary, dict_size);
+	if (err != Z_OK)
+		return err;
+
+	stream->next_in = (unsigned char *) src;
+	stream->avail_in = size;
+	stream->next_out = (unsigned char *) dest;
+	stream->avail_out = *len;
+
+	err = deflate(stream, Z_FINISH);
+	if (err != Z_STREAM_END)
+		return err == Z_OK ? Z_BUF_ERROR : err;
+	*len = stream->total_out;
+	return Z_OK;
+}
+
+/*
+ * The data region is written straight to the output file through
+ * out_buf, which holds the out_len bytes of the image from out_start.
+ * Each file's block pointers are only known once its blocks are out,
+ * so they are patched in afterwards, and the checksum of the region
+ * is pieced together in data_crc as it goes.
+ */
+#define OUT_BUF_SIZE (256 * 1024)
+
+static int out_fd;
+static char *out_buf;
+static unsigned long out_start, out_len;
+static u32 data_crc;
+
+static void pwrite_all(const char *buf, unsigned long len, unsigned long offset)
+{
+	while (len) {
+		ssize_t res = pwrite(out_fd, buf, len, offset);
+
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			die(MKFS_ERROR, 1, "write failed");
+		}
+		buf += res;
+		len -= res;
+		offset += res;
+	}
+}
+
+static void flush_out(void)
+{
+	pwrite_all(out_buf, out_len, out_start);
+	out_start += out_len;
+	out_len = 0;
+}
+
+/* Append buf, or len zero bytes if buf is NULL, to the image. */
+static void write_out(const char *buf, unsigned long len)
+{
+	while (len) {
+		unsigned long n = OUT_BUF_SIZE - out_len;
+
+		if (n > len)
+			n = len;
+		if (buf) {
+			memcpy(out_buf + out_len, buf, n);
+			buf += n;
+		}
+		else
+			memset(out_buf + out_len, 0, n);
+		out_len += n;
+		len -= n;
+		if (out_len == OUT_BUF_SIZE)
+			flush_out();
+	}
+}
+
+/* Overwrite bytes already appended at offset. */
+static void patch_out(unsigned long offset, const char *buf, unsigned long len)
+{
+	if (offset < out_start) {
+		unsigned long n = out_start - offset;
+
+		if (n > len)
+			n = len;
+		pwrite_all(buf, n, offset);
+		offset += n;
+		buf += n;
+		len -= n;
+	}
+	memcpy(out_buf + (offset - out_start), buf, len);
+}
+
+static u32 crc32_zeros(u32 crc, unsigned long len)
+{
+	static const unsigned char zeros[64];
+
+	while (len) {
+		unsigned long n = len < sizeof(zeros) ? len : sizeof(zeros);
+
+		crc = crc32(crc, zeros, n);
+		len -= n;
+	}
+	return crc;
+}
+
+/*
+ * The files write_data lays out, in its order.  The compression threads
+ * take their blocks in turn, each compressing into the slot of its
+ * block's sequence number, and write_data takes the blocks from the
+ * slots in the same order.  A block is only started once its slot has
+ * been written out, so memory use does not depend on the files' sizes.
+ */
+struct slot {
+	char *data;
+	unsigned long len;
+	unsigned long seq;
+	int full;
+};
+
+static struct entry **jobs;
+static int job_count, next_job;
+static unsigned long next_block, next_seq, written_seq;
+static struct slot *slots;
+static int slot_count;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+
+static void queue_jobs(struct entry *entry)
+{
+	static int job_size = 0;
+
+	do {
+		if (entry->path || entry->uncompressed) {
+			if (entry->same) {
+				/* the data goes where the first file to need it would */
+				if (entry->priority > entry->same->priority)
+					entry->same->priority = entry->priority;
+			}
+			else {
+				if (job_count == job_size) {
+					job_size = job_size ? job_size * 2 : 256;
+					jobs = realloc(jobs, job_size * sizeof(struct entry *));
+					if (!jobs) {
+						die(MKFS_ERROR, 1, "realloc failed");
+					}
+				}
+				jobs[job_count++] = entry;
+			}
+		}
+		else if (entry->child)
+			queue_jobs(entry->child);
+		entry = entry->next;
+	} while (entry);
+}
+
+struct job_order {
+	struct entry *entry;
+	int index;		/* tree order */
+};
+
+static int job_order_cmp(const void *a, const void *b)
+{
+	const struct job_order *x = a, *y = b;
+
+	if (x->entry->priority != y->entry->priority)
+		return x->entry->priority > y->entry->priority ? -1 : 1;
+	return x->index - y->index;
+}
+
+/* Highest priority first (-S), and in tree order among equals */
+static void sort_jobs(void)
+{
+	struct job_order *order = malloc(job_count * sizeof(struct job_order) + 1);
+	int i;
+
+	if (!order) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
+	for (i = 0; i < job_count; i++) {
+		order[i].entry = jobs[i];
+		order[i].index = i;
+	}
+	qsort(order, job_count, sizeof(struct job_order), job_order_cmp);
+	for (i = 0; i < job_count; i++)
+		jobs[i] = order[i].entry;
+	free(order);
+}
+
+/* Read block of a file or symlink into buf, returning its length. */
+static unsigned int read_block(struct entry *entry, unsigned long block, char *buf)
+{
+	unsigned long pos = block * blksize;
+	unsigned int input = entry->size - pos;
+	unsigned int done = 0;
+
+	if (input > blksize)
+		input = blksize;
+	if (!entry->path) {
+		memcpy(buf, (char *) entry->uncompressed + pos, input);
+		return input;
+	}
+
+	while (done < input) {
+		ssize_t res = pread(entry->fd, buf + done, input - done, pos + done);
+
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0) {
+			die(MKFS_ERROR, res < 0, "read failed: %s", entry->path);
+		}
+		done += res;
+	}
+	return input;
+}
+
+static void *compress_thread(void *arg)
+{
+	z_stream stream;
+	char *uncompressed;
+
+	(void) arg;
+	uncompressed = malloc(blksize);
+	if (!uncompressed) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
+	memset(&stream, 0, sizeof(stream));
+	if (dictionary && deflateInit(&stream, Z_BEST_COMPRESSION) != Z_OK) {
+		die(MKFS_ERROR, 0, "deflateInit failed");
+	}
+
+	for (;;) {
+		struct entry *entry;
+		struct slot *slot;
+		unsigned long block, seq, len = 2 * blksize;
+		unsigned int input;
+		int err;
+
+		pthread_mutex_lock(&job_mutex);
+		while (next_job < job_count && next_seq >= written_seq + slot_count)
+			pthread_cond_wait(&job_cond, &job_mutex);
+		if (next_job == job_count) {
+			pthread_mutex_unlock(&job_mutex);
+			break;
+		}
+		entry = jobs[next_job];
+		block = next_block;
+		seq = next_seq++;
+		if (block == 0 && entry->path) {
+			/* write_data closes it after the last block */
+			entry->fd = open(entry->path, O_RDONLY);
+			if (entry->fd < 0) {
+				die(MKFS_ERROR, 1, "open failed: %s", entry->path);
+			}
+		}
+		if (++next_block == (entry->size - 1) / blksize + 1) {
+			next_block = 0;
+			next_job++;
+		}
+		pthread_mutex_unlock(&job_mutex);
+
+		slot = &slots[seq % slot_count];
+		input = read_block(entry, block, uncompressed);
+		if (opt_holes && is_zero (uncompressed, input))
+			len = 0;
+		else {
+			long long fmk_start;
+
+			FMK_STAGE_BEGIN(compress_block, fmk_start);
+			if (dictionary)
+				err = compress_dict(&stream, slot->data, &len, uncompressed, input);
+			else
+				err = zbuf_compress(slot->data, &len, uncompressed, input, Z_BEST_COMPRESSION);
+			FMK_STAGE_END(compress_block, fmk_start, input, len);
+			if (err != Z_OK) {
+				die(MKFS_ERROR, 0, "compression error: %s", zError(err));
+			}
+		}
+
+		pthread_mutex_lock(&job_mutex);
+		slot->len = len;
+		slot->seq = seq;
+		slot->full = 1;
+		pthread_cond_broadcast(&job_cond);
+		pthread_mutex_unlock(&job_mutex);
+	}
+
+	if (dictionary)
+		deflateEnd(&stream);
+	free(uncompressed);
+	return NULL;
 }
 
 /*
@@ -572,47 +1163,74 @@ static int is_zero(char const *begin, unsigned len)
  * so the i'th pointer points to the end of the i'th block
  * (i.e. the start of the (i+1)'th block or past EOF).
  *
+ * The blocks come compressed from the compression threads, so all
+ * that is left is writing them out at offset.
+ *
  * Note that size > 0, as a zero-sized file wouldn't ever
  * have gotten here in the first place.
  */
-static unsigned int do_compress(char *base, unsigned int offset, char const *name, char *uncompressed, unsigned int size)
+static unsigned int do_compress(unsigned int offset, struct entry *entry)
 {
-	unsigned long original_size = size;
+	static unsigned long seq = 0;
+	unsigned long original_size = entry->size;
 	unsigned long original_offset = offset;
 	unsigned long new_size;
-	unsigned long blocks = (size - 1) / blksize + 1;
+	unsigned long blocks = (entry->size - 1) / blksize + 1;
 	unsigned long curr = offset + 4 * blocks;
+	unsigned long i, pad;
+	u32 *pointers, crc;
 	int change;
+	long long fmk_start;
 
+	FMK_STAGE_BEGIN(write_file, fmk_start);
+	pointers = malloc(4 * blocks);
+	if (!pointers) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
 	total_blocks += blocks;
 
-	do {
-		unsigned long len = 2 * blksize;
-		unsigned int input = size;
-		int err;
+	/* the pointers are patched in once the blocks are out */
+	write_out(NULL, 4 * blocks);
+	crc = crc32(0L, Z_NULL, 0);
+	for (i = 0; i < blocks; i++, seq++) {
+		struct slot *slot = &slots[seq % slot_count];
+
+		pthread_mutex_lock(&job_mutex);
+		while (!slot->full || slot->seq != seq)
+			pthread_cond_wait(&job_cond, &job_mutex);
+		pthread_mutex_unlock(&job_mutex);
+
+		write_out(slot->data, slot->len);
+		crc = crc32(crc, (unsigned char *) slot->data, slot->len);
+		curr += slot->len;
+		pointers[i] = curr;
+
+		pthread_mutex_lock(&job_mutex);
+		slot->full = 0;
+		written_seq++;
+		pthread_cond_broadcast(&job_cond);
+		pthread_mutex_unlock(&job_mutex);
+	}
+	if (entry->path)
+		close(entry->fd);
 
-		if (input > blksize)
-			input = blksize;
-		size -= input;
-		if (!(opt_holes && is_zero (uncompressed, input))) {
-			err = compress2(base + curr, &len, uncompressed, input, Z_BEST_COMPRESSION);
-			if (err != Z_OK) {
-				die(MKFS_ERROR, 0, "compression error: %s", zError(err));
-			}
-			curr += len;
-		}
-		uncompressed += input;
+	pad = ((curr + 3) & ~3) - curr;
+	write_out(NULL, pad);
+	crc = crc32_zeros(crc, pad);
+	curr += pad;
 
-		if (len > blksize*2) {
-			/* (I don't think this can happen with zlib.) */
-			die(MKFS_ERROR, 0, "AIEEE: block \"compressed\" to > 2*blocklength (%ld)", len);
-		}
+	if (opt_swap) {
+		for (i = 0; i < blocks; i++)
+			pointers[i] = bswap_32(pointers[i]);
+	}
 
-		*(u32 *) (base + offset) = curr;
-		offset += 4;
-	} while (size);
+	/* the file's checksum is that of its pointers, then its blocks */
+	patch_out(offset, (char *) pointers, 4 * blocks);
+	crc = crc32_combine(crc32(crc32(0L, Z_NULL, 0), (unsigned char *) pointers, 4 * blocks),
+			    crc, curr - offset - 4 * blocks);
+	data_crc = crc32_combine(data_crc, crc, curr - offset);
+	free(pointers);
 
-	curr = (curr + 3) & ~3;
 	new_size = curr - original_offset;
 	/* TODO: Arguably, original_size in these 2 lines should be
 	   st_blocks * 512.  But if you say that then perhaps
@@ -620,38 +1238,44 @@ static unsigned int do_compress(char *base, unsigned int offset, char const *nam
 	change = new_size - original_size;
 	if (opt_verbose > 1) {
 		printf("%6.2f%% (%+d bytes)\t%s\n",
-		       (change * 100) / (double) original_size, change, name);
+		       (change * 100) / (double) original_size, change, entry->name);
 	}
+	FMK_STAGE_END(write_file, fmk_start, original_size, new_size);
 
 	return curr;
 }
 
 
-/*
- * Traverse the entry tree, writing data for every item that has
- * non-null entry->path (i.e. every non-empty regfile) and non-null
- * entry->uncompressed (i.e. every symlink).
- */
-static unsigned int write_data(struct entry *entry, char *base, unsigned int offset)
+/* Point the files that share another's data (entry->same) at it. */
+static void set_shared_offsets(struct entry *entry, char *base)
 {
 	do {
-		if (entry->path || entry->uncompressed) {
-			if (entry->same) {
-				set_data_offset(entry, base, entry->same->offset);
-				entry->offset = entry->same->offset;
-			}
-			else {
-				set_data_offset(entry, base, offset);
-				entry->offset = offset;
-				map_entry(entry);
-				offset = do_compress(base, offset, entry->name, entry->uncompressed, entry->size);
-				unmap_entry(entry);
-			}
+		if (entry->same) {
+			set_data_offset(entry, base, entry->same->offset);
+			entry->offset = entry->same->offset;
 		}
 		else if (entry->child)
-			offset = write_data(entry->child, base, offset);
-		entry=entry->next;
+			set_shared_offsets(entry->child, base);
+		entry = entry->next;
 	} while (entry);
+}
+
+/*
+ * Write the data of every job, i.e. every non-empty regfile and every
+ * symlink that doesn't share another's, in the order of the jobs.
+ */
+static unsigned int write_data(struct entry *root, char *base, unsigned int offset)
+{
+	int i;
+
+	for (i = 0; i < job_count; i++) {
+		struct entry *entry = jobs[i];
+
+		set_data_offset(entry, base, offset);
+		entry->offset = offset;
+		offset = do_compress(offset, entry);
+	}
+	set_shared_offsets(root, base);
 	return offset;
 }
 
@@ -684,7 +1308,7 @@ int main(int argc, char **argv)
 	struct stat st;		/* used twice... */
 	struct entry *root_entry;
 	char *rom_image;
-	ssize_t offset, written;
+	ssize_t offset, written, header_length, dir_start;
 	int fd;
 	/* initial guess (upper-bound) of required filesystem size */
 	loff_t fslen_ub = sizeof(struct cramfs_super);
@@ -692,17 +1316,35 @@ int main(int argc, char **argv)
 	u32 crc;
 	int c;			/* for getopt */
 	char *ep;		/* for strtoul */
+	pthread_t *threads;
+	int i;
+	long long fmk_start;
 
 	total_blocks = 0;
 
 	if (argc)
 		progname = argv[0];
+	fmk_stats_init("mkcramfs");
 
 	/* command line options */
-	while ((c = getopt(argc, argv, "hEe:i:n:psvz")) != EOF) {
+	while ((c = getopt(argc, argv, "hBb:D:Ee:i:n:pS:st:vz")) != EOF) {
 		switch (c) {
 		case 'h':
 			usage(MKFS_OK);
+		case 'B':
+			opt_swap = !CRAMFS_HOST_BIG_ENDIAN;
+			break;
+		case 'b':
+			errno = 0;
+			blksize = strtoul(optarg, &ep, 10);
+			if (errno || optarg[0] == '\0' || *ep != '\0' ||
+			    blksize < PAGE_CACHE_SIZE || blksize > MAX_BLKSIZE ||
+			    (blksize & (blksize - 1)))
+				usage(MKFS_USAGE);
+			break;
+		case 'D':
+			read_dictionary(optarg);
+			break;
 		case 'E':
 			opt_errors = 1;
 			break;
@@ -727,9 +1369,18 @@ int main(int argc, char **argv)
 			opt_pad = PAD_SIZE;
 			fslen_ub += PAD_SIZE;
 			break;
+		case 'S':
+			opt_sort = optarg;
+			break;
 		case 's':
 			/* old option, ignored */
 			break;
+		case 't':
+			errno = 0;
+			opt_threads = strtoul(optarg, &ep, 10);
+			if (errno || optarg[0] == '\0' || *ep != '\0' || opt_threads < 1)
+				usage(MKFS_USAGE);
+			break;
 		case 'v':
 			opt_verbose++;
 			break;
@@ -760,10 +1411,11 @@ int main(int argc, char **argv)
 	root_entry->uid = st.st_uid;
 	root_entry->gid = st.st_gid;
 
+	FMK_STAGE_BEGIN(scan, fmk_start);
 	root_entry->size = parse_directory(root_entry, dirname, &root_entry->child, &fslen_ub);
+	FMK_STAGE_END(scan, fmk_start, 0, 0);
 
-	/* always allocate a multiple of blksize bytes because that's
-	   what we're going to write later on */
+	/* we always write a multiple of blksize bytes */
 	fslen_ub = ((fslen_ub - 1) | (blksize - 1)) + 1;
 
 	if (fslen_ub > MAXFSLEN) {
@@ -771,31 +1423,26 @@ int main(int argc, char **argv)
 			"warning: estimate of required size (upper bound) is %LdMB, but maximum image size is %uMB, we might die prematurely\n",
 			fslen_ub >> 20,
 			MAXFSLEN >> 20);
-		fslen_ub = MAXFSLEN;
 	}
 
-	/* find duplicate files. TODO: uses the most inefficient algorithm
-	   possible. */
-	eliminate_doubles(root_entry, root_entry);
+	if (opt_sort) {
+		read_sort_file(opt_sort, dirname);
+		sort_entries(root_entry);
+	}
 
-	/* TODO: Why do we use a private/anonymous mapping here
-	   followed by a write below, instead of just a shared mapping
-	   and a couple of ftruncate calls?  Is it just to save us
-	   having to deal with removing the file afterwards?  If we
-	   really need this huge anonymous mapping, we ought to mmap
-	   in smaller chunks, so that the user doesn't need nn MB of
-	   RAM free.  If the reason is to be able to write to
-	   un-mmappable block devices, then we could try shared mmap
-	   and revert to anonymous mmap if the shared mmap fails. */
-	rom_image = mmap(NULL, fslen_ub?fslen_ub:1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	/* find duplicate files */
+	eliminate_doubles(root_entry);
 
-	if (rom_image == MAP_FAILED) {
-		die(MKFS_ERROR, 1, "mmap failed");
+	/* Only the part of the image up to the file data is kept in
+	   memory, the data is streamed to the output file after it. */
+	rom_image = calloc(1, opt_pad + sizeof(struct cramfs_super) + image_length + 3 + dir_size);
+	out_buf = malloc(OUT_BUF_SIZE);
+	if (!rom_image || !out_buf) {
+		die(MKFS_ERROR, 1, "malloc failed");
 	}
 
 	/* Skip the first opt_pad bytes for boot loader code */
 	offset = opt_pad;
-	memset(rom_image, 0x00, opt_pad);
 
 	/* Skip the superblock and come back to write it later. */
 	offset += sizeof(struct cramfs_super);
@@ -806,38 +1453,77 @@ int main(int argc, char **argv)
 		offset = write_file(opt_image, rom_image, offset);
 	}
 
+	dir_start = offset;
 	offset = write_directory_structure(root_entry->child, rom_image, offset);
 	printf("Directory data: %d bytes\n", offset);
+	if (opt_verbose) {
+		if (dictionary)
+			printf("Compressor: zlib %s, for the preset dictionary\n", zlibVersion());
+		else
+			printf("Compressor: %s\n", zbuf_backend());
+	}
+	header_length = offset;
+
+	/* Compress the files ahead of write_data laying them out. */
+	queue_jobs(root_entry);
+	if (opt_sort)
+		sort_jobs();
+	if (opt_threads == 0)
+		opt_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (opt_threads < 1)
+		opt_threads = 1;
+	slot_count = 4 * opt_threads;
+	threads = malloc(opt_threads * sizeof(pthread_t));
+	slots = calloc(slot_count, sizeof(struct slot));
+	if (!threads || !slots) {
+		die(MKFS_ERROR, 1, "malloc failed");
+	}
+	for (i = 0; i < slot_count; i++) {
+		slots[i].data = malloc(2 * blksize);
+		if (!slots[i].data) {
+			die(MKFS_ERROR, 1, "malloc failed");
+		}
+	}
+	for (i = 0; i < opt_threads; i++) {
+		if (pthread_create(&threads[i], NULL, compress_thread, NULL) != 0) {
+			die(MKFS_ERROR, 0, "failed to create thread");
+		}
+	}
 
+	out_fd = fd;
+	out_start = offset;
+	data_crc = crc32(0L, Z_NULL, 0);
 	offset = write_data(root_entry, rom_image, offset);
 
-	/* We always write a multiple of blksize bytes, so that
+	for (i = 0; i < opt_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	/* We always write a multiple of PAGE_CACHE_SIZE bytes, so that
 	   losetup works. */
-	offset = ((offset - 1) | (blksize - 1)) + 1;
+	written = ((offset - 1) | (PAGE_CACHE_SIZE - 1)) + 1;
+	write_out(NULL, written - offset);
+	data_crc = crc32_zeros(data_crc, written - offset);
+	flush_out();
+	offset = written;
 	printf("Everything: %d kilobytes\n", offset >> 10);
 
 	/* Write the superblock now that we can fill in all of the fields. */
 	write_superblock(root_entry, rom_image+opt_pad, offset);
 	printf("Super block: %d bytes\n", sizeof(struct cramfs_super));
+	if (opt_swap)
+		swap_header(rom_image+opt_pad, dir_start-opt_pad, header_length-opt_pad);
 
 	/* Put the checksum in. */
+	FMK_STAGE_BEGIN(checksum, fmk_start);
 	crc = crc32(0L, Z_NULL, 0);
-	crc = crc32(crc, (rom_image+opt_pad), (offset-opt_pad));
-	((struct cramfs_super *) (rom_image+opt_pad))->fsid.crc = crc;
+	crc = crc32(crc, (rom_image+opt_pad), (header_length-opt_pad));
+	crc = crc32_combine(crc, data_crc, offset - header_length);
+	FMK_STAGE_END(checksum, fmk_start, header_length - opt_pad, 4);
+	((struct cramfs_super *) (rom_image+opt_pad))->fsid.crc = opt_swap ? bswap_32(crc) : crc;
 	printf("CRC: %x\n", crc);
 
-	/* Check to make sure we allocated enough space. */
-	if (fslen_ub < offset) {
-		die(MKFS_ERROR, 0, "not enough space allocated for ROM image (%Ld allocated, %d used)", fslen_ub, offset);
-	}
-
-	written = write(fd, rom_image, offset);
-	if (written < 0) {
-		die(MKFS_ERROR, 1, "write failed");
-	}
-	if (offset != written) {
-		die(MKFS_ERROR, 0, "ROM image write failed (wrote %d of %d bytes)", written, offset);
-	}
+	pwrite_all(rom_image, header_length, 0);
 
 	/* (These warnings used to come at the start, but they scroll off the
 	   screen too quickly.) */
@@ -18,26 +18,109 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "../fmkpool/fmkpool.h"
 
-#define BUFFERSIZE	16384
-#define MAXFILES	4096
 #define BLKSIZE		4096	/* Should this be a command line option? */
+#define JOBBYTES	262144	/* data copied by one task, at least */
+
+
+/* A run of stored files, whose block pointers one task swaps and whose
+   data it copies, from the mapped input image to the mapped output */
+struct swapjob
+{
+  unsigned int		first, last;		/* into the sorted files */
+};
+
+struct storedfile
+{
+  uint32_t		offset;			/* in words */
+  uint32_t		nblocks;
+  uint32_t		end;			/* in bytes, word aligned */
+};
+
+static const unsigned char	*image_in;
+static unsigned char		*image_out;
+static struct storedfile	*stored;
+
+
+/* Byte swaps n words, 16 bytes at a time as GCC vectors. With SSSE3 or
+   NEON that is one byte shuffle, pshufb or rev32, without it the shifts
+   and masks of SSE2. in and out needn't be aligned */
+typedef uint32_t swap_vec __attribute__((vector_size(16), aligned(1),
+                                         may_alias));
+typedef unsigned char swap_bytes __attribute__((vector_size(16)));
+
+static inline swap_vec swap_vector(swap_vec v)
+{
+#if defined(__SSSE3__) || defined(__ARM_NEON)
+  static const swap_bytes	mask = { 3, 2, 1, 0, 7, 6, 5, 4,
+                                         11, 10, 9, 8, 15, 14, 13, 12 };
+
+  return (swap_vec)__builtin_shuffle((swap_bytes)v, mask);
+#else
+  return (v << 24) | ((v << 8) & 0xFF0000) | ((v >> 8) & 0xFF00) | (v >> 24);
+#endif
+}
+
+static void swap_words(unsigned char *out, const unsigned char *in,
+                       unsigned int n)
+{
+  uint32_t		word;
+  unsigned int		x;
+
+  for ( x=0; x+4<=n; x+=4 )
+    *(swap_vec *)(out+x*4) = swap_vector(*(const swap_vec *)(in+x*4));
+
+  for ( ; x<n; x++ )
+  {
+    memcpy(&word, in+x*4, 4);
+    word = bswap_32(word);
+    memcpy(out+x*4, &word, 4);
+  }
+}
+
+
+static void swap_files(void *arg)
+{
+  const struct swapjob	*job = arg;
+  unsigned int		x;
+
+  for ( x=job->first; x<=job->last; x++ )
+  {
+    size_t start = (size_t)stored[x].offset<<2,
+           data  = start + ((size_t)stored[x].nblocks<<2);
+
+    swap_words(image_out+start, image_in+start, stored[x].nblocks);
+    memcpy(image_out+data, image_in+data, stored[x].end-data);
+  }
+}
+
+
+static int compare_stored(const void *a, const void *b)
+{
+  const struct storedfile *x = a, *y = b;
+
+  return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
 
 
 int main(int argc, char *argv[])
 {
   uint32_t		superblock_in[16], superblock_out[16], 
-                        flags, blockpointer_in, blockpointer_out,
-                        blockpointer_last, crc, *mapping;
+                        flags, blockpointer_last, crc, *mapping;
   uint16_t		endiantest;
   uint8_t	        inode_in[12], inode_out[12];
   struct cramfs_inode	inode;
-  unsigned int		filecnt, file, filepos, remaining, nblocks,
-                        copybytes, readbytes, x;
-  unsigned int 		*fileoffset, *filesize;
-  unsigned char		buffer[BUFFERSIZE], is_hostorder, host_is_le, file_is_le;
+  unsigned int		filecnt, file, filepos, nstored, nunique, njobs,
+                        jobbytes, x;
+  unsigned char		is_hostorder, host_is_le, file_is_le;
   int			infile, outfile;
-  int			size;
+  size_t		size;
+  struct stat		st;
+  struct swapjob	*jobs;
+  struct fmk_pool_group	group;
 
   
   if ( argc != 3 )
@@ -57,12 +140,40 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
-  if ( read(infile, &superblock_in, sizeof(superblock_in)) != sizeof(superblock_in) )
+  /* Work on mappings of both images, the output is the size of the input */
+  if ( fstat(infile, &st) < 0 )
+  {
+    perror("while trying to stat binary input file");
+    exit(1);
+  }
+  size = st.st_size;
+  if ( size < sizeof(superblock_in) || size > UINT32_MAX )
+  {
+    fprintf(stderr, "Error: %s is too small or too large for a cramfs image\n",
+            argv[1]);
+    exit(1);
+  }
+  image_in = mmap(NULL, size, PROT_READ, MAP_PRIVATE, infile, 0);
+  if ( image_in == MAP_FAILED )
+  {
+    perror("while trying to map binary input file");
+    exit(1);
+  }
+  madvise((void *)image_in, size, MADV_SEQUENTIAL);
+  if ( ftruncate(outfile, size) < 0 )
+  {
+    perror("while trying to size image output file");
+    exit(1);
+  }
+  image_out = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, outfile, 0);
+  if ( image_out == MAP_FAILED )
   {
-    perror("while trying to read superblock");
+    perror("while trying to map image output file");
     exit(1);
   }
 
+  memcpy(superblock_in, image_in, sizeof(superblock_in));
+
   /* Detect endianness of host */
   endiantest = 1;
   if ( ((uint8_t *)&endiantest)[0] == 1 )
@@ -109,7 +220,7 @@ int main(int argc, char *argv[])
   superblock_out[13] =          superblock_in[13] ;     /* Name 2/4 */
   superblock_out[14] =          superblock_in[14] ;     /* Name 3/4 */
   superblock_out[15] =          superblock_in[15] ;     /* Name 4/4 */
-  write(outfile, &superblock_out, sizeof(superblock_out));
+  memcpy(image_out, superblock_out, sizeof(superblock_out));
 
 
   /* Check Flags */
@@ -154,16 +265,9 @@ int main(int argc, char *argv[])
     filecnt = superblock_out[11];
   printf("Filesystem contains %d files.\n", filecnt-1);
 
-  fileoffset = (unsigned int*)malloc( filecnt * sizeof( *fileoffset ));
-  if( fileoffset == NULL ){
-      perror("fileoffset malloc error");
-      exit(1);
-  }
-
-  filesize = (unsigned int*)malloc( filecnt * sizeof( *filesize ));
-  if( filesize == NULL ){
-      free( fileoffset ); fileoffset = NULL;
-      perror("filesize malloc error");
+  stored = malloc( filecnt * sizeof( *stored ));
+  if( stored == NULL ){
+      perror("stored file malloc error");
       exit(1);
   }
 
@@ -171,17 +275,17 @@ int main(int argc, char *argv[])
   filepos = 16;
 
   /* Initialise the counter for the "real" (stored) files */
-  remaining = 0;
+  nstored = 0;
 
-  /* Read directory entries (first one is the root inode) */
+  /* Swap the directory entries (first one is the root inode) */
   for ( file=0; file<filecnt; file++ )
   {
-    /* Read and swap file inode */
-    if ( read(infile, &inode_in, sizeof(inode_in)) != sizeof(inode_in) )
+    if ( ((size_t)filepos<<2) + sizeof(inode_in) > size )
     {
-      perror("while trying to read directory entry");
+      fprintf(stderr, "Error: Image ends inside the directory entries\n");
       exit(1);
     }
+    memcpy(inode_in, image_in+((size_t)filepos<<2), sizeof(inode_in));
 
     /* Swap the inode. */
 
@@ -239,122 +343,115 @@ int main(int argc, char *argv[])
     }
 
     /* write the converted inode */
-    write(outfile, &inode_out, sizeof(inode_out));
+    memcpy(image_out+((size_t)filepos<<2), inode_out, sizeof(inode_out));
 
     /* Copy filename */
-    if ( read(infile, &buffer, inode.namelen<<2) != inode.namelen<<2 )
+    if ( ((size_t)(filepos+3+inode.namelen)<<2) > size )
     {
-      perror("while trying to read filename");
+      fprintf(stderr, "Error: Image ends inside a filename\n");
       exit(1);
     }
-    write(outfile, &buffer, inode.namelen<<2);
-
-    /* Store the file size and file offset */
-    filesize  [file] = inode.size;
-    fileoffset[file] = inode.offset;
-
-    /* filepos is increased by namelen words + 3 words for the inode */
-    filepos += inode.namelen + 3;
+    memcpy(image_out+((size_t)(filepos+3)<<2),
+           image_in+((size_t)(filepos+3)<<2), inode.namelen<<2);
 
     /* Has this entry a data chunk? */
-    if ( ( S_ISREG(inode.mode) || S_ISLNK(inode.mode) ) && inode.size > 0 )
+    if ( file && ( S_ISREG(inode.mode) || S_ISLNK(inode.mode) ) && inode.size > 0 )
     {
-      remaining++;
+      stored[nstored].offset  = inode.offset;
+      stored[nstored].nblocks = (inode.size-1)/BLKSIZE + 1;
+      nstored++;
     }
-    
+
+    /* filepos is increased by namelen words + 3 words for the inode */
+    filepos += inode.namelen + 3;
   }
 
   
-  /* Now process the individual files data. Because cramfs will share the compressed
-     data for two identical input files, we do this by starting at the begin of the
-     data, identifiying the accompanying file, process the file data, and move to
-     the next until no file is left                                                */
-  while ( remaining )
+  /* Now process the individual files data. Because cramfs will share the
+     compressed data for two identical input files, the files are taken in
+     the order of their data, those sharing it once, and each must start
+     where the one before ended. That already checks the whole layout, so
+     the pointers and data of runs of files are then swapped and copied by
+     the threads in any order                                               */
+  qsort(stored, nstored, sizeof(*stored), compare_stored);
+  nunique = 0;
+  for ( x=0; x<nstored; x++ )
   {
-    /* Find the file */
-    for ( file=1; fileoffset[file]!=filepos&&file<filecnt; file++ );
-    if ( fileoffset[file]!=filepos ) 
+    if ( nunique && stored[x].offset == stored[nunique-1].offset )
+      continue;
+    if ( stored[x].offset != filepos )
     {
       /* Not found */
       fprintf(stderr, "Did not find the file which starts at word %x, aborting...\n", filepos);
       exit(1);
     }
-
-    /* Reduce file counter for each file which starts here (as said, can be more
-       than one if the cramfs had identical input files) */
-    for ( x=1; x<filecnt; x++ )
-      if ( fileoffset[x] == filepos )
-        remaining--;
-
-    /* Number of blocks of this file */
-    nblocks = (filesize[file]-1)/BLKSIZE + 1;
-
-    /* Swap the blockpointer */
-    for ( x=0; x<nblocks; x++ )
+    if ( ((size_t)(filepos+stored[x].nblocks)<<2) > size )
     {
-      if ( read(infile, &blockpointer_in, 4) != 4 )
-      {
-        perror("while trying to read blockpointer");
-        exit(1);
-      }
-
-      blockpointer_out = bswap_32(blockpointer_in);
-      write(outfile, &blockpointer_out, 4);
-
-      filepos++;
+      fprintf(stderr, "Error: Image ends inside the blockpointers at word %x\n", filepos);
+      exit(1);
     }
-    
+
     /* Last blockpointer points to the byte after the end 
        of the file */
-    if ( is_hostorder )
-      blockpointer_last = blockpointer_in;
-    else
-      blockpointer_last = blockpointer_out;
+    memcpy(&blockpointer_last,
+           image_in+((size_t)(filepos+stored[x].nblocks-1)<<2), 4);
+    if ( !is_hostorder )
+      blockpointer_last = bswap_32(blockpointer_last);
 
     /* Align to a word boundary */
     blockpointer_last += (4-(blockpointer_last%4))%4;
-
-    /* Copy the file data */
-    copybytes = blockpointer_last-(filepos<<2);
-    while (copybytes>0)
+    if ( blockpointer_last < ((size_t)(filepos+stored[x].nblocks)<<2) ||
+         blockpointer_last > size )
     {
-      readbytes = (copybytes>BUFFERSIZE) ? BUFFERSIZE : copybytes;
-      
-      if ( read(infile, &buffer, readbytes) != readbytes )
-      {
-        perror("while trying to read file data");
-        exit(1);
-      }
-      write(outfile, &buffer, readbytes);
-      
-      copybytes -= readbytes;
+      fprintf(stderr, "Error: Data of the file at word %x is outside the image\n", filepos);
+      exit(1);
     }
 
+    stored[x].end = blockpointer_last;
+    stored[nunique++] = stored[x];
+
     /* Set new filepos */
     filepos = (blockpointer_last)>>2;
-  }  
+  }
 
   /* Copy the remaining data (padding) */
-  do
-  {
-    readbytes = read(infile, &buffer, BUFFERSIZE);
-    write(outfile, &buffer, readbytes);
-  } while ( readbytes>0 );
+  memcpy(image_out+((size_t)filepos<<2), image_in+((size_t)filepos<<2),
+         size-((size_t)filepos<<2));
 
-  /* recalculate the crc */
-  size = lseek(outfile, 0, SEEK_CUR); /* should not fail */
-  mapping = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, outfile, 0);
-  if (mapping != MAP_FAILED) {
-    crc = crc32(0L, Z_NULL, 0);
-    mapping[8] = is_hostorder?bswap_32(crc):crc;
-    crc = crc32(crc, (unsigned char *)mapping, size);
-    printf("CRC: 0x%08x\n", crc);
-    mapping[8] = is_hostorder?bswap_32(crc):crc;
-    munmap(mapping, size);
+  /* Split the files into runs of JOBBYTES or more */
+  jobs = malloc( (nunique+1) * sizeof( *jobs ));
+  if( jobs == NULL ){
+      perror("job malloc error");
+      exit(1);
   }
-  else {
-    perror("mapping failed");
+  njobs = 0;
+  jobbytes = 0;
+  for ( x=0; x<nunique; x++ )
+  {
+    if ( jobbytes == 0 )
+      jobs[njobs].first = x;
+    jobbytes += stored[x].end - (stored[x].offset<<2);
+    if ( jobbytes >= JOBBYTES || x == nunique-1 )
+    {
+      jobs[njobs++].last = x;
+      jobbytes = 0;
+    }
   }
+
+  fmk_pool_group_init(&group, fmk_pool_get(0));
+  for ( x=0; x<njobs; x++ )
+    fmk_pool_submit(&group, swap_files, &jobs[x], FMK_POOL_NORMAL);
+  fmk_pool_wait(&group, 0);
+
+  /* recalculate the crc */
+  mapping = (uint32_t *)image_out;
+  crc = crc32(0L, Z_NULL, 0);
+  mapping[8] = is_hostorder?bswap_32(crc):crc;
+  crc = crc32(crc, image_out, size);
+  printf("CRC: 0x%08x\n", crc);
+  mapping[8] = is_hostorder?bswap_32(crc):crc;
+  munmap(image_out, size);
+  munmap((void *)image_in, size);
   
   /* Done! */
   close(infile);
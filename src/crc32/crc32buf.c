@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * crc32buf.c
+ *
+ * CRC-32 shared by the firmware header tools.  Buffers are checksummed
+ * sixteen bytes at a time with slicing tables, or, where the CPU has
+ * them, with carry-less multiplies (x86 PCLMULQDQ) or the ARMv8 CRC32
+ * instructions, picked at the first call.
+ */
+
+#include <stdint.h>
+
+#include "crc32buf.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_PCLMUL
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__AARCH64EL__) && \
+	defined(__linux__)
+#define CRC32_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+static uint32_t crc_table[16][256];
+
+static uint32_t crc32_dispatch(uint32_t crc, const unsigned char *buf,
+	size_t len);
+static uint32_t (*crc32_impl)(uint32_t, const unsigned char *, size_t) =
+	crc32_dispatch;
+
+
+static void crc32_init_table(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for(i = 0; i < 256; i++) {
+		crc = i;
+		for(j = 0; j < 8; j++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+		crc_table[0][i] = crc;
+	}
+
+	/* crc_table[j][i] is byte i followed by j zero bytes */
+	for(j = 1; j < 16; j++)
+		for(i = 0; i < 256; i++)
+			crc_table[j][i] = (crc_table[j - 1][i] >> 8) ^
+				crc_table[0][crc_table[j - 1][i] & 0xff];
+}
+
+
+static uint32_t crc32_slice16(uint32_t crc, const unsigned char *buf,
+	size_t len)
+{
+	for(; len >= 16; len -= 16, buf += 16) {
+		crc ^= buf[0] | buf[1] << 8 | buf[2] << 16 |
+			(uint32_t) buf[3] << 24;
+		crc = crc_table[15][crc & 0xff] ^
+			crc_table[14][(crc >> 8) & 0xff] ^
+			crc_table[13][(crc >> 16) & 0xff] ^
+			crc_table[12][crc >> 24] ^
+			crc_table[11][buf[4]] ^ crc_table[10][buf[5]] ^
+			crc_table[9][buf[6]] ^ crc_table[8][buf[7]] ^
+			crc_table[7][buf[8]] ^ crc_table[6][buf[9]] ^
+			crc_table[5][buf[10]] ^ crc_table[4][buf[11]] ^
+			crc_table[3][buf[12]] ^ crc_table[2][buf[13]] ^
+			crc_table[1][buf[14]] ^ crc_table[0][buf[15]];
+	}
+
+	for(; len; len--, buf++)
+		crc = crc_table[0][(crc ^ *buf) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+
+#ifdef CRC32_PCLMUL
+/*
+ * Fold 64 bytes at a time with carry-less multiplies by x^n mod P, then
+ * Barrett reduce the last 128 bits, after Intel's "Fast CRC Computation
+ * for Generic Polynomials Using PCLMULQDQ Instruction".  len is a
+ * multiple of 16, and at least 64
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_fold(uint32_t crc, const unsigned char *buf,
+	size_t len)
+{
+	static const uint64_t __attribute__((aligned(16)))
+		k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL },
+		k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL },
+		k5k0[] = { 0x0163cd6124ULL, 0 },
+		poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i *) buf);
+	x2 = _mm_loadu_si128((const __m128i *) (buf + 16));
+	x3 = _mm_loadu_si128((const __m128i *) (buf + 32));
+	x4 = _mm_loadu_si128((const __m128i *) (buf + 48));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((const __m128i *) k1k2);
+	buf += 64;
+	len -= 64;
+
+	for(; len >= 64; len -= 64, buf += 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+			_mm_loadu_si128((const __m128i *) buf));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+			_mm_loadu_si128((const __m128i *) (buf + 16)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+			_mm_loadu_si128((const __m128i *) (buf + 32)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+			_mm_loadu_si128((const __m128i *) (buf + 48)));
+	}
+
+	/* fold the four lanes into one */
+	x0 = _mm_load_si128((const __m128i *) k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	for(; len >= 16; len -= 16, buf += 16) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+			_mm_loadu_si128((const __m128i *) buf));
+	}
+
+	/* 128 bits to 64 */
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x00), x2);
+
+	/* Barrett reduction to 32 bits */
+	x0 = _mm_load_si128((const __m128i *) poly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
+}
+
+
+static uint32_t crc32_pclmul(uint32_t crc, const unsigned char *buf,
+	size_t len)
+{
+	if(len >= 64) {
+		size_t n = len & ~(size_t) 15;
+
+		crc = crc32_fold(crc, buf, n);
+		buf += n;
+		len -= n;
+	}
+
+	return crc32_slice16(crc, buf, len);
+}
+#endif
+
+
+#ifdef CRC32_ARMV8
+__attribute__((target("+crc")))
+static uint32_t crc32_armv8(uint32_t crc, const unsigned char *buf,
+	size_t len)
+{
+	for(; len && ((uintptr_t) buf & 7); len--, buf++)
+		crc = __crc32b(crc, *buf);
+
+	for(; len >= 8; len -= 8, buf += 8)
+		crc = __crc32d(crc, *(const uint64_t *) buf);
+
+	for(; len; len--, buf++)
+		crc = __crc32b(crc, *buf);
+
+	return crc;
+}
+#endif
+
+
+static uint32_t crc32_dispatch(uint32_t crc, const unsigned char *buf,
+	size_t len)
+{
+	crc32_init_table();
+	crc32_impl = crc32_slice16;
+
+#ifdef CRC32_PCLMUL
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+		crc32_impl = crc32_pclmul;
+#endif
+
+#ifdef CRC32_ARMV8
+	if(getauxval(AT_HWCAP) & HWCAP_CRC32)
+		crc32_impl = crc32_armv8;
+#endif
+
+	return crc32_impl(crc, buf, len);
+}
+
+
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len)
+{
+	return crc32_impl(crc, buf, len);
+}
+
+
+uint32_t crc32buf(const void *buf, size_t len)
+{
+	return crc32_impl(0xffffffff, buf, len);
+}
+
+
+/* a * b modulo P, both bit reflected, as in zlib's crc32_combine() */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+	uint32_t m = (uint32_t) 1 << 31, p = 0;
+
+	for(;;) {
+		if(a & m) {
+			p ^= b;
+			if((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ 0xedb88320 : b >> 1;
+	}
+
+	return p;
+}
+
+
+uint32_t crc32_shift(uint32_t crc, uint64_t len)
+{
+	uint32_t x2n = (uint32_t) 1 << 23;	/* x^8, one zero byte */
+	uint32_t p = (uint32_t) 1 << 31;	/* x^0 */
+
+	for(; len; len >>= 1) {
+		if(len & 1)
+			p = crc32_multmodp(x2n, p);
+		x2n = crc32_multmodp(x2n, x2n);
+	}
+
+	return crc32_multmodp(p, crc);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * crc32buf.h
+ */
+
+#ifndef CRC32BUF_H
+#define CRC32BUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC-32 (polynomial 0xedb88320) of the firmware header tools.  crc is
+ * the running register, without the inversions: crc32buf() starts it at
+ * 0xffffffff and returns it as is, which is what trx, the motorola
+ * header and crcalc store.  Callers wanting the zlib value invert it.
+ */
+extern uint32_t crc32_update(uint32_t crc, const void *buf, size_t len);
+extern uint32_t crc32buf(const void *buf, size_t len);
+
+/*
+ * The register after len zero bytes, without reading them.  The register
+ * is linear in its start value, so for data D of length len
+ * crc32_update(crc, D, len) is crc32_shift(crc, len) ^
+ * crc32_update(0, D, len): data can be checksummed before the bytes in
+ * front of it are known.
+ */
+extern uint32_t crc32_shift(uint32_t crc, uint64_t len);
+
+#endif
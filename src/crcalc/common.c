@@ -3,16 +3,94 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <arpa/inet.h>
 #include "common.h"
 #include "patch.h"
+#include "manifest.h"
 
-/* Parse binwalk-style log file for offsets to headers in the target firmware image */
+/* Map a manifest fmk-extract wrote, if file is one; returns NULL otherwise, quietly */
+struct manifest *manifest_map(char *file, size_t *size)
+{
+	struct manifest *m = NULL, head;
+	struct stat _fstat = { 0 };
+	int fd = -1;
+
+	fd = open(file, O_RDONLY);
+	if(fd == -1)
+	{
+		goto end;
+	}
+
+	if(fstat(fd, &_fstat) == -1 || read(fd, &head, sizeof(head)) != sizeof(head) ||
+	   memcmp(head.magic, MANIFEST_MAGIC, MANIFEST_MAGIC_SIZE) != 0)
+	{
+		goto end;
+	}
+
+	if(head.version != MANIFEST_VERSION ||
+	   (size_t) _fstat.st_size < sizeof(head) + (size_t) head.nregions * sizeof(struct manifest_region))
+	{
+		fprintf(stderr, "%s: unsupported or truncated manifest\n", file);
+		goto end;
+	}
+
+	m = mmap(NULL, _fstat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if(m == MAP_FAILED)
+	{
+		perror("mmap");
+		m = NULL;
+	}
+	else
+	{
+		*size = _fstat.st_size;
+	}
+
+end:
+	if(fd != -1) close(fd);
+	return m;
+}
+
+void manifest_unmap(struct manifest *m, size_t size)
+{
+	munmap(m, size);
+}
+
+/* The header offsets of a manifest, and the CRC prefixes saved for them if prefixes isn't NULL */
+static int manifest_headers(struct manifest *m, int offsets[MAX_HEAD_SIZE], struct crc_prefix *prefixes)
+{
+	struct manifest_region *region = MANIFEST_REGIONS(m);
+	uint32_t i = 0;
+	int n = 0;
+
+	for(i=0; i<m->nregions && n<MAX_HEAD_SIZE; i++)
+	{
+		if(region[i].kind != REGION_HEADER || (prefixes && !(region[i].flags & REGION_PREFIX)))
+		{
+			continue;
+		}
+
+		offsets[n] = (int) region[i].offset;
+		if(prefixes)
+		{
+			prefixes[n].len = region[i].prefix_len;
+			prefixes[n].crc = region[i].prefix_crc;
+		}
+		n++;
+	}
+
+	return n;
+}
+
+/* Parse binwalk-style log file, or a manifest, for offsets to headers in the target firmware image */
 int parse_log(char *file, int offsets[MAX_HEAD_SIZE])
 {
 	FILE *fp = NULL;
 	char line[MAX_LINE_SIZE] = { 0 };
+	struct manifest *m = NULL;
+	size_t msize = 0;
 	int n = 0;
 
 	if(file == NULL)
@@ -20,6 +98,11 @@ int parse_log(char *file, int offsets[MAX_HEAD_SIZE])
 		offsets[0] = 0;
 		n = 1;
 	}
+	else if((m = manifest_map(file, &msize)) != NULL)
+	{
+		n = manifest_headers(m, offsets, NULL);
+		manifest_unmap(m, msize);
+	}
 	else
 	{
 		fp = fopen(file, "r");
@@ -54,6 +137,204 @@ int parse_log(char *file, int offsets[MAX_HEAD_SIZE])
 	return n;
 }
 
+/* Read a CRC prefix cache written by write_cache, or the prefixes of a manifest; returns the number of entries */
+int read_cache(char *file, int offsets[MAX_HEAD_SIZE], struct crc_prefix *prefixes)
+{
+	FILE *fp = NULL;
+	char line[MAX_LINE_SIZE] = { 0 };
+	unsigned int len = 0, crc = 0;
+	struct manifest *m = NULL;
+	size_t msize = 0;
+	int n = 0;
+
+	if((m = manifest_map(file, &msize)) != NULL)
+	{
+		n = manifest_headers(m, offsets, prefixes);
+		manifest_unmap(m, msize);
+		return n;
+	}
+
+	fp = fopen(file, "r");
+	if(fp)
+	{
+		while((fgets((char *) &line, MAX_LINE_SIZE, fp) != NULL) && (n < MAX_HEAD_SIZE))
+		{
+			if(sscanf((char *) &line, "%d %u %x", &offsets[n], &len, &crc) == 3)
+			{
+				prefixes[n].len = len;
+				prefixes[n].crc = crc;
+				n++;
+			}
+		}
+
+		fclose(fp);
+	}
+	else
+	{
+		perror(file);
+	}
+
+	return n;
+}
+
+/* Save n CRC prefixes, one "offset length crc" line per header */
+int write_cache(char *file, int offsets[MAX_HEAD_SIZE], struct crc_prefix *prefixes, int n)
+{
+	FILE *fp = NULL;
+	int i = 0, retval = 0;
+
+	fp = fopen(file, "w");
+	if(fp)
+	{
+		for(i=0; i<n; i++)
+		{
+			fprintf(fp, "%d %u 0x%08X\n", offsets[i], prefixes[i].len, prefixes[i].crc);
+		}
+
+		retval = (fclose(fp) == 0);
+	}
+	else
+	{
+		perror(file);
+	}
+
+	return retval;
+}
+
+/* 
+ * Save the CRC prefix of each TRX and uImage header for the bytes before end, which a rebuild copies
+ * over unchanged. A prefix stops at the next header, since that one may yet be patched.
+ */
+int save_prefixes(char *cache, char *buf, size_t size, int offsets[MAX_HEAD_SIZE], int n, size_t end)
+{
+	struct crc_prefix prefixes[MAX_HEAD_SIZE];
+	int saved[MAX_HEAD_SIZE] = { 0 };
+	int i = 0, j = 0, m = 0, ok = 0, offset = 0;
+	size_t stop = 0;
+
+	for(i=0; i<n; i++)
+	{
+		offset = offsets[i];
+
+		if(offset < 0 || (size_t) offset + MIN_FILE_SIZE > size || (size_t) offset >= end)
+		{
+			continue;
+		}
+
+		stop = (end < size) ? end : size;
+		for(j=0; j<n; j++)
+		{
+			if(offsets[j] > offset && (size_t) offsets[j] < stop)
+			{
+				stop = offsets[j];
+			}
+		}
+
+		switch(identify_header(buf + offset))
+		{
+			case TRX:
+				ok = prefix_trx(buf + offset, size - offset, stop - offset, &prefixes[m]);
+				break;
+			case UIMAGE:
+				ok = prefix_uimage(buf + offset, size - offset, stop - offset, &prefixes[m]);
+				break;
+			default:
+				ok = 0;
+				break;
+		}
+
+		if(ok)
+		{
+			saved[m++] = offset;
+		}
+	}
+
+	fprintf(stderr, "Saving %d CRC prefix(es) to %s...\n", m, cache);
+
+	return write_cache(cache, saved, prefixes, m);
+}
+
+/* 
+ * Patch the header at each offset, resuming TRX and uImage CRCs from the prefixes in cache, if any.
+ * Returns 1 if at least one header was patched.
+ */
+int patch_headers(char *buf, size_t size, int offsets[MAX_HEAD_SIZE], int n, char *cache)
+{
+	int cache_offsets[MAX_HEAD_SIZE] = { 0 };
+	struct crc_prefix prefixes[MAX_HEAD_SIZE], *prefix = NULL;
+	int i = 0, j = 0, ok = 0, patched = 0, offset = 0, ncache = 0;
+	char *ptr = NULL;
+	size_t nsize = 0;
+
+	if(cache)
+	{
+		ncache = read_cache(cache, cache_offsets, prefixes);
+	}
+
+	/* 
+	 * Loop through each offset in the integer array, last one first. Later headers are usually
+	 * nested in earlier ones, and an outer checksum has to cover the patched inner header.
+	 */
+	for(i=n-1; i>=0; i--)
+	{
+		ok = 0;
+		offset = offsets[i];
+
+		if(offset < 0 || (size_t) offset + MIN_FILE_SIZE > size)
+		{
+			fprintf(stderr, "Skipping header offset %d, past the end of the file.\n", offset);
+			continue;
+		}
+
+		nsize = size - offset;
+		ptr = (buf + offset);
+
+		/* Resume from the saved CRC of the unchanged bytes, if there is one */
+		prefix = NULL;
+		for(j=0; j<ncache; j++)
+		{
+			if(cache_offsets[j] == offset)
+			{
+				prefix = &prefixes[j];
+			}
+		}
+
+		fprintf(stderr, "Processing header at offset %d...", offset);
+
+		/* Identify and patch the header at each offset */
+		switch(identify_header(ptr))
+		{
+			case TRX:
+				ok = patch_trx(ptr, nsize, prefix);
+				break;
+			case UIMAGE:
+				ok = patch_uimage(ptr, nsize, prefix);
+				break;
+			case DLOB:
+				ok = patch_dlob(ptr, nsize);
+				break;
+			case TPLINK:
+				ok = patch_tplink(ptr, nsize);
+				break;
+			default:
+				fprintf(stderr, "sorry, this file type is not supported.\n");
+				break;
+		}
+
+		if(ok)
+		{
+			patched = 1;
+			fprintf(stderr, "checksum(s) updated OK.\n");
+		}
+		else
+		{
+			fprintf(stderr, "checksum update(s) failed!\n");
+		}
+	}
+
+	return patched;
+}
+
 /* Determine if a string is all white space or not */
 int is_whitespace(char *string)
 {
@@ -71,44 +352,36 @@ int is_whitespace(char *string)
 	return retval;
 }
 
-/* Reads in and returns the contents and size of a given file */
-char *file_read(char *file, size_t *fsize)
+/* Maps a given file, read/write if writable so headers can be patched in place; returns the mapping and its size */
+char *file_map(char *file, size_t *fsize, int writable)
 {
-        int fd = 0;
+        int fd = -1;
         struct stat _fstat = { 0 };
         char *buffer = NULL;
 
-        if(stat(file, &_fstat) == -1)
+        fd = open(file, writable ? O_RDWR : O_RDONLY);
+        if(fd == -1)
         {
                 perror(file);
                 goto end;
         }
 
-        if(_fstat.st_size == 0)
-        {
-                fprintf(stderr, "%s: zero size file\n", file);
-                goto end;
-        }
-
-        fd = open(file,O_RDONLY);
-        if(!fd)
+        if(fstat(fd, &_fstat) == -1)
         {
                 perror(file);
                 goto end;
         }
 
-        buffer = malloc(_fstat.st_size);
-        if(!buffer)
+        if(_fstat.st_size == 0)
         {
-                perror("malloc");
-		goto end;
+                fprintf(stderr, "%s: zero size file\n", file);
+                goto end;
         }
-        memset(buffer, 0 ,_fstat.st_size);
 
-        if(read(fd, buffer, _fstat.st_size) != _fstat.st_size)
+        buffer = mmap(NULL, _fstat.st_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        if(buffer == MAP_FAILED)
         {
-                perror(file);
-                if(buffer) free(buffer);
+                perror("mmap");
                 buffer = NULL;
         }
         else
@@ -117,31 +390,26 @@ char *file_read(char *file, size_t *fsize)
         }
 
 end:
-        if(fd) close(fd);
+        if(fd != -1) close(fd);
         return buffer;
 }
 
-/* Write size bytes from buf to file fname */
-int file_write(char *fname, char *buf, size_t size)
+/* Flushes the patched headers in a mapping from file_map to disk and unmaps it */
+int file_unmap(char *buf, size_t size)
 {
-	FILE *fp = NULL;
 	int retval = 0;
 
-	fp = fopen(fname, "w");
-	if(fp)
+	if(msync(buf, size, MS_SYNC) == 0)
 	{
-		if(fwrite(buf, 1, size, fp) == size)
-		{
-			retval = 1;
-		}
-		
-		fclose(fp);
+		retval = 1;
 	}
 	else
 	{
-		perror("fopen");
+		perror("msync");
 	}
 
+	munmap(buf, size);
+
 	return retval;
 }
 
@@ -165,6 +433,11 @@ enum header_type identify_header(char *buf)
 			retval = DLOB;
 			break;
 		default:
+			/* TP-Link has no magic, just a big endian header version */
+			if(ntohl(*sig) == TPLINK_VERSION)
+			{
+				retval = TPLINK;
+			}
 			break;
 	}
 
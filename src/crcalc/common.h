@@ -1,6 +1,7 @@
 #ifndef _COMMON_H_
 #define _COMMON_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define MIN_FILE_SIZE 4
@@ -17,12 +18,31 @@ enum header_type
 	TRX,
 	UIMAGE,
 	DLOB,
+	TPLINK,
 };
 
+/*
+ * The CRC register over the first len bytes that a header's checksum covers.
+ * crcalc -e saves these for the part of an image that a rebuild leaves alone,
+ * so that patch_trx and patch_uimage only have to checksum the rest.
+ */
+struct crc_prefix {
+	uint32_t len;
+	uint32_t crc;
+};
+
+struct manifest;
+
 int parse_log(char *file, int offsets[MAX_HEAD_SIZE]);
+int read_cache(char *file, int offsets[MAX_HEAD_SIZE], struct crc_prefix *prefixes);
+int write_cache(char *file, int offsets[MAX_HEAD_SIZE], struct crc_prefix *prefixes, int n);
+int save_prefixes(char *cache, char *buf, size_t size, int offsets[MAX_HEAD_SIZE], int n, size_t end);
+int patch_headers(char *buf, size_t size, int offsets[MAX_HEAD_SIZE], int n, char *cache);
 int is_whitespace(char *string);
-char *file_read(char *file, size_t *fsize);
-int file_write(char *fname, char *buf, size_t size);
+char *file_map(char *file, size_t *fsize, int writable);
+int file_unmap(char *buf, size_t size);
 enum header_type identify_header(char *buf);
+struct manifest *manifest_map(char *file, size_t *size);
+void manifest_unmap(struct manifest *m, size_t size);
 
 #endif
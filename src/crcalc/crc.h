@@ -5,5 +5,6 @@
 #include <stdint.h>
 
 uint32_t crc32(char *buf, size_t len);
+uint32_t crc32_continue(uint32_t crc, char *buf, size_t len);
 
 #endif
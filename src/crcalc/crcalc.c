@@ -9,35 +9,72 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include "common.h"
 #include "crcalc.h"
 #include "patch.h"
+#include "../fmkstats/fmkstats.h"
 
 int main(int argc, char *argv[])
 {
-	int retval = EXIT_FAILURE, ok = 0, fail = 1, n = 0, i = 0, offset = 0;
+	int retval = EXIT_FAILURE, fail = 1, n = 0, c = 0;
 	int offsets[MAX_HEAD_SIZE] = { 0 };
-	char *buf = NULL, *ptr = NULL, *fname = NULL, *log = NULL;
-	size_t size = 0, nsize = 0;
+	char *buf = NULL, *fname = NULL, *log = NULL, *cache = NULL;
+	size_t size = 0;
+	long save_end = -1;
+	long long start;
+
+	fmk_stats_init("crcalc");
+
+	while((c = getopt(argc, argv, "c:e:")) != -1)
+	{
+		switch(c)
+		{
+			case 'c':
+				cache = optarg;
+				break;
+			case 'e':
+				save_end = atol(optarg);
+				break;
+			default:
+				fprintf(stderr, USAGE, argv[0]);
+				goto end;
+		}
+	}
 
 	/* Check usage */
-	if(argc < 2 || argv[1][0] == '-')
+	if(optind >= argc || (save_end >= 0 && cache == NULL))
 	{
 		fprintf(stderr, USAGE, argv[0]);
 		goto end;
 	}
 	else
 	{
-		fname = argv[1];
+		fname = argv[optind];
 	
-		if(argc == 3)
+		if(optind+1 < argc)
 		{
-			log = argv[2];
+			log = argv[optind+1];
 		}
 	}
 
-	/* Read in target file */
-	buf = file_read(fname, &size);
+	/* Map in target file; headers are patched in place, unless only the CRC prefixes are saved */
+	buf = file_map(fname, &size, (save_end < 0));
+
+	if(buf && save_end >= 0)
+	{
+		n = parse_log(log, offsets);
+
+		FMK_STAGE_BEGIN(checksum, start);
+		if(size > MIN_FILE_SIZE && save_prefixes(cache, buf, size, offsets, n, save_end))
+		{
+			retval = EXIT_SUCCESS;
+		}
+		FMK_STAGE_END(checksum, start, size, n);
+
+		munmap(buf, size);
+		goto end;
+	}
 
 	if(buf && size > MIN_FILE_SIZE)
 	{
@@ -46,64 +83,30 @@ int main(int argc, char *argv[])
 
 		fprintf(stderr, "Processing %d header(s) from %s...\n", n, fname);
 
-		/* Loop through each offset in the integer array */
-		for(i=0; i<n; i++)
-		{
-			ok = 0;
-			offset = offsets[i];
-			nsize = size - offset;
-			ptr = (buf + offset);
-
-			fprintf(stderr, "Processing header at offset %d...", offset);
-
-			/* Identify and patch the header at each offset */
-			switch(identify_header(ptr))
-			{
-				case TRX:
-					ok = patch_trx(ptr, nsize);
-					break;
-				case UIMAGE:
-					ok = patch_uimage(ptr, nsize);
-					break;
-				case DLOB:
-					ok = patch_dlob(ptr, nsize);
-					break;
-				default:
-					fprintf(stderr, "sorry, this file type is not supported.\n");
-					break;
-			}
-
-			if(ok)
-			{
-				fail = 0;
-				fprintf(stderr, "checksum(s) updated OK.\n");
-			}
-			else
-			{
-				fprintf(stderr, "checksum update(s) failed!\n");
-			}
-		}
+		FMK_STAGE_BEGIN(checksum, start);
+		fail = !patch_headers(buf, size, offsets, n, cache);
+		FMK_STAGE_END(checksum, start, size, n);
 	}
 
-	if(!fail)
+	if(buf)
 	{
-		if(!file_write(fname, buf, size))
+		if(!file_unmap(buf, size))
 		{
 			fprintf(stderr, "Failed to save data to file '%s'\n", fname);
 		}
-		else
+		else if(!fail)
 		{
 			fprintf(stderr, "CRC(s) updated successfully.\n");
 			retval = EXIT_SUCCESS;
 		}
 	}
-	else
+
+	if(fail)
 	{
 		fprintf(stderr, "CRC update failed.\n");
 	}
 
 end:
-	if(buf) free(buf);
 	return retval;
 }
 
@@ -2,12 +2,16 @@
 #define _CRCALC_H_
 
 #define USAGE "\n\
-crcalc v0.2 - (c) 2011, Craig Heffner\n\
-Re-calculates firmware header checksusms for TRX and uImage firmware headers.\n\
+crcalc v0.3 - (c) 2011, Craig Heffner\n\
+Re-calculates firmware header checksusms for TRX, uImage, DLOB and TP-Link firmware headers.\n\
 \n\
-Usage: %s <firmware image> [binwalk log file]\n\
+Usage: %s [-c cache [-e end]] <firmware image> [binwalk log file]\n\
 \n\
 If no binwalk log file is specified, the header is assumed to be at the beginning of the firmware image.\n\
+The manifest.bin fmk-extract writes may be given as the log file and as the cache.\n\
+\n\
+\t-c <cache>   Resume TRX and uImage CRCs from the prefixes saved in this file\n\
+\t-e <end>     Do not patch; save the CRC prefixes of the bytes before offset <end> to the cache\n\
 \n"
 
 #endif
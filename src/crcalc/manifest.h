@@ -0,0 +1,61 @@
+#ifndef _MANIFEST_H_
+#define _MANIFEST_H_
+
+#include <stdint.h>
+
+/*
+ * logs/manifest.bin, the layout of an image as fmk-extract found it: one
+ * struct manifest followed by nregions struct manifest_region, in the byte
+ * order of the host that wrote it. crcalc and fmk-assemble map it rather
+ * than parse binwalk.log, config.log and crc.log again; the scripts still
+ * read config.log.
+ */
+#define MANIFEST_MAGIC		"FMKMANIF"
+#define MANIFEST_MAGIC_SIZE	8
+#define MANIFEST_VERSION	1
+#define MANIFEST_NAME_SIZE	16
+#define MANIFEST_COMP_SIZE	8
+
+enum manifest_kind
+{
+	REGION_HEADER = 1,	/* a container header patch_headers() patches */
+	REGION_HEADER_IMAGE,	/* image_parts/header.img */
+	REGION_FILESYSTEM,	/* the rootfs, or a partition before it */
+	REGION_FOOTER,		/* image_parts/footer.img */
+};
+
+/* manifest_region flags */
+#define REGION_BIG_ENDIAN	0x01
+#define REGION_ROOTFS		0x02	/* the file system that is rootfs.img */
+#define REGION_PREFIX		0x04	/* prefix_len and prefix_crc are valid */
+
+struct manifest
+{
+	char magic[MANIFEST_MAGIC_SIZE];	/* MANIFEST_MAGIC */
+	uint32_t version;			/* MANIFEST_VERSION */
+	uint32_t nregions;
+	uint64_t fw_size;			/* FW_SIZE */
+	uint64_t fs_offset;			/* FS_OFFSET, the size of header.img */
+	uint64_t footer_size;			/* FOOTER_SIZE */
+	uint32_t reserved[2];
+};
+
+struct manifest_region
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t kind;				/* enum manifest_kind */
+	uint32_t type;				/* enum header_type of a REGION_HEADER */
+	uint32_t flags;
+	uint32_t block_size;			/* of a file system, 0 if unknown */
+	uint32_t crc;				/* crc32buf() of the region, bar headers */
+	uint32_t prefix_len;			/* the CRC prefix crc.log has, if REGION_PREFIX */
+	uint32_t prefix_crc;
+	uint32_t reserved;
+	char name[MANIFEST_NAME_SIZE];		/* "trx", "squashfs", "header.img"... */
+	char compression[MANIFEST_COMP_SIZE];	/* "gzip" or "lzma" of a file system */
+};
+
+#define MANIFEST_REGIONS(m)	((struct manifest_region *) ((struct manifest *) (m) + 1))
+
+#endif
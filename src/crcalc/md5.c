@@ -213,7 +213,11 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
     md5_word_t t;
 
 #ifndef ARCH_IS_BIG_ENDIAN
-# define ARCH_IS_BIG_ENDIAN 1	/* slower, default implementation */
+# if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define ARCH_IS_BIG_ENDIAN 0
+# else
+#  define ARCH_IS_BIG_ENDIAN 1	/* slower, default implementation */
+# endif
 #endif
 #if ARCH_IS_BIG_ENDIAN
 
@@ -252,9 +256,9 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
     /* Round 1. */
     /* Let [abcd k s i] denote the operation
        a = b + ((a + F(b,c,d) + X[k] + T[i]) <<< s). */
-#define F(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))	/* (x & y) | (~x & z) */
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + F(b,c,d) + X[k] + Ti;\
+  t = a + X[k] + Ti + F(b,c,d);\
   a = ROTATE_LEFT(t, s) + b
     /* Do the following 16 operations. */
     SET(a, b, c, d,  0,  7,  T1);
@@ -279,8 +283,12 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
      /* Let [abcd k s i] denote the operation
           a = b + ((a + G(b,c,d) + X[k] + T[i]) <<< s). */
 #define G(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+    /*
+     * The two halves of G never have a bit set in common, so they can be
+     * added in separately; y & ~z does not wait for the previous step.
+     */
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + G(b,c,d) + X[k] + Ti;\
+  t = a + ((c) & ~(d)) + X[k] + Ti + ((b) & (d));\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  1,  5, T17);
@@ -306,7 +314,7 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
           a = b + ((a + H(b,c,d) + X[k] + T[i]) <<< s). */
 #define H(x, y, z) ((x) ^ (y) ^ (z))
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + H(b,c,d) + X[k] + Ti;\
+  t = a + X[k] + Ti + H(b,c,d);\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  5,  4, T33);
@@ -332,7 +340,7 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
           a = b + ((a + I(b,c,d) + X[k] + T[i]) <<< s). */
 #define I(x, y, z) ((y) ^ ((x) | ~(z)))
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + I(b,c,d) + X[k] + Ti;\
+  t = a + X[k] + Ti + I(b,c,d);\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  0,  6, T49);
@@ -432,3 +440,245 @@ md5_finish(md5_state_t *pms, md5_byte_t digest[16])
     for (i = 0; i < 16; ++i)
 	digest[i] = (md5_byte_t)(pms->abcd[i >> 2] >> ((i & 3) << 3));
 }
+
+/*
+ * Multi-buffer MD5.  One message can only be hashed a block at a time, but
+ * separate messages can share the work: four of them go through the SSE2
+ * registers side by side, a 32-bit lane each.  Messages are grouped by size
+ * so the lanes of a group run out at about the same time; whatever is left
+ * of the longer ones, and the padding, is done one at a time by md5_append.
+ */
+#if defined(__SSE2__) && !ARCH_IS_BIG_ENDIAN
+#include <emmintrin.h>
+
+#define MD5_LANES 4
+
+static void
+md5_process_x4(__m128i abcd[4], const md5_byte_t *data[MD5_LANES],
+	       size_t nblocks)
+{
+    __m128i a = abcd[0], b = abcd[1], c = abcd[2], d = abcd[3];
+    __m128i X[16];
+    const __m128i ones = _mm_set1_epi32(-1);
+    size_t n;
+    int i;
+
+#define ROL4(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define F4(x, y, z) _mm_xor_si128(z, _mm_and_si128(x, _mm_xor_si128(y, z)))
+#define G4(x, y, z) _mm_xor_si128(y, _mm_and_si128(z, _mm_xor_si128(x, y)))
+#define H4(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define I4(x, y, z) _mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, ones)))
+#define SET4(f, a, b, c, d, k, s, Ti)\
+  a = _mm_add_epi32(_mm_add_epi32(a, X[k]), _mm_set1_epi32((int)Ti));\
+  a = _mm_add_epi32(ROL4(_mm_add_epi32(a, f(b, c, d)), s), b)
+
+    for (n = 0; n < nblocks; ++n) {
+	__m128i sa = a, sb = b, sc = c, sd = d;
+
+	/* Transpose 4x4 words, so X[k] holds word k of every lane. */
+	for (i = 0; i < 16; i += 4) {
+	    size_t o = n * 64 + i * 4;
+	    __m128i r0 = _mm_loadu_si128((const __m128i *)(data[0] + o));
+	    __m128i r1 = _mm_loadu_si128((const __m128i *)(data[1] + o));
+	    __m128i r2 = _mm_loadu_si128((const __m128i *)(data[2] + o));
+	    __m128i r3 = _mm_loadu_si128((const __m128i *)(data[3] + o));
+	    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+	    X[i + 0] = _mm_unpacklo_epi64(t0, t1);
+	    X[i + 1] = _mm_unpackhi_epi64(t0, t1);
+	    X[i + 2] = _mm_unpacklo_epi64(t2, t3);
+	    X[i + 3] = _mm_unpackhi_epi64(t2, t3);
+	}
+
+	SET4(F4, a, b, c, d,  0,  7,  T1);
+	SET4(F4, d, a, b, c,  1, 12,  T2);
+	SET4(F4, c, d, a, b,  2, 17,  T3);
+	SET4(F4, b, c, d, a,  3, 22,  T4);
+	SET4(F4, a, b, c, d,  4,  7,  T5);
+	SET4(F4, d, a, b, c,  5, 12,  T6);
+	SET4(F4, c, d, a, b,  6, 17,  T7);
+	SET4(F4, b, c, d, a,  7, 22,  T8);
+	SET4(F4, a, b, c, d,  8,  7,  T9);
+	SET4(F4, d, a, b, c,  9, 12, T10);
+	SET4(F4, c, d, a, b, 10, 17, T11);
+	SET4(F4, b, c, d, a, 11, 22, T12);
+	SET4(F4, a, b, c, d, 12,  7, T13);
+	SET4(F4, d, a, b, c, 13, 12, T14);
+	SET4(F4, c, d, a, b, 14, 17, T15);
+	SET4(F4, b, c, d, a, 15, 22, T16);
+
+	SET4(G4, a, b, c, d,  1,  5, T17);
+	SET4(G4, d, a, b, c,  6,  9, T18);
+	SET4(G4, c, d, a, b, 11, 14, T19);
+	SET4(G4, b, c, d, a,  0, 20, T20);
+	SET4(G4, a, b, c, d,  5,  5, T21);
+	SET4(G4, d, a, b, c, 10,  9, T22);
+	SET4(G4, c, d, a, b, 15, 14, T23);
+	SET4(G4, b, c, d, a,  4, 20, T24);
+	SET4(G4, a, b, c, d,  9,  5, T25);
+	SET4(G4, d, a, b, c, 14,  9, T26);
+	SET4(G4, c, d, a, b,  3, 14, T27);
+	SET4(G4, b, c, d, a,  8, 20, T28);
+	SET4(G4, a, b, c, d, 13,  5, T29);
+	SET4(G4, d, a, b, c,  2,  9, T30);
+	SET4(G4, c, d, a, b,  7, 14, T31);
+	SET4(G4, b, c, d, a, 12, 20, T32);
+
+	SET4(H4, a, b, c, d,  5,  4, T33);
+	SET4(H4, d, a, b, c,  8, 11, T34);
+	SET4(H4, c, d, a, b, 11, 16, T35);
+	SET4(H4, b, c, d, a, 14, 23, T36);
+	SET4(H4, a, b, c, d,  1,  4, T37);
+	SET4(H4, d, a, b, c,  4, 11, T38);
+	SET4(H4, c, d, a, b,  7, 16, T39);
+	SET4(H4, b, c, d, a, 10, 23, T40);
+	SET4(H4, a, b, c, d, 13,  4, T41);
+	SET4(H4, d, a, b, c,  0, 11, T42);
+	SET4(H4, c, d, a, b,  3, 16, T43);
+	SET4(H4, b, c, d, a,  6, 23, T44);
+	SET4(H4, a, b, c, d,  9,  4, T45);
+	SET4(H4, d, a, b, c, 12, 11, T46);
+	SET4(H4, c, d, a, b, 15, 16, T47);
+	SET4(H4, b, c, d, a,  2, 23, T48);
+
+	SET4(I4, a, b, c, d,  0,  6, T49);
+	SET4(I4, d, a, b, c,  7, 10, T50);
+	SET4(I4, c, d, a, b, 14, 15, T51);
+	SET4(I4, b, c, d, a,  5, 21, T52);
+	SET4(I4, a, b, c, d, 12,  6, T53);
+	SET4(I4, d, a, b, c,  3, 10, T54);
+	SET4(I4, c, d, a, b, 10, 15, T55);
+	SET4(I4, b, c, d, a,  1, 21, T56);
+	SET4(I4, a, b, c, d,  8,  6, T57);
+	SET4(I4, d, a, b, c, 15, 10, T58);
+	SET4(I4, c, d, a, b,  6, 15, T59);
+	SET4(I4, b, c, d, a, 13, 21, T60);
+	SET4(I4, a, b, c, d,  4,  6, T61);
+	SET4(I4, d, a, b, c, 11, 10, T62);
+	SET4(I4, c, d, a, b,  2, 15, T63);
+	SET4(I4, b, c, d, a,  9, 21, T64);
+
+	a = _mm_add_epi32(a, sa);
+	b = _mm_add_epi32(b, sb);
+	c = _mm_add_epi32(c, sc);
+	d = _mm_add_epi32(d, sd);
+    }
+
+#undef SET4
+#undef I4
+#undef H4
+#undef G4
+#undef F4
+#undef ROL4
+
+    abcd[0] = a;
+    abcd[1] = b;
+    abcd[2] = c;
+    abcd[3] = d;
+}
+
+/* A message of md5_multi, sorted by size to build the groups. */
+typedef struct md5_multi_msg_s {
+    size_t size;
+    int index;
+} md5_multi_msg_t;
+
+static int
+md5_multi_cmp(const void *a, const void *b)
+{
+    size_t x = ((const md5_multi_msg_t *)a)->size;
+    size_t y = ((const md5_multi_msg_t *)b)->size;
+
+    return (x > y) - (x < y);
+}
+#endif /* __SSE2__ */
+
+/* Carries on with whatever md5_append has not seen yet, size_t at a time. */
+static void
+md5_append_large(md5_state_t *pms, const md5_byte_t *data, size_t nbytes)
+{
+    while (nbytes > 0) {
+	int chunk = nbytes > (1 << 30) ? (1 << 30) : (int)nbytes;
+
+	md5_append(pms, data, chunk);
+	data += chunk;
+	nbytes -= chunk;
+    }
+}
+
+void
+md5_multi(const md5_byte_t *const data[], const size_t sizes[],
+	  md5_byte_t digests[][16], int n)
+{
+    int i;
+#if defined(__SSE2__) && !ARCH_IS_BIG_ENDIAN
+    md5_multi_msg_t *order = malloc(n * sizeof(md5_multi_msg_t));
+    int done = 0;
+
+    if (order != NULL) {
+	for (i = 0; i < n; ++i) {
+	    order[i].size = sizes[i];
+	    order[i].index = i;
+	}
+	qsort(order, n, sizeof(md5_multi_msg_t), md5_multi_cmp);
+
+	for (; done + MD5_LANES <= n; done += MD5_LANES) {
+	    const md5_byte_t *lane[MD5_LANES];
+	    __m128i abcd[4];
+	    md5_word_t words[4][MD5_LANES];
+	    size_t nblocks = order[done].size / 64;	/* the shortest */
+	    int l, w;
+
+	    for (l = 0; l < MD5_LANES; ++l)
+		lane[l] = data[order[done + l].index];
+	    abcd[0] = _mm_set1_epi32(0x67452301);
+	    abcd[1] = _mm_set1_epi32((int)0xefcdab89);
+	    abcd[2] = _mm_set1_epi32((int)0x98badcfe);
+	    abcd[3] = _mm_set1_epi32(0x10325476);
+
+	    md5_process_x4(abcd, lane, nblocks);
+
+	    for (w = 0; w < 4; ++w)
+		_mm_storeu_si128((__m128i *)words[w], abcd[w]);
+
+	    for (l = 0; l < MD5_LANES; ++l) {
+		int m = order[done + l].index;
+		md5_state_t state;
+		size_t head = nblocks * 64;
+
+		state.count[0] = (md5_word_t)(head << 3);
+		state.count[1] = (md5_word_t)((unsigned long long)head >> 29);
+		for (w = 0; w < 4; ++w)
+		    state.abcd[w] = words[w][l];
+
+		md5_append_large(&state, data[m] + head, sizes[m] - head);
+		md5_finish(&state, digests[m]);
+	    }
+	}
+
+	/* Fewer than MD5_LANES left, the largest ones. */
+	for (i = done; i < n; ++i) {
+	    md5_state_t state;
+	    int m = order[i].index;
+
+	    md5_init(&state);
+	    md5_append_large(&state, data[m], sizes[m]);
+	    md5_finish(&state, digests[m]);
+	}
+
+	free(order);
+	return;
+    }
+#endif
+
+    for (i = 0; i < n; ++i) {
+	md5_state_t state;
+
+	md5_init(&state);
+	md5_append_large(&state, data[i], sizes[i]);
+	md5_finish(&state, digests[i]);
+    }
+}
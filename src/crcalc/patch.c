@@ -4,20 +4,72 @@
 #include "crc.h"
 #include "md5.h"
 
+/* CRC of len bytes at buf, resumed from prefix if one is given and fits */
+static uint32_t crc32_region(char *buf, size_t len, struct crc_prefix *prefix)
+{
+	if(prefix && prefix->len <= len)
+	{
+		return crc32_continue(prefix->crc, buf + prefix->len, len - prefix->len);
+	}
+
+	return crc32(buf, len);
+}
+
+/* Saves the CRC register of the part of a checksummed region that lies before end */
+static void crc32_prefix(char *buf, size_t len, size_t end, struct crc_prefix *prefix)
+{
+	prefix->len = (end < len) ? end : len;
+	prefix->crc = crc32(buf, prefix->len);
+}
+
+/* Get the CRC prefix of a TRX file up to end */
+int prefix_trx(char *buf, size_t size, size_t end, struct crc_prefix *prefix)
+{
+	int retval = 0;
+	struct trx_header *header = (struct trx_header *) buf;
+
+	if(header->len <= size && header->len >= 12 && end >= 12)
+	{
+		crc32_prefix(buf+12, header->len-12, end-12, prefix);
+		retval = 1;
+	}
+
+	return retval;
+}
+
+/* Get the data CRC prefix of a uImage file up to end */
+int prefix_uimage(char *buf, size_t size, size_t end, struct crc_prefix *prefix)
+{
+	int retval = 0;
+	uint32_t hlen = 0;
+	struct uimage_header *header = (struct uimage_header *) buf;
+
+	hlen = ntohl(header->ih_size);
+
+	if(hlen <= (size - sizeof(struct uimage_header)) && size >= sizeof(struct uimage_header) && end >= sizeof(struct uimage_header))
+	{
+		crc32_prefix(buf+sizeof(struct uimage_header), hlen, end-sizeof(struct uimage_header), prefix);
+		retval = 1;
+	}
+
+	return retval;
+}
+
 /* Update the CRC for a TRX file */
-int patch_trx(char *buf, size_t size)
+int patch_trx(char *buf, size_t size, struct crc_prefix *prefix)
 {
         int retval = 0;
         struct trx_header *header = NULL;
 
         header = (struct trx_header *) buf;
-        header->crc32 = 0;
 
 	/* Sanity check on the header length field */
 	if(header->len <= size)
 	{
+        	header->crc32 = 0;
+
         	/* Checksum is calculated over the image, plus the header offsets (12 bytes into the TRX header) */
-        	header->crc32 = crc32(buf+12, (header->len-12));
+        	header->crc32 = crc32_region(buf+12, (header->len-12), prefix);
 
         	if(header->crc32 != 0)
         	{
@@ -29,7 +81,7 @@ int patch_trx(char *buf, size_t size)
 }
 
 /* Update both CRCs for uImage files */
-int patch_uimage(char *buf, size_t size)
+int patch_uimage(char *buf, size_t size, struct crc_prefix *prefix)
 {
         int retval = 0;
 	uint32_t hlen = 0;
@@ -43,7 +95,7 @@ int patch_uimage(char *buf, size_t size)
         	header->ih_hcrc = 0;
         	header->ih_dcrc = 0;
 
-        	header->ih_dcrc = crc32(buf+sizeof(struct uimage_header), hlen) ^ 0xFFFFFFFFL;
+        	header->ih_dcrc = crc32_region(buf+sizeof(struct uimage_header), hlen, prefix) ^ 0xFFFFFFFFL;
         	header->ih_dcrc = htonl(header->ih_dcrc);
 
         	header->ih_hcrc = crc32(buf, sizeof(struct uimage_header)) ^ 0xFFFFFFFFL;
@@ -93,3 +145,73 @@ int patch_dlob(char *buf, size_t size)
 		
 	return retval;
 }
+
+/* Keys TP-Link puts in the image_checksum field while the MD5 is taken */
+static const md5_byte_t tplink_key[TPLINK_MD5_LEN] = {
+	0xdc, 0xd7, 0x3a, 0xa5, 0xc3, 0x95, 0x98, 0xfb,
+	0xdd, 0xf9, 0xe7, 0xf4, 0x0e, 0xae, 0x47, 0x38,
+};
+
+static const md5_byte_t tplink_key_bootldr[TPLINK_MD5_LEN] = {
+	0x8c, 0xef, 0x33, 0x5b, 0xd5, 0xc5, 0xce, 0xfa,
+	0xa7, 0x9c, 0x28, 0xda, 0xb2, 0xe9, 0x0f, 0x42,
+};
+
+/* Sets the MD5 of one TP-Link image, header included */
+static void tplink_md5(struct tplink_header *header, uint32_t len)
+{
+	md5_state_t state;
+
+	if(header->bootldr_length == 0)
+	{
+		memcpy(header->image_checksum, tplink_key, TPLINK_MD5_LEN);
+	}
+	else
+	{
+		memcpy(header->image_checksum, tplink_key_bootldr, TPLINK_MD5_LEN);
+	}
+
+	md5_init(&state);
+	md5_append(&state, (const md5_byte_t *) header, len);
+	md5_finish(&state, header->image_checksum);
+}
+
+/* Update the MD5 checksum(s) of a TP-Link image, as tpl-tool -b would */
+int patch_tplink(char *buf, size_t size)
+{
+	int retval = 0;
+	uint32_t len = 0, inner_len = 0;
+	struct tplink_header *header = NULL, *inner = NULL;
+
+	header = (struct tplink_header *) buf;
+
+	if(size >= sizeof(struct tplink_header))
+	{
+		len = ntohl(header->image_length);
+
+		if(len >= sizeof(struct tplink_header) && len <= size)
+		{
+			/*
+			 * Images with a bootloader hold a complete kernel/rootfs image at TPLINK_IMAGE2_OFFSET.
+			 * Its MD5 is part of what the outer one covers, so it has to be done first.
+			 */
+			if(header->bootldr_length != 0 && len > (TPLINK_IMAGE2_OFFSET + sizeof(struct tplink_header)))
+			{
+				inner = (struct tplink_header *) (buf + TPLINK_IMAGE2_OFFSET);
+				inner_len = ntohl(inner->image_length);
+
+				if(ntohl(inner->header_version) == TPLINK_VERSION &&
+				   inner_len >= sizeof(struct tplink_header) &&
+				   inner_len <= (len - TPLINK_IMAGE2_OFFSET))
+				{
+					tplink_md5(inner, inner_len);
+				}
+			}
+
+			tplink_md5(header, len);
+			retval = 1;
+		}
+	}
+
+	return retval;
+}
@@ -2,6 +2,7 @@
 #define _PATCH_H_
 
 #include <stdint.h>
+#include "common.h"
 
 #define TRX_MAGIC 0x30524448
 struct trx_header {
@@ -37,8 +38,41 @@ struct dlob_header {
 	uint32_t data_size;		/* Flags or an ID value maybe? */
 };
 
-int patch_trx(char *buf, size_t size);
-int patch_uimage(char *buf, size_t size);
+/* TP-Link headers have no magic; the version is 1, stored big endian */
+#define TPLINK_VERSION 0x01000000
+#define TPLINK_IMAGE2_OFFSET 0x20200	/* inner image of bootloader images */
+#define TPLINK_MD5_LEN 16
+struct tplink_header {
+	uint32_t header_version;	/* TPLINK_VERSION */
+	char vendor[24];
+	char version[36];
+	uint32_t product_id;
+	uint32_t product_ver;
+	uint32_t padding1;
+	uint8_t image_checksum[TPLINK_MD5_LEN];	/* MD5 of image_length bytes */
+	uint32_t padding2;
+	uint8_t kernel_checksum[TPLINK_MD5_LEN];
+	uint32_t padding3;
+	uint32_t kernel_loadaddr;
+	uint32_t kernel_entrypoint;
+	uint32_t image_length;		/* Length of the image including header */
+	uint32_t kernel_offset;
+	uint32_t kernel_length;
+	uint32_t rootfs_offset;
+	uint32_t rootfs_length;
+	uint32_t bootldr_offset;
+	uint32_t bootldr_length;	/* Non-zero if a bootloader is included */
+	uint16_t fw_ver_major;
+	uint16_t fw_ver_minor;
+	uint16_t fw_ver_point;
+	uint8_t padding4[354];
+} __attribute__ ((packed));
+
+int prefix_trx(char *buf, size_t size, size_t end, struct crc_prefix *prefix);
+int prefix_uimage(char *buf, size_t size, size_t end, struct crc_prefix *prefix);
+int patch_trx(char *buf, size_t size, struct crc_prefix *prefix);
+int patch_uimage(char *buf, size_t size, struct crc_prefix *prefix);
 int patch_dlob(char *buf, size_t size);
+int patch_tplink(char *buf, size_t size);
 
 #endif
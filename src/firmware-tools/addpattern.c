@@ -70,6 +70,8 @@
 
 #define CYBERTAN_VERSION	"v3.37.2" /* from cyutils.h */
 
+#define GARBAGE_ALIGN	1024	/* -g pads the image to a multiple of this */
+
 /* WRT54G v2.2 and WRT54GS v1.1 "flags" (from 3.37.32 firmware cyutils.h) */
 #define SUPPORT_4712_CHIP      0x0001
 #define SUPPORT_INTEL_FLASH    0x0002
@@ -139,7 +141,7 @@ struct board_info *find_board(char *id)
 
 int main(int argc, char **argv)
 {
-	char buf[1024];	/* keep this at 1k or adjust garbage calc below */
+	char buf[64 * 1024];	/* keep this a multiple of GARBAGE_ALIGN */
 	struct code_header *hdr;
 	FILE *in = stdin;
 	FILE *out = stdout;
@@ -296,11 +298,11 @@ int main(int argc, char **argv)
 				fprintf(stderr, "fread error\n");
 				return EXIT_FAILURE;
 			}
-			if (gflag) {
-				gflag = sizeof(buf) - n;
+			if (gflag && n % GARBAGE_ALIGN) {
+				gflag = GARBAGE_ALIGN - n % GARBAGE_ALIGN;
 				memset(buf + n, 0xff, gflag);
 				fprintf(stderr, "adding %d bytes of garbage\n", gflag);
-				n = sizeof(buf);
+				n += gflag;
 			}
 		}
 		if (!fwrite(buf, n, 1, out)) {
@@ -26,6 +26,7 @@
 static char *progname;
 static char *ifname;
 static char *ofname;
+static char *listname;
 static char *crypt_key = "Buffalo";
 static char *magic = "start";
 static int longstate;
@@ -46,6 +47,7 @@ void usage(int status)
 "  -d              decrypt instead of encrypt\n"
 "  -i <file>       read input from the file <file>\n"
 "  -o <file>       write output to the file <file>\n"
+"  -b <file>       process each input and output file pair listed in <file>\n"
 "  -l              use longstate {en,de}cryption method\n"
 "  -k <key>        use <key> for encryption (default: Buffalo)\n"
 "  -m <magic>      set magic to <magic>\n"
@@ -177,14 +179,16 @@ static int check_params(void)
 {
 	int ret = -1;
 
-	if (ifname == NULL) {
-		ERR("no input file specified");
-		goto out;
-	}
+	if (listname == NULL) {
+		if (ifname == NULL) {
+			ERR("no input file specified");
+			goto out;
+		}
 
-	if (ofname == NULL) {
-		ERR("no output file specified");
-		goto out;
+		if (ofname == NULL) {
+			ERR("no output file specified");
+			goto out;
+		}
 	}
 
 	if (crypt_key == NULL) {
@@ -228,6 +232,33 @@ out:
 	return ret;
 }
 
+/* runs every "input output" line of the list, going on past failures */
+static int process_list(void)
+{
+	char line[2 * 4096], in[4096], out[4096];
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(listname, "r");
+	if (f == NULL) {
+		ERR("unable to open list '%s'", listname);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%4095s %4095s", in, out) != 2)
+			continue;
+
+		ifname = in;
+		ofname = out;
+		if (do_decrypt ? decrypt_file() : encrypt_file())
+			ret = -1;
+	}
+
+	fclose(f);
+	return ret;
+}
+
 int main(int argc, char *argv[])
 {
 	int res = EXIT_FAILURE;
@@ -238,11 +269,14 @@ int main(int argc, char *argv[])
 	while ( 1 ) {
 		int c;
 
-		c = getopt(argc, argv, "adi:m:o:hp:v:k:r:s:");
+		c = getopt(argc, argv, "ab:di:m:o:hp:v:k:r:s:");
 		if (c == -1)
 			break;
 
 		switch (c) {
+		case 'b':
+			listname = optarg;
+			break;
 		case 'd':
 			do_decrypt = 1;
 			break;
@@ -283,7 +317,9 @@ int main(int argc, char *argv[])
 	if (err)
 		goto out;
 
-	if (do_decrypt)
+	if (listname)
+		err = process_list();
+	else if (do_decrypt)
 		err = decrypt_file();
 	else
 		err = encrypt_file();
@@ -15,6 +15,7 @@
 #include <sys/stat.h>
 
 #include "buffalo-lib.h"
+#include "../crc32/crc32buf.h"
 
 static uint32_t crc32_table[256] =
 {
@@ -127,16 +128,33 @@ int bcrypt_process(struct bcrypt_ctx *ctx, unsigned char *src,
 	i = ctx->i;
 	j = ctx->j;
 
-	for (k = 0; k < len; k++) {
-		unsigned char t;
-
-		i = (i + 1) % state_len;
-		j = (j + state[i]) % state_len;
-		t = state[j];
-		state[j] = state[i];
-		state[i] = t;
-
-		dst[k] = src[k] ^ state[(state[i] + state[j]) % state_len];
+	/* the default state wraps with i and j, so needs no divisions */
+	if (state_len == 256) {
+		for (k = 0; k < len; k++) {
+			unsigned char t;
+
+			i++;
+			j += state[i];
+			t = state[j];
+			state[j] = state[i];
+			state[i] = t;
+
+			t = state[i] + state[j];
+			dst[k] = src[k] ^ state[t];
+		}
+	} else {
+		for (k = 0; k < len; k++) {
+			unsigned char t;
+
+			i = (i + 1) % state_len;
+			j = (j + state[i]) % state_len;
+			t = state[j];
+			state[j] = state[i];
+			state[i] = t;
+
+			dst[k] = src[k] ^
+				 state[(state[i] + state[j]) % state_len];
+		}
 	}
 
 	ctx->i = i;
@@ -177,21 +195,47 @@ int bcrypt_buf(unsigned char seed, unsigned char *key, unsigned char *src,
 	return 0;
 }
 
+#define SIGN(c)	((unsigned char) ((signed char) (c) >> 7))
+
+/*
+ * A CRC-32 fed sign extended bytes: one of 0x80 and up also flips the low
+ * three bytes of the register, which is the same as flipping the three
+ * data bytes after it.  The data is run through crc32_update() that way,
+ * a block at a time, and the flips left over at the end go on the result.
+ */
 uint32_t buffalo_csum(uint32_t csum, void *buf, unsigned long len)
 {
-	char *p = buf;
+	unsigned char blk[4096];
+	unsigned char *p = buf;
+	unsigned char h[3] = { 0, 0, 0 };	/* the last three bytes so far */
+
+	while (len) {
+		unsigned long n = len < sizeof(blk) ? len : sizeof(blk);
+		unsigned long k;
+
+		for (k = 0; k < n && k < 3; k++)
+			blk[k] = p[k] ^ SIGN(k > 0 ? p[k - 1] : h[2]) ^
+				 SIGN(k > 1 ? p[k - 2] : h[k + 1]) ^
+				 SIGN(h[k]);
 
-	while (len--) {
-		int i;
+		for (; k < n; k++)
+			blk[k] = p[k] ^ SIGN(p[k - 1]) ^ SIGN(p[k - 2]) ^
+				 SIGN(p[k - 3]);
 
-		csum ^= *p++;
-		for (i = 0; i < 8; i++)
-			csum = (csum >> 1) ^ ((csum & 1) ? 0xedb88320ul : 0);
+		for (k = 0; k < 3; k++)
+			h[k] = n + k >= 3 ? p[n + k - 3] : h[n + k];
+
+		csum = crc32_update(csum, blk, n);
+		p += n;
+		len -= n;
 	}
 
-	return csum;
+	return csum ^ (SIGN(h[2]) * 0x010101u) ^ (SIGN(h[1]) * 0x0101u) ^
+	       SIGN(h[0]);
 }
 
+#undef SIGN
+
 uint32_t buffalo_crc(void *buf, unsigned long len)
 {
 	unsigned char *p = buf;
@@ -14,9 +14,43 @@
 #include <libgen.h>
 #include <getopt.h>     /* for getopt() */
 #include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 #include "buffalo-lib.h"
 
+/*
+ * With -s the image is also sent to the TFTP server of each bootloader
+ * given, all of them at once, one thread each, from the one mapping of
+ * the image.  The block size (RFC 2348) and window size (RFC 7440) are
+ * negotiated, and a bootloader that refuses options, or ignores the
+ * request, is sent the image again in 512 byte lock-step blocks.
+ */
+#define TFTP_PORT		"69"
+#define TFTP_WRQ		2
+#define TFTP_DATA		3
+#define TFTP_ACK		4
+#define TFTP_ERROR		5
+#define TFTP_OACK		6
+#define TFTP_BLKSIZE_DEF	512
+#define TFTP_BLKSIZE_MIN	8
+#define TFTP_BLKSIZE_MAX	65464
+#define TFTP_WINDOW_MAX		65535
+#define TFTP_TIMEOUT_MS		1000
+#define TFTP_RETRIES		5
+#define TFTP_REQUEST_MAX	512
+#define MAX_TARGETS		16
+
 #define ERR(fmt, args...) do { \
 	fflush(0); \
 	fprintf(stderr, "[%s] *** error: " fmt "\n", \
@@ -27,6 +61,24 @@ static char *progname;
 static char *ifname;
 static char *ofname;
 static int do_decrypt;
+static char *remote_name;
+static unsigned int tftp_blksize = 1468;	/* a full Ethernet frame */
+static unsigned int tftp_windowsize = 16;
+
+struct tftp_target {
+	char *host;
+	char *ifname;		/* the interface to send from, or NULL */
+	pthread_t thread;
+	int ret;
+	unsigned int blksize;	/* as negotiated */
+	unsigned int windowsize;
+	double secs;
+};
+
+static struct tftp_target targets[MAX_TARGETS];
+static int num_targets;
+static unsigned char *image;
+static ssize_t image_len;
 
 void usage(int status)
 {
@@ -39,7 +91,16 @@ void usage(int status)
 "  -d              decrypt instead of encrypt\n"
 "  -i <file>       read input from the file <file>\n"
 "  -o <file>       write output to the file <file>\n"
-"  -h              show this screen\n"
+"  -s <host>[%%<if>] send the output to the TFTP server of <host>, from the\n"
+"                  interface <if> if given; may be repeated, to flash up to\n"
+"                  %d devices at once\n"
+"  -r <name>       the file name the TFTP server is sent (default: the input\n"
+"                  file's name)\n"
+"  -b <size>       TFTP block size to ask for (default: %u, 8192 on networks\n"
+"                  that take fragmented UDP)\n"
+"  -w <blocks>     TFTP window size to ask for (default: %u, 1 for lock-step)\n"
+"  -h              show this screen\n",
+		MAX_TARGETS, tftp_blksize, tftp_windowsize
 	);
 
 	exit(status);
@@ -66,48 +127,350 @@ static void crypt_header(unsigned char *buf, ssize_t len,
 	}
 }
 
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* waits up to TFTP_TIMEOUT_MS for a packet; returns its length, 0 on timeout */
+static ssize_t tftp_recv(int fd, unsigned char *buf, size_t len,
+			 struct sockaddr_storage *from, socklen_t *fromlen)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int n;
+
+	do
+		n = poll(&pfd, 1, TFTP_TIMEOUT_MS);
+	while (n < 0 && errno == EINTR);
+	if (n <= 0)
+		return n;
+
+	*fromlen = sizeof(*from);
+	return recvfrom(fd, buf, len, 0, (struct sockaddr *) from, fromlen);
+}
+
+static size_t tftp_request(unsigned char *pkt, int options)
+{
+	size_t len;
+
+	pkt[0] = 0;
+	pkt[1] = TFTP_WRQ;
+	len = 2;
+	len += sprintf((char *) pkt + len, "%s", remote_name) + 1;
+	len += sprintf((char *) pkt + len, "octet") + 1;
+	if (options) {
+		len += sprintf((char *) pkt + len, "blksize") + 1;
+		len += sprintf((char *) pkt + len, "%u", tftp_blksize) + 1;
+		if (tftp_windowsize > 1) {
+			len += sprintf((char *) pkt + len, "windowsize") + 1;
+			len += sprintf((char *) pkt + len, "%u",
+				       tftp_windowsize) + 1;
+		}
+	}
+
+	return len;
+}
+
+/* the options a server took, which may be smaller than asked for */
+static int tftp_oack(struct tftp_target *t, unsigned char *pkt, ssize_t len)
+{
+	char *p = (char *) pkt + 2, *end = (char *) pkt + len;
+
+	while (p < end) {
+		char *name = p, *value;
+		unsigned long v;
+
+		value = memchr(name, 0, end - name);
+		if (value == NULL || ++value >= end ||
+		    memchr(value, 0, end - value) == NULL)
+			return -1;
+		p = value + strlen(value) + 1;
+
+		v = strtoul(value, NULL, 10);
+		if (strcasecmp(name, "blksize") == 0) {
+			if (v < TFTP_BLKSIZE_MIN || v > tftp_blksize)
+				return -1;
+			t->blksize = v;
+		} else if (strcasecmp(name, "windowsize") == 0) {
+			if (v < 1 || v > tftp_windowsize)
+				return -1;
+			t->windowsize = v;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Sends the write request, with the options first, and connects fd to the
+ * port the server answers from
+ */
+static int tftp_connect(struct tftp_target *t, int fd, struct addrinfo *ai,
+			unsigned char *pkt, size_t pktlen)
+{
+	struct sockaddr_storage from;
+	socklen_t fromlen;
+	int options, retries;
+
+	for (options = 1; options >= 0; options--) {
+		size_t len = tftp_request(pkt, options);
+
+		t->blksize = TFTP_BLKSIZE_DEF;
+		t->windowsize = 1;
+		for (retries = 0; retries < TFTP_RETRIES; retries++) {
+			ssize_t n;
+
+			if (sendto(fd, pkt, len, 0, ai->ai_addr,
+				   ai->ai_addrlen) < 0) {
+				ERR("%s: unable to send the request: %s",
+				    t->host, strerror(errno));
+				return -1;
+			}
+
+			n = tftp_recv(fd, pkt, pktlen, &from, &fromlen);
+			if (n < 0) {
+				ERR("%s: %s", t->host, strerror(errno));
+				return -1;
+			}
+			if (n < 4)
+				continue;
+
+			if (pkt[1] == TFTP_ERROR && options)
+				break;
+			if (pkt[1] == TFTP_ERROR) {
+				ERR("%s: refused: %.*s", t->host,
+				    (int) (n - 4), pkt + 4);
+				return -1;
+			}
+			if (pkt[1] == TFTP_OACK && options &&
+			    tftp_oack(t, pkt, n) == 0)
+				return connect(fd, (struct sockaddr *) &from,
+					       fromlen);
+			if (pkt[1] == TFTP_ACK && pkt[2] == 0 && pkt[3] == 0)
+				return connect(fd, (struct sockaddr *) &from,
+					       fromlen);
+		}
+
+		if (options)
+			fprintf(stderr, "%s: no options, sending in %d byte "
+				"blocks\n", t->host, TFTP_BLKSIZE_DEF);
+	}
+
+	ERR("%s: no answer from the TFTP server", t->host);
+	return -1;
+}
+
+/* block is counted from 1; on the wire it wraps around to 0 */
+static int tftp_block(int fd, unsigned char *pkt, struct tftp_target *t,
+		      unsigned long block)
+{
+	size_t off = (block - 1) * t->blksize, len;
+
+	len = (off + t->blksize <= image_len) ? t->blksize : image_len - off;
+	pkt[0] = 0;
+	pkt[1] = TFTP_DATA;
+	pkt[2] = (block >> 8) & 0xff;
+	pkt[3] = block & 0xff;
+	memcpy(pkt + 4, image + off, len);
+
+	return send(fd, pkt, len + 4, 0) < 0 ? -1 : 0;
+}
+
+/*
+ * Sends a window of blocks, then waits for the ACK of the last block the
+ * server got in order, and goes on from the one after it
+ */
+static int tftp_data(struct tftp_target *t, int fd, unsigned char *pkt,
+		     size_t pktlen)
+{
+	unsigned long blocks = image_len / t->blksize + 1, acked = 0, next = 1;
+	int retries = 0;
+
+	while (acked < blocks) {
+		unsigned long end = acked + t->windowsize;
+		unsigned int dist;
+		ssize_t n;
+
+		if (end > blocks)
+			end = blocks;
+		for (; next <= end; next++)
+			if (tftp_block(fd, pkt, t, next)) {
+				ERR("%s: %s", t->host, strerror(errno));
+				return -1;
+			}
+
+		n = tftp_recv(fd, pkt, pktlen, NULL, &(socklen_t){ 0 });
+		if (n < 0 && errno != ECONNREFUSED) {
+			ERR("%s: %s", t->host, strerror(errno));
+			return -1;
+		}
+		if (n <= 0) {
+			if (++retries > TFTP_RETRIES) {
+				ERR("%s: timed out at block %lu", t->host,
+				    acked + 1);
+				return -1;
+			}
+			next = acked + 1;
+			continue;
+		}
+
+		if (n >= 4 && pkt[1] == TFTP_ERROR) {
+			ERR("%s: %.*s", t->host, (int) (n - 4), pkt + 4);
+			return -1;
+		}
+		if (n < 4 || pkt[1] != TFTP_ACK)
+			continue;
+
+		dist = (uint16_t) (((pkt[2] << 8) | pkt[3]) - acked);
+		if (dist == 0 || dist > end - acked)
+			continue;	/* an old ACK, answering it would double up */
+		acked += dist;
+		next = acked + 1;
+		retries = 0;
+	}
+
+	return 0;
+}
+
+static void *tftp_send(void *arg)
+{
+	struct tftp_target *t = arg;
+	struct addrinfo hints, *ai = NULL;
+	unsigned char *pkt = NULL;
+	size_t pktlen = 4 + (tftp_blksize > TFTP_REQUEST_MAX ?
+			     tftp_blksize : TFTP_REQUEST_MAX);
+	double start = now();
+	int fd = -1, err;
+
+	t->ret = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	err = getaddrinfo(t->host, TFTP_PORT, &hints, &ai);
+	if (err) {
+		ERR("%s: %s", t->host, gai_strerror(err));
+		goto out;
+	}
+
+	fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (fd < 0) {
+		ERR("%s: unable to open a socket: %s", t->host,
+		    strerror(errno));
+		goto out;
+	}
+	if (t->ifname && setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE,
+				    t->ifname, strlen(t->ifname) + 1)) {
+		ERR("%s: unable to send from %s: %s", t->host, t->ifname,
+		    strerror(errno));
+		goto out;
+	}
+
+	pkt = malloc(pktlen);
+	if (pkt == NULL) {
+		ERR("no memory for the packet buffer");
+		goto out;
+	}
+
+	if (tftp_connect(t, fd, ai, pkt, pktlen) || tftp_data(t, fd, pkt,
+							     pktlen))
+		goto out;
+
+	t->secs = now() - start;
+	t->ret = 0;
+
+out:
+	free(pkt);
+	if (fd >= 0)
+		close(fd);
+	if (ai)
+		freeaddrinfo(ai);
+	return NULL;
+}
+
+static int send_image(void)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < num_targets; i++) {
+		fprintf(stderr, "Sending %s to %s%s%s...\n", remote_name,
+			targets[i].host, targets[i].ifname ? " on " : "",
+			targets[i].ifname ? targets[i].ifname : "");
+		if (pthread_create(&targets[i].thread, NULL, tftp_send,
+				   &targets[i])) {
+			ERR("unable to start a thread for %s", targets[i].host);
+			targets[i].thread = 0;
+			targets[i].ret = -1;
+		}
+	}
+
+	for (i = 0; i < num_targets; i++) {
+		struct tftp_target *t = &targets[i];
+
+		if (t->thread)
+			pthread_join(t->thread, NULL);
+		if (t->ret) {
+			ret = -1;
+			continue;
+		}
+		fprintf(stderr, "%s: sent %zd bytes in %.1f s (%u byte blocks, "
+			"window of %u)\n", t->host, image_len, t->secs,
+			t->blksize, t->windowsize);
+	}
+
+	return ret;
+}
+
 static int crypt_file(void)
 {
-	unsigned char *buf = NULL;
-	ssize_t src_len;
-	ssize_t crypt_len;
 	int err;
 	int ret = -1;
+	int fd;
+	ssize_t crypt_len;
 
-	src_len = get_file_size(ifname);
-	if (src_len < 0) {
+	fd = open(ifname, O_RDONLY);
+	image_len = fd < 0 ? -1 : get_file_size(ifname);
+	if (image_len < 0) {
 		ERR("unable to get size of '%s'", ifname);
 		goto out;
 	}
 
-	buf = malloc(src_len);
-	if (buf == NULL) {
-		ERR("no memory for the buffer");
-		goto out;
-	}
-
-	err = read_file_to_buf(ifname, buf, src_len);
-	if (err) {
-		ERR("unable to read from file '%s'", ifname);
+	/* a private mapping, only the page with the header gets copied */
+	image = mmap(NULL, image_len ? image_len : 1, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE, fd, 0);
+	if (image == MAP_FAILED) {
+		image = NULL;
+		ERR("unable to map '%s'", ifname);
 		goto out;
 	}
 
-	crypt_len = (src_len > 512) ? 512 : src_len;
+	crypt_len = (image_len > 512) ? 512 : image_len;
 	if (do_decrypt)
-		crypt_header(buf, 512, crypt_key2, crypt_key1);
+		crypt_header(image, crypt_len, crypt_key2, crypt_key1);
 	else
-		crypt_header(buf, 512, crypt_key1, crypt_key2);
+		crypt_header(image, crypt_len, crypt_key1, crypt_key2);
 
-	err = write_buf_to_file(ofname, buf, src_len);
-	if (err) {
-		ERR("unable to write to file '%s'", ofname);
-		goto out;
+	if (ofname) {
+		err = write_buf_to_file(ofname, image, image_len);
+		if (err) {
+			ERR("unable to write to file '%s'", ofname);
+			goto out;
+		}
 	}
 
+	if (num_targets && send_image())
+		goto out;
+
 	ret = 0;
 
 out:
-	free(buf);
+	if (image)
+		munmap(image, image_len ? image_len : 1);
+	if (fd >= 0)
+		close(fd);
 	return ret;
 }
 
@@ -120,8 +483,26 @@ static int check_params(void)
 		goto out;
 	}
 
-	if (ofname == NULL) {
-		ERR("no output file specified");
+	if (ofname == NULL && num_targets == 0) {
+		ERR("no output file or TFTP server specified");
+		goto out;
+	}
+
+	if (tftp_blksize < TFTP_BLKSIZE_MIN || tftp_blksize > TFTP_BLKSIZE_MAX) {
+		ERR("the block size must be %d to %d bytes", TFTP_BLKSIZE_MIN,
+		    TFTP_BLKSIZE_MAX);
+		goto out;
+	}
+
+	if (tftp_windowsize < 1 || tftp_windowsize > TFTP_WINDOW_MAX) {
+		ERR("the window size must be 1 to %d blocks", TFTP_WINDOW_MAX);
+		goto out;
+	}
+
+	if (remote_name == NULL)
+		remote_name = basename(strdup(ifname));
+	if (strlen(remote_name) > TFTP_REQUEST_MAX - 64) {
+		ERR("the remote file name is too long");
 		goto out;
 	}
 
@@ -141,7 +522,7 @@ int main(int argc, char *argv[])
 	while ( 1 ) {
 		int c;
 
-		c = getopt(argc, argv, "di:o:h");
+		c = getopt(argc, argv, "di:o:s:r:b:w:h");
 		if (c == -1)
 			break;
 
@@ -155,6 +536,26 @@ int main(int argc, char *argv[])
 		case 'o':
 			ofname = optarg;
 			break;
+		case 's':
+			if (num_targets == MAX_TARGETS) {
+				ERR("no more than %d TFTP servers", MAX_TARGETS);
+				goto out;
+			}
+			targets[num_targets].host = optarg;
+			targets[num_targets].ifname = strchr(optarg, '%');
+			if (targets[num_targets].ifname)
+				*targets[num_targets].ifname++ = '\0';
+			num_targets++;
+			break;
+		case 'r':
+			remote_name = optarg;
+			break;
+		case 'b':
+			tftp_blksize = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			tftp_windowsize = strtoul(optarg, NULL, 0);
+			break;
 		case 'h':
 			usage(EXIT_SUCCESS);
 			break;
@@ -18,6 +18,7 @@
 
 #include "bcm_tag.h"
 #include "imagetag_cmdline.h"
+#include "imgasm.h"
 
 #define DEADCODE			0xDEADC0DE
 
@@ -78,42 +79,15 @@ uint32_t crc32(uint32_t crc, uint8_t *data, size_t len)
 	return crc;
 }
 
-uint32_t compute_crc32(uint32_t crc, FILE *binfile, size_t compute_start, size_t compute_len)
+/* Sizes a layout part, rounded up to a multiple of block_size if given */
+static size_t part_size(struct imgasm_part *part, uint32_t block_size)
 {
-	uint8_t readbuf[1024];
-	size_t read;
+	size_t len = part->size;
 
-	fseek(binfile, compute_start, SEEK_SET);
+	if (block_size && (len % block_size) > 0)
+		len = ((len / block_size) + 1) * block_size;
 
-	/* read block of 1024 bytes */
-	while (binfile && !feof(binfile) && !ferror(binfile) && (compute_len >= sizeof(readbuf))) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), binfile);
-		crc = crc32(crc, readbuf, read);
-		compute_len = compute_len - read;
-	}
-
-	/* Less than 1024 bytes remains, read compute_len bytes */
-	if (binfile && !feof(binfile) && !ferror(binfile) && (compute_len > 0)) {
-		read = fread(readbuf, sizeof(uint8_t), compute_len, binfile);
-		crc = crc32(crc, readbuf, read);
-	}
-
-	return crc;
-}
-
-size_t getlen(FILE *fp)
-{
-	size_t retval, curpos;
-
-	if (!fp)
-		return 0;
-
-	curpos = ftell(fp);
-	fseek(fp, 0, SEEK_END);
-	retval = ftell(fp);
-	fseek(fp, curpos, SEEK_SET);
-
-	return retval;
+	return len;
 }
 
 int tagfile(const char *kernel, const char *rootfs, const char *bin, \
@@ -123,61 +97,81 @@ int tagfile(const char *kernel, const char *rootfs, const char *bin, \
 {
 	struct bcm_tag tag;
 	struct kernelhdr khdr;
-	FILE *kernelfile = NULL, *rootfsfile = NULL, *binfile = NULL, *cfefile = NULL;
 	size_t cfeoff, cfelen, kerneloff, kernellen, rootfsoff, rootfslen, \
-	  read, imagelen, rootfsoffpadlen = 0, kernelfslen, kerneloffpadlen = 0, oldrootfslen;
-	uint8_t readbuf[1024];
-	uint32_t imagecrc = IMAGETAG_CRC_START;
-	uint32_t kernelcrc = IMAGETAG_CRC_START;
-	uint32_t rootfscrc = IMAGETAG_CRC_START;
-	uint32_t kernelfscrc = IMAGETAG_CRC_START;
+	  imagelen, rootfsoffpadlen = 0, oldrootfslen;
 	uint32_t fwaddr = 0;
-	uint8_t crc_val;
 	const uint32_t deadcode = htonl(DEADCODE);
 	int i;
 	int is_pirelli = 0;
+	int nparts = 0, ret = 1;
 
+	/*
+	 * The image is laid out as parts, each input mapped rather than
+	 * copied, and the tag's CRCs are taken over the mapped parts
+	 * before it goes out in front of them.
+	 */
+	struct imgasm_part parts[8], *cfe_part, *kernel_part, *rootfs_part;
+	struct imgasm_part *khdr_part, *gap_part, *deadcode_part, *pad_part;
+	struct imgasm_crc crcs[4];	/* image, kernel, kernelfs, rootfs */
 
 	memset(&tag, 0, sizeof(struct bcm_tag));
+	memset(parts, 0, sizeof(parts));
 
 	if (!kernel || !rootfs) {
 		fprintf(stderr, "imagetag can't create an image without both kernel and rootfs\n");
 	}
 
-	if (kernel && !(kernelfile = fopen(kernel, "rb"))) {
+	if (kernel && access(kernel, R_OK)) {
 		fprintf(stderr, "Unable to open kernel \"%s\"\n", kernel);
 		return 1;
 	}
 
-	if (rootfs && !(rootfsfile = fopen(rootfs, "rb"))) {
+	if (rootfs && access(rootfs, R_OK)) {
 		fprintf(stderr, "Unable to open rootfs \"%s\"\n", rootfs);
 		return 1;
 	}
 
-	if (!bin || !(binfile = fopen(bin, "wb+"))) {
+	if (!bin) {
 		fprintf(stderr, "Unable to open output file \"%s\"\n", bin);
 		return 1;
 	}
 
+	/* tag, [cfe], kernel header, kernel, gap, rootfs or tag, [cfe], rootfs, kernel header, kernel */
+	parts[nparts].data = &tag;
+	parts[nparts++].len = sizeof(tag);
+	cfe_part = &parts[nparts++];
+	if (!args->root_first_flag) {
+	  khdr_part = &parts[nparts++];
+	  kernel_part = &parts[nparts++];
+	  gap_part = &parts[nparts++];
+	  rootfs_part = &parts[nparts++];
+	} else {
+	  rootfs_part = &parts[nparts++];
+	  khdr_part = &parts[nparts++];
+	  kernel_part = &parts[nparts++];
+	  gap_part = NULL;
+	}
+	deadcode_part = &parts[nparts++];
+	pad_part = &parts[nparts++];
+
 	if ((args->cfe_given) && (args->cfe_arg)) {
-	  if (!(cfefile = fopen(args->cfe_arg, "rb"))) {
+	  if (access(args->cfe_arg, R_OK)) {
 		fprintf(stderr, "Unable to open CFE file \"%s\"\n", args->cfe_arg);
+	  } else {
+		cfe_part->file = args->cfe_arg;
 	  }
 	}
+	kernel_part->file = kernel;
+	rootfs_part->file = rootfs;
+	pad_part->fill = 0xff;
+
+	if (imgasm_map("imagetag", parts, nparts))
+		return 1;
 
 	fwaddr = flash_start + image_offset;
-	if (cfefile) {
+	if (cfe_part->file) {
 	  cfeoff = flash_start;		  
-	  cfelen = getlen(cfefile);
-	  /* Seek to the start of the file after tag */
-	  fseek(binfile, sizeof(tag), SEEK_SET);
-	  
-	  /* Write the cfe */
-	  while (cfefile && !feof(cfefile) && !ferror(cfefile)) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), cfefile);
-		fwrite(readbuf, sizeof(uint8_t), read, binfile);
-	  }
-
+	  cfelen = cfe_part->size;
 	} else {
 	  cfeoff = 0;
 	  cfelen = 0;
@@ -187,13 +181,15 @@ int tagfile(const char *kernel, const char *rootfs, const char *bin, \
 	  /* Build the kernel address and length (doesn't need to be aligned, read only) */
 	  kerneloff = fwaddr + sizeof(tag);
 	  
-	  kernellen = getlen(kernelfile);
+	  kernellen = kernel_part->size;
 	  
 	  if (!args->kernel_file_has_header_flag) {
 		/* Build the kernel header */
 		khdr.loadaddr	= htonl(load_address);
 		khdr.entry	= htonl(entry);
 		khdr.lzmalen	= htonl(kernellen);
+		khdr_part->data = &khdr;
+		khdr_part->size = khdr_part->len = sizeof(khdr);
 		
 		/* Increase the kernel size by the header size */
 		kernellen += sizeof(khdr);	  
@@ -202,60 +198,41 @@ int tagfile(const char *kernel, const char *rootfs, const char *bin, \
 	  /* Build the rootfs address and length (start and end do need to be aligned on flash erase block boundaries */
 	  rootfsoff = kerneloff + kernellen;
 	  rootfsoff = (rootfsoff % block_size) > 0 ? (((rootfsoff / block_size) + 1) * block_size) : rootfsoff;
-	  rootfslen = getlen(rootfsfile);
-	  rootfslen = ( (rootfslen % block_size) > 0 ? (((rootfslen / block_size) + 1) * block_size) : rootfslen );
+	  rootfslen = part_size(rootfs_part, block_size);
 	  imagelen = rootfsoff + rootfslen - kerneloff + sizeof(deadcode);
 	  rootfsoffpadlen = rootfsoff - (kerneloff + kernellen);
-	  
-	  /* Seek to the start of the kernel */
-	  fseek(binfile, kerneloff - fwaddr + cfelen, SEEK_SET);
-	  
-	  /* Write the kernel header */
-	  fwrite(&khdr, sizeof(khdr), 1, binfile);
-	  
-	  /* Write the kernel */
-	  while (kernelfile && !feof(kernelfile) && !ferror(kernelfile)) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), kernelfile);
-		fwrite(readbuf, sizeof(uint8_t), read, binfile);
-	  }
 
-	  /* Write the RootFS */
-	  fseek(binfile, rootfsoff - fwaddr + cfelen, SEEK_SET);
-	  while (rootfsfile && !feof(rootfsfile) && !ferror(rootfsfile)) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), rootfsfile);
-		fwrite(readbuf, sizeof(uint8_t), read, binfile);
-	  }
+	  /* The rootfs starts after a gap to its aligned offset and is zero padded to a whole block */
+	  gap_part->len = rootfsoffpadlen;
+	  rootfs_part->len = rootfslen;
 
 	  /* Align image to specified erase block size and append deadc0de */
 	  printf("Data alignment to %dk with 'deadc0de' appended\n", block_size/1024);
-	  fseek(binfile, rootfsoff + rootfslen - fwaddr + cfelen, SEEK_SET);
-	  fwrite(&deadcode, sizeof(uint32_t), 1, binfile);
+	  deadcode_part->data = &deadcode;
+	  deadcode_part->size = deadcode_part->len = sizeof(deadcode);
 
 	  oldrootfslen = rootfslen;
 	  if (args->pad_given) {
-		uint32_t allfs = 0xffffffff;
 		uint32_t pad_size = args->pad_arg * 1024 * 1024;
 
 		printf("Padding image to %d bytes ...\n", pad_size);
 		while (imagelen < pad_size) {
-			fwrite(&allfs, sizeof(uint32_t), 1, binfile);
+			pad_part->len += 4;
 			imagelen += 4;
 			rootfslen += 4;
 		}
 	  }
 
-	  /* Flush the binfile buffer so that when we read from file, it contains
-	   * everything in the buffer
-	   */
-	  fflush(binfile);
-
-	  /* Compute the crc32 of the entire image (deadC0de included) */
-	  imagecrc = compute_crc32(imagecrc, binfile, kerneloff - fwaddr + cfelen, imagelen);
-	  /* Compute the crc32 of the kernel and padding between kernel and rootfs) */
-	  kernelcrc = compute_crc32(kernelcrc, binfile, kerneloff - fwaddr + cfelen, kernellen + rootfsoffpadlen);
-	  /* Compute the crc32 of the kernel and padding between kernel and rootfs) */
-	  kernelfscrc = compute_crc32(kernelfscrc, binfile, kerneloff - fwaddr + cfelen, kernellen + rootfsoffpadlen + rootfslen + sizeof(deadcode));
-	  /* Compute the crc32 of the flashImageStart to rootLength.
+	  /* The crc32 of the entire image (deadC0de included) */
+	  crcs[0].start = kerneloff - fwaddr + cfelen;
+	  crcs[0].len = imagelen;
+	  /* The crc32 of the kernel and padding between kernel and rootfs) */
+	  crcs[1].start = kerneloff - fwaddr + cfelen;
+	  crcs[1].len = kernellen + rootfsoffpadlen;
+	  /* The crc32 of the kernel and padding between kernel and rootfs) */
+	  crcs[2].start = kerneloff - fwaddr + cfelen;
+	  crcs[2].len = kernellen + rootfsoffpadlen + rootfslen + sizeof(deadcode);
+	  /* The crc32 of the flashImageStart to rootLength.
 	   * The broadcom firmware assumes the rootfs starts the image,
 	   * therefore uses the rootfs start to determine where to flash
 	   * the image.  Since we have the kernel first we have to give
@@ -264,70 +241,53 @@ int tagfile(const char *kernel, const char *rootfs, const char *bin, \
 	   * length to determine the length of image to flash and thus
 	   * needs to be rootfs + deadcode
 	   */
-	  rootfscrc = compute_crc32(rootfscrc, binfile, kerneloff - fwaddr + cfelen, rootfslen + sizeof(deadcode));
+	  crcs[3].start = kerneloff - fwaddr + cfelen;
+	  crcs[3].len = rootfslen + sizeof(deadcode);
 
 	} else {
 	  /* Build the kernel address and length (doesn't need to be aligned, read only) */
 	  rootfsoff = fwaddr + sizeof(tag);
-	  oldrootfslen = getlen(rootfsfile);
-	  rootfslen = oldrootfslen;
-	  rootfslen = ( (rootfslen % block_size) > 0 ? (((rootfslen / block_size) + 1) * block_size) : rootfslen );
-	  kerneloffpadlen = rootfslen - oldrootfslen;
+	  oldrootfslen = rootfs_part->size;
+	  rootfslen = part_size(rootfs_part, block_size);
 	  oldrootfslen = rootfslen;
 
+	  /* The kernel follows the rootfs zero padded to a whole block */
+	  rootfs_part->len = rootfslen;
+
 	  kerneloff = rootfsoff + rootfslen;
-	  kernellen = getlen(kernelfile);
+	  kernellen = kernel_part->size;
 
 	  imagelen = cfelen + rootfslen + kernellen;
 	  
-	  /* Seek to the start of the kernel */
-	  fseek(binfile, kerneloff - fwaddr + cfelen, SEEK_SET);
-	  
 	  if (!args->kernel_file_has_header_flag) {
 		/* Build the kernel header */
 		khdr.loadaddr	= htonl(load_address);
 		khdr.entry	= htonl(entry);
 		khdr.lzmalen	= htonl(kernellen);
-		
-		/* Write the kernel header */
-		fwrite(&khdr, sizeof(khdr), 1, binfile);
+		khdr_part->data = &khdr;
+		khdr_part->size = khdr_part->len = sizeof(khdr);
 	  
 		/* Increase the kernel size by the header size */
 		kernellen += sizeof(khdr);	  
 	  }
-	  
-	  /* Write the kernel */
-	  while (kernelfile && !feof(kernelfile) && !ferror(kernelfile)) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), kernelfile);
-		fwrite(readbuf, sizeof(uint8_t), read, binfile);
-	  }
-
-	  /* Write the RootFS */
-	  fseek(binfile, rootfsoff - fwaddr + cfelen, SEEK_SET);
-	  while (rootfsfile && !feof(rootfsfile) && !ferror(rootfsfile)) {
-		read = fread(readbuf, sizeof(uint8_t), sizeof(readbuf), rootfsfile);
-		fwrite(readbuf, sizeof(uint8_t), read, binfile);
-	  }
 
-	  /* Flush the binfile buffer so that when we read from file, it contains
-	   * everything in the buffer
-	   */
-	  fflush(binfile);
-
-	  /* Compute the crc32 of the entire image (deadC0de included) */
-	  imagecrc = compute_crc32(imagecrc, binfile, sizeof(tag), imagelen);
-	  /* Compute the crc32 of the kernel and padding between kernel and rootfs) */
-	  kernelcrc = compute_crc32(kernelcrc, binfile, kerneloff - fwaddr + cfelen, kernellen + rootfsoffpadlen);
-	  kernelfscrc = compute_crc32(kernelfscrc, binfile, rootfsoff - fwaddr + cfelen, kernellen + rootfslen);
-	  rootfscrc = compute_crc32(rootfscrc, binfile, rootfsoff - fwaddr + cfelen, rootfslen);
+	  /* The crc32 of the entire image (deadC0de included) */
+	  crcs[0].start = sizeof(tag);
+	  crcs[0].len = imagelen;
+	  /* The crc32 of the kernel and padding between kernel and rootfs) */
+	  crcs[1].start = kerneloff - fwaddr + cfelen;
+	  crcs[1].len = kernellen + rootfsoffpadlen;
+	  crcs[2].start = rootfsoff - fwaddr + cfelen;
+	  crcs[2].len = kernellen + rootfslen;
+	  crcs[3].start = rootfsoff - fwaddr + cfelen;
+	  crcs[3].len = rootfslen;
 	}
 
-	/* Close the files */
-	if (cfefile) {
-	  fclose(cfefile);
-	}
-	fclose(kernelfile);
-	fclose(rootfsfile);
+	/* All four are taken over the mapped parts, side by side */
+	for (i = 0; i < 4; i++)
+	  crcs[i].crc = IMAGETAG_CRC_START;
+	if (imgasm_crc32("imagetag", parts, nparts, crcs, 4))
+	  goto out;
 
 	/* Build the tag */
 	strncpy(tag.tagVersion, args->tag_version_arg, sizeof(tag.tagVersion) - 1);
@@ -403,23 +363,23 @@ int tagfile(const char *kernel, const char *rootfs, const char *bin, \
 	}
 
 	if ( !is_pirelli ) {
-	  int2tag(tag.imageCRC, kernelfscrc);
+	  int2tag(tag.imageCRC, crcs[2].crc);
 	} else {
-	  int2tag(tag.imageCRC, kernelcrc);
+	  int2tag(tag.imageCRC, crcs[1].crc);
 	}
 
-	int2tag(&(tag.rootfsCRC[0]), rootfscrc);
-	int2tag(tag.kernelCRC, kernelcrc);
-	int2tag(tag.fskernelCRC, kernelfscrc);
+	int2tag(&(tag.rootfsCRC[0]), crcs[3].crc);
+	int2tag(tag.kernelCRC, crcs[1].crc);
+	int2tag(tag.fskernelCRC, crcs[2].crc);
 	int2tag(tag.headerCRC, crc32(IMAGETAG_CRC_START, (uint8_t*)&tag, sizeof(tag) - 20));
 
-	fseek(binfile, 0L, SEEK_SET);
-	fwrite(&tag, sizeof(uint8_t), sizeof(tag), binfile);
-
-    fflush(binfile);
-	fclose(binfile);
+	/* Write the tag, then everything else straight from the inputs */
+	if (imgasm_write("imagetag", bin, parts, nparts) == 0)
+	  ret = 0;
 
-	return 0;
+out:
+	imgasm_unmap(parts, nparts);
+	return ret;
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * imgasm.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "../crc32/crc32buf.h"
+#include "imgasm.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX		1024
+#endif
+
+#define IMGASM_FILLSIZE	(64 * 1024)
+
+#define ERR(fmt, ...) do { \
+	fflush(0); \
+	fprintf(stderr, "[%s] *** error: " fmt "\n", \
+			progname, ## __VA_ARGS__ ); \
+} while (0)
+
+#define ERRS(fmt, ...) do { \
+	int save = errno; \
+	fflush(0); \
+	fprintf(stderr, "[%s] *** error: " fmt ": %s\n", \
+			progname, ## __VA_ARGS__, strerror(save)); \
+} while (0)
+
+struct imgasm_job {
+	struct imgasm_part *parts;
+	int nparts;
+	struct imgasm_sum *sum;
+	struct imgasm_crc *range;
+	pthread_t thread;
+};
+
+static size_t part_len(struct imgasm_part *part)
+{
+	return part->len > part->size ? part->len : part->size;
+}
+
+size_t imgasm_length(struct imgasm_part *parts, int nparts)
+{
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < nparts; i++)
+		total += part_len(&parts[i]);
+
+	return total;
+}
+
+/* Maps the input files and sizes every part; a file longer than its part is an error */
+int imgasm_map(const char *progname, struct imgasm_part *parts, int nparts)
+{
+	struct imgasm_part *part;
+	struct stat st;
+	int i, fd;
+
+	for (i = 0; i < nparts; i++) {
+		part = &parts[i];
+		part->map = NULL;
+		part->maplen = 0;
+		part->size = part->data ? part->len : 0;
+
+		if (part->file == NULL)
+			continue;
+
+		fd = open(part->file, O_RDONLY);
+		if (fd < 0) {
+			ERRS("could not open \"%s\" for reading", part->file);
+			goto err;
+		}
+
+		if (fstat(fd, &st)) {
+			ERRS("stat failed on %s", part->file);
+			close(fd);
+			goto err;
+		}
+
+		if (part->len && (size_t) st.st_size > part->len) {
+			ERR("file '%s' is too big - max size: 0x%08lX (exceeds %lu bytes)",
+			    part->file, (unsigned long) part->len,
+			    (unsigned long) (st.st_size - part->len));
+			close(fd);
+			goto err;
+		}
+
+		part->size = st.st_size;
+		if (st.st_size > 0) {
+			part->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+					 fd, 0);
+			if (part->map == MAP_FAILED) {
+				ERRS("unable to map %s", part->file);
+				part->map = NULL;
+				close(fd);
+				goto err;
+			}
+			part->maplen = st.st_size;
+		}
+		close(fd);
+	}
+
+	return 0;
+
+err:
+	imgasm_unmap(parts, i);
+	return -1;
+}
+
+void imgasm_unmap(struct imgasm_part *parts, int nparts)
+{
+	int i;
+
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].map)
+			munmap(parts[i].map, parts[i].maplen);
+		parts[i].map = NULL;
+		parts[i].maplen = 0;
+	}
+}
+
+static const uint8_t *part_bytes(struct imgasm_part *part)
+{
+	return part->file ? part->map : part->data;
+}
+
+static void *imgasm_sum_job(void *arg)
+{
+	struct imgasm_job *job = arg;
+	uint8_t fill[IMGASM_FILLSIZE];
+	struct imgasm_part *part;
+	size_t pad, n;
+	int i;
+
+	for (i = 0; i < job->nparts; i++) {
+		part = &job->parts[i];
+		if (part->sum != job->sum)
+			continue;
+
+		if (part->size)
+			job->sum->update(job->sum->ctx, part_bytes(part),
+					 part->size);
+
+		pad = part_len(part) - part->size;
+		if (pad)
+			memset(fill, part->fill, pad < sizeof(fill) ?
+			       pad : sizeof(fill));
+		for (; pad; pad -= n) {
+			n = pad < sizeof(fill) ? pad : sizeof(fill);
+			job->sum->update(job->sum->ctx, fill, n);
+		}
+	}
+
+	return NULL;
+}
+
+/* Runs every checksum of the layout, one thread per distinct imgasm_sum */
+int imgasm_checksum(const char *progname, struct imgasm_part *parts, int nparts)
+{
+	struct imgasm_job *jobs;
+	int i, j, njobs = 0, ret = 0;
+
+	jobs = calloc(nparts, sizeof(*jobs));
+	if (!jobs) {
+		ERR("no memory for checksum jobs");
+		return -1;
+	}
+
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].sum == NULL)
+			continue;
+
+		for (j = 0; j < njobs; j++)
+			if (jobs[j].sum == parts[i].sum)
+				break;
+
+		if (j == njobs) {
+			jobs[njobs].parts = parts;
+			jobs[njobs].nparts = nparts;
+			jobs[njobs].sum = parts[i].sum;
+			njobs++;
+		}
+	}
+
+	/* the last job, and any that can't get a thread, run here */
+	for (i = 0; i < njobs - 1; i++)
+		if (pthread_create(&jobs[i].thread, NULL, imgasm_sum_job,
+				   &jobs[i]))
+			break;
+
+	for (j = i; j < njobs; j++)
+		imgasm_sum_job(&jobs[j]);
+
+	while (i-- > 0)
+		if (pthread_join(jobs[i].thread, NULL))
+			ret = -1;
+
+	free(jobs);
+	return ret;
+}
+
+static void *imgasm_crc_job(void *arg)
+{
+	struct imgasm_job *job = arg;
+	struct imgasm_crc *r = job->range;
+	uint8_t fill[IMGASM_FILLSIZE];
+	struct imgasm_part *part;
+	size_t off = 0, end = r->start + r->len, a, b, n, plen;
+	uint32_t crc = r->crc;
+	int i, filled = -1;
+
+	for (i = 0; i < job->nparts && off < end; i++, off += plen) {
+		part = &job->parts[i];
+		plen = part_len(part);
+
+		a = r->start > off ? r->start - off : 0;
+		b = end - off < plen ? end - off : plen;
+		if (a >= b)
+			continue;
+
+		if (a < part->size) {
+			n = (b < part->size ? b : part->size) - a;
+			crc = crc32_update(crc, part_bytes(part) + a, n);
+			a += n;
+		}
+
+		/* padding: zeros can be skipped over, other bytes are fed */
+		if (a < b && part->fill == 0) {
+			crc = crc32_shift(crc, b - a);
+		} else if (a < b) {
+			if (filled != part->fill)
+				memset(fill, part->fill, sizeof(fill));
+			filled = part->fill;
+			for (; a < b; a += n) {
+				n = b - a < sizeof(fill) ? b - a : sizeof(fill);
+				crc = crc32_update(crc, fill, n);
+			}
+		}
+	}
+
+	r->crc = crc;
+	return NULL;
+}
+
+/* Computes CRC-32 registers over ranges of the image, each on a thread of its own */
+int imgasm_crc32(const char *progname, struct imgasm_part *parts, int nparts,
+		 struct imgasm_crc *ranges, int nranges)
+{
+	struct imgasm_job *jobs;
+	int i, j, ret = 0;
+
+	if (nranges <= 0)
+		return 0;
+
+	jobs = calloc(nranges, sizeof(*jobs));
+	if (!jobs) {
+		ERR("no memory for checksum jobs");
+		return -1;
+	}
+
+	for (i = 0; i < nranges; i++) {
+		jobs[i].parts = parts;
+		jobs[i].nparts = nparts;
+		jobs[i].range = &ranges[i];
+	}
+
+	for (i = 0; i < nranges - 1; i++)
+		if (pthread_create(&jobs[i].thread, NULL, imgasm_crc_job,
+				   &jobs[i]))
+			break;
+
+	for (j = i; j < nranges; j++)
+		imgasm_crc_job(&jobs[j]);
+
+	while (i-- > 0)
+		if (pthread_join(jobs[i].thread, NULL))
+			ret = -1;
+
+	free(jobs);
+	return ret;
+}
+
+static int writev_all(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t n;
+
+	while (cnt) {
+		n = writev(fd, iov, cnt);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+
+		for (; cnt && (size_t) n >= iov->iov_len; iov++, cnt--)
+			n -= iov->iov_len;
+		if (cnt) {
+			iov->iov_base = (uint8_t *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Streams the parts out in order, gathered straight from the mapped
+ * inputs, with padding taken from one buffer per fill byte; "-" is stdout
+ */
+int imgasm_write(const char *progname, const char *ofname,
+		 struct imgasm_part *parts, int nparts)
+{
+	struct iovec iov[IOV_MAX];
+	uint8_t *fill[256] = { NULL };
+	struct imgasm_part *part;
+	size_t pad, n;
+	int fd, i, cnt = 0, ret = -1;
+
+	if (strcmp(ofname, "-") == 0)
+		fd = STDOUT_FILENO;
+	else
+		fd = open(ofname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		ERRS("could not open \"%s\" for writing", ofname);
+		return -1;
+	}
+
+	for (i = 0; i < nparts; i++) {
+		part = &parts[i];
+
+		if (cnt == IOV_MAX) {
+			if (writev_all(fd, iov, cnt))
+				goto err;
+			cnt = 0;
+		}
+
+		if (part->size) {
+			iov[cnt].iov_base = (void *) part_bytes(part);
+			iov[cnt].iov_len = part->size;
+			cnt++;
+		}
+
+		pad = part_len(part) - part->size;
+		if (pad && fill[part->fill] == NULL) {
+			fill[part->fill] = malloc(IMGASM_FILLSIZE);
+			if (fill[part->fill] == NULL) {
+				errno = ENOMEM;
+				goto err;
+			}
+			memset(fill[part->fill], part->fill, IMGASM_FILLSIZE);
+		}
+
+		for (; pad; pad -= n) {
+			if (cnt == IOV_MAX) {
+				if (writev_all(fd, iov, cnt))
+					goto err;
+				cnt = 0;
+			}
+
+			n = pad < IMGASM_FILLSIZE ? pad : IMGASM_FILLSIZE;
+			iov[cnt].iov_base = fill[part->fill];
+			iov[cnt].iov_len = n;
+			cnt++;
+		}
+	}
+
+	if (cnt && writev_all(fd, iov, cnt))
+		goto err;
+
+	ret = 0;
+
+err:
+	if (ret)
+		ERRS("unable to write to file %s", ofname);
+	if (fd != STDOUT_FILENO && close(fd) && !ret) {
+		ERRS("unable to write to file %s", ofname);
+		ret = -1;
+	}
+	if (ret && fd != STDOUT_FILENO)
+		unlink(ofname);
+	for (i = 0; i < 256; i++)
+		free(fill[i]);
+
+	return ret;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * imgasm.h
+ */
+
+#ifndef IMGASM_H
+#define IMGASM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * A firmware image described as a list of parts written one after the
+ * other: bytes built by the tool (headers, trailers), input files and
+ * runs of padding.  Input files are mapped rather than read into one
+ * buffer, and the checksums the layout asks for are computed before
+ * anything is written, so headers holding them can still be filled in
+ * and the output streamed out in a single pass.
+ */
+
+/*
+ * Ranges given to imgasm_crc32() need not line up with the parts, for
+ * headers whose CRCs cover odd spans of the image; each is run on a
+ * thread of its own over the mapped parts.
+ */
+
+/* Feeds len bytes to a checksum; ctx is the tool's running state */
+typedef void (*imgasm_update_fn)(void *ctx, const uint8_t *buf, size_t len);
+
+struct imgasm_sum {
+	imgasm_update_fn update;
+	void *ctx;
+};
+
+struct imgasm_part {
+	const char *file;	/* input file to stream, or NULL */
+	const void *data;	/* bytes to copy if there is no file, or NULL for fill only */
+	size_t len;		/* part length; a file is padded up to it, 0 keeps the file's own size */
+	uint8_t fill;		/* padding byte */
+	struct imgasm_sum *sum;	/* checksum fed the whole part, padding included, or NULL */
+
+	/* set by imgasm_map() */
+	size_t size;		/* bytes of file or data, the rest of len is padding */
+	uint8_t *map;
+	size_t maplen;
+};
+
+/* The CRC-32 register (as crc32_update() keeps it) over a byte range of the image */
+struct imgasm_crc {
+	size_t start;
+	size_t len;		/* clipped to the end of the image */
+	uint32_t crc;		/* start value in, result out */
+};
+
+/*
+ * Parts sharing an imgasm_sum are fed to it in layout order by one
+ * thread; each distinct sum gets a thread of its own, so sums that can
+ * be combined afterwards (additive sums, CRCs) should be given one per
+ * part.
+ */
+int imgasm_map(const char *progname, struct imgasm_part *parts, int nparts);
+int imgasm_checksum(const char *progname, struct imgasm_part *parts, int nparts);
+int imgasm_crc32(const char *progname, struct imgasm_part *parts, int nparts,
+		 struct imgasm_crc *ranges, int nranges);
+int imgasm_write(const char *progname, const char *ofname,
+		 struct imgasm_part *parts, int nparts);
+void imgasm_unmap(struct imgasm_part *parts, int nparts);
+size_t imgasm_length(struct imgasm_part *parts, int nparts);
+
+#endif
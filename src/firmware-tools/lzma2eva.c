@@ -20,18 +20,35 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <zlib.h> /* crc32 */
 
+#include "../lzma/C/7zip/Compress/LZMA_Lib/LzmaStream.h"
+
 #define checksum_add32(csum, data) \
   csum += ((uint8_t *)&data)[0]; \
   csum += ((uint8_t *)&data)[1]; \
   csum += ((uint8_t *)&data)[2]; \
   csum += ((uint8_t *)&data)[3];
 
+/* the compressed data as it goes out: its size, crc32 and byte sum */
+struct eva_data {
+  FILE *out;
+  uint32_t size;
+  uint32_t crc32;
+  uint32_t sum;
+};
+
 void
 usage(void)
 {
-  fprintf(stderr, "usage: lzma2eva <loadadddr> <entry> <lzmafile> <evafile>\n");
+  fprintf(stderr, "usage: lzma2eva [-z [-d <dictbits>] [-c <lc>] [-l <lp>] [-p <pb>]]\n"
+                  "                <loadadddr> <entry> <lzmafile> <evafile>\n"
+                  "  -z  compress <lzmafile>, a plain kernel, into the EVA file\n");
   exit(1);
 }
 
@@ -42,18 +59,40 @@ pexit(const char *msg)
   exit(1);
 }
 
+int
+eva_data_write(void *ctx, const void *buf, size_t len)
+{
+  struct eva_data *data = ctx;
+  const uint8_t *p = buf;
+  uint32_t sum = 0;
+  size_t i;
+
+  if (len != fwrite(buf, 1, len, data->out))
+    return -1;
+  data->size += len;
+  data->crc32 = crc32(data->crc32, buf, len);
+  for (i = 0; i < len; ++i)
+    sum += p[i];
+  data->sum += sum;
+  return 0;
+}
+
 int
 main(int argc, char *argv[])
 {
 
   const char *infile, *outfile;
   FILE *in, *out;
-  static const uint8_t buf[4096];
+  static uint8_t buf[65536];
   size_t elems;
+  int opt, compress = 0;
 
   uint8_t properties;
   uint32_t dictsize;
   uint64_t datasize;
+  unsigned dictbits = 23;
+  int lc = 3, lp = 0, pb = 2;
+  uint8_t *kernel = NULL;
 
   uint32_t magic = 0xfeed1281L;
   uint32_t reclength = 0;
@@ -65,19 +104,42 @@ main(int argc, char *argv[])
   uint32_t compsize = 0;
   fpos_t compsizepos;
   uint32_t datasize32 = 0;
-  uint32_t datacrc32 = crc32(0, 0, 0);
+  struct eva_data data;
 
   uint32_t zero = 0;
   uint32_t entry = 0;
 
-  if (argc != 5)
+  while ((opt = getopt(argc, argv, "zd:c:l:p:")) != -1) {
+    switch (opt) {
+    case 'z':
+      compress = 1;
+      break;
+    case 'd':
+      dictbits = strtoul(optarg, 0, 0);
+      break;
+    case 'c':
+      lc = strtoul(optarg, 0, 0);
+      break;
+    case 'l':
+      lp = strtoul(optarg, 0, 0);
+      break;
+    case 'p':
+      pb = strtoul(optarg, 0, 0);
+      break;
+    default:
+      usage();
+    }
+  }
+  if (argc - optind != 4)
+    usage();
+  if (dictbits > 28 || lc > 8 || lp > 4 || pb > 4)
     usage();
 
   /* "parse" command line */
-  loadaddress = strtoul(argv[1], 0, 0);
-  entry = strtoul(argv[2], 0, 0);
-  infile = argv[3];
-  outfile = argv[4];
+  loadaddress = strtoul(argv[optind], 0, 0);
+  entry = strtoul(argv[optind + 1], 0, 0);
+  infile = argv[optind + 2];
+  outfile = argv[optind + 3];
 
   in = fopen(infile, "rb");
   if (!in)
@@ -86,13 +148,29 @@ main(int argc, char *argv[])
   if (!out)
     pexit("fopen");
 
-  /* read LZMA header */
-  if (1 != fread(&properties, sizeof properties, 1, in))
-    pexit("fread");
-  if (1 != fread(&dictsize, sizeof dictsize, 1, in))
-    pexit("fread");
-  if (1 != fread(&datasize, sizeof datasize, 1, in))
-    pexit("fread");
+  if (compress) {
+    /* the kernel is coded straight from its mapping */
+    struct stat st;
+
+    if (fstat(fileno(in), &st))
+      pexit("fstat");
+    datasize = st.st_size;
+    if (datasize) {
+      kernel = mmap(NULL, datasize, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+      if (kernel == MAP_FAILED)
+        pexit("mmap");
+    }
+    properties = (pb * 5 + lp) * 9 + lc;
+    dictsize = (uint32_t)1 << dictbits;
+  } else {
+    /* read LZMA header */
+    if (1 != fread(&properties, sizeof properties, 1, in))
+      pexit("fread");
+    if (1 != fread(&dictsize, sizeof dictsize, 1, in))
+      pexit("fread");
+    if (1 != fread(&datasize, sizeof datasize, 1, in))
+      pexit("fread");
+  }
 
   /* write EVA header */
   if (1 != fwrite(&magic, sizeof magic, 1, out))
@@ -107,6 +185,10 @@ main(int argc, char *argv[])
     pexit("fwrite");
 
   /* write EVA LZMA header */
+  data.out = out;
+  data.size = 0;
+  data.crc32 = crc32(0, 0, 0);
+  data.sum = 0;
   if (fgetpos(out, &compsizepos))
     pexit("fgetpos");
   if (1 != fwrite(&compsize, sizeof compsize, 1, out))
@@ -115,7 +197,7 @@ main(int argc, char *argv[])
   datasize32 = (uint32_t)datasize;
   if (1 != fwrite(&datasize32, sizeof datasize32, 1, out))
     pexit("fwrite");
-  if (1 != fwrite(&datacrc32, sizeof datacrc32, 1, out))
+  if (1 != fwrite(&data.crc32, sizeof data.crc32, 1, out))
     pexit("fwrite");
 
   /* write modified LZMA header */
@@ -126,52 +208,44 @@ main(int argc, char *argv[])
   if (1 != fwrite(&zero, 3, 1, out))
     pexit("fwrite");
 
-  /* copy compressed data, calculate crc32 */
-  while (0 < (elems = fread(&buf, sizeof buf[0], sizeof buf, in))) {
-    compsize += elems;
-    if (elems != fwrite(&buf, sizeof buf[0], elems, out))
+  /*
+   * Write the compressed data, from the encoder or the LZMA file, taking
+   * its crc32 and its share of the record checksum on the way out
+   */
+  if (compress) {
+    int err = lzma_stream_compress(kernel, datasize, dictbits, lc, lp, pb,
+                                   eva_data_write, &data);
+
+    if (err == Z_ERRNO)
       pexit("fwrite");
-    datacrc32 = crc32(datacrc32, buf, elems);
+    if (err != Z_OK) {
+      fprintf(stderr, "lzma2eva: compression failed (%d)\n", err);
+      exit(1);
+    }
+    if (kernel)
+      munmap(kernel, datasize);
+  } else {
+    while (0 < (elems = fread(&buf, sizeof buf[0], sizeof buf, in))) {
+      if (eva_data_write(&data, buf, elems))
+        pexit("fwrite");
+    }
+    if (ferror(in))
+      pexit("fread");
   }
-  if (ferror(in))
-    pexit("fread");
   fclose(in);
-
-  /* re-write record length */
-  reclength = compsize + 24;
-  if (fsetpos(out, &reclengthpos))
-    pexit("fsetpos");
-  if (1 != fwrite(&reclength, sizeof reclength, 1, out))
-    pexit("fwrite");
-
-  /* re-write EVA LZMA header including size and data crc */
-  if (fsetpos(out, &compsizepos))
-    pexit("fsetpos");
-  if (1 != fwrite(&compsize, sizeof compsize, 1, out))
-    pexit("fwrite");
-  if (1 != fwrite(&datasize32, sizeof datasize32, 1, out))
-    pexit("fwrite");
-  if (1 != fwrite(&datacrc32, sizeof datacrc32, 1, out))
-    pexit("fwrite");
+  compsize = data.size;
 
   /* calculate record checksum */
+  reclength = compsize + 24;
   checksum += reclength;
   checksum += loadaddress;
   checksum_add32(checksum, type);
   checksum_add32(checksum, compsize);
   checksum_add32(checksum, datasize32);
-  checksum_add32(checksum, datacrc32);
-  if (fseek(out, 0, SEEK_CUR))
-    pexit("fseek");
-  while (0 < (elems = fread(&buf, sizeof buf[0], sizeof buf, out))) {
-    size_t i;
-    for (i = 0; i < elems; ++i)
-      checksum += buf[i];
-  }
-  if (ferror(out))
-    pexit("fread");
-  if (fseek(out, 0, SEEK_CUR))
-    pexit("fseek");
+  checksum_add32(checksum, data.crc32);
+  checksum += properties;
+  checksum_add32(checksum, dictsize);
+  checksum += data.sum;
 
   checksum = ~checksum + 1;
   if (1 != fwrite(&checksum, sizeof checksum, 1, out))
@@ -183,6 +257,22 @@ main(int argc, char *argv[])
   if (1 != fwrite(&entry, sizeof entry, 1, out))
     pexit("fwrite");
 
+  /* re-write record length */
+  if (fsetpos(out, &reclengthpos))
+    pexit("fsetpos");
+  if (1 != fwrite(&reclength, sizeof reclength, 1, out))
+    pexit("fwrite");
+
+  /* re-write EVA LZMA header including size and data crc */
+  if (fsetpos(out, &compsizepos))
+    pexit("fsetpos");
+  if (1 != fwrite(&compsize, sizeof compsize, 1, out))
+    pexit("fwrite");
+  if (1 != fwrite(&datasize32, sizeof datasize32, 1, out))
+    pexit("fwrite");
+  if (1 != fwrite(&data.crc32, sizeof data.crc32, 1, out))
+    pexit("fwrite");
+
   if (fclose(out))
     pexit("fclose");
 
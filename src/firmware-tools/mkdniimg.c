@@ -16,7 +16,8 @@
 #include <getopt.h>     /* for getopt() */
 #include <stdarg.h>
 #include <errno.h>
-#include <sys/stat.h>
+
+#include "imgasm.h"
 
 #define DNI_HDR_LEN	128
 
@@ -68,17 +69,28 @@ void usage(int status)
 	exit(status);
 }
 
+static void sum8_update(void *ctx, const uint8_t *buf, size_t len)
+{
+	uint8_t *csum = ctx;
+
+	while (len--)
+		*csum += *buf++;
+}
+
 int main(int argc, char *argv[])
 {
 	int res = EXIT_FAILURE;
-	int buflen;
-	int err;
-	struct stat st;
-	char *buf;
-	int pos, rem, i;
-	uint8_t csum;
-
-	FILE *outfile, *infile;
+	char hdr[DNI_HDR_LEN];
+	int pos, rem;
+	uint8_t hdr_csum = 0, data_csum = 0, csum;
+	struct imgasm_sum hdr_sum = { sum8_update, &hdr_csum };
+	struct imgasm_sum data_sum = { sum8_update, &data_csum };
+	struct imgasm_part parts[] = {
+		{ .data = hdr, .len = DNI_HDR_LEN, .sum = &hdr_sum },
+		{ .sum = &data_sum },		/* the input file */
+		{ .data = &csum, .len = 1 },
+	};
+	int nparts = sizeof(parts) / sizeof(parts[0]);
 
 	progname = basename(argv[0]);
 
@@ -132,76 +144,31 @@ int main(int argc, char *argv[])
 		goto err;
 	}
 
-	err = stat(ifname, &st);
-	if (err){
-		ERRS("stat failed on %s", ifname);
-		goto err;
-	}
-
-	buflen = st.st_size + DNI_HDR_LEN + 1;
-	buf = malloc(buflen);
-	if (!buf) {
-		ERR("no memory for buffer\n");
-		goto err;
-	}
-
-	memset(buf, 0, DNI_HDR_LEN);
-	pos = snprintf(buf, DNI_HDR_LEN, "device:%s\nversion:V%s\nregion:%s\n",
+	memset(hdr, 0, DNI_HDR_LEN);
+	pos = snprintf(hdr, DNI_HDR_LEN, "device:%s\nversion:V%s\nregion:%s\n",
 		       board_id, version, region);
 	rem = DNI_HDR_LEN - pos;
 	if (pos >= 0 && rem > 1 && hd_id) {
-		snprintf(buf + pos, rem, "hd_id:%s\n", hd_id);
+		snprintf(hdr + pos, rem, "hd_id:%s\n", hd_id);
 	}
 
-	infile = fopen(ifname, "r");
-	if (infile == NULL) {
-		ERRS("could not open \"%s\" for reading", ifname);
-		goto err_free;
-	}
-
-	errno = 0;
-	fread(buf +  DNI_HDR_LEN, st.st_size, 1, infile);
-	if (errno != 0) {
-		ERRS("unable to read from file %s", ifname);
-		goto err_close_in;
-	}
+	parts[1].file = ifname;
+	if (imgasm_map(progname, parts, nparts))
+		goto err;
 
-	csum = 0;
-	for (i = 0; i < (st.st_size + DNI_HDR_LEN); i++)
-		csum += buf[i];
+	/* header and data are summed in parallel, the 8 bit sums just add up */
+	if (imgasm_checksum(progname, parts, nparts))
+		goto err_unmap;
 
-	csum = 0xff - csum;
-	buf[st.st_size + DNI_HDR_LEN] = csum;
+	csum = 0xff - (uint8_t)(hdr_csum + data_csum);
 
-	outfile = fopen(ofname, "w");
-	if (outfile == NULL) {
-		ERRS("could not open \"%s\" for writing", ofname);
-		goto err_close_in;
-	}
-
-	errno = 0;
-	fwrite(buf, buflen, 1, outfile);
-	if (errno) {
-		ERRS("unable to write to file %s", ofname);
-		goto err_close_out;
-	}
+	if (imgasm_write(progname, ofname, parts, nparts))
+		goto err_unmap;
 
 	res = EXIT_SUCCESS;
 
- out_flush:
-	fflush(outfile);
-
- err_close_out:
-	fclose(outfile);
-	if (res != EXIT_SUCCESS) {
-		unlink(ofname);
-	}
-
- err_close_in:
-	fclose(infile);
-
- err_free:
-	free(buf);
+ err_unmap:
+	imgasm_unmap(parts, nparts);
 
  err:
 	return res;
@@ -16,9 +16,10 @@
 #include <getopt.h>     /* for getopt() */
 #include <stdarg.h>
 #include <errno.h>
-#include <sys/stat.h>
+#include <byteswap.h>
 
 #include "sha1.h"
+#include "imgasm.h"
 
 #if (__BYTE_ORDER == __BIG_ENDIAN)
 #  define HOST_TO_BE32(x)	(x)
@@ -121,18 +122,24 @@ void usage(int status)
 	exit(status);
 }
 
+static void sha1_part_update(void *ctx, const uint8_t *buf, size_t len)
+{
+	sha1_update(ctx, (uchar *) buf, len);
+}
+
 int main(int argc, char *argv[])
 {
 	int res = EXIT_FAILURE;
-	int buflen;
-	int err;
-	struct stat st;
-	char *buf;
-	struct planex_hdr *hdr;
+	struct planex_hdr hdr;
 	sha1_context ctx;
 	uint32_t seed;
-
-	FILE *outfile, *infile;
+	struct imgasm_sum sum = { sha1_part_update, &ctx };
+	struct imgasm_part parts[] = {
+		{ .data = &hdr, .len = sizeof(hdr) },
+		{ .fill = 0xff, .sum = &sum },	/* the input, padded to datalen */
+		{ .len = 0x10000 - sizeof(hdr), .fill = 0xff },
+	};
+	int nparts = sizeof(parts) / sizeof(parts[0]);
 
 	progname = basename(argv[0]);
 
@@ -186,84 +193,34 @@ int main(int argc, char *argv[])
 		goto err;
 	}
 
-	err = stat(ifname, &st);
-	if (err){
-		ERRS("stat failed on %s", ifname);
-		goto err;
-	}
-
-	if (st.st_size > board->datalen) {
-		ERR("file '%s' is too big - max size: 0x%08X (exceeds %lu bytes)\n",
-		    ifname, board->datalen, st.st_size - board->datalen);
-		goto err;
-	}
-
-	buflen = board->datalen + 0x10000;
-	buf = malloc(buflen);
-	if (!buf) {
-		ERR("no memory for buffer\n");
-		goto err;
-	}
-
-	memset(buf, 0xff, buflen);
-	hdr = (struct planex_hdr *)buf;
-
-	hdr->datalen = HOST_TO_BE32(board->datalen);
-	hdr->unk1[0] = board->unk[0];
-	hdr->unk1[1] = board->unk[1];
+	memset(&hdr, 0xff, sizeof(hdr));
 
-	snprintf(hdr->version, sizeof(hdr->version), "%s", version);
+	hdr.datalen = HOST_TO_BE32(board->datalen);
+	hdr.unk1[0] = board->unk[0];
+	hdr.unk1[1] = board->unk[1];
 
-	infile = fopen(ifname, "r");
-	if (infile == NULL) {
-		ERRS("could not open \"%s\" for reading", ifname);
-		goto err_free;
-	}
+	snprintf(hdr.version, sizeof(hdr.version), "%s", version);
 
-	errno = 0;
-	fread(buf +  sizeof(*hdr), st.st_size, 1, infile);
-	if (errno != 0) {
-		ERRS("unable to read from file %s", ifname);
-		goto err_close_in;
-	}
+	parts[1].file = ifname;
+	parts[1].len = board->datalen;
+	if (imgasm_map(progname, parts, nparts))
+		goto err;
 
 	seed = HOST_TO_BE32(board->seed);
 	sha1_starts(&ctx);
 	sha1_update(&ctx, (uchar *) &seed, sizeof(seed));
-	sha1_update(&ctx, buf + sizeof(*hdr), board->datalen);
-	sha1_finish(&ctx, hdr->sha1sum);
+	if (imgasm_checksum(progname, parts, nparts))
+		goto err_unmap;
+	sha1_finish(&ctx, hdr.sha1sum);
 
-	outfile = fopen(ofname, "w");
-	if (outfile == NULL) {
-		ERRS("could not open \"%s\" for writing", ofname);
-		goto err_close_in;
-	}
-
-	errno = 0;
-	fwrite(buf, buflen, 1, outfile);
-	if (errno) {
-		ERRS("unable to write to file %s", ofname);
-		goto err_close_out;
-	}
+	if (imgasm_write(progname, ofname, parts, nparts))
+		goto err_unmap;
 
 	res = EXIT_SUCCESS;
 
- out_flush:
-	fflush(outfile);
-
- err_close_out:
-	fclose(outfile);
-	if (res != EXIT_SUCCESS) {
-		unlink(ofname);
-	}
-
- err_close_in:
-	fclose(infile);
-
- err_free:
-	free(buf);
+ err_unmap:
+	imgasm_unmap(parts, nparts);
 
  err:
 	return res;
 }
-
@@ -49,37 +49,12 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <string.h>
 #include <netinet/in.h>
 #include <inttypes.h>
 
-#define BPB 8 /* bits/byte */
-
-static uint32_t crc32[1<<BPB];
-
-static void init_crc32()
-{
-	const uint32_t poly = ntohl(0x2083b8ed);
-	int n;
-
-	for (n = 0; n < 1<<BPB; n++) {
-		uint32_t crc = n;
-		int bit;
-
-		for (bit = 0; bit < BPB; bit++)
-			crc = (crc & 1) ? (poly ^ (crc >> 1)) : (crc >> 1);
-		crc32[n] = crc;
-	}
-}
-
-static uint32_t crc32buf(unsigned char *buf, size_t len)
-{
-	uint32_t crc = 0xFFFFFFFF;
-
-	for (; len; len--, buf++)
-		crc = crc32[(uint8_t)crc ^ *buf] ^ (crc >> BPB);
-	return crc;
-}
+#include "../crc32/crc32buf.h"
 
 struct motorola {
 	uint32_t crc;	// crc32 of the remainder
@@ -119,7 +94,9 @@ int main(int argc, char **argv)
 	off_t len;	// of original firmware
 	int fd;
 	void *trx;	// pointer to original firmware (mmmapped)
-	struct motorola *firmware;	// pionter to prefix + copy of original firmware
+	struct motorola *firmware;	// pointer to the prefix of a stripped firmware
+	struct motorola hdr;	// prefix written in front of the original firmware
+	struct iovec iov[2];
 	uint32_t flags;
 
 	// verify parameters
@@ -137,8 +114,6 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	init_crc32();
-
 	if (strcmp(argv[1], "--strip") == 0)
 	{
 		const char *ugh = NULL;
@@ -198,27 +173,24 @@ int main(int argc, char **argv)
 		}
 
 
-		// create a firmware image in memory
-		// and copy the trx to it
-		firmware = malloc(sizeof(struct motorola) + len);
-		memcpy(&firmware[1], trx, len);
-
 		// setup the motorola headers
-		firmware->flags = htonl(flags);
+		hdr.flags = htonl(flags);
 
-		// CRC of flags + firmware
-		firmware->crc = htonl(crc32buf((unsigned char *)&firmware->flags, sizeof(firmware->flags) + len));
+		// CRC of flags + firmware, continued over the mapped trx
+		hdr.crc = htonl(crc32_update(crc32buf(&hdr.flags, sizeof(hdr.flags)), trx, len));
 
-		// write the firmware
+		// write the header, then the trx straight from the mapping
+		iov[0].iov_base = &hdr;
+		iov[0].iov_len = sizeof(hdr);
+		iov[1].iov_base = trx;
+		iov[1].iov_len = len;
 		if ((fd = open(argv[3], O_CREAT|O_WRONLY|O_TRUNC,0644)) < 0
-		|| write(fd, firmware, sizeof(struct motorola) + len) != sizeof(struct motorola) + len
+		|| writev(fd, iov, 2) != sizeof(struct motorola) + len
 		|| close(fd) < 0)
 		{
 			fprintf(stderr, "Error storing file %s: %s\n", argv[3], strerror(errno));
 			exit(2);
 		}
-
-		free(firmware);
 	}
 
 	munmap(trx,len);
@@ -28,14 +28,18 @@
 #include <stdint.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 
 #define DEF_NAND_PAGE_SIZE   2048
 #define DEF_NAND_OOB_SIZE     64
 #define DEF_NAND_ECC_OFFSET   0x28
 
+/* Built with NAND_ECC_LIB, only nand_calculate_ecc(), for src/kernbench */
+#ifndef NAND_ECC_LIB
 static int page_size = DEF_NAND_PAGE_SIZE;
 static int oob_size = DEF_NAND_OOB_SIZE;
 static int ecc_offset = DEF_NAND_ECC_OFFSET;
+#endif
 
 /*
  * Pre-calculated 256-way 1 byte column parity
@@ -59,32 +63,53 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+static inline uint8_t nand_parity32(uint32_t x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return (nand_ecc_precalc_table[x & 0xff] >> 6) & 1;
+}
+
 /**
  * nand_calculate_ecc - [NAND Interface] Calculate 3-byte ECC for 256-byte block
  * @dat:	raw data
  * @ecc_code:	buffer for ECC
+ *
+ * The table is linear in the byte, so the column parity is that of all
+ * bytes XORed together, and line parity bit n is the parity of the bytes
+ * whose offset has bit n set; both are gathered a 32-bit word at a time.
  */
 int nand_calculate_ecc(const uint8_t *dat,
 		       uint8_t *ecc_code)
 {
 	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	uint8_t b[4];
+	uint32_t w, all = 0, rp[6] = { 0, 0, 0, 0, 0, 0 };
 	int i;
 
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
+	/* XOR the words, and those at offsets with bits 2..7 set */
+	for(i = 0; i < 64; i++) {
+		memcpy(&w, dat + i * 4, 4);
+		all ^= w;
+		rp[0] ^= w & -(uint32_t) (i & 1);
+		rp[1] ^= w & -(uint32_t) ((i >> 1) & 1);
+		rp[2] ^= w & -(uint32_t) ((i >> 2) & 1);
+		rp[3] ^= w & -(uint32_t) ((i >> 3) & 1);
+		rp[4] ^= w & -(uint32_t) ((i >> 4) & 1);
+		rp[5] ^= w & -(uint32_t) ((i >> 5) & 1);
+	}
 
-	/* Build up column parity */
-	for(i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
+	/* Get CP0 - CP5 from table, bytes in memory order */
+	memcpy(b, &all, 4);
+	idx = nand_ecc_precalc_table[b[0] ^ b[1] ^ b[2] ^ b[3]];
+	reg1 = idx & 0x3f;
 
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
-		}
-	}
+	/* Line parity, inverted for reg2 when all bit XOR = 1 */
+	reg3 = (nand_ecc_precalc_table[b[1] ^ b[3]] >> 6) & 1;
+	reg3 |= ((nand_ecc_precalc_table[b[2] ^ b[3]] >> 6) & 1) << 1;
+	for(i = 0; i < 6; i++)
+		reg3 |= nand_parity32(rp[i]) << (i + 2);
+	reg2 = (idx & 0x40) ? ~reg3 : reg3;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
@@ -118,6 +143,7 @@ int nand_calculate_ecc(const uint8_t *dat,
 	return 0;
 }
 
+#ifndef NAND_ECC_LIB
 /*
  *  usage: bb-nandflash-ecc    start_address  size
  */
@@ -201,4 +227,4 @@ out:
 		free(page_data);
 	return ret;
 }
-
+#endif
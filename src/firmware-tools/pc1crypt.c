@@ -26,23 +26,14 @@
 #include <errno.h>
 #include <sys/stat.h>
 
+/*
+ * The key, as the eight big endian words the cipher reads it in, and the
+ * two registers carried from one byte to the next.
+ */
 struct pc1_ctx {
-	unsigned short	ax;
-	unsigned short	bx;
-	unsigned short	cx;
-	unsigned short	dx;
-	unsigned short	si;
-	unsigned short	tmp;
-	unsigned short	x1a2;
-	unsigned short	x1a0[8];
-	unsigned short	res;
-	unsigned short	i;
-	unsigned short	inter;
-	unsigned short	cfc;
-	unsigned short	cfd;
-	unsigned short	compte;
-	unsigned char	cle[17];
-	short		c;
+	uint16_t	key[8];
+	uint16_t	si;
+	uint16_t	x1a2;
 };
 
 static void pc1_finish(struct pc1_ctx *pc1)
@@ -51,141 +42,63 @@ static void pc1_finish(struct pc1_ctx *pc1)
 	memset(pc1, 0, sizeof(struct pc1_ctx));
 }
 
-static void pc1_code(struct pc1_ctx *pc1)
+static void pc1_init(struct pc1_ctx *pc1)
 {
-	pc1->dx = pc1->x1a2 + pc1->i;
-	pc1->ax = pc1->x1a0[pc1->i];
-	pc1->cx = 0x015a;
-	pc1->bx = 0x4e35;
-
-	pc1->tmp = pc1->ax;
-	pc1->ax = pc1->si;
-	pc1->si = pc1->tmp;
-
-	pc1->tmp = pc1->ax;
-	pc1->ax = pc1->dx;
-	pc1->dx = pc1->tmp;
-
-	if (pc1->ax != 0) {
-		pc1->ax = pc1->ax * pc1->bx;
-	}
-
-	pc1->tmp = pc1->ax;
-	pc1->ax = pc1->cx;
-	pc1->cx = pc1->tmp;
-
-	if (pc1->ax != 0) {
-		pc1->ax = pc1->ax * pc1->si;
-		pc1->cx = pc1->ax + pc1->cx;
-	}
-
-	pc1->tmp = pc1->ax;
-	pc1->ax = pc1->si;
-	pc1->si = pc1->tmp;
-	pc1->ax = pc1->ax * pc1->bx;
-	pc1->dx = pc1->cx + pc1->dx;
-
-	pc1->ax = pc1->ax + 1;
-
-	pc1->x1a2 = pc1->dx;
-	pc1->x1a0[pc1->i] = pc1->ax;
+	/* ('Remsaalps!123456') is the key used, you can change it */
+	static const unsigned char cle[] = "Remsaalps!123456";
+	int i;
 
-	pc1->res = pc1->ax ^ pc1->dx;
-	pc1->i = pc1->i + 1;
+	memset(pc1, 0, sizeof(struct pc1_ctx));
+	for (i = 0; i < 8; i++)
+		pc1->key[i] = (cle[2 * i] << 8) | cle[2 * i + 1];
 }
 
-static void pc1_assemble(struct pc1_ctx *pc1)
+/*
+ * Each byte is xored with one from eight rounds of the reference code's
+ * pc1_code(), then mixed into every byte of the key.  The rounds are the
+ * original's register shuffles worked out: every x1a0[] word is rebuilt
+ * from the key per byte, so only si and x1a2 live on, in registers here.
+ * Each byte depends on the one before, so this stays a scalar loop.
+ */
+static void pc1_crypt_buf(struct pc1_ctx *pc1, unsigned char *buf,
+			  unsigned len, int decrypt)
 {
-	pc1->x1a0[0] = (pc1->cle[0] * 256) + pc1->cle[1];
+	uint16_t key[8];
+	uint16_t si = pc1->si, x1a2 = pc1->x1a2;
+	unsigned n;
+	int i;
 
-	pc1_code(pc1);
-	pc1->inter = pc1->res;
+	memcpy(key, pc1->key, sizeof(key));
 
-	pc1->x1a0[1] = pc1->x1a0[0] ^ ((pc1->cle[2]*256) + pc1->cle[3]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
+	for (n = 0; n < len; n++) {
+		uint16_t ax = 0, inter = 0, mix;
+		unsigned char rnd, c;
 
-	pc1->x1a0[2] = pc1->x1a0[1] ^ ((pc1->cle[4]*256) + pc1->cle[5]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
+		for (i = 0; i < 8; i++) {
+			uint16_t w = ax ^ key[i];
+			uint16_t cx = (x1a2 + i) * 0x4e35 + 0x015a * w;
 
-	pc1->x1a0[3] = pc1->x1a0[2] ^ ((pc1->cle[6]*256) + pc1->cle[7]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
-
-	pc1->x1a0[4] = pc1->x1a0[3] ^ ((pc1->cle[8]*256) + pc1->cle[9]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
-
-	pc1->x1a0[5] = pc1->x1a0[4] ^ ((pc1->cle[10]*256) + pc1->cle[11]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
-
-	pc1->x1a0[6] = pc1->x1a0[5] ^ ((pc1->cle[12]*256) + pc1->cle[13]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
-
-	pc1->x1a0[7] = pc1->x1a0[6] ^ ((pc1->cle[14]*256) + pc1->cle[15]);
-	pc1_code(pc1);
-	pc1->inter = pc1->inter ^ pc1->res;
-
-	pc1->i = 0;
-}
-
-static unsigned char pc1_decrypt(struct pc1_ctx *pc1, short c)
-{
-	pc1_assemble(pc1);
-	pc1->cfc = pc1->inter >> 8;
-	pc1->cfd = pc1->inter & 255; /* cfc^cfd = random byte */
-
-	c = c ^ (pc1->cfc ^ pc1->cfd);
-	for (pc1->compte = 0; pc1->compte <= 15; pc1->compte++) {
-		/* we mix the plaintext byte with the key */
-		pc1->cle[pc1->compte] = pc1->cle[pc1->compte] ^ c;
-	}
+			x1a2 = cx + si;
+			si = 0x015a * w;
+			ax = w * 0x4e35 + 1;
+			inter ^= ax ^ x1a2;
+		}
 
-	return c;
-}
+		/* cfc^cfd = random byte */
+		rnd = (inter >> 8) ^ (inter & 255);
 
-static unsigned char pc1_encrypt(struct pc1_ctx *pc1, short c)
-{
-	pc1_assemble(pc1);
-	pc1->cfc = pc1->inter >> 8;
-	pc1->cfd = pc1->inter & 255; /* cfc^cfd = random byte */
+		c = decrypt ? buf[n] ^ rnd : buf[n];
+		buf[n] ^= rnd;
 
-	for (pc1->compte = 0; pc1->compte <= 15; pc1->compte++) {
 		/* we mix the plaintext byte with the key */
-		pc1->cle[pc1->compte] = pc1->cle[pc1->compte] ^ c;
+		mix = c * 0x0101;
+		for (i = 0; i < 8; i++)
+			key[i] ^= mix;
 	}
-	c = c ^ (pc1->cfc ^ pc1->cfd);
-
-	return c;
-}
-
-static void pc1_init(struct pc1_ctx *pc1)
-{
-	memset(pc1, 0, sizeof(struct pc1_ctx));
 
-	/* ('Remsaalps!123456') is the key used, you can change it */
-	strcpy(pc1->cle, "Remsaalps!123456");
-}
-
-static void pc1_decrypt_buf(struct pc1_ctx *pc1, unsigned char *buf,
-			    unsigned len)
-{
-	unsigned i;
-
-	for (i = 0; i < len; i++)
-		buf[i] = pc1_decrypt(pc1, buf[i]);
-}
-
-static void pc1_encrypt_buf(struct pc1_ctx *pc1, unsigned char *buf,
-			    unsigned len)
-{
-	unsigned i;
-
-	for (i = 0; i < len; i++)
-		buf[i] = pc1_encrypt(pc1, buf[i]);
+	memcpy(pc1->key, key, sizeof(key));
+	pc1->si = si;
+	pc1->x1a2 = x1a2;
 }
 
 /*
@@ -215,15 +128,15 @@ static int decrypt;
 void usage(int status)
 {
 	FILE *stream = (status != EXIT_SUCCESS) ? stderr : stdout;
-	struct board_info *board;
 
 	fprintf(stream, "Usage: %s [OPTIONS...]\n", progname);
 	fprintf(stream,
 "\n"
 "Options:\n"
-"  -d              decrypt instead of encrypt"
+"  -d              decrypt instead of encrypt\n"
 "  -i <file>       read input from the file <file>\n"
 "  -o <file>       write output to the file <file>\n"
+"  -b <file>       process each input and output file pair listed in <file>\n"
 "  -h              show this screen\n"
 	);
 
@@ -232,7 +145,7 @@ void usage(int status)
 
 #define BUFSIZE		(64 * 1024)
 
-int main(int argc, char *argv[])
+static int pc1_file(char *ifname, char *ofname)
 {
 	struct pc1_ctx pc1;
 	int res = EXIT_FAILURE;
@@ -243,44 +156,6 @@ int main(int argc, char *argv[])
 
 	FILE *outfile, *infile;
 
-	progname = basename(argv[0]);
-
-	while ( 1 ) {
-		int c;
-
-		c = getopt(argc, argv, "di:o:h");
-		if (c == -1)
-			break;
-
-		switch (c) {
-		case 'd':
-			decrypt = 1;
-			break;
-		case 'i':
-			ifname = optarg;
-			break;
-		case 'o':
-			ofname = optarg;
-			break;
-		case 'h':
-			usage(EXIT_SUCCESS);
-			break;
-		default:
-			usage(EXIT_FAILURE);
-			break;
-		}
-	}
-
-	if (ifname == NULL) {
-		ERR("no input file specified");
-		goto err;
-	}
-
-	if (ofname == NULL) {
-		ERR("no output file specified");
-		goto err;
-	}
-
 	err = stat(ifname, &st);
 	if (err){
 		ERRS("stat failed on %s", ifname);
@@ -322,10 +197,7 @@ int main(int argc, char *argv[])
 			goto err_close_out;
 		}
 
-		if (decrypt)
-			pc1_decrypt_buf(&pc1, buf, datalen);
-		else
-			pc1_encrypt_buf(&pc1, buf, datalen);
+		pc1_crypt_buf(&pc1, (unsigned char *) buf, datalen, decrypt);
 
 		errno = 0;
 		fwrite(buf, datalen, 1, outfile);
@@ -340,7 +212,6 @@ int main(int argc, char *argv[])
 
 	res = EXIT_SUCCESS;
 
- out_flush:
 	fflush(outfile);
 
  err_close_out:
@@ -359,3 +230,78 @@ int main(int argc, char *argv[])
 	return res;
 }
 
+/* runs every "input output" line of the list, going on past failures */
+static int pc1_list(char *listname)
+{
+	char line[2 * 4096], in[4096], out[4096];
+	FILE *f;
+	int res = EXIT_SUCCESS;
+
+	f = fopen(listname, "r");
+	if (f == NULL) {
+		ERRS("could not open \"%s\" for reading", listname);
+		return EXIT_FAILURE;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%4095s %4095s", in, out) != 2)
+			continue;
+
+		if (pc1_file(in, out) != EXIT_SUCCESS)
+			res = EXIT_FAILURE;
+	}
+
+	fclose(f);
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	char *listname = NULL;
+
+	progname = basename(argv[0]);
+
+	while ( 1 ) {
+		int c;
+
+		c = getopt(argc, argv, "b:di:o:h");
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'b':
+			listname = optarg;
+			break;
+		case 'd':
+			decrypt = 1;
+			break;
+		case 'i':
+			ifname = optarg;
+			break;
+		case 'o':
+			ofname = optarg;
+			break;
+		case 'h':
+			usage(EXIT_SUCCESS);
+			break;
+		default:
+			usage(EXIT_FAILURE);
+			break;
+		}
+	}
+
+	if (listname)
+		return pc1_list(listname);
+
+	if (ifname == NULL) {
+		ERR("no input file specified");
+		return EXIT_FAILURE;
+	}
+
+	if (ofname == NULL) {
+		ERR("no output file specified");
+		return EXIT_FAILURE;
+	}
+
+	return pc1_file(ifname, ofname);
+}
@@ -30,6 +30,18 @@
 #include <string.h>
 #include <stdio.h>
 
+/* before sha1.h, whose uint and ulong macros break system headers */
+#if defined(__GNUC__) && ( __GNUC__ >= 7 || defined(__clang__) ) && \
+    ( defined(__x86_64__) || defined(__i386__) )
+#define SHA1_HW_X86
+#include <stdint.h>
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+#define SHA1_HW_ARM
+#include <arm_neon.h>
+#endif
+
 #include "sha1.h"
 
 /* 
@@ -225,6 +237,189 @@ void sha1_process( sha1_context *ctx, uchar data[64] )
     ctx->state[4] += E;
 }
 
+/*
+ * SHA-1 instructions: SHA-NI on x86, looked for at run time, and the
+ * ARMv8 crypto extensions when the compiler targets them.  Either one
+ * does four rounds an instruction and keeps the state in registers over
+ * all the blocks it is given.  SHA1_HW_ROUNDS(j) is rounds 4j to 4j+3,
+ * which also schedule m[] for group j+1.
+ */
+#if defined(SHA1_HW_X86)
+
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+
+#define SHA1_HW
+
+static int sha1_hw_ok( void )
+{
+    static int ok = -1;
+    unsigned int a, b, c, d;
+
+    if( ok < 0 )
+        ok = __get_cpuid( 1, &a, &b, &c, &d ) && ( c & bit_SSE4_1 ) &&
+             __get_cpuid_count( 7, 0, &a, &b, &c, &d ) && ( b & bit_SHA );
+
+    return( ok );
+}
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_process_hw( ulong state[5], uchar *data, ulong blocks )
+{
+    const __m128i mask = _mm_set_epi64x( 0x0001020304050607ULL,
+                                         0x08090A0B0C0D0E0FULL );
+    __m128i abcd, e0, abcd_save, e0_save, prev, m[4];
+
+    /* A in the top lane, as sha1rnds4 wants it */
+    abcd = _mm_set_epi32( state[0], state[1], state[2], state[3] );
+    e0   = _mm_set_epi32( state[4], 0, 0, 0 );
+
+#define SHA1_HW_ROUNDS(j)                                               \
+{                                                                       \
+    __m128i x = ( (j) == 0 ) ? _mm_add_epi32( e0, m[0] )                \
+                             : _mm_sha1nexte_epu32( prev, m[(j) & 3] ); \
+    prev = abcd;                                                        \
+    abcd = _mm_sha1rnds4_epu32( abcd, x, (j) / 5 );                     \
+    if( (j) >= 3 && (j) < 19 )                                          \
+        m[((j) + 1) & 3] = _mm_sha1msg2_epu32(                          \
+            _mm_xor_si128( _mm_sha1msg1_epu32( m[((j) + 1) & 3],        \
+                                               m[((j) + 2) & 3] ),      \
+                           m[((j) + 3) & 3] ), m[(j) & 3] );            \
+}
+
+    while( blocks-- )
+    {
+        abcd_save = abcd;
+        e0_save = e0;
+        prev = abcd;
+
+        m[0] = _mm_shuffle_epi8( _mm_loadu_si128( (__m128i *) data ),        mask );
+        m[1] = _mm_shuffle_epi8( _mm_loadu_si128( (__m128i *) (data + 16) ), mask );
+        m[2] = _mm_shuffle_epi8( _mm_loadu_si128( (__m128i *) (data + 32) ), mask );
+        m[3] = _mm_shuffle_epi8( _mm_loadu_si128( (__m128i *) (data + 48) ), mask );
+
+        SHA1_HW_ROUNDS(  0 ); SHA1_HW_ROUNDS(  1 );
+        SHA1_HW_ROUNDS(  2 ); SHA1_HW_ROUNDS(  3 );
+        SHA1_HW_ROUNDS(  4 ); SHA1_HW_ROUNDS(  5 );
+        SHA1_HW_ROUNDS(  6 ); SHA1_HW_ROUNDS(  7 );
+        SHA1_HW_ROUNDS(  8 ); SHA1_HW_ROUNDS(  9 );
+        SHA1_HW_ROUNDS( 10 ); SHA1_HW_ROUNDS( 11 );
+        SHA1_HW_ROUNDS( 12 ); SHA1_HW_ROUNDS( 13 );
+        SHA1_HW_ROUNDS( 14 ); SHA1_HW_ROUNDS( 15 );
+        SHA1_HW_ROUNDS( 16 ); SHA1_HW_ROUNDS( 17 );
+        SHA1_HW_ROUNDS( 18 ); SHA1_HW_ROUNDS( 19 );
+
+        e0 = _mm_sha1nexte_epu32( prev, e0_save );
+        abcd = _mm_add_epi32( abcd, abcd_save );
+        data += 64;
+    }
+
+#undef SHA1_HW_ROUNDS
+
+    state[0] = (uint32_t) _mm_extract_epi32( abcd, 3 );
+    state[1] = (uint32_t) _mm_extract_epi32( abcd, 2 );
+    state[2] = (uint32_t) _mm_extract_epi32( abcd, 1 );
+    state[3] = (uint32_t) _mm_extract_epi32( abcd, 0 );
+    state[4] = (uint32_t) _mm_extract_epi32( e0, 3 );
+}
+
+#elif defined(SHA1_HW_ARM)
+
+#define SHA1_HW
+
+static int sha1_hw_ok( void )
+{
+    return( 1 );
+}
+
+static void sha1_process_hw( ulong state[5], uchar *data, ulong blocks )
+{
+    static const uint32_t K[4] =
+        { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+    uint32_t s[4] = { state[0], state[1], state[2], state[3] };
+    uint32x4_t abcd, abcd_save, m[4];
+    uint32_t e, e_save;
+
+    abcd = vld1q_u32( s );
+    e = state[4];
+
+#define SHA1_HW_ROUNDS(j)                                               \
+{                                                                       \
+    uint32x4_t x = vaddq_u32( m[(j) & 3], vdupq_n_u32( K[(j) / 5] ) );  \
+    uint32_t next = vsha1h_u32( vgetq_lane_u32( abcd, 0 ) );            \
+    if( (j) < 5 )                                                       \
+        abcd = vsha1cq_u32( abcd, e, x );                               \
+    else if( (j) >= 10 && (j) < 15 )                                    \
+        abcd = vsha1mq_u32( abcd, e, x );                               \
+    else                                                                \
+        abcd = vsha1pq_u32( abcd, e, x );                               \
+    e = next;                                                           \
+    if( (j) >= 3 && (j) < 19 )                                          \
+        m[((j) + 1) & 3] = vsha1su1q_u32(                               \
+            vsha1su0q_u32( m[((j) + 1) & 3], m[((j) + 2) & 3],          \
+                           m[((j) + 3) & 3] ), m[(j) & 3] );            \
+}
+
+    while( blocks-- )
+    {
+        abcd_save = abcd;
+        e_save = e;
+
+        m[0] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( data ) ) );
+        m[1] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( data + 16 ) ) );
+        m[2] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( data + 32 ) ) );
+        m[3] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( data + 48 ) ) );
+
+        SHA1_HW_ROUNDS(  0 ); SHA1_HW_ROUNDS(  1 );
+        SHA1_HW_ROUNDS(  2 ); SHA1_HW_ROUNDS(  3 );
+        SHA1_HW_ROUNDS(  4 ); SHA1_HW_ROUNDS(  5 );
+        SHA1_HW_ROUNDS(  6 ); SHA1_HW_ROUNDS(  7 );
+        SHA1_HW_ROUNDS(  8 ); SHA1_HW_ROUNDS(  9 );
+        SHA1_HW_ROUNDS( 10 ); SHA1_HW_ROUNDS( 11 );
+        SHA1_HW_ROUNDS( 12 ); SHA1_HW_ROUNDS( 13 );
+        SHA1_HW_ROUNDS( 14 ); SHA1_HW_ROUNDS( 15 );
+        SHA1_HW_ROUNDS( 16 ); SHA1_HW_ROUNDS( 17 );
+        SHA1_HW_ROUNDS( 18 ); SHA1_HW_ROUNDS( 19 );
+
+        abcd = vaddq_u32( abcd, abcd_save );
+        e += e_save;
+        data += 64;
+    }
+
+#undef SHA1_HW_ROUNDS
+
+    vst1q_u32( s, abcd );
+    state[0] = s[0];
+    state[1] = s[1];
+    state[2] = s[2];
+    state[3] = s[3];
+    state[4] = e;
+}
+
+#endif
+
+/*
+ * Runs whole blocks through the SHA-1 instructions if there are any,
+ * else through sha1_process
+ */
+static void sha1_process_blocks( sha1_context *ctx, uchar *data, ulong blocks )
+{
+#ifdef SHA1_HW
+    if( sha1_hw_ok() )
+    {
+        sha1_process_hw( ctx->state, data, blocks );
+        return;
+    }
+#endif
+
+    while( blocks-- )
+    {
+        sha1_process( ctx, data );
+        data += 64;
+    }
+}
+
 void sha1_update( sha1_context *ctx, uchar *input, uint length )
 {
     ulong left, fill;
@@ -244,17 +439,17 @@ void sha1_update( sha1_context *ctx, uchar *input, uint length )
     {
         memcpy( (void *) (ctx->buffer + left),
                 (void *) input, fill );
-        sha1_process( ctx, ctx->buffer );
+        sha1_process_blocks( ctx, ctx->buffer, 1 );
         length -= fill;
         input  += fill;
         left = 0;
     }
 
-    while( length >= 64 )
+    if( length >= 64 )
     {
-        sha1_process( ctx, input );
-        length -= 64;
-        input  += 64;
+        sha1_process_blocks( ctx, input, length / 64 );
+        input  += length & ~63;
+        length &= 63;
     }
 
     if( length )
@@ -1,6 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 //Rev 0.1 Original
 // 8 Jan 2001  MJH  Added code to write data to Binary file
@@ -63,12 +69,51 @@ int BigEndian;
 
 int inputline;
 
-// char buf[16*1024];
-
-char buffer[2048];
-char *cur_ptr;
 int cur_line=0;
-int cur_len=0;
+
+//  The binary file is built up in memory and written out in one go, so a
+//  record's length can be filled in without seeking back in the file
+
+bit8u *OutBuf;
+size_t OutLen;
+size_t OutSize;
+size_t RecOffset;
+
+//  S3 lines are decoded in parallel, in chunks of the mapped input split
+//  at line ends.  Anything else, and any S3 line that does not check out,
+//  is left to srecLine() when the chunks are merged in order.
+
+#define CHUNK_MIN   (1024*1024)     // less than this per thread is not worth it
+#define MAX_THREADS 16
+#define LINE_MAX    255             // longest line srecLine() is given
+
+typedef struct
+{
+    const char *Line;
+    bit32u LineLen;
+    bit32u Address;
+    size_t DataOff;
+    bit32u DataLen;
+    int    Slow;
+} SrecItem;
+
+typedef struct
+{
+    const char *Start;
+    const char *End;
+    SrecItem   *Items;
+    size_t      NumItems;
+    size_t      MaxItems;
+    bit8u      *Data;
+    size_t      DataLen;
+    size_t      DataMax;
+    int         NoMem;
+    pthread_t   Thread;
+} SrecChunk;
+
+//  A pair of hex digits to its byte, or 0x100 if either is not hex
+
+unsigned short HexPair[65536];
 
 int s1s2s3_total=0;
 
@@ -83,7 +128,7 @@ void dumpfTell(char *s, bit32u Value)
     Length = (int) RecLength;
     if (debug)
           printf("[%s  ] ftell()[0x%08lX] Length[0x%4X] Length[%4d] Value[0x%08x]\n",
-                s, ftell(fOut), Length, Length, Value);
+                s, (long) OutLen, Length, Length, Value);
 }
 
 void DispHex(bit32u Hex)
@@ -107,18 +152,43 @@ void WaitDisplay(void)
 }
 
 
+int OutReserve( size_t n )
+{
+    bit8u *p;
+    size_t size;
+
+    if (OutLen + n <= OutSize)
+        return(TRUE);
+
+    size = OutSize ? OutSize : 64*1024;
+    while (size < OutLen + n)
+        size *= 2;
+
+    p = realloc(OutBuf, size);
+    if (p == NULL)
+        return(FALSE);
+
+    OutBuf = p;
+    OutSize = size;
+    return(TRUE);
+}
+
 void binOut32 ( bit32u Data )
 {
 // On UNIX machine all 32bit writes need ENDIAN switched
 //    Data = EndianSwitch(Data);
 //    fwrite( &Data, sizeof(bit32u), 1, fOut);
 
-   char sdat[4];
    int i;
 
+   if (!OutReserve(4))
+   {
+       printf("Error in writing %X\n", Data);
+       return;
+   }
+
    for(i=0;i<4;i++)
-    sdat[i]=(char)(Data>>(i*8));
-   fwrite( sdat, 1, 4, fOut);
+    OutBuf[OutLen++]=(bit8u)(Data>>(i*8));
    dumpfTell("Out32" , Data);
 }
 
@@ -127,11 +197,13 @@ void binOut32 ( bit32u Data )
 
 void binOut8 ( bit8u Data )
 {
-    int n;
     dumpfTell("B4Data" , (bit32u) (Data & 0xFF) );
-    n = fwrite( &Data, sizeof(bit8u), 1, fOut);
-    if (n != 1)
+    if (!OutReserve(1))
+    {
         printf("Error in writing %X for Address 0x%8X\n", Data, AddressCurrent);
+        return;
+    }
+    OutBuf[OutLen++] = Data;
     RecLength += 1;
 }
 
@@ -148,6 +220,7 @@ void binRecStart(bit32u Address)
                 CheckSum, RecLength, Address);
 
 
+    RecOffset = OutLen;             // Save Start Of Length
     dumpfTell("RecLength", RecLength);
     binOut32( RecLength );
     dumpfTell("Address", Address);
@@ -156,7 +229,7 @@ void binRecStart(bit32u Address)
 
 void binRecEnd(void)
 {
-    long RecEnd;
+    int i;
 
     if (!RecStart)   //  if no record started, do not end it
     {
@@ -165,28 +238,13 @@ void binRecEnd(void)
 
     RecStart = FALSE;
 
-
-    RecEnd = ftell(fOut);         // Save Current position
-
     if (debug)
           printf("[RecEnd  ] CheckSum[0x%08X] Length[%4d] Length[0x%X] RecEnd[0x%08lX]\n",
-                CheckSum, RecLength, RecLength, RecEnd);
-
-    fseek( fOut, -((long) RecLength), SEEK_CUR);  // move back Start Of Data
-
-    dumpfTell("Data   ", -1);
-
-    fseek( fOut, -4, SEEK_CUR);  // move back Start Of Address
+                CheckSum, RecLength, RecLength, (long) OutLen);
 
-    dumpfTell("Address   ", -1);
-
-    fseek( fOut, -4, SEEK_CUR);  // move back Start Of Length
-
-    dumpfTell("Length   ", -1);
-
-    binOut32( RecLength );
-
-    fseek( fOut, RecEnd, SEEK_SET);  // move to end of Record
+    if (RecOffset + 4 <= OutLen)    // Fill in the Length
+        for(i=0;i<4;i++)
+            OutBuf[RecOffset+i]=(bit8u)(RecLength>>(i*8));
 
     CheckSum += RecLength;
 
@@ -223,64 +281,173 @@ void binRecOutByte(bit32u Address, bit8u Data)
     binOut8( Data );
 }
 
+//  Same as binRecOutByte() for each of Count bytes at consecutive addresses
+
+void binRecOutBytes(bit32u Address, const bit8u *Data, bit32u Count)
+{
+    bit32u i, Sum;
+
+    if (Count == 0)
+        return;
+
+    if (Address != (AddressCurrent+1))
+    {
+        binRecEnd();
+        binRecStart(Address);
+    }
+    AddressCurrent = Address + Count - 1;
+
+    if (!OutReserve(Count))
+    {
+        printf("Error in writing %d bytes for Address 0x%8X\n", Count, Address);
+        return;
+    }
+
+    for (i=0, Sum=0; i<Count; i++)
+        Sum += Data[i];
+
+    memcpy(OutBuf + OutLen, Data, Count);
+    OutLen += Count;
+    RecLength += Count;
+    CheckSum += Sum;
+}
+
 //=============================================================================
 //       SUPPORT FUNCTIONS
 //=============================================================================
-int readline(FILE *fil,char *buf,int len)
+//  Copies a line the way it was always read: '\r's dropped, cut at LINE_MAX
+
+void CopyLine(char *buf, const char *line, bit32u len)
 {
-    int rlen;
-    
-    rlen=0;
-    if (len==0)  return(0);
-    while(1)
+    bit32u i, n = 0;
+
+    for (i=0; i<len; i++)
+        if ((n<LINE_MAX)&&(line[i]!='\r'))
+            buf[n++]=line[i];
+    buf[n]=0;
+}
+
+void InitHexPair(void)
+{
+    int i, j, hi, lo;
+    static const char digits[] = "0123456789abcdef";
+
+    for (i=0; i<65536; i++)
+        HexPair[i] = 0x100;
+
+    for (i=0; i<16; i++)
+        for (j=0; j<16; j++)
+            for (hi=0; hi<2; hi++)
+                for (lo=0; lo<2; lo++)
+                    HexPair[((hi ? toupper(digits[i]) : digits[i]) << 8) |
+                            (lo ? toupper(digits[j]) : digits[j])] = (i<<4)|j;
+}
+
+//  Decodes an "S3" line with a good count and checksum into Data, returning
+//  the number of data bytes, or -1 if srecLine() has to look at it
+
+int FastS3(const char *line, bit32u len, bit32u *Address, bit8u *Data)
+{
+    const unsigned char *p = (const unsigned char *) line + 2;
+    bit32u count, i, v, bad, sum;
+
+    if ((len < 4) || (len > LINE_MAX) || (line[0] != 'S') || (line[1] != '3'))
+        return(-1);
+
+    count = HexPair[p[0]<<8 | p[1]];
+    if ((count & 0x100) || (count < 5) || (count*2 != len-4))
+        return(-1);
+
+    p += 2;
+    sum = count;
+    bad = 0;
+    *Address = 0;
+
+    for (i=0; i<4; i++, p+=2)
     {
-      if (cur_len==0)
-      {
-        cur_len=fread(buffer, 1, sizeof(buffer), fil);
-        if (cur_len==0)
+        v = HexPair[p[0]<<8 | p[1]];
+        bad |= v;
+        sum += v;
+        *Address = (*Address << 8) | (v & 0xFF);
+    }
+
+    for (i=0; i<count-4; i++, p+=2)
+    {
+        v = HexPair[p[0]<<8 | p[1]];
+        bad |= v;
+        sum += v;
+        if (i < count-5)
+            Data[i] = (bit8u) v;
+    }
+
+    if ((bad & 0x100) || ((sum & 0xFF) != 0xFF))
+        return(-1);
+
+    return(count-5);
+}
+
+void *DecodeChunk(void *arg)
+{
+    SrecChunk *c = arg;
+    const char *p = c->Start, *nl;
+    SrecItem *item;
+    bit32u len;
+    int n;
+
+    while (p < c->End)
+    {
+        nl = memchr(p, '\n', c->End - p);
+        if (nl == NULL)
+            nl = c->End;
+        len = nl - p;
+
+        if ((len > 0) && (p[len-1] == '\r'))   // the one '\r' a line usually has
+            len--;
+
+        if (c->NumItems == c->MaxItems)
         {
-          if (rlen)
-          {
-            *buf=0;
-            return(rlen);
-          }
-          return(-1);
+            c->MaxItems = c->MaxItems ? c->MaxItems*2 : 4096;
+            item = realloc(c->Items, c->MaxItems * sizeof(SrecItem));
+            if (item == NULL)
+            {
+                c->NoMem = TRUE;
+                return(NULL);
+            }
+            c->Items = item;
         }
-        cur_ptr=buffer;
-      }
-      if (cur_len)
-      {
-        if (*cur_ptr=='\n')
+
+        if (c->DataLen + LINE_MAX/2 > c->DataMax)
         {
-          *buf=0;
-          cur_ptr++;
-          cur_len--;
-          return(rlen);
+            bit8u *d;
+            c->DataMax = c->DataMax ? c->DataMax*2 : 64*1024;
+            d = realloc(c->Data, c->DataMax);
+            if (d == NULL)
+            {
+                c->NoMem = TRUE;
+                return(NULL);
+            }
+            c->Data = d;
         }
-         else
-         {
-           if ((len>1)&&(*cur_ptr!='\r'))
-           {
-             *buf++=*cur_ptr++;
-             len--;
-           }
-           else
-             cur_ptr++;
-
-           rlen++;
-           cur_len--;
-         }
-      }
-      else
-      {
-        *buf=0;
-        cur_ptr++;
-        cur_len--;
-        return(rlen);
-      }
+
+        item = &c->Items[c->NumItems];
+        item->Line = p;
+        item->LineLen = nl - p;
+        item->DataOff = c->DataLen;
+
+        n = memchr(p, '\r', len) ? -1 : FastS3(p, len, &item->Address, c->Data + c->DataLen);
+        item->Slow = (n < 0);
+        item->DataLen = (n < 0) ? 0 : n;
+        c->DataLen += item->DataLen;
+
+        //  Empty lines were always skipped
+        if (item->Slow || item->LineLen)
+            c->NumItems++;
+
+        p = nl + 1;
     }
-}
 
+    return(NULL);
+}
 
 int SRLerrorout(char *c1,char *c2)
 {
@@ -433,10 +600,13 @@ int srecLine(char *pSrecLine)
 
 int srec2bin(int argc,char *argv[],int verbose)
 {
-    int i,rlen,sts;
-    FILE *fp;
-    char ac;
-    char buff[256];
+    int i,fd,sts,nthreads;
+    size_t j;
+    struct stat st;
+    const char *map, *p, *end;
+    char buff[LINE_MAX+1];
+    SrecChunk chunks[MAX_THREADS];
+    SrecItem *item;
     bit32u TAG_BIG     = 0xDEADBE42;
     bit32u TAG_LITTLE  = 0xFEEDFA42;
 
@@ -459,20 +629,34 @@ int srec2bin(int argc,char *argv[],int verbose)
     if (verbose)
        printf("\nEndian: %s, Tag is 0x%8X\n",(BigEndian)?"BIG":"LITTLE", Tag);
 
-    fp = fopen(argv[1],"rt");
+    fd = open(argv[1], O_RDONLY);
 
-    if (fp==NULL)
+    if ((fd < 0) || fstat(fd, &st))
     {
       printf("\nError: Opening input file, %s.", argv[1]);
+      if (fd >= 0) close(fd);
       return(0);
     }
+
+    map = NULL;
+    if (st.st_size > 0)
+    {
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+      {
+        printf("\nError: Opening input file, %s.", argv[1]);
+        close(fd);
+        return(0);
+      }
+    }
+    close(fd);
   
     fOut = fopen( argv[2], "wb");
     
     if (fOut==NULL)
     {
       printf("\nError: Opening Output file, %s.", argv[2]);
-      if(fp) fclose(fp);
+      if (map) munmap((void *) map, st.st_size);
       return(0);
     }
  
@@ -486,20 +670,73 @@ int srec2bin(int argc,char *argv[],int verbose)
 
     binOut32(Tag);
 
+    InitHexPair();
+
+    // Split the input at line ends, one chunk per thread
+  
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > st.st_size / CHUNK_MIN) nthreads = st.st_size / CHUNK_MIN;
+    if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+    if (nthreads < 1) nthreads = 1;
+
+    memset(chunks, 0, sizeof(chunks));
+    p = map;
+    end = map + st.st_size;
+    for (i=0; i<nthreads; i++)
+    {
+        chunks[i].Start = p;
+        if (i == nthreads-1)
+            p = end;
+        else
+        {
+            p = map + st.st_size / nthreads * (i+1);
+            if (p < chunks[i].Start) p = chunks[i].Start;
+            p = memchr(p, '\n', end - p);
+            p = p ? p+1 : end;
+        }
+        chunks[i].End = p;
+    }
+
+    for (i=1; i<nthreads; i++)
+        if (pthread_create(&chunks[i].Thread, NULL, DecodeChunk, &chunks[i]))
+            DecodeChunk(&chunks[i]), chunks[i].Thread = 0;
+    DecodeChunk(&chunks[0]);
+    for (i=1; i<nthreads; i++)
+        if (chunks[i].Thread)
+            pthread_join(chunks[i].Thread, NULL);
+
+    // Merge in line order, emitting records as before
   
     inputline=0;
     sts=TRUE;
 
-    rlen = readline(fp,buff,sizeof buff);
-
-    while( (sts) && (rlen != -1))
+    for (i=0; (sts) && (i<nthreads); i++)
     {
-        if (strlen(buff))
+        if (chunks[i].NoMem)
+        {
+            printf("\nERROR: Out of memory decoding %s.", argv[1]);
+            sts = FALSE;
+            break;
+        }
+
+        for (j=0; (sts) && (j<chunks[i].NumItems); j++)
         {
-            sts &= srecLine(buff);
+            item = &chunks[i].Items[j];
+
+            if (item->Slow)
+            {
+                CopyLine(buff, item->Line, item->LineLen);
+                if (strlen(buff))
+                    sts &= srecLine(buff);
+            }
+            else
+            {
+                cur_line++;
+                binRecOutBytes(item->Address, chunks[i].Data + item->DataOff, item->DataLen);
+                s1s2s3_total++;
+            }
             WaitDisplay();
         }
-       rlen = readline(fp,buff,sizeof buff);
     }
 
   
@@ -507,7 +744,16 @@ int srec2bin(int argc,char *argv[],int verbose)
   
     binRecEnd();
 
-    if(fp) fclose(fp);
+    if (fwrite(OutBuf, 1, OutLen, fOut) != OutLen)
+        printf("\nError: Writing Output file, %s.", argv[2]);
+
+    for (i=0; i<nthreads; i++)
+    {
+        free(chunks[i].Items);
+        free(chunks[i].Data);
+    }
+    free(OutBuf);
+    if (map) munmap((void *) map, st.st_size);
     if(fOut) fclose(fOut);
 
     return(1);
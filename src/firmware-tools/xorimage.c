@@ -25,12 +25,25 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XOR_X86
+#include <immintrin.h>
+#endif
+
+/* bytes xored per step, and how far past its end the pattern is repeated */
+#define XOR_WIDTH	32
+
 static char default_pattern[] = "12345678";
 
+static int xor_dispatch(uint8_t *data, size_t len, const uint8_t *pattern,
+			int p_len, int p_off);
+static int (*xor_impl)(uint8_t *, size_t, const uint8_t *, int, int) =
+	xor_dispatch;
 
-int xor_data(uint8_t *data, size_t len, const uint8_t *pattern, int p_len, int p_off)
+
+static int xor_tail(uint8_t *data, size_t len, const uint8_t *pattern,
+		    int p_len, int offset)
 {
-	int offset = p_off;
 	while (len--) {
 		*data ^= pattern[offset];
 		data++;
@@ -39,31 +52,195 @@ int xor_data(uint8_t *data, size_t len, const uint8_t *pattern, int p_len, int p
 	return offset;
 }
 
+static int xor_generic(uint8_t *data, size_t len, const uint8_t *pattern,
+		       int p_len, int offset)
+{
+	for (; len >= XOR_WIDTH; len -= XOR_WIDTH, data += XOR_WIDTH) {
+		uint64_t d[XOR_WIDTH / 8], p[XOR_WIDTH / 8];
+		int i;
+
+		memcpy(d, data, XOR_WIDTH);
+		memcpy(p, pattern + offset, XOR_WIDTH);
+		for (i = 0; i < XOR_WIDTH / 8; i++)
+			d[i] ^= p[i];
+		memcpy(data, d, XOR_WIDTH);
+		offset = (offset + XOR_WIDTH) % p_len;
+	}
+	return xor_tail(data, len, pattern, p_len, offset);
+}
+
+#ifdef XOR_X86
+__attribute__((target("sse2")))
+static int xor_sse2(uint8_t *data, size_t len, const uint8_t *pattern,
+		    int p_len, int offset)
+{
+	for (; len >= XOR_WIDTH; len -= XOR_WIDTH, data += XOR_WIDTH) {
+		__m128i *d = (__m128i *) data;
+		const __m128i *p = (const __m128i *) (pattern + offset);
+
+		_mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d),
+						  _mm_loadu_si128(p)));
+		_mm_storeu_si128(d + 1, _mm_xor_si128(_mm_loadu_si128(d + 1),
+						      _mm_loadu_si128(p + 1)));
+		offset = (offset + XOR_WIDTH) % p_len;
+	}
+	return xor_tail(data, len, pattern, p_len, offset);
+}
+
+__attribute__((target("avx2")))
+static int xor_avx2(uint8_t *data, size_t len, const uint8_t *pattern,
+		    int p_len, int offset)
+{
+	for (; len >= XOR_WIDTH; len -= XOR_WIDTH, data += XOR_WIDTH) {
+		__m256i *d = (__m256i *) data;
+		const __m256i *p = (const __m256i *) (pattern + offset);
+
+		_mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d),
+							_mm256_loadu_si256(p)));
+		offset = (offset + XOR_WIDTH) % p_len;
+	}
+	return xor_tail(data, len, pattern, p_len, offset);
+}
+#endif
+
+static int xor_dispatch(uint8_t *data, size_t len, const uint8_t *pattern,
+			int p_len, int p_off)
+{
+	xor_impl = xor_generic;
+
+#ifdef XOR_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		xor_impl = xor_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		xor_impl = xor_sse2;
+#endif
+
+	return xor_impl(data, len, pattern, p_len, p_off);
+}
+
+/*
+ * pattern must hold p_len + XOR_WIDTH bytes, the pattern over and over,
+ * so that a whole step can be read from any offset into it
+ */
+int xor_data(uint8_t *data, size_t len, const uint8_t *pattern, int p_len, int p_off)
+{
+	return xor_impl(data, len, pattern, p_len, p_off);
+}
+
+static uint8_t *xor_widen(const char *pattern, int p_len)
+{
+	uint8_t *wide;
+	int i;
+
+	wide = malloc(p_len + XOR_WIDTH);
+	if (wide)
+		for (i = 0; i < p_len + XOR_WIDTH; i++)
+			wide[i] = pattern[i % p_len];
+	return wide;
+}
+
+/* Built with XORIMAGE_LIB, only the xor routines, for src/kernbench */
+#ifndef XORIMAGE_LIB
+static int xor_file(FILE *in, FILE *out, const uint8_t *pattern, int p_len)
+{
+	static char buf[64 * 1024];
+	size_t n;
+	int p_off = 0;
+
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+		if (n < sizeof(buf) && ferror(in))
+			break;
+
+		p_off = xor_data((uint8_t *) buf, n, pattern, p_len, p_off);
+
+		if (!fwrite(buf, n, 1, out)) {
+			fprintf(stderr, "fwrite error\n");
+			return -1;
+		}
+	}
+
+	if (ferror(in)) {
+		fprintf(stderr, "fread error\n");
+		return -1;
+	}
+
+	if (fflush(out)) {
+		fprintf(stderr, "fwrite error\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* each line of the list names an input and an output file */
+static int xor_batch(const char *list, const uint8_t *pattern, int p_len)
+{
+	char line[2 * 4096], ifn[4096], ofn[4096];
+	FILE *lf, *in, *out;
+	int ret = 0;
+
+	if (!(lf = fopen(list, "r"))) {
+		fprintf(stderr, "can not open \"%s\" for reading\n", list);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), lf)) {
+		if (sscanf(line, "%4095s %4095s", ifn, ofn) != 2)
+			continue;
+
+		if (!(in = fopen(ifn, "r"))) {
+			fprintf(stderr, "can not open \"%s\" for reading\n", ifn);
+			ret = -1;
+			continue;
+		}
+
+		if (!(out = fopen(ofn, "w"))) {
+			fprintf(stderr, "can not open \"%s\" for writing\n", ofn);
+			fclose(in);
+			ret = -1;
+			continue;
+		}
+
+		if (xor_file(in, out, pattern, p_len))
+			ret = -1;
+
+		fclose(in);
+		fclose(out);
+	}
+
+	fclose(lf);
+	return ret;
+}
+
 
 void usage(void) __attribute__ (( __noreturn__ ));
 
 void usage(void)
 {
-	fprintf(stderr, "Usage: xorimage [-i infile] [-o outfile] [-p <pattern>]\n");
+	fprintf(stderr, "Usage: xorimage [-i infile] [-o outfile] [-b listfile] [-p <pattern>]\n");
 	exit(EXIT_FAILURE);
 }
 
 
 int main(int argc, char **argv)
 {
-	char buf[1024];	/* keep this at 1k or adjust garbage calc below */
 	FILE *in = stdin;
 	FILE *out = stdout;
 	char *ifn = NULL;
 	char *ofn = NULL;
+	char *list = NULL;
 	const char *pattern = default_pattern;
+	uint8_t *wide;
 	int c;
-	int v0, v1, v2;
-	size_t n;
-	int p_len, p_off = 0;
+	int p_len;
+	int ret;
 
-	while ((c = getopt(argc, argv, "i:o:p:h")) != -1) {
+	while ((c = getopt(argc, argv, "b:i:o:p:h")) != -1) {
 		switch (c) {
+			case 'b':
+				list = optarg;
+				break;
 			case 'i':
 				ifn = optarg;
 				break;
@@ -84,16 +261,6 @@ int main(int argc, char **argv)
 		usage();
 	}
 
-	if (ifn && !(in = fopen(ifn, "r"))) {
-		fprintf(stderr, "can not open \"%s\" for reading\n", ifn);
-		usage();
-	}
-
-	if (ofn && !(out = fopen(ofn, "w"))) {
-		fprintf(stderr, "can not open \"%s\" for writing\n", ofn);
-		usage();
-	}
-
 	p_len = strlen(pattern);
 
 	if (p_len == 0) {
@@ -101,35 +268,30 @@ int main(int argc, char **argv)
 		usage();
 	}
 
+	if (!(wide = xor_widen(pattern, p_len))) {
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
 
-	while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
-		if (n < sizeof(buf)) {
-			if (ferror(in)) {
-			FREAD_ERROR:
-				fprintf(stderr, "fread error\n");
-				return EXIT_FAILURE;
-			}
-		}
-
-		p_off = xor_data(buf, n, pattern, p_len, p_off);
+	if (list)
+		return xor_batch(list, wide, p_len) ? EXIT_FAILURE : EXIT_SUCCESS;
 
-		if (!fwrite(buf, n, 1, out)) {
-		FWRITE_ERROR:
-			fprintf(stderr, "fwrite error\n");
-			return EXIT_FAILURE;
-		}
+	if (ifn && !(in = fopen(ifn, "r"))) {
+		fprintf(stderr, "can not open \"%s\" for reading\n", ifn);
+		usage();
 	}
 
-	if (ferror(in)) {
-		goto FREAD_ERROR;
+	if (ofn && !(out = fopen(ofn, "w"))) {
+		fprintf(stderr, "can not open \"%s\" for writing\n", ofn);
+		usage();
 	}
 
-	if (fflush(out)) {
-		goto FWRITE_ERROR;
-	}
+	ret = xor_file(in, out, wide, p_len);
 
 	fclose(in);
 	fclose(out);
+	free(wide);
 
-	return EXIT_SUCCESS;
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
 }
+#endif
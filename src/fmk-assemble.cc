@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-assemble.cc
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "untrx.h"
+
+extern "C"
+{
+#include "crcalc/common.h"
+#include "crcalc/manifest.h"
+}
+
+/*
+ * The assembly half of build-firmware.sh, the counterpart of
+ * fmk-extract.  The new image is sized up front with fallocate, the
+ * header image, the new file system and the footer are copied in with
+ * AppendSegment, the gap before the footer is filled with 0xFF from one
+ * buffer, and the headers fmk-extract logged are patched in a mapping
+ * of the result, resuming from the CRC prefixes it saved.  All of what
+ * it logged is read from its logs/manifest.bin, where there is one, or
+ * from config.log, binwalk.log and crc.log otherwise.  Rebuilt
+ * partitions, the file systems in the header image, are written over it
+ * with -p, each in the space its original had.
+ */
+
+#define FMK_PATH_LEN	4096
+#define FMK_LINE_LEN	256
+#define FMK_FILL_LEN	(1024*1024)
+#define FMK_PARTITIONS	16
+
+/************************************************************
+	helpers
+************************************************************/
+
+static void MakePath(char *pszPath, const char *pszDir, const char *pszName)
+{
+	snprintf(pszPath,FMK_PATH_LEN,"%s/%s",pszDir,pszName);
+}
+
+/* a number from config.log, which fmk-extract writes as KEY='value' */
+bool ReadConfig(const char *pszConf, const char *pszKey, size_t *pnValue)
+{
+	char szLine[FMK_LINE_LEN];
+	size_t nKey=strlen(pszKey);
+	bool bFound=false;
+
+	FILE *fConf=fopen(pszConf,"r");
+	if(!fConf) return false;
+	while(!bFound && fgets(szLine,sizeof(szLine),fConf))
+	{
+		if(!strncmp(szLine,pszKey,nKey) && szLine[nKey]=='='
+			&& szLine[nKey+1]=='\'')
+		{
+			*pnValue=strtoul(szLine+nKey+2,NULL,10);
+			bFound=true;
+		}
+	}
+	fclose(fConf);
+	return bFound;
+}
+
+/* fills nLength bytes at the current position of fdOut with 0xFF */
+bool AppendFill(int fdOut, size_t nLength)
+{
+	static unsigned char fill[FMK_FILL_LEN];
+
+	memset(fill,0xff,nLength<sizeof(fill) ? nLength : sizeof(fill));
+	while(nLength)
+	{
+		ssize_t nDone=write(fdOut,fill,
+			nLength<sizeof(fill) ? nLength : sizeof(fill));
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0) return false;
+		nLength-=nDone;
+	}
+	return true;
+}
+
+/* copies all of pszFile to the current position of fdOut */
+bool AppendFile(const char *pszFile, int fdOut)
+{
+	struct stat st;
+
+	int fdIn=open(pszFile,O_RDONLY);
+	if(fdIn<0) return false;
+	bool bOk=fstat(fdIn,&st)==0 && AppendSegment(fdIn,0,st.st_size,fdOut);
+	close(fdIn);
+	return bOk;
+}
+
+static off_t FileSize(const char *pszFile)
+{
+	struct stat st;
+	return stat(pszFile,&st)<0 ? -1 : st.st_size;
+}
+
+/* a partition to write over the header image, as -p offset:space:file */
+struct PARTITION
+{
+	size_t nOffset;
+	size_t nSpace;
+	const char *pszFile;
+};
+
+static bool ParsePartition(const char *pszArg, PARTITION *pP)
+{
+	char *pszEnd;
+
+	pP->nOffset=strtoul(pszArg,&pszEnd,0);
+	if(*pszEnd!=':') return false;
+	pP->nSpace=strtoul(pszEnd+1,&pszEnd,0);
+	if(*pszEnd!=':' || !pszEnd[1]) return false;
+	pP->pszFile=pszEnd+1;
+	return true;
+}
+
+/* writes pP->pszFile at its offset in fdOut, the rest of its space 0xFF */
+static bool WritePartition(int fdOut, const PARTITION *pP, size_t nFile)
+{
+	if(lseek(fdOut,pP->nOffset,SEEK_SET)<0) return false;
+	return AppendFile(pP->pszFile,fdOut) && AppendFill(fdOut,pP->nSpace-nFile);
+}
+
+/*************************************************************************
+* PatchHeaders
+*
+* patches the checksums of the headers in the manifest, or binwalk.log,
+* as crcalc does.  The CRC prefixes are only used while header.img is
+* no newer than them, since they checksum the header image fmk-extract
+* carved, and not at all once a partition has been written over it
+* (bNoCache).
+*
+**************************************************************************/
+bool PatchHeaders(int fdOut, size_t nSize, const char *pszDir, bool bManifest,
+	bool bNoCache)
+{
+	char szLog[FMK_PATH_LEN], szCache[FMK_PATH_LEN], szHeader[FMK_PATH_LEN];
+	int offsets[MAX_HEAD_SIZE];
+	struct stat stCache, stHeader;
+	char *pszCache=NULL;
+
+	MakePath(szLog,pszDir,bManifest ? "logs/manifest.bin" : "logs/binwalk.log");
+	MakePath(szCache,pszDir,bManifest ? "logs/manifest.bin" : "logs/crc.log");
+	MakePath(szHeader,pszDir,"image_parts/header.img");
+	if(!bNoCache && stat(szCache,&stCache)==0 && stat(szHeader,&stHeader)==0
+		&& stHeader.st_mtime<=stCache.st_mtime)
+	{
+		pszCache=szCache;
+	}
+
+	if(nSize<=MIN_FILE_SIZE) return false;
+	void *p=mmap(NULL,nSize,PROT_READ|PROT_WRITE,MAP_SHARED,fdOut,0);
+	if(p==MAP_FAILED) return false;
+
+	int n=parse_log(szLog,offsets);
+	fprintf(stderr, "Processing %d header(s)...\n", n);
+	bool bOk=patch_headers((char *)p,nSize,offsets,n,pszCache)!=0;
+	munmap(p,nSize);
+	return bOk;
+}
+
+/************************************************************
+	main
+************************************************************/
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-assemble [-nopad] [-p offset:space:file]... dir fs out\n"
+		"  builds out from dir/image_parts/header.img, the new file system\n"
+		"  fs and dir/image_parts/footer.img, padded with 0xFF to the size\n"
+		"  of the original image unless -nopad, and patches its header\n"
+		"  checksums.  Exits 1 if no header could be patched, and 2 if\n"
+		"  no image was built.\n"
+		" -p writes a rebuilt partition over the header image at offset,\n"
+		"  filling the rest of the space bytes the original had with 0xFF.\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	char szConf[FMK_PATH_LEN], szHeader[FMK_PATH_LEN], szFooter[FMK_PATH_LEN];
+	char szManifest[FMK_PATH_LEN];
+	size_t nFwSize=0, nFooterSize=0, nManifest=0;
+	PARTITION parts[FMK_PARTITIONS];
+	size_t nParts=0;
+	bool bPad=true;
+	int nArg=1;
+
+	while(nArg<argc && argv[nArg][0]=='-')
+	{
+		if(!strcmp(argv[nArg],"-nopad"))
+		{
+			bPad=false;
+			nArg++;
+		}
+		else if(!strcmp(argv[nArg],"-p") && nArg+1<argc && nParts<FMK_PARTITIONS
+			&& ParsePartition(argv[nArg+1],&parts[nParts]))
+		{
+			nParts++;
+			nArg+=2;
+		}
+		else
+		{
+			ShowUsage();
+		}
+	}
+	if(argc!=nArg+3)
+	{
+		ShowUsage();
+	}
+	const char *pszDir=argv[nArg], *pszFs=argv[nArg+1], *pszOut=argv[nArg+2];
+
+	MakePath(szConf,pszDir,"logs/config.log");
+	MakePath(szManifest,pszDir,"logs/manifest.bin");
+	MakePath(szHeader,pszDir,"image_parts/header.img");
+	MakePath(szFooter,pszDir,"image_parts/footer.img");
+	struct manifest *pMan=manifest_map(szManifest,&nManifest);
+	bool bManifest=pMan!=NULL;
+	if(bManifest)
+	{
+		nFwSize=pMan->fw_size;
+		nFooterSize=pMan->footer_size;
+		manifest_unmap(pMan,nManifest);
+	}
+	else if(!ReadConfig(szConf,"FW_SIZE",&nFwSize)
+		|| !ReadConfig(szConf,"FOOTER_SIZE",&nFooterSize))
+	{
+		fprintf(stderr, " ERROR reading %s\n", szConf);
+		return 2;
+	}
+
+	off_t nHeader=FileSize(szHeader), nFs=FileSize(pszFs);
+	if(nHeader<0 || nFs<0)
+	{
+		fprintf(stderr, " ERROR reading %s\n", nHeader<0 ? szHeader : pszFs);
+		return 2;
+	}
+
+	/* the new file system has to fit where the old one was */
+	size_t nCur=nHeader+nFs;
+	if(nCur+nFooterSize>nFwSize)
+	{
+		printf("ERROR: New firmware image will be larger than original image!\n"
+			"       Building firmware images larger than the original can brick your device!\n"
+			"       Try re-running with the -min option, or remove any unnecessary files.\n"
+			"       REFUSING to create new firmware image.\n\n"
+			"       Original file size: %lu\n"
+			"       Current file size:  %lu (plus footer of %lu bytes)\n\n"
+			"       Quitting...\n", (unsigned long)nFwSize,
+			(unsigned long)nCur, (unsigned long)nFooterSize);
+		return 2;
+	}
+	size_t nFill=nFwSize-nCur-nFooterSize;
+
+	/* and each partition where its original was */
+	size_t nPartFile[FMK_PARTITIONS];
+	for(size_t nP=0;nP<nParts;nP++)
+	{
+		off_t nFile=FileSize(parts[nP].pszFile);
+		if(nFile<0)
+		{
+			fprintf(stderr, " ERROR reading %s\n", parts[nP].pszFile);
+			return 2;
+		}
+		nPartFile[nP]=nFile;
+		if(parts[nP].nOffset+parts[nP].nSpace>(size_t)nHeader
+			|| nPartFile[nP]>parts[nP].nSpace)
+		{
+			printf("ERROR: New partition %s is %lu bytes, but only %lu bytes are\n"
+				"       left for it at offset %lu of the header image!\n"
+				"       REFUSING to create new firmware image.\n"
+				"       Quitting...\n", parts[nP].pszFile, (unsigned long)nPartFile[nP],
+				(unsigned long)parts[nP].nSpace, (unsigned long)parts[nP].nOffset);
+			return 2;
+		}
+	}
+	if(bPad)
+	{
+		printf("Remaining free bytes in firmware image: %lu\n",
+			(unsigned long)nFill);
+	}
+	else
+	{
+		printf("Padding of firmware image disabled via -nopad\n");
+		nFill=0;
+	}
+	size_t nSize=nCur+nFill+nFooterSize;
+
+	int fdOut=open(pszOut,O_RDWR|O_CREAT|O_TRUNC,0644);
+	if(fdOut<0)
+	{
+		fprintf(stderr, " ERROR creating %s: %s\n", pszOut, strerror(errno));
+		return 2;
+	}
+
+	/* the space for all of it at once, where the file system can */
+	if(nSize && fallocate(fdOut,0,0,nSize)<0 && errno!=EOPNOTSUPP
+		&& errno!=ENOSYS && errno!=EINVAL)
+	{
+		fprintf(stderr, " ERROR allocating %s: %s\n", pszOut, strerror(errno));
+		close(fdOut);
+		return 2;
+	}
+
+	if(!AppendFile(szHeader,fdOut) || !AppendFile(pszFs,fdOut)
+		|| !AppendFill(fdOut,nFill)
+		|| (nFooterSize && !AppendFile(szFooter,fdOut)))
+	{
+		fprintf(stderr, " ERROR writing %s\n", pszOut);
+		close(fdOut);
+		return 2;
+	}
+	fflush(stdout);
+
+	/* the parts decide the size, should they disagree with config.log */
+	off_t nEnd=lseek(fdOut,0,SEEK_CUR);
+	if(nEnd<0 || ftruncate(fdOut,nEnd)<0)
+	{
+		fprintf(stderr, " ERROR writing %s\n", pszOut);
+		close(fdOut);
+		return 2;
+	}
+
+	for(size_t nP=0;nP<nParts;nP++)
+	{
+		printf("Writing partition %s at offset %lu\n", parts[nP].pszFile,
+			(unsigned long)parts[nP].nOffset);
+		if(!WritePartition(fdOut,&parts[nP],nPartFile[nP]))
+		{
+			fprintf(stderr, " ERROR writing %s\n", pszOut);
+			close(fdOut);
+			return 2;
+		}
+	}
+	fflush(stdout);
+
+	bool bPatched=PatchHeaders(fdOut,nEnd,pszDir,bManifest,nParts!=0);
+	if(close(fdOut))
+	{
+		fprintf(stderr, " ERROR writing %s\n", pszOut);
+		return 2;
+	}
+	return bPatched ? 0 : 1;
+}
@@ -0,0 +1,1330 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-cpio.cc
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <lzma.h>
+#include <zlib.h>
+
+#include "fmkindex/fmkindex.h"
+
+/*
+ * Unpacks and builds cpio archives, newc and odc, in place of the cpio
+ * run of uncpio.sh.  An archive compressed with gzip, xz or lzma, as an
+ * initramfs is, is decoded as it is read, so it comes out in one pass,
+ * and -c compresses the archive it writes the same way.  Entries are
+ * created below the output directory only: leading /s are dropped,
+ * names with .. in them are skipped and none is made through a symlink.
+ * With -p the owners, set-id bits and device nodes, which only root
+ * can give the files extracted, go to a pseudo file as unsquashfs -pf
+ * writes it, and -c takes them back from it, so neither needs root.
+ */
+
+#define FMK_PATH_LEN	4096
+#define FMK_BUFFER_LEN	(256*1024)
+#define FMK_LINK_HASH	1024
+#define FMK_PSEUDO_HASH	4096
+#define CPIO_NEWC_LEN	110
+#define CPIO_ODC_LEN	76
+#define CPIO_BLOCK	512	/* what the archive is padded to, as GNU cpio does */
+#define CPIO_TRAILER	"TRAILER!!!"
+
+/* the mode a file extracted with -p is left with, as unsquashfs gives it */
+#define PSEUDO_MODE(nMode)	(((nMode)&0777) | S_IRUSR | S_IWUSR | \
+	(S_ISDIR(nMode) ? S_IXUSR : 0))
+
+enum { FMK_RAW, FMK_GZIP, FMK_XZ, FMK_LZMA };
+
+typedef struct _CPIO_ENTRY
+{
+	char szName[FMK_PATH_LEN];
+	unsigned int nMode, nUid, nGid, nNlink;
+	unsigned int nDevMajor, nDevMinor, nRdevMajor, nRdevMinor;
+	unsigned long long nIno, nSize;
+	time_t nMtime;
+} CPIO_ENTRY;
+
+/* an archive being read, decoded as it comes if it is compressed */
+typedef struct _INPUT
+{
+	int fd;
+	int nType;
+	unsigned char *pBuffer;
+	const unsigned char *pNext;	/* the part of pBuffer not decoded yet */
+	size_t nAvail;
+	bool bEof;		/* fd has no more */
+	bool bEnd;		/* nor the decoder */
+	bool bFailed;
+	z_stream zs;
+	lzma_stream ls;
+} INPUT;
+
+/* an archive being written, compressed as it goes */
+typedef struct _OUTPUT
+{
+	int fd;
+	int nType;
+	bool bOdc;
+	unsigned long long nTotal;	/* of the archive, before compression */
+	unsigned char *pBuffer;
+	z_stream zs;
+	lzma_stream ls;
+} OUTPUT;
+
+/* the first path extracted of each inode with more than one link */
+typedef struct _LINK
+{
+	unsigned int nMajor, nMinor;
+	unsigned long long nIno;
+	char *pszPath;
+	struct _LINK *pNext;
+} LINK;
+
+/* a line of a pseudo file, keyed on the path with no leading / */
+typedef struct _PSEUDO_DEF
+{
+	char *pszName;
+	char cType;
+	unsigned int nMode, nUid, nGid, nMajor, nMinor;
+	bool bUsed;
+	struct _PSEUDO_DEF *pNext;
+} PSEUDO_DEF;
+
+/* a directory extracted, whose mode and mtime are set once all in it is */
+typedef struct _DIR_ENTRY
+{
+	char *pszName;
+	unsigned int nMode;
+	time_t nMtime;
+} DIR_ENTRY;
+
+/* a node of the tree -c archives */
+typedef struct _NODE
+{
+	char *pszName;		/* "" for the root */
+	struct stat st;
+	unsigned long long nIno;
+	unsigned int nNlink;
+	bool bData;		/* the newc link of an inode that carries its data */
+} NODE;
+
+static unsigned char g_buffer[FMK_BUFFER_LEN];
+static LINK *g_pLinks[FMK_LINK_HASH];
+static PSEUDO_DEF *g_pDefs[FMK_PSEUDO_HASH];
+static PSEUDO_DEF **g_ppDefOrder;
+static size_t g_nDefs, g_nDefAlloc;
+static FILE *g_fPseudo;
+static bool g_bPseudo;		/* -c has a pseudo file */
+static bool g_bRoot;
+static int g_nWarnings;
+
+static unsigned int HashString(const char *psz)
+{
+	unsigned int nHash=2166136261U;
+	for(;*psz;psz++) nHash=(nHash^(unsigned char)*psz)*16777619U;
+	return nHash;
+}
+
+static unsigned int HashInode(unsigned long long nDev, unsigned long long nIno)
+{
+	return (unsigned int)((nDev*0x9e3779b97f4a7c15ULL^nIno)*0x9e3779b97f4a7c15ULL>>40);
+}
+
+/* writes all of p to fd */
+static bool WriteAll(int fd, const unsigned char *p, size_t nLength)
+{
+	while(nLength)
+	{
+		ssize_t nDone=write(fd,p,nLength);
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0) return false;
+		p+=nDone;
+		nLength-=nDone;
+	}
+	return true;
+}
+
+/************************************************************
+	reading
+************************************************************/
+
+static bool InputFill(INPUT *pI)
+{
+	for(;;)
+	{
+		ssize_t nRead=read(pI->fd,pI->pBuffer,FMK_BUFFER_LEN);
+		if(nRead<0 && errno==EINTR) continue;
+		if(nRead<0)
+		{
+			pI->bFailed=true;
+			return false;
+		}
+		pI->pNext=pI->pBuffer;
+		pI->nAvail=nRead;
+		pI->bEof=nRead==0;
+		return nRead>0;
+	}
+}
+
+/*************************************************************************
+* InputOpen
+*
+* starts reading an archive, picking the decoder from its first bytes:
+* gzip, or anything not a cpio header for liblzma's auto decoder, which
+* takes xz and lzma_alone
+*
+**************************************************************************/
+bool InputOpen(INPUT *pI, int fd)
+{
+	memset(pI,0,sizeof(*pI));
+	pI->fd=fd;
+	pI->pBuffer=(unsigned char *)malloc(FMK_BUFFER_LEN);
+	if(!pI->pBuffer) return false;
+	if(!InputFill(pI))
+	{
+		pI->bEnd=true;
+		return !pI->bFailed;
+	}
+
+	const unsigned char *p=pI->pNext;
+	if(pI->nAvail>=2 && p[0]==0x1f && p[1]==0x8b)
+	{
+		pI->nType=FMK_GZIP;
+		return inflateInit2(&pI->zs,15+16)==Z_OK;
+	}
+	if(pI->nAvail>=5 && !memcmp(p,"07070",5))
+	{
+		pI->nType=FMK_RAW;
+		return true;
+	}
+	pI->nType=FMK_XZ;
+	pI->ls=LZMA_STREAM_INIT;
+	return lzma_auto_decoder(&pI->ls,UINT64_MAX,LZMA_CONCATENATED)==LZMA_OK;
+}
+
+void InputClose(INPUT *pI)
+{
+	if(pI->nType==FMK_GZIP) inflateEnd(&pI->zs);
+	if(pI->nType==FMK_XZ) lzma_end(&pI->ls);
+	free(pI->pBuffer);
+}
+
+/*************************************************************************
+* InputRead
+*
+* reads up to nWant bytes of the archive, decoded, short only at its
+* end.  Gzip members may follow each other, as they do where an
+* initramfs is built from several archives.
+*
+**************************************************************************/
+size_t InputRead(INPUT *pI, void *pv, size_t nWant)
+{
+	unsigned char *p=(unsigned char *)pv;
+	size_t nDone=0;
+
+	while(nDone<nWant && !pI->bEnd && !pI->bFailed)
+	{
+		if(!pI->nAvail && !pI->bEof && !InputFill(pI) && pI->bFailed) break;
+
+		size_t nRoom=nWant-nDone;
+		if(pI->nType==FMK_RAW)
+		{
+			if(!pI->nAvail)
+			{
+				pI->bEnd=true;
+				break;
+			}
+			size_t n=nRoom<pI->nAvail ? nRoom : pI->nAvail;
+			memcpy(p+nDone,pI->pNext,n);
+			pI->pNext+=n;
+			pI->nAvail-=n;
+			nDone+=n;
+		}
+		else if(pI->nType==FMK_GZIP)
+		{
+			pI->zs.next_in=(Bytef *)pI->pNext;
+			pI->zs.avail_in=(uInt)pI->nAvail;
+			pI->zs.next_out=p+nDone;
+			pI->zs.avail_out=(uInt)(nRoom>0x40000000 ? 0x40000000 : nRoom);
+			int nRet=inflate(&pI->zs,Z_NO_FLUSH);
+			nDone=pI->zs.next_out-p;
+			pI->pNext=pI->zs.next_in;
+			pI->nAvail=pI->zs.avail_in;
+			if(nRet==Z_STREAM_END)
+			{
+				if(!pI->nAvail && !pI->bEof) InputFill(pI);
+				if(pI->nAvail && pI->pNext[0]==0x1f) inflateReset(&pI->zs);
+				else pI->bEnd=true;
+			}
+			else if((nRet!=Z_OK && nRet!=Z_BUF_ERROR)
+				|| (nRet==Z_BUF_ERROR && !pI->nAvail && pI->bEof))
+				pI->bFailed=true;
+		}
+		else
+		{
+			pI->ls.next_in=pI->pNext;
+			pI->ls.avail_in=pI->nAvail;
+			pI->ls.next_out=p+nDone;
+			pI->ls.avail_out=nRoom;
+			lzma_ret ret=lzma_code(&pI->ls,pI->bEof ? LZMA_FINISH : LZMA_RUN);
+			nDone=pI->ls.next_out-p;
+			pI->pNext=pI->ls.next_in;
+			pI->nAvail=pI->ls.avail_in;
+			if(ret==LZMA_STREAM_END) pI->bEnd=true;
+			else if(ret!=LZMA_OK) pI->bFailed=true;
+		}
+	}
+	return nDone;
+}
+
+static bool InputSkip(INPUT *pI, unsigned long long nSkip)
+{
+	while(nSkip)
+	{
+		size_t n=nSkip<FMK_BUFFER_LEN ? nSkip : FMK_BUFFER_LEN;
+		if(InputRead(pI,g_buffer,n)!=n) return false;
+		nSkip-=n;
+	}
+	return true;
+}
+
+static unsigned long long CpioNumber(const char *p, int nLength, int nBase)
+{
+	char szField[12];
+	memcpy(szField,p,nLength);
+	szField[nLength]='\0';
+	return strtoull(szField,NULL,nBase);
+}
+
+/*************************************************************************
+* CpioNext
+*
+* reads the header and name of the next entry, leaving its data to be
+* read.  The NULs padding entries, and archives, apart are skipped, so
+* that archives one after another read as one.  Returns 1 for an entry,
+* 0 at the end and -1 for a bad or short archive.  *pnTrailers counts
+* the archives read to their end.
+*
+**************************************************************************/
+int CpioNext(INPUT *pI, CPIO_ENTRY *pEntry, int *pnTrailers)
+{
+	char header[CPIO_NEWC_LEN];
+
+	for(;;)
+	{
+		do
+		{
+			if(InputRead(pI,header,1)!=1)
+				return pI->bFailed || !*pnTrailers ? -1 : 0;
+		} while(!header[0]);
+
+		if(InputRead(pI,header+1,5)!=5 || memcmp(header,"07070",5)) return -1;
+
+		bool bNewc=header[5]=='1' || header[5]=='2';
+		unsigned long long nNameSize;
+		if(bNewc)
+		{
+			if(InputRead(pI,header+6,CPIO_NEWC_LEN-6)!=CPIO_NEWC_LEN-6) return -1;
+			pEntry->nIno=CpioNumber(header+6,8,16);
+			pEntry->nMode=(unsigned int)CpioNumber(header+14,8,16);
+			pEntry->nUid=(unsigned int)CpioNumber(header+22,8,16);
+			pEntry->nGid=(unsigned int)CpioNumber(header+30,8,16);
+			pEntry->nNlink=(unsigned int)CpioNumber(header+38,8,16);
+			pEntry->nMtime=(time_t)CpioNumber(header+46,8,16);
+			pEntry->nSize=CpioNumber(header+54,8,16);
+			pEntry->nDevMajor=(unsigned int)CpioNumber(header+62,8,16);
+			pEntry->nDevMinor=(unsigned int)CpioNumber(header+70,8,16);
+			pEntry->nRdevMajor=(unsigned int)CpioNumber(header+78,8,16);
+			pEntry->nRdevMinor=(unsigned int)CpioNumber(header+86,8,16);
+			nNameSize=CpioNumber(header+94,8,16);
+		}
+		else if(header[5]=='7')
+		{
+			if(InputRead(pI,header+6,CPIO_ODC_LEN-6)!=CPIO_ODC_LEN-6) return -1;
+			unsigned int nDev=(unsigned int)CpioNumber(header+6,6,8);
+			unsigned int nRdev=(unsigned int)CpioNumber(header+42,6,8);
+			pEntry->nDevMajor=major(nDev);
+			pEntry->nDevMinor=minor(nDev);
+			pEntry->nIno=CpioNumber(header+12,6,8);
+			pEntry->nMode=(unsigned int)CpioNumber(header+18,6,8);
+			pEntry->nUid=(unsigned int)CpioNumber(header+24,6,8);
+			pEntry->nGid=(unsigned int)CpioNumber(header+30,6,8);
+			pEntry->nNlink=(unsigned int)CpioNumber(header+36,6,8);
+			pEntry->nRdevMajor=major(nRdev);
+			pEntry->nRdevMinor=minor(nRdev);
+			pEntry->nMtime=(time_t)CpioNumber(header+48,11,8);
+			nNameSize=CpioNumber(header+59,6,8);
+			pEntry->nSize=CpioNumber(header+65,11,8);
+		}
+		else return -1;
+
+		if(!nNameSize || nNameSize>FMK_PATH_LEN
+			|| InputRead(pI,pEntry->szName,nNameSize)!=nNameSize)
+			return -1;
+		pEntry->szName[nNameSize-1]='\0';
+		if(bNewc && !InputSkip(pI,(4-(CPIO_NEWC_LEN+nNameSize)%4)%4)) return -1;
+
+		if(strcmp(pEntry->szName,CPIO_TRAILER)) return 1;
+		(*pnTrailers)++;
+		if(!InputSkip(pI,pEntry->nSize)) return -1;
+	}
+}
+
+/************************************************************
+	extracting
+************************************************************/
+
+/* a member name with any leading ./ and / and trailing / dropped, and
+   false for one with a .. in it */
+static bool MemberName(const char *pszName, char *pszOut)
+{
+	while(*pszName=='/' || (pszName[0]=='.' && pszName[1]=='/')) pszName+=*pszName=='/' ? 1 : 2;
+	snprintf(pszOut,FMK_PATH_LEN,"%s",strcmp(pszName,".") ? pszName : "");
+	size_t nName=strlen(pszOut);
+	while(nName && pszOut[nName-1]=='/') pszOut[--nName]='\0';
+
+	for(const char *psz=pszOut;(psz=strstr(psz,".."))!=NULL;psz+=2)
+	{
+		if((psz==pszOut || psz[-1]=='/') && (!psz[2] || psz[2]=='/')) return false;
+	}
+	return true;
+}
+
+/*************************************************************************
+* OpenParent
+*
+* opens the directory a member goes in below fdRoot, making any missing
+* on the way, and hands back its last component.  Symlinks aren't
+* followed, so nothing can be made outside the tree.
+*
+**************************************************************************/
+int OpenParent(int fdRoot, const char *pszName, const char **ppszLeaf)
+{
+	char szPath[FMK_PATH_LEN];
+	snprintf(szPath,sizeof(szPath),"%s",pszName);
+	const char *pszLeaf=strrchr(pszName,'/');
+	*ppszLeaf=pszLeaf ? pszLeaf+1 : pszName;
+
+	int fd=dup(fdRoot);
+	char *pszSave=NULL, *psz=strtok_r(szPath,"/",&pszSave);
+	for(char *pszNext;fd>=0 && psz && (pszNext=strtok_r(NULL,"/",&pszSave))!=NULL;psz=pszNext)
+	{
+		if(!strcmp(psz,".")) continue;
+		int fdNext=openat(fd,psz,O_RDONLY|O_DIRECTORY|O_NOFOLLOW);
+		if(fdNext<0 && errno==ENOENT && (mkdirat(fd,psz,0755)==0 || errno==EEXIST))
+			fdNext=openat(fd,psz,O_RDONLY|O_DIRECTORY|O_NOFOLLOW);
+		int nErrno=errno;
+		close(fd);
+		errno=nErrno;
+		fd=fdNext;
+	}
+	return fd;
+}
+
+static void AddPseudo(const char *pszName, char cType, const CPIO_ENTRY *pEntry)
+{
+	if(!*pszName) pszName="/";
+	if(strpbrk(pszName," \t\n\r\v\f"))
+	{
+		fprintf(stderr, " WARNING %s can't be named in a pseudo file, its owner and mode are lost\n",
+			pszName);
+		g_nWarnings++;
+		return;
+	}
+
+	if(cType=='m')
+		fprintf(g_fPseudo,"%s m %o %u %u\n",pszName,pEntry->nMode&07777,
+			pEntry->nUid,pEntry->nGid);
+	else
+		fprintf(g_fPseudo,"%s %c %o %u %u %u %u\n",pszName,cType,
+			pEntry->nMode&07777,pEntry->nUid,pEntry->nGid,pEntry->nRdevMajor,
+			pEntry->nRdevMinor);
+}
+
+/* the owner and mode of an entry, applied where only root may apply all of it */
+static void SetAttributes(int fdDir, const char *pszLeaf, const char *pszName,
+	const CPIO_ENTRY *pEntry)
+{
+	struct timespec times[2];
+	unsigned int nMode=pEntry->nMode;
+
+	if(g_fPseudo)
+	{
+		AddPseudo(pszName,'m',pEntry);
+		nMode=PSEUDO_MODE(nMode);
+	}
+	else if(g_bRoot) fchownat(fdDir,pszLeaf,pEntry->nUid,pEntry->nGid,AT_SYMLINK_NOFOLLOW);
+	else nMode&=~07000;
+
+	if(!S_ISLNK(pEntry->nMode)) fchmodat(fdDir,pszLeaf,nMode&07777,0);
+	times[0].tv_sec=times[1].tv_sec=pEntry->nMtime;
+	times[0].tv_nsec=times[1].tv_nsec=0;
+	utimensat(fdDir,pszLeaf,times,AT_SYMLINK_NOFOLLOW);
+}
+
+/* copies the data of an entry to fd, or past it with fd -1, hashing it
+   into pHash for FMK_INDEX if one is given */
+static bool CopyData(INPUT *pI, int fd, unsigned long long nSize,
+	fmk_index_hash *pHash=NULL)
+{
+	bool bOk=true;
+	while(nSize)
+	{
+		size_t n=nSize<FMK_BUFFER_LEN ? nSize : FMK_BUFFER_LEN;
+		if(InputRead(pI,g_buffer,n)!=n) return false;
+		if(fd>=0 && bOk) bOk=WriteAll(fd,g_buffer,n);
+		if(pHash) fmk_index_data(pHash,g_buffer,n);
+		nSize-=n;
+	}
+	return bOk;
+}
+
+/* forgets the links of an archive at its end, as the kernel does */
+static void ClearLinks()
+{
+	for(int nI=0;nI<FMK_LINK_HASH;nI++)
+	{
+		while(g_pLinks[nI])
+		{
+			LINK *pNext=g_pLinks[nI]->pNext;
+			free(g_pLinks[nI]->pszPath);
+			free(g_pLinks[nI]);
+			g_pLinks[nI]=pNext;
+		}
+	}
+}
+
+/* passes over the data of an entry that couldn't be made, keeping errno */
+static bool SkipFailed(INPUT *pI, unsigned long long nSize)
+{
+	int nErrno=errno;
+	CopyData(pI,-1,nSize);
+	errno=nErrno;
+	return false;
+}
+
+/* the path an inode with more links was first extracted to, which is
+   remembered as pszName when it hasn't been */
+static const char *FindLink(const CPIO_ENTRY *pEntry, const char *pszName)
+{
+	unsigned int nHash=HashInode((unsigned long long)pEntry->nDevMajor<<32
+		| pEntry->nDevMinor,pEntry->nIno)%FMK_LINK_HASH;
+
+	for(LINK *pLink=g_pLinks[nHash];pLink;pLink=pLink->pNext)
+	{
+		if(pLink->nMajor==pEntry->nDevMajor && pLink->nMinor==pEntry->nDevMinor
+			&& pLink->nIno==pEntry->nIno)
+			return pLink->pszPath;
+	}
+
+	LINK *pLink=(LINK *)malloc(sizeof(LINK));
+	if(pLink && (pLink->pszPath=strdup(pszName))!=NULL)
+	{
+		pLink->nMajor=pEntry->nDevMajor;
+		pLink->nMinor=pEntry->nDevMinor;
+		pLink->nIno=pEntry->nIno;
+		pLink->pNext=g_pLinks[nHash];
+		g_pLinks[nHash]=pLink;
+	}
+	else free(pLink);
+	return NULL;
+}
+
+/*************************************************************************
+* ExtractEntry
+*
+* creates one entry in directory fdDir, replacing whatever is there but
+* a directory.  Hard links of an earlier file are linked to it, and
+* write their data, if they carry it, through it: newc archives keep
+* the data of an inode with its last link.
+*
+**************************************************************************/
+bool ExtractEntry(INPUT *pI, int fdRoot, int fdDir, const char *pszLeaf,
+	const char *pszName, const CPIO_ENTRY *pEntry, DIR_ENTRY **ppDirs,
+	size_t *pnDirs, size_t *pnDirAlloc)
+{
+	struct stat st;
+	unsigned int nType=pEntry->nMode&S_IFMT;
+	bool bExists=fstatat(fdDir,pszLeaf,&st,AT_SYMLINK_NOFOLLOW)==0;
+
+	if(bExists && !(nType==S_IFDIR && S_ISDIR(st.st_mode))
+		&& unlinkat(fdDir,pszLeaf,S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0)<0)
+		return SkipFailed(pI,pEntry->nSize);
+
+	switch(nType)
+	{
+	case S_IFDIR:
+	{
+		if(!(bExists && S_ISDIR(st.st_mode)) && mkdirat(fdDir,pszLeaf,0700)<0)
+			return SkipFailed(pI,pEntry->nSize);
+		if(*pnDirs==*pnDirAlloc)
+		{
+			size_t nAlloc=*pnDirAlloc ? *pnDirAlloc*2 : 256;
+			DIR_ENTRY *pNew=(DIR_ENTRY *)realloc(*ppDirs,nAlloc*sizeof(DIR_ENTRY));
+			if(!pNew) return SkipFailed(pI,pEntry->nSize);
+			*ppDirs=pNew;
+			*pnDirAlloc=nAlloc;
+		}
+		DIR_ENTRY *pDir=&(*ppDirs)[(*pnDirs)++];
+		pDir->pszName=strdup(*pszName ? pszName : ".");
+		pDir->nMode=pEntry->nMode;
+		pDir->nMtime=pEntry->nMtime;
+		if(g_fPseudo) AddPseudo(pszName,'m',pEntry);
+		else if(g_bRoot) fchownat(fdDir,pszLeaf,pEntry->nUid,pEntry->nGid,AT_SYMLINK_NOFOLLOW);
+		return CopyData(pI,-1,pEntry->nSize);
+	}
+	case S_IFREG:
+	{
+		const char *pszFirst=pEntry->nNlink>1 ? FindLink(pEntry,pszName) : NULL;
+		int fd;
+		if(pszFirst)
+		{
+			if(linkat(fdRoot,pszFirst,fdDir,pszLeaf,0)<0) return SkipFailed(pI,pEntry->nSize);
+			if(!pEntry->nSize)
+			{
+				SetAttributes(fdDir,pszLeaf,pszName,pEntry);
+				return true;
+			}
+			fd=openat(fdDir,pszLeaf,O_WRONLY|O_TRUNC|O_NOFOLLOW);
+		}
+		else fd=openat(fdDir,pszLeaf,O_WRONLY|O_CREAT|O_TRUNC|O_NOFOLLOW,0600);
+		if(fd<0) return SkipFailed(pI,pEntry->nSize);
+
+		/* the links of a newc inode before the one with its data are
+		   empty until then, so only that one is indexed */
+		fmk_index_hash hash;
+		bool bIndex=fmk_index && (pEntry->nNlink<=1 || pEntry->nSize);
+		if(bIndex) fmk_index_start(&hash);
+		bool bOk=CopyData(pI,fd,pEntry->nSize,bIndex ? &hash : NULL);
+		if(close(fd)) bOk=false;
+		if(bOk) SetAttributes(fdDir,pszLeaf,pszName,pEntry);
+		if(bOk && bIndex) fmk_index_add(&hash,pszName,pEntry->nSize,pEntry->nMode);
+		return bOk;
+	}
+	case S_IFLNK:
+	{
+		char szTarget[FMK_PATH_LEN];
+		if(pEntry->nSize>=sizeof(szTarget)) return SkipFailed(pI,pEntry->nSize);
+		if(InputRead(pI,szTarget,pEntry->nSize)!=pEntry->nSize) return false;
+		szTarget[pEntry->nSize]='\0';
+		if(symlinkat(szTarget,fdDir,pszLeaf)<0) return false;
+		SetAttributes(fdDir,pszLeaf,pszName,pEntry);
+		return true;
+	}
+	case S_IFCHR:
+	case S_IFBLK:
+		if(g_fPseudo)
+		{
+			AddPseudo(pszName,nType==S_IFCHR ? 'c' : 'b',pEntry);
+			return CopyData(pI,-1,pEntry->nSize);
+		}
+		if(!g_bRoot)
+		{
+			fprintf(stderr, " WARNING device %s needs root or -p, skipped\n", pszName);
+			g_nWarnings++;
+			return CopyData(pI,-1,pEntry->nSize);
+		}
+		/* fall through */
+	case S_IFIFO:
+	case S_IFSOCK:
+		if(mknodat(fdDir,pszLeaf,nType|0600,makedev(pEntry->nRdevMajor,pEntry->nRdevMinor))<0)
+			return SkipFailed(pI,pEntry->nSize);
+		SetAttributes(fdDir,pszLeaf,pszName,pEntry);
+		return CopyData(pI,-1,pEntry->nSize);
+	default:
+		fprintf(stderr, " WARNING %s is of unknown type %o, skipped\n", pszName, nType);
+		g_nWarnings++;
+		return CopyData(pI,-1,pEntry->nSize);
+	}
+}
+
+int Extract(const char *pszArchive, const char *pszDir)
+{
+	DIR_ENTRY *pDirs=NULL;
+	size_t nDirs=0, nDirAlloc=0;
+	CPIO_ENTRY entry;
+	INPUT input;
+	int nFailed=0, nRet, nTrailers=0, nLinked=0;
+
+	int fd=strcmp(pszArchive,"-") ? open(pszArchive,O_RDONLY) : 0;
+	if(fd<0)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszArchive, strerror(errno));
+		return 1;
+	}
+	fmk_index_init("fmk-cpio",pszArchive);
+	mkdir(pszDir,0755);
+	int fdRoot=open(pszDir,O_RDONLY|O_DIRECTORY);
+	if(fdRoot<0)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszDir, strerror(errno));
+		return 1;
+	}
+	if(!InputOpen(&input,fd))
+	{
+		fprintf(stderr, " ERROR reading %s\n", pszArchive);
+		return 1;
+	}
+
+	while((nRet=CpioNext(&input,&entry,&nTrailers))==1)
+	{
+		char szName[FMK_PATH_LEN];
+		const char *pszLeaf;
+
+		if(nLinked!=nTrailers)
+		{
+			ClearLinks();
+			nLinked=nTrailers;
+		}
+		if(!MemberName(entry.szName,szName))
+		{
+			fprintf(stderr, " WARNING %s is outside the archive, skipped\n", entry.szName);
+			g_nWarnings++;
+			if(!CopyData(&input,-1,entry.nSize)) break;
+			continue;
+		}
+
+		int fdDir=*szName ? OpenParent(fdRoot,szName,&pszLeaf) : dup(fdRoot);
+		if(!*szName) pszLeaf=".";
+		if(fdDir<0 ? !SkipFailed(&input,entry.nSize) : !ExtractEntry(&input,fdRoot,fdDir,
+			pszLeaf,szName,&entry,&pDirs,&nDirs,&nDirAlloc))
+		{
+			fprintf(stderr, " ERROR extracting %s: %s\n", entry.szName,
+				input.bFailed ? "archive damaged" : strerror(errno));
+			nFailed++;
+			if(input.bFailed || input.bEnd) break;
+		}
+		if(fdDir>=0) close(fdDir);
+	}
+	if(nRet<0)
+	{
+		fprintf(stderr, " ERROR %s is %s\n", pszArchive, input.bFailed
+			? "damaged, or not compressed with gzip, xz or lzma"
+			: nTrailers ? "damaged" : "not a complete cpio archive");
+		nFailed++;
+	}
+
+	/* deepest first, so setting a directory read-only can't stop the rest */
+	while(nDirs--)
+	{
+		DIR_ENTRY *pDir=&pDirs[nDirs];
+		unsigned int nMode=g_fPseudo ? PSEUDO_MODE(pDir->nMode)
+			: g_bRoot ? pDir->nMode : pDir->nMode&~07000;
+		struct timespec times[2];
+
+		fchmodat(fdRoot,pDir->pszName,nMode&07777,0);
+		times[0].tv_sec=times[1].tv_sec=pDir->nMtime;
+		times[0].tv_nsec=times[1].tv_nsec=0;
+		utimensat(fdRoot,pDir->pszName,times,AT_SYMLINK_NOFOLLOW);
+		free(pDir->pszName);
+	}
+	free(pDirs);
+	ClearLinks();
+	InputClose(&input);
+	close(fdRoot);
+	if(fd) close(fd);
+	return nFailed ? 1 : 0;
+}
+
+/************************************************************
+	pseudo files
+************************************************************/
+
+static PSEUDO_DEF *FindDef(const char *pszName)
+{
+	for(PSEUDO_DEF *pDef=g_pDefs[HashString(pszName)%FMK_PSEUDO_HASH];pDef;pDef=pDef->pNext)
+	{
+		if(!strcmp(pDef->pszName,pszName)) return pDef;
+	}
+	return NULL;
+}
+
+/*************************************************************************
+* ReadPseudo
+*
+* reads the m, c and b lines of a pseudo file, the ones unsquashfs -pf
+* and -x -p write.  A later line for a path replaces an earlier one.
+*
+**************************************************************************/
+bool ReadPseudo(const char *pszPseudo)
+{
+	char szLine[FMK_PATH_LEN+128], szName[FMK_PATH_LEN];
+	int nLine=0;
+
+	FILE *f=fopen(pszPseudo,"r");
+	if(!f)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszPseudo, strerror(errno));
+		return false;
+	}
+	while(fgets(szLine,sizeof(szLine),f))
+	{
+		PSEUDO_DEF def;
+		char cType;
+		nLine++;
+
+		const char *psz=szLine+strspn(szLine," \t");
+		if(*psz=='#' || *psz=='\n' || !*psz) continue;
+		int nFields=sscanf(psz,"%4095s %c %o %u %u %u %u",szName,&cType,&def.nMode,
+			&def.nUid,&def.nGid,&def.nMajor,&def.nMinor);
+		if(!(nFields==5 && cType=='m') && !(nFields==7 && (cType=='c' || cType=='b')))
+		{
+			fprintf(stderr, " ERROR %s:%d isn't an m, c or b definition\n", pszPseudo, nLine);
+			fclose(f);
+			return false;
+		}
+
+		char szMember[FMK_PATH_LEN];
+		MemberName(szName,szMember);
+		PSEUDO_DEF *pDef=FindDef(szMember);
+		if(!pDef)
+		{
+			pDef=(PSEUDO_DEF *)calloc(1,sizeof(PSEUDO_DEF));
+			if(g_nDefs==g_nDefAlloc)
+			{
+				g_nDefAlloc=g_nDefAlloc ? g_nDefAlloc*2 : 256;
+				g_ppDefOrder=(PSEUDO_DEF **)realloc(g_ppDefOrder,g_nDefAlloc*sizeof(PSEUDO_DEF *));
+			}
+			if(!pDef || !g_ppDefOrder || !(pDef->pszName=strdup(szMember)))
+			{
+				fprintf(stderr, " ERROR out of memory\n");
+				fclose(f);
+				return false;
+			}
+			unsigned int nHash=HashString(szMember)%FMK_PSEUDO_HASH;
+			pDef->pNext=g_pDefs[nHash];
+			g_pDefs[nHash]=pDef;
+			g_ppDefOrder[g_nDefs++]=pDef;
+		}
+		pDef->cType=cType;
+		pDef->nMode=def.nMode&07777;
+		pDef->nUid=def.nUid;
+		pDef->nGid=def.nGid;
+		pDef->nMajor=nFields==7 ? def.nMajor : 0;
+		pDef->nMinor=nFields==7 ? def.nMinor : 0;
+	}
+	fclose(f);
+	return true;
+}
+
+/************************************************************
+	writing
+************************************************************/
+
+bool OutputOpen(OUTPUT *pO, int fd, int nType, bool bOdc)
+{
+	memset(pO,0,sizeof(*pO));
+	pO->fd=fd;
+	pO->nType=nType;
+	pO->bOdc=bOdc;
+	pO->pBuffer=(unsigned char *)malloc(FMK_BUFFER_LEN);
+	if(!pO->pBuffer) return false;
+
+	switch(nType)
+	{
+	case FMK_GZIP:
+		return deflateInit2(&pO->zs,9,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)==Z_OK;
+	case FMK_XZ:
+		/* the kernel's xz decoder checks CRC32s only */
+		pO->ls=LZMA_STREAM_INIT;
+		return lzma_easy_encoder(&pO->ls,6,LZMA_CHECK_CRC32)==LZMA_OK;
+	case FMK_LZMA:
+	{
+		lzma_options_lzma options;
+		pO->ls=LZMA_STREAM_INIT;
+		return !lzma_lzma_preset(&options,6)
+			&& lzma_alone_encoder(&pO->ls,&options)==LZMA_OK;
+	}
+	default:
+		return true;
+	}
+}
+
+/* compresses p, or with bFinish the end of the stream, to the archive */
+static bool OutputCode(OUTPUT *pO, const unsigned char *p, size_t nLength, bool bFinish)
+{
+	if(pO->nType==FMK_RAW) return WriteAll(pO->fd,p,nLength);
+
+	for(;;)
+	{
+		size_t nOut;
+		bool bDone;
+		if(pO->nType==FMK_GZIP)
+		{
+			pO->zs.next_in=(Bytef *)p;
+			pO->zs.avail_in=(uInt)nLength;
+			pO->zs.next_out=pO->pBuffer;
+			pO->zs.avail_out=FMK_BUFFER_LEN;
+			int nRet=deflate(&pO->zs,bFinish ? Z_FINISH : Z_NO_FLUSH);
+			if(nRet==Z_STREAM_ERROR) return false;
+			nOut=FMK_BUFFER_LEN-pO->zs.avail_out;
+			bDone=bFinish ? nRet==Z_STREAM_END : !pO->zs.avail_in && pO->zs.avail_out;
+		}
+		else
+		{
+			pO->ls.next_in=p;
+			pO->ls.avail_in=nLength;
+			pO->ls.next_out=pO->pBuffer;
+			pO->ls.avail_out=FMK_BUFFER_LEN;
+			lzma_ret ret=lzma_code(&pO->ls,bFinish ? LZMA_FINISH : LZMA_RUN);
+			if(ret!=LZMA_OK && ret!=LZMA_STREAM_END) return false;
+			nOut=FMK_BUFFER_LEN-pO->ls.avail_out;
+			bDone=bFinish ? ret==LZMA_STREAM_END : !pO->ls.avail_in && pO->ls.avail_out;
+		}
+		if(!WriteAll(pO->fd,pO->pBuffer,nOut)) return false;
+		if(bDone) return true;
+		size_t nUsed=nLength-(pO->nType==FMK_GZIP ? pO->zs.avail_in : pO->ls.avail_in);
+		p+=nUsed;
+		nLength-=nUsed;
+	}
+}
+
+static bool OutputWrite(OUTPUT *pO, const void *p, size_t nLength)
+{
+	pO->nTotal+=nLength;
+	return OutputCode(pO,(const unsigned char *)p,nLength,false);
+}
+
+static bool OutputPad(OUTPUT *pO, unsigned int nAlign)
+{
+	static const unsigned char zero[CPIO_BLOCK]={0};
+	return OutputWrite(pO,zero,(nAlign-pO->nTotal%nAlign)%nAlign);
+}
+
+bool OutputClose(OUTPUT *pO)
+{
+	bool bOk=OutputPad(pO,CPIO_BLOCK) && (pO->nType==FMK_RAW || OutputCode(pO,NULL,0,true));
+	if(pO->nType==FMK_GZIP) deflateEnd(&pO->zs);
+	if(pO->nType==FMK_XZ || pO->nType==FMK_LZMA) lzma_end(&pO->ls);
+	free(pO->pBuffer);
+	return bOk;
+}
+
+/* a header and the name, with an odc one's fields cut to their width */
+static bool CpioHeader(OUTPUT *pO, const char *pszName, const CPIO_ENTRY *pEntry)
+{
+	char header[CPIO_NEWC_LEN+1];
+	size_t nName=strlen(pszName)+1;
+
+	if(pO->bOdc)
+	{
+		unsigned int nRdev=makedev(pEntry->nRdevMajor,pEntry->nRdevMinor);
+		snprintf(header,sizeof(header),"070707%06o%06o%06o%06o%06o%06o%06o%011llo%06o%011llo",
+			0,(unsigned int)(pEntry->nIno&0777777),pEntry->nMode&0777777,
+			pEntry->nUid&0777777,pEntry->nGid&0777777,pEntry->nNlink&0777777,
+			nRdev&0777777,(unsigned long long)pEntry->nMtime&077777777777ULL,
+			(unsigned int)nName,pEntry->nSize);
+		return OutputWrite(pO,header,CPIO_ODC_LEN) && OutputWrite(pO,pszName,nName);
+	}
+
+	snprintf(header,sizeof(header),"070701%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X",
+		(unsigned int)pEntry->nIno,pEntry->nMode,pEntry->nUid,pEntry->nGid,
+		pEntry->nNlink,(unsigned int)pEntry->nMtime,(unsigned int)pEntry->nSize,
+		0,0,pEntry->nRdevMajor,pEntry->nRdevMinor,(unsigned int)nName,0);
+	return OutputWrite(pO,header,CPIO_NEWC_LEN) && OutputWrite(pO,pszName,nName)
+		&& OutputPad(pO,4);
+}
+
+static int CompareNames(const struct dirent **a, const struct dirent **b)
+{
+	return strcmp((*a)->d_name,(*b)->d_name);
+}
+
+static int SkipDots(const struct dirent *pEntry)
+{
+	return strcmp(pEntry->d_name,".") && strcmp(pEntry->d_name,"..");
+}
+
+/*************************************************************************
+* Collect
+*
+* lists pszName below pszDir, and everything below it, directories ahead
+* of what is in them and names in byte order, so the same tree always
+* makes the same archive
+*
+**************************************************************************/
+bool Collect(const char *pszDir, const char *pszName, NODE **ppNodes, size_t *pnNodes,
+	size_t *pnAlloc)
+{
+	char szPath[FMK_PATH_LEN];
+	struct stat st;
+
+	snprintf(szPath,sizeof(szPath),"%s%s%s",pszDir,*pszName ? "/" : "",pszName);
+	if(lstat(szPath,&st)<0)
+	{
+		fprintf(stderr, " ERROR reading %s: %s\n", szPath, strerror(errno));
+		return false;
+	}
+	if(*pnNodes==*pnAlloc)
+	{
+		size_t nAlloc=*pnAlloc ? *pnAlloc*2 : 1024;
+		NODE *pNew=(NODE *)realloc(*ppNodes,nAlloc*sizeof(NODE));
+		if(!pNew)
+		{
+			fprintf(stderr, " ERROR out of memory\n");
+			return false;
+		}
+		*ppNodes=pNew;
+		*pnAlloc=nAlloc;
+	}
+	NODE *pNode=&(*ppNodes)[(*pnNodes)++];
+	memset(pNode,0,sizeof(*pNode));
+	pNode->pszName=strdup(pszName);
+	pNode->st=st;
+	if(!S_ISDIR(st.st_mode)) return true;
+
+	struct dirent **ppEntries;
+	int nEntries=scandir(szPath,&ppEntries,SkipDots,CompareNames);
+	bool bOk=nEntries>=0;
+	if(!bOk) fprintf(stderr, " ERROR reading %s: %s\n", szPath, strerror(errno));
+	for(int nI=0;nI<nEntries;nI++)
+	{
+		char szChild[FMK_PATH_LEN];
+		snprintf(szChild,sizeof(szChild),"%s%s%s",pszName,*pszName ? "/" : "",
+			ppEntries[nI]->d_name);
+		if(bOk) bOk=Collect(pszDir,szChild,ppNodes,pnNodes,pnAlloc);
+		free(ppEntries[nI]);
+	}
+	if(nEntries>=0) free(ppEntries);
+	return bOk;
+}
+
+/*************************************************************************
+* LinkNodes
+*
+* numbers the inodes from 1, and counts the links of those with more
+* than one in the tree.  The last of them in the archive carries the
+* data in newc, as GNU cpio writes it; odc repeats it in every one.
+*
+**************************************************************************/
+bool LinkNodes(NODE *pNodes, size_t nNodes, bool bOdc)
+{
+	typedef struct _INODE
+	{
+		dev_t nDev;
+		ino_t nIno;
+		unsigned long long nNumber;
+		unsigned int nLinks;
+		size_t nLast;
+		struct _INODE *pNext;
+	} INODE;
+	INODE **ppHash=(INODE **)calloc(FMK_LINK_HASH,sizeof(INODE *));
+	unsigned long long nNext=1;
+	bool bOk=ppHash!=NULL;
+
+	for(size_t nI=0;bOk && nI<nNodes;nI++)
+	{
+		NODE *pNode=&pNodes[nI];
+		pNode->nNlink=S_ISDIR(pNode->st.st_mode) ? 2 : 1;
+		pNode->bData=true;
+		if(!S_ISREG(pNode->st.st_mode) || pNode->st.st_nlink<2)
+		{
+			pNode->nIno=nNext++;
+			continue;
+		}
+
+		unsigned int nHash=HashInode(pNode->st.st_dev,pNode->st.st_ino)%FMK_LINK_HASH;
+		INODE *pInode;
+		for(pInode=ppHash[nHash];pInode;pInode=pInode->pNext)
+		{
+			if(pInode->nDev==pNode->st.st_dev && pInode->nIno==pNode->st.st_ino) break;
+		}
+		if(!pInode && (pInode=(INODE *)calloc(1,sizeof(INODE)))!=NULL)
+		{
+			pInode->nDev=pNode->st.st_dev;
+			pInode->nIno=pNode->st.st_ino;
+			pInode->nNumber=nNext++;
+			pInode->pNext=ppHash[nHash];
+			ppHash[nHash]=pInode;
+		}
+		bOk=pInode!=NULL;
+		if(bOk)
+		{
+			pNode->nIno=pInode->nNumber;
+			pInode->nLinks++;
+			pInode->nLast=nI;
+		}
+	}
+
+	/* every link has the count, and only the last the data in newc */
+	for(size_t nI=0;bOk && nI<nNodes;nI++)
+	{
+		NODE *pNode=&pNodes[nI];
+		if(!S_ISREG(pNode->st.st_mode) || pNode->st.st_nlink<2) continue;
+
+		unsigned int nHash=HashInode(pNode->st.st_dev,pNode->st.st_ino)%FMK_LINK_HASH;
+		INODE *pInode;
+		for(pInode=ppHash[nHash];pInode->nNumber!=pNode->nIno;pInode=pInode->pNext);
+		pNode->nNlink=pInode->nLinks;
+		pNode->bData=bOdc || pInode->nLast==nI;
+	}
+
+	for(int nI=0;ppHash && nI<FMK_LINK_HASH;nI++)
+	{
+		while(ppHash[nI])
+		{
+			INODE *pNext=ppHash[nI]->pNext;
+			free(ppHash[nI]);
+			ppHash[nI]=pNext;
+		}
+	}
+	free(ppHash);
+	if(!bOk) fprintf(stderr, " ERROR out of memory\n");
+	return bOk;
+}
+
+/* writes a node of the tree, with its owner and mode from the pseudo
+   file if there is one, and root's if the pseudo file doesn't name it */
+bool WriteNode(OUTPUT *pO, const char *pszDir, const NODE *pNode)
+{
+	char szPath[FMK_PATH_LEN], szTarget[FMK_PATH_LEN];
+	const struct stat *pSt=&pNode->st;
+	CPIO_ENTRY entry;
+
+	memset(&entry,0,sizeof(entry));
+	entry.nIno=pNode->nIno;
+	entry.nMode=pSt->st_mode;
+	entry.nUid=pSt->st_uid;
+	entry.nGid=pSt->st_gid;
+	entry.nNlink=pNode->nNlink;
+	entry.nMtime=pSt->st_mtime;
+	if(S_ISCHR(pSt->st_mode) || S_ISBLK(pSt->st_mode))
+	{
+		entry.nRdevMajor=major(pSt->st_rdev);
+		entry.nRdevMinor=minor(pSt->st_rdev);
+	}
+	if(g_bPseudo)
+	{
+		PSEUDO_DEF *pDef=FindDef(pNode->pszName);
+		entry.nUid=entry.nGid=0;
+		if(pDef)
+		{
+			pDef->bUsed=true;
+			entry.nMode=(entry.nMode&S_IFMT) | pDef->nMode;
+			entry.nUid=pDef->nUid;
+			entry.nGid=pDef->nGid;
+		}
+	}
+
+	snprintf(szPath,sizeof(szPath),"%s%s%s",pszDir,*pNode->pszName ? "/" : "",
+		pNode->pszName);
+	const char *pszName=*pNode->pszName ? pNode->pszName : ".";
+	if(S_ISLNK(pSt->st_mode))
+	{
+		ssize_t nTarget=readlink(szPath,szTarget,sizeof(szTarget));
+		if(nTarget<0) return false;
+		entry.nSize=nTarget;
+		return CpioHeader(pO,pszName,&entry) && OutputWrite(pO,szTarget,nTarget)
+			&& (pO->bOdc || OutputPad(pO,4));
+	}
+	if(!S_ISREG(pSt->st_mode) || !pNode->bData || !pSt->st_size)
+		return CpioHeader(pO,pszName,&entry);
+
+	int fd=open(szPath,O_RDONLY);
+	if(fd<0) return false;
+	entry.nSize=pSt->st_size;
+	bool bOk=CpioHeader(pO,pszName,&entry);
+	unsigned long long nLeft=entry.nSize;
+	while(bOk && nLeft)
+	{
+		ssize_t nRead=read(fd,g_buffer,nLeft<FMK_BUFFER_LEN ? nLeft : FMK_BUFFER_LEN);
+		if(nRead<0 && errno==EINTR) continue;
+		if(nRead<=0)
+		{
+			/* shrunk while it was read */
+			errno=nRead ? errno : EIO;
+			bOk=false;
+			break;
+		}
+		bOk=OutputWrite(pO,g_buffer,nRead);
+		nLeft-=nRead;
+	}
+	close(fd);
+	return bOk && (pO->bOdc || OutputPad(pO,4));
+}
+
+int Create(const char *pszDir, const char *pszArchive, int nType, bool bOdc)
+{
+	NODE *pNodes=NULL;
+	size_t nNodes=0, nAlloc=0;
+	OUTPUT output;
+	int nFailed=0;
+
+	if(!Collect(pszDir,"",&pNodes,&nNodes,&nAlloc) || !LinkNodes(pNodes,nNodes,bOdc))
+	{
+		return 1;
+	}
+	int fd=strcmp(pszArchive,"-") ? open(pszArchive,O_WRONLY|O_CREAT|O_TRUNC,0644) : 1;
+	if(fd<0 || !OutputOpen(&output,fd,nType,bOdc))
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszArchive, strerror(errno));
+		return 1;
+	}
+
+	unsigned long long nIno=nNodes+1;
+	for(size_t nI=0;nI<nNodes;nI++)
+	{
+		/* a device the pseudo file has takes the place of what is there */
+		PSEUDO_DEF *pDef=g_nDefs ? FindDef(pNodes[nI].pszName) : NULL;
+		if(pDef && pDef->cType!='m') continue;
+		if(!WriteNode(&output,pszDir,&pNodes[nI]))
+		{
+			fprintf(stderr, " ERROR archiving %s/%s: %s\n", pszDir, pNodes[nI].pszName,
+				strerror(errno));
+			nFailed++;
+			break;
+		}
+	}
+
+	/* the device nodes, which -x -p and unsquashfs -pf leave out of the tree */
+	for(size_t nI=0;!nFailed && nI<g_nDefs;nI++)
+	{
+		PSEUDO_DEF *pDef=g_ppDefOrder[nI];
+		CPIO_ENTRY entry;
+
+		if(pDef->cType=='m')
+		{
+			if(!pDef->bUsed)
+			{
+				fprintf(stderr, " WARNING %s in the pseudo file isn't in %s\n",
+					*pDef->pszName ? pDef->pszName : "/", pszDir);
+				g_nWarnings++;
+			}
+			continue;
+		}
+		memset(&entry,0,sizeof(entry));
+		entry.nIno=nIno++;
+		entry.nMode=(pDef->cType=='c' ? S_IFCHR : S_IFBLK) | pDef->nMode;
+		entry.nUid=pDef->nUid;
+		entry.nGid=pDef->nGid;
+		entry.nNlink=1;
+		entry.nRdevMajor=pDef->nMajor;
+		entry.nRdevMinor=pDef->nMinor;
+		if(!CpioHeader(&output,pDef->pszName,&entry))
+		{
+			fprintf(stderr, " ERROR writing %s: %s\n", pszArchive, strerror(errno));
+			nFailed++;
+		}
+	}
+
+	CPIO_ENTRY trailer;
+	memset(&trailer,0,sizeof(trailer));
+	trailer.nNlink=1;
+	if(!nFailed && (!CpioHeader(&output,CPIO_TRAILER,&trailer) || !OutputClose(&output)))
+	{
+		fprintf(stderr, " ERROR writing %s: %s\n", pszArchive, strerror(errno));
+		nFailed++;
+	}
+	if(fd!=1 && close(fd) && !nFailed)
+	{
+		fprintf(stderr, " ERROR writing %s: %s\n", pszArchive, strerror(errno));
+		nFailed++;
+	}
+	for(size_t nI=0;nI<nNodes;nI++) free(pNodes[nI].pszName);
+	free(pNodes);
+	if(nFailed && fd!=1) unlink(pszArchive);
+	return nFailed ? 1 : 0;
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-cpio -x [-p pseudo] archive dir\n"
+		"        fmk-cpio -c [-p pseudo] [-H newc|odc] [-z none|gzip|xz|lzma] dir archive\n"
+		"  -x extracts a newc or odc cpio archive, compressed with gzip, xz\n"
+		"     or lzma or not, into dir\n"
+		"  -c archives dir, newc and uncompressed unless -H and -z say otherwise\n"
+		"  -p pseudo  the owners, set-id bits and device nodes are written to,\n"
+		"             or read from, the pseudo file, so root isn't needed\n"
+		"  an archive of - is standard input or output\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	const char *pszPseudo=NULL;
+	int nType=FMK_RAW, nArg=2;
+	bool bOdc=false;
+
+	if(argc<2 || (strcmp(argv[1],"-x") && strcmp(argv[1],"-c")))
+	{
+		ShowUsage();
+	}
+	bool bExtract=argv[1][1]=='x';
+	for(;nArg+1<argc && argv[nArg][0]=='-' && argv[nArg][1];nArg+=2)
+	{
+		const char *pszValue=argv[nArg+1];
+		if(!strcmp(argv[nArg],"-p")) pszPseudo=pszValue;
+		else if(!strcmp(argv[nArg],"-H") && !bExtract && (!strcmp(pszValue,"newc")
+			|| !strcmp(pszValue,"odc")))
+			bOdc=pszValue[0]=='o';
+		else if(!strcmp(argv[nArg],"-z") && !bExtract)
+		{
+			if(!strcmp(pszValue,"none")) nType=FMK_RAW;
+			else if(!strcmp(pszValue,"gzip")) nType=FMK_GZIP;
+			else if(!strcmp(pszValue,"xz")) nType=FMK_XZ;
+			else if(!strcmp(pszValue,"lzma")) nType=FMK_LZMA;
+			else ShowUsage();
+		}
+		else ShowUsage();
+	}
+	if(argc!=nArg+2)
+	{
+		ShowUsage();
+	}
+	g_bRoot=geteuid()==0;
+
+	int nRet;
+	if(bExtract)
+	{
+		if(pszPseudo && !(g_fPseudo=fopen(pszPseudo,"w")))
+		{
+			fprintf(stderr, " ERROR opening %s: %s\n", pszPseudo, strerror(errno));
+			return 1;
+		}
+		nRet=Extract(argv[nArg],argv[nArg+1]);
+		if(g_fPseudo && fclose(g_fPseudo))
+		{
+			fprintf(stderr, " ERROR writing %s: %s\n", pszPseudo, strerror(errno));
+			nRet=1;
+		}
+	}
+	else
+	{
+		g_bPseudo=pszPseudo!=NULL;
+		if(g_bPseudo && !ReadPseudo(pszPseudo))
+		{
+			return 1;
+		}
+		nRet=Create(argv[nArg],argv[nArg+1],nType,bOdc);
+	}
+	if(g_nWarnings)
+	{
+		fprintf(stderr, " %d warning(s)\n", g_nWarnings);
+	}
+	return nRet;
+}
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-daemon.cc
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/*
+ * Serves extract, build and list requests over a Unix socket, for a
+ * service that would otherwise start the scripts for every upload.
+ * fmk-daemon.sh builds the tools once and starts it from the FMK
+ * directory with FMK_TOOLS_BUILT set, so no request checks or builds
+ * them again, and it runs as the user the jobs need, so none asks for
+ * sudo.  Each connection carries one request, a line of tab separated
+ * words, and gets back the output of the job followed by a last line
+ * "FMK-STATUS <exit status>".  At most -j requests run at once, the
+ * rest wait in the listen backlog.  fmk-daemon -c is a client for it.
+ */
+
+#define FMK_PATH_LEN	4096
+#define FMK_REQUEST_LEN	(4*FMK_PATH_LEN)
+#define FMK_MAX_ARGS	8
+#define FMK_STATUS	"FMK-STATUS "
+#define FMK_BACKLOG	64
+#define FMK_IDLE_SECS	30	/* for the request line to arrive */
+
+/* the length of the rootfs path, for the names ListEntry prints */
+static size_t g_nRoot;
+
+/************************************************************
+	server
+************************************************************/
+
+/* reads the request line, without its newline */
+bool ReadRequest(int fd, char *pszRequest, size_t nRequest)
+{
+	size_t nRead=0;
+
+	while(nRead<nRequest-1)
+	{
+		ssize_t n=read(fd,pszRequest+nRead,1);
+		if(n<0 && errno==EINTR) continue;
+		if(n<=0) return false;
+		if(pszRequest[nRead]=='\n') break;
+		nRead++;
+	}
+	pszRequest[nRead]='\0';
+	return nRead<nRequest-1;
+}
+
+static int ListEntry(const char *pszPath, const struct stat *pSt, int, struct FTW *)
+{
+	printf("%06o %u %u %lld /%s\n", (unsigned)pSt->st_mode, (unsigned)pSt->st_uid,
+		(unsigned)pSt->st_gid, (long long)pSt->st_size,
+		strlen(pszPath)>g_nRoot ? pszPath+g_nRoot+1 : "");
+	return 0;
+}
+
+/*************************************************************************
+* RunRequest
+*
+* runs the job of a request with its output going to the client, and
+* doesn't return
+*
+**************************************************************************/
+void RunRequest(char **ppArgs, int nArgs)
+{
+	const char *pszOp=ppArgs[0];
+
+	if(!strcmp(pszOp,"extract") && nArgs==3)
+	{
+		execl("./extract-firmware.sh","extract-firmware.sh",ppArgs[1],ppArgs[2],(char *)NULL);
+	}
+	else if(!strcmp(pszOp,"build") && (nArgs==2 || nArgs==3))
+	{
+		execl("./build-firmware.sh","build-firmware.sh",ppArgs[1],nArgs==3 ? ppArgs[2] : (char *)NULL,
+			(char *)NULL);
+	}
+	else if(!strcmp(pszOp,"list") && nArgs==2)
+	{
+		char szRoot[FMK_PATH_LEN];
+		snprintf(szRoot,sizeof(szRoot),"%s/rootfs",ppArgs[1]);
+		g_nRoot=strlen(szRoot);
+		if(nftw(szRoot,ListEntry,64,FTW_PHYS)<0)
+		{
+			printf("ERROR listing %s: %s\n", szRoot, strerror(errno));
+			fflush(stdout);
+			_exit(1);
+		}
+		fflush(stdout);
+		_exit(0);
+	}
+	else
+	{
+		printf("ERROR: expected extract <image> <dir>, build <dir> [-nopad | -min] or list <dir>\n");
+		fflush(stdout);
+		_exit(2);
+	}
+	printf("ERROR starting %s: %s\n", pszOp, strerror(errno));
+	fflush(stdout);
+	_exit(127);
+}
+
+/*************************************************************************
+* HandleClient
+*
+* reads one request, runs it in a child and reports how it exited
+*
+**************************************************************************/
+void HandleClient(int fdClient)
+{
+	char szRequest[FMK_REQUEST_LEN], *ppArgs[FMK_MAX_ARGS];
+	struct timeval tv={FMK_IDLE_SECS,0};
+	int nArgs=0, nStatus=0;
+
+	setsockopt(fdClient,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+	if(!ReadRequest(fdClient,szRequest,sizeof(szRequest))) return;
+	for(char *psz=strtok(szRequest,"\t");psz && nArgs<FMK_MAX_ARGS;psz=strtok(NULL,"\t"))
+	{
+		ppArgs[nArgs++]=psz;
+	}
+	if(!nArgs) return;
+
+	pid_t pid=fork();
+	if(pid==0)
+	{
+		int fdNull=open("/dev/null",O_RDONLY);
+		dup2(fdNull,0);
+		dup2(fdClient,1);
+		dup2(fdClient,2);
+		close(fdClient);
+		RunRequest(ppArgs,nArgs);
+	}
+	if(pid<0 || waitpid(pid,&nStatus,0)<0)
+	{
+		nStatus=127;
+	}
+	else
+	{
+		nStatus=WIFEXITED(nStatus) ? WEXITSTATUS(nStatus) : 128+WTERMSIG(nStatus);
+	}
+	dprintf(fdClient,FMK_STATUS "%d\n",nStatus);
+}
+
+int Serve(const char *pszSocket, int nJobs)
+{
+	struct sockaddr_un addr;
+	int nRunning=0;
+
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	if(strlen(pszSocket)>=sizeof(addr.sun_path))
+	{
+		fprintf(stderr, " ERROR: socket path %s is too long\n", pszSocket);
+		return 1;
+	}
+	strcpy(addr.sun_path,pszSocket);
+
+	/* only the user running it may connect */
+	unlink(pszSocket);
+	mode_t nMask=umask(077);
+	int fdListen=socket(AF_UNIX,SOCK_STREAM,0);
+	if(fdListen<0 || bind(fdListen,(struct sockaddr *)&addr,sizeof(addr))<0
+		|| listen(fdListen,FMK_BACKLOG)<0)
+	{
+		fprintf(stderr, " ERROR listening on %s: %s\n", pszSocket, strerror(errno));
+		return 1;
+	}
+	umask(nMask);
+	signal(SIGPIPE,SIG_IGN);
+	printf("Listening on %s, %d job(s) at a time\n", pszSocket, nJobs);
+	fflush(stdout);
+
+	for(;;)
+	{
+		while(nRunning>0 && waitpid(-1,NULL,nRunning<nJobs ? WNOHANG : 0)>0)
+		{
+			nRunning--;
+		}
+
+		int fdClient=accept(fdListen,NULL,NULL);
+		if(fdClient<0)
+		{
+			if(errno==EINTR || errno==ECONNABORTED) continue;
+			fprintf(stderr, " ERROR accepting on %s: %s\n", pszSocket, strerror(errno));
+			return 1;
+		}
+		pid_t pid=fork();
+		if(pid==0)
+		{
+			close(fdListen);
+			HandleClient(fdClient);
+			_exit(0);
+		}
+		if(pid>0) nRunning++;
+		close(fdClient);
+	}
+}
+
+/************************************************************
+	client
+************************************************************/
+
+/* paths go to the daemon absolute, as it runs from the FMK directory */
+static void AppendArg(char *pszRequest, size_t nRequest, const char *pszArg, bool bFirst)
+{
+	char szCwd[FMK_PATH_LEN];
+	size_t nLength=strlen(pszRequest);
+
+	if(!bFirst && pszArg[0]!='/' && pszArg[0]!='-' && getcwd(szCwd,sizeof(szCwd)))
+	{
+		snprintf(pszRequest+nLength,nRequest-nLength,"\t%s/%s",szCwd,pszArg);
+	}
+	else
+	{
+		snprintf(pszRequest+nLength,nRequest-nLength,"%s%s",bFirst ? "" : "\t",pszArg);
+	}
+}
+
+/*************************************************************************
+* Client
+*
+* sends one request and copies the output to stdout, returning the exit
+* status of the job
+*
+**************************************************************************/
+int Client(const char *pszSocket, char **ppArgs, int nArgs)
+{
+	struct sockaddr_un addr;
+	char szRequest[FMK_REQUEST_LEN]="", szLine[FMK_REQUEST_LEN], buf[65536];
+	size_t nLine=0;
+	int nStatus=-1;
+
+	for(int nI=0;nI<nArgs;nI++)
+	{
+		AppendArg(szRequest,sizeof(szRequest)-1,ppArgs[nI],nI==0);
+	}
+	strcat(szRequest,"\n");
+
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	snprintf(addr.sun_path,sizeof(addr.sun_path),"%s",pszSocket);
+	int fd=socket(AF_UNIX,SOCK_STREAM,0);
+	if(fd<0 || connect(fd,(struct sockaddr *)&addr,sizeof(addr))<0
+		|| write(fd,szRequest,strlen(szRequest))!=(ssize_t)strlen(szRequest))
+	{
+		fprintf(stderr, " ERROR connecting to %s: %s\n", pszSocket, strerror(errno));
+		return 1;
+	}
+
+	/* everything but the status line is the job's */
+	for(;;)
+	{
+		ssize_t n=read(fd,buf,sizeof(buf));
+		if(n<0 && errno==EINTR) continue;
+		if(n<=0) break;
+		for(ssize_t nI=0;nI<n;nI++)
+		{
+			szLine[nLine++]=buf[nI];
+			if(buf[nI]!='\n' && nLine<sizeof(szLine)-1) continue;
+			szLine[nLine]='\0';
+			if(!strncmp(szLine,FMK_STATUS,sizeof(FMK_STATUS)-1))
+				nStatus=atoi(szLine+sizeof(FMK_STATUS)-1);
+			else
+				fwrite(szLine,1,nLine,stdout);
+			nLine=0;
+		}
+	}
+	fwrite(szLine,1,nLine,stdout);
+	close(fd);
+
+	if(nStatus<0)
+	{
+		fprintf(stderr, " ERROR: %s closed the connection\n", pszSocket);
+		return 1;
+	}
+	return nStatus;
+}
+
+/************************************************************
+	main
+************************************************************/
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-daemon [-j jobs] socket\n"
+		"        fmk-daemon -c socket extract image dir\n"
+		"        fmk-daemon -c socket build dir [-nopad | -min]\n"
+		"        fmk-daemon -c socket list dir\n"
+		"  serves extract, build and list requests on the Unix socket,\n"
+		"  from the FMK directory, or with -c sends one and exits with\n"
+		"  its status.\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	int nJobs=(int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if(argc>3 && !strcmp(argv[1],"-c"))
+	{
+		return Client(argv[2],argv+3,argc-3);
+	}
+	if(argc==4 && !strcmp(argv[1],"-j"))
+	{
+		nJobs=atoi(argv[2]);
+		argv+=2;
+		argc-=2;
+	}
+	if(argc!=2 || nJobs<1)
+	{
+		ShowUsage();
+	}
+	return Serve(argv[1],nJobs);
+}
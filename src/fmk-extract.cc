@@ -0,0 +1,2161 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-extract.cc
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <lzma.h>
+#include <zlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "untrx.h"
+#include "fwimage.h"
+#include "crcalc/md5.h"
+
+extern "C"
+{
+#include "crcalc/common.h"
+#include "crcalc/manifest.h"
+}
+
+/*
+ * The scanning and carving half of extract-firmware.sh in one process.
+ * The image is mapped once and walked for the containers fwimage.h
+ * knows, the file systems the kit unpacks and LZMA data, using the
+ * signatures and descriptions of the kit's binwalk magic.  binwalk.log
+ * therefore still feeds crcalc, and config.log reads as before.
+ * header.img, rootfs.img and footer.img are copied out with
+ * WriteSegment, and the CRC prefixes crcalc resumes from are saved
+ * straight from the mapping.  All of it goes to logs/manifest.bin too,
+ * which crcalc and fmk-assemble map instead of parsing the text logs.
+ * Unpacking the file system stays with the script, which runs the
+ * extractor as root.
+ */
+
+#define FMK_DESCRIPTION_LEN	512
+#define FMK_PATH_LEN		4096
+#define FMK_FOOTER_LINES	10	/* hexdump -C lines a footer may span */
+#define FMK_LINE_LEN		16
+#define FMK_SCAN_THREADS	16
+#define FMK_SCAN_CHUNK_MIN	(8*1024*1024)	/* smaller images scan in one go */
+#define FMK_SCAN_ALIGN		4	/* of all but compressed data, in a flash dump */
+#define FMK_ERASE_BLOCK		(64*1024)
+#define FMK_ENTROPY_BLOCK	4096
+#define FMK_ENTROPY_SCALE	32	/* the map holds 1/32 bits per byte */
+#define FMK_ENTROPY_HIGH	(7*FMK_ENTROPY_SCALE+FMK_ENTROPY_SCALE/2)	/* 7.5 bits */
+#define FMK_STREAM_WINDOW	(256*1024*1024)	/* the most a stream holds */
+#define FMK_STREAM_LOOKAHEAD	(64*1024)	/* taken to settle all but containers */
+#define FMK_ENTROPY_BLOCKS(nSize)	(((nSize)+FMK_ENTROPY_BLOCK-1)/FMK_ENTROPY_BLOCK)
+#define FMK_PARTITIONS		16	/* file systems config.log lists */
+
+typedef struct _SCAN_RESULT
+{
+	size_t nOffset;
+	bool bHeader;		/* a container header crcalc patches */
+	bool bFilesystem;
+	bool bOneOfMany;	/* only the first of a run is logged */
+	bool bData;		/* compressed data, never the header */
+	size_t nHeaderSize;
+	char szDescription[FMK_DESCRIPTION_LEN];
+} SCAN_RESULT;
+
+/* a part of the image a scan thread covers */
+typedef struct _SCAN_CHUNK
+{
+	unsigned char *pData;
+	size_t nSize;
+	size_t nStart, nEnd;
+	size_t *pHits;		/* offsets where ScanAt found something */
+	size_t nHits, nAlloc;
+	unsigned char *pEntropy;	/* the map of the whole image */
+	bool bAligned;		/* only compressed data between FMK_SCAN_ALIGN */
+	bool bFailed;
+	bool bJoined;		/* scanned without a thread of its own */
+} SCAN_CHUNK;
+
+typedef void (*SCAN_CALLBACK)(const SCAN_RESULT *pR, void *pContext);
+
+/* a scan of data pushed in as it arrives, holding a window of it */
+typedef struct _SCAN_STREAM
+{
+	unsigned char *pWindow;
+	size_t nBase;		/* the stream offset of pWindow[0] */
+	size_t nFill, nAlloc;
+	size_t nPos;		/* the next offset to scan */
+	unsigned char *pEntropy;	/* the map so far */
+	size_t nBlocks, nEntropyAlloc;
+	size_t nClaimNext;	/* the next block of an LZMA claim to check */
+	bool bClaim;
+	bool bRun;
+	bool bLast;
+	bool bFailed;
+	SCAN_RESULT last;	/* the last result reported, for runs */
+	SCAN_CALLBACK pfnResult;
+	void *pContext;
+} SCAN_STREAM;
+
+/* a bit for each pair of bytes a signature below can start with, and
+   for those of compressed data only */
+static uint32_t g_nLeads[65536/32];
+static uint32_t g_nDataLeads[65536/32];
+
+/* n*log2(n) for each count a block can have */
+static double g_dNLogN[FMK_ENTROPY_BLOCK+1];
+
+/************************************************************
+	helpers
+************************************************************/
+
+static inline uint16_t Get16(const unsigned char *p, bool bBig)
+{
+	return bBig ? FwGet16BE(p) : (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t Get32(const unsigned char *p, bool bBig)
+{
+	return bBig ? FwGet32BE(p) : FwGet32LE(p);
+}
+
+static inline uint64_t Get64(const unsigned char *p, bool bBig)
+{
+	if(bBig) return (uint64_t)FwGet32BE(p)<<32 | FwGet32BE(p+4);
+	return (uint64_t)FwGet32LE(p+4)<<32 | FwGet32LE(p);
+}
+
+static void Append(SCAN_RESULT *pR, const char *pszFormat, ...)
+{
+	size_t nLen=strlen(pR->szDescription);
+	va_list args;
+	va_start(args,pszFormat);
+	vsnprintf(pR->szDescription+nLen,sizeof(pR->szDescription)-nLen,
+		pszFormat,args);
+	va_end(args);
+}
+
+/* a timestamp the way the magic's date types print it */
+static const char *FormatDate(uint32_t nTime, char *pszBuf, size_t nBuf)
+{
+	time_t t=nTime;
+	struct tm tm;
+	if(!gmtime_r(&t,&tm) || !strftime(pszBuf,nBuf,"%a %b %e %H:%M:%S %Y",&tm))
+		snprintf(pszBuf,nBuf,"%u",nTime);
+	return pszBuf;
+}
+
+/************************************************************
+	containers
+************************************************************/
+
+/*************************************************************************
+* DescribeContainer
+*
+* logs a container fwimage.h found.  The formats crcalc patches get a
+* "header" line, as in the binwalk magic; Buffalo images are left out,
+* binwalk never listed them and their contents are encrypted.
+*
+**************************************************************************/
+bool DescribeContainer(const FwContainer *pC, SCAN_RESULT *pR)
+{
+	const unsigned char *p=pC->header.pData;
+	char szDate[64];
+
+	memset(pR,0,sizeof(SCAN_RESULT));
+	pR->nOffset=pC->nOffset;
+	pR->nHeaderSize=pC->header.nLength;
+
+	switch(pC->format)
+	{
+		case FW_FORMAT_TRX:
+			pR->bHeader=true;
+			Append(pR,"TRX firmware header, little endian, header size: %u bytes, "
+				"image size: %u bytes, CRC32: 0x%X flags/version: 0x%X",
+				FW_TRX_HEADER_SIZE,FwGet32LE(p+4),FwGet32LE(p+8),
+				FwGet32LE(p+12));
+			return true;
+		case FW_FORMAT_UIMAGE:
+			pR->bHeader=true;
+			Append(pR,"uImage header, header size: %u bytes, header CRC: 0x%X, "
+				"created: %s, image size: %u bytes, Data Address: 0x%X, "
+				"Entry Point: 0x%X, data CRC: 0x%X, image name: \"%.32s\"",
+				FW_UIMAGE_HEADER_SIZE,FwGet32BE(p+4),
+				FormatDate(FwGet32BE(p+8),szDate,sizeof(szDate)),
+				FwGet32BE(p+12),FwGet32BE(p+16),FwGet32BE(p+20),
+				FwGet32BE(p+24),(const char *)p+32);
+			return true;
+		case FW_FORMAT_DLOB:
+			pR->bHeader=true;
+			Append(pR,"DLOB firmware header, header size: %lu bytes, "
+				"image size: %lu bytes",(unsigned long)pC->header.nLength,
+				(unsigned long)pC->payload.nLength);
+			return true;
+		case FW_FORMAT_TPLINK:
+			pR->bHeader=true;
+			Append(pR,"TP-Link firmware header, header size: %u bytes, "
+				"image size: %u bytes, firmware version: %d.%d.%d, "
+				"image version: \"%.36s\", product ID: 0x%X, "
+				"product version: %d, kernel load address: 0x%X, "
+				"kernel entry point: 0x%X, kernel offset: %d, "
+				"kernel length: %d, rootfs offset: %d, rootfs length: %d, "
+				"bootloader offset: %d, bootloader length: %d",
+				FW_TPLINK_HEADER_SIZE,FwGet32BE(p+0x7c),FwGet16BE(p+0x98),
+				FwGet16BE(p+0x9a),FwGet16BE(p+0x9c),(const char *)p+0x1c,
+				FwGet32BE(p+0x40),FwGet32BE(p+0x44),FwGet32BE(p+0x74),
+				FwGet32BE(p+0x78),FwGet32BE(p+0x80),FwGet32BE(p+0x84),
+				FwGet32BE(p+0x88),FwGet32BE(p+0x8c),FwGet32BE(p+0x90),
+				FwGet32BE(p+0x94));
+			return true;
+		case FW_FORMAT_SEAMA:
+			/* no "header" here, crcalc has nothing to patch in it */
+			Append(pR,"Seama firmware image, meta size: %u bytes, "
+				"image size: %lu bytes",FwGet16BE(p+6),
+				(unsigned long)pC->payload.nLength);
+			return true;
+		default:
+			return false;
+	}
+}
+
+/************************************************************
+	file systems
+************************************************************/
+
+static const struct
+{
+	char szMagic[5];
+	bool bBig;
+	const char *pszNote;
+} g_Squashfs[]=
+{
+	{"sqsh",true,""},
+	{"hsqs",false,""},
+	{"sqlz",true," lzma compression,"},
+	{"qshs",true," lzma signature,"},
+	{"tqsh",true," DD-WRT signature,"},
+	{"hsqt",false," DD-WRT signature,"},
+	{"shsq",false," non-standard signature,"}
+};
+
+#define SQUASHFS_SUPER_MIN	72	/* up to the 3.x bytes_used */
+
+bool IdentifySquashfs(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	static const char *compressors[]={"invalid","gzip","lzma","lzo","xz"};
+	char szDate[64];
+
+	if(nAvail<SQUASHFS_SUPER_MIN) return false;
+	for(size_t nI=0;nI<sizeof(g_Squashfs)/sizeof(g_Squashfs[0]);nI++)
+	{
+		if(memcmp(p,g_Squashfs[nI].szMagic,4)) continue;
+
+		bool bBig=g_Squashfs[nI].bBig;
+		unsigned nMajor=Get16(p+28,bBig), nMinor=Get16(p+30,bBig);
+		if(nMajor<1 || nMajor>10 || nMinor>10) return false;
+
+		/* the superblock moved its fields around between versions */
+		uint64_t nBytes=nMajor<3 ? Get32(p+8,bBig)
+			: nMajor==3 ? Get64(p+63,bBig) : Get64(p+40,bBig);
+		uint32_t nBlock=nMajor<2 ? Get16(p+32,bBig)
+			: nMajor<4 ? Get32(p+51,bBig) : Get32(p+12,bBig);
+		uint32_t nTime=Get32(nMajor<4 ? p+39 : p+8,bBig);
+		if(!nBytes || nBytes>nAvail) return false;
+
+		pR->bFilesystem=true;
+		Append(pR,"Squashfs filesystem, %s endian,%s version %u.%u,",
+			bBig ? "big" : "little",g_Squashfs[nI].pszNote,nMajor,nMinor);
+		if(nMajor>3)
+		{
+			unsigned nComp=Get16(p+20,bBig);
+			Append(pR," compression:%s,",compressors[nComp<5 ? nComp : 0]);
+		}
+		Append(pR," size: %llu bytes, %u inodes, blocksize: %u bytes, "
+			"created: %s",(unsigned long long)nBytes,Get32(p+4,bBig),nBlock,
+			FormatDate(nTime,szDate,sizeof(szDate)));
+		*pnSkip=nBytes;
+		return true;
+	}
+	return false;
+}
+
+#define CRAMFS_SUPER_MIN	48
+
+bool IdentifyCramfs(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	if(nAvail<CRAMFS_SUPER_MIN) return false;
+
+	bool bBig=p[0]==0x28;
+	if(Get32(p,bBig)!=CRAMFS_MAGIC) return false;
+
+	uint32_t nBytes=Get32(p+4,bBig), nFlags=Get32(p+8,bBig);
+	int32_t nBlocks=Get32(p+40,bBig), nFiles=Get32(p+44,bBig);
+	if((int32_t)nBytes<=0 || nBytes>nAvail || nBlocks<0 || nFiles<0)
+		return false;
+
+	pR->bFilesystem=true;
+	Append(pR,"CramFS filesystem, %s endian size %u%s%s%s CRC 0x%x, "
+		"edition %u, %d blocks, %d files",bBig ? "big" : "little",nBytes,
+		nFlags&1 ? " version #2" : "",nFlags&2 ? " sorted_dirs" : "",
+		nFlags&4 ? " hole_support" : "",Get32(p+32,bBig),Get32(p+36,bBig),
+		nBlocks,nFiles);
+	*pnSkip=nBytes;
+	return true;
+}
+
+#define JFFS2_NODE_MIN	12
+
+bool IdentifyJffs2(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	static const uint16_t types[]={0xE001,0xE002,0x2003,0x2004,0x2006,
+		0xE008,0xE009};
+
+	if(nAvail<JFFS2_NODE_MIN) return false;
+
+	bool bBig=p[0]==0x19;
+	if(Get16(p,bBig)!=0x1985) return false;
+
+	uint16_t nType=Get16(p+2,bBig);
+	size_t nI;
+	for(nI=0;nI<sizeof(types)/sizeof(types[0]) && types[nI]!=nType;nI++);
+	if(nI==sizeof(types)/sizeof(types[0])) return false;
+
+	/* the next node, or erased flash, has to follow within 3 bytes */
+	uint32_t nLen=Get32(p+4,bBig);
+	bool bNext=false;
+	for(nI=0;nI<4 && !bNext;nI++)
+	{
+		if(nLen<JFFS2_NODE_MIN || nLen+nI+2>nAvail) break;
+		uint16_t nNext=Get16(p+nLen+nI,bBig);
+		bNext=nNext==0x1985 || nNext==0xFFFF;
+	}
+	if(!bNext) return false;
+
+	pR->bFilesystem=true;
+	pR->bOneOfMany=true;
+	Append(pR,"JFFS2 filesystem, %s endian",bBig ? "big" : "little");
+	*pnSkip=nLen;
+	return true;
+}
+
+#define YAFFS_MAGIC	"\x03\x00\x00\x00\x01\x00\x00\x00\xFF\xFF"
+#define YAFFS_MAGIC_LEN	10
+
+bool IdentifyYaffs(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	if(nAvail<YAFFS_MAGIC_LEN || memcmp(p,YAFFS_MAGIC,YAFFS_MAGIC_LEN))
+		return false;
+
+	/* every object header matches, so a run counts as one */
+	pR->bFilesystem=true;
+	pR->bOneOfMany=true;
+	Append(pR,"YAFFS filesystem");
+	*pnSkip=YAFFS_MAGIC_LEN;
+	return true;
+}
+
+/*************************************************************************
+* IdentifyFilesystem
+*
+* checks for a file system at p, as the kit's binwalk signatures did,
+* and hands back in *pnSkip how much of the image it takes up, so the
+* scan can jump over it
+*
+**************************************************************************/
+bool IdentifyFilesystem(const unsigned char *p, size_t nAvail,
+	SCAN_RESULT *pR, size_t *pnSkip)
+{
+	switch(p[0])
+	{
+		case 's':
+		case 'h':
+		case 'q':
+		case 't':
+			return IdentifySquashfs(p,nAvail,pR,pnSkip);
+		case 0x45:
+		case 0x28:
+			return IdentifyCramfs(p,nAvail,pR,pnSkip);
+		case 0x85:
+		case 0x19:
+			return IdentifyJffs2(p,nAvail,pR,pnSkip);
+		case 0x03:
+			return IdentifyYaffs(p,nAvail,pR,pnSkip);
+		default:
+			return false;
+	}
+}
+
+/************************************************************
+	compressed data
+************************************************************/
+
+#define LZMA_HEADER_LEN		13
+#define LZMA_PROPS_MAX		(9*5*5)
+#define LZMA_SIZE_MAX		0x40000000ULL	/* 1 GiB, as binwalk's table */
+
+/*************************************************************************
+* IdentifyLzma
+*
+* checks for an lzma_alone header at p, in place of the generated table
+* of binwalk's magic/lzma: lc+lp of at most 4, a power of two dictionary
+* from 64 KiB to 32 MiB, and an uncompressed size up to 1 GiB that isn't
+* the dictionary size.  The range coder's first byte is always 0, which
+* weeds out most of the rest.  The scan goes on inside the data.
+*
+**************************************************************************/
+bool IdentifyLzma(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	if(nAvail<LZMA_HEADER_LEN+1) return false;
+
+	unsigned nProps=p[0];
+	if(!nProps || nProps>=LZMA_PROPS_MAX || nProps%9+nProps/9%5>4) return false;
+
+	uint32_t nDict=Get32(p+1,false);
+	if(nDict<0x10000 || nDict>0x2000000 || (nDict&(nDict-1))) return false;
+
+	uint64_t nUncompressed=Get64(p+5,false);
+	if(!nUncompressed || nUncompressed>LZMA_SIZE_MAX || nUncompressed==nDict)
+		return false;
+
+	if(p[LZMA_HEADER_LEN]) return false;
+
+	pR->bData=true;
+	Append(pR,"LZMA compressed data, properties: 0x%02X, dictionary size: %u "
+		"bytes, uncompressed size: %llu bytes",nProps,nDict,
+		(unsigned long long)nUncompressed);
+	*pnSkip=1;
+	return true;
+}
+
+#define GZIP_HEADER_LEN		10
+#define GZIP_DATE_MIN		694224000	/* binwalk's 1992 */
+
+/* where the deflate data of a gzip member starts, or 0 past the end */
+static size_t GzipDataOffset(const unsigned char *p, size_t nAvail)
+{
+	unsigned nFlags=p[3];
+	size_t nPos=GZIP_HEADER_LEN;
+
+	if(nFlags&0x04) nPos+=2+(p[10] | p[11]<<8);
+	for(unsigned nField=0x08;nField<=0x10;nField<<=1)
+	{
+		if(!(nFlags&nField)) continue;
+		const void *pEnd=nPos<nAvail ? memchr(p+nPos,0,nAvail-nPos) : NULL;
+		if(!pEnd) return 0;
+		nPos=(const unsigned char *)pEnd-p+1;
+	}
+	if(nFlags&0x02) nPos+=2;
+	return nPos<nAvail ? nPos : 0;
+}
+
+/*************************************************************************
+* IdentifyGzip
+*
+* checks for a gzip member at p, as binwalk's magic/compressed did, but
+* passing only what gzip itself could read: no reserved flags, a known
+* source and a first deflate block of a valid type
+*
+**************************************************************************/
+bool IdentifyGzip(const unsigned char *p, size_t nAvail, SCAN_RESULT *pR,
+	size_t *pnSkip)
+{
+	static const char *sources[]={"FAT filesystem (MS-DOS, OS/2, NT)","Amiga",
+		"VMS","Unix","VM/CMS","Atari","HPFS filesystem (OS/2, NT)","MacOS",
+		"Z-System","CP/M","TOPS/20","NTFS filesystem (NT)","QDOS",
+		"Acorn RISCOS"};
+	char szDate[64];
+
+	if(nAvail<GZIP_HEADER_LEN+2 || p[0]!=0x1f || p[1]!=0x8b || p[2]!=8)
+		return false;
+
+	unsigned nFlags=p[3], nSource=p[9];
+	if(nFlags&0xe0 || (nSource>=sizeof(sources)/sizeof(sources[0]) && nSource!=0xff))
+		return false;
+
+	/* the first block after the optional fields can't be of type 3 */
+	size_t nPos=GzipDataOffset(p,nAvail);
+	if(!nPos || (p[nPos]>>1&3)==3) return false;
+
+	pR->bData=true;
+	Append(pR,"gzip compressed data");
+	if(nFlags&0x01) Append(pR,", ASCII");
+	if(nFlags&0x02) Append(pR,", has CRC");
+	if(nFlags&0x04) Append(pR,", extra field");
+	if((nFlags&0x0c)==0x08) Append(pR,", was \"%.64s\"",(const char *)p+GZIP_HEADER_LEN);
+	if(nFlags&0x10) Append(pR,", has comment");
+	if(nSource!=0xff) Append(pR,", from %s",sources[nSource]);
+
+	uint32_t nTime=Get32(p+4,false);
+	Append(pR,", %s %s",!nTime ? "NULL date:" : (int32_t)nTime<=GZIP_DATE_MIN
+		? "invalid date:" : "last modified:",FormatDate(nTime,szDate,sizeof(szDate)));
+	if(p[8]==2) Append(pR,", max compression");
+	if(p[8]==4) Append(pR,", max speed");
+	*pnSkip=1;
+	return true;
+}
+
+/************************************************************
+	scanning
+************************************************************/
+
+static void InitLeads()
+{
+	static const unsigned char leads[][2]={
+		{'H','D'},{0x27,0x05},{0x5e,0xa3},{0x01,0x00},	/* fwimage.h containers */
+		{'s','t'},{'a','s'},
+		{'s','q'},{'h','s'},{'q','s'},{'t','q'},{'s','h'},	/* file systems */
+		{0x45,0x3d},{0x28,0xcd},{0x85,0x19},{0x19,0x85},{0x03,0x00}
+	};
+	for(size_t nI=0;nI<sizeof(leads)/sizeof(leads[0]);nI++)
+	{
+		unsigned nLead=leads[nI][0]<<8|leads[nI][1];
+		g_nLeads[nLead>>5]|=1u<<(nLead&31);
+	}
+
+	/* gzip, then LZMA properties and a dictionary size that is a
+	   multiple of 64K */
+	g_nDataLeads[0x1f8b>>5]|=1u<<(0x1f8b&31);
+	for(unsigned nProps=1;nProps<LZMA_PROPS_MAX;nProps++)
+	{
+		if(nProps%9+nProps/9%5>4) continue;
+		unsigned nLead=nProps<<8;
+		g_nDataLeads[nLead>>5]|=1u<<(nLead&31);
+	}
+	for(size_t nI=0;nI<sizeof(g_nLeads)/sizeof(g_nLeads[0]);nI++)
+	{
+		g_nLeads[nI]|=g_nDataLeads[nI];
+	}
+}
+
+static inline bool IsLead(const uint32_t *pLeads, const unsigned char *p)
+{
+	unsigned nLead=p[0]<<8|p[1];
+	return pLeads[nLead>>5]>>(nLead&31)&1;
+}
+
+/* whether only compressed data is looked for at nPos: real flash puts
+   headers and file systems on word boundaries at least */
+static inline bool DataOnly(bool bAligned, size_t nPos)
+{
+	return bAligned && nPos%FMK_SCAN_ALIGN;
+}
+
+/* the container or file system at nPos, if any, and how far it reaches */
+static bool ScanAt(unsigned char *pData, size_t nSize, size_t nPos,
+	SCAN_RESULT *pR, size_t *pnSkip, bool bDataOnly)
+{
+	FwContainer c;
+
+	memset(pR,0,sizeof(*pR));
+	*pnSkip=1;
+	if(!bDataOnly && FwIdentify(pData,pData+nPos,nSize-nPos,&c) && DescribeContainer(&c,pR))
+	{
+		*pnSkip=c.header.nLength;
+		return true;
+	}
+	if((!bDataOnly && IdentifyFilesystem(pData+nPos,nSize-nPos,pR,pnSkip))
+		|| IdentifyLzma(pData+nPos,nSize-nPos,pR,pnSkip)
+		|| IdentifyGzip(pData+nPos,nSize-nPos,pR,pnSkip))
+	{
+		pR->nOffset=nPos;
+		return true;
+	}
+	return false;
+}
+
+/************************************************************
+	entropy
+************************************************************/
+
+static void InitEntropy()
+{
+	for(int nI=1;nI<=FMK_ENTROPY_BLOCK;nI++) g_dNLogN[nI]=nI*log2((double)nI);
+}
+
+/* the Shannon entropy of a block, counted into four histograms so that
+   runs of one byte don't wait on the same counter */
+static unsigned char BlockEntropy(const unsigned char *p, size_t nLength)
+{
+	uint32_t counts[4][256];
+	size_t nI;
+
+	memset(counts,0,sizeof(counts));
+	for(nI=0;nI+4<=nLength;nI+=4)
+	{
+		counts[0][p[nI]]++;
+		counts[1][p[nI+1]]++;
+		counts[2][p[nI+2]]++;
+		counts[3][p[nI+3]]++;
+	}
+	for(;nI<nLength;nI++) counts[0][p[nI]]++;
+
+	double dSum=0;
+	for(int nB=0;nB<256;nB++)
+	{
+		dSum+=g_dNLogN[counts[0][nB]+counts[1][nB]+counts[2][nB]+counts[3][nB]];
+	}
+	double dBits=log2((double)nLength)-dSum/nLength;
+	int nScaled=(int)(dBits*FMK_ENTROPY_SCALE+0.5);
+	return nScaled>255 ? 255 : nScaled<0 ? 0 : nScaled;
+}
+
+/* the offset where the high entropy run from the block after nOffset ends */
+static size_t HighEntropyEnd(const unsigned char *pEntropy, size_t nSize,
+	size_t nOffset)
+{
+	size_t nBlock=nOffset/FMK_ENTROPY_BLOCK+1, nBlocks=FMK_ENTROPY_BLOCKS(nSize);
+
+	while(nBlock<nBlocks && pEntropy[nBlock]>=FMK_ENTROPY_HIGH) nBlock++;
+	return nBlock*FMK_ENTROPY_BLOCK;
+}
+
+/*************************************************************************
+* ScanChunk
+*
+* a worker, mapping the entropy of the blocks in [nStart,nEnd) and
+* collecting the offsets there where something is found.  It may read
+* past nEnd, as the whole image is mapped, so the chunks need not
+* overlap.
+*
+**************************************************************************/
+static void *ScanChunk(void *pArg)
+{
+	SCAN_CHUNK *pChunk=(SCAN_CHUNK *)pArg;
+	const unsigned char *pData=pChunk->pData;
+	size_t nSize=pChunk->nSize, nPos=pChunk->nStart, nSkip;
+	SCAN_RESULT r;
+
+	for(size_t nBlock=nPos;nBlock<pChunk->nEnd;nBlock+=FMK_ENTROPY_BLOCK)
+	{
+		size_t nLength=nSize-nBlock<FMK_ENTROPY_BLOCK ? nSize-nBlock : FMK_ENTROPY_BLOCK;
+		pChunk->pEntropy[nBlock/FMK_ENTROPY_BLOCK]=BlockEntropy(pData+nBlock,nLength);
+	}
+
+	/* no signature is shorter than two bytes, or starts with 0x00 or
+	   0xFF, so erased flash and zero fill go eight bytes at a time */
+	while(nPos<pChunk->nEnd && nPos+1<nSize)
+	{
+		uint64_t nWord;
+
+		if((pData[nPos]==0 || pData[nPos]==0xff) && nPos+8<=nSize)
+		{
+			memcpy(&nWord,pData+nPos,8);
+			if(nWord==0 || nWord==~(uint64_t)0)
+			{
+				nPos+=8;
+				continue;
+			}
+		}
+		bool bDataOnly=DataOnly(pChunk->bAligned,nPos);
+		if(!IsLead(bDataOnly ? g_nDataLeads : g_nLeads,pData+nPos)
+			|| !ScanAt(pChunk->pData,nSize,nPos,&r,&nSkip,bDataOnly))
+		{
+			nPos++;
+			continue;
+		}
+
+		if(pChunk->nHits==pChunk->nAlloc)
+		{
+			pChunk->nAlloc=pChunk->nAlloc ? pChunk->nAlloc*2 : 64;
+			size_t *pNew=(size_t *)realloc(pChunk->pHits,
+				pChunk->nAlloc*sizeof(size_t));
+			if(!pNew)
+			{
+				pChunk->bFailed=true;
+				break;
+			}
+			pChunk->pHits=pNew;
+		}
+		pChunk->pHits[pChunk->nHits++]=nPos++;
+	}
+	return NULL;
+}
+
+static void InitTables()
+{
+	InitLeads();
+	InitEntropy();
+}
+
+/*************************************************************************
+* ScanImage
+*
+* lists the containers and file systems of an image in offset order,
+* and maps its entropy into pEntropy, a byte per FMK_ENTROPY_BLOCK.
+* The scan goes on inside a container's payload, but jumps over a file
+* system, as binwalk's jump-to-offset did.  LZMA data has no length to
+* jump, so the run of high entropy blocks after its header is taken to
+* be the stream, and other LZMA matches there are dropped.  Large
+* images are split into chunks scanned by a thread each; the jumps are
+* then taken over their hits in order, so the results are those of a
+* scan from the start.  Returns the number of results, which the caller
+* frees.
+*
+**************************************************************************/
+size_t ScanImage(const FwImage &image, SCAN_RESULT **ppResults,
+	unsigned char *pEntropy, bool bAligned)
+{
+	unsigned char *pData=image.Data();
+	size_t nSize=image.Size(), nPos=0, nResults=0, nAlloc=0, nSkip, nClaim=0;
+	SCAN_RESULT *pResults=NULL, r;
+	SCAN_CHUNK chunks[FMK_SCAN_THREADS];
+	pthread_t threads[FMK_SCAN_THREADS];
+	bool bRun=false;
+
+	long nCpus=sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nChunks=nSize/FMK_SCAN_CHUNK_MIN;
+	if(nCpus>0 && nChunks>(size_t)nCpus) nChunks=nCpus;
+	if(nChunks>FMK_SCAN_THREADS) nChunks=FMK_SCAN_THREADS;
+	if(nChunks<1) nChunks=1;
+
+	/* once, as -x scans images from several threads */
+	static pthread_once_t once=PTHREAD_ONCE_INIT;
+	pthread_once(&once,InitTables);
+
+	/* chunks start on a block, so each block is mapped by one of them */
+	memset(chunks,0,sizeof(chunks));
+	for(size_t nC=0;nC<nChunks;nC++)
+	{
+		chunks[nC].pData=pData;
+		chunks[nC].nSize=nSize;
+		chunks[nC].pEntropy=pEntropy;
+		chunks[nC].bAligned=bAligned;
+		chunks[nC].nStart=nSize/nChunks*nC/FMK_ENTROPY_BLOCK*FMK_ENTROPY_BLOCK;
+		chunks[nC].nEnd=nC+1<nChunks
+			? nSize/nChunks*(nC+1)/FMK_ENTROPY_BLOCK*FMK_ENTROPY_BLOCK : nSize;
+		if(nC && pthread_create(&threads[nC],NULL,ScanChunk,&chunks[nC]))
+		{
+			ScanChunk(&chunks[nC]);
+			chunks[nC].bJoined=true;
+		}
+	}
+	ScanChunk(&chunks[0]);
+	for(size_t nC=1;nC<nChunks;nC++)
+	{
+		if(!chunks[nC].bJoined) pthread_join(threads[nC],NULL);
+	}
+
+	for(size_t nC=0;nC<nChunks;nC++)
+	{
+		if(chunks[nC].bFailed)
+		{
+			fprintf(stderr, " ERROR out of memory\n");
+			nChunks=nC;
+			break;
+		}
+	}
+
+	for(size_t nC=0;nC<nChunks;nC++)
+	{
+		for(size_t nH=0;nH<chunks[nC].nHits;nH++)
+		{
+			size_t nHit=chunks[nC].pHits[nH];
+			if(nHit<nPos) continue;
+			ScanAt(pData,nSize,nHit,&r,&nSkip,DataOnly(bAligned,nHit));
+
+			/* LZMA inside the stream of the one before is its data */
+			if(r.bData)
+			{
+				if(nHit<nClaim) continue;
+				nClaim=HighEntropyEnd(pEntropy,nSize,nHit);
+			}
+			else
+			{
+				nClaim=0;
+			}
+
+			/* a run of nodes or objects of one file system is logged once */
+			bool bSkip=bRun && r.bOneOfMany && nResults
+				&& !strcmp(pResults[nResults-1].szDescription,r.szDescription);
+			bRun=r.bOneOfMany;
+			nPos=nHit+(nSkip ? nSkip : 1);
+			if(bSkip) continue;
+
+			if(nResults==nAlloc)
+			{
+				nAlloc=nAlloc ? nAlloc*2 : 16;
+				SCAN_RESULT *pNew=(SCAN_RESULT *)
+					realloc(pResults,nAlloc*sizeof(SCAN_RESULT));
+				if(!pNew)
+				{
+					fprintf(stderr, " ERROR out of memory\n");
+					nC=nChunks;
+					break;
+				}
+				pResults=pNew;
+			}
+			pResults[nResults++]=r;
+		}
+	}
+
+	for(size_t nC=0;nC<FMK_SCAN_THREADS;nC++) free(chunks[nC].pHits);
+	*ppResults=pResults;
+	return nResults;
+}
+
+/*************************************************************************
+* FooterSize
+*
+* sizes the footer the way the script read it off hexdump -C: the lines
+* after the last run of repeated lines (a '*'), up to 10 of them, so
+* filler or padding ending the image means no footer.  Only the last 11
+* lines are read, with pread, so that neither a mapping nor a hexdump of
+* the rest of the image is needed.  The image is the nSize bytes at
+* nBase in fd.
+*
+**************************************************************************/
+bool FooterSize(int fd, off_t nBase, size_t nSize, size_t *pnFooterSize)
+{
+	unsigned char tail[(FMK_FOOTER_LINES+1)*FMK_LINE_LEN];
+	size_t nLine=(nSize+FMK_LINE_LEN-1)/FMK_LINE_LEN, nCounted=0;
+	size_t nFirst=nLine>FMK_FOOTER_LINES+1 ? nLine-FMK_FOOTER_LINES-1 : 0;
+	size_t nTail=nSize-nFirst*FMK_LINE_LEN;
+
+	if(pread(fd,tail,nTail,nBase+nFirst*FMK_LINE_LEN)!=(ssize_t)nTail)
+	{
+		return false;
+	}
+
+	while(nLine>nFirst && nCounted<FMK_FOOTER_LINES)
+	{
+		size_t nI=nLine-1;
+		const unsigned char *p=tail+(nI-nFirst)*FMK_LINE_LEN;
+
+		/* hexdump only folds whole lines, and never the first */
+		if(nI>nFirst && (nI+1)*FMK_LINE_LEN<=nSize
+			&& !memcmp(p,p-FMK_LINE_LEN,FMK_LINE_LEN))
+			break;
+		nCounted++;
+		nLine--;
+	}
+	*pnFooterSize=nCounted ? nSize-nLine*FMK_LINE_LEN : 0;
+	return true;
+}
+
+/************************************************************
+	streaming
+************************************************************/
+
+/* whether what fails at p now is a container or file system that may
+   still fit once more of the stream is in: the magic of each one that
+   carries its length */
+static bool StreamPending(const unsigned char *p)
+{
+	static const unsigned char magics[][4]={
+		{'H','D','R','0'},{0x27,0x05,0x19,0x56},{0x5e,0xa3,0xa4,0x17},
+		{'s','t','a','r'},{'a','s','a','r'},
+		{0x45,0x3d,0xcd,0x28},{0x28,0xcd,0x3d,0x45}
+	};
+
+	for(size_t nI=0;nI<sizeof(magics)/sizeof(magics[0]);nI++)
+	{
+		if(!memcmp(p,magics[nI],4)) return true;
+	}
+	for(size_t nI=0;nI<sizeof(g_Squashfs)/sizeof(g_Squashfs[0]);nI++)
+	{
+		if(!memcmp(p,g_Squashfs[nI].szMagic,4)) return true;
+	}
+	return FwGet32BE(p)==FW_TPLINK_VERSION && p[4]>=' ' && p[4]<='~';
+}
+
+/* the entropy of each block now complete, and at the end the last part */
+static bool StreamMapBlocks(SCAN_STREAM *pS, bool bEnd)
+{
+	size_t nEnd=pS->nBase+pS->nFill;
+
+	while(pS->nBlocks*FMK_ENTROPY_BLOCK<nEnd
+		&& (bEnd || (pS->nBlocks+1)*FMK_ENTROPY_BLOCK<=nEnd))
+	{
+		if(pS->nBlocks==pS->nEntropyAlloc)
+		{
+			size_t nAlloc=pS->nEntropyAlloc ? pS->nEntropyAlloc*2 : 4096;
+			unsigned char *pNew=(unsigned char *)realloc(pS->pEntropy,nAlloc);
+			if(!pNew) return false;
+			pS->pEntropy=pNew;
+			pS->nEntropyAlloc=nAlloc;
+		}
+		size_t nBlock=pS->nBlocks*FMK_ENTROPY_BLOCK;
+		size_t nLength=nEnd-nBlock<FMK_ENTROPY_BLOCK ? nEnd-nBlock : FMK_ENTROPY_BLOCK;
+		pS->pEntropy[pS->nBlocks++]=BlockEntropy(pS->pWindow+nBlock-pS->nBase,nLength);
+	}
+	return true;
+}
+
+/*************************************************************************
+* StreamScan
+*
+* scans the window as far as it can be settled, taking the jumps, LZMA
+* claims and runs as ScanImage's merge does.  A container or file system
+* is only reported once all of it is in; anything else needs
+* FMK_STREAM_LOOKAHEAD bytes after it, or the end.
+*
+**************************************************************************/
+static void StreamScan(SCAN_STREAM *pS, bool bEnd)
+{
+	size_t nEnd=pS->nBase+pS->nFill, nSkip;
+	SCAN_RESULT r;
+
+	while(pS->nPos+1<nEnd)
+	{
+		size_t nPos=pS->nPos, nAvail=nEnd-nPos;
+		unsigned char *p=pS->pWindow+nPos-pS->nBase;
+		uint64_t nWord;
+
+		if((p[0]==0 || p[0]==0xff) && nAvail>=8)
+		{
+			memcpy(&nWord,p,8);
+			if(nWord==0 || nWord==~(uint64_t)0)
+			{
+				pS->nPos+=8;
+				continue;
+			}
+		}
+		if(!IsLead(g_nLeads,p))
+		{
+			pS->nPos++;
+			continue;
+		}
+		if(!ScanAt(pS->pWindow,pS->nFill,nPos-pS->nBase,&r,&nSkip,false))
+		{
+			if(!bEnd && nAvail<FMK_STREAM_WINDOW
+				&& (nAvail<FMK_STREAM_LOOKAHEAD || StreamPending(p)))
+				return;
+			pS->nPos++;
+			continue;
+		}
+		r.nOffset=nPos;
+
+		/* LZMA inside the claim of the one before is its data, which
+		   the blocks up to this one tell */
+		if(r.bData)
+		{
+			size_t nBlock=nPos/FMK_ENTROPY_BLOCK;
+			if(pS->bClaim)
+			{
+				if(nBlock>=pS->nBlocks) return;
+				while(pS->nClaimNext<=nBlock
+					&& pS->pEntropy[pS->nClaimNext]>=FMK_ENTROPY_HIGH)
+					pS->nClaimNext++;
+				if(pS->nClaimNext>nBlock)
+				{
+					pS->nPos++;
+					continue;
+				}
+			}
+			pS->bClaim=true;
+			pS->nClaimNext=nBlock+1;
+		}
+		else
+		{
+			pS->bClaim=false;
+		}
+
+		bool bSkip=pS->bRun && r.bOneOfMany && pS->bLast
+			&& !strcmp(pS->last.szDescription,r.szDescription);
+		pS->bRun=r.bOneOfMany;
+		pS->nPos=nPos+(nSkip ? nSkip : 1);
+		if(bSkip) continue;
+		pS->last=r;
+		pS->bLast=true;
+		pS->pfnResult(&r,pS->pContext);
+	}
+}
+
+void StreamInit(SCAN_STREAM *pS, SCAN_CALLBACK pfnResult, void *pContext)
+{
+	static pthread_once_t once=PTHREAD_ONCE_INIT;
+	pthread_once(&once,InitTables);
+
+	memset(pS,0,sizeof(*pS));
+	pS->pfnResult=pfnResult;
+	pS->pContext=pContext;
+}
+
+/*************************************************************************
+* StreamPush
+*
+* adds the next nLength bytes of the stream, reporting what they settle.
+* What is behind the scan and mapped is dropped when room is needed, and
+* the window only grows for a container or file system that isn't all
+* in yet, to at most FMK_STREAM_WINDOW; one bigger than that is missed.
+*
+**************************************************************************/
+bool StreamPush(SCAN_STREAM *pS, const void *pData, size_t nLength)
+{
+	const unsigned char *p=(const unsigned char *)pData;
+
+	while(nLength && !pS->bFailed)
+	{
+		size_t nKeep=pS->nBlocks*FMK_ENTROPY_BLOCK;
+		if(pS->nPos<nKeep) nKeep=pS->nPos;
+		if(pS->nFill+nLength>pS->nAlloc && nKeep>pS->nBase)
+		{
+			memmove(pS->pWindow,pS->pWindow+(nKeep-pS->nBase),pS->nFill-(nKeep-pS->nBase));
+			pS->nFill-=nKeep-pS->nBase;
+			pS->nBase=nKeep;
+		}
+		if(pS->nFill==pS->nAlloc && pS->nAlloc<FMK_STREAM_WINDOW)
+		{
+			size_t nAlloc=pS->nAlloc ? pS->nAlloc*2 : 4*FMK_STREAM_LOOKAHEAD;
+			if(nAlloc>FMK_STREAM_WINDOW) nAlloc=FMK_STREAM_WINDOW;
+			unsigned char *pNew=(unsigned char *)realloc(pS->pWindow,nAlloc);
+			if(!pNew)
+			{
+				pS->bFailed=true;
+				break;
+			}
+			pS->pWindow=pNew;
+			pS->nAlloc=nAlloc;
+		}
+
+		size_t nCopy=pS->nAlloc-pS->nFill;
+		if(nCopy>nLength) nCopy=nLength;
+		memcpy(pS->pWindow+pS->nFill,p,nCopy);
+		pS->nFill+=nCopy;
+		p+=nCopy;
+		nLength-=nCopy;
+
+		if(!StreamMapBlocks(pS,false))
+			pS->bFailed=true;
+		else
+			StreamScan(pS,false);
+	}
+	return !pS->bFailed;
+}
+
+/* settles the rest at the end of the stream, and frees it */
+bool StreamFinish(SCAN_STREAM *pS)
+{
+	if(!pS->bFailed && !StreamMapBlocks(pS,true)) pS->bFailed=true;
+	if(!pS->bFailed && pS->pWindow) StreamScan(pS,true);
+	free(pS->pWindow);
+	free(pS->pEntropy);
+	pS->pWindow=NULL;
+	pS->pEntropy=NULL;
+	return !pS->bFailed;
+}
+
+/************************************************************
+	output
+************************************************************/
+
+static void MakePath(char *pszPath, const char *pszDir, const char *pszName)
+{
+	snprintf(pszPath,FMK_PATH_LEN,"%s/%s",pszDir,pszName);
+}
+
+static bool MakeDir(const char *pszDir)
+{
+	if(mkdir(pszDir,0755)<0 && errno!=EEXIST)
+	{
+		fprintf(stderr, " ERROR creating %s: %s\n", pszDir, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+static void PrintScanHead(FILE *f)
+{
+	fprintf(f,"\nDECIMAL   \tHEX       \tDESCRIPTION\n"
+		"-------------------------------------------------------------"
+		"------------------------------------------\n");
+}
+
+static void PrintScanLine(FILE *f, const SCAN_RESULT *pR)
+{
+	fprintf(f,"%-10lu\t0x%-8lX\t%s\n",(unsigned long)pR->nOffset,
+		(unsigned long)pR->nOffset,pR->szDescription);
+}
+
+/* the results as binwalk printed them */
+static void PrintScan(FILE *f, const SCAN_RESULT *pResults, size_t nResults)
+{
+	PrintScanHead(f);
+	for(size_t nI=0;nI<nResults;nI++)
+	{
+		PrintScanLine(f,&pResults[nI]);
+	}
+	fprintf(f,"\n");
+}
+
+/* the entropy of each block, 0 to 1 as binwalk's entropy scan had it */
+static void PrintEntropy(FILE *f, const unsigned char *pEntropy, size_t nSize)
+{
+	fprintf(f,"\nDECIMAL   \tHEX       \tENTROPY\n"
+		"-------------------------------------------------------------"
+		"------------------------------------------\n");
+	for(size_t nI=0;nI<FMK_ENTROPY_BLOCKS(nSize);nI++)
+	{
+		fprintf(f,"%-10lu\t0x%-8lX\t%.4f\n",
+			(unsigned long)(nI*FMK_ENTROPY_BLOCK),
+			(unsigned long)(nI*FMK_ENTROPY_BLOCK),
+			pEntropy[nI]/(8.0*FMK_ENTROPY_SCALE));
+	}
+	fprintf(f,"\n");
+}
+
+/* to the log and to stdout */
+static bool WriteScanLog(const char *pszLog, const SCAN_RESULT *pResults,
+	size_t nResults)
+{
+	FILE *fLog=fopen(pszLog,"w");
+	if(!fLog) return false;
+
+	PrintScan(fLog,pResults,nResults);
+	PrintScan(stdout,pResults,nResults);
+	return fclose(fLog)==0;
+}
+
+/* the first word of a description, lower case, as the script's awk took it */
+static void TypeName(const SCAN_RESULT *pR, char *pszType, size_t nType)
+{
+	size_t nI;
+	for(nI=0;nI+1<nType && pR->szDescription[nI]
+		&& pR->szDescription[nI]!=' ' && pR->szDescription[nI]!=',';nI++)
+	{
+		char ch=pR->szDescription[nI];
+		pszType[nI]=ch>='A' && ch<='Z' ? ch-'A'+'a' : ch;
+	}
+	pszType[nI]=0;
+}
+
+/* the number after label in a description, or "" */
+static void Field(const SCAN_RESULT *pR, const char *pszLabel, char *pszValue,
+	size_t nValue)
+{
+	const char *p=pR ? strstr(pR->szDescription,pszLabel) : NULL;
+	size_t nI=0;
+	if(p)
+	{
+		for(p+=strlen(pszLabel);nI+1<nValue && *p>='0' && *p<='9';p++)
+			pszValue[nI++]=*p;
+	}
+	pszValue[nI]=0;
+}
+
+/************************************************************
+	scan cache
+************************************************************/
+
+#define FMK_KEY_SEGMENTS	16
+#define FMK_KEY_LEN		(2*(24+9*FMK_KEY_SEGMENTS))
+#define FMK_CACHE_MAGIC		"FMK-SCAN 2"
+
+/* the size of the data and the CRC of each sixteenth, at memory speed */
+static void KeyData(const unsigned char *pData, size_t nSize, char *pszKey)
+{
+	size_t nSegment=nSize/FMK_KEY_SEGMENTS;
+	int nLength=sprintf(pszKey,"%lu",(unsigned long)nSize);
+
+	for(int nI=0;nI<FMK_KEY_SEGMENTS;nI++)
+	{
+		size_t nLast=nI+1<FMK_KEY_SEGMENTS ? nSegment : nSize-nSegment*nI;
+		nLength+=sprintf(pszKey+nLength,":%08x",
+			(unsigned)crc32buf(pData+nSegment*nI,nLast));
+	}
+}
+
+/*************************************************************************
+* CacheKey
+*
+* the key of the scan of an image, over its data and this program, whose
+* signatures are compiled in and decide the scan, and in *pszPath the
+* file that scan is kept in, named for the MD5 of the key
+*
+**************************************************************************/
+static bool CacheKey(const FwImage &image, const char *pszCache, char *pszKey,
+	char *pszPath)
+{
+	md5_byte_t digest[16];
+	md5_state_t state;
+	char szName[33];
+	FwImage self;
+
+	if(!self.Open("/proc/self/exe")) return false;
+	KeyData(self.Data(),self.Size(),pszKey);
+	strcat(pszKey," ");
+	KeyData(image.Data(),image.Size(),pszKey+strlen(pszKey));
+
+	md5_init(&state);
+	md5_append(&state,(const md5_byte_t *)pszKey,strlen(pszKey));
+	md5_finish(&state,digest);
+	for(int nI=0;nI<16;nI++) sprintf(szName+2*nI,"%02x",digest[nI]);
+	MakePath(pszPath,pszCache,szName);
+	return true;
+}
+
+/* the results, one to a line, then the entropy map as it is in memory */
+static bool LoadScan(const char *pszPath, const char *pszKey,
+	SCAN_RESULT **ppResults, size_t *pnResults, unsigned char *pEntropy,
+	size_t nBlocks)
+{
+	char szLine[FMK_DESCRIPTION_LEN+FMK_KEY_LEN+128];
+	unsigned long nResults=0, nRead=0;
+	SCAN_RESULT *pResults=NULL;
+
+	FILE *f=fopen(pszPath,"r");
+	if(!f) return false;
+	if(!fgets(szLine,sizeof(szLine),f)
+		|| strncmp(szLine,FMK_CACHE_MAGIC " ",sizeof(FMK_CACHE_MAGIC))
+		|| strcmp(szLine+sizeof(FMK_CACHE_MAGIC),pszKey)
+		|| !fgets(szLine,sizeof(szLine),f)
+		|| sscanf(szLine,"%lu",&nResults)!=1
+		|| !(pResults=(SCAN_RESULT *)calloc(nResults+1,sizeof(SCAN_RESULT))))
+	{
+		fclose(f);
+		return false;
+	}
+	while(nRead<nResults && fgets(szLine,sizeof(szLine),f))
+	{
+		SCAN_RESULT *pR=&pResults[nRead];
+		unsigned long nOffset, nHeaderSize;
+		int bHeader, bFs, bMany, bData, nDescription=0;
+
+		if(sscanf(szLine,"%lu %d %d %d %d %lu %n",&nOffset,&bHeader,&bFs,&bMany,
+			&bData,&nHeaderSize,&nDescription)!=6 || !nDescription)
+			break;
+		szLine[strcspn(szLine,"\n")]='\0';
+		pR->nOffset=nOffset;
+		pR->bHeader=bHeader;
+		pR->bFilesystem=bFs;
+		pR->bOneOfMany=bMany;
+		pR->bData=bData;
+		pR->nHeaderSize=nHeaderSize;
+		snprintf(pR->szDescription,sizeof(pR->szDescription),"%s",
+			szLine+nDescription);
+		nRead++;
+	}
+	unsigned long nMapped=0;
+	bool bMap=nRead==nResults && fgets(szLine,sizeof(szLine),f)
+		&& sscanf(szLine,"%lu",&nMapped)==1 && nMapped==nBlocks
+		&& fread(pEntropy,1,nBlocks,f)==nBlocks;
+	fclose(f);
+
+	if(!bMap)
+	{
+		free(pResults);
+		return false;
+	}
+	*ppResults=pResults;
+	*pnResults=nResults;
+	return true;
+}
+
+/* written aside and renamed, so that concurrent jobs only ever see it whole */
+static void SaveScan(char *pszCache, const char *pszPath, const char *pszKey,
+	const SCAN_RESULT *pResults, size_t nResults, const unsigned char *pEntropy,
+	size_t nBlocks)
+{
+	char szTemp[FMK_PATH_LEN+32];
+
+	/* the cache and the directories above it */
+	for(char *psz=strchr(pszCache+1,'/');;psz=strchr(psz+1,'/'))
+	{
+		if(psz) *psz='\0';
+		mkdir(pszCache,0755);
+		if(!psz) break;
+		*psz='/';
+	}
+
+	snprintf(szTemp,sizeof(szTemp),"%s.%d.%lx",pszPath,(int)getpid(),
+		(unsigned long)pthread_self());
+	FILE *f=fopen(szTemp,"w");
+	if(!f) return;
+	fprintf(f,FMK_CACHE_MAGIC " %s%lu\n",pszKey,(unsigned long)nResults);
+	for(size_t nI=0;nI<nResults;nI++)
+	{
+		const SCAN_RESULT *pR=&pResults[nI];
+		fprintf(f,"%lu %d %d %d %d %lu %s\n",(unsigned long)pR->nOffset,pR->bHeader,
+			pR->bFilesystem,pR->bOneOfMany,pR->bData,(unsigned long)pR->nHeaderSize,
+			pR->szDescription);
+	}
+	fprintf(f,"%lu\n",(unsigned long)nBlocks);
+	fwrite(pEntropy,1,nBlocks,f);
+	bool bOk=!ferror(f);
+	if(fclose(f) || !bOk || rename(szTemp,pszPath)) unlink(szTemp);
+}
+
+/* MTD partition dumps, named for the /dev/mtdN or mtdblockN they were
+   read from and a whole number of erase blocks, scan aligned unless
+   $FMK_SCAN_ALIGN is 0; it being 1 aligns any image */
+static bool ScanAligned(const char *pszImage, size_t nSize)
+{
+	const char *pszAlign=getenv("FMK_SCAN_ALIGN");
+	if(pszAlign && *pszAlign) return strcmp(pszAlign,"0")!=0;
+
+	const char *pszName=strrchr(pszImage,'/');
+	pszName=pszName ? pszName+1 : pszImage;
+	return !strncmp(pszName,"mtd",3) && nSize && !(nSize%FMK_ERASE_BLOCK);
+}
+
+/*************************************************************************
+* CachedScan
+*
+* ScanImage, through the cache in $FMK_SCAN_CACHE when that is set, so
+* an image seen before isn't scanned again.  What a hit lists is checked
+* against the image, which only costs a look at each offset.
+*
+**************************************************************************/
+size_t CachedScan(const FwImage &image, SCAN_RESULT **ppResults,
+	unsigned char *pEntropy, bool bAligned)
+{
+	char szPath[FMK_PATH_LEN], szCache[FMK_PATH_LEN], szKey[FMK_KEY_LEN+4];
+	const char *pszCache=getenv("FMK_SCAN_CACHE");
+	size_t nResults, nSkip, nI, nBlocks=FMK_ENTROPY_BLOCKS(image.Size());
+	SCAN_RESULT r;
+
+	if(!pszCache || !*pszCache || !image.Size())
+		return ScanImage(image,ppResults,pEntropy,bAligned);
+	snprintf(szCache,sizeof(szCache),"%s",pszCache);
+	if(!CacheKey(image,szCache,szKey,szPath))
+		return ScanImage(image,ppResults,pEntropy,bAligned);
+	strcat(szKey,bAligned ? " a\n" : "\n");
+
+	if(LoadScan(szPath,szKey,ppResults,&nResults,pEntropy,nBlocks))
+	{
+		for(nI=0;nI<nResults;nI++)
+		{
+			const SCAN_RESULT *pR=&(*ppResults)[nI];
+			if(pR->nOffset>=image.Size()
+				|| !ScanAt(image.Data(),image.Size(),pR->nOffset,&r,&nSkip,
+					DataOnly(bAligned,pR->nOffset))
+				|| strcmp(r.szDescription,pR->szDescription))
+				break;
+		}
+		if(nI==nResults) return nResults;
+		free(*ppResults);
+	}
+	nResults=ScanImage(image,ppResults,pEntropy,bAligned);
+	SaveScan(szCache,szPath,szKey,*ppResults,nResults,pEntropy,nBlocks);
+	return nResults;
+}
+
+/************************************************************
+	extraction
+************************************************************/
+
+#define FMK_EXTRACT_DEPTH	8	/* decoded data inside decoded data */
+#define FMK_DECODE_LEN		(1024*1024)
+
+/* scans szImage into szDir or, for bDecode, decodes the data at nOffset
+   of szImage into szDir, named for the offset */
+typedef struct _EXTRACT_JOB
+{
+	char szImage[FMK_PATH_LEN];
+	char szDir[FMK_PATH_LEN];
+	size_t nOffset;
+	int nDepth;
+	bool bDecode;
+	bool bLzma;
+} EXTRACT_JOB;
+
+/* the jobs of -x, which workers take and add to until none are left */
+static struct
+{
+	EXTRACT_JOB *pJobs;
+	size_t nJobs, nAlloc;
+	int nBusy;
+	int nFailed;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} g_Extract={NULL,0,0,0,0,PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER};
+
+static void QueueJob(const EXTRACT_JOB *pJob)
+{
+	pthread_mutex_lock(&g_Extract.lock);
+	if(g_Extract.nJobs==g_Extract.nAlloc)
+	{
+		size_t nAlloc=g_Extract.nAlloc ? g_Extract.nAlloc*2 : 16;
+		EXTRACT_JOB *pNew=(EXTRACT_JOB *)realloc(g_Extract.pJobs,
+			nAlloc*sizeof(EXTRACT_JOB));
+		if(!pNew)
+		{
+			fprintf(stderr, " ERROR out of memory\n");
+			g_Extract.nFailed++;
+			pthread_mutex_unlock(&g_Extract.lock);
+			return;
+		}
+		g_Extract.pJobs=pNew;
+		g_Extract.nAlloc=nAlloc;
+	}
+	g_Extract.pJobs[g_Extract.nJobs++]=*pJob;
+	pthread_cond_signal(&g_Extract.cond);
+	pthread_mutex_unlock(&g_Extract.lock);
+}
+
+static void ExtractFailed()
+{
+	pthread_mutex_lock(&g_Extract.lock);
+	g_Extract.nFailed++;
+	pthread_mutex_unlock(&g_Extract.lock);
+}
+
+static bool WriteAll(int fd, const unsigned char *p, size_t nLength)
+{
+	while(nLength)
+	{
+		ssize_t nDone=write(fd,p,nLength);
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0) return false;
+		p+=nDone;
+		nLength-=nDone;
+	}
+	return true;
+}
+
+/* an lzma_alone stream, which ends itself after its uncompressed size */
+static bool DecodeLzma(const unsigned char *p, size_t nAvail, int fdOut,
+	unsigned char *pOut)
+{
+	lzma_stream strm=LZMA_STREAM_INIT;
+	lzma_ret ret;
+
+	if(lzma_alone_decoder(&strm,UINT64_MAX)!=LZMA_OK) return false;
+	strm.next_in=p;
+	strm.avail_in=nAvail;
+	do
+	{
+		strm.next_out=pOut;
+		strm.avail_out=FMK_DECODE_LEN;
+		ret=lzma_code(&strm,LZMA_FINISH);
+		if((ret==LZMA_OK || ret==LZMA_STREAM_END)
+			&& !WriteAll(fdOut,pOut,FMK_DECODE_LEN-strm.avail_out))
+			ret=LZMA_PROG_ERROR;
+	} while(ret==LZMA_OK);
+	lzma_end(&strm);
+	return ret==LZMA_STREAM_END;
+}
+
+/* one gzip member, up to the size LZMA data may have.  The deflate data
+   is inflated raw and the trailer checked with crc32buf.h, as crcalc's
+   crc32() takes the place of zlib's in this program. */
+static bool DecodeGzip(const unsigned char *p, size_t nAvail, int fdOut,
+	unsigned char *pOut)
+{
+	const unsigned char *pEnd=p+nAvail;
+	uint32_t nCrc=0xffffffff;
+	z_stream strm;
+	int ret=Z_OK;
+
+	size_t nPos=GzipDataOffset(p,nAvail);
+	if(!nPos) return false;
+	memset(&strm,0,sizeof(strm));
+	if(inflateInit2(&strm,-15)!=Z_OK) return false;
+	strm.next_in=(Bytef *)p+nPos;
+	while(ret==Z_OK && strm.total_out<=LZMA_SIZE_MAX)
+	{
+		if(!strm.avail_in)
+		{
+			size_t nIn=pEnd-strm.next_in>FMK_DECODE_LEN ? FMK_DECODE_LEN
+				: pEnd-strm.next_in;
+			if(!nIn) break;
+			strm.avail_in=nIn;
+		}
+		strm.next_out=pOut;
+		strm.avail_out=FMK_DECODE_LEN;
+		ret=inflate(&strm,Z_NO_FLUSH);
+		nCrc=crc32_update(nCrc,pOut,FMK_DECODE_LEN-strm.avail_out);
+		if((ret==Z_OK || ret==Z_STREAM_END)
+			&& !WriteAll(fdOut,pOut,FMK_DECODE_LEN-strm.avail_out))
+			ret=Z_ERRNO;
+	}
+	const unsigned char *pTrailer=strm.next_in;
+	inflateEnd(&strm);
+	return ret==Z_STREAM_END && pEnd-pTrailer>=8 && Get32(pTrailer,false)==~nCrc
+		&& Get32(pTrailer+4,false)==(uint32_t)strm.total_out;
+}
+
+/*************************************************************************
+* DecodeJob
+*
+* decodes LZMA or gzip data into a file named for its offset, and queues
+* a scan of what came out into _<offset>.extracted.  Data that doesn't
+* decode was a false match, and is only reported.
+*
+**************************************************************************/
+static void DecodeJob(const EXTRACT_JOB *pJob)
+{
+	char szPath[FMK_PATH_LEN];
+	FwImage image;
+	bool bOk=false;
+
+	snprintf(szPath,sizeof(szPath),"%s/%lX",pJob->szDir,(unsigned long)pJob->nOffset);
+	unsigned char *pOut=(unsigned char *)malloc(FMK_DECODE_LEN);
+	int fdOut=open(szPath,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(pOut && fdOut>=0 && image.Open(pJob->szImage) && pJob->nOffset<image.Size())
+	{
+		const unsigned char *p=image.Data()+pJob->nOffset;
+		size_t nAvail=image.Size()-pJob->nOffset;
+		bOk=pJob->bLzma ? DecodeLzma(p,nAvail,fdOut,pOut)
+			: DecodeGzip(p,nAvail,fdOut,pOut);
+	}
+	free(pOut);
+	if(fdOut<0 || close(fdOut) || !bOk)
+	{
+		unlink(szPath);
+		printf("Could not decode %s\n", szPath);
+		return;
+	}
+	printf("Decoded %s\n", szPath);
+
+	if(pJob->nDepth<FMK_EXTRACT_DEPTH)
+	{
+		EXTRACT_JOB job;
+		memset(&job,0,sizeof(job));
+		snprintf(job.szImage,sizeof(job.szImage),"%s",szPath);
+		snprintf(job.szDir,sizeof(job.szDir),"%s/_%lX.extracted",pJob->szDir,
+			(unsigned long)pJob->nOffset);
+		job.nDepth=pJob->nDepth+1;
+		QueueJob(&job);
+	}
+}
+
+/*************************************************************************
+* ExtractJob
+*
+* scans a file and carves what it finds into szDir as <offset>.<type>:
+* containers whole, file systems to their size, or to the end where a
+* run of nodes has none.  Compressed data is queued to be decoded.
+*
+**************************************************************************/
+static void ExtractJob(const EXTRACT_JOB *pJob)
+{
+	SCAN_RESULT *pResults=NULL;
+	char szPath[FMK_PATH_LEN];
+	FwImage image;
+
+	if(!image.Open(pJob->szImage))
+	{
+		fprintf(stderr, " ERROR opening %s\n", pJob->szImage);
+		ExtractFailed();
+		return;
+	}
+	unsigned char *pEntropy=(unsigned char *)calloc(FMK_ENTROPY_BLOCKS(image.Size())+1,1);
+	if(!pEntropy)
+	{
+		fprintf(stderr, " ERROR out of memory\n");
+		ExtractFailed();
+		return;
+	}
+	size_t nResults=CachedScan(image,&pResults,pEntropy,
+		ScanAligned(pJob->szImage,image.Size()));
+	free(pEntropy);
+	if(nResults && !MakeDir(pJob->szDir))
+	{
+		ExtractFailed();
+		nResults=0;
+	}
+
+	for(size_t nI=0;nI<nResults;nI++)
+	{
+		const SCAN_RESULT *pR=&pResults[nI];
+		size_t nLength=image.Size()-pR->nOffset, nSkip;
+		char szType[32];
+		SCAN_RESULT r;
+		FwContainer c;
+
+		if(pR->bData)
+		{
+			EXTRACT_JOB job;
+			memset(&job,0,sizeof(job));
+			snprintf(job.szImage,sizeof(job.szImage),"%s",pJob->szImage);
+			snprintf(job.szDir,sizeof(job.szDir),"%s",pJob->szDir);
+			job.nOffset=pR->nOffset;
+			job.nDepth=pJob->nDepth;
+			job.bDecode=true;
+			job.bLzma=!strncmp(pR->szDescription,"LZMA",4);
+			QueueJob(&job);
+			continue;
+		}
+
+		if(FwIdentify(image.Data(),image.Data()+pR->nOffset,nLength,&c))
+		{
+			nLength=c.header.nLength+c.payload.nLength;
+			snprintf(szType,sizeof(szType),"%s",FwFormatName(c.format));
+		}
+		else
+		{
+			if(!pR->bOneOfMany && ScanAt(image.Data(),image.Size(),pR->nOffset,&r,&nSkip,false)
+				&& nSkip<nLength)
+				nLength=nSkip;
+			TypeName(pR,szType,sizeof(szType));
+		}
+
+		snprintf(szPath,sizeof(szPath),"%s/%lX.%s",pJob->szDir,
+			(unsigned long)pR->nOffset,szType);
+		if(!WriteSegment(image.Fd(),image.Offset()+pR->nOffset,nLength,szPath))
+		{
+			fprintf(stderr, " ERROR writing %s\n", szPath);
+			ExtractFailed();
+			continue;
+		}
+		printf("Carved %s\n", szPath);
+	}
+	free(pResults);
+}
+
+static void *ExtractWorker(void *)
+{
+	pthread_mutex_lock(&g_Extract.lock);
+	for(;;)
+	{
+		while(!g_Extract.nJobs && g_Extract.nBusy)
+			pthread_cond_wait(&g_Extract.cond,&g_Extract.lock);
+		if(!g_Extract.nJobs) break;
+
+		EXTRACT_JOB job=g_Extract.pJobs[--g_Extract.nJobs];
+		g_Extract.nBusy++;
+		pthread_mutex_unlock(&g_Extract.lock);
+
+		if(job.bDecode)
+			DecodeJob(&job);
+		else
+			ExtractJob(&job);
+
+		pthread_mutex_lock(&g_Extract.lock);
+		g_Extract.nBusy--;
+	}
+	pthread_cond_broadcast(&g_Extract.cond);
+	pthread_mutex_unlock(&g_Extract.lock);
+	return NULL;
+}
+
+/*************************************************************************
+* ExtractAll
+*
+* carves and decodes everything the scan finds in an image, and then in
+* what was decoded, on a thread per CPU in this one process
+*
+**************************************************************************/
+int ExtractAll(const char *pszImage, const char *pszDir)
+{
+	pthread_t threads[FMK_SCAN_THREADS];
+	EXTRACT_JOB job;
+	int nThreads;
+
+	memset(&job,0,sizeof(job));
+	snprintf(job.szImage,sizeof(job.szImage),"%s",pszImage);
+	snprintf(job.szDir,sizeof(job.szDir),"%s",pszDir);
+	QueueJob(&job);
+
+	long nCpus=sysconf(_SC_NPROCESSORS_ONLN);
+	nThreads=nCpus<1 ? 1 : nCpus>FMK_SCAN_THREADS ? FMK_SCAN_THREADS : (int)nCpus;
+	for(int nI=1;nI<nThreads;nI++)
+	{
+		if(pthread_create(&threads[nI],NULL,ExtractWorker,NULL))
+		{
+			nThreads=nI;
+			break;
+		}
+	}
+	ExtractWorker(NULL);
+	for(int nI=1;nI<nThreads;nI++) pthread_join(threads[nI],NULL);
+
+	free(g_Extract.pJobs);
+	return g_Extract.nFailed ? 1 : 0;
+}
+
+/************************************************************
+	main
+************************************************************/
+
+/*************************************************************************
+* WriteManifest
+*
+* writes logs/manifest.bin, the struct manifest and its regions, in one go
+*
+**************************************************************************/
+static bool WriteManifest(const char *pszPath, const struct manifest *pMan,
+	const struct manifest_region *pRegions)
+{
+	FILE *fMan=fopen(pszPath,"wb");
+	if(!fMan) return false;
+	bool bOk=fwrite(pMan,sizeof(*pMan),1,fMan)==1
+		&& fwrite(pRegions,sizeof(*pRegions),pMan->nregions,fMan)==pMan->nregions;
+	return fclose(fMan)==0 && bOk;
+}
+
+/* a region of the image for the manifest, its CRC taken if pData is given */
+static void SetRegion(struct manifest_region *pReg, uint32_t nKind, size_t nOffset,
+	size_t nLength, const char *pszName, const unsigned char *pData)
+{
+	memset(pReg,0,sizeof(*pReg));
+	pReg->kind=nKind;
+	pReg->offset=nOffset;
+	pReg->size=nLength;
+	strncpy(pReg->name,pszName,sizeof(pReg->name)-1);
+	if(pData) pReg->crc=crc32buf(pData+nOffset,nLength);
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-extract image dir\n"
+		"  scans a firmware image and splits it into dir/image_parts\n"
+		"  (header.img, rootfs.img, footer.img), with the scan, the\n"
+		"  parsed layout and the header CRC prefixes in dir/logs\n"
+		"  File systems before the rootfs are carved as partition<n>.img,\n"
+		"  and every one is listed as PARTITION<n>_* in dir/logs/config.log\n"
+		"  The layout is in dir/logs/manifest.bin too, for crcalc and\n"
+		"  fmk-assemble (crcalc/manifest.h).\n"
+		" An image may be a region of a file, as file@offset[+length].\n"
+		" USAGE: fmk-extract -f image\n"
+		"  prints FOOTER_SIZE and FOOTER_OFFSET of an image only\n"
+		" USAGE: fmk-extract -s image\n"
+		"  prints the scan of an image only, as binwalk did\n"
+		" USAGE: fmk-extract -S image\n"
+		"  copies stdin to image, printing the scan as it goes\n"
+		" USAGE: fmk-extract -x image dir\n"
+		"  carves every container and file system of an image into dir,\n"
+		"  and decodes its LZMA and gzip data, scanning that in turn\n"
+		" USAGE: fmk-extract -e image\n"
+		"  prints the entropy of each 4K block of an image only, as\n"
+		"  logs/entropy.log has it\n"
+		" Scans are kept in and reused from $FMK_SCAN_CACHE, if set.\n"
+		" An MTD dump (mtd*, whole erase blocks) is scanned for headers and\n"
+		" file systems on 4 byte boundaries only, unless $FMK_SCAN_ALIGN=0.\n");
+	exit(9);
+}
+
+/* the scan or the entropy map of an image on its own */
+int ShowScan(const char *pszImage, bool bEntropy)
+{
+	SCAN_RESULT *pResults=NULL;
+	FwImage image;
+
+	if(!image.Open(pszImage))
+	{
+		fprintf(stderr, " ERROR opening %s\n", pszImage);
+		return 1;
+	}
+	unsigned char *pEntropy=(unsigned char *)calloc(FMK_ENTROPY_BLOCKS(image.Size())+1,1);
+	if(!pEntropy)
+	{
+		fprintf(stderr, " ERROR out of memory\n");
+		return 1;
+	}
+	size_t nResults=CachedScan(image,&pResults,pEntropy,
+		ScanAligned(pszImage,image.Size()));
+	if(bEntropy)
+		PrintEntropy(stdout,pEntropy,image.Size());
+	else
+		PrintScan(stdout,pResults,nResults);
+	free(pEntropy);
+	free(pResults);
+	return 0;
+}
+
+static void PrintStreamResult(const SCAN_RESULT *pR, void *)
+{
+	PrintScanLine(stdout,pR);
+	fflush(stdout);
+}
+
+/*************************************************************************
+* ScanStream
+*
+* copies stdin to pszImage, printing each result of the scan as soon as
+* it is settled.  A container or file system is printed once all of it
+* is in the file, so it can be carved while the rest still comes in.
+*
+**************************************************************************/
+int ScanStream(const char *pszImage)
+{
+	unsigned char buf[65536];
+	SCAN_STREAM stream;
+	bool bOk=true;
+
+	int fd=open(pszImage,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(fd<0)
+	{
+		fprintf(stderr, " ERROR creating %s: %s\n", pszImage, strerror(errno));
+		return 1;
+	}
+	StreamInit(&stream,PrintStreamResult,NULL);
+	PrintScanHead(stdout);
+	for(;;)
+	{
+		ssize_t nRead=read(0,buf,sizeof(buf));
+		if(nRead<0 && errno==EINTR) continue;
+		if(nRead<0)
+		{
+			fprintf(stderr, " ERROR reading stdin: %s\n", strerror(errno));
+			bOk=false;
+		}
+		if(nRead<=0) break;
+		if(!WriteAll(fd,buf,nRead))
+		{
+			fprintf(stderr, " ERROR writing %s: %s\n", pszImage, strerror(errno));
+			bOk=false;
+			break;
+		}
+		if(!StreamPush(&stream,buf,nRead)) break;
+	}
+	if(!StreamFinish(&stream))
+	{
+		fprintf(stderr, " ERROR out of memory\n");
+		bOk=false;
+	}
+	printf("\n");
+	if(close(fd)) bOk=false;
+	return bOk ? 0 : 1;
+}
+
+/* the footer of an image on its own, in config.log's form */
+int ShowFooter(const char *pszImage)
+{
+	char szPath[FW_PATH_LEN];
+	uint64_t nOffset=0, nLength=UINT64_MAX;
+	struct stat st;
+	size_t nFooterSize, nSize=0;
+
+	bool bRegion=FwParseRegion(pszImage,szPath,&nOffset,&nLength);
+	int fd=open(bRegion ? szPath : pszImage,O_RDONLY);
+	bool bOk=fd>=0 && fstat(fd,&st)==0 && nOffset<=(uint64_t)st.st_size;
+	if(bOk)
+	{
+		nSize=st.st_size-nOffset<nLength ? st.st_size-nOffset : nLength;
+		bOk=FooterSize(fd,nOffset,nSize,&nFooterSize);
+	}
+	if(!bOk)
+	{
+		fprintf(stderr, " ERROR reading %s\n", pszImage);
+		if(fd>=0) close(fd);
+		return 1;
+	}
+	close(fd);
+	printf("FOOTER_SIZE='%lu'\n",(unsigned long)nFooterSize);
+	printf("FOOTER_OFFSET='%lu'\n",(unsigned long)(nSize-nFooterSize));
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	char szLogs[FMK_PATH_LEN], szParts[FMK_PATH_LEN], szPath[FMK_PATH_LEN];
+	char szHeaderType[32]="", szHeaderSize[32]="", szFsType[32]="";
+	char szBlockSize[32]="";
+	SCAN_RESULT *pResults=NULL, *pHeader=NULL, *pFs=NULL;
+	FwImage image;
+
+	if(argc==4 && !strcmp(argv[1],"-x"))
+	{
+		return ExtractAll(argv[2],argv[3]);
+	}
+	if(argc!=3)
+	{
+		ShowUsage();
+	}
+	if(!strcmp(argv[1],"-f"))
+	{
+		return ShowFooter(argv[2]);
+	}
+	if(!strcmp(argv[1],"-S"))
+	{
+		return ScanStream(argv[2]);
+	}
+	if(!strcmp(argv[1],"-s") || !strcmp(argv[1],"-e"))
+	{
+		return ShowScan(argv[2],argv[1][1]=='e');
+	}
+	const char *pszImage=argv[1], *pszDir=argv[2];
+
+	if(!image.Open(pszImage))
+	{
+		fprintf(stderr, " ERROR opening %s\n", pszImage);
+		return 1;
+	}
+	MakePath(szLogs,pszDir,"logs");
+	MakePath(szParts,pszDir,"image_parts");
+	if(!MakeDir(pszDir) || !MakeDir(szLogs) || !MakeDir(szParts))
+	{
+		return 1;
+	}
+
+	unsigned char *pEntropy=(unsigned char *)calloc(FMK_ENTROPY_BLOCKS(image.Size())+1,1);
+	if(!pEntropy)
+	{
+		fprintf(stderr, " ERROR out of memory\n");
+		return 1;
+	}
+
+	printf("Scanning firmware...\n");
+	size_t nResults=CachedScan(image,&pResults,pEntropy,
+		ScanAligned(pszImage,image.Size()));
+	MakePath(szPath,szLogs,"binwalk.log");
+	if(!WriteScanLog(szPath,pResults,nResults))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+
+	/* where the unknown compressed or encrypted parts may be */
+	MakePath(szPath,szLogs,"entropy.log");
+	FILE *fEntropy=fopen(szPath,"w");
+	if(fEntropy) PrintEntropy(fEntropy,pEntropy,image.Size());
+	if(!fEntropy || fclose(fEntropy))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+	free(pEntropy);
+
+	/* what is at 0 is the header, and the last file system is the one */
+	for(size_t nI=0;nI<nResults;nI++)
+	{
+		if(pResults[nI].bFilesystem) pFs=&pResults[nI];
+		else if(pResults[nI].nOffset==0 && !pResults[nI].bData) pHeader=&pResults[nI];
+	}
+	if(pHeader)
+	{
+		TypeName(pHeader,szHeaderType,sizeof(szHeaderType));
+		Field(pHeader,"header size: ",szHeaderSize,sizeof(szHeaderSize));
+	}
+
+	size_t nSize=image.Size(), nFsOffset=pFs ? pFs->nOffset : 0;
+	printf("Extracting %lu bytes of %s header image at offset 0\n",
+		(unsigned long)nFsOffset, szHeaderType);
+	MakePath(szPath,szParts,"header.img");
+	if(!WriteSegment(image.Fd(),image.Offset(),nFsOffset,szPath))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+
+	if(!pFs)
+	{
+		printf("ERROR: No supported file system found! Aborting...\n");
+		return 1;
+	}
+	TypeName(pFs,szFsType,sizeof(szFsType));
+	Field(pFs,"blocksize: ",szBlockSize,sizeof(szBlockSize));
+	printf("Extracting %s file system at offset %lu\n", szFsType,
+		(unsigned long)nFsOffset);
+	MakePath(szPath,szParts,"rootfs.img");
+	if(!WriteSegment(image.Fd(),image.Offset()+nFsOffset,nSize-nFsOffset,szPath))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+
+	size_t nFooterSize;
+	if(!FooterSize(image.Fd(),image.Offset(),nSize,&nFooterSize))
+	{
+		fprintf(stderr, " ERROR reading %s\n", pszImage);
+		return 1;
+	}
+	size_t nFooterOffset=nSize-nFooterSize;
+	if(nFooterSize)
+	{
+		printf("Extracting %lu byte footer from offset %lu\n",
+			(unsigned long)nFooterSize, (unsigned long)nFooterOffset);
+		MakePath(szPath,szParts,"footer.img");
+		if(!WriteSegment(image.Fd(),image.Offset()+nFooterOffset,nFooterSize,szPath))
+		{
+			fprintf(stderr, " ERROR writing %s\n", szPath);
+			return 1;
+		}
+	}
+
+	/* every file system found is a partition, the rootfs above the last
+	   of them; the others before it are in the header image, and are
+	   carved on their own too for extract-firmware.sh */
+	size_t parts[FMK_PARTITIONS], nParts=0;
+	size_t nPartSize[FMK_PARTITIONS], nPartSpace[FMK_PARTITIONS];
+	for(size_t nI=0;nI<nResults && nParts<FMK_PARTITIONS-1;nI++)
+	{
+		if(pResults[nI].bFilesystem && &pResults[nI]!=pFs) parts[nParts++]=nI;
+	}
+	parts[nParts++]=pFs-pResults;
+	for(size_t nP=0;nP+1<nParts;nP++)
+	{
+		const SCAN_RESULT *pR=&pResults[parts[nP]];
+		size_t nSkip;
+		SCAN_RESULT r;
+
+		/* the space up to the next one, which a rebuild may fill */
+		nPartSpace[nP]=nPartSize[nP]=pResults[parts[nP+1]].nOffset-pR->nOffset;
+		if(!pR->bOneOfMany && ScanAt(image.Data(),nSize,pR->nOffset,&r,&nSkip,false)
+			&& nSkip<nPartSize[nP])
+			nPartSize[nP]=nSkip;
+
+		snprintf(szPath,sizeof(szPath),"%s/partition%lu.img",szParts,(unsigned long)nP);
+		TypeName(pR,szFsType,sizeof(szFsType));
+		printf("Extracting %s file system partition at offset %lu\n", szFsType,
+			(unsigned long)pR->nOffset);
+		if(!WriteSegment(image.Fd(),image.Offset()+pR->nOffset,nPartSize[nP],szPath))
+		{
+			fprintf(stderr, " ERROR writing %s\n", szPath);
+			return 1;
+		}
+	}
+	nPartSize[nParts-1]=nSize-nFsOffset;
+	nPartSpace[nParts-1]=nFooterOffset>nFsOffset ? nFooterOffset-nFsOffset : nPartSize[nParts-1];
+	TypeName(pFs,szFsType,sizeof(szFsType));
+
+	/* the parsed values, for build-firmware.sh to read back */
+	MakePath(szPath,szLogs,"config.log");
+	FILE *fConf=fopen(szPath,"w");
+	if(!fConf)
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+	fprintf(fConf,"FW_SIZE='%lu'\n",(unsigned long)nSize);
+	fprintf(fConf,"HEADER_TYPE='%s'\n",szHeaderType);
+	fprintf(fConf,"HEADER_SIZE='%s'\n",szHeaderSize);
+	fprintf(fConf,"HEADER_IMAGE_SIZE='%lu'\n",(unsigned long)nFsOffset);
+	fprintf(fConf,"HEADER_IMAGE_OFFSET='0'\n");
+	fprintf(fConf,"FOOTER_SIZE='%lu'\n",(unsigned long)nFooterSize);
+	fprintf(fConf,"FOOTER_OFFSET='%lu'\n",(unsigned long)nFooterOffset);
+	fprintf(fConf,"FS_TYPE='%s'\n",szFsType);
+	fprintf(fConf,"FS_OFFSET='%lu'\n",(unsigned long)nFsOffset);
+	fprintf(fConf,"FS_COMPRESSION='%s'\n",
+		strstr(pFs->szDescription,"gzip") ? "gzip" : "lzma");
+	fprintf(fConf,"FS_BLOCKSIZE='%s'\n",szBlockSize);
+	fprintf(fConf,"ENDIANESS='%s'\n",
+		strstr(pFs->szDescription,"big endian") ? "-be" : "-le");
+	fprintf(fConf,"PARTITIONS='%lu'\n",(unsigned long)nParts);
+	for(size_t nP=0;nP<nParts;nP++)
+	{
+		const SCAN_RESULT *pR=&pResults[parts[nP]];
+		char szType[32], szBlock[32];
+		unsigned long n=nP;
+
+		TypeName(pR,szType,sizeof(szType));
+		Field(pR,"blocksize: ",szBlock,sizeof(szBlock));
+		fprintf(fConf,"PARTITION%lu_TYPE='%s'\n",n,szType);
+		fprintf(fConf,"PARTITION%lu_OFFSET='%lu'\n",n,(unsigned long)pR->nOffset);
+		fprintf(fConf,"PARTITION%lu_SIZE='%lu'\n",n,(unsigned long)nPartSize[nP]);
+		fprintf(fConf,"PARTITION%lu_SPACE='%lu'\n",n,(unsigned long)nPartSpace[nP]);
+		fprintf(fConf,"PARTITION%lu_COMPRESSION='%s'\n",n,
+			strstr(pR->szDescription,"gzip") ? "gzip" : "lzma");
+		fprintf(fConf,"PARTITION%lu_BLOCKSIZE='%s'\n",n,szBlock);
+		fprintf(fConf,"PARTITION%lu_ENDIANESS='%s'\n",n,
+			strstr(pR->szDescription,"big endian") ? "-be" : "-le");
+		if(nP+1<nParts)
+		{
+			fprintf(fConf,"PARTITION%lu_IMAGE='partition%lu.img'\n",n,n);
+			fprintf(fConf,"PARTITION%lu_ROOTFS='partition%lu'\n",n,n);
+		}
+		else
+		{
+			fprintf(fConf,"PARTITION%lu_IMAGE='rootfs.img'\n",n);
+			fprintf(fConf,"PARTITION%lu_ROOTFS='rootfs'\n",n);
+		}
+	}
+	if(fclose(fConf))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+
+	/* save the CRC state of the header image, so that a rebuild only
+	   checksums the new file system */
+	int offsets[MAX_HEAD_SIZE], nOffsets=0;
+	for(size_t nI=0;nI<nResults && nOffsets<MAX_HEAD_SIZE;nI++)
+	{
+		if(pResults[nI].bHeader) offsets[nOffsets++]=pResults[nI].nOffset;
+	}
+	MakePath(szPath,szLogs,"crc.log");
+	fflush(stdout);
+	if(nSize>MIN_FILE_SIZE)
+	{
+		save_prefixes(szPath,(char *)image.Data(),nSize,offsets,nOffsets,
+			nFsOffset);
+	}
+
+	/* and the whole layout, with those prefixes, in logs/manifest.bin */
+	static struct manifest_region regions[MAX_HEAD_SIZE+FMK_PARTITIONS+2];
+	struct crc_prefix prefixes[MAX_HEAD_SIZE];
+	int prefixOffsets[MAX_HEAD_SIZE];
+	int nPrefixes=nSize>MIN_FILE_SIZE ? read_cache(szPath,prefixOffsets,prefixes) : 0;
+	const unsigned char *pData=image.Data();
+	struct manifest man;
+	uint32_t nRegions=0;
+
+	for(size_t nI=0;nI<nResults && nRegions<MAX_HEAD_SIZE;nI++)
+	{
+		const SCAN_RESULT *pR=&pResults[nI];
+		char szType[32];
+
+		if(!pR->bHeader) continue;
+		struct manifest_region *pReg=&regions[nRegions++];
+		TypeName(pR,szType,sizeof(szType));
+		SetRegion(pReg,REGION_HEADER,pR->nOffset,pR->nHeaderSize,szType,NULL);
+		if(pR->nOffset+MIN_FILE_SIZE<=nSize)
+			pReg->type=identify_header((char *)pData+pR->nOffset);
+		for(int nC=0;nC<nPrefixes;nC++)
+		{
+			if((size_t)prefixOffsets[nC]!=pR->nOffset) continue;
+			pReg->flags|=REGION_PREFIX;
+			pReg->prefix_len=prefixes[nC].len;
+			pReg->prefix_crc=prefixes[nC].crc;
+		}
+	}
+	SetRegion(&regions[nRegions++],REGION_HEADER_IMAGE,0,nFsOffset,"header.img",pData);
+	for(size_t nP=0;nP<nParts;nP++)
+	{
+		const SCAN_RESULT *pR=&pResults[parts[nP]];
+		struct manifest_region *pReg=&regions[nRegions++];
+		char szType[32], szBlock[32];
+
+		TypeName(pR,szType,sizeof(szType));
+		Field(pR,"blocksize: ",szBlock,sizeof(szBlock));
+		SetRegion(pReg,REGION_FILESYSTEM,pR->nOffset,nPartSize[nP],szType,pData);
+		pReg->block_size=strtoul(szBlock,NULL,10);
+		strcpy(pReg->compression,strstr(pR->szDescription,"gzip") ? "gzip" : "lzma");
+		if(strstr(pR->szDescription,"big endian")) pReg->flags|=REGION_BIG_ENDIAN;
+		if(nP+1==nParts) pReg->flags|=REGION_ROOTFS;
+	}
+	if(nFooterSize)
+	{
+		SetRegion(&regions[nRegions++],REGION_FOOTER,nFooterOffset,nFooterSize,
+			"footer.img",pData);
+	}
+
+	memset(&man,0,sizeof(man));
+	memcpy(man.magic,MANIFEST_MAGIC,MANIFEST_MAGIC_SIZE);
+	man.version=MANIFEST_VERSION;
+	man.nregions=nRegions;
+	man.fw_size=nSize;
+	man.fs_offset=nFsOffset;
+	man.footer_size=nFooterSize;
+	MakePath(szPath,szLogs,"manifest.bin");
+	if(!WriteManifest(szPath,&man,regions))
+	{
+		fprintf(stderr, " ERROR writing %s\n", szPath);
+		return 1;
+	}
+
+	free(pResults);
+	return 0;
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-index.cc
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fmkindex/fmkindex.h"
+
+/*
+ * Searches the file content index the extractors write with FMK_INDEX
+ * set, see fmkindex/fmkindex.h, for the images a file is in: by the MD5
+ * md5sum prints, by a file to hash, by a path pattern or by an image
+ * pattern.  The index is mapped and every segment is checked before its
+ * columns are read, so a damaged or truncated tail, that of a crashed
+ * extraction say, stops the walk with a warning and nothing else.  A
+ * hash search compares the hash column alone and only looks at the
+ * paths of the records that match.
+ */
+
+#define FMK_CHUNK_LEN	0x40000000	/* md5_append takes an int */
+
+typedef struct _QUERY
+{
+	bool bHash;
+	md5_byte_t hash[FMK_INDEX_HASH_SIZE];
+	const char *pszPath;		/* fnmatch() patterns, or NULL */
+	const char *pszImage;
+	bool bStats;
+} QUERY;
+
+/* whether a column of nCount nSize byte values lies in the segment */
+static bool ColumnFits(const fmk_index_segment *pSeg, uint64_t nOffset,
+	uint64_t nCount, uint64_t nSize)
+{
+	return nOffset>=sizeof(fmk_index_segment) && nOffset%8==0 && nOffset<=pSeg->size
+		&& nCount<=(pSeg->size-nOffset)/nSize;
+}
+
+/*************************************************************************
+* CheckSegment
+*
+* whether the segment at p, with nLeft bytes of the index from it, is
+* whole, and all its offsets are inside it
+*
+**************************************************************************/
+bool CheckSegment(const unsigned char *p, uint64_t nLeft)
+{
+	const fmk_index_segment *pSeg=(const fmk_index_segment *)p;
+
+	if(nLeft<sizeof(fmk_index_segment) || memcmp(pSeg->magic,FMK_INDEX_MAGIC,
+		FMK_INDEX_MAGIC_SIZE) || pSeg->version!=FMK_INDEX_VERSION
+		|| pSeg->size>nLeft || pSeg->size%8)
+		return false;
+	if(!ColumnFits(pSeg,pSeg->hashes,pSeg->records,FMK_INDEX_HASH_SIZE)
+		|| !ColumnFits(pSeg,pSeg->sizes,pSeg->records,sizeof(uint64_t))
+		|| !ColumnFits(pSeg,pSeg->modes,pSeg->records,sizeof(uint32_t))
+		|| !ColumnFits(pSeg,pSeg->paths,pSeg->records,sizeof(uint32_t))
+		|| !ColumnFits(pSeg,pSeg->strings,pSeg->strings_size,1))
+		return false;
+
+	/* every string must end inside the strings */
+	const char *pszStrings=(const char *)p+pSeg->strings;
+	if(!pSeg->strings_size || pszStrings[pSeg->strings_size-1]
+		|| pSeg->image>=pSeg->strings_size || pSeg->tool>=pSeg->strings_size)
+		return false;
+	const uint32_t *pPaths=(const uint32_t *)(p+pSeg->paths);
+	for(uint32_t nI=0;nI<pSeg->records;nI++)
+	{
+		if(pPaths[nI]>=pSeg->strings_size) return false;
+	}
+	return true;
+}
+
+/*************************************************************************
+* SearchSegment
+*
+* prints the records of a segment the query matches, returning how many
+*
+**************************************************************************/
+unsigned long long SearchSegment(const unsigned char *p, const QUERY *pQuery)
+{
+	const fmk_index_segment *pSeg=(const fmk_index_segment *)p;
+	const char *pszStrings=(const char *)p+pSeg->strings;
+	const char *pszImage=pszStrings+pSeg->image;
+	const unsigned char *pHashes=p+pSeg->hashes;
+	const uint64_t *pSizes=(const uint64_t *)(p+pSeg->sizes);
+	const uint32_t *pModes=(const uint32_t *)(p+pSeg->modes);
+	const uint32_t *pPaths=(const uint32_t *)(p+pSeg->paths);
+	unsigned long long nMatched=0;
+
+	if(pQuery->pszImage && fnmatch(pQuery->pszImage,pszImage,0)) return 0;
+	if(pQuery->bStats)
+	{
+		unsigned long long nBytes=0;
+		for(uint32_t nI=0;nI<pSeg->records;nI++) nBytes+=pSizes[nI];
+		printf("%s\t%s\t%u\t%llu\n",pszImage,pszStrings+pSeg->tool,
+			pSeg->records,nBytes);
+		return pSeg->records;
+	}
+
+	for(uint32_t nI=0;nI<pSeg->records;nI++)
+	{
+		const unsigned char *pHash=pHashes+(size_t)nI*FMK_INDEX_HASH_SIZE;
+		if(pQuery->bHash && memcmp(pHash,pQuery->hash,FMK_INDEX_HASH_SIZE)) continue;
+		const char *pszPath=pszStrings+pPaths[nI];
+		if(pQuery->pszPath && fnmatch(pQuery->pszPath,pszPath,0)) continue;
+
+		printf("%s\t%s\t%llu\t%o\t",pszImage,pszPath,
+			(unsigned long long)pSizes[nI],(unsigned)pModes[nI]);
+		for(int nJ=0;nJ<FMK_INDEX_HASH_SIZE;nJ++) printf("%02x",pHash[nJ]);
+		printf("\n");
+		nMatched++;
+	}
+	return nMatched;
+}
+
+/*************************************************************************
+* Search
+*
+* walks the segments of an index, returning 0 if anything matched, 1 if
+* nothing did and 2 if the index couldn't be read
+*
+**************************************************************************/
+int Search(const char *pszIndex, const QUERY *pQuery)
+{
+	struct stat st;
+	unsigned long long nMatched=0;
+
+	int fd=open(pszIndex,O_RDONLY);
+	if(fd<0 || fstat(fd,&st)<0)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszIndex, strerror(errno));
+		if(fd>=0) close(fd);
+		return 2;
+	}
+	if(!st.st_size)
+	{
+		close(fd);
+		return 1;
+	}
+	void *pMap=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(pMap==MAP_FAILED)
+	{
+		fprintf(stderr, " ERROR reading %s: %s\n", pszIndex, strerror(errno));
+		return 2;
+	}
+
+	const unsigned char *p=(const unsigned char *)pMap;
+	uint64_t nOffset=0;
+	while(nOffset<(uint64_t)st.st_size)
+	{
+		if(!CheckSegment(p+nOffset,st.st_size-nOffset))
+		{
+			fprintf(stderr, " WARNING %s is damaged at %llu, the rest is skipped\n",
+				pszIndex, (unsigned long long)nOffset);
+			break;
+		}
+		nMatched+=SearchSegment(p+nOffset,pQuery);
+		nOffset+=((const fmk_index_segment *)(p+nOffset))->size;
+	}
+	munmap(pMap,st.st_size);
+	return nMatched ? 0 : 1;
+}
+
+/* the MD5 of a file, as the extractors index it */
+bool HashFile(const char *pszPath, md5_byte_t hash[FMK_INDEX_HASH_SIZE])
+{
+	struct stat st;
+	md5_state_t state;
+
+	int fd=open(pszPath,O_RDONLY);
+	if(fd<0 || fstat(fd,&st)<0)
+	{
+		fprintf(stderr, " ERROR reading %s: %s\n", pszPath, strerror(errno));
+		if(fd>=0) close(fd);
+		return false;
+	}
+	if(!S_ISREG(st.st_mode))
+	{
+		fprintf(stderr, " ERROR %s isn't a regular file\n", pszPath);
+		close(fd);
+		return false;
+	}
+	md5_init(&state);
+	if(st.st_size)
+	{
+		void *p=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+		if(p==MAP_FAILED)
+		{
+			fprintf(stderr, " ERROR reading %s: %s\n", pszPath, strerror(errno));
+			close(fd);
+			return false;
+		}
+		madvise(p,st.st_size,MADV_SEQUENTIAL);
+		const md5_byte_t *pb=(const md5_byte_t *)p;
+		for(size_t nLeft=st.st_size;nLeft;)
+		{
+			int nChunk=nLeft>FMK_CHUNK_LEN ? FMK_CHUNK_LEN : (int)nLeft;
+			md5_append(&state,pb,nChunk);
+			pb+=nChunk;
+			nLeft-=nChunk;
+		}
+		munmap(p,st.st_size);
+	}
+	close(fd);
+	md5_finish(&state,hash);
+	return true;
+}
+
+/* the hash of md5sum's 32 hex digits */
+bool ParseHash(const char *pszHex, md5_byte_t hash[FMK_INDEX_HASH_SIZE])
+{
+	if(strlen(pszHex)!=FMK_INDEX_HASH_SIZE*2) return false;
+	for(int nI=0;nI<FMK_INDEX_HASH_SIZE;nI++)
+	{
+		unsigned int nByte;
+		if(!isxdigit((unsigned char)pszHex[nI*2]) || !isxdigit((unsigned char)pszHex[nI*2+1])
+			|| sscanf(pszHex+nI*2,"%2x",&nByte)!=1)
+			return false;
+		hash[nI]=nByte;
+	}
+	return true;
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-index [-m md5 | -f file] [-p path] [-i image] [-s] index\n"
+		"  prints the image, path, size, mode and MD5 of the files in an index\n"
+		"  FMK_INDEX=index extractions wrote, one record to a line\n"
+		"  -m md5    only the files with this MD5, as md5sum prints it\n"
+		"  -f file   only the files with the contents of file\n"
+		"  -p path   only the files whose path, from /, matches the pattern\n"
+		"  -i image  only the files of images matching the pattern\n"
+		"  -s        the image, tool, files and bytes of each extraction instead\n"
+		"  exits 1 if nothing matched\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	QUERY query;
+	int nArg=1;
+
+	memset(&query,0,sizeof(query));
+	for(;nArg<argc && argv[nArg][0]=='-' && argv[nArg][1];nArg++)
+	{
+		if(!strcmp(argv[nArg],"-s"))
+		{
+			query.bStats=true;
+			continue;
+		}
+		if(nArg+1>=argc) ShowUsage();
+		const char *pszValue=argv[++nArg];
+		if(!strcmp(argv[nArg-1],"-m") && !query.bHash)
+		{
+			if(!ParseHash(pszValue,query.hash))
+			{
+				fprintf(stderr, " ERROR %s isn't an MD5\n", pszValue);
+				return 2;
+			}
+			query.bHash=true;
+		}
+		else if(!strcmp(argv[nArg-1],"-f") && !query.bHash)
+		{
+			if(!HashFile(pszValue,query.hash)) return 2;
+			query.bHash=true;
+		}
+		else if(!strcmp(argv[nArg-1],"-p")) query.pszPath=pszValue;
+		else if(!strcmp(argv[nArg-1],"-i")) query.pszImage=pszValue;
+		else ShowUsage();
+	}
+	if(argc!=nArg+1 || (query.bStats && (query.bHash || query.pszPath)))
+	{
+		ShowUsage();
+	}
+	return Search(argv[nArg],&query);
+}
@@ -0,0 +1,839 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-ipkg.cc
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <zlib.h>
+
+/*
+ * Installs .ipk packages into the rootfs of a working directory, and
+ * removes them again, in place of the tar and gunzip runs of the
+ * ipkg_*.sh scripts.  Packages are mapped and inflated in memory, as
+ * many at once as there are jobs, and their data.tar.gz is unpacked
+ * straight into the rootfs, in the order given so that later packages
+ * still overwrite earlier ones.  The files a package installed are
+ * listed in installed_packages/<package>.list, which removal reads
+ * rather than the archive.  Paths, and any symlinks on them, are
+ * resolved inside the rootfs, as the firmware will see them.
+ */
+
+#define FMK_PATH_LEN	4096
+#define FMK_NAME_LEN	256
+#define FMK_LINK_DEPTH	40	/* symlinks followed resolving one path */
+#define TAR_BLOCK	512
+#define AR_MAGIC	"!<arch>\n"
+#define AR_HEADER_LEN	60
+
+typedef struct _PACKAGE
+{
+	const char *pszPath;
+	char szName[FMK_NAME_LEN];	/* the file name, less .ipk */
+	char szList[FMK_PATH_LEN+FMK_NAME_LEN];
+	bool bListed;			/* remove from szList, not the archive */
+	unsigned char *pData;		/* data.tar, inflated */
+	size_t nData;
+	unsigned char *pControl;	/* control.tar, inflated */
+	size_t nControl;
+	const char *pszError;
+	bool bRead;
+} PACKAGE;
+
+typedef struct _TAR_ENTRY
+{
+	char szName[FMK_PATH_LEN];
+	char szLink[FMK_PATH_LEN];
+	char cType;
+	unsigned int nMode, nUid, nGid, nMajor, nMinor;
+	time_t nMtime;
+	const unsigned char *pData;
+	size_t nSize;
+} TAR_ENTRY;
+
+/* the packages, read ahead of the installs by the reader threads */
+static PACKAGE *g_pPackages;
+static int g_nPackages, g_nNext, g_nDone, g_nAhead;
+static pthread_mutex_t g_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond=PTHREAD_COND_INITIALIZER;
+static bool g_bRoot;
+
+/************************************************************
+	archives
+************************************************************/
+
+/* inflates a whole gzip stream in memory, into a buffer grown as needed */
+unsigned char *Inflate(const unsigned char *pIn, size_t nIn, size_t *pnOut)
+{
+	z_stream zs;
+	size_t nSize=nIn*4+TAR_BLOCK, nOut=0;
+	unsigned char *pOut;
+
+	memset(&zs,0,sizeof(zs));
+	if(nIn>0xffffffffUL || inflateInit2(&zs,15+32)!=Z_OK) return NULL;
+	zs.next_in=(Bytef *)pIn;
+	zs.avail_in=(uInt)nIn;
+	pOut=(unsigned char *)malloc(nSize);
+	while(pOut)
+	{
+		if(nOut==nSize)
+		{
+			unsigned char *pNew=(unsigned char *)realloc(pOut,nSize*=2);
+			if(!pNew) free(pOut);
+			pOut=pNew;
+			continue;
+		}
+		zs.next_out=pOut+nOut;
+		zs.avail_out=(uInt)(nSize-nOut>0x40000000 ? 0x40000000 : nSize-nOut);
+		int nRet=inflate(&zs,Z_NO_FLUSH);
+		nOut=zs.next_out-pOut;
+		if(nRet==Z_STREAM_END) break;
+		if((nRet!=Z_OK && nRet!=Z_BUF_ERROR) || (nRet==Z_BUF_ERROR && !zs.avail_in))
+		{
+			free(pOut);
+			pOut=NULL;
+		}
+	}
+	inflateEnd(&zs);
+	*pnOut=nOut;
+	return pOut;
+}
+
+static unsigned long long TarNumber(const unsigned char *p, int nLength)
+{
+	unsigned long long n=0;
+	int nI=0;
+
+	/* GNU base-256, for sizes past the octal field */
+	if(p[0]&0x80)
+	{
+		n=p[0]&0x3f;
+		for(nI=1;nI<nLength;nI++) n=n<<8|p[nI];
+		return n;
+	}
+	while(nI<nLength && p[nI]==' ') nI++;
+	for(;nI<nLength && p[nI]>='0' && p[nI]<='7';nI++) n=n*8+p[nI]-'0';
+	return n;
+}
+
+/* the path and linkpath records of a pax extended header */
+static void TarPax(const unsigned char *p, size_t nLength, char *pszName, char *pszLink)
+{
+	size_t nOffset=0;
+	while(nOffset<nLength)
+	{
+		char *pszEnd;
+		unsigned long nRecord=strtoul((const char *)p+nOffset,&pszEnd,10);
+		const char *pszKey=pszEnd+1;
+		if(!nRecord || nRecord>nLength-nOffset || *pszEnd!=' ') return;
+		const char *pszValue=(const char *)memchr(pszKey,'=',(const char *)p+nOffset+nRecord-pszKey);
+		if(pszValue)
+		{
+			size_t nValue=(const char *)p+nOffset+nRecord-1-(pszValue+1);
+			char *pszTo=!strncmp(pszKey,"path=",5) ? pszName
+				: !strncmp(pszKey,"linkpath=",9) ? pszLink : NULL;
+			if(pszTo && nValue<FMK_PATH_LEN)
+			{
+				memcpy(pszTo,pszValue+1,nValue);
+				pszTo[nValue]='\0';
+			}
+		}
+		nOffset+=nRecord;
+	}
+}
+
+/*************************************************************************
+* TarNext
+*
+* the entry of a tar at *pnOffset, moving *pnOffset past it.  Returns 1
+* for an entry, 0 at the end of the archive and -1 for a bad header.
+*
+**************************************************************************/
+int TarNext(const unsigned char *pTar, size_t nTar, size_t *pnOffset, TAR_ENTRY *pEntry)
+{
+	char szLongName[FMK_PATH_LEN]="", szLongLink[FMK_PATH_LEN]="";
+
+	while(*pnOffset<nTar && nTar-*pnOffset>=TAR_BLOCK)
+	{
+		const unsigned char *h=pTar+*pnOffset;
+		unsigned int nSum=0;
+		int nSignedSum=0;
+
+		if(!h[0]) return 0;
+		for(int nI=0;nI<TAR_BLOCK;nI++)
+		{
+			nSum+=nI>=148 && nI<156 ? ' ' : h[nI];
+			nSignedSum+=nI>=148 && nI<156 ? ' ' : (signed char)h[nI];
+		}
+		/* some old tars summed signed bytes */
+		unsigned long long nCheck=TarNumber(h+148,8);
+		if(nSum!=nCheck && (unsigned int)nSignedSum!=nCheck) return -1;
+
+		size_t nData=*pnOffset+TAR_BLOCK;
+		unsigned long long nSize=TarNumber(h+124,12);
+		if(nSize>nTar-nData) return -1;
+		*pnOffset=nData+((nSize+TAR_BLOCK-1)&~(unsigned long long)(TAR_BLOCK-1));
+
+		char cType=h[156];
+		if(cType=='L' || cType=='K')
+		{
+			char *psz=cType=='L' ? szLongName : szLongLink;
+			size_t n=nSize<FMK_PATH_LEN-1 ? nSize : FMK_PATH_LEN-1;
+			memcpy(psz,pTar+nData,n);
+			psz[n]='\0';
+			continue;
+		}
+		if(cType=='x')
+		{
+			TarPax(pTar+nData,nSize,szLongName,szLongLink);
+			continue;
+		}
+		if(cType=='g') continue;
+
+		if(szLongName[0])
+			strcpy(pEntry->szName,szLongName);
+		else if(!memcmp(h+257,"ustar",5) && h[345])
+			snprintf(pEntry->szName,FMK_PATH_LEN,"%.155s/%.100s",h+345,h+0);
+		else
+			snprintf(pEntry->szName,FMK_PATH_LEN,"%.100s",h+0);
+		if(szLongLink[0])
+			strcpy(pEntry->szLink,szLongLink);
+		else
+			snprintf(pEntry->szLink,FMK_PATH_LEN,"%.100s",h+157);
+
+		pEntry->cType=cType ? cType : '0';
+		pEntry->nMode=(unsigned int)TarNumber(h+100,8);
+		pEntry->nUid=(unsigned int)TarNumber(h+108,8);
+		pEntry->nGid=(unsigned int)TarNumber(h+116,8);
+		pEntry->nMtime=(time_t)TarNumber(h+136,12);
+		pEntry->nMajor=(unsigned int)TarNumber(h+329,8);
+		pEntry->nMinor=(unsigned int)TarNumber(h+337,8);
+		pEntry->pData=pTar+nData;
+		pEntry->nSize=nSize;
+		return 1;
+	}
+	return 0;
+}
+
+/* a member name with any leading ./ and / dropped */
+static const char *MemberName(const char *pszName)
+{
+	while(*pszName=='/' || (pszName[0]=='.' && pszName[1]=='/')) pszName+=*pszName=='/' ? 1 : 2;
+	return pszName;
+}
+
+/* finds member pszName of a tar in memory */
+bool TarFind(const unsigned char *pTar, size_t nTar, const char *pszName,
+	const unsigned char **ppMember, size_t *pnMember)
+{
+	TAR_ENTRY entry;
+	size_t nOffset=0;
+
+	while(TarNext(pTar,nTar,&nOffset,&entry)==1)
+	{
+		if(!strcmp(MemberName(entry.szName),pszName))
+		{
+			*ppMember=entry.pData;
+			*pnMember=entry.nSize;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* finds member pszName of an ar archive in memory */
+bool ArFind(const unsigned char *pAr, size_t nAr, const char *pszName,
+	const unsigned char **ppMember, size_t *pnMember)
+{
+	size_t nOffset=sizeof(AR_MAGIC)-1;
+	size_t nName=strlen(pszName);
+
+	while(nOffset<nAr && nAr-nOffset>=AR_HEADER_LEN)
+	{
+		const unsigned char *h=pAr+nOffset;
+		char szSize[11];
+		memcpy(szSize,h+48,10);
+		szSize[10]='\0';
+		size_t nSize=strtoul(szSize,NULL,10);
+		nOffset+=AR_HEADER_LEN;
+		if(nSize>nAr-nOffset) return false;
+
+		/* GNU ar ends names with a / */
+		if(nName<16 && !memcmp(h,pszName,nName) && (h[nName]==' ' || h[nName]=='/'))
+		{
+			*ppMember=pAr+nOffset;
+			*pnMember=nSize;
+			return true;
+		}
+		nOffset+=nSize+(nSize&1);
+	}
+	return false;
+}
+
+/*************************************************************************
+* ReadPackage
+*
+* inflates the data.tar.gz and control.tar.gz of a package, which is an
+* ar archive, or the gzipped tar older ipkg-build writes
+*
+**************************************************************************/
+void ReadPackage(PACKAGE *pPackage)
+{
+	struct stat st;
+	const unsigned char *pData=NULL, *pControl=NULL;
+	size_t nData=0, nControl=0, nOuter=0;
+	unsigned char *pOuter=NULL;
+	bool bData=false, bControl=false;
+
+	int fd=open(pPackage->pszPath,O_RDONLY);
+	if(fd<0 || fstat(fd,&st)<0 || !st.st_size)
+	{
+		pPackage->pszError="can't be read";
+		if(fd>=0) close(fd);
+		return;
+	}
+	void *p=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(p==MAP_FAILED)
+	{
+		pPackage->pszError="can't be read";
+		return;
+	}
+
+	const unsigned char *pb=(const unsigned char *)p;
+	size_t nSize=st.st_size;
+	if(nSize>=sizeof(AR_MAGIC)-1 && !memcmp(pb,AR_MAGIC,sizeof(AR_MAGIC)-1))
+	{
+		bData=ArFind(pb,nSize,"data.tar.gz",&pData,&nData);
+		bControl=ArFind(pb,nSize,"control.tar.gz",&pControl,&nControl);
+	}
+	else if(nSize>=2 && pb[0]==0x1f && pb[1]==0x8b
+		&& (pOuter=Inflate(pb,nSize,&nOuter))!=NULL)
+	{
+		bData=TarFind(pOuter,nOuter,"data.tar.gz",&pData,&nData);
+		bControl=TarFind(pOuter,nOuter,"control.tar.gz",&pControl,&nControl);
+	}
+
+	if(!bData)
+		pPackage->pszError="has no data.tar.gz (not an ipk?)";
+	else if(!(pPackage->pData=Inflate(pData,nData,&pPackage->nData)))
+		pPackage->pszError="has a damaged data.tar.gz";
+	else if(bControl)
+		pPackage->pControl=Inflate(pControl,nControl,&pPackage->nControl);
+
+	free(pOuter);
+	munmap(p,st.st_size);
+}
+
+/* reads the packages in order, at most g_nAhead ahead of the installs */
+static void *ReadThread(void *)
+{
+	pthread_mutex_lock(&g_mutex);
+	while(g_nNext<g_nPackages)
+	{
+		if(g_nNext>=g_nDone+g_nAhead)
+		{
+			pthread_cond_wait(&g_cond,&g_mutex);
+			continue;
+		}
+		PACKAGE *pPackage=&g_pPackages[g_nNext++];
+		pthread_mutex_unlock(&g_mutex);
+		if(!pPackage->bListed) ReadPackage(pPackage);
+		pthread_mutex_lock(&g_mutex);
+		pPackage->bRead=true;
+		pthread_cond_broadcast(&g_cond);
+	}
+	pthread_mutex_unlock(&g_mutex);
+	return NULL;
+}
+
+/************************************************************
+	the rootfs
+************************************************************/
+
+static bool SameFile(int fd1, int fd2)
+{
+	struct stat st1, st2;
+	return fstat(fd1,&st1)==0 && fstat(fd2,&st2)==0
+		&& st1.st_dev==st2.st_dev && st1.st_ino==st2.st_ino;
+}
+
+/*************************************************************************
+* OpenDir
+*
+* opens directory pszPath of the rootfs fdRoot, relative to fdFrom, with
+* symlinks followed as the firmware would: absolute ones from fdRoot,
+* and .. never above it.  With bCreate, missing directories are made.
+*
+**************************************************************************/
+int OpenDir(int fdRoot, int fdFrom, const char *pszPath, bool bCreate, int nDepth)
+{
+	char szPath[FMK_PATH_LEN], *pszSave=NULL;
+
+	if(nDepth>FMK_LINK_DEPTH)
+	{
+		errno=ELOOP;
+		return -1;
+	}
+	snprintf(szPath,sizeof(szPath),"%s",pszPath);
+	int fd=dup(szPath[0]=='/' ? fdRoot : fdFrom);
+
+	for(char *psz=strtok_r(szPath,"/",&pszSave);fd>=0 && psz;psz=strtok_r(NULL,"/",&pszSave))
+	{
+		int fdNext;
+
+		if(!strcmp(psz,".")) continue;
+		if(!strcmp(psz,".."))
+		{
+			fdNext=SameFile(fd,fdRoot) ? dup(fd) : openat(fd,"..",O_RDONLY|O_DIRECTORY);
+		}
+		else
+		{
+			fdNext=openat(fd,psz,O_RDONLY|O_DIRECTORY|O_NOFOLLOW);
+			if(fdNext<0 && errno==ENOENT && bCreate
+				&& (mkdirat(fd,psz,0755)==0 || errno==EEXIST))
+			{
+				fdNext=openat(fd,psz,O_RDONLY|O_DIRECTORY|O_NOFOLLOW);
+			}
+			if(fdNext<0 && (errno==ELOOP || errno==ENOTDIR))
+			{
+				char szLink[FMK_PATH_LEN];
+				ssize_t nLink=readlinkat(fd,psz,szLink,sizeof(szLink)-1);
+				if(nLink>=0)
+				{
+					szLink[nLink]='\0';
+					fdNext=OpenDir(fdRoot,fd,szLink,bCreate,nDepth+1);
+				}
+				else errno=ENOTDIR;
+			}
+		}
+		int nErrno=errno;
+		close(fd);
+		errno=nErrno;
+		fd=fdNext;
+	}
+	return fd;
+}
+
+/* splits a member name into its parent directory and last component */
+static void SplitPath(const char *pszName, char *pszParent, char *pszLeaf)
+{
+	char szName[FMK_PATH_LEN];
+	snprintf(szName,sizeof(szName),"%s",MemberName(pszName));
+	size_t nName=strlen(szName);
+	while(nName && szName[nName-1]=='/') szName[--nName]='\0';
+
+	char *pszSlash=strrchr(szName,'/');
+	if(pszSlash)
+	{
+		*pszSlash='\0';
+		strcpy(pszParent,szName);
+		strcpy(pszLeaf,pszSlash+1);
+	}
+	else
+	{
+		pszParent[0]='\0';
+		strcpy(pszLeaf,szName);
+	}
+}
+
+/* writes all of p to fd */
+static bool WriteAll(int fd, const unsigned char *p, size_t nLength)
+{
+	while(nLength)
+	{
+		ssize_t nDone=write(fd,p,nLength);
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0) return false;
+		p+=nDone;
+		nLength-=nDone;
+	}
+	return true;
+}
+
+/* the mode and owner of an entry, applied where only root may apply all of it */
+static void SetAttributes(int fdDir, const char *pszLeaf, const TAR_ENTRY *pEntry)
+{
+	struct timespec times[2];
+
+	if(g_bRoot) fchownat(fdDir,pszLeaf,pEntry->nUid,pEntry->nGid,AT_SYMLINK_NOFOLLOW);
+	if(pEntry->cType!='2') fchmodat(fdDir,pszLeaf,pEntry->nMode&07777,0);
+	times[0].tv_sec=times[1].tv_sec=pEntry->nMtime;
+	times[0].tv_nsec=times[1].tv_nsec=0;
+	utimensat(fdDir,pszLeaf,times,AT_SYMLINK_NOFOLLOW);
+}
+
+/*************************************************************************
+* InstallEntry
+*
+* creates one tar entry in directory fdDir, replacing whatever is there,
+* except that a directory already there, or a symlink to one, is kept
+*
+**************************************************************************/
+bool InstallEntry(int fdRoot, int fdDir, const char *pszLeaf, const TAR_ENTRY *pEntry)
+{
+	struct stat st;
+	bool bExists=fstatat(fdDir,pszLeaf,&st,AT_SYMLINK_NOFOLLOW)==0;
+
+	if(pEntry->cType=='5')
+	{
+		if(bExists && (S_ISDIR(st.st_mode) || S_ISLNK(st.st_mode))) return true;
+		if(bExists) unlinkat(fdDir,pszLeaf,0);
+		if(mkdirat(fdDir,pszLeaf,0755)<0) return false;
+		SetAttributes(fdDir,pszLeaf,pEntry);
+		return true;
+	}
+
+	if(bExists && unlinkat(fdDir,pszLeaf,S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0)<0)
+	{
+		return false;
+	}
+
+	switch(pEntry->cType)
+	{
+	case '0':
+	case '7':
+	{
+		int fd=openat(fdDir,pszLeaf,O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW,0600);
+		if(fd<0) return false;
+		bool bOk=WriteAll(fd,pEntry->pData,pEntry->nSize);
+		if(close(fd) || !bOk) return false;
+		break;
+	}
+	case '1':
+	{
+		char szParent[FMK_PATH_LEN], szLeaf[FMK_PATH_LEN];
+		SplitPath(pEntry->szLink,szParent,szLeaf);
+		int fdTarget=OpenDir(fdRoot,fdRoot,szParent,false,0);
+		bool bOk=fdTarget>=0 && linkat(fdTarget,szLeaf,fdDir,pszLeaf,0)==0;
+		if(fdTarget>=0) close(fdTarget);
+		return bOk;
+	}
+	case '2':
+		if(symlinkat(pEntry->szLink,fdDir,pszLeaf)<0) return false;
+		break;
+	case '3':
+	case '4':
+	case '6':
+		if(mknodat(fdDir,pszLeaf,(pEntry->cType=='3' ? S_IFCHR : pEntry->cType=='4' ? S_IFBLK : S_IFIFO)
+			|(pEntry->nMode&0777),makedev(pEntry->nMajor,pEntry->nMinor))<0)
+		{
+			return false;
+		}
+		break;
+	default:
+		errno=EINVAL;
+		return false;
+	}
+	SetAttributes(fdDir,pszLeaf,pEntry);
+	return true;
+}
+
+/*************************************************************************
+* InstallPackage
+*
+* unpacks the data.tar of a package into the rootfs and lists what it
+* put there
+*
+**************************************************************************/
+bool InstallPackage(int fdRoot, PACKAGE *pPackage)
+{
+	char szDir[FMK_PATH_LEN]="", szParent[FMK_PATH_LEN], szLeaf[FMK_PATH_LEN];
+	TAR_ENTRY entry;
+	size_t nOffset=0;
+	int fdDir=-1, nFiles=0, nFailed=0, nRet;
+
+	FILE *fList=fopen(pPackage->szList,"w");
+	if(!fList)
+	{
+		fprintf(stderr, " ERROR creating %s: %s\n", pPackage->szList, strerror(errno));
+		return false;
+	}
+
+	while((nRet=TarNext(pPackage->pData,pPackage->nData,&nOffset,&entry))==1)
+	{
+		SplitPath(entry.szName,szParent,szLeaf);
+		if(!szLeaf[0] || !strcmp(szLeaf,".") || !strcmp(szLeaf,"..")) continue;
+
+		/* entries mostly follow others in the same directory */
+		if(fdDir<0 || strcmp(szParent,szDir))
+		{
+			if(fdDir>=0) close(fdDir);
+			strcpy(szDir,szParent);
+			fdDir=OpenDir(fdRoot,fdRoot,szParent,true,0);
+		}
+		if(fdDir<0 || !InstallEntry(fdRoot,fdDir,szLeaf,&entry))
+		{
+			fprintf(stderr, " ERROR installing %s: %s\n", MemberName(entry.szName), strerror(errno));
+			nFailed++;
+		}
+		else
+		{
+			fprintf(fList,"%s%s%s%s\n",szParent,szParent[0] ? "/" : "",szLeaf,
+				entry.cType=='5' ? "/" : "");
+			nFiles++;
+		}
+
+		/* a new directory or link may change what a path resolves to */
+		if(entry.cType!='0' && entry.cType!='7' && fdDir>=0)
+		{
+			close(fdDir);
+			fdDir=-1;
+		}
+	}
+	if(fdDir>=0) close(fdDir);
+	if(nRet<0)
+	{
+		fprintf(stderr, " ERROR: data.tar.gz of %s is damaged\n", pPackage->szName);
+		nFailed++;
+	}
+
+	if(fclose(fList))
+	{
+		fprintf(stderr, " ERROR writing %s\n", pPackage->szList);
+		nFailed++;
+	}
+	printf(" %d file(s) installed\n", nFiles);
+	return !nFailed;
+}
+
+/* the list of a package that wasn't installed by us, from its data.tar */
+static bool ListPackage(PACKAGE *pPackage)
+{
+	TAR_ENTRY entry;
+	size_t nOffset=0;
+
+	FILE *fList=fopen(pPackage->szList,"w");
+	if(!fList) return false;
+	while(TarNext(pPackage->pData,pPackage->nData,&nOffset,&entry)==1)
+	{
+		fprintf(fList,"%s\n",MemberName(entry.szName));
+	}
+	return fclose(fList)==0;
+}
+
+static int CompareReverse(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)b,*(char * const *)a);
+}
+
+/*************************************************************************
+* RemovePackage
+*
+* deletes the files of a package's list, then its directories deepest
+* first, those that are left empty
+*
+**************************************************************************/
+bool RemovePackage(int fdRoot, PACKAGE *pPackage)
+{
+	char szLine[FMK_PATH_LEN], szParent[FMK_PATH_LEN], szLeaf[FMK_PATH_LEN];
+	char **ppDirs=NULL;
+	int nDirs=0, nFiles=0;
+
+	if(!pPackage->bListed && !ListPackage(pPackage))
+	{
+		fprintf(stderr, " ERROR writing %s\n", pPackage->szList);
+		return false;
+	}
+	FILE *fList=fopen(pPackage->szList,"r");
+	if(!fList)
+	{
+		fprintf(stderr, " ERROR reading %s: %s\n", pPackage->szList, strerror(errno));
+		return false;
+	}
+
+	while(fgets(szLine,sizeof(szLine),fList))
+	{
+		size_t nLine=strlen(szLine);
+		if(nLine && szLine[nLine-1]=='\n') szLine[--nLine]='\0';
+		if(!nLine) continue;
+		if(szLine[nLine-1]=='/')
+		{
+			ppDirs=(char **)realloc(ppDirs,(nDirs+1)*sizeof(char *));
+			ppDirs[nDirs++]=strdup(szLine);
+			continue;
+		}
+
+		SplitPath(szLine,szParent,szLeaf);
+		int fdDir=OpenDir(fdRoot,fdRoot,szParent,false,0);
+		if(fdDir>=0 && unlinkat(fdDir,szLeaf,0)==0)
+		{
+			nFiles++;
+		}
+		else if(errno!=ENOENT)
+		{
+			fprintf(stderr, " ERROR removing %s: %s\n", szLine, strerror(errno));
+		}
+		if(fdDir>=0) close(fdDir);
+	}
+	fclose(fList);
+
+	/* children sort after their parents */
+	qsort(ppDirs,nDirs,sizeof(char *),CompareReverse);
+	for(int nI=0;nI<nDirs;nI++)
+	{
+		SplitPath(ppDirs[nI],szParent,szLeaf);
+		int fdDir=OpenDir(fdRoot,fdRoot,szParent,false,0);
+		if(fdDir>=0)
+		{
+			unlinkat(fdDir,szLeaf,AT_REMOVEDIR);
+			close(fdDir);
+		}
+		free(ppDirs[nI]);
+	}
+	free(ppDirs);
+
+	unlink(pPackage->szList);
+	printf(" %d file(s) removed\n", nFiles);
+	return true;
+}
+
+/* prints the control file, for the dependencies to be checked by hand */
+static void ShowControl(PACKAGE *pPackage)
+{
+	const unsigned char *p;
+	size_t n;
+
+	if(pPackage->pControl && TarFind(pPackage->pControl,pPackage->nControl,"control",&p,&n))
+	{
+		printf(" --------------------------------------------\n");
+		fwrite(p,1,n,stdout);
+		printf(" --------------------------------------------\n");
+	}
+}
+
+/************************************************************
+	main
+************************************************************/
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-ipkg [-j jobs] install|remove WORKING_DIRECTORY package.ipk...\n"
+		"  installs the packages into WORKING_DIRECTORY/rootfs, in order, or\n"
+		"  removes the files they installed, listed in\n"
+		"  WORKING_DIRECTORY/installed_packages/<package>.list\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	char szPath[FMK_PATH_LEN];
+	int nJobs=(int)sysconf(_SC_NPROCESSORS_ONLN), nArg=1, nFailed=0;
+
+	if(argc>2 && !strcmp(argv[1],"-j"))
+	{
+		nJobs=atoi(argv[2]);
+		nArg+=2;
+	}
+	if(argc<nArg+3 || nJobs<1)
+	{
+		ShowUsage();
+	}
+	bool bInstall=!strcmp(argv[nArg],"install");
+	if(!bInstall && strcmp(argv[nArg],"remove"))
+	{
+		ShowUsage();
+	}
+	const char *pszDir=argv[nArg+1];
+
+	snprintf(szPath,sizeof(szPath),"%s/rootfs",pszDir);
+	int fdRoot=open(szPath,O_RDONLY|O_DIRECTORY);
+	if(fdRoot<0)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", szPath, strerror(errno));
+		return 1;
+	}
+	snprintf(szPath,sizeof(szPath),"%s/installed_packages",pszDir);
+	mkdir(szPath,0755);
+	g_bRoot=geteuid()==0;
+
+	g_nPackages=argc-nArg-2;
+	g_pPackages=(PACKAGE *)calloc(g_nPackages,sizeof(PACKAGE));
+	for(int nI=0;nI<g_nPackages;nI++)
+	{
+		PACKAGE *pPackage=&g_pPackages[nI];
+		const char *pszBase=strrchr(argv[nArg+2+nI],'/');
+		pPackage->pszPath=argv[nArg+2+nI];
+		snprintf(pPackage->szName,FMK_NAME_LEN,"%s",pszBase ? pszBase+1 : pPackage->pszPath);
+		size_t nName=strlen(pPackage->szName);
+		if(nName>4 && !strcmp(pPackage->szName+nName-4,".ipk")) pPackage->szName[nName-4]='\0';
+		snprintf(pPackage->szList,sizeof(pPackage->szList),"%s/%s.list",szPath,pPackage->szName);
+		pPackage->bListed=!bInstall && access(pPackage->szList,R_OK)==0;
+	}
+
+	if(nJobs>g_nPackages) nJobs=g_nPackages;
+	g_nAhead=nJobs;
+	pthread_t *pThreads=(pthread_t *)malloc(nJobs*sizeof(pthread_t));
+	for(int nI=0;nI<nJobs;nI++)
+	{
+		pthread_create(&pThreads[nI],NULL,ReadThread,NULL);
+	}
+
+	for(int nI=0;nI<g_nPackages;nI++)
+	{
+		PACKAGE *pPackage=&g_pPackages[nI];
+
+		pthread_mutex_lock(&g_mutex);
+		while(!pPackage->bRead) pthread_cond_wait(&g_cond,&g_mutex);
+		pthread_mutex_unlock(&g_mutex);
+
+		printf(" %s %s\n", bInstall ? "Installing" : "Removing", pPackage->szName);
+		if(pPackage->pszError)
+		{
+			fprintf(stderr, " ERROR: %s %s\n", pPackage->pszPath, pPackage->pszError);
+			nFailed++;
+		}
+		else
+		{
+			ShowControl(pPackage);
+			if(!(bInstall ? InstallPackage(fdRoot,pPackage) : RemovePackage(fdRoot,pPackage)))
+			{
+				nFailed++;
+			}
+		}
+		fflush(stdout);
+		free(pPackage->pData);
+		free(pPackage->pControl);
+
+		pthread_mutex_lock(&g_mutex);
+		g_nDone++;
+		pthread_cond_broadcast(&g_cond);
+		pthread_mutex_unlock(&g_mutex);
+	}
+
+	for(int nI=0;nI<nJobs;nI++)
+	{
+		pthread_join(pThreads[nI],NULL);
+	}
+	close(fdRoot);
+	if(nFailed)
+	{
+		fprintf(stderr, " %d of %d package(s) failed\n", nFailed, g_nPackages);
+		return 1;
+	}
+	return 0;
+}
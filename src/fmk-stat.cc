@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-stat.cc
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * Runs a command and appends what it cost, as one line of JSON, to a
+ * file: wall clock, user and system time, peak RSS and I/O counters, for
+ * the command and everything it waited for.  benchmark-firmware.sh runs
+ * every stage under it.  The I/O counters come from /proc/<pid>/io,
+ * read while the exited command is still a zombie, so they cover the
+ * bytes its processes read and wrote even when the page cache meant no
+ * block was read from disk; the block counts from rusage are there too.
+ */
+
+#define FMK_LINE_LEN	256
+
+typedef struct _IO_COUNTERS
+{
+	unsigned long long nReadChars;
+	unsigned long long nWriteChars;
+	unsigned long long nReadBytes;
+	unsigned long long nWriteBytes;
+} IO_COUNTERS;
+
+/*************************************************************************
+* ReadIo
+*
+* reads the I/O counters of a process, leaving them zero where the
+* kernel has no task I/O accounting
+*
+**************************************************************************/
+void ReadIo(pid_t pid, IO_COUNTERS *pIo)
+{
+	char szLine[FMK_LINE_LEN];
+	memset(pIo,0,sizeof(IO_COUNTERS));
+
+	snprintf(szLine,sizeof(szLine),"/proc/%d/io",(int)pid);
+	FILE *fIo=fopen(szLine,"r");
+	if(!fIo) return;
+	while(fgets(szLine,sizeof(szLine),fIo))
+	{
+		unsigned long long nValue;
+		if(sscanf(szLine,"rchar: %llu",&nValue)==1) pIo->nReadChars=nValue;
+		else if(sscanf(szLine,"wchar: %llu",&nValue)==1) pIo->nWriteChars=nValue;
+		else if(sscanf(szLine,"read_bytes: %llu",&nValue)==1) pIo->nReadBytes=nValue;
+		else if(sscanf(szLine,"write_bytes: %llu",&nValue)==1) pIo->nWriteBytes=nValue;
+	}
+	fclose(fIo);
+}
+
+/* prints s as a JSON string */
+void PrintString(FILE *fOut, const char *s)
+{
+	fputc('"',fOut);
+	for(;*s;s++)
+	{
+		if(*s=='"' || *s=='\\') fprintf(fOut,"\\%c",*s);
+		else if((unsigned char)*s<' ') fprintf(fOut,"\\u%04x",*s);
+		else fputc(*s,fOut);
+	}
+	fputc('"',fOut);
+}
+
+double Seconds(const struct timeval *pTv)
+{
+	return pTv->tv_sec+pTv->tv_usec/1e6;
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-stat [-o file] [-n name] command [args...]\n"
+		"  runs command and appends its wall, user and system seconds,\n"
+		"  peak RSS and I/O counters to file, or stderr, as a line of\n"
+		"  JSON named name.  Exits with the command's status.\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	const char *pszOut=NULL;
+	const char *pszName="";
+	int nOpt;
+
+	while((nOpt=getopt(argc,argv,"+o:n:"))!=-1)
+	{
+		switch(nOpt)
+		{
+			case 'o':
+				pszOut=optarg;
+				break;
+			case 'n':
+				pszName=optarg;
+				break;
+			default:
+				ShowUsage();
+		}
+	}
+	if(optind>=argc)
+	{
+		ShowUsage();
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	pid_t pid=fork();
+	if(pid<0)
+	{
+		fprintf(stderr, " ERROR forking: %s\n", strerror(errno));
+		return 1;
+	}
+	if(!pid)
+	{
+		execvp(argv[optind],argv+optind);
+		fprintf(stderr, " ERROR running %s: %s\n", argv[optind], strerror(errno));
+		_exit(127);
+	}
+
+	/* wait without reaping, so /proc still has the command's counters */
+	siginfo_t info;
+	while(waitid(P_PID,pid,&info,WEXITED|WNOWAIT)<0 && errno==EINTR);
+	clock_gettime(CLOCK_MONOTONIC,&end);
+
+	IO_COUNTERS io;
+	ReadIo(pid,&io);
+
+	int nStatus;
+	struct rusage usage;
+	while(wait4(pid,&nStatus,0,&usage)<0)
+	{
+		if(errno!=EINTR)
+		{
+			fprintf(stderr, " ERROR waiting for %s: %s\n", argv[optind], strerror(errno));
+			return 1;
+		}
+	}
+	int nExit=WIFEXITED(nStatus) ? WEXITSTATUS(nStatus) : 128+WTERMSIG(nStatus);
+
+	FILE *fOut=pszOut ? fopen(pszOut,"a") : stderr;
+	if(!fOut)
+	{
+		fprintf(stderr, " ERROR opening %s: %s\n", pszOut, strerror(errno));
+		return 1;
+	}
+	fprintf(fOut,"{\"name\": ");
+	PrintString(fOut,pszName);
+	fprintf(fOut,", \"status\": %d, \"wall\": %.3f, \"user\": %.3f, \"sys\": %.3f, "
+		"\"maxrss_kb\": %ld, \"inblock\": %ld, \"oublock\": %ld, "
+		"\"rchar\": %llu, \"wchar\": %llu, \"read_bytes\": %llu, \"write_bytes\": %llu}\n",
+		nExit,(end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9,
+		Seconds(&usage.ru_utime),Seconds(&usage.ru_stime),usage.ru_maxrss,
+		usage.ru_inblock,usage.ru_oublock,io.nReadChars,io.nWriteChars,
+		io.nReadBytes,io.nWriteBytes);
+	if(pszOut) fclose(fOut);
+
+	return nExit;
+}
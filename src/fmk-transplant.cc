@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-transplant.cc
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+
+#include "fmkpool/fmkpool.h"
+
+/*
+ * Copies a directory tree as cp -a would, for transplant-firmware.sh.
+ * Each file is first cloned (FICLONE), which on btrfs, XFS and the like
+ * shares the data until either copy is written.  Files that can't be
+ * cloned are queued and copied as tasks of the thread pool, a thread per
+ * CPU (see fmkpool/fmkpool.h), with copy_file_range, which the kernel may
+ * still do without passing the data through here.
+ * Hard links within the tree are kept as such.
+ */
+
+#define FMK_PATH_LEN		4096
+#define FMK_COPY_THREADS	16
+#define FMK_COPY_BUF		0x10000
+
+typedef struct _COPY_JOB
+{
+	char *pszSrc;
+	char *pszDest;
+	struct stat st;
+} COPY_JOB;
+
+typedef struct _LINK_ENTRY
+{
+	dev_t nDev;
+	ino_t nIno;
+	char *pszDest;
+} LINK_ENTRY;
+
+static struct
+{
+	COPY_JOB *pJobs;
+	size_t nJobs, nAlloc;
+	COPY_JOB *pDirs;		/* directories, children first */
+	size_t nDirs, nDirAlloc;
+	LINK_ENTRY *pLinks;
+	size_t nLinks, nLinkAlloc;
+	dev_t nDestDev;
+	ino_t nDestIno;
+	size_t nCloned;
+	bool bFailed;
+	pthread_mutex_t lock;
+} g_Tree={NULL,0,0,NULL,0,0,NULL,0,0,0,0,0,false,PTHREAD_MUTEX_INITIALIZER};
+
+static void Fail(const char *pszWhat, const char *pszPath)
+{
+	fprintf(stderr, " ERROR %s %s: %s\n", pszWhat, pszPath, strerror(errno));
+	g_Tree.bFailed=true;
+}
+
+static bool Append(COPY_JOB **ppList, size_t *pnCount, size_t *pnAlloc,
+	const char *pszSrc, const char *pszDest, const struct stat &st)
+{
+	if(*pnCount==*pnAlloc)
+	{
+		size_t nAlloc=*pnAlloc ? *pnAlloc*2 : 256;
+		COPY_JOB *pList=(COPY_JOB *)realloc(*ppList,nAlloc*sizeof(COPY_JOB));
+		if(!pList) return false;
+		*ppList=pList;
+		*pnAlloc=nAlloc;
+	}
+
+	COPY_JOB *pJob=&(*ppList)[*pnCount];
+	pJob->pszSrc=strdup(pszSrc);
+	pJob->pszDest=strdup(pszDest);
+	pJob->st=st;
+	if(!pJob->pszSrc || !pJob->pszDest) return false;
+	(*pnCount)++;
+	return true;
+}
+
+/*************************************************************************
+* SetMeta
+*
+* sets the owner, mode and times of a copy; ownership is only kept when
+* run as root, as with cp -a
+*
+**************************************************************************/
+static void SetMeta(const char *pszDest, const struct stat &st)
+{
+	struct timespec times[2]={st.st_atim,st.st_mtim};
+
+	if(lchown(pszDest,st.st_uid,st.st_gid)<0 && errno!=EPERM)
+	{
+		Fail("setting the owner of",pszDest);
+	}
+	/* after chown, which clears setuid; links have no mode of their own */
+	if(!S_ISLNK(st.st_mode) && chmod(pszDest,st.st_mode&07777)<0)
+	{
+		Fail("setting the mode of",pszDest);
+	}
+	if(utimensat(AT_FDCWD,pszDest,times,AT_SYMLINK_NOFOLLOW)<0)
+	{
+		Fail("setting the times of",pszDest);
+	}
+}
+
+/*************************************************************************
+* CopyData
+*
+* copies nSize bytes between two files, in the kernel where it can
+*
+**************************************************************************/
+static bool CopyData(int fdIn, int fdOut, off_t nSize)
+{
+	bool bKernel=true;
+	char buf[FMK_COPY_BUF];
+
+	while(nSize>0)
+	{
+		ssize_t nDone;
+		if(bKernel)
+		{
+			nDone=copy_file_range(fdIn,NULL,fdOut,NULL,nSize,0);
+			if(nDone<0 && (errno==ENOSYS || errno==EXDEV || errno==EINVAL ||
+				errno==EOPNOTSUPP))
+			{
+				bKernel=false;
+				continue;
+			}
+		}
+		else
+		{
+			nDone=read(fdIn,buf,nSize<FMK_COPY_BUF ? nSize : FMK_COPY_BUF);
+			if(nDone>0 && write(fdOut,buf,nDone)!=nDone) nDone=-1;
+		}
+
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0) return false;	/* the file shrank under us */
+		nSize-=nDone;
+	}
+	return true;
+}
+
+static void CopyFile(void *pArg)
+{
+	COPY_JOB *pJob=(COPY_JOB *)pArg;
+	int fdIn=open(pJob->pszSrc,O_RDONLY);
+	int fdOut=open(pJob->pszDest,O_WRONLY);
+	bool bOk=fdIn>=0 && fdOut>=0 && CopyData(fdIn,fdOut,pJob->st.st_size);
+	if(fdIn>=0) close(fdIn);
+	if(fdOut>=0 && close(fdOut)<0) bOk=false;
+
+	pthread_mutex_lock(&g_Tree.lock);
+	if(bOk) SetMeta(pJob->pszDest,pJob->st);
+	else Fail("copying",pJob->pszSrc);
+	pthread_mutex_unlock(&g_Tree.lock);
+}
+
+/*************************************************************************
+* CreateFile
+*
+* creates the copy of a regular file, linking it to an earlier copy of
+* the same inode, or cloning it; anything else is queued for CopyFile
+*
+**************************************************************************/
+static void CreateFile(const char *pszSrc, const char *pszDest,
+	const struct stat &st)
+{
+	if(st.st_nlink>1)
+	{
+		for(size_t nL=0;nL<g_Tree.nLinks;nL++)
+		{
+			if(g_Tree.pLinks[nL].nDev==st.st_dev && g_Tree.pLinks[nL].nIno==st.st_ino)
+			{
+				if(link(g_Tree.pLinks[nL].pszDest,pszDest)<0) Fail("linking",pszDest);
+				return;
+			}
+		}
+		if(g_Tree.nLinks==g_Tree.nLinkAlloc)
+		{
+			size_t nAlloc=g_Tree.nLinkAlloc ? g_Tree.nLinkAlloc*2 : 64;
+			LINK_ENTRY *pLinks=(LINK_ENTRY *)realloc(g_Tree.pLinks,
+				nAlloc*sizeof(LINK_ENTRY));
+			if(pLinks)
+			{
+				g_Tree.pLinks=pLinks;
+				g_Tree.nLinkAlloc=nAlloc;
+			}
+		}
+		/* out of memory only costs the link */
+		if(g_Tree.nLinks<g_Tree.nLinkAlloc)
+		{
+			LINK_ENTRY *pLink=&g_Tree.pLinks[g_Tree.nLinks];
+			pLink->nDev=st.st_dev;
+			pLink->nIno=st.st_ino;
+			pLink->pszDest=strdup(pszDest);
+			if(pLink->pszDest) g_Tree.nLinks++;
+		}
+	}
+
+	int fdOut=open(pszDest,O_WRONLY|O_CREAT|O_EXCL,0600);
+	if(fdOut<0)
+	{
+		Fail("creating",pszDest);
+		return;
+	}
+
+	bool bCloned=false;
+#ifdef FICLONE
+	int fdIn=open(pszSrc,O_RDONLY);
+	if(fdIn<0)
+	{
+		Fail("opening",pszSrc);
+		close(fdOut);
+		return;
+	}
+	bCloned=st.st_size==0 || ioctl(fdOut,FICLONE,fdIn)==0;
+	close(fdIn);
+#endif
+	if(close(fdOut)<0)
+	{
+		Fail("creating",pszDest);
+		return;
+	}
+
+	if(bCloned)
+	{
+		g_Tree.nCloned++;
+		SetMeta(pszDest,st);
+	}
+	else if(!Append(&g_Tree.pJobs,&g_Tree.nJobs,&g_Tree.nAlloc,pszSrc,pszDest,st))
+	{
+		errno=ENOMEM;
+		Fail("queueing",pszSrc);
+	}
+}
+
+/*************************************************************************
+* CreateNode
+*
+* recreates pszSrc, and all below it, as pszDest
+*
+**************************************************************************/
+static void CreateNode(const char *pszSrc, const char *pszDest)
+{
+	struct stat st;
+
+	if(lstat(pszSrc,&st)<0)
+	{
+		Fail("reading",pszSrc);
+		return;
+	}
+
+	if(S_ISREG(st.st_mode))
+	{
+		CreateFile(pszSrc,pszDest,st);
+	}
+	else if(S_ISDIR(st.st_mode))
+	{
+		/* the copy of a tree into itself mustn't copy the copy */
+		if(st.st_dev==g_Tree.nDestDev && st.st_ino==g_Tree.nDestIno) return;
+
+		if(mkdir(pszDest,0700)<0)
+		{
+			Fail("creating",pszDest);
+			return;
+		}
+		if(!g_Tree.nDestIno)
+		{
+			struct stat stDest;
+			if(stat(pszDest,&stDest)==0)
+			{
+				g_Tree.nDestDev=stDest.st_dev;
+				g_Tree.nDestIno=stDest.st_ino;
+			}
+		}
+
+		DIR *pDir=opendir(pszSrc);
+		if(!pDir)
+		{
+			Fail("reading",pszSrc);
+			return;
+		}
+		struct dirent *pEntry;
+		while((pEntry=readdir(pDir)))
+		{
+			char szSrc[FMK_PATH_LEN], szDest[FMK_PATH_LEN];
+
+			if(!strcmp(pEntry->d_name,".") || !strcmp(pEntry->d_name,"..")) continue;
+			if(snprintf(szSrc,sizeof(szSrc),"%s/%s",pszSrc,pEntry->d_name)>=(int)sizeof(szSrc) ||
+				snprintf(szDest,sizeof(szDest),"%s/%s",pszDest,pEntry->d_name)>=(int)sizeof(szDest))
+			{
+				errno=ENAMETOOLONG;
+				Fail("reading",szSrc);
+				continue;
+			}
+			CreateNode(szSrc,szDest);
+		}
+		closedir(pDir);
+
+		/* set once its entries are made, which would change its mtime */
+		if(!Append(&g_Tree.pDirs,&g_Tree.nDirs,&g_Tree.nDirAlloc,pszSrc,pszDest,st))
+		{
+			errno=ENOMEM;
+			Fail("queueing",pszSrc);
+		}
+	}
+	else if(S_ISLNK(st.st_mode))
+	{
+		char szTarget[FMK_PATH_LEN];
+		ssize_t nTarget=readlink(pszSrc,szTarget,sizeof(szTarget)-1);
+		if(nTarget<0)
+		{
+			Fail("reading",pszSrc);
+			return;
+		}
+		szTarget[nTarget]='\0';
+		if(symlink(szTarget,pszDest)<0)
+		{
+			Fail("creating",pszDest);
+			return;
+		}
+		SetMeta(pszDest,st);
+	}
+	else
+	{
+		if(mknod(pszDest,st.st_mode,st.st_rdev)<0)
+		{
+			Fail("creating",pszDest);
+			return;
+		}
+		SetMeta(pszDest,st);
+	}
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-transplant src dest\n"
+		"  copies the tree src to dest, which mustn't exist, keeping\n"
+		"  owners, modes, times and hard links; file data is shared\n"
+		"  with src where the file system can clone it\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	if(argc!=3)
+	{
+		ShowUsage();
+	}
+
+	umask(0);
+	CreateNode(argv[1],argv[2]);
+
+	/* this thread copies files too while it waits */
+	if(g_Tree.nJobs)
+	{
+		size_t nThreads=fmk_pool_threads();
+		if(nThreads>FMK_COPY_THREADS) nThreads=FMK_COPY_THREADS;
+		if(nThreads>g_Tree.nJobs) nThreads=g_Tree.nJobs;
+
+		fmk_pool_group group;
+		fmk_pool_group_init(&group,fmk_pool_get(nThreads));
+		for(size_t nJob=0;nJob<g_Tree.nJobs;nJob++)
+		{
+			fmk_pool_submit(&group,CopyFile,&g_Tree.pJobs[nJob],FMK_POOL_NORMAL);
+		}
+		fmk_pool_wait(&group,0);
+	}
+
+	for(size_t nD=0;nD<g_Tree.nDirs;nD++)
+	{
+		SetMeta(g_Tree.pDirs[nD].pszDest,g_Tree.pDirs[nD].st);
+	}
+
+	if(g_Tree.bFailed)
+	{
+		return 1;
+	}
+	printf(" %s: %lu files cloned, %lu copied\n", argv[2],
+		(unsigned long)g_Tree.nCloned, (unsigned long)g_Tree.nJobs);
+	return 0;
+}
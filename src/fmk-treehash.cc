@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmk-treehash.cc
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "crcalc/md5.h"
+
+/*
+ * Prints a Merkle hash of a directory tree, which build-firmware.sh keys
+ * its file system cache on.  Every node is hashed over its type, mode,
+ * owner, mtime and device number, all of which end up on the image,
+ * followed by its contents: the data of a file, the target of a link,
+ * or the names and hashes of the entries of a directory, in byte order
+ * so the locale can't change it.
+ */
+
+#define FMK_PATH_LEN	4096
+#define FMK_MD5_LEN	16
+#define FMK_CHUNK_LEN	0x40000000	/* md5_append takes an int */
+
+static void Md5Append(md5_state_t *pState, const void *p, size_t nLength)
+{
+	const md5_byte_t *pb=(const md5_byte_t *)p;
+	while(nLength)
+	{
+		int nChunk=nLength>FMK_CHUNK_LEN ? FMK_CHUNK_LEN : (int)nLength;
+		md5_append(pState,pb,nChunk);
+		pb+=nChunk;
+		nLength-=nChunk;
+	}
+}
+
+static int CompareNames(const struct dirent **a, const struct dirent **b)
+{
+	return strcmp((*a)->d_name,(*b)->d_name);
+}
+
+static int SkipDots(const struct dirent *pEntry)
+{
+	return strcmp(pEntry->d_name,".") && strcmp(pEntry->d_name,"..");
+}
+
+/*************************************************************************
+* HashFile
+*
+* appends the data of a regular file, mapped rather than read
+*
+**************************************************************************/
+bool HashFile(md5_state_t *pState, const char *pszPath, size_t nSize)
+{
+	if(!nSize) return true;
+
+	int fd=open(pszPath,O_RDONLY);
+	if(fd<0) return false;
+	void *p=mmap(NULL,nSize,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(p==MAP_FAILED) return false;
+	madvise(p,nSize,MADV_SEQUENTIAL);
+	Md5Append(pState,p,nSize);
+	munmap(p,nSize);
+	return true;
+}
+
+/*************************************************************************
+* HashNode
+*
+* the hash of pszPath and, for a directory, all below it
+*
+**************************************************************************/
+bool HashNode(const char *pszPath, md5_byte_t digest[FMK_MD5_LEN])
+{
+	struct stat st;
+	char szMeta[128];
+	md5_state_t state;
+	bool bOk=true;
+
+	if(lstat(pszPath,&st)<0)
+	{
+		fprintf(stderr, " ERROR reading %s: %s\n", pszPath, strerror(errno));
+		return false;
+	}
+
+	md5_init(&state);
+	int nMeta=snprintf(szMeta,sizeof(szMeta),"%o %u %u %ld %lx %lu",
+		(unsigned)st.st_mode,(unsigned)st.st_uid,(unsigned)st.st_gid,
+		(long)st.st_mtime,(unsigned long)st.st_rdev,
+		(unsigned long)(S_ISREG(st.st_mode) ? st.st_size : 0));
+	Md5Append(&state,szMeta,nMeta+1);
+
+	if(S_ISREG(st.st_mode))
+	{
+		bOk=HashFile(&state,pszPath,st.st_size);
+	}
+	else if(S_ISLNK(st.st_mode))
+	{
+		char szTarget[FMK_PATH_LEN];
+		ssize_t nTarget=readlink(pszPath,szTarget,sizeof(szTarget));
+		bOk=nTarget>=0;
+		if(bOk) Md5Append(&state,szTarget,nTarget);
+	}
+	else if(S_ISDIR(st.st_mode))
+	{
+		struct dirent **ppEntries;
+		int nEntries=scandir(pszPath,&ppEntries,SkipDots,CompareNames);
+		bOk=nEntries>=0;
+		for(int nI=0;nI<nEntries;nI++)
+		{
+			char szChild[FMK_PATH_LEN];
+			md5_byte_t child[FMK_MD5_LEN];
+
+			if(bOk)
+			{
+				snprintf(szChild,sizeof(szChild),"%s/%s",pszPath,
+					ppEntries[nI]->d_name);
+				bOk=HashNode(szChild,child);
+			}
+			if(bOk)
+			{
+				Md5Append(&state,ppEntries[nI]->d_name,
+					strlen(ppEntries[nI]->d_name)+1);
+				Md5Append(&state,child,FMK_MD5_LEN);
+			}
+			free(ppEntries[nI]);
+		}
+		if(nEntries>=0) free(ppEntries);
+	}
+
+	if(!bOk)
+	{
+		fprintf(stderr, " ERROR reading %s\n", pszPath);
+		return false;
+	}
+	md5_finish(&state,digest);
+	return true;
+}
+
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fmk-treehash dir\n"
+		"  prints a hash of dir covering the contents, names, modes,\n"
+		"  owners and mtimes of everything in it\n");
+	exit(9);
+}
+
+int main(int argc, char **argv)
+{
+	md5_byte_t digest[FMK_MD5_LEN];
+
+	if(argc!=2)
+	{
+		ShowUsage();
+	}
+	if(!HashNode(argv[1],digest))
+	{
+		return 1;
+	}
+	for(int nI=0;nI<FMK_MD5_LEN;nI++)
+	{
+		printf("%02x",digest[nI]);
+	}
+	printf("\n");
+	return 0;
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkindex.c
+ *
+ * The records behind fmkindex.h, and their segment at exit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fmkindex.h"
+
+#define FMK_INDEX_ZEROS		65536
+#define FMK_INDEX_CHUNK		0x40000000	/* md5_append takes an int */
+#define FMK_INDEX_ALIGN(n)	(((n) + 7) & ~(uint64_t) 7)
+
+int fmk_index = 0;
+
+static const char *index_path;
+
+/* the columns so far, records long, and the strings they point into */
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *hashes;
+static uint64_t *sizes;
+static uint32_t *modes, *paths;
+static uint32_t records, allocated;
+static char *strings;
+static uint64_t strings_size, strings_allocated;
+static uint32_t image_name, tool_name;
+
+
+/* called with index_mutex held, or before there are threads */
+static uint32_t add_string(const char *str)
+{
+	size_t len = strlen(str) + 1;
+	uint64_t offset = strings_size;
+
+	if(strings_size + len > strings_allocated) {
+		uint64_t size = strings_allocated ? strings_allocated * 2 :
+			65536;
+		char *new;
+
+		while(size < strings_size + len)
+			size *= 2;
+		new = realloc(strings, size);
+		if(new == NULL)
+			return (uint32_t) -1;
+		strings = new;
+		strings_allocated = size;
+	}
+
+	memcpy(strings + strings_size, str, len);
+	strings_size += len;
+	return offset;
+}
+
+
+static int grow_columns(void)
+{
+	uint32_t size = allocated ? allocated * 2 : 1024;
+	unsigned char *h = realloc(hashes, (size_t) size * FMK_INDEX_HASH_SIZE);
+	uint64_t *s;
+	uint32_t *m, *p;
+
+	if(h == NULL)
+		return 0;
+	hashes = h;
+	if((s = realloc(sizes, size * sizeof(uint64_t))) == NULL)
+		return 0;
+	sizes = s;
+	if((m = realloc(modes, size * sizeof(uint32_t))) == NULL)
+		return 0;
+	modes = m;
+	if((p = realloc(paths, size * sizeof(uint32_t))) == NULL)
+		return 0;
+	paths = p;
+	allocated = size;
+	return 1;
+}
+
+
+static int write_all(int fd, const void *buf, uint64_t len)
+{
+	const char *p = buf;
+
+	while(len) {
+		ssize_t res = write(fd, p, len);
+
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res <= 0)
+			return 0;
+		p += res;
+		len -= res;
+	}
+
+	return 1;
+}
+
+
+static void index_dump(void)
+{
+	static const char pad[8];
+	struct fmk_index_segment seg;
+	uint64_t offset;
+	int fd, ok;
+
+	if(records == 0)
+		return;
+
+	memset(&seg, 0, sizeof(seg));
+	memcpy(seg.magic, FMK_INDEX_MAGIC, FMK_INDEX_MAGIC_SIZE);
+	seg.version = FMK_INDEX_VERSION;
+	seg.records = records;
+	seg.image = image_name;
+	seg.tool = tool_name;
+	seg.hashes = offset = FMK_INDEX_ALIGN(sizeof(seg));
+	seg.sizes = offset = FMK_INDEX_ALIGN(offset + (uint64_t) records *
+		FMK_INDEX_HASH_SIZE);
+	seg.modes = offset = FMK_INDEX_ALIGN(offset + (uint64_t) records *
+		sizeof(uint64_t));
+	seg.paths = offset = FMK_INDEX_ALIGN(offset + (uint64_t) records *
+		sizeof(uint32_t));
+	seg.strings = offset = FMK_INDEX_ALIGN(offset + (uint64_t) records *
+		sizeof(uint32_t));
+	seg.strings_size = strings_size;
+	seg.size = FMK_INDEX_ALIGN(offset + strings_size);
+
+	fd = open(index_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(fd == -1) {
+		fprintf(stderr, "fmkindex: can't open %s\n", index_path);
+		return;
+	}
+
+	/* the whole segment under the lock, so those of other tools can't mix */
+	flock(fd, LOCK_EX);
+	ok = write_all(fd, &seg, sizeof(seg)) &&
+		write_all(fd, pad, seg.hashes - sizeof(seg)) &&
+		write_all(fd, hashes, (uint64_t) records * FMK_INDEX_HASH_SIZE)
+		&& write_all(fd, pad, seg.sizes - seg.hashes - (uint64_t)
+			records * FMK_INDEX_HASH_SIZE) &&
+		write_all(fd, sizes, (uint64_t) records * sizeof(uint64_t)) &&
+		write_all(fd, modes, (uint64_t) records * sizeof(uint32_t)) &&
+		write_all(fd, pad, seg.paths - seg.modes - (uint64_t) records *
+			sizeof(uint32_t)) &&
+		write_all(fd, paths, (uint64_t) records * sizeof(uint32_t)) &&
+		write_all(fd, pad, seg.strings - seg.paths - (uint64_t)
+			records * sizeof(uint32_t)) &&
+		write_all(fd, strings, strings_size) &&
+		write_all(fd, pad, seg.size - seg.strings - strings_size);
+	flock(fd, LOCK_UN);
+
+	if(!ok)
+		fprintf(stderr, "fmkindex: can't write %s\n", index_path);
+	close(fd);
+}
+
+
+void fmk_index_init(const char *tool, const char *image)
+{
+	char *path = getenv("FMK_INDEX"), *name = getenv("FMK_INDEX_IMAGE");
+
+	if(path == NULL || *path == '\0' || fmk_index)
+		return;
+
+	index_path = path;
+	image_name = add_string(name && *name ? name : image ? image : "-");
+	tool_name = add_string(tool);
+	if(image_name == (uint32_t) -1 || tool_name == (uint32_t) -1)
+		return;
+
+	fmk_index = 1;
+	atexit(index_dump);
+}
+
+
+void fmk_index_start(struct fmk_index_hash *hash)
+{
+	md5_init(&hash->md5);
+}
+
+
+void fmk_index_data(struct fmk_index_hash *hash, const void *data,
+	size_t bytes)
+{
+	const md5_byte_t *p = data;
+
+	while(bytes) {
+		int chunk = bytes > FMK_INDEX_CHUNK ? FMK_INDEX_CHUNK : bytes;
+
+		md5_append(&hash->md5, p, chunk);
+		p += chunk;
+		bytes -= chunk;
+	}
+}
+
+
+void fmk_index_zeros(struct fmk_index_hash *hash, long long bytes)
+{
+	static const md5_byte_t zeros[FMK_INDEX_ZEROS];
+
+	while(bytes > 0) {
+		int chunk = bytes > FMK_INDEX_ZEROS ? FMK_INDEX_ZEROS : bytes;
+
+		md5_append(&hash->md5, zeros, chunk);
+		bytes -= chunk;
+	}
+}
+
+
+/*
+ * Records the file the hash was of.  path is taken from the root of the
+ * file system, leading "./" and "/" or not, and any number of threads
+ * can add files
+ */
+void fmk_index_add(struct fmk_index_hash *hash, const char *path,
+	long long size, unsigned int mode)
+{
+	md5_byte_t digest[FMK_INDEX_HASH_SIZE];
+	char name[4096];
+	uint32_t offset;
+
+	md5_finish(&hash->md5, digest);
+
+	for(;;) {
+		if(path[0] == '/')
+			path ++;
+		else if(path[0] == '.' && path[1] == '/')
+			path += 2;
+		else
+			break;
+	}
+	if(snprintf(name, sizeof(name), "/%s", path) >= (int) sizeof(name))
+		return;
+
+	pthread_mutex_lock(&index_mutex);
+	if((records < allocated || grow_columns()) &&
+			(offset = add_string(name)) != (uint32_t) -1) {
+		memcpy(hashes + (size_t) records * FMK_INDEX_HASH_SIZE, digest,
+			FMK_INDEX_HASH_SIZE);
+		sizes[records] = size;
+		modes[records] = (mode & ~S_IFMT) | S_IFREG;
+		paths[records ++] = offset;
+	}
+	pthread_mutex_unlock(&index_mutex);
+}
+
+
+/*
+ * Records a file from what is on disk at pathname, for the files a tool
+ * didn't write itself, those an earlier run had written say
+ */
+int fmk_index_file(const char *pathname, const char *path, long long size,
+	unsigned int mode)
+{
+	struct fmk_index_hash hash;
+	struct stat buf;
+	void *map;
+	int fd;
+
+	fmk_index_start(&hash);
+	if(size) {
+		fd = open(pathname, O_RDONLY);
+		if(fd == -1)
+			return 0;
+		/* mapping past its end would fault */
+		if(fstat(fd, &buf) == -1 || buf.st_size != size) {
+			close(fd);
+			return 0;
+		}
+		map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(map == MAP_FAILED)
+			return 0;
+		fmk_index_data(&hash, map, size);
+		munmap(map, size);
+	}
+
+	fmk_index_add(&hash, path, size, mode);
+	return 1;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkindex.h
+ */
+
+#ifndef FMKINDEX_H
+#define FMKINDEX_H
+
+#include <stdint.h>
+
+#include "../crcalc/md5.h"
+
+/*
+ * The file content index of the extractors, unsquashfs, cramfsck,
+ * unyaffs2 and fmk-cpio.  A tool calling fmk_index_init() with
+ * FMK_INDEX=path set in its environment hashes each file as it writes
+ * it, from the data it already has in hand, e.g.
+ *
+ *	struct fmk_index_hash hash;
+ *
+ *	if(fmk_index)
+ *		fmk_index_start(&hash);
+ *	... fmk_index_data(&hash, block, bytes) as each block is written ...
+ *	if(fmk_index)
+ *		fmk_index_add(&hash, path, size, mode);
+ *
+ * and appends the records, the image, path, size, mode and MD5 of every
+ * file, to path as one segment when it exits.  The image is the tool's
+ * input, or FMK_INDEX_IMAGE when that is set, so extract-firmware.sh
+ * can name the firmware rather than rootfs.img.  fmk-index searches
+ * the index.  Without FMK_INDEX the hashing costs a test of fmk_index.
+ *
+ * A segment is a struct fmk_index_segment followed by its columns, each
+ * 8 byte aligned and at the offset from the segment's start the header
+ * gives: the hashes, sizes, modes and path offsets of the records in
+ * turn, then the strings the offsets point into.  Segments are appended
+ * whole under flock(), so any number of extractions can share an index,
+ * and a query maps the file and walks them, only touching the columns
+ * it tests.  Values are in the byte order of the host that wrote them.
+ */
+
+#define FMK_INDEX_MAGIC		"FMKINDEX"
+#define FMK_INDEX_MAGIC_SIZE	8
+#define FMK_INDEX_VERSION	1
+#define FMK_INDEX_HASH_SIZE	16
+
+struct fmk_index_segment {
+	char magic[FMK_INDEX_MAGIC_SIZE];	/* FMK_INDEX_MAGIC */
+	uint32_t version;			/* FMK_INDEX_VERSION */
+	uint32_t records;
+	uint64_t size;				/* of the segment, header and all */
+	uint32_t image;				/* string offsets of the image */
+	uint32_t tool;				/* and of the tool that wrote it */
+	uint64_t hashes;			/* [records][FMK_INDEX_HASH_SIZE] */
+	uint64_t sizes;				/* uint64_t [records] */
+	uint64_t modes;				/* uint32_t [records], as st_mode */
+	uint64_t paths;				/* uint32_t [records] offsets */
+	uint64_t strings;			/* NUL terminated, paths from / */
+	uint64_t strings_size;
+};
+
+struct fmk_index_hash {
+	md5_state_t md5;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int fmk_index;
+
+extern void fmk_index_init(const char *tool, const char *image);
+extern void fmk_index_start(struct fmk_index_hash *hash);
+extern void fmk_index_data(struct fmk_index_hash *hash, const void *data,
+	size_t bytes);
+extern void fmk_index_zeros(struct fmk_index_hash *hash, long long bytes);
+extern void fmk_index_add(struct fmk_index_hash *hash, const char *path,
+	long long size, unsigned int mode);
+extern int fmk_index_file(const char *pathname, const char *path,
+	long long size, unsigned int mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
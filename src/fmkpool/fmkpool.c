@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkpool.c
+ *
+ * The work stealing pool behind fmkpool.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+
+#include "fmkpool.h"
+
+#define FMK_POOL_MAX		256
+#define FMK_POOL_DEQUE		64		/* tasks, to start with */
+
+struct fmk_pool_task {
+	void (*fn)(void *);
+	void *arg;
+	struct fmk_pool_group *group;
+};
+
+/* a ring of tasks, pushed and popped at the tail, stolen at the head */
+struct fmk_pool_deque {
+	pthread_mutex_t lock;
+	struct fmk_pool_task *tasks;
+	unsigned head, count, size;
+};
+
+struct fmk_pool_worker {
+	struct fmk_pool *pool;
+	pthread_t thread;
+	int slot, node;
+	int *victims;			/* the other workers, nearest first */
+	struct fmk_pool_deque deque[FMK_POOL_PRIORITIES];
+};
+
+struct fmk_pool {
+	int workers;
+	struct fmk_pool_worker *worker;
+	unsigned next;			/* of the workers given outside tasks */
+
+	/*
+	 * Sleeping workers and waiters count themselves in idle and waiters
+	 * before they test queued and pending, and tasks are counted in
+	 * before those are tested, so neither side can miss the other
+	 */
+	pthread_mutex_t lock;
+	pthread_cond_t work;		/* a task was queued */
+	pthread_cond_t done;		/* a task was run */
+	long queued;
+	int idle, waiters;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct fmk_pool *pool_shared;
+static __thread int pool_slot = -1;
+
+
+int fmk_pool_threads(void)
+{
+	char *processors = getenv("FMK_PROCESSORS");
+	cpu_set_t set;
+	long cpus;
+
+	if(processors && atoi(processors) > 0)
+		return atoi(processors);
+
+	if(sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+		return CPU_COUNT(&set);
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? cpus : 1;
+}
+
+
+/* the node of cpu, from the nodeN link sysfs has in its directory */
+static int cpu_node(int cpu)
+{
+	char path[64];
+	struct dirent *entry;
+	DIR *dir;
+	int node = 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	dir = opendir(path);
+	if(dir == NULL)
+		return 0;
+	while((entry = readdir(dir)) != NULL)
+		if(sscanf(entry->d_name, "node%d", &node) == 1)
+			break;
+	closedir(dir);
+	return node;
+}
+
+
+/*
+ * Spreads the workers over the processors the process may use, a node at
+ * a time, so that workers next to each other share a node, and binds each
+ * to its node's processors when there is more than one node
+ */
+static void pool_layout(struct fmk_pool *pool)
+{
+	int cpu[CPU_SETSIZE], node[CPU_SETSIZE];
+	int cpus = 0, nodes = 0, i, j, k, n;
+	cpu_set_t set;
+
+	if(sched_getaffinity(0, sizeof(set), &set) == 0)
+		for(i = 0; i < CPU_SETSIZE; i++)
+			if(CPU_ISSET(i, &set)) {
+				cpu[cpus] = i;
+				node[cpus ++] = cpu_node(i);
+			}
+
+	/* sorted by node, keeping the order of the processors in each */
+	for(i = 1; i < cpus; i++)
+		for(j = i; j > 0 && node[j - 1] > node[j]; j--) {
+			n = node[j], node[j] = node[j - 1], node[j - 1] = n;
+			n = cpu[j], cpu[j] = cpu[j - 1], cpu[j - 1] = n;
+		}
+	for(i = 0; i < cpus; i++)
+		if(i == 0 || node[i] != node[i - 1])
+			nodes ++;
+
+	for(i = 0; i < pool->workers; i++)
+		pool->worker[i].node = cpus ? node[(long) i * cpus /
+			pool->workers] : 0;
+
+	/* the victims of each worker: its node's in turn after it, then the rest */
+	for(i = 0; i < pool->workers; i++) {
+		struct fmk_pool_worker *w = &pool->worker[i];
+
+		for(k = 0, j = 1; j < pool->workers; j++)
+			if(pool->worker[(i + j) % pool->workers].node == w->node)
+				w->victims[k ++] = (i + j) % pool->workers;
+		for(j = 1; j < pool->workers; j++)
+			if(pool->worker[(i + j) % pool->workers].node != w->node)
+				w->victims[k ++] = (i + j) % pool->workers;
+	}
+
+	if(nodes > 1)
+		for(i = 0; i < pool->workers; i++) {
+			CPU_ZERO(&set);
+			for(j = 0; j < cpus; j++)
+				if(node[j] == pool->worker[i].node)
+					CPU_SET(cpu[j], &set);
+			pthread_setaffinity_np(pool->worker[i].thread, sizeof(set),
+				&set);
+		}
+}
+
+
+static int deque_push(struct fmk_pool_deque *deque, struct fmk_pool_task *task)
+{
+	pthread_mutex_lock(&deque->lock);
+	if(deque->count == deque->size) {
+		unsigned size = deque->size ? deque->size * 2 : FMK_POOL_DEQUE, i;
+		struct fmk_pool_task *tasks = malloc(size * sizeof(*tasks));
+
+		if(tasks == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			return 0;
+		}
+		for(i = 0; i < deque->count; i++)
+			tasks[i] = deque->tasks[(deque->head + i) % deque->size];
+		free(deque->tasks);
+		deque->tasks = tasks;
+		deque->head = 0;
+		deque->size = size;
+	}
+	deque->tasks[(deque->head + deque->count ++) % deque->size] = *task;
+	pthread_mutex_unlock(&deque->lock);
+	return 1;
+}
+
+
+/* the newest task for the deque's worker, the oldest for a thief */
+static int deque_take(struct fmk_pool_deque *deque, struct fmk_pool_task *task,
+	int steal)
+{
+	int taken = 0;
+
+	/* racy, but a deque seen empty is looked at again before sleeping */
+	if(deque->count == 0)
+		return 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->count) {
+		if(steal) {
+			*task = deque->tasks[deque->head];
+			deque->head = (deque->head + 1) % deque->size;
+		} else
+			*task = deque->tasks[(deque->head + deque->count - 1) %
+				deque->size];
+		deque->count --;
+		taken = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return taken;
+}
+
+
+/* self is the worker looking, or NULL for a waiter, which only steals */
+static int pool_find(struct fmk_pool *pool, struct fmk_pool_worker *self,
+	struct fmk_pool_task *task)
+{
+	int priority, i;
+
+	for(priority = 0; priority < FMK_POOL_PRIORITIES; priority++) {
+		if(self) {
+			if(deque_take(&self->deque[priority], task, 0))
+				goto found;
+			for(i = 0; i < pool->workers - 1; i++)
+				if(deque_take(&pool->worker[self->victims[i]].
+						deque[priority], task, 1))
+					goto found;
+		} else
+			for(i = 0; i < pool->workers; i++)
+				if(deque_take(&pool->worker[i].deque[priority],
+						task, 1))
+					goto found;
+	}
+	return 0;
+
+found:
+	__sync_sub_and_fetch(&pool->queued, 1);
+	return 1;
+}
+
+
+static void pool_run(struct fmk_pool *pool, struct fmk_pool_task *task)
+{
+	task->fn(task->arg);
+
+	__sync_sub_and_fetch(&task->group->pending, 1);
+	if(__sync_add_and_fetch(&pool->waiters, 0)) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+
+static void *pool_worker(void *arg)
+{
+	struct fmk_pool_worker *self = arg;
+	struct fmk_pool *pool = self->pool;
+	struct fmk_pool_task task;
+
+	pool_slot = self->slot;
+
+	/* held by pool_create() until the layout is done */
+	pthread_mutex_lock(&pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(;;) {
+		if(pool_find(pool, self, &task)) {
+			pool_run(pool, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		__sync_add_and_fetch(&pool->idle, 1);
+		while(__sync_add_and_fetch(&pool->queued, 0) == 0)
+			pthread_cond_wait(&pool->work, &pool->lock);
+		__sync_sub_and_fetch(&pool->idle, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+
+static struct fmk_pool *pool_create(int threads)
+{
+	struct fmk_pool *pool = calloc(1, sizeof(*pool));
+	int i, j;
+
+	if(pool == NULL)
+		return NULL;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	if(threads > FMK_POOL_MAX)
+		threads = FMK_POOL_MAX;
+	pool->worker = calloc(threads, sizeof(struct fmk_pool_worker));
+	if(pool->worker == NULL)
+		return pool;
+
+	/* the thread waiting is the last of the threads */
+	pthread_mutex_lock(&pool->lock);
+	for(i = 0; i < threads - 1; i++) {
+		struct fmk_pool_worker *w = &pool->worker[i];
+
+		w->pool = pool;
+		w->slot = i;
+		w->victims = malloc(threads * sizeof(int));
+		if(w->victims == NULL)
+			break;
+		for(j = 0; j < FMK_POOL_PRIORITIES; j++)
+			pthread_mutex_init(&w->deque[j].lock, NULL);
+		if(pthread_create(&w->thread, NULL, pool_worker, w) != 0) {
+			free(w->victims);
+			break;
+		}
+		pool->workers ++;
+	}
+
+	pool_layout(pool);
+	pthread_mutex_unlock(&pool->lock);
+	return pool;
+}
+
+
+struct fmk_pool *fmk_pool_get(int threads)
+{
+	pthread_mutex_lock(&pool_mutex);
+	if(pool_shared == NULL)
+		pool_shared = pool_create(threads > 0 ? threads :
+			fmk_pool_threads());
+	pthread_mutex_unlock(&pool_mutex);
+	return pool_shared;
+}
+
+
+void fmk_pool_group_init(struct fmk_pool_group *group, struct fmk_pool *pool)
+{
+	group->pool = pool;
+	group->pending = 0;
+}
+
+
+void fmk_pool_submit(struct fmk_pool_group *group, void (*fn)(void *),
+	void *arg, int priority)
+{
+	struct fmk_pool *pool = group->pool;
+	struct fmk_pool_task task = { fn, arg, group };
+	struct fmk_pool_worker *w;
+
+	if(pool == NULL || pool->workers == 0) {
+		fn(arg);
+		return;
+	}
+	if(priority < 0 || priority >= FMK_POOL_PRIORITIES)
+		priority = FMK_POOL_NORMAL;
+
+	/* a worker's own tasks go on its deque, the rest are dealt round */
+	w = pool_slot >= 0 && pool_slot < pool->workers ?
+		&pool->worker[pool_slot] : &pool->worker[__sync_fetch_and_add(
+		&pool->next, 1) % pool->workers];
+
+	__sync_add_and_fetch(&group->pending, 1);
+	if(!deque_push(&w->deque[priority], &task)) {
+		__sync_sub_and_fetch(&group->pending, 1);
+		fn(arg);
+		return;
+	}
+
+	__sync_add_and_fetch(&pool->queued, 1);
+	if(__sync_add_and_fetch(&pool->idle, 0)) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_signal(&pool->work);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+
+void fmk_pool_wait(struct fmk_pool_group *group, long max)
+{
+	struct fmk_pool *pool = group->pool;
+	struct fmk_pool_worker *self;
+	struct fmk_pool_task task;
+
+	if(pool == NULL)
+		return;
+	self = pool_slot >= 0 && pool_slot < pool->workers ?
+		&pool->worker[pool_slot] : NULL;
+
+	while(__sync_add_and_fetch(&group->pending, 0) > max) {
+		if(pool_find(pool, self, &task)) {
+			pool_run(pool, &task);
+			continue;
+		}
+
+		/* the rest are being run, by workers that will say when */
+		pthread_mutex_lock(&pool->lock);
+		__sync_add_and_fetch(&pool->waiters, 1);
+		while(__sync_add_and_fetch(&group->pending, 0) > max &&
+				__sync_add_and_fetch(&pool->queued, 0) == 0)
+			pthread_cond_wait(&pool->done, &pool->lock);
+		__sync_sub_and_fetch(&pool->waiters, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+
+int fmk_pool_size(struct fmk_pool *pool)
+{
+	return pool ? pool->workers : 0;
+}
+
+
+int fmk_pool_slot(struct fmk_pool *pool)
+{
+	return pool_slot >= 0 && pool_slot < fmk_pool_size(pool) ? pool_slot :
+		fmk_pool_size(pool);
+}
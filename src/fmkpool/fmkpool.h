@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkpool.h
+ */
+
+#ifndef FMKPOOL_H
+#define FMKPOOL_H
+
+/*
+ * The one pool of worker threads of a tool, shared by all its stages so
+ * that a scan, the decompression and the writing of the files don't each
+ * start a thread per processor.  Work is submitted as tasks, each with a
+ * group whose tasks can be waited for, e.g.
+ *
+ *	struct fmk_pool_group group;
+ *
+ *	fmk_pool_group_init(&group, fmk_pool_get(threads));
+ *	for (each file)
+ *		fmk_pool_submit(&group, extract, file, FMK_POOL_NORMAL);
+ *	fmk_pool_wait(&group, 0);
+ *
+ * Every worker has a deque of tasks per priority: it runs its own newest
+ * first and, when it has none, steals the oldest of the others, those of
+ * workers on its own NUMA node before the rest.  High priority tasks are
+ * taken before any normal ones.  A thread in fmk_pool_wait() runs tasks
+ * too rather than sleep, so nested waits can't deadlock and a pool of
+ * threads - 1 workers keeps threads processors busy.
+ *
+ * The pool is made on the first fmk_pool_get(), with threads processors,
+ * or fmk_pool_threads() for 0, and lasts until the process exits.  On a
+ * machine of several nodes each worker is bound to the processors of its
+ * node.  A pool of one processor has no workers, and the tasks are run by
+ * fmk_pool_submit() itself.
+ */
+
+#define FMK_POOL_HIGH		0
+#define FMK_POOL_NORMAL		1
+#define FMK_POOL_PRIORITIES	2
+
+struct fmk_pool;
+
+struct fmk_pool_group {
+	struct fmk_pool *pool;
+	long pending;			/* tasks submitted and not yet run */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FMK_PROCESSORS if that is set, else the processors the process may use */
+extern int fmk_pool_threads(void);
+
+extern struct fmk_pool *fmk_pool_get(int threads);
+extern void fmk_pool_group_init(struct fmk_pool_group *group,
+	struct fmk_pool *pool);
+extern void fmk_pool_submit(struct fmk_pool_group *group,
+	void (*fn)(void *), void *arg, int priority);
+
+/* Returns when no more than max tasks of the group are left to run */
+extern void fmk_pool_wait(struct fmk_pool_group *group, long max);
+
+/*
+ * The workers and the slot, 0 up to fmk_pool_size(), of the calling
+ * thread, for the per thread buffers of tasks.  Threads that aren't
+ * workers share slot fmk_pool_size(), so a task the caller of
+ * fmk_pool_submit() or fmk_pool_wait() runs can only use its buffer when
+ * one thread submits and waits.
+ */
+extern int fmk_pool_size(struct fmk_pool *pool);
+extern int fmk_pool_slot(struct fmk_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
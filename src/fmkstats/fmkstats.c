@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkstats.c
+ *
+ * The counters behind fmkstats.h, and their JSON line at exit.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "fmkstats.h"
+
+#define FMK_COUNTERS		32
+#define FMK_LINE_SIZE		8192
+
+struct fmk_stage_stats {
+	long long calls;
+	long long bytes_in;
+	long long bytes_out;
+	long long usecs;
+};
+
+int fmk_stats = 0;
+
+static const char *stage_name[FMK_STAGES] = {
+	"scan", "carve", "decompress_block", "write_file", "compress_block",
+	"checksum"
+};
+
+static struct fmk_stage_stats stage_count[FMK_STAGES];
+
+/* names are claimed a slot at a time, so threads need no lock */
+static struct {
+	const char *name;
+	long long value;
+} counter[FMK_COUNTERS];
+
+static const char *stats_tool, *stats_path;
+static long long start_usecs;
+
+
+long long fmk_stats_usecs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+
+void fmk_stage_add(int stage, long long start, long long bytes_in,
+	long long bytes_out)
+{
+	struct fmk_stage_stats *s = &stage_count[stage];
+
+	__sync_fetch_and_add(&s->calls, 1);
+	__sync_fetch_and_add(&s->bytes_in, bytes_in);
+	__sync_fetch_and_add(&s->bytes_out, bytes_out);
+	__sync_fetch_and_add(&s->usecs, fmk_stats_usecs() - start);
+}
+
+
+void fmk_count(const char *name, long long value)
+{
+	int i;
+
+	for(i = 0; i < FMK_COUNTERS; i++) {
+		const char *n = counter[i].name;
+
+		if(n == NULL && __sync_bool_compare_and_swap(&counter[i].name,
+				NULL, name))
+			n = name;
+		else if(n == NULL)
+			n = counter[i].name;
+
+		if(n == name || strcmp(n, name) == 0) {
+			__sync_fetch_and_add(&counter[i].value, value);
+			return;
+		}
+	}
+}
+
+
+/*
+ * Append to the line at len.  Once the line is full len is left past its
+ * end, and the dump is dropped rather than written truncated
+ */
+static size_t stats_append(char *line, size_t len, const char *fmt, ...)
+{
+	va_list ap;
+	int res;
+
+	if(len >= FMK_LINE_SIZE)
+		return len;
+
+	va_start(ap, fmt);
+	res = vsnprintf(line + len, FMK_LINE_SIZE - len, fmt, ap);
+	va_end(ap);
+
+	return res < 0 ? FMK_LINE_SIZE : len + res;
+}
+
+
+static void stats_dump(void)
+{
+	char line[FMK_LINE_SIZE];
+	size_t len;
+	int i, first = 1, fd;
+
+	len = stats_append(line, 0, "{\"tool\": \"%s\", \"pid\": %d, "
+		"\"usecs\": %lld, \"stages\": {", stats_tool, (int) getpid(),
+		fmk_stats_usecs() - start_usecs);
+
+	for(i = 0; i < FMK_STAGES; i++) {
+		struct fmk_stage_stats *s = &stage_count[i];
+
+		if(s->calls == 0)
+			continue;
+		len = stats_append(line, len, "%s\"%s\": {\"calls\": %lld, "
+			"\"bytes_in\": %lld, \"bytes_out\": %lld, \"usecs\": "
+			"%lld}", first ? "" : ", ", stage_name[i], s->calls,
+			s->bytes_in, s->bytes_out, s->usecs);
+		first = 0;
+	}
+
+	len = stats_append(line, len, "}, \"counters\": {");
+	for(i = 0; i < FMK_COUNTERS && counter[i].name; i++)
+		len = stats_append(line, len, "%s\"%s\": %lld", i ? ", " : "",
+			counter[i].name, counter[i].value);
+	len = stats_append(line, len, "}}\n");
+
+	if(len >= sizeof(line))
+		return;
+
+	/* one write, so the lines of processes sharing the file don't mix */
+	fd = open(stats_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(fd == -1) {
+		fprintf(stderr, "fmkstats: can't open %s\n", stats_path);
+		return;
+	}
+	if(write(fd, line, len) != (ssize_t) len)
+		fprintf(stderr, "fmkstats: can't write %s\n", stats_path);
+	close(fd);
+}
+
+
+void fmk_stats_init(const char *tool)
+{
+	char *path = getenv("FMK_STATS");
+
+	if(path == NULL || *path == '\0' || fmk_stats)
+		return;
+
+	stats_tool = tool;
+	stats_path = path;
+	start_usecs = fmk_stats_usecs();
+	fmk_stats = 1;
+	atexit(stats_dump);
+}
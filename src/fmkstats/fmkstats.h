@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fmkstats.h
+ */
+
+#ifndef FMKSTATS_H
+#define FMKSTATS_H
+
+/*
+ * Instrumentation shared by the extraction and build tools.  Each stage
+ * of the work, scanning, carving, decompressing a block, writing a file,
+ * compressing a block and checksumming, is bracketed by
+ *
+ *	long long start;
+ *
+ *	FMK_STAGE_BEGIN(decompress_block, start);
+ *	...
+ *	FMK_STAGE_END(decompress_block, start, bytes_in, bytes_out);
+ *
+ * which fire the USDT probes fmk:<stage>_begin and fmk:<stage>_end (the
+ * latter with the bytes in and out) where <sys/sdt.h> is installed, for
+ * perf, bpftrace or SystemTap, e.g.
+ *
+ *	perf probe -x unsquashfs sdt_fmk:decompress_block_end
+ *
+ * A tool calling fmk_stats_init() with FMK_STATS=path set in its
+ * environment also counts the calls, bytes and time of each stage, and
+ * the FMK_COUNT() counters, and appends them to path as a line of JSON
+ * when it exits: one line per process, so a whole extraction can share
+ * the file.  Without FMK_STATS the stages cost a test of fmk_stats.
+ */
+
+#if !defined(FMK_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define FMK_PROBE(name)			DTRACE_PROBE(fmk, name)
+#define FMK_PROBE2(name, a, b)		DTRACE_PROBE2(fmk, name, a, b)
+#endif
+#endif
+
+#ifndef FMK_PROBE
+#define FMK_PROBE(name)			do { } while(0)
+#define FMK_PROBE2(name, a, b)		do { } while(0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* named as the probes, so the macros can paste the one from the other */
+enum fmk_stage {
+	fmk_stage_scan,
+	fmk_stage_carve,
+	fmk_stage_decompress_block,
+	fmk_stage_write_file,
+	fmk_stage_compress_block,
+	fmk_stage_checksum,
+	FMK_STAGES
+};
+
+extern int fmk_stats;
+
+extern void fmk_stats_init(const char *tool);
+extern long long fmk_stats_usecs(void);
+extern void fmk_stage_add(int stage, long long start, long long bytes_in,
+	long long bytes_out);
+extern void fmk_count(const char *name, long long value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define FMK_STAGE_BEGIN(stage, start) \
+	do { \
+		FMK_PROBE(stage##_begin); \
+		(start) = fmk_stats ? fmk_stats_usecs() : 0; \
+	} while(0)
+
+#define FMK_STAGE_END(stage, start, bytes_in, bytes_out) \
+	do { \
+		long long fmk_in = (bytes_in), fmk_out = (bytes_out); \
+		FMK_PROBE2(stage##_end, fmk_in, fmk_out); \
+		if(fmk_stats) \
+			fmk_stage_add(fmk_stage_##stage, start, fmk_in, \
+				fmk_out); \
+	} while(0)
+
+/* adds value to the counter name, a string constant */
+#define FMK_COUNT(name, value) \
+	do { \
+		if(fmk_stats) \
+			fmk_count(name, value); \
+	} while(0)
+
+#ifdef __cplusplus
+/*
+ * The stage from here to the end of the scope, the bytes set in var.in
+ * and var.out on the way, e.g.
+ *
+ *	FMK_SCOPED_STAGE(carve, s);
+ *	s.in = s.out = size;
+ */
+struct fmk_scope {
+	int stage;
+	long long start, in, out;
+
+	fmk_scope(int s) : stage(s), in(0), out(0)
+	{
+		start = fmk_stats ? fmk_stats_usecs() : 0;
+	}
+	~fmk_scope()
+	{
+		if(fmk_stats)
+			fmk_stage_add(stage, start, in, out);
+	}
+};
+
+#define FMK_SCOPED_STAGE(stage, var) \
+	struct fmk_scope_##stage : fmk_scope { \
+		fmk_scope_##stage() : fmk_scope(fmk_stage_##stage) \
+		{ \
+			FMK_PROBE(stage##_begin); \
+		} \
+		~fmk_scope_##stage() \
+		{ \
+			FMK_PROBE2(stage##_end, in, out); \
+		} \
+	} var
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+# The stage probes and counters of fmkstats.c, used by the squashfs 4.2,
+# cramfs and yaffs2 tools, untrx, crcalc and tpl-tool, e.g.
+#	make FMK_PROBES=0
+# Variables given on the command line reach every sub-make.
+#
+# FMK_PROBES	auto (the default) builds the USDT probes in where
+#		<sys/sdt.h> is installed (systemtap-sdt-dev), 0 leaves
+#		them out.  The counters are there either way, for
+#		FMK_STATS=path at run time
+#
+# Makefiles add FMKSTATS_FLAGS to the compiler flags of every file that
+# includes fmkstats.h, and build and link fmkstats.o.
+
+FMK_PROBES ?= auto
+
+FMKSTATS_FLAGS :=
+
+ifeq ($(FMK_PROBES),0)
+FMKSTATS_FLAGS += -DFMK_NO_PROBES
+else ifneq ($(FMK_PROBES),auto)
+$(error FMK_PROBES must be auto or 0)
+endif
@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fwimage.h
+ */
+
+#ifndef _FWIMAGE_H
+#define _FWIMAGE_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+extern "C"
+{
+#include "crc32/crc32buf.h"
+}
+#include "crcalc/md5.h"
+
+/*
+ * One parser for the firmware containers the kit otherwise handles in
+ * separate tools: TRX (untrx, asustrx, crcalc), uImage and DLOB (crcalc),
+ * TP-Link (tpl-tool), Seama (seama) and encrypted Buffalo images
+ * (buffalo-enc).  An FwImage maps the file; iterating over it finds every
+ * container header in one pass and hands back FwContainer views that
+ * point into the mapping, so nothing is copied.  Checksums can be checked
+ * and, on a writable mapping, patched in place.  Users link crc32buf.o
+ * and crcalc's md5.o.
+ */
+
+/************************************************************
+	on-flash headers
+************************************************************/
+
+#define FW_TRX_MAGIC		0x30524448	/* "HDR0", little-endian */
+#define FW_TRX_HEADER_SIZE	28
+
+#define FW_UIMAGE_MAGIC		0x27051956	/* big-endian */
+#define FW_UIMAGE_HEADER_SIZE	64
+
+#define FW_DLOB_MAGIC		0x17A4A35E	/* little-endian */
+#define FW_DLOB_HEADER_SIZE	12
+#define FW_DLOB_TYPE_LENGTH	16
+
+#define FW_TPLINK_VERSION	0x01000000	/* big-endian */
+#define FW_TPLINK_HEADER_SIZE	512
+
+#define FW_SEAMA_MAGIC		0x5EA3A417	/* big-endian */
+#define FW_SEAMA_HEADER_SIZE	12
+
+#define FW_BUFFALO_MAGIC_LEN	6
+#define FW_BUFFALO_PRODUCT_LEN	32
+#define FW_BUFFALO_VERSION_LEN	8
+
+#define FW_MD5_LEN		16
+
+static inline uint32_t FwGet32LE(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint32_t FwGet32BE(const unsigned char *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static inline uint16_t FwGet16BE(const unsigned char *p)
+{
+	return p[0] << 8 | p[1];
+}
+
+static inline void FwPut32LE(unsigned char *p, uint32_t v)
+{
+	p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24;
+}
+
+static inline void FwPut32BE(unsigned char *p, uint32_t v)
+{
+	p[0]=v>>24; p[1]=v>>16; p[2]=v>>8; p[3]=v;
+}
+
+/************************************************************
+	containers
+************************************************************/
+
+typedef enum _FW_FORMAT
+{
+	FW_FORMAT_TRX,
+	FW_FORMAT_UIMAGE,
+	FW_FORMAT_DLOB,
+	FW_FORMAT_TPLINK,
+	FW_FORMAT_SEAMA,
+	FW_FORMAT_BUFFALO
+} FW_FORMAT;
+
+static inline const char *FwFormatName(FW_FORMAT format)
+{
+	static const char *names[]={"trx","uimage","dlob","tplink","seama","buffalo"};
+	return names[format];
+}
+
+/* a byte range of the mapped image */
+struct FwSpan
+{
+	unsigned char *pData;
+	size_t nLength;
+};
+
+/* FW_CHECK_*: what FwContainer::Verify() found */
+#define FW_CHECK_BAD		0
+#define FW_CHECK_OK		1
+#define FW_CHECK_NONE		-1	/* keyed or not checksummed */
+
+/*
+ * A container header found at nOffset of the image.  header is the
+ * header proper, payload what it wraps, checksum the stored digest for
+ * the MD5 formats and parts[] the partitions it names, for TRX (up to 3
+ * offsets) and TP-Link (kernel and rootfs).
+ */
+struct FwContainer
+{
+	FW_FORMAT format;
+	size_t nOffset;
+	FwSpan header;
+	FwSpan payload;
+	FwSpan checksum;
+	FwSpan parts[3];
+	int nParts;
+
+	/* checks the container's checksums against its payload */
+	int Verify() const
+	{
+		return Check(false);
+	}
+
+	/* rewrites the checksums, needs a writable mapping; returns false
+	   for formats whose checksums cannot be recomputed here */
+	bool Patch()
+	{
+		return Check(true)!=FW_CHECK_NONE;
+	}
+
+private:
+	static void Md5Append(md5_state_t *pState, const unsigned char *p,
+		size_t nLength)
+	{
+		while(nLength)
+		{
+			int nChunk=nLength>0x40000000 ? 0x40000000 : (int)nLength;
+			md5_append(pState,p,nChunk);
+			p+=nChunk;
+			nLength-=nChunk;
+		}
+	}
+
+	static void Md5(const unsigned char *p, size_t nLength,
+		unsigned char digest[FW_MD5_LEN])
+	{
+		md5_state_t state;
+		md5_init(&state);
+		Md5Append(&state,p,nLength);
+		md5_finish(&state,digest);
+	}
+
+	/* writes digest to pField when bPatch, else compares it */
+	static int Store(unsigned char *pField, const unsigned char *pSum,
+		size_t nLength, bool bPatch)
+	{
+		if(bPatch)
+		{
+			memcpy(pField,pSum,nLength);
+			return FW_CHECK_OK;
+		}
+		return memcmp(pField,pSum,nLength) ? FW_CHECK_BAD : FW_CHECK_OK;
+	}
+
+	int Check(bool bPatch) const
+	{
+		unsigned char *h=header.pData;
+		unsigned char sum[FW_MD5_LEN];
+		int nResult;
+
+		switch(format)
+		{
+			case FW_FORMAT_TRX:
+				/* from flag_version to the end of the image */
+				FwPut32LE(sum,crc32buf(h+12,
+					header.nLength+payload.nLength-12));
+				return Store(h+8,sum,4,bPatch);
+			case FW_FORMAT_UIMAGE:
+			{
+				/* zlib crc32s, of the data and of the header with
+				   its own crc zeroed */
+				unsigned char hdr[FW_UIMAGE_HEADER_SIZE];
+				FwPut32BE(sum,~crc32buf(payload.pData,payload.nLength));
+				nResult=Store(h+24,sum,4,bPatch);
+				memcpy(hdr,h,sizeof(hdr));
+				memset(hdr+4,0,4);
+				FwPut32BE(sum,~crc32buf(hdr,sizeof(hdr)));
+				return Store(h+4,sum,4,bPatch) && nResult;
+			}
+			case FW_FORMAT_DLOB:
+				/* md5 of the data behind the second, checksum header */
+				Md5(payload.pData,payload.nLength,sum);
+				return Store(checksum.pData,sum,FW_MD5_LEN,bPatch);
+			case FW_FORMAT_TPLINK:
+			{
+				/* md5 of the whole image, taken with a fixed key in
+				   the checksum field; a bootloader gets its own key */
+				static const unsigned char key[FW_MD5_LEN]={
+					0xdc,0xd7,0x3a,0xa5,0xc3,0x95,0x98,0xfb,
+					0xdd,0xf9,0xe7,0xf4,0x0e,0xae,0x47,0x38};
+				static const unsigned char key_bootldr[FW_MD5_LEN]={
+					0x8c,0xef,0x33,0x5b,0xd5,0xc5,0xce,0xfa,
+					0xa7,0x9c,0x28,0xda,0xb2,0xe9,0x0f,0x42};
+				md5_state_t state;
+				md5_init(&state);
+				Md5Append(&state,h,0x4c);
+				Md5Append(&state,FwGet32BE(h+0x94) ? key_bootldr : key,
+					FW_MD5_LEN);
+				Md5Append(&state,h+0x4c+FW_MD5_LEN,
+					header.nLength+payload.nLength-0x4c-FW_MD5_LEN);
+				md5_finish(&state,sum);
+				return Store(checksum.pData,sum,FW_MD5_LEN,bPatch);
+			}
+			case FW_FORMAT_SEAMA:
+				if(!checksum.pData) return FW_CHECK_NONE;
+				Md5(payload.pData,payload.nLength,sum);
+				return Store(checksum.pData,sum,FW_MD5_LEN,bPatch);
+			default:
+				return FW_CHECK_NONE;
+		}
+	}
+};
+
+/************************************************************
+	identification
+************************************************************/
+
+/* FwSet: fills in the spans of a container whose header of nHeader
+   bytes at p is followed by nPayload bytes it wraps */
+static inline void FwSet(FwContainer *pC, FW_FORMAT format,
+	unsigned char *pBase, unsigned char *p, size_t nHeader, size_t nPayload)
+{
+	memset(pC,0,sizeof(FwContainer));
+	pC->format=format;
+	pC->nOffset=p-pBase;
+	pC->header.pData=p;
+	pC->header.nLength=nHeader;
+	pC->payload.pData=p+nHeader;
+	pC->payload.nLength=nPayload;
+}
+
+/*************************************************************************
+* FwIdentify
+*
+* checks for a container header at p, with nAvail bytes of the image
+* from there on, and fills in *pC if one is there and fits.
+*
+**************************************************************************/
+static inline bool FwIdentify(unsigned char *pBase, unsigned char *p,
+	size_t nAvail, FwContainer *pC)
+{
+	if(nAvail<FW_DLOB_HEADER_SIZE) return false;
+
+	switch(p[0])
+	{
+		case 0x48:	/* TRX */
+		{
+			if(FwGet32LE(p)!=FW_TRX_MAGIC || nAvail<FW_TRX_HEADER_SIZE)
+				break;
+			uint32_t nLen=FwGet32LE(p+4);
+			if(nLen<FW_TRX_HEADER_SIZE || nLen>nAvail) break;
+			FwSet(pC,FW_FORMAT_TRX,pBase,p,FW_TRX_HEADER_SIZE,
+				nLen-FW_TRX_HEADER_SIZE);
+			for(int nI=0;nI<3;nI++)
+			{
+				uint32_t nStart=FwGet32LE(p+16+4*nI);
+				if(!nStart || nStart>=nLen) break;
+				uint32_t nEnd=nI<2 ? FwGet32LE(p+20+4*nI) : 0;
+				if(!nEnd || nEnd>nLen || nEnd<nStart) nEnd=nLen;
+				pC->parts[nI].pData=p+nStart;
+				pC->parts[nI].nLength=nEnd-nStart;
+				pC->nParts++;
+			}
+			return true;
+		}
+		case 0x27:	/* uImage */
+		{
+			if(FwGet32BE(p)!=FW_UIMAGE_MAGIC || nAvail<FW_UIMAGE_HEADER_SIZE)
+				break;
+			uint32_t nSize=FwGet32BE(p+12);
+			if(nSize>nAvail-FW_UIMAGE_HEADER_SIZE) break;
+			FwSet(pC,FW_FORMAT_UIMAGE,pBase,p,FW_UIMAGE_HEADER_SIZE,nSize);
+			return true;
+		}
+		case 0x5e:	/* DLOB */
+		{
+			if(FwGet32LE(p)!=FW_DLOB_MAGIC) break;
+			/* a signature header and its data, then a checksum header
+			   followed by the digest, a type string and the data: the
+			   same bytes as a Seama signature entity and the entity
+			   after it, which DLOB takes as a single container */
+			uint64_t nCk=(uint64_t)FW_DLOB_HEADER_SIZE+FwGet32BE(p+4)
+				+FwGet32BE(p+8);
+			if(nCk+FW_DLOB_HEADER_SIZE>nAvail
+				|| FwGet32LE(p+nCk)!=FW_DLOB_MAGIC)
+				break;
+			uint64_t nData=nCk+FW_DLOB_HEADER_SIZE+FwGet32BE(p+nCk+4)
+				+FW_DLOB_TYPE_LENGTH;
+			uint32_t nSize=FwGet32BE(p+nCk+8);
+			if(nData>nAvail || nSize>nAvail-nData
+				|| nCk+FW_DLOB_HEADER_SIZE+FW_MD5_LEN>nData)
+				break;
+			FwSet(pC,FW_FORMAT_DLOB,pBase,p,nData,nSize);
+			pC->checksum.pData=p+nCk+FW_DLOB_HEADER_SIZE;
+			pC->checksum.nLength=FW_MD5_LEN;
+			return true;
+		}
+		case 0x01:	/* TP-Link, which has a version where others have magic */
+		{
+			if(FwGet32BE(p)!=FW_TPLINK_VERSION || nAvail<FW_TPLINK_HEADER_SIZE
+				|| p[4]<' ' || p[4]>'~' || !memchr(p+4,0,24))
+				break;
+			uint32_t nLen=FwGet32BE(p+0x7c);
+			uint64_t nKernel=(uint64_t)FwGet32BE(p+0x80)+FwGet32BE(p+0x84);
+			uint64_t nRootfs=(uint64_t)FwGet32BE(p+0x88)+FwGet32BE(p+0x8c);
+			if(nLen<FW_TPLINK_HEADER_SIZE || nLen>nAvail
+				|| nKernel>nLen || nRootfs>nLen)
+				break;
+			FwSet(pC,FW_FORMAT_TPLINK,pBase,p,FW_TPLINK_HEADER_SIZE,
+				nLen-FW_TPLINK_HEADER_SIZE);
+			pC->checksum.pData=p+0x4c;
+			pC->checksum.nLength=FW_MD5_LEN;
+			for(int nI=0;nI<2;nI++)
+			{
+				uint32_t nLength=FwGet32BE(p+0x84+8*nI);
+				if(!nLength) continue;
+				pC->parts[pC->nParts].pData=p+FwGet32BE(p+0x80+8*nI);
+				pC->parts[pC->nParts].nLength=nLength;
+				pC->nParts++;
+			}
+			return true;
+		}
+		case 's':	/* encrypted Buffalo */
+		case 'a':
+		{
+			if(memcmp(p,"start",FW_BUFFALO_MAGIC_LEN)
+				&& memcmp(p,"asar1",FW_BUFFALO_MAGIC_LEN))
+				break;
+			/* magic, seed, then product and version each after their
+			   length, then the data length, the data and a checksum */
+			size_t nPos=FW_BUFFALO_MAGIC_LEN+1;
+			if(nAvail<nPos+4) break;
+			uint32_t nProduct=FwGet32BE(p+nPos);
+			if(nProduct>FW_BUFFALO_PRODUCT_LEN) break;
+			nPos+=4+nProduct;
+			if(nAvail<nPos+4) break;
+			uint32_t nVersion=FwGet32BE(p+nPos);
+			if(nVersion>FW_BUFFALO_VERSION_LEN) break;
+			nPos+=4+nVersion;
+			if(nAvail<nPos+4) break;
+			uint32_t nData=FwGet32BE(p+nPos);
+			nPos+=4;
+			if(nData>nAvail-nPos || nAvail-nPos-nData<4) break;
+			FwSet(pC,FW_FORMAT_BUFFALO,pBase,p,nPos,nData);
+			return true;
+		}
+		default:
+			break;
+	}
+
+	/* Seama shares DLOB's first byte */
+	if(p[0]==0x5e && FwGet32BE(p)==FW_SEAMA_MAGIC)
+	{
+		uint16_t nMeta=FwGet16BE(p+6);
+		uint32_t nSize=FwGet32BE(p+8);
+		size_t nHeader=FW_SEAMA_HEADER_SIZE+(nSize ? FW_MD5_LEN : 0)+nMeta;
+		if(nHeader>nAvail || nSize>nAvail-nHeader) return false;
+		FwSet(pC,FW_FORMAT_SEAMA,pBase,p,nHeader,nSize);
+		if(nSize)
+		{
+			pC->checksum.pData=p+FW_SEAMA_HEADER_SIZE;
+			pC->checksum.nLength=FW_MD5_LEN;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/************************************************************
+	mapped images
+************************************************************/
+
+class FwIterator;
+
+#define FW_PATH_LEN	4096
+
+/*
+ * An image argument may name a region of a file as file@offset or
+ * file@offset+length, decimal or 0x hex, so that a tool works on part
+ * of an image where it lies rather than on a copy carved out of it.  A
+ * file that exists under the whole name is taken whole.
+ */
+static inline bool FwParseRegion(const char *pszArg, char *pszPath,
+	uint64_t *pnOffset, uint64_t *pnLength)
+{
+	struct stat st;
+	char *pszEnd;
+
+	const char *pszAt=strrchr(pszArg,'@');
+	if(!pszAt || pszAt==pszArg || (size_t)(pszAt-pszArg)>=FW_PATH_LEN
+		|| stat(pszArg,&st)==0)
+		return false;
+	*pnOffset=strtoull(pszAt+1,&pszEnd,0);
+	*pnLength=UINT64_MAX;
+	if(pszEnd==pszAt+1) return false;
+	if(*pszEnd=='+')
+	{
+		const char *pszLength=pszEnd+1;
+		*pnLength=strtoull(pszLength,&pszEnd,0);
+		if(pszEnd==pszLength) return false;
+	}
+	if(*pszEnd) return false;
+	memcpy(pszPath,pszArg,pszAt-pszArg);
+	pszPath[pszAt-pszArg]='\0';
+	return true;
+}
+
+/*
+ * A firmware image mapped into memory, read-only or, for patching,
+ * shared and writable, or a region of one named as FwParseRegion has
+ * it.  Data() and Size() are those of the region and Offset() where it
+ * lies in Fd(), for tools that copy from it by file offset.
+ * begin()/end() iterate over its containers.
+ */
+class FwImage
+{
+public:
+	FwImage() : m_fd(-1), m_pData(NULL), m_nSize(0), m_nOffset(0), m_pMap(NULL),
+		m_nMap(0) {}
+	~FwImage() { Close(); }
+
+	bool Open(const char *pszFile, bool bWritable=false)
+	{
+		char szPath[FW_PATH_LEN];
+		uint64_t nOffset=0, nLength=UINT64_MAX;
+		struct stat st;
+
+		Close();
+		if(FwParseRegion(pszFile,szPath,&nOffset,&nLength)) pszFile=szPath;
+		m_fd=open(pszFile,bWritable ? O_RDWR : O_RDONLY);
+		if(m_fd<0) return false;
+		if(fstat(m_fd,&st)<0 || nOffset>(uint64_t)st.st_size)
+		{
+			Close();
+			return false;
+		}
+		m_nOffset=nOffset;
+		m_nSize=st.st_size-nOffset<nLength ? st.st_size-nOffset : nLength;
+		if(!m_nSize) return true;
+
+		/* the mapping starts on the page the region starts in */
+		size_t nSlack=nOffset%sysconf(_SC_PAGESIZE);
+		m_nMap=m_nSize+nSlack;
+		void *p=mmap(NULL,m_nMap,PROT_READ|(bWritable ? PROT_WRITE : 0),
+			MAP_SHARED,m_fd,nOffset-nSlack);
+		if(p==MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		m_pMap=(unsigned char *)p;
+		m_pData=m_pMap+nSlack;
+		return true;
+	}
+
+	void Close()
+	{
+		if(m_pMap) munmap(m_pMap,m_nMap);
+		if(m_fd>=0) close(m_fd);
+		m_fd=-1;
+		m_pData=m_pMap=NULL;
+		m_nSize=m_nMap=0;
+		m_nOffset=0;
+	}
+
+	unsigned char *Data() const { return m_pData; }
+	size_t Size() const { return m_nSize; }
+	int Fd() const { return m_fd; }
+	off_t Offset() const { return m_nOffset; }
+
+	/* finds the first container starting at or after nFrom */
+	bool Find(size_t nFrom, FwContainer *pC) const
+	{
+		for(size_t nPos=nFrom;nPos<m_nSize;nPos++)
+		{
+			if(FwIdentify(m_pData,m_pData+nPos,m_nSize-nPos,pC))
+				return true;
+		}
+		return false;
+	}
+
+	inline FwIterator begin() const;
+	inline FwIterator end() const;
+
+private:
+	FwImage(const FwImage &);
+	FwImage &operator=(const FwImage &);
+
+	int m_fd;
+	unsigned char *m_pData;
+	size_t m_nSize;
+	off_t m_nOffset;	/* of the region in the file */
+	unsigned char *m_pMap;	/* from the page it starts in */
+	size_t m_nMap;
+};
+
+/*
+ * Walks the containers of an image in offset order.  The search goes on
+ * right after each header, so containers inside a payload (a TRX in a
+ * Seama image, a TP-Link image in another's bootloader part) are found
+ * too: outer ones come first, and patching is done innermost first by
+ * going over them backwards.
+ */
+class FwIterator
+{
+public:
+	FwIterator(const FwImage *pImage, bool bEnd) : m_pImage(pImage), m_bEnd(bEnd)
+	{
+		if(!m_bEnd) m_bEnd=!m_pImage->Find(0,&m_container);
+	}
+
+	FwContainer &operator*() { return m_container; }
+	FwContainer *operator->() { return &m_container; }
+
+	FwIterator &operator++()
+	{
+		m_bEnd=!m_pImage->Find(m_container.nOffset+m_container.header.nLength,
+			&m_container);
+		return *this;
+	}
+
+	bool operator==(const FwIterator &other) const
+	{
+		if(m_bEnd || other.m_bEnd) return m_bEnd==other.m_bEnd;
+		return m_container.nOffset==other.m_container.nOffset;
+	}
+
+	bool operator!=(const FwIterator &other) const
+	{
+		return !(*this==other);
+	}
+
+private:
+	const FwImage *m_pImage;
+	bool m_bEnd;
+	FwContainer m_container;
+};
+
+inline FwIterator FwImage::begin() const
+{
+	return FwIterator(this,false);
+}
+
+inline FwIterator FwImage::end() const
+{
+	return FwIterator(this,true);
+}
+
+#endif /* _FWIMAGE_H */
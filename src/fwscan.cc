@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * fwscan.cc
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fwimage.h"
+
+/*************************************************************************
+* ShowUsage
+*
+*
+**************************************************************************/
+void ShowUsage()
+{
+	fprintf(stderr, " USAGE: fwscan [-p] image...\n"
+		"  lists the TRX, uImage, DLOB, TP-Link, Seama and Buffalo headers\n"
+		"  in each image: offset, format, header and payload sizes and\n"
+		"  whether the checksum holds; -p rewrites the bad ones in place.\n"
+		"  An image may be a region of a file, as file@offset[+length].\n");
+	exit(9);
+}
+
+/*************************************************************************
+* ScanImage
+*
+* lists, and with bPatch fixes, the containers of one image.  Returns
+* the number of bad checksums left.
+*
+**************************************************************************/
+int ScanImage(const char *pszImage, bool bPatch)
+{
+	FwImage image;
+	if(!image.Open(pszImage,bPatch))
+	{
+		fprintf(stderr, " ERROR opening %s\n", pszImage);
+		return 1;
+	}
+
+	FwContainer *pContainers=NULL;
+	size_t nContainers=0, nAlloc=0;
+	for(FwIterator it=image.begin();it!=image.end();++it)
+	{
+		if(nContainers==nAlloc)
+		{
+			nAlloc=nAlloc ? nAlloc*2 : 16;
+			pContainers=(FwContainer *)
+				realloc(pContainers,nAlloc*sizeof(FwContainer));
+			if(!pContainers)
+			{
+				fprintf(stderr, " ERROR out of memory\n");
+				return 1;
+			}
+		}
+		pContainers[nContainers++]=*it;
+	}
+
+	// innermost first, so outer checksums cover the patched data
+	int *pResults=(int *)malloc((nContainers+1)*sizeof(int));
+	bool *pPatched=(bool *)calloc(nContainers+1,sizeof(bool));
+	int nBad=0;
+	for(size_t nI=nContainers;nI-->0;)
+	{
+		pResults[nI]=pContainers[nI].Verify();
+		if(bPatch && pResults[nI]==FW_CHECK_BAD && pContainers[nI].Patch())
+		{
+			pResults[nI]=FW_CHECK_OK;
+			pPatched[nI]=true;
+		}
+		if(pResults[nI]==FW_CHECK_BAD) nBad++;
+	}
+
+	for(size_t nI=0;nI<nContainers;nI++)
+	{
+		FwContainer *pC=&pContainers[nI];
+		printf("%s\t%lu\t%s\t%lu\t%lu\t%s\n", pszImage,
+			(unsigned long)pC->nOffset, FwFormatName(pC->format),
+			(unsigned long)pC->header.nLength,
+			(unsigned long)pC->payload.nLength,
+			pPatched[nI] ? "patched" :
+			pResults[nI]==FW_CHECK_OK ? "ok" :
+			pResults[nI]==FW_CHECK_BAD ? "bad" : "-");
+	}
+
+	free(pPatched);
+	free(pResults);
+	free(pContainers);
+	return nBad;
+}
+
+/*************************************************************************
+* main
+*
+*
+**************************************************************************/
+int main(int argc, char **argv)
+{
+	bool bPatch=false;
+	int nArg=1, nBad=0;
+
+	if(argc>1 && !strcmp(argv[1],"-p"))
+	{
+		bPatch=true;
+		nArg++;
+	}
+	if(nArg>=argc)
+	{
+		ShowUsage();
+	}
+
+	for(;nArg<argc;nArg++)
+	{
+		nBad+=ScanImage(argv[nArg],bPatch);
+	}
+	exit(nBad ? 1 : 0);
+}
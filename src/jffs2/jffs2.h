@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * jffs2.h
+ */
+
+#ifndef JFFS2_H
+#define JFFS2_H
+
+#include <stdint.h>
+
+#include "crc32buf.h"
+
+/*
+ * The JFFS2 on-flash format shared by jffs2extract and mkjffs2.  Nodes
+ * are kept as bytes and read and written with the helpers below in the
+ * image's byte order, big set for big-endian.
+ */
+#define JFFS2_MAGIC		0x1985
+#define JFFS2_NODE_ACCURATE	0x2000
+#define JFFS2_NODETYPE_DIRENT	0xE001
+#define JFFS2_NODETYPE_INODE	0xE002
+#define JFFS2_NODETYPE_CLEANMARKER 0x2003
+
+#define JFFS2_COMPR_NONE	0x00
+#define JFFS2_COMPR_ZERO	0x01
+#define JFFS2_COMPR_RTIME	0x02
+#define JFFS2_COMPR_ZLIB	0x06
+#define JFFS2_COMPR_LZO		0x07
+#define JFFS2_COMPR_LZMA	0x08
+
+/* Sizes of the node header and of the dirent and inode nodes */
+#define JFFS2_HEADER_SIZE	12
+#define JFFS2_DIRENT_SIZE	40
+#define JFFS2_INODE_SIZE	68
+
+#define JFFS2_ROOT_INO		1
+#define JFFS2_PAGE_SIZE		4096	/* the most data an inode node holds */
+
+#define PAD4(x)			(((x) + 3) & ~3UL)
+
+static inline uint16_t get16(const unsigned char *p, int big)
+{
+	return big ? p[0] << 8 | p[1] : p[0] | p[1] << 8;
+}
+
+static inline uint32_t get32(const unsigned char *p, int big)
+{
+	if(big)
+	{
+		return (uint32_t) p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+	}
+
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline void put16(unsigned char *p, uint16_t v, int big)
+{
+	p[big ? 0 : 1] = v >> 8;
+	p[big ? 1 : 0] = v;
+}
+
+static inline void put32(unsigned char *p, uint32_t v, int big)
+{
+	if(big)
+	{
+		p[0] = v >> 24;
+		p[1] = v >> 16;
+		p[2] = v >> 8;
+		p[3] = v;
+	}
+	else
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+		p[2] = v >> 16;
+		p[3] = v >> 24;
+	}
+}
+
+/* The kernel's crc32(0, ...): the running register, without inversions */
+static inline uint32_t jffs2_crc32(const unsigned char *p, size_t len)
+{
+	return crc32_update(0, p, len);
+}
+
+#endif
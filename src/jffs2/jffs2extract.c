@@ -0,0 +1,1044 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * jffs2extract.c
+ */
+
+/*
+ * Extracts a JFFS2 image to a directory without mounting it.
+ *
+ * The image is scanned for nodes in parallel, each thread taking a slice
+ * of it, and the nodes are read in whichever byte order their magic is
+ * in, so big-endian images need no conversion first.  Per inode, the data
+ * nodes are applied in version order, as the kernel builds its fragment
+ * tree, and the files are decompressed and written by the same threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sysmacros.h>
+#include <zlib.h>
+#include <lzma.h>
+
+#include "zbuf.h"
+#include "jffs2.h"
+
+#define JFFS2_SLICE_ALIGN	0x10000	/* scan slices start on 64K */
+
+/* A node found by the scan; big is set for big-endian nodes */
+struct jffs2_rec
+{
+	size_t offset;
+	uint32_t totlen;
+	uint16_t type;
+	unsigned char big;
+};
+
+struct jffs2_scan
+{
+	pthread_t thread;
+	int started;
+	size_t start;
+	size_t end;
+	struct jffs2_rec *rec;
+	size_t nrec;
+	size_t size;
+};
+
+/* A data node of an inode, in image order in seq */
+struct jffs2_dnode
+{
+	uint32_t ino;
+	uint32_t version;
+	uint32_t mode;
+	uint32_t isize;
+	uint32_t atime;
+	uint32_t mtime;
+	uint32_t offset;
+	uint32_t csize;
+	uint32_t dsize;
+	uint16_t uid;
+	uint16_t gid;
+	unsigned char compr;
+	unsigned char big;
+	const unsigned char *data;
+	size_t seq;
+};
+
+struct jffs2_dirent
+{
+	uint32_t pino;
+	uint32_t version;
+	uint32_t ino;
+	unsigned char nsize;
+	const unsigned char *name;
+	size_t seq;
+};
+
+/* An inode and its data nodes, the latest last */
+struct jffs2_inode
+{
+	uint32_t ino;
+	struct jffs2_dnode *dnode;
+	size_t ndnodes;
+	char *path;
+};
+
+static const unsigned char *image;
+static size_t image_size;
+
+static struct jffs2_dnode *dnodes;
+static size_t ndnodes;
+static struct jffs2_dirent *dirents;
+static size_t ndirents;
+static struct jffs2_inode *inodes;
+static size_t ninodes;
+
+/* Regular files to write and directories to finish, in walk order */
+static struct jffs2_inode **files;
+static size_t nfiles;
+static struct jffs2_inode **dirs;
+static size_t ndirs;
+
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t job_next;
+static int errors;
+static int is_root;
+
+static void error_msg(const char *fmt, const char *arg)
+{
+	pthread_mutex_lock(&job_lock);
+	fprintf(stderr, fmt, arg);
+	errors++;
+	pthread_mutex_unlock(&job_lock);
+}
+
+/*
+ * The header CRC is of the node as written, before obsoleting it cleared
+ * JFFS2_NODE_ACCURATE, so it is checked with that bit set again.
+ */
+static int check_header(const unsigned char *p, int big)
+{
+	unsigned char hdr[8];
+
+	memcpy(hdr, p, sizeof(hdr));
+	hdr[big ? 2 : 3] |= JFFS2_NODE_ACCURATE >> 8;
+
+	return jffs2_crc32(hdr, sizeof(hdr)) == get32(p + 8, big);
+}
+
+/* Checks the node and, for inodes and dirents, data CRCs of a node */
+static int check_node(const unsigned char *p, uint16_t type, uint32_t totlen,
+	int big)
+{
+	if(type == JFFS2_NODETYPE_INODE)
+	{
+		uint32_t csize = get32(p + 48, big);
+
+		return totlen >= JFFS2_INODE_SIZE &&
+			csize <= totlen - JFFS2_INODE_SIZE &&
+			jffs2_crc32(p, 60) == get32(p + 64, big) &&
+			jffs2_crc32(p + JFFS2_INODE_SIZE, csize) ==
+				get32(p + 60, big);
+	}
+
+	if(type == JFFS2_NODETYPE_DIRENT)
+	{
+		unsigned char nsize = p[28];
+
+		return totlen >= JFFS2_DIRENT_SIZE + nsize &&
+			jffs2_crc32(p, 32) == get32(p + 32, big) &&
+			jffs2_crc32(p + JFFS2_DIRENT_SIZE, nsize) ==
+				get32(p + 36, big);
+	}
+
+	return 0;
+}
+
+/*
+ * Records the valid inode and dirent nodes starting in one slice of the
+ * image.  Nodes are on 4 byte boundaries and checked by their header CRC,
+ * so a slice may start in the middle of a node: whatever is found inside
+ * it is dropped when the slices are merged.
+ */
+static void *scan_slice(void *arg)
+{
+	struct jffs2_scan *s = arg;
+	size_t pos = s->start;
+
+	while(pos < s->end && pos + JFFS2_HEADER_SIZE <= image_size)
+	{
+		const unsigned char *p = image + pos;
+		uint32_t totlen;
+		uint16_t type;
+		int big;
+
+		if(p[0] == (JFFS2_MAGIC & 0xff) && p[1] == JFFS2_MAGIC >> 8)
+		{
+			big = 0;
+		}
+		else if(p[0] == JFFS2_MAGIC >> 8 && p[1] == (JFFS2_MAGIC & 0xff))
+		{
+			big = 1;
+		}
+		else
+		{
+			pos += 4;
+			continue;
+		}
+
+		totlen = get32(p + 4, big);
+		if(totlen < JFFS2_HEADER_SIZE || totlen > image_size - pos ||
+			!check_header(p, big))
+		{
+			pos += 4;
+			continue;
+		}
+
+		type = get16(p + 2, big);
+		if((type & JFFS2_NODE_ACCURATE) && check_node(p, type, totlen, big))
+		{
+			if(s->nrec == s->size)
+			{
+				size_t size = s->size ? s->size * 2 : 1024;
+				struct jffs2_rec *rec = realloc(s->rec,
+					size * sizeof(*rec));
+
+				if(rec == NULL)
+				{
+					error_msg("%s: out of memory\n", "scan");
+					break;
+				}
+				s->rec = rec;
+				s->size = size;
+			}
+			s->rec[s->nrec].offset = pos;
+			s->rec[s->nrec].totlen = totlen;
+			s->rec[s->nrec].type = type;
+			s->rec[s->nrec++].big = big;
+		}
+
+		pos += PAD4(totlen);
+	}
+
+	return NULL;
+}
+
+static void add_node(const struct jffs2_rec *r)
+{
+	const unsigned char *p = image + r->offset;
+	int big = r->big;
+
+	if(r->type == JFFS2_NODETYPE_INODE)
+	{
+		struct jffs2_dnode *d = &dnodes[ndnodes];
+
+		d->ino = get32(p + 12, big);
+		d->version = get32(p + 16, big);
+		d->mode = get32(p + 20, big);
+		d->uid = get16(p + 24, big);
+		d->gid = get16(p + 26, big);
+		d->isize = get32(p + 28, big);
+		d->atime = get32(p + 32, big);
+		d->mtime = get32(p + 36, big);
+		d->offset = get32(p + 44, big);
+		d->csize = get32(p + 48, big);
+		d->dsize = get32(p + 52, big);
+		d->compr = p[56];
+		d->big = big;
+		d->data = p + JFFS2_INODE_SIZE;
+		d->seq = ndnodes++;
+	}
+	else
+	{
+		struct jffs2_dirent *e = &dirents[ndirents];
+
+		e->pino = get32(p + 12, big);
+		e->version = get32(p + 16, big);
+		e->ino = get32(p + 20, big);
+		e->nsize = p[28];
+		e->name = p + JFFS2_DIRENT_SIZE;
+		e->seq = ndirents++;
+	}
+}
+
+/* Scans the image with the given number of threads and collects its nodes */
+static int scan_image(int threads)
+{
+	struct jffs2_scan *scan;
+	size_t slice, total = 0, end = 0;
+	int i;
+
+	slice = image_size / threads;
+	slice = (slice + JFFS2_SLICE_ALIGN - 1) & ~(size_t) (JFFS2_SLICE_ALIGN - 1);
+	if(slice == 0)
+	{
+		slice = JFFS2_SLICE_ALIGN;
+	}
+
+	scan = calloc(threads, sizeof(*scan));
+	if(scan == NULL)
+	{
+		return -1;
+	}
+
+	for(i = 0; i < threads; i++)
+	{
+		scan[i].start = i * slice < image_size ? i * slice : image_size;
+		scan[i].end = (i + 1) * slice < image_size ?
+			(i + 1) * slice : image_size;
+		if(i == threads - 1)
+		{
+			scan[i].end = image_size;
+		}
+		scan[i].started = i > 0 && pthread_create(&scan[i].thread, NULL,
+			scan_slice, &scan[i]) == 0;
+	}
+
+	for(i = 0; i < threads; i++)
+	{
+		if(scan[i].started)
+		{
+			pthread_join(scan[i].thread, NULL);
+		}
+		else
+		{
+			scan_slice(&scan[i]);
+		}
+		total += scan[i].nrec;
+	}
+
+	dnodes = malloc((total ? total : 1) * sizeof(*dnodes));
+	dirents = malloc((total ? total : 1) * sizeof(*dirents));
+	if(dnodes == NULL || dirents == NULL)
+	{
+		total = 0;
+		errors++;
+	}
+
+	/* merge in image order, dropping nodes found inside earlier ones */
+	for(i = 0; i < threads; i++)
+	{
+		size_t j;
+
+		for(j = 0; total && j < scan[i].nrec; j++)
+		{
+			if(scan[i].rec[j].offset >= end)
+			{
+				add_node(&scan[i].rec[j]);
+				end = scan[i].rec[j].offset + scan[i].rec[j].totlen;
+			}
+		}
+		free(scan[i].rec);
+	}
+	free(scan);
+
+	return total ? 0 : -1;
+}
+
+static int dnode_cmp(const void *a, const void *b)
+{
+	const struct jffs2_dnode *x = a, *y = b;
+
+	if(x->ino != y->ino)
+	{
+		return x->ino < y->ino ? -1 : 1;
+	}
+	if(x->version != y->version)
+	{
+		return x->version < y->version ? -1 : 1;
+	}
+
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static int dirent_cmp(const void *a, const void *b)
+{
+	const struct jffs2_dirent *x = a, *y = b;
+	int r;
+
+	if(x->pino != y->pino)
+	{
+		return x->pino < y->pino ? -1 : 1;
+	}
+	if(x->nsize != y->nsize)
+	{
+		return x->nsize < y->nsize ? -1 : 1;
+	}
+	r = memcmp(x->name, y->name, x->nsize);
+	if(r)
+	{
+		return r;
+	}
+	if(x->version != y->version)
+	{
+		return x->version < y->version ? -1 : 1;
+	}
+
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/*
+ * Sorts the data nodes into inodes and keeps the latest dirent of each
+ * name in a directory, dropping the names whose latest dirent unlinked
+ * them (ino 0).
+ */
+static int build_tree(void)
+{
+	size_t i, n = 0;
+
+	qsort(dnodes, ndnodes, sizeof(*dnodes), dnode_cmp);
+	qsort(dirents, ndirents, sizeof(*dirents), dirent_cmp);
+
+	inodes = calloc(ndnodes ? ndnodes : 1, sizeof(*inodes));
+	if(inodes == NULL)
+	{
+		return -1;
+	}
+
+	for(i = 0; i < ndnodes; i++)
+	{
+		if(ninodes == 0 || inodes[ninodes - 1].ino != dnodes[i].ino)
+		{
+			inodes[ninodes].ino = dnodes[i].ino;
+			inodes[ninodes++].dnode = &dnodes[i];
+		}
+		inodes[ninodes - 1].ndnodes++;
+	}
+
+	for(i = 0; i < ndirents; i++)
+	{
+		const struct jffs2_dirent *e = &dirents[i];
+
+		if(i + 1 < ndirents && dirents[i + 1].pino == e->pino &&
+			dirents[i + 1].nsize == e->nsize &&
+			memcmp(dirents[i + 1].name, e->name, e->nsize) == 0)
+		{
+			continue;
+		}
+		if(e->ino != 0)
+		{
+			dirents[n++] = *e;
+		}
+	}
+	ndirents = n;
+
+	return 0;
+}
+
+static struct jffs2_inode *find_inode(uint32_t ino)
+{
+	size_t lo = 0, hi = ninodes;
+
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if(inodes[mid].ino == ino)
+		{
+			return &inodes[mid];
+		}
+		if(inodes[mid].ino < ino)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return NULL;
+}
+
+/* The latest node holds the inode's mode, owner, times and size */
+static inline const struct jffs2_dnode *latest(const struct jffs2_inode *inode)
+{
+	return &inode->dnode[inode->ndnodes - 1];
+}
+
+static int rtime_decompress(const unsigned char *in, uint32_t inlen,
+	unsigned char *out, uint32_t outlen)
+{
+	uint32_t positions[256];
+	uint32_t inpos = 0, outpos = 0;
+
+	memset(positions, 0, sizeof(positions));
+
+	while(outpos < outlen)
+	{
+		unsigned char value;
+		uint32_t repeat, backoffs;
+
+		if(inpos + 2 > inlen)
+		{
+			return -1;
+		}
+		value = in[inpos++];
+		repeat = in[inpos++];
+		out[outpos++] = value;
+		backoffs = positions[value];
+		positions[value] = outpos;
+
+		if(repeat > outlen - outpos)
+		{
+			return -1;
+		}
+		/* the copy may overlap itself, so it goes a byte at a time */
+		while(repeat--)
+		{
+			out[outpos++] = out[backoffs++];
+		}
+	}
+
+	return 0;
+}
+
+/* Raw LZMA with lc, lp and pb of 0 and no header, as OpenWrt's jffs2 writes */
+static int lzma_decompress(const unsigned char *in, uint32_t inlen,
+	unsigned char *out, uint32_t outlen)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	lzma_options_lzma opt;
+	lzma_filter filters[2];
+	lzma_ret ret;
+
+	memset(&opt, 0, sizeof(opt));
+	opt.dict_size = outlen > LZMA_DICT_SIZE_MIN ? outlen : LZMA_DICT_SIZE_MIN;
+	filters[0].id = LZMA_FILTER_LZMA1;
+	filters[0].options = &opt;
+	filters[1].id = LZMA_VLI_UNKNOWN;
+
+	if(lzma_raw_decoder(&strm, filters) != LZMA_OK)
+	{
+		return -1;
+	}
+
+	strm.next_in = in;
+	strm.avail_in = inlen;
+	strm.next_out = out;
+	strm.avail_out = outlen;
+	ret = lzma_code(&strm, LZMA_RUN);
+	lzma_end(&strm);
+
+	return (ret == LZMA_OK || ret == LZMA_STREAM_END) &&
+		strm.avail_out == 0 ? 0 : -1;
+}
+
+static int decompress(const struct jffs2_dnode *d, unsigned char *out)
+{
+	unsigned long len = d->dsize;
+
+	switch(d->compr)
+	{
+		case JFFS2_COMPR_NONE:
+			if(d->csize < d->dsize)
+			{
+				return -1;
+			}
+			memcpy(out, d->data, d->dsize);
+			return 0;
+		case JFFS2_COMPR_ZERO:
+			memset(out, 0, d->dsize);
+			return 0;
+		case JFFS2_COMPR_RTIME:
+			return rtime_decompress(d->data, d->csize, out, d->dsize);
+		case JFFS2_COMPR_ZLIB:
+			return zbuf_uncompress(out, &len, d->data, d->csize) == Z_OK &&
+				len == d->dsize ? 0 : -1;
+		case JFFS2_COMPR_LZMA:
+			return lzma_decompress(d->data, d->csize, out, d->dsize);
+	}
+
+	return -1;
+}
+
+/*
+ * Assembles the contents of an inode: its data nodes are laid over one
+ * another oldest first, so that the latest data of every range wins, and
+ * the result is cut to the latest node's size.
+ */
+static unsigned char *read_inode(const struct jffs2_inode *inode,
+	uint32_t *size)
+{
+	unsigned char *buf, *tmp = NULL;
+	uint32_t isize = latest(inode)->isize;
+	size_t i;
+
+	buf = calloc(isize ? isize : 1, 1);
+	if(buf == NULL)
+	{
+		error_msg("%s: out of memory\n", inode->path);
+		return NULL;
+	}
+
+	for(i = 0; i < inode->ndnodes; i++)
+	{
+		const struct jffs2_dnode *d = &inode->dnode[i];
+		unsigned char *out;
+
+		if(d->dsize == 0 || d->offset >= isize)
+		{
+			continue;
+		}
+
+		/* nodes running past the end are decompressed aside */
+		if(d->dsize <= isize - d->offset)
+		{
+			out = buf + d->offset;
+		}
+		else
+		{
+			free(tmp);
+			out = tmp = malloc(d->dsize);
+			if(tmp == NULL)
+			{
+				error_msg("%s: out of memory\n", inode->path);
+				continue;
+			}
+		}
+
+		if(decompress(d, out) != 0)
+		{
+			error_msg(d->compr == JFFS2_COMPR_LZO ?
+				"%s: LZO compressed data is not supported\n" :
+				"%s: bad compressed data\n", inode->path);
+			memset(out, 0, d->dsize);
+		}
+
+		if(out == tmp)
+		{
+			memcpy(buf + d->offset, tmp, isize - d->offset);
+		}
+	}
+	free(tmp);
+
+	*size = isize;
+	return buf;
+}
+
+/* Sets the owner, mode and times, the mode after chown() cleared set-id bits */
+static void set_attrs(const struct jffs2_inode *inode)
+{
+	const struct jffs2_dnode *d = latest(inode);
+	struct timespec times[2];
+
+	if(is_root && lchown(inode->path, d->uid, d->gid) != 0)
+	{
+		error_msg("%s: chown failed\n", inode->path);
+	}
+	if(!S_ISLNK(d->mode) && chmod(inode->path, d->mode & 07777) != 0)
+	{
+		error_msg("%s: chmod failed\n", inode->path);
+	}
+
+	times[0].tv_sec = d->atime;
+	times[0].tv_nsec = 0;
+	times[1].tv_sec = d->mtime;
+	times[1].tv_nsec = 0;
+	utimensat(AT_FDCWD, inode->path, times, AT_SYMLINK_NOFOLLOW);
+}
+
+static void write_file(struct jffs2_inode *inode)
+{
+	unsigned char *buf;
+	uint32_t size, done = 0;
+	int fd;
+
+	buf = read_inode(inode, &size);
+	if(buf == NULL)
+	{
+		return;
+	}
+
+	fd = open(inode->path, O_WRONLY | O_TRUNC);
+	if(fd < 0)
+	{
+		error_msg("%s: open failed\n", inode->path);
+		free(buf);
+		return;
+	}
+
+	while(done < size)
+	{
+		ssize_t n = write(fd, buf + done, size - done);
+
+		if(n <= 0)
+		{
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			error_msg("%s: write failed\n", inode->path);
+			break;
+		}
+		done += n;
+	}
+	close(fd);
+	free(buf);
+
+	set_attrs(inode);
+}
+
+static void *write_files(void *arg)
+{
+	while(1)
+	{
+		size_t i;
+
+		pthread_mutex_lock(&job_lock);
+		i = job_next++;
+		pthread_mutex_unlock(&job_lock);
+
+		if(i >= nfiles)
+		{
+			break;
+		}
+		write_file(files[i]);
+	}
+
+	return NULL;
+}
+
+static void write_all(int threads)
+{
+	pthread_t *thread;
+	int *started;
+	int i;
+
+	thread = calloc(threads, sizeof(*thread));
+	started = calloc(threads, sizeof(*started));
+	if(thread == NULL || started == NULL)
+	{
+		threads = 1;
+	}
+
+	for(i = 1; i < threads; i++)
+	{
+		started[i] = pthread_create(&thread[i], NULL, write_files,
+			NULL) == 0;
+	}
+	write_files(NULL);
+	for(i = 1; i < threads; i++)
+	{
+		if(started[i])
+		{
+			pthread_join(thread[i], NULL);
+		}
+	}
+
+	free(thread);
+	free(started);
+}
+
+/*
+ * Device numbers are kept in the old 16 bit or the new 32 bit encoding,
+ * as the data of the latest node, whatever size the inode gives
+ */
+static dev_t device_number(const struct jffs2_inode *inode)
+{
+	const struct jffs2_dnode *d = latest(inode);
+	unsigned char buf[4];
+	uint32_t id;
+
+	if((d->dsize != 2 && d->dsize != 4) || decompress(d, buf) != 0)
+	{
+		error_msg("%s: bad device number\n", inode->path);
+		return 0;
+	}
+
+	if(d->dsize == 2)
+	{
+		id = get16(buf, d->big);
+		return makedev(id >> 8, id & 0xff);
+	}
+
+	id = get32(buf, d->big);
+	return makedev((id & 0xfff00) >> 8, (id & 0xff) | ((id >> 12) & 0xfff00));
+}
+
+static int push(struct jffs2_inode ***list, size_t *n, struct jffs2_inode *inode)
+{
+	if((*n & (*n - 1)) == 0)
+	{
+		struct jffs2_inode **l = realloc(*list,
+			(*n ? *n * 2 : 1) * sizeof(**list));
+
+		if(l == NULL)
+		{
+			error_msg("%s: out of memory\n", inode->path);
+			return -1;
+		}
+		*list = l;
+	}
+	(*list)[(*n)++] = inode;
+
+	return 0;
+}
+
+/*
+ * Creates the entries of a directory and walks its subdirectories.
+ * Regular files are only created here and written by write_all() later;
+ * directories are queued to get their attributes after their contents.
+ */
+static void walk(uint32_t pino, const char *dir)
+{
+	size_t lo = 0, hi = ndirents, i;
+
+	/* the dirents of pino are contiguous from the first one */
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if(dirents[mid].pino < pino)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	for(i = lo; i < ndirents && dirents[i].pino == pino; i++)
+	{
+		const struct jffs2_dirent *e = &dirents[i];
+		struct jffs2_inode *inode = find_inode(e->ino);
+		const struct jffs2_dnode *d;
+		size_t dlen = strlen(dir), len = dlen + 1 + e->nsize;
+		char *path;
+
+		if(len >= PATH_MAX)
+		{
+			error_msg("%s: path too long\n", dir);
+			continue;
+		}
+		path = malloc(len + 1);
+		if(path == NULL)
+		{
+			error_msg("%s: out of memory\n", dir);
+			continue;
+		}
+		memcpy(path, dir, dlen);
+		path[dlen] = '/';
+		memcpy(path + dlen + 1, e->name, e->nsize);
+		path[len] = '\0';
+
+		if(e->nsize == 0 || memchr(e->name, '/', e->nsize) ||
+			memchr(e->name, '\0', e->nsize) ||
+			(e->nsize == 1 && e->name[0] == '.') ||
+			(e->nsize == 2 && e->name[0] == '.' && e->name[1] == '.'))
+		{
+			error_msg("%s: bad file name\n", path);
+			free(path);
+			continue;
+		}
+		if(inode == NULL)
+		{
+			error_msg("%s: no inode\n", path);
+			free(path);
+			continue;
+		}
+		d = latest(inode);
+
+		/* a second name of an inode is a hard link */
+		if(inode->path)
+		{
+			if(S_ISDIR(d->mode) || link(inode->path, path) != 0)
+			{
+				error_msg("%s: link failed\n", path);
+			}
+			free(path);
+			continue;
+		}
+		inode->path = path;
+
+		if(S_ISDIR(d->mode))
+		{
+			if(mkdir(path, 0700) != 0 && errno != EEXIST)
+			{
+				error_msg("%s: mkdir failed\n", path);
+				continue;
+			}
+			walk(e->ino, path);
+			push(&dirs, &ndirs, inode);
+		}
+		else if(S_ISREG(d->mode))
+		{
+			int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+			if(fd < 0)
+			{
+				error_msg("%s: create failed\n", path);
+				continue;
+			}
+			close(fd);
+			push(&files, &nfiles, inode);
+		}
+		else if(S_ISLNK(d->mode))
+		{
+			unsigned char *target;
+			uint32_t size;
+			char *t;
+
+			target = read_inode(inode, &size);
+			t = target ? realloc(target, size + 1) : NULL;
+			if(t == NULL)
+			{
+				free(target);
+				continue;
+			}
+			t[size] = '\0';
+			if(symlink(t, path) != 0)
+			{
+				error_msg("%s: symlink failed\n", path);
+			}
+			else
+			{
+				set_attrs(inode);
+			}
+			free(t);
+		}
+		else if(S_ISCHR(d->mode) || S_ISBLK(d->mode) ||
+			S_ISFIFO(d->mode) || S_ISSOCK(d->mode))
+		{
+			dev_t dev = S_ISCHR(d->mode) || S_ISBLK(d->mode) ?
+				device_number(inode) : 0;
+
+			if(mknod(path, (d->mode & S_IFMT) | 0600, dev) != 0)
+			{
+				error_msg("%s: mknod failed\n", path);
+			}
+			else
+			{
+				set_attrs(inode);
+			}
+		}
+		else
+		{
+			error_msg("%s: unknown file type\n", path);
+		}
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "\nExtracts a JFFS2 image of either byte order to a directory.\n");
+	fprintf(stderr, "Usage: %s [-t threads] <jffs2 image> <directory>\n\n", prog);
+	fprintf(stderr, "\t-t\tthreads to scan and write with (default: CPUs online)\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct jffs2_inode *root;
+	struct stat st;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = cpus > 0 ? cpus : 1;
+	int fd, c;
+	size_t i;
+
+	while((c = getopt(argc, argv, "t:h")) != -1)
+	{
+		switch(c)
+		{
+			case 't':
+				threads = atoi(optarg);
+				if(threads < 1)
+				{
+					threads = 1;
+				}
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if(argc - optind != 2)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fd = open(argv[optind], O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0)
+	{
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	image_size = st.st_size;
+	if(image_size == 0)
+	{
+		fprintf(stderr, "%s: empty image\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	image = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(image == MAP_FAILED)
+	{
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if(scan_image(threads) != 0 || build_tree() != 0)
+	{
+		fprintf(stderr, "%s: no JFFS2 nodes found\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if(mkdir(argv[optind + 1], 0755) != 0 && errno != EEXIST)
+	{
+		perror(argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+
+	/* the root is the output directory, whatever names point at it */
+	root = find_inode(JFFS2_ROOT_INO);
+	if(root)
+	{
+		root->path = argv[optind + 1];
+	}
+
+	is_root = geteuid() == 0;
+	walk(JFFS2_ROOT_INO, argv[optind + 1]);
+	write_all(threads);
+
+	/* the deepest directories come first, so parents are done last */
+	for(i = 0; i < ndirs; i++)
+	{
+		set_attrs(dirs[i]);
+	}
+	if(root && S_ISDIR(latest(root)->mode))
+	{
+		set_attrs(root);
+	}
+
+	printf("%lu files, %lu directories, %d errors\n",
+		(unsigned long) nfiles, (unsigned long) ndirs, errors);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,900 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * mkjffs2.c
+ */
+
+/*
+ * Builds a JFFS2 image of a directory.
+ *
+ * The tree is walked first, giving every entry its inode number and its
+ * dirent its version, so that the nodes of an entry, or of a run of pages
+ * of a large file, can be made by any thread: jobs go round a ring of
+ * MKJFFS2_PIPE_JOBS slots, workers compress them and the main thread lays
+ * them out in order, a cleanmarker at the start of every erase block and
+ * no node across one.  The image is the same whatever the thread count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <endian.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sysmacros.h>
+#include <zlib.h>
+#include <lzma.h>
+
+#include "zbuf.h"
+#include "jffs2.h"
+
+#define MKJFFS2_PIPE_JOBS	64	/* jobs being compressed or waiting */
+#define MKJFFS2_JOB_PAGES	64	/* pages of a file per job */
+#define MKJFFS2_ERASE_SIZE	0x10000	/* mkfs.jffs2's default */
+
+/* A node of the largest size a job can make, padded */
+#define MKJFFS2_NODE_MAX	(JFFS2_INODE_SIZE + JFFS2_PAGE_SIZE)
+#define MKJFFS2_DIRENT_MAX	PAD4(JFFS2_DIRENT_SIZE + 255)
+
+struct entry
+{
+	char *path;
+	const char *name;
+	size_t parent;
+	struct stat st;
+	uint32_t ino;
+	uint32_t version;	/* of its dirent */
+	uint32_t highest;	/* last version used in a directory */
+	size_t link;		/* entry this is a hard link to, or itself */
+};
+
+struct job
+{
+	size_t entry;
+	uint32_t page;
+	uint32_t pages;
+	unsigned char *buf;
+	size_t len;
+	int done;
+};
+
+static struct entry *entries;
+static size_t nentries;
+
+static int big_endian;
+static int compressor = JFFS2_COMPR_ZLIB;
+static int all_root;
+static uint32_t erase_size = MKJFFS2_ERASE_SIZE;
+static int cleanmarkers = 1;
+static int pad;
+static int errors;
+
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	struct job job[MKJFFS2_PIPE_JOBS];
+	unsigned long emitted;
+	unsigned long started;
+	unsigned long queued;
+	int closing;
+} pipe_ = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER
+};
+
+/* The erase block being filled, written out once full */
+static unsigned char *block;
+static uint32_t block_used;
+static int out_fd;
+
+static void error_msg(const char *fmt, const char *arg)
+{
+	pthread_mutex_lock(&pipe_.lock);
+	fprintf(stderr, fmt, arg);
+	errors++;
+	pthread_mutex_unlock(&pipe_.lock);
+}
+
+static void fill_header(unsigned char *p, uint16_t type, uint32_t totlen)
+{
+	put16(p, JFFS2_MAGIC, big_endian);
+	put16(p + 2, type, big_endian);
+	put32(p + 4, totlen, big_endian);
+	put32(p + 8, jffs2_crc32(p, 8), big_endian);
+}
+
+static int add_entry(const char *path, const char *name, size_t parent)
+{
+	struct entry *e;
+
+	if((nentries & (nentries - 1)) == 0)
+	{
+		e = realloc(entries, (nentries ? nentries * 2 : 1) *
+			sizeof(*entries));
+		if(e == NULL)
+		{
+			error_msg("%s: out of memory\n", path);
+			return -1;
+		}
+		entries = e;
+	}
+
+	e = &entries[nentries];
+	memset(e, 0, sizeof(*e));
+	e->path = strdup(path);
+	if(e->path == NULL || lstat(path, &e->st) != 0)
+	{
+		error_msg("%s: cannot stat\n", path);
+		free(e->path);
+		return -1;
+	}
+	e->name = name ? e->path + (name - path) : NULL;
+	e->parent = parent;
+	e->link = nentries++;
+
+	return 0;
+}
+
+/* Adds the entries below a directory, in name order, depth first */
+static void walk(size_t dir)
+{
+	struct dirent **names;
+	int i, n;
+
+	n = scandir(entries[dir].path, &names, NULL, alphasort);
+	if(n < 0)
+	{
+		error_msg("%s: cannot read directory\n", entries[dir].path);
+		return;
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		const char *name = names[i]->d_name;
+		size_t dlen = strlen(entries[dir].path), nlen = strlen(name);
+		char *path;
+
+		if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+		{
+			free(names[i]);
+			continue;
+		}
+		if(nlen > 255 || dlen + 1 + nlen >= PATH_MAX)
+		{
+			error_msg("%s: name too long\n", name);
+			free(names[i]);
+			continue;
+		}
+
+		path = malloc(dlen + 1 + nlen + 1);
+		if(path != NULL)
+		{
+			memcpy(path, entries[dir].path, dlen);
+			path[dlen] = '/';
+			memcpy(path + dlen + 1, name, nlen + 1);
+			if(add_entry(path, path + dlen + 1, dir) == 0 &&
+				S_ISDIR(entries[nentries - 1].st.st_mode))
+			{
+				walk(nentries - 1);
+			}
+			free(path);
+		}
+		free(names[i]);
+	}
+	free(names);
+}
+
+static int link_cmp(const void *a, const void *b)
+{
+	const struct entry *x = &entries[*(const size_t *) a];
+	const struct entry *y = &entries[*(const size_t *) b];
+
+	if(x->st.st_dev != y->st.st_dev)
+	{
+		return x->st.st_dev < y->st.st_dev ? -1 : 1;
+	}
+	if(x->st.st_ino != y->st.st_ino)
+	{
+		return x->st.st_ino < y->st.st_ino ? -1 : 1;
+	}
+
+	return *(const size_t *) a < *(const size_t *) b ? -1 : 1;
+}
+
+/*
+ * Finds the hard links, the later names of a file sharing the first one's
+ * inode, then numbers the inodes and dirent versions in walk order.  A
+ * directory's own inode node is its version 1, its dirents go on from 2.
+ */
+static int number_entries(void)
+{
+	size_t *linked, nlinked = 0, i;
+	uint32_t ino = JFFS2_ROOT_INO;
+
+	linked = malloc((nentries ? nentries : 1) * sizeof(*linked));
+	if(linked == NULL)
+	{
+		return -1;
+	}
+	for(i = 1; i < nentries; i++)
+	{
+		if(!S_ISDIR(entries[i].st.st_mode) && entries[i].st.st_nlink > 1)
+		{
+			linked[nlinked++] = i;
+		}
+	}
+	qsort(linked, nlinked, sizeof(*linked), link_cmp);
+	for(i = 1; i < nlinked; i++)
+	{
+		struct entry *x = &entries[linked[i - 1]], *y = &entries[linked[i]];
+
+		if(x->st.st_dev == y->st.st_dev && x->st.st_ino == y->st.st_ino)
+		{
+			y->link = x->link;
+		}
+	}
+	free(linked);
+
+	for(i = 0; i < nentries; i++)
+	{
+		struct entry *e = &entries[i];
+
+		e->highest = 1;
+		e->ino = e->link == i ? ino++ : entries[e->link].ino;
+		if(i > 0)
+		{
+			e->version = ++entries[e->parent].highest;
+		}
+	}
+
+	return 0;
+}
+
+static unsigned char dirent_type(mode_t mode)
+{
+	switch(mode & S_IFMT)
+	{
+		case S_IFDIR: return DT_DIR;
+		case S_IFREG: return DT_REG;
+		case S_IFLNK: return DT_LNK;
+		case S_IFCHR: return DT_CHR;
+		case S_IFBLK: return DT_BLK;
+		case S_IFIFO: return DT_FIFO;
+		case S_IFSOCK: return DT_SOCK;
+	}
+
+	return DT_UNKNOWN;
+}
+
+static size_t make_dirent(unsigned char *p, const struct entry *e)
+{
+	size_t nsize = strlen(e->name);
+
+	fill_header(p, JFFS2_NODETYPE_DIRENT, JFFS2_DIRENT_SIZE + nsize);
+	put32(p + 12, entries[e->parent].ino, big_endian);
+	put32(p + 16, e->version, big_endian);
+	put32(p + 20, e->ino, big_endian);
+	put32(p + 24, e->st.st_mtime, big_endian);
+	p[28] = nsize;
+	p[29] = dirent_type(e->st.st_mode);
+	p[30] = p[31] = 0;
+	put32(p + 32, jffs2_crc32(p, 32), big_endian);
+	memcpy(p + JFFS2_DIRENT_SIZE, e->name, nsize);
+	put32(p + 36, jffs2_crc32(p + JFFS2_DIRENT_SIZE, nsize), big_endian);
+	memset(p + JFFS2_DIRENT_SIZE + nsize, 0xff,
+		PAD4(JFFS2_DIRENT_SIZE + nsize) - JFFS2_DIRENT_SIZE - nsize);
+
+	return PAD4(JFFS2_DIRENT_SIZE + nsize);
+}
+
+static size_t make_inode(unsigned char *p, const struct entry *e,
+	uint32_t version, uint32_t isize, uint32_t offset,
+	const unsigned char *data, uint32_t csize, uint32_t dsize,
+	unsigned char compr)
+{
+	fill_header(p, JFFS2_NODETYPE_INODE, JFFS2_INODE_SIZE + csize);
+	put32(p + 12, e->ino, big_endian);
+	put32(p + 16, version, big_endian);
+	put32(p + 20, e->st.st_mode, big_endian);
+	put16(p + 24, all_root ? 0 : e->st.st_uid, big_endian);
+	put16(p + 26, all_root ? 0 : e->st.st_gid, big_endian);
+	put32(p + 28, isize, big_endian);
+	put32(p + 32, e->st.st_atime, big_endian);
+	put32(p + 36, e->st.st_mtime, big_endian);
+	put32(p + 40, e->st.st_ctime, big_endian);
+	put32(p + 44, offset, big_endian);
+	put32(p + 48, csize, big_endian);
+	put32(p + 52, dsize, big_endian);
+	p[56] = compr;
+	p[57] = 0;
+	put16(p + 58, 0, big_endian);
+	if(data != p + JFFS2_INODE_SIZE)
+	{
+		memcpy(p + JFFS2_INODE_SIZE, data, csize);
+	}
+	put32(p + 60, jffs2_crc32(p + JFFS2_INODE_SIZE, csize), big_endian);
+	put32(p + 64, jffs2_crc32(p, 60), big_endian);
+	memset(p + JFFS2_INODE_SIZE + csize, 0xff,
+		PAD4(JFFS2_INODE_SIZE + csize) - JFFS2_INODE_SIZE - csize);
+
+	return PAD4(JFFS2_INODE_SIZE + csize);
+}
+
+/* The kernel's rtime compressor; returns the size, or 0 if it is no smaller */
+static uint32_t rtime_compress(const unsigned char *in, uint32_t inlen,
+	unsigned char *out, uint32_t outlen)
+{
+	uint32_t positions[256];
+	uint32_t pos = 0, outpos = 0;
+
+	memset(positions, 0, sizeof(positions));
+
+	while(pos < inlen && outpos + 2 <= outlen)
+	{
+		unsigned char value = in[pos];
+		uint32_t backpos = positions[value], runlen = 0;
+
+		out[outpos++] = in[pos++];
+		positions[value] = pos;
+		while(backpos < pos && pos < inlen && in[pos] == in[backpos++] &&
+			runlen < 255)
+		{
+			pos++;
+			runlen++;
+		}
+		out[outpos++] = runlen;
+	}
+
+	return pos < inlen ? 0 : outpos;
+}
+
+/* Raw LZMA with lc, lp and pb of 0 and no header, as OpenWrt's jffs2 reads */
+static uint32_t lzma_compress(const unsigned char *in, uint32_t inlen,
+	unsigned char *out, uint32_t outlen)
+{
+	lzma_options_lzma opt;
+	lzma_filter filters[2];
+	size_t out_pos = 0;
+
+	lzma_lzma_preset(&opt, 9);
+	opt.lc = 0;
+	opt.lp = 0;
+	opt.pb = 0;
+	opt.dict_size = inlen > LZMA_DICT_SIZE_MIN ? inlen : LZMA_DICT_SIZE_MIN;
+	filters[0].id = LZMA_FILTER_LZMA1;
+	filters[0].options = &opt;
+	filters[1].id = LZMA_VLI_UNKNOWN;
+
+	if(lzma_raw_buffer_encode(filters, NULL, in, inlen, out, &out_pos,
+		outlen) != LZMA_OK)
+	{
+		return 0;
+	}
+
+	return out_pos;
+}
+
+/*
+ * Compresses a page into out, which has room for the page less one byte.
+ * Pages that do not shrink are stored as they are, and pages of zeros
+ * take no data at all.
+ */
+static uint32_t compress_page(const unsigned char *in, uint32_t len,
+	unsigned char *out, unsigned char *compr)
+{
+	unsigned long zlen = len - 1;
+	uint32_t clen = 0, i;
+
+	for(i = 0; i < len && in[i] == 0; i++)
+		;
+	if(i == len)
+	{
+		*compr = JFFS2_COMPR_ZERO;
+		return 0;
+	}
+
+	switch(compressor)
+	{
+		case JFFS2_COMPR_ZLIB:
+			if(zbuf_compress(out, &zlen, in, len, 9) == Z_OK)
+			{
+				clen = zlen;
+			}
+			break;
+		case JFFS2_COMPR_LZMA:
+			clen = lzma_compress(in, len, out, len - 1);
+			break;
+		case JFFS2_COMPR_RTIME:
+			clen = rtime_compress(in, len, out, len - 1);
+			break;
+	}
+
+	if(clen == 0 || clen >= len)
+	{
+		*compr = JFFS2_COMPR_NONE;
+		memcpy(out, in, len);
+		return len;
+	}
+
+	*compr = compressor;
+	return clen;
+}
+
+/* The most bytes the nodes of a job can take */
+static size_t job_size(const struct job *j)
+{
+	return MKJFFS2_DIRENT_MAX + PAD4(JFFS2_INODE_SIZE + PATH_MAX) +
+		(size_t) j->pages * PAD4(MKJFFS2_NODE_MAX);
+}
+
+static void make_regfile(struct job *j, const struct entry *e)
+{
+	uint32_t size = e->st.st_size, first = j->page * JFFS2_PAGE_SIZE;
+	uint32_t len = size - first, i;
+	unsigned char *data;
+	ssize_t n = 0;
+	int fd;
+
+	if(len > j->pages * JFFS2_PAGE_SIZE)
+	{
+		len = j->pages * JFFS2_PAGE_SIZE;
+	}
+
+	data = malloc(len);
+	fd = open(e->path, O_RDONLY);
+	if(data == NULL || fd < 0 ||
+		(n = pread(fd, data, len, first)) != (ssize_t) len)
+	{
+		error_msg("%s: cannot read\n", e->path);
+		if(data != NULL && n >= 0 && n < (ssize_t) len)
+		{
+			memset(data + n, 0, len - n);
+		}
+	}
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+	if(data == NULL)
+	{
+		return;
+	}
+
+	/* data node versions follow the page numbers, from 1 */
+	for(i = 0; i < len; i += JFFS2_PAGE_SIZE)
+	{
+		uint32_t dsize = len - i < JFFS2_PAGE_SIZE ? len - i : JFFS2_PAGE_SIZE;
+		unsigned char *p = j->buf + j->len, compr;
+		uint32_t csize = compress_page(data + i, dsize,
+			p + JFFS2_INODE_SIZE, &compr);
+
+		j->len += make_inode(p, e, j->page + i / JFFS2_PAGE_SIZE + 1,
+			size, first + i, p + JFFS2_INODE_SIZE, csize, dsize, compr);
+	}
+	free(data);
+}
+
+/* Makes the nodes of a job: the dirent with the first, then the inode's */
+static void make_job(struct job *j)
+{
+	const struct entry *e = &entries[j->entry];
+	mode_t mode = e->st.st_mode;
+
+	j->len = 0;
+	j->buf = malloc(job_size(j));
+	if(j->buf == NULL)
+	{
+		error_msg("%s: out of memory\n", e->path);
+		return;
+	}
+
+	if(j->page == 0 && j->entry > 0)
+	{
+		j->len += make_dirent(j->buf, e);
+	}
+	if(e->link != j->entry)
+	{
+		return;
+	}
+
+	if(S_ISREG(mode) && e->st.st_size > 0)
+	{
+		make_regfile(j, e);
+	}
+	else if(S_ISLNK(mode))
+	{
+		char target[PATH_MAX];
+		ssize_t n = readlink(e->path, target, sizeof(target));
+
+		if(n < 0)
+		{
+			error_msg("%s: cannot read link\n", e->path);
+			n = 0;
+		}
+		j->len += make_inode(j->buf + j->len, e, 1, n, 0,
+			(unsigned char *) target, n, n, JFFS2_COMPR_NONE);
+	}
+	else if(S_ISCHR(mode) || S_ISBLK(mode))
+	{
+		unsigned maj = major(e->st.st_rdev), min = minor(e->st.st_rdev);
+		unsigned char dev[4];
+
+		/* the kernel's new_encode_dev() */
+		put32(dev, (min & 0xff) | (maj << 8) | ((min & ~0xff) << 12),
+			big_endian);
+		j->len += make_inode(j->buf + j->len, e, 1, sizeof(dev), 0, dev,
+			sizeof(dev), sizeof(dev), JFFS2_COMPR_NONE);
+	}
+	else
+	{
+		j->len += make_inode(j->buf + j->len, e, 1, 0, 0, NULL, 0, 0,
+			JFFS2_COMPR_NONE);
+	}
+}
+
+static void write_block(uint32_t len)
+{
+	uint32_t done = 0;
+
+	while(done < len)
+	{
+		ssize_t n = write(out_fd, block + done, len - done);
+
+		if(n <= 0)
+		{
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			error_msg("%s: write failed\n", "image");
+			break;
+		}
+		done += n;
+	}
+}
+
+/* Pads out the erase block being filled and writes it */
+static void next_block(void)
+{
+	memset(block + block_used, 0xff, erase_size - block_used);
+	write_block(erase_size);
+	block_used = 0;
+}
+
+static void emit_node(const unsigned char *node, uint32_t len)
+{
+	if(block_used > 0 && block_used + len > erase_size)
+	{
+		next_block();
+	}
+	if(block_used == 0 && cleanmarkers)
+	{
+		fill_header(block, JFFS2_NODETYPE_CLEANMARKER, JFFS2_HEADER_SIZE);
+		block_used = JFFS2_HEADER_SIZE;
+	}
+	memcpy(block + block_used, node, len);
+	block_used += len;
+}
+
+/* Lays out the nodes of a job; each one's size is in its header */
+static void emit_job(struct job *j)
+{
+	size_t pos = 0;
+
+	while(pos < j->len)
+	{
+		uint32_t len = PAD4(get32(j->buf + pos + 4, big_endian));
+
+		emit_node(j->buf + pos, len);
+		pos += len;
+	}
+	free(j->buf);
+	j->buf = NULL;
+}
+
+static void *worker(void *arg)
+{
+	while(1)
+	{
+		struct job *j;
+
+		pthread_mutex_lock(&pipe_.lock);
+		while(pipe_.started == pipe_.queued && !pipe_.closing)
+		{
+			pthread_cond_wait(&pipe_.work, &pipe_.lock);
+		}
+		if(pipe_.started == pipe_.queued)
+		{
+			pthread_mutex_unlock(&pipe_.lock);
+			break;
+		}
+		j = &pipe_.job[pipe_.started++ % MKJFFS2_PIPE_JOBS];
+		pthread_mutex_unlock(&pipe_.lock);
+
+		make_job(j);
+
+		pthread_mutex_lock(&pipe_.lock);
+		j->done = 1;
+		pthread_cond_broadcast(&pipe_.done);
+		pthread_mutex_unlock(&pipe_.lock);
+	}
+
+	return NULL;
+}
+
+/* Emits the oldest job once it is done */
+static void emit_oldest(void)
+{
+	struct job *j = &pipe_.job[pipe_.emitted % MKJFFS2_PIPE_JOBS];
+
+	pthread_mutex_lock(&pipe_.lock);
+	while(!j->done)
+	{
+		pthread_cond_wait(&pipe_.done, &pipe_.lock);
+	}
+	pthread_mutex_unlock(&pipe_.lock);
+
+	emit_job(j);
+	pipe_.emitted++;
+}
+
+static void queue_job(size_t entry, uint32_t page, uint32_t pages, int threads)
+{
+	struct job *j;
+
+	if(pipe_.queued - pipe_.emitted == MKJFFS2_PIPE_JOBS)
+	{
+		emit_oldest();
+	}
+
+	j = &pipe_.job[pipe_.queued % MKJFFS2_PIPE_JOBS];
+	j->entry = entry;
+	j->page = page;
+	j->pages = pages;
+	j->done = 0;
+
+	if(threads == 1)
+	{
+		make_job(j);
+		emit_job(j);
+		return;
+	}
+
+	pthread_mutex_lock(&pipe_.lock);
+	pipe_.queued++;
+	pthread_cond_signal(&pipe_.work);
+	pthread_mutex_unlock(&pipe_.lock);
+}
+
+static void build(int threads)
+{
+	pthread_t *thread = NULL;
+	int *started = NULL, running = 0, i;
+	size_t e;
+
+	if(threads > 1)
+	{
+		thread = calloc(threads, sizeof(*thread));
+		started = calloc(threads, sizeof(*started));
+		if(thread == NULL || started == NULL)
+		{
+			threads = 1;
+		}
+	}
+	for(i = 0; i < threads && threads > 1; i++)
+	{
+		started[i] = pthread_create(&thread[i], NULL, worker, NULL) == 0;
+		running += started[i];
+	}
+	if(threads > 1 && running == 0)
+	{
+		threads = 1;
+	}
+
+	for(e = 0; e < nentries; e++)
+	{
+		const struct entry *en = &entries[e];
+		uint32_t pages = 0, p = 0;
+
+		if(S_ISREG(en->st.st_mode) && en->link == e)
+		{
+			pages = (en->st.st_size + JFFS2_PAGE_SIZE - 1) /
+				JFFS2_PAGE_SIZE;
+		}
+
+		do
+		{
+			uint32_t n = pages - p < MKJFFS2_JOB_PAGES ?
+				pages - p : MKJFFS2_JOB_PAGES;
+
+			queue_job(e, p, n, threads);
+			p += n;
+		}
+		while(p < pages);
+	}
+
+	if(threads > 1)
+	{
+		pthread_mutex_lock(&pipe_.lock);
+		pipe_.closing = 1;
+		pthread_cond_broadcast(&pipe_.work);
+		pthread_mutex_unlock(&pipe_.lock);
+
+		while(pipe_.emitted < pipe_.queued)
+		{
+			emit_oldest();
+		}
+		for(i = 0; i < threads; i++)
+		{
+			if(started[i])
+			{
+				pthread_join(thread[i], NULL);
+			}
+		}
+	}
+	free(thread);
+	free(started);
+
+	if(pad && block_used > 0)
+	{
+		next_block();
+	}
+	else if(block_used > 0)
+	{
+		write_block(block_used);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "\nBuilds a JFFS2 image of a directory.\n");
+	fprintf(stderr, "Usage: %s [options] <directory> <jffs2 image>\n\n", prog);
+	fprintf(stderr, "\t-b\tbig-endian image (default: the host's byte order)\n");
+	fprintf(stderr, "\t-l\tlittle-endian image\n");
+	fprintf(stderr, "\t-c comp\tzlib (default), lzma, rtime or none\n");
+	fprintf(stderr, "\t-e size\terase block size (default: 64KiB)\n");
+	fprintf(stderr, "\t-n\tno cleanmarkers, for NAND\n");
+	fprintf(stderr, "\t-p\tpad the image to a whole erase block\n");
+	fprintf(stderr, "\t-U\tmake all files owned by root\n");
+	fprintf(stderr, "\t-t\tthreads to compress with (default: CPUs online)\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = cpus > 0 ? cpus : 1;
+	char *end;
+	int c;
+
+	big_endian = __BYTE_ORDER == __BIG_ENDIAN;
+
+	while((c = getopt(argc, argv, "blc:e:npUt:h")) != -1)
+	{
+		switch(c)
+		{
+			case 'b':
+				big_endian = 1;
+				break;
+			case 'l':
+				big_endian = 0;
+				break;
+			case 'c':
+				if(strcmp(optarg, "zlib") == 0)
+				{
+					compressor = JFFS2_COMPR_ZLIB;
+				}
+				else if(strcmp(optarg, "lzma") == 0)
+				{
+					compressor = JFFS2_COMPR_LZMA;
+				}
+				else if(strcmp(optarg, "rtime") == 0)
+				{
+					compressor = JFFS2_COMPR_RTIME;
+				}
+				else if(strcmp(optarg, "none") == 0)
+				{
+					compressor = JFFS2_COMPR_NONE;
+				}
+				else
+				{
+					usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'e':
+				erase_size = strtoul(optarg, &end, 0);
+				if(*end == 'k' || *end == 'K')
+				{
+					erase_size *= 1024;
+				}
+				/* room for a full page node and a cleanmarker */
+				if(erase_size < 2 * JFFS2_PAGE_SIZE || erase_size % 4)
+				{
+					fprintf(stderr, "%s: bad erase block size\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'n':
+				cleanmarkers = 0;
+				break;
+			case 'p':
+				pad = 1;
+				break;
+			case 'U':
+				all_root = 1;
+				break;
+			case 't':
+				threads = atoi(optarg);
+				if(threads < 1)
+				{
+					threads = 1;
+				}
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if(argc - optind != 2)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(add_entry(argv[optind], NULL, 0) != 0 ||
+		!S_ISDIR(entries[0].st.st_mode))
+	{
+		fprintf(stderr, "%s: not a directory\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	walk(0);
+	if(number_entries() != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	block = malloc(erase_size);
+	out_fd = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(block == NULL || out_fd < 0)
+	{
+		perror(argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+
+	build(threads);
+
+	if(close(out_fd) != 0)
+	{
+		perror(argv[optind + 1]);
+		errors++;
+	}
+	printf("%lu entries, %d errors\n", (unsigned long) nentries, errors);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
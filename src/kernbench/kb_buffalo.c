@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_buffalo.c
+ *
+ * The checksum and cipher of buffalo-enc, from buffalo-lib.o, against
+ * the byte at a time loops they were written as.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "../firmware-tools/buffalo-lib.h"
+
+#include "kernbench.h"
+
+#define KB_BCRYPT_SEED	'X'
+#define KB_BCRYPT_KEY	"buffalo"
+#define KB_BCRYPT_SEED_KEY	"Xbuffalo"
+
+/* the CRC-32 of sign extended bytes buffalo_csum() stands for */
+static size_t kb_csum_bytewise(const struct kb_input *in, unsigned char *out)
+{
+	const signed char *p = (const signed char *) in->data;
+	uint32_t csum = 0xffffffff;
+	size_t n;
+	int i;
+
+	for(n = 0; n < in->len; n++) {
+		csum ^= p[n];
+		for(i = 0; i < 8; i++)
+			csum = (csum >> 1) ^ (csum & 1 ? 0xedb88320 : 0);
+	}
+
+	return kb_put32(out, csum);
+}
+
+
+static size_t kb_csum_lib(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, buffalo_csum(0xffffffff, (void *) in->data,
+		in->len));
+}
+
+
+struct kb_kernel kb_buffalo_csum = {
+	.name = "buffalo_csum",
+	.source = "firmware-tools/buffalo-lib.c",
+	.variant = {
+		{ "bytewise", NULL, kb_csum_bytewise },
+		{ "crc32_update", NULL, kb_csum_lib },
+	}
+};
+
+
+/* the state stepped with modular arithmetic, as for any length */
+static size_t kb_bcrypt_modular(const struct kb_input *in, unsigned char *out)
+{
+	unsigned char key[] = KB_BCRYPT_SEED_KEY;
+	struct bcrypt_ctx ctx;
+	unsigned char *state;
+	unsigned long i = 0, j = 0, k, len;
+
+	if(bcrypt_init(&ctx, key, sizeof(key) - 1, BCRYPT_DEFAULT_STATE_LEN))
+		return 0;
+	state = ctx.state;
+	len = ctx.state_len;
+
+	for(k = 0; k < in->len; k++) {
+		unsigned char t;
+
+		i = (i + 1) % len;
+		j = (j + state[i]) % len;
+		t = state[j];
+		state[j] = state[i];
+		state[i] = t;
+
+		out[k] = in->data[k] ^ state[(state[i] + state[j]) % len];
+	}
+
+	bcrypt_finish(&ctx);
+	return in->len;
+}
+
+
+static size_t kb_bcrypt_lib(const struct kb_input *in, unsigned char *out)
+{
+	if(bcrypt_buf(KB_BCRYPT_SEED, (unsigned char *) KB_BCRYPT_KEY,
+		(unsigned char *) in->data, out, in->len, 0))
+		return 0;
+
+	return in->len;
+}
+
+
+struct kb_kernel kb_bcrypt = {
+	.name = "bcrypt_process",
+	.source = "firmware-tools/buffalo-lib.c",
+	.variant = {
+		{ "modular", NULL, kb_bcrypt_modular },
+		{ "state256", NULL, kb_bcrypt_lib },
+	}
+};
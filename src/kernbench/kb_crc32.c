@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_crc32.c
+ *
+ * crc32buf() of the header tools, each of the implementations it picks
+ * between.  The source is included so its static ones can be called; it
+ * also provides crc32_update() to buffalo-lib.o.
+ */
+
+#include "../crc32/crc32buf.c"
+
+#include "kernbench.h"
+
+static int kb_crc32_prepare(struct kb_input *in, const unsigned char *raw,
+	size_t len)
+{
+	crc32_init_table();
+	in->data = raw;
+	in->len = in->raw_len = len;
+
+	return 0;
+}
+
+
+static size_t kb_crc32_bitwise(const struct kb_input *in, unsigned char *out)
+{
+	const unsigned char *p = in->data;
+	uint32_t crc = 0xffffffff;
+	size_t n;
+	int i;
+
+	for(n = 0; n < in->len; n++) {
+		crc ^= p[n];
+		for(i = 0; i < 8; i++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+
+	return kb_put32(out, crc);
+}
+
+
+static size_t kb_crc32_slice16(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, crc32_slice16(0xffffffff, in->data, in->len));
+}
+
+
+#ifdef CRC32_PCLMUL
+static int kb_crc32_pclmul_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") &&
+		__builtin_cpu_supports("sse4.1");
+}
+
+
+static size_t kb_crc32_pclmul(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, crc32_pclmul(0xffffffff, in->data, in->len));
+}
+#endif
+
+
+#ifdef CRC32_ARMV8
+static int kb_crc32_armv8_supported(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+
+static size_t kb_crc32_armv8(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, crc32_armv8(0xffffffff, in->data, in->len));
+}
+#endif
+
+
+struct kb_kernel kb_crc32 = {
+	.name = "crc32buf",
+	.source = "crc32/crc32buf.c",
+	.prepare = kb_crc32_prepare,
+	.variant = {
+		{ "bitwise", NULL, kb_crc32_bitwise },
+		{ "slice16", NULL, kb_crc32_slice16 },
+#ifdef CRC32_PCLMUL
+		{ "pclmul", kb_crc32_pclmul_supported, kb_crc32_pclmul },
+#endif
+#ifdef CRC32_ARMV8
+		{ "armv8", kb_crc32_armv8_supported, kb_crc32_armv8 },
+#endif
+	}
+};
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_ecc.c
+ *
+ * nand_calculate_ecc() of nand_ecc, which gathers the parities a word at
+ * a time, against the byte at a time table loop it replaced.
+ */
+
+#define NAND_ECC_LIB
+#include "../firmware-tools/nand_ecc.c"
+
+#include "kernbench.h"
+
+#define KB_ECC_BLOCK	256
+
+/* a whole number of 256 byte blocks, each giving 3 bytes of ECC */
+static int kb_ecc_prepare(struct kb_input *in, const unsigned char *raw,
+	size_t len)
+{
+	if(len < KB_ECC_BLOCK)
+		return -1;
+
+	in->data = raw;
+	in->len = in->raw_len = len - len % KB_ECC_BLOCK;
+
+	return 0;
+}
+
+
+static void kb_ecc_bytewise_block(const uint8_t *dat, uint8_t *ecc_code)
+{
+	uint8_t idx, reg1 = 0, reg2 = 0, reg3 = 0, tmp1, tmp2;
+	int j;
+
+	for(j = 0; j < KB_ECC_BLOCK; j++) {
+		idx = nand_ecc_precalc_table[dat[j]];
+		reg1 ^= idx & 0x3f;
+
+		/* XOR in the offset of every byte of odd parity */
+		if(idx & 0x40) {
+			reg3 ^= (uint8_t) j;
+			reg2 ^= ~((uint8_t) j);
+		}
+	}
+
+	tmp1  = (reg3 & 0x80) >> 0;
+	tmp1 |= (reg2 & 0x80) >> 1;
+	tmp1 |= (reg3 & 0x40) >> 1;
+	tmp1 |= (reg2 & 0x40) >> 2;
+	tmp1 |= (reg3 & 0x20) >> 2;
+	tmp1 |= (reg2 & 0x20) >> 3;
+	tmp1 |= (reg3 & 0x10) >> 3;
+	tmp1 |= (reg2 & 0x10) >> 4;
+
+	tmp2  = (reg3 & 0x08) << 4;
+	tmp2 |= (reg2 & 0x08) << 3;
+	tmp2 |= (reg3 & 0x04) << 3;
+	tmp2 |= (reg2 & 0x04) << 2;
+	tmp2 |= (reg3 & 0x02) << 2;
+	tmp2 |= (reg2 & 0x02) << 1;
+	tmp2 |= (reg3 & 0x01) << 1;
+	tmp2 |= (reg2 & 0x01) << 0;
+
+#ifdef CONFIG_MTD_NAND_ECC_SMC
+	ecc_code[0] = ~tmp2;
+	ecc_code[1] = ~tmp1;
+#else
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+#endif
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+}
+
+
+static size_t kb_ecc_bytewise(const struct kb_input *in, unsigned char *out)
+{
+	size_t n;
+
+	for(n = 0; n < in->len; n += KB_ECC_BLOCK, out += 3)
+		kb_ecc_bytewise_block(in->data + n, out);
+
+	return in->len / KB_ECC_BLOCK * 3;
+}
+
+
+static size_t kb_ecc_words(const struct kb_input *in, unsigned char *out)
+{
+	size_t n;
+
+	for(n = 0; n < in->len; n += KB_ECC_BLOCK, out += 3)
+		nand_calculate_ecc(in->data + n, out);
+
+	return in->len / KB_ECC_BLOCK * 3;
+}
+
+
+struct kb_kernel kb_nand_ecc = {
+	.name = "nand_calculate_ecc",
+	.source = "firmware-tools/nand_ecc.c",
+	.prepare = kb_ecc_prepare,
+	.variant = {
+		{ "bytewise", NULL, kb_ecc_bytewise },
+		{ "words", NULL, kb_ecc_words },
+	}
+};
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_lzma.c
+ *
+ * The LZMA SDK 4.40 decoders libunlzma builds from, for the squashfs 3
+ * lzma tools: LzmaDecode.c, the reference, the LzmaDecodeFast.c of
+ * UseFastDecode and LzmaDecodeSize.c.  The input is the sample data
+ * packed by liblzma with the lc=3 lp=0 pb=2 properties mksquashfs uses.
+ */
+
+#include <string.h>
+#include <lzma.h>
+
+#include "../others/squashfs-3.2-r2-lzma/C/Compress/Lzma/LzmaDecode.c"
+
+#include "kernbench.h"
+#include "kb_lzma_run.h"
+
+/* an lzma_alone header is the properties, then the 8 byte size */
+#define KB_LZMA_ALONE_HEADER	13
+
+static int kb_lzma_prepare(struct kb_input *in, const unsigned char *raw,
+	size_t len)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	lzma_options_lzma opt;
+	size_t size = len + len / 2 + 1024;
+	unsigned char *packed;
+	lzma_ret ret;
+
+	if(lzma_lzma_preset(&opt, 6))
+		return -1;
+	opt.lc = 3;
+	opt.lp = 0;
+	opt.pb = 2;
+
+	packed = malloc(size);
+	if(packed == NULL)
+		return -1;
+
+	if(lzma_alone_encoder(&strm, &opt) != LZMA_OK) {
+		free(packed);
+		return -1;
+	}
+
+	strm.next_in = raw;
+	strm.avail_in = len;
+	strm.next_out = packed;
+	strm.avail_out = size;
+	ret = lzma_code(&strm, LZMA_FINISH);
+	size -= strm.avail_out;
+	lzma_end(&strm);
+
+	if(ret != LZMA_STREAM_END) {
+		free(packed);
+		return -1;
+	}
+
+	/* keep the properties, drop the size the SDK decoder doesn't read */
+	memmove(packed + LZMA_PROPERTIES_SIZE, packed + KB_LZMA_ALONE_HEADER,
+		size - KB_LZMA_ALONE_HEADER);
+
+	in->data = packed;
+	in->len = size - (KB_LZMA_ALONE_HEADER - LZMA_PROPERTIES_SIZE);
+	in->raw_len = len;
+
+	return 0;
+}
+
+
+static void kb_lzma_release(struct kb_input *in)
+{
+	free((void *) in->data);
+}
+
+
+struct kb_kernel kb_lzma = {
+	.name = "LzmaDecode",
+	.source = "others/squashfs-3.2-r2-lzma/C/Compress/Lzma",
+	.prepare = kb_lzma_prepare,
+	.release = kb_lzma_release,
+	.variant = {
+		{ "LzmaDecode", NULL, kb_lzma_decode },
+		{ "LzmaDecodeFast", NULL, kb_lzma_fast_run },
+		{ "LzmaDecodeSize", NULL, kb_lzma_size_run },
+	}
+};
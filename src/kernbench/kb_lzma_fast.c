@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_lzma_fast.c
+ *
+ * LzmaDecodeFast.c, the whole buffer decoder of UseFastDecode, renamed
+ * so it links beside the LzmaDecode.c of kb_lzma.c.
+ */
+
+#define LzmaDecode kb_LzmaDecodeFast
+#define LzmaDecodeProperties kb_LzmaDecodePropertiesFast
+
+#include "../others/squashfs-3.2-r2-lzma/C/Compress/Lzma/LzmaDecodeFast.c"
+
+#include "kernbench.h"
+#include "kb_lzma_run.h"
+
+size_t kb_lzma_fast_run(const struct kb_input *in, unsigned char *out)
+{
+	return kb_lzma_decode(in, out);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_lzma_run.h
+ *
+ * The whole buffer decode of kb_lzma*.c, one copy in each so LzmaDecode
+ * names the decoder that file built.  The input holds the 5 property
+ * bytes and then the stream, and decodes to raw_len bytes.
+ */
+
+#include <stdlib.h>
+
+static size_t kb_lzma_decode(const struct kb_input *in, unsigned char *out)
+{
+	CLzmaDecoderState st;
+	SizeT in_done, out_done;
+	int res;
+
+	if(in->len < LZMA_PROPERTIES_SIZE || LzmaDecodeProperties(&st.Properties,
+			in->data, LZMA_PROPERTIES_SIZE) != LZMA_RESULT_OK)
+		return 0;
+
+	st.Probs = malloc(LzmaGetNumProbs(&st.Properties) * sizeof(CProb));
+	if(st.Probs == NULL)
+		return 0;
+
+	res = LzmaDecode(&st, in->data + LZMA_PROPERTIES_SIZE,
+		in->len - LZMA_PROPERTIES_SIZE, &in_done, out, in->raw_len,
+		&out_done);
+	free(st.Probs);
+
+	return res == LZMA_RESULT_OK ? out_done : 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_unpack.c
+ *
+ * unpack_decode() of bff_huffman_decompress, which resolves codes through
+ * a table, against the tree walk a bit at a time it replaced.  The input
+ * is the sample data packed here in pack(1)'s format.
+ */
+
+#define BFF_UNPACK_LIB
+#include "../bff/bff_huffman_decompress.c"
+
+#include "kernbench.h"
+
+#define KB_PACK_SYMBOLS		257	/* the bytes and EOB */
+
+struct kb_pack_node {
+	unsigned long freq;
+	int left, right;
+};
+
+/*
+ * Huffman code lengths for freq[], 0 for unused symbols.  Returns the
+ * longest.
+ */
+static int kb_pack_lengths(const unsigned long *freq, int *bits)
+{
+	struct kb_pack_node node[2 * KB_PACK_SYMBOLS];
+	int live[KB_PACK_SYMBOLS], depth[2 * KB_PACK_SYMBOLS];
+	int n = 0, nodes = KB_PACK_SYMBOLS, i, j, k, max = 0;
+
+	for(i = 0; i < KB_PACK_SYMBOLS; i++) {
+		node[i].freq = freq[i];
+		node[i].left = node[i].right = -1;
+		bits[i] = 0;
+		if(freq[i])
+			live[n++] = i;
+	}
+
+	/* join the two lightest until one tree is left */
+	while(n > 1) {
+		int a, b;
+
+		for(a = 0, i = 1; i < n; i++)
+			if(node[live[i]].freq < node[live[a]].freq)
+				a = i;
+		for(b = a ? 0 : 1, i = 0; i < n; i++)
+			if(i != a && node[live[i]].freq < node[live[b]].freq)
+				b = i;
+
+		node[nodes].freq = node[live[a]].freq + node[live[b]].freq;
+		node[nodes].left = live[a];
+		node[nodes].right = live[b];
+		live[a] = nodes++;
+		live[b] = live[--n];
+	}
+
+	/* parents are made after their children, so walk down from the root */
+	depth[nodes - 1] = 0;
+	for(k = nodes - 1; k >= KB_PACK_SYMBOLS; k--)
+		for(j = 0; j < 2; j++) {
+			i = j ? node[k].right : node[k].left;
+			depth[i] = depth[k] + 1;
+			if(i < KB_PACK_SYMBOLS) {
+				bits[i] = depth[i];
+				if(depth[i] > max)
+					max = depth[i];
+			}
+		}
+
+	return max;
+}
+
+
+struct kb_pack_bits {
+	unsigned char *p;
+	unsigned int acc;
+	int count;
+};
+
+static void kb_pack_put(struct kb_pack_bits *pb, unsigned int code, int bits)
+{
+	while(bits--) {
+		pb->acc = pb->acc << 1 | ((code >> bits) & 1);
+		if(++pb->count == 8) {
+			*pb->p++ = pb->acc;
+			pb->acc = pb->count = 0;
+		}
+	}
+}
+
+
+/*
+ * Packs raw the way pack(1) would: the level count, the leaves at each
+ * level with the last level's less 2, the symbols but EOB level by
+ * level, then the codes.  At each level the inner nodes take the lowest
+ * codes and the leaves follow in symbol table order, EOB the last leaf
+ * of all; that is the tree unpack_parse_tables() rebuilds.
+ */
+static int kb_unpack_prepare(struct kb_input *in, const unsigned char *raw,
+	size_t len)
+{
+	unsigned long freq[KB_PACK_SYMBOLS];
+	int bits[KB_PACK_SYMBOLS], leaves[HTREE_MAXLEVEL + 1];
+	int inodes[HTREE_MAXLEVEL + 1];
+	unsigned int code[KB_PACK_SYMBOLS], next[HTREE_MAXLEVEL + 1];
+	int levels, i, l, eob = KB_PACK_SYMBOLS - 1;
+	struct kb_pack_bits pb;
+	unsigned char *packed;
+	size_t n;
+
+	if(len == 0)
+		return -1;
+
+	memset(freq, 0, sizeof(freq));
+	for(n = 0; n < len; n++)
+		freq[raw[n]]++;
+	freq[eob] = 1;
+
+	/* flatten the counts until the tree fits pack(1)'s 24 levels */
+	while((levels = kb_pack_lengths(freq, bits)) > HTREE_MAXLEVEL)
+		for(i = 0; i < KB_PACK_SYMBOLS; i++)
+			if(freq[i])
+				freq[i] = (freq[i] + 1) / 2;
+
+	/* EOB has to be one of the longest codes */
+	for(i = 0; i < eob && bits[eob] < levels; i++)
+		if(bits[i] == levels) {
+			bits[i] = bits[eob];
+			bits[eob] = levels;
+		}
+
+	memset(leaves, 0, sizeof(leaves));
+	for(i = 0; i < KB_PACK_SYMBOLS; i++)
+		if(bits[i])
+			leaves[bits[i] - 1]++;
+
+	inodes[levels - 1] = 0;
+	for(l = levels - 2; l >= 0; l--)
+		inodes[l] = (inodes[l + 1] + leaves[l + 1]) / 2;
+	for(l = 0; l < levels; l++)
+		next[l] = inodes[l];
+	for(i = 0; i < KB_PACK_SYMBOLS; i++)
+		if(bits[i])
+			code[i] = next[bits[i] - 1]++;
+
+	/* each code is at most 3 bytes, and EOB pads the last one out */
+	packed = malloc(1 + levels + KB_PACK_SYMBOLS + len * 3 + 4);
+	if(packed == NULL)
+		return -1;
+
+	pb.p = packed;
+	*pb.p++ = levels;
+	for(l = 0; l < levels; l++)
+		*pb.p++ = l == levels - 1 ? leaves[l] - 2 : leaves[l];
+	for(l = 0; l < levels; l++)
+		for(i = 0; i < eob; i++)
+			if(bits[i] == l + 1)
+				*pb.p++ = i;
+
+	pb.acc = pb.count = 0;
+	for(n = 0; n < len; n++)
+		kb_pack_put(&pb, code[raw[n]], bits[raw[n]]);
+	kb_pack_put(&pb, code[eob], bits[eob]);
+	if(pb.count)
+		kb_pack_put(&pb, 0, 8 - pb.count);
+
+	in->data = packed;
+	in->len = pb.p - packed;
+	in->raw_len = len;
+
+	return 0;
+}
+
+
+static void kb_unpack_release(struct kb_input *in)
+{
+	free((void *) in->data);
+}
+
+
+/* the tree walked a bit at a time from the bytes after the tables */
+static size_t kb_unpack_bitwise(const struct kb_input *in, unsigned char *out)
+{
+	unpack_descriptor_t unpackd;
+	int levels, thislevel, thiscode, inlevelindex, bit;
+	size_t pos, n = 0;
+
+	memset(&unpackd, 0, sizeof(unpackd));
+	unpackd.fpIn = fmemopen((void *) in->data, in->len, "r");
+	if(unpackd.fpIn == NULL)
+		return 0;
+
+	if((levels = fgetc(unpackd.fpIn)) == EOF ||
+			unpack_parse_tables(&unpackd, levels, NULL))
+		goto finished;
+
+	pos = ftell(unpackd.fpIn) * 8;
+	thislevel = thiscode = 0;
+	for(; pos < in->len * 8; pos++) {
+		bit = (in->data[pos / 8] >> (7 - pos % 8)) & 1;
+		thiscode = thiscode << 1 | bit;
+
+		if(thiscode >= unpackd.inodesin[thislevel]) {
+			inlevelindex = thiscode - unpackd.inodesin[thislevel];
+			if(inlevelindex >= unpackd.symbolsin[thislevel])
+				break;
+			if(&unpackd.tree[thislevel][inlevelindex] ==
+					unpackd.symbol_eob)
+				break;
+			out[n++] = unpackd.tree[thislevel][inlevelindex];
+			thislevel = thiscode = 0;
+		} else if(++thislevel > unpackd.treelevels)
+			break;
+	}
+
+finished:
+	unpack_descriptor_fini(&unpackd);
+	return n;
+}
+
+
+static size_t kb_unpack_table(const struct kb_input *in, unsigned char *out)
+{
+	FILE *fin, *fout;
+	off_t n = 0;
+
+	fin = fmemopen((void *) in->data, in->len, "r");
+	fout = fmemopen(out, in->raw_len + KB_OUT_SLACK, "w");
+	if(fin && fout)
+		n = unpack_stream(fin, fout);
+	if(fin)
+		fclose(fin);
+	if(fout)
+		fclose(fout);
+
+	return n;
+}
+
+
+struct kb_kernel kb_unpack = {
+	.name = "unpack_decode",
+	.source = "bff/bff_huffman_decompress.c",
+	.prepare = kb_unpack_prepare,
+	.release = kb_unpack_release,
+	.variant = {
+		{ "bitwise", NULL, kb_unpack_bitwise },
+		{ "table", NULL, kb_unpack_table },
+	}
+};
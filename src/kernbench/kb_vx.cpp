@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_vx.cpp
+ *
+ * Checksum_Linksys_WRT54Gv5_v6() of wrt_vx_imgtool, as built for SSE2,
+ * against the word at a time sum it replaced.  The tool is included in
+ * a namespace of its own, its headers first so they stay outside it;
+ * kb_vx_scalar.cpp builds it again without SSE2.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace vx_sse2 {
+#define WRT_VX_IMGTOOL_LIB
+#include "../wrt_vx_imgtool/wrt54gv5_img.cpp"
+}
+
+#include "kernbench.h"
+
+// big endian words, the last padded with zeros, summed one at a time
+static size_t kb_vx_wordwise(const struct kb_input *in, unsigned char *out)
+{
+	const unsigned char *p = in->data;
+	unsigned long nI;
+	unsigned int nSum = 0;
+
+	for(nI = 0; nI + 4 <= in->len; nI += 4)
+		nSum += (unsigned int)p[nI] << 24 | (unsigned int)p[nI + 1] << 16 |
+			(unsigned int)p[nI + 2] << 8 | p[nI + 3];
+	for(int nJ = 0; nI < in->len; nI++, nJ++)
+		nSum += (unsigned int)p[nI] << (24 - nJ * 8);
+
+	return kb_put32(out, ~(nSum - 1));
+}
+
+
+static size_t kb_vx_sse2(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, vx_sse2::Checksum_Linksys_WRT54Gv5_v6(in->data,
+		in->len));
+}
+
+
+struct kb_kernel kb_vx_checksum = {
+	"Checksum_Linksys_WRT54Gv5_v6",
+	"wrt_vx_imgtool/wrt54gv5_img.cpp",
+	0,
+	NULL,
+	NULL,
+	{
+		{ "wordwise", NULL, kb_vx_wordwise },
+		{ "partial_sums", NULL, kb_vx_scalar_run },
+#ifdef __SSE2__
+		{ "sse2", NULL, kb_vx_sse2 },
+#endif
+	}
+};
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_vx_scalar.cpp
+ *
+ * wrt_vx_imgtool's checksum as built where there is no SSE2, the four
+ * partial sums of SumBigEndianWords(), for kb_vx.cpp.
+ */
+
+#undef __SSE2__
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace vx_scalar {
+#define WRT_VX_IMGTOOL_LIB
+#include "../wrt_vx_imgtool/wrt54gv5_img.cpp"
+}
+
+#include "kernbench.h"
+
+size_t kb_vx_scalar_run(const struct kb_input *in, unsigned char *out)
+{
+	return kb_put32(out, vx_scalar::Checksum_Linksys_WRT54Gv5_v6(in->data,
+		in->len));
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kb_xor.c
+ *
+ * xor_data() of xorimage, each of the routines it dispatches between.
+ * They xor the buffer in place, so the same buffer is run over and over
+ * once timing starts; xoring twice is as much work as once.
+ */
+
+#define XORIMAGE_LIB
+#include "../firmware-tools/xorimage.c"
+
+#include "kernbench.h"
+
+static int kb_xor_prepare(struct kb_input *in, const unsigned char *raw,
+	size_t len)
+{
+	uint8_t *wide;
+
+	wide = xor_widen(default_pattern, strlen(default_pattern));
+	if(wide == NULL)
+		return -1;
+
+	in->data = raw;
+	in->len = in->raw_len = len;
+	in->priv = wide;
+
+	return 0;
+}
+
+
+static void kb_xor_release(struct kb_input *in)
+{
+	free(in->priv);
+}
+
+
+#define KB_XOR_VARIANT(fn) \
+static size_t kb_##fn(const struct kb_input *in, unsigned char *out) \
+{ \
+	fn(out, in->len, in->priv, strlen(default_pattern), 0); \
+	return in->len; \
+}
+
+KB_XOR_VARIANT(xor_tail)
+KB_XOR_VARIANT(xor_generic)
+
+#ifdef XOR_X86
+KB_XOR_VARIANT(xor_sse2)
+KB_XOR_VARIANT(xor_avx2)
+
+static int kb_xor_sse2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+
+static int kb_xor_avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+
+struct kb_kernel kb_xor = {
+	.name = "xor_data",
+	.source = "firmware-tools/xorimage.c",
+	.inplace = 1,
+	.prepare = kb_xor_prepare,
+	.release = kb_xor_release,
+	.variant = {
+		{ "bytewise", NULL, kb_xor_tail },
+		{ "generic", NULL, kb_xor_generic },
+#ifdef XOR_X86
+		{ "sse2", kb_xor_sse2_supported, kb_xor_sse2 },
+		{ "avx2", kb_xor_avx2_supported, kb_xor_avx2 },
+#endif
+	}
+};
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kernbench.c
+ *
+ * Benchmark the hot loops of the header and image tools, each variant
+ * of a kernel against the plain reference it must match.  Every variant
+ * is first checked byte for byte against the reference over odd sizes
+ * and unaligned starts, then timed at each size, reporting the time per
+ * call, MB/s of the data it stands for, and the speedup over the
+ * reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "kernbench.h"
+
+#define ERROR(s, args...)	fprintf(stderr, s, ## args)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ## args);\
+			exit(1);\
+		} while(0)
+
+#define TRUE		1
+#define FALSE		0
+
+#define MAX_SIZES		16
+#define MAX_KERNELS		16
+#define DEFAULT_MIN_TIME	0.2
+#define MAX_OFFSET		7	/* unaligned starts checked */
+
+static struct kb_kernel *kernel[] = {
+	&kb_crc32, &kb_buffalo_csum, &kb_nand_ecc, &kb_xor, &kb_bcrypt,
+	&kb_unpack, &kb_lzma, &kb_vx_checksum, NULL
+};
+
+static const size_t default_size[] = { 64, 256, 4096, 65536, 1048576 };
+
+/* lengths around the block and word sizes the variants step by */
+static const size_t check_size[] = { 1, 3, 4, 7, 15, 16, 17, 31, 33, 63,
+	255, 256, 257, 511, 768, 1000, 4095, 4096, 4097, 65536 + 13 };
+
+static const char *word[] = {
+	"the ", "squashfs ", "firmware ", "image ", "header ", "kernel ",
+	"root ", "/bin/busybox ", "0x80000000 ", "\n", "\t", "lzma ",
+	"cramfs ", "checksum ", "=", "; ", "config ", "uImage ", "ecc ",
+	"nvram "
+};
+
+static uint64_t xorshift = 0x2545f4914f6cdd1dULL;
+
+static uint64_t next_random(void)
+{
+	xorshift ^= xorshift << 13;
+	xorshift ^= xorshift >> 7;
+	xorshift ^= xorshift << 17;
+	return xorshift;
+}
+
+
+/*
+ * Sample data like the insides of an image: mostly words and text, runs
+ * of zeros, and the odd stretch of random bytes, so it compresses.
+ */
+static void make_sample(unsigned char *buf, size_t len)
+{
+	size_t n = 0;
+
+	while(n < len) {
+		uint64_t r = next_random();
+		size_t run = 1 + (r >> 8) % 64;
+
+		if((r & 15) == 0) {
+			for(; run && n < len; run--)
+				buf[n++] = next_random() >> 24;
+		} else if((r & 15) == 1) {
+			for(; run && n < len; run--)
+				buf[n++] = 0;
+		} else {
+			const char *w = word[(r >> 16) % (sizeof(word) /
+				sizeof(word[0]))];
+
+			for(; *w && n < len; w++)
+				buf[n++] = *w;
+		}
+	}
+}
+
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int supported(const struct kb_variant *v)
+{
+	return v->supported == NULL || v->supported();
+}
+
+
+static int variants(const struct kb_kernel *k)
+{
+	int i;
+
+	for(i = 0; i < KB_MAX_VARIANTS && k->variant[i].name; i++);
+	return i;
+}
+
+
+static unsigned char *out_buffer(const struct kb_input *in)
+{
+	unsigned char *out = malloc((in->len > in->raw_len ? in->len :
+		in->raw_len) + KB_OUT_SLACK);
+
+	if(out == NULL)
+		BAD_ERROR("Out of memory in out_buffer\n");
+	return out;
+}
+
+
+static size_t run_once(const struct kb_kernel *k, const struct kb_variant *v,
+	const struct kb_input *in, unsigned char *out)
+{
+	if(k->inplace)
+		memcpy(out, in->data, in->len);
+	return v->run(in, out);
+}
+
+
+/*
+ * Check every variant the CPU runs against the reference, for len bytes
+ * of sample data starting offset bytes in.  Returns the number that
+ * differ, 0 for a length the kernel can't take.
+ */
+static int check(const struct kb_kernel *k, const unsigned char *sample,
+	size_t offset, size_t len)
+{
+	struct kb_input in;
+	unsigned char *ref, *out;
+	size_t ref_len, out_len;
+	int i, bad = 0;
+
+	memset(&in, 0, sizeof(in));
+	if(k->prepare) {
+		if(k->prepare(&in, sample + offset, len) == -1)
+			return 0;
+	} else {
+		in.data = sample + offset;
+		in.len = in.raw_len = len;
+	}
+
+	ref = out_buffer(&in);
+	out = out_buffer(&in);
+	ref_len = run_once(k, &k->variant[0], &in, ref);
+
+	for(i = 1; i < variants(k); i++) {
+		if(!supported(&k->variant[i]))
+			continue;
+
+		memset(out, 0xa5, in.len > in.raw_len ? in.len : in.raw_len);
+		out_len = run_once(k, &k->variant[i], &in, out);
+		if(out_len != ref_len || memcmp(out, ref, ref_len)) {
+			ERROR("kernbench: %s/%s differs from %s at size %zu "
+				"offset %zu\n", k->name, k->variant[i].name,
+				k->variant[0].name, len, offset);
+			bad++;
+		}
+	}
+
+	free(ref);
+	free(out);
+	if(k->release)
+		k->release(&in);
+
+	return bad;
+}
+
+
+/* time each variant at len bytes, the iterations doubled to min_time */
+static void bench(const struct kb_kernel *k, const unsigned char *sample,
+	size_t len, double min_time)
+{
+	struct kb_input in;
+	unsigned char *out;
+	double ref_ns = 0;
+	int i;
+
+	memset(&in, 0, sizeof(in));
+	if(k->prepare) {
+		if(k->prepare(&in, sample, len) == -1)
+			return;
+	} else {
+		in.data = sample;
+		in.len = in.raw_len = len;
+	}
+
+	out = out_buffer(&in);
+
+	for(i = 0; i < variants(k); i++) {
+		const struct kb_variant *v = &k->variant[i];
+		char name[128];
+		long long iters, n;
+		double start, secs, ns;
+
+		snprintf(name, sizeof(name), "%s/%s/%zu", k->name, v->name,
+			len);
+		if(!supported(v)) {
+			printf("%-48s %s\n", name, "not supported by this CPU");
+			continue;
+		}
+
+		run_once(k, v, &in, out);
+		for(iters = 1; ; iters *= 2) {
+			start = now();
+			for(n = 0; n < iters; n++)
+				v->run(&in, out);
+			secs = now() - start;
+			if(secs >= min_time)
+				break;
+		}
+
+		ns = secs * 1e9 / iters;
+		if(i == 0)
+			ref_ns = ns;
+		printf("%-48s %12.1f %11lld %10.2f %7.2f\n", name, ns, iters,
+			in.raw_len * iters / secs / 1048576, ref_ns / ns);
+		fflush(stdout);
+	}
+
+	free(out);
+	if(k->release)
+		k->release(&in);
+}
+
+
+static void usage(char *name)
+{
+	int i;
+
+	ERROR("SYNTAX: %s [options]\n\n", name);
+	ERROR("Checks each variant of the kernels below against the first, "
+		"its reference,\nthen times them, reporting ns per call, "
+		"iterations, MB/s of sample data\nand the speedup over the "
+		"reference.\n\n");
+	ERROR("Options are\n");
+	ERROR("-kernel <name>\t\tbenchmark <name>, can be given more than "
+		"once.\n\t\t\tDefault all the kernels below\n");
+	ERROR("-size <bytes>\t\tsize to benchmark, can be given more than "
+		"once.\n\t\t\tDefault 64 256 4096 65536 1048576\n");
+	ERROR("-time <seconds>\t\tshortest time to run each for.  Default "
+		"%g\n", DEFAULT_MIN_TIME);
+	ERROR("-check\t\t\tonly check the variants against the references\n");
+	ERROR("\nKernels:\n");
+	for(i = 0; kernel[i]; i++)
+		ERROR("\t%-30s %s\n", kernel[i]->name, kernel[i]->source);
+	exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct kb_kernel *chosen[MAX_KERNELS];
+	size_t size[MAX_SIZES], max = 0;
+	int i, j, kernels = 0, sizes = 0, check_only = FALSE, bad = 0;
+	double min_time = DEFAULT_MIN_TIME;
+	unsigned char *sample;
+	size_t off;
+
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-kernel") == 0) {
+			if(++i == argc) {
+				ERROR("%s: -kernel missing kernel name\n",
+					argv[0]);
+				exit(1);
+			}
+			for(j = 0; kernel[j] && strcmp(kernel[j]->name,
+					argv[i]); j++);
+			if(kernel[j] == NULL) {
+				ERROR("%s: no kernel \"%s\"\n", argv[0],
+					argv[i]);
+				usage(argv[0]);
+			}
+			if(kernels == MAX_KERNELS) {
+				ERROR("%s: too many -kernel\n", argv[0]);
+				exit(1);
+			}
+			chosen[kernels++] = kernel[j];
+		} else if(strcmp(argv[i], "-size") == 0) {
+			char *b;
+			long long s;
+
+			if(++i == argc) {
+				ERROR("%s: -size missing size\n", argv[0]);
+				exit(1);
+			}
+			s = strtoll(argv[i], &b, 10);
+			if(*b == 'm' || *b == 'M')
+				s *= 1048576;
+			else if(*b == 'k' || *b == 'K')
+				s *= 1024;
+			else if(*b != '\0')
+				s = 0;
+			if(s < 1) {
+				ERROR("%s: -size invalid size\n", argv[0]);
+				exit(1);
+			}
+			if(sizes == MAX_SIZES) {
+				ERROR("%s: too many -size\n", argv[0]);
+				exit(1);
+			}
+			size[sizes++] = s;
+		} else if(strcmp(argv[i], "-time") == 0) {
+			if((++i == argc) || (min_time = atof(argv[i])) <= 0) {
+				ERROR("%s: -time missing or invalid time\n",
+					argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-check") == 0)
+			check_only = TRUE;
+		else
+			usage(argv[0]);
+	}
+
+	if(kernels == 0)
+		for(; kernel[kernels]; kernels++)
+			chosen[kernels] = kernel[kernels];
+
+	if(sizes == 0)
+		for(; sizes < sizeof(default_size) / sizeof(default_size[0]);
+				sizes++)
+			size[sizes] = default_size[sizes];
+
+	for(i = 0; i < sizes; i++)
+		if(size[i] > max)
+			max = size[i];
+	for(i = 0; i < sizeof(check_size) / sizeof(check_size[0]); i++)
+		if(check_size[i] > max)
+			max = check_size[i];
+
+	sample = malloc(max + MAX_OFFSET);
+	if(sample == NULL)
+		BAD_ERROR("Out of memory in main\n");
+	make_sample(sample, max + MAX_OFFSET);
+
+	for(i = 0; i < kernels; i++) {
+		for(j = 0; j < sizeof(check_size) / sizeof(check_size[0]); j++)
+			for(off = 0; off <= MAX_OFFSET; off += 3)
+				bad += check(chosen[i], sample, off,
+					check_size[j]);
+		for(j = 0; j < sizes; j++)
+			bad += check(chosen[i], sample, 1, size[j]);
+	}
+
+	printf("%d kernels checked, %s\n", kernels, bad ? "MISMATCHES" :
+		"all variants match their reference");
+	if(bad || check_only)
+		return bad != 0;
+
+	printf("\n%-48s %12s %11s %10s %7s\n", "Benchmark", "Time(ns)",
+		"Iterations", "MB/s", "x ref");
+	for(i = 0; i < kernels; i++)
+		for(j = 0; j < sizes; j++)
+			bench(chosen[i], sample, size[j], min_time);
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * kernbench.h
+ *
+ * The kernels kernbench measures.  Each kb_*.c file builds one from the
+ * tool it lives in, and describes it as a struct kb_kernel: how to make
+ * its input from a buffer of sample data, and its variants, the first a
+ * plain reference the others must match byte for byte.
+ */
+
+#ifndef KERNBENCH_H
+#define KERNBENCH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KB_MAX_VARIANTS		6
+
+/* room a variant may write past the length of the sample data */
+#define KB_OUT_SLACK		64
+
+struct kb_input {
+	const unsigned char *data;	/* what the kernel reads */
+	size_t len;
+	size_t raw_len;		/* the sample bytes it stands for, which
+				   throughput is counted in */
+	void *priv;
+};
+
+struct kb_variant {
+	const char *name;
+	/* NULL when every CPU the variant is built for runs it */
+	int (*supported)(void);
+	/* writes the result to out and returns its length */
+	size_t (*run)(const struct kb_input *in, unsigned char *out);
+};
+
+struct kb_kernel {
+	const char *name;
+	const char *source;
+	/* run() works on out in place, filled with the input beforehand */
+	int inplace;
+	/* makes the input from len bytes of sample data, NULL to use the
+	   data as it is; returns -1 for a length the kernel can't take */
+	int (*prepare)(struct kb_input *in, const unsigned char *raw,
+		size_t len);
+	void (*release)(struct kb_input *in);
+	struct kb_variant variant[KB_MAX_VARIANTS];
+};
+
+extern struct kb_kernel kb_crc32, kb_buffalo_csum, kb_nand_ecc, kb_xor,
+	kb_bcrypt, kb_unpack, kb_lzma, kb_vx_checksum;
+
+/* the variants built in files of their own, beside the kernel's */
+extern size_t kb_lzma_fast_run(const struct kb_input *in, unsigned char *out);
+extern size_t kb_lzma_size_run(const struct kb_input *in, unsigned char *out);
+extern size_t kb_vx_scalar_run(const struct kb_input *in, unsigned char *out);
+
+/* stores the 32 bit value v little endian, returning the 4 bytes */
+static inline size_t kb_put32(unsigned char *out, unsigned int v)
+{
+	out[0] = v;
+	out[1] = v >> 8;
+	out[2] = v >> 16;
+	out[3] = v >> 24;
+
+	return 4;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,283 @@
+// MT.cpp
+
+#include "../StdAfx.h"
+
+#include "MT.h"
+#include "../../../../Common/Alloc.h"
+
+static void *MatchFinderThread(void *param)
+{
+  ((CMatchFinderMT *)param)->Process();
+  return 0;
+}
+
+STDMETHODIMP CMatchFinderMTCallback::BeforeChangingBufferPos()
+{
+  Owner->BeforeChangingBufferPos();
+  return S_OK;
+}
+
+STDMETHODIMP CMatchFinderMTCallback::AfterChangingBufferPos()
+{
+  return S_OK;
+}
+
+CMatchFinderMT::CMatchFinderMT():
+  _distances(0),
+  _numFilled(0),
+  _threadCreated(false)
+{
+  for (UInt32 i = 0; i < kMTNumBlocks; i++)
+    _blocks[i].Buffer = 0;
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_canFill, NULL);
+  pthread_cond_init(&_filled, NULL);
+  CMatchFinderMTCallback *callbackSpec = new CMatchFinderMTCallback;
+  callbackSpec->Owner = this;
+  _callback = callbackSpec;
+}
+
+CMatchFinderMT::~CMatchFinderMT()
+{
+  StopThread();
+  FreeBlocks();
+  pthread_cond_destroy(&_filled);
+  pthread_cond_destroy(&_canFill);
+  pthread_mutex_destroy(&_mutex);
+}
+
+void CMatchFinderMT::FreeBlocks()
+{
+  for (UInt32 i = 0; i < kMTNumBlocks; i++)
+  {
+    ::MyFree(_blocks[i].Buffer);
+    _blocks[i].Buffer = 0;
+  }
+  ::MyFree(_distances);
+  _distances = 0;
+}
+
+HRESULT CMatchFinderMT::SetMatchFinder(IMatchFinder *matchFinder)
+{
+  CMyComPtr<IMatchFinderSetCallback> setCallback;
+  matchFinder->QueryInterface(IID_IMatchFinderSetCallback, (void **)&setCallback);
+  // the window must not move under the encoder
+  if (!setCallback)
+    return E_INVALIDARG;
+  RINOK(setCallback->SetCallback(_callback));
+  _matchFinder = matchFinder;
+  return S_OK;
+}
+
+STDMETHODIMP CMatchFinderMT::Create(UInt32 historySize, UInt32 keepAddBufferBefore, 
+    UInt32 matchMaxLen, UInt32 keepAddBufferAfter)
+{
+  StopThread();
+  FreeBlocks();
+  if (matchMaxLen + 2 > kMTBlockSize)
+    return E_INVALIDARG;
+  _matchMaxLen = matchMaxLen;
+  _distances = (UInt32 *)::MyAlloc((matchMaxLen + 1) * sizeof(UInt32));
+  if (_distances == 0)
+    return E_OUTOFMEMORY;
+  for (UInt32 i = 0; i < kMTNumBlocks; i++)
+  {
+    _blocks[i].Buffer = (UInt32 *)::MyAlloc(kMTBlockSize * sizeof(UInt32));
+    if (_blocks[i].Buffer == 0)
+      return E_OUTOFMEMORY;
+  }
+  return _matchFinder->Create(historySize, keepAddBufferBefore, 
+      matchMaxLen, keepAddBufferAfter);
+}
+
+STDMETHODIMP CMatchFinderMT::Init(ISequentialInStream *inStream)
+{
+  StopThread();
+  RINOK(_matchFinder->Init(inStream));
+  _numFilled = 0;
+  _fillIndex = 0;
+  _readIndex = 0;
+  _stop = false;
+  if (pthread_create(&_thread, NULL, MatchFinderThread, this) != 0)
+    return E_FAIL;
+  _threadCreated = true;
+  GetBlock();
+  if (_left == 0)
+    return _blocks[_readIndex].Result;
+  return S_OK;
+}
+
+STDMETHODIMP_(void) CMatchFinderMT::ReleaseStream()
+{
+  StopThread();
+  _matchFinder->ReleaseStream();
+}
+
+void CMatchFinderMT::StopThread()
+{
+  if (!_threadCreated)
+    return;
+  pthread_mutex_lock(&_mutex);
+  _stop = true;
+  pthread_cond_signal(&_canFill);
+  pthread_mutex_unlock(&_mutex);
+  pthread_join(_thread, NULL);
+  _threadCreated = false;
+}
+
+///////////////////////////////////////////
+// Match finder thread
+
+void CMatchFinderMT::Publish(UInt32 numPositions, HRESULT result)
+{
+  CMTBlock &block = _blocks[_fillIndex];
+  block.NumPositions = numPositions;
+  block.Result = result;
+  _fillIndex = (_fillIndex + 1) % kMTNumBlocks;
+  pthread_mutex_lock(&_mutex);
+  _numFilled++;
+  pthread_cond_signal(&_filled);
+  pthread_mutex_unlock(&_mutex);
+}
+
+void CMatchFinderMT::Process()
+{
+  HRESULT result = S_OK;
+  while (true)
+  {
+    pthread_mutex_lock(&_mutex);
+    while (_numFilled == kMTNumBlocks && !_stop)
+      pthread_cond_wait(&_canFill, &_mutex);
+    bool stop = _stop;
+    pthread_mutex_unlock(&_mutex);
+    if (stop)
+      return;
+
+    if (result != S_OK)
+    {
+      Publish(0, result);
+      return;
+    }
+
+    CMTBlock &block = _blocks[_fillIndex];
+    UInt32 *items = block.Buffer;
+    const UInt32 *itemsLimit = items + kMTBlockSize - (_matchMaxLen + 2);
+    block.DataPos = _matchFinder->GetPointerToCurrentPos();
+    _fillPositions = 0;
+    _fillPublished = false;
+    do
+    {
+      UInt32 numAvail = _matchFinder->GetNumAvailableBytes();
+      items[0] = numAvail;
+      _fillPositions++;
+      if (numAvail == 0)
+      {
+        // the encoder never moves past the end of the stream
+        items[1] = 0;
+        Publish(_fillPositions, E_FAIL);
+        return;
+      }
+      // every position is matched, which leaves the tree as
+      // DummyLongestMatch would
+      UInt32 len = _matchFinder->GetLongestMatch(_distances);
+      items[1] = len;
+      for (UInt32 i = 1; i <= len; i++)
+        items[1 + i] = _distances[i];
+      items += 2 + len;
+      result = _matchFinder->MovePos();
+    }
+    while (result == S_OK && !_fillPublished && items <= itemsLimit);
+
+    if (!_fillPublished)
+    {
+      Publish(_fillPositions, result);
+      if (result != S_OK)
+        return;
+    }
+  }
+}
+
+// Called from the match finder's MovePos before it moves the window.
+// The positions so far go out as a block, then the thread waits until
+// the encoder has left every block that points into the old window.
+void CMatchFinderMT::BeforeChangingBufferPos()
+{
+  Publish(_fillPositions, S_OK);
+  _fillPublished = true;
+  pthread_mutex_lock(&_mutex);
+  while (_numFilled != 0 && !_stop)
+    pthread_cond_wait(&_canFill, &_mutex);
+  pthread_mutex_unlock(&_mutex);
+}
+
+///////////////////////////////////////////
+// Encoder side
+
+void CMatchFinderMT::GetBlock()
+{
+  pthread_mutex_lock(&_mutex);
+  while (_numFilled == 0)
+    pthread_cond_wait(&_filled, &_mutex);
+  pthread_mutex_unlock(&_mutex);
+  const CMTBlock &block = _blocks[_readIndex];
+  _cur = block.Buffer;
+  _dataPos = block.DataPos;
+  _left = block.NumPositions;
+  _numAvail = (_left != 0) ? _cur[0] : 0;
+}
+
+STDMETHODIMP CMatchFinderMT::MovePos()
+{
+  _dataPos++;
+  if (--_left != 0)
+  {
+    _cur += 2 + _cur[1];
+    _numAvail = _cur[0];
+    return S_OK;
+  }
+  RINOK(_blocks[_readIndex].Result);
+  pthread_mutex_lock(&_mutex);
+  _readIndex = (_readIndex + 1) % kMTNumBlocks;
+  _numFilled--;
+  pthread_cond_signal(&_canFill);
+  pthread_mutex_unlock(&_mutex);
+  GetBlock();
+  if (_left == 0)
+    return _blocks[_readIndex].Result;
+  return S_OK;
+}
+
+STDMETHODIMP_(UInt32) CMatchFinderMT::GetLongestMatch(UInt32 *distances)
+{
+  UInt32 len = _cur[1];
+  for (UInt32 i = 1; i <= len; i++)
+    distances[i] = _cur[1 + i];
+  return len;
+}
+
+STDMETHODIMP_(void) CMatchFinderMT::DummyLongestMatch()
+{
+}
+
+STDMETHODIMP_(Byte) CMatchFinderMT::GetIndexByte(Int32 index)
+  { return _dataPos[index]; }
+
+// same as CLZInWindow::GetMatchLen, which only has to stop early at the
+// end of the stream
+STDMETHODIMP_(UInt32) CMatchFinderMT::GetMatchLen(Int32 index, 
+    UInt32 distance, UInt32 limit)
+{
+  if (index + (Int32)limit > (Int32)_numAvail)
+    limit = _numAvail - index;
+  distance++;
+  const Byte *pby = _dataPos + index;
+  UInt32 i;
+  for(i = 0; i < limit && pby[i] == pby[(size_t)i - distance]; i++);
+  return i;
+}
+
+STDMETHODIMP_(UInt32) CMatchFinderMT::GetNumAvailableBytes()
+  { return _numAvail; }
+
+STDMETHODIMP_(const Byte *) CMatchFinderMT::GetPointerToCurrentPos()
+  { return _dataPos; }
@@ -0,0 +1,104 @@
+// MT.h
+
+#ifndef __LZ_MT_H
+#define __LZ_MT_H
+
+#include <pthread.h>
+
+#include "../../../../Common/MyCom.h"
+#include "../../../IStream.h"
+#include "../IMatchFinder.h"
+
+// The match finder runs on its own thread and hands the results for each
+// position to the encoder in blocks. An item is
+//   numAvailableBytes, len, distances[1..len]
+// and a block holds the items of a run of positions that all share one
+// window buffer, so the encoder reads the data through the block's pointer.
+
+const UInt32 kMTNumBlocks = 4;
+const UInt32 kMTBlockSize = (1 << 15); // in UInt32 items
+
+struct CMTBlock
+{
+  UInt32 *Buffer;
+  const Byte *DataPos;  // window pointer of the first position
+  UInt32 NumPositions;
+  HRESULT Result;       // result of MovePos after the last position
+};
+
+class CMatchFinderMT;
+
+class CMatchFinderMTCallback:
+  public IMatchFinderCallback,
+  public CMyUnknownImp
+{
+public:
+  CMatchFinderMT *Owner;
+
+  virtual ~CMatchFinderMTCallback() {}
+
+  MY_UNKNOWN_IMP
+
+  STDMETHOD(BeforeChangingBufferPos)();
+  STDMETHOD(AfterChangingBufferPos)();
+};
+
+class CMatchFinderMT:
+  public IMatchFinder,
+  public CMyUnknownImp
+{
+  CMyComPtr<IMatchFinder> _matchFinder;
+  CMyComPtr<IMatchFinderCallback> _callback;
+  UInt32 _matchMaxLen;
+  UInt32 *_distances;
+
+  // shared with the thread
+  CMTBlock _blocks[kMTNumBlocks];
+  UInt32 _numFilled;
+  bool _stop;
+  bool _threadCreated;
+  pthread_t _thread;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _canFill;
+  pthread_cond_t _filled;
+
+  // thread side
+  UInt32 _fillIndex;
+  UInt32 _fillPositions;
+  bool _fillPublished;
+
+  // encoder side
+  UInt32 _readIndex;
+  const UInt32 *_cur;
+  const Byte *_dataPos;
+  UInt32 _left;
+  UInt32 _numAvail;
+
+  void Publish(UInt32 numPositions, HRESULT result);
+  void GetBlock();
+  void StopThread();
+  void FreeBlocks();
+
+  MY_UNKNOWN_IMP
+
+  STDMETHOD(Init)(ISequentialInStream *inStream);
+  STDMETHOD_(void, ReleaseStream)();
+  STDMETHOD(MovePos)();
+  STDMETHOD_(Byte, GetIndexByte)(Int32 index);
+  STDMETHOD_(UInt32, GetMatchLen)(Int32 index, UInt32 back, UInt32 limit);
+  STDMETHOD_(UInt32, GetNumAvailableBytes)();
+  STDMETHOD_(const Byte *, GetPointerToCurrentPos)();
+  STDMETHOD(Create)(UInt32 historySize, UInt32 keepAddBufferBefore,
+      UInt32 matchMaxLen, UInt32 keepAddBufferAfter);
+  STDMETHOD_(UInt32, GetLongestMatch)(UInt32 *distances);
+  STDMETHOD_(void, DummyLongestMatch)();
+
+public:
+  CMatchFinderMT();
+  virtual ~CMatchFinderMT();
+  HRESULT SetMatchFinder(IMatchFinder *matchFinder);
+  void Process();
+  void BeforeChangingBufferPos();
+};
+
+#endif
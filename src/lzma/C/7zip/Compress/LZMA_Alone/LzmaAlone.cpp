@@ -28,6 +28,11 @@
 #include "LzmaBench.h"
 #include "LzmaRam.h"
 
+#ifdef COMPRESS_MT
+#include <unistd.h>
+#include "LzmaChunk.h"
+#endif
+
 extern "C"
 {
 #include "LzmaRamDecode.h"
@@ -63,6 +68,11 @@ enum Enum
   kLitPos,
   kPosBits,
   kMatchFinder,
+  kMultiThread,
+  kChunk,
+  kChunkIndex,
+  kChunkThreads,
+  kChunkExtract,
   kEOS,
   kStdIn,
   kStdOut,
@@ -81,6 +91,11 @@ static const CSwitchForm kSwitchForms[] =
   { L"LP", NSwitchType::kUnLimitedPostString, false, 1 },
   { L"PB", NSwitchType::kUnLimitedPostString, false, 1 },
   { L"MF", NSwitchType::kUnLimitedPostString, false, 1 },
+  { L"MT", NSwitchType::kSimple, false },
+  { L"C", NSwitchType::kUnLimitedPostString, false, 1 },
+  { L"CI", NSwitchType::kSimple, false },
+  { L"CT", NSwitchType::kUnLimitedPostString, false, 1 },
+  { L"CX", NSwitchType::kUnLimitedPostString, false, 1 },
   { L"EOS", NSwitchType::kSimple, false },
   { L"SI",  NSwitchType::kSimple, false },
   { L"SO",  NSwitchType::kSimple, false },
@@ -104,6 +119,15 @@ static void PrintHelp()
     "  -pb{N}: set number of pos bits - [0, 4], default: 2\n"
     "  -mf{MF_ID}: set Match Finder: [bt2, bt3, bt4, bt4b, pat2r, pat2,\n"
     "              pat2h, pat3h, pat4h, hc3, hc4], default: bt4\n"
+    #ifdef COMPRESS_MF_MT
+    "  -mt:    run the match finder on a second thread\n"
+    #endif
+    #ifdef COMPRESS_MT
+    "  -c{N}:  compress chunks of 2^N bytes independently - [16, 30]\n"
+    "  -ci:    write an index of the chunks\n"
+    "  -ct{N}: number of threads for chunks, default: number of CPUs\n"
+    "  -cx{N}: decode chunk N only\n"
+    #endif
     "  -eos:   write End Of Stream marker\n"
     "  -si:    read data from stdin\n"
     "  -so:    write data to stdout\n"
@@ -202,6 +226,17 @@ int main2(int n, const char *args[])
   if (parser[NKey::kMatchFinder].ThereIs)
     mf = parser[NKey::kMatchFinder].PostStrings[0];
 
+  #ifdef COMPRESS_MT
+  UInt32 numThreads = 1;
+  long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+  if (numProcessors > 1)
+    numThreads = (UInt32)numProcessors;
+  if(parser[NKey::kChunkThreads].ThereIs)
+    if (!GetNumber(parser[NKey::kChunkThreads].PostStrings[0], numThreads) ||
+        numThreads == 0)
+      IncorrectCommand();
+  #endif
+
   if (command.CompareNoCase(L"b") == 0)
   {
     const UInt32 kNumDefaultItereations = 10;
@@ -417,6 +452,47 @@ int main2(int n, const char *args[])
 
     if (encoderSpec->SetCoderProperties(propIDs, properties, kNumProps) != S_OK)
       IncorrectCommand();
+
+    if(parser[NKey::kMultiThread].ThereIs)
+    {
+      #ifdef COMPRESS_MF_MT
+      PROPID propID = NCoderPropID::kMultiThread;
+      PROPVARIANT property;
+      property.vt = VT_BOOL;
+      property.boolVal = VARIANT_TRUE;
+      if (encoderSpec->SetCoderProperties(&propID, &property, 1) != S_OK)
+        IncorrectCommand();
+      #else
+      IncorrectCommand();
+      #endif
+    }
+
+    #ifdef COMPRESS_MT
+    if(parser[NKey::kChunk].ThereIs)
+    {
+      UInt32 chunkLog;
+      if (!GetNumber(parser[NKey::kChunk].PostStrings[0], chunkLog) ||
+          chunkLog < kChunkLogMin || chunkLog > kChunkLogMax)
+        IncorrectCommand();
+      if (stdInMode)
+        throw "Can not use stdin in this mode";
+      inStreamSpec->File.GetLength(fileSize);
+      HRESULT result = LzmaChunkEncode(inStream, outStream, fileSize, 
+          chunkLog, parser[NKey::kChunkIndex].ThereIs, numThreads, 
+          propIDs, properties, kNumProps, parser[NKey::kMultiThread].ThereIs);
+      if (result == E_OUTOFMEMORY)
+      {
+        fprintf(stderr, "\nError: Can not allocate memory\n");
+        return 1;
+      }   
+      else if (result != S_OK)
+      {
+        fprintf(stderr, "\nEncoder error = %X\n", (unsigned int)result);
+        return 1;
+      }   
+      return 0;
+    }
+    #endif
     encoderSpec->WriteCoderProperties(outStream);
 
     if (eos || stdInMode)
@@ -463,6 +539,36 @@ int main2(int n, const char *args[])
       fprintf(stderr, kReadError);
       return 1;
     }
+    #ifdef COMPRESS_MT
+    if (LzmaChunkIsSignature(properties))
+    {
+      HRESULT result;
+      if(parser[NKey::kChunkExtract].ThereIs)
+      {
+        UInt32 segment;
+        if (!GetNumber(parser[NKey::kChunkExtract].PostStrings[0], segment))
+          IncorrectCommand();
+        if (stdInMode)
+          throw "Can not use stdin in this mode";
+        result = LzmaChunkDecodeSegment(inStreamSpec, outStream, segment);
+      }
+      else
+        result = LzmaChunkDecode(inStream, outStream, numThreads);
+      if (result == E_INVALIDARG)
+      {
+        fprintf(stderr, "There is no such chunk");
+        return 1;
+      }
+      if (result != S_OK)
+      {
+        fprintf(stderr, "Decoder error");
+        return 1;
+      }   
+      return 0;
+    }
+    if(parser[NKey::kChunkExtract].ThereIs)
+      throw "Input is not chunked";
+    #endif
     if (decoderSpec->SetDecoderProperties2(properties, kPropertiesSize) != S_OK)
     {
       fprintf(stderr, "SetDecoderProperties error");
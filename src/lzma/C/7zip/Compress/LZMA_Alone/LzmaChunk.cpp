@@ -0,0 +1,463 @@
+// LzmaChunk.cpp
+
+#include "StdAfx.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../../../Common/Alloc.h"
+#include "../../../Common/Vector.h"
+#include "../../Common/StreamUtils.h"
+#include "../LZMA/LZMADecoder.h"
+#include "../LZMA/LZMAEncoder.h"
+#include "LzmaChunk.h"
+
+static const Byte kChunkSignature[kChunkSignatureSize] =
+    { 0xFF, 'L', 'Z', 'C', 1 };
+static const UInt32 kLzmaHeaderSize = 5 + 8;
+static const UInt32 kMaxNumProperties = 16;
+
+class CInChunkStream:
+  public ISequentialInStream,
+  public CMyUnknownImp
+{
+  const Byte *Data;
+  UInt32 Size;
+  UInt32 Pos;
+public:
+  virtual ~CInChunkStream() {}
+  MY_UNKNOWN_IMP
+  void Init(const Byte *data, UInt32 size)
+  {
+    Data = data;
+    Size = size;
+    Pos = 0;
+  }
+  STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize);
+};
+
+STDMETHODIMP CInChunkStream::Read(void *data, UInt32 size, UInt32 *processedSize)
+{
+  if (size > Size - Pos)
+    size = Size - Pos;
+  memcpy(data, Data + Pos, size);
+  Pos += size;
+  if(processedSize != NULL)
+    *processedSize = size;
+  return S_OK;
+}
+
+class COutChunkStream:
+  public ISequentialOutStream,
+  public CMyUnknownImp
+{
+  Byte *Data;
+  UInt32 Size;
+public:
+  UInt32 Pos;
+  virtual ~COutChunkStream() {}
+  MY_UNKNOWN_IMP
+  void Init(Byte *data, UInt32 size)
+  {
+    Data = data;
+    Size = size;
+    Pos = 0;
+  }
+  STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize);
+};
+
+STDMETHODIMP COutChunkStream::Write(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  UInt32 rem = Size - Pos;
+  UInt32 cur = (size < rem) ? size : rem;
+  memcpy(Data + Pos, data, cur);
+  Pos += cur;
+  if(processedSize != NULL)
+    *processedSize = cur;
+  return (cur == size) ? S_OK : E_FAIL;
+}
+
+static void SetUInt64(Byte *p, UInt64 value)
+{
+  for (int i = 0; i < 8; i++)
+    p[i] = Byte(value >> (8 * i));
+}
+
+static UInt64 GetUInt64(const Byte *p)
+{
+  UInt64 value = 0;
+  for (int i = 0; i < 8; i++)
+    value |= ((UInt64)p[i]) << (8 * i);
+  return value;
+}
+
+static UInt32 GetUInt32(const Byte *p)
+{
+  return p[0] | ((UInt32)p[1] << 8) | ((UInt32)p[2] << 16) |
+      ((UInt32)p[3] << 24);
+}
+
+// the same bound LzmaRamEncode uses for incompressible data
+static UInt32 GetPackSizeMax(UInt32 chunkSize)
+{
+  return chunkSize / 20 * 21 + (1 << 16);
+}
+
+struct CChunkSettings
+{
+  const PROPID *PropIDs;
+  const PROPVARIANT *Properties;
+  UInt32 NumProperties;
+  bool MultiThread;
+};
+
+struct CChunk
+{
+  Byte *InBuffer;
+  UInt32 InSize;
+  Byte *OutBuffer;
+  UInt32 OutSize;
+  HRESULT Result;
+  pthread_t Thread;
+  const CChunkSettings *Settings;
+};
+
+// Buffers and threads of the chunks coded at the same time
+class CChunks
+{
+  UInt32 _numThreads;
+public:
+  CChunk *Items;
+  CChunks(): Items(0) {}
+  ~CChunks()
+  {
+    if (Items == 0)
+      return;
+    for (UInt32 i = 0; i < _numThreads; i++)
+    {
+      ::MyFree(Items[i].InBuffer);
+      ::MyFree(Items[i].OutBuffer);
+    }
+    delete []Items;
+  }
+  bool Create(UInt32 numThreads, UInt32 inSize, UInt32 outSize)
+  {
+    _numThreads = numThreads;
+    Items = new CChunk[numThreads];
+    for (UInt32 i = 0; i < numThreads; i++)
+      Items[i].InBuffer = Items[i].OutBuffer = 0;
+    for (UInt32 i = 0; i < numThreads; i++)
+    {
+      Items[i].InBuffer = (Byte *)::MyAlloc(inSize);
+      Items[i].OutBuffer = (Byte *)::MyAlloc(outSize);
+      if ((Items[i].InBuffer == 0 && inSize != 0) ||
+          (Items[i].OutBuffer == 0 && outSize != 0))
+        return false;
+    }
+    return true;
+  }
+  HRESULT Start(UInt32 index, void *(*func)(void *))
+  {
+    if (pthread_create(&Items[index].Thread, NULL, func, &Items[index]) != 0)
+      return E_FAIL;
+    return S_OK;
+  }
+  // waits for the first numItems chunks, and returns the first error
+  HRESULT Wait(UInt32 numItems)
+  {
+    HRESULT result = S_OK;
+    for (UInt32 i = 0; i < numItems; i++)
+    {
+      pthread_join(Items[i].Thread, NULL);
+      if (result == S_OK)
+        result = Items[i].Result;
+    }
+    return result;
+  }
+};
+
+static HRESULT EncodeChunk(CChunk &chunk)
+{
+  const CChunkSettings &settings = *chunk.Settings;
+  NCompress::NLZMA::CEncoder *encoderSpec =
+      new NCompress::NLZMA::CEncoder;
+  CMyComPtr<ICompressCoder> encoder = encoderSpec;
+  RINOK(encoderSpec->SetCoderProperties(settings.PropIDs,
+      settings.Properties, settings.NumProperties));
+  #ifdef COMPRESS_MF_MT
+  if (settings.MultiThread)
+  {
+    PROPID propID = NCoderPropID::kMultiThread;
+    PROPVARIANT property;
+    property.vt = VT_BOOL;
+    property.boolVal = VARIANT_TRUE;
+    RINOK(encoderSpec->SetCoderProperties(&propID, &property, 1));
+  }
+  #endif
+
+  CInChunkStream *inStreamSpec = new CInChunkStream;
+  CMyComPtr<ISequentialInStream> inStream = inStreamSpec;
+  inStreamSpec->Init(chunk.InBuffer, chunk.InSize);
+  COutChunkStream *outStreamSpec = new COutChunkStream;
+  CMyComPtr<ISequentialOutStream> outStream = outStreamSpec;
+  outStreamSpec->Init(chunk.OutBuffer, chunk.OutSize);
+
+  RINOK(encoderSpec->WriteCoderProperties(outStream));
+  Byte sizeBuf[8];
+  SetUInt64(sizeBuf, chunk.InSize);
+  RINOK(WriteStream(outStream, sizeBuf, 8, 0));
+  RINOK(encoder->Code(inStream, outStream, 0, 0, 0));
+  chunk.OutSize = outStreamSpec->Pos;
+  return S_OK;
+}
+
+// InBuffer holds the .lzma stream, OutSize is the size it must unpack to
+static HRESULT DecodeChunk(CChunk &chunk)
+{
+  if (chunk.InSize < kLzmaHeaderSize)
+    return S_FALSE;
+  UInt64 outSize = GetUInt64(chunk.InBuffer + 5);
+  if (outSize != chunk.OutSize)
+    return S_FALSE;
+  NCompress::NLZMA::CDecoder *decoderSpec =
+      new NCompress::NLZMA::CDecoder;
+  CMyComPtr<ICompressCoder> decoder = decoderSpec;
+  RINOK(decoderSpec->SetDecoderProperties2(chunk.InBuffer, 5));
+
+  CInChunkStream *inStreamSpec = new CInChunkStream;
+  CMyComPtr<ISequentialInStream> inStream = inStreamSpec;
+  inStreamSpec->Init(chunk.InBuffer + kLzmaHeaderSize,
+      chunk.InSize - kLzmaHeaderSize);
+  COutChunkStream *outStreamSpec = new COutChunkStream;
+  CMyComPtr<ISequentialOutStream> outStream = outStreamSpec;
+  outStreamSpec->Init(chunk.OutBuffer, chunk.OutSize);
+
+  RINOK(decoder->Code(inStream, outStream, 0, &outSize, 0));
+  if (outStreamSpec->Pos != chunk.OutSize)
+    return S_FALSE;
+  return S_OK;
+}
+
+static void *EncodeChunkThread(void *param)
+{
+  CChunk &chunk = *(CChunk *)param;
+  chunk.Result = EncodeChunk(chunk);
+  return 0;
+}
+
+static void *DecodeChunkThread(void *param)
+{
+  CChunk &chunk = *(CChunk *)param;
+  chunk.Result = DecodeChunk(chunk);
+  return 0;
+}
+
+static HRESULT ReadFull(ISequentialInStream *stream, void *data, UInt32 size)
+{
+  UInt32 processedSize;
+  RINOK(ReadStream(stream, data, size, &processedSize));
+  return (processedSize == size) ? S_OK : S_FALSE;
+}
+
+bool LzmaChunkIsSignature(const Byte *data)
+{
+  return memcmp(data, kChunkSignature, kChunkSignatureSize) == 0;
+}
+
+HRESULT LzmaChunkEncode(ISequentialInStream *inStream,
+    ISequentialOutStream *outStream, UInt64 unpackSize, int chunkLog,
+    bool writeIndex, UInt32 numThreads, const PROPID *propIDs,
+    const PROPVARIANT *properties, UInt32 numProperties, bool multiThread)
+{
+  if (chunkLog < kChunkLogMin || chunkLog > kChunkLogMax ||
+      numThreads == 0 || numProperties > kMaxNumProperties)
+    return E_INVALIDARG;
+  UInt32 chunkSize = (UInt32)1 << chunkLog;
+  UInt64 numChunks = (unpackSize + chunkSize - 1) >> chunkLog;
+  if (numThreads > numChunks)
+    numThreads = (numChunks == 0) ? 1 : (UInt32)numChunks;
+
+  // a dictionary bigger than the chunk only costs memory
+  PROPVARIANT props[kMaxNumProperties];
+  for (UInt32 p = 0; p < numProperties; p++)
+  {
+    props[p] = properties[p];
+    if (propIDs[p] == NCoderPropID::kDictionarySize &&
+        props[p].ulVal > chunkSize)
+      props[p].ulVal = chunkSize;
+  }
+  CChunkSettings settings;
+  settings.PropIDs = propIDs;
+  settings.Properties = props;
+  settings.NumProperties = numProperties;
+  settings.MultiThread = multiThread;
+
+  UInt32 inSizeMax = (unpackSize < chunkSize) ? (UInt32)unpackSize : chunkSize;
+  CChunks chunks;
+  if (!chunks.Create(numThreads, inSizeMax, GetPackSizeMax(inSizeMax)))
+    return E_OUTOFMEMORY;
+
+  Byte header[kChunkHeaderSize];
+  memcpy(header, kChunkSignature, kChunkSignatureSize);
+  header[kChunkSignatureSize] = writeIndex ? kChunkFlagIndex : 0;
+  header[kChunkSignatureSize + 1] = (Byte)chunkLog;
+  SetUInt64(header + kChunkSignatureSize + 2, unpackSize);
+  RINOK(WriteStream(outStream, header, kChunkHeaderSize, 0));
+
+  CRecordVector<UInt64> offsets;
+  UInt64 offset = kChunkHeaderSize;
+  UInt64 pos = 0;
+  while (pos < unpackSize)
+  {
+    // each chunk starts coding as soon as it is read
+    UInt32 numItems;
+    HRESULT readResult = S_OK;
+    for (numItems = 0; numItems < numThreads && pos < unpackSize; numItems++)
+    {
+      CChunk &chunk = chunks.Items[numItems];
+      UInt64 rem = unpackSize - pos;
+      chunk.InSize = (rem < chunkSize) ? (UInt32)rem : chunkSize;
+      chunk.OutSize = GetPackSizeMax(chunk.InSize);
+      chunk.Settings = &settings;
+      readResult = ReadFull(inStream, chunk.InBuffer, chunk.InSize);
+      if (readResult == S_OK)
+        readResult = chunks.Start(numItems, EncodeChunkThread);
+      if (readResult != S_OK)
+        break;
+      pos += chunk.InSize;
+    }
+    HRESULT result = chunks.Wait(numItems);
+    RINOK(readResult);
+    RINOK(result);
+    for (UInt32 i = 0; i < numItems; i++)
+    {
+      const CChunk &chunk = chunks.Items[i];
+      Byte sizeBuf[4];
+      for (int b = 0; b < 4; b++)
+        sizeBuf[b] = Byte(chunk.OutSize >> (8 * b));
+      RINOK(WriteStream(outStream, sizeBuf, 4, 0));
+      RINOK(WriteStream(outStream, chunk.OutBuffer, chunk.OutSize, 0));
+      offsets.Add(offset);
+      offset += 4 + chunk.OutSize;
+    }
+  }
+
+  if (writeIndex)
+    for (int i = 0; i < offsets.Size(); i++)
+    {
+      Byte buf[8];
+      SetUInt64(buf, offsets[i]);
+      RINOK(WriteStream(outStream, buf, 8, 0));
+    }
+  return S_OK;
+}
+
+static HRESULT ReadHeader(ISequentialInStream *inStream, Byte &flags,
+    int &chunkLog, UInt64 &unpackSize, UInt64 &numChunks)
+{
+  Byte header[kChunkHeaderSize - kChunkSignatureSize];
+  RINOK(ReadFull(inStream, header, sizeof(header)));
+  flags = header[0];
+  chunkLog = header[1];
+  unpackSize = GetUInt64(header + 2);
+  if (chunkLog < kChunkLogMin || chunkLog > kChunkLogMax)
+    return S_FALSE;
+  numChunks = (unpackSize + ((UInt32)1 << chunkLog) - 1) >> chunkLog;
+  return S_OK;
+}
+
+// reads the size field and the .lzma stream of a chunk
+static HRESULT ReadChunk(ISequentialInStream *inStream, CChunk &chunk)
+{
+  Byte sizeBuf[4];
+  RINOK(ReadFull(inStream, sizeBuf, 4));
+  chunk.InSize = GetUInt32(sizeBuf);
+  if (chunk.InSize > GetPackSizeMax(chunk.OutSize))
+    return S_FALSE;
+  return ReadFull(inStream, chunk.InBuffer, chunk.InSize);
+}
+
+HRESULT LzmaChunkDecode(ISequentialInStream *inStream,
+    ISequentialOutStream *outStream, UInt32 numThreads)
+{
+  Byte flags;
+  int chunkLog;
+  UInt64 unpackSize, numChunks;
+  RINOK(ReadHeader(inStream, flags, chunkLog, unpackSize, numChunks));
+  UInt32 chunkSize = (UInt32)1 << chunkLog;
+  if (numThreads == 0)
+    return E_INVALIDARG;
+  if (numThreads > numChunks)
+    numThreads = (numChunks == 0) ? 1 : (UInt32)numChunks;
+
+  UInt32 outSizeMax = (unpackSize < chunkSize) ? (UInt32)unpackSize : chunkSize;
+  CChunks chunks;
+  if (!chunks.Create(numThreads, GetPackSizeMax(outSizeMax), outSizeMax))
+    return E_OUTOFMEMORY;
+
+  // the index is not needed to read the chunks in order
+  UInt64 pos = 0;
+  while (pos < unpackSize)
+  {
+    UInt32 numItems;
+    HRESULT readResult = S_OK;
+    for (numItems = 0; numItems < numThreads && pos < unpackSize; numItems++)
+    {
+      CChunk &chunk = chunks.Items[numItems];
+      UInt64 rem = unpackSize - pos;
+      chunk.OutSize = (rem < chunkSize) ? (UInt32)rem : chunkSize;
+      readResult = ReadChunk(inStream, chunk);
+      if (readResult == S_OK)
+        readResult = chunks.Start(numItems, DecodeChunkThread);
+      if (readResult != S_OK)
+        break;
+      pos += chunk.OutSize;
+    }
+    HRESULT result = chunks.Wait(numItems);
+    RINOK(readResult);
+    RINOK(result);
+    for (UInt32 i = 0; i < numItems; i++)
+      RINOK(WriteStream(outStream, chunks.Items[i].OutBuffer,
+          chunks.Items[i].OutSize, 0));
+  }
+  return S_OK;
+}
+
+HRESULT LzmaChunkDecodeSegment(IInStream *inStream,
+    ISequentialOutStream *outStream, UInt32 segment)
+{
+  Byte flags;
+  int chunkLog;
+  UInt64 unpackSize, numChunks;
+  RINOK(ReadHeader(inStream, flags, chunkLog, unpackSize, numChunks));
+  if (segment >= numChunks)
+    return E_INVALIDARG;
+
+  if (flags & kChunkFlagIndex)
+  {
+    Byte buf[8];
+    RINOK(inStream->Seek(-(Int64)((numChunks - segment) * 8),
+        STREAM_SEEK_END, NULL));
+    RINOK(ReadFull(inStream, buf, 8));
+    RINOK(inStream->Seek(GetUInt64(buf), STREAM_SEEK_SET, NULL));
+  }
+  else
+    for (UInt32 i = 0; i < segment; i++)
+    {
+      Byte sizeBuf[4];
+      RINOK(ReadFull(inStream, sizeBuf, 4));
+      RINOK(inStream->Seek(GetUInt32(sizeBuf), STREAM_SEEK_CUR, NULL));
+    }
+
+  UInt64 rem = unpackSize - ((UInt64)segment << chunkLog);
+  UInt32 chunkSize = (UInt32)1 << chunkLog;
+  UInt32 outSize = (rem < chunkSize) ? (UInt32)rem : chunkSize;
+  CChunks chunks;
+  if (!chunks.Create(1, GetPackSizeMax(outSize), outSize))
+    return E_OUTOFMEMORY;
+  CChunk &chunk = chunks.Items[0];
+  chunk.OutSize = outSize;
+  RINOK(ReadChunk(inStream, chunk));
+  RINOK(DecodeChunk(chunk));
+  return WriteStream(outStream, chunk.OutBuffer, chunk.OutSize, 0);
+}
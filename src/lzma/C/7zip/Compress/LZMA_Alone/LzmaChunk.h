@@ -0,0 +1,49 @@
+// LzmaChunk.h
+
+#ifndef __LzmaChunk_h
+#define __LzmaChunk_h
+
+#include "../../../Common/MyWindows.h"
+#include "../../IStream.h"
+
+/*
+Chunked .lzma: the input is cut into chunks of 2^chunkLog bytes, and
+each chunk is a complete .lzma stream of its own, so the chunks can be
+coded in parallel, and any one of them read without the others.
+It is a host side format, the device kernels still take plain .lzma.
+
+  Header (15 bytes):
+    5 bytes - signature: 0xFF 'L' 'Z' 'C' 1
+    1 byte  - flags (kChunkFlagIndex)
+    1 byte  - chunkLog
+    8 bytes - unpacked size (little endian), must be known
+  Chunks, (unpackSize + 2^chunkLog - 1) >> chunkLog of them:
+    4 bytes - size of the .lzma stream that follows
+    .lzma stream (properties, 8 bytes unpacked size, packed data)
+  Index, if kChunkFlagIndex is set:
+    8 bytes per chunk - file offset of the chunk's size field
+
+0xFF can not start a .lzma stream, so LzmaChunkIsSignature can look at
+the 5 properties bytes of a plain .lzma header.
+*/
+
+const UInt32 kChunkSignatureSize = 5;
+const UInt32 kChunkHeaderSize = kChunkSignatureSize + 1 + 1 + 8;
+const Byte kChunkFlagIndex = 1;
+const int kChunkLogMin = 16;
+const int kChunkLogMax = 30;
+
+bool LzmaChunkIsSignature(const Byte *data);
+
+HRESULT LzmaChunkEncode(ISequentialInStream *inStream, 
+    ISequentialOutStream *outStream, UInt64 unpackSize, int chunkLog, 
+    bool writeIndex, UInt32 numThreads, const PROPID *propIDs, 
+    const PROPVARIANT *properties, UInt32 numProperties, bool multiThread);
+
+// The decoders start after the signature
+HRESULT LzmaChunkDecode(ISequentialInStream *inStream, 
+    ISequentialOutStream *outStream, UInt32 numThreads);
+HRESULT LzmaChunkDecodeSegment(IInStream *inStream, 
+    ISequentialOutStream *outStream, UInt32 segment);
+
+#endif
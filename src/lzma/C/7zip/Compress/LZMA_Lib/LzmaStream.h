@@ -0,0 +1,34 @@
+/*
+ * lzma streaming encoder for C tools
+ *
+ * lzma_stream_compress() codes source as a raw LZMA stream, without the
+ * .lzma header and without an end marker, the way "lzma e" codes a file
+ * whose size it knows.  The coded bytes are handed to write() as the
+ * encoder produces them; a non-zero return from write() stops it with
+ * Z_ERRNO.  The header a reader needs is the properties byte
+ * (pb * 5 + lp) * 9 + lc and the dictionary size 1 << dictbits.
+ *
+ * The match finder runs on its own thread when the library is built
+ * with COMPRESS_MF_MT; the stream is the same either way.
+ */
+
+#ifndef __LZMA_STREAM_H
+#define __LZMA_STREAM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*lzma_stream_write)(void *ctx, const void *buf, size_t len);
+
+int lzma_stream_compress(const unsigned char *source,
+	unsigned long sourceLen, unsigned dictbits, int lc, int lp, int pb,
+	lzma_stream_write write, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
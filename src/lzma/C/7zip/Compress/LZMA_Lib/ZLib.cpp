@@ -203,7 +203,8 @@ ZEXTERN int ZEXPORT compress2 OF((Bytef *dest,   uLongf *destLen,
 		NCoderPropID::kAlgorithm,
 		NCoderPropID::kNumFastBytes,
 		NCoderPropID::kMatchFinder,
-		NCoderPropID::kEndMarker
+		NCoderPropID::kEndMarker,
+		NCoderPropID::kMultiThread
 	};
 	const int kNumProps = sizeof(propIDs) / sizeof(propIDs[0]);
 	
@@ -222,6 +223,10 @@ ZEXTERN int ZEXPORT compress2 OF((Bytef *dest,   uLongf *destLen,
 	
 	properties[7].vt = VT_BOOL;
 	properties[7].boolVal = VARIANT_TRUE;
+
+	/* match finder on its own thread, the output is unchanged */
+	properties[8].vt = VT_BOOL;
+	properties[8].boolVal = VARIANT_TRUE;
 	
 	if (encoderSpec->SetCoderProperties(propIDs, properties, kNumProps) != S_OK)
 		return Z_MEM_ERROR; // should not happen
@@ -278,3 +283,96 @@ ZEXTERN int ZEXPORT uncompress OF((Bytef *dest,   uLongf *destLen,
 	
 	return Z_OK;
 }
+
+#include "LzmaStream.h"
+
+class CCallbackOutStream: 
+  public ISequentialOutStream,
+  public CMyUnknownImp
+{
+public:
+  CCallbackOutStream(lzma_stream_write write, void *ctx) : 
+	  m_write(write), m_ctx(ctx) {}
+  virtual ~CCallbackOutStream() {}
+
+  MY_UNKNOWN_IMP
+
+  STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+  {
+	  if (processedSize) 
+		  *processedSize = 0;
+
+	  if (size && m_write(m_ctx, data, size) != 0)
+		  return E_FAIL;
+
+	  if (processedSize) 
+		  *processedSize = size;
+
+	  return S_OK;
+  }
+protected:
+	lzma_stream_write m_write;
+	void *m_ctx;
+};
+
+extern "C" int lzma_stream_compress(const unsigned char *source,
+	unsigned long sourceLen, unsigned dictbits, int lc, int lp, int pb,
+	lzma_stream_write write, void *ctx)
+{
+	CInMemoryStream *inStreamSpec = new CInMemoryStream(source, sourceLen);
+	CMyComPtr<ISequentialInStream> inStream = inStreamSpec;
+	
+	CCallbackOutStream *outStreamSpec = new CCallbackOutStream(write, ctx);
+	CMyComPtr<ISequentialOutStream> outStream = outStreamSpec;
+	
+	NCompress::NLZMA::CEncoder *encoderSpec = 
+		new NCompress::NLZMA::CEncoder;
+	CMyComPtr<ICompressCoder> encoder = encoderSpec;
+	
+	PROPID propIDs[] = 
+	{
+		NCoderPropID::kDictionarySize,
+		NCoderPropID::kPosStateBits,
+		NCoderPropID::kLitContextBits,
+		NCoderPropID::kLitPosBits,
+		NCoderPropID::kAlgorithm,
+		NCoderPropID::kNumFastBytes,
+		NCoderPropID::kMatchFinder,
+		NCoderPropID::kEndMarker,
+		NCoderPropID::kMultiThread
+	};
+	const int kNumProps = sizeof(propIDs) / sizeof(propIDs[0]);
+	
+	PROPVARIANT properties[kNumProps];
+	for (int p = 0; p < 6; p++)
+		properties[p].vt = VT_UI4;
+	properties[0].ulVal = UInt32(1) << dictbits;
+	properties[1].ulVal = UInt32(pb);
+	properties[2].ulVal = UInt32(lc);
+	properties[3].ulVal = UInt32(lp);
+	properties[4].ulVal = UInt32(2);
+	properties[5].ulVal = UInt32(128);
+	
+	properties[6].vt = VT_BSTR;
+	properties[6].bstrVal = (BSTR)(const wchar_t *)L"BT4";
+	
+	/* the size is known, as for lzma e without -eos */
+	properties[7].vt = VT_BOOL;
+	properties[7].boolVal = VARIANT_FALSE;
+
+	properties[8].vt = VT_BOOL;
+	properties[8].boolVal = VARIANT_TRUE;
+	
+	if (encoderSpec->SetCoderProperties(propIDs, properties, kNumProps) != S_OK)
+		return Z_STREAM_ERROR;
+	
+	HRESULT result = encoder->Code(inStream, outStream, 0, 0, 0);
+	if (result == E_OUTOFMEMORY)
+		return Z_MEM_ERROR;
+	else if (result == E_FAIL)
+		return Z_ERRNO;
+	else if (result != S_OK)
+		return Z_BUF_ERROR;
+	
+	return Z_OK;
+}
@@ -0,0 +1,23 @@
+# Code generation for the LZMA SDK builds of every squashfs variant, set
+# in this one place rather than in each SDK copy's makefile, e.g.
+#	make LZMA_ARCH=native LZMA_LTO=1
+# Variables given on the make command line reach every sub-make.
+#
+# LZMA_ARCH	-march for the SDK objects, native tunes for the build host
+# LZMA_LTO	1 to build the SDK objects for link time optimisation.  They
+#		are fat objects, so the libraries still link without -flto
+#
+# SDK makefiles add LZMA_TUNE_FLAGS to their compiler flags, and the tools
+# linking an SDK library add LZMA_TUNE_LDFLAGS to their link.
+
+LZMA_TUNE_FLAGS :=
+LZMA_TUNE_LDFLAGS :=
+
+ifneq ($(LZMA_ARCH),)
+LZMA_TUNE_FLAGS += -march=$(LZMA_ARCH)
+endif
+
+ifeq ($(LZMA_LTO),1)
+LZMA_TUNE_FLAGS += -flto -ffat-lto-objects
+LZMA_TUNE_LDFLAGS += -flto -O2 $(filter -march=%,$(LZMA_TUNE_FLAGS))
+endif
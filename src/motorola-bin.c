@@ -37,32 +37,7 @@
 #include <string.h>
 #include <netinet/in.h>
 
-unsigned long *crc32;
-
-void init_crc32()
-{
-    unsigned long crc;
-    unsigned long poly = ntohl(0x2083b8ed);
-    int n, bit;
-    if ((crc32 = (unsigned long *) malloc(256 * sizeof(unsigned long))) == (void *)-1) {
-       perror("malloc");
-       exit(1);
-    }
-    for (n = 0; n < 256; n++) {
-        crc = (unsigned long) n;
-        for (bit = 0; bit < 8; bit++)
-            crc = (crc & 1) ? (poly ^ (crc >> 1)) : (crc >> 1);
-        crc32[n] = crc;
-    }
-}
-
-unsigned int crc32buf(char *buf, size_t len)
-{
-    unsigned int crc = 0xFFFFFFFF;
-    for (; len; len--, buf++)
-        crc = crc32[(crc ^ *buf) & 0xff] ^ (crc >> 8);
-    return crc;
-}
+#include "crc32/crc32buf.h"
 
 struct motorola {
 	unsigned int crc;	// crc32 of the remainder
@@ -109,9 +84,6 @@ int main(int argc, char **argv)
 	memcpy(&firmware->trx,trx,len);
 	munmap(trx,len);
 
-	// setup the motorola headers
-	init_crc32();
-
 	// setup the firmware magic
 
 	while ((c = getopt(argc, argv, "123")) !=-1) {
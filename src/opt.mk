@@ -0,0 +1,43 @@
+# Optimisation of the tools that spend their time compressing, the squashfs
+# 4.2 mksquashfs and unsquashfs with the LZMA SDK decoder, the squashfs 2.2
+# LZMA tools and the cramfs tools, e.g.
+#	make FAST=1
+#	make pgo
+# Variables given on the command line reach every sub-make, and configure
+# --enable-fast makes FAST=1 the default.
+#
+# FAST=1	-O3, -march=native and link time optimisation.  The tools
+#		then only run on CPUs with the instructions of the one
+#		that built them
+# PGO		generate builds the tools to write a profile of their runs,
+#		use rebuilds them optimised for those profiles.  The pgo
+#		target of src/Makefile does both, training the tools with
+#		pgo-train.sh in between
+#
+# Makefiles add OPT_CFLAGS to their compiler flags, after their own -O, and
+# OPT_LDFLAGS to their links.
+
+FAST ?=
+
+OPT_CFLAGS :=
+OPT_LDFLAGS :=
+
+ifeq ($(FAST),1)
+OPT_CFLAGS += -O3 -march=native -flto=auto -ffat-lto-objects
+OPT_LDFLAGS += -O3 -march=native -flto=auto
+else ifneq ($(FAST),)
+ifneq ($(FAST),0)
+$(error FAST must be 0 or 1)
+endif
+endif
+
+ifeq ($(PGO),generate)
+OPT_CFLAGS += -fprofile-generate -fprofile-update=prefer-atomic
+OPT_LDFLAGS += -fprofile-generate
+else ifeq ($(PGO),use)
+# code the training didn't run is still optimised for speed
+OPT_CFLAGS += -fprofile-use -fprofile-partial-training -Wno-missing-profile
+OPT_LDFLAGS += -fprofile-use
+else ifneq ($(PGO),)
+$(error PGO must be generate or use)
+endif
@@ -0,0 +1,149 @@
+/*
+ * zlib compatible compress2() and uncompress() around the LZMA SDK, which
+ * squashfs 2.2 7z images use for their blocks.  A block is the uncompressed
+ * size in 4 little endian bytes, the 5 byte LZMA properties, then the LZMA
+ * stream with an end marker.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * lzma_zlib.c
+ */
+
+#include <stdlib.h>
+#include <zlib.h>
+
+#include <LzmaEnc.h>
+#include <LzmaDec.h>
+
+/* the encoder settings of the p7zip wrapper this replaces */
+#define ZLIB_DICT	(1 << 15)
+#define ZLIB_LC		3
+#define ZLIB_LP		0
+#define ZLIB_PB		2
+#define ZLIB_FB		0x28
+
+#define ZLIB_HEADER	4
+
+static void *sz_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void sz_free(void *p, void *address)
+{
+	free(address);
+}
+
+static ISzAlloc sz = { sz_alloc, sz_free };
+
+/*
+ * mksquashfs and unsquashfs work a block at a time in one thread, so one
+ * encoder and one decoder are kept for all the blocks rather than being
+ * set up for each one.  A zeroed CLzmaDec is a constructed one
+ */
+static CLzmaEncHandle encoder;
+static CLzmaDec decoder;
+
+
+ZEXTERN int ZEXPORT compress2 OF((Bytef *dest, uLongf *destLen,
+	const Bytef *source, uLong sourceLen, int level))
+{
+	SizeT props_size = LZMA_PROPS_SIZE, out_size;
+	SRes res;
+
+	if(*destLen < ZLIB_HEADER + LZMA_PROPS_SIZE)
+		return Z_BUF_ERROR;
+
+	if(encoder == NULL) {
+		CLzmaEncProps props;
+
+		encoder = LzmaEnc_Create(&sz);
+		if(encoder == NULL)
+			return Z_MEM_ERROR;
+
+		LzmaEncProps_Init(&props);
+		props.dictSize = ZLIB_DICT;
+		props.lc = ZLIB_LC;
+		props.lp = ZLIB_LP;
+		props.pb = ZLIB_PB;
+		props.algo = 0;
+		props.fb = ZLIB_FB;
+		props.btMode = 1;
+		props.numHashBytes = 4;
+		props.writeEndMark = 1;
+		props.numThreads = 1;
+		if(LzmaEnc_SetProps(encoder, &props) != SZ_OK) {
+			LzmaEnc_Destroy(encoder, &sz, &sz);
+			encoder = NULL;
+			return Z_MEM_ERROR;
+		}
+	}
+
+	if(LzmaEnc_WriteProperties(encoder, dest + ZLIB_HEADER,
+			&props_size) != SZ_OK)
+		return Z_MEM_ERROR;
+
+	out_size = *destLen - ZLIB_HEADER - props_size;
+	res = LzmaEnc_MemEncode(encoder, dest + ZLIB_HEADER + props_size,
+		&out_size, source, sourceLen, 1, NULL, &sz, &sz);
+	if(res == SZ_ERROR_MEM)
+		return Z_MEM_ERROR;
+	if(res != SZ_OK)
+		return Z_BUF_ERROR;
+
+	*destLen = ZLIB_HEADER + props_size + out_size;
+
+	dest[0] = sourceLen & 0xff;
+	dest[1] = (sourceLen >> 8) & 0xff;
+	dest[2] = (sourceLen >> 16) & 0xff;
+	dest[3] = (sourceLen >> 24) & 0xff;
+
+	return Z_OK;
+}
+
+
+ZEXTERN int ZEXPORT uncompress OF((Bytef *dest, uLongf *destLen,
+	const Bytef *source, uLong sourceLen))
+{
+	SizeT in_size;
+	ELzmaStatus status;
+	SRes res;
+
+	if(sourceLen < ZLIB_HEADER + LZMA_PROPS_SIZE)
+		return Z_DATA_ERROR;
+
+	/* only reallocates the probabilities if lc or lp change */
+	res = LzmaDec_AllocateProbs(&decoder, source + ZLIB_HEADER,
+		LZMA_PROPS_SIZE, &sz);
+	if(res == SZ_ERROR_MEM)
+		return Z_MEM_ERROR;
+	if(res != SZ_OK)
+		return Z_DATA_ERROR;
+
+	decoder.dic = dest;
+	decoder.dicBufSize = *destLen;
+	LzmaDec_Init(&decoder);
+
+	in_size = sourceLen - ZLIB_HEADER - LZMA_PROPS_SIZE;
+	res = LzmaDec_DecodeToDic(&decoder, *destLen, source + ZLIB_HEADER +
+		LZMA_PROPS_SIZE, &in_size, LZMA_FINISH_ANY, &status);
+	if(res != SZ_OK)
+		return Z_DATA_ERROR;
+
+	*destLen = decoder.dicPos;
+	return Z_OK;
+}
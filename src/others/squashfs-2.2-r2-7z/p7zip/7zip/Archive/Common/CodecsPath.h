@@ -1,12 +0,0 @@
-// CodecsPath.h
-
-#ifndef __CODECSPATH_H
-#define __CODECSPATH_H
-
-#include "../../../Common/String.h"
-
-CSysString GetBaseFolderPrefix();
-CSysString GetCodecsFolderPrefix();
-
-#endif
-
@@ -1,21 +0,0 @@
-// Rar20ExtConst.h
-// According to unRAR license,
-// this code may not be used to develop a 
-// RAR (WinRAR) compatible archiver
-
-#ifndef __RAR20_EXTCONST_H
-#define __RAR20_EXTCONST_H
-
-#include "../../../Common/Types.h"
-
-namespace NCompress {
-namespace NRar20 {
-
-const UInt32 kNumRepDists = 4;
-const UInt32 kDistTableSize = 48;
-
-const int kMMTableSize = 256 + 1;
-
-}}
-
-#endif
@@ -1,10 +0,0 @@
-#define MY_VER_MAJOR 4
-#define MY_VER_MINOR 30
-#define MY_VERSION "4.30 beta"
-#define MY_7ZIP_VERSION "7-Zip 4.30 beta"
-#define MY_DATE "2005-11-18"
-#define MY_COPYRIGHT "Copyright (c) 1999-2005 Igor Pavlov"
-#define MY_VERSION_COPYRIGHT_DATE MY_VERSION "  " MY_COPYRIGHT "  " MY_DATE
-
-#define P7ZIP_VERSION "4.30"
-
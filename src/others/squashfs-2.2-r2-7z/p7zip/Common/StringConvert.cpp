@@ -1,54 +0,0 @@
-// Common/StringConvert.cpp
-
-#include "StdAfx.h"
-#include <stdlib.h>
-
-#include "StringConvert.h"
-
-int global_use_utf16_conversion = 0;
-
-UString MultiByteToUnicodeString(const AString &srcString, UINT codePage)
-{
-#ifdef HAVE_MBSTOWCS
-  if ((global_use_utf16_conversion) && (!srcString.IsEmpty()))
-  {
-    UString resultString;
-    int numChars = mbstowcs(resultString.GetBuffer(srcString.Length()),srcString,srcString.Length()+1);
-    if (numChars >= 0) {
-      resultString.ReleaseBuffer(numChars);
-      return resultString;
-    }
-  }
-#endif
-
-  UString resultString;
-  for (int i = 0; i < srcString.Length(); i++)
-    resultString += wchar_t(srcString[i] & 255);
-
-  return resultString;
-}
-
-AString UnicodeStringToMultiByte(const UString &srcString, UINT codePage)
-{
-#ifdef HAVE_WCSTOMBS
-  if ((global_use_utf16_conversion) && (!srcString.IsEmpty()))
-  {
-    AString resultString;
-    int numRequiredBytes = srcString.Length() * 6+1;
-    int numChars = wcstombs(resultString.GetBuffer(numRequiredBytes),srcString,numRequiredBytes);
-    if (numChars >= 0) {
-      resultString.ReleaseBuffer(numChars);
-      return resultString;
-    }
-  }
-#endif
-
-  AString resultString;
-  for (int i = 0; i < srcString.Length(); i++)
-  {
-    if (srcString[i] >= 256) resultString += '?';
-    else                     resultString += char(srcString[i]);
-  }
-  return resultString;
-}
-
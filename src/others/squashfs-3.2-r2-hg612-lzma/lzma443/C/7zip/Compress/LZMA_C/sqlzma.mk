@@ -18,7 +18,12 @@ endif
 ifdef UseDebugFlags
 DebugFlags = -O0 -g -UNDEBUG
 endif
-CFLAGS += -DNDEBUG ${DebugFlags}
+CFLAGS += -DNDEBUG ${DebugFlags} ${LZMA_TUNE_FLAGS}
+ifdef UseFastDecode
+Decode = LzmaDecodeFast
+else
+Decode = LzmaDecode
+endif
 Tgt = libunlzma.a libunlzma_r.a
 
 all: ${Tgt}
@@ -30,15 +35,17 @@ all: ${Tgt}
 
 uncomp.o uncomp_r.o: CFLAGS += -I${Sqlzma}
 uncomp.o: uncomp.c ${Sqlzma}/sqlzma.h
+LzmaDecodeFast.o LzmaDecodeFast_r.o: LzmaDecodeFastLoop.h
 
-libunlzma.a: uncomp.o LzmaDecode.o
+libunlzma.a: uncomp.o ${Decode}.o
 	${AR} cr $@ $^
-libunlzma_r.a: uncomp_r.o LzmaDecode_r.o
+libunlzma_r.a: uncomp_r.o ${Decode}_r.o
 	${AR} cr $@ $^
 
 clean: clean_sqlzma
 clean_sqlzma:
-	$(RM) ${Tgt} uncomp.o uncomp_r.o LzmaDecode_r.o *~
+	$(RM) ${Tgt} uncomp.o uncomp_r.o LzmaDecode_r.o \
+		LzmaDecodeFast_r.o LzmaDecodeFast.o *~
 
 # Local variables: ;
 # compile-command: (concat "make Sqlzma=../../../../.. -f " (file-name-nondirectory (buffer-file-name)));
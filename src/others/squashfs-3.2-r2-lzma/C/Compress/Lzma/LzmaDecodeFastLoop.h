@@ -0,0 +1,292 @@
+/*
+  LzmaDecodeFastLoop.h
+  Decoding loop of LzmaDecodeFast.c, which includes it once for each
+  set of properties it has a loop for, with
+    FAST_FUNC                  the name of the function
+    FAST_LOCALS                declarations the macros below need
+    FAST_POS_STATE(pos)        posState of output position pos
+    FAST_LIT_PROBS(pos, prev)  literal coder of pos after byte prev
+*/
+
+static int FAST_FUNC(CLzmaDecoderState *vs,
+    const Byte *inStream, SizeT inSize, SizeT *inSizeProcessed,
+    Byte *outStream, SizeT outSize, SizeT *outSizeProcessed)
+{
+  CProb *p = vs->Probs;
+  SizeT nowPos = 0;
+  Byte previousByte = 0;
+  int state = 0;
+  UInt32 rep0 = 1, rep1 = 1, rep2 = 1, rep3 = 1;
+  UInt32 len;
+  UInt32 Range, Code, bound;
+  const Byte *Buffer = inStream;
+  const Byte *BufferLim = inStream + inSize;
+  const Byte *BufferSafe = inSize > kMaxSymbolInput ? BufferLim - kMaxSymbolInput : inStream;
+  SizeT tailPos = 0;
+  Byte tail[2 * kMaxSymbolInput];
+  FAST_LOCALS
+
+  *inSizeProcessed = 0;
+  *outSizeProcessed = 0;
+
+  {
+    UInt32 i;
+    UInt32 numProbs = LzmaGetNumProbs(&vs->Properties);
+    for (i = 0; i < numProbs; i++)
+      p[i] = kBitModelTotal >> 1;
+  }
+
+  if (inSize < 5)
+    return LZMA_RESULT_DATA_ERROR;
+  Code = 0;
+  Range = 0xFFFFFFFF;
+  {
+    int i;
+    for (i = 0; i < 5; i++)
+      Code = (Code << 8) | *Buffer++;
+  }
+
+  while (nowPos < outSize)
+  {
+    CProb *prob;
+    UInt32 posState;
+
+    if (Buffer >= BufferSafe)
+    {
+      if (BufferSafe != tail)
+      {
+        /* go on from a copy of the rest, padded for the last symbol */
+        SizeT i, rem = (SizeT)(BufferLim - Buffer);
+        for (i = 0; i < rem; i++)
+          tail[i] = Buffer[i];
+        for (; i < sizeof(tail); i++)
+          tail[i] = 0;
+        tailPos = (SizeT)(Buffer - inStream);
+        Buffer = tail;
+        BufferLim = tail + rem;
+        BufferSafe = tail;
+      }
+      else if (Buffer > BufferLim)
+        return LZMA_RESULT_DATA_ERROR;
+    }
+
+    posState = FAST_POS_STATE(nowPos);
+    prob = p + IsMatch + (state << kNumPosBitsMax) + posState;
+    IfBit0(prob)
+    {
+      UInt32 symbol = 1;
+      UpdateBit0(prob)
+      prob = FAST_LIT_PROBS(nowPos, previousByte);
+      if (state >= kNumLitStates)
+      {
+        /* offs drops to 0 at the first bit that differs from matchByte */
+        UInt32 matchByte = outStream[nowPos - rep0];
+        UInt32 offs = 0x100;
+        do
+        {
+          UInt32 bit, mask;
+          CProb *probLit;
+          matchByte <<= 1;
+          bit = matchByte & offs;
+          probLit = prob + offs + bit + symbol;
+          GetBitMask(probLit, mask)
+          symbol = (symbol + symbol) + (mask & 1);
+          offs &= bit ^ ~mask;
+        }
+        while (symbol < 0x100);
+      }
+      else
+      {
+        TreeBit8(prob, symbol)
+      }
+      previousByte = (Byte)symbol;
+      outStream[nowPos++] = previousByte;
+      state = kLiteralNextStates[state];
+      Prefetch(FAST_LIT_PROBS(nowPos, previousByte));
+      continue;
+    }
+
+    UpdateBit1(prob);
+    prob = p + IsRep + state;
+    IfBit0(prob)
+    {
+      UpdateBit0(prob);
+      rep3 = rep2;
+      rep2 = rep1;
+      rep1 = rep0;
+      state = state < kNumLitStates ? 0 : 3;
+      prob = p + LenCoder;
+    }
+    else
+    {
+      UpdateBit1(prob);
+      prob = p + IsRepG0 + state;
+      IfBit0(prob)
+      {
+        UpdateBit0(prob);
+        prob = p + IsRep0Long + (state << kNumPosBitsMax) + posState;
+        IfBit0(prob)
+        {
+          UpdateBit0(prob);
+          if (nowPos == 0)
+            return LZMA_RESULT_DATA_ERROR;
+          state = state < kNumLitStates ? 9 : 11;
+          previousByte = outStream[nowPos - rep0];
+          outStream[nowPos++] = previousByte;
+          continue;
+        }
+        else
+        {
+          UpdateBit1(prob);
+        }
+      }
+      else
+      {
+        UInt32 distance;
+        UpdateBit1(prob);
+        prob = p + IsRepG1 + state;
+        IfBit0(prob)
+        {
+          UpdateBit0(prob);
+          distance = rep1;
+        }
+        else
+        {
+          UpdateBit1(prob);
+          prob = p + IsRepG2 + state;
+          IfBit0(prob)
+          {
+            UpdateBit0(prob);
+            distance = rep2;
+          }
+          else
+          {
+            UpdateBit1(prob);
+            distance = rep3;
+            rep3 = rep2;
+          }
+          rep2 = rep1;
+        }
+        rep1 = rep0;
+        rep0 = distance;
+      }
+      state = state < kNumLitStates ? 8 : 11;
+      prob = p + RepLenCoder;
+    }
+    {
+      CProb *probLen = prob + LenChoice;
+      len = 1;
+      IfBit0(probLen)
+      {
+        UpdateBit0(probLen);
+        probLen = prob + LenLow + (posState << kLenNumLowBits);
+        TreeBit3(probLen, len)
+        len -= kLenNumLowSymbols;
+      }
+      else
+      {
+        UpdateBit1(probLen);
+        probLen = prob + LenChoice2;
+        IfBit0(probLen)
+        {
+          UpdateBit0(probLen);
+          probLen = prob + LenMid + (posState << kLenNumMidBits);
+          TreeBit3(probLen, len)
+        }
+        else
+        {
+          UpdateBit1(probLen);
+          probLen = prob + LenHigh;
+          TreeBit8(probLen, len)
+          len = len - kLenNumHighSymbols + kLenNumLowSymbols + kLenNumMidSymbols;
+        }
+      }
+    }
+
+    if (state < 4)
+    {
+      UInt32 posSlot = 1;
+      state += kNumLitStates;
+      prob = p + PosSlot +
+          ((len < kNumLenToPosStates ? len : kNumLenToPosStates - 1) <<
+          kNumPosSlotBits);
+      TreeBit6(prob, posSlot)
+      posSlot -= 1 << kNumPosSlotBits;
+      if (posSlot >= kStartPosModelIndex)
+      {
+        int numDirectBits = (int)((posSlot >> 1) - 1);
+        rep0 = (2 | (posSlot & 1));
+        if (posSlot < kEndPosModelIndex)
+        {
+          rep0 <<= numDirectBits;
+          prob = p + SpecPos + rep0 - posSlot - 1;
+        }
+        else
+        {
+          numDirectBits -= kNumAlignBits;
+          do
+          {
+            UInt32 mask;
+            NORMALIZE
+            Range >>= 1;
+            Code -= Range;
+            mask = (UInt32)0 - (Code >> 31);
+            Code += Range & mask;
+            rep0 = (rep0 << 1) + (mask + 1);
+          }
+          while (--numDirectBits != 0);
+          prob = p + Align;
+          rep0 <<= kNumAlignBits;
+          numDirectBits = kNumAlignBits;
+        }
+        {
+          UInt32 i = 1;
+          UInt32 mi = 1;
+          do
+          {
+            CProb *prob3 = prob + mi;
+            UInt32 mask;
+            GetBitMask(prob3, mask)
+            mi = (mi + mi) + (mask & 1);
+            rep0 |= i & mask;
+            i <<= 1;
+          }
+          while (--numDirectBits != 0);
+        }
+      }
+      else
+        rep0 = posSlot;
+      if (++rep0 == (UInt32)(0))
+      {
+        /* it's for stream version */
+        break;
+      }
+    }
+
+    len += kMatchMinLen;
+    if (rep0 > nowPos)
+      return LZMA_RESULT_DATA_ERROR;
+    {
+      Byte *dest = outStream + nowPos;
+      const Byte *src = dest - rep0;
+      if (outSize - nowPos < len)
+        len = (UInt32)(outSize - nowPos);
+      nowPos += len;
+      do
+        *dest++ = *src++;
+      while (--len != 0);
+      previousByte = dest[-1];
+    }
+    Prefetch(FAST_LIT_PROBS(nowPos, previousByte));
+  }
+  NORMALIZE;
+  if (Buffer > BufferLim)
+    return LZMA_RESULT_DATA_ERROR;
+
+  if (BufferSafe == tail)
+    *inSizeProcessed = tailPos + (SizeT)(Buffer - tail);
+  else
+    *inSizeProcessed = (SizeT)(Buffer - inStream);
+  *outSizeProcessed = nowPos;
+  return LZMA_RESULT_OK;
+}
@@ -195,6 +195,74 @@ void sqlzma_fin(struct sqlzma_un *un)
 	BUG_ON(zlib_inflateEnd(&un->un_stream) != Z_OK);
 }
 
+#if !defined(__KERNEL__) && defined(_REENTRANT)
+/* a sqlzma_un for each of count threads, handed out by sqlzma_pool_get() */
+int sqlzma_pool_init(struct sqlzma_pool *pool, int count, int do_lzma,
+		     unsigned int res_sz)
+{
+	int err, i;
+
+	err = -ENOMEM;
+	pool->un = malloc(count * sizeof(*pool->un));
+	pool->free = malloc(count * sizeof(*pool->free));
+	if (unlikely(!pool->un || !pool->free))
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		err = sqlzma_init(pool->un + i, do_lzma, res_sz);
+		if (unlikely(err))
+			goto out_fin;
+		pool->free[i] = pool->un + i;
+	}
+	pool->count = pool->nfree = count;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	return 0;
+
+ out_fin:
+	while (i--)
+		sqlzma_fin(pool->un + i);
+ out:
+	free(pool->un);
+	free(pool->free);
+	return err;
+}
+
+/* take a free sqlzma_un, waiting for one to be put back if they're all busy */
+struct sqlzma_un *sqlzma_pool_get(struct sqlzma_pool *pool)
+{
+	struct sqlzma_un *un;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (!pool->nfree)
+		pthread_cond_wait(&pool->cond, &pool->mutex);
+	un = pool->free[--pool->nfree];
+	pthread_mutex_unlock(&pool->mutex);
+	return un;
+}
+
+void sqlzma_pool_put(struct sqlzma_pool *pool, struct sqlzma_un *un)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->free[pool->nfree++] = un;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void sqlzma_pool_fin(struct sqlzma_pool *pool)
+{
+	int i;
+
+	BUG_ON(pool->nfree != pool->count);
+	for (i = 0; i < pool->count; i++)
+		sqlzma_fin(pool->un + i);
+	free(pool->un);
+	free(pool->free);
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->cond);
+}
+#endif
+
 #ifdef __KERNEL__
 EXPORT_SYMBOL(sqlzma_un);
 EXPORT_SYMBOL(sqlzma_init);
@@ -11,6 +11,7 @@ $(error Sqlzma is not defined)
 endif
 
 include makefile.gcc
+CFLAGS += ${LZMA_TUNE_FLAGS}
 
 ifdef UseDebugFlags
 DebugFlags = -Wall -O0 -g -UNDEBUG
@@ -49,8 +49,10 @@ int sqlzma_cm(struct sqlzma_opts *opts, z_stream *stream, Bytef *next_in,
 /*
  * Three patterns for sqlzma uncompression. very dirty code.
  * - kernel space (squashfs kernel module)
- * - user space with pthread (mksquashfs)
- * - user space without pthread (unsquashfs)
+ * - user space with pthread (mksquashfs, unsquashfs)
+ * - user space without pthread
+ * A struct sqlzma_un is never shared, each thread decompressing at the same
+ * time takes its own from a struct sqlzma_pool.
  */
 
 struct sized_buf {
@@ -76,6 +78,23 @@ int sqlzma_un(struct sqlzma_un *un, struct sized_buf *src,
 	      struct sized_buf *dst);
 void sqlzma_fin(struct sqlzma_un *un);
 
+#if !defined(__KERNEL__) && defined(_REENTRANT)
+struct sqlzma_pool {
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	int			count;
+	int			nfree;
+	struct sqlzma_un	*un;
+	struct sqlzma_un	**free;
+};
+
+int sqlzma_pool_init(struct sqlzma_pool *pool, int count, int do_lzma,
+		     unsigned int res_sz);
+struct sqlzma_un *sqlzma_pool_get(struct sqlzma_pool *pool);
+void sqlzma_pool_put(struct sqlzma_pool *pool, struct sqlzma_un *un);
+void sqlzma_pool_fin(struct sqlzma_pool *pool);
+#endif
+
 /* ---------------------------------------------------------------------- */
 
 #ifdef __cplusplus
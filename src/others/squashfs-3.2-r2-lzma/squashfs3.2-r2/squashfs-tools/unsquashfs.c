@@ -34,6 +34,8 @@
 #include <zlib.h>
 #include <sys/mman.h>
 #include <utime.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #ifndef linux
 #define __BYTE_ORDER BYTE_ORDER
@@ -65,6 +67,7 @@
 
 #define EXIT_UNSQUASH(s, args...)	do { \
 						fprintf(stderr, "FATAL ERROR aborting: "s, ## args); \
+						exit(1); \
 					} while(0)
 
 struct hash_table_entry {
@@ -75,7 +78,7 @@ struct hash_table_entry {
 
 typedef struct squashfs_operations {
 	struct dir	*(*squashfs_opendir)(unsigned int block_start, unsigned int offset);
-	char 		*(*read_fragment)(unsigned int fragment);
+	void		(*read_fragment)(unsigned int fragment, long long *start_block, int *size);
 	void		(*read_fragment_table)();
 	int		(*create_inode)(char *pathname, unsigned int start_block, unsigned int offset);
 } squashfs_operations;
@@ -91,15 +94,12 @@ int fd;
 squashfs_fragment_entry *fragment_table;
 squashfs_fragment_entry_2 *fragment_table_2;
 unsigned int *uid_table, *guid_table;
-unsigned int cached_frag = SQUASHFS_INVALID_FRAG;
-char *fragment_data;
-char *file_data;
-char *data;
 unsigned int block_size;
 int lsonly = FALSE, info = FALSE, force = FALSE;
 char **created_inode;
 int root_process;
-struct sqlzma_un un;
+struct sqlzma_pool un_pool;
+int un_lzma;
 
 #define CALCULATE_HASH(start)	(start & 0xffff)
 
@@ -177,6 +177,7 @@ int read_block(long long start, long long *next, char *block)
 		offset = 3;
 	if(SQUASHFS_COMPRESSED(c_byte)) {
 		char buffer[SQUASHFS_METADATA_SIZE];
+		struct sqlzma_un *un;
 		int res;
 		unsigned long bytes = SQUASHFS_METADATA_SIZE;
 		enum {Src, Dst};
@@ -190,10 +191,12 @@ int read_block(long long start, long long *next, char *block)
 			goto failed;
 
 		sbuf[Src].sz = c_byte;
-		res = sqlzma_un(&un, sbuf + Src, sbuf + Dst);
+		un = sqlzma_pool_get(&un_pool);
+		res = sqlzma_un(un, sbuf + Src, sbuf + Dst);
+		bytes = un->un_reslen;
+		sqlzma_pool_put(&un_pool, un);
 		if (res)
 			abort();
-		bytes = un.un_reslen;
 		if(next)
 			*next = start + offset + c_byte;
 		return bytes;
@@ -211,38 +214,6 @@ failed:
 }
 
 
-int read_data_block(long long start, unsigned int size, char *block)
-{
-	int res;
-	unsigned long bytes = block_size;
-	int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(size);
-
-	TRACE("read_data_block: block @0x%llx, %d %s bytes\n", start, SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte), SQUASHFS_COMPRESSED_BLOCK(c_byte) ? "compressed" : "uncompressed");
-
-	if(SQUASHFS_COMPRESSED_BLOCK(size)) {
-		enum {Src, Dst};
-		struct sized_buf sbuf[] = {
-			{.buf = data, .sz = c_byte},
-			{.buf = block, .sz = bytes}
-		};
-
-		if(read_bytes(start, c_byte, data) == FALSE)
-			return 0;
-
-		res = sqlzma_un(&un, sbuf + Src, sbuf + Dst);
-		if (res)
-			abort();
-		bytes = un.un_reslen;
-		return bytes;
-	} else {
-		if(read_bytes(start, c_byte, block) == FALSE)
-			return 0;
-
-		return c_byte;
-	}
-}
-
-
 void uncompress_inode_table(long long start, long long end)
 {
 	int size = 0, bytes = 0, res;
@@ -394,48 +365,452 @@ void read_fragment_table_2()
 }
 
 
-char *read_fragment(unsigned int fragment)
+void read_fragment(unsigned int fragment, long long *start_block, int *size)
 {
 	TRACE("read_fragment: reading fragment %d\n", fragment);
 
-	if(cached_frag == SQUASHFS_INVALID_FRAG || fragment != cached_frag) {
-		squashfs_fragment_entry *fragment_entry = &fragment_table[fragment];
-		if(read_data_block(fragment_entry->start_block, fragment_entry->size, fragment_data) == 0) {
-			ERROR("read_fragment: failed to read fragment %d\n", fragment);
-			cached_frag = SQUASHFS_INVALID_FRAG;
-			return NULL;
-		}
-		cached_frag = fragment;
+	*start_block = fragment_table[fragment].start_block;
+	*size = fragment_table[fragment].size;
+}
+
+
+void read_fragment_2(unsigned int fragment, long long *start_block, int *size)
+{
+	TRACE("read_fragment: reading fragment %d\n", fragment);
+
+	*start_block = fragment_table_2[fragment].start_block;
+	*size = fragment_table_2[fragment].size;
+}
+
+
+/*
+ * Threaded read path, after the 4.x unsquashfs.  The main thread walks the
+ * directories and queues each file's blocks to the writer thread, looking
+ * them up in the data or fragment cache.  A block not in the cache is read
+ * by the reader thread and, if compressed, decompressed by one of the
+ * deflator threads, so decompression and writing overlap the scan
+ */
+struct queue {
+	int		size;
+	int		readp;
+	int		writep;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	empty;
+	pthread_cond_t	full;
+	void		**data;
+};
+
+struct cache_entry {
+	struct cache	*cache;
+	long long	block;
+	int		size;
+	int		bytes;
+	int		used;
+	int		error;
+	int		pending;
+	struct cache_entry *hash_next;
+	struct cache_entry *hash_prev;
+	struct cache_entry *free_next;
+	struct cache_entry *free_prev;
+	char		*data;
+};
+
+struct cache {
+	int		max_buffers;
+	int		count;
+	int		buffer_size;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	wait_for_free;
+	pthread_cond_t	wait_for_pending;
+	struct cache_entry *free_list;
+	struct cache_entry *hash_table[65536];
+};
+
+/* a block, or the tail of a fragment, queued to the writer */
+struct file_entry {
+	int		offset;
+	int		size;
+	struct cache_entry *buffer;
+};
+
+/* a file queued to the writer, followed by its blocks */
+struct squashfs_file {
+	int		fd;
+	int		blocks;
+	unsigned int	mode;
+	unsigned int	uid;
+	unsigned int	guid;
+	unsigned int	mtime;
+	char		*pathname;
+};
+
+#define DATA_BUFFER_DEFAULT	256
+#define FRAGMENT_BUFFER_DEFAULT	256
+
+struct cache *fragment_cache, *data_cache;
+struct queue *to_reader, *to_deflate, *to_writer, *from_writer;
+pthread_t *thread, *deflator_thread;
+int processors = -1;
+
+
+struct queue *queue_init(int size)
+{
+	struct queue *queue = malloc(sizeof(struct queue));
+
+	if(queue == NULL)
+		return NULL;
+
+	if((queue->data = malloc(sizeof(void *) * (size + 1))) == NULL) {
+		free(queue);
+		return NULL;
 	}
 
-	return fragment_data;
+	queue->size = size + 1;
+	queue->readp = queue->writep = 0;
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->empty, NULL);
+	pthread_cond_init(&queue->full, NULL);
+
+	return queue;
 }
 
 
-char *read_fragment_2(unsigned int fragment)
+void queue_put(struct queue *queue, void *data)
 {
-	TRACE("read_fragment: reading fragment %d\n", fragment);
+	int nextp;
 
-	if(cached_frag == SQUASHFS_INVALID_FRAG || fragment != cached_frag) {
-		squashfs_fragment_entry_2 *fragment_entry = &fragment_table_2[fragment];
-		if(read_data_block(fragment_entry->start_block, fragment_entry->size, fragment_data) == 0) {
-			ERROR("read_fragment: failed to read fragment %d\n", fragment);
-			cached_frag = SQUASHFS_INVALID_FRAG;
-			return NULL;
+	pthread_mutex_lock(&queue->mutex);
+
+	while((nextp = (queue->writep + 1) % queue->size) == queue->readp)
+		pthread_cond_wait(&queue->full, &queue->mutex);
+
+	queue->data[queue->writep] = data;
+	queue->writep = nextp;
+	pthread_cond_signal(&queue->empty);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+
+void *queue_get(struct queue *queue)
+{
+	void *data;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while(queue->readp == queue->writep)
+		pthread_cond_wait(&queue->empty, &queue->mutex);
+
+	data = queue->data[queue->readp];
+	queue->readp = (queue->readp + 1) % queue->size;
+	pthread_cond_signal(&queue->full);
+	pthread_mutex_unlock(&queue->mutex);
+
+	return data;
+}
+
+
+struct cache *cache_init(int buffer_size, int max_buffers)
+{
+	struct cache *cache = malloc(sizeof(struct cache));
+
+	if(cache == NULL)
+		return NULL;
+
+	cache->max_buffers = max_buffers;
+	cache->buffer_size = buffer_size;
+	cache->count = 0;
+	cache->free_list = NULL;
+	memset(cache->hash_table, 0, sizeof(struct cache_entry *) * 65536);
+	pthread_mutex_init(&cache->mutex, NULL);
+	pthread_cond_init(&cache->wait_for_free, NULL);
+	pthread_cond_init(&cache->wait_for_pending, NULL);
+
+	return cache;
+}
+
+
+void insert_hash_table(struct cache *cache, struct cache_entry *entry)
+{
+	int hash = CALCULATE_HASH(entry->block);
+
+	entry->hash_next = cache->hash_table[hash];
+	cache->hash_table[hash] = entry;
+	entry->hash_prev = NULL;
+	if(entry->hash_next)
+		entry->hash_next->hash_prev = entry;
+}
+
+
+void remove_hash_table(struct cache *cache, struct cache_entry *entry)
+{
+	if(entry->hash_prev)
+		entry->hash_prev->hash_next = entry->hash_next;
+	else
+		cache->hash_table[CALCULATE_HASH(entry->block)] = entry->hash_next;
+	if(entry->hash_next)
+		entry->hash_next->hash_prev = entry->hash_prev;
+
+	entry->hash_prev = entry->hash_next = NULL;
+}
+
+
+void insert_free_list(struct cache *cache, struct cache_entry *entry)
+{
+	if(cache->free_list) {
+		entry->free_next = cache->free_list;
+		entry->free_prev = cache->free_list->free_prev;
+		cache->free_list->free_prev->free_next = entry;
+		cache->free_list->free_prev = entry;
+	} else {
+		cache->free_list = entry;
+		entry->free_prev = entry->free_next = entry;
+	}
+}
+
+
+void remove_free_list(struct cache *cache, struct cache_entry *entry)
+{
+	if(entry->free_prev == NULL && entry->free_next == NULL)
+		/* not in free list */
+		return;
+	else if(entry->free_prev == entry && entry->free_next == entry) {
+		/* only this entry in the free list */
+		cache->free_list = NULL;
+	} else {
+		/* more than one entry in the free list */
+		entry->free_next->free_prev = entry->free_prev;
+		entry->free_prev->free_next = entry->free_next;
+		if(cache->free_list == entry)
+			cache->free_list = entry->free_next;
+	}
+
+	entry->free_prev = entry->free_next = NULL;
+}
+
+
+/*
+ * Get the block from the cache, queueing it to the reader thread if it
+ * isn't there.  The caller waits for it with cache_block_wait()
+ */
+struct cache_entry *cache_get(struct cache *cache, long long block, int size)
+{
+	int hash = CALCULATE_HASH(block);
+	struct cache_entry *entry;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	for(entry = cache->hash_table[hash]; entry; entry = entry->hash_next)
+		if(entry->block == block)
+			break;
+
+	if(entry) {
+		/* found, it may still be pending but that's handled later */
+		if(entry->used == 0)
+			remove_free_list(cache, entry);
+		entry->used ++;
+		pthread_mutex_unlock(&cache->mutex);
+		return entry;
+	}
+
+	/* not in the cache, wait for a buffer to become free if they're all in use */
+	while(cache->free_list == NULL && cache->count == cache->max_buffers)
+		pthread_cond_wait(&cache->wait_for_free, &cache->mutex);
+
+	if(cache->count < cache->max_buffers) {
+		if((entry = malloc(sizeof(struct cache_entry))) == NULL || (entry->data = malloc(cache->buffer_size)) == NULL)
+			EXIT_UNSQUASH("cache_get: out of memory\n");
+		entry->cache = cache;
+		entry->free_prev = entry->free_next = NULL;
+		cache->count ++;
+	} else {
+		/* reuse the least recently used free buffer */
+		entry = cache->free_list;
+		remove_free_list(cache, entry);
+		remove_hash_table(cache, entry);
+	}
+
+	entry->block = block;
+	entry->size = size;
+	entry->used = 1;
+	entry->error = FALSE;
+	entry->pending = TRUE;
+	insert_hash_table(cache, entry);
+	pthread_mutex_unlock(&cache->mutex);
+
+	queue_put(to_reader, entry);
+
+	return entry;
+}
+
+
+void cache_block_ready(struct cache_entry *entry, int error)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	entry->pending = FALSE;
+	entry->error = error;
+	pthread_cond_broadcast(&entry->cache->wait_for_pending);
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+void cache_block_wait(struct cache_entry *entry)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	while(entry->pending)
+		pthread_cond_wait(&entry->cache->wait_for_pending, &entry->cache->mutex);
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+void cache_block_put(struct cache_entry *entry)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	if(-- entry->used == 0) {
+		insert_free_list(entry->cache, entry);
+		pthread_cond_signal(&entry->cache->wait_for_free);
+	}
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+/*
+ * Read the compressed blocks in the order they were queued, passing them on
+ * to the deflators
+ */
+void *reader(void *arg)
+{
+	while(1) {
+		struct cache_entry *entry = queue_get(to_reader);
+		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size);
+
+		if(c_byte > entry->cache->buffer_size) {
+			ERROR("reader: block 0x%llx size %d too large\n", entry->block, c_byte);
+			cache_block_ready(entry, TRUE);
+		} else if(read_bytes(entry->block, c_byte, entry->data) == FALSE)
+			cache_block_ready(entry, TRUE);
+		else if(SQUASHFS_COMPRESSED_BLOCK(entry->size))
+			queue_put(to_deflate, entry);
+		else {
+			entry->bytes = c_byte;
+			cache_block_ready(entry, FALSE);
 		}
-		cached_frag = fragment;
 	}
+}
+
+
+/*
+ * Each block takes a sqlzma_un from the pool for as long as it's being
+ * decompressed, so the deflators never share one
+ */
+void *deflator(void *arg)
+{
+	char tmp[block_size];
 
-	return fragment_data;
+	while(1) {
+		struct cache_entry *entry = queue_get(to_deflate);
+		struct sqlzma_un *un = sqlzma_pool_get(&un_pool);
+		int res;
+		enum {Src, Dst};
+		struct sized_buf sbuf[] = {
+			{.buf = entry->data, .sz = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size)},
+			{.buf = tmp, .sz = block_size}
+		};
+
+		res = sqlzma_un(un, sbuf + Src, sbuf + Dst);
+		entry->bytes = un->un_reslen;
+		sqlzma_pool_put(&un_pool, un);
+
+		if(res) {
+			ERROR("deflator: failed to decompress block 0x%llx\n", entry->block);
+			cache_block_ready(entry, TRUE);
+			continue;
+		}
+
+		memcpy(entry->data, tmp, entry->bytes);
+		cache_block_ready(entry, FALSE);
+	}
+}
+
+
+/*
+ * Write each queued file once its blocks are ready, then set its attributes.
+ * A NULL file marks the end of the scan
+ */
+void *writer(void *arg)
+{
+	struct squashfs_file *file;
+	int i;
+
+	while((file = queue_get(to_writer)) != NULL) {
+		int failed = FALSE;
+
+		for(i = 0; i < file->blocks; i++) {
+			struct file_entry *block = queue_get(to_writer);
+			int size;
+
+			cache_block_wait(block->buffer);
+			size = block->size == -1 ? block->buffer->bytes : block->size;
+			if(!failed && block->buffer->error) {
+				ERROR("writer: failed to read data block 0x%llx\n", block->buffer->block);
+				failed = TRUE;
+			} else if(!failed && write(file->fd, block->buffer->data + block->offset, size) < size) {
+				ERROR("writer: failed to write file %s, because %s\n", file->pathname, strerror(errno));
+				failed = TRUE;
+			}
+			cache_block_put(block->buffer);
+			free(block);
+		}
+
+		close(file->fd);
+		if(!failed)
+			set_attributes(file->pathname, file->mode, file->uid, file->guid, file->mtime, force);
+		free(file->pathname);
+		free(file);
+	}
+
+	queue_put(from_writer, NULL);
+	return NULL;
+}
+
+
+void initialise_threads(int fragment_buffer_size, int data_buffer_size)
+{
+	int i, all_buffers_size = fragment_buffer_size + data_buffer_size;
+
+	if(processors == -1)
+		processors = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+	if((thread = malloc((2 + processors) * sizeof(pthread_t))) == NULL)
+		EXIT_UNSQUASH("Out of memory allocating thread descriptors\n");
+	deflator_thread = &thread[2];
+
+	to_reader = queue_init(all_buffers_size);
+	to_deflate = queue_init(all_buffers_size);
+	to_writer = queue_init(1000);
+	from_writer = queue_init(1);
+	fragment_cache = cache_init(block_size, fragment_buffer_size);
+	data_cache = cache_init(block_size, data_buffer_size);
+	if(to_reader == NULL || to_deflate == NULL || to_writer == NULL || from_writer == NULL ||
+			fragment_cache == NULL || data_cache == NULL)
+		EXIT_UNSQUASH("Out of memory allocating thread queues and caches\n");
+
+	pthread_create(&thread[0], NULL, reader, NULL);
+	pthread_create(&thread[1], NULL, writer, NULL);
+	for(i = 0; i < processors; i++)
+		if(pthread_create(&deflator_thread[i], NULL, deflator, NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+
+	printf("Parallel unsquashfs: Using %d processor%s\n", processors, processors == 1 ? "" : "s");
 }
 
 
 int write_file(char *pathname, unsigned int fragment, unsigned int frag_bytes,
 unsigned int offset, unsigned int blocks, long long start, char *block_ptr,
-unsigned int mode)
+unsigned int mode, unsigned int uid, unsigned int guid, unsigned int mtime)
 {
-	unsigned int file_fd, bytes, i;
+	int file_fd, i;
 	unsigned int *block_list;
+	struct squashfs_file *file;
 
 	TRACE("write_file: regular file, blocks %d\n", blocks);
 
@@ -458,39 +833,46 @@ unsigned int mode)
 		return FALSE;
 	}
 
-	for(i = 0; i < blocks; i++) {
-		if((bytes = read_data_block(start, block_list[i], file_data)) == 0) {
-			ERROR("write_file: failed to read data block 0x%llx\n", start);
-			goto failure;
-		}
+	if((file = malloc(sizeof(struct squashfs_file))) == NULL || (file->pathname = strdup(pathname)) == NULL)
+		EXIT_UNSQUASH("write_file: unable to malloc file\n");
 
-		if(write(file_fd, file_data, bytes) < bytes) {
-			ERROR("write_file: failed to write data block 0x%llx\n", start);
-			goto failure;
-		}
+	file->fd = file_fd;
+	file->blocks = blocks + (frag_bytes != 0);
+	file->mode = mode;
+	file->uid = uid;
+	file->guid = guid;
+	file->mtime = mtime;
+	queue_put(to_writer, file);
 
+	/* the blocks follow the file on the writer queue, fetched as they're queued */
+	for(i = 0; i < blocks; i++) {
+		struct file_entry *block = malloc(sizeof(struct file_entry));
+
+		if(block == NULL)
+			EXIT_UNSQUASH("write_file: unable to malloc file entry\n");
+		block->offset = 0;
+		block->size = -1;
+		block->buffer = cache_get(data_cache, start, block_list[i]);
+		queue_put(to_writer, block);
 		start += SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[i]);
 	}
 
 	if(frag_bytes != 0) {
-		char *fragment_data = s_ops.read_fragment(fragment);
-
-		if(fragment_data == NULL)
-			goto failure;
-
-		if(write(file_fd, fragment_data + offset, frag_bytes) < frag_bytes) {
-			ERROR("write_file: failed to write fragment %d\n", fragment);
-			goto failure;
-		}
+		long long frag_start;
+		int frag_size;
+		struct file_entry *block = malloc(sizeof(struct file_entry));
+
+		if(block == NULL)
+			EXIT_UNSQUASH("write_file: unable to malloc file entry\n");
+		s_ops.read_fragment(fragment, &frag_start, &frag_size);
+		block->offset = offset;
+		block->size = frag_bytes;
+		block->buffer = cache_get(fragment_cache, frag_start, frag_size);
+		queue_put(to_writer, block);
 	}
 
-	close(file_fd);
-	return TRUE;
-
-failure:
-	close(file_fd);
 	free(block_list);
-	return FALSE;
+	return TRUE;
 }
 		
 
@@ -557,10 +939,9 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset)
 
 			if(write_file(pathname, inode->fragment, frag_bytes,
 					offset, blocks, start, block_ptr +
-					sizeof(*inode), inode->mode)) {
-				set_attributes(pathname, inode->mode, inode->uid, inode->guid, inode->mtime, force);
+					sizeof(*inode), inode->mode, inode->uid,
+					inode->guid, inode->mtime))
 				file_count ++;
-			}
 			break;
 		}	
 		case SQUASHFS_LREG_TYPE: {
@@ -590,10 +971,9 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset)
 
 			if(write_file(pathname, inode->fragment, frag_bytes,
 					offset, blocks, start, block_ptr +
-					sizeof(*inode), inode->mode)) {
-				set_attributes(pathname, inode->mode, inode->uid, inode->guid, inode->mtime, force);
+					sizeof(*inode), inode->mode, inode->uid,
+					inode->guid, inode->mtime))
 				file_count ++;
-			}
 			break;
 		}	
 		case SQUASHFS_SYMLINK_TYPE: {
@@ -748,10 +1128,9 @@ int create_inode_2(char *pathname, unsigned int start_block, unsigned int offset
 
 			if(write_file(pathname, inode->fragment, frag_bytes,
 					offset, blocks, start, block_ptr +
-					sizeof(*inode), inode->mode)) {
-				set_attributes(pathname, inode->mode, inode->uid, inode->guid, inode->mtime, force);
+					sizeof(*inode), inode->mode, inode->uid,
+					inode->guid, inode->mtime))
 				file_count ++;
-			}
 			break;
 		}	
 		case SQUASHFS_SYMLINK_TYPE: {
@@ -1228,17 +1607,17 @@ int read_super(char *source)
 	read_bytes(SQUASHFS_START, sizeof(squashfs_super_block), (char *) &sBlk);
 
 	/* Check it is a SQUASHFS superblock */
-	un.un_lzma = 1;
+	un_lzma = 1;
 	swap = 0;
 	switch (sBlk.s_magic) {
 		squashfs_super_block sblk;
 	case SQUASHFS_MAGIC:
-		un.un_lzma = 0;
+		un_lzma = 0;
 		/*FALLTHROUGH*/
 	case SQUASHFS_MAGIC_LZMA:
 		break;
 	case SQUASHFS_MAGIC_SWAP:
-		un.un_lzma = 0;
+		un_lzma = 0;
 		/*FALLTHROUGH*/
 	case SQUASHFS_MAGIC_LZMA_SWAP:
 		ERROR("Reading a different endian SQUASHFS filesystem on %s\n", source);
@@ -1343,6 +1722,12 @@ int main(int argc, char *argv[])
 			dest = argv[i];
 		} else if(strcmp(argv[i], "-force") == 0 || strcmp(argv[i], "-f") == 0)
 			force = TRUE;
+		else if(strcmp(argv[i], "-processors") == 0 || strcmp(argv[i], "-p") == 0) {
+			if(++i == argc || (processors = atoi(argv[i])) < 1) {
+				ERROR("%s: -processors missing or invalid processor number\n", argv[0]);
+				exit(1);
+			}
+		}
 	}
 
 	if(i == argc) {
@@ -1354,6 +1739,7 @@ options:
 			ERROR("\t-l[s]\t\t\tlist filesystem only\n");
 			ERROR("\t-d[est] <pathname>\tunsquash to <pathname>, default \"squashfs-root\"\n");
 			ERROR("\t-f[orce]\t\tif file already exists then overwrite\n");
+			ERROR("\t-p[rocessors] <number>\tuse <number> deflator threads, default the number of processors\n");
 		}
 		exit(1);
 	}
@@ -1370,20 +1756,16 @@ options:
 		exit(1);
 
 	block_size = sBlk.block_size;
-	if((fragment_data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate fragment_data\n");
-
-	if((file_data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate file_data");
-
-	if((data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate datan\n");
 
 	if((created_inode = malloc(sBlk.inodes * sizeof(char *))) == NULL)
 		EXIT_UNSQUASH("failed to allocate created_inode\n");
 
 	memset(created_inode, 0, sBlk.inodes * sizeof(char *));
-	i = sqlzma_init(&un, un.un_lzma, 0);
+	if(processors == -1)
+		processors = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+	/* a context for each deflator and one for the main thread */
+	i = sqlzma_pool_init(&un_pool, processors + 1, un_lzma, 0);
 	if (i != Z_OK) {
 		fputs("sqlzma_init failed", stderr);
 		abort();
@@ -1394,8 +1776,14 @@ options:
 	uncompress_inode_table(sBlk.inode_table_start, sBlk.directory_table_start);
 	uncompress_directory_table(sBlk.directory_table_start, sBlk.fragment_table_start);
 
+	initialise_threads(FRAGMENT_BUFFER_DEFAULT, DATA_BUFFER_DEFAULT);
+
 	dir_scan(dest, SQUASHFS_INODE_BLK(sBlk.root_inode), SQUASHFS_INODE_OFFSET(sBlk.root_inode), target);
 
+	/* wait for the writer to drain the queued files */
+	queue_put(to_writer, NULL);
+	queue_get(from_writer);
+
 	if(!lsonly) {
 		printf("\n");
 		printf("created %d files\n", file_count);
@@ -0,0 +1,166 @@
+/*
+  LzmaDecodeFast.c
+  LZMA Decoder (whole buffer version for libunlzma)
+
+  Based on LzmaDecode.c from
+  LZMA SDK 4.40 Copyright (c) 1999-2006 Igor Pavlov (2006-05-01)
+  http://www.7-zip.org/
+
+  LZMA SDK is licensed under two licenses:
+  1) GNU Lesser General Public License (GNU LGPL)
+  2) Common Public License (CPL)
+  It means that you can select one of these two licenses and
+  follow rules of that license.
+
+  It has the interface of LzmaDecode.c built without _LZMA_IN_CB and
+  _LZMA_OUT_READ, and gives the same results, but
+  - the range decoder does not test for the end of the input on each
+    normalization; the loop tests once per symbol that kMaxSymbolInput
+    bytes are left, and decodes the last bytes from a padded copy,
+  - literals, bit trees and direct bits are decoded without branches
+    on the decoded bits,
+  - the contexts of lc=3, lp=0, pb=2 (the properties mksquashfs uses)
+    are constants in a copy of the loop of their own.
+*/
+
+#include "LzmaDecode.h"
+
+#if defined(_LZMA_IN_CB) || defined(_LZMA_OUT_READ)
+#error LzmaDecodeFast.c only decodes whole buffers
+#endif
+
+#define kNumTopBits 24
+#define kTopValue ((UInt32)1 << kNumTopBits)
+
+#define kNumBitModelTotalBits 11
+#define kBitModelTotal (1 << kNumBitModelTotalBits)
+#define kNumMoveBits 5
+
+/* a symbol reads at most one byte for each of its (up to 48) bits */
+#define kMaxSymbolInput 64
+
+#define NORMALIZE if (Range < kTopValue) { Range <<= 8; Code = (Code << 8) | *Buffer++; }
+
+#define IfBit0(p) NORMALIZE; bound = (Range >> kNumBitModelTotalBits) * *(p); if (Code < bound)
+#define UpdateBit0(p) Range = bound; *(p) += (kBitModelTotal - *(p)) >> kNumMoveBits;
+#define UpdateBit1(p) Range -= bound; Code -= bound; *(p) -= (*(p)) >> kNumMoveBits;
+
+/* mask is 0 after a 0 bit and ~0 after a 1 bit */
+#define GetBitMask(p, mask) { UInt32 pr = *(p); NORMALIZE; \
+  bound = (Range >> kNumBitModelTotalBits) * pr; \
+  mask = (UInt32)0 - (UInt32)(Code >= bound); \
+  Range = (bound & ~mask) | ((Range - bound) & mask); \
+  Code -= bound & mask; \
+  *(p) = (CProb)(((pr + ((kBitModelTotal - pr) >> kNumMoveBits)) & ~mask) | \
+      ((pr - (pr >> kNumMoveBits)) & mask)); }
+
+#define TreeBit(probs, mi) { CProb *pt = (probs) + (mi); UInt32 mask; \
+  GetBitMask(pt, mask); mi = (mi + mi) + (mask & 1); }
+
+#define TreeBit3(probs, mi) TreeBit(probs, mi) TreeBit(probs, mi) TreeBit(probs, mi)
+#define TreeBit6(probs, mi) TreeBit3(probs, mi) TreeBit3(probs, mi)
+#define TreeBit8(probs, mi) TreeBit6(probs, mi) TreeBit(probs, mi) TreeBit(probs, mi)
+
+#ifdef __GNUC__
+#define Prefetch(p) __builtin_prefetch(p)
+#else
+#define Prefetch(p)
+#endif
+
+
+#define kNumPosBitsMax 4
+#define kNumPosStatesMax (1 << kNumPosBitsMax)
+
+#define kLenNumLowBits 3
+#define kLenNumLowSymbols (1 << kLenNumLowBits)
+#define kLenNumMidBits 3
+#define kLenNumMidSymbols (1 << kLenNumMidBits)
+#define kLenNumHighBits 8
+#define kLenNumHighSymbols (1 << kLenNumHighBits)
+
+#define LenChoice 0
+#define LenChoice2 (LenChoice + 1)
+#define LenLow (LenChoice2 + 1)
+#define LenMid (LenLow + (kNumPosStatesMax << kLenNumLowBits))
+#define LenHigh (LenMid + (kNumPosStatesMax << kLenNumMidBits))
+#define kNumLenProbs (LenHigh + kLenNumHighSymbols)
+
+
+#define kNumStates 12
+#define kNumLitStates 7
+
+#define kStartPosModelIndex 4
+#define kEndPosModelIndex 14
+#define kNumFullDistances (1 << (kEndPosModelIndex >> 1))
+
+#define kNumPosSlotBits 6
+#define kNumLenToPosStates 4
+
+#define kNumAlignBits 4
+#define kAlignTableSize (1 << kNumAlignBits)
+
+#define kMatchMinLen 2
+
+#define IsMatch 0
+#define IsRep (IsMatch + (kNumStates << kNumPosBitsMax))
+#define IsRepG0 (IsRep + kNumStates)
+#define IsRepG1 (IsRepG0 + kNumStates)
+#define IsRepG2 (IsRepG1 + kNumStates)
+#define IsRep0Long (IsRepG2 + kNumStates)
+#define PosSlot (IsRep0Long + (kNumStates << kNumPosBitsMax))
+#define SpecPos (PosSlot + (kNumLenToPosStates << kNumPosSlotBits))
+#define Align (SpecPos + kNumFullDistances - kEndPosModelIndex)
+#define LenCoder (Align + kAlignTableSize)
+#define RepLenCoder (LenCoder + kNumLenProbs)
+#define Literal (RepLenCoder + kNumLenProbs)
+
+#if Literal != LZMA_BASE_SIZE
+StopCompilingDueBUG
+#endif
+
+static const Byte kLiteralNextStates[kNumStates] = { 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 4, 5 };
+
+int LzmaDecodeProperties(CLzmaProperties *propsRes, const unsigned char *propsData, int size)
+{
+  unsigned char prop0;
+  if (size < LZMA_PROPERTIES_SIZE)
+    return LZMA_RESULT_DATA_ERROR;
+  prop0 = propsData[0];
+  if (prop0 >= (9 * 5 * 5))
+    return LZMA_RESULT_DATA_ERROR;
+  for (propsRes->pb = 0; prop0 >= (9 * 5); propsRes->pb++, prop0 -= (9 * 5));
+  for (propsRes->lp = 0; prop0 >= 9; propsRes->lp++, prop0 -= 9);
+  propsRes->lc = prop0;
+  return LZMA_RESULT_OK;
+}
+
+#define FAST_FUNC LzmaDecodeAny
+#define FAST_LOCALS \
+  UInt32 posStateMask = (1 << (vs->Properties.pb)) - 1; \
+  UInt32 literalPosMask = (1 << (vs->Properties.lp)) - 1; \
+  int lc = vs->Properties.lc;
+#define FAST_POS_STATE(pos) ((UInt32)(pos) & posStateMask)
+#define FAST_LIT_PROBS(pos, prev) (p + Literal + (LZMA_LIT_SIZE * \
+  ((((UInt32)(pos) & literalPosMask) << lc) + ((UInt32)(prev) >> (8 - lc)))))
+#include "LzmaDecodeFastLoop.h"
+#undef FAST_FUNC
+#undef FAST_LOCALS
+#undef FAST_POS_STATE
+#undef FAST_LIT_PROBS
+
+#define FAST_FUNC LzmaDecodeLc3Lp0Pb2
+#define FAST_LOCALS
+#define FAST_POS_STATE(pos) ((UInt32)(pos) & 3)
+#define FAST_LIT_PROBS(pos, prev) (p + Literal + LZMA_LIT_SIZE * ((UInt32)(prev) >> 5))
+#include "LzmaDecodeFastLoop.h"
+
+int LzmaDecode(CLzmaDecoderState *vs,
+    const unsigned char *inStream, SizeT inSize, SizeT *inSizeProcessed,
+    unsigned char *outStream, SizeT outSize, SizeT *outSizeProcessed)
+{
+  if (vs->Properties.lc == 3 && vs->Properties.lp == 0 && vs->Properties.pb == 2)
+    return LzmaDecodeLc3Lp0Pb2(vs, inStream, inSize, inSizeProcessed,
+        outStream, outSize, outSizeProcessed);
+  return LzmaDecodeAny(vs, inStream, inSize, inSizeProcessed,
+      outStream, outSize, outSizeProcessed);
+}
@@ -841,7 +841,12 @@ int mangle2(void **strm, char *d, char *s, int size,
 	int error, c_byte = 0;
 
 	if(!uncompressed) {
-		c_byte = comp->compress(strm, d, s, size, block_size, &error);
+		if(*strm == NULL && compressor_init(comp, strm, block_size,
+				data_block))
+			BAD_ERROR("mangle2:: %s compressor_init failed\n",
+				comp->name);
+		c_byte = compressor_compress(comp, *strm, d, s, size,
+			block_size, &error);
 		if(c_byte == -1)
 			BAD_ERROR("mangle2:: %s compress failed with error "
 				"code %d\n", comp->name, error);
@@ -1621,8 +1626,8 @@ struct file_buffer *get_fragment(struct fragment *fragment)
 		else
 			data = read_from_disk(start_block, size);
 
-		res = comp->uncompress(buffer->data, data, size, block_size,
-			&error);
+		res = compressor_uncompress(comp, buffer->data, data, size,
+			block_size, &error);
 		if(res == -1)
 			BAD_ERROR("%s uncompress failed with error code %d\n",
 				comp->name, error);
@@ -4789,6 +4794,13 @@ printOptions:
 		}
 	}
 
+	/*
+	 * This format has no room for compressor options, so the compressor
+	 * always uses its defaults
+	 */
+	if(compressor_options_post(comp, block_size) == -1)
+		EXIT_MKSQUASHFS();
+
 	initialise_threads();
 
 	if(delete) {
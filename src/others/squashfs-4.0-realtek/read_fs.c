@@ -84,7 +84,7 @@ int read_block(int fd, long long start, long long *next, void *block,
 		c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
 		read_destination(fd, start + offset, c_byte, buffer);
 
-		res = comp->uncompress(block, buffer, c_byte,
+		res = compressor_uncompress(comp, block, buffer, c_byte,
 			SQUASHFS_METADATA_SIZE, &error);
 		if(res == -1) {
 			ERROR("%s uncompress failed with error code %d\n",
@@ -391,6 +391,12 @@ struct compressor *read_super(int fd, squashfs_super_block *sBlk, char *source)
 		goto failed_mount;
 	}
 
+	/* there are no compressor options on disk, set the defaults */
+	if(compressor_extract_options(comp, sBlk->block_size, NULL, 0) == -1) {
+		ERROR("Compressor failed to set compressor options\n");
+		goto failed_mount;
+	}
+
 	printf("Found a valid %sSQUASHFS superblock on %s.\n",
 		SQUASHFS_EXPORTABLE(sBlk->flags) ? "exportable " : "", source);
 	printf("\tCompression used %s\n", comp->name);
@@ -230,6 +230,8 @@ typedef long long		squashfs_inode_t;
 
 #define ZLIB_COMPRESSION	1
 #define LZMA_COMPRESSION	2
+#define LZO_COMPRESSION		3
+#define XZ_COMPRESSION		4
 
 struct squashfs_super_block {
 	unsigned int		s_magic;
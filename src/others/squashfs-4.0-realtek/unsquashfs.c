@@ -600,7 +600,7 @@ int read_block(long long start, long long *next, char *block)
 		if(read_bytes(start + offset, c_byte, buffer) == FALSE)
 			goto failed;
 
-		res = comp->uncompress(block, buffer, c_byte,
+		res = compressor_uncompress(comp, block, buffer, c_byte,
 			SQUASHFS_METADATA_SIZE, &error);
 
 		if(res == -1) {
@@ -639,7 +639,8 @@ int read_data_block(long long start, unsigned int size, char *block)
 		if(read_bytes(start, c_byte, data) == FALSE)
 			goto failed;
 
-		res = comp->uncompress(block, data, c_byte, block_size, &error);
+		res = compressor_uncompress(comp, block, data, c_byte,
+			block_size, &error);
 
 		if(res == -1) {
 			ERROR("%s uncompress failed with error code %d\n",
@@ -1459,6 +1460,13 @@ int read_super(char *source)
 			display_compressors("", "");
 			goto failed_mount;
 		}
+
+		/* there are no compressor options on disk, set the defaults */
+		if(compressor_extract_options(comp, sBlk.block_size, NULL,
+				0) == -1) {
+			ERROR("Compressor failed to set compressor options\n");
+			goto failed_mount;
+		}
 		return TRUE;
 	}
 
@@ -1709,14 +1717,15 @@ void *writer(void *arg)
 void *deflator(void *arg)
 {
 	char tmp[block_size];
+	void *stream = compressor_uncompress_init(comp, block_size);
 
 	while(1) {
 		struct cache_entry *entry = queue_get(to_deflate);
 		int error, res;
 
-		res = comp->uncompress(tmp, entry->data,
-			SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size), block_size,
-			&error);
+		res = compressor_uncompress_stream(comp, stream, tmp,
+			entry->data, SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
+			block_size, &error);
 
 		if(res == -1)
 			ERROR("%s uncompress failed with error code %d\n",
@@ -112,6 +112,9 @@
 #include "pseudo.h"
 #include "compressor.h"
 #include "xattr.h"
+#ifdef SQFS_CONVERT
+#include "sqfs-source.h"
+#endif
 
 int delete = FALSE;
 int fd;
@@ -322,6 +325,7 @@ struct file_buffer {
 	int used;
 	int	fragment;
 	int error;
+	int raw;
 	struct file_buffer *hash_next;
 	struct file_buffer *hash_prev;
 	struct file_buffer *free_next;
@@ -655,6 +659,7 @@ struct file_buffer *cache_get(struct cache *cache, long long index, int keep)
 	/* initialise block and if a keep block insert into the hash table */
 	entry->used = 1;
 	entry->error = FALSE;
+	entry->raw = FALSE;
 	entry->keep = keep;
 	if(keep) {
 		entry->index = index;
@@ -727,14 +732,6 @@ inline void inc_progress_bar()
 }
 
 
-inline void update_progress_bar()
-{
-	pthread_mutex_lock(&progress_mutex);
-	pthread_cond_signal(&progress_wait);
-	pthread_mutex_unlock(&progress_mutex);
-}
-
-
 inline void waitforthread(int i)
 {
 	TRACE("Waiting for thread %d\n", i);
@@ -1196,6 +1193,17 @@ unsigned int get_guid(unsigned int guid)
 }
 
 
+/* as readlink(2), sqfs-convert reads symlinks from the source image */
+int read_link(struct dir_ent *dir_ent, char *buff, int size)
+{
+#ifdef SQFS_CONVERT
+	if(dir_ent->inode->source_ref != -1)
+		return source_readlink(dir_ent->inode->source_ref, buff, size);
+#endif
+	return readlink(dir_ent->pathname, buff, size);
+}
+
+
 int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 	struct dir_ent *dir_ent, int type, long long byte_size,
 	long long start_block, unsigned int offset, unsigned int *block_list,
@@ -1404,7 +1412,7 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 		char buff[65536];
 		size_t off = offsetof(struct squashfs_symlink_inode_header, symlink);
 
-		byte = readlink(filename, buff, 65536);
+		byte = read_link(dir_ent, buff, 65536);
 		if(byte == -1) {
 			ERROR("Failed to read symlink %s, creating empty "
 				"symlink\n", filename);
@@ -1431,7 +1439,7 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 		char buff[65536];
 		size_t off = offsetof(struct squashfs_symlink_inode_header, symlink);
 
-		byte = readlink(filename, buff, 65536);
+		byte = read_link(dir_ent, buff, 65536);
 		if(byte == -1) {
 			ERROR("Failed to read symlink %s, creating empty "
 				"symlink\n", filename);
@@ -2446,6 +2454,80 @@ read_err:
 }
 
 
+#ifdef SQFS_CONVERT
+/*
+ * Read a file of the source image.  If verbatim its data blocks are passed
+ * to the deflators as they are stored, to be copied rather than compressed
+ */
+int verbatim = FALSE;
+void reader_read_source(struct dir_ent *dir_ent)
+{
+	struct stat *buf = &dir_ent->inode->buf;
+	struct file_buffer *file_buffer;
+	int blocks, byte, count = 0, expected, frag_block, c_byte;
+	long long read_size = buf->st_size;
+	void *file;
+
+	if(dir_ent->inode->read)
+		return;
+
+	dir_ent->inode->read = TRUE;
+	blocks = (read_size + block_size - 1) >> block_log;
+	frag_block = !no_fragments && (always_use_fragments ||
+		(read_size < block_size)) ? read_size >> block_log : -1;
+
+	file_buffer = cache_get(reader_buffer, 0, 0);
+	file_buffer->sequence = seq ++;
+	file_buffer->file_size = read_size;
+
+	file = source_open_file(dir_ent->inode->source_ref);
+	if(file == NULL)
+		goto read_err;
+
+	while(1) {
+		expected = read_size - ((long long) count * block_size) >
+			block_size ? block_size :
+			read_size - ((long long) count * block_size);
+
+		byte = verbatim && count != frag_block ?
+			source_read_raw(file, count, file_buffer->data,
+			&c_byte) : 0;
+		if(byte > 0) {
+			file_buffer->raw = TRUE;
+			file_buffer->c_byte = c_byte;
+		} else if(byte == 0 && expected)
+			byte = source_read(file, (long long) count * block_size,
+				file_buffer->data, expected);
+		if(byte == -1)
+			goto read_err;
+
+		file_buffer->size = byte;
+		file_buffer->block = count;
+		file_buffer->fragment = (count == frag_block);
+
+		if(++ count >= blocks)
+			break;
+
+		queue_put(from_reader, file_buffer);
+		file_buffer = cache_get(reader_buffer, 0, 0);
+		file_buffer->sequence = seq ++;
+		file_buffer->file_size = read_size;
+	}
+
+	queue_put(from_reader, file_buffer);
+	source_close_file(file);
+
+	return;
+
+read_err:
+	if(file)
+		source_close_file(file);
+	file_buffer->error = TRUE;
+	queue_put(from_deflate, file_buffer);
+}
+#endif
+
+
 void reader_scan(struct dir_info *dir) {
 	int i;
 
@@ -2462,6 +2544,12 @@ void reader_scan(struct dir_info *dir) {
 
 		switch(buf->st_mode & S_IFMT) {
 			case S_IFREG:
+#ifdef SQFS_CONVERT
+				if(dir_ent->inode->source_ref != -1) {
+					reader_read_source(dir_ent);
+					break;
+				}
+#endif
 				reader_read_file(dir_ent);
 				break;
 			case S_IFDIR:
@@ -2575,7 +2663,8 @@ void *deflator(void *arg)
 		struct file_buffer *file_buffer = queue_get(from_reader);
 		struct file_buffer *write_buffer;
 
-		if(sparse_files && all_zero(file_buffer)) { 
+		if(!file_buffer->raw && sparse_files &&
+				all_zero(file_buffer)) { 
 			file_buffer->c_byte = 0;
 			queue_put(from_deflate, file_buffer);
 		} else if(file_buffer->fragment) {
@@ -2583,9 +2672,15 @@ void *deflator(void *arg)
 			queue_put(from_deflate, file_buffer);
 		} else {
 			write_buffer = cache_get(writer_buffer, 0, 0);
-			write_buffer->c_byte = mangle2(stream,
-				write_buffer->data, file_buffer->data,
-				file_buffer->size, block_size, noD, 1);
+			if(file_buffer->raw) {
+				/* already compressed, c_byte is its size word */
+				memcpy(write_buffer->data, file_buffer->data,
+					file_buffer->size);
+				write_buffer->c_byte = file_buffer->c_byte;
+			} else
+				write_buffer->c_byte = mangle2(stream,
+					write_buffer->data, file_buffer->data,
+					file_buffer->size, block_size, noD, 1);
 			write_buffer->sequence = file_buffer->sequence;
 			write_buffer->file_size = file_buffer->file_size;
 			write_buffer->block = file_buffer->block;
@@ -2688,6 +2783,11 @@ struct file_buffer *get_file_buffer(struct queue *queue)
 }
 
 
+/*
+ * Redraws the bar every quarter second.  cur_uncompressed is only bumped
+ * by the main thread and estimated_uncompressed by the reader, so they are
+ * read without locking.  Not started with -no-progress.
+ */
 void *progress_thrd(void *arg)
 {
 	struct timeval timeval;
@@ -3321,6 +3421,7 @@ struct inode_info *lookup_inode(struct stat *buf)
 	inode->read = FALSE;
 	inode->root_entry = FALSE;
 	inode->pseudo_file = FALSE;
+	inode->source_ref = -1;
 	inode->inode = SQUASHFS_INVALID_BLK;
 	inode->nlink = 1;
 
@@ -3569,11 +3670,73 @@ void scan3_freedir(struct directory *dir)
 }
 
 
+#ifdef SQFS_CONVERT
+/*
+ * As dir_scan1(), of a directory of the source image.  The pathnames are
+ * the image name followed by the path within it, and are only used in
+ * messages
+ */
+struct dir_info *source_scan1(long long ref, char *pathname,
+	struct pathnames *paths)
+{
+	char filename[8192], *name;
+	long long entry;
+	struct dir_info *dir;
+	void *source_dir = source_opendir(ref);
+
+	if(source_dir == NULL) {
+		ERROR("Could not open %s, skipping...\n", pathname);
+		return NULL;
+	}
+
+	dir = scan1_opendir("");
+	free(dir->pathname);
+	dir->pathname = strdup(pathname);
+
+	while(source_readdir(source_dir, &name, &entry) != FALSE) {
+		struct dir_info *sub_dir;
+		struct inode_info *inode;
+		struct stat buf;
+		struct pathnames *new;
+
+		strcat(strcat(strcpy(filename, pathname), "/"), name);
+		source_stat(entry, &buf);
+
+		if(excluded(paths, name, &new))
+			continue;
+
+		if((buf.st_mode & S_IFMT) == S_IFDIR) {
+			sub_dir = source_scan1(entry, filename, new);
+			if(sub_dir == NULL)
+				continue;
+			dir->directory_count ++;
+		} else
+			sub_dir = NULL;
+
+		inode = lookup_inode(&buf);
+		inode->source_ref = entry;
+		add_dir_entry(name, filename, sub_dir, inode, dir);
+	}
+
+	source_closedir(source_dir);
+	free(dir->pathname);
+	dir->pathname = NULL;
+
+	return dir;
+}
+#endif
+
+
 void dir_scan(squashfs_inode *inode, char *pathname,
 	int (_readdir)(char *, char *, struct dir_info *))
 {
 	struct stat buf;
+#ifdef SQFS_CONVERT
+	struct dir_info *dir_info = source_scan1(source_root(), pathname,
+		paths);
+#else
 	struct dir_info *dir_info = dir_scan1(pathname, paths, _readdir);
+#endif
 	struct dir_ent *dir_ent;
 	
 	if(dir_info == NULL)
@@ -3600,11 +3763,15 @@ void dir_scan(squashfs_inode *inode, char *pathname,
 		dir_ent->inode = lookup_inode(&buf);
 		dir_ent->inode->pseudo_file = PSEUDO_FILE_OTHER;
 	} else {
+#ifdef SQFS_CONVERT
+		source_stat(source_root(), &buf);
+#else
 		if(lstat(pathname, &buf) == -1) {
 			ERROR("Cannot stat dir/file %s because %s, ignoring",
 				pathname, strerror(errno));
 			return;
 		}
+#endif
 		dir_ent->inode = lookup_inode(&buf);
 	}
 
@@ -3949,7 +4116,6 @@ void dir_scan3(squashfs_inode *inode, struct dir_info *dir_info)
 		}
 		
 		add_dir(*inode, inode_number, dir_name, squashfs_type, &dir);
-		update_progress_bar();
 	}
 
 	write_dir(inode, dir_info, &dir);
@@ -4101,7 +4267,8 @@ void initialise_threads(int readb_mbytes, int writeb_mbytes,
 	fragment_buffer = cache_init(block_size, fragment_buffer_size);
 	pthread_create(&thread[0], NULL, reader, NULL);
 	pthread_create(&thread[1], NULL, writer, NULL);
-	pthread_create(&progress_thread, NULL, progress_thrd, NULL);
+	if(progress)
+		pthread_create(&progress_thread, NULL, progress_thrd, NULL);
 	pthread_mutex_init(&fragment_mutex, NULL);
 	pthread_cond_init(&fragment_waiting, NULL);
 
@@ -4560,6 +4727,9 @@ int main(int argc, char *argv[])
 	int readb_mbytes = READER_BUFFER_DEFAULT,
 		writeb_mbytes = WRITER_BUFFER_DEFAULT,
 		fragmentb_mbytes = FRAGMENT_BUFFER_DEFAULT;
+#ifdef SQFS_CONVERT
+	struct source_info source_info;
+#endif
 
 	pthread_mutex_init(&progress_mutex, NULL);
 	block_log = slog(block_size);
@@ -4578,6 +4748,19 @@ int main(int argc, char *argv[])
 	 * for failure here
 	 */
 	comp = lookup_compressor(COMP_DEFAULT);
+#ifdef SQFS_CONVERT
+	if(source != 1)
+		goto printOptions;
+	if(source_open(source_path[0], &source_info) == FALSE)
+		exit(1);
+
+	/* a 4.x image keeps its compressor and block size by default */
+	if(source_info.major == 4) {
+		if(lookup_compressor_id(source_info.comp_id)->supported)
+			comp = lookup_compressor_id(source_info.comp_id);
+		block_log = slog(block_size = source_info.block_size);
+	}
+#endif
 	for(; i < argc; i++) {
 		if(strcmp(argv[i], "-comp") == 0) {
 			if(compressor_opts_parsed) {
@@ -4736,6 +4919,10 @@ int main(int argc, char *argv[])
 			always_use_fragments = TRUE;
 
 		 else if(strcmp(argv[i], "-sort") == 0) {
+#ifdef SQFS_CONVERT
+			ERROR("%s: -sort is not supported\n", argv[0]);
+			exit(1);
+#endif
 			if(++i == argc) {
 				ERROR("%s: -sort missing filename\n", argv[0]);
 				exit(1);
@@ -4841,8 +5028,13 @@ int main(int argc, char *argv[])
 		} else {
 			ERROR("%s: invalid option\n\n", argv[0]);
 printOptions:
+#ifdef SQFS_CONVERT
+			ERROR("SYNTAX:%s source-image dest [options] "
+				"[-e list of exclude\ndirs/files]\n", argv[0]);
+#else
 			ERROR("SYNTAX:%s source1 source2 ...  dest [options] "
 				"[-e list of exclude\ndirs/files]\n", argv[0]);
+#endif
 			ERROR("\nFilesystem build options:\n");
 			ERROR("-comp <comp>\t\tselect <comp> compression\n");
 			ERROR("\t\t\tCompressors available:\n");
@@ -4952,6 +5144,22 @@ printOptions:
 	if(res)
 		EXIT_MKSQUASHFS();
 
+#ifdef SQFS_CONVERT
+	/*
+	 * The destination is always a new filesystem of the image's root,
+	 * excludes are paths within the image, and the image's xattrs aren't
+	 * read
+	 */
+	source_stat(source_root(), &source_buf);
+	delete = TRUE;
+	keep_as_directory = FALSE;
+	old_exclude = FALSE;
+	no_xattrs = TRUE;
+	verbatim = source_info.major == 4 &&
+		source_info.comp_id == comp->id &&
+		source_info.block_size == block_size && !noD &&
+		!compressor_opts_parsed;
+#else
 	for(i = 0; i < source; i++)
 		if(lstat(source_path[i], &source_buf) == -1) {
 			fprintf(stderr, "Cannot stat source directory \"%s\" "
@@ -4959,6 +5167,7 @@ printOptions:
 				strerror(errno));
 			EXIT_MKSQUASHFS();
 		}
+#endif
 
 	destination_file = argv[source + 1];
 	if(stat(argv[source + 1], &buf) == -1) {
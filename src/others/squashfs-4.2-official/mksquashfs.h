@@ -67,6 +67,7 @@ struct inode_info {
 	unsigned int		inode_number;
 	unsigned int		nlink;
 	int			pseudo_id;
+	long long		source_ref;
 	char			type;
 	char			read;
 	char			root_entry;
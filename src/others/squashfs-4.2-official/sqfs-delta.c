@@ -0,0 +1,701 @@
+/*
+ * Make a block level delta between two squashfs 4.0 filesystems, and
+ * rebuild the new filesystem from the old one and the delta.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * sqfs-delta.c
+ */
+
+#define TRUE 1
+#define FALSE 0
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef linux
+#define __BYTE_ORDER BYTE_ORDER
+#define __BIG_ENDIAN BIG_ENDIAN
+#define __LITTLE_ENDIAN LITTLE_ENDIAN
+#else
+#include <endian.h>
+#endif
+
+#define ERROR(s, args...) \
+		do { \
+			fprintf(stderr, s, ## args); \
+		} while(0)
+
+#include "squashfs_fs.h"
+#include "squashfs_swap.h"
+#include "read_fs.h"
+#include "compressor.h"
+#include "sqfs-delta.h"
+
+extern struct compressor *read_super(int fd, struct squashfs_super_block *sBlk,
+	char *source);
+extern unsigned int *read_id_table(int fd, struct squashfs_super_block *sBlk);
+extern int read_fragment_table(int fd, struct squashfs_super_block *sBlk,
+	struct squashfs_fragment_entry **fragment_table);
+extern int scan_inode_table(int fd, long long start, long long end,
+	long long root_inode_start, int root_inode_offset,
+	struct squashfs_super_block *sBlk, union squashfs_inode_header *dir_inode,
+	unsigned char **inode_table, unsigned int *root_inode_block,
+	unsigned int *root_inode_size, long long *uncompressed_file,
+	unsigned int *uncompressed_directory, int *file_count, int *sym_count,
+	int *dev_count, int *dir_count, int *fifo_count, int *sock_count,
+	unsigned int *id_table);
+
+#define DELTA_BUFFER_SIZE	65536
+#define EXTENT_HASH_SIZE	65536
+#define EXTENT_HASH(hash)	((hash) & (EXTENT_HASH_SIZE - 1))
+
+/* a compressed data or fragment block of an image */
+struct extent {
+	long long	start;
+	int		size;
+	unsigned int	hash;
+	int		next;
+};
+
+struct image {
+	char		*name;
+	int		fd;
+	struct squashfs_super_block sBlk;
+	long long	size;
+	struct extent	*extent;
+	int		extents;
+	int		max_extents;
+	int		*hash_table;
+};
+
+/* the image being scanned, which add_file() adds the blocks of */
+static struct image *scanning;
+
+static char buffer[DELTA_BUFFER_SIZE], buffer2[DELTA_BUFFER_SIZE];
+
+/* the copy op being extended, written before any other op */
+static struct sqfs_delta_op pending;
+
+static long long copied = 0, literal = 0, delta_bytes = 0;
+
+
+int read_bytes(int fd, void *buff, int bytes)
+{
+	int res, count;
+
+	for(count = 0; count < bytes; count += res) {
+		res = read(fd, buff + count, bytes - count);
+		if(res < 1) {
+			if(res == 0)
+				goto bytes_read;
+			else if(errno != EINTR) {
+				ERROR("Read failed because %s\n",
+						strerror(errno));
+				return -1;
+			} else
+				res = 0;
+		}
+	}
+
+bytes_read:
+	return count;
+}
+
+
+int read_fs_bytes(int fd, long long byte, int bytes, void *buff)
+{
+	off_t off = byte;
+
+	if(lseek(fd, off, SEEK_SET) == -1) {
+		ERROR("Lseek failed because %s\n", strerror(errno));
+		return 0;
+	}
+
+	if(read_bytes(fd, buff, bytes) < bytes) {
+		ERROR("Read failed\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+
+int write_bytes(int fd, void *buff, int bytes)
+{
+	int res, count;
+
+	for(count = 0; count < bytes; count += res) {
+		res = write(fd, buff + count, bytes - count);
+		if(res == -1) {
+			if(errno != EINTR) {
+				ERROR("Write failed because %s\n",
+						strerror(errno));
+				return -1;
+			}
+			res = 0;
+		}
+	}
+
+	return 0;
+}
+
+
+/* FNV-1a */
+unsigned int checksum(char *buff, int bytes, unsigned int sum)
+{
+	unsigned char *b = (unsigned char *) buff;
+
+	while(bytes --)
+		sum = (sum ^ *b ++) * 16777619;
+
+	return sum;
+}
+
+
+/* scan_inode_table() only needs the id table read, not the ids kept */
+void *create_id(unsigned int id)
+{
+	return NULL;
+}
+
+
+unsigned int get_uid(unsigned int uid)
+{
+	return 0;
+}
+
+
+unsigned int get_guid(unsigned int guid)
+{
+	return 0;
+}
+
+
+/* nor is read_filesystem(), which reads the xattrs, used */
+int get_xattrs(int fd, struct squashfs_super_block *sBlk)
+{
+	return 1;
+}
+
+
+void add_extent(struct image *image, long long start, int size)
+{
+	if(image->extents == image->max_extents) {
+		image->max_extents = image->max_extents ?
+			image->max_extents * 2 : 1024;
+		image->extent = realloc(image->extent, image->max_extents *
+			sizeof(struct extent));
+		if(image->extent == NULL) {
+			ERROR("Out of memory in add_extent\n");
+			exit(1);
+		}
+	}
+
+	image->extent[image->extents].start = start;
+	image->extent[image->extents ++].size = size;
+}
+
+
+void add_file(long long start, long long file_size, long long file_bytes,
+	unsigned int *block_list, int blocks, unsigned int fragment,
+	int offset, int bytes)
+{
+	int i;
+
+	for(i = 0; i < blocks; i++) {
+		int size = SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[i]);
+
+		/* sparse blocks aren't stored */
+		if(size)
+			add_extent(scanning, start, size);
+		start += size;
+	}
+
+	free(block_list);
+}
+
+
+int compare_extent(const void *e1, const void *e2)
+{
+	const struct extent *extent1 = e1, *extent2 = e2;
+
+	if(extent1->start == extent2->start)
+		return 0;
+	return extent1->start < extent2->start ? -1 : 1;
+}
+
+
+/*
+ * Find the compressed blocks of the image from its inode block lists and
+ * fragment table, sorted and with the blocks of duplicate files once
+ */
+int scan_image(struct image *image)
+{
+	struct squashfs_super_block *sBlk = &image->sBlk;
+	struct squashfs_fragment_entry *fragment_table = NULL;
+	union squashfs_inode_header dir_inode;
+	unsigned char *inode_table = NULL;
+	unsigned int *id_table, root_inode_block, root_inode_size,
+		uncompressed_directory = 0;
+	long long uncompressed_file = 0;
+	int file_count = 0, sym_count = 0, dev_count = 0, dir_count = 0,
+		fifo_count = 0, sock_count = 0, i, j;
+	struct stat buf;
+
+	if((image->fd = open(image->name, O_RDONLY)) == -1) {
+		ERROR("Could not open %s, because %s\n", image->name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	if(fstat(image->fd, &buf) == -1) {
+		ERROR("Could not stat %s, because %s\n", image->name,
+			strerror(errno));
+		return FALSE;
+	}
+	image->size = buf.st_size;
+
+	if(read_super(image->fd, sBlk, image->name) == NULL)
+		return FALSE;
+
+	id_table = read_id_table(image->fd, sBlk);
+	if(id_table == NULL)
+		return FALSE;
+
+	scanning = image;
+	if(scan_inode_table(image->fd, sBlk->inode_table_start,
+			sBlk->directory_table_start, sBlk->inode_table_start +
+			SQUASHFS_INODE_BLK(sBlk->root_inode),
+			SQUASHFS_INODE_OFFSET(sBlk->root_inode), sBlk,
+			&dir_inode, &inode_table, &root_inode_block,
+			&root_inode_size, &uncompressed_file,
+			&uncompressed_directory, &file_count, &sym_count,
+			&dev_count, &dir_count, &fifo_count, &sock_count,
+			id_table) == FALSE) {
+		ERROR("Failed to read the inode table of %s\n", image->name);
+		return FALSE;
+	}
+	free(inode_table);
+	free(id_table);
+
+	if(read_fragment_table(image->fd, sBlk, &fragment_table) == 0)
+		return FALSE;
+	for(i = 0; i < sBlk->fragments; i++)
+		add_extent(image, fragment_table[i].start_block,
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(fragment_table[i].size));
+	free(fragment_table);
+
+	qsort(image->extent, image->extents, sizeof(struct extent),
+		compare_extent);
+	for(i = 0, j = 0; i < image->extents; i++)
+		if(j == 0 || image->extent[i].start !=
+				image->extent[j - 1].start)
+			image->extent[j ++] = image->extent[i];
+	image->extents = j;
+
+	for(i = 0; i < image->extents; i++) {
+		struct extent *extent = &image->extent[i];
+
+		if(extent->start + extent->size > image->size ||
+				extent->size > SQUASHFS_FILE_MAX_SIZE) {
+			ERROR("Block at %lld in %s is corrupt\n", extent->start,
+				image->name);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+int hash_extent(struct image *image, struct extent *extent)
+{
+	long long start = extent->start;
+	int bytes = extent->size;
+
+	extent->hash = 2166136261U;
+	while(bytes) {
+		int size = bytes > DELTA_BUFFER_SIZE ? DELTA_BUFFER_SIZE :
+			bytes;
+
+		if(read_fs_bytes(image->fd, start, size, buffer) == 0)
+			return FALSE;
+		extent->hash = checksum(buffer, size, extent->hash);
+		start += size;
+		bytes -= size;
+	}
+
+	return TRUE;
+}
+
+
+int same_bytes(struct image *image1, long long start1, struct image *image2,
+	long long start2, int bytes)
+{
+	while(bytes) {
+		int size = bytes > DELTA_BUFFER_SIZE ? DELTA_BUFFER_SIZE :
+			bytes;
+
+		if(read_fs_bytes(image1->fd, start1, size, buffer) == 0 ||
+				read_fs_bytes(image2->fd, start2, size,
+				buffer2) == 0)
+			return FALSE;
+		if(memcmp(buffer, buffer2, size) != 0)
+			return FALSE;
+		start1 += size;
+		start2 += size;
+		bytes -= size;
+	}
+
+	return TRUE;
+}
+
+
+int hash_image(struct image *image)
+{
+	int i;
+
+	image->hash_table = malloc(EXTENT_HASH_SIZE * sizeof(int));
+	if(image->hash_table == NULL) {
+		ERROR("Out of memory in hash_image\n");
+		return FALSE;
+	}
+	for(i = 0; i < EXTENT_HASH_SIZE; i++)
+		image->hash_table[i] = -1;
+
+	for(i = 0; i < image->extents; i++) {
+		struct extent *extent = &image->extent[i];
+
+		if(hash_extent(image, extent) == FALSE)
+			return FALSE;
+		extent->next = image->hash_table[EXTENT_HASH(extent->hash)];
+		image->hash_table[EXTENT_HASH(extent->hash)] = i;
+	}
+
+	return TRUE;
+}
+
+
+/* where the block of the new image is in the old one, or -1 */
+long long lookup_extent(struct image *old, struct image *new,
+	struct extent *extent)
+{
+	int i;
+
+	if(hash_extent(new, extent) == FALSE)
+		return -1;
+
+	for(i = old->hash_table[EXTENT_HASH(extent->hash)]; i != -1;
+			i = old->extent[i].next)
+		if(old->extent[i].hash == extent->hash &&
+				old->extent[i].size == extent->size &&
+				same_bytes(old, old->extent[i].start, new,
+				extent->start, extent->size))
+			return old->extent[i].start;
+
+	return -1;
+}
+
+
+int write_op(int fd, long long length, long long start, int type)
+{
+	struct sqfs_delta_op op;
+
+	op.length = length;
+	op.start = start;
+	op.type = type;
+	op.unused = 0;
+	SQFS_DELTA_SWAP_OP(&op);
+	delta_bytes += sizeof(op);
+
+	return write_bytes(fd, &op, sizeof(op));
+}
+
+
+int flush_copy(int fd)
+{
+	int res = 0;
+
+	if(pending.length) {
+		res = write_op(fd, pending.length, pending.start,
+			SQFS_DELTA_COPY);
+		copied += pending.length;
+		pending.length = 0;
+	}
+
+	return res;
+}
+
+
+int write_copy(int fd, long long start, int size)
+{
+	if(pending.length && pending.start + pending.length == start) {
+		pending.length += size;
+		return 0;
+	}
+
+	if(flush_copy(fd) == -1)
+		return -1;
+
+	pending.start = start;
+	pending.length = size;
+	return 0;
+}
+
+
+/* the bytes of the new image from start are written to the delta as is */
+int write_literal(int fd, struct image *new, long long start,
+	long long length)
+{
+	if(length == 0)
+		return 0;
+
+	if(flush_copy(fd) == -1 || write_op(fd, length, 0,
+			SQFS_DELTA_DATA) == -1)
+		return -1;
+
+	literal += length;
+	delta_bytes += length;
+	while(length) {
+		int size = length > DELTA_BUFFER_SIZE ? DELTA_BUFFER_SIZE :
+			length;
+
+		if(read_fs_bytes(new->fd, start, size, buffer) == 0 ||
+				write_bytes(fd, buffer, size) == -1)
+			return -1;
+		start += size;
+		length -= size;
+	}
+
+	return 0;
+}
+
+
+int make_delta(struct image *old, struct image *new, char *delta_name)
+{
+	struct sqfs_delta_header header;
+	long long pos;
+	int fd, i;
+
+	if(scan_image(old) == FALSE || hash_image(old) == FALSE ||
+			scan_image(new) == FALSE)
+		return FALSE;
+
+	fd = open(delta_name, O_CREAT | O_TRUNC | O_WRONLY,
+		S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if(fd == -1) {
+		ERROR("Could not create %s, because %s\n", delta_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	header.magic = SQFS_DELTA_MAGIC;
+	header.checksum = 2166136261U;
+	header.new_size = new->size;
+	for(pos = 0; pos < new->size; pos += DELTA_BUFFER_SIZE) {
+		int size = new->size - pos > DELTA_BUFFER_SIZE ?
+			DELTA_BUFFER_SIZE : new->size - pos;
+
+		if(read_fs_bytes(new->fd, pos, size, buffer) == 0)
+			goto failed;
+		header.checksum = checksum(buffer, size, header.checksum);
+	}
+	if(read_fs_bytes(old->fd, SQUASHFS_START,
+			sizeof(struct squashfs_super_block),
+			&header.old_sBlk) == 0)
+		goto failed;
+	SQFS_DELTA_SWAP_HEADER(&header);
+	if(write_bytes(fd, &header, sizeof(header)) == -1)
+		goto failed;
+	delta_bytes = sizeof(header);
+
+	/*
+	 * Everything but the blocks found in the old image, which includes
+	 * the superblock and metadata tables, is written literally
+	 */
+	for(pos = 0, i = 0; i < new->extents; i++) {
+		struct extent *extent = &new->extent[i];
+		long long start;
+
+		if(extent->start < pos)
+			continue;
+
+		start = lookup_extent(old, new, extent);
+		if(start == -1)
+			continue;
+
+		if(write_literal(fd, new, pos, extent->start - pos) == -1 ||
+				write_copy(fd, start, extent->size) == -1)
+			goto failed;
+		pos = extent->start + extent->size;
+	}
+
+	if(write_literal(fd, new, pos, new->size - pos) == -1 ||
+			flush_copy(fd) == -1 ||
+			write_op(fd, 0, 0, SQFS_DELTA_END) == -1)
+		goto failed;
+
+	if(close(fd) == -1) {
+		ERROR("Failed to close %s, because %s\n", delta_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	printf("Delta %lld bytes for a %lld byte image, %lld bytes copied "
+		"from %s, %lld bytes new\n", delta_bytes, new->size, copied,
+		old->name, literal);
+	return TRUE;
+
+failed:
+	ERROR("Failed to write delta %s\n", delta_name);
+	close(fd);
+	unlink(delta_name);
+	return FALSE;
+}
+
+
+/*
+ * The delta and the new image are read and written in one pass, so either
+ * can be a pipe ("-"), only the old image is read out of order
+ */
+int apply_delta(char *old_name, char *delta_name, char *new_name)
+{
+	struct sqfs_delta_header header;
+	struct squashfs_super_block sBlk;
+	struct sqfs_delta_op op;
+	unsigned int sum = 2166136261U;
+	long long written = 0;
+	int old_fd, delta_fd, new_fd;
+
+	if((old_fd = open(old_name, O_RDONLY)) == -1) {
+		ERROR("Could not open %s, because %s\n", old_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	if(strcmp(delta_name, "-") == 0)
+		delta_fd = STDIN_FILENO;
+	else if((delta_fd = open(delta_name, O_RDONLY)) == -1) {
+		ERROR("Could not open %s, because %s\n", delta_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	if(read_bytes(delta_fd, &header, sizeof(header)) != sizeof(header))
+		goto bad_delta;
+	SQFS_DELTA_SWAP_HEADER(&header);
+	if(header.magic != SQFS_DELTA_MAGIC)
+		goto bad_delta;
+
+	if(read_fs_bytes(old_fd, SQUASHFS_START, sizeof(sBlk), &sBlk) == 0 ||
+			memcmp(&sBlk, &header.old_sBlk, sizeof(sBlk)) != 0) {
+		ERROR("%s isn't the image %s was made from\n", old_name,
+			delta_name);
+		return FALSE;
+	}
+
+	if(strcmp(new_name, "-") == 0)
+		new_fd = STDOUT_FILENO;
+	else if((new_fd = open(new_name, O_CREAT | O_TRUNC | O_WRONLY,
+			S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) == -1) {
+		ERROR("Could not create %s, because %s\n", new_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	while(1) {
+		if(read_bytes(delta_fd, &op, sizeof(op)) != sizeof(op))
+			goto bad_delta;
+		SQFS_DELTA_SWAP_OP(&op);
+
+		if(op.type == SQFS_DELTA_END)
+			break;
+		if((op.type != SQFS_DELTA_COPY && op.type != SQFS_DELTA_DATA)
+				|| op.length < 0 || written + op.length >
+				header.new_size)
+			goto bad_delta;
+
+		while(op.length) {
+			int size = op.length > DELTA_BUFFER_SIZE ?
+				DELTA_BUFFER_SIZE : op.length;
+
+			if(op.type == SQFS_DELTA_COPY) {
+				if(read_fs_bytes(old_fd, op.start, size,
+						buffer) == 0)
+					goto failed;
+				op.start += size;
+			} else if(read_bytes(delta_fd, buffer, size) != size)
+				goto bad_delta;
+
+			if(write_bytes(new_fd, buffer, size) == -1)
+				goto failed;
+			sum = checksum(buffer, size, sum);
+			written += size;
+			op.length -= size;
+		}
+	}
+
+	if(written != header.new_size || sum != header.checksum) {
+		ERROR("%s doesn't match the image %s was made for\n", new_name,
+			delta_name);
+		return FALSE;
+	}
+
+	if(new_fd != STDOUT_FILENO && close(new_fd) == -1) {
+		ERROR("Failed to close %s, because %s\n", new_name,
+			strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+
+bad_delta:
+	ERROR("%s is truncated or not a delta\n", delta_name);
+	return FALSE;
+
+failed:
+	ERROR("Failed to write %s\n", new_name);
+	return FALSE;
+}
+
+
+int main(int argc, char *argv[])
+{
+	if(argc == 5 && strcmp(argv[1], "-apply") == 0)
+		exit(apply_delta(argv[2], argv[3], argv[4]) ? 0 : 1);
+
+	if(argc == 4 && argv[1][0] != '-') {
+		struct image old = { .name = argv[1] }, new = { .name = argv[2] };
+
+		exit(make_delta(&old, &new, argv[3]) ? 0 : 1);
+	}
+
+	ERROR("SYNTAX: %s old-image new-image delta\n", argv[0]);
+	ERROR("        %s -apply old-image delta new-image\n", argv[0]);
+	ERROR("\nThe first makes a delta of the data and fragment blocks of "
+		"new-image\nmissing from old-image, and its metadata.  The "
+		"second rebuilds new-image\nfrom old-image and the delta, "
+		"either of which can be \"-\" for the standard\ninput "
+		"and output\n");
+	exit(1);
+}
@@ -0,0 +1,58 @@
+#ifndef SQFS_DELTA_H
+#define SQFS_DELTA_H
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * sqfs-delta.h
+ */
+
+/*
+ * A delta is a header followed by ops which write the new image in order,
+ * either copying bytes of the old image or the literal bytes following the
+ * op.  All fields are little endian
+ */
+#define SQFS_DELTA_MAGIC	0x544c4453	/* "SDLT" */
+
+#define SQFS_DELTA_END		0
+#define SQFS_DELTA_COPY		1
+#define SQFS_DELTA_DATA		2
+
+struct sqfs_delta_header {
+	unsigned int			magic;
+	unsigned int			checksum;	/* of the new image */
+	long long			new_size;
+	/* the old image's superblock as stored, to check it is the same */
+	struct squashfs_super_block	old_sBlk;
+};
+
+struct sqfs_delta_op {
+	long long			length;
+	long long			start;		/* in the old image */
+	unsigned int			type;
+	unsigned int			unused;
+};
+
+#define SQFS_DELTA_SWAP_HEADER(s) { \
+	SQUASHFS_INSWAP_INTS(&(s)->magic, 2); \
+	SQUASHFS_INSWAP_LONG_LONGS(&(s)->new_size, 1); \
+}
+
+#define SQFS_DELTA_SWAP_OP(s) { \
+	SQUASHFS_INSWAP_LONG_LONGS(&(s)->length, 2); \
+	SQUASHFS_INSWAP_INTS(&(s)->type, 1); \
+}
+#endif
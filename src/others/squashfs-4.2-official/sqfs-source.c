@@ -0,0 +1,395 @@
+/*
+ * Read a squashfs image with the unsquashfs engine as the source of
+ * sqfs-convert.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * sqfs-source.c
+ */
+
+#include "unsquashfs.h"
+#include "squashfs_compat.h"
+#include "compressor.h"
+#include "sqfs-source.h"
+
+#include <sys/sysmacros.h>
+
+/*
+ * read_inode() and squashfs_opendir() work in static buffers, and the
+ * 1.x - 3.x versions number the inodes as they are read.  mksquashfs
+ * reads files in its reader thread while it reads symlinks in the main
+ * one
+ */
+static pthread_mutex_t engine_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* the last fragment block read, files sharing one are mostly adjacent */
+static pthread_mutex_t fragment_mutex_source = PTHREAD_MUTEX_INITIALIZER;
+static long long fragment_start = -1;
+static char *fragment_block;
+static int fragment_bytes;
+
+struct source_file {
+	struct inode inode;
+	unsigned int *block_list;
+	long long *block_start;
+	long long frag_start;
+	int frag_size;
+	char *compressed;
+	/* the last data block read, reads of the file are mostly in order */
+	char *block;
+	int block_cached;
+	int block_bytes;
+};
+
+
+int source_open(char *image, struct source_info *info)
+{
+	if((fd = open(image, O_RDONLY)) == -1) {
+		ERROR("Could not open %s, because %s\n", image,
+			strerror(errno));
+		return FALSE;
+	}
+
+	if(read_super(image) == FALSE)
+		return FALSE;
+
+	if(!comp->supported) {
+		ERROR("%s uses %s compression, this is unsupported by this "
+			"version\n", image, comp->name);
+		return FALSE;
+	}
+
+	block_size = sBlk.s.block_size;
+	block_log = sBlk.s.block_log;
+
+	fragment_block = malloc(block_size);
+	if(fragment_block == NULL)
+		EXIT_UNSQUASH("source_open: failed to allocate fragment "
+			"buffer\n");
+
+	if(s_ops.read_uids_guids() == FALSE)
+		EXIT_UNSQUASH("failed to uid/gid table\n");
+
+	if(s_ops.read_fragment_table() == FALSE)
+		EXIT_UNSQUASH("failed to read fragment table\n");
+
+	uncompress_inode_table(sBlk.s.inode_table_start,
+		sBlk.s.directory_table_start);
+
+	uncompress_directory_table(sBlk.s.directory_table_start,
+		sBlk.s.fragment_table_start);
+
+	info->major = sBlk.s.s_major;
+	info->minor = sBlk.s.s_minor;
+	info->block_size = block_size;
+	info->comp_id = comp->id;
+	info->comp_name = comp->name;
+
+	return TRUE;
+}
+
+
+long long source_root()
+{
+	return sBlk.s.root_inode;
+}
+
+
+/* a copy of the inode, whose symlink the caller frees */
+static void get_inode(long long ref, struct inode *i)
+{
+	pthread_mutex_lock(&engine_mutex);
+	*i = *s_ops.read_inode(SQUASHFS_INODE_BLK(ref),
+		SQUASHFS_INODE_OFFSET(ref));
+	pthread_mutex_unlock(&engine_mutex);
+}
+
+
+static void put_inode(struct inode *i)
+{
+	if(S_ISLNK(i->mode))
+		free(i->symlink);
+}
+
+
+/*
+ * Hard links are entries with the same inode reference, and so the same
+ * stat, which is how mksquashfs finds them
+ */
+int source_stat(long long ref, struct stat *buf)
+{
+	struct inode i;
+
+	get_inode(ref, &i);
+
+	memset(buf, 0, sizeof(*buf));
+	buf->st_dev = 1;
+	buf->st_ino = ref;
+	buf->st_mode = i.mode;
+	buf->st_nlink = 1;
+	buf->st_uid = i.uid;
+	buf->st_gid = i.gid;
+	buf->st_mtime = i.time;
+
+	if(S_ISREG(i.mode)) {
+		/* mksquashfs only reports sparse files it was told are sparse */
+		buf->st_size = i.data;
+		buf->st_blocks = i.sparse ? 0 : (i.data + 511) >> 9;
+	} else if(S_ISLNK(i.mode))
+		buf->st_size = i.data;
+	else if(S_ISBLK(i.mode) || S_ISCHR(i.mode))
+		buf->st_rdev = makedev((i.data >> 8) & 0xfff, (i.data & 0xff) |
+			((i.data >> 12) & 0xfff00));
+
+	put_inode(&i);
+	return TRUE;
+}
+
+
+void *source_opendir(long long ref)
+{
+	struct inode *i;
+	struct dir *dir;
+
+	pthread_mutex_lock(&engine_mutex);
+	dir = s_ops.squashfs_opendir(SQUASHFS_INODE_BLK(ref),
+		SQUASHFS_INODE_OFFSET(ref), &i);
+	pthread_mutex_unlock(&engine_mutex);
+
+	return dir;
+}
+
+
+int source_readdir(void *dir, char **name, long long *ref)
+{
+	unsigned int start_block, offset, type;
+
+	if(squashfs_readdir(dir, name, &start_block, &offset, &type) == FALSE)
+		return FALSE;
+
+	*ref = SQUASHFS_MKINODE(start_block, offset);
+	return TRUE;
+}
+
+
+void source_closedir(void *dir)
+{
+	squashfs_closedir(dir);
+}
+
+
+/* as readlink(2), the target isn't terminated */
+int source_readlink(long long ref, char *buff, int size)
+{
+	struct inode i;
+	int bytes;
+
+	get_inode(ref, &i);
+	if(!S_ISLNK(i.mode)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	bytes = i.data < size ? i.data : size;
+	memcpy(buff, i.symlink, bytes);
+	put_inode(&i);
+
+	return bytes;
+}
+
+
+void *source_open_file(long long ref)
+{
+	struct source_file *file = malloc(sizeof(struct source_file));
+	long long start;
+	int b;
+
+	if(file == NULL)
+		return NULL;
+
+	get_inode(ref, &file->inode);
+	file->block_list = malloc((file->inode.blocks + 1) *
+		sizeof(unsigned int));
+	file->block_start = malloc((file->inode.blocks + 1) *
+		sizeof(long long));
+	file->compressed = malloc(block_size);
+	file->block = malloc(block_size);
+	file->block_cached = -1;
+	if(file->block_list == NULL || file->block_start == NULL ||
+			file->compressed == NULL || file->block == NULL) {
+		source_close_file(file);
+		return NULL;
+	}
+
+	s_ops.read_block_list(file->block_list, file->inode.block_ptr,
+		file->inode.blocks);
+	for(start = file->inode.start, b = 0; b < file->inode.blocks; b++) {
+		file->block_start[b] = start;
+		start += SQUASHFS_COMPRESSED_SIZE_BLOCK(file->block_list[b]);
+	}
+
+	if(file->inode.frag_bytes)
+		s_ops.read_fragment(file->inode.fragment, &file->frag_start,
+			&file->frag_size);
+
+	return file;
+}
+
+
+static int read_fragment_tail(struct source_file *file, char *buffer,
+	int offset, int size)
+{
+	int error, res = TRUE;
+
+	pthread_mutex_lock(&fragment_mutex_source);
+	if(fragment_start != file->frag_start) {
+		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(file->frag_size);
+
+		fragment_start = -1;
+		if(SQUASHFS_COMPRESSED_BLOCK(file->frag_size)) {
+			res = read_fs_bytes(fd, file->frag_start, c_byte,
+				file->compressed);
+			if(res)
+				fragment_bytes = compressor_uncompress(comp,
+					fragment_block, file->compressed,
+					c_byte, block_size, &error);
+		} else {
+			res = read_fs_bytes(fd, file->frag_start, c_byte,
+				fragment_block);
+			fragment_bytes = c_byte;
+		}
+		if(res && fragment_bytes != -1)
+			fragment_start = file->frag_start;
+	}
+
+	offset += file->inode.offset;
+	if(fragment_start == -1 || offset + size > fragment_bytes)
+		res = FALSE;
+	else
+		memcpy(buffer, fragment_block + offset, size);
+	pthread_mutex_unlock(&fragment_mutex_source);
+
+	return res;
+}
+
+
+static int read_data_block(struct source_file *file, int block)
+{
+	unsigned int word = file->block_list[block];
+	int bytes = SQUASHFS_COMPRESSED_SIZE_BLOCK(word), error;
+
+	if(file->block_cached == block)
+		return TRUE;
+
+	file->block_cached = -1;
+	if(word == 0) {
+		/* sparse block */
+		memset(file->block, 0, block_size);
+		file->block_bytes = block_size;
+	} else if(!SQUASHFS_COMPRESSED_BLOCK(word)) {
+		if(read_fs_bytes(fd, file->block_start[block], bytes,
+				file->block) == FALSE)
+			return FALSE;
+		file->block_bytes = bytes;
+	} else {
+		if(read_fs_bytes(fd, file->block_start[block], bytes,
+				file->compressed) == FALSE)
+			return FALSE;
+
+		file->block_bytes = compressor_uncompress(comp, file->block,
+			file->compressed, bytes, block_size, &error);
+		if(file->block_bytes == -1) {
+			ERROR("%s uncompress failed with error code %d\n",
+				comp->name, error);
+			return FALSE;
+		}
+	}
+
+	file->block_cached = block;
+	return TRUE;
+}
+
+
+/*
+ * Read size bytes of the file from offset, which needn't be aligned to the
+ * image's blocks.  Returns the bytes read or -1 on failure
+ */
+int source_read(void *f, long long offset, char *buffer, int size)
+{
+	struct source_file *file = f;
+	long long tail = (long long) file->inode.blocks << block_log;
+	int bytes = 0;
+
+	while(bytes < size) {
+		int block = offset >> block_log, start = offset &
+			(block_size - 1), len;
+
+		if(offset >= tail)
+			return read_fragment_tail(file, buffer + bytes,
+				offset - tail, size - bytes) ? size : -1;
+
+		if(read_data_block(file, block) == FALSE)
+			return -1;
+
+		len = file->block_bytes - start;
+		if(len <= 0)
+			return -1;
+		if(len > size - bytes)
+			len = size - bytes;
+
+		memcpy(buffer + bytes, file->block + start, len);
+		bytes += len;
+		offset += len;
+	}
+
+	return bytes;
+}
+
+
+/*
+ * Copy the file's data block as it is stored, setting *c_byte to its size
+ * word.  Returns the bytes copied, 0 if the block is sparse or isn't stored
+ * as a data block, or -1 on failure
+ */
+int source_read_raw(void *f, int block, char *buffer, int *c_byte)
+{
+	struct source_file *file = f;
+	int bytes;
+
+	if(block >= file->inode.blocks || file->block_list[block] == 0)
+		return 0;
+
+	bytes = SQUASHFS_COMPRESSED_SIZE_BLOCK(file->block_list[block]);
+	if(read_fs_bytes(fd, file->block_start[block], bytes, buffer) == FALSE)
+		return -1;
+
+	*c_byte = file->block_list[block];
+	return bytes;
+}
+
+
+void source_close_file(void *f)
+{
+	struct source_file *file = f;
+
+	put_inode(&file->inode);
+	free(file->block_list);
+	free(file->block_start);
+	free(file->compressed);
+	free(file->block);
+	free(file);
+}
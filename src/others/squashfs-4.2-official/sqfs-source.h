@@ -0,0 +1,49 @@
+#ifndef SQFS_SOURCE_H
+#define SQFS_SOURCE_H
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * sqfs-source.h
+ */
+
+/*
+ * A squashfs image read with the unsquashfs engine, as the source of
+ * sqfs-convert.  The engine shares too many names with mksquashfs to be
+ * linked with it, so it is built into one object of which only these are
+ * left global.  Inodes are named by their squashfs inode reference.
+ */
+
+struct source_info {
+	int	major;
+	int	minor;
+	int	block_size;
+	int	comp_id;
+	char	*comp_name;
+};
+
+extern int source_open(char *image, struct source_info *info);
+extern long long source_root();
+extern int source_stat(long long ref, struct stat *buf);
+extern void *source_opendir(long long ref);
+extern int source_readdir(void *dir, char **name, long long *ref);
+extern void source_closedir(void *dir);
+extern int source_readlink(long long ref, char *buff, int size);
+extern void *source_open_file(long long ref);
+extern int source_read(void *file, long long offset, char *buffer, int size);
+extern int source_read_raw(void *file, int block, char *buffer, int *c_byte);
+extern void source_close_file(void *file);
+#endif
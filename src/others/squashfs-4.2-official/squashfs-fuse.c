@@ -0,0 +1,705 @@
+/*
+ * Mount a squashfs filesystem read-only with FUSE, reading it with the
+ * unsquashfs engine, so only the blocks that are looked at are ever
+ * decompressed.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * squashfs-fuse.c
+ */
+
+#define FUSE_USE_VERSION 26
+
+#include "unsquashfs.h"
+#include "squashfs_compat.h"
+#include "compressor.h"
+
+#include <fuse_lowlevel.h>
+#include <stdint.h>
+#include <sys/statvfs.h>
+#include <sys/sysmacros.h>
+
+/* data blocks queued to the deflators ahead of a sequential reader */
+#define READAHEAD_BLOCKS	8
+
+/* nothing on the image ever changes */
+#define ATTR_TIMEOUT		86400.0
+
+/*
+ * read_inode() and squashfs_opendir() work in static buffers, and the
+ * 1.x - 3.x versions number the inodes as they are read
+ */
+pthread_mutex_t engine_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * blocks read ahead by all the open files, which hold their cache entries
+ * until they are read.  Kept to half the data cache, so a read always
+ * finds a buffer and doesn't wait on the readahead of idle files
+ */
+int ahead_blocks, max_ahead_blocks;
+pthread_mutex_t ahead_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct fuse_file {
+	struct inode inode;
+	unsigned int *block_list;
+	long long *block_start;
+	long long frag_start;
+	int frag_size;
+	pthread_mutex_t mutex;
+	/* block after the last one read */
+	int next;
+	/* blocks ahead_start ... ahead_start + ahead - 1 are read ahead */
+	int ahead_start;
+	int ahead;
+	struct cache_entry *ahead_entry[READAHEAD_BLOCKS];
+};
+
+
+/*
+ * FUSE reserves inode 1 for the root, the others are the squashfs inode
+ * reference plus two
+ */
+static squashfs_inode inode_ref(fuse_ino_t ino)
+{
+	return ino == FUSE_ROOT_ID ? sBlk.s.root_inode : ino - 2;
+}
+
+
+static fuse_ino_t inode_ino(squashfs_inode ref)
+{
+	return ref == sBlk.s.root_inode ? FUSE_ROOT_ID : ref + 2;
+}
+
+
+/* a copy of the inode, whose symlink put_inode() frees */
+static void get_inode(fuse_ino_t ino, struct inode *i)
+{
+	squashfs_inode ref = inode_ref(ino);
+
+	pthread_mutex_lock(&engine_mutex);
+	*i = *s_ops.read_inode(SQUASHFS_INODE_BLK(ref),
+		SQUASHFS_INODE_OFFSET(ref));
+	pthread_mutex_unlock(&engine_mutex);
+}
+
+
+static void put_inode(struct inode *i)
+{
+	if(S_ISLNK(i->mode))
+		free(i->symlink);
+}
+
+
+static struct dir *open_dir(fuse_ino_t ino)
+{
+	squashfs_inode ref = inode_ref(ino);
+	struct inode *i;
+	struct dir *dir;
+
+	pthread_mutex_lock(&engine_mutex);
+	dir = s_ops.squashfs_opendir(SQUASHFS_INODE_BLK(ref),
+		SQUASHFS_INODE_OFFSET(ref), &i);
+	pthread_mutex_unlock(&engine_mutex);
+
+	return dir;
+}
+
+
+static void stat_inode(fuse_ino_t ino, struct inode *i, struct stat *st)
+{
+	memset(st, 0, sizeof(*st));
+	st->st_ino = ino;
+	st->st_mode = i->mode;
+	st->st_nlink = S_ISDIR(i->mode) ? 2 : 1;
+	st->st_uid = i->uid;
+	st->st_gid = i->gid;
+	st->st_atime = st->st_mtime = st->st_ctime = i->time;
+	st->st_blksize = block_size;
+
+	if(S_ISREG(i->mode) || S_ISLNK(i->mode) || S_ISDIR(i->mode))
+		st->st_size = i->data;
+	else if(S_ISBLK(i->mode) || S_ISCHR(i->mode))
+		st->st_rdev = makedev((i->data >> 8) & 0xff, i->data & 0xff);
+
+	st->st_blocks = (st->st_size + 511) >> 9;
+}
+
+
+static void sqfs_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	struct dir *dir = open_dir(parent);
+	struct fuse_entry_param e;
+	struct inode i;
+	unsigned int start_block, offset, type;
+	char *entry;
+	int found = FALSE;
+
+	while(!found && squashfs_readdir(dir, &entry, &start_block, &offset,
+			&type))
+		found = strcmp(entry, name) == 0;
+	squashfs_closedir(dir);
+
+	if(!found) {
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
+
+	memset(&e, 0, sizeof(e));
+	e.ino = inode_ino(SQUASHFS_MKINODE(start_block, offset));
+	e.attr_timeout = e.entry_timeout = ATTR_TIMEOUT;
+	get_inode(e.ino, &i);
+	stat_inode(e.ino, &i, &e.attr);
+	put_inode(&i);
+	fuse_reply_entry(req, &e);
+}
+
+
+static void sqfs_getattr(fuse_req_t req, fuse_ino_t ino,
+	struct fuse_file_info *fi)
+{
+	struct inode i;
+	struct stat st;
+
+	get_inode(ino, &i);
+	stat_inode(ino, &i, &st);
+	put_inode(&i);
+	fuse_reply_attr(req, &st, ATTR_TIMEOUT);
+}
+
+
+static void sqfs_readlink(fuse_req_t req, fuse_ino_t ino)
+{
+	struct inode i;
+
+	get_inode(ino, &i);
+	if(S_ISLNK(i.mode))
+		fuse_reply_readlink(req, i.symlink);
+	else
+		fuse_reply_err(req, EINVAL);
+	put_inode(&i);
+}
+
+
+static void sqfs_opendir(fuse_req_t req, fuse_ino_t ino,
+	struct fuse_file_info *fi)
+{
+	fi->fh = (uintptr_t) open_dir(ino);
+	fi->keep_cache = 1;
+	fuse_reply_open(req, fi);
+}
+
+
+static void sqfs_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+	off_t off, struct fuse_file_info *fi)
+{
+	struct dir *dir = (struct dir *) (uintptr_t) fi->fh;
+	char *buffer = malloc(size);
+	size_t bytes = 0;
+	off_t n;
+
+	if(buffer == NULL) {
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+
+	/* "." and ".." come first, at offsets 0 and 1 */
+	for(n = off; n < dir->dir_count + 2; n++) {
+		struct stat st;
+		const char *name;
+		size_t entry;
+
+		memset(&st, 0, sizeof(st));
+		if(n < 2) {
+			name = n ? ".." : ".";
+			st.st_ino = ino;
+			st.st_mode = S_IFDIR;
+		} else {
+			struct dir_ent *ent = &dir->dirs[n - 2];
+
+			name = ent->name;
+			st.st_ino = inode_ino(SQUASHFS_MKINODE(ent->start_block,
+				ent->offset));
+			st.st_mode = lookup_type[ent->type];
+		}
+
+		entry = fuse_add_direntry(req, buffer + bytes, size - bytes,
+			name, &st, n + 1);
+		if(entry > size - bytes)
+			break;
+		bytes += entry;
+	}
+
+	fuse_reply_buf(req, buffer, bytes);
+	free(buffer);
+}
+
+
+static void sqfs_releasedir(fuse_req_t req, fuse_ino_t ino,
+	struct fuse_file_info *fi)
+{
+	squashfs_closedir((struct dir *) (uintptr_t) fi->fh);
+	fuse_reply_err(req, 0);
+}
+
+
+static int reserve_ahead()
+{
+	int reserved;
+
+	pthread_mutex_lock(&ahead_mutex);
+	reserved = ahead_blocks < max_ahead_blocks;
+	if(reserved)
+		ahead_blocks ++;
+	pthread_mutex_unlock(&ahead_mutex);
+
+	return reserved;
+}
+
+
+static void release_ahead()
+{
+	pthread_mutex_lock(&ahead_mutex);
+	ahead_blocks --;
+	pthread_mutex_unlock(&ahead_mutex);
+}
+
+
+/*
+ * releases the blocks read ahead before block upto.  An entry still
+ * pending mustn't go back on the free list, where cache_get() could reuse
+ * it while the reader or a deflator is filling it
+ */
+static void drop_ahead(struct fuse_file *file, int upto)
+{
+	while(file->ahead && file->ahead_start < upto) {
+		struct cache_entry *entry = file->ahead_entry[0];
+
+		if(entry) {
+			cache_block_wait(entry);
+			cache_block_put(entry);
+			release_ahead();
+		}
+		memmove(file->ahead_entry, file->ahead_entry + 1,
+			--file->ahead * sizeof(struct cache_entry *));
+		file->ahead_start ++;
+	}
+}
+
+
+/* queues the blocks from block from on to the reader and deflators */
+static void read_ahead(struct fuse_file *file, int from)
+{
+	int end = from + READAHEAD_BLOCKS, b;
+
+	if(end > file->inode.blocks)
+		end = file->inode.blocks;
+
+	drop_ahead(file, from);
+	if(file->ahead == 0)
+		file->ahead_start = from;
+
+	for(b = file->ahead_start + file->ahead; b < end; b++) {
+		struct cache_entry *entry = NULL;
+
+		if(file->block_list[b]) {
+			if(!reserve_ahead())
+				break;
+			entry = cache_get(data_cache, file->block_start[b],
+				file->block_list[b]);
+		}
+		file->ahead_entry[file->ahead ++] = entry;
+	}
+}
+
+
+/* the cache entry of (non sparse) data block b */
+static struct cache_entry *get_block(struct fuse_file *file, int b)
+{
+	drop_ahead(file, b);
+
+	if(file->ahead && file->ahead_start == b) {
+		struct cache_entry *entry = file->ahead_entry[0];
+
+		memmove(file->ahead_entry, file->ahead_entry + 1,
+			--file->ahead * sizeof(struct cache_entry *));
+		file->ahead_start ++;
+		if(entry) {
+			release_ahead();
+			return entry;
+		}
+	}
+
+	return cache_get(data_cache, file->block_start[b], file->block_list[b]);
+}
+
+
+static void sqfs_open(fuse_req_t req, fuse_ino_t ino,
+	struct fuse_file_info *fi)
+{
+	struct fuse_file *file;
+	long long start;
+	int b;
+
+	if((fi->flags & O_ACCMODE) != O_RDONLY) {
+		fuse_reply_err(req, EROFS);
+		return;
+	}
+
+	file = malloc(sizeof(struct fuse_file));
+	if(file == NULL)
+		goto failed;
+
+	get_inode(ino, &file->inode);
+	file->block_list = malloc((file->inode.blocks + 1) *
+		sizeof(unsigned int));
+	file->block_start = malloc((file->inode.blocks + 1) *
+		sizeof(long long));
+	if(file->block_list == NULL || file->block_start == NULL) {
+		free(file->block_list);
+		free(file->block_start);
+		free(file);
+		goto failed;
+	}
+
+	s_ops.read_block_list(file->block_list, file->inode.block_ptr,
+		file->inode.blocks);
+	for(start = file->inode.start, b = 0; b < file->inode.blocks; b++) {
+		file->block_start[b] = start;
+		start += SQUASHFS_COMPRESSED_SIZE_BLOCK(file->block_list[b]);
+	}
+
+	if(file->inode.frag_bytes)
+		s_ops.read_fragment(file->inode.fragment, &file->frag_start,
+			&file->frag_size);
+
+	pthread_mutex_init(&file->mutex, NULL);
+	file->next = file->ahead_start = file->ahead = 0;
+
+	fi->fh = (uintptr_t) file;
+	fi->keep_cache = 1;
+	fuse_reply_open(req, fi);
+	return;
+
+failed:
+	fuse_reply_err(req, ENOMEM);
+}
+
+
+static void sqfs_read(fuse_req_t req, fuse_ino_t ino, size_t size,
+	off_t off, struct fuse_file_info *fi)
+{
+	struct fuse_file *file = (struct fuse_file *) (uintptr_t) fi->fh;
+	struct inode *i = &file->inode;
+	long long end = off + size;
+	int first, last, b, sequential, error = 0;
+	char *buffer;
+
+	if(off >= i->data) {
+		fuse_reply_buf(req, NULL, 0);
+		return;
+	}
+	if(end > i->data)
+		end = i->data;
+
+	buffer = malloc(end - off);
+	if(buffer == NULL) {
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+
+	first = off >> block_log;
+	last = (end - 1) >> block_log;
+
+	pthread_mutex_lock(&file->mutex);
+
+	/* small reads may start in the block the last one ended in */
+	sequential = first == file->next || first == file->next - 1;
+	if(!sequential)
+		drop_ahead(file, i->blocks);
+
+	for(b = first; b <= last && !error; b++) {
+		long long block_off = (long long) b << block_log;
+		long long from = off > block_off ? off : block_off;
+		long long to = end < block_off + block_size ? end :
+			block_off + block_size;
+		struct cache_entry *entry;
+		int offset = 0;
+
+		if(b >= i->blocks) {
+			/* the tail end of the file is in a fragment */
+			entry = cache_get(fragment_cache, file->frag_start,
+				file->frag_size);
+			offset = i->offset;
+		} else if(file->block_list[b] == 0) {
+			/* sparse block */
+			memset(buffer + (from - off), 0, to - from);
+			continue;
+		} else
+			entry = get_block(file, b);
+
+		cache_block_wait(entry);
+		if(entry->error)
+			error = EIO;
+		else
+			memcpy(buffer + (from - off), entry->data + offset +
+				(from - block_off), to - from);
+		cache_block_put(entry);
+	}
+
+	if(sequential)
+		read_ahead(file, last + 1);
+	file->next = last + 1;
+
+	pthread_mutex_unlock(&file->mutex);
+
+	if(error)
+		fuse_reply_err(req, error);
+	else
+		fuse_reply_buf(req, buffer, end - off);
+	free(buffer);
+}
+
+
+static void sqfs_release(fuse_req_t req, fuse_ino_t ino,
+	struct fuse_file_info *fi)
+{
+	struct fuse_file *file = (struct fuse_file *) (uintptr_t) fi->fh;
+
+	drop_ahead(file, file->inode.blocks);
+	pthread_mutex_destroy(&file->mutex);
+	free(file->block_list);
+	free(file->block_start);
+	free(file);
+	fuse_reply_err(req, 0);
+}
+
+
+static void sqfs_statfs(fuse_req_t req, fuse_ino_t ino)
+{
+	struct statvfs st;
+
+	memset(&st, 0, sizeof(st));
+	st.f_bsize = st.f_frsize = block_size;
+	st.f_blocks = (sBlk.s.bytes_used + block_size - 1) >> block_log;
+	st.f_files = sBlk.s.inodes;
+	st.f_namemax = SQUASHFS_NAME_LEN;
+	fuse_reply_statfs(req, &st);
+}
+
+
+static struct fuse_lowlevel_ops sqfs_ops = {
+	.lookup		= sqfs_lookup,
+	.getattr	= sqfs_getattr,
+	.readlink	= sqfs_readlink,
+	.open		= sqfs_open,
+	.read		= sqfs_read,
+	.release	= sqfs_release,
+	.opendir	= sqfs_opendir,
+	.readdir	= sqfs_readdir,
+	.releasedir	= sqfs_releasedir,
+	.statfs		= sqfs_statfs,
+};
+
+
+/*
+ * only the readers and the deflators of initialise_threads() are needed,
+ * with every signal left to the FUSE loop
+ */
+static void initialise_readers(int fragment_buffer_size, int data_buffer_size)
+{
+	int i, all_buffers_size = fragment_buffer_size + data_buffer_size;
+	sigset_t sigmask, old_mask;
+	pthread_t *thread;
+
+	if(processors == -1)
+		processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+	thread = malloc((readers + processors) * sizeof(pthread_t));
+	if(thread == NULL)
+		EXIT_UNSQUASH("Out of memory allocating thread descriptors\n");
+
+	to_reader = queue_init(all_buffers_size);
+	to_deflate = queue_init(all_buffers_size);
+	fragment_cache = cache_init(block_size, fragment_buffer_size);
+	data_cache = cache_init(block_size, data_buffer_size);
+
+	sigfillset(&sigmask);
+	pthread_sigmask(SIG_BLOCK, &sigmask, &old_mask);
+
+	for(i = 0; i < readers; i++)
+		if(pthread_create(&thread[i], NULL, reader, NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+	for(i = 0; i < processors; i++)
+		if(pthread_create(&thread[readers + i], NULL, deflator,
+				NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+
+static void usage(char *name)
+{
+	ERROR("SYNTAX: %s [options] filesystem mountpoint [FUSE options]\n",
+		name);
+	ERROR("\t-p[rocessors] <number>\tuse <number> processors to "
+		"decompress.  By default\n\t\t\t\twill use the number of "
+		"processors available\n");
+	ERROR("\t-rd[eaders] <number>\tuse <number> threads to read the "
+		"filesystem.\n\t\t\t\tDefault 1, more help on network "
+		"storage\n");
+	ERROR("\t-da[ta-queue] <size>\tSet data queue to <size> Mbytes.  "
+		"Default %d\n\t\t\t\tMbytes\n", DATA_BUFFER_DEFAULT);
+	ERROR("\t-fr[ag-queue] <size>\tSet fragment queue to <size> Mbytes.  "
+		"Default\n\t\t\t\t%d Mbytes\n", FRAGMENT_BUFFER_DEFAULT);
+	ERROR("\nMounts 1.x - 4.x filesystems, gzip, lzma or xz compressed, "
+		"read-only.\nFUSE options, such as -f to stay in the "
+		"foreground, follow the mountpoint.\n");
+	exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int fragment_buffer_size = FRAGMENT_BUFFER_DEFAULT;
+	int data_buffer_size = DATA_BUFFER_DEFAULT;
+	int i, res = 1, multithreaded, foreground;
+	struct fuse_session *se = NULL;
+	struct fuse_chan *ch;
+	struct fuse_args args;
+	char *mountpoint, *b;
+
+	pthread_mutex_init(&screen_mutex, NULL);
+
+	for(i = 1; i < argc; i++) {
+		if(*argv[i] != '-')
+			break;
+		if(strcmp(argv[i], "-processors") == 0 ||
+				strcmp(argv[i], "-p") == 0) {
+			if((++i == argc) ||
+					(processors = strtol(argv[i], &b, 10),
+					*b != '\0') || processors < 1) {
+				ERROR("%s: -processors missing or invalid "
+					"processor number\n", argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-readers") == 0 ||
+				strcmp(argv[i], "-rd") == 0) {
+			if((++i == argc) ||
+					(readers = strtol(argv[i], &b, 10),
+					*b != '\0') || readers < 1) {
+				ERROR("%s: -readers missing or invalid "
+					"number of readers\n", argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-data-queue") == 0 ||
+				strcmp(argv[i], "-da") == 0) {
+			if((++i == argc) ||
+					(data_buffer_size = strtol(argv[i], &b,
+					 10), *b != '\0') ||
+					data_buffer_size < 1) {
+				ERROR("%s: -data-queue missing or invalid "
+					"queue size\n", argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-frag-queue") == 0 ||
+				strcmp(argv[i], "-fr") == 0) {
+			if((++i == argc) ||
+					(fragment_buffer_size = strtol(argv[i],
+					 &b, 10), *b != '\0') ||
+					fragment_buffer_size < 1) {
+				ERROR("%s: -frag-queue missing or invalid "
+					"queue size\n", argv[0]);
+				exit(1);
+			}
+		} else
+			usage(argv[0]);
+	}
+
+	if(i > argc - 2)
+		usage(argv[0]);
+
+	if((fd = open(argv[i], O_RDONLY)) == -1) {
+		ERROR("Could not open %s, because %s\n", argv[i],
+			strerror(errno));
+		exit(1);
+	}
+
+	if(read_super(argv[i]) == FALSE)
+		exit(1);
+
+	if(!comp->supported) {
+		ERROR("Filesystem uses %s compression, this is "
+			"unsupported by this version\n", comp->name);
+		exit(1);
+	}
+
+	block_size = sBlk.s.block_size;
+	block_log = sBlk.s.block_log;
+
+	if(s_ops.read_uids_guids() == FALSE)
+		EXIT_UNSQUASH("failed to uid/gid table\n");
+
+	if(s_ops.read_fragment_table() == FALSE)
+		EXIT_UNSQUASH("failed to read fragment table\n");
+
+	/* the metadata is small, only the data is read on demand */
+	uncompress_inode_table(sBlk.s.inode_table_start,
+		sBlk.s.directory_table_start);
+
+	uncompress_directory_table(sBlk.s.directory_table_start,
+		sBlk.s.fragment_table_start);
+
+	/* the rest of the command line is for FUSE */
+	argv[i] = argv[0];
+	args = (struct fuse_args) FUSE_ARGS_INIT(argc - i, argv + i);
+	if(fuse_opt_add_arg(&args, "-oro") == -1 ||
+			fuse_parse_cmdline(&args, &mountpoint, &multithreaded,
+			&foreground) == -1 || mountpoint == NULL)
+		usage(argv[0]);
+
+	ch = fuse_mount(mountpoint, &args);
+	if(ch == NULL)
+		exit(1);
+
+	se = fuse_lowlevel_new(&args, &sqfs_ops, sizeof(sqfs_ops), NULL);
+	if(se && fuse_set_signal_handlers(se) != -1) {
+		fuse_session_add_chan(se, ch);
+
+		/* threads don't survive the fork into the background */
+		if(fuse_daemonize(foreground) != -1) {
+			fragment_buffer_size <<= 20 - block_log;
+			data_buffer_size <<= 20 - block_log;
+			max_ahead_blocks = data_buffer_size / 2;
+			initialise_readers(fragment_buffer_size,
+				data_buffer_size);
+
+			res = multithreaded ? fuse_session_loop_mt(se) :
+				fuse_session_loop(se);
+		}
+
+		fuse_remove_signal_handlers(se);
+		fuse_session_remove_chan(ch);
+	}
+
+	if(se)
+		fuse_session_destroy(se);
+	fuse_unmount(mountpoint, ch);
+	fuse_opt_free_args(&args);
+
+	return res == 0 ? 0 : 1;
+}
@@ -27,6 +27,10 @@
  * definitions for structures on disk - layout 3.x
  */
 
+/* the magic of the (sqlzma) LZMA patched 3.x mksquashfs */
+#define SQUASHFS_MAGIC_LZMA		0x71736873
+#define SQUASHFS_MAGIC_LZMA_SWAP	0x73687371
+
 #define SQUASHFS_CHECK			2
 #define SQUASHFS_CHECK_DATA(flags)		SQUASHFS_BIT(flags, \
 						SQUASHFS_CHECK)
@@ -26,26 +26,49 @@
 #include "squashfs_swap.h"
 #include "read_fs.h"
 
-static struct squashfs_fragment_entry *fragment_table;
 static unsigned int *id_table;
 
+/*
+ * The fragment table is read a metadata block (512 entries) at a time as
+ * fragments are looked up, rather than all at mount, so listing or
+ * extracting a few files from a big image doesn't decompress all of it.
+ * The last FRAGMENT_CACHE_BLOCKS blocks used are kept.
+ */
+#define FRAGMENT_CACHE_BLOCKS	8
+#define FRAGMENT_BLOCK_ENTRIES	(SQUASHFS_METADATA_SIZE / \
+					sizeof(struct squashfs_fragment_entry))
+
+struct fragment_block {
+	int				index;
+	unsigned int			used;
+	struct squashfs_fragment_entry	entry[FRAGMENT_BLOCK_ENTRIES];
+};
+
+static long long *fragment_table_index;
+static struct fragment_block fragment_cache_4[FRAGMENT_CACHE_BLOCKS];
+static unsigned int fragment_cache_used;
+static pthread_mutex_t fragment_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 int read_fragment_table_4()
 {
-	int res, i, indexes = SQUASHFS_FRAGMENT_INDEXES(sBlk.s.fragments);
-	long long fragment_table_index[indexes];
+	int res, i;
 
 	TRACE("read_fragment_table: %d fragments, reading %d fragment indexes "
-		"from 0x%llx\n", sBlk.s.fragments, indexes,
+		"from 0x%llx\n", sBlk.s.fragments,
+		SQUASHFS_FRAGMENT_INDEXES(sBlk.s.fragments),
 		sBlk.s.fragment_table_start);
 
+	for(i = 0; i < FRAGMENT_CACHE_BLOCKS; i++)
+		fragment_cache_4[i].index = -1;
+
 	if(sBlk.s.fragments == 0)
 		return TRUE;
 
-	fragment_table = malloc(sBlk.s.fragments *
-		sizeof(struct squashfs_fragment_entry));
-	if(fragment_table == NULL)
+	fragment_table_index = malloc(SQUASHFS_FRAGMENT_INDEX_BYTES(
+		sBlk.s.fragments));
+	if(fragment_table_index == NULL)
 		EXIT_UNSQUASH("read_fragment_table: failed to allocate "
-			"fragment table\n");
+			"fragment table index\n");
 
 	res = read_fs_bytes(fd, sBlk.s.fragment_table_start,
 		SQUASHFS_FRAGMENT_INDEX_BYTES(sBlk.s.fragments),
@@ -55,25 +78,48 @@ int read_fragment_table_4()
 			"index\n");
 		return FALSE;
 	}
-	SQUASHFS_INSWAP_FRAGMENT_INDEXES(fragment_table_index, indexes);
+	SQUASHFS_INSWAP_FRAGMENT_INDEXES(fragment_table_index,
+		SQUASHFS_FRAGMENT_INDEXES(sBlk.s.fragments));
 
-	for(i = 0; i < indexes; i++) {
-		int length = read_block(fd, fragment_table_index[i], NULL,
-			((char *) fragment_table) + (i *
-			SQUASHFS_METADATA_SIZE));
-		TRACE("Read fragment table block %d, from 0x%llx, length %d\n",
-			i, fragment_table_index[i], length);
-		if(length == FALSE) {
-			ERROR("read_fragment_table: failed to read fragment "
-				"table index\n");
-			return FALSE;
+	return TRUE;
+}
+
+
+/*
+ * Return the cached fragment table block holding block index, reading it
+ * into the least recently used slot if it isn't there.  Called with
+ * fragment_mutex held.
+ */
+static struct fragment_block *get_fragment_block(int index)
+{
+	struct fragment_block *block = &fragment_cache_4[0];
+	int i, length, entries;
+
+	for(i = 0; i < FRAGMENT_CACHE_BLOCKS; i++) {
+		if(fragment_cache_4[i].index == index) {
+			block = &fragment_cache_4[i];
+			goto found;
 		}
+		if(fragment_cache_4[i].used < block->used)
+			block = &fragment_cache_4[i];
 	}
 
-	for(i = 0; i < sBlk.s.fragments; i++) 
-		SQUASHFS_INSWAP_FRAGMENT_ENTRY(&fragment_table[i]);
-
-	return TRUE;
+	length = read_block(fd, fragment_table_index[index], NULL,
+		block->entry);
+	TRACE("Read fragment table block %d, from 0x%llx, length %d\n",
+		index, fragment_table_index[index], length);
+	if(length == FALSE)
+		EXIT_UNSQUASH("read_fragment_table: failed to read fragment "
+			"table block %d\n", index);
+
+	entries = length / sizeof(struct squashfs_fragment_entry);
+	for(i = 0; i < entries; i++)
+		SQUASHFS_INSWAP_FRAGMENT_ENTRY(&block->entry[i]);
+	block->index = index;
+
+found:
+	block->used = ++fragment_cache_used;
+	return block;
 }
 
 
@@ -83,9 +129,17 @@ void read_fragment_4(unsigned int fragment, long long *start_block, int *size)
 
 	struct squashfs_fragment_entry *fragment_entry;
 
-	fragment_entry = &fragment_table[fragment];
+	if(fragment >= sBlk.s.fragments)
+		EXIT_UNSQUASH("read_fragment: fragment %u out of range\n",
+			fragment);
+
+	pthread_mutex_lock(&fragment_mutex);
+	fragment_entry = &get_fragment_block(SQUASHFS_FRAGMENT_INDEX(fragment))->
+		entry[SQUASHFS_FRAGMENT_INDEX_OFFSET(fragment) /
+		sizeof(struct squashfs_fragment_entry)];
 	*start_block = fragment_entry->start_block;
 	*size = fragment_entry->size;
+	pthread_mutex_unlock(&fragment_mutex);
 }
 
 
@@ -31,6 +31,7 @@
 
 #include <sys/sysinfo.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 struct cache *fragment_cache, *data_cache;
 struct queue *to_reader, *to_deflate, *to_writer, *from_writer;
@@ -39,6 +40,7 @@ pthread_mutex_t	fragment_mutex;
 
 /* user options that control parallelisation */
 int processors = -1;
+int readers = 1;
 
 struct super_block sBlk;
 squashfs_operations s_ops;
@@ -114,7 +116,6 @@ struct test table[] = {
 };
 
 void progress_bar(long long current, long long max, int columns);
-void update_progress_bar();
 
 void sigwinch_handler()
 {
@@ -537,6 +538,10 @@ int lookup_entry(struct hash_table_entry *hash_table[], long long start)
 }
 
 
+/*
+ * pread rather than lseek and read, as there may be more than one reader
+ * thread
+ */
 int read_fs_bytes(int fd, long long byte, int bytes, void *buff)
 {
 	off_t off = byte;
@@ -545,13 +550,40 @@ int read_fs_bytes(int fd, long long byte, int bytes, void *buff)
 	TRACE("read_bytes: reading from position 0x%llx, bytes %d\n", byte,
 		bytes);
 
-	if(lseek(fd, off, SEEK_SET) == -1) {
-		ERROR("Lseek failed because %s\n", strerror(errno));
-		return FALSE;
+	for(count = 0; count < bytes; count += res) {
+		res = pread(fd, buff + count, bytes - count, off + count);
+		if(res < 1) {
+			if(res == 0) {
+				ERROR("Read on filesystem failed because "
+					"EOF\n");
+				return FALSE;
+			} else if(errno != EINTR) {
+				ERROR("Read on filesystem failed because %s\n",
+						strerror(errno));
+				return FALSE;
+			} else
+				res = 0;
+		}
 	}
 
-	for(count = 0; count < bytes; count += res) {
-		res = read(fd, buff + count, bytes - count);
+	return TRUE;
+}
+
+
+/*
+ * reads the count buffers of iov, which are adjacent on disk, in one go.
+ * The iovecs are used up
+ */
+int read_fs_vector(int fd, long long byte, struct iovec *iov, int count)
+{
+	off_t off = byte;
+	ssize_t res;
+
+	TRACE("read_vector: reading from position 0x%llx, %d buffers\n",
+		byte, count);
+
+	while(count) {
+		res = preadv(fd, iov, count, off);
 		if(res < 1) {
 			if(res == 0) {
 				ERROR("Read on filesystem failed because "
@@ -564,6 +596,17 @@ int read_fs_bytes(int fd, long long byte, int bytes, void *buff)
 			} else
 				res = 0;
 		}
+
+		off += res;
+		while(count && res >= iov->iov_len) {
+			res -= iov->iov_len;
+			iov ++;
+			count --;
+		}
+		if(count) {
+			iov->iov_base += res;
+			iov->iov_len -= res;
+		}
 	}
 
 	return TRUE;
@@ -686,32 +729,122 @@ void uncompress_inode_table(long long start, long long end)
 }
 
 
+/*
+ * Attributes aren't set as each inode is created, but queued and set once
+ * everything is written: other inodes a directory at a time, through a
+ * descriptor for it, across processors threads, then directories in the
+ * order queued, contents before the directory, so a directory's mode
+ * can't stop its contents being reached.
+ */
+struct attributes {
+	char		*pathname;
+	int		parent;		/* length of the parent's pathname */
+	int		mode;
+	uid_t		uid;
+	gid_t		gid;
+	time_t		time;
+	unsigned int	xattr;
+	unsigned int	set_mode;
+	int		order;
+};
+
+static struct attributes *attributes;
+static int attributes_count, attributes_size, attributes_next;
+static pthread_mutex_t attributes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 int set_attributes(char *pathname, int mode, uid_t uid, gid_t guid, time_t time,
 	unsigned int xattr, unsigned int set_mode)
 {
-	struct utimbuf times = { time, time };
+	struct attributes *a;
+	char *name = strrchr(pathname, '/');
+
+	pthread_mutex_lock(&attributes_mutex);
+	if(attributes_count == attributes_size) {
+		attributes_size = attributes_size ? attributes_size * 2 : 1024;
+		attributes = realloc(attributes, attributes_size *
+			sizeof(struct attributes));
+		if(attributes == NULL)
+			EXIT_UNSQUASH("set_attributes: failed to allocate "
+				"attribute queue\n");
+	}
+	a = &attributes[attributes_count];
+	a->pathname = strdup(pathname);
+	if(a->pathname == NULL)
+		EXIT_UNSQUASH("set_attributes: failed to allocate pathname\n");
+	a->parent = name ? name - pathname : -1;
+	a->mode = mode;
+	a->uid = uid;
+	a->gid = guid;
+	a->time = time;
+	a->xattr = xattr;
+	a->set_mode = set_mode;
+	a->order = attributes_count ++;
+	pthread_mutex_unlock(&attributes_mutex);
+
+	return TRUE;
+}
+
+
+static int same_parent(struct attributes *a, struct attributes *b)
+{
+	return a->parent == b->parent && (a->parent <= 0 ||
+		memcmp(a->pathname, b->pathname, a->parent) == 0);
+}
+
+
+/* other inodes grouped by parent directory, then directories as queued */
+static int compare_attributes(const void *x, const void *y)
+{
+	const struct attributes *a = x, *b = y;
+	int a_dir = S_ISDIR(a->mode), b_dir = S_ISDIR(b->mode), res;
+
+	if(a_dir != b_dir)
+		return a_dir - b_dir;
+
+	if(!a_dir) {
+		res = memcmp(a->pathname, b->pathname, (a->parent < b->parent ?
+			a->parent : b->parent) + 1);
+		if(res == 0)
+			res = a->parent - b->parent;
+		if(res)
+			return res;
+	}
+
+	return a->order - b->order;
+}
+
+
+static int apply_attributes(int dir_fd, char *name, struct attributes *a)
+{
+	struct timespec times[2] = { { a->time, 0 }, { a->time, 0 } };
+	int mode = a->mode;
 
-	write_xattr(pathname, xattr);
+	write_xattr(a->pathname, a->xattr);
 
-	if(utime(pathname, &times) == -1) {
+	if(utimensat(dir_fd, name, times, AT_SYMLINK_NOFOLLOW) == -1) {
 		ERROR("set_attributes: failed to set time on %s, because %s\n",
-			pathname, strerror(errno));
+			a->pathname, strerror(errno));
 		return FALSE;
 	}
 
 	if(root_process) {
-		if(chown(pathname, uid, guid) == -1) {
+		if(fchownat(dir_fd, name, a->uid, a->gid,
+				AT_SYMLINK_NOFOLLOW) == -1) {
 			ERROR("set_attributes: failed to change uid and gids "
-				"on %s, because %s\n", pathname,
+				"on %s, because %s\n", a->pathname,
 				strerror(errno));
 			return FALSE;
 		}
 	} else
 		mode &= ~07000;
 
-	if((set_mode || (mode & 07000)) && chmod(pathname, (mode_t) mode) == -1) {
+	if(S_ISLNK(mode))
+		return TRUE;
+
+	if((a->set_mode || (mode & 07000)) &&
+			fchmodat(dir_fd, name, (mode_t) mode, 0) == -1) {
 		ERROR("set_attributes: failed to change mode %s, because %s\n",
-			pathname, strerror(errno));
+			a->pathname, strerror(errno));
 		return FALSE;
 	}
 
@@ -719,12 +852,86 @@ int set_attributes(char *pathname, int mode, uid_t uid, gid_t guid, time_t time,
 }
 
 
-int write_bytes(int fd, char *buff, int bytes)
+static void *attributes_thread(void *arg)
+{
+	while(1) {
+		int i, first, last, dir_fd = AT_FDCWD;
+		struct attributes *a;
+
+		pthread_mutex_lock(&attributes_mutex);
+		first = last = attributes_next;
+		while(last < attributes_count &&
+				!S_ISDIR(attributes[last].mode) &&
+				same_parent(&attributes[first],
+				&attributes[last]))
+			last ++;
+		attributes_next = last;
+		pthread_mutex_unlock(&attributes_mutex);
+
+		if(first == last)
+			return NULL;
+
+		a = &attributes[first];
+		if(a->parent == 0)
+			dir_fd = open("/", O_RDONLY | O_DIRECTORY);
+		else if(a->parent > 0) {
+			char parent[a->parent + 1];
+
+			memcpy(parent, a->pathname, a->parent);
+			parent[a->parent] = '\0';
+			dir_fd = open(parent, O_RDONLY | O_DIRECTORY);
+		}
+
+		for(i = first; i < last; i++) {
+			a = &attributes[i];
+			if(dir_fd == -1)
+				apply_attributes(AT_FDCWD, a->pathname, a);
+			else
+				apply_attributes(dir_fd, a->pathname +
+					a->parent + 1, a);
+			free(a->pathname);
+		}
+
+		if(dir_fd >= 0)
+			close(dir_fd);
+	}
+}
+
+
+void apply_queued_attributes()
+{
+	int i, threads = processors > 0 ? processors : 1;
+	pthread_t attr_thread[threads];
+
+	qsort(attributes, attributes_count, sizeof(struct attributes),
+		compare_attributes);
+
+	attributes_next = 0;
+	for(i = 0; i < threads; i++)
+		if(pthread_create(&attr_thread[i], NULL, attributes_thread,
+				NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+	for(i = 0; i < threads; i++)
+		pthread_join(attr_thread[i], NULL);
+
+	for(i = attributes_next; i < attributes_count; i++) {
+		apply_attributes(AT_FDCWD, attributes[i].pathname,
+			&attributes[i]);
+		free(attributes[i].pathname);
+	}
+
+	free(attributes);
+	attributes = NULL;
+	attributes_count = attributes_size = 0;
+}
+
+
+int write_bytes(int fd, char *buff, int bytes, long long off)
 {
 	int res, count;
 
 	for(count = 0; count < bytes; count += res) {
-		res = write(fd, buff + count, bytes - count);
+		res = pwrite(fd, buff + count, bytes - count, off + count);
 		if(res == -1) {
 			if(errno != EINTR) {
 				ERROR("Write on output file failed because "
@@ -739,52 +946,43 @@ int write_bytes(int fd, char *buff, int bytes)
 }
 
 
-int lseek_broken = FALSE;
-char *zero_data = NULL;
-
-int write_block(int file_fd, char *buffer, int size, long long hole, int sparse)
+/*
+ * makes bytes at off of the file read as zeros, punching a hole for a
+ * sparse file.  Where the filesystem can't, zeros are written, though a
+ * sparse hole past the end of the file is already one
+ */
+int write_hole(int file_fd, long long bytes, long long off, int sparse)
 {
-	off_t off = hole;
-
-	if(hole) {
-		if(sparse && lseek_broken == FALSE) {
-			 int error = lseek(file_fd, off, SEEK_CUR);
-			 if(error == -1)
-				/* failed to seek beyond end of file */
-				lseek_broken = TRUE;
-		}
+	static char zero_data[SQUASHFS_FILE_MAX_SIZE];
+	struct stat buf;
+	int avail_bytes;
 
-		if((sparse == FALSE || lseek_broken) && zero_data == NULL) {
-			if((zero_data = malloc(block_size)) == NULL)
-				EXIT_UNSQUASH("write_block: failed to alloc "
-					"zero data block\n");
-			memset(zero_data, 0, block_size);
-		}
+#ifdef FALLOC_FL_PUNCH_HOLE
+	if(sparse && fallocate(file_fd, FALLOC_FL_PUNCH_HOLE |
+			FALLOC_FL_KEEP_SIZE, off, bytes) == 0)
+		return TRUE;
+#endif
+#ifdef FALLOC_FL_ZERO_RANGE
+	if(!sparse && fallocate(file_fd, FALLOC_FL_ZERO_RANGE, off,
+			bytes) == 0)
+		return TRUE;
+#endif
 
-		if(sparse == FALSE || lseek_broken) {
-			int blocks = (hole + block_size -1) / block_size;
-			int avail_bytes, i;
-			for(i = 0; i < blocks; i++, hole -= avail_bytes) {
-				avail_bytes = hole > block_size ? block_size :
-					hole;
-				if(write_bytes(file_fd, zero_data, avail_bytes)
-						== -1)
-					goto failure;
-			}
-		}
-	}
+	if(sparse && fstat(file_fd, &buf) == 0 && buf.st_size <= off)
+		return TRUE;
 
-	if(write_bytes(file_fd, buffer, size) == -1)
-		goto failure;
+	for(; bytes; bytes -= avail_bytes, off += avail_bytes) {
+		avail_bytes = bytes > SQUASHFS_FILE_MAX_SIZE ?
+			SQUASHFS_FILE_MAX_SIZE : bytes;
+		if(write_bytes(file_fd, zero_data, avail_bytes, off) == -1)
+			return FALSE;
+	}
 
 	return TRUE;
-
-failure:
-	return FALSE;
 }
 
 
-int write_file(struct inode *inode, char *pathname)
+int write_file(struct inode *inode, int dir_fd, char *name, char *pathname)
 {
 	unsigned int file_fd, i;
 	unsigned int *block_list;
@@ -794,8 +992,8 @@ int write_file(struct inode *inode, char *pathname)
 
 	TRACE("write_file: regular file, blocks %d\n", inode->blocks);
 
-	file_fd = open(pathname, O_CREAT | O_WRONLY | (force ? O_TRUNC : 0),
-		(mode_t) inode->mode & 0777);
+	file_fd = openat(dir_fd, name, O_CREAT | O_WRONLY |
+		(force ? O_TRUNC : 0), (mode_t) inode->mode & 0777);
 	if(file_fd == -1) {
 		ERROR("write_file: failed to create file %s, because %s\n",
 			pathname, strerror(errno));
@@ -836,6 +1034,7 @@ int write_file(struct inode *inode, char *pathname)
 		if(block == NULL)
 			EXIT_UNSQUASH("write_file: unable to malloc file\n");
 		block->offset = 0;
+		block->start = (long long) i * block_size;
 		block->size = i == file_end ? inode->data & (block_size - 1) :
 			block_size;
 		if(block_list[i] == 0) /* sparse file */
@@ -858,6 +1057,7 @@ int write_file(struct inode *inode, char *pathname)
 		s_ops.read_fragment(inode->fragment, &start, &size);
 		block->buffer = cache_get(fragment_cache, start, size);
 		block->offset = inode->offset;
+		block->start = (long long) inode->blocks * block_size;
 		block->size = inode->frag_bytes;
 		queue_put(to_writer, block);
 	}
@@ -867,16 +1067,21 @@ int write_file(struct inode *inode, char *pathname)
 }
 
 
-int create_inode(char *pathname, struct inode *i)
+/*
+ * Create name in the directory open on dir_fd, pathname is its full name
+ * for messages and later hard links
+ */
+int create_inode(int dir_fd, char *name, char *pathname, struct inode *i)
 {
 	TRACE("create_inode: pathname %s\n", pathname);
 
 	if(created_inode[i->inode_number - 1]) {
 		TRACE("create_inode: hard link\n");
 		if(force)
-			unlink(pathname);
+			unlinkat(dir_fd, name, 0);
 
-		if(link(created_inode[i->inode_number - 1], pathname) == -1) {
+		if(linkat(AT_FDCWD, created_inode[i->inode_number - 1], dir_fd,
+				name, 0) == -1) {
 			ERROR("create_inode: failed to create hardlink, "
 				"because %s\n", strerror(errno));
 			return FALSE;
@@ -891,7 +1096,7 @@ int create_inode(char *pathname, struct inode *i)
 			TRACE("create_inode: regular file, file_size %lld, "
 				"blocks %d\n", i->data, i->blocks);
 
-			if(write_file(i, pathname))
+			if(write_file(i, dir_fd, name, pathname))
 				file_count ++;
 			break;
 		case SQUASHFS_SYMLINK_TYPE:
@@ -900,25 +1105,17 @@ int create_inode(char *pathname, struct inode *i)
 				i->data);
 
 			if(force)
-				unlink(pathname);
+				unlinkat(dir_fd, name, 0);
 
-			if(symlink(i->symlink, pathname) == -1) {
+			if(symlinkat(i->symlink, dir_fd, name) == -1) {
 				ERROR("create_inode: failed to create symlink "
 					"%s, because %s\n", pathname,
 					strerror(errno));
 				break;
 			}
 
-			write_xattr(pathname, i->xattr);
-	
-			if(root_process) {
-				if(lchown(pathname, i->uid, i->gid) == -1)
-					ERROR("create_inode: failed to change "
-						"uid and gids on %s, because "
-						"%s\n", pathname,
-						strerror(errno));
-			}
-
+			set_attributes(pathname, i->mode, i->uid, i->gid,
+				i->time, i->xattr, FALSE);
 			sym_count ++;
 			break;
  		case SQUASHFS_BLKDEV_TYPE:
@@ -930,9 +1127,9 @@ int create_inode(char *pathname, struct inode *i)
 
 			if(root_process) {
 				if(force)
-					unlink(pathname);
+					unlinkat(dir_fd, name, 0);
 
-				if(mknod(pathname, chrdev ? S_IFCHR : S_IFBLK,
+				if(mknodat(dir_fd, name, chrdev ? S_IFCHR : S_IFBLK,
 						makedev((i->data >> 8) & 0xff,
 						i->data & 0xff)) == -1) {
 					ERROR("create_inode: failed to create "
@@ -956,9 +1153,9 @@ int create_inode(char *pathname, struct inode *i)
 			TRACE("create_inode: fifo\n");
 
 			if(force)
-				unlink(pathname);
+				unlinkat(dir_fd, name, 0);
 
-			if(mknod(pathname, S_IFIFO, 0) == -1) {
+			if(mknodat(dir_fd, name, S_IFIFO, 0) == -1) {
 				ERROR("create_inode: failed to create fifo %s, "
 					"because %s\n", pathname,
 					strerror(errno));
@@ -1250,11 +1447,11 @@ empty_set:
 }
 
 
-void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
+void pre_scan(unsigned int start_block, unsigned int offset,
 	struct pathnames *paths)
 {
 	unsigned int type;
-	char *name, pathname[1024];
+	char *name;
 	struct pathnames *new;
 	struct inode *i;
 	struct dir *dir = s_ops.squashfs_opendir(start_block, offset, &i);
@@ -1268,10 +1465,8 @@ void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 		if(!matches(paths, name, &new))
 			continue;
 
-		strcat(strcat(strcpy(pathname, parent_name), "/"), name);
-
 		if(type == SQUASHFS_DIR_TYPE)
-			pre_scan(parent_name, start_block, offset, new);
+			pre_scan(start_block, offset, new);
 		else if(new == NULL) {
 			if(type == SQUASHFS_FILE_TYPE ||
 					type == SQUASHFS_LREG_TYPE) {
@@ -1294,26 +1489,44 @@ void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 }
 
 
-void dir_scan(char *parent_name, unsigned int start_block, unsigned int offset,
-	struct pathnames *paths)
+/*
+ * Extract the directory dir_name in the directory open on parent_fd, and
+ * its contents relative to a descriptor for it.  pathname holds its full
+ * name, length bytes, and each entry's name is added to it in place.
+ */
+void dir_scan(int parent_fd, char *dir_name, char *pathname, int length,
+	unsigned int start_block, unsigned int offset, struct pathnames *paths)
 {
 	unsigned int type;
-	char *name, pathname[1024];
+	char *name;
+	int dir_fd = -1, name_length;
 	struct pathnames *new;
 	struct inode *i;
 	struct dir *dir = s_ops.squashfs_opendir(start_block, offset, &i);
 
 	if(lsonly || info)
-		print_filename(parent_name, i);
+		print_filename(pathname, i);
 
-	if(!lsonly && mkdir(parent_name, (mode_t) dir->mode) == -1 &&
-			(!force || errno != EEXIST)) {
-		ERROR("dir_scan: failed to make directory %s, because %s\n",
-			parent_name, strerror(errno));
-		squashfs_closedir(dir);
-		return;
+	if(!lsonly) {
+		if(mkdirat(parent_fd, dir_name, (mode_t) dir->mode) == -1 &&
+				(!force || errno != EEXIST)) {
+			ERROR("dir_scan: failed to make directory %s, because "
+				"%s\n", pathname, strerror(errno));
+			squashfs_closedir(dir);
+			return;
+		}
+
+		dir_fd = openat(parent_fd, dir_name, O_RDONLY | O_DIRECTORY);
+		if(dir_fd == -1) {
+			ERROR("dir_scan: failed to open directory %s, because "
+				"%s\n", pathname, strerror(errno));
+			squashfs_closedir(dir);
+			return;
+		}
 	}
 
+	pathname[length] = '/';
+
 	while(squashfs_readdir(dir, &name, &start_block, &offset, &type)) {
 		TRACE("dir_scan: name %s, start_block %d, offset %d, type %d\n",
 			name, start_block, offset, type);
@@ -1322,20 +1535,30 @@ void dir_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 		if(!matches(paths, name, &new))
 			continue;
 
-		strcat(strcat(strcpy(pathname, parent_name), "/"), name);
+		name_length = strlen(name);
+		if(length + 1 + name_length >= PATH_MAX) {
+			pathname[length] = '\0';
+			ERROR("dir_scan: pathname %s/%s is too long, skipping\n",
+				pathname, name);
+			pathname[length] = '/';
+			free_subdir(new);
+			continue;
+		}
+		memcpy(pathname + length + 1, name, name_length + 1);
 
 		if(type == SQUASHFS_DIR_TYPE)
-			dir_scan(pathname, start_block, offset, new);
+			dir_scan(dir_fd, pathname + length + 1, pathname,
+				length + 1 + name_length, start_block, offset,
+				new);
 		else if(new == NULL) {
 			i = s_ops.read_inode(start_block, offset);
 
 			if(lsonly || info)
 				print_filename(pathname, i);
 
-			if(!lsonly) {
-				create_inode(pathname, i);
-				update_progress_bar();
-				}
+			if(!lsonly)
+				create_inode(dir_fd, pathname + length + 1,
+					pathname, i);
 
 			if(i->type == SQUASHFS_SYMLINK_TYPE ||
 					i->type == SQUASHFS_LSYMLINK_TYPE)
@@ -1345,9 +1568,13 @@ void dir_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 		free_subdir(new);
 	}
 
-	if(!lsonly)
-		set_attributes(parent_name, dir->mode, dir->uid, dir->guid,
+	pathname[length] = '\0';
+
+	if(!lsonly) {
+		close(dir_fd);
+		set_attributes(pathname, dir->mode, dir->uid, dir->guid,
 			dir->mtime, dir->xattr, force);
+	}
 
 	squashfs_closedir(dir);
 	dir_count ++;
@@ -1450,10 +1677,56 @@ void squashfs_stat(char *source)
 }
 
 
+/*
+ * LZMA patched 3.x (and earlier) filesystems compress each block with LZMA
+ * or, where that doesn't gain, with zlib.  LZMA blocks start with the 0x5d
+ * properties byte
+ */
+static int sqlzma_uncompress(void *dest, void *src, int size, int block_size,
+	int *error)
+{
+	struct compressor *method = lookup_compressor(*(unsigned char *) src ==
+		0x5d ? "lzma" : "gzip");
+
+	return compressor_uncompress(method, dest, src, size, block_size,
+		error);
+}
+
+
+struct compressor sqlzma_comp_ops = {
+	.uncompress = sqlzma_uncompress,
+	.name = "sqlzma",
+};
+
+
+/*
+ * Not every LZMA patched mksquashfs gives its filesystems a magic of their
+ * own, the others are told apart by the first compressed block of the
+ * inode table not being zlib
+ */
+static int lzma_blocks()
+{
+	unsigned short c_byte;
+	unsigned char first;
+	long long start = sBlk.s.inode_table_start;
+
+	if(read_fs_bytes(fd, start, 2, &c_byte) == FALSE)
+		return FALSE;
+	if(swap)
+		c_byte = (c_byte >> 8) | ((c_byte & 0xff) << 8);
+	if(!SQUASHFS_COMPRESSED(c_byte))
+		return FALSE;
+
+	start += SQUASHFS_CHECK_DATA(sBlk.s.flags) ? 3 : 2;
+	return read_fs_bytes(fd, start, 1, &first) && first == 0x5d;
+}
+
+
 int read_super(char *source)
 {
 	squashfs_super_block_3 sBlk_3;
 	struct squashfs_super_block sBlk_4;
+	int lzma = FALSE;
 
 	/*
 	 * Try to read a Squashfs 4 superblock
@@ -1491,6 +1764,12 @@ int read_super(char *source)
 	 * Check it is a SQUASHFS superblock
 	 */
 	swap = 0;
+	if(sBlk_3.s_magic == SQUASHFS_MAGIC_LZMA ||
+			sBlk_3.s_magic == SQUASHFS_MAGIC_LZMA_SWAP) {
+		lzma = TRUE;
+		sBlk_3.s_magic = sBlk_3.s_magic == SQUASHFS_MAGIC_LZMA ?
+			SQUASHFS_MAGIC : SQUASHFS_MAGIC_SWAP;
+	}
 	if(sBlk_3.s_magic != SQUASHFS_MAGIC) {
 		if(sBlk_3.s_magic == SQUASHFS_MAGIC_SWAP) {
 			squashfs_super_block_3 sblk;
@@ -1568,9 +1847,14 @@ int read_super(char *source)
 	}
 
 	/*
-	 * 1.x, 2.x and 3.x filesystems use gzip compression.
+	 * 1.x, 2.x and 3.x filesystems use gzip compression, unless they were
+	 * made by an LZMA patched mksquashfs
 	 */
-	comp = lookup_compressor("gzip");
+	if(lzma || lzma_blocks()) {
+		comp = &sqlzma_comp_ops;
+		comp->supported = lookup_compressor("lzma")->supported;
+	} else
+		comp = lookup_compressor("gzip");
 	return TRUE;
 
 failed_mount:
@@ -1597,31 +1881,72 @@ struct pathname *process_extract_files(struct pathname *path, char *filename)
 		
 
 /*
- * reader thread.  This thread processes read requests queued by the
- * cache_get() routine.
+ * Takes the next read request off the queue if it is for the block that
+ * starts at next on disk.  write_file() queues the blocks of a file in
+ * order, so they can be read together
+ */
+struct cache_entry *queue_get_adjacent(struct queue *queue, long long next)
+{
+	struct cache_entry *entry = NULL;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	if(queue->readp != queue->writep &&
+			((struct cache_entry *)
+			queue->data[queue->readp])->block == next) {
+		entry = queue->data[queue->readp];
+		queue->readp = (queue->readp + 1) % queue->size;
+		pthread_cond_signal(&queue->full);
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+
+	return entry;
+}
+
+
+/*
+ * reader thread(s).  These process read requests queued by the
+ * cache_get() routine, reading up to READER_COALESCE adjacent blocks
+ * with one read.
  */
 void *reader(void *arg)
 {
-	while(1) {
-		struct cache_entry *entry = queue_get(to_reader);
-		int res = read_fs_bytes(fd, entry->block,
-			SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
-			entry->data);
+	struct cache_entry *entry[READER_COALESCE];
+	struct iovec iov[READER_COALESCE];
 
-		if(res && SQUASHFS_COMPRESSED_BLOCK(entry->size))
-			/*
-			 * queue successfully read block to the deflate
-			 * thread(s) for further processing
- 			 */
-			queue_put(to_deflate, entry);
-		else
-			/*
-			 * block has either been successfully read and is
-			 * uncompressed, or an error has occurred, clear pending
-			 * flag, set error appropriately, and wake up any
-			 * threads waiting on this buffer
-			 */
-			cache_block_ready(entry, !res);
+	while(1) {
+		long long next;
+		int i, n = 0, res;
+
+		entry[0] = queue_get(to_reader);
+		do {
+			iov[n].iov_base = entry[n]->data;
+			iov[n].iov_len =
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry[n]->size);
+			next = entry[n]->block + iov[n].iov_len;
+			n ++;
+		} while(n < READER_COALESCE && (entry[n] =
+			queue_get_adjacent(to_reader, next)) != NULL);
+
+		res = read_fs_vector(fd, entry[0]->block, iov, n);
+
+		for(i = 0; i < n; i++)
+			if(res && SQUASHFS_COMPRESSED_BLOCK(entry[i]->size))
+				/*
+				 * queue successfully read block to the deflate
+				 * thread(s) for further processing
+ 				 */
+				queue_put(to_deflate, entry[i]);
+			else
+				/*
+				 * block has either been successfully read and
+				 * is uncompressed, or an error has occurred,
+				 * clear pending flag, set error appropriately,
+				 * and wake up any threads waiting on this
+				 * buffer
+				 */
+				cache_block_ready(entry[i], !res);
 	}
 }
 
@@ -1637,9 +1962,8 @@ void *writer(void *arg)
 	while(1) {
 		struct squashfs_file *file = queue_get(to_writer);
 		int file_fd;
-		long long hole = 0;
+		long long hole_start = 0, hole = 0;
 		int failed = FALSE;
-		int error;
 
 		if(file == NULL) {
 			queue_put(from_writer, NULL);
@@ -1650,10 +1974,27 @@ void *writer(void *arg)
 
 		file_fd = file->fd;
 
+		/*
+		 * every block is written at its offset in the file, adjacent
+		 * sparse blocks are made into one hole
+		 */
 		for(i = 0; i < file->blocks; i++, cur_blocks ++) {
 			struct file_entry *block = queue_get(to_writer);
 
-			if(block->buffer == 0) { /* sparse file */
+			if(hole && (block->buffer ||
+					hole_start + hole != block->start)) {
+				if(failed == FALSE && write_hole(file_fd, hole,
+						hole_start, file->sparse) == FALSE) {
+					ERROR("writer: failed to write sparse "
+						"data block\n");
+					failed = TRUE;
+				}
+				hole = 0;
+			}
+
+			if(block->buffer == NULL) { /* sparse file */
+				if(hole == 0)
+					hole_start = block->start;
 				hole += block->size;
 				free(block);
 				continue;
@@ -1664,43 +2005,26 @@ void *writer(void *arg)
 			if(block->buffer->error)
 				failed = TRUE;
 
-			if(failed)
-				continue;
-
-			error = write_block(file_fd, block->buffer->data +
-				block->offset, block->size, hole, file->sparse);
-
-			if(error == FALSE) {
+			if(failed == FALSE && write_bytes(file_fd,
+					block->buffer->data + block->offset,
+					block->size, block->start) == -1) {
 				ERROR("writer: failed to write data block %d\n",
 					i);
 				failed = TRUE;
 			}
 
-			hole = 0;
 			cache_block_put(block->buffer);
 			free(block);
 		}
 
 		if(hole && failed == FALSE) {
 			/*
-			 * corner case for hole extending to end of file
+			 * a hole extending to the end of the file leaves it
+			 * short until it is truncated to its size
 			 */
-			if(file->sparse == FALSE ||
-					lseek(file_fd, hole, SEEK_CUR) == -1) {
-				/*
-				 * for files which we don't want to write
-				 * sparsely, or for broken lseeks which cannot
-				 * seek beyond end of file, write_block will do
-				 * the right thing
-				 */
-				hole --;
-				if(write_block(file_fd, "\0", 1, hole,
-						file->sparse) == FALSE) {
-					ERROR("writer: failed to write sparse "
-						"data block\n");
-					failed = TRUE;
-				}
-			} else if(ftruncate(file_fd, file->file_size) == -1) {
+			if(write_hole(file_fd, hole, hole_start,
+					file->sparse) == FALSE ||
+					ftruncate(file_fd, file->file_size) == -1) {
 				ERROR("writer: failed to write sparse data "
 					"block\n");
 				failed = TRUE;
@@ -1753,6 +2077,12 @@ void *deflator(void *arg)
 }
 
 
+/*
+ * progress thread.  Redraws the bar every quarter second from the counts,
+ * which are read without locking as each is only bumped by one thread
+ * (cur_blocks by the writer, the others by dir_scan).  It isn't started
+ * with -no-progress.
+ */
 void *progress_thread(void *arg)
 {
 	struct timeval timeval;
@@ -1831,10 +2161,10 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 #endif
 	}
 
-	thread = malloc((3 + processors) * sizeof(pthread_t));
+	thread = malloc((2 + readers + processors) * sizeof(pthread_t));
 	if(thread == NULL)
 		EXIT_UNSQUASH("Out of memory allocating thread descriptors\n");
-	deflator_thread = &thread[3];
+	deflator_thread = &thread[2 + readers];
 
 	to_reader = queue_init(all_buffers_size);
 	to_deflate = queue_init(all_buffers_size);
@@ -1842,11 +2172,16 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 	from_writer = queue_init(1);
 	fragment_cache = cache_init(block_size, fragment_buffer_size);
 	data_cache = cache_init(block_size, data_buffer_size);
-	pthread_create(&thread[0], NULL, reader, NULL);
-	pthread_create(&thread[1], NULL, writer, NULL);
-	pthread_create(&thread[2], NULL, progress_thread, NULL);
+	pthread_create(&thread[0], NULL, writer, NULL);
+	if(progress)
+		pthread_create(&thread[1], NULL, progress_thread, NULL);
 	pthread_mutex_init(&fragment_mutex, NULL);
 
+	for(i = 0; i < readers; i++) {
+		if(pthread_create(&thread[2 + i], NULL, reader, NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+	}
+
 	for(i = 0; i < processors; i++) {
 		if(pthread_create(&deflator_thread[i], NULL, deflator, NULL) !=
 				 0)
@@ -1878,14 +2213,6 @@ void disable_progress_bar()
 }
 
 
-void update_progress_bar()
-{
-	pthread_mutex_lock(&screen_mutex);
-	pthread_cond_signal(&progress_wait);
-	pthread_mutex_unlock(&screen_mutex);
-}
-
-
 void progress_bar(long long current, long long max, int columns)
 {
 	char rotate_list[] = { '|', '/', '-', '\\' };
@@ -1954,9 +2281,10 @@ void progress_bar(long long current, long long max, int columns)
 	printf("MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the"\
 		"\n");\
 	printf("GNU General Public License for more details.\n");
+#ifndef SQUASHFS_FUSE
 int main(int argc, char *argv[])
 {
-	char *dest = "squashfs-root";
+	char *dest = "squashfs-root", pathname[PATH_MAX];
 	int i, stat_sys = FALSE, version = FALSE;
 	int n;
 	struct pathnames *paths = NULL;
@@ -2014,6 +2342,15 @@ int main(int argc, char *argv[])
 					argv[0]);
 				exit(1);
 			}
+		} else if(strcmp(argv[i], "-readers") == 0 ||
+				strcmp(argv[i], "-rd") == 0) {
+			if((++i == argc) ||
+					(readers = strtol(argv[i], &b, 10),
+					*b != '\0') || readers < 1) {
+				ERROR("%s: -readers missing or invalid "
+					"number of readers\n", argv[0]);
+				exit(1);
+			}
 		} else if(strcmp(argv[i], "-data-queue") == 0 ||
 					 strcmp(argv[i], "-da") == 0) {
 			if((++i == argc) ||
@@ -2096,6 +2433,9 @@ options:
 			ERROR("\t-p[rocessors] <number>\tuse <number> "
 				"processors.  By default will use\n");
 			ERROR("\t\t\t\tnumber of processors available\n");
+			ERROR("\t-rd[eaders] <number>\tuse <number> threads to "
+				"read the filesystem.\n\t\t\t\tDefault 1, more "
+				"help on network storage\n");
 			ERROR("\t-i[nfo]\t\t\tprint files as they are "
 				"unsquashed\n");
 			ERROR("\t-li[nfo]\t\tprint files as they are "
@@ -2201,7 +2541,7 @@ options:
 		paths = add_subdir(paths, path);
 	}
 
-	pre_scan(dest, SQUASHFS_INODE_BLK(sBlk.s.root_inode),
+	pre_scan(SQUASHFS_INODE_BLK(sBlk.s.root_inode),
 		SQUASHFS_INODE_OFFSET(sBlk.s.root_inode), paths);
 
 	memset(created_inode, 0, sBlk.s.inodes * sizeof(char *));
@@ -2213,12 +2553,18 @@ options:
 	if(progress)
 		enable_progress_bar();
 
-	dir_scan(dest, SQUASHFS_INODE_BLK(sBlk.s.root_inode),
+	if(strlen(dest) >= PATH_MAX)
+		EXIT_UNSQUASH("destination %s is too long\n", dest);
+	strcpy(pathname, dest);
+	dir_scan(AT_FDCWD, dest, pathname, strlen(dest),
+		SQUASHFS_INODE_BLK(sBlk.s.root_inode),
 		SQUASHFS_INODE_OFFSET(sBlk.s.root_inode), paths);
 
 	queue_put(to_writer, NULL);
 	queue_get(from_writer);
 
+	apply_queued_attributes();
+
 	if(progress) {
 		disable_progress_bar();
 		progress_bar(sym_count + dev_count + fifo_count + cur_blocks,
@@ -2236,3 +2582,4 @@ options:
 
 	return 0;
 }
+#endif
@@ -44,6 +44,7 @@
 #include <math.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <limits.h>
 
 #ifndef linux
 #define __BYTE_ORDER BYTE_ORDER
@@ -190,6 +191,8 @@ struct queue {
 #define FRAGMENT_BUFFER_DEFAULT 256
 /* default size of data buffer in Mbytes */
 #define DATA_BUFFER_DEFAULT 256
+/* most adjacent blocks a reader thread reads at once */
+#define READER_COALESCE 32
 
 #define DIR_ENT_SIZE	16
 
@@ -214,6 +217,8 @@ struct dir {
 struct file_entry {
 	int offset;
 	int size;
+	/* offset of the block in the file */
+	long long start;
 	struct cache_entry *buffer;
 };
 
@@ -295,3 +300,24 @@ extern struct inode *read_inode_4(unsigned int, unsigned int);
 extern struct dir *squashfs_opendir_4(unsigned int, unsigned int,
 	struct inode **);
 extern int read_uids_guids_4();
+
+/* the rest of the engine in unsquashfs.c, for squashfs-fuse */
+extern struct cache *fragment_cache, *data_cache;
+extern struct queue *to_reader, *to_deflate;
+extern struct compressor *comp;
+extern unsigned int block_size, block_log;
+extern int processors, readers;
+
+extern struct queue *queue_init(int);
+extern struct cache *cache_init(int, int);
+extern struct cache_entry *cache_get(struct cache *, long long, int);
+extern void cache_block_wait(struct cache_entry *);
+extern void cache_block_put(struct cache_entry *);
+extern void *reader(void *);
+extern void *deflator(void *);
+extern int read_super(char *);
+extern void uncompress_inode_table(long long, long long);
+extern void uncompress_directory_table(long long, long long);
+extern int squashfs_readdir(struct dir *, char **, unsigned int *,
+	unsigned int *, unsigned int *);
+extern void squashfs_closedir(struct dir *);
@@ -31,14 +31,90 @@
 #include "xz_wrapper.h"
 #include "compressor.h"
 
+/*
+ * Cheap checks of whether a block looks like code for a BCJ filter, rather
+ * than compressing it with each filter to find out.  They count the branch
+ * instructions the filter converts, and pass if there are several times
+ * more than in random data, of which 1 in p positions would match
+ */
+#define LOOKS_LIKE_CODE(hits, positions, p) \
+	((hits) > 4 * (positions) / (p) + 16)
+
+static int x86_code(unsigned char *b, int size)
+{
+	int i, hits = 0;
+
+	/* call and jmp with a 32-bit displacement of under 16 Mbytes */
+	for(i = 0; i + 4 < size; i++)
+		if((b[i] & 0xfe) == 0xe8 && (b[i + 4] == 0 || b[i + 4] == 0xff))
+			hits ++;
+
+	return LOOKS_LIKE_CODE(hits, size, 16384);
+}
+
+
+static int powerpc_code(unsigned char *b, int size)
+{
+	int i, hits = 0;
+
+	/* bl */
+	for(i = 0; i + 3 < size; i += 4)
+		if((b[i] & 0xfc) == 0x48 && (b[i + 3] & 3) == 1)
+			hits ++;
+
+	return LOOKS_LIKE_CODE(hits, size / 4, 256);
+}
+
+
+static int arm_code(unsigned char *b, int size)
+{
+	int i, hits = 0;
+
+	/* bl */
+	for(i = 0; i + 3 < size; i += 4)
+		if(b[i + 3] == 0xeb)
+			hits ++;
+
+	return LOOKS_LIKE_CODE(hits, size / 4, 256);
+}
+
+
+static int armthumb_code(unsigned char *b, int size)
+{
+	int i, hits = 0;
+
+	/* the two halves of bl */
+	for(i = 0; i + 3 < size; i += 2)
+		if((b[i + 1] & 0xf8) == 0xf0 && (b[i + 3] & 0xf8) == 0xf8)
+			hits ++;
+
+	return LOOKS_LIKE_CODE(hits, size / 2, 1024);
+}
+
+
+static int sparc_code(unsigned char *b, int size)
+{
+	int i, hits = 0;
+
+	/* call with a displacement of under 16 Mbytes */
+	for(i = 0; i + 3 < size; i += 4)
+		if((b[i] == 0x40 && (b[i + 1] & 0xc0) == 0) ||
+				(b[i] == 0x7f && (b[i + 1] & 0xc0) == 0xc0))
+			hits ++;
+
+	return LOOKS_LIKE_CODE(hits, size / 4, 512);
+}
+
+
+/* ia64 branches are in instruction bundles, it is always tried */
 static struct bcj bcj[] = {
-	{ "x86", LZMA_FILTER_X86, 0 },
-	{ "powerpc", LZMA_FILTER_POWERPC, 0 },
-	{ "ia64", LZMA_FILTER_IA64, 0 },
-	{ "arm", LZMA_FILTER_ARM, 0 },
-	{ "armthumb", LZMA_FILTER_ARMTHUMB, 0 },
-	{ "sparc", LZMA_FILTER_SPARC, 0 },
-	{ NULL, LZMA_VLI_UNKNOWN, 0 }
+	{ "x86", LZMA_FILTER_X86, 0, x86_code },
+	{ "powerpc", LZMA_FILTER_POWERPC, 0, powerpc_code },
+	{ "ia64", LZMA_FILTER_IA64, 0, NULL },
+	{ "arm", LZMA_FILTER_ARM, 0, arm_code },
+	{ "armthumb", LZMA_FILTER_ARMTHUMB, 0, armthumb_code },
+	{ "sparc", LZMA_FILTER_SPARC, 0, sparc_code },
+	{ NULL, LZMA_VLI_UNKNOWN, 0, NULL }
 };
 
 static struct comp_opts comp_opts;
@@ -294,6 +370,7 @@ static int xz_init(void **strm, int block_size, int datablock)
 			if(filter[j].buffer == NULL)
 				goto failed3;
 			filter[j].filter[0].id = bcj[i].id;
+			filter[j].code = bcj[i].code;
 			filter[j].filter[1].id = LZMA_FILTER_LZMA2;
 			filter[j].filter[1].options = &stream->opt;
 			filter[j].filter[2].id = LZMA_VLI_UNKNOWN;
@@ -329,6 +406,9 @@ static int xz_compress(void *strm, void *dest, void *src,  int size,
 	for(i = 0; i < stream->filters; i++) {
 		struct filter *filter = &stream->filter[i];
 
+		if(filter->code && !filter->code(src, size))
+			continue;
+
         	if(lzma_lzma_preset(&stream->opt, LZMA_PRESET_DEFAULT))
                 	goto failed;
 
@@ -387,7 +467,9 @@ void xz_usage()
 	fprintf(stderr, "\t  -Xbcj filter1,filter2,...,filterN\n");
 	fprintf(stderr, "\t\tCompress using filter1,filter2,...,filterN in");
 	fprintf(stderr, " turn\n\t\t(in addition to no filter), and choose");
-	fprintf(stderr, " the best compression.\n");
+	fprintf(stderr, " the best compression.\n\t\tA filter is only");
+	fprintf(stderr, " tried on blocks which look like\n\t\tcode for");
+	fprintf(stderr, " it.\n");
 	fprintf(stderr, "\t\tAvailable filters: x86, arm, armthumb,");
 	fprintf(stderr, " powerpc, sparc, ia64\n");
 	fprintf(stderr, "\t  -Xdict-size <dict-size>\n");
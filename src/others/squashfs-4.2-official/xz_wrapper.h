@@ -49,12 +49,14 @@ struct bcj {
 	char	 	*name;
 	lzma_vli	id;
 	int		selected;
+	int		(*code)(unsigned char *, int);
 };
 
 struct filter {
 	void		*buffer;
 	lzma_filter	filter[3];
 	size_t		length;
+	int		(*code)(unsigned char *, int);
 };
 
 struct xz_stream {
@@ -0,0 +1,292 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * arena.c
+ *
+ * Arena allocation for the structures built while scanning the source
+ * tree.  Mksquashfs allocates several small objects per file and keeps
+ * most of them until it exits, so carving them out of large blocks saves
+ * the per-allocation overhead of malloc, and strings which repeat across
+ * directories (file names) can be stored once.
+ *
+ * For trees too big for memory (-spill) the blocks are instead mapped from
+ * an unlinked file.  The pages are then the page cache's, which writes
+ * them back and drops them when memory is short instead of mksquashfs
+ * getting killed, and reads back only the ones a lookup touches.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+#define ARENA_HEADER	((sizeof(struct arena_block) + ARENA_ALIGN - 1) & \
+				~(ARENA_ALIGN - 1))
+
+static char *spill_dir = NULL;
+static int spill_fd = -1;
+static long long spill_size = 0;
+static size_t page_size;
+
+
+/* an unlinked file in the spill directory, -1 if it can't be made */
+static int spill_open()
+{
+	int fd, len = strlen(spill_dir) + 32;
+	char *name = malloc(len);
+
+	if(name == NULL)
+		return -1;
+
+	snprintf(name, len, "%s/mksquashfs-spill-XXXXXX", spill_dir);
+	fd = mkstemp(name);
+	if(fd != -1)
+		unlink(name);
+	free(name);
+
+	return fd;
+}
+
+
+/*
+ * Spill the arenas and tables to files in dir from now on.  Returns 0
+ * if a file can't be made there
+ */
+int arena_spill(const char *dir)
+{
+	spill_dir = strdup(dir);
+	if(spill_dir == NULL)
+		return 0;
+
+	spill_fd = spill_open();
+	if(spill_fd == -1) {
+		free(spill_dir);
+		spill_dir = NULL;
+		return 0;
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	return 1;
+}
+
+
+static struct arena_block *block_alloc(size_t size)
+{
+	struct arena_block *block;
+
+	if(spill_fd == -1) {
+		block = malloc(size);
+		if(block == NULL)
+			return NULL;
+		block->size = size;
+		block->offset = -1;
+		return block;
+	}
+
+	/* the file only grows, the holes of freed blocks are punched */
+	size = (size + page_size - 1) & ~(page_size - 1);
+	if(ftruncate(spill_fd, spill_size + size) == -1)
+		return NULL;
+	block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, spill_fd,
+		spill_size);
+	if(block == MAP_FAILED)
+		return NULL;
+
+	block->size = size;
+	block->offset = spill_size;
+	spill_size += size;
+	return block;
+}
+
+
+static void block_free(struct arena_block *block)
+{
+	size_t size = block->size;
+	long long offset = block->offset;
+
+	if(offset == -1) {
+		free(block);
+		return;
+	}
+
+	munmap(block, size);
+	fallocate(spill_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+		size);
+}
+
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_block *block;
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	if(arena->block && arena->used + size <= arena->block->size) {
+		void *data = (char *) arena->block + arena->used;
+
+		arena->used += size;
+		return data;
+	}
+
+	if(size > ARENA_BLOCK_SIZE / 4) {
+		/*
+		 * give large objects a block of their own, behind the current
+		 * block so the space left in that isn't wasted
+		 */
+		block = block_alloc(ARENA_HEADER + size);
+		if(block == NULL)
+			return NULL;
+		if(arena->block) {
+			block->next = arena->block->next;
+			arena->block->next = block;
+		} else {
+			block->next = NULL;
+			arena->block = block;
+			arena->used = ARENA_HEADER + size;
+		}
+		return (char *) block + ARENA_HEADER;
+	}
+
+	block = block_alloc(ARENA_BLOCK_SIZE);
+	if(block == NULL)
+		return NULL;
+	block->next = arena->block;
+	arena->block = block;
+	arena->used = ARENA_HEADER + size;
+
+	return (char *) block + ARENA_HEADER;
+}
+
+
+char *arena_strdup(struct arena *arena, const char *string)
+{
+	int size = strlen(string) + 1;
+	char *copy = arena_alloc(arena, size);
+
+	if(copy)
+		memcpy(copy, string, size);
+
+	return copy;
+}
+
+
+/*
+ * Returns the arena's copy of string, storing it if it's the first time
+ * string has been seen.  Interned strings are shared and so mustn't be
+ * modified
+ */
+char *arena_intern(struct arena *arena, const char *string)
+{
+	unsigned int hash = 5381;
+	const char *s;
+	struct arena_string *entry;
+
+	if(arena->strings == NULL) {
+		arena->strings = calloc(ARENA_STRING_HASH,
+			sizeof(struct arena_string *));
+		if(arena->strings == NULL)
+			return NULL;
+	}
+
+	for(s = string; *s; s++)
+		hash = hash * 33 + *s;
+	hash &= ARENA_STRING_HASH - 1;
+
+	for(entry = arena->strings[hash]; entry; entry = entry->next)
+		if(strcmp(entry->string, string) == 0)
+			return entry->string;
+
+	entry = arena_alloc(arena, sizeof(struct arena_string));
+	if(entry == NULL)
+		return NULL;
+	entry->string = arena_strdup(arena, string);
+	if(entry->string == NULL)
+		return NULL;
+	entry->next = arena->strings[hash];
+	arena->strings[hash] = entry;
+
+	return entry->string;
+}
+
+
+void arena_free(struct arena *arena)
+{
+	while(arena->block) {
+		struct arena_block *block = arena->block;
+
+		arena->block = block->next;
+		block_free(block);
+	}
+
+	free(arena->strings);
+	arena->strings = NULL;
+	arena->used = 0;
+}
+
+
+/*
+ * Grows the table at data, of old_size bytes, to size bytes, returning
+ * where it now is, or NULL.  data can be a malloced table, that of the
+ * file system being appended to, which is then moved into the mapping
+ */
+void *arena_table_resize(struct arena_table *table, void *data,
+	size_t old_size, size_t size)
+{
+	size_t mapped;
+	void *map;
+
+	if(spill_dir == NULL)
+		return realloc(data, size);
+
+	if(size <= table->mapped)
+		return data;
+
+	/* double it, so appending a metadata block at a time is linear */
+	mapped = table->mapped ? table->mapped * 2 : ARENA_BLOCK_SIZE;
+	while(mapped < size)
+		mapped *= 2;
+
+	if(table->mapped == 0) {
+		table->fd = spill_open();
+		if(table->fd == -1)
+			return NULL;
+	}
+	if(ftruncate(table->fd, mapped) == -1)
+		return NULL;
+
+	if(table->mapped)
+		map = mremap(data, table->mapped, mapped, MREMAP_MAYMOVE);
+	else
+		map = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED,
+			table->fd, 0);
+	if(map == MAP_FAILED)
+		return NULL;
+
+	if(table->mapped == 0 && data) {
+		memcpy(map, data, old_size);
+		free(data);
+	}
+	table->mapped = mapped;
+	return map;
+}
@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * arena.h
+ */
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE	(256 * 1024)
+#define ARENA_ALIGN		sizeof(long long)
+#define ARENA_STRING_HASH	65536
+
+struct arena_block {
+	struct arena_block	*next;
+	size_t			size;
+	long long		offset;		/* in the spill file, or -1 */
+};
+
+struct arena_string {
+	struct arena_string	*next;
+	char			*string;
+};
+
+/*
+ * Bump allocator, objects can't be freed individually, only the whole
+ * arena at once.  A zeroed struct arena is an empty arena
+ */
+struct arena {
+	struct arena_block	*block;
+	size_t			used;
+	struct arena_string	**strings;
+};
+
+extern void *arena_alloc(struct arena *, size_t);
+extern char *arena_strdup(struct arena *, const char *);
+extern char *arena_intern(struct arena *, const char *);
+extern void arena_free(struct arena *);
+
+/*
+ * A buffer which only grows, the inode and directory tables.  When
+ * spilling it's a mapping of a file of its own, so growing it doesn't copy
+ * it.  A zeroed struct arena_table is an empty table
+ */
+struct arena_table {
+	int			fd;
+	size_t			mapped;		/* 0 until fd is open */
+};
+
+extern void *arena_table_resize(struct arena_table *, void *, size_t, size_t);
+extern int arena_spill(const char *);
+#endif
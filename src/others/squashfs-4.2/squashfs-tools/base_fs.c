@@ -0,0 +1,719 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * base_fs.c
+ *
+ * Index of the regular files in the -base image.  Files in the source
+ * whose size and mtime match their namesake in the base image have their
+ * compressed data blocks copied from it rather than being read and
+ * compressed again.
+ */
+
+#define TRUE 1
+#define FALSE 0
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef linux
+#ifndef __CYGWIN__
+#define __BYTE_ORDER BYTE_ORDER
+#define __BIG_ENDIAN BIG_ENDIAN
+#define __LITTLE_ENDIAN LITTLE_ENDIAN
+#endif
+#else
+#include <endian.h>
+#endif
+
+#ifdef SQUASHFS_TRACE
+#define TRACE(s, args...) \
+		do { \
+			printf("mksquashfs: "s, ## args); \
+		} while(0)
+#else
+#define TRACE(s, args...)
+#endif
+
+#define ERROR(s, args...) \
+		do { \
+			fprintf(stderr, s, ## args); \
+		} while(0)
+
+#include "squashfs_fs.h"
+#include "squashfs_swap.h"
+#include "read_fs.h"
+#include "compressor.h"
+#include "arena.h"
+#include "base_fs.h"
+
+extern int read_fs_bytes(int, long long, int, void *);
+
+static int base_fd = -1;
+static struct compressor *base_comp;
+static struct squashfs_super_block base_sBlk;
+static struct base_fragment *base_fragment_table;
+static struct base_file *base_table[BASE_HASH_SIZE];
+static struct arena base_arena;
+
+/*
+ * the inode table is read whole, index[i] being the offset of its i'th
+ * metadata block within the image's inode table and the uncompressed
+ * table
+ */
+static unsigned char *inode_table;
+static struct base_index {
+	unsigned int		start;
+	unsigned int		offset;
+} *inode_index;
+static int inode_blocks;
+
+/*
+ * regular files and fragment blocks by where their data is in the image,
+ * and files by fragment block, built the first time base_files_at() is
+ * called
+ */
+static struct base_extent {
+	long long		start;
+	long long		end;
+	struct base_file	*file;
+	unsigned int		fragment;
+} *base_extent, *frag_extent;
+static struct base_file **frag_files;
+static int base_extents, frag_extents, base_frag_files;
+
+/* the reader thread's last decompressed fragment block */
+static char *fragment_data;
+static unsigned int fragment_cached = SQUASHFS_INVALID_FRAG;
+static int fragment_size;
+
+
+static unsigned int base_hash(char *pathname)
+{
+	unsigned int hash = 5381;
+
+	while(*pathname)
+		hash = hash * 33 + *pathname++;
+
+	return hash & (BASE_HASH_SIZE - 1);
+}
+
+
+static int read_base_block(long long start, long long *next, void *block)
+{
+	unsigned short c_byte;
+	char buffer[SQUASHFS_METADATA_SIZE];
+	int error, res;
+
+	if(read_fs_bytes(base_fd, start, 2, &c_byte) == 0)
+		return 0;
+
+	SQUASHFS_INSWAP_SHORTS(&c_byte, 1);
+
+	if(next)
+		*next = start + 2 + SQUASHFS_COMPRESSED_SIZE(c_byte);
+
+	if(!SQUASHFS_COMPRESSED(c_byte)) {
+		c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
+		return read_fs_bytes(base_fd, start + 2, c_byte, block) ?
+			c_byte : 0;
+	}
+
+	c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
+	if(read_fs_bytes(base_fd, start + 2, c_byte, buffer) == 0)
+		return 0;
+
+	res = compressor_uncompress(base_comp, block, buffer, c_byte,
+		SQUASHFS_METADATA_SIZE, &error);
+	if(res == -1) {
+		ERROR("%s uncompress failed with error code %d\n",
+			base_comp->name, error);
+		return 0;
+	}
+
+	return res;
+}
+
+
+static int read_inode_table()
+{
+	long long start = base_sBlk.inode_table_start;
+	int bytes = 0, size = 0, byte;
+
+	while(start < base_sBlk.directory_table_start) {
+		if(size - bytes < SQUASHFS_METADATA_SIZE) {
+			inode_table = realloc(inode_table, size +=
+				SQUASHFS_METADATA_SIZE * 16);
+			if(inode_table == NULL)
+				goto failed;
+		}
+
+		inode_index = realloc(inode_index, (inode_blocks + 1) *
+			sizeof(struct base_index));
+		if(inode_index == NULL)
+			goto failed;
+		inode_index[inode_blocks].start = start -
+			base_sBlk.inode_table_start;
+		inode_index[inode_blocks ++].offset = bytes;
+
+		byte = read_base_block(start, &start, inode_table + bytes);
+		if(byte == 0) {
+			ERROR("Failed to read base inode table\n");
+			return FALSE;
+		}
+		bytes += byte;
+	}
+
+	return TRUE;
+
+failed:
+	ERROR("Out of memory reading base inode table\n");
+	return FALSE;
+}
+
+
+/*
+ * Returns the inode at offset within the inode table metadata block
+ * starting at start, or NULL if there's no such block
+ */
+static unsigned char *base_inode(unsigned int start, unsigned int offset)
+{
+	int low = 0, high = inode_blocks - 1;
+
+	while(low <= high) {
+		int mid = (low + high) / 2;
+
+		if(inode_index[mid].start == start)
+			return inode_table + inode_index[mid].offset + offset;
+		if(inode_index[mid].start < start)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return NULL;
+}
+
+
+static int read_fragment_index()
+{
+	int i, indexes = SQUASHFS_FRAGMENT_INDEXES(base_sBlk.fragments);
+	long long index[indexes];
+	struct squashfs_fragment_entry *table;
+
+	if(base_sBlk.fragments == 0)
+		return TRUE;
+
+	table = malloc(indexes * SQUASHFS_METADATA_SIZE);
+	base_fragment_table = malloc(base_sBlk.fragments *
+		sizeof(struct base_fragment));
+	fragment_data = malloc(base_sBlk.block_size);
+	if(table == NULL || base_fragment_table == NULL ||
+			fragment_data == NULL) {
+		ERROR("Out of memory reading base fragment table\n");
+		return FALSE;
+	}
+
+	if(read_fs_bytes(base_fd, base_sBlk.fragment_table_start,
+			SQUASHFS_FRAGMENT_INDEX_BYTES(base_sBlk.fragments),
+			index) == 0)
+		goto failed;
+
+	SQUASHFS_INSWAP_FRAGMENT_INDEXES(index, indexes);
+
+	for(i = 0; i < indexes; i++)
+		if(read_base_block(index[i], NULL, ((char *) table) + i *
+				SQUASHFS_METADATA_SIZE) == 0)
+			goto failed;
+
+	for(i = 0; i < base_sBlk.fragments; i++) {
+		SQUASHFS_INSWAP_FRAGMENT_ENTRY(&table[i]);
+		base_fragment_table[i].start_block = table[i].start_block;
+		base_fragment_table[i].size = table[i].size;
+		base_fragment_table[i].copy = 0;
+	}
+
+	free(table);
+	return TRUE;
+
+failed:
+	ERROR("Failed to read base fragment table\n");
+	free(table);
+	return FALSE;
+}
+
+
+static int add_base_file(char *pathname, unsigned char *inodep)
+{
+	struct squashfs_base_inode_header base;
+	struct base_file *file;
+	int hash;
+
+	file = arena_alloc(&base_arena, sizeof(struct base_file));
+	if(file == NULL)
+		return FALSE;
+
+	SQUASHFS_SWAP_BASE_INODE_HEADER(&base, inodep);
+	if(base.inode_type == SQUASHFS_FILE_TYPE) {
+		struct squashfs_reg_inode_header inode;
+
+		SQUASHFS_SWAP_REG_INODE_HEADER(&inode, inodep);
+		file->file_size = inode.file_size;
+		file->start = inode.start_block;
+		file->mtime = inode.mtime;
+		file->fragment = inode.fragment;
+		file->offset = inode.offset;
+		inodep += sizeof(inode);
+	} else {
+		struct squashfs_lreg_inode_header inode;
+
+		SQUASHFS_SWAP_LREG_INODE_HEADER(&inode, inodep);
+		file->file_size = inode.file_size;
+		file->start = inode.start_block;
+		file->mtime = inode.mtime;
+		file->fragment = inode.fragment;
+		file->offset = inode.offset;
+		inodep += sizeof(inode);
+	}
+
+	file->blocks = file->fragment == SQUASHFS_INVALID_FRAG ?
+		(file->file_size + base_sBlk.block_size - 1) >>
+		base_sBlk.block_log : file->file_size >> base_sBlk.block_log;
+	file->block_list = arena_alloc(&base_arena, file->blocks *
+		sizeof(unsigned int));
+	file->pathname = arena_strdup(&base_arena, pathname);
+	if(file->block_list == NULL || file->pathname == NULL)
+		return FALSE;
+	SQUASHFS_SWAP_INTS(file->block_list, inodep, file->blocks);
+
+	hash = base_hash(pathname);
+	file->next = base_table[hash];
+	base_table[hash] = file;
+
+	return TRUE;
+}
+
+
+static int scan_base_dir(char *pathname, unsigned int start_block,
+	unsigned int offset, int size)
+{
+	struct squashfs_dir_header dirh;
+	char buffer[sizeof(struct squashfs_dir_entry) + SQUASHFS_NAME_LEN + 1]
+		__attribute__ ((aligned));
+	struct squashfs_dir_entry *dire = (struct squashfs_dir_entry *) buffer;
+	unsigned char *directory;
+	long long start = base_sBlk.directory_table_start + start_block;
+	int bytes = 0, byte, dir_count, res = FALSE;
+
+	size += offset;
+	directory = malloc((size + SQUASHFS_METADATA_SIZE * 2 - 1) &
+		~(SQUASHFS_METADATA_SIZE - 1));
+	if(directory == NULL) {
+		ERROR("Out of memory reading base directory\n");
+		return FALSE;
+	}
+
+	while(bytes < size) {
+		byte = read_base_block(start, &start, directory + bytes);
+		if(byte == 0) {
+			ERROR("Failed to read base directory %s\n", pathname);
+			goto failed;
+		}
+		bytes += byte;
+	}
+
+	for(bytes = offset; bytes < size;) {
+		SQUASHFS_SWAP_DIR_HEADER(&dirh, directory + bytes);
+		dir_count = dirh.count + 1;
+		bytes += sizeof(dirh);
+
+		while(dir_count--) {
+			union squashfs_inode_header inode;
+			unsigned char *inodep;
+			char *name;
+
+			SQUASHFS_SWAP_DIR_ENTRY(dire, directory + bytes);
+			bytes += sizeof(*dire);
+			memcpy(dire->name, directory + bytes, dire->size + 1);
+			dire->name[dire->size + 1] = '\0';
+			bytes += dire->size + 1;
+
+			inodep = base_inode(dirh.start_block, dire->offset);
+			if(inodep == NULL) {
+				ERROR("Base image inode for %s/%s not found\n",
+					pathname, dire->name);
+				goto failed;
+			}
+
+			name = malloc(strlen(pathname) + dire->size + 3);
+			if(name == NULL) {
+				ERROR("Out of memory reading base directory\n");
+				goto failed;
+			}
+			if(*pathname)
+				sprintf(name, "%s/%s", pathname, dire->name);
+			else
+				strcpy(name, dire->name);
+
+			SQUASHFS_SWAP_BASE_INODE_HEADER(&inode.base, inodep);
+			switch(inode.base.inode_type) {
+			case SQUASHFS_FILE_TYPE:
+			case SQUASHFS_LREG_TYPE:
+				byte = add_base_file(name, inodep);
+				if(byte == FALSE)
+					ERROR("Out of memory reading base "
+						"directory\n");
+				break;
+			case SQUASHFS_DIR_TYPE:
+				SQUASHFS_SWAP_DIR_INODE_HEADER(&inode.dir,
+					inodep);
+				byte = scan_base_dir(name, inode.dir.start_block,
+					inode.dir.offset, inode.dir.file_size -
+					3);
+				break;
+			case SQUASHFS_LDIR_TYPE:
+				SQUASHFS_SWAP_LDIR_INODE_HEADER(&inode.ldir,
+					inodep);
+				byte = scan_base_dir(name,
+					inode.ldir.start_block,
+					inode.ldir.offset,
+					inode.ldir.file_size - 3);
+				break;
+			default:
+				byte = TRUE;
+			}
+
+			free(name);
+			if(byte == FALSE)
+				goto failed;
+		}
+	}
+
+	res = TRUE;
+
+failed:
+	free(directory);
+	return res;
+}
+
+
+/*
+ * Open the base image and index its regular files.  Its data blocks are
+ * copied as they are, so it must use the same compressor and block size
+ * as the filesystem being created
+ */
+int read_base(char *source, struct compressor *comp, int block_size)
+{
+	union squashfs_inode_header inode;
+	unsigned char *inodep;
+
+	base_fd = open(source, O_RDONLY);
+	if(base_fd == -1) {
+		ERROR("Could not open base image %s because %s\n", source,
+			strerror(errno));
+		return FALSE;
+	}
+
+	if(read_fs_bytes(base_fd, SQUASHFS_START, sizeof(base_sBlk),
+			&base_sBlk) == 0)
+		goto failed;
+
+	SQUASHFS_INSWAP_SUPER_BLOCK(&base_sBlk);
+
+	if(base_sBlk.s_magic != SQUASHFS_MAGIC || base_sBlk.s_major !=
+			SQUASHFS_MAJOR || base_sBlk.s_minor > SQUASHFS_MINOR) {
+		ERROR("Base image %s is not a SQUASHFS %d.%d filesystem\n",
+			source, SQUASHFS_MAJOR, SQUASHFS_MINOR);
+		goto failed;
+	}
+
+	if(base_sBlk.compression != comp->id) {
+		ERROR("Base image %s uses %s compression, not %s\n", source,
+			lookup_compressor_id(base_sBlk.compression)->name,
+			comp->name);
+		goto failed;
+	}
+
+	if(base_sBlk.block_size != block_size) {
+		ERROR("Base image %s has block size %d, not %d\n", source,
+			base_sBlk.block_size, block_size);
+		goto failed;
+	}
+
+	base_comp = comp;
+
+	if(read_inode_table() == FALSE || read_fragment_index() == FALSE)
+		goto failed;
+
+	inodep = base_inode(SQUASHFS_INODE_BLK(base_sBlk.root_inode),
+		SQUASHFS_INODE_OFFSET(base_sBlk.root_inode));
+	if(inodep == NULL) {
+		ERROR("Base image %s root inode not found\n", source);
+		goto failed;
+	}
+
+	SQUASHFS_SWAP_BASE_INODE_HEADER(&inode.base, inodep);
+	if(inode.base.inode_type == SQUASHFS_DIR_TYPE) {
+		SQUASHFS_SWAP_DIR_INODE_HEADER(&inode.dir, inodep);
+		if(scan_base_dir("", inode.dir.start_block, inode.dir.offset,
+				inode.dir.file_size - 3) == FALSE)
+			goto failed;
+	} else {
+		SQUASHFS_SWAP_LDIR_INODE_HEADER(&inode.ldir, inodep);
+		if(scan_base_dir("", inode.ldir.start_block,
+				inode.ldir.offset, inode.ldir.file_size - 3) ==
+				FALSE)
+			goto failed;
+	}
+
+	/* the inodes have been indexed, only the files are needed now */
+	free(inode_table);
+	free(inode_index);
+
+	return TRUE;
+
+failed:
+	ERROR("Failed to read base image %s\n", source);
+	close(base_fd);
+	return FALSE;
+}
+
+
+struct base_file *lookup_base(char *pathname)
+{
+	struct base_file *file = base_table[base_hash(pathname)];
+
+	for(; file; file = file->next)
+		if(strcmp(file->pathname, pathname) == 0)
+			break;
+
+	return file;
+}
+
+
+int read_base_bytes(long long start, int bytes, void *buffer)
+{
+	return read_fs_bytes(base_fd, start, bytes, buffer);
+}
+
+
+/*
+ * Copy the file's tail out of its base image fragment block into buffer,
+ * returning its size, or 0 if the fragment can't be read.  Only called
+ * by the reader thread, which reads files in order, so consecutive tails
+ * are usually in the same (cached) fragment block
+ */
+int read_base_fragment(struct base_file *file, void *buffer)
+{
+	struct base_fragment *entry = lookup_base_fragment(file->fragment);
+	int size = file->file_size & (base_sBlk.block_size - 1);
+
+	if(entry == NULL)
+		return 0;
+
+	if(fragment_cached != file->fragment) {
+		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size);
+		int error, res;
+
+		fragment_cached = SQUASHFS_INVALID_FRAG;
+		if(SQUASHFS_COMPRESSED_BLOCK(entry->size)) {
+			char *data = malloc(c_byte);
+
+			if(data == NULL)
+				return 0;
+			res = read_fs_bytes(base_fd, entry->start_block, c_byte,
+				data) ? compressor_uncompress(base_comp,
+				fragment_data, data, c_byte,
+				base_sBlk.block_size, &error) : -1;
+			free(data);
+		} else
+			res = read_fs_bytes(base_fd, entry->start_block,
+				c_byte, fragment_data) ? c_byte : -1;
+
+		if(res == -1)
+			return 0;
+		fragment_cached = file->fragment;
+		fragment_size = res;
+	}
+
+	if(file->offset + size > fragment_size)
+		return 0;
+
+	memcpy(buffer, fragment_data + file->offset, size);
+
+	return size;
+}
+
+
+struct base_fragment *lookup_base_fragment(unsigned int fragment)
+{
+	if(fragment >= base_sBlk.fragments)
+		return NULL;
+
+	return &base_fragment_table[fragment];
+}
+
+
+static int compare_extent(const void *a, const void *b)
+{
+	const struct base_extent *e1 = a, *e2 = b;
+
+	return e1->start < e2->start ? -1 : e1->start > e2->start;
+}
+
+
+static int compare_frag_file(const void *a, const void *b)
+{
+	struct base_file *f1 = *(struct base_file **) a;
+	struct base_file *f2 = *(struct base_file **) b;
+
+	if(f1->fragment != f2->fragment)
+		return f1->fragment < f2->fragment ? -1 : 1;
+	return f1->offset < f2->offset ? -1 : f1->offset > f2->offset;
+}
+
+
+static int index_base_extents()
+{
+	struct base_file *file;
+	int i, files = 0;
+
+	for(i = 0; i < BASE_HASH_SIZE; i++)
+		for(file = base_table[i]; file; file = file->next)
+			files ++;
+
+	base_extent = malloc((files + 1) * sizeof(struct base_extent));
+	frag_extent = malloc((base_sBlk.fragments + 1) *
+		sizeof(struct base_extent));
+	frag_files = malloc((files + 1) * sizeof(struct base_file *));
+	if(base_extent == NULL || frag_extent == NULL || frag_files == NULL) {
+		ERROR("Out of memory indexing base image\n");
+		return FALSE;
+	}
+
+	for(i = 0; i < BASE_HASH_SIZE; i++)
+		for(file = base_table[i]; file; file = file->next) {
+			long long end = file->start;
+			int block;
+
+			for(block = 0; block < file->blocks; block++)
+				end += SQUASHFS_COMPRESSED_SIZE_BLOCK(
+					file->block_list[block]);
+			if(end > file->start) {
+				base_extent[base_extents].start = file->start;
+				base_extent[base_extents].end = end;
+				base_extent[base_extents++].file = file;
+			}
+			if(lookup_base_fragment(file->fragment))
+				frag_files[base_frag_files++] = file;
+		}
+
+	for(i = 0; i < base_sBlk.fragments; i++) {
+		frag_extent[i].start = base_fragment_table[i].start_block;
+		frag_extent[i].end = base_fragment_table[i].start_block +
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(
+			base_fragment_table[i].size);
+		frag_extent[i].fragment = i;
+	}
+	frag_extents = base_sBlk.fragments;
+
+	qsort(base_extent, base_extents, sizeof(struct base_extent),
+		compare_extent);
+	qsort(frag_extent, frag_extents, sizeof(struct base_extent),
+		compare_extent);
+	qsort(frag_files, base_frag_files, sizeof(struct base_file *),
+		compare_frag_file);
+
+	return TRUE;
+}
+
+
+/*
+ * Index of the first extent overlapping start, extents only overlap when
+ * files share blocks, and then they start together
+ */
+static int first_extent(struct base_extent *extent, int extents,
+	long long start)
+{
+	int low = 0, high = extents;
+
+	while(low < high) {
+		int mid = (low + high) / 2;
+
+		if(extent[mid].start < start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	while(low && extent[low - 1].end > start)
+		low --;
+
+	return low;
+}
+
+
+/*
+ * Call fn for each file whose data is in the length bytes of the base
+ * image at start, and each file with its tail in a fragment block there.
+ * Turns a trace of what was read from the image into the files being read
+ */
+int base_files_at(long long start, long long length,
+	void (*fn)(struct base_file *, void *), void *arg)
+{
+	long long end = start + length;
+	int i, j;
+
+	if(base_extent == NULL && index_base_extents() == FALSE)
+		return FALSE;
+
+	for(i = first_extent(base_extent, base_extents, start); i <
+			base_extents && base_extent[i].start < end; i++)
+		if(base_extent[i].end > start)
+			fn(base_extent[i].file, arg);
+
+	for(i = first_extent(frag_extent, frag_extents, start); i <
+			frag_extents && frag_extent[i].start < end; i++) {
+		unsigned int fragment = frag_extent[i].fragment;
+		int low = 0, high = base_frag_files;
+
+		if(frag_extent[i].end <= start)
+			continue;
+
+		while(low < high) {
+			int mid = (low + high) / 2;
+
+			if(frag_files[mid]->fragment < fragment)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		for(j = low; j < base_frag_files && frag_files[j]->fragment ==
+				fragment; j++)
+			fn(frag_files[j], arg);
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,63 @@
+#ifndef BASE_FS_H
+#define BASE_FS_H
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * base_fs.h
+ */
+
+#define BASE_HASH_SIZE		65536
+
+/*
+ * A regular file in the -base image, looked up by its pathname relative
+ * to the root of the image
+ */
+struct base_file {
+	char			*pathname;
+	long long		file_size;
+	long long		start;
+	unsigned int		mtime;
+	unsigned int		fragment;
+	unsigned int		offset;
+	int			blocks;
+	unsigned int		*block_list;
+	struct base_file	*next;
+};
+
+/*
+ * A fragment block in the -base image.  copy is set (to the index + 1 of
+ * the copy) once the block has been copied to the filesystem being created
+ */
+struct base_fragment {
+	long long		start_block;
+	unsigned int		size;
+	unsigned int		copy;
+};
+
+struct compressor;
+
+extern int read_base(char *, struct compressor *, int);
+extern struct base_file *lookup_base(char *);
+extern int read_base_bytes(long long, int, void *);
+extern int read_base_fragment(struct base_file *, void *);
+extern struct base_fragment *lookup_base_fragment(unsigned int);
+extern int base_files_at(long long, long long, void (*)(struct base_file *,
+	void *), void *);
+#endif
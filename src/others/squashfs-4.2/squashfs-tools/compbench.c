@@ -0,0 +1,556 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * compbench.c
+ *
+ * Benchmark the compressors mksquashfs and unsquashfs are built with.
+ * The sources are cut into blocks the way mksquashfs cuts files, and
+ * each compressor compresses and decompresses them at each block size
+ * and thread count, reporting the ratio, MB/s and scaling.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "squashfs_fs.h"
+#include "compressor.h"
+#include "cpus.h"
+
+#define ERROR(s, args...)	fprintf(stderr, s, ## args)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ## args);\
+			exit(1);\
+		} while(0)
+
+#define TRUE		1
+#define FALSE		0
+
+#define MAX_COMPS		8
+#define MAX_BLOCK_SIZES		16
+#define DEFAULT_MBYTES		64
+
+struct source_file {
+	char *data;
+	int size;
+};
+
+struct block {
+	char *data;
+	int size;
+	char *comp;
+	int c_byte;
+};
+
+struct bench {
+	struct compressor *comp;
+	struct compressor *uncomp;
+	struct block *block;
+	int blocks;
+	int block_size;
+	int threads;
+};
+
+struct bench_thread {
+	pthread_t thread;
+	struct bench *bench;
+	int first;
+	int failed;
+	char *buffer;
+};
+
+struct bench_comp {
+	char *name;
+	struct compressor *comp;
+	struct compressor *uncomp;
+	char **options;
+	int option_args;
+};
+
+extern struct compressor *compressor[];
+
+struct source_file *source_file = NULL;
+int source_files = 0;
+long long source_bytes = 0, source_max;
+
+
+void read_source(char *pathname)
+{
+	struct stat buf;
+	struct dirent *d;
+	DIR *dir;
+
+	if(source_bytes == source_max || lstat(pathname, &buf) == -1)
+		return;
+
+	if(S_ISREG(buf.st_mode) && buf.st_size) {
+		struct source_file *file;
+		int fd, size = buf.st_size > source_max - source_bytes ?
+			source_max - source_bytes : buf.st_size;
+
+		fd = open(pathname, O_RDONLY);
+		if(fd == -1) {
+			ERROR("compbench: can't open %s because %s\n", pathname,
+				strerror(errno));
+			return;
+		}
+
+		if((source_files & 255) == 0) {
+			source_file = realloc(source_file, (source_files + 256) *
+				sizeof(struct source_file));
+			if(source_file == NULL)
+				BAD_ERROR("Out of memory in read_source\n");
+		}
+
+		file = &source_file[source_files];
+		file->data = malloc(size);
+		if(file->data == NULL)
+			BAD_ERROR("Out of memory in read_source\n");
+
+		for(file->size = 0; file->size < size; ) {
+			int res = read(fd, file->data + file->size, size -
+				file->size);
+
+			if(res == -1 && errno == EINTR)
+				continue;
+			if(res < 1)
+				break;
+			file->size += res;
+		}
+		close(fd);
+
+		if(file->size) {
+			source_bytes += file->size;
+			source_files++;
+		} else
+			free(file->data);
+		return;
+	}
+
+	if(!S_ISDIR(buf.st_mode) || (dir = opendir(pathname)) == NULL)
+		return;
+
+	while((d = readdir(dir)) != NULL) {
+		char *subpath;
+
+		if(strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+			continue;
+
+		subpath = malloc(strlen(pathname) + strlen(d->d_name) + 2);
+		if(subpath == NULL)
+			BAD_ERROR("Out of memory in read_source\n");
+		sprintf(subpath, "%s/%s", pathname, d->d_name);
+		read_source(subpath);
+		free(subpath);
+	}
+
+	closedir(dir);
+}
+
+
+void *compress_thread(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct bench *b = t->bench;
+	void *stream = NULL;
+	int i;
+
+	if(compressor_init(b->comp, &stream, b->block_size, 1)) {
+		ERROR("compbench: %s compressor_init failed\n", b->comp->name);
+		t->failed = TRUE;
+		return NULL;
+	}
+
+	for(i = t->first; i < b->blocks; i += b->threads) {
+		struct block *block = &b->block[i];
+		int error, c_byte = compressor_compress(b->comp, stream,
+			block->comp, block->data, block->size, b->block_size,
+			&error);
+
+		if(c_byte == -1) {
+			ERROR("compbench: %s compress failed with error code "
+				"%d\n", b->comp->name, error);
+			t->failed = TRUE;
+			break;
+		}
+
+		/* as mksquashfs, blocks that don't shrink are stored */
+		block->c_byte = c_byte >= block->size ? 0 : c_byte;
+	}
+
+	return NULL;
+}
+
+
+void *uncompress_thread(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct bench *b = t->bench;
+	void *stream = compressor_uncompress_init(b->uncomp, b->block_size);
+	int i;
+
+	for(i = t->first; i < b->blocks; i += b->threads) {
+		struct block *block = &b->block[i];
+		int error, res;
+
+		if(block->c_byte == 0)
+			continue;
+
+		res = compressor_uncompress_stream(b->uncomp, stream, t->buffer,
+			block->comp, block->c_byte, b->block_size, &error);
+		if(res != block->size || memcmp(t->buffer, block->data, res)) {
+			ERROR("compbench: %s decompressed block %d wrongly\n",
+				b->uncomp->name, i);
+			t->failed = TRUE;
+			break;
+		}
+	}
+
+	compressor_uncompress_free(b->uncomp, stream);
+	return NULL;
+}
+
+
+/* run the threads over the blocks, returning the seconds taken */
+double run(struct bench *b, struct bench_thread *thread,
+	void *(*fn)(void *))
+{
+	struct timeval start, end;
+	int i, failed = FALSE;
+
+	gettimeofday(&start, NULL);
+
+	for(i = 0; i < b->threads; i++) {
+		thread[i].bench = b;
+		thread[i].first = i;
+		thread[i].failed = FALSE;
+		if(pthread_create(&thread[i].thread, NULL, fn, &thread[i]) != 0)
+			BAD_ERROR("Failed to create thread\n");
+	}
+
+	for(i = 0; i < b->threads; i++) {
+		pthread_join(thread[i].thread, NULL);
+		failed |= thread[i].failed;
+	}
+
+	gettimeofday(&end, NULL);
+
+	if(failed)
+		return -1;
+
+	return end.tv_sec - start.tv_sec + (end.tv_usec - start.tv_usec) /
+		1000000.0;
+}
+
+
+/*
+ * Benchmark one compressor at one block size, for 1, 2, 4 ... threads up
+ * to processors.  Run in a child, as the lzma and xz options are shared
+ * and compressor_options_post() fixes them for the one block size.
+ * Returns 2 for bad options, 1 if the benchmark failed
+ */
+int bench(struct bench_comp *bc, int block_size, int processors)
+{
+	struct bench b;
+	struct bench_thread *thread;
+	double comp_secs, uncomp_secs, comp_one = 0, uncomp_one = 0;
+	long long bytes = 0;
+	char *comp_data;
+	int i, threads;
+
+	for(i = 0; i < bc->option_args; i++) {
+		int args = compressor_options(bc->comp, bc->options + i,
+			bc->option_args - i);
+
+		if(args < 0) {
+			if(args == -1)
+				ERROR("compbench: unrecognised %s option %s\n",
+					bc->name, bc->options[i]);
+			return 2;
+		}
+		i += args;
+	}
+
+	if(compressor_options_post(bc->comp, block_size))
+		return 2;
+
+	b.comp = bc->comp;
+	b.uncomp = bc->uncomp;
+	b.block_size = block_size;
+
+	for(b.blocks = 0, i = 0; i < source_files; i++)
+		b.blocks += (source_file[i].size + block_size - 1) / block_size;
+
+	b.block = malloc(b.blocks * sizeof(struct block));
+	comp_data = malloc((long long) b.blocks * block_size);
+	thread = malloc(processors * sizeof(struct bench_thread));
+	if(b.block == NULL || comp_data == NULL || thread == NULL)
+		BAD_ERROR("Out of memory in bench\n");
+
+	for(b.blocks = 0, i = 0; i < source_files; i++) {
+		int offset;
+
+		for(offset = 0; offset < source_file[i].size; offset +=
+				block_size, b.blocks++) {
+			struct block *block = &b.block[b.blocks];
+
+			block->data = source_file[i].data + offset;
+			block->size = source_file[i].size - offset > block_size ?
+				block_size : source_file[i].size - offset;
+			block->comp = comp_data + (long long) b.blocks *
+				block_size;
+		}
+	}
+
+	for(i = 0; i < processors; i++) {
+		thread[i].buffer = malloc(block_size);
+		if(thread[i].buffer == NULL)
+			BAD_ERROR("Out of memory in bench\n");
+	}
+
+	for(threads = 1; ; threads = threads * 2 > processors ? processors :
+			threads * 2) {
+		b.threads = threads;
+
+		comp_secs = run(&b, thread, compress_thread);
+		if(comp_secs < 0)
+			return 1;
+		uncomp_secs = run(&b, thread, uncompress_thread);
+		if(uncomp_secs < 0)
+			return 1;
+
+		if(threads == 1) {
+			for(i = 0; i < b.blocks; i++)
+				bytes += b.block[i].c_byte ? b.block[i].c_byte :
+					b.block[i].size;
+			comp_one = comp_secs;
+			uncomp_one = uncomp_secs;
+		}
+
+		printf("%-8s %7d %7d %7.2f%% %10.2f %10.2f %7.2f %7.2f\n",
+			bc->name, block_size, threads, bytes * 100.0 /
+			source_bytes, source_bytes / comp_secs / 1048576,
+			source_bytes / uncomp_secs / 1048576, comp_one /
+			comp_secs, uncomp_one / uncomp_secs);
+		fflush(stdout);
+
+		if(threads == processors)
+			break;
+	}
+
+	return 0;
+}
+
+
+int compbench_option(char *arg)
+{
+	return strcmp(arg, "-comp") == 0 || strcmp(arg, "-b") == 0 ||
+		strcmp(arg, "-processors") == 0 || strcmp(arg, "-max") == 0 ||
+		strncmp(arg, "-X", 2) == 0;
+}
+
+
+void usage(char *name)
+{
+	int i;
+
+	ERROR("SYNTAX: %s source1 source2 ... [options]\n\n", name);
+	ERROR("Compresses and decompresses the files under the sources as "
+		"mksquashfs data\nblocks, and reports the compressed size, "
+		"MB/s of input, and the speedup\nover one thread.\n\n");
+	ERROR("Options are\n");
+	ERROR("-comp <comp>\t\tbenchmark <comp>, can be given more than once."
+		"\n\t\t\tDefault all the compressors below, sqlzma decompresses"
+		"\n\t\t\tthe lzma blocks as unsquashfs does sqlzma images,\n\t\t\twhich needs the default -Xlc, -Xlp and -Xpb\n");
+	ERROR("-X<option>\t\tcompressor option for the -comp before it, as "
+		"in mksquashfs\n");
+	ERROR("-b <block_size>\t\tblock size to benchmark, can be given more "
+		"than once.\n\t\t\tDefault %d bytes\n", SQUASHFS_FILE_SIZE);
+	ERROR("-processors <number>\tthe most threads to use.  Default number "
+		"of processors\n");
+	ERROR("-max <Mbytes>\t\tread at most <Mbytes> of the sources.  Default "
+		"%d\n", DEFAULT_MBYTES);
+	ERROR("\nCompressors available:\n");
+	for(i = 0; compressor[i]->id; i++)
+		if(compressor[i]->supported && compressor[i]->compress)
+			ERROR("\t%s\n", compressor[i]->name);
+	if(lookup_compressor("lzma")->supported)
+		ERROR("\tsqlzma\n");
+	exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct bench_comp comp[MAX_COMPS];
+	int block_size[MAX_BLOCK_SIZES];
+	int i, j, comps = 0, block_sizes = 0, processors = -1, failed = FALSE;
+	int mbytes = DEFAULT_MBYTES, source = 0;
+	char **source_path = argv + 1;
+
+	for(source = 0; source + 1 < argc && argv[source + 1][0] != '-';
+			source++);
+
+	for(i = source + 1; i < argc; i++) {
+		if(strcmp(argv[i], "-comp") == 0) {
+			struct compressor *c;
+
+			if(++i == argc) {
+				ERROR("%s: -comp missing compression type\n",
+					argv[0]);
+				exit(1);
+			}
+			if(comps == MAX_COMPS) {
+				ERROR("%s: too many -comp\n", argv[0]);
+				exit(1);
+			}
+
+			c = lookup_compressor(strcmp(argv[i], "sqlzma") == 0 ?
+				"lzma" : argv[i]);
+			if(!c->supported || c->compress == NULL) {
+				ERROR("%s: Compressor \"%s\" is not supported!\n",
+					argv[0], argv[i]);
+				usage(argv[0]);
+			}
+			comp[comps].name = argv[i];
+			comp[comps].comp = c;
+			comp[comps].uncomp = strcmp(argv[i], "sqlzma") == 0 ?
+				&sqlzma_comp_ops : c;
+			comp[comps].options = argv + i + 1;
+			comp[comps++].option_args = 0;
+		} else if(strncmp(argv[i], "-X", 2) == 0) {
+			/*
+			 * parsed in the child, here only skip to the next of
+			 * our options
+			 */
+			if(comps == 0 || comp[comps - 1].options + comp[comps -
+					1].option_args != argv + i) {
+				ERROR("%s: %s must follow the -comp it is for\n",
+					argv[0], argv[i]);
+				exit(1);
+			}
+
+			for(; i + 1 < argc && !compbench_option(argv[i + 1]); i++)
+				comp[comps - 1].option_args++;
+			comp[comps - 1].option_args++;
+		} else if(strcmp(argv[i], "-b") == 0) {
+			char *b;
+			int size;
+
+			if(++i == argc) {
+				ERROR("%s: -b missing block size\n", argv[0]);
+				exit(1);
+			}
+			size = strtol(argv[i], &b, 10);
+			if(*b == 'm' || *b == 'M')
+				size *= 1048576;
+			else if(*b == 'k' || *b == 'K')
+				size *= 1024;
+			else if(*b != '\0') {
+				ERROR("%s: -b invalid block size\n", argv[0]);
+				exit(1);
+			}
+			if(size < 4096 || size > SQUASHFS_FILE_MAX_SIZE ||
+					(size & (size - 1))) {
+				ERROR("%s: -b block size not power of two or "
+					"not between 4096 and 1Mbyte\n",
+					argv[0]);
+				exit(1);
+			}
+			if(block_sizes == MAX_BLOCK_SIZES) {
+				ERROR("%s: too many -b\n", argv[0]);
+				exit(1);
+			}
+			block_size[block_sizes++] = size;
+		} else if(strcmp(argv[i], "-processors") == 0) {
+			if((++i == argc) || (processors = atoi(argv[i])) < 1) {
+				ERROR("%s: -processors missing or invalid "
+					"processor number\n", argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-max") == 0) {
+			if((++i == argc) || (mbytes = atoi(argv[i])) < 1) {
+				ERROR("%s: -max missing or invalid size\n",
+					argv[0]);
+				exit(1);
+			}
+		} else
+			usage(argv[0]);
+	}
+
+	if(source == 0)
+		usage(argv[0]);
+
+	if(comps == 0)
+		for(i = 0; compressor[i]->id; i++)
+			if(compressor[i]->supported && compressor[i]->compress) {
+				comp[comps].name = compressor[i]->name;
+				comp[comps].comp = compressor[i];
+				comp[comps].uncomp = compressor[i];
+				comp[comps++].option_args = 0;
+			}
+
+	if(block_sizes == 0)
+		block_size[block_sizes++] = SQUASHFS_FILE_SIZE;
+
+	if(processors == -1)
+		processors = available_processors();
+	if(processors < 1)
+		processors = 1;
+
+	source_max = (long long) mbytes * 1048576;
+	for(i = 0; i < source; i++)
+		read_source(source_path[i]);
+	if(source_bytes == 0)
+		BAD_ERROR("No data in the sources\n");
+
+	printf("%lld bytes in %d files\n\n", source_bytes, source_files);
+	printf("%-8s %7s %7s %8s %10s %10s %7s %7s\n", "comp", "block",
+		"threads", "size", "comp MB/s", "dec MB/s", "comp x", "dec x");
+	fflush(stdout);
+
+	for(i = 0; i < comps; i++)
+		for(j = 0; j < block_sizes; j++) {
+			int status;
+			pid_t pid = fork();
+
+			if(pid == -1)
+				BAD_ERROR("fork failed because %s\n",
+					strerror(errno));
+			if(pid == 0)
+				exit(bench(&comp[i], block_size[j], processors));
+
+			if(waitpid(pid, &status, 0) == -1 ||
+					!WIFEXITED(status) || WEXITSTATUS(status))
+				failed = TRUE;
+			if(WIFEXITED(status) && WEXITSTATUS(status) == 2)
+				break;
+		}
+
+	return failed;
+}
@@ -26,8 +26,10 @@
 #include "squashfs_fs.h"
 
 #ifndef GZIP_SUPPORT
-static struct compressor gzip_comp_ops =  {
-	NULL, NULL, NULL, NULL, NULL, NULL, ZLIB_COMPRESSION, "gzip", 0
+static struct compressor gzip_comp_ops = {
+	.id = ZLIB_COMPRESSION,
+	.name = "gzip",
+	.supported = 0
 };
 #else
 extern struct compressor gzip_comp_ops;
@@ -35,8 +37,9 @@ extern struct compressor gzip_comp_ops;
 
 #ifndef LZMA_SUPPORT
 static struct compressor lzma_comp_ops = {
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, LZMA_COMPRESSION,
-	"lzma", 0
+	.id = LZMA_COMPRESSION,
+	.name = "lzma",
+	.supported = 0
 };
 #else
 extern struct compressor lzma_comp_ops;
@@ -44,8 +47,9 @@ extern struct compressor lzma_comp_ops;
 
 #ifndef LZO_SUPPORT
 static struct compressor lzo_comp_ops = {
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, LZO_COMPRESSION, "lzo",
-	0
+	.id = LZO_COMPRESSION,
+	.name = "lzo",
+	.supported = 0
 };
 #else
 extern struct compressor lzo_comp_ops;
@@ -53,7 +57,9 @@ extern struct compressor lzo_comp_ops;
 
 #ifndef XZ_SUPPORT
 static struct compressor xz_comp_ops = {
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, XZ_COMPRESSION, "xz", 0
+	.id = XZ_COMPRESSION,
+	.name = "xz",
+	.supported = 0
 };
 #else
 extern struct compressor xz_comp_ops;
@@ -61,7 +67,9 @@ extern struct compressor xz_comp_ops;
 
 
 static struct compressor unknown_comp_ops = {
-	NULL, NULL, NULL , NULL, NULL, NULL, NULL, NULL, 0, "unknown", 0
+	.id = 0,
+	.name = "unknown",
+	.supported = 0
 };
 
 
@@ -24,8 +24,21 @@ struct compressor {
 	int (*init)(void **, int, int);
 	int (*compress)(void *, void *, void *, int, int, int *);
 	int (*uncompress)(void *, void *, int, int, int *);
+	/*
+	 * optional reusable decompression context, so threads decompressing
+	 * many blocks don't set up and tear down the decoder every block
+	 */
+	void *(*uncompress_init)(int);
+	int (*uncompress_stream)(void *, void *, void *, int, int, int *);
+	void (*uncompress_free)(void *);
 	int (*options)(char **, int);
 	int (*options_post)(int);
+	/*
+	 * optional tuning of the options on data blocks sampled from the
+	 * sources, tune_blocks returns how many blocks to sample, 0 for none
+	 */
+	int (*tune_blocks)(int);
+	int (*tune)(void *, int *, int, int, int);
 	void *(*dump_options)(int, int *);
 	int (*extract_options)(int, void *, int);
 	void (*usage)();
@@ -39,6 +52,11 @@ extern struct compressor *lookup_compressor_id(int);
 extern void display_compressors(char *, char *);
 extern void display_compressor_usage(char *);
 
+/* unsquashfs only, for the LZMA/zlib blocks of sqlzma 2.x and 3.x images */
+extern struct compressor sqlzma_comp_ops;
+/* unsquashfs only, for the size-less LZMA blocks of the Broadcom 2.x images */
+extern struct compressor lzma_nosize_comp_ops;
+
 static inline int compressor_init(struct compressor *comp, void **stream,
 	int block_size, int datablock)
 {
@@ -62,6 +80,38 @@ static inline int compressor_uncompress(struct compressor *comp, void *dest,
 }
 
 
+/*
+ * Returns NULL if the compressor has no decompression context (or it
+ * cannot be allocated), compressor_uncompress_stream() then falls back
+ * to compressor_uncompress()
+ */
+static inline void *compressor_uncompress_init(struct compressor *comp,
+	int block_size)
+{
+	if(comp->uncompress_init == NULL)
+		return NULL;
+	return comp->uncompress_init(block_size);
+}
+
+
+static inline int compressor_uncompress_stream(struct compressor *comp,
+	void *strm, void *dest, void *src, int size, int block_size, int *error)
+{
+	if(strm == NULL)
+		return comp->uncompress(dest, src, size, block_size, error);
+	return comp->uncompress_stream(strm, dest, src, size, block_size,
+		error);
+}
+
+
+static inline void compressor_uncompress_free(struct compressor *comp,
+	void *strm)
+{
+	if(strm)
+		comp->uncompress_free(strm);
+}
+
+
 static inline int compressor_options(struct compressor *comp, char *argv[],
 	int argc)
 {
@@ -80,6 +130,22 @@ static inline int compressor_options_post(struct compressor *comp, int block_siz
 }
 
 
+static inline int compressor_tune_blocks(struct compressor *comp,
+	int block_size)
+{
+	if(comp->tune_blocks == NULL)
+		return 0;
+	return comp->tune_blocks(block_size);
+}
+
+
+static inline int compressor_tune(struct compressor *comp, void *samples,
+	int *sizes, int count, int block_size, int threads)
+{
+	return comp->tune(samples, sizes, count, block_size, threads);
+}
+
+
 static inline void *compressor_dump_options(struct compressor *comp,
 	int block_size, int *size)
 {
@@ -0,0 +1,110 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * contenthash.c
+ */
+
+#include <string.h>
+
+#include "contenthash.h"
+
+/*
+ * 128 bit content hash (MurmurHash3 x64_128), which mksquashfs uses to find
+ * duplicate file candidates without checksumming every same sized file, and
+ * unsquashfs -verify-hash reports.  It isn't collision resistant, so a match
+ * is always confirmed by comparing the data.  Files are hashed a block at a
+ * time, only the final block of a file can have a partial 16 byte tail, so
+ * identical files always hash identically
+ */
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+#define HASH_C1 0x87c37b91114253d5ULL
+#define HASH_C2 0x4cf5ad432745937fULL
+
+static unsigned long long hash_fmix(unsigned long long k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
+
+
+void content_hash_block(unsigned long long *hash, char *buff, int bytes)
+{
+	unsigned long long h1 = hash[0], h2 = hash[1], k1, k2;
+	unsigned char *tail;
+	int i;
+
+	for(i = 0; i + 16 <= bytes; i += 16) {
+		memcpy(&k1, buff + i, 8);
+		memcpy(&k2, buff + i + 8, 8);
+
+		k1 *= HASH_C1; k1 = ROTL64(k1, 31); k1 *= HASH_C2; h1 ^= k1;
+		h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+		k2 *= HASH_C2; k2 = ROTL64(k2, 33); k2 *= HASH_C1; h2 ^= k2;
+		h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	tail = (unsigned char *) buff + i;
+	k1 = k2 = 0;
+	switch(bytes & 15) {
+		case 15: k2 ^= (unsigned long long) tail[14] << 48;
+		case 14: k2 ^= (unsigned long long) tail[13] << 40;
+		case 13: k2 ^= (unsigned long long) tail[12] << 32;
+		case 12: k2 ^= (unsigned long long) tail[11] << 24;
+		case 11: k2 ^= (unsigned long long) tail[10] << 16;
+		case 10: k2 ^= (unsigned long long) tail[9] << 8;
+		case 9: k2 ^= (unsigned long long) tail[8];
+			k2 *= HASH_C2; k2 = ROTL64(k2, 33); k2 *= HASH_C1;
+			h2 ^= k2;
+		case 8: k1 ^= (unsigned long long) tail[7] << 56;
+		case 7: k1 ^= (unsigned long long) tail[6] << 48;
+		case 6: k1 ^= (unsigned long long) tail[5] << 40;
+		case 5: k1 ^= (unsigned long long) tail[4] << 32;
+		case 4: k1 ^= (unsigned long long) tail[3] << 24;
+		case 3: k1 ^= (unsigned long long) tail[2] << 16;
+		case 2: k1 ^= (unsigned long long) tail[1] << 8;
+		case 1: k1 ^= (unsigned long long) tail[0];
+			k1 *= HASH_C1; k1 = ROTL64(k1, 31); k1 *= HASH_C2;
+			h1 ^= k1;
+	}
+
+	hash[0] = h1;
+	hash[1] = h2;
+}
+
+
+void content_hash_final(unsigned long long *hash, long long length)
+{
+	unsigned long long h1 = hash[0] ^ length, h2 = hash[1] ^ length;
+
+	h1 += h2;
+	h2 += h1;
+	h1 = hash_fmix(h1);
+	h2 = hash_fmix(h2);
+	h1 += h2;
+	h2 += h1;
+
+	hash[0] = h1;
+	hash[1] = h2;
+}
@@ -0,0 +1,32 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+/*
+ * File content hash shared by mksquashfs and unsquashfs.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * contenthash.h
+ */
+
+/*
+ * hash is two unsigned long longs, zeroed to start a file, which each block
+ * of the file in turn is added to, and then the file's length
+ */
+extern void content_hash_block(unsigned long long *hash, char *buff,
+	int bytes);
+extern void content_hash_final(unsigned long long *hash, long long length);
+#endif
@@ -0,0 +1,255 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * cpus.c
+ *
+ * The online processor count is the host's, which in a container, or
+ * under taskset, is more than the process may run on, and a thread per
+ * host processor then only queues up on the CFS quota.  So the count is
+ * capped by the affinity mask, and by the cpu.max (cgroup v2) or
+ * cpu.cfs_quota_us (cgroup v1) quota of each cgroup from the process's
+ * own up to the root, as any of them can be the one that limits it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#ifdef linux
+#include <sched.h>
+#elif !defined(__CYGWIN__)
+#include <sys/sysctl.h>
+#endif
+
+#include "cpus.h"
+
+#ifdef linux
+/* a cgroup directory, the mount point and the cgroup path under it */
+#define CGROUP_PATH	(2 * PATH_MAX)
+
+/* read the first line of a file, returning FALSE if there isn't one */
+static int read_line(char *filename, char *line, int size)
+{
+	FILE *file = fopen(filename, "r");
+	int res;
+
+	if(file == NULL)
+		return 0;
+
+	res = fgets(line, size, file) != NULL;
+	fclose(file);
+	return res;
+}
+
+
+/* processors the quota of one cgroup allows, or INT_MAX for no quota */
+static int cgroup_quota(char *dir, int v2)
+{
+	char filename[CGROUP_PATH + 32], line[64];
+	long long quota, period;
+
+	if(v2) {
+		snprintf(filename, sizeof(filename), "%s/cpu.max", dir);
+		if(!read_line(filename, line, sizeof(line)) ||
+				sscanf(line, "%lld %lld", &quota, &period) != 2)
+			/* "max", or no cpu controller here */
+			return INT_MAX;
+	} else {
+		snprintf(filename, sizeof(filename), "%s/cpu.cfs_quota_us",
+			dir);
+		if(!read_line(filename, line, sizeof(line)) ||
+				sscanf(line, "%lld", &quota) != 1)
+			return INT_MAX;
+
+		snprintf(filename, sizeof(filename), "%s/cpu.cfs_period_us",
+			dir);
+		if(!read_line(filename, line, sizeof(line)) ||
+				sscanf(line, "%lld", &period) != 1)
+			return INT_MAX;
+	}
+
+	if(quota <= 0 || period <= 0)
+		return INT_MAX;
+
+	quota = (quota + period - 1) / period;
+	return quota < INT_MAX ? quota : INT_MAX;
+}
+
+
+/* is name one of the words in the comma separated list? */
+static int in_list(char *list, char *name)
+{
+	int len = strlen(name);
+
+	while(list) {
+		if(strncmp(list, name, len) == 0 && (list[len] == ',' ||
+				list[len] == '\0'))
+			return 1;
+		list = strchr(list, ',');
+		if(list)
+			list ++;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Find where the cgroup hierarchy with the cpu controller is mounted, and
+ * the cgroup it's rooted at, which in a container is usually the
+ * container's own cgroup rather than the real root
+ */
+static int cgroup_mount(int v2, char *root, char *mount)
+{
+	FILE *mountinfo = fopen("/proc/self/mountinfo", "r");
+	char line[4096];
+	int found = 0;
+
+	if(mountinfo == NULL)
+		return 0;
+
+	while(!found && fgets(line, sizeof(line), mountinfo)) {
+		char m_root[PATH_MAX], m_mount[PATH_MAX], fstype[64],
+			options[1024], *sep = strstr(line, " - ");
+
+		if(sep == NULL || sscanf(line, "%*s %*s %*s %4095s %4095s",
+				m_root, m_mount) != 2 || sscanf(sep,
+				" - %63s %*s %1023s", fstype, options) != 2)
+			continue;
+
+		if(v2 ? strcmp(fstype, "cgroup2") == 0 :
+				strcmp(fstype, "cgroup") == 0 &&
+				in_list(options, "cpu")) {
+			strcpy(root, m_root);
+			strcpy(mount, m_mount);
+			found = 1;
+		}
+	}
+
+	fclose(mountinfo);
+	return found;
+}
+
+
+static int cgroup_processors()
+{
+	FILE *cgroup = fopen("/proc/self/cgroup", "r");
+	char line[PATH_MAX + 256], root[PATH_MAX], mount[PATH_MAX],
+		dir[CGROUP_PATH];
+	int processors = INT_MAX;
+
+	if(cgroup == NULL)
+		return INT_MAX;
+
+	while(fgets(line, sizeof(line), cgroup)) {
+		char *controllers = strchr(line, ':'), *path;
+		int v2, len;
+
+		if(controllers == NULL || (path = strchr(++ controllers, ':'))
+				== NULL)
+			continue;
+		*path ++ = '\0';
+		path[strcspn(path, "\n")] = '\0';
+
+		/* "0::/path" is cgroup v2, v1 lists the controllers */
+		v2 = *controllers == '\0';
+		if(!v2 && !in_list(controllers, "cpu"))
+			continue;
+		if(!cgroup_mount(v2, root, mount))
+			continue;
+
+		len = strlen(root);
+		if(strcmp(root, "/") == 0)
+			len = 0;
+		else if(strncmp(path, root, len) || (path[len] != '/' &&
+				path[len] != '\0'))
+			/* the cgroup isn't under the mount, look at it all */
+			path = "";
+		else
+			path += len;
+
+		snprintf(dir, sizeof(dir), "%s%s", mount, path);
+		while(1) {
+			int quota = cgroup_quota(dir, v2);
+			char *slash = strrchr(dir, '/');
+
+			if(quota < processors)
+				processors = quota;
+			if(strlen(dir) <= strlen(mount) || slash == NULL)
+				break;
+			*slash = '\0';
+		}
+	}
+
+	fclose(cgroup);
+	return processors;
+}
+#endif
+
+
+int available_processors()
+{
+	static int processors = 0;
+
+	if(processors)
+		return processors;
+
+#if defined(__CYGWIN__)
+	processors = sysconf(_SC_NPROCESSORS_ONLN);
+#elif !defined(linux)
+	{
+		int mib[2];
+		size_t len = sizeof(processors);
+
+		mib[0] = CTL_HW;
+#ifdef HW_AVAILCPU
+		mib[1] = HW_AVAILCPU;
+#else
+		mib[1] = HW_NCPU;
+#endif
+
+		if(sysctl(mib, 2, &processors, &len, NULL, 0) == -1) {
+			fprintf(stderr, "Failed to get number of available "
+				"processors.  Defaulting to 1\n");
+			processors = 1;
+		}
+	}
+#else
+	{
+		cpu_set_t set;
+		int quota = cgroup_processors();
+
+		processors = sysconf(_SC_NPROCESSORS_ONLN);
+		if(sched_getaffinity(0, sizeof(set), &set) == 0 &&
+				CPU_COUNT(&set) < processors)
+			processors = CPU_COUNT(&set);
+		if(quota < processors)
+			processors = quota;
+	}
+#endif
+
+	if(processors < 1)
+		processors = 1;
+
+	return processors;
+}
@@ -0,0 +1,31 @@
+#ifndef CPUS_H
+#define CPUS_H
+/*
+ * Default thread counts shared by mksquashfs, unsquashfs and compbench.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * cpus.h
+ */
+
+/*
+ * The number of processors the process can actually keep busy, at
+ * least 1.  On Linux that's the online count capped by the affinity
+ * mask and by the CPU quota of the cgroup the process runs in
+ */
+extern int available_processors();
+#endif
@@ -0,0 +1,966 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * estimate.c
+ *
+ * -estimate, the size the filesystem would be, without building it.  The
+ * tree is scanned as it is for a build, files of the same size are hashed
+ * to find the duplicates, and the tails are packed into fragments the way
+ * the writer packs them.  A sample of the data blocks and of the fragments,
+ * spread evenly through the data, is compressed on all the processors and
+ * scaled up to the rest.  The inode, directory and lookup tables are laid
+ * out in full, with the sampled block sizes, and compressed as they would
+ * be written.
+ */
+
+#define TRUE 1
+#define FALSE 0
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "squashfs_fs.h"
+#include "mksquashfs.h"
+#include "compressor.h"
+#include "contenthash.h"
+#include "cpus.h"
+#include "estimate.h"
+
+#define ERROR(s, args...) \
+		do { \
+			fprintf(stderr, s, ## args); \
+		} while(0)
+
+#define EXIT_MKSQUASHFS() \
+		do { \
+			exit(1); \
+		} while(0)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ##args);\
+			EXIT_MKSQUASHFS();\
+		} while(0);
+
+extern int block_size, block_log, processors, nopad;
+extern int no_fragments, always_use_fragments, duplicate_checking;
+extern int sparse_files, noI, noD, noF, exportable;
+extern long long global_uid, global_gid;
+extern unsigned int dir_inode_no, inode_no;
+extern int read_bytes(int, void *, int);
+
+int estimate = FALSE;
+
+struct estimate_file {
+	char			*pathname;
+	struct inode_info	*inode;
+	long long		size;
+	/* the earlier file this one duplicates, or -1 */
+	int			duplicate;
+	int			blocks;
+	int			tail;
+	unsigned int		fragment;
+	unsigned int		offset;
+	unsigned long long	hash[2];
+	/* where the layout put the blocks, start is -1 until then */
+	long long		start;
+	int			seq;
+};
+
+/*
+ * A sampled data block of file, or, if files isn't 0, a fragment holding
+ * the tails of files tail[file] on
+ */
+struct estimate_sample {
+	int			file;
+	int			files;
+	long long		offset;
+	int			bytes;
+	int			c_bytes;
+};
+
+/* a metadata table, laid out uncompressed */
+struct table {
+	char			*data;
+	long long		bytes;
+	long long		size;
+};
+
+static struct compressor *est_comp;
+static struct estimate_file *file;
+static int files, files_size, *file_hash, file_hash_size;
+static int *candidate, candidates;
+static int *tail, tails, *frag_first, fragments;
+static long long data_bytes, data_blocks, tail_bytes;
+static struct estimate_sample *sample;
+static int samples, data_samples, every_block, next_job, duplicates;
+static unsigned int id_table[SQUASHFS_IDS], ids;
+static struct table inode_table, dir_table, export_table;
+
+
+static unsigned int pointer_hash(void *pointer)
+{
+	unsigned long long key = (unsigned long) pointer;
+
+	key *= 0x9e3779b97f4a7c15ULL;
+	return key >> 32;
+}
+
+
+/* the file index of a hard linked inode already seen, or -1 */
+static int lookup_file(struct inode_info *inode)
+{
+	int i, mask = file_hash_size - 1;
+
+	if(file_hash_size == 0)
+		return -1;
+
+	for(i = pointer_hash(inode) & mask; file_hash[i]; i = (i + 1) & mask)
+		if(file[file_hash[i] - 1].inode == inode)
+			return file_hash[i] - 1;
+	return -1;
+}
+
+
+static void hash_file(int index)
+{
+	int i, mask = file_hash_size - 1;
+
+	for(i = pointer_hash(file[index].inode) & mask; file_hash[i];
+			i = (i + 1) & mask);
+	file_hash[i] = index + 1;
+}
+
+
+static void add_file(struct dir_ent *dir_ent)
+{
+	struct inode_info *inode = dir_ent->inode;
+	struct estimate_file *f;
+	int i;
+
+	if(files == files_size) {
+		files_size = files_size ? files_size * 2 : 1024;
+		file = realloc(file, files_size * sizeof(struct estimate_file));
+		if(file == NULL)
+			BAD_ERROR("Out of memory in add_file\n");
+	}
+
+	/* grown at half full */
+	if(files * 2 >= file_hash_size) {
+		free(file_hash);
+		file_hash_size = file_hash_size ? file_hash_size * 2 : 2048;
+		file_hash = calloc(file_hash_size, sizeof(int));
+		if(file_hash == NULL)
+			BAD_ERROR("Out of memory in add_file\n");
+		for(i = 0; i < files; i++)
+			hash_file(i);
+	}
+
+	f = &file[files];
+	memset(f, 0, sizeof(struct estimate_file));
+	f->pathname = dir_ent->pathname;
+	f->inode = inode;
+	/* the output of a pseudo file's command isn't known until it's run */
+	f->size = IS_PSEUDO_PROCESS(inode) ? 0 : inode->buf.st_size;
+	f->duplicate = -1;
+	f->fragment = SQUASHFS_INVALID_FRAG;
+	f->start = -1;
+	hash_file(files ++);
+}
+
+
+/* the regular files, once each, in the order they'll be written */
+static void scan_files(struct dir_info *dir)
+{
+	int i;
+
+	for(i = 0; dir && i < dir->count; i++) {
+		struct dir_ent *dir_ent = dir->list[i];
+		struct inode_info *inode = dir_ent->inode;
+
+		if(inode->root_entry)
+			continue;
+
+		if(S_ISDIR(inode->buf.st_mode))
+			scan_files(dir_ent->dir);
+		else if(S_ISREG(inode->buf.st_mode) &&
+				lookup_file(inode) == -1)
+			add_file(dir_ent);
+	}
+}
+
+
+static int read_at(char *pathname, char *buffer, long long offset, int bytes)
+{
+	int fd = open(pathname, O_RDONLY), res, count = 0;
+
+	if(fd == -1)
+		return 0;
+
+	while(count < bytes) {
+		res = pread(fd, buffer + count, bytes - count, offset + count);
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res < 1)
+			break;
+		count += res;
+	}
+
+	close(fd);
+	return count;
+}
+
+
+static void *hash_thread(void *arg)
+{
+	char *buffer = malloc(block_size);
+	int job;
+
+	if(buffer == NULL)
+		BAD_ERROR("Out of memory in hash_thread\n");
+
+	while((job = __sync_fetch_and_add(&next_job, 1)) < candidates) {
+		struct estimate_file *f = &file[candidate[job]];
+		long long bytes = 0;
+		int fd = open(f->pathname, O_RDONLY), res = 0;
+
+		f->hash[0] = f->hash[1] = 0;
+		while(fd != -1 && bytes < f->size &&
+				(res = read_bytes(fd, buffer, block_size)) > 0) {
+			content_hash_block(f->hash, buffer, res);
+			bytes += res;
+		}
+		if(fd != -1)
+			close(fd);
+		content_hash_final(f->hash, bytes);
+
+		/* a file that can't be read duplicates nothing */
+		if(fd == -1 || res == -1) {
+			f->hash[0] = ~0ULL;
+			f->hash[1] = candidate[job];
+		}
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+
+static int all_zero(char *buffer, int bytes)
+{
+	int i;
+
+	for(i = 0; i < bytes; i++)
+		if(buffer[i])
+			return FALSE;
+	return TRUE;
+}
+
+
+static void *sample_thread(void *arg)
+{
+	void *stream = NULL;
+	char *buffer = malloc(block_size), *c_buffer = malloc(block_size);
+	int job, i;
+
+	if(buffer == NULL || c_buffer == NULL)
+		BAD_ERROR("Out of memory in sample_thread\n");
+	if(compressor_init(est_comp, &stream, block_size, 1))
+		BAD_ERROR("compressor_init failed\n");
+
+	while((job = __sync_fetch_and_add(&next_job, 1)) < samples) {
+		struct estimate_sample *s = &sample[job];
+		int bytes = 0, uncompressed, error, res;
+
+		if(s->files == 0) {
+			bytes = read_at(file[s->file].pathname, buffer,
+				s->offset, s->bytes);
+			uncompressed = noD;
+		} else {
+			for(i = 0; i < s->files; i++) {
+				struct estimate_file *f = &file[tail[s->file +
+					i]];
+
+				bytes += read_at(f->pathname, buffer + bytes,
+					f->size - f->tail, f->tail);
+			}
+			uncompressed = noF;
+		}
+
+		/* as read_file() reads a file that shrank */
+		memset(buffer + bytes, 0, s->bytes - bytes);
+
+		if(s->files == 0 && sparse_files && all_zero(buffer,
+				s->bytes))
+			s->c_bytes = 0;
+		else if(uncompressed)
+			s->c_bytes = s->bytes;
+		else {
+			res = compressor_compress(est_comp, stream, c_buffer,
+				buffer, s->bytes, block_size, &error);
+			if(res == -1)
+				BAD_ERROR("compressor failed in sample_thread, "
+					"error %d\n", error);
+			s->c_bytes = res ? res : s->bytes;
+		}
+	}
+
+	free(buffer);
+	free(c_buffer);
+	return NULL;
+}
+
+
+static void run_threads(void *(*thread)(void *))
+{
+	int i, threads = processors == -1 ? available_processors() :
+		processors;
+	pthread_t *thread_id = malloc(threads * sizeof(pthread_t));
+
+	if(thread_id == NULL)
+		BAD_ERROR("Out of memory in run_threads\n");
+
+	next_job = 0;
+	for(i = 0; i < threads; i++)
+		if(pthread_create(&thread_id[i], NULL, thread, NULL) != 0)
+			BAD_ERROR("Failed to create thread\n");
+	for(i = 0; i < threads; i++)
+		pthread_join(thread_id[i], NULL);
+
+	free(thread_id);
+}
+
+
+static int size_cmp(const void *a, const void *b)
+{
+	struct estimate_file *fa = &file[*(int *) a], *fb = &file[*(int *) b];
+
+	if(fa->size != fb->size)
+		return fa->size < fb->size ? -1 : 1;
+	return *(int *) a - *(int *) b;
+}
+
+
+static int hash_cmp(const void *a, const void *b)
+{
+	struct estimate_file *fa = &file[*(int *) a], *fb = &file[*(int *) b];
+
+	if(fa->size != fb->size)
+		return fa->size < fb->size ? -1 : 1;
+	if(fa->hash[0] != fb->hash[0])
+		return fa->hash[0] < fb->hash[0] ? -1 : 1;
+	if(fa->hash[1] != fb->hash[1])
+		return fa->hash[1] < fb->hash[1] ? -1 : 1;
+	return *(int *) a - *(int *) b;
+}
+
+
+static int same_contents(int a, int b)
+{
+	return file[a].size == file[b].size && file[a].hash[0] ==
+		file[b].hash[0] && file[a].hash[1] == file[b].hash[1];
+}
+
+
+/*
+ * Only files with a size another file has can be duplicates, so only they
+ * are read, and each is marked as a duplicate of the first written of the
+ * files with the same contents
+ */
+static void find_duplicates()
+{
+	int i, j;
+
+	candidate = malloc(files * sizeof(int));
+	if(candidate == NULL)
+		BAD_ERROR("Out of memory in find_duplicates\n");
+
+	for(i = 0; i < files; i++)
+		candidate[i] = i;
+	qsort(candidate, files, sizeof(int), size_cmp);
+
+	for(i = 0; i < files; i = j) {
+		for(j = i + 1; j < files && file[candidate[j]].size ==
+				file[candidate[i]].size; j++);
+		if(j - i > 1 && file[candidate[i]].size)
+			while(i < j)
+				candidate[candidates ++] = candidate[i ++];
+	}
+
+	run_threads(hash_thread);
+	qsort(candidate, candidates, sizeof(int), hash_cmp);
+
+	for(i = 0; i < candidates; i = j)
+		for(j = i + 1; j < candidates && same_contents(candidate[i],
+				candidate[j]); j++) {
+			file[candidate[j]].duplicate = candidate[i];
+			duplicates ++;
+		}
+}
+
+
+/* as write_file() splits the files, and the fragments are filled */
+static void pack_fragments()
+{
+	int i, bytes = 0;
+
+	tail = malloc(files * sizeof(int));
+	frag_first = malloc((files + 1) * sizeof(int));
+	if(tail == NULL || frag_first == NULL)
+		BAD_ERROR("Out of memory in pack_fragments\n");
+
+	frag_first[0] = 0;
+	for(i = 0; i < files; i++) {
+		struct estimate_file *f = &file[i];
+		int frag = !no_fragments && (always_use_fragments ||
+			f->size < block_size);
+
+		if(f->duplicate != -1)
+			continue;
+
+		f->tail = frag ? f->size & (block_size - 1) : 0;
+		f->blocks = frag ? f->size >> block_log :
+			(f->size + block_size - 1) >> block_log;
+		data_bytes += f->size - f->tail;
+		data_blocks += f->blocks;
+
+		if(f->tail == 0)
+			continue;
+
+		if(bytes + f->tail > block_size) {
+			frag_first[++ fragments] = tails;
+			bytes = 0;
+		}
+		f->fragment = fragments;
+		f->offset = bytes;
+		bytes += f->tail;
+		tail_bytes += f->tail;
+		tail[tails ++] = i;
+	}
+
+	if(bytes)
+		frag_first[++ fragments] = tails;
+}
+
+
+static long long file_data(struct estimate_file *f)
+{
+	return f->duplicate == -1 ? f->size - f->tail : 0;
+}
+
+
+/*
+ * The sample is shared between the blocks and the fragments by their
+ * bytes, and each part is spread evenly through them, as tune_compressor()
+ * spreads its samples.  Unless every block is sampled, the blocks are
+ * picked by their bytes rather than their number, as the last blocks of
+ * files are short, compress worse, and would be weighed as full blocks
+ */
+static void choose_samples()
+{
+	long long budget = ESTIMATE_SAMPLE_MBYTES * 1048576LL, start = 0;
+	long long total = data_bytes + tail_bytes, blocks = 0, frags = 0;
+	int i, f = 0;
+
+	if(total) {
+		blocks = (budget * (double) data_bytes / total) / block_size;
+		frags = (budget * (double) tail_bytes / total) / block_size;
+	}
+	if(blocks == 0 && data_blocks)
+		blocks = 1;
+	if(blocks > data_blocks)
+		blocks = data_blocks;
+	if(frags == 0 && fragments)
+		frags = 1;
+	if(frags > fragments)
+		frags = fragments;
+
+	sample = malloc((blocks + frags + 1) * sizeof(struct estimate_sample));
+	if(sample == NULL)
+		BAD_ERROR("Out of memory in choose_samples\n");
+
+	every_block = blocks == data_blocks;
+	for(i = 0; i < blocks; i++) {
+		struct estimate_sample *s = &sample[samples ++];
+
+		if(every_block) {
+			while(start + file[f].blocks <= i)
+				start += file[f ++].blocks;
+			s->offset = (i - start) << block_log;
+		} else {
+			long long pos = (2 * i + 1) * data_bytes / (2 * blocks);
+
+			while(start + file_data(&file[f]) <= pos)
+				start += file_data(&file[f ++]);
+			s->offset = (pos - start) & ~(block_size - 1LL);
+		}
+
+		s->file = f;
+		s->files = 0;
+		s->bytes = file[f].size - s->offset < block_size ?
+			file[f].size - s->offset : block_size;
+	}
+	data_samples = samples;
+
+	for(i = 0; i < frags; i++) {
+		struct estimate_sample *s = &sample[samples ++];
+		int frag = (2LL * i + 1) * fragments / (2 * frags), j;
+
+		s->file = frag_first[frag];
+		s->files = frag_first[frag + 1] - frag_first[frag];
+		s->offset = 0;
+		s->bytes = 0;
+		for(j = 0; j < s->files; j++)
+			s->bytes += file[tail[s->file + j]].tail;
+	}
+}
+
+
+static void *table_add(struct table *table, int bytes)
+{
+	void *entry;
+
+	if(table->bytes + bytes > table->size) {
+		table->size = (table->bytes + bytes) * 2;
+		table->data = realloc(table->data, table->size);
+		if(table->data == NULL)
+			BAD_ERROR("Out of memory in table_add\n");
+	}
+
+	entry = table->data + table->bytes;
+	memset(entry, 0, bytes);
+	table->bytes += bytes;
+	return entry;
+}
+
+
+/*
+ * The compressed positions of the metadata blocks aren't known until
+ * they're compressed, so the references guess at half a block each
+ */
+static squashfs_inode table_ref(struct table *table)
+{
+	return SQUASHFS_MKINODE((table->bytes / SQUASHFS_METADATA_SIZE) *
+		(SQUASHFS_METADATA_SIZE / 2),
+		table->bytes % SQUASHFS_METADATA_SIZE);
+}
+
+
+static unsigned int get_id(unsigned int id)
+{
+	int i;
+
+	for(i = 0; i < ids; i++)
+		if(id_table[i] == id)
+			return i;
+	if(ids == SQUASHFS_IDS)
+		return 0;
+	id_table[ids] = id;
+	return ids ++;
+}
+
+
+/* the numbers the scan gave, as dir_scan3() numbers the inodes */
+static unsigned int number(struct inode_info *inode)
+{
+	return S_ISDIR(inode->buf.st_mode) ? inode->inode_number :
+		inode->inode_number + dir_inode_no;
+}
+
+
+static void *add_inode(struct inode_info *inode, int type, int bytes,
+	squashfs_inode *ref)
+{
+	struct squashfs_base_inode_header *base;
+	long long export = (number(inode) - 1LL) * sizeof(squashfs_inode);
+
+	*ref = table_ref(&inode_table);
+	base = table_add(&inode_table, bytes);
+	base->inode_type = type;
+	base->mode = SQUASHFS_MODE(inode->buf.st_mode);
+	base->uid = get_id(global_uid == -1 ? inode->buf.st_uid : global_uid);
+	base->guid = get_id(global_gid == -1 ? inode->buf.st_gid : global_gid);
+	base->mtime = inode->buf.st_mtime;
+	base->inode_number = number(inode);
+
+	/* the export table is indexed by inode number */
+	if(exportable) {
+		if(export >= export_table.bytes)
+			table_add(&export_table, export - export_table.bytes +
+				sizeof(squashfs_inode));
+		*(squashfs_inode *) (export_table.data + export) = *ref;
+	}
+
+	return base;
+}
+
+
+/* the sampled block sizes stand in for the blocks that weren't sampled */
+static unsigned int block_bytes(int seq)
+{
+	return data_samples ? sample[seq % data_samples].c_bytes : 0;
+}
+
+
+static squashfs_inode layout_file(struct dir_ent *dir_ent)
+{
+	struct inode_info *inode = dir_ent->inode;
+	struct estimate_file *f = &file[lookup_file(inode)], *data = f;
+	squashfs_inode ref;
+	unsigned int *block_list;
+	int i;
+
+	if(f->duplicate != -1)
+		data = &file[f->duplicate];
+
+	if(data->start == -1) {
+		static long long start = 0;
+		static int seq = 0;
+
+		data->start = start;
+		data->seq = seq;
+		for(i = 0; i < data->blocks; i++)
+			start += block_bytes(seq ++);
+	}
+
+	if(inode->nlink > 1 || f->size >= (1LL << 32) ||
+			data->start >= (1LL << 32)) {
+		struct squashfs_lreg_inode_header *reg = add_inode(inode,
+			SQUASHFS_LREG_TYPE, sizeof(*reg) + data->blocks *
+			sizeof(unsigned int), &ref);
+
+		reg->start_block = data->start;
+		reg->file_size = f->size;
+		reg->nlink = inode->nlink;
+		reg->fragment = data->fragment;
+		reg->offset = data->offset;
+		reg->xattr = SQUASHFS_INVALID_XATTR;
+		block_list = reg->block_list;
+	} else {
+		struct squashfs_reg_inode_header *reg = add_inode(inode,
+			SQUASHFS_FILE_TYPE, sizeof(*reg) + data->blocks *
+			sizeof(unsigned int), &ref);
+
+		reg->start_block = data->start;
+		reg->file_size = f->size;
+		reg->fragment = data->fragment;
+		reg->offset = data->offset;
+		block_list = reg->block_list;
+	}
+
+	for(i = 0; i < data->blocks; i++)
+		block_list[i] = block_bytes(data->seq + i);
+
+	return ref;
+}
+
+
+static squashfs_inode layout_symlink(struct dir_ent *dir_ent)
+{
+	struct inode_info *inode = dir_ent->inode;
+	struct squashfs_symlink_inode_header *symlink;
+	int size = inode->symlink ? strlen(inode->symlink) :
+		inode->buf.st_size;
+	squashfs_inode ref;
+
+	symlink = add_inode(inode, SQUASHFS_SYMLINK_TYPE, sizeof(*symlink) +
+		size, &ref);
+	symlink->nlink = inode->nlink;
+	symlink->symlink_size = size;
+	if(inode->symlink)
+		memcpy(symlink->symlink, inode->symlink, size);
+	else if(!IS_PSEUDO(inode) && readlink(dir_ent->pathname,
+			symlink->symlink, size) == -1)
+		ERROR("Cannot read symlink %s because %s, estimating it "
+			"anyway\n", dir_ent->pathname, strerror(errno));
+
+	return ref;
+}
+
+
+static squashfs_inode layout_dev(struct inode_info *inode, int type)
+{
+	squashfs_inode ref;
+
+	if(type == SQUASHFS_BLKDEV_TYPE || type == SQUASHFS_CHRDEV_TYPE) {
+		struct squashfs_dev_inode_header *dev = add_inode(inode, type,
+			sizeof(*dev), &ref);
+
+		dev->nlink = inode->nlink;
+		dev->rdev = inode->buf.st_rdev;
+	} else {
+		struct squashfs_ipc_inode_header *ipc = add_inode(inode, type,
+			sizeof(*ipc), &ref);
+
+		ipc->nlink = inode->nlink;
+	}
+
+	return ref;
+}
+
+
+static int squashfs_type(int mode)
+{
+	switch(mode & S_IFMT) {
+	case S_IFREG:
+		return SQUASHFS_FILE_TYPE;
+	case S_IFDIR:
+		return SQUASHFS_DIR_TYPE;
+	case S_IFLNK:
+		return SQUASHFS_SYMLINK_TYPE;
+	case S_IFCHR:
+		return SQUASHFS_CHRDEV_TYPE;
+	case S_IFBLK:
+		return SQUASHFS_BLKDEV_TYPE;
+	case S_IFIFO:
+		return SQUASHFS_FIFO_TYPE;
+	default:
+		return SQUASHFS_SOCKET_TYPE;
+	}
+}
+
+
+/* the table moves as it grows, so the header is kept by its offset */
+static void dir_header_count(long long header, int count)
+{
+	((struct squashfs_dir_header *) (dir_table.data + header))->count =
+		count - 1;
+}
+
+
+/*
+ * As dir_scan3() writes the tree: each entry's inode, a directory's after
+ * everything in it, then the directory's entries as add_dir() lays them out
+ */
+static squashfs_inode layout_dir(struct dir_info *dir, struct inode_info *us,
+	unsigned int parent)
+{
+	int i, count = dir ? dir->count : 0, subdirs = 0, entry_count = 256;
+	unsigned int start_block = 0, base_number = 0;
+	long long dir_start = dir_table.bytes, header = -1, size;
+	squashfs_inode ref;
+
+	for(i = 0; i < count; i++) {
+		struct dir_ent *dir_ent = dir->list[i];
+		struct inode_info *inode = dir_ent->inode;
+		struct squashfs_dir_entry *entry;
+		int type = squashfs_type(inode->buf.st_mode);
+		int len = strlen(dir_ent->name);
+
+		if(inode->root_entry)
+			continue;
+
+		if(inode->inode == SQUASHFS_INVALID_BLK)
+			switch(type) {
+			case SQUASHFS_FILE_TYPE:
+				inode->inode = layout_file(dir_ent);
+				break;
+			case SQUASHFS_DIR_TYPE:
+				inode->inode = layout_dir(dir_ent->dir, inode,
+					number(us));
+				break;
+			case SQUASHFS_SYMLINK_TYPE:
+				inode->inode = layout_symlink(dir_ent);
+				break;
+			default:
+				inode->inode = layout_dev(inode, type);
+			}
+
+		if(type == SQUASHFS_DIR_TYPE)
+			subdirs ++;
+
+		if(entry_count == 256 || (inode->inode >> 16) != start_block ||
+				number(inode) - base_number > 32767) {
+			struct squashfs_dir_header *dir_header;
+
+			if(header != -1)
+				dir_header_count(header, entry_count);
+			header = dir_table.bytes;
+			dir_header = table_add(&dir_table, sizeof(*dir_header));
+			dir_header->start_block = start_block =
+				inode->inode >> 16;
+			dir_header->inode_number = base_number =
+				number(inode);
+			entry_count = 0;
+		}
+
+		entry = table_add(&dir_table, sizeof(*entry) + len);
+		entry->offset = inode->inode & 0xffff;
+		entry->inode_number = number(inode) - base_number;
+		entry->type = type;
+		entry->size = len - 1;
+		memcpy(entry->name, dir_ent->name, len);
+		entry_count ++;
+	}
+	if(header != -1)
+		dir_header_count(header, entry_count);
+
+	size = dir_table.bytes - dir_start + 3;
+	if(size >= (1 << 16)) {
+		struct squashfs_ldir_inode_header *ldir = add_inode(us,
+			SQUASHFS_LDIR_TYPE, sizeof(*ldir), &ref);
+
+		ldir->nlink = subdirs + 2;
+		ldir->file_size = size;
+		ldir->start_block = dir_start / SQUASHFS_METADATA_SIZE;
+		ldir->offset = dir_start % SQUASHFS_METADATA_SIZE;
+		ldir->parent_inode = parent;
+		ldir->xattr = SQUASHFS_INVALID_XATTR;
+	} else {
+		struct squashfs_dir_inode_header *dinode = add_inode(us,
+			SQUASHFS_DIR_TYPE, sizeof(*dinode), &ref);
+
+		dinode->nlink = subdirs + 2;
+		dinode->file_size = size;
+		dinode->start_block = dir_start / SQUASHFS_METADATA_SIZE;
+		dinode->offset = dir_start % SQUASHFS_METADATA_SIZE;
+		dinode->parent_inode = parent;
+	}
+
+	return ref;
+}
+
+
+/* the bytes a table takes once compressed a metadata block at a time */
+static long long compress_table(void *stream, struct table *table,
+	int uncompressed)
+{
+	char buffer[SQUASHFS_METADATA_SIZE * 2];
+	long long pos, total = 0;
+	int bytes, res, error;
+
+	for(pos = 0; pos < table->bytes; pos += SQUASHFS_METADATA_SIZE) {
+		bytes = table->bytes - pos < SQUASHFS_METADATA_SIZE ?
+			table->bytes - pos : SQUASHFS_METADATA_SIZE;
+		res = uncompressed ? 0 : compressor_compress(est_comp, stream,
+			buffer, table->data + pos, bytes,
+			SQUASHFS_METADATA_SIZE, &error);
+		if(res == -1)
+			BAD_ERROR("compressor failed in compress_table, error "
+				"%d\n", error);
+		total += (res ? res : bytes) + BLOCK_OFFSET;
+	}
+
+	return total;
+}
+
+
+/* a lookup table, compressed, and its index of the blocks */
+static long long lookup_table(void *stream, struct table *table,
+	int uncompressed)
+{
+	return compress_table(stream, table, uncompressed) +
+		(table->bytes + SQUASHFS_METADATA_SIZE - 1) /
+		SQUASHFS_METADATA_SIZE * sizeof(long long);
+}
+
+
+long long estimate_filesystem(struct dir_info *root, struct compressor *comp)
+{
+	struct timeval start_time, end_time;
+	struct table fragment_table = { NULL, 0, 0 }, ids_table = { NULL, 0, 0 };
+	long long sampled_c_bytes = 0, sampled_tails = 0, sampled_c_tails = 0;
+	long long est_data, est_frags, metadata, total;
+	double ratios = 0;
+	long long frag_start;
+	void *stream = NULL, *comp_data;
+	int i, size;
+
+	gettimeofday(&start_time, NULL);
+	est_comp = comp;
+
+	scan_files(root);
+	if(duplicate_checking)
+		find_duplicates();
+	pack_fragments();
+	choose_samples();
+	run_threads(sample_thread);
+
+	for(i = 0; i < samples; i++)
+		if(i < data_samples) {
+			sampled_c_bytes += sample[i].c_bytes;
+			ratios += (double) sample[i].c_bytes / sample[i].bytes;
+		} else {
+			sampled_tails += sample[i].bytes;
+			sampled_c_tails += sample[i].c_bytes;
+		}
+
+	est_data = every_block ? sampled_c_bytes : data_bytes * ratios /
+		data_samples;
+	est_frags = sampled_tails ? tail_bytes * (double) sampled_c_tails /
+		sampled_tails : 0;
+
+	layout_dir(root, root->dir_ent->inode, dir_inode_no + inode_no);
+
+	frag_start = est_data;
+	for(i = 0; i < fragments; i++) {
+		struct squashfs_fragment_entry *entry =
+			table_add(&fragment_table, sizeof(*entry));
+
+		entry->start_block = frag_start;
+		entry->size = est_frags / fragments;
+		frag_start += entry->size;
+	}
+
+	for(i = 0; i < ids; i++)
+		*(unsigned int *) table_add(&ids_table, sizeof(unsigned int)) =
+			id_table[i];
+
+	if(compressor_init(comp, &stream, SQUASHFS_METADATA_SIZE, 0))
+		BAD_ERROR("compressor_init failed\n");
+
+	metadata = compress_table(stream, &inode_table, noI) +
+		compress_table(stream, &dir_table, noI) +
+		lookup_table(stream, &fragment_table, noF) +
+		lookup_table(stream, &export_table, noI) +
+		lookup_table(stream, &ids_table, noI);
+
+	total = sizeof(struct squashfs_super_block) + est_data + est_frags +
+		metadata;
+	comp_data = compressor_dump_options(comp, block_size, &size);
+	if(comp_data)
+		total += sizeof(unsigned short) + size;
+	if(!nopad)
+		total = (total + 4095) & ~4095LL;
+
+	gettimeofday(&end_time, NULL);
+
+	printf("Estimated filesystem size %lld bytes (%.2f Kbytes / %.2f "
+		"Mbytes)\n", total, total / 1024.0, total / (1024.0 * 1024.0));
+	printf("\tdata blocks %lld bytes, fragments %lld bytes in %d, "
+		"metadata %lld bytes\n", est_data, est_frags, fragments,
+		metadata);
+	printf("\t%d of %lld blocks and %d of %d fragments compressed, %d "
+		"duplicate files, in %.2f seconds\n", data_samples,
+		data_blocks, samples - data_samples, fragments,
+		duplicates, (end_time.tv_sec -
+		start_time.tv_sec) + (end_time.tv_usec - start_time.tv_usec) /
+		1000000.0);
+
+	return total;
+}
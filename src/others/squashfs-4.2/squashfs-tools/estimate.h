@@ -1,7 +1,10 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
 /*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
  *
- * Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009
- * Phillip Lougher <phillip@lougher.demon.co.uk>
+ * Copyright (c) 2011
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU General Public License
@@ -17,17 +20,15 @@
  * along with this program; if not, write to the Free Software
  * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  *
- * compressor.h
+ * estimate.h
  */
 
-struct compressor {
-	int (*compress)(void **, char *, char *, int, int, int *);
-	int (*uncompress)(char *, char *, int, int, int *);
-	int id;
-	char *name;
-	int supported;
-};
+/* the data compressed to make the estimate, split between blocks and fragments */
+#define ESTIMATE_SAMPLE_MBYTES	64
 
-extern struct compressor *lookup_compressor(char *);
-extern struct compressor *lookup_compressor_id(int);
-extern void display_compressors(char *, char *);
+struct dir_info;
+struct compressor;
+
+extern int estimate;
+extern long long estimate_filesystem(struct dir_info *, struct compressor *);
+#endif
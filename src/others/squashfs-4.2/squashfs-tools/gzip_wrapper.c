@@ -19,11 +19,174 @@
  * gzip_wrapper.c
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include <zlib.h>
 
 #include "squashfs_fs.h"
+#include "gzip_wrapper.h"
 #include "compressor.h"
+#include "../../../zbuf/zbuf.h"
+
+/* preset dictionary given with -Xdict, used for every block */
+static char *dictionary = NULL;
+static int dict_size;
+static unsigned int dict_id;
+
+static struct gzip_comp_opts comp_opts;
+
+
+static int read_dictionary(char *filename)
+{
+	struct stat buf;
+	int fd, bytes = 0;
+
+	fd = open(filename, O_RDONLY);
+	if(fd == -1) {
+		fprintf(stderr, "gzip: can't open dictionary %s because %s\n",
+			filename, strerror(errno));
+		return -1;
+	}
+
+	if(fstat(fd, &buf) == -1 || buf.st_size == 0 ||
+			buf.st_size > GZIP_DICT_MAX) {
+		fprintf(stderr, "gzip: dictionary %s must be 1 to %d bytes\n",
+			filename, GZIP_DICT_MAX);
+		goto failed;
+	}
+
+	free(dictionary);
+	dictionary = malloc(buf.st_size);
+	if(dictionary == NULL) {
+		fprintf(stderr, "gzip: out of memory reading dictionary\n");
+		goto failed;
+	}
+
+	while(bytes < buf.st_size) {
+		int res = read(fd, dictionary + bytes, buf.st_size - bytes);
+
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res < 1) {
+			fprintf(stderr, "gzip: failed to read dictionary %s\n",
+				filename);
+			free(dictionary);
+			dictionary = NULL;
+			goto failed;
+		}
+		bytes += res;
+	}
+	close(fd);
+
+	dict_size = bytes;
+	dict_id = adler32(adler32(0L, Z_NULL, 0), (Bytef *) dictionary,
+		dict_size);
+	return 0;
+
+failed:
+	close(fd);
+	return -1;
+}
+
+
+/*
+ * This function is called by the options parsing code in mksquashfs.c
+ * and unsquashfs.c to parse any -X compressor option.
+ *
+ * -Xdict <dictionary> compresses every block with <dictionary> preset
+ * in the zlib window, so the small blocks of routers don't each have to
+ * start from nothing.  The dictionary is needed again to decompress.
+ *
+ * Returns -1 for an unrecognised option, -2 for a bad option, or the
+ * number of arguments taken otherwise
+ */
+static int gzip_options(char *argv[], int argc)
+{
+	if(strcmp(argv[0], "-Xdict") == 0) {
+		if(argc < 2) {
+			fprintf(stderr, "gzip: -Xdict missing dictionary\n");
+			return -2;
+		}
+
+		return read_dictionary(argv[1]) ? -2 : 1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * The preset dictionary's id and size are stored in the filesystem, so
+ * the dictionary a filesystem needs can be told and checked
+ */
+static void *gzip_dump_options(int block_size, int *size)
+{
+	if(dictionary == NULL)
+		return NULL;
+
+	comp_opts.magic = GZIP_DICT_MAGIC;
+	comp_opts.dict_id = dict_id;
+	comp_opts.dict_size = dict_size;
+	SQUASHFS_INSWAP_GZIP_COMP_OPTS(&comp_opts);
+
+	*size = sizeof(comp_opts);
+	return &comp_opts;
+}
+
+
+static int gzip_extract_options(int block_size, void *buffer, int size)
+{
+	struct gzip_comp_opts *opts = buffer;
+
+	if(size == sizeof(struct gzip_comp_opts))
+		SQUASHFS_INSWAP_GZIP_COMP_OPTS(opts);
+
+	/*
+	 * anything else is no options, or those of squashfs-tools 4.3 and
+	 * later, which decompressing doesn't need
+	 */
+	if(size != sizeof(struct gzip_comp_opts) ||
+			opts->magic != GZIP_DICT_MAGIC) {
+		if(dictionary) {
+			fprintf(stderr, "gzip: the filesystem wasn't "
+				"compressed with a preset dictionary\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	if(dictionary == NULL) {
+		fprintf(stderr, "gzip: the filesystem needs the %d byte "
+			"preset dictionary with id 0x%08x\n", opts->dict_size,
+			opts->dict_id);
+		return -1;
+	}
+
+	if(opts->dict_id != dict_id || opts->dict_size != dict_size) {
+		fprintf(stderr, "gzip: the dictionary given has id 0x%08x, the "
+			"filesystem needs 0x%08x\n", dict_id, opts->dict_id);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static void gzip_usage()
+{
+	fprintf(stderr, "\t  -Xdict <dictionary>\n");
+	fprintf(stderr, "\t\tCompress with the zlib preset dictionary in "
+		"<dictionary>,\n\t\tas made by traindict.  unsquashfs then "
+		"needs\n\t\t-dict <dictionary>\n");
+	fprintf(stderr, "\t\tBlocks without a dictionary are compressed with "
+		"%s\n", zbuf_backend());
+}
+
 
 static int gzip_init(void **strm, int block_size, int flags)
 {
@@ -57,10 +220,26 @@ static int gzip_compress(void *strm, void *d, void *s, int size, int block_size,
 	int res;
 	z_stream *stream = strm;
 
+	if(dictionary == NULL) {
+		/* whole blocks without a dictionary go through zbuf */
+		unsigned long bytes = block_size;
+
+		res = zbuf_compress(d, &bytes, s, size, 9);
+		if(res == Z_OK)
+			return (int) bytes;
+		if(res == Z_BUF_ERROR)
+			return 0;
+		goto failed;
+	}
+
 	res = deflateReset(stream);
 	if(res != Z_OK)
 		goto failed;
 
+	res = deflateSetDictionary(stream, (Bytef *) dictionary, dict_size);
+	if(res != Z_OK)
+		goto failed;
+
 	stream->next_in = s;
 	stream->avail_in = size;
 	stream->next_out = d;
@@ -87,12 +266,102 @@ failed:
 }
 
 
+static void *gzip_uncompress_init(int block_size)
+{
+	z_stream *stream = malloc(sizeof(z_stream));
+
+	if(stream == NULL)
+		return NULL;
+
+	stream->zalloc = Z_NULL;
+	stream->zfree = Z_NULL;
+	stream->opaque = 0;
+	stream->next_in = Z_NULL;
+	stream->avail_in = 0;
+
+	if(inflateInit(stream) != Z_OK) {
+		free(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+
+static int gzip_uncompress_stream(void *strm, void *d, void *s, int size,
+	int block_size, int *error)
+{
+	int res;
+	z_stream *stream = strm;
+
+	if(dictionary == NULL) {
+		/* whole blocks without a dictionary go through zbuf */
+		unsigned long bytes = block_size;
+
+		res = zbuf_uncompress(d, &bytes, s, size);
+		*error = res;
+		return res == Z_OK ? (int) bytes : -1;
+	}
+
+	res = inflateReset(stream);
+	if(res != Z_OK)
+		goto failed;
+
+	stream->next_in = s;
+	stream->avail_in = size;
+	stream->next_out = d;
+	stream->avail_out = block_size;
+
+	res = inflate(stream, Z_FINISH);
+	if(res == Z_NEED_DICT && dictionary && stream->adler == dict_id) {
+		res = inflateSetDictionary(stream, (Bytef *) dictionary,
+			dict_size);
+		if(res != Z_OK)
+			goto failed;
+		res = inflate(stream, Z_FINISH);
+	}
+	if(res == Z_STREAM_END) {
+		*error = Z_OK;
+		return (int) stream->total_out;
+	}
+
+	if(res == Z_OK || (res == Z_BUF_ERROR && stream->avail_in))
+		/* report the same code uncompress() would */
+		res = stream->avail_out ? Z_DATA_ERROR : Z_BUF_ERROR;
+
+failed:
+	*error = res;
+	return -1;
+}
+
+
+static void gzip_uncompress_free(void *strm)
+{
+	inflateEnd(strm);
+	free(strm);
+}
+
+
 static int gzip_uncompress(void *d, void *s, int size, int block_size, int *error)
 {
 	int res;
 	unsigned long bytes = block_size;
 
-	res = uncompress(d, &bytes, s, size);
+	if(dictionary) {
+		/* uncompress() can't be given the dictionary */
+		void *stream = gzip_uncompress_init(block_size);
+
+		if(stream == NULL) {
+			*error = Z_MEM_ERROR;
+			return -1;
+		}
+		res = gzip_uncompress_stream(stream, d, s, size, block_size,
+			error);
+		gzip_uncompress_free(stream);
+		return res;
+	}
+
+	res = zbuf_uncompress(d, &bytes, s, size);
 
 	*error = res;
 	return res == Z_OK ? (int) bytes : -1;
@@ -103,8 +372,13 @@ struct compressor gzip_comp_ops = {
 	.init = gzip_init,
 	.compress = gzip_compress,
 	.uncompress = gzip_uncompress,
-	.options = NULL,
-	.usage = NULL,
+	.uncompress_init = gzip_uncompress_init,
+	.uncompress_stream = gzip_uncompress_stream,
+	.uncompress_free = gzip_uncompress_free,
+	.options = gzip_options,
+	.dump_options = gzip_dump_options,
+	.extract_options = gzip_extract_options,
+	.usage = gzip_usage,
 	.id = ZLIB_COMPRESSION,
 	.name = "gzip",
 	.supported = 1
@@ -0,0 +1,66 @@
+#ifndef GZIP_WRAPPER_H
+#define GZIP_WRAPPER_H
+/*
+ * Squashfs
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * gzip_wrapper.h
+ *
+ */
+
+#ifndef linux
+#ifdef __FreeBSD__
+#include <machine/endian.h>
+#endif
+#define __BYTE_ORDER BYTE_ORDER
+#define __BIG_ENDIAN BIG_ENDIAN
+#define __LITTLE_ENDIAN LITTLE_ENDIAN
+#else
+#include <endian.h>
+#endif
+
+/* zlib only looks back 32K, so no preset dictionary is longer */
+#define GZIP_DICT_MAX	32768
+
+/*
+ * Stored when the blocks were compressed with a preset dictionary.
+ * The id is the Adler-32 of the dictionary, which zlib also stores in
+ * each block.  Squashfs-tools 4.3 and later store 8 bytes of gzip options
+ * of their own (level, window size and strategy), so these are told from
+ * those by their size and magic
+ */
+#define GZIP_DICT_MAGIC	0x444b4d46	/* "FMKD" */
+
+struct gzip_comp_opts {
+	unsigned int magic;
+	unsigned int dict_id;
+	unsigned int dict_size;
+};
+
+#if __BYTE_ORDER == __BIG_ENDIAN
+extern unsigned int inswap_le32(unsigned int);
+
+#define SQUASHFS_INSWAP_GZIP_COMP_OPTS(s) { \
+	(s)->magic = inswap_le32((s)->magic); \
+	(s)->dict_id = inswap_le32((s)->dict_id); \
+	(s)->dict_size = inswap_le32((s)->dict_size); \
+}
+#else
+#define SQUASHFS_INSWAP_GZIP_COMP_OPTS(s)
+#endif
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * lzma_nosize_wrapper.c
+ *
+ * Decompressor for the LZMA blocks written by the Broadcom mksquashfs
+ * (the squashfs-2.0-nb4 tree in src/others), which keep the standard
+ * squashfs magic.  Each block is the 5 byte LZMA properties followed by
+ * the stream, without the 8 byte uncompressed size of the LZMA header
+ * and without an end marker, so a block is decoded until its input or
+ * the output buffer runs out.  The LZMA SDK decoder is used whichever
+ * LZMA library the lzma compressor is built with, as it can stop at the
+ * end of the input without treating that as an error.
+ */
+
+#include <stdlib.h>
+
+#include "squashfs_fs.h"
+#include "compressor.h"
+
+#include "LzmaDec.h"
+
+static void *lzma_nosize_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+
+static void lzma_nosize_free(void *p, void *address)
+{
+	free(address);
+}
+
+
+static ISzAlloc lzma_nosize_allocator = {
+	lzma_nosize_alloc, lzma_nosize_free
+};
+
+
+static int lzma_nosize_uncompress_stream(void *strm, void *dest, void *src,
+	int size, int block_size, int *error)
+{
+	CLzmaDec *dec = strm;
+	SizeT inlen = size - LZMA_PROPS_SIZE;
+	ELzmaStatus status;
+	int res;
+
+	if(size <= LZMA_PROPS_SIZE) {
+		*error = SZ_ERROR_INPUT_EOF;
+		return -1;
+	}
+
+	/* only reallocates the probabilities if lc + lp has changed */
+	res = LzmaDec_AllocateProbs(dec, src, LZMA_PROPS_SIZE,
+		&lzma_nosize_allocator);
+	if(res != SZ_OK)
+		goto failed;
+
+	dec->dic = dest;
+	dec->dicBufSize = block_size;
+	LzmaDec_Init(dec);
+
+	res = LzmaDec_DecodeToDic(dec, block_size, src + LZMA_PROPS_SIZE,
+		&inlen, LZMA_FINISH_ANY, &status);
+	if(res != SZ_OK)
+		goto failed;
+
+	/*
+	 * Without a size or an end marker the block has ended when all of it
+	 * has been read, or the output is a full block
+	 */
+	if(dec->dicPos == 0 || (status != LZMA_STATUS_FINISHED_WITH_MARK &&
+			inlen != size - LZMA_PROPS_SIZE &&
+			dec->dicPos != block_size)) {
+		res = SZ_ERROR_DATA;
+		goto failed;
+	}
+
+	return dec->dicPos;
+
+failed:
+	*error = res;
+	return -1;
+}
+
+
+static void *lzma_nosize_uncompress_init(int block_size)
+{
+	CLzmaDec *dec = malloc(sizeof(CLzmaDec));
+
+	if(dec)
+		LzmaDec_Construct(dec);
+	return dec;
+}
+
+
+static void lzma_nosize_uncompress_free(void *strm)
+{
+	LzmaDec_FreeProbs(strm, &lzma_nosize_allocator);
+	free(strm);
+}
+
+
+static int lzma_nosize_uncompress(void *dest, void *src, int size,
+	int block_size, int *error)
+{
+	CLzmaDec dec;
+	int res;
+
+	LzmaDec_Construct(&dec);
+	res = lzma_nosize_uncompress_stream(&dec, dest, src, size, block_size,
+		error);
+	LzmaDec_FreeProbs(&dec, &lzma_nosize_allocator);
+
+	return res;
+}
+
+
+struct compressor lzma_nosize_comp_ops = {
+	.init = NULL,
+	.compress = NULL,
+	.uncompress = lzma_nosize_uncompress,
+	.uncompress_init = lzma_nosize_uncompress_init,
+	.uncompress_stream = lzma_nosize_uncompress_stream,
+	.uncompress_free = lzma_nosize_uncompress_free,
+	.options = NULL,
+	.usage = NULL,
+	.id = LZMA_COMPRESSION,
+	.name = "lzma-nosize",
+	.supported = 1
+};
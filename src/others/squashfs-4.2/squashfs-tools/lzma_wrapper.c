@@ -22,23 +22,110 @@
  * development, other versions may work) http://www.7-zip.org/sdk.html
  */
 
+#include <stdlib.h>
 #include <LzmaLib.h>
+#include <LzmaEnc.h>
 
 #include "squashfs_fs.h"
 #include "compressor.h"
 
 #define LZMA_HEADER_SIZE	(LZMA_PROPS_SIZE + 8)
 
+/*
+ * Each deflator thread keeps an encoder, so the match finder's hash and
+ * tree tables are allocated once for the thread rather than once a block.
+ * The properties are those LzmaCompress() was called with, and depend
+ * only on the dictionary (block) size, which is set again if it changes
+ */
+struct lzma_enc_stream {
+	CLzmaEncHandle	enc;
+	int		dict_size;
+};
+
+static void *lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+
+static void lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+
+static ISzAlloc lzma_allocator = { lzma_alloc, lzma_free };
+
+
+static int lzma_set_props(struct lzma_enc_stream *stream, int block_size)
+{
+	CLzmaEncProps props;
+
+	LzmaEncProps_Init(&props);
+	props.level = 5;
+	props.dictSize = block_size;
+	props.lc = 3;
+	props.lp = 0;
+	props.pb = 2;
+	props.fb = 32;
+	props.numThreads = 1;
+
+	if(LzmaEnc_SetProps(stream->enc, &props) != SZ_OK)
+		return -1;
+
+	stream->dict_size = block_size;
+	return 0;
+}
+
+
+static int lzma_init(void **strm, int block_size, int datablock)
+{
+	struct lzma_enc_stream *stream;
+
+	stream = *strm = malloc(sizeof(struct lzma_enc_stream));
+	if(stream == NULL)
+		goto failed;
+
+	stream->enc = LzmaEnc_Create(&lzma_allocator);
+	if(stream->enc == NULL)
+		goto failed2;
+
+	if(lzma_set_props(stream, block_size) == -1)
+		goto failed3;
+
+	return 0;
+
+failed3:
+	LzmaEnc_Destroy(stream->enc, &lzma_allocator, &lzma_allocator);
+failed2:
+	free(stream);
+failed:
+	return -1;
+}
+
+
 static int lzma_compress(void *strm, void *dest, void *src, int size, int block_size,
 		int *error)
 {
+	struct lzma_enc_stream *stream = strm;
 	unsigned char *d = dest;
 	size_t props_size = LZMA_PROPS_SIZE,
 		outlen = block_size - LZMA_HEADER_SIZE;
 	int res;
 
-	res = LzmaCompress(dest + LZMA_HEADER_SIZE, &outlen, src, size, dest,
-		&props_size, 5, block_size, 3, 0, 2, 32, 1);
+	if(stream == NULL)
+		res = LzmaCompress(dest + LZMA_HEADER_SIZE, &outlen, src, size,
+			dest, &props_size, 5, block_size, 3, 0, 2, 32, 1);
+	else if(stream->dict_size != block_size &&
+			lzma_set_props(stream, block_size) == -1)
+		res = SZ_ERROR_PARAM;
+	else {
+		res = LzmaEnc_WriteProperties(stream->enc, dest, &props_size);
+		if(res == SZ_OK)
+			res = LzmaEnc_MemEncode(stream->enc, dest +
+				LZMA_HEADER_SIZE, &outlen, src, size, 0, NULL,
+				&lzma_allocator, &lzma_allocator);
+	}
 	
 	if(res == SZ_ERROR_OUTPUT_EOF) {
 		/*
@@ -100,7 +187,7 @@ static int lzma_uncompress(void *dest, void *src, int size, int block_size,
 
 
 struct compressor lzma_comp_ops = {
-	.init = NULL,
+	.init = lzma_init,
 	.compress = lzma_compress,
 	.uncompress = lzma_uncompress,
 	.options = NULL,
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include <lzma.h>
 
@@ -40,6 +41,8 @@ static struct lzma_xz_options options = {
 	.pb		= LZMA_OPT_PB_DEFAULT,
 	.fb		= LZMA_OPT_FB_DEFAULT,
 	.dict_size	= 0,
+	.tune		= 0,
+	.set		= 0,
 };
 
 static float lzma_dict_percent = 0;
@@ -73,6 +76,14 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 	} else if(strcmp(argv[0], "-Xe") == 0) {
 		options.extreme = 1;
 		return 0;
+	} else if(strcmp(argv[0], "-Xtune") == 0) {
+		if(lzmaver != LZMA_OPT_LZMA) {
+			fprintf(stderr, "%s: -Xtune is only supported by lzma\n",
+				comp_name);
+			goto failed;
+		}
+		options.tune = 1;
+		return 0;
 	} else if(strcmp(argv[0], "-Xlc") == 0) {
 		int lc;
 		
@@ -88,6 +99,7 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 			goto failed;
 		}
 		options.lc = lc;
+		options.set |= LZMA_OPT_SET_LC;
 		return 1;
 	} else if(strcmp(argv[0], "-Xlp") == 0) {
 		int lp;
@@ -104,6 +116,7 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 			goto failed;
 		}
 		options.lp = lp;
+		options.set |= LZMA_OPT_SET_LP;
 		return 1;
 	} else if(strcmp(argv[0], "-Xpb") == 0) {
 		int pb;
@@ -120,6 +133,7 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 			goto failed;
 		}
 		options.pb = pb;
+		options.set |= LZMA_OPT_SET_PB;
 		return 1;	
 	} else if(strcmp(argv[0], "-Xfb") == 0) {
 		int fb;
@@ -136,6 +150,7 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 			goto failed;
 		}
 		options.fb = fb;
+		options.set |= LZMA_OPT_SET_FB;
 		return 1;
 	} else if(strcmp(argv[0], "-Xdict-size") == 0) {
 		char *b;
@@ -178,6 +193,7 @@ int lzma_xz_options(char *argv[], int argc, int lzmaver)
 			}
 		}
 
+		options.set |= LZMA_OPT_SET_DICT;
 		return 1;
 	}
 	
@@ -334,6 +350,248 @@ failed:
 	return -1;	
 }
 
+struct tune_job {
+	struct lzma_xz_options opts;
+	long long bytes;
+};
+
+struct tune_thread {
+	pthread_t thread;
+	int started;
+	struct tune_job *job;
+	int jobs;
+	int first;
+	int step;
+	char *samples;
+	int *sizes;
+	int count;
+	int block_size;
+	lzma_xz_compress_fn compress;
+	char *buffer;
+	int error;
+};
+
+
+/* compress the samples with every step'th job from first */
+static void *tune_compress(void *arg)
+{
+	struct tune_thread *t = arg;
+	int i, j;
+
+	for(i = t->first; i < t->jobs; i += t->step) {
+		struct tune_job *job = &t->job[i];
+
+		job->bytes = 0;
+		for(j = 0; j < t->count; j++) {
+			int res = t->compress(&job->opts, t->buffer, t->samples +
+				(long long) j * t->block_size, t->sizes[j],
+				t->block_size, &t->error);
+
+			if(res < 0) {
+				if(t->error == 0)
+					t->error = -1;
+				return NULL;
+			}
+
+			/* mksquashfs stores blocks that don't shrink uncompressed */
+			job->bytes += res == 0 || res >= t->sizes[j] ?
+				t->sizes[j] : res;
+		}
+	}
+
+	return NULL;
+}
+
+
+static int tune_run(struct tune_thread *thread, int threads,
+	struct tune_job *job, int jobs)
+{
+	int i, error = 0;
+
+	if(threads > jobs)
+		threads = jobs;
+
+	for(i = 0; i < threads; i++) {
+		thread[i].job = job;
+		thread[i].jobs = jobs;
+		thread[i].first = i;
+		thread[i].step = threads;
+		thread[i].error = 0;
+		thread[i].started = pthread_create(&thread[i].thread, NULL,
+			tune_compress, &thread[i]) == 0;
+		if(!thread[i].started)
+			tune_compress(&thread[i]);
+	}
+
+	for(i = 0; i < threads; i++) {
+		if(thread[i].started)
+			pthread_join(thread[i].thread, NULL);
+		if(thread[i].error)
+			error = thread[i].error;
+	}
+
+	return error;
+}
+
+
+int lzma_xz_tune_blocks(int block_size)
+{
+	int blocks = LZMA_TUNE_BYTES / block_size;
+
+	if(!options.tune)
+		return 0;
+
+	return blocks < LZMA_TUNE_BLOCKS ? blocks : LZMA_TUNE_BLOCKS;
+}
+
+
+/*
+ * Pick the lc/lp pair, pb, fb and dictionary size, in that order, that
+ * compress the sample blocks smallest, compressing each option's
+ * candidates in parallel.  Options given on the command line are kept,
+ * lc + lp stays within 4 as LZMA2 and many boot loader decoders require,
+ * and of dictionary sizes that do equally well the smallest is taken
+ */
+int lzma_xz_tune(void *samples, int *sizes, int count, int block_size,
+	int threads, int lzmaver, lzma_xz_compress_fn compress)
+{
+	static const int fb[] = { 32, 64, 128, 273 };
+	const char *comp_name = lzmaver_str[lzmaver];
+	int dict_size_min = (lzmaver == 1 ? 4096 : 8192);
+	struct tune_thread *thread;
+	struct tune_job job[32];
+	long long bytes, start;
+	int i, jobs, error, lc, lp, pb, dict_size;
+
+	if(count == 0)
+		return 0;
+
+	if(threads < 1)
+		threads = 1;
+
+	thread = malloc(threads * sizeof(struct tune_thread));
+	if(thread == NULL)
+		goto failed;
+
+	for(i = 0; i < threads; i++) {
+		thread[i].samples = samples;
+		thread[i].sizes = sizes;
+		thread[i].count = count;
+		thread[i].block_size = block_size;
+		thread[i].compress = compress;
+		thread[i].buffer = malloc(block_size);
+		if(thread[i].buffer == NULL) {
+			while(i--)
+				free(thread[i].buffer);
+			free(thread);
+			goto failed;
+		}
+	}
+
+	job[0].opts = options;
+	error = tune_run(thread, threads, job, 1);
+	if(error)
+		goto failed2;
+	start = bytes = job[0].bytes;
+
+	jobs = 0;
+	for(lc = LZMA_OPT_LC_MIN; lc <= LZMA_OPT_LC_MAX; lc++)
+		for(lp = LZMA_OPT_LP_MIN; lp <= LZMA_OPT_LP_MAX &&
+				lc + lp <= 4; lp++) {
+			if((lc == options.lc && lp == options.lp) ||
+					((options.set & LZMA_OPT_SET_LC) &&
+					lc != options.lc) ||
+					((options.set & LZMA_OPT_SET_LP) &&
+					lp != options.lp))
+				continue;
+			job[jobs].opts = options;
+			job[jobs].opts.lc = lc;
+			job[jobs++].opts.lp = lp;
+		}
+	error = tune_run(thread, threads, job, jobs);
+	if(error)
+		goto failed2;
+	for(i = 0; i < jobs; i++)
+		if(job[i].bytes < bytes) {
+			bytes = job[i].bytes;
+			options.lc = job[i].opts.lc;
+			options.lp = job[i].opts.lp;
+		}
+
+	jobs = 0;
+	for(pb = LZMA_OPT_PB_MIN; pb <= LZMA_OPT_PB_MAX &&
+			!(options.set & LZMA_OPT_SET_PB); pb++)
+		if(pb != options.pb) {
+			job[jobs].opts = options;
+			job[jobs++].opts.pb = pb;
+		}
+	error = tune_run(thread, threads, job, jobs);
+	if(error)
+		goto failed2;
+	for(i = 0; i < jobs; i++)
+		if(job[i].bytes < bytes) {
+			bytes = job[i].bytes;
+			options.pb = job[i].opts.pb;
+		}
+
+	jobs = 0;
+	for(i = 0; i < sizeof(fb) / sizeof(fb[0]) &&
+			!(options.set & LZMA_OPT_SET_FB); i++)
+		if(fb[i] != options.fb) {
+			job[jobs].opts = options;
+			job[jobs++].opts.fb = fb[i];
+		}
+	error = tune_run(thread, threads, job, jobs);
+	if(error)
+		goto failed2;
+	for(i = 0; i < jobs; i++)
+		if(job[i].bytes < bytes) {
+			bytes = job[i].bytes;
+			options.fb = job[i].opts.fb;
+		}
+
+	/* halving keeps the dictionary size storable in the header */
+	jobs = 0;
+	for(dict_size = options.dict_size / 2; dict_size >= dict_size_min &&
+			!(options.set & LZMA_OPT_SET_DICT) &&
+			(options.dict_size & (options.dict_size - 1)) == 0;
+			dict_size /= 2) {
+		job[jobs].opts = options;
+		job[jobs++].opts.dict_size = dict_size;
+	}
+	error = tune_run(thread, threads, job, jobs);
+	if(error)
+		goto failed2;
+	for(i = 0; i < jobs; i++)
+		if(job[i].bytes <= bytes) {
+			bytes = job[i].bytes;
+			options.dict_size = job[i].opts.dict_size;
+		}
+
+	for(i = 0; i < threads; i++)
+		free(thread[i].buffer);
+	free(thread);
+
+	printf("%s: -Xtune picked -Xlc %d -Xlp %d -Xpb %d -Xfb %d -Xdict-size "
+		"%d\n", comp_name, options.lc, options.lp, options.pb,
+		options.fb, options.dict_size);
+	printf("%s: %d sample blocks compress to %lld bytes, %lld before\n",
+		comp_name, count, bytes, start);
+	return 0;
+
+failed2:
+	for(i = 0; i < threads; i++)
+		free(thread[i].buffer);
+	free(thread);
+	fprintf(stderr, "%s: -Xtune compression failed with error code %d\n",
+		comp_name, error);
+	return -1;
+
+failed:
+	fprintf(stderr, "%s: -Xtune out of memory\n", comp_name);
+	return -1;
+}
+
 void lzma_xz_usage(int lzmaver)
 {
 	fprintf(stderr, "\t  -Xpreset <preset>\n");
@@ -341,6 +599,13 @@ void lzma_xz_usage(int lzmaver)
 	fprintf(stderr, "\t  -Xe\n");
 	fprintf(stderr, "\t\tTry to improve compression ratio by using more ");
 	fprintf(stderr, "CPU time.\n");
+	if(lzmaver == LZMA_OPT_LZMA) {
+		fprintf(stderr, "\t  -Xtune\n");
+		fprintf(stderr, "\t\tPick the lc, lp, pb, fb and dict-size that ");
+		fprintf(stderr, "compress blocks\n\t\tsampled from the sources ");
+		fprintf(stderr, "smallest.  Options given are\n\t\tkept, and ");
+		fprintf(stderr, "lc + lp is at most 4\n");
+	}
 	fprintf(stderr, "\t  -Xlc <lc>\n");
 	fprintf(stderr, "\t\tNumber of literal context bits (0-4, default 3)\n");
 	fprintf(stderr, "\t  -Xlp <lp>\n");
@@ -89,6 +89,17 @@ enum {
 	LZMA_OPT_XZ
 };
 
+/* -Xtune: sample blocks, and the most of them kept in memory */
+#define LZMA_TUNE_BLOCKS	32
+#define LZMA_TUNE_BYTES		(8 * 1024 * 1024)
+
+/* options given on the command line, which -Xtune leaves alone */
+#define LZMA_OPT_SET_LC		1
+#define LZMA_OPT_SET_LP		2
+#define LZMA_OPT_SET_PB		4
+#define LZMA_OPT_SET_FB		8
+#define LZMA_OPT_SET_DICT	16
+
 struct lzma_xz_options {
 	int preset;
 	int extreme;
@@ -98,8 +109,13 @@ struct lzma_xz_options {
 	int fb;
 	int dict_size;
 	int flags;
+	int tune;
+	int set;
 };
 
+typedef int (*lzma_xz_compress_fn)(struct lzma_xz_options *, void *, void *,
+	int, int, int *);
+
 struct lzma_xz_options *lzma_xz_get_options(void);
 
 int lzma_xz_options(char *argv[], int argc, int lzmaver);
@@ -110,6 +126,11 @@ void *lzma_xz_dump_options(int block_size, int *size, int flags);
 
 int lzma_xz_extract_options(int block_size, void *buffer, int size, int lzmaver);
 
+int lzma_xz_tune_blocks(int block_size);
+
+int lzma_xz_tune(void *samples, int *sizes, int count, int block_size,
+	int threads, int lzmaver, lzma_xz_compress_fn compress);
+
 void lzma_xz_usage(int lzmaver);
 
 #endif
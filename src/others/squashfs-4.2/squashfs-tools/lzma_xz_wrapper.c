@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <lzma.h>
 
 #include "squashfs_fs.h"
@@ -36,15 +37,18 @@
 #define LZMA_OPTIONS 5
 #define MEMLIMIT (32 * 1024 * 1024)
 
-static int lzma_compress(void *dummy, void *dest, void *src,  int size,
-	int block_size, int *error)
+/*
+ * strm is kept from block to block by each deflator thread, and setting
+ * up the lzma_alone encoder again on it reuses the match finder tables
+ * once allocated, rather than allocating them again for every block
+ */
+static int lzma_compress_stream(lzma_stream *strm, struct lzma_xz_options *opts,
+	void *dest, void *src, int size, int block_size, int *error)
 {
 	uint32_t preset;
 	unsigned char *d = (unsigned char *) dest;
-	struct lzma_xz_options *opts = lzma_xz_get_options();
 
 	lzma_options_lzma opt;
-	lzma_stream strm = LZMA_STREAM_INIT;
 	int res;
 
 	preset = opts->preset;
@@ -61,19 +65,16 @@ static int lzma_compress(void *dummy, void *dest, void *src,  int size,
 
 	opt.dict_size = opts->dict_size;
 
-	res = lzma_alone_encoder(&strm, &opt);
-	if(res != LZMA_OK) {
-		lzma_end(&strm);
+	res = lzma_alone_encoder(strm, &opt);
+	if(res != LZMA_OK)
 		goto failed;
-	}
 
-	strm.next_out = dest;
-	strm.avail_out = block_size;
-	strm.next_in = src;
-	strm.avail_in = size;
+	strm->next_out = dest;
+	strm->avail_out = block_size;
+	strm->next_in = src;
+	strm->avail_in = size;
 
-	res = lzma_code(&strm, LZMA_FINISH);
-	lzma_end(&strm);
+	res = lzma_code(strm, LZMA_FINISH);
 
 	if(res == LZMA_STREAM_END) {
 		/*
@@ -92,7 +93,7 @@ static int lzma_compress(void *dummy, void *dest, void *src,  int size,
 		d[LZMA_PROPS_SIZE + 6] = 0;
 		d[LZMA_PROPS_SIZE + 7] = 0;
 
-		return (int) strm.total_out;
+		return (int) strm->total_out;
 	}
 
 	if(res == LZMA_OK)
@@ -111,18 +112,52 @@ failed:
 }
 
 
-static int lzma_uncompress(void *dest, void *src, int size, int block_size,
-	int *error)
+static int lzma_compress_opts(struct lzma_xz_options *opts, void *dest,
+	void *src, int size, int block_size, int *error)
 {
 	lzma_stream strm = LZMA_STREAM_INIT;
+	int res = lzma_compress_stream(&strm, opts, dest, src, size,
+		block_size, error);
+
+	lzma_end(&strm);
+	return res;
+}
+
+
+static int lzma_init(void **strm, int block_size, int datablock)
+{
+	lzma_stream *stream = *strm = malloc(sizeof(lzma_stream));
+
+	if(stream == NULL)
+		return -1;
+
+	memset(stream, 0, sizeof(lzma_stream));
+	return 0;
+}
+
+
+static int lzma_compress(void *strm, void *dest, void *src,  int size,
+	int block_size, int *error)
+{
+	if(strm == NULL)
+		return lzma_compress_opts(lzma_xz_get_options(), dest, src,
+			size, block_size, error);
+
+	return lzma_compress_stream(strm, lzma_xz_get_options(), dest, src,
+		size, block_size, error);
+}
+
+
+static int lzma_uncompress_stream(void *stream, void *dest, void *src,
+	int size, int block_size, int *error)
+{
+	lzma_stream *strm = stream;
 	int uncompressed_size = 0, res;
 	unsigned char lzma_header[LZMA_HEADER_SIZE];
 
-	res = lzma_alone_decoder(&strm, MEMLIMIT);
-	if(res != LZMA_OK) {
-		lzma_end(&strm);
+	res = lzma_alone_decoder(strm, MEMLIMIT);
+	if(res != LZMA_OK)
 		goto failed;
-	}
 
 	memcpy(lzma_header, src, LZMA_HEADER_SIZE);
 	uncompressed_size = lzma_header[LZMA_PROPS_SIZE] |
@@ -131,26 +166,23 @@ static int lzma_uncompress(void *dest, void *src, int size, int block_size,
 		(lzma_header[LZMA_PROPS_SIZE + 3] << 24);
 	memset(lzma_header + LZMA_PROPS_SIZE, 255, LZMA_UNCOMP_SIZE);
 
-	strm.next_out = dest;
-	strm.avail_out = block_size;
-	strm.next_in = lzma_header;
-	strm.avail_in = LZMA_HEADER_SIZE;
+	strm->next_out = dest;
+	strm->avail_out = block_size;
+	strm->next_in = lzma_header;
+	strm->avail_in = LZMA_HEADER_SIZE;
 
-	res = lzma_code(&strm, LZMA_RUN);
+	res = lzma_code(strm, LZMA_RUN);
 
-	if(res != LZMA_OK || strm.avail_in != 0) {
-		lzma_end(&strm);
+	if(res != LZMA_OK || strm->avail_in != 0)
 		goto failed;
-	}
 
-	strm.next_in = src + LZMA_HEADER_SIZE;
-	strm.avail_in = size - LZMA_HEADER_SIZE;
+	strm->next_in = src + LZMA_HEADER_SIZE;
+	strm->avail_in = size - LZMA_HEADER_SIZE;
 
-	res = lzma_code(&strm, LZMA_FINISH);
-	lzma_end(&strm);
+	res = lzma_code(strm, LZMA_FINISH);
 
 	if(res == LZMA_STREAM_END || (res == LZMA_OK &&
-		strm.total_out >= uncompressed_size && strm.avail_in == 0))
+		strm->total_out >= uncompressed_size && strm->avail_in == 0))
 		return uncompressed_size;
 
 failed:
@@ -158,6 +190,35 @@ failed:
 	return -1;
 }
 
+
+static int lzma_uncompress(void *dest, void *src, int size, int block_size,
+	int *error)
+{
+	lzma_stream strm = LZMA_STREAM_INIT;
+	int res = lzma_uncompress_stream(&strm, dest, src, size, block_size,
+		error);
+
+	lzma_end(&strm);
+	return res;
+}
+
+
+static void *lzma_uncompress_init(int block_size)
+{
+	lzma_stream *strm = malloc(sizeof(lzma_stream));
+
+	if(strm)
+		memset(strm, 0, sizeof(lzma_stream));
+	return strm;
+}
+
+
+static void lzma_uncompress_free(void *strm)
+{
+	lzma_end(strm);
+	free(strm);
+}
+
 static int lzma_options(char *argv[], int argc)
 {
 	return lzma_xz_options(argv, argc, LZMA_OPT_LZMA);
@@ -170,6 +231,20 @@ static int lzma_options_post(int block_size)
 }
 
 
+static int lzma_tune_blocks(int block_size)
+{
+	return lzma_xz_tune_blocks(block_size);
+}
+
+
+static int lzma_tune(void *samples, int *sizes, int count, int block_size,
+	int threads)
+{
+	return lzma_xz_tune(samples, sizes, count, block_size, threads,
+		LZMA_OPT_LZMA, lzma_compress_opts);
+}
+
+
 static void *lzma_dump_options(int block_size, int *size)
 {
 	return lzma_xz_dump_options(block_size, size, 0);
@@ -189,11 +264,16 @@ void lzma_usage()
 
 
 struct compressor lzma_comp_ops = {
-	.init = NULL,
+	.init = lzma_init,
 	.compress = lzma_compress,
 	.uncompress = lzma_uncompress,
+	.uncompress_init = lzma_uncompress_init,
+	.uncompress_stream = lzma_uncompress_stream,
+	.uncompress_free = lzma_uncompress_free,
 	.options = lzma_options,
 	.options_post = lzma_options_post,
+	.tune_blocks = lzma_tune_blocks,
+	.tune = lzma_tune,
 	.dump_options = lzma_dump_options,
 	.extract_options = lzma_extract_options,
 	.usage = lzma_usage,
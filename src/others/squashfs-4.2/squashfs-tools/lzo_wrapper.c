@@ -22,6 +22,7 @@
  * lzo_wrapper.c
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -29,26 +30,211 @@
 #include <lzo/lzo1x.h>
 
 #include "squashfs_fs.h"
+#include "lzo_wrapper.h"
 #include "compressor.h"
 
 /* worst-case expansion calculation during compression,
    see LZO FAQ for more information */
 #define LZO_OUTPUT_BUFFER_SIZE(size)	(size + (size/16) + 64 + 3)
 
+/*
+ * In the hybrid mode lzo1x_999 is only tried on blocks lzo1x_1 got
+ * below 7/8 of their size, the rest gain too little to be worth it
+ */
+#define LZO_HYBRID_THRESHOLD(size)	((size) - (size) / 8)
+
 struct lzo_stream {
 	lzo_voidp wrkmem;
 	lzo_bytep out;
 };
 
+static struct lzo_algorithm {
+	char *name;
+	lzo_uint32 wrkmem;
+	lzo_compress_t compress;
+} lzo_algorithm[SQUASHFS_LZO_ALGORITHMS] = {
+	[SQUASHFS_LZO1X_1] = { "lzo1x_1", LZO1X_1_MEM_COMPRESS,
+		lzo1x_1_compress },
+	[SQUASHFS_LZO1X_1_11] = { "lzo1x_1_11", LZO1X_1_11_MEM_COMPRESS,
+		lzo1x_1_11_compress },
+	[SQUASHFS_LZO1X_1_12] = { "lzo1x_1_12", LZO1X_1_12_MEM_COMPRESS,
+		lzo1x_1_12_compress },
+	[SQUASHFS_LZO1X_1_15] = { "lzo1x_1_15", LZO1X_1_15_MEM_COMPRESS,
+		lzo1x_1_15_compress },
+	/* compressed with lzo1x_999_compress_level() instead */
+	[SQUASHFS_LZO1X_999] = { "lzo1x_999", LZO1X_999_MEM_COMPRESS, NULL }
+};
+
+static int algorithm = SQUASHFS_LZO1X_999;
+static int compression_level = SQUASHFS_LZO1X_999_COMP_DEFAULT;
+static int user_comp_level = -1;
+static int hybrid = 0;
+
+static struct lzo_comp_opts comp_opts;
+
+
+/*
+ * This function is called by the options parsing code in mksquashfs.c
+ * to parse any -X compressor option.
+ *
+ * -Xalgorithm chooses lzo1x_1, lzo1x_1_11, lzo1x_1_12, lzo1x_1_15 or
+ * lzo1x_999 (the default), or hybrid, which compresses each block with
+ * lzo1x_1 first and only tries lzo1x_999 on those that compress well.
+ * -Xcompression-level sets the lzo1x_999 level, 1 to 9.
+ *
+ * Returns -1 for an unrecognised option, -2 for a bad option, or the
+ * number of arguments taken otherwise
+ */
+static int lzo_options(char *argv[], int argc)
+{
+	int i;
+
+	if(strcmp(argv[0], "-Xalgorithm") == 0) {
+		if(argc < 2) {
+			fprintf(stderr, "lzo: -Xalgorithm missing algorithm\n");
+			return -2;
+		}
+
+		if(strcmp(argv[1], "hybrid") == 0) {
+			algorithm = SQUASHFS_LZO1X_999;
+			hybrid = 1;
+			return 1;
+		}
+
+		for(i = 0; i < SQUASHFS_LZO_ALGORITHMS; i++)
+			if(strcmp(argv[1], lzo_algorithm[i].name) == 0) {
+				algorithm = i;
+				hybrid = 0;
+				return 1;
+			}
+
+		fprintf(stderr, "lzo: -Xalgorithm unrecognised algorithm\n");
+		return -2;
+	} else if(strcmp(argv[0], "-Xcompression-level") == 0) {
+		if(argc < 2) {
+			fprintf(stderr, "lzo: -Xcompression-level missing "
+				"compression level\n");
+			return -2;
+		}
+
+		user_comp_level = atoi(argv[1]);
+		if(user_comp_level < 1 || user_comp_level > 9) {
+			fprintf(stderr, "lzo: -Xcompression-level should be 1 "
+				"to 9\n");
+			return -2;
+		}
+		return 1;
+	}
+
+	return -1;
+}
+
+
+static int lzo_options_post(int block_size)
+{
+	if(user_comp_level == -1)
+		return 0;
+
+	if(algorithm != SQUASHFS_LZO1X_999) {
+		fprintf(stderr, "lzo: -Xcompression-level is only for "
+			"lzo1x_999 and hybrid\n");
+		return -1;
+	}
+
+	compression_level = user_comp_level;
+	return 0;
+}
+
+
+/*
+ * Nothing is stored for lzo1x_999 at its default level, as the
+ * filesystems made before these options were, so they stay the same
+ */
+static void *lzo_dump_options(int block_size, int *size)
+{
+	if(algorithm == SQUASHFS_LZO1X_999 &&
+			compression_level == SQUASHFS_LZO1X_999_COMP_DEFAULT)
+		return NULL;
+
+	comp_opts.algorithm = algorithm;
+	comp_opts.compression_level = algorithm == SQUASHFS_LZO1X_999 ?
+		compression_level : 0;
+	SQUASHFS_INSWAP_LZO_COMP_OPTS(&comp_opts);
+
+	*size = sizeof(comp_opts);
+	return &comp_opts;
+}
+
+
+/*
+ * Appending carries on with the algorithm the filesystem was made
+ * with, except that hybrid is kept, as it's stored as lzo1x_999
+ */
+static int lzo_extract_options(int block_size, void *buffer, int size)
+{
+	struct lzo_comp_opts *opts = buffer;
+
+	if(size == 0) {
+		algorithm = SQUASHFS_LZO1X_999;
+		compression_level = SQUASHFS_LZO1X_999_COMP_DEFAULT;
+		return 0;
+	}
+
+	if(size != sizeof(struct lzo_comp_opts))
+		goto failed;
+
+	SQUASHFS_INSWAP_LZO_COMP_OPTS(opts);
+
+	if(opts->algorithm < 0 || opts->algorithm >= SQUASHFS_LZO_ALGORITHMS)
+		goto failed;
+
+	if(opts->algorithm == SQUASHFS_LZO1X_999) {
+		if(opts->compression_level < 1 ||
+				opts->compression_level > 9)
+			goto failed;
+		compression_level = opts->compression_level;
+	} else {
+		if(opts->compression_level != 0)
+			goto failed;
+		compression_level = SQUASHFS_LZO1X_999_COMP_DEFAULT;
+		hybrid = 0;
+	}
+
+	algorithm = opts->algorithm;
+	return 0;
+
+failed:
+	fprintf(stderr, "lzo: bad compressor options in the filesystem\n");
+	return -1;
+}
+
+
+static void lzo_usage()
+{
+	fprintf(stderr, "\t  -Xalgorithm <algorithm>\n");
+	fprintf(stderr, "\t\tCompress with <algorithm>, one of lzo1x_1, "
+		"lzo1x_1_11,\n\t\tlzo1x_1_12, lzo1x_1_15 or lzo1x_999 "
+		"(default), or hybrid,\n\t\twhich only tries lzo1x_999 on "
+		"blocks lzo1x_1 compresses well\n");
+	fprintf(stderr, "\t  -Xcompression-level <compression-level>\n");
+	fprintf(stderr, "\t\t<compression-level> should be 1 .. 9 "
+		"(default %d), for\n\t\tlzo1x_999 and hybrid only\n",
+		SQUASHFS_LZO1X_999_COMP_DEFAULT);
+}
+
 
 static int squashfs_lzo_init(void **strm, int block_size, int flags)
 {
 	struct lzo_stream *stream;
+	lzo_uint32 wrkmem = lzo_algorithm[algorithm].wrkmem;
+
+	if(hybrid && wrkmem < LZO1X_1_MEM_COMPRESS)
+		wrkmem = LZO1X_1_MEM_COMPRESS;
 
 	if((stream = *strm = malloc(sizeof(struct lzo_stream))) == NULL)
 		goto failed;
 	/* work memory for compression */
-	if((stream->wrkmem = malloc(LZO1X_999_MEM_COMPRESS)) == NULL)
+	if((stream->wrkmem = malloc(wrkmem)) == NULL)
 		goto failed2;
 	/* temporal output buffer */
 	if((stream->out = malloc(LZO_OUTPUT_BUFFER_SIZE(block_size))) == NULL)
@@ -69,17 +255,37 @@ static int lzo_compress(void *strm, void *d, void *s, int size, int block_size,
 		int *error)
 {
 	int res;
-	lzo_uint outlen;
+	lzo_uint outlen, best = size;
 	struct lzo_stream *stream = strm;
 
-	res = lzo1x_999_compress(s, size, stream->out, &outlen, stream->wrkmem);
+	if(hybrid) {
+		res = lzo1x_1_compress(s, size, stream->out, &outlen,
+			stream->wrkmem);
+		if(res != LZO_E_OK)
+			goto failed;
+		if(outlen >= size)
+			return 0;
+
+		memcpy(d, stream->out, outlen);
+		if(outlen > LZO_HYBRID_THRESHOLD(size))
+			return outlen;
+		best = outlen;
+	}
+
+	if(algorithm == SQUASHFS_LZO1X_999)
+		res = lzo1x_999_compress_level(s, size, stream->out, &outlen,
+			stream->wrkmem, NULL, 0, NULL, compression_level);
+	else
+		res = lzo_algorithm[algorithm].compress(s, size, stream->out,
+			&outlen, stream->wrkmem);
 	if(res != LZO_E_OK)
 		goto failed;
-	if(outlen >= size)
+	if(outlen >= best)
 		/*
-		 * Output buffer overflow. Return out of buffer space
+		 * Output buffer overflow. Return out of buffer space, or
+		 * the lzo1x_1 block already in d if that did better
 		 */
-		return 0;
+		return best == size ? 0 : best;
 
 	/*
 	 * Success, return the compressed size.
@@ -113,8 +319,11 @@ struct compressor lzo_comp_ops = {
 	.init = squashfs_lzo_init,
 	.compress = lzo_compress,
 	.uncompress = lzo_uncompress,
-	.options = NULL,
-	.usage = NULL,
+	.options = lzo_options,
+	.options_post = lzo_options_post,
+	.dump_options = lzo_dump_options,
+	.extract_options = lzo_extract_options,
+	.usage = lzo_usage,
 	.id = LZO_COMPRESSION,
 	.name = "lzo",
 	.supported = 1
@@ -39,11 +39,13 @@
 #include <dirent.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <signal.h>
 #include <setjmp.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <pthread.h>
 #include <math.h>
 #include <regex.h>
@@ -60,6 +62,7 @@
 #else
 #include <endian.h>
 #include <sys/sysinfo.h>
+#include <sys/syscall.h>
 #endif
 
 #ifdef __CYGWIN__
@@ -123,6 +126,16 @@
 #include "pseudo.h"
 #include "compressor.h"
 #include "xattr.h"
+#include "queue.h"
+#include "arena.h"
+#include "base_fs.h"
+#include "stream.h"
+#include "report.h"
+#include "pathmatch.h"
+#include "contenthash.h"
+#include "cpus.h"
+#include "estimate.h"
+#include "../../../fmkstats/fmkstats.h"
 
 int delete = FALSE;
 int fd;
@@ -137,6 +150,7 @@ int noI = 0, noD = 0;
 int silent = TRUE;
 long long global_uid = -1, global_gid = -1;
 int exportable = TRUE;
+int nopad = FALSE;
 int progress = TRUE;
 int progress_enabled = FALSE;
 int sparse_files = TRUE;
@@ -156,6 +170,7 @@ long long bytes = 0, total_bytes = 0;
 /* in memory directory table - possibly compressed */
 char *directory_table = NULL;
 unsigned int directory_bytes = 0, directory_size = 0, total_directory_bytes = 0;
+struct arena_table directory_map;
 
 /* cached directory table */
 char *directory_data_cache = NULL;
@@ -164,6 +179,7 @@ unsigned int directory_cache_bytes = 0, directory_cache_size = 0;
 /* in memory inode table - possibly compressed */
 char *inode_table = NULL;
 unsigned int inode_bytes = 0, inode_size = 0, total_inode_bytes = 0;
+struct arena_table inode_map;
 
 /* cached inode table */
 char *data_cache = NULL;
@@ -175,9 +191,7 @@ squashfs_inode *inode_lookup_table = NULL;
 /* in memory directory data */
 #define I_COUNT_SIZE		128
 #define DIR_ENTRIES		32
-#define INODE_HASH_SIZE		65536
-#define INODE_HASH_MASK		(INODE_HASH_SIZE - 1)
-#define INODE_HASH(dev, ino)	(ino & INODE_HASH_MASK)
+#define INODE_HASH_MIN		65536
 
 struct cached_dir_index {
 	struct squashfs_dir_index	index;
@@ -198,12 +212,70 @@ struct directory {
 	unsigned int		inode_number;
 };
 
-struct inode_info *inode_info[INODE_HASH_SIZE];
+/*
+ * open addressed (linear probing) hash of the inode_infos on (st_dev,
+ * st_ino), doubled when half full.  The key is kept in the slot so probes
+ * don't touch the inode_infos themselves
+ */
+struct inode_slot {
+	dev_t			dev;
+	ino_t			ino;
+	struct inode_info	*inode;
+};
+
+struct inode_slot *inode_hash = NULL;
+unsigned int inode_hash_size = 0, inode_hash_count = 0;
+
+/*
+ * the source tree (dir_infos, dir_ents, inode_infos and their names) and
+ * the duplicate file records live until mksquashfs exits and are allocated
+ * from tree_arena, strings only needed while scanning come from
+ * scan_arena, which is freed once the scan is complete.  With -spill the
+ * arenas, the block lists of the duplicate file records and the inode and
+ * directory tables are mapped from files, see arena.c, which leaves only
+ * the hash tables below and the queues in memory
+ */
+struct arena tree_arena, scan_arena;
+int spill = FALSE;
 
 /* hash tables used to do fast duplicate searches in duplicate check */
 struct file_info *dupl[65536];
+/* files with a content hash, indexed by the hash */
+struct file_info *dupl_content[65536];
 int dup_files = 0;
 
+/*
+ * -block-dedup index of the data blocks written, in disk order, chained by
+ * a hash of their compressed contents.  Chains hold index + 1, 0 ends them
+ */
+struct block_info {
+	long long		start;
+	unsigned int		c_byte;
+	unsigned long long	hash[2];
+	int			next;
+};
+int block_dedup = FALSE;
+struct block_info *block_info = NULL;
+int block_info_count = 0, block_info_size = 0;
+int block_table[65536];
+int dup_blocks = 0;
+
+/*
+ * -store-incompressible, data blocks which look already compressed are
+ * stored without trying to compress them
+ */
+#define INCOMPRESSIBLE_BITS	7.99
+#define INCOMPRESSIBLE_MIN	4096
+int store_incompressible = FALSE;
+int incompressible_blocks = 0;
+
+/* -base image, unchanged files have their blocks copied from it */
+char *base_image = NULL;
+int base_files = 0;
+
+/* -report file, the kind of report is in report (report.c) */
+char *report_filename = NULL;
+
 /* exclude file handling */
 /* list of exclude dirs/files */
 struct exclude_info {
@@ -216,23 +288,6 @@ int exclude = 0;
 struct exclude_info *exclude_paths = NULL;
 int old_excluded(char *filename, struct stat *buf);
 
-struct path_entry {
-	char *name;
-	regex_t *preg;
-	struct pathname *paths;
-};
-
-struct pathname {
-	int names;
-	struct path_entry *name;
-};
-
-struct pathnames {
-	int count;
-	struct pathname *path[0];
-};
-#define PATHS_ALLOC_SIZE 10
-
 struct pathnames *paths = NULL;
 struct pathname *path = NULL;
 struct pathname *stickypath = NULL;
@@ -240,8 +295,30 @@ int excluded(struct pathnames *paths, char *name, struct pathnames **new);
 
 /* fragment block data structures */
 int fragments = 0;
-struct file_buffer *fragment_data = NULL;
-int fragment_size = 0;
+
+/*
+ * Tails are packed into the fragment being filled for their group.  By
+ * default there's one group, so tails are packed in the order files are
+ * written.  -pack-fragments keys the groups on the file's extension (or
+ * kind of contents) and -sort priority, keeping up to FRAG_GROUPS
+ * fragments open and writing out the least recently used one when a new
+ * group needs its slot
+ */
+#define FRAG_GROUPS	16
+struct frag_group {
+	unsigned int		key;
+	struct file_buffer	*data;
+	int			size;
+	long long		used;
+};
+struct frag_group frag_group[FRAG_GROUPS];
+int frag_groups = 1;
+long long frag_group_clock = 0;
+int pack_fragments = FALSE;
+/* priority of the file being written, set by sort_files_and_write */
+int fragment_priority = 0;
+/* set by sort_files_and_write when the file was placed by -sort-trace */
+int fragment_boot = FALSE;
 
 struct fragment {
 	unsigned int		index;
@@ -249,12 +326,49 @@ struct fragment {
 	int			size;
 };
 
+/*
+ * -stream input, the data of regular files is written in stream order as
+ * the stream is read, before the directory tree (and so the inode numbers
+ * and link counts) is known.  create_inode() saves what it's given for the
+ * file inode, which is created by dir_scan3() with the rest of the tree
+ */
+struct deferred_file {
+	long long		file_size;
+	long long		start;
+	long long		sparse;
+	unsigned int		*block_list;
+	int			blocks;
+	int			duplicate;
+	struct fragment		*fragment;
+};
+
+int stream_input = FALSE, defer_inodes = FALSE;
+struct queue *to_stream;
+/* stream inodes aren't in the inode hash table, they're chained here */
+struct inode_info *stream_inodes = NULL;
+
 #define FRAG_SIZE 32768
 #define FRAG_INDEX (1LL << 32)
 
 struct squashfs_fragment_entry *fragment_table = NULL;
 int fragments_outstanding = 0;
 
+/*
+ * -reproducible, fragments are placed in the order the main thread queued
+ * them rather than the order the deflators finish them.  Finished
+ * fragments wait in a ring of the last FRAG_REORDER queued, and the
+ * main thread commits the oldest when it needs the slot, so fragments
+ * land at the same points between the data blocks every time
+ */
+#define FRAG_REORDER	64
+int reproducible = FALSE;
+struct file_buffer *frag_reorder[FRAG_REORDER];
+unsigned int frag_reorder_head = 0, frag_reorder_tail = 0;
+
+/* -reproducible timestamps, clamped to SOURCE_DATE_EPOCH if it's set */
+int clamp_time = FALSE;
+time_t source_date_epoch = 0;
+
 /* current inode number for directories and non directories */
 unsigned int dir_inode_no = 1;
 unsigned int inode_no = 0;
@@ -283,6 +397,9 @@ struct file_info {
 	struct file_info	*next;
 	struct fragment		*fragment;
 	char			checksum_flag;
+	char			content_hashed;
+	unsigned long long	content_hash[2];
+	struct file_info	*content_next;
 };
 
 /* count of how many times SIGINT or SIGQUIT has been sent */
@@ -333,6 +450,15 @@ struct file_buffer {
 	int used;
 	int	fragment;
 	int error;
+	/* the number of small files in a reader batch, 0 for one file */
+	int batch;
+	/* a block of zeros the reader found in a hole, and didn't read */
+	int hole;
+	/*
+	 * set if the data came from this -base image file, data blocks are
+	 * then still compressed (c_byte is set)
+	 */
+	struct base_file *base;
 	struct file_buffer *hash_next;
 	struct file_buffer *hash_prev;
 	struct file_buffer *free_next;
@@ -342,15 +468,15 @@ struct file_buffer {
 };
 
 
-/* struct describing queues used to pass data between threads */
-struct queue {
+/* a metadata block compressed by compress_metadata() */
+struct meta_block {
+	char			*src;
 	int			size;
-	int			readp;
-	int			writep;
-	pthread_mutex_t		mutex;
-	pthread_cond_t		empty;
-	pthread_cond_t		full;
-	void			**data;
+	int			uncompressed;
+	int			c_byte;
+	/* the stored block, its c_byte header and data */
+	int			bytes;
+	char			data[BLOCK_OFFSET + SQUASHFS_METADATA_SIZE];
 };
 
 
@@ -371,9 +497,20 @@ unsigned int uid_count = 0, guid_count = 0;
 unsigned int sid_count = 0, suid_count = 0, sguid_count = 0;
 
 struct cache *reader_buffer, *writer_buffer, *fragment_buffer;
+/*
+ * compressed fragments, the writer_buffer except with -reproducible where
+ * the main thread may wait on a fragment while the data blocks it hasn't
+ * taken yet hold all the writer_buffer
+ */
+struct cache *frag_writer_buffer;
 struct queue *to_reader, *from_reader, *to_writer, *from_writer, *from_deflate,
-	*to_frag;
-pthread_t *thread, *deflator_thread, *frag_deflator_thread, progress_thread;
+	*to_frag, *to_meta;
+pthread_t *thread, *deflator_thread, progress_thread;
+
+/* idle deflator threads wait here for data blocks or fragments to compress */
+pthread_mutex_t deflator_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t deflator_waiting = PTHREAD_COND_INITIALIZER;
+volatile int deflators_idle = 0;
 pthread_mutex_t	fragment_mutex;
 pthread_cond_t fragment_waiting;
 pthread_mutex_t	pos_mutex;
@@ -392,6 +529,34 @@ int processors = -1;
 #define FRAGMENT_BUFFER_DEFAULT 64
 int writer_buffer_size;
 
+/*
+ * -mem, the read, write and fragment caches share a budget.  Every
+ * AUTOSIZE_USECS the main thread moves 1/AUTOSIZE_STEPS of it to the cache
+ * threads waited on most from one nobody waited on with buffers to spare
+ */
+#define AUTOSIZE_USECS		100000
+#define AUTOSIZE_STEPS		32
+int mem_mbytes = 0;
+
+/*
+ * The fewest buffers a cache can run with, counted in buffers as a large
+ * block size leaves few to the Mbyte.  The read and write caches need one
+ * for the reader or writer, one for the main thread and two per deflator.
+ * The fragment cache needs one per open fragment group, as many again
+ * queued to the deflators, one being compressed and one for get_fragment()
+ * to read a fragment back into
+ */
+#define MEM_MIN_BUFFERS(processors)	(2 * (processors) + 2)
+#define MEM_MIN_FRAGMENT(groups)	(2 * (groups) + 2)
+struct autosize {
+	char		*name;
+	struct cache	*cache;
+	int		waits;
+	int		floor;
+} autosize[3];
+int autosize_step;
+long long autosize_last = 0;
+
 /* compression operations */
 static struct compressor *comp;
 int compressor_opts_parsed = 0;
@@ -420,84 +585,34 @@ extern long long read_filesystem(char *root_name, int fd,
 	struct squashfs_fragment_entry **fragment_table,
 	squashfs_inode **inode_lookup_table);
 extern int read_sort_file(char *filename, int source, char *source_path[]);
+extern int read_trace_file(char *filename, int source, char *source_path[]);
 extern void sort_files_and_write(struct dir_info *dir);
 struct file_info *duplicate(long long file_size, long long bytes,
 	unsigned int **block_list, long long *start, struct fragment **fragment,
 	struct file_buffer *file_buffer, int blocks, unsigned short checksum,
-	unsigned short fragment_checksum, int checksum_flag);
+	unsigned short fragment_checksum, int checksum_flag,
+	unsigned long long *content_hash);
 struct dir_info *dir_scan1(char *, struct pathnames *, int (_readdir)(char *,
 	char *, struct dir_info *));
 struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo);
 void dir_scan3(squashfs_inode *inode, struct dir_info *dir_info);
 struct file_info *add_non_dup(long long file_size, long long bytes,
-	unsigned int *block_list, long long start, struct fragment *fragment,
-	unsigned short checksum, unsigned short fragment_checksum,
-	int checksum_flag);
+	unsigned int *block_list, int blocks, long long start,
+	struct fragment *fragment, unsigned short checksum,
+	unsigned short fragment_checksum, int checksum_flag,
+	unsigned long long *content_hash);
 extern int generate_file_priorities(struct dir_info *dir, int priority,
 	struct stat *buf);
 extern struct priority_entry *priority_list[65536];
 void progress_bar(long long current, long long max, int columns);
 long long generic_write_table(int, void *, int, void *, int);
 void restorefs();
-
-
-struct queue *queue_init(int size)
-{
-	struct queue *queue = malloc(sizeof(struct queue));
-
-	if(queue == NULL)
-		goto failed;
-
-	queue->data = malloc(sizeof(void *) * (size + 1));
-	if(queue->data == NULL) {
-		free(queue);
-		goto failed;
-	}
-
-	queue->size = size + 1;
-	queue->readp = queue->writep = 0;
-	pthread_mutex_init(&queue->mutex, NULL);
-	pthread_cond_init(&queue->empty, NULL);
-	pthread_cond_init(&queue->full, NULL);
-
-	return queue;
-
-failed:
-	BAD_ERROR("Out of memory in queue_init\n");
-}
-
-
-void queue_put(struct queue *queue, void *data)
-{
-	int nextp;
-
-	pthread_mutex_lock(&queue->mutex);
-
-	while((nextp = (queue->writep + 1) % queue->size) == queue->readp)
-		pthread_cond_wait(&queue->full, &queue->mutex);
-
-	queue->data[queue->writep] = data;
-	queue->writep = nextp;
-	pthread_cond_signal(&queue->empty);
-	pthread_mutex_unlock(&queue->mutex);
-}
-
-
-void *queue_get(struct queue *queue)
-{
-	void *data;
-	pthread_mutex_lock(&queue->mutex);
-
-	while(queue->readp == queue->writep)
-		pthread_cond_wait(&queue->empty, &queue->mutex);
-
-	data = queue->data[queue->readp];
-	queue->readp = (queue->readp + 1) % queue->size;
-	pthread_cond_signal(&queue->full);
-	pthread_mutex_unlock(&queue->mutex);
-
-	return data;
-}
+void deflate_put(struct queue *queue, void *data);
+void deflate_fragment(void *stream, struct file_buffer *file_buffer);
+void autosize_buffers();
+void wake_deflators();
+struct meta_block *compress_metadata(char *src, int length, int uncompressed,
+	int *blocks);
 
 
 /* Cache status struct.  Caches are used to keep
@@ -506,6 +621,9 @@ struct cache {
 	int	max_buffers;
 	int	count;
 	int	buffer_size;
+	/* buffers being used, and times cache_get had to wait for one */
+	int	in_use;
+	int	waits;
 	pthread_mutex_t	mutex;
 	pthread_cond_t wait_for_free;
 	struct file_buffer *free_list;
@@ -591,6 +709,8 @@ struct cache *cache_init(int buffer_size, int max_buffers)
 	cache->max_buffers = max_buffers;
 	cache->buffer_size = buffer_size;
 	cache->count = 0;
+	cache->in_use = 0;
+	cache->waits = 0;
 	cache->free_list = NULL;
 	memset(cache->hash_table, 0, sizeof(struct file_buffer *) * 65536);
 	pthread_mutex_init(&cache->mutex, NULL);
@@ -617,7 +737,8 @@ struct file_buffer *cache_lookup(struct cache *cache, long long index)
 		/* found the block in the cache, increment used count and
  		 * if necessary remove from free list so it won't disappear
  		 */
-		entry->used ++;
+		if(entry->used ++ == 0)
+			cache->in_use ++;
 		remove_free_list(&cache->free_list, entry);
 	}
 
@@ -658,14 +779,20 @@ struct file_buffer *cache_get(struct cache *cache, long long index, int keep)
 			remove_free_list(&cache->free_list, entry);
 			remove_hash_table(cache, entry);
 			break;
-		} else
+		} else {
 			/* wait for a block */
+			cache->waits ++;
 			pthread_cond_wait(&cache->wait_for_free, &cache->mutex);
+		}
 	}
 
 	/* initialise block and if a keep block insert into the hash table */
+	cache->in_use ++;
 	entry->used = 1;
 	entry->error = FALSE;
+	entry->base = NULL;
+	entry->batch = 0;
+	entry->hole = FALSE;
 	entry->keep = keep;
 	if(keep) {
 		entry->index = index;
@@ -713,7 +840,13 @@ void cache_block_put(struct file_buffer *entry)
 
 	entry->used --;
 	if(entry->used == 0) {
-		if(entry->keep)
+		cache->in_use --;
+		if(entry->keep && cache->count > cache->max_buffers) {
+			/* the cache has been shrunk */
+			remove_hash_table(cache, entry);
+			free(entry);
+			cache->count --;
+		} else if(entry->keep)
 			insert_free_list(&cache->free_list, entry);
 		else {
 			free(entry);
@@ -728,6 +861,27 @@ void cache_block_put(struct file_buffer *entry)
 }
 
 
+/*
+ * Change the number of buffers the cache can hold.  Unused buffers over
+ * the new size are freed now, buffers in use as they're put
+ */
+void cache_resize(struct cache *cache, int max_buffers)
+{
+	pthread_mutex_lock(&cache->mutex);
+	cache->max_buffers = max_buffers;
+	while(cache->count > max_buffers && cache->free_list) {
+		struct file_buffer *entry = cache->free_list;
+
+		remove_free_list(&cache->free_list, entry);
+		remove_hash_table(cache, entry);
+		free(entry);
+		cache->count --;
+	}
+	pthread_cond_broadcast(&cache->wait_for_free);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+
 #define MKINODE(A)	((squashfs_inode)(((squashfs_inode) inode_bytes << 16) \
 			+ (((char *)A) - data_cache)))
 
@@ -773,10 +927,10 @@ void restorefs()
 
 	ERROR("Exiting - restoring original filesystem!\n\n");
 
-	for(i = 0; i < 2 + processors * 2; i++)
+	for(i = 0; i < 2 + processors; i++)
 		if(thread[i])
 			pthread_kill(thread[i], SIGUSR1);
-	for(i = 0; i < 2 + processors * 2; i++)
+	for(i = 0; i < 2 + processors; i++)
 		waitforthread(i);
 	TRACE("All threads in signal handler\n");
 	bytes = sbytes;
@@ -801,7 +955,10 @@ void restorefs()
 	sock_count = ssock_count;
 	dup_files = sdup_files;
 	fragments = sfragments;
-	fragment_size = 0;
+	for(i = 0; i < frag_groups; i++)
+		frag_group[i].size = 0;
+	memset(frag_reorder, 0, sizeof(frag_reorder));
+	frag_reorder_head = frag_reorder_tail = 0;
 	id_count = sid_count;
 	restore_xattrs();
 	longjmp(env, 1);
@@ -833,7 +990,7 @@ void sigusr1_handler()
 	sigset_t sigmask;
 	pthread_t thread_id = pthread_self();
 
-	for(i = 0; i < (2 + processors * 2) && thread[i] != thread_id; i++);
+	for(i = 0; i < (2 + processors) && thread[i] != thread_id; i++);
 	thread[i] = (pthread_t) 0;
 
 	TRACE("Thread %d(%p) in sigusr1_handler\n", i, &thread_id);
@@ -879,8 +1036,13 @@ int mangle2(void *strm, char *d, char *s, int size,
 	int error, c_byte = 0;
 
 	if(!uncompressed) {
+		long long fmk_start;
+
+		FMK_STAGE_BEGIN(compress_block, fmk_start);
 		c_byte = compressor_compress(comp, strm, d, s, size, block_size,
 			 &error);
+		FMK_STAGE_END(compress_block, fmk_start, size,
+			c_byte > 0 ? c_byte : size);
 		if(c_byte == -1)
 			BAD_ERROR("mangle2:: %s compress failed with error "
 				"code %d\n", comp->name, error);
@@ -899,8 +1061,16 @@ int mangle2(void *strm, char *d, char *s, int size,
 int mangle(char *d, char *s, int size, int block_size,
 	int uncompressed, int data_block)
 {
-	return mangle2(stream, d, s, size, block_size, uncompressed,
+	long long start = REPORT_START();
+	int c_byte = mangle2(stream, d, s, size, block_size, uncompressed,
 		data_block);
+
+	if(report && !uncompressed)
+		report_compress(REPORT_METADATA, size, data_block ?
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte) :
+			SQUASHFS_COMPRESSED_SIZE(c_byte), start);
+
+	return c_byte;
 }
 
 
@@ -912,7 +1082,8 @@ void *get_inode(int req_size)
 	while(cache_bytes >= SQUASHFS_METADATA_SIZE) {
 		if((inode_size - inode_bytes) <
 				((SQUASHFS_METADATA_SIZE << 1)) + 2) {
-			void *it = realloc(inode_table, inode_size +
+			void *it = arena_table_resize(&inode_map, inode_table,
+				inode_size, inode_size +
 				(SQUASHFS_METADATA_SIZE << 1) + 2);
 			if(it == NULL) {
 				goto failed;
@@ -1050,15 +1221,16 @@ void write_destination(int fd, long long byte, int bytes, void *buff)
 
 long long write_inodes()
 {
-	unsigned short c_byte;
-	int avail_bytes;
-	char *datap = data_cache;
+	struct meta_block *block;
+	int i, blocks;
 	long long start_bytes = bytes;
 
-	while(cache_bytes) {
+	block = compress_metadata(data_cache, cache_bytes, noI, &blocks);
+	for(i = 0; i < blocks; i++) {
 		if(inode_size - inode_bytes <
 				((SQUASHFS_METADATA_SIZE << 1) + 2)) {
-			void *it = realloc(inode_table, inode_size +
+			void *it = arena_table_resize(&inode_map, inode_table,
+				inode_size, inode_size +
 				((SQUASHFS_METADATA_SIZE << 1) + 2));
 			if(it == NULL) {
 				BAD_ERROR("Out of memory in inode table "
@@ -1067,17 +1239,15 @@ long long write_inodes()
 			inode_size += (SQUASHFS_METADATA_SIZE << 1) + 2;
 			inode_table = it;
 		}
-		avail_bytes = cache_bytes > SQUASHFS_METADATA_SIZE ?
-			SQUASHFS_METADATA_SIZE : cache_bytes;
-		c_byte = mangle(inode_table + inode_bytes + BLOCK_OFFSET, datap,
-			avail_bytes, SQUASHFS_METADATA_SIZE, noI, 0);
-		TRACE("Inode block @ 0x%x, size %d\n", inode_bytes, c_byte);
-		SQUASHFS_SWAP_SHORTS(&c_byte, inode_table + inode_bytes, 1); 
-		inode_bytes += SQUASHFS_COMPRESSED_SIZE(c_byte) + BLOCK_OFFSET;
-		total_inode_bytes += avail_bytes + BLOCK_OFFSET;
-		datap += avail_bytes;
-		cache_bytes -= avail_bytes;
+		TRACE("Inode block @ 0x%x, size %d\n", inode_bytes,
+			block[i].c_byte);
+		memcpy(inode_table + inode_bytes, block[i].data,
+			block[i].bytes);
+		inode_bytes += block[i].bytes;
+		total_inode_bytes += block[i].size + BLOCK_OFFSET;
 	}
+	cache_bytes = 0;
+	free(block);
 
 	write_destination(fd, bytes, inode_bytes,  inode_table);
 	bytes += inode_bytes;
@@ -1088,15 +1258,17 @@ long long write_inodes()
 
 long long write_directories()
 {
-	unsigned short c_byte;
-	int avail_bytes;
-	char *directoryp = directory_data_cache;
+	struct meta_block *block;
+	int i, blocks;
 	long long start_bytes = bytes;
 
-	while(directory_cache_bytes) {
+	block = compress_metadata(directory_data_cache, directory_cache_bytes,
+		noI, &blocks);
+	for(i = 0; i < blocks; i++) {
 		if(directory_size - directory_bytes <
 				((SQUASHFS_METADATA_SIZE << 1) + 2)) {
-			void *dt = realloc(directory_table,
+			void *dt = arena_table_resize(&directory_map,
+				directory_table, directory_size,
 				directory_size + ((SQUASHFS_METADATA_SIZE << 1)
 				+ 2));
 			if(dt == NULL) {
@@ -1106,21 +1278,15 @@ long long write_directories()
 			directory_size += (SQUASHFS_METADATA_SIZE << 1) + 2;
 			directory_table = dt;
 		}
-		avail_bytes = directory_cache_bytes > SQUASHFS_METADATA_SIZE ?
-			SQUASHFS_METADATA_SIZE : directory_cache_bytes;
-		c_byte = mangle(directory_table + directory_bytes +
-			BLOCK_OFFSET, directoryp, avail_bytes,
-			SQUASHFS_METADATA_SIZE, noI, 0);
 		TRACE("Directory block @ 0x%x, size %d\n", directory_bytes,
-			c_byte);
-		SQUASHFS_SWAP_SHORTS(&c_byte,
-			directory_table + directory_bytes, 1);
-		directory_bytes += SQUASHFS_COMPRESSED_SIZE(c_byte) +
-			BLOCK_OFFSET;
-		total_directory_bytes += avail_bytes + BLOCK_OFFSET;
-		directoryp += avail_bytes;
-		directory_cache_bytes -= avail_bytes;
+			block[i].c_byte);
+		memcpy(directory_table + directory_bytes, block[i].data,
+			block[i].bytes);
+		directory_bytes += block[i].bytes;
+		total_directory_bytes += block[i].size + BLOCK_OFFSET;
 	}
+	directory_cache_bytes = 0;
+	free(block);
 	write_destination(fd, bytes, directory_bytes, directory_table);
 	bytes += directory_bytes;
 
@@ -1211,6 +1377,64 @@ unsigned int get_guid(unsigned int guid)
 }
 
 
+/*
+ * The time stamped on the filesystem and on directories made up by
+ * mksquashfs, fixed with -reproducible
+ */
+time_t build_time()
+{
+	return reproducible ? source_date_epoch : time(NULL);
+}
+
+
+time_t clamp_mtime(time_t mtime)
+{
+	return clamp_time && mtime > source_date_epoch ? source_date_epoch :
+		mtime;
+}
+
+
+void defer_file_inode(struct inode_info *inode, long long byte_size,
+	long long start_block, int blocks, unsigned int *block_list,
+	struct fragment *fragment, long long sparse)
+{
+	struct deferred_file *deferred = malloc(sizeof(struct deferred_file));
+
+	if(deferred == NULL || (blocks && (deferred->block_list =
+			malloc(blocks * sizeof(unsigned int))) == NULL))
+		BAD_ERROR("Out of memory in defer_file_inode\n");
+
+	deferred->file_size = byte_size;
+	deferred->start = start_block;
+	deferred->sparse = sparse;
+	deferred->blocks = blocks;
+	deferred->fragment = fragment;
+	deferred->duplicate = FALSE;
+	if(blocks)
+		memcpy(deferred->block_list, block_list, blocks *
+			sizeof(unsigned int));
+	else
+		deferred->block_list = NULL;
+	inode->deferred = deferred;
+}
+
+
+int read_symlink(struct dir_ent *dir_ent, char *buff)
+{
+	int byte;
+
+	if(dir_ent->inode->symlink == NULL)
+		return readlink(dir_ent->pathname, buff, 65536);
+
+	byte = strlen(dir_ent->inode->symlink);
+	if(byte >= 65536)
+		return 65536;
+	memcpy(buff, dir_ent->inode->symlink, byte);
+
+	return byte;
+}
+
+
 int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 	struct dir_ent *dir_ent, int type, long long byte_size,
 	long long start_block, unsigned int offset, unsigned int *block_list,
@@ -1225,7 +1449,21 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 	int inode_number = type == SQUASHFS_DIR_TYPE ?
 		dir_ent->inode->inode_number :
 		dir_ent->inode->inode_number + dir_inode_no;
-	int xattr = read_xattrs(dir_ent);
+	int xattr;
+
+	if(type == SQUASHFS_FILE_TYPE && report)
+		report_file(dir_ent, byte_size, offset, block_list,
+			fragment->index, fragment->offset, fragment->size,
+			sparse);
+
+	if(type == SQUASHFS_FILE_TYPE && defer_inodes) {
+		defer_file_inode(dir_ent->inode, byte_size, start_block, offset,
+			block_list, fragment, sparse);
+		*i_no = SQUASHFS_INVALID_BLK;
+		return TRUE;
+	}
+
+	xattr = read_xattrs(dir_ent);
 
 	switch(type) {
 	case SQUASHFS_FILE_TYPE:
@@ -1262,12 +1500,12 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 	}
 			
 	base->mode = SQUASHFS_MODE(buf->st_mode);
-	base->uid = get_uid((unsigned int) global_uid == -1 ?
-		buf->st_uid : global_uid);
+	base->uid = get_uid((unsigned int) global_uid == -1 ||
+		dir_ent->inode->pseudo_owner ? buf->st_uid : global_uid);
 	base->inode_type = type;
-	base->guid = get_guid((unsigned int) global_gid == -1 ?
-		buf->st_gid : global_gid);
-	base->mtime = buf->st_mtime;
+	base->guid = get_guid((unsigned int) global_gid == -1 ||
+		dir_ent->inode->pseudo_owner ? buf->st_gid : global_gid);
+	base->mtime = clamp_mtime(buf->st_mtime);
 	base->inode_number = inode_number;
 
 	if(type == SQUASHFS_FILE_TYPE) {
@@ -1419,7 +1657,7 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 		char buff[65536];
 		size_t off = offsetof(struct squashfs_symlink_inode_header, symlink);
 
-		byte = readlink(filename, buff, 65536);
+		byte = read_symlink(dir_ent, buff);
 		if(byte == -1) {
 			ERROR("Failed to read symlink %s, creating empty "
 				"symlink\n", filename);
@@ -1446,7 +1684,7 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 		char buff[65536];
 		size_t off = offsetof(struct squashfs_symlink_inode_header, symlink);
 
-		byte = readlink(filename, buff, 65536);
+		byte = read_symlink(dir_ent, buff);
 		if(byte == -1) {
 			ERROR("Failed to read symlink %s, creating empty "
 				"symlink\n", filename);
@@ -1500,6 +1738,22 @@ int create_inode(squashfs_inode *i_no, struct dir_info *dir_info,
 }
 
 
+void create_deferred_inode(squashfs_inode *i_no, struct dir_ent *dir_ent,
+	int *duplicate_file)
+{
+	struct deferred_file *deferred = dir_ent->inode->deferred;
+
+	create_inode(i_no, NULL, dir_ent, SQUASHFS_FILE_TYPE,
+		deferred->file_size, deferred->start, deferred->blocks,
+		deferred->block_list, deferred->fragment, NULL,
+		deferred->sparse);
+	*duplicate_file = deferred->duplicate;
+	free(deferred->block_list);
+	free(deferred);
+	dir_ent->inode->deferred = NULL;
+}
+
+
 void scan3_init_dir(struct directory *dir)
 {
 	dir->buff = malloc(SQUASHFS_METADATA_SIZE);
@@ -1657,7 +1911,8 @@ void write_dir(squashfs_inode *inode, struct dir_info *dir_info,
 
 		if((directory_size - directory_bytes) <
 					((SQUASHFS_METADATA_SIZE << 1) + 2)) {
-			void *dt = realloc(directory_table,
+			void *dt = arena_table_resize(&directory_map,
+				directory_table, directory_size,
 				directory_size + (SQUASHFS_METADATA_SIZE << 1)
 				+ 2);
 			if(dt == NULL) {
@@ -1743,7 +1998,7 @@ struct file_buffer *get_fragment(struct fragment *fragment)
 	if(buffer)
 		return buffer;
 
-	compressed_buffer = cache_lookup(writer_buffer, fragment->index +
+	compressed_buffer = cache_lookup(frag_writer_buffer, fragment->index +
 		FRAG_INDEX);
 
 	buffer = cache_get(fragment_buffer, fragment->index, 1);
@@ -1848,12 +2103,75 @@ void add_pending_fragment(struct file_buffer *write_buffer, int c_byte,
 }
 
 
-void write_fragment()
+/*
+ * Commit the oldest fragment in the -reproducible ring, waiting for it to
+ * be compressed if need be.  Must be called by the main thread with
+ * fragment_mutex held, outside the writing of a file's blocks.  The main
+ * thread compresses queued fragments itself meanwhile, the deflators may
+ * all be stuck waiting for write buffers held by blocks it hasn't taken
+ */
+void commit_fragment()
 {
-	if(fragment_size == 0)
-		return;
+	static void *frag_stream = NULL;
+	int slot = frag_reorder_tail % FRAG_REORDER;
+	struct file_buffer *write_buffer, *file_buffer;
+	int fragment;
+
+	while((write_buffer = frag_reorder[slot]) == NULL) {
+		if(queue_get_nowait(to_frag, (void **) &file_buffer)) {
+			pthread_mutex_unlock(&fragment_mutex);
+			if(frag_stream == NULL && compressor_init(comp,
+					&frag_stream, block_size, 1))
+				BAD_ERROR("commit_fragment:: compressor_init "
+					"failed\n");
+			deflate_fragment(frag_stream, file_buffer);
+			pthread_mutex_lock(&fragment_mutex);
+		} else
+			pthread_cond_wait(&fragment_waiting, &fragment_mutex);
+	}
+
+	frag_reorder[slot] = NULL;
+	frag_reorder_tail ++;
+
+	fragment = write_buffer->index - FRAG_INDEX;
+	fragment_table[fragment].start_block = bytes;
+	write_buffer->block = bytes;
+	bytes += write_buffer->size;
+	fragments_outstanding --;
+	queue_put(to_writer, write_buffer);
+	TRACE("reorder writing fragment %d, compressed size %d\n", fragment,
+		write_buffer->size);
+}
+
+
+/*
+ * Take the next slot in the -reproducible ring, committing the oldest
+ * fragment if the ring is full.  Must be called with fragment_mutex held
+ */
+int reorder_fragment()
+{
+	if(frag_reorder_head - frag_reorder_tail == FRAG_REORDER)
+		commit_fragment();
+
+	return frag_reorder_head ++ % FRAG_REORDER;
+}
+
 
+void commit_fragments()
+{
 	pthread_mutex_lock(&fragment_mutex);
+	while(frag_reorder_tail != frag_reorder_head)
+		commit_fragment();
+	pthread_mutex_unlock(&fragment_mutex);
+}
+
+
+/*
+ * Allocate the next fragment index, must be called with fragment_mutex
+ * held
+ */
+int alloc_fragment()
+{
 	if(fragments % FRAG_SIZE == 0) {
 		void *ft = realloc(fragment_table, (fragments +
 			FRAG_SIZE) * sizeof(struct squashfs_fragment_entry));
@@ -1863,42 +2181,200 @@ void write_fragment()
 		}
 		fragment_table = ft;
 	}
-	fragment_data->size = fragment_size;
-	fragment_data->block = fragments;
 	fragment_table[fragments].unused = 0;
+
+	return fragments ++;
+}
+
+
+void write_fragment(struct frag_group *group)
+{
+	if(group->size == 0)
+		return;
+
+	pthread_mutex_lock(&fragment_mutex);
+	group->data->size = group->size;
+	if(reproducible)
+		group->data->sequence = reorder_fragment();
 	fragments_outstanding ++;
-	queue_put(to_frag, fragment_data);
-	fragments ++;
-	fragment_size = 0;
+	deflate_put(to_frag, group->data);
+	group->size = 0;
 	pthread_mutex_unlock(&fragment_mutex);
 }
 
 
+void write_fragments()
+{
+	int i;
+
+	for(i = 0; i < frag_groups; i++)
+		write_fragment(&frag_group[i]);
+}
+
+
+/*
+ * Group key of a file's tail, its extension if it has one, otherwise the
+ * kind of its contents when the tail is the whole file
+ */
+unsigned int fragment_key(struct dir_ent *dir_ent,
+	struct file_buffer *file_buffer)
+{
+	char *ext = strrchr(dir_ent->name, '.');
+	unsigned int key = 5381;
+
+	if(ext && ext != dir_ent->name && ext[1])
+		for(ext ++; *ext; ext ++)
+			key = key * 33 + tolower(*ext);
+	else if(file_buffer->block == 0) {
+		unsigned char *data = (unsigned char *) file_buffer->data;
+		int i, size = file_buffer->size < 64 ? file_buffer->size : 64;
+
+		if(size >= 4 && memcmp(data, "\177ELF", 4) == 0)
+			key = 1;
+		else if(size >= 2 && data[0] == '#' && data[1] == '!')
+			key = 2;
+		else {
+			for(i = 0; i < size && (isprint(data[i]) ||
+					isspace(data[i])); i++);
+			key = i == size ? 3 : 4;
+		}
+	}
+
+	/* tails of files read at boot share fragments whatever their type */
+	if(fragment_boot)
+		return 0;
+
+	return key * 31 + fragment_priority;
+}
+
+
+struct frag_group *get_frag_group(unsigned int key)
+{
+	struct frag_group *group, *free_group = NULL, *lru = NULL;
+	int i;
+
+	for(i = 0; i < frag_groups; i++) {
+		group = &frag_group[i];
+		if(group->size == 0) {
+			if(free_group == NULL)
+				free_group = group;
+		} else if(group->key == key)
+			return group;
+		else if(lru == NULL || group->used < lru->used)
+			lru = group;
+	}
+
+	if(free_group == NULL) {
+		write_fragment(lru);
+		free_group = lru;
+	}
+
+	free_group->key = key;
+	return free_group;
+}
+
+
 static struct fragment empty_fragment = {SQUASHFS_INVALID_FRAG, 0, 0};
-struct fragment *get_and_fill_fragment(struct file_buffer *file_buffer)
+/*
+ * The tail of a file unchanged from the -base image is shared from a copy
+ * of its base fragment block, which is copied over still compressed the
+ * first time one of its files is written.  Tails in the block of files
+ * which did change are left in the copy unused
+ */
+struct fragment *get_base_fragment(struct file_buffer *file_buffer)
 {
+	struct base_file *base = file_buffer->base;
+	struct base_fragment *base_frag = lookup_base_fragment(base->fragment);
+	struct file_buffer *write_buffer;
 	struct fragment *ffrg;
-	
+	int size, index, locked;
+
+	if(base_frag->copy == 0) {
+		pthread_mutex_lock(&fragment_mutex);
+		index = alloc_fragment();
+		pthread_mutex_unlock(&fragment_mutex);
+
+		size = SQUASHFS_COMPRESSED_SIZE_BLOCK(base_frag->size);
+		write_buffer = cache_get(frag_writer_buffer, index + FRAG_INDEX,
+			1);
+		write_buffer->size = size;
+		if(read_base_bytes(base_frag->start_block, size,
+				write_buffer->data) == 0)
+			BAD_ERROR("Failed to read fragment from base image\n");
+
+		pthread_mutex_lock(&fragment_mutex);
+		fragment_table[index].size = base_frag->size;
+		locked = fragments_locked && !reproducible;
+		if(reproducible) {
+			write_buffer->c_byte = base_frag->size;
+			frag_reorder[reorder_fragment()] = write_buffer;
+			fragments_outstanding ++;
+		} else if(locked == FALSE) {
+			fragment_table[index].start_block = bytes;
+			write_buffer->block = bytes;
+			bytes += size;
+			queue_put(to_writer, write_buffer);
+		} else
+			fragments_outstanding ++;
+		pthread_mutex_unlock(&fragment_mutex);
+
+		if(locked)
+			add_pending_fragment(write_buffer, base_frag->size,
+				index);
+		base_frag->copy = index + 1;
+	}
+
+	ffrg = malloc(sizeof(struct fragment));
+	if(ffrg == NULL)
+		BAD_ERROR("Out of memory in fragment block allocation!\n");
+
+	ffrg->index = base_frag->copy - 1;
+	ffrg->offset = base->offset;
+	ffrg->size = file_buffer->size;
+
+	return ffrg;
+}
+
+
+struct fragment *get_and_fill_fragment(struct file_buffer *file_buffer,
+	struct dir_ent *dir_ent)
+{
+	struct fragment *ffrg;
+	struct frag_group *group;
 
 	if(file_buffer == NULL || file_buffer->size == 0)
 		return &empty_fragment;
 
-	if(fragment_size + file_buffer->size > block_size)
-		write_fragment();
+	if(file_buffer->base)
+		return get_base_fragment(file_buffer);
+
+	group = get_frag_group(pack_fragments ? fragment_key(dir_ent,
+		file_buffer) : 0);
+
+	if(group->size + file_buffer->size > block_size)
+		write_fragment(group);
 
 	ffrg = malloc(sizeof(struct fragment));
 	if(ffrg == NULL)
 		BAD_ERROR("Out of memory in fragment block allocation!\n");
 
-	if(fragment_size == 0)
-		fragment_data = cache_get(fragment_buffer, fragments, 1);
+	if(group->size == 0) {
+		int index;
+
+		pthread_mutex_lock(&fragment_mutex);
+		index = alloc_fragment();
+		pthread_mutex_unlock(&fragment_mutex);
+		group->data = cache_get(fragment_buffer, index, 1);
+		group->data->block = index;
+	}
 
-	ffrg->index = fragments;
-	ffrg->offset = fragment_size;
+	ffrg->index = group->data->block;
+	ffrg->offset = group->size;
 	ffrg->size = file_buffer->size;
-	memcpy(fragment_data->data + fragment_size, file_buffer->data,
+	memcpy(group->data->data + group->size, file_buffer->data,
 		file_buffer->size);
-	fragment_size += file_buffer->size;
+	group->size += file_buffer->size;
+	group->used = ++ frag_group_clock;
 
 	return ffrg;
 }
@@ -1910,32 +2386,24 @@ long long generic_write_table(int length, void *buffer, int length2,
 	int meta_blocks = (length + SQUASHFS_METADATA_SIZE - 1) /
 		SQUASHFS_METADATA_SIZE;
 	long long list[meta_blocks], start_bytes;
-	int compressed_size, i;
-	unsigned short c_byte;
-	char cbuffer[(SQUASHFS_METADATA_SIZE << 2) + 2];
+	struct meta_block *block;
+	int i;
 	
 #ifdef SQUASHFS_TRACE
 	long long obytes = bytes;
 	int olength = length;
 #endif
 
+	block = compress_metadata(buffer, length, uncompressed, &meta_blocks);
 	for(i = 0; i < meta_blocks; i++) {
-		int avail_bytes = length > SQUASHFS_METADATA_SIZE ?
-			SQUASHFS_METADATA_SIZE : length;
-		c_byte = mangle(cbuffer + BLOCK_OFFSET, buffer + i *
-			SQUASHFS_METADATA_SIZE , avail_bytes,
-			SQUASHFS_METADATA_SIZE, uncompressed, 0);
-		SQUASHFS_SWAP_SHORTS(&c_byte, cbuffer, 1);
 		list[i] = bytes;
-		compressed_size = SQUASHFS_COMPRESSED_SIZE(c_byte) +
-			BLOCK_OFFSET;
 		TRACE("block %d @ 0x%llx, compressed size %d\n", i, bytes,
-			compressed_size);
-		write_destination(fd, bytes, compressed_size, cbuffer);
-		bytes += compressed_size;
-		total_bytes += avail_bytes;
-		length -= avail_bytes;
+			block[i].bytes);
+		write_destination(fd, bytes, block[i].bytes, block[i].data);
+		bytes += block[i].bytes;
+		total_bytes += block[i].size;
 	}
+	free(block);
 
 	start_bytes = bytes;
 	if(length2) {
@@ -2007,11 +2475,15 @@ char *read_from_disk2(long long start, unsigned int avail_bytes)
 unsigned short get_checksum(char *buff, int bytes, unsigned short chksum)
 {
 	unsigned char *b = (unsigned char *) buff;
+	long long fmk_start;
+	int n = bytes;
 
+	FMK_STAGE_BEGIN(checksum, fmk_start);
 	while(bytes --) {
 		chksum = (chksum & 1) ? (chksum >> 1) | 0x8000 : chksum >> 1;
 		chksum += *b++;
 	}
+	FMK_STAGE_END(checksum, fmk_start, n, 2);
 
 	return chksum;
 }
@@ -2060,15 +2532,42 @@ unsigned short get_checksum_mem_buffer(struct file_buffer *file_buffer)
 }
 
 
-#define DUP_HASH(a) (a & 0xffff)
-void add_file(long long start, long long file_size, long long file_bytes,
-	unsigned int *block_listp, int blocks, unsigned int fragment,
-	int offset, int bytes)
+/*
+ * Returns the content hash of the file if the reader thread computed one
+ * (it doesn't for pseudo files or when not duplicate checking)
+ */
+unsigned long long *file_content_hash(struct dir_ent *dir_ent)
 {
-	struct fragment *frg;
-	unsigned int *block_list = block_listp;
-	struct file_info *dupl_ptr = dupl[DUP_HASH(file_size)];
-
+	return dir_ent->inode->content_hashed ? dir_ent->inode->content_hash :
+		NULL;
+}
+
+
+#define CONTENT_HASH(a) ((a)[0] & 0xffff)
+struct file_info *content_duplicate(long long file_size,
+	unsigned long long *content_hash)
+{
+	struct file_info *dupl_ptr = dupl_content[CONTENT_HASH(content_hash)];
+
+	for(; dupl_ptr; dupl_ptr = dupl_ptr->content_next)
+		if(file_size == dupl_ptr->file_size &&
+				content_hash[0] == dupl_ptr->content_hash[0] &&
+				content_hash[1] == dupl_ptr->content_hash[1])
+			return dupl_ptr;
+
+	return NULL;
+}
+
+
+#define DUP_HASH(a) (a & 0xffff)
+void add_file(long long start, long long file_size, long long file_bytes,
+	unsigned int *block_listp, int blocks, unsigned int fragment,
+	int offset, int bytes)
+{
+	struct fragment *frg;
+	unsigned int *block_list = block_listp;
+	struct file_info *dupl_ptr = dupl[DUP_HASH(file_size)];
+
 	if(!duplicate_checking || file_size == 0)
 		return;
 
@@ -2094,7 +2593,10 @@ void add_file(long long start, long long file_size, long long file_bytes,
 	frg->offset = offset;
 	frg->size = bytes;
 
-	add_non_dup(file_size, file_bytes, block_list, start, frg, 0, 0, FALSE);
+	add_non_dup(file_size, file_bytes, block_list, blocks, start, frg, 0, 0,
+		FALSE, NULL);
+	if(spill)
+		free(block_list);
 }
 
 
@@ -2110,13 +2612,21 @@ int pre_duplicate(long long file_size)
 }
 
 
-int pre_duplicate_frag(long long file_size, unsigned short checksum)
+int pre_duplicate_frag(long long file_size, struct file_buffer *file_buffer,
+	unsigned short *checksum, int *checksum_flag,
+	unsigned long long *content_hash)
 {
 	struct file_info *dupl_ptr = dupl[DUP_HASH(file_size)];
 
+	if(content_hash && content_duplicate(file_size, content_hash))
+		return TRUE;
+
 	for(; dupl_ptr; dupl_ptr = dupl_ptr->next)
 		if(file_size == dupl_ptr->file_size && file_size ==
 				dupl_ptr->fragment->size) {
+			if(content_hash && dupl_ptr->content_hashed)
+				/* hashes differ, it can't be a duplicate */
+				continue;
 			if(dupl_ptr->checksum_flag == FALSE) {
 				struct file_buffer *frag_buffer =
 					get_fragment(dupl_ptr->fragment);
@@ -2129,7 +2639,11 @@ int pre_duplicate_frag(long long file_size, unsigned short checksum)
 				cache_block_put(frag_buffer);
 				dupl_ptr->checksum_flag = TRUE;
 			}
-			if(dupl_ptr->fragment_checksum == checksum)
+			if(*checksum_flag == FALSE) {
+				*checksum = get_checksum_mem_buffer(file_buffer);
+				*checksum_flag = TRUE;
+			}
+			if(dupl_ptr->fragment_checksum == *checksum)
 				return TRUE;
 		}
 
@@ -2138,16 +2652,32 @@ int pre_duplicate_frag(long long file_size, unsigned short checksum)
 
 
 struct file_info *add_non_dup(long long file_size, long long bytes,
-	unsigned int *block_list, long long start, struct fragment *fragment,
-	unsigned short checksum, unsigned short fragment_checksum,
-	int checksum_flag)
+	unsigned int *block_list, int blocks, long long start,
+	struct fragment *fragment, unsigned short checksum,
+	unsigned short fragment_checksum, int checksum_flag,
+	unsigned long long *content_hash)
 {
-	struct file_info *dupl_ptr = malloc(sizeof(struct file_info));
+	struct file_info *dupl_ptr = arena_alloc(&tree_arena,
+		sizeof(struct file_info));
 
 	if(dupl_ptr == NULL) {
 		BAD_ERROR("Out of memory in dup_files allocation!\n");
 	}
 
+	/*
+	 * spilling, the record keeps a copy in the arena and the caller
+	 * frees its block list
+	 */
+	if(spill && blocks) {
+		unsigned int *copy = arena_alloc(&tree_arena, blocks *
+			sizeof(unsigned int));
+
+		if(copy == NULL)
+			BAD_ERROR("Out of memory in dup_files allocation!\n");
+		memcpy(copy, block_list, blocks * sizeof(unsigned int));
+		block_list = copy;
+	}
+
 	dupl_ptr->file_size = file_size;
 	dupl_ptr->bytes = bytes;
 	dupl_ptr->block_list = block_list;
@@ -2158,25 +2688,119 @@ struct file_info *add_non_dup(long long file_size, long long bytes,
 	dupl_ptr->checksum_flag = checksum_flag;
 	dupl_ptr->next = dupl[DUP_HASH(file_size)];
 	dupl[DUP_HASH(file_size)] = dupl_ptr;
+	dupl_ptr->content_hashed = content_hash != NULL;
+	if(content_hash) {
+		dupl_ptr->content_hash[0] = content_hash[0];
+		dupl_ptr->content_hash[1] = content_hash[1];
+		dupl_ptr->content_next = dupl_content[CONTENT_HASH(content_hash)];
+		dupl_content[CONTENT_HASH(content_hash)] = dupl_ptr;
+	}
 	dup_files ++;
 
 	return dupl_ptr;
 }
 
 
+/*
+ * Compare the blocks and fragment just written for a file with those of
+ * dupl_ptr, reading them back from the cache or the output filesystem
+ */
+int same_data(struct file_info *dupl_ptr, long long start,
+	unsigned int *block_list, int blocks, struct file_buffer *file_buffer,
+	int frag_bytes)
+{
+	long long target_start = start, dup_start = dupl_ptr->start;
+	struct file_buffer *frag_buffer;
+	int block, res;
+
+	for(block = 0; block < blocks; block ++) {
+		int size = SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[block]);
+		struct file_buffer *target_buffer = NULL;
+		struct file_buffer *dup_buffer = NULL;
+		char *target_data, *dup_data;
+
+		if(size == 0)
+			continue;
+		target_buffer = cache_lookup(writer_buffer, target_start);
+		if(target_buffer)
+			target_data = target_buffer->data;
+		else
+			target_data = read_from_disk(target_start, size);
+
+		dup_buffer = cache_lookup(writer_buffer, dup_start);
+		if(dup_buffer)
+			dup_data = dup_buffer->data;
+		else
+			dup_data = read_from_disk2(dup_start, size);
+
+		res = memcmp(target_data, dup_data, size);
+		cache_block_put(target_buffer);
+		cache_block_put(dup_buffer);
+		if(res != 0)
+			return FALSE;
+		target_start += size;
+		dup_start += size;
+	}
+
+	frag_buffer = get_fragment(dupl_ptr->fragment);
+	res = frag_bytes == 0 || memcmp(file_buffer->data, frag_buffer->data +
+		dupl_ptr->fragment->offset, frag_bytes) == 0;
+	cache_block_put(frag_buffer);
+
+	return res;
+}
+
+
 struct file_info *duplicate(long long file_size, long long bytes,
 	unsigned int **block_list, long long *start, struct fragment **fragment,
 	struct file_buffer *file_buffer, int blocks, unsigned short checksum,
-	unsigned short fragment_checksum, int checksum_flag)
+	unsigned short fragment_checksum, int checksum_flag,
+	unsigned long long *content_hash)
 {
-	struct file_info *dupl_ptr = dupl[DUP_HASH(file_size)];
+	struct file_info *dupl_ptr;
 	int frag_bytes = file_buffer ? file_buffer->size : 0;
 
-	for(; dupl_ptr; dupl_ptr = dupl_ptr->next)
+	/*
+	 * Files with a content hash are found with one lookup and without
+	 * checksumming.  The hash isn't collision resistant, so a match is
+	 * only a candidate, and its data is still compared before the blocks
+	 * are shared.  Differing hashes do mean differing contents
+	 */
+	if(content_hash) {
+		for(dupl_ptr = content_duplicate(file_size, content_hash);
+				dupl_ptr; dupl_ptr = dupl_ptr->content_next) {
+			if(file_size != dupl_ptr->file_size ||
+					content_hash[0] != dupl_ptr->content_hash[0] ||
+					content_hash[1] != dupl_ptr->content_hash[1])
+				continue;
+			if(bytes != dupl_ptr->bytes || frag_bytes !=
+					dupl_ptr->fragment->size)
+				continue;
+			if(memcmp(*block_list, dupl_ptr->block_list, blocks *
+					sizeof(unsigned int)) != 0)
+				continue;
+			if(!same_data(dupl_ptr, *start, *block_list, blocks,
+					file_buffer, frag_bytes))
+				continue;
+
+			TRACE("Found duplicate file by content hash, start "
+				"0x%llx, size %lld, fragment %d\n",
+				dupl_ptr->start, dupl_ptr->bytes,
+				dupl_ptr->fragment->index);
+			*block_list = dupl_ptr->block_list;
+			*start = dupl_ptr->start;
+			*fragment = dupl_ptr->fragment;
+			return 0;
+		}
+	}
+
+	for(dupl_ptr = dupl[DUP_HASH(file_size)]; dupl_ptr;
+			dupl_ptr = dupl_ptr->next)
 		if(file_size == dupl_ptr->file_size && bytes == dupl_ptr->bytes
 				 && frag_bytes == dupl_ptr->fragment->size) {
-			long long target_start, dup_start = dupl_ptr->start;
-			int block;
+			if(content_hash && dupl_ptr->content_hashed)
+				/* hashes differ, it can't be a duplicate */
+				continue;
 
 			if(memcmp(*block_list, dupl_ptr->block_list, blocks *
 					sizeof(unsigned int)) != 0)
@@ -2208,75 +2832,120 @@ struct file_info *duplicate(long long file_size, long long bytes,
 					dupl_ptr->fragment_checksum)
 				continue;
 
-			target_start = *start;
-			for(block = 0; block < blocks; block ++) {
-				int size = SQUASHFS_COMPRESSED_SIZE_BLOCK
-					((*block_list)[block]);
-				struct file_buffer *target_buffer = NULL;
-				struct file_buffer *dup_buffer = NULL;
-				char *target_data, *dup_data;
-				int res;
-
-				if(size == 0)
-					continue;
-				target_buffer = cache_lookup(writer_buffer,
-					target_start);
-				if(target_buffer)
-					target_data = target_buffer->data;
-				else
-					target_data =
-						read_from_disk(target_start,
-						size);
-
-				dup_buffer = cache_lookup(writer_buffer,
-					dup_start);
-				if(dup_buffer)
-					dup_data = dup_buffer->data;
-				else
-					dup_data = read_from_disk2(dup_start,
-						size);
-
-				res = memcmp(target_data, dup_data, size);
-				cache_block_put(target_buffer);
-				cache_block_put(dup_buffer);
-				if(res != 0)
-					break;
-				target_start += size;
-				dup_start += size;
+			if(same_data(dupl_ptr, *start, *block_list, blocks,
+					file_buffer, frag_bytes)) {
+				TRACE("Found duplicate file, start 0x%llx, "
+					"size %lld, checksum 0x%x, fragment "
+					"%d, size %d, offset %d, checksum "
+					"0x%x\n", dupl_ptr->start,
+					dupl_ptr->bytes, dupl_ptr->checksum,
+					dupl_ptr->fragment->index, frag_bytes,
+					dupl_ptr->fragment->offset,
+					fragment_checksum);
+				*block_list = dupl_ptr->block_list;
+				*start = dupl_ptr->start;
+				*fragment = dupl_ptr->fragment;
+				return 0;
 			}
-			if(block == blocks) {
-				struct file_buffer *frag_buffer =
-					get_fragment(dupl_ptr->fragment);
+		}
 
-				if(frag_bytes == 0 ||
-						memcmp(file_buffer->data,
-						frag_buffer->data +
-						dupl_ptr->fragment->offset,
-						frag_bytes) == 0) {
-					TRACE("Found duplicate file, start "
-						"0x%llx, size %lld, checksum "
-						"0x%x, fragment %d, size %d, "
-						"offset %d, checksum 0x%x\n",
-						dupl_ptr->start,
-						dupl_ptr->bytes,
-						dupl_ptr->checksum,
-						dupl_ptr->fragment->index,
-						frag_bytes,
-						dupl_ptr->fragment->offset,
-						fragment_checksum);
-					*block_list = dupl_ptr->block_list;
-					*start = dupl_ptr->start;
-					*fragment = dupl_ptr->fragment;
-					cache_block_put(frag_buffer);
-					return 0;
-				}
-				cache_block_put(frag_buffer);
-			}
+
+	return add_non_dup(file_size, bytes, *block_list, blocks, *start,
+		*fragment, checksum, fragment_checksum, checksum_flag,
+		content_hash);
+}
+
+
+void data_block_hash(struct file_buffer *file_buffer, unsigned long long *hash)
+{
+	hash[0] = hash[1] = 0;
+	content_hash_block(hash, file_buffer->data, file_buffer->size);
+	content_hash_final(hash, file_buffer->c_byte);
+}
+
+
+#define DEDUP_HASH(a) ((a)[0] & 0xffff)
+void add_dedup_blocks(long long start, int blocks, unsigned int *block_list,
+	unsigned long long *hashes)
+{
+	int block;
+
+	for(block = 0; block < blocks; block ++) {
+		struct block_info *info;
+		unsigned long long *hash = hashes + block * 2;
+
+		if(block_list[block] == 0)
+			continue;
+
+		if(block_info_count == block_info_size) {
+			block_info_size += 1024;
+			block_info = realloc(block_info, block_info_size *
+				sizeof(struct block_info));
+			if(block_info == NULL)
+				BAD_ERROR("Out of memory in block dedup "
+					"index\n");
 		}
 
+		info = &block_info[block_info_count ++];
+		info->start = start;
+		info->c_byte = block_list[block];
+		info->hash[0] = hash[0];
+		info->hash[1] = hash[1];
+		info->next = block_table[DEDUP_HASH(hash)];
+		block_table[DEDUP_HASH(hash)] = block_info_count;
 
-	return add_non_dup(file_size, bytes, *block_list, *start, *fragment,
-		checksum, fragment_checksum, checksum_flag);
+		start += SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[block]);
+	}
+}
+
+
+/*
+ * A file's blocks have to be stored contiguously from its start block, so
+ * a file can only share blocks if all of them (sparse blocks aside) match a
+ * run of blocks already written back to back, for instance files that
+ * only differ in their tail fragment.  Returns the start of the run, or -1
+ */
+long long dedup_block_run(int blocks, unsigned int *block_list,
+	unsigned long long *hashes)
+{
+	int first, entry;
+
+	for(first = 0; first < blocks && block_list[first] == 0; first ++);
+	if(first == blocks)
+		return -1;
+
+	for(entry = block_table[DEDUP_HASH(hashes + first * 2)]; entry;
+			entry = block_info[entry - 1].next) {
+		int block, i = entry - 1;
+		long long start = block_info[i].start;
+
+		for(block = first; block < blocks; block ++) {
+			unsigned long long *hash = hashes + block * 2;
+
+			if(block_list[block] == 0)
+				continue;
+			if(i == block_info_count ||
+					block_info[i].start != start ||
+					block_info[i].c_byte !=
+					block_list[block] ||
+					block_info[i].hash[0] != hash[0] ||
+					block_info[i].hash[1] != hash[1])
+				break;
+			start += SQUASHFS_COMPRESSED_SIZE_BLOCK(
+				block_list[block]);
+			i ++;
+		}
+
+		if(block == blocks) {
+			TRACE("Found duplicate block run, start 0x%llx, "
+				"blocks %d\n", block_info[entry - 1].start,
+				i - entry + 1);
+			dup_blocks += i - entry + 1;
+			return block_info[entry - 1].start;
+		}
+	}
+
+	return -1;
 }
 
 
@@ -2284,17 +2953,34 @@ static int seq = 0;
 void reader_read_process(struct dir_ent *dir_ent)
 {
 	struct file_buffer *prev_buffer = NULL, *file_buffer;
+	struct pseudo_dev *dev = get_pseudo_file(dir_ent->inode->pseudo_id);
 	int status, res, byte, count = 0;
-	int file = get_pseudo_file(dir_ent->inode->pseudo_id)->fd;
-	int child = get_pseudo_file(dir_ent->inode->pseudo_id)->child;
-	long long bytes = 0;
+	int file = dev->fd;
+	int child = dev->child;
+	long long bytes = 0, size = -1;
+
+	/*
+	 * the -pg generator replies with the size of a 'g' pseudo file, and
+	 * then its contents, which run to there rather than to the end of file
+	 */
+	if(dev->type == 'g') {
+		size = pseudo_generate(dev);
+		if(size == -1) {
+			file_buffer = cache_get(reader_buffer, 0, 0);
+			file_buffer->sequence = seq ++;
+			goto read_err;
+		}
+	}
 
 	while(1) {
+		int want = size == -1 || size - bytes > block_size ?
+			block_size : size - bytes;
+
 		file_buffer = cache_get(reader_buffer, 0, 0);
 		file_buffer->sequence = seq ++;
 
-		byte = read_bytes(file, file_buffer->data, block_size);
-		if(byte == -1)
+		byte = read_bytes(file, file_buffer->data, want);
+		if(byte == -1 || (size != -1 && byte < want))
 			goto read_err;
 
 		file_buffer->size = byte;
@@ -2317,7 +3003,7 @@ void reader_read_process(struct dir_ent *dir_ent)
 		estimated_uncompressed ++;
 
 		if(prev_buffer)
-			queue_put(from_reader, prev_buffer);
+			deflate_put(from_reader, prev_buffer);
 		prev_buffer = file_buffer;
 	}
 
@@ -2327,9 +3013,12 @@ void reader_read_process(struct dir_ent *dir_ent)
 	 */
 	dir_ent->inode->buf.st_size = bytes;
 
-	res = waitpid(child, &status, 0);
-	if(res == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
-		goto read_err;
+	if(child != -1) {
+		res = waitpid(child, &status, 0);
+		if(res == -1 || !WIFEXITED(status) ||
+				WEXITSTATUS(status) != 0)
+			goto read_err;
+	}
 
 	if(prev_buffer == NULL)
 		prev_buffer = file_buffer;
@@ -2338,9 +3027,11 @@ void reader_read_process(struct dir_ent *dir_ent)
 		seq --;
 	}
 	prev_buffer->file_size = bytes;
+	/* byte is the read which found the end, the last block is prev_buffer */
 	prev_buffer->fragment = !no_fragments &&
-		(count == 2 || always_use_fragments) && (byte < block_size);
-	queue_put(from_reader, prev_buffer);
+		(count == 2 || always_use_fragments) &&
+		(prev_buffer->size < block_size);
+	deflate_put(from_reader, prev_buffer);
 
 	return;
 
@@ -2355,18 +3046,205 @@ read_err:
 }
 
 
-void reader_read_file(struct dir_ent *dir_ent)
+/*
+ * Pathname of dir_ent relative to the root of the filesystem being
+ * created, which is what files in the -base image are looked up by
+ */
+char *image_pathname(struct dir_ent *dir_ent)
+{
+	struct dir_ent *parent = dir_ent->our_dir->dir_ent;
+	char *pathname, *parent_name;
+
+	if(parent->our_dir == NULL)
+		return strdup(dir_ent->name);
+
+	parent_name = image_pathname(parent);
+	if(parent_name == NULL)
+		return NULL;
+
+	pathname = malloc(strlen(parent_name) + strlen(dir_ent->name) + 2);
+	if(pathname)
+		sprintf(pathname, "%s/%s", parent_name, dir_ent->name);
+	free(parent_name);
+
+	return pathname;
+}
+
+
+/*
+ * If the file is unchanged from the -base image (same size and mtime)
+ * queue its data blocks as they are stored in the base image rather than
+ * reading and compressing it again.  The tail is unpacked from its base
+ * fragment, which duplicate checking needs, but get_and_fill_fragment
+ * then shares a copy of the base fragment rather than packing it again.
+ * Returns FALSE if the file has to be read
+ */
+struct base_file *reader_unchanged_base(struct dir_ent *dir_ent)
+{
+	struct stat *buf = &dir_ent->inode->buf;
+	struct base_file *base;
+	char *pathname;
+
+	if(buf->st_size == 0)
+		return NULL;
+
+	pathname = image_pathname(dir_ent);
+	if(pathname == NULL)
+		BAD_ERROR("Out of memory in reader_unchanged_base\n");
+	base = lookup_base(pathname);
+	free(pathname);
+
+	if(base == NULL || base->file_size != buf->st_size || base->mtime !=
+			buf->st_mtime)
+		return NULL;
+
+	return base;
+}
+
+
+int reader_read_base(struct dir_ent *dir_ent)
+{
+	struct stat *buf = &dir_ent->inode->buf;
+	struct file_buffer *file_buffer = NULL;
+	struct base_file *base;
+	long long start, read_size = buf->st_size;
+	int block, blocks, frag_block;
+
+	base = reader_unchanged_base(dir_ent);
+	if(base == NULL)
+		return FALSE;
+
+	blocks = (read_size + block_size - 1) >> block_log;
+	frag_block = !no_fragments && (always_use_fragments ||
+		(read_size < block_size)) ? read_size >> block_log : -1;
+
+	/* the tail must be a fragment in both or a block in both */
+	if((frag_block == blocks - 1) != (base->fragment !=
+			SQUASHFS_INVALID_FRAG))
+		return FALSE;
+
+	if(!sparse_files)
+		for(block = 0; block < base->blocks; block++)
+			if(base->block_list[block] == 0)
+				return FALSE;
+
+	dir_ent->inode->content_hashed = FALSE;
+	start = base->start;
+
+	for(block = 0; block < blocks; block++) {
+		if(file_buffer)
+			deflate_put(from_reader, file_buffer);
+		file_buffer = cache_get(reader_buffer, 0, 0);
+		file_buffer->sequence = seq ++;
+		file_buffer->file_size = read_size;
+		file_buffer->block = block;
+		file_buffer->fragment = block == frag_block;
+		file_buffer->base = base;
+
+		if(file_buffer->fragment) {
+			file_buffer->size = read_base_fragment(base,
+				file_buffer->data);
+			if(file_buffer->size == 0)
+				BAD_ERROR("Failed to read fragment of %s from "
+					"base image\n", dir_ent->pathname);
+			/*
+			 * the whole of a file in a fragment is at hand
+			 * uncompressed, so it can still be content hashed
+			 */
+			if(duplicate_checking && blocks == 1) {
+				unsigned long long *hash =
+					dir_ent->inode->content_hash;
+
+				hash[0] = hash[1] = 0;
+				content_hash_block(hash, file_buffer->data,
+					file_buffer->size);
+				content_hash_final(hash, read_size);
+				dir_ent->inode->content_hashed = TRUE;
+			}
+			continue;
+		}
+
+		file_buffer->c_byte = base->block_list[block];
+		if(file_buffer->c_byte == 0) {
+			/* sparse, size is the uncompressed size as usual */
+			file_buffer->size = read_size - ((long long) block <<
+				block_log) > block_size ? block_size :
+				read_size - ((long long) block << block_log);
+			continue;
+		}
+
+		file_buffer->size = SQUASHFS_COMPRESSED_SIZE_BLOCK
+			(file_buffer->c_byte);
+		if(read_base_bytes(start, file_buffer->size,
+				file_buffer->data) == 0)
+			BAD_ERROR("Failed to read block of %s from base "
+				"image\n", dir_ent->pathname);
+		start += file_buffer->size;
+	}
+
+	deflate_put(from_reader, file_buffer);
+	base_files ++;
+
+	return TRUE;
+}
+
+
+/*
+ * Find the first hole of file at or after offset with SEEK_HOLE and
+ * SEEK_DATA, setting *start and *end to it, or both to size if there is
+ * none before size (or the file system can't say).  Leaves the file offset
+ * wherever lseek() left it
+ */
+void reader_next_hole(int file, long long offset, long long size,
+	long long *start, long long *end)
+{
+	off_t hole = lseek(file, offset, SEEK_HOLE), data;
+
+	if(hole == -1 || hole >= size) {
+		*start = *end = size;
+		return;
+	}
+
+	data = lseek(file, hole, SEEK_DATA);
+	*start = hole;
+	/* ENXIO, the hole runs to the end of the file */
+	*end = data == -1 || data > size ? size : data;
+}
+
+
+/*
+ * file is the file already opened by a prefetch thread, or -1 to open it
+ * here.
+ *
+ * Whole blocks which lie in a hole of a sparse file are zeroed rather than
+ * read, and marked so that deflate_block() knows they're zero without
+ * scanning them
+ */
+void reader_read_file(struct dir_ent *dir_ent, int file)
 {
 	struct stat *buf = &dir_ent->inode->buf, buf2;
 	struct file_buffer *file_buffer;
-	int blocks, byte, count, expected, file, frag_block;
-	long long bytes, read_size;
-
-	if(dir_ent->inode->read)
+	int blocks, byte, count, expected, frag_block, seek;
+	long long bytes, read_size, offset, hole_start, hole_end;
+	unsigned long long hash[2];
+
+	if(dir_ent->inode->read) {
+		/* a hard link to a file already read */
+		if(file != -1)
+			close(file);
 		return;
+	}
 
 	dir_ent->inode->read = TRUE;
+
+	if(base_image && reader_read_base(dir_ent)) {
+		if(file != -1)
+			close(file);
+		return;
+	}
 again:
+	dir_ent->inode->content_hashed = FALSE;
+	hash[0] = hash[1] = 0;
 	bytes = 0;
 	count = 0;
 	file_buffer = NULL;
@@ -2375,23 +3253,50 @@ again:
 	frag_block = !no_fragments && (always_use_fragments ||
 		(read_size < block_size)) ? read_size >> block_log : -1;
 
-	file = open(dir_ent->pathname, O_RDONLY);
+	if(file == -1)
+		file = open(dir_ent->pathname, O_RDONLY);
 	if(file == -1) {
 		file_buffer = cache_get(reader_buffer, 0, 0);
 		file_buffer->sequence = seq ++;
 		goto read_err;
 	}
 
+	/* files of less than a block aren't worth the lseek()s */
+	hole_start = hole_end = read_size < block_size ? read_size : 0;
+	seek = FALSE;
+
 	do {
-		expected = read_size - ((long long) count * block_size) >
-			block_size ? block_size :
-			read_size - ((long long) count * block_size);
+		offset = (long long) count * block_size;
+		expected = read_size - offset > block_size ? block_size :
+			read_size - offset;
 
 		if(file_buffer)
-			queue_put(from_reader, file_buffer);
+			deflate_put(from_reader, file_buffer);
 		file_buffer = cache_get(reader_buffer, 0, 0);
 		file_buffer->sequence = seq ++;
 
+		if(offset >= hole_end) {
+			reader_next_hole(file, offset, read_size, &hole_start,
+				&hole_end);
+			seek = TRUE;
+		}
+
+		if(expected == block_size && offset >= hole_start &&
+				offset + block_size <= hole_end) {
+			memset(file_buffer->data, 0, block_size);
+			file_buffer->size = byte = block_size;
+			file_buffer->file_size = read_size;
+			file_buffer->hole = TRUE;
+			seek = TRUE;
+			goto got_block;
+		}
+
+		if(seek) {
+			if(lseek(file, offset, SEEK_SET) == -1)
+				goto read_err;
+			seek = FALSE;
+		}
+
 		/*
 		 * Always try to read block_size bytes from the file rather
 		 * than expected bytes (which will be less than the block_size
@@ -2412,10 +3317,14 @@ again:
 		if(byte != expected)
 			goto restat;
 
+got_block:
 		file_buffer->block = count;
 		file_buffer->error = FALSE;
 		file_buffer->fragment = (file_buffer->block == frag_block);
 
+		if(duplicate_checking)
+			content_hash_block(hash, file_buffer->data, byte);
+
 		bytes += byte;
 		count ++;
 	} while(count < blocks);
@@ -2432,32 +3341,298 @@ again:
 		char buffer;
 		int res;
 
+		if(seek && lseek(file, read_size, SEEK_SET) == -1)
+			goto read_err;
+
 		res = read_bytes(file, &buffer, 1);
 		if(res == -1)
 			goto read_err;
 
-		if(res != 0)
-			goto restat;
+		if(res != 0)
+			goto restat;
+	}
+
+	if(duplicate_checking) {
+		/*
+		 * published before the file's last block is queued, so it is
+		 * always set by the time the main thread has the whole file
+		 */
+		content_hash_final(hash, read_size);
+		dir_ent->inode->content_hash[0] = hash[0];
+		dir_ent->inode->content_hash[1] = hash[1];
+		dir_ent->inode->content_hashed = TRUE;
+	}
+
+	deflate_put(from_reader, file_buffer);
+
+	close(file);
+
+	return;
+
+restat:
+	fstat(file, &buf2);
+	close(file);
+	file = -1;
+	if(read_size != buf2.st_size) {
+		memcpy(buf, &buf2, sizeof(struct stat));
+		file_buffer->error = 2;
+		queue_put(from_deflate, file_buffer);
+		goto again;
+	}
+read_err:
+	file_buffer->error = TRUE;
+	queue_put(from_deflate, file_buffer);
+}
+
+
+/*
+ * Small files are batched: consecutive files which go wholly in a
+ * fragment are read into one reader buffer, each after its size, and the
+ * buffer goes straight to the main thread, there being nothing for a
+ * deflator to do with them.  That is one cache_get() and queue_put() (and
+ * one sequence number) for the batch, rather than for each file.  The main
+ * thread hands the files out one at a time, get_file_buffer() below, so
+ * fragment packing sees them just as if they'd been read one by one
+ */
+#define BATCH_HEADER	sizeof(unsigned int)
+
+struct file_buffer *reader_batch = NULL;
+int reader_batch_bytes;
+
+
+void reader_batch_flush()
+{
+	if(reader_batch == NULL)
+		return;
+
+	reader_batch->sequence = seq ++;
+	reader_batch->fragment = TRUE;
+	reader_batch->size = reader_batch->c_byte = reader_batch_bytes;
+	queue_put(from_deflate, reader_batch);
+	reader_batch = NULL;
+}
+
+
+/*
+ * Adds dir_ent to the batch, returning FALSE if reader_read_file() has to
+ * read it, either as it isn't small or to deal with a read error or change
+ * of size.  *file is the prefetched file, set to -1 if it's closed here
+ */
+int reader_batch_file(struct dir_ent *dir_ent, int *file)
+{
+	struct inode_info *inode = dir_ent->inode;
+	long long size = inode->buf.st_size;
+	unsigned long long hash[2];
+	unsigned int header;
+	char *data, buffer;
+
+	if(inode->read) {
+		if(*file != -1)
+			close(*file);
+		*file = -1;
+		return TRUE;
+	}
+
+	if(no_fragments || size == 0 || size + BATCH_HEADER > block_size)
+		return FALSE;
+
+	if(base_image && reader_unchanged_base(dir_ent))
+		return FALSE;
+
+	if(reader_batch && reader_batch_bytes + BATCH_HEADER + size >
+			block_size)
+		reader_batch_flush();
+
+	if(*file == -1) {
+		*file = open(dir_ent->pathname, O_RDONLY);
+		if(*file == -1)
+			return FALSE;
+	}
+
+	if(reader_batch == NULL) {
+		reader_batch = cache_get(reader_buffer, 0, 0);
+		reader_batch->file_size = reader_batch->block = 0;
+		reader_batch_bytes = 0;
+	}
+
+	/* the file must end where it was stated to */
+	data = reader_batch->data + reader_batch_bytes + BATCH_HEADER;
+	if(read_bytes(*file, data, size) != size ||
+			read_bytes(*file, &buffer, 1) != 0) {
+		close(*file);
+		*file = -1;
+		return FALSE;
+	}
+	close(*file);
+	*file = -1;
+
+	header = size;
+	memcpy(reader_batch->data + reader_batch_bytes, &header,
+		BATCH_HEADER);
+	reader_batch_bytes += BATCH_HEADER + size;
+	reader_batch->batch ++;
+
+	inode->read = TRUE;
+	inode->content_hashed = FALSE;
+	if(duplicate_checking) {
+		hash[0] = hash[1] = 0;
+		content_hash_block(hash, data, size);
+		content_hash_final(hash, size);
+		inode->content_hash[0] = hash[0];
+		inode->content_hash[1] = hash[1];
+		inode->content_hashed = TRUE;
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * -stream input, the inode is made here, rather than by the main thread,
+ * as the reader fills in its content hash.  It isn't numbered until it's
+ * added to the directory tree, (nlink counts the entries linking to it),
+ * as a later entry in the stream may replace it
+ */
+struct inode_info *stream_inode(struct stream_entry *entry)
+{
+	struct inode_info *inode = malloc(sizeof(struct inode_info));
+
+	if(inode == NULL)
+		BAD_ERROR("Out of memory in stream_inode\n");
+
+	memset(inode, 0, sizeof(struct inode_info));
+	memcpy(&inode->buf, &entry->buf, sizeof(struct stat));
+	inode->inode = SQUASHFS_INVALID_BLK;
+	/* the data is read here, not by reader_read_file() */
+	inode->read = TRUE;
+	inode->pseudo_file = PSEUDO_FILE_OTHER;
+	if(S_ISLNK(entry->buf.st_mode)) {
+		inode->symlink = entry->linkname;
+		entry->linkname = NULL;
+	}
+	inode->next = stream_inodes;
+	stream_inodes = inode;
+
+	return inode;
+}
+
+
+void reader_read_stream(struct inode_info *inode)
+{
+	struct file_buffer *file_buffer = NULL;
+	long long read_size = inode->buf.st_size;
+	int blocks = (read_size + block_size - 1) >> block_log;
+	int frag_block = !no_fragments && (always_use_fragments ||
+		(read_size < block_size)) ? read_size >> block_log : -1;
+	int count = 0, expected;
+	unsigned long long hash[2] = { 0, 0 };
+
+	do {
+		expected = read_size - ((long long) count * block_size) >
+			block_size ? block_size :
+			read_size - ((long long) count * block_size);
+
+		if(file_buffer)
+			deflate_put(from_reader, file_buffer);
+		file_buffer = cache_get(reader_buffer, 0, 0);
+		file_buffer->sequence = seq ++;
+
+		/* the stream can't be re-read, so a short read is fatal */
+		file_buffer->size = stream_read(file_buffer->data, expected);
+		if(file_buffer->size != expected)
+			BAD_ERROR("Unexpected end of input stream\n");
+
+		file_buffer->file_size = read_size;
+		file_buffer->block = count;
+		file_buffer->error = FALSE;
+		file_buffer->fragment = (file_buffer->block == frag_block);
+
+		if(duplicate_checking)
+			content_hash_block(hash, file_buffer->data, expected);
+
+		count ++;
+	} while(count < blocks);
+
+	if(duplicate_checking) {
+		content_hash_final(hash, read_size);
+		inode->content_hash[0] = hash[0];
+		inode->content_hash[1] = hash[1];
+		inode->content_hashed = TRUE;
+	}
+
+	deflate_put(from_reader, file_buffer);
+}
+
+
+/*
+ * Pass the entries of the stream to the main thread, reading each regular
+ * file's data after its entry, which the main thread writes as it arrives
+ */
+void reader_stream()
+{
+	struct stream_entry *entry;
+
+	while((entry = stream_next()) != NULL) {
+		struct inode_info *inode = NULL;
+
+		if(!entry->hardlink)
+			inode = entry->inode = stream_inode(entry);
+		queue_put(to_stream, entry);
+
+		if(inode && S_ISREG(inode->buf.st_mode))
+			reader_read_stream(inode);
 	}
 
-	queue_put(from_reader, file_buffer);
+	queue_put(to_stream, NULL);
+}
 
-	close(file);
 
-	return;
+/*
+ * Prefetching for the reader.  The reader lists the files in the order it
+ * reads them (the directory walk, or the sort priorities), and a pool of
+ * threads opens the next PREFETCH_AHEAD of them and posix_fadvise()s their
+ * start as WILLNEED, so the kernel reads them in parallel while the
+ * reader is still on earlier files.  The reader itself still reads every
+ * file, in list order, numbering its blocks with seq as before, so the
+ * layout of the output doesn't depend on the prefetching.  As with the
+ * scan threads, the pool is sized for the latency of slow (network)
+ * filesystems rather than by processors
+ */
+#define PREFETCH_THREADS	8
+#define PREFETCH_AHEAD		64
+#define PREFETCH_BYTES		(1024 * 1024)
+
+#define PREFETCH_WAITING	0
+#define PREFETCH_BUSY		1
+#define PREFETCH_DONE		2
+
+struct prefetch_entry {
+	struct dir_ent	*dir_ent;
+	int		file;
+	int		state;
+};
 
-restat:
-	fstat(file, &buf2);
-	close(file);
-	if(read_size != buf2.st_size) {
-		memcpy(buf, &buf2, sizeof(struct stat));
-		file_buffer->error = 2;
-		queue_put(from_deflate, file_buffer);
-		goto again;
+struct prefetch_entry *prefetch_list = NULL;
+int prefetch_count = 0, prefetch_size = 0, prefetch_next = 0;
+int prefetch_reading = 0;
+pthread_t prefetch_thread_id[PREFETCH_THREADS];
+pthread_mutex_t prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t prefetch_waiting = PTHREAD_COND_INITIALIZER;
+
+
+void prefetch_add(struct dir_ent *dir_ent)
+{
+	if(prefetch_count == prefetch_size) {
+		prefetch_size = prefetch_size ? prefetch_size * 2 : 1024;
+		prefetch_list = realloc(prefetch_list, prefetch_size *
+			sizeof(struct prefetch_entry));
+		if(prefetch_list == NULL)
+			BAD_ERROR("Out of memory in prefetch_add\n");
 	}
-read_err:
-	file_buffer->error = TRUE;
-	queue_put(from_deflate, file_buffer);
+
+	prefetch_list[prefetch_count].dir_ent = dir_ent;
+	prefetch_list[prefetch_count].file = -1;
+	prefetch_list[prefetch_count ++].state = PREFETCH_WAITING;
 }
 
 
@@ -2471,13 +3646,13 @@ void reader_scan(struct dir_info *dir) {
 			continue;
 
 		if(IS_PSEUDO_PROCESS(dir_ent->inode)) {
-			reader_read_process(dir_ent);
+			prefetch_add(dir_ent);
 			continue;
 		}
 
 		switch(buf->st_mode & S_IFMT) {
 			case S_IFREG:
-				reader_read_file(dir_ent);
+				prefetch_add(dir_ent);
 				break;
 			case S_IFDIR:
 				reader_scan(dir_ent->dir);
@@ -2487,32 +3662,208 @@ void reader_scan(struct dir_info *dir) {
 }
 
 
+/*
+ * Nothing is opened for files the reader won't read from the source:
+ * those already read (by -stream, or as an earlier hard link), the
+ * pseudo processes, and those taken from the base image.  inode->read
+ * is only ever set by the reader, so a stale FALSE costs just an open
+ */
+int prefetch_file(struct dir_ent *dir_ent)
+{
+	struct inode_info *inode = dir_ent->inode;
+	int file;
+
+	if(inode->read || IS_PSEUDO_PROCESS(inode) || inode->buf.st_size == 0)
+		return -1;
+
+	if(base_image && reader_unchanged_base(dir_ent))
+		return -1;
+
+	file = open(dir_ent->pathname, O_RDONLY);
+	if(file == -1)
+		/* the reader tries again, and reports the error */
+		return -1;
+
+	posix_fadvise(file, 0, inode->buf.st_size < PREFETCH_BYTES ?
+		inode->buf.st_size : PREFETCH_BYTES, POSIX_FADV_WILLNEED);
+
+	return file;
+}
+
+
+void *prefetch_thread(void *arg)
+{
+	while(1) {
+		struct prefetch_entry *entry;
+
+		pthread_mutex_lock(&prefetch_mutex);
+		while(prefetch_next < prefetch_count && prefetch_next >=
+				prefetch_reading + PREFETCH_AHEAD)
+			pthread_cond_wait(&prefetch_waiting, &prefetch_mutex);
+		if(prefetch_next == prefetch_count) {
+			pthread_mutex_unlock(&prefetch_mutex);
+			return NULL;
+		}
+		entry = &prefetch_list[prefetch_next ++];
+		entry->state = PREFETCH_BUSY;
+		pthread_mutex_unlock(&prefetch_mutex);
+
+		entry->file = prefetch_file(entry->dir_ent);
+
+		pthread_mutex_lock(&prefetch_mutex);
+		entry->state = PREFETCH_DONE;
+		pthread_cond_broadcast(&prefetch_waiting);
+		pthread_mutex_unlock(&prefetch_mutex);
+	}
+}
+
+
+void prefetch_start()
+{
+	sigset_t sigmask, old_mask;
+	int i;
+
+	/* leave the signals to the main thread, as initialise_threads does */
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGINT);
+	sigaddset(&sigmask, SIGQUIT);
+	sigaddset(&sigmask, SIGUSR1);
+	if(sigprocmask(SIG_BLOCK, &sigmask, &old_mask) == -1)
+		BAD_ERROR("Failed to set signal mask in prefetch_start\n");
+
+	for(i = 0; i < PREFETCH_THREADS; i++)
+		if(pthread_create(&prefetch_thread_id[i], NULL,
+				prefetch_thread, NULL) != 0)
+			BAD_ERROR("Failed to create prefetch thread\n");
+
+	if(sigprocmask(SIG_SETMASK, &old_mask, NULL) == -1)
+		BAD_ERROR("Failed to set signal mask in prefetch_start\n");
+}
+
+
+/*
+ * Returns the file the prefetch threads opened for entry i, or -1 for
+ * the reader to open it, moving the prefetch window on to entry i
+ */
+int prefetch_get(int i)
+{
+	struct prefetch_entry *entry = &prefetch_list[i];
+
+	pthread_mutex_lock(&prefetch_mutex);
+	prefetch_reading = i;
+	pthread_cond_broadcast(&prefetch_waiting);
+	while(entry->state == PREFETCH_BUSY)
+		pthread_cond_wait(&prefetch_waiting, &prefetch_mutex);
+	if(entry->state == PREFETCH_WAITING)
+		/* not reached by the threads, so don't let them have it */
+		prefetch_next = i + 1;
+	pthread_mutex_unlock(&prefetch_mutex);
+
+	return entry->file;
+}
+
+
 void *reader(void *arg)
 {
-	int oldstate;
+	int i, oldstate;
 
 	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldstate);
 
+	/* anything not in the stream (dynamic pseudo files) is read after */
+	if(stream_input)
+		reader_stream();
+
 	if(!sorted)
 		reader_scan(queue_get(to_reader));
 	else {
-		int i;
 		struct priority_entry *entry;
 
 		queue_get(to_reader);
 		for(i = 65535; i >= 0; i--)
 			for(entry = priority_list[i]; entry;
 							entry = entry->next)
-				reader_read_file(entry->dir);
+				prefetch_add(entry->dir);
 	}
 
+	prefetch_start();
+
+	for(i = 0; i < prefetch_count; i++) {
+		struct dir_ent *dir_ent = prefetch_list[i].dir_ent;
+		int file = prefetch_get(i);
+
+		if(IS_PSEUDO_PROCESS(dir_ent->inode)) {
+			reader_batch_flush();
+			reader_read_process(dir_ent);
+		} else if(!reader_batch_file(dir_ent, &file)) {
+			reader_batch_flush();
+			reader_read_file(dir_ent, file);
+		}
+	}
+	reader_batch_flush();
+
+	for(i = 0; i < PREFETCH_THREADS; i++)
+		pthread_join(prefetch_thread_id[i], NULL);
+	free(prefetch_list);
+
 	thread[0] = 0;
 
 	pthread_exit(NULL);
 }
 
 
+/*
+ * The writer coalesces blocks which follow on from each other in the
+ * output into one pwritev of up to WRITE_BATCH blocks.  Buffers are kept
+ * (and so still found by cache_lookup) until their batch is written, and
+ * the batch is flushed before the writer waits for more blocks, so it
+ * never sits on buffers the other threads are waiting for
+ */
+#define WRITE_BATCH	64
+
+struct iovec write_iov[WRITE_BATCH];
+struct file_buffer *write_batch[WRITE_BATCH];
+int write_count = 0;
+long long write_offset, write_batch_bytes;
+
+
+int flush_writes(int write_error)
+{
+	struct iovec *iov = write_iov;
+	int count = write_count, i;
+
+	while(!write_error && count) {
+		ssize_t written = pwritev(fd, iov, count, write_offset);
+
+		if(written == -1) {
+			if(errno == EINTR)
+				continue;
+			ERROR("Write on destination failed because %s\n",
+				strerror(errno));
+			write_error = TRUE;
+			break;
+		}
+
+		write_offset += written;
+		while(count && written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov ++;
+			count --;
+		}
+		if(count) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	for(i = 0; i < write_count; i++)
+		cache_block_put(write_batch[i]);
+	write_count = 0;
+
+	return write_error;
+}
+
+
 void *writer(void *arg)
 {
 	int write_error = FALSE;
@@ -2522,102 +3873,332 @@ void *writer(void *arg)
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldstate);
 
 	while(1) {
-		struct file_buffer *file_buffer = queue_get(to_writer);
-		off_t off;
+		struct file_buffer *file_buffer;
+
+		if(!queue_get_nowait(to_writer, (void **) &file_buffer)) {
+			write_error = flush_writes(write_error);
+			file_buffer = queue_get(to_writer);
+		}
 
 		if(file_buffer == NULL) {
+			write_error = flush_writes(write_error);
 			queue_put(from_writer,
 				write_error ? &write_error : NULL);
 			continue;
 		}
 
-		off = file_buffer->block;
-
-		pthread_mutex_lock(&pos_mutex);
-
-		if(!write_error && lseek(fd, off, SEEK_SET) == -1) {
-			ERROR("Lseek on destination failed because %s\n",
-				strerror(errno));
-			write_error = TRUE;
-		}
+		if(write_count && (write_count == WRITE_BATCH ||
+				write_offset + write_batch_bytes !=
+				file_buffer->block))
+			write_error = flush_writes(write_error);
 
-		if(!write_error && write_bytes(fd, file_buffer->data,
-				file_buffer->size) == -1) {
-			ERROR("Write on destination failed because %s\n",
-				strerror(errno));
-			write_error = TRUE;
+		if(write_count == 0) {
+			write_offset = file_buffer->block;
+			write_batch_bytes = 0;
 		}
-		pthread_mutex_unlock(&pos_mutex);
 
-		cache_block_put(file_buffer);
+		write_iov[write_count].iov_base = file_buffer->data;
+		write_iov[write_count].iov_len = file_buffer->size;
+		write_batch[write_count ++] = file_buffer;
+		write_batch_bytes += file_buffer->size;
 	}
 }
 
 
+/*
+ * all_zero() scans ZERO_SCAN bytes at a time, or'd together as 32 byte
+ * vectors, which GCC makes AVX2, SSE2 or NEON registers as the target has
+ * them, stopping at the first chunk that isn't zero.  The data needn't be
+ * aligned
+ */
+typedef unsigned long long zero_vec __attribute__((vector_size(32),
+	aligned(1), may_alias));
+#define ZERO_SCAN	(4 * sizeof(zero_vec))
+
 int all_zero(struct file_buffer *file_buffer)
 {
-	int i;
-	long entries = file_buffer->size / sizeof(long);
-	long *p = (long *) file_buffer->data;
+	int i, size = file_buffer->size;
+	char *data = file_buffer->data;
 
-	for(i = 0; i < entries && p[i] == 0; i++);
+	if(file_buffer->hole)
+		return TRUE;
 
-	if(i == entries) {
-		for(i = file_buffer->size & ~(sizeof(long) - 1);
-			i < file_buffer->size && file_buffer->data[i] == 0;
-			i++);
+	for(i = 0; i + ZERO_SCAN <= size; i += ZERO_SCAN) {
+		zero_vec *p = (zero_vec *) (data + i);
+		zero_vec acc = p[0] | p[1] | p[2] | p[3];
 
-		return i == file_buffer->size;
+		if(acc[0] | acc[1] | acc[2] | acc[3])
+			return FALSE;
 	}
 
-	return 0;
+	for(; i < size && data[i] == 0; i++);
+
+	return i == size;
 }
 
 
-void *deflator(void *arg)
+/*
+ * Estimate the block's order-0 entropy from its byte histogram.  JPEG,
+ * gzip, xz and the like come out at almost 8 bits a byte, where even LZMA
+ * gains at most a few percent, while most data worth compressing is well
+ * below.  The histogram costs a small fraction of compressing the block
+ */
+int incompressible(struct file_buffer *file_buffer)
 {
-	void *stream = NULL;
-	int res, oldstate;
+	unsigned int count[256];
+	unsigned char *data = (unsigned char *) file_buffer->data;
+	int i, used = 0, size = file_buffer->size;
+	double bits = 0;
 
-	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
-	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldstate);
+	if(size < INCOMPRESSIBLE_MIN)
+		return FALSE;
 
-	res = compressor_init(comp, &stream, block_size, 1);
-	if(res)
-		BAD_ERROR("deflator:: compressor_init failed\n");
+	memset(count, 0, sizeof(count));
+	for(i = 0; i < size; i++)
+		count[data[i]] ++;
 
-	while(1) {
-		struct file_buffer *file_buffer = queue_get(from_reader);
-		struct file_buffer *write_buffer;
-
-		if(sparse_files && all_zero(file_buffer)) { 
-			file_buffer->c_byte = 0;
-			queue_put(from_deflate, file_buffer);
-		} else if(file_buffer->fragment) {
-			file_buffer->c_byte = file_buffer->size;
-			queue_put(from_deflate, file_buffer);
-		} else {
-			write_buffer = cache_get(writer_buffer, 0, 0);
-			write_buffer->c_byte = mangle2(stream,
-				write_buffer->data, file_buffer->data,
-				file_buffer->size, block_size, noD, 1);
-			write_buffer->sequence = file_buffer->sequence;
-			write_buffer->file_size = file_buffer->file_size;
-			write_buffer->block = file_buffer->block;
-			write_buffer->size = SQUASHFS_COMPRESSED_SIZE_BLOCK
-				(write_buffer->c_byte);
-			write_buffer->fragment = FALSE;
-			write_buffer->error = FALSE;
-			cache_block_put(file_buffer);
-			queue_put(from_deflate, write_buffer);
+	for(i = 0; i < 256; i++)
+		if(count[i]) {
+			double p = (double) count[i] / size;
+
+			bits -= p * log2(p);
+			used ++;
 		}
+
+	/*
+	 * Miller-Madow correction, a block's histogram underestimates the
+	 * entropy of its source, noticeably so for small blocks
+	 */
+	bits += (used - 1) / (2.0 * size * M_LN2);
+
+	return bits >= INCOMPRESSIBLE_BITS;
+}
+
+
+/*
+ * Data blocks and fragments are compressed by one pool of deflator threads,
+ * so whichever kind of work is queued keeps all the processors busy.  The
+ * main thread orders the data blocks by sequence number, and fragments are
+ * placed under the fragment mutex, so the order in which the deflators
+ * finish doesn't matter
+ */
+void wake_deflators()
+{
+	__sync_synchronize();
+	if(deflators_idle) {
+		pthread_mutex_lock(&deflator_mutex);
+		pthread_cond_broadcast(&deflator_waiting);
+		pthread_mutex_unlock(&deflator_mutex);
+	}
+}
+
+
+void deflate_put(struct queue *queue, void *data)
+{
+	queue_put(queue, data);
+	wake_deflators();
+}
+
+
+/*
+ * Wait until there's work for a deflator holding (or not holding) a
+ * compressed data block.  The queues are re-checked after counting
+ * ourselves idle, so a put made meanwhile is either seen here or wakes us
+ */
+void deflator_wait(struct file_buffer *held)
+{
+	pthread_mutex_lock(&deflator_mutex);
+	deflators_idle ++;
+	__sync_synchronize();
+	if(queue_count(to_frag) == 0 && queue_count(to_meta) == 0 && (held ?
+			queue_full(from_deflate) : queue_count(from_reader) == 0))
+		pthread_cond_wait(&deflator_waiting, &deflator_mutex);
+	deflators_idle --;
+	pthread_mutex_unlock(&deflator_mutex);
+}
+
+
+struct file_buffer *deflate_block(void *stream, struct file_buffer *file_buffer)
+{
+	struct file_buffer *write_buffer;
+	int uncompressed;
+	long long start;
+
+	if(file_buffer->base && !file_buffer->fragment) {
+		/* copied from the -base image, just needs moving over */
+		if(file_buffer->c_byte == 0)
+			return file_buffer;
+		write_buffer = cache_get(writer_buffer, 0, 0);
+		memcpy(write_buffer->data, file_buffer->data,
+			file_buffer->size);
+		write_buffer->c_byte = file_buffer->c_byte;
+		goto done;
+	}
+
+	if(sparse_files && all_zero(file_buffer)) { 
+		file_buffer->c_byte = 0;
+		return file_buffer;
+	}
+
+	if(file_buffer->fragment) {
+		file_buffer->c_byte = file_buffer->size;
+		return file_buffer;
+	}
+
+	uncompressed = noD;
+	if(!uncompressed && store_incompressible &&
+			incompressible(file_buffer)) {
+		__sync_fetch_and_add(&incompressible_blocks, 1);
+		uncompressed = TRUE;
+	}
+
+	write_buffer = cache_get(writer_buffer, 0, 0);
+	start = REPORT_START();
+	write_buffer->c_byte = mangle2(stream, write_buffer->data,
+		file_buffer->data, file_buffer->size, block_size, uncompressed,
+		1);
+	if(report && !uncompressed)
+		report_compress(REPORT_DATA, file_buffer->size,
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(write_buffer->c_byte),
+			start);
+done:
+	write_buffer->sequence = file_buffer->sequence;
+	write_buffer->file_size = file_buffer->file_size;
+	write_buffer->block = file_buffer->block;
+	write_buffer->size = SQUASHFS_COMPRESSED_SIZE_BLOCK
+		(write_buffer->c_byte);
+	write_buffer->fragment = FALSE;
+	write_buffer->error = FALSE;
+	cache_block_put(file_buffer);
+
+	return write_buffer;
+}
+
+
+void deflate_fragment(void *stream, struct file_buffer *file_buffer)
+{
+	int c_byte, compressed_size;
+	struct file_buffer *write_buffer = cache_get(frag_writer_buffer,
+		file_buffer->block + FRAG_INDEX, 1);
+	long long start = REPORT_START();
+
+	c_byte = mangle2(stream, write_buffer->data, file_buffer->data,
+		file_buffer->size, block_size, noF, 1);
+	compressed_size = SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
+	if(report && !noF)
+		report_compress(REPORT_FRAGMENT, file_buffer->size,
+			compressed_size, start);
+	write_buffer->size = compressed_size;
+	pthread_mutex_lock(&fragment_mutex);
+	if(reproducible) {
+		/* left for the main thread to commit in order */
+		fragment_table[file_buffer->block].size = c_byte;
+		write_buffer->c_byte = c_byte;
+		frag_reorder[file_buffer->sequence] = write_buffer;
+		pthread_cond_signal(&fragment_waiting);
+		pthread_mutex_unlock(&fragment_mutex);
+	} else if(fragments_locked == FALSE) {
+		fragment_table[file_buffer->block].size = c_byte;
+		fragment_table[file_buffer->block].start_block = bytes;
+		write_buffer->block = bytes;
+		bytes += compressed_size;
+		fragments_outstanding --;
+		queue_put(to_writer, write_buffer);
+		pthread_mutex_unlock(&fragment_mutex);
+		TRACE("Writing fragment %lld, uncompressed size %d, "
+			"compressed size %d\n", file_buffer->block,
+			file_buffer->size, compressed_size);
+	} else {
+			pthread_mutex_unlock(&fragment_mutex);
+			add_pending_fragment(write_buffer, c_byte,
+				file_buffer->block);
+	}
+	cache_block_put(file_buffer);
+}
+
+
+/*
+ * The metadata tables written at the end of the build are compressed by
+ * the deflator pool, a block to each, and then laid out in order, rather
+ * than one block after another on the main thread.  The inode and
+ * directory blocks compressed as they fill during the scan can't be, as
+ * the references to their inodes and directories hold the compressed
+ * offset of the block.  When restoring the deflators are held in their
+ * signal handler, so the blocks are compressed by the main thread
+ */
+int meta_pending = 0;
+pthread_mutex_t meta_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t meta_waiting = PTHREAD_COND_INITIALIZER;
+
+
+void deflate_metadata(void *stream, struct meta_block *block)
+{
+	unsigned short c_byte;
+	long long start = REPORT_START();
+
+	block->c_byte = mangle2(stream, block->data + BLOCK_OFFSET, block->src,
+		block->size, SQUASHFS_METADATA_SIZE, block->uncompressed, 0);
+	if(report && !block->uncompressed)
+		report_compress(REPORT_METADATA, block->size,
+			SQUASHFS_COMPRESSED_SIZE(block->c_byte), start);
+	c_byte = block->c_byte;
+	SQUASHFS_SWAP_SHORTS(&c_byte, block->data, 1);
+	block->bytes = SQUASHFS_COMPRESSED_SIZE(block->c_byte) + BLOCK_OFFSET;
+
+	pthread_mutex_lock(&meta_mutex);
+	if(-- meta_pending == 0)
+		pthread_cond_signal(&meta_waiting);
+	pthread_mutex_unlock(&meta_mutex);
+}
+
+
+/*
+ * Returns the length bytes at src compressed into metadata blocks, in
+ * order, and their number in *blocks
+ */
+struct meta_block *compress_metadata(char *src, int length, int uncompressed,
+	int *blocks)
+{
+	struct meta_block *block;
+	int i, count = (length + SQUASHFS_METADATA_SIZE - 1) /
+		SQUASHFS_METADATA_SIZE;
+
+	block = malloc((count ? count : 1) * sizeof(struct meta_block));
+	if(block == NULL)
+		BAD_ERROR("Out of memory in compress_metadata\n");
+
+	for(i = 0; i < count; i++) {
+		block[i].src = src + i * SQUASHFS_METADATA_SIZE;
+		block[i].size = length - i * SQUASHFS_METADATA_SIZE >
+			SQUASHFS_METADATA_SIZE ? SQUASHFS_METADATA_SIZE :
+			length - i * SQUASHFS_METADATA_SIZE;
+		block[i].uncompressed = uncompressed;
+	}
+
+	meta_pending = count;
+	if(restoring || count < 2) {
+		for(i = 0; i < count; i++)
+			deflate_metadata(stream, &block[i]);
+	} else {
+		for(i = 0; i < count; i++)
+			deflate_put(to_meta, &block[i]);
+
+		pthread_mutex_lock(&meta_mutex);
+		while(meta_pending)
+			pthread_cond_wait(&meta_waiting, &meta_mutex);
+		pthread_mutex_unlock(&meta_mutex);
 	}
+
+	*blocks = count;
+	return block;
 }
 
 
-void *frag_deflator(void *arg)
+void *deflator(void *arg)
 {
-	void *stream = NULL;
+	/* metadata is compressed as by the main thread, not as data blocks */
+	void *stream = NULL, *meta_stream = NULL;
+	struct file_buffer *held = NULL;
 	int res, oldstate;
 
 	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
@@ -2625,37 +4206,35 @@ void *frag_deflator(void *arg)
 
 	res = compressor_init(comp, &stream, block_size, 1);
 	if(res)
-		BAD_ERROR("frag_deflator:: compressor_init failed\n");
+		BAD_ERROR("deflator:: compressor_init failed\n");
 
+	/*
+	 * Fragments go first, the main thread may be blocked queueing one.
+	 * A compressed data block is never queued with a blocking put: if
+	 * from_deflate is full its consumer, the main thread, may itself be
+	 * waiting for to_frag to drain, so the block is held and fragments
+	 * are compressed until there's room for it
+	 */
 	while(1) {
-		int c_byte, compressed_size;
-		struct file_buffer *file_buffer = queue_get(to_frag);
-		struct file_buffer *write_buffer =
-			cache_get(writer_buffer, file_buffer->block +
-			FRAG_INDEX, 1);
-
-		c_byte = mangle2(stream, write_buffer->data, file_buffer->data,
-			file_buffer->size, block_size, noF, 1);
-		compressed_size = SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
-		write_buffer->size = compressed_size;
-		pthread_mutex_lock(&fragment_mutex);
-		if(fragments_locked == FALSE) {
-			fragment_table[file_buffer->block].size = c_byte;
-			fragment_table[file_buffer->block].start_block = bytes;
-			write_buffer->block = bytes;
-			bytes += compressed_size;
-			fragments_outstanding --;
-			queue_put(to_writer, write_buffer);
-			pthread_mutex_unlock(&fragment_mutex);
-			TRACE("Writing fragment %lld, uncompressed size %d, "
-				"compressed size %d\n", file_buffer->block,
-				file_buffer->size, compressed_size);
-		} else {
-				pthread_mutex_unlock(&fragment_mutex);
-				add_pending_fragment(write_buffer, c_byte,
-					file_buffer->block);
-		}
-		cache_block_put(file_buffer);
+		struct file_buffer *file_buffer;
+		struct meta_block *block;
+
+		if(held && queue_put_nowait(from_deflate, held))
+			held = NULL;
+
+		if(queue_get_nowait(to_meta, (void **) &block)) {
+			if(meta_stream == NULL && compressor_init(comp,
+					&meta_stream, SQUASHFS_METADATA_SIZE, 0))
+				BAD_ERROR("deflator:: compressor_init "
+					"failed\n");
+			deflate_metadata(meta_stream, block);
+		} else if(queue_get_nowait(to_frag, (void **) &file_buffer))
+			deflate_fragment(stream, file_buffer);
+		else if(held == NULL && queue_get_nowait(from_reader,
+				(void **) &file_buffer))
+			held = deflate_block(stream, file_buffer);
+		else
+			deflator_wait(held);
 	}
 }
 
@@ -2673,12 +4252,45 @@ void push_buffer(struct file_buffer *file_buffer)
 }
 
 
+/*
+ * The next file of a reader batch, moved to the start of the buffer over
+ * the files before it, which their writers have finished with.  The batch
+ * is put by each of them, and so freed with the last
+ */
+struct file_buffer *batch_buffer = NULL;
+int batch_left, batch_offset;
+
+struct file_buffer *batch_next()
+{
+	struct file_buffer *file_buffer = batch_buffer;
+	unsigned int size;
+
+	memcpy(&size, file_buffer->data + batch_offset, BATCH_HEADER);
+	memmove(file_buffer->data, file_buffer->data + batch_offset +
+		BATCH_HEADER, size);
+	batch_offset += BATCH_HEADER + size;
+	if(-- batch_left == 0)
+		batch_buffer = NULL;
+
+	file_buffer->file_size = file_buffer->size = size;
+	file_buffer->block = 0;
+	file_buffer->fragment = TRUE;
+	/* as deflate_block() would have done */
+	file_buffer->c_byte = sparse_files && all_zero(file_buffer) ? 0 : size;
+
+	return file_buffer;
+}
+
+
 struct file_buffer *get_file_buffer(struct queue *queue)
 {
 	static unsigned int sequence = 0;
 	int hash = BLOCK_HASH(sequence);
 	struct file_buffer *file_buffer = block_hash[hash], *prev = NULL;
 
+	if(batch_buffer)
+		return batch_next();
+
 	for(;file_buffer; prev = file_buffer, file_buffer = file_buffer->next)
 		if(file_buffer->sequence == sequence)
 			break;
@@ -2691,6 +4303,8 @@ struct file_buffer *get_file_buffer(struct queue *queue)
 	} else {
 		while(1) {
 			file_buffer = queue_get(queue);
+			/* a deflator may be waiting for room to queue a block */
+			wake_deflators();
 			if(file_buffer->sequence == sequence)
 				break;
 			push_buffer(file_buffer);
@@ -2699,6 +4313,16 @@ struct file_buffer *get_file_buffer(struct queue *queue)
 
 	sequence ++;
 
+	if(file_buffer->batch) {
+		pthread_mutex_lock(&file_buffer->cache->mutex);
+		file_buffer->used = file_buffer->batch;
+		pthread_mutex_unlock(&file_buffer->cache->mutex);
+		batch_buffer = file_buffer;
+		batch_left = file_buffer->batch;
+		batch_offset = 0;
+		return batch_next();
+	}
+
 	return file_buffer;
 }
 
@@ -2822,7 +4446,7 @@ void write_file_empty(squashfs_inode *inode, struct dir_ent *dir_ent,
 
 void write_file_frag_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	int size, int *duplicate_file, struct file_buffer *file_buffer,
-	unsigned short checksum)
+	unsigned short checksum, int checksum_flag)
 {
 	struct file_info *dupl_ptr;
 	struct fragment *fragment;
@@ -2830,11 +4454,12 @@ void write_file_frag_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	long long start = 0;
 
 	dupl_ptr = duplicate(size, 0, &block_listp, &start, &fragment,
-		file_buffer, 0, 0, checksum, TRUE);
+		file_buffer, 0, 0, checksum, checksum_flag,
+		file_content_hash(dir_ent));
 
 	if(dupl_ptr) {
 		*duplicate_file = FALSE;
-		fragment = get_and_fill_fragment(file_buffer);
+		fragment = get_and_fill_fragment(file_buffer, dir_ent);
 		dupl_ptr->fragment = fragment;
 	} else
 		*duplicate_file = TRUE;
@@ -2855,22 +4480,31 @@ void write_file_frag(squashfs_inode *inode, struct dir_ent *dir_ent, int size,
 	struct file_buffer *file_buffer, int *duplicate_file)
 {
 	struct fragment *fragment;
-	unsigned short checksum;
+	unsigned long long *content_hash = file_content_hash(dir_ent);
+	unsigned short checksum = 0;
+	/*
+	 * the checksum is only needed to compare against files without a
+	 * content hash, so when this file has one it is computed on demand
+	 */
+	int checksum_flag = content_hash == NULL;
 
-	checksum = get_checksum_mem_buffer(file_buffer);
+	if(checksum_flag)
+		checksum = get_checksum_mem_buffer(file_buffer);
 
-	if(pre_duplicate_frag(size, checksum)) {
+	if(pre_duplicate_frag(size, file_buffer, &checksum, &checksum_flag,
+			content_hash)) {
 		write_file_frag_dup(inode, dir_ent, size, duplicate_file,
-			file_buffer, checksum);
+			file_buffer, checksum, checksum_flag);
 		return;
 	}
 		
-	fragment = get_and_fill_fragment(file_buffer);
+	fragment = get_and_fill_fragment(file_buffer, dir_ent);
 
 	cache_block_put(file_buffer);
 
 	if(duplicate_checking)
-		add_non_dup(size, 0, NULL, 0, fragment, 0, checksum, TRUE);
+		add_non_dup(size, 0, NULL, 0, 0, fragment, 0, checksum,
+			checksum_flag, content_hash);
 
 	total_bytes += size;
 	file_count ++;
@@ -2935,19 +4569,19 @@ int write_file_process(squashfs_inode *inode, struct dir_ent *dir_ent,
 	}
 
 	unlock_fragments();
-	fragment = get_and_fill_fragment(fragment_buffer);
+	fragment = get_and_fill_fragment(fragment_buffer, dir_ent);
 	cache_block_put(fragment_buffer);
 
 	if(duplicate_checking)
-		add_non_dup(read_size, file_bytes, block_list, start, fragment,
-			0, 0, FALSE);
+		add_non_dup(read_size, file_bytes, block_list, block, start,
+			fragment, 0, 0, FALSE, NULL);
 	file_count ++;
 	total_bytes += read_size;
 
 	create_inode(inode, NULL, dir_ent, SQUASHFS_FILE_TYPE, read_size, start,
 		 block, block_list, fragment, NULL, sparse);
 
-	if(duplicate_checking == FALSE)
+	if(duplicate_checking == FALSE || spill)
 		free(block_list);
 
 	return 0;
@@ -3023,12 +4657,12 @@ int write_file_blocks(squashfs_inode *inode, struct dir_ent *dir_ent,
 	}
 
 	unlock_fragments();
-	fragment = get_and_fill_fragment(fragment_buffer);
+	fragment = get_and_fill_fragment(fragment_buffer, dir_ent);
 	cache_block_put(fragment_buffer);
 
 	if(duplicate_checking)
-		add_non_dup(read_size, file_bytes, block_list, start, fragment,
-			0, 0, FALSE);
+		add_non_dup(read_size, file_bytes, block_list, blocks, start,
+			fragment, 0, 0, FALSE, file_content_hash(dir_ent));
 	file_count ++;
 	total_bytes += read_size;
 
@@ -3046,7 +4680,7 @@ int write_file_blocks(squashfs_inode *inode, struct dir_ent *dir_ent,
 	create_inode(inode, NULL, dir_ent, SQUASHFS_FILE_TYPE, read_size, start,
 		 blocks, block_list, fragment, NULL, sparse);
 
-	if(duplicate_checking == FALSE)
+	if(duplicate_checking == FALSE || spill)
 		free(block_list);
 
 	return 0;
@@ -3078,7 +4712,7 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	int *duplicate_file)
 {
 	int block, thresh;
-	long long file_bytes, dup_start, start;
+	long long file_bytes, dup_start, start, run = -1;
 	struct fragment *fragment;
 	struct file_info *dupl_ptr;
 	int blocks = (read_size + block_size - 1) >> block_log;
@@ -3087,12 +4721,19 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	int status, num_locked_fragments;
 	long long sparse = 0;
 	struct file_buffer *fragment_buffer = NULL;
+	unsigned long long *hashes = NULL;
 
 	block_list = malloc(blocks * sizeof(unsigned int));
 	if(block_list == NULL)
 		BAD_ERROR("Out of memory allocating block_list\n");
 	block_listp = block_list;
 
+	if(block_dedup) {
+		hashes = malloc(blocks * 2 * sizeof(unsigned long long));
+		if(hashes == NULL)
+			BAD_ERROR("Out of memory allocating block hashes\n");
+	}
+
 	buffer_list = malloc(blocks * sizeof(struct file_buffer *));
 	if(buffer_list == NULL)
 		BAD_ERROR("Out of memory allocating file block list\n");
@@ -3116,6 +4757,9 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 				bytes += read_buffer->size;
 				file_bytes += read_buffer->size;
 				cache_rehash(read_buffer, read_buffer->block);
+				if(hashes)
+					data_block_hash(read_buffer, hashes +
+						block * 2);
 				if(block < thresh) {
 					buffer_list[block] = NULL;
 					queue_put(to_writer, read_buffer);
@@ -3137,17 +4781,27 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	}
 
 	dupl_ptr = duplicate(read_size, file_bytes, &block_listp, &dup_start,
-		&fragment, fragment_buffer, blocks, 0, 0, FALSE);
+		&fragment, fragment_buffer, blocks, 0, 0, FALSE,
+		file_content_hash(dir_ent));
 
-	if(dupl_ptr) {
+	if(dupl_ptr && hashes)
+		run = dedup_block_run(blocks, block_list, hashes);
+
+	if(dupl_ptr && run == -1) {
 		*duplicate_file = FALSE;
 		for(block = thresh; block < blocks; block ++)
 			if(buffer_list[block])
 				queue_put(to_writer, buffer_list[block]);
-		fragment = get_and_fill_fragment(fragment_buffer);
+		if(hashes)
+			add_dedup_blocks(start, blocks, block_list, hashes);
+		fragment = get_and_fill_fragment(fragment_buffer, dir_ent);
 		dupl_ptr->fragment = fragment;
 	} else {
-		*duplicate_file = TRUE;
+		/*
+		 * either the whole file is a duplicate, or (-block-dedup) its
+		 * blocks are, in which case it still gets its own fragment
+		 */
+		*duplicate_file = dupl_ptr == NULL;
 		for(block = thresh; block < blocks; block ++)
 			cache_block_put(buffer_list[block]);
 		bytes = start;
@@ -3162,11 +4816,18 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 				BAD_ERROR("Failed to truncate dest file because"
 					"  %s\n", strerror(errno));
 		}
+		if(dupl_ptr) {
+			dup_start = dupl_ptr->start = run;
+			fragment = get_and_fill_fragment(fragment_buffer,
+				dir_ent);
+			dupl_ptr->fragment = fragment;
+		}
 	}
 
 	unlock_fragments();
 	cache_block_put(fragment_buffer);
 	free(buffer_list);
+	free(hashes);
 	file_count ++;
 	total_bytes += read_size;
 
@@ -3184,7 +4845,7 @@ int write_file_blocks_dup(squashfs_inode *inode, struct dir_ent *dir_ent,
 	create_inode(inode, NULL, dir_ent, SQUASHFS_FILE_TYPE, read_size,
 		dup_start, blocks, block_listp, fragment, NULL, sparse);
 
-	if(*duplicate_file == TRUE)
+	if(*duplicate_file == TRUE || spill)
 		free(block_list);
 
 	return 0;
@@ -3209,6 +4870,7 @@ read_err:
 		cache_block_put(buffer_list[blocks]);
 	free(buffer_list);
 	free(block_list);
+	free(hashes);
 	cache_block_put(read_buffer);
 	return status;
 }
@@ -3219,7 +4881,10 @@ void write_file(squashfs_inode *inode, struct dir_ent *dir_ent,
 {
 	int status;
 	struct file_buffer *read_buffer;
-	long long read_size;
+	long long read_size = 0, fmk_start;
+
+	autosize_buffers();
+	FMK_STAGE_BEGIN(write_file, fmk_start);
 
 again:
 	read_buffer = get_file_buffer(from_deflate);
@@ -3241,7 +4906,7 @@ again:
 	} else if(read_buffer->fragment && read_buffer->c_byte)
 		write_file_frag(inode, dir_ent, read_size, read_buffer,
 			duplicate_file);
-	else if(pre_duplicate(read_size))
+	else if(block_dedup || pre_duplicate(read_size))
 		status = write_file_blocks_dup(inode, dir_ent, read_size,
 			read_buffer, duplicate_file);
 	else
@@ -3258,6 +4923,10 @@ file_err:
 			dir_ent->pathname);
 		write_file_empty(inode, dir_ent, duplicate_file);
 	}
+	if(report)
+		report_duplicate(dir_ent->inode, *duplicate_file);
+	FMK_STAGE_END(write_file, fmk_start, read_size > 0 ? read_size : 0,
+		read_size > 0 ? read_size : 0);
 }
 
 
@@ -3314,20 +4983,60 @@ char *basename_r()
 }
 
 
+static struct inode_slot *inode_hash_slot(struct inode_slot *table,
+	unsigned int size, dev_t dev, ino_t ino)
+{
+	unsigned int i = dev_ino_hash(dev, ino) & (size - 1);
+
+	while(table[i].inode && (table[i].ino != ino || table[i].dev != dev))
+		i = (i + 1) & (size - 1);
+
+	return &table[i];
+}
+
+
+static void inode_hash_grow()
+{
+	unsigned int i, size = inode_hash_size ? inode_hash_size << 1 :
+		INODE_HASH_MIN;
+	struct inode_slot *table = calloc(size, sizeof(struct inode_slot));
+
+	if(table == NULL)
+		BAD_ERROR("Out of memory in inode hash table allocation\n");
+
+	for(i = 0; i < inode_hash_size; i ++)
+		if(inode_hash[i].inode)
+			*inode_hash_slot(table, size, inode_hash[i].dev,
+				inode_hash[i].ino) = inode_hash[i];
+
+	free(inode_hash);
+	inode_hash = table;
+	inode_hash_size = size;
+}
+
+
 struct inode_info *lookup_inode(struct stat *buf)
 {
-	int inode_hash = INODE_HASH(buf->st_dev, buf->st_ino);
-	struct inode_info *inode = inode_info[inode_hash];
+	struct inode_slot *slot;
+	struct inode_info *inode;
+
+	if(inode_hash_count >= inode_hash_size >> 1)
+		inode_hash_grow();
 
-	while(inode != NULL) {
+	slot = inode_hash_slot(inode_hash, inode_hash_size, buf->st_dev,
+		buf->st_ino);
+
+	/*
+	 * inodes with the same (st_dev, st_ino), but a different stat (files
+	 * changed during the scan), are chained off the slot, newest first
+	 */
+	for(inode = slot->inode; inode; inode = inode->next)
 		if(memcmp(buf, &inode->buf, sizeof(struct stat)) == 0) {
 			inode->nlink ++;
 			return inode;
 		}
-		inode = inode->next;
-	}
 
-	inode = malloc(sizeof(struct inode_info));
+	inode = arena_alloc(&tree_arena, sizeof(struct inode_info));
 	if(inode == NULL)
 		BAD_ERROR("Out of memory in inode hash table entry allocation"
 			"\n");
@@ -3336,6 +5045,11 @@ struct inode_info *lookup_inode(struct stat *buf)
 	inode->read = FALSE;
 	inode->root_entry = FALSE;
 	inode->pseudo_file = FALSE;
+	inode->pseudo_owner = FALSE;
+	inode->symlink = NULL;
+	inode->deferred = NULL;
+	inode->xattr_scanned = FALSE;
+	inode->xattrs = NULL;
 	inode->inode = SQUASHFS_INVALID_BLK;
 	inode->nlink = 1;
 
@@ -3348,8 +5062,13 @@ struct inode_info *lookup_inode(struct stat *buf)
 	else
 		inode->inode_number = inode_no ++;
 
-	inode->next = inode_info[inode_hash];
-	inode_info[inode_hash] = inode;
+	if(slot->inode == NULL) {
+		slot->dev = buf->st_dev;
+		slot->ino = buf->st_ino;
+		inode_hash_count ++;
+	}
+	inode->next = slot->inode;
+	slot->inode = inode;
 
 	return inode;
 }
@@ -3365,15 +5084,20 @@ inline void add_dir_entry(char *name, char *pathname, struct dir_info *sub_dir,
 			BAD_ERROR("Out of memory in add_dir_entry\n");
 	}
 
-	dir->list[dir->count] = malloc(sizeof(struct dir_ent));
+	dir->list[dir->count] = arena_alloc(&tree_arena,
+		sizeof(struct dir_ent));
 	if(dir->list[dir->count] == NULL)
 		BAD_ERROR("Out of memory in linux_opendir\n");
 
 	if(sub_dir)
 		sub_dir->dir_ent = dir->list[dir->count];
-	dir->list[dir->count]->name = strdup(name);
-	dir->list[dir->count]->pathname = pathname != NULL ? strdup(pathname) :
-		NULL;
+	/* names repeat across directories, so share one copy */
+	dir->list[dir->count]->name = arena_intern(&tree_arena, name);
+	dir->list[dir->count]->pathname = pathname != NULL ?
+		arena_strdup(&tree_arena, pathname) : NULL;
+	if(dir->list[dir->count]->name == NULL || (pathname &&
+			dir->list[dir->count]->pathname == NULL))
+		BAD_ERROR("Out of memory in add_dir_entry\n");
 	dir->list[dir->count]->inode = inode_info;
 	dir->list[dir->count]->dir = sub_dir;
 	dir->list[dir->count++]->our_dir = dir;
@@ -3381,18 +5105,125 @@ inline void add_dir_entry(char *name, char *pathname, struct dir_info *sub_dir,
 }
 
 
-int compare_name(const void *ent1_ptr, const void *ent2_ptr)
+/*
+ * Directories are sorted on a key of the first 8 bytes of each name, big
+ * endian so keys order as strcmp() orders the names, falling back to
+ * strcmp() only for names sharing those 8 bytes.  Small directories are
+ * qsort()ed on the keys, which saves chasing the name pointers, large
+ * ones (/usr/lib, /dev) radix sorted a byte at a time
+ */
+#define SORT_RADIX_MIN		256
+
+struct sort_key {
+	unsigned long long	key;
+	struct dir_ent		*dir_ent;
+};
+
+
+unsigned long long name_key(char *name)
+{
+	unsigned long long key = 0;
+	int i;
+
+	for(i = 0; i < 8; i++) {
+		key <<= 8;
+		if(*name)
+			key |= (unsigned char) *name ++;
+	}
+
+	return key;
+}
+
+
+int compare_key(const void *key1_ptr, const void *key2_ptr)
+{
+	const struct sort_key *key1 = key1_ptr, *key2 = key2_ptr;
+
+	if(key1->key != key2->key)
+		return key1->key < key2->key ? -1 : 1;
+
+	return strcmp(key1->dir_ent->name, key2->dir_ent->name);
+}
+
+
+void radix_sort_keys(struct sort_key *keys, int count)
+{
+	struct sort_key *temp = malloc(count * sizeof(struct sort_key));
+	struct sort_key *from = keys, *to = temp, *swap;
+	int i, byte, start;
+
+	if(temp == NULL)
+		BAD_ERROR("Out of memory in radix_sort_keys\n");
+
+	/* least significant byte first, skipping bytes all the keys share */
+	for(byte = 0; byte < 8; byte++) {
+		int counts[256] = { 0 }, shift = byte * 8;
+
+		for(i = 0; i < count; i++)
+			counts[(from[i].key >> shift) & 0xff] ++;
+		if(counts[(from[0].key >> shift) & 0xff] == count)
+			continue;
+
+		for(start = 0, i = 0; i < 256; i++) {
+			int n = counts[i];
+
+			counts[i] = start;
+			start += n;
+		}
+		for(i = 0; i < count; i++)
+			to[counts[(from[i].key >> shift) & 0xff] ++] = from[i];
+
+		swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if(from != keys)
+		memcpy(keys, from, count * sizeof(struct sort_key));
+	free(temp);
+
+	/* names sharing a key are ordered by the rest of the name */
+	for(start = 0; start < count; start = i) {
+		for(i = start + 1; i < count && keys[i].key == keys[start].key;
+				i++);
+		if(i - start > 1)
+			qsort(keys + start, i - start, sizeof(struct sort_key),
+				compare_key);
+	}
+}
+
+
+void sort_dir_entries(struct dir_info *dir)
 {
-	struct dir_ent *ent1 = *((struct dir_ent **) ent1_ptr);
-	struct dir_ent *ent2 = *((struct dir_ent **) ent2_ptr);
+	struct sort_key *keys;
+	int i;
+
+	if(dir->count > 1) {
+		keys = malloc(dir->count * sizeof(struct sort_key));
+		if(keys == NULL)
+			BAD_ERROR("Out of memory in sort_directory\n");
+
+		for(i = 0; i < dir->count; i++) {
+			keys[i].key = name_key(dir->list[i]->name);
+			keys[i].dir_ent = dir->list[i];
+		}
+
+		if(dir->count >= SORT_RADIX_MIN)
+			radix_sort_keys(keys, dir->count);
+		else
+			qsort(keys, dir->count, sizeof(struct sort_key),
+				compare_key);
 
-	return strcmp(ent1->name, ent2->name);
+		for(i = 0; i < dir->count; i++)
+			dir->list[i] = keys[i].dir_ent;
+		free(keys);
+	}
 }
 
 
 void sort_directory(struct dir_info *dir)
 {
-	qsort(dir->list, dir->count, sizeof(struct dir_ent *), compare_name);
+	sort_dir_entries(dir);
 
 	if((dir->count < 257 && dir->byte_count < SQUASHFS_METADATA_SIZE))
 		dir->dir_is_ldir = FALSE;
@@ -3402,16 +5233,19 @@ void sort_directory(struct dir_info *dir)
 struct dir_info *scan1_opendir(char *pathname)
 {
 	struct dir_info *dir;
+	DIR *linuxdir = NULL;
 
-	dir = malloc(sizeof(struct dir_info));
+	if(pathname[0] != '\0' && (linuxdir = opendir(pathname)) == NULL)
+		return NULL;
+
+	dir = arena_alloc(&tree_arena, sizeof(struct dir_info));
 	if(dir == NULL)
 		BAD_ERROR("Out of memory in scan1_opendir\n");
 
-	if(pathname[0] != '\0' && (dir->linuxdir = opendir(pathname)) == NULL) {
-		free(dir);
-		return NULL;
-	}
-	dir->pathname = strdup(pathname);
+	dir->linuxdir = linuxdir;
+	dir->pathname = arena_strdup(&scan_arena, pathname);
+	if(dir->pathname == NULL)
+		BAD_ERROR("Out of memory in scan1_opendir\n");
 	dir->count = dir->directory_count = dir->current_count = dir->byte_count
 		= 0;
 	dir->dir_is_ldir = TRUE;
@@ -3529,11 +5363,27 @@ struct dir_ent *scan2_readdir(struct dir_info *dir_info)
 }
 
 
-struct dir_ent *scan2_lookup(struct dir_info *dir, char *name)
+/*
+ * The first sorted entries of dir are in name order, and binary searched,
+ * those added after by dir_scan2() are searched in turn
+ */
+struct dir_ent *scan2_lookup(struct dir_info *dir, int sorted, char *name)
 {
-	int i;
+	int i, low = 0, high = sorted - 1;
 
-	for(i = 0; i < dir->count; i++)
+	while(low <= high) {
+		int mid = (low + high) / 2;
+		int res = strcmp(dir->list[mid]->name, name);
+
+		if(res == 0)
+			return dir->list[mid];
+		if(res < 0)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	for(i = sorted; i < dir->count; i++)
 		if(strcmp(dir->list[i]->name, name) == 0)
 			return dir->list[i];
 
@@ -3561,7 +5411,6 @@ void scan1_freedir(struct dir_info *dir)
 {
 	if(dir->pathname[0] != '\0')
 		closedir(dir->linuxdir);
-	free(dir->pathname);
 	dir->pathname = NULL;
 }
 
@@ -3569,10 +5418,7 @@ void scan1_freedir(struct dir_info *dir)
 void scan2_freedir(struct dir_info *dir)
 {
 	dir->current_count = 0;
-	if(dir->pathname) {
-		free(dir->pathname);
-		dir->pathname = NULL;
-	}
+	dir->pathname = NULL;
 }
 
 
@@ -3584,19 +5430,349 @@ void scan3_freedir(struct directory *dir)
 }
 
 
+/*
+ * Parallel lstat for dir_scan1().  Before the scan a pool of threads walks
+ * the source tree, reading directories and stat'ing their entries ahead of
+ * dir_scan1(), which picks the results up by pathname.  dir_scan1() still
+ * builds the tree (and allocates the inode numbers) on one thread, in the
+ * same order as before, so the output doesn't depend on which thread
+ * stat'ed what.  On slow (network) filesystems the stat latency rather
+ * than the CPU bounds the scan, so the pool isn't sized by processors
+ */
+#define SCAN_THREADS		8
+#define SCAN_CHUNK		32
+#define SCAN_HASH_SIZE		65536
+#define SCAN_HASH(a)		(a & (SCAN_HASH_SIZE - 1))
+
+struct scan_entry {
+	char			*pathname;
+	struct stat		buf;
+	int			error;
+	void			*xattrs;
+	struct scan_entry	*next;
+};
+
+/* either a directory to read, or up to SCAN_CHUNK entries to stat */
+struct scan_job {
+	char			*dir;
+	char			*pathname[SCAN_CHUNK];
+	int			count;
+	struct scan_job		*next;
+};
+
+struct scan_entry *scan_table[SCAN_HASH_SIZE];
+struct scan_job *scan_jobs = NULL;
+int scan_busy = 0, scan_done = TRUE;
+volatile int scan_cancel = FALSE;
+pthread_t scan_thread_id[SCAN_THREADS];
+pthread_mutex_t scan_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t scan_waiting = PTHREAD_COND_INITIALIZER;
+
+
+unsigned int scan_hash(char *pathname)
+{
+	unsigned int hash = 5381;
+
+	while(*pathname)
+		hash = hash * 33 + *pathname++;
+
+	return SCAN_HASH(hash);
+}
+
+
+struct scan_job *scan_new_job(char *dir)
+{
+	struct scan_job *job = malloc(sizeof(struct scan_job));
+
+	if(job == NULL)
+		BAD_ERROR("Out of memory in scan_new_job\n");
+
+	job->dir = dir;
+	job->count = 0;
+
+	return job;
+}
+
+
+/*
+ * Queue stat jobs for the pathnames.  The job list is a stack, so pushing
+ * the chunks last first has them stat'ed in directory order, and
+ * directories found are read before their siblings' entries are stat'ed,
+ * roughly the depth first order dir_scan1() asks for them
+ */
+void scan_push_stats(char **pathname, int count)
+{
+	struct scan_job *job = NULL, *jobs = NULL;
+	int i;
+
+	for(i = 0; i < count; i++) {
+		if(job == NULL || job->count == SCAN_CHUNK) {
+			job = scan_new_job(NULL);
+			job->next = jobs;
+			jobs = job;
+		}
+		job->pathname[job->count ++] = pathname[i];
+	}
+
+	pthread_mutex_lock(&scan_mutex);
+	while(jobs) {
+		job = jobs;
+		jobs = jobs->next;
+		job->next = scan_jobs;
+		scan_jobs = job;
+	}
+	pthread_cond_broadcast(&scan_waiting);
+	pthread_mutex_unlock(&scan_mutex);
+}
+
+
+void scan_read_dir(char *dir)
+{
+	DIR *linuxdir = opendir(dir);
+	struct dirent *d_name;
+	char **pathname = NULL;
+	int count = 0;
+
+	/* errors are reported by dir_scan1() when it opens the directory */
+	if(linuxdir == NULL)
+		return;
+
+	while((d_name = readdir(linuxdir)) != NULL) {
+		if(strcmp(d_name->d_name, ".") == 0 ||
+				strcmp(d_name->d_name, "..") == 0)
+			continue;
+
+		if((count % DIR_ENTRIES) == 0) {
+			pathname = realloc(pathname, (count + DIR_ENTRIES) *
+				sizeof(char *));
+			if(pathname == NULL)
+				BAD_ERROR("Out of memory in scan_read_dir\n");
+		}
+
+		pathname[count] = malloc(strlen(dir) + strlen(d_name->d_name)
+			+ 2);
+		if(pathname[count] == NULL)
+			BAD_ERROR("Out of memory in scan_read_dir\n");
+		strcat(strcat(strcpy(pathname[count], dir), "/"),
+			d_name->d_name);
+		count ++;
+	}
+	closedir(linuxdir);
+
+	scan_push_stats(pathname, count);
+	free(pathname);
+}
+
+
+void scan_stat(struct scan_job *job)
+{
+	struct scan_entry *entry, *entries = NULL;
+	char *dir[SCAN_CHUNK];
+	int i, dirs = 0;
+
+	for(i = 0; i < job->count; i++) {
+		entry = malloc(sizeof(struct scan_entry));
+		if(entry == NULL)
+			BAD_ERROR("Out of memory in scan_stat\n");
+
+		entry->pathname = job->pathname[i];
+		entry->error = lstat(entry->pathname, &entry->buf) == -1 ?
+			errno : 0;
+		entry->xattrs = entry->error || no_xattrs ? NULL :
+			scan_xattrs(entry->pathname);
+		if(entry->error == 0 && S_ISDIR(entry->buf.st_mode))
+			dir[dirs ++] = entry->pathname;
+		entry->next = entries;
+		entries = entry;
+	}
+
+	pthread_mutex_lock(&scan_mutex);
+	while(entries) {
+		int hash = scan_hash(entries->pathname);
+
+		entry = entries;
+		entries = entries->next;
+		entry->next = scan_table[hash];
+		scan_table[hash] = entry;
+	}
+	for(i = dirs - 1; i >= 0; i--) {
+		struct scan_job *dir_job = scan_new_job(strdup(dir[i]));
+
+		dir_job->next = scan_jobs;
+		scan_jobs = dir_job;
+	}
+	pthread_cond_broadcast(&scan_waiting);
+	pthread_mutex_unlock(&scan_mutex);
+}
+
+
+void *scan_thread(void *arg)
+{
+	while(1) {
+		struct scan_job *job;
+
+		pthread_mutex_lock(&scan_mutex);
+		while(scan_jobs == NULL && scan_busy)
+			pthread_cond_wait(&scan_waiting, &scan_mutex);
+		if(scan_jobs == NULL) {
+			scan_done = TRUE;
+			pthread_cond_broadcast(&scan_waiting);
+			pthread_mutex_unlock(&scan_mutex);
+			return NULL;
+		}
+		job = scan_jobs;
+		scan_jobs = job->next;
+		scan_busy ++;
+		pthread_mutex_unlock(&scan_mutex);
+
+		if(scan_cancel) {
+			/* dir_scan1() has finished, drop what's left */
+			int i;
+
+			for(i = 0; i < job->count; i++)
+				free(job->pathname[i]);
+		} else if(job->dir)
+			scan_read_dir(job->dir);
+		else
+			scan_stat(job);
+		free(job->dir);
+		free(job);
+
+		pthread_mutex_lock(&scan_mutex);
+		scan_busy --;
+		pthread_cond_broadcast(&scan_waiting);
+		pthread_mutex_unlock(&scan_mutex);
+	}
+}
+
+
+void scan_start(char *pathname)
+{
+	sigset_t sigmask, old_mask;
+	int i;
+
+	scan_done = scan_cancel = FALSE;
+
+	if(pathname[0] != '\0') {
+		scan_jobs = scan_new_job(strdup(pathname));
+		scan_jobs->next = NULL;
+	} else {
+		char **paths = malloc(source * sizeof(char *));
+
+		if(paths == NULL)
+			BAD_ERROR("Out of memory in scan_start\n");
+		for(i = 0; i < source; i++)
+			paths[i] = strdup(source_path[i]);
+		scan_push_stats(paths, source);
+		free(paths);
+	}
+
+	/* leave the signals to the main thread, as initialise_threads does */
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGINT);
+	sigaddset(&sigmask, SIGQUIT);
+	sigaddset(&sigmask, SIGUSR1);
+	if(sigprocmask(SIG_BLOCK, &sigmask, &old_mask) == -1)
+		BAD_ERROR("Failed to set signal mask in scan_start\n");
+
+	for(i = 0; i < SCAN_THREADS; i++)
+		if(pthread_create(&scan_thread_id[i], NULL, scan_thread, NULL)
+				!= 0)
+			BAD_ERROR("Failed to create scan thread\n");
+
+	if(sigprocmask(SIG_SETMASK, &old_mask, NULL) == -1)
+		BAD_ERROR("Failed to set signal mask in scan_start\n");
+}
+
+
+/*
+ * Returns the stat of pathname, waiting for the scan threads if they
+ * haven't got to it yet.  Anything they never saw (created since they read
+ * its directory) is stat'ed here once they have finished.  Returns TRUE in
+ * scanned if the scan threads also read its xattrs, into xattrs
+ */
+int scan_lstat(char *pathname, struct stat *buf, int *scanned, void **xattrs)
+{
+	struct scan_entry *entry, **prev;
+	int hash = scan_hash(pathname), error;
+
+	pthread_mutex_lock(&scan_mutex);
+	while(1) {
+		for(prev = &scan_table[hash]; *prev && strcmp((*prev)->pathname,
+				pathname) != 0; prev = &(*prev)->next);
+		if(*prev || scan_done)
+			break;
+		pthread_cond_wait(&scan_waiting, &scan_mutex);
+	}
+	entry = *prev;
+	if(entry)
+		*prev = entry->next;
+	pthread_mutex_unlock(&scan_mutex);
+
+	*scanned = entry && !no_xattrs;
+	*xattrs = NULL;
+	if(entry == NULL)
+		return lstat(pathname, buf);
+
+	memcpy(buf, &entry->buf, sizeof(struct stat));
+	*xattrs = entry->xattrs;
+	error = entry->error;
+	free(entry->pathname);
+	free(entry);
+
+	if(error) {
+		errno = error;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Stop the scan threads, anything still queued or not picked up is under
+ * an excluded directory
+ */
+void scan_finish()
+{
+	int i;
+
+	scan_cancel = TRUE;
+	for(i = 0; i < SCAN_THREADS; i++)
+		pthread_join(scan_thread_id[i], NULL);
+
+	for(i = 0; i < SCAN_HASH_SIZE; i++)
+		while(scan_table[i]) {
+			struct scan_entry *entry = scan_table[i];
+
+			scan_table[i] = entry->next;
+			free(entry->pathname);
+			free(entry);
+		}
+}
+
+
 void dir_scan(squashfs_inode *inode, char *pathname,
 	int (_readdir)(char *, char *, struct dir_info *))
 {
 	struct stat buf;
-	struct dir_info *dir_info = dir_scan1(pathname, paths, _readdir);
+	struct dir_info *dir_info;
 	struct dir_ent *dir_ent;
-	
+	long long fmk_start;
+
+	FMK_STAGE_BEGIN(scan, fmk_start);
+	scan_start(pathname);
+	dir_info = dir_scan1(pathname, paths, _readdir);
+	scan_finish();
+	FMK_STAGE_END(scan, fmk_start, 0, 0);
+
 	if(dir_info == NULL)
 		return;
 
 	dir_scan2(dir_info, pseudo);
+	arena_free(&scan_arena);
 
-	dir_ent = malloc(sizeof(struct dir_ent));
+	dir_ent = arena_alloc(&tree_arena, sizeof(struct dir_ent));
 	if(dir_ent == NULL)
 		BAD_ERROR("Out of memory in dir_scan\n");
 
@@ -3609,7 +5785,7 @@ void dir_scan(squashfs_inode *inode, char *pathname,
 		buf.st_mode = S_IRWXU | S_IRWXG | S_IRWXO | S_IFDIR;
 		buf.st_uid = getuid();
 		buf.st_gid = getgid();
-		buf.st_mtime = time(NULL);
+		buf.st_mtime = build_time();
 		buf.st_dev = 0;
 		buf.st_ino = 0;
 		dir_ent->inode = lookup_inode(&buf);
@@ -3623,15 +5799,31 @@ void dir_scan(squashfs_inode *inode, char *pathname,
 		dir_ent->inode = lookup_inode(&buf);
 	}
 
+	if(pseudo_root) {
+		dir_ent->inode->buf.st_mode = (buf.st_mode & S_IFMT) |
+			pseudo_root->mode;
+		dir_ent->inode->buf.st_uid = pseudo_root->uid;
+		dir_ent->inode->buf.st_gid = pseudo_root->gid;
+		dir_ent->inode->pseudo_owner = TRUE;
+	}
+
 	if(root_inode_number) {
 		dir_ent->inode->inode_number = root_inode_number;
 		dir_inode_no --;
 	}
-	dir_ent->name = dir_ent->pathname = strdup(pathname);
+	dir_ent->name = dir_ent->pathname = arena_strdup(&tree_arena,
+		pathname);
+	if(dir_ent->name == NULL)
+		BAD_ERROR("Out of memory in dir_scan\n");
 	dir_ent->dir = dir_info;
 	dir_ent->our_dir = NULL;
 	dir_info->dir_ent = dir_ent;
 
+	if(estimate) {
+		estimate_filesystem(dir_info, comp);
+		exit(0);
+	}
+
 	if(sorted) {
 		int res = generate_file_priorities(dir_info, 0,
 			&dir_info->dir_ent->inode->buf);
@@ -3650,6 +5842,126 @@ void dir_scan(squashfs_inode *inode, char *pathname,
 }
 
 
+/*
+ * -stream input.  Regular files are written as they arrive from the
+ * reader, the entries being added to the pseudo files, which once the
+ * stream has ended dir_scan2() makes the directory tree from
+ */
+void add_stream_entry(struct stream_entry *entry)
+{
+	struct inode_info *inode = entry->inode;
+	struct pseudo_dev *dev;
+
+	if(entry->hardlink) {
+		dev = pseudo_lookup(pseudo, entry->linkname);
+		if(dev == NULL || dev->type != 's' || S_ISDIR(dev->mode)) {
+			ERROR("Hard link %s to %s, which isn't an earlier file "
+				"in the stream, ignoring\n", entry->pathname,
+				entry->linkname);
+			return;
+		}
+		inode = dev->inode;
+	} else if(S_ISREG(inode->buf.st_mode)) {
+		struct dir_ent dir_ent;
+		squashfs_inode i_no;
+		int duplicate_file;
+
+		dir_ent.name = strrchr(entry->pathname, '/');
+		dir_ent.name = dir_ent.name ? dir_ent.name + 1 :
+			entry->pathname;
+		dir_ent.pathname = entry->pathname;
+		dir_ent.inode = inode;
+		dir_ent.dir = dir_ent.our_dir = NULL;
+
+		estimated_uncompressed += (inode->buf.st_size + block_size - 1)
+			>> block_log;
+		write_file(&i_no, &dir_ent, &duplicate_file);
+		inode->deferred->duplicate = duplicate_file;
+	}
+
+	dev = malloc(sizeof(struct pseudo_dev));
+	if(dev == NULL)
+		BAD_ERROR("Out of memory in add_stream_entry\n");
+
+	memset(dev, 0, sizeof(struct pseudo_dev));
+	dev->type = 's';
+	dev->mode = inode->buf.st_mode;
+	dev->uid = inode->buf.st_uid;
+	dev->gid = inode->buf.st_gid;
+	dev->inode = inode;
+	pseudo = add_pseudo(pseudo, dev, entry->pathname, entry->pathname);
+}
+
+
+void dir_scan_stream(squashfs_inode *inode)
+{
+	struct stream_entry *entry;
+	struct dir_info *dir_info;
+	struct dir_ent *dir_ent;
+	struct pseudo_dev *dir_dev = malloc(sizeof(struct pseudo_dev));
+	struct inode_info *root = NULL;
+	struct stat buf;
+
+	if(dir_dev == NULL)
+		BAD_ERROR("Out of memory in dir_scan_stream\n");
+
+	if(progress)
+		enable_progress_bar();
+
+	defer_inodes = TRUE;
+	while((entry = queue_get(to_stream)) != NULL) {
+		if(entry->pathname[0] != '\0')
+			add_stream_entry(entry);
+		else if(S_ISDIR(entry->buf.st_mode))
+			root = entry->inode;
+		else
+			ERROR("Root of the input stream isn't a directory, "
+				"ignoring\n");
+		stream_free(entry);
+	}
+	defer_inodes = FALSE;
+
+	/* directories that are only implied by the pathnames */
+	memset(dir_dev, 0, sizeof(struct pseudo_dev));
+	dir_dev->type = 'd';
+	dir_dev->mode = S_IFDIR | 0755;
+	pseudo_fill_dirs(pseudo, dir_dev, "");
+
+	dir_info = dir_scan2(NULL, pseudo);
+	arena_free(&scan_arena);
+
+	dir_ent = arena_alloc(&tree_arena, sizeof(struct dir_ent));
+	if(dir_ent == NULL)
+		BAD_ERROR("Out of memory in dir_scan_stream\n");
+
+	if(root) {
+		root->nlink = 1;
+		root->inode_number = dir_inode_no ++;
+		dir_ent->inode = root;
+	} else {
+		memset(&buf, 0, sizeof(buf));
+		buf.st_mode = dir_dev->mode;
+		buf.st_mtime = build_time();
+		dir_ent->inode = lookup_inode(&buf);
+		dir_ent->inode->pseudo_file = PSEUDO_FILE_OTHER;
+	}
+
+	if(root_inode_number) {
+		dir_ent->inode->inode_number = root_inode_number;
+		dir_inode_no --;
+	}
+	dir_ent->name = dir_ent->pathname = "";
+	dir_ent->dir = dir_info;
+	dir_ent->our_dir = NULL;
+	dir_info->dir_ent = dir_ent;
+
+	queue_put(to_reader, dir_info);
+	dir_scan3(inode, dir_info);
+	dir_ent->inode->inode = *inode;
+	dir_ent->inode->type = SQUASHFS_DIR_TYPE;
+}
+
+
 struct dir_info *dir_scan1(char *pathname, struct pathnames *paths,
 	int (_readdir)(char *, char *, struct dir_info *))
 {
@@ -3663,13 +5975,16 @@ struct dir_info *dir_scan1(char *pathname, struct pathnames *paths,
 
 	while(_readdir(filename, dir_name, dir) != FALSE) {
 		struct dir_info *sub_dir;
+		struct inode_info *inode;
 		struct stat buf;
 		struct pathnames *new;
+		void *xattrs;
+		int scanned;
 
 		if(strcmp(dir_name, ".") == 0 || strcmp(dir_name, "..") == 0)
 			continue;
 
-		if(lstat(filename, &buf) == -1) {
+		if(scan_lstat(filename, &buf, &scanned, &xattrs) == -1) {
 			ERROR("Cannot stat dir/file %s because %s, ignoring",
 				filename, strerror(errno));
 			continue;
@@ -3703,8 +6018,12 @@ struct dir_info *dir_scan1(char *pathname, struct pathnames *paths,
 		} else
 			sub_dir = NULL;
 
-		add_dir_entry(dir_name, filename, sub_dir, lookup_inode(&buf),
-			dir);
+		inode = lookup_inode(&buf);
+		if(scanned && !inode->xattr_scanned) {
+			inode->xattr_scanned = TRUE;
+			inode->xattrs = xattrs;
+		}
+		add_dir_entry(dir_name, filename, sub_dir, inode, dir);
 	}
 
 	scan1_freedir(dir);
@@ -3721,6 +6040,7 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 	struct pseudo_entry *pseudo_ent;
 	struct stat buf;
 	static int pseudo_ino = 1;
+	int sorted = 0;
 	
 	if(dir == NULL && (dir = scan1_opendir("")) == NULL)
 		return NULL;
@@ -3734,8 +6054,14 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 			dir_scan2(dir_ent->dir, pseudo_subdir(name, pseudo));
 	}
 
+	/* sorted here for scan2_lookup(), and again once the pseudos are in */
+	if(pseudo) {
+		sort_dir_entries(dir);
+		sorted = dir->count;
+	}
+
 	while((pseudo_ent = pseudo_readdir(pseudo)) != NULL) {
-		dir_ent = scan2_lookup(dir, pseudo_ent->name);
+		dir_ent = scan2_lookup(dir, sorted, pseudo_ent->name);
 		if(pseudo_ent->dev->type == 'm') {
 			struct stat *buf;
 			if(dir_ent == NULL) {
@@ -3756,6 +6082,7 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 				pseudo_ent->dev->mode;
 			buf->st_uid = pseudo_ent->dev->uid;
 			buf->st_gid = pseudo_ent->dev->gid;
+			dir_ent->inode->pseudo_owner = TRUE;
 			continue;
 		}
 
@@ -3774,6 +6101,30 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 			continue;
 		}
 
+		if(pseudo_ent->dev->type == 's') {
+			struct inode_info *inode = pseudo_ent->dev->inode;
+
+			if(S_ISDIR(inode->buf.st_mode)) {
+				sub_dir = dir_scan2(NULL, pseudo_ent->pseudo);
+				if(sub_dir == NULL) {
+					ERROR("Could not create directory "
+						"\"%s\", skipping...\n",
+						pseudo_ent->pathname);
+					continue;
+				}
+				dir->directory_count ++;
+			} else
+				sub_dir = NULL;
+
+			/* numbered when first linked into the tree */
+			if(inode->nlink ++ == 0)
+				inode->inode_number = S_ISDIR(inode->buf.st_mode)
+					? dir_inode_no ++ : inode_no ++;
+			add_dir_entry(pseudo_ent->name, pseudo_ent->pathname,
+				sub_dir, inode, dir);
+			continue;
+		}
+
 		if(pseudo_ent->dev->type == 'd') {
 			sub_dir = dir_scan2(NULL, pseudo_ent->pseudo);
 			if(sub_dir == NULL) {
@@ -3792,11 +6143,11 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 		buf.st_gid = pseudo_ent->dev->gid;
 		buf.st_rdev = makedev(pseudo_ent->dev->major,
 			pseudo_ent->dev->minor);
-		buf.st_mtime = time(NULL);
+		buf.st_mtime = build_time();
 		buf.st_ino = pseudo_ino ++;
 
-		if(pseudo_ent->dev->type == 'f') {
 #ifdef USE_TMP_FILE
+		if(pseudo_ent->dev->type == 'f') {
 			struct stat buf2;
 			int res = stat(pseudo_ent->dev->filename, &buf2);
 			struct inode_info *inode;
@@ -3811,16 +6162,19 @@ struct dir_info *dir_scan2(struct dir_info *dir, struct pseudo *pseudo)
 			add_dir_entry(pseudo_ent->name,
 				pseudo_ent->dev->filename, sub_dir, inode,
 				dir);
-#else
+		} else
+#endif
+		if(pseudo_ent->dev->type == 'f' ||
+				pseudo_ent->dev->type == 'g') {
 			struct inode_info *inode = lookup_inode(&buf);
 			inode->pseudo_id = pseudo_ent->dev->pseudo_id;
 			inode->pseudo_file = PSEUDO_FILE_PROCESS;		
 			add_dir_entry(pseudo_ent->name, pseudo_ent->pathname,
 				sub_dir, inode, dir);
-#endif
 		} else {
 			struct inode_info *inode = lookup_inode(&buf);
 			inode->pseudo_file = PSEUDO_FILE_OTHER;		
+			inode->pseudo_owner = TRUE;
 			add_dir_entry(pseudo_ent->name, pseudo_ent->pathname,
 				sub_dir, inode, dir);
 		}
@@ -3856,8 +6210,13 @@ void dir_scan3(squashfs_inode *inode, struct dir_info *dir_info)
 			switch(buf->st_mode & S_IFMT) {
 				case S_IFREG:
 					squashfs_type = SQUASHFS_FILE_TYPE;
-					write_file(inode, dir_ent,
-						&duplicate_file);
+					if(inode_info->deferred)
+						create_deferred_inode(inode,
+							dir_ent,
+							&duplicate_file);
+					else
+						write_file(inode, dir_ent,
+							&duplicate_file);
 					INFO("file %s, uncompressed size %lld "
 						"bytes %s\n", filename,
 						(long long) buf->st_size,
@@ -4055,19 +6414,61 @@ void add_old_root_entry(char *name, squashfs_inode inode, int inode_number,
 }
 
 
-void initialise_threads(int readb_mbytes, int writeb_mbytes,
-	int fragmentb_mbytes)
+/*
+ * Split the -mem budget between the caches in the proportions of the queue
+ * sizes, but giving each at least its fewest buffers.  A budget too small
+ * for those at this block size and number of processors is refused
+ */
+void mem_split(int readb_mbytes, int writeb_mbytes, int fragmentb_mbytes,
+	int *readb, int *writeb, int *fragmentb)
+{
+	int total = readb_mbytes + writeb_mbytes + fragmentb_mbytes;
+	int buffers = mem_mbytes << (20 - block_log);
+	int read_min = MEM_MIN_BUFFERS(processors);
+	int write_min = MEM_MIN_BUFFERS(processors);
+	int fragment_min = MEM_MIN_FRAGMENT(1);
+	int needed = read_min + write_min + fragment_min, lack, take;
+
+	if(buffers < needed) {
+		ERROR("mksquashfs: -mem %d is too small, with a block size of "
+			"%d and %d processor%s the queues need at least %lld "
+			"Mbytes\n", mem_mbytes, block_size, processors,
+			processors == 1 ? "" : "s", (((long long) needed <<
+			block_log) + (1 << 20) - 1) >> 20);
+		EXIT_MKSQUASHFS();
+	}
+
+	*readb = (long long) buffers * readb_mbytes / total;
+	*fragmentb = (long long) buffers * fragmentb_mbytes / total;
+	if(*readb < read_min)
+		*readb = read_min;
+	if(*fragmentb < fragment_min)
+		*fragmentb = fragment_min;
+	*writeb = buffers - *readb - *fragmentb;
+
+	/* raising the others can leave the writer short, take it back */
+	if(*writeb < write_min) {
+		lack = write_min - *writeb;
+		take = *readb - read_min < lack ? *readb - read_min : lack;
+		*readb -= take;
+		*fragmentb -= lack - take;
+		*writeb = write_min;
+	}
+}
+
+
+void initialise_threads(int reader_buffer_size, int writer_buffers,
+	int fragment_buffer_size)
 {
 	int i;
 	sigset_t sigmask, old_mask;
-	int reader_buffer_size = readb_mbytes << (20 - block_log);
-	int fragment_buffer_size = fragmentb_mbytes << (20 - block_log);
+	int mem_buffers = mem_mbytes << (20 - block_log);
 
 	/*
 	 * writer_buffer_size is global because it is needed in
 	 * write_file_blocks_dup()
 	 */
-	writer_buffer_size = writeb_mbytes << (20 - block_log);
+	writer_buffer_size = writer_buffers;
 
 	sigemptyset(&sigmask);
 	sigaddset(&sigmask, SIGINT);
@@ -4077,61 +6478,70 @@ void initialise_threads(int readb_mbytes, int writeb_mbytes,
 
 	signal(SIGUSR1, sigusr1_handler);
 
-#ifdef __CYGWIN__
-	processors = atoi(getenv("NUMBER_OF_PROCESSORS"));
-#else
-	if(processors == -1) {
-#ifndef linux
-		int mib[2];
-		size_t len = sizeof(processors);
-
-		mib[0] = CTL_HW;
-#ifdef HW_AVAILCPU
-		mib[1] = HW_AVAILCPU;
-#else
-		mib[1] = HW_NCPU;
-#endif
-
-		if(sysctl(mib, 2, &processors, &len, NULL, 0) == -1) {
-			ERROR("Failed to get number of available processors.  "
-				"Defaulting to 1\n");
-			processors = 1;
-		}
-#else
-		processors = sysconf(_SC_NPROCESSORS_ONLN);
-#endif
-	}
-#endif /* __CYGWIN__ */
-
-	thread = malloc((2 + processors * 2) * sizeof(pthread_t));
+	thread = malloc((2 + processors) * sizeof(pthread_t));
 	if(thread == NULL)
 		BAD_ERROR("Out of memory allocating thread descriptors\n");
 	deflator_thread = &thread[2];
-	frag_deflator_thread = &deflator_thread[processors];
 
+	/* with -mem the queues are sized for a cache having all the budget */
 	to_reader = queue_init(1);
-	from_reader = queue_init(reader_buffer_size);
-	to_writer = queue_init(writer_buffer_size);
+	from_reader = queue_init(mem_buffers ? mem_buffers :
+		reader_buffer_size);
+	to_writer = queue_init(mem_buffers ? mem_buffers : writer_buffer_size);
 	from_writer = queue_init(1);
-	from_deflate = queue_init(reader_buffer_size);
-	to_frag = queue_init(fragment_buffer_size);
+	from_deflate = queue_init(mem_buffers ? mem_buffers :
+		reader_buffer_size);
+	to_frag = queue_init(mem_buffers ? mem_buffers : fragment_buffer_size);
+	to_stream = queue_init(STREAM_QUEUE_SIZE);
+	to_meta = queue_init(processors * 2);
+	if(to_reader == NULL || from_reader == NULL || to_writer == NULL ||
+			from_writer == NULL || from_deflate == NULL ||
+			to_frag == NULL || to_stream == NULL || to_meta == NULL)
+		BAD_ERROR("Out of memory in queue_init\n");
 	reader_buffer = cache_init(block_size, reader_buffer_size);
 	writer_buffer = cache_init(block_size, writer_buffer_size);
 	fragment_buffer = cache_init(block_size, fragment_buffer_size);
+	/* one more for a -base fragment being copied while the ring is full */
+	frag_writer_buffer = reproducible ? cache_init(block_size,
+		FRAG_REORDER + 1) : writer_buffer;
+
+	/*
+	 * leave the deflators at least half the fragment cache, open fragments
+	 * can only be flushed by the main thread
+	 */
+	if(pack_fragments) {
+		frag_groups = (fragment_buffer_size - 2) / 2;
+		if(frag_groups > FRAG_GROUPS)
+			frag_groups = FRAG_GROUPS;
+		else if(frag_groups == 0)
+			frag_groups = 1;
+	}
+
+	if(mem_buffers) {
+		autosize[0].name = "read";
+		autosize[0].cache = reader_buffer;
+		autosize[0].floor = MEM_MIN_BUFFERS(processors);
+		autosize[1].name = "write";
+		autosize[1].cache = writer_buffer;
+		autosize[1].floor = MEM_MIN_BUFFERS(processors);
+		autosize[2].name = "fragment";
+		autosize[2].cache = fragment_buffer;
+		autosize[2].floor = MEM_MIN_FRAGMENT(frag_groups);
+		autosize_step = mem_buffers / AUTOSIZE_STEPS;
+		if(autosize_step == 0)
+			autosize_step = 1;
+	}
+
 	pthread_create(&thread[0], NULL, reader, NULL);
 	pthread_create(&thread[1], NULL, writer, NULL);
 	pthread_create(&progress_thread, NULL, progress_thrd, NULL);
 	pthread_mutex_init(&fragment_mutex, NULL);
 	pthread_cond_init(&fragment_waiting, NULL);
 
-	for(i = 0; i < processors; i++) {
+	for(i = 0; i < processors; i++)
 		if(pthread_create(&deflator_thread[i], NULL, deflator, NULL) !=
 				 0)
 			BAD_ERROR("Failed to create thread\n");
-		if(pthread_create(&frag_deflator_thread[i], NULL, frag_deflator,
-				NULL) != 0)
-			BAD_ERROR("Failed to create thread\n");
-	}
 
 	printf("Parallel mksquashfs: Using %d processor%s\n", processors,
 			processors == 1 ? "" : "s");
@@ -4141,9 +6551,179 @@ void initialise_threads(int readb_mbytes, int writeb_mbytes,
 }
 
 
+/*
+ * Called by the main thread between files, so write_file_blocks_dup()
+ * sees writer_buffer_size unchanged while it holds blocks back
+ */
+void autosize_buffers()
+{
+	struct timeval tv;
+	long long now;
+	int i, waits[3], need = -1, donor = -1, idle = 0;
+
+	if(mem_mbytes == 0)
+		return;
+
+	gettimeofday(&tv, NULL);
+	now = tv.tv_sec * 1000000LL + tv.tv_usec;
+	if(now - autosize_last < AUTOSIZE_USECS)
+		return;
+	autosize_last = now;
+
+	/* the counts are only sampled, a race just skews one interval */
+	for(i = 0; i < 3; i++) {
+		waits[i] = autosize[i].cache->waits - autosize[i].waits;
+		autosize[i].waits += waits[i];
+		if(waits[i] && (need == -1 || waits[i] > waits[need]))
+			need = i;
+	}
+
+	if(need == -1)
+		return;
+
+	for(i = 0; i < 3; i++) {
+		struct cache *cache = autosize[i].cache;
+		int spare = cache->max_buffers - cache->in_use;
+
+		if(waits[i] == 0 && spare >= autosize_step &&
+				cache->max_buffers - autosize_step >=
+				autosize[i].floor && spare > idle) {
+			donor = i;
+			idle = spare;
+		}
+	}
+
+	if(donor == -1)
+		return;
+
+	cache_resize(autosize[donor].cache, autosize[donor].cache->max_buffers
+		- autosize_step);
+	cache_resize(autosize[need].cache, autosize[need].cache->max_buffers +
+		autosize_step);
+	writer_buffer_size = writer_buffer->max_buffers;
+
+	TRACE("autosize_buffers: %d buffers from %s to %s cache\n",
+		autosize_step, autosize[donor].name, autosize[need].name);
+}
+
+
+struct sample_file {
+	char *pathname;
+	long long blocks;
+};
+
+struct sample_file *sample_file = NULL;
+int sample_files = 0;
+long long sample_blocks = 0;
+
+
+/* collect the regular files under pathname for tune_compressor() */
+void sample_scan(char *pathname)
+{
+	struct stat buf;
+	struct dirent *d;
+	DIR *dir;
+
+	if(lstat(pathname, &buf) == -1)
+		return;
+
+	if(S_ISREG(buf.st_mode) && buf.st_size) {
+		if((sample_files & 1023) == 0) {
+			sample_file = realloc(sample_file, (sample_files +
+				1024) * sizeof(struct sample_file));
+			if(sample_file == NULL)
+				BAD_ERROR("Out of memory in sample_scan\n");
+		}
+		sample_file[sample_files].pathname = strdup(pathname);
+		if(sample_file[sample_files].pathname == NULL)
+			BAD_ERROR("Out of memory in sample_scan\n");
+		sample_file[sample_files].blocks = (buf.st_size + block_size -
+			1) / block_size;
+		sample_blocks += sample_file[sample_files++].blocks;
+		return;
+	}
+
+	if(!S_ISDIR(buf.st_mode) || (dir = opendir(pathname)) == NULL)
+		return;
+
+	while((d = readdir(dir)) != NULL) {
+		char *subpath;
+
+		if(strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+			continue;
+
+		subpath = malloc(strlen(pathname) + strlen(d->d_name) + 2);
+		if(subpath == NULL)
+			BAD_ERROR("Out of memory in sample_scan\n");
+		sprintf(subpath, "%s/%s", pathname, d->d_name);
+		sample_scan(subpath);
+		free(subpath);
+	}
+
+	closedir(dir);
+}
+
+
+/*
+ * Let the compressor tune its options on blocks data blocks, spread
+ * evenly over the regular files of the sources, before anything is
+ * compressed
+ */
+void tune_compressor(int blocks)
+{
+	char *samples;
+	int i, *sizes, count = 0, file = 0;
+	long long start = 0;
+
+	for(i = 0; i < source; i++)
+		sample_scan(source_path[i]);
+
+	if(blocks > sample_blocks)
+		blocks = sample_blocks;
+
+	samples = malloc((long long) blocks * block_size);
+	sizes = malloc(blocks * sizeof(int));
+	if(samples == NULL || sizes == NULL)
+		BAD_ERROR("Out of memory in tune_compressor\n");
+
+	for(i = 0; i < blocks; i++) {
+		long long block = (2 * i + 1) * sample_blocks / (2 * blocks);
+		int fd, bytes;
+
+		while(start + sample_file[file].blocks <= block)
+			start += sample_file[file++].blocks;
+
+		fd = open(sample_file[file].pathname, O_RDONLY);
+		if(fd == -1)
+			continue;
+		if(lseek(fd, (block - start) * block_size, SEEK_SET) == -1)
+			bytes = -1;
+		else
+			bytes = read_bytes(fd, samples + (long long) count *
+				block_size, block_size);
+		close(fd);
+
+		if(bytes > 0)
+			sizes[count++] = bytes;
+	}
+
+	if(compressor_tune(comp, samples, sizes, count, block_size,
+			processors == -1 ? available_processors() :
+			processors))
+		EXIT_MKSQUASHFS();
+
+	for(i = 0; i < sample_files; i++)
+		free(sample_file[i].pathname);
+	free(sample_file);
+	free(samples);
+	free(sizes);
+}
+
+
 long long write_inode_lookup_table()
 {
 	int i, inode_number, lookup_bytes = SQUASHFS_LOOKUP_BYTES(inode_count);
+	struct inode_info *inode;
 	void *it;
 
 	if(inode_count == sinode_count)
@@ -4154,10 +6734,8 @@ long long write_inode_lookup_table()
 		BAD_ERROR("Out of memory in write_inode_table\n");
 	inode_lookup_table = it;
 
-	for(i = 0; i < INODE_HASH_SIZE; i ++) {
-		struct inode_info *inode = inode_info[i];
-
-		for(inode = inode_info[i]; inode; inode = inode->next) {
+	for(i = 0; i < inode_hash_size; i ++) {
+		for(inode = inode_hash[i].inode; inode; inode = inode->next) {
 
 			inode_number = inode->type == SQUASHFS_DIR_TYPE ?
 				inode->inode_number : inode->inode_number +
@@ -4169,6 +6747,19 @@ long long write_inode_lookup_table()
 		}
 	}
 
+	for(inode = stream_inodes; inode; inode = inode->next) {
+		/* replaced by a later entry in the stream */
+		if(inode->nlink == 0)
+			continue;
+
+		inode_number = inode->type == SQUASHFS_DIR_TYPE ?
+			inode->inode_number : inode->inode_number +
+			dir_inode_no;
+
+		SQUASHFS_SWAP_LONG_LONGS(&inode->inode,
+			&inode_lookup_table[inode_number - 1], 1);
+	}
+
 skip_inode_hash_table:
 	return generic_write_table(lookup_bytes, inode_lookup_table, 0, NULL,
 		noI);
@@ -4193,6 +6784,8 @@ void free_path(struct pathname *paths)
 {
 	int i;
 
+	path_matcher_free(paths->matcher);
+
 	for(i = 0; i < paths->names; i++) {
 		if(paths->name[i].paths)
 			free_path(paths->name[i].paths);
@@ -4221,6 +6814,7 @@ struct pathname *add_path(struct pathname *paths, char *target, char *alltarget)
 
 		paths->names = 0;
 		paths->name = NULL;
+		paths->matcher = NULL;
 	}
 
 	for(i = 0; i < paths->names; i++)
@@ -4229,6 +6823,8 @@ struct pathname *add_path(struct pathname *paths, char *target, char *alltarget)
 
 	if(i == paths->names) {
 		/* allocate new name entry */
+		path_matcher_free(paths->matcher);
+		paths->matcher = NULL;
 		paths->names ++;
 		paths->name = realloc(paths->name, (i + 1) *
 			sizeof(struct path_entry));
@@ -4376,27 +6972,33 @@ int excluded(struct pathnames *paths, char *name, struct pathnames **new)
 
 	for(n = 0; n < paths->count; n++) {
 		struct pathname *path = paths->path[n];
+		int match[path->names], m, matches = 0;
 
-		for(i = 0; i < path->names; i++) {
-			int match = use_regex ?
-				regexec(path->name[i].preg, name, (size_t) 0,
-					NULL, 0) == 0 :
-				fnmatch(path->name[i].name, name,
-					FNM_PATHNAME|FNM_PERIOD|FNM_EXTMATCH) ==
-					 0;
+		if(use_regex) {
+			for(i = 0; i < path->names; i++)
+				if(regexec(path->name[i].preg, name, (size_t) 0,
+						NULL, 0) == 0)
+					match[matches ++] = i;
+		} else {
+			if(path->matcher == NULL && (path->matcher =
+					path_matcher_init(path)) == NULL)
+				BAD_ERROR("Out of memory in excluded\n");
+			matches = path_match(path->matcher, name, match);
+		}
 
-			if(match && path->name[i].paths == NULL) {
+		for(m = 0; m < matches; m++) {
+			i = match[m];
+			if(path->name[i].paths == NULL) {
 				/* match on a leaf component, any subdirectories
 				 * in the filesystem should be excluded */
 				res = TRUE;
 				goto empty_set;
 			}
 
-			if(match)
-				/* match on a non-leaf component, add any
-				 * subdirectories to the new set of
-				 * subdirectories to scan for this name */
-				*new = add_subdir(*new, path->name[i].paths);
+			/* match on a non-leaf component, add any
+			 * subdirectories to the new set of
+			 * subdirectories to scan for this name */
+			*new = add_subdir(*new, path->name[i].paths);
 		}
 	}
 
@@ -4421,6 +7023,39 @@ empty_set:
 #define RECOVER_ID "Squashfs recovery file v1.0\n"
 #define RECOVER_ID_SIZE 28
 
+/*
+ * Copy the existing metadata into the recovery file inside the kernel,
+ * which reflinks it on filesystems that share extents.  Returns FALSE,
+ * having copied nothing, if copy_file_range() can't be used here
+ */
+int copy_recovery_data(int recoverfd, long long start, int bytes)
+{
+#ifdef __NR_copy_file_range
+	loff_t off = start;
+
+	while(bytes) {
+		long res = syscall(__NR_copy_file_range, fd, &off, recoverfd,
+			NULL, (size_t) bytes, 0);
+
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res <= 0) {
+			if(off == start)
+				return FALSE;
+			BAD_ERROR("Failed to write recovery file, because %s\n",
+				res ? strerror(errno) : "the filesystem is "
+				"truncated");
+		}
+		bytes -= res;
+	}
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+
 void write_recovery_data(struct squashfs_super_block *sBlk)
 {
 	int res, recoverfd, bytes = sBlk->bytes_used - sBlk->inode_table_start;
@@ -4434,15 +7069,6 @@ void write_recovery_data(struct squashfs_super_block *sBlk)
 		return;
 	}
 
-	metadata = malloc(bytes);
-	if(metadata == NULL)
-		BAD_ERROR("Failed to alloc metadata buffer in "
-			"write_recovery_data\n");
-
-	res = read_fs_bytes(fd, sBlk->inode_table_start, bytes, metadata);
-	if(res == 0)
-		EXIT_MKSQUASHFS();
-
 	sprintf(recovery_file, "squashfs_recovery_%s_%d",
 		getbase(destination_file), pid);
 	recoverfd = open(recovery_file, O_CREAT | O_TRUNC | O_RDWR, S_IRWXU);
@@ -4458,12 +7084,25 @@ void write_recovery_data(struct squashfs_super_block *sBlk)
 		BAD_ERROR("Failed to write recovery file, because %s\n",
 			strerror(errno));
 
-	if(write_bytes(recoverfd, metadata, bytes) == -1)
-		BAD_ERROR("Failed to write recovery file, because %s\n",
-			strerror(errno));
+	if(copy_recovery_data(recoverfd, sBlk->inode_table_start, bytes) ==
+			FALSE) {
+		metadata = malloc(bytes);
+		if(metadata == NULL)
+			BAD_ERROR("Failed to alloc metadata buffer in "
+				"write_recovery_data\n");
+
+		res = read_fs_bytes(fd, sBlk->inode_table_start, bytes,
+			metadata);
+		if(res == 0)
+			EXIT_MKSQUASHFS();
+
+		if(write_bytes(recoverfd, metadata, bytes) == -1)
+			BAD_ERROR("Failed to write recovery file, because %s\n",
+				strerror(errno));
+		free(metadata);
+	}
 
 	close(recoverfd);
-	free(metadata);
 	
 	printf("Recovery file \"%s\" written\n", recovery_file);
 	printf("If Mksquashfs aborts abnormally (i.e. power failure), run\n");
@@ -4570,23 +7209,26 @@ void read_recovery_data(char *recovery_file, char *destination_file)
 	printf("GNU General Public License for more details.\n");
 int main(int argc, char *argv[])
 {
-	struct stat buf, source_buf;
+	struct stat buf, source_buf, base_buf;
 	int res, i;
 	struct squashfs_super_block sBlk;
 	char *b, *root_name = NULL;
-	int nopad = FALSE, keep_as_directory = FALSE;
+	int keep_as_directory = FALSE;
 	squashfs_inode inode;
 	int readb_mbytes = READER_BUFFER_DEFAULT,
 		writeb_mbytes = WRITER_BUFFER_DEFAULT,
 		fragmentb_mbytes = FRAGMENT_BUFFER_DEFAULT;
+	int reader_buffers, writer_buffers, fragment_buffers;
 
 	pthread_mutex_init(&progress_mutex, NULL);
+	fmk_stats_init("mksquashfs");
 	block_log = slog(block_size);
 	if(argc > 1 && strcmp(argv[1], "-version") == 0) {
 		VERSION();
 		exit(0);
 	}
-        for(i = 1; i < argc && argv[i][0] != '-'; i++);
+        for(i = 1; i < argc && (argv[i][0] != '-' || argv[i][1] == '\0');
+			i++);
 	if(i < 3)
 		goto printOptions;
 	source_path = argv + 1;
@@ -4642,6 +7284,13 @@ int main(int argc, char *argv[])
 			}
 			if(read_pseudo_file(&pseudo, argv[i]) == FALSE)
 				exit(1);
+		} else if(strcmp(argv[i], "-pg") == 0) {
+			if(++i == argc) {
+				ERROR("%s: -pg missing generator command\n",
+					argv[0]);
+				exit(1);
+			}
+			set_pseudo_generator(argv[i]);
 		} else if(strcmp(argv[i], "-p") == 0) {
 			if(++i == argc) {
 				ERROR("%s: -p missing pseudo file definition\n",
@@ -4720,6 +7369,18 @@ int main(int argc, char *argv[])
 					"megabyte or larger\n", argv[0]);
 				exit(1);
 			}
+		} else if(strcmp(argv[i], "-mem") == 0) {
+			if((++i == argc) || (mem_mbytes =
+					strtol(argv[i], &b, 10), *b != '\0')) {
+				ERROR("%s: -mem missing or invalid size\n",
+					argv[0]);
+				exit(1);
+			}
+			if(mem_mbytes < 3) {
+				ERROR("%s: -mem should be 3 megabytes or "
+					"larger\n", argv[0]);
+				exit(1);
+			}
 		} else if(strcmp(argv[i], "-b") == 0) {
 			if(++i == argc) {
 				ERROR("%s: -b missing block size\n", argv[0]);
@@ -4748,9 +7409,56 @@ int main(int argc, char *argv[])
 		} else if(strcmp(argv[i], "-no-duplicates") == 0)
 			duplicate_checking = FALSE;
 
+		else if(strcmp(argv[i], "-block-dedup") == 0)
+			block_dedup = TRUE;
+
+		else if(strcmp(argv[i], "-spill") == 0) {
+			if(++i == argc) {
+				ERROR("%s: -spill missing directory\n",
+					argv[0]);
+				exit(1);
+			}
+			if(!arena_spill(argv[i])) {
+				ERROR("%s: -spill can't create files in %s "
+					"because %s\n", argv[0], argv[i],
+					strerror(errno));
+				exit(1);
+			}
+			spill = TRUE;
+		}
+
+		else if(strcmp(argv[i], "-base") == 0) {
+			if(++i == argc) {
+				ERROR("%s: -base missing filename\n", argv[0]);
+				exit(1);
+			}
+			base_image = argv[i];
+		}
+
+		else if(strcmp(argv[i], "-report") == 0 ||
+				strcmp(argv[i], "-report-json") == 0) {
+			if(++i == argc) {
+				ERROR("%s: %s missing filename\n", argv[0],
+					argv[i - 1]);
+				exit(1);
+			}
+			report = strcmp(argv[i - 1], "-report") == 0 ?
+				REPORT_TEXT : REPORT_JSON;
+			report_filename = argv[i];
+		}
+
 		else if(strcmp(argv[i], "-no-fragments") == 0)
 			no_fragments = TRUE;
 
+		else if(strcmp(argv[i], "-pack-fragments") == 0)
+			pack_fragments = TRUE;
+
+		else if(strcmp(argv[i], "-store-incompressible") == 0)
+			store_incompressible = TRUE;
+
+		else if(strcmp(argv[i], "-reproducible") == 0)
+			reproducible = TRUE;
+
 		 else if(strcmp(argv[i], "-always-use-fragments") == 0)
 			always_use_fragments = TRUE;
 
@@ -4759,6 +7467,12 @@ int main(int argc, char *argv[])
 				ERROR("%s: -sort missing filename\n", argv[0]);
 				exit(1);
 			}
+		} else if(strcmp(argv[i], "-sort-trace") == 0) {
+			if(++i == argc) {
+				ERROR("%s: -sort-trace missing filename\n",
+					argv[0]);
+				exit(1);
+			}
 		} else if(strcmp(argv[i], "-all-root") == 0 ||
 				strcmp(argv[i], "-root-owned") == 0)
 			global_uid = global_gid = 0;
@@ -4834,6 +7548,9 @@ int main(int argc, char *argv[])
 		else if(strcmp(argv[i], "-nopad") == 0)
 			nopad = TRUE;
 
+		else if(strcmp(argv[i], "-estimate") == 0)
+			estimate = TRUE;
+
 		else if(strcmp(argv[i], "-info") == 0) {
 			silent = FALSE;
 			progress = FALSE;
@@ -4862,6 +7579,8 @@ int main(int argc, char *argv[])
 printOptions:
 			ERROR("SYNTAX:%s source1 source2 ...  dest [options] "
 				"[-e list of exclude\ndirs/files]\n", argv[0]);
+			ERROR("A source of - reads a tar or cpio archive from "
+				"standard input\n");
 			ERROR("\nFilesystem build options:\n");
 			ERROR("-comp <comp>\t\tselect <comp> compression\n");
 			ERROR("\t\t\tCompressors available:\n");
@@ -4879,18 +7598,38 @@ printOptions:
 			ERROR("-noI\t\t\tdo not compress inode table\n");
 			ERROR("-noD\t\t\tdo not compress data blocks\n");
 			ERROR("-noF\t\t\tdo not compress fragment blocks\n");
+			ERROR("-store-incompressible\tstore data blocks which "
+				"look already compressed\n\t\t\t(JPEG, gzip, "
+				"...) without trying to compress them\n");
 			ERROR("-noX\t\t\tdo not compress extended "
 				"attributes\n");
 			ERROR("-no-fragments\t\tdo not use fragments\n");
+			ERROR("-pack-fragments\t\tpack tails into fragments "
+				"grouped by file extension\n\t\t\tand -sort "
+				"priority, rather than in scan order\n");
 			ERROR("-always-use-fragments\tuse fragment blocks for "
 				"files larger than block size\n");
+			ERROR("-reproducible\t\tmake the same filesystem from "
+				"the same input every\n\t\t\ttime, timestamps "
+				"are clamped to SOURCE_DATE_EPOCH\n\t\t\tif it's "
+				"set\n");
 			ERROR("-no-duplicates\t\tdo not perform duplicate "
 				"checking\n");
+			ERROR("-block-dedup\t\tshare data blocks between files "
+				"whose blocks\n\t\t\tmatch, not just whole "
+				"duplicate files (implies\n\t\t\t"
+				"-always-use-fragments)\n");
+			ERROR("-base <image>\t\tcopy the compressed data of "
+				"files whose size and\n\t\t\tmtime are "
+				"unchanged from <image>\n");
 			ERROR("-all-root\t\tmake all files owned by root\n");
 			ERROR("-force-uid uid\t\tset all file uids to uid\n");
 			ERROR("-force-gid gid\t\tset all file gids to gid\n");
 			ERROR("-nopad\t\t\tdo not pad filesystem to a multiple "
 				"of 4K\n");
+			ERROR("-estimate\t\tprint the size the filesystem "
+				"would be, from a sample\n\t\t\tof its blocks, "
+				"without writing it\n");
 			ERROR("-keep-as-directory\tif one source directory is "
 				"specified, create a root\n");
 			ERROR("\t\t\tdirectory containing that directory, "
@@ -4901,11 +7640,20 @@ printOptions:
 				"definition\n");
 			ERROR("-pf <pseudo-file>\tAdd list of pseudo file "
 				"definitions\n");
+			ERROR("-pg <command>\t\tRun <command> once to make the "
+				"contents of all\n");
+			ERROR("\t\t\tthe 'g' pseudo files given after it\n");
 			ERROR("-sort <sort_file>\tsort files according to "
 				"priorities in <sort_file>.  One\n");
 			ERROR("\t\t\tfile or dir with priority per line.  "
 				"Priority -32768 to\n");
 			ERROR("\t\t\t32767, default priority 0\n");
+			ERROR("-sort-trace <trace>\tlay files out in the order "
+				"<trace> first reads them.\n");
+			ERROR("\t\t\t<trace> is a list of files, strace or "
+				"fatrace output,\n");
+			ERROR("\t\t\tor blkparse output of reads of the -base "
+				"image\n");
 			ERROR("-ef <exclude_file>\tlist of exclude dirs/files."
 				"  One per line\n");
 			ERROR("-wildcards\t\tAllow extended shell wildcards "
@@ -4931,6 +7679,16 @@ printOptions:
 			ERROR("-no-recovery\t\tdon't generate a recovery "
 				"file\n");
 			ERROR("-info\t\t\tprint files written to filesystem\n");
+			ERROR("-report <file>\t\twrite a layout report to "
+				"<file> (- for stdout): the\n");
+			ERROR("\t\t\tuncompressed and stored size, block and "
+				"fragment\n");
+			ERROR("\t\t\tplacement and duplicates of each file "
+				"and directory,\n");
+			ERROR("\t\t\tand the time taken by the compressor "
+				"calls\n");
+			ERROR("-report-json <file>\tas -report, but report in "
+				"JSON\n");
 			ERROR("-no-progress\t\tdon't display the progress "
 				"bar\n");
 			ERROR("-processors <number>\tUse <number> processors."
@@ -4945,6 +7703,15 @@ printOptions:
 			ERROR("-fragment-queue <size>\tSet fragment queue to "
 				"<size> Mbytes.  Default %d Mbytes\n",
 				FRAGMENT_BUFFER_DEFAULT);
+			ERROR("-mem <size>\t\tShare <size> Mbytes between the "
+				"read, write and fragment\n\t\t\tqueues, "
+				"moving memory to whichever is full\n\t\t\t"
+				"during the run.  The queue sizes above set the "
+				"\n\t\t\tstarting proportions\n");
+			ERROR("-spill <dir>\t\tKeep the source tree, duplicate "
+				"file records and\n\t\t\tinode and directory "
+				"tables in files in <dir>,\n\t\t\tfor trees "
+				"too big for memory\n");
 			ERROR("\nMiscellaneous options:\n");
 			ERROR("-root-owned\t\talternative name for -all-root"
 				"\n");
@@ -4971,7 +7738,24 @@ printOptions:
 	if(res)
 		EXIT_MKSQUASHFS();
 
-	for(i = 0; i < source; i++)
+	/* a single source of "-" is a tar or cpio stream on stdin */
+	if(source == 1 && strcmp(source_path[0], "-") == 0) {
+		if(stream_open(STDIN_FILENO) == FALSE) {
+			ERROR("%s: standard input isn't a tar or cpio stream\n",
+				argv[0]);
+			exit(1);
+		}
+		stream_input = TRUE;
+	}
+
+	/* the stream's files are only seen as they're written */
+	if(estimate && stream_input) {
+		ERROR("%s: -estimate can't be used with an input stream\n",
+			argv[0]);
+		exit(1);
+	}
+
+	for(i = 0; i < source && !stream_input; i++)
 		if(lstat(source_path[i], &source_buf) == -1) {
 			fprintf(stderr, "Cannot stat source directory \"%s\" "
 				"because %s\n", source_path[i],
@@ -4979,8 +7763,34 @@ printOptions:
 			EXIT_MKSQUASHFS();
 		}
 
-	destination_file = argv[source + 1];
-	if(stat(argv[source + 1], &buf) == -1) {
+	if(reproducible && getenv("SOURCE_DATE_EPOCH")) {
+		char *epoch = getenv("SOURCE_DATE_EPOCH");
+
+		source_date_epoch = strtoll(epoch, &b, 10);
+		if(*epoch == '\0' || *b != '\0' || source_date_epoch < 0 ||
+				source_date_epoch > 0xffffffffLL) {
+			ERROR("%s: invalid SOURCE_DATE_EPOCH \"%s\"\n",
+				argv[0], epoch);
+			exit(1);
+		}
+		clamp_time = TRUE;
+	}
+
+	/* the destination is neither read nor written by -estimate */
+	if(!estimate)
+		destination_file = argv[source + 1];
+	if(base_image && stat(base_image, &base_buf) == 0 &&
+			stat(argv[source + 1], &buf) == 0 &&
+			base_buf.st_dev == buf.st_dev &&
+			base_buf.st_ino == buf.st_ino) {
+		ERROR("%s: -base image can't also be the destination\n",
+			argv[0]);
+		exit(1);
+	}
+
+	if(estimate)
+		delete = TRUE;
+	else if(stat(argv[source + 1], &buf) == -1) {
 		if(errno == ENOENT) { /* Does not exist */
 			fd = open(argv[source + 1], O_CREAT | O_TRUNC | O_RDWR,
 				S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
@@ -5030,6 +7840,11 @@ printOptions:
 		if(strcmp(argv[i], "-ef") == 0) {
 			FILE *fd;
 			char filename[16385];
+			if(stream_input) {
+				ERROR("%s: excludes can't be used with an "
+					"input stream\n", argv[0]);
+				EXIT_MKSQUASHFS();
+			}
 			if((fd = fopen(argv[++i], "r")) == NULL) {
 				perror("Could not open exclude file...");
 				EXIT_MKSQUASHFS();
@@ -5044,7 +7859,12 @@ printOptions:
 			break;
 		else if(strcmp(argv[i], "-root-becomes") == 0 ||
 				strcmp(argv[i], "-sort") == 0 ||
+				strcmp(argv[i], "-sort-trace") == 0 ||
 				strcmp(argv[i], "-pf") == 0 ||
+				strcmp(argv[i], "-pg") == 0 ||
+				strcmp(argv[i], "-base") == 0 ||
+				strcmp(argv[i], "-report") == 0 ||
+				strcmp(argv[i], "-report-json") == 0 ||
 				strcmp(argv[i], "-comp") == 0)
 			i++;
 
@@ -5053,6 +7873,11 @@ printOptions:
 			ERROR("%s: -e missing arguments\n", argv[0]);
 			EXIT_MKSQUASHFS();
 		}
+		if(stream_input) {
+			ERROR("%s: excludes can't be used with an input "
+				"stream\n", argv[0]);
+			EXIT_MKSQUASHFS();
+		}
 		while(i < argc)
 			if(old_exclude)
 				old_add_exclude(argv[i++]);
@@ -5073,6 +7898,11 @@ printOptions:
 		else if(strcmp(argv[i], "-root-becomes") == 0 ||
 				strcmp(argv[i], "-ef") == 0 ||
 				strcmp(argv[i], "-pf") == 0 ||
+				strcmp(argv[i], "-pg") == 0 ||
+				strcmp(argv[i], "-base") == 0 ||
+				strcmp(argv[i], "-sort-trace") == 0 ||
+				strcmp(argv[i], "-report") == 0 ||
+				strcmp(argv[i], "-report-json") == 0 ||
 				strcmp(argv[i], "-comp") == 0)
 			i++;
 
@@ -5103,13 +7933,97 @@ printOptions:
 		comp_opts = SQUASHFS_COMP_OPTS(sBlk.flags);
 	}
 
-	initialise_threads(readb_mbytes, writeb_mbytes, fragmentb_mbytes);
+	if(block_dedup && !duplicate_checking) {
+		ERROR("%s: -block-dedup needs duplicate checking, which is "
+			"disabled\n", argv[0]);
+		EXIT_MKSQUASHFS();
+	}
+
+	/*
+	 * with tails in fragments files which only differ in their last block
+	 * can still share all of their blocks
+	 */
+	if(block_dedup)
+		always_use_fragments = TRUE;
+
+	if(base_image) {
+		if(!delete) {
+			ERROR("%s: -base can't be used when appending, use "
+				"-noappend\n", argv[0]);
+			EXIT_MKSQUASHFS();
+		}
+		if(read_base(base_image, comp, block_size) == FALSE)
+			EXIT_MKSQUASHFS();
+	}
+
+	/*
+	 * process the sort trace files - after the -base image is read, as
+	 * block traces are mapped to files through it
+	 */
+	for(i = source + 2; i < argc; i++)
+		if(strcmp(argv[i], "-sort-trace") == 0) {
+			if(read_trace_file(argv[++i], source, source_path) ==
+					FALSE)
+				BAD_ERROR("Failed to read sort trace file\n");
+			sorted ++;
+		} else if(strcmp(argv[i], "-e") == 0)
+			break;
+		else if(strcmp(argv[i], "-root-becomes") == 0 ||
+				strcmp(argv[i], "-ef") == 0 ||
+				strcmp(argv[i], "-pf") == 0 ||
+				strcmp(argv[i], "-pg") == 0 ||
+				strcmp(argv[i], "-base") == 0 ||
+				strcmp(argv[i], "-sort") == 0 ||
+				strcmp(argv[i], "-report") == 0 ||
+				strcmp(argv[i], "-report-json") == 0 ||
+				strcmp(argv[i], "-comp") == 0)
+			i++;
+
+	if(stream_input) {
+		if(!delete) {
+			ERROR("%s: an input stream can't be appended, use "
+				"-noappend\n", argv[0]);
+			EXIT_MKSQUASHFS();
+		}
+		/* the files are written in stream order as they arrive */
+		if(sorted) {
+			ERROR("%s: -sort and -sort-trace can't be used with an "
+				"input stream\n", argv[0]);
+			EXIT_MKSQUASHFS();
+		}
+	}
+
+#ifdef __CYGWIN__
+	processors = atoi(getenv("NUMBER_OF_PROCESSORS"));
+#else
+	if(processors == -1)
+		processors = available_processors();
+#endif /* __CYGWIN__ */
+
+	if(mem_mbytes)
+		mem_split(readb_mbytes, writeb_mbytes, fragmentb_mbytes,
+			&reader_buffers, &writer_buffers, &fragment_buffers);
+	else {
+		reader_buffers = readb_mbytes << (20 - block_log);
+		writer_buffers = writeb_mbytes << (20 - block_log);
+		fragment_buffers = fragmentb_mbytes << (20 - block_log);
+	}
+
+	/* the options are stored before the first block is compressed */
+	if(delete && !stream_input) {
+		int blocks = compressor_tune_blocks(comp, block_size);
+
+		if(blocks)
+			tune_compressor(blocks);
+	}
+
+	initialise_threads(reader_buffers, writer_buffers, fragment_buffers);
 
 	res = compressor_init(comp, &stream, SQUASHFS_METADATA_SIZE, 0);
 	if(res)
 		BAD_ERROR("compressor_init failed\n");
 
-	if(delete) {
+	if(delete && !estimate) {
 		int size;
 		void *comp_data = compressor_dump_options(comp, block_size,
 			&size);
@@ -5135,7 +8049,7 @@ printOptions:
 			comp_opts = TRUE;
 		} else			
 			bytes = sizeof(struct squashfs_super_block);
-	} else {
+	} else if(!delete) {
 		unsigned int last_directory_block, inode_dir_offset,
 			inode_dir_file_size, root_inode_size,
 			inode_dir_start_block, uncompressed_data,
@@ -5293,7 +8207,9 @@ printOptions:
 			paths = add_subdir(paths, stickypath);
 	}
 
-	if(delete && !keep_as_directory && source == 1 &&
+	if(stream_input)
+		dir_scan_stream(&inode);
+	else if(delete && !keep_as_directory && source == 1 &&
 			S_ISDIR(source_buf.st_mode))
 		dir_scan(&inode, source_path[0], scan1_readdir);
 	else if(!keep_as_directory && source == 1 &&
@@ -5311,7 +8227,7 @@ printOptions:
 	sBlk.flags = SQUASHFS_MKFLAGS(noI, noD, noF, noX, no_fragments,
 		always_use_fragments, duplicate_checking, exportable,
 		no_xattrs, comp_opts);
-	sBlk.mkfs_time = time(NULL);
+	sBlk.mkfs_time = build_time();
 
 restore_filesystem:
 	if(progress && estimated_uncompressed) {
@@ -5319,9 +8235,11 @@ restore_filesystem:
 		progress_bar(cur_uncompressed, estimated_uncompressed, columns);
 	}
 
-	write_fragment();
+	write_fragments();
 	sBlk.fragments = fragments;
 	if(!restoring) {
+		if(reproducible)
+			commit_fragments();
 		unlock_fragments();
 		pthread_mutex_lock(&fragment_mutex);
 		while(fragments_outstanding) {
@@ -5329,11 +8247,12 @@ restore_filesystem:
 			sched_yield();
 			pthread_mutex_lock(&fragment_mutex);
 		}
-		queue_put(to_writer, NULL);
-		if(queue_get(from_writer) != 0)
-			EXIT_MKSQUASHFS();
 	}
 
+	/*
+	 * the tables are written while the writer thread is still writing
+	 * out the last data blocks, it's waited for before the superblock
+	 */
 	sBlk.no_ids = id_count;
 	sBlk.inode_table_start = write_inodes();
 	sBlk.directory_table_start = write_directories();
@@ -5355,6 +8274,12 @@ restore_filesystem:
 
 	sBlk.compression = comp->id;
 
+	if(!restoring) {
+		queue_put(to_writer, NULL);
+		if(queue_get(from_writer) != 0)
+			EXIT_MKSQUASHFS();
+	}
+
 	SQUASHFS_INSWAP_SUPER_BLOCK(&sBlk); 
 	write_destination(fd, SQUASHFS_START, sizeof(sBlk), &sBlk);
 
@@ -5370,6 +8295,10 @@ restore_filesystem:
 	if(recovery_file[0] != '\0')
 		unlink(recovery_file);
 
+	if(report && !report_write(report_filename, comp->name, block_size,
+			fragment_table, fragments))
+		EXIT_MKSQUASHFS();
+
 	total_bytes += total_inode_bytes + total_directory_bytes +
 		sizeof(struct squashfs_super_block) + total_xattr_bytes;
 
@@ -5409,6 +8338,20 @@ restore_filesystem:
 			dup_files);
 	else
 		printf("No duplicate files removed\n");
+	if(block_dedup)
+		printf("Number of duplicate blocks found %d\n", dup_blocks);
+	if(store_incompressible)
+		printf("Number of incompressible blocks stored %d\n",
+			incompressible_blocks);
+	if(mem_mbytes)
+		printf("Queue sizes at end (Mbytes) read %d, write %d, "
+			"fragment %d\n", reader_buffer->max_buffers >>
+			(20 - block_log), writer_buffer->max_buffers >>
+			(20 - block_log), fragment_buffer->max_buffers >>
+			(20 - block_log));
+	if(base_image)
+		printf("Number of files copied from base image %d\n",
+			base_files);
 	printf("Number of inodes %d\n", inode_count);
 	printf("Number of files %d\n", file_count);
 	if(!no_fragments)
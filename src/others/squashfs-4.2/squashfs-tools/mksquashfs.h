@@ -60,6 +60,8 @@ struct dir_ent {
 	struct dir_info		*our_dir;
 };
 
+struct deferred_file;
+
 struct inode_info {
 	struct stat		buf;
 	struct inode_info	*next;
@@ -71,6 +73,17 @@ struct inode_info {
 	char			read;
 	char			root_entry;
 	char			pseudo_file;
+	/* set if a pseudo definition gave the owner, which -all-root keeps */
+	char			pseudo_owner;
+	/* -stream input, the symlink's target, and file data written early */
+	char			*symlink;
+	struct deferred_file	*deferred;
+	/* set if the scan threads read the xattrs, interned in xattrs */
+	char			xattr_scanned;
+	void			*xattrs;
+	/* set by the reader thread once the whole file has been hashed */
+	char			content_hashed;
+	unsigned long long	content_hash[2];
 };
 #endif
 
@@ -81,6 +94,20 @@ struct inode_info {
 #define IS_PSEUDO_PROCESS(a)	((a)->pseudo_file & PSEUDO_FILE_PROCESS)
 #define IS_PSEUDO_OTHER(a)	((a)->pseudo_file & PSEUDO_FILE_OTHER)
 
+/*
+ * Hash of a (st_dev, st_ino) pair for the open addressed inode and sort
+ * tables, which are a power of two in size and index it with a mask.
+ * Inode numbers are mostly sequential, so they're mixed rather than used
+ * as they are
+ */
+static inline unsigned int dev_ino_hash(dev_t dev, ino_t ino)
+{
+	unsigned long long key = ((unsigned long long) dev << 32) ^ ino;
+
+	key *= 0x9e3779b97f4a7c15ULL;
+	return key >> 32;
+}
+
 /* offset of data in compressed metadata blocks (allowing room for
  * compressed size */
 #define BLOCK_OFFSET 2
@@ -0,0 +1,158 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * pathmatch.c
+ *
+ * Matching a directory entry against the names at one level of an extract
+ * or exclude list.  Each name used to be tried with fnmatch() in turn,
+ * which with long lists is most of the scan.  Here the literal names
+ * (most of them, usually) are found by a binary search, and a wildcard
+ * is only tried if the name starts and ends with the literal text either
+ * side of its wildcard characters.  The names matched, and the order they
+ * are returned in, are those fnmatch() gives, so callers see no change.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+
+#ifdef __CYGWIN__
+#define FNM_EXTMATCH  (1 << 5)
+#endif
+
+#ifndef FNM_EXTMATCH
+#define FNM_EXTMATCH 0
+#endif
+
+#include "pathmatch.h"
+
+/* as literal_path() in unsquashfs, any ( may start an extended pattern */
+#define GLOB_CHARS	"*?[\\("
+/* the characters which end the literal tail of a wildcard */
+#define GLOB_TAIL_CHARS	"*?[]\\()|!+@"
+
+static int literal_cmp(const void *a, const void *b)
+{
+	return strcmp(((struct path_literal *) a)->name,
+		((struct path_literal *) b)->name);
+}
+
+
+struct path_matcher *path_matcher_init(struct pathname *paths)
+{
+	struct path_matcher *matcher = malloc(sizeof(struct path_matcher));
+	int i;
+
+	if(matcher == NULL)
+		return NULL;
+
+	matcher->literals = matcher->globs = 0;
+	matcher->literal = malloc(paths->names * sizeof(struct path_literal));
+	matcher->glob = malloc(paths->names * sizeof(struct path_glob));
+	if(matcher->literal == NULL || matcher->glob == NULL) {
+		path_matcher_free(matcher);
+		return NULL;
+	}
+
+	for(i = 0; i < paths->names; i++) {
+		char *name = paths->name[i].name, *tail;
+		struct path_glob *glob;
+
+		if(strpbrk(name, GLOB_CHARS) == NULL) {
+			matcher->literal[matcher->literals].name = name;
+			matcher->literal[matcher->literals ++].index = i;
+			continue;
+		}
+
+		glob = &matcher->glob[matcher->globs ++];
+		glob->index = i;
+		glob->pattern = name;
+		glob->prefix = name;
+		glob->prefix_len = strcspn(name, GLOB_CHARS);
+		/* +(, @( and !( don't match the characters before the ( */
+		if(glob->prefix_len && name[glob->prefix_len] == '(')
+			glob->prefix_len --;
+
+		for(tail = name + strlen(name); tail > name &&
+				strchr(GLOB_TAIL_CHARS, tail[-1]) == NULL;
+				tail --);
+		glob->suffix = tail;
+		glob->suffix_len = strlen(tail);
+	}
+
+	qsort(matcher->literal, matcher->literals, sizeof(struct path_literal),
+		literal_cmp);
+
+	return matcher;
+}
+
+
+void path_matcher_free(struct path_matcher *matcher)
+{
+	if(matcher == NULL)
+		return;
+
+	free(matcher->literal);
+	free(matcher->glob);
+	free(matcher);
+}
+
+
+/*
+ * Stores the indices of the names matching name in match, in increasing
+ * order, and returns how many there are
+ */
+int path_match(struct path_matcher *matcher, char *name, int *match)
+{
+	struct path_literal key, *literal;
+	int i, len = strlen(name), matches = 0, literal_index = -1;
+
+	key.name = name;
+	literal = bsearch(&key, matcher->literal, matcher->literals,
+		sizeof(struct path_literal), literal_cmp);
+	if(literal)
+		literal_index = literal->index;
+
+	for(i = 0; i < matcher->globs; i++) {
+		struct path_glob *glob = &matcher->glob[i];
+
+		if(len < glob->prefix_len + glob->suffix_len ||
+				strncmp(name, glob->prefix,
+				glob->prefix_len) != 0 ||
+				strcmp(name + len - glob->suffix_len,
+				glob->suffix) != 0)
+			continue;
+
+		if(fnmatch(glob->pattern, name, FNM_PATHNAME|FNM_PERIOD|
+				FNM_EXTMATCH) != 0)
+			continue;
+
+		if(literal_index != -1 && literal_index < glob->index) {
+			match[matches ++] = literal_index;
+			literal_index = -1;
+		}
+		match[matches ++] = glob->index;
+	}
+
+	if(literal_index != -1)
+		match[matches ++] = literal_index;
+
+	return matches;
+}
@@ -0,0 +1,76 @@
+#ifndef PATHMATCH_H
+#define PATHMATCH_H
+/*
+ * Extract and exclude path lists shared by mksquashfs and unsquashfs.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * pathmatch.h
+ */
+
+#include <regex.h>
+
+struct path_entry {
+	char *name;
+	regex_t *preg;
+	struct pathname *paths;
+};
+
+struct pathname {
+	int names;
+	struct path_entry *name;
+	/* made on first use, and dropped when a name is added */
+	struct path_matcher *matcher;
+};
+
+struct pathnames {
+	int count;
+	struct pathname *path[0];
+};
+#define PATHS_ALLOC_SIZE 10
+
+/* a wildcard, and the literal text any name it matches starts and ends in */
+struct path_glob {
+	int index;
+	char *pattern;
+	char *prefix;
+	int prefix_len;
+	char *suffix;
+	int suffix_len;
+};
+
+struct path_literal {
+	char *name;
+	int index;
+};
+
+/*
+ * The names of one struct pathname split into the literal names, sorted
+ * to be binary searched, and the wildcards, which fnmatch() is only
+ * called for when their literal prefix and suffix match
+ */
+struct path_matcher {
+	int literals;
+	struct path_literal *literal;
+	int globs;
+	struct path_glob *glob;
+};
+
+extern struct path_matcher *path_matcher_init(struct pathname *paths);
+extern void path_matcher_free(struct path_matcher *matcher);
+extern int path_match(struct path_matcher *matcher, char *name, int *match);
+#endif
@@ -33,6 +33,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <signal.h>
 
 #include "pseudo.h"
 
@@ -67,6 +68,22 @@
 struct pseudo_dev **pseudo_file = NULL;
 int pseudo_count = 0;
 
+/* an 'm' definition of "/", which modifies the root directory */
+struct pseudo_dev *pseudo_root = NULL;
+
+/*
+ * The -pg generator, one helper process which makes the contents of all
+ * the 'g' pseudo files, rather than a shell being run for each.  It's
+ * started by the first 'g' definition, and sent each file's request as a
+ * line on its stdin as the reader reaches the file.  It replies on its
+ * stdout with the file's size in decimal, on a line of its own, followed by
+ * that many bytes of contents, which the reader reads straight into its
+ * buffers
+ */
+static char *generator_command = NULL;
+static int generator_in = -1, generator_out = -1;
+static pid_t generator_pid = -1;
+
 static void dump_pseudo(struct pseudo *pseudo, char *string)
 {
 	int i;
@@ -145,6 +162,7 @@ struct pseudo *add_pseudo(struct pseudo *pseudo, struct pseudo_dev *pseudo_dev,
 		} else {
 			/* recurse adding child components */
 			pseudo->name[i].dev = NULL;
+			pseudo->name[i].pathname = NULL;
 			pseudo->name[i].pseudo = add_pseudo(NULL, pseudo_dev,
 				target, alltarget);
 		}
@@ -155,8 +173,11 @@ struct pseudo *add_pseudo(struct pseudo *pseudo, struct pseudo_dev *pseudo_dev,
 			 * component of a pre-existing pseudo file.
 			 */
 			if(target[0] != '\0') {
-				/* entry must exist as a 'd' type pseudo file */
-				if(pseudo->name[i].dev->type == 'd')
+				/* entry must exist as a 'd' type pseudo file,
+				 * or modify a directory of the source */
+				if(pseudo->name[i].dev->type == 'd' ||
+						pseudo->name[i].dev->type == 'm' ||
+						IS_STREAM_DIR(pseudo->name[i].dev))
 					/* recurse adding child components */
 					pseudo->name[i].pseudo =
 						add_pseudo(NULL, pseudo_dev,
@@ -165,7 +186,11 @@ struct pseudo *add_pseudo(struct pseudo *pseudo, struct pseudo_dev *pseudo_dev,
 					ERROR("%s already exists as a non "
 						"directory.  Ignoring %s!\n",
 						 targname, alltarget);
-			} else if(memcmp(pseudo_dev, pseudo->name[i].dev,
+			} else if(pseudo_dev->type == 's' &&
+					pseudo->name[i].dev->type == 's')
+				/* later entries in a stream replace earlier */
+				pseudo->name[i].dev = pseudo_dev;
+			else if(memcmp(pseudo_dev, pseudo->name[i].dev,
 					sizeof(struct pseudo_dev)) != 0)
 				ERROR("%s already exists as a different pseudo "
 					"definition.  Ignoring!\n", alltarget);
@@ -173,10 +198,15 @@ struct pseudo *add_pseudo(struct pseudo *pseudo, struct pseudo_dev *pseudo_dev,
 					"pseudo definition!\n", alltarget);
 		} else {
 			/* sub-directory exists which means this can only be a
-			 * 'd' type pseudo file */
+			 * 'd' type pseudo file, or an 'm' of a source directory */
 			if(target[0] == '\0') {
-				if(pseudo->name[i].dev == NULL &&
-						pseudo_dev->type == 'd') {
+				if((pseudo->name[i].dev == NULL &&
+						(pseudo_dev->type == 'd' ||
+						pseudo_dev->type == 'm')) ||
+						((pseudo->name[i].dev == NULL ||
+						pseudo->name[i].dev->type == 's') &&
+						IS_STREAM_DIR(pseudo_dev))) {
+					free(pseudo->name[i].pathname);
 					pseudo->name[i].pathname =
 						strdup(alltarget);
 					pseudo->name[i].dev = pseudo_dev;
@@ -215,6 +245,70 @@ struct pseudo *pseudo_subdir(char *filename, struct pseudo *pseudo)
 }
 
 
+/*
+ * Find the pseudo file at pathname, NULL if there isn't one
+ */
+struct pseudo_dev *pseudo_lookup(struct pseudo *pseudo, char *pathname)
+{
+	char targname[1024];
+	int i;
+
+	while(pseudo) {
+		pathname = get_component(pathname, targname);
+
+		for(i = 0; i < pseudo->names; i++)
+			if(strcmp(pseudo->name[i].name, targname) == 0)
+				break;
+
+		if(i == pseudo->names)
+			return NULL;
+
+		if(*pathname == '\0' || (*pathname == '/' && pathname[1] ==
+				'\0'))
+			return pseudo->name[i].dev;
+
+		pseudo = pseudo->name[i].pseudo;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Give the directories only implied by the pathnames of the pseudo files
+ * below them the definition dev.  With -stream input there are no source
+ * directories for them otherwise
+ */
+void pseudo_fill_dirs(struct pseudo *pseudo, struct pseudo_dev *dev,
+	char *parent)
+{
+	int i;
+
+	if(pseudo == NULL)
+		return;
+
+	for(i = 0; i < pseudo->names; i++) {
+		struct pseudo_entry *entry = &pseudo->name[i];
+		char *pathname = entry->pathname;
+
+		if(entry->dev == NULL) {
+			pathname = malloc(strlen(parent) + strlen(entry->name) +
+				2);
+			if(pathname == NULL)
+				BAD_ERROR("failed to allocate pseudo file\n");
+			if(parent[0])
+				sprintf(pathname, "%s/%s", parent, entry->name);
+			else
+				strcpy(pathname, entry->name);
+			entry->pathname = pathname;
+			entry->dev = dev;
+		}
+
+		pseudo_fill_dirs(entry->pseudo, dev, pathname);
+	}
+}
+
+
 struct pseudo_entry *pseudo_readdir(struct pseudo *pseudo)
 {
 	if(pseudo == NULL)
@@ -267,6 +361,7 @@ int exec_file(char *command, struct pseudo_dev *dev)
 	}
 
 	if(child == 0) {
+		signal(SIGPIPE, SIG_DFL);
 		close(STDOUT_FILENO);
 		res = dup(pipefd[1]);
 		if(res == -1) {
@@ -299,6 +394,142 @@ failed:
 }
 
 
+void set_pseudo_generator(char *command)
+{
+	generator_command = command;
+}
+
+
+static int start_generator()
+{
+	int in[2], out[2];
+
+	if(pipe(in) == -1 || pipe(out) == -1) {
+		ERROR("pipe failed\n");
+		return FALSE;
+	}
+
+	/* a generator that dies is then an EPIPE, not the end of mksquashfs */
+	signal(SIGPIPE, SIG_IGN);
+
+	generator_pid = fork();
+	if(generator_pid == -1) {
+		ERROR("fork failed\n");
+		return FALSE;
+	}
+
+	if(generator_pid == 0) {
+		signal(SIGPIPE, SIG_DFL);
+		if(dup2(in[0], STDIN_FILENO) == -1 ||
+				dup2(out[1], STDOUT_FILENO) == -1) {
+			ERROR("dup failed\n");
+			exit(EXIT_FAILURE);
+		}
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		execl("/bin/sh", "sh", "-c", generator_command, (char *) NULL);
+		ERROR("execl failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	close(in[0]);
+	close(out[1]);
+	generator_in = in[1];
+	generator_out = out[0];
+
+	/*
+	 * the dynamic pseudo files run later mustn't hold the generator's
+	 * stdin open, or it won't see the end of the requests
+	 */
+	fcntl(generator_in, F_SETFD, FD_CLOEXEC);
+	fcntl(generator_out, F_SETFD, FD_CLOEXEC);
+
+	return TRUE;
+}
+
+
+/*
+ * Stops using the generator, after an error leaves its replies out of step
+ * with the requests
+ */
+static void stop_generator()
+{
+	if(generator_in != -1) {
+		close(generator_in);
+		generator_in = -1;
+	}
+}
+
+
+/*
+ * Asks the generator for the contents of the 'g' pseudo file dev, returning
+ * their size, the contents are then read from dev->fd.  Returns -1 on error
+ */
+long long pseudo_generate(struct pseudo_dev *dev)
+{
+	char *request, reply[24], *end;
+	int len, res, count = 0;
+	long long size;
+
+	if(generator_in == -1)
+		return -1;
+
+	len = strlen(dev->request);
+	request = malloc(len + 1);
+	if(request == NULL) {
+		ERROR("Out of memory in pseudo_generate\n");
+		return -1;
+	}
+	memcpy(request, dev->request, len);
+	request[len ++] = '\n';
+
+	while(count < len) {
+		res = write(generator_in, request + count, len - count);
+		if(res == -1 && errno == EINTR)
+			continue;
+		if(res == -1) {
+			ERROR("Failed to write to the pseudo file generator "
+				"because %s\n", strerror(errno));
+			free(request);
+			goto failed;
+		}
+		count += res;
+	}
+	free(request);
+
+	for(count = 0; count < sizeof(reply) - 1; count ++) {
+		res = read(generator_out, reply + count, 1);
+		if(res == -1 && errno == EINTR) {
+			count --;
+			continue;
+		}
+		if(res != 1 || reply[count] == '\n')
+			break;
+	}
+
+	if(res != 1 || reply[count] != '\n' || count == 0) {
+		ERROR("Bad or missing reply from the pseudo file generator\n");
+		goto failed;
+	}
+
+	reply[count] = '\0';
+	size = strtoll(reply, &end, 10);
+	if(*end != '\0' || size < 0) {
+		ERROR("Bad size \"%s\" from the pseudo file generator\n",
+			reply);
+		goto failed;
+	}
+
+	return size;
+
+failed:
+	stop_generator();
+	return -1;
+}
+
+
 void add_pseudo_file(struct pseudo_dev *dev)
 {
 	pseudo_file = realloc(pseudo_file, (pseudo_count + 1) *
@@ -317,8 +548,20 @@ void delete_pseudo_files()
 	int i;
 
 	for(i = 0; i < pseudo_count; i++)
-		unlink(pseudo_file[i]->filename);
+		if(pseudo_file[i]->type == 'f')
+			unlink(pseudo_file[i]->filename);
 #endif
+
+	if(generator_pid != -1) {
+		int res, status;
+
+		/* the end of its requests tells the generator to exit */
+		stop_generator();
+		res = waitpid(generator_pid, &status, 0);
+		if(res == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			ERROR("The pseudo file generator failed\n");
+		close(generator_out);
+	}
 }
 
 
@@ -367,6 +610,7 @@ int read_pseudo_def(struct pseudo **pseudo, char *def)
 		}
 
 	case 'f':
+	case 'g':
 		if(def[bytes] == '\0') {
 			ERROR("Not enough arguments in pseudo file "
 				"definition\n");
@@ -430,6 +674,7 @@ int read_pseudo_def(struct pseudo **pseudo, char *def)
 		mode |= S_IFDIR;
 		break;
 	case 'f':
+	case 'g':
 		mode |= S_IFREG;
 		break;
 	}
@@ -444,6 +689,12 @@ int read_pseudo_def(struct pseudo **pseudo, char *def)
 	dev->gid = gid;
 	dev->major = major;
 	dev->minor = minor;
+	dev->request = NULL;
+
+	if(type == 'm' && filename[strspn(filename, "/")] == '\0') {
+		pseudo_root = dev;
+		return TRUE;
+	}
 
 	if(type == 'f') {
 		int res;
@@ -459,6 +710,31 @@ int read_pseudo_def(struct pseudo **pseudo, char *def)
 		add_pseudo_file(dev);
 	}
 
+	if(type == 'g') {
+		if(generator_command == NULL) {
+			ERROR("Generated pseudo file definition \"%s\" without "
+				"a -pg generator before it\n", def);
+			return FALSE;
+		}
+
+		if(generator_pid == -1) {
+			printf("Starting pseudo file generator\n");
+			printf("\t\"%s\"\n", generator_command);
+			if(start_generator() == FALSE) {
+				ERROR("Failed to start pseudo file generator "
+					"\"%s\"\n", generator_command);
+				return FALSE;
+			}
+		}
+
+		dev->request = strdup(def + bytes);
+		if(dev->request == NULL)
+			BAD_ERROR("Failed to create pseudo_dev\n");
+		dev->fd = generator_out;
+		dev->child = -1;
+		add_pseudo_file(dev);
+	}
+
 	*pseudo = add_pseudo(*pseudo, dev, filename, filename);
 
 	return TRUE;
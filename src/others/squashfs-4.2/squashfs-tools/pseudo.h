@@ -21,6 +21,14 @@
  *
  * pseudo.h
  */
+struct inode_info;
+
+/*
+ * Type 's' pseudo files are entries of a -stream input, with inode the
+ * inode mksquashfs made for them and mode their complete st_mode
+ */
+#define IS_STREAM_DIR(dev) ((dev)->type == 's' && S_ISDIR((dev)->mode))
+
 struct pseudo_dev {
 	char		type;
 	unsigned int	mode;
@@ -31,6 +39,9 @@ struct pseudo_dev {
 	int		pseudo_id;
 	int		fd;
 	int		child;
+	/* type 'g', the line the generator is sent for the file */
+	char		*request;
+	struct inode_info *inode;
 #ifdef USE_TMP_FILE
 	char		*filename;
 #endif
@@ -49,9 +60,16 @@ struct pseudo {
 	struct pseudo_entry	*name;
 };
 
+extern struct pseudo_dev *pseudo_root;
 extern int read_pseudo_def(struct pseudo **, char *);
 extern int read_pseudo_file(struct pseudo **, char *);
 extern struct pseudo *pseudo_subdir(char *, struct pseudo *);
 extern struct pseudo_entry *pseudo_readdir(struct pseudo *);
 extern struct pseudo_dev *get_pseudo_file(int);
 extern void delete_pseudo_files();
+extern void set_pseudo_generator(char *);
+extern long long pseudo_generate(struct pseudo_dev *);
+extern struct pseudo *add_pseudo(struct pseudo *, struct pseudo_dev *, char *,
+	char *);
+extern struct pseudo_dev *pseudo_lookup(struct pseudo *, char *);
+extern void pseudo_fill_dirs(struct pseudo *, struct pseudo_dev *, char *);
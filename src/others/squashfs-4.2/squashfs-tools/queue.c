@@ -0,0 +1,287 @@
+/*
+ * Bounded lock-free queue shared by mksquashfs and unsquashfs.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * queue.c
+ *
+ * Multi-producer/multi-consumer ring buffer (after Dmitry Vyukov's bounded
+ * MPMC queue).  Threads that find the queue full or empty spin for an
+ * adaptively sized interval and then sleep on a futex, so the lock-free
+ * fast path never enters the kernel while the pipeline is busy.
+ */
+
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef linux
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "queue.h"
+#include "cpus.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#define cpu_relax()	__asm__ __volatile__("pause" ::: "memory")
+#else
+#define cpu_relax()	__sync_synchronize()
+#endif
+
+
+static void queue_sleep(volatile int *event, volatile int *waiters, int old)
+{
+	__sync_fetch_and_add(waiters, 1);
+#ifdef linux
+	syscall(SYS_futex, event, FUTEX_WAIT_PRIVATE, old, NULL, NULL, 0);
+#else
+	if(*event == old)
+		sched_yield();
+#endif
+	__sync_fetch_and_sub(waiters, 1);
+}
+
+
+static void queue_wake(volatile int *event, volatile int *waiters)
+{
+	__sync_fetch_and_add(event, 1);
+#ifdef linux
+	if(*waiters)
+		syscall(SYS_futex, event, FUTEX_WAKE_PRIVATE, 1, NULL, NULL,
+			0);
+#endif
+}
+
+
+static int queue_try_put(struct queue *queue, void *data)
+{
+	unsigned int pos = queue->head;
+	struct queue_cell *cell;
+
+	while(1) {
+		int diff;
+
+		cell = &queue->cell[pos & queue->mask];
+		diff = (int) (cell->seq - pos);
+		__sync_synchronize();
+
+		if(diff == 0) {
+			if(__sync_bool_compare_and_swap(&queue->head, pos,
+					pos + 1))
+				break;
+		} else if(diff < 0)
+			/* slot still holds last lap's entry, queue is full */
+			return 0;
+
+		pos = queue->head;
+	}
+
+	cell->data = data;
+	__sync_synchronize();
+	cell->seq = pos + 1;
+
+	return 1;
+}
+
+
+static int queue_try_get(struct queue *queue, void **data)
+{
+	unsigned int pos = queue->tail;
+	struct queue_cell *cell;
+
+	while(1) {
+		int diff;
+
+		cell = &queue->cell[pos & queue->mask];
+		diff = (int) (cell->seq - (pos + 1));
+		__sync_synchronize();
+
+		if(diff == 0) {
+			if(__sync_bool_compare_and_swap(&queue->tail, pos,
+					pos + 1))
+				break;
+		} else if(diff < 0)
+			/* slot not yet filled on this lap, queue is empty */
+			return 0;
+
+		pos = queue->tail;
+	}
+
+	*data = cell->data;
+	__sync_synchronize();
+	cell->seq = pos + queue->mask + 1;
+
+	return 1;
+}
+
+
+/*
+ * Grow the spin interval when spinning paid off, shrink it when we ended
+ * up sleeping anyway.  Races on the update are harmless.
+ */
+static void queue_adapt(struct queue *queue, int spun_ok)
+{
+	int spin = queue->spin;
+
+	if(spin == 0)
+		return;
+
+	if(spun_ok && spin < QUEUE_SPIN_MAX)
+		queue->spin = spin << 1;
+	else if(!spun_ok && spin > QUEUE_SPIN_MIN)
+		queue->spin = spin >> 1;
+}
+
+
+struct queue *queue_init(int size)
+{
+	struct queue *queue;
+	unsigned int i, entries = 2;
+
+	/*
+	 * The ring must be a power of two of at least two slots (with one
+	 * slot a full and an empty cell have the same sequence number),
+	 * round up so the queue holds at least size entries
+	 */
+	while(entries < size)
+		entries <<= 1;
+
+	if(posix_memalign((void **) &queue, QUEUE_CACHE_LINE,
+			sizeof(struct queue)))
+		return NULL;
+
+	queue->cell = malloc(sizeof(struct queue_cell) * entries);
+	if(queue->cell == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	for(i = 0; i < entries; i++)
+		queue->cell[i].seq = i;
+
+	queue->mask = entries - 1;
+	queue->head = queue->tail = 0;
+	queue->put_event = queue->get_event = 0;
+	queue->put_waiters = queue->get_waiters = 0;
+	/*
+	 * spinning on a uniprocessor only delays the thread we're waiting
+	 * for, go straight to sleep there
+	 */
+	queue->spin = available_processors() > 1 ? QUEUE_SPIN_MIN : 0;
+
+	return queue;
+}
+
+
+void queue_put(struct queue *queue, void *data)
+{
+	int spin = queue->spin, i;
+
+	for(i = 0; !queue_try_put(queue, data); i++) {
+		if(i < spin)
+			cpu_relax();
+		else {
+			int old = queue->get_event;
+
+			if(queue_try_put(queue, data))
+				break;
+			queue_sleep(&queue->get_event, &queue->get_waiters,
+				old);
+		}
+	}
+
+	if(i)
+		queue_adapt(queue, i <= spin);
+
+	queue_wake(&queue->put_event, &queue->put_waiters);
+}
+
+
+void *queue_get(struct queue *queue)
+{
+	int spin = queue->spin, i;
+	void *data;
+
+	for(i = 0; !queue_try_get(queue, &data); i++) {
+		if(i < spin)
+			cpu_relax();
+		else {
+			int old = queue->put_event;
+
+			if(queue_try_get(queue, &data))
+				break;
+			queue_sleep(&queue->put_event, &queue->put_waiters,
+				old);
+		}
+	}
+
+	if(i)
+		queue_adapt(queue, i <= spin);
+
+	queue_wake(&queue->get_event, &queue->get_waiters);
+
+	return data;
+}
+
+
+/*
+ * Number of entries queued, only a snapshot as other threads may be
+ * putting and getting concurrently
+ */
+int queue_count(struct queue *queue)
+{
+	int count = (int) (queue->head - queue->tail);
+
+	return count < 0 ? 0 : count;
+}
+
+
+/*
+ * Get the next entry if one is queued, returning 0 rather than waiting
+ * when the queue is empty
+ */
+int queue_get_nowait(struct queue *queue, void **data)
+{
+	if(!queue_try_get(queue, data))
+		return 0;
+
+	queue_wake(&queue->get_event, &queue->get_waiters);
+
+	return 1;
+}
+
+
+/*
+ * Put the entry if there's room, returning 0 rather than waiting when the
+ * queue is full
+ */
+int queue_put_nowait(struct queue *queue, void *data)
+{
+	if(!queue_try_put(queue, data))
+		return 0;
+
+	queue_wake(&queue->put_event, &queue->put_waiters);
+
+	return 1;
+}
+
+
+int queue_full(struct queue *queue)
+{
+	return queue_count(queue) > queue->mask;
+}
@@ -0,0 +1,69 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+/*
+ * Bounded lock-free queue shared by mksquashfs and unsquashfs.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * queue.h
+ */
+
+#define QUEUE_CACHE_LINE	64
+
+/* minimum and maximum number of spins before sleeping on the futex */
+#define QUEUE_SPIN_MIN		16
+#define QUEUE_SPIN_MAX		4096
+
+/*
+ * Each slot carries a sequence number which tells producers and
+ * consumers whether the slot is free for the lap they are on, so
+ * puts and gets only contend on the head and tail counters
+ */
+struct queue_cell {
+	volatile unsigned int	seq;
+	void			*data;
+};
+
+/* struct describing queues used to pass data between threads */
+struct queue {
+	unsigned int		mask;
+	struct queue_cell	*cell;
+	volatile unsigned int	head
+		__attribute__((aligned(QUEUE_CACHE_LINE)));
+	volatile unsigned int	tail
+		__attribute__((aligned(QUEUE_CACHE_LINE)));
+	/*
+	 * puts and gets bump their event counter, sleepers wait on the
+	 * counter not changing, and wakers only enter the kernel if the
+	 * waiter count is non-zero
+	 */
+	volatile int		put_event
+		__attribute__((aligned(QUEUE_CACHE_LINE)));
+	volatile int		put_waiters;
+	volatile int		get_event;
+	volatile int		get_waiters;
+	volatile int		spin;
+};
+
+extern struct queue *queue_init(int);
+extern void queue_put(struct queue *, void *);
+extern void *queue_get(struct queue *);
+extern int queue_get_nowait(struct queue *, void **);
+extern int queue_put_nowait(struct queue *, void *);
+extern int queue_full(struct queue *);
+extern int queue_count(struct queue *);
+#endif
@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <pthread.h>
 
 #ifndef linux
 #ifndef __CYGWIN__
@@ -70,6 +71,7 @@ extern int add_file(long long, long long, long long, unsigned int *, int,
 extern void *create_id(unsigned int);
 extern unsigned int get_uid(unsigned int);
 extern unsigned int get_guid(unsigned int);
+extern int processors;
 
 static struct compressor *comp;
 
@@ -116,6 +118,116 @@ int read_block(int fd, long long start, long long *next, void *block)
 }
 
 
+/*
+ * The metadata blocks of a table all decompress to SQUASHFS_METADATA_SIZE
+ * bytes but the last, so once the chain of block headers has been walked
+ * each block can be decompressed into its own slot by a pool of threads,
+ * and the slots closed up afterwards, which only moves anything if a block
+ * was short
+ */
+struct metadata_blocks {
+	int			fd;
+	int			blocks;
+	int			next;
+	long long		*start;
+	int			*bytes;
+	unsigned char		*table;
+};
+
+
+static void *metadata_thread(void *arg)
+{
+	struct metadata_blocks *job = arg;
+	int i;
+
+	while((i = __sync_fetch_and_add(&job->next, 1)) < job->blocks)
+		job->bytes[i] = read_block(job->fd, job->start[i], NULL,
+			job->table + (long long) i * SQUASHFS_METADATA_SIZE);
+
+	return NULL;
+}
+
+
+/*
+ * Read the metadata blocks from start up to end into one table, returning
+ * its size, or -1 on failure.  If a block starts at find, *found is set to
+ * where it is in the table
+ */
+static int read_metadata_table(int fd, long long start, long long end,
+	unsigned char **table, long long find, unsigned int *found)
+{
+	struct metadata_blocks job;
+	pthread_t *thread = NULL;
+	int i, threads, size = 0, bytes = 0;
+
+	job.fd = fd;
+	job.blocks = job.next = 0;
+	job.start = NULL;
+	job.bytes = NULL;
+	job.table = NULL;
+
+	while(start < end) {
+		unsigned short c_byte;
+
+		if(job.blocks == size) {
+			size = size ? size * 2 : 256;
+			job.start = realloc(job.start, size * sizeof(long long));
+			if(job.start == NULL)
+				goto failed;
+		}
+		job.start[job.blocks ++] = start;
+
+		if(read_fs_bytes(fd, start, 2, &c_byte) == 0)
+			goto failed;
+		SQUASHFS_INSWAP_SHORTS(&c_byte, 1);
+		start += 2 + SQUASHFS_COMPRESSED_SIZE(c_byte);
+	}
+
+	job.bytes = malloc(job.blocks * sizeof(int));
+	job.table = malloc((long long) job.blocks * SQUASHFS_METADATA_SIZE);
+	if(job.blocks && (job.bytes == NULL || job.table == NULL))
+		goto failed;
+
+	threads = processors < job.blocks / 4 ? processors : job.blocks / 4;
+	if(threads > 1) {
+		thread = malloc(threads * sizeof(pthread_t));
+		if(thread == NULL)
+			goto failed;
+		for(i = 1; i < threads; i++)
+			if(pthread_create(&thread[i], NULL, metadata_thread,
+					&job) != 0)
+				break;
+		threads = i;
+	}
+
+	metadata_thread(&job);
+	for(i = 1; i < threads; i++)
+		pthread_join(thread[i], NULL);
+	free(thread);
+
+	for(i = 0; i < job.blocks; i++) {
+		if(job.bytes[i] == 0)
+			goto failed;
+		if(job.start[i] == find)
+			*found = bytes;
+		memmove(job.table + bytes, job.table + (long long) i *
+			SQUASHFS_METADATA_SIZE, job.bytes[i]);
+		bytes += job.bytes[i];
+	}
+
+	free(job.start);
+	free(job.bytes);
+	*table = job.table;
+	return bytes;
+
+failed:
+	free(job.start);
+	free(job.bytes);
+	free(job.table);
+	return -1;
+}
+
+
 int scan_inode_table(int fd, long long start, long long end,
 	long long root_inode_start, int root_inode_offset,
 	struct squashfs_super_block *sBlk, union squashfs_inode_header *dir_inode,
@@ -126,33 +238,17 @@ int scan_inode_table(int fd, long long start, long long end,
 	unsigned int *id_table)
 {
 	unsigned char *cur_ptr;
-	int byte, bytes = 0, size = 0, files = 0;
+	int bytes, files = 0;
 	struct squashfs_reg_inode_header inode;
 	unsigned int directory_start_block;
 
 	TRACE("scan_inode_table: start 0x%llx, end 0x%llx, root_inode_start "
 		"0x%llx\n", start, end, root_inode_start);
 
-	while(start < end) {
-		if(start == root_inode_start) {
-			TRACE("scan_inode_table: read compressed block 0x%llx "
-				"containing root inode\n", start);
-			*root_inode_block = bytes;
-		}
-		if(size - bytes < SQUASHFS_METADATA_SIZE) {
-			*inode_table = realloc(*inode_table, size
-				+= SQUASHFS_METADATA_SIZE);
-			if(*inode_table == NULL)
-				return FALSE;
-		}
-		TRACE("scan_inode_table: reading block 0x%llx\n", start);
-		byte = read_block(fd, start, &start, *inode_table + bytes);
-		if(byte == 0) {
-			free(*inode_table);
-			return FALSE;
-		}
-		bytes += byte;
-	}
+	bytes = read_metadata_table(fd, start, end, inode_table,
+		root_inode_start, root_inode_block);
+	if(bytes == -1)
+		return FALSE;
 
 	/*
 	 * Read last inode entry which is the root directory inode, and obtain
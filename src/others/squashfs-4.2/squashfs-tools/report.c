@@ -0,0 +1,492 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * report.c
+ *
+ * The -report layout report: what each file and directory costs in the
+ * image, how its data was placed, and how long the compressor calls took.
+ * The main thread records each regular file as its inode is made, the
+ * deflator threads add up their compressor calls, and the report is
+ * written once the fragment table is complete, as the share of a fragment
+ * a file's tail takes is only known then.
+ */
+
+#define TRUE 1
+#define FALSE 0
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "squashfs_fs.h"
+#include "mksquashfs.h"
+#include "report.h"
+
+#define ERROR(s, args...) \
+		do { \
+			fprintf(stderr, s, ## args); \
+		} while(0)
+
+#define EXIT_MKSQUASHFS() \
+		do { \
+			exit(1); \
+		} while(0)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ##args);\
+			EXIT_MKSQUASHFS();\
+		} while(0);
+
+extern char *image_pathname(struct dir_ent *);
+
+int report = REPORT_NONE;
+
+static struct report_calls {
+	char			*name;
+	long long		calls;
+	long long		bytes_in;
+	long long		bytes_out;
+	long long		usecs;
+	long long		max_usecs;
+	long long		hist[REPORT_HIST_BUCKETS];
+} report_calls[REPORT_CLASSES] = {
+	{ "data" }, { "fragment" }, { "metadata" }
+};
+
+struct report_file {
+	char			*pathname;
+	struct inode_info	*inode;
+	long long		size;
+	long long		block_bytes;
+	long long		sparse;
+	int			blocks;
+	unsigned int		fragment;
+	int			frag_offset;
+	int			frag_size;
+	int			duplicate;
+	long long		stored;
+};
+
+static struct report_file *files;
+static int file_count, files_size;
+
+struct report_dir {
+	char			*pathname;
+	int			files;
+	int			duplicates;
+	long long		size;
+	long long		stored;
+	struct report_dir	*next;
+};
+
+static struct report_dir *dir_hash[REPORT_DIR_HASH];
+static int dir_count;
+
+
+long long report_usecs()
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+
+/*
+ * Bucket 0 counts calls taking under a microsecond, bucket n calls taking
+ * 2^(n-1) to 2^n - 1 microseconds
+ */
+static int hist_bucket(long long usecs)
+{
+	int bucket = 0;
+
+	while(usecs && bucket < REPORT_HIST_BUCKETS - 1) {
+		usecs >>= 1;
+		bucket ++;
+	}
+
+	return bucket;
+}
+
+
+/* called by the deflator threads, once the compressor has returned */
+void report_compress(int class, int size, int c_size, long long start)
+{
+	struct report_calls *c = &report_calls[class];
+	long long usecs = report_usecs() - start, max;
+
+	__sync_fetch_and_add(&c->calls, 1);
+	__sync_fetch_and_add(&c->bytes_in, size);
+	__sync_fetch_and_add(&c->bytes_out, c_size);
+	__sync_fetch_and_add(&c->usecs, usecs);
+	__sync_fetch_and_add(&c->hist[hist_bucket(usecs)], 1);
+
+	for(max = c->max_usecs; usecs > max;
+			max = __sync_val_compare_and_swap(&c->max_usecs, max,
+			usecs));
+}
+
+
+/*
+ * Records the regular file dir_ent, from the arguments create_inode() is
+ * given for it
+ */
+void report_file(struct dir_ent *dir_ent, long long size, int blocks,
+	unsigned int *block_list, unsigned int fragment, int frag_offset,
+	int frag_size, long long sparse)
+{
+	struct report_file *file;
+	int i;
+
+	if(file_count == files_size) {
+		files_size = files_size ? files_size * 2 : 1024;
+		files = realloc(files, files_size * sizeof(*files));
+		if(files == NULL)
+			BAD_ERROR("Out of memory in report_file\n");
+	}
+
+	file = &files[file_count ++];
+	memset(file, 0, sizeof(*file));
+	/* -stream files are written before the directory tree is made */
+	file->pathname = dir_ent->our_dir ? image_pathname(dir_ent) :
+		strdup(dir_ent->pathname);
+	if(file->pathname == NULL)
+		BAD_ERROR("Out of memory in report_file\n");
+	file->inode = dir_ent->inode;
+	file->size = size;
+	file->sparse = sparse;
+	file->blocks = blocks;
+	for(i = 0; i < blocks; i++)
+		file->block_bytes +=
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[i]);
+	file->fragment = fragment;
+	file->frag_offset = frag_offset;
+	file->frag_size = frag_size;
+}
+
+
+/* whether the file just recorded turned out to duplicate another */
+void report_duplicate(struct inode_info *inode, int duplicate)
+{
+	if(file_count && files[file_count - 1].inode == inode)
+		files[file_count - 1].duplicate = duplicate;
+}
+
+
+static int compare_file(const void *a, const void *b)
+{
+	return strcmp(((struct report_file *) a)->pathname,
+		((struct report_file *) b)->pathname);
+}
+
+
+static int compare_dir(const void *a, const void *b)
+{
+	return strcmp((*(struct report_dir **) a)->pathname,
+		(*(struct report_dir **) b)->pathname);
+}
+
+
+static struct report_dir *lookup_dir(char *pathname, int len)
+{
+	unsigned int hash = 0;
+	struct report_dir *dir;
+	int i;
+
+	for(i = 0; i < len; i++)
+		hash = hash * 31 + (unsigned char) pathname[i];
+	hash %= REPORT_DIR_HASH;
+
+	for(dir = dir_hash[hash]; dir; dir = dir->next)
+		if(strncmp(dir->pathname, pathname, len) == 0 &&
+				dir->pathname[len] == '\0')
+			return dir;
+
+	dir = malloc(sizeof(*dir));
+	if(dir == NULL)
+		BAD_ERROR("Out of memory in lookup_dir\n");
+	memset(dir, 0, sizeof(*dir));
+	dir->pathname = strndup(pathname, len);
+	if(dir->pathname == NULL)
+		BAD_ERROR("Out of memory in lookup_dir\n");
+	dir->next = dir_hash[hash];
+	dir_hash[hash] = dir;
+	dir_count ++;
+
+	return dir;
+}
+
+
+/* adds the file to the totals of each directory it is in, "" the root */
+static void add_to_dirs(struct report_file *file)
+{
+	struct report_dir *dir;
+	char *slash;
+	int len = 0;
+
+	while(1) {
+		dir = lookup_dir(file->pathname, len);
+		dir->files ++;
+		dir->duplicates += file->duplicate;
+		dir->size += file->size;
+		dir->stored += file->stored;
+
+		if(file->pathname[len] == '\0')
+			break;
+		slash = strchr(file->pathname + len + 1, '/');
+		if(slash == NULL)
+			break;
+		len = slash - file->pathname;
+	}
+}
+
+
+/*
+ * Works out the bytes each file adds to the image, nothing for a
+ * duplicate, and for a tail the compressed size of its fragment in
+ * proportion to the part of the fragment it fills
+ */
+static void stored_bytes(struct squashfs_fragment_entry *fragment_table,
+	int fragments)
+{
+	int *fill = calloc(fragments ? fragments : 1, sizeof(int));
+	int i;
+
+	if(fill == NULL)
+		BAD_ERROR("Out of memory in stored_bytes\n");
+
+	for(i = 0; i < file_count; i++) {
+		struct report_file *file = &files[i];
+
+		if(file->fragment < fragments && file->frag_offset +
+				file->frag_size > fill[file->fragment])
+			fill[file->fragment] = file->frag_offset +
+				file->frag_size;
+	}
+
+	for(i = 0; i < file_count; i++) {
+		struct report_file *file = &files[i];
+
+		if(file->duplicate)
+			continue;
+
+		file->stored = file->block_bytes;
+		if(file->fragment < fragments && fill[file->fragment])
+			file->stored += (long long) file->frag_size *
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(fragment_table
+				[file->fragment].size) / fill[file->fragment];
+	}
+
+	free(fill);
+}
+
+
+static char *placement(struct report_file *file)
+{
+	int fragment = file->fragment != SQUASHFS_INVALID_FRAG;
+
+	if(file->size == 0)
+		return "empty";
+	if(file->block_bytes == 0 && !fragment)
+		return "sparse";
+	if(file->block_bytes == 0)
+		return "fragment";
+	return fragment ? "blocks+fragment" : "blocks";
+}
+
+
+static double ratio(long long stored, long long size)
+{
+	return size ? stored * 100.0 / size : 0;
+}
+
+
+static void json_string(FILE *out, char *string)
+{
+	unsigned char *s = (unsigned char *) string;
+
+	fputc('"', out);
+	for(; *s; s++)
+		if(*s == '"' || *s == '\\')
+			fprintf(out, "\\%c", *s);
+		else if(*s < 0x20)
+			fprintf(out, "\\u%04x", *s);
+		else
+			fputc(*s, out);
+	fputc('"', out);
+}
+
+
+static void calls_report(FILE *out, struct report_calls *c, int json,
+	int last)
+{
+	int i, top;
+
+	if(json) {
+		for(top = REPORT_HIST_BUCKETS; top > 1 && c->hist[top - 1] == 0;
+			top--);
+		fprintf(out, "    \"%s\": { \"calls\": %lld, \"bytes_in\": "
+			"%lld, \"bytes_out\": %lld, \"usecs\": %lld, "
+			"\"max_usecs\": %lld, \"histogram\": [", c->name,
+			c->calls, c->bytes_in, c->bytes_out, c->usecs,
+			c->max_usecs);
+		for(i = 0; i < top; i++)
+			fprintf(out, "%s%lld", i ? ", " : " ", c->hist[i]);
+		fprintf(out, " ] }%s\n", last ? "" : ",");
+		return;
+	}
+
+	fprintf(out, "  %-10s %10lld %14lld %14lld %6.1f%% %10.3f %10.1f "
+		"%10lld\n", c->name, c->calls, c->bytes_in, c->bytes_out,
+		ratio(c->bytes_out, c->bytes_in), c->usecs / 1000000.0,
+		c->calls ? c->usecs / (double) c->calls : 0, c->max_usecs);
+}
+
+
+static void file_report(FILE *out, struct report_file *file, int json,
+	int last)
+{
+	char fragment[16] = "-";
+
+	if(json) {
+		fprintf(out, "    { \"path\": ");
+		json_string(out, file->pathname);
+		fprintf(out, ", \"size\": %lld, \"stored\": %lld, "
+			"\"placement\": \"%s\", \"blocks\": %d, "
+			"\"block_bytes\": %lld, \"sparse\": %lld, ",
+			file->size, file->stored, placement(file),
+			file->blocks, file->block_bytes, file->sparse);
+		if(file->fragment == SQUASHFS_INVALID_FRAG)
+			fprintf(out, "\"fragment\": null, ");
+		else
+			fprintf(out, "\"fragment\": %u, \"tail\": %d, ",
+				file->fragment, file->frag_size);
+		fprintf(out, "\"duplicate\": %s }%s\n", file->duplicate ?
+			"true" : "false", last ? "" : ",");
+		return;
+	}
+
+	if(file->fragment != SQUASHFS_INVALID_FRAG)
+		sprintf(fragment, "%u", file->fragment);
+	fprintf(out, "  %12lld %12lld %6.1f%% %-15s %6d %8s %8d %-3s %s\n",
+		file->size, file->stored, ratio(file->stored, file->size),
+		placement(file), file->blocks, fragment, file->frag_size,
+		file->duplicate ? "yes" : "no", file->pathname);
+}
+
+
+static void dir_report(FILE *out, struct report_dir *dir, int json,
+	int last)
+{
+	if(json) {
+		fprintf(out, "    { \"path\": ");
+		json_string(out, dir->pathname[0] ? dir->pathname : ".");
+		fprintf(out, ", \"files\": %d, \"duplicates\": %d, \"size\": "
+			"%lld, \"stored\": %lld }%s\n", dir->files,
+			dir->duplicates, dir->size, dir->stored, last ? "" :
+			",");
+		return;
+	}
+
+	fprintf(out, "  %8d %8d %14lld %14lld %6.1f%% %s\n", dir->files,
+		dir->duplicates, dir->size, dir->stored, ratio(dir->stored,
+		dir->size), dir->pathname[0] ? dir->pathname : ".");
+}
+
+
+int report_write(char *filename, char *comp_name, int block_size,
+	struct squashfs_fragment_entry *fragment_table, int fragments)
+{
+	int json = report == REPORT_JSON, i, j;
+	struct report_dir **dirs;
+	FILE *out;
+
+	out = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+	if(out == NULL) {
+		ERROR("Failed to open report file %s\n", filename);
+		return FALSE;
+	}
+
+	stored_bytes(fragment_table, fragments);
+	qsort(files, file_count, sizeof(*files), compare_file);
+	for(i = 0; i < file_count; i++)
+		add_to_dirs(&files[i]);
+
+	dirs = malloc((dir_count ? dir_count : 1) * sizeof(*dirs));
+	if(dirs == NULL)
+		BAD_ERROR("Out of memory in report_write\n");
+	for(i = j = 0; i < REPORT_DIR_HASH; i++) {
+		struct report_dir *dir;
+
+		for(dir = dir_hash[i]; dir; dir = dir->next)
+			dirs[j++] = dir;
+	}
+	qsort(dirs, dir_count, sizeof(*dirs), compare_dir);
+
+	if(json) {
+		fprintf(out, "{\n  \"compressor\": \"%s\",\n  \"block_size\": "
+			"%d,\n  \"compressor_calls\": {\n", comp_name,
+			block_size);
+		for(i = 0; i < REPORT_CLASSES; i++)
+			calls_report(out, &report_calls[i], TRUE,
+				i == REPORT_CLASSES - 1);
+		fprintf(out, "  },\n  \"files\": [\n");
+		for(i = 0; i < file_count; i++)
+			file_report(out, &files[i], TRUE, i == file_count - 1);
+		fprintf(out, "  ],\n  \"directories\": [\n");
+		for(i = 0; i < dir_count; i++)
+			dir_report(out, dirs[i], TRUE, i == dir_count - 1);
+		fprintf(out, "  ]\n}\n");
+	} else {
+		fprintf(out, "Compressor calls (%s, block size %d, time summed "
+			"over threads):\n", comp_name, block_size);
+		fprintf(out, "  %-10s %10s %14s %14s %7s %10s %10s %10s\n",
+			"class", "calls", "bytes in", "bytes out", "ratio",
+			"total s", "mean us", "max us");
+		for(i = 0; i < REPORT_CLASSES; i++)
+			calls_report(out, &report_calls[i], FALSE, FALSE);
+		fprintf(out, "\nFiles (stored is what the file adds to the "
+			"image, a tail its share of the\ncompressed fragment, "
+			"and nothing for a duplicate):\n");
+		fprintf(out, "  %12s %12s %7s %-15s %6s %8s %8s %-3s %s\n",
+			"size", "stored", "ratio", "placement", "blocks",
+			"fragment", "tail", "dup", "path");
+		for(i = 0; i < file_count; i++)
+			file_report(out, &files[i], FALSE, FALSE);
+		fprintf(out, "\nDirectories (the files anywhere below each):\n");
+		fprintf(out, "  %8s %8s %14s %14s %7s %s\n", "files",
+			"dups", "size", "stored", "ratio", "path");
+		for(i = 0; i < dir_count; i++)
+			dir_report(out, dirs[i], FALSE, FALSE);
+	}
+
+	free(dirs);
+
+	if(out != stdout && fclose(out) != 0) {
+		ERROR("Failed to write report file %s\n", filename);
+		return FALSE;
+	}
+
+	return TRUE;
+}
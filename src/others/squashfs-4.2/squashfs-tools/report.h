@@ -0,0 +1,54 @@
+#ifndef REPORT_H
+#define REPORT_H
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * report.h
+ */
+
+/* -report and -report-json */
+#define REPORT_NONE		0
+#define REPORT_TEXT		1
+#define REPORT_JSON		2
+
+/* what a compressor call was compressing */
+#define REPORT_DATA		0
+#define REPORT_FRAGMENT		1
+#define REPORT_METADATA		2
+#define REPORT_CLASSES		3
+
+#define REPORT_HIST_BUCKETS	16
+#define REPORT_DIR_HASH		1024
+
+#define REPORT_START()		(report ? report_usecs() : 0)
+
+struct dir_ent;
+struct inode_info;
+struct squashfs_fragment_entry;
+
+extern int report;
+extern long long report_usecs();
+extern void report_compress(int, int, int, long long);
+extern void report_file(struct dir_ent *, long long, int, unsigned int *,
+	unsigned int, int, int, long long);
+extern void report_duplicate(struct inode_info *, int);
+extern int report_write(char *, char *, int, struct squashfs_fragment_entry *,
+	int);
+#endif
@@ -34,10 +34,13 @@
 #include <dirent.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #include "squashfs_fs.h"
 #include "mksquashfs.h"
 #include "sort.h"
+#include "base_fs.h"
+#include "arena.h"
 
 #ifdef SQUASHFS_TRACE
 #define TRACE(s, args...) \
@@ -60,18 +63,33 @@
 
 int mkisofs_style = -1;
 
+#define SORT_HASH_MIN		4096
+
+/*
+ * the sort and trace file priorities, an open addressed (linear probing)
+ * hash on (st_dev, st_ino) doubled when half full.  A file listed again
+ * takes the later priority
+ */
 struct sort_info {
 	dev_t			st_dev;
 	ino_t			st_ino;
 	int			priority;
-	struct sort_info	*next;
+	char			traced;
+	char			used;
 };
 
-struct sort_info *sort_info_list[65536];
+struct sort_info *sort_hash = NULL;
+unsigned int sort_hash_size = 0, sort_hash_count = 0;
 
 struct priority_entry *priority_list[65536];
 
+/* the priority entries live until mksquashfs exits */
+static struct arena sort_arena;
+
 extern int silent;
+extern int fragment_priority;
+extern int fragment_boot;
+extern char *base_image;
 extern void write_file(squashfs_inode *inode, struct dir_ent *dir_ent,
 	int *c_size);
 
@@ -81,7 +99,9 @@ int add_priority_list(struct dir_ent *dir, int priority)
 	struct priority_entry *new_priority_entry;
 
 	priority += 32768;
-	if((new_priority_entry = malloc(sizeof(struct priority_entry))) == NULL) {
+	new_priority_entry = arena_alloc(&sort_arena,
+		sizeof(struct priority_entry));
+	if(new_priority_entry == NULL) {
 		ERROR("Out of memory allocating priority entry\n");
 		return FALSE;
 	}
@@ -93,35 +113,91 @@ int add_priority_list(struct dir_ent *dir, int priority)
 }
 
 
-int get_priority(char *filename, struct stat *buf, int priority)
+static struct sort_info *sort_hash_slot(struct sort_info *table,
+	unsigned int size, dev_t dev, ino_t ino)
+{
+	unsigned int i = dev_ino_hash(dev, ino) & (size - 1);
+
+	while(table[i].used && (table[i].st_ino != ino ||
+			table[i].st_dev != dev))
+		i = (i + 1) & (size - 1);
+
+	return &table[i];
+}
+
+
+static struct sort_info *lookup_sort_info(struct stat *buf)
 {
-	int hash = buf->st_ino & 0xffff;
 	struct sort_info *s;
 
-	for(s = sort_info_list[hash]; s; s = s->next)
-		if((s->st_dev == buf->st_dev) && (s->st_ino == buf->st_ino)) {
-			TRACE("returning priority %d (%s)\n", s->priority,
-				filename);
-			return s->priority;
+	if(sort_hash == NULL)
+		return NULL;
+
+	s = sort_hash_slot(sort_hash, sort_hash_size, buf->st_dev,
+		buf->st_ino);
+	return s->used ? s : NULL;
+}
+
+
+/*
+ * Returns the file's entry, which stays valid until the next one is added,
+ * or NULL if out of memory
+ */
+static struct sort_info *add_sort_info(struct stat *buf, int priority)
+{
+	struct sort_info *s;
+
+	if(sort_hash_count >= sort_hash_size >> 1) {
+		unsigned int i, size = sort_hash_size ? sort_hash_size << 1 :
+			SORT_HASH_MIN;
+		struct sort_info *table;
+
+		table = calloc(size, sizeof(struct sort_info));
+
+		if(table == NULL) {
+			ERROR("Out of memory allocating sort list entry\n");
+			return NULL;
 		}
+
+		for(i = 0; i < sort_hash_size; i ++)
+			if(sort_hash[i].used)
+				*sort_hash_slot(table, size,
+					sort_hash[i].st_dev,
+					sort_hash[i].st_ino) = sort_hash[i];
+
+		free(sort_hash);
+		sort_hash = table;
+		sort_hash_size = size;
+	}
+
+	s = sort_hash_slot(sort_hash, sort_hash_size, buf->st_dev,
+		buf->st_ino);
+	if(!s->used) {
+		s->st_dev = buf->st_dev;
+		s->st_ino = buf->st_ino;
+		s->used = TRUE;
+		sort_hash_count ++;
+	}
+	s->priority = priority;
+	s->traced = FALSE;
+
+	return s;
+}
+
+
+int get_priority(char *filename, struct stat *buf, int priority)
+{
+	struct sort_info *s = lookup_sort_info(buf);
+
+	if(s) {
+		TRACE("returning priority %d (%s)\n", s->priority, filename);
+		return s->priority;
+	}
 	TRACE("returning priority %d (%s)\n", priority, filename);
 	return priority;
 }
 
 
-#define ADD_ENTRY(buf, priority) {\
-	int hash = buf.st_ino & 0xffff;\
-	struct sort_info *s;\
-	if((s = malloc(sizeof(struct sort_info))) == NULL) {\
-		ERROR("Out of memory allocating sort list entry\n");\
-		return FALSE;\
-	}\
-	s->st_dev = buf.st_dev;\
-	s->st_ino = buf.st_ino;\
-	s->priority = priority;\
-	s->next = sort_info_list[hash];\
-	sort_info_list[hash] = s;\
-	}
 int add_sort_list(char *path, int priority, int source, char *source_path[])
 {
 	int i, n;
@@ -141,8 +217,7 @@ re_read:
 		TRACE("adding filename %s, priority %d, st_dev %d, st_ino "
 			"%lld\n", path, priority, (int) buf.st_dev,
 			(long long) buf.st_ino);
-		ADD_ENTRY(buf, priority);
-		return TRUE;
+		return add_sort_info(&buf, priority) != NULL;
 	}
 
 	for(i = 0, n = 0; i < source; i++) {
@@ -152,7 +227,8 @@ re_read:
 				goto error;
 			continue;
 		}
-		ADD_ENTRY(buf, priority);
+		if(add_sort_info(&buf, priority) == NULL)
+			return FALSE;
 		n ++;
 	}
 
@@ -259,6 +335,199 @@ int read_sort_file(char *filename, int source, char *source_path[])
 }
 
 
+/*
+ * -sort-trace, files are given priorities from TRACE_PRIORITY down in the
+ * order a boot trace first reads them, so they're written first and
+ * together.  Past TRACE_PRIORITY files they all get priority 1
+ */
+#define TRACE_PRIORITY	32767
+static int trace_priority = TRACE_PRIORITY;
+
+struct trace_sources {
+	int			source;
+	char			**source_path;
+	int			added;
+};
+
+
+static int trace_stat(char *path, struct trace_sources *sources,
+	struct stat *buf)
+{
+	char filename[4096], *base, *rest = strchr(path, '/');
+	int i;
+
+	for(i = 0; i < sources->source; i++) {
+		snprintf(filename, sizeof(filename), "%s/%s",
+			sources->source_path[i], path);
+		if(lstat(filename, buf) == 0)
+			return TRUE;
+
+		/* with several sources each is a directory in the root */
+		base = strrchr(sources->source_path[i], '/');
+		base = base ? base + 1 : sources->source_path[i];
+		if(rest && strlen(base) == rest - path &&
+				strncmp(path, base, rest - path) == 0) {
+			snprintf(filename, sizeof(filename), "%s%s",
+				sources->source_path[i], rest);
+			if(lstat(filename, buf) == 0)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+/*
+ * Give the file at path (relative to the root of the filesystem) the next
+ * trace priority, unless the trace has already placed it.  Only regular
+ * files are placed, a directory's priority would become the default for
+ * all its files
+ */
+static int add_trace_file(char *path, struct trace_sources *sources)
+{
+	struct stat buf;
+	struct sort_info *s;
+	int priority = trace_priority;
+
+	while(*path == '/')
+		path ++;
+	while(strncmp(path, "./", 2) == 0)
+		path += 2;
+
+	if(*path == '\0' || trace_stat(path, sources, &buf) == FALSE ||
+			!S_ISREG(buf.st_mode))
+		return TRUE;
+
+	s = lookup_sort_info(&buf);
+	if(s && s->traced)
+		return TRUE;
+
+	TRACE("add_trace_file: %s, priority %d\n", path, priority);
+	s = add_sort_info(&buf, priority);
+	if(s == NULL)
+		return FALSE;
+	s->traced = TRUE;
+	if(trace_priority > 1)
+		trace_priority --;
+	sources->added ++;
+
+	return TRUE;
+}
+
+
+static void add_base_trace_file(struct base_file *file, void *arg)
+{
+	add_trace_file(file->pathname, arg);
+}
+
+
+/*
+ * Pull the pathname out of a line of the trace.  strace lines give the
+ * first quoted string of a successful open or exec, fatrace lines
+ * ("comm(pid): O /path") the path after the event flags, anything else
+ * is taken to be a pathname
+ */
+static char *trace_pathname(char *line)
+{
+	char *p = line, *name, *end;
+
+	while(isdigit(*p) || *p == ' ' || *p == '[' || *p == ']' ||
+			strncmp(p, "pid", 3) == 0)
+		p += strncmp(p, "pid", 3) == 0 ? 3 : 1;
+
+	for(name = p; isalnum(*p) || *p == '_' || *p == '-' || *p == '.';
+			p++);
+
+	if(*p == '(' && p > name) {
+		end = p + 1;
+		while(isdigit(*end))
+			end ++;
+		if(end > p + 1 && strncmp(end, "): ", 3) == 0) {
+			/* fatrace */
+			end = strchr(end + 3, ' ');
+			return end ? end + 1 : NULL;
+		}
+
+		if(strncmp(name, "open(", 5) && strncmp(name, "openat(", 7) &&
+				strncmp(name, "open64(", 7) &&
+				strncmp(name, "openat2(", 8) &&
+				strncmp(name, "execve(", 7) &&
+				strncmp(name, "execveat(", 9))
+			return NULL;
+		if(strstr(p, "= -1") || (p = strchr(p, '"')) == NULL ||
+				(end = strchr(++p, '"')) == NULL)
+			return NULL;
+		*end = '\0';
+		return p;
+	}
+
+	while(isspace(*line))
+		line ++;
+	return *line ? line : NULL;
+}
+
+
+/*
+ * Read a -sort-trace file.  As well as lists of pathnames, strace and
+ * fatrace output, blkparse output of reads of the -base image is
+ * understood, the sectors read being mapped back to the files there
+ */
+int read_trace_file(char *filename, int source, char *source_path[])
+{
+	FILE *fd;
+	char line[16384];
+	struct trace_sources sources = { source, source_path, 0 };
+	int lines = 0;
+
+	if((fd = fopen(filename, "r")) == NULL) {
+		perror("Could not open sort trace file...");
+		return FALSE;
+	}
+
+	while(fgets(line, sizeof(line), fd)) {
+		int major, minor, cpu, seq, pid, sectors;
+		long long sector;
+		double secs;
+		char action[4], rwbs[8], *path;
+
+		line[strcspn(line, "\n")] = '\0';
+		lines ++;
+
+		if(sscanf(line, "%d,%d %d %d %lf %d %3s %7s %lld + %d", &major,
+				&minor, &cpu, &seq, &secs, &pid, action, rwbs,
+				&sector, &sectors) == 10) {
+			if(strchr(rwbs, 'R') == NULL)
+				continue;
+			if(base_image == NULL) {
+				ERROR("Sort trace file %s is a block trace, "
+					"which needs the -base image it was "
+					"taken of\n", filename);
+				fclose(fd);
+				return FALSE;
+			}
+			if(base_files_at(sector << 9, (long long) sectors << 9,
+					add_base_trace_file, &sources) == FALSE) {
+				fclose(fd);
+				return FALSE;
+			}
+			continue;
+		}
+
+		path = trace_pathname(line);
+		if(path && add_trace_file(path, &sources) == FALSE) {
+			fclose(fd);
+			return FALSE;
+		}
+	}
+
+	fclose(fd);
+	printf("Sort trace file %s: %d files placed from %d lines\n", filename,
+		sources.added, lines);
+	return TRUE;
+}
+
+
 void sort_files_and_write(struct dir_info *dir)
 {
 	int i;
@@ -270,6 +539,11 @@ void sort_files_and_write(struct dir_info *dir)
 		for(entry = priority_list[i]; entry; entry = entry->next) {
 			TRACE("%d: %s\n", i - 32768, entry->dir->pathname);
 			if(entry->dir->inode->inode == SQUASHFS_INVALID_BLK) {
+				struct sort_info *s = lookup_sort_info(
+					&entry->dir->inode->buf);
+
+				fragment_priority = i - 32768;
+				fragment_boot = s && s->traced;
 				write_file(&inode, entry->dir, &duplicate_file);
 				INFO("file %s, uncompressed size %lld bytes %s"
 					"\n", entry->dir->pathname,
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * sqlzma_wrapper.c
+ *
+ * Decompressor for the 2.x and 3.x filesystems written by the sqlzma
+ * mksquashfs forks (the -lzma, -rtn12, -wnr1000, -hg612 and -nb4 trees
+ * in src/others).  They compress each block with LZMA, falling back to
+ * zlib block by block, and an LZMA block is told apart by its first
+ * properties byte, which can never start a zlib stream.  The blocks
+ * are handed to the gzip and lzma decompressors built into unsquashfs.
+ */
+
+#include <stdlib.h>
+
+#include "squashfs_fs.h"
+#include "compressor.h"
+
+#define SQLZMA_LZMA_PROPS	0x5d
+
+struct sqlzma_stream {
+	void	*gzip;
+	void	*lzma;
+};
+
+
+static struct compressor *sqlzma_block_comp(void *src)
+{
+	return *((unsigned char *) src) == SQLZMA_LZMA_PROPS ?
+		lookup_compressor("lzma") : lookup_compressor("gzip");
+}
+
+
+static int sqlzma_uncompress(void *dest, void *src, int size, int block_size,
+	int *error)
+{
+	struct compressor *comp = sqlzma_block_comp(src);
+
+	if(!comp->supported) {
+		*error = 0;
+		return -1;
+	}
+
+	return compressor_uncompress(comp, dest, src, size, block_size, error);
+}
+
+
+static void *sqlzma_uncompress_init(int block_size)
+{
+	struct compressor *gzip = lookup_compressor("gzip"),
+		*lzma = lookup_compressor("lzma");
+	struct sqlzma_stream *stream = malloc(sizeof(struct sqlzma_stream));
+
+	if(stream == NULL)
+		return NULL;
+
+	stream->gzip = gzip->supported ?
+		compressor_uncompress_init(gzip, block_size) : NULL;
+	stream->lzma = lzma->supported ?
+		compressor_uncompress_init(lzma, block_size) : NULL;
+
+	return stream;
+}
+
+
+static int sqlzma_uncompress_stream(void *strm, void *dest, void *src,
+	int size, int block_size, int *error)
+{
+	struct sqlzma_stream *stream = strm;
+	struct compressor *comp = sqlzma_block_comp(src);
+
+	if(!comp->supported) {
+		*error = 0;
+		return -1;
+	}
+
+	return compressor_uncompress_stream(comp, comp->id == LZMA_COMPRESSION ?
+		stream->lzma : stream->gzip, dest, src, size, block_size,
+		error);
+}
+
+
+static void sqlzma_uncompress_free(void *strm)
+{
+	struct sqlzma_stream *stream = strm;
+
+	compressor_uncompress_free(lookup_compressor("gzip"), stream->gzip);
+	compressor_uncompress_free(lookup_compressor("lzma"), stream->lzma);
+	free(stream);
+}
+
+
+struct compressor sqlzma_comp_ops = {
+	.init = NULL,
+	.compress = NULL,
+	.uncompress = sqlzma_uncompress,
+	.uncompress_init = sqlzma_uncompress_init,
+	.uncompress_stream = sqlzma_uncompress_stream,
+	.uncompress_free = sqlzma_uncompress_free,
+	.options = NULL,
+	.usage = NULL,
+	.id = LZMA_COMPRESSION,
+	.name = "sqlzma",
+	.supported = 1
+};
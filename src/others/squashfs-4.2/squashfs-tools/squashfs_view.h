@@ -0,0 +1,85 @@
+#ifndef SQUASHFS_VIEW_H
+#define SQUASHFS_VIEW_H
+/*
+ * Unsquash a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * squashfs_view.h
+ */
+
+/*
+ * Read a field of a little endian 4.0 structure where it lies, in a
+ * metadata block or the fragment table, rather than swapping the whole
+ * structure into a copy first, e.g.
+ *
+ *	size = SQUASHFS_VIEW(ptr, struct squashfs_reg_inode_header, file_size);
+ *
+ * ptr needn't be aligned.  The width comes from the field, and each read
+ * is a memcpy of a constant size, so on little endian hosts it compiles
+ * to a plain load and on big endian ones to a load and a byte swap
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+
+#if __BYTE_ORDER == __BIG_ENDIAN
+#define SQUASHFS_VIEW_LE(bits, v)	__builtin_bswap##bits(v)
+#else
+#define SQUASHFS_VIEW_LE(bits, v)	(v)
+#endif
+
+static inline unsigned short squashfs_view_le16(const void *p)
+{
+	unsigned short v;
+
+	memcpy(&v, p, sizeof(v));
+	return SQUASHFS_VIEW_LE(16, v);
+}
+
+
+static inline unsigned int squashfs_view_le32(const void *p)
+{
+	unsigned int v;
+
+	memcpy(&v, p, sizeof(v));
+	return SQUASHFS_VIEW_LE(32, v);
+}
+
+
+static inline unsigned long long squashfs_view_le64(const void *p)
+{
+	unsigned long long v;
+
+	memcpy(&v, p, sizeof(v));
+	return SQUASHFS_VIEW_LE(64, v);
+}
+
+#define SQUASHFS_VIEW_SIZE(type, field)	sizeof(((type *) 0)->field)
+#define SQUASHFS_VIEW_AT(p, type, field) \
+		((const char *) (p) + offsetof(type, field))
+
+/* the sizes are constant, so only one branch is ever compiled in */
+#define SQUASHFS_VIEW(p, type, field) \
+	(SQUASHFS_VIEW_SIZE(type, field) == 2 ? \
+		squashfs_view_le16(SQUASHFS_VIEW_AT(p, type, field)) : \
+	SQUASHFS_VIEW_SIZE(type, field) == 4 ? \
+		squashfs_view_le32(SQUASHFS_VIEW_AT(p, type, field)) : \
+		squashfs_view_le64(SQUASHFS_VIEW_AT(p, type, field)))
+#endif
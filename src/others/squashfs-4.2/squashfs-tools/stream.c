@@ -0,0 +1,807 @@
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * stream.c
+ *
+ * Reader for tar (v7, ustar, GNU and pax) and cpio (newc, crc and odc)
+ * streams, so a filesystem can be built from an archive piped to
+ * mksquashfs without unpacking it first.  The entries are read strictly
+ * in stream order, each regular file's data straight after its header.
+ */
+
+#define TRUE 1
+#define FALSE 0
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef linux
+#include <sys/mkdev.h>
+#else
+#include <sys/sysmacros.h>
+#endif
+
+#include "stream.h"
+
+#ifdef SQUASHFS_TRACE
+#define TRACE(s, args...) \
+		do { \
+			printf("mksquashfs: "s, ## args); \
+		} while(0)
+#else
+#define TRACE(s, args...)
+#endif
+
+#define ERROR(s, args...) \
+		do { \
+			fprintf(stderr, s, ## args); \
+		} while(0)
+
+#define EXIT_MKSQUASHFS() \
+		do { \
+			exit(1); \
+		} while(0)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ##args);\
+			EXIT_MKSQUASHFS();\
+		} while(0);
+
+static int stream_fd, stream_format, stream_ended = FALSE;
+static char *stream_buffer;
+static int stream_bytes = 0, stream_offset = 0;
+
+/* data of the current entry not yet read, and the padding after it */
+static long long data_left = 0;
+static int data_pad = 0;
+
+/* entries waiting to be returned by stream_next() */
+static struct stream_entry *queued = NULL, **queued_tail = &queued;
+
+/*
+ * cpio hard links are the entries sharing a device and inode number.  In
+ * newc archives only the last of them carries the data, so those before it
+ * are held back until it's been seen
+ */
+struct cpio_link {
+	unsigned long long	dev;
+	unsigned long long	ino;
+	char			*pathname;
+	struct stream_entry	*pending;
+	struct cpio_link	*next;
+};
+
+static struct cpio_link *cpio_link[STREAM_LINK_HASH];
+
+
+/*
+ * Make sure at least bytes (no more than STREAM_BUFFER_SIZE) are in the
+ * buffer, returns how many are, fewer only at the end of the stream
+ */
+static int stream_fill(int bytes)
+{
+	int res;
+
+	if(stream_bytes - stream_offset >= bytes)
+		return stream_bytes - stream_offset;
+
+	memmove(stream_buffer, stream_buffer + stream_offset, stream_bytes -
+		stream_offset);
+	stream_bytes -= stream_offset;
+	stream_offset = 0;
+
+	while(stream_bytes < bytes) {
+		res = read(stream_fd, stream_buffer + stream_bytes,
+			STREAM_BUFFER_SIZE - stream_bytes);
+		if(res == 0)
+			break;
+		if(res == -1) {
+			if(errno == EINTR)
+				continue;
+			BAD_ERROR("Read on input stream failed because %s\n",
+				strerror(errno));
+		}
+		stream_bytes += res;
+	}
+
+	return stream_bytes;
+}
+
+
+static int stream_get(void *buffer, int bytes)
+{
+	int copied = 0;
+
+	while(copied < bytes) {
+		int avail = stream_fill(1), size = bytes - copied;
+
+		if(avail == 0)
+			break;
+		if(size > avail)
+			size = avail;
+		memcpy(buffer + copied, stream_buffer + stream_offset, size);
+		stream_offset += size;
+		copied += size;
+	}
+
+	return copied;
+}
+
+
+static void stream_skip(long long bytes)
+{
+	while(bytes) {
+		int avail = stream_fill(1);
+
+		if(avail == 0)
+			BAD_ERROR("Unexpected end of input stream\n");
+		if(avail > bytes)
+			avail = bytes;
+		stream_offset += avail;
+		bytes -= avail;
+	}
+}
+
+
+/*
+ * Read the next bytes of the current entry's data, returns fewer (or -1)
+ * only if the stream ends early
+ */
+int stream_read(void *buffer, int bytes)
+{
+	int res;
+
+	if(bytes > data_left)
+		bytes = data_left;
+
+	res = stream_get(buffer, bytes);
+	data_left -= res;
+
+	return res < bytes ? -1 : res;
+}
+
+
+/* read size bytes of the entry's data as a string */
+static char *stream_string(long long size)
+{
+	char *string;
+
+	if(size > 65536)
+		BAD_ERROR("Oversized name or header in input stream\n");
+
+	string = malloc(size + 1);
+	if(string == NULL)
+		BAD_ERROR("Out of memory in stream_string\n");
+
+	if(stream_get(string, size) != size)
+		BAD_ERROR("Unexpected end of input stream\n");
+	string[size] = '\0';
+	data_left = 0;
+
+	return string;
+}
+
+
+static struct stream_entry *new_entry(char *pathname)
+{
+	struct stream_entry *entry = malloc(sizeof(struct stream_entry));
+
+	if(entry == NULL)
+		BAD_ERROR("Out of memory in new_entry\n");
+
+	memset(entry, 0, sizeof(struct stream_entry));
+	entry->pathname = pathname;
+
+	return entry;
+}
+
+
+void stream_free(struct stream_entry *entry)
+{
+	free(entry->pathname);
+	free(entry->linkname);
+	free(entry);
+}
+
+
+static void queue_entry(struct stream_entry *entry)
+{
+	entry->next = NULL;
+	*queued_tail = entry;
+	queued_tail = &entry->next;
+}
+
+
+/*
+ * Make the pathname relative to the root, dropping leading "/" and "./",
+ * repeated and trailing slashes.  Pathnames with ".." components, which
+ * would escape the root or refer back into it, are refused
+ */
+static int clean_pathname(char *pathname)
+{
+	char *s = pathname, *d = pathname, *component;
+
+	while(*s) {
+		while(*s == '/')
+			s ++;
+		if(*s == '\0')
+			break;
+
+		component = s;
+		while(*s && *s != '/')
+			s ++;
+
+		if(s - component == 1 && component[0] == '.')
+			continue;
+		if(s - component == 2 && component[0] == '.' &&
+				component[1] == '.')
+			return FALSE;
+
+		if(d != pathname)
+			*d++ = '/';
+		memmove(d, component, s - component);
+		d += s - component;
+	}
+	*d = '\0';
+
+	return TRUE;
+}
+
+
+/*
+ * Tar numbers are octal, or for values too big for the field (GNU and
+ * star) base-256 with the top bit of the first byte set
+ */
+static long long tar_number(char *field, int size)
+{
+	long long value = 0;
+	int i = 0;
+
+	if(field[0] & 0x80) {
+		value = field[0] & 0x3f;
+		for(i = 1; i < size; i++)
+			value = (value << 8) | (unsigned char) field[i];
+		return value;
+	}
+
+	while(i < size && (field[i] == ' ' || field[i] == '\0'))
+		i ++;
+	for(; i < size && field[i] >= '0' && field[i] <= '7'; i++)
+		value = (value << 3) | (field[i] - '0');
+
+	return value;
+}
+
+
+/* the header checksum, summed both unsigned (POSIX) and signed (old tars) */
+static int tar_checksum(char *block)
+{
+	int i, usum = 0, ssum = 0;
+	long long checksum = tar_number(block + 148, 8);
+
+	for(i = 0; i < 512; i++) {
+		char c = i >= 148 && i < 156 ? ' ' : block[i];
+
+		usum += (unsigned char) c;
+		ssum += (signed char) c;
+	}
+
+	return checksum == usum || checksum == ssum;
+}
+
+
+static char *tar_field(char *field, int size)
+{
+	char *string = malloc(size + 1);
+
+	if(string == NULL)
+		BAD_ERROR("Out of memory in tar_field\n");
+
+	memcpy(string, field, size);
+	string[size] = '\0';
+
+	return string;
+}
+
+
+struct pax {
+	char		*path;
+	char		*linkpath;
+	long long	size;
+	long long	uid;
+	long long	gid;
+	long long	mtime;
+	int		has_size;
+	int		has_uid;
+	int		has_gid;
+	int		has_mtime;
+};
+
+
+/*
+ * pax extended header records are "<length> <keyword>=<value>\n".  Only
+ * the keywords which override header fields mksquashfs stores are used
+ */
+static void tar_pax(char *header, long long size, struct pax *pax)
+{
+	char *p = header, *end = header + size;
+
+	while(p < end) {
+		char *key, *value, *next;
+		long long length = strtoll(p, &key, 10);
+
+		if(length <= 0 || *key != ' ' || length > end - p)
+			break;
+		next = p + length;
+		next[-1] = '\0';
+		key ++;
+		value = strchr(key, '=');
+		if(value == NULL) {
+			p = next;
+			continue;
+		}
+		*value++ = '\0';
+
+		if(strcmp(key, "path") == 0) {
+			free(pax->path);
+			pax->path = strdup(value);
+		} else if(strcmp(key, "linkpath") == 0) {
+			free(pax->linkpath);
+			pax->linkpath = strdup(value);
+		} else if(strcmp(key, "size") == 0) {
+			pax->size = strtoll(value, NULL, 10);
+			pax->has_size = TRUE;
+		} else if(strcmp(key, "uid") == 0) {
+			pax->uid = strtoll(value, NULL, 10);
+			pax->has_uid = TRUE;
+		} else if(strcmp(key, "gid") == 0) {
+			pax->gid = strtoll(value, NULL, 10);
+			pax->has_gid = TRUE;
+		} else if(strcmp(key, "mtime") == 0) {
+			pax->mtime = strtoll(value, NULL, 10);
+			pax->has_mtime = TRUE;
+		}
+
+		p = next;
+	}
+}
+
+
+static struct stream_entry *tar_next()
+{
+	char block[512], type, *name;
+	char *longname = NULL, *longlink = NULL;
+	struct pax pax;
+	struct stream_entry *entry;
+	long long size;
+	int res;
+
+	memset(&pax, 0, sizeof(pax));
+
+	while(1) {
+		res = stream_get(block, 512);
+		if(res == 0)
+			/* no end of archive blocks, but at a header boundary */
+			goto end;
+		if(res != 512)
+			BAD_ERROR("Unexpected end of tar stream\n");
+
+		for(res = 0; res < 512 && block[res] == '\0'; res++);
+		if(res == 512)
+			goto end;
+
+		if(!tar_checksum(block))
+			BAD_ERROR("Bad header checksum in tar stream\n");
+
+		type = block[156];
+		size = pax.has_size && type != 'x' && type != 'L' &&
+			type != 'K' ? pax.size : tar_number(block + 124, 12);
+		data_left = size;
+		data_pad = (512 - (size & 511)) & 511;
+
+		switch(type) {
+		case 'L':
+			free(longname);
+			longname = stream_string(size);
+			break;
+		case 'K':
+			free(longlink);
+			longlink = stream_string(size);
+			break;
+		case 'x': {
+			char *header = stream_string(size);
+
+			tar_pax(header, size, &pax);
+			free(header);
+			break;
+		}
+		case 'g':
+		case 'V':
+			/* global pax header, volume label */
+			break;
+		default:
+			goto entry;
+		}
+
+		stream_skip(data_left + data_pad);
+		data_left = data_pad = 0;
+	}
+
+entry:
+	if(longname)
+		name = longname;
+	else if(pax.path)
+		name = strdup(pax.path);
+	else if(memcmp(block + 257, "ustar", 5) == 0 && block[345]) {
+		char *prefix = tar_field(block + 345, 155);
+		char *base = tar_field(block, 100);
+
+		name = malloc(strlen(prefix) + strlen(base) + 2);
+		if(name == NULL)
+			BAD_ERROR("Out of memory in tar_next\n");
+		sprintf(name, "%s/%s", prefix, base);
+		free(prefix);
+		free(base);
+	} else
+		name = tar_field(block, 100);
+
+	if(name == NULL)
+		BAD_ERROR("Out of memory in tar_next\n");
+
+	entry = new_entry(name);
+	if(longlink)
+		entry->linkname = longlink;
+	else if(pax.linkpath)
+		entry->linkname = strdup(pax.linkpath);
+	else
+		entry->linkname = tar_field(block + 157, 100);
+	free(pax.path);
+	free(pax.linkpath);
+
+	entry->buf.st_mode = tar_number(block + 100, 8) & 07777;
+	entry->buf.st_uid = pax.has_uid ? pax.uid : tar_number(block + 108, 8);
+	entry->buf.st_gid = pax.has_gid ? pax.gid : tar_number(block + 116, 8);
+	entry->buf.st_mtime = pax.has_mtime ? pax.mtime :
+		tar_number(block + 136, 12);
+
+	switch(type) {
+	case '0':
+	case '\0':
+	case '7':
+		/* old tars mark directories with a trailing slash */
+		if(name[0] && name[strlen(name) - 1] == '/')
+			entry->buf.st_mode |= S_IFDIR;
+		else {
+			entry->buf.st_mode |= S_IFREG;
+			entry->buf.st_size = size;
+		}
+		break;
+	case '1':
+		entry->hardlink = TRUE;
+		break;
+	case '2':
+		entry->buf.st_mode |= S_IFLNK;
+		break;
+	case '3':
+	case '4':
+		entry->buf.st_mode |= type == '3' ? S_IFCHR : S_IFBLK;
+		entry->buf.st_rdev = makedev(tar_number(block + 329, 8),
+			tar_number(block + 337, 8));
+		break;
+	case '5':
+		entry->buf.st_mode |= S_IFDIR;
+		break;
+	case '6':
+		entry->buf.st_mode |= S_IFIFO;
+		break;
+	default:
+		ERROR("Unsupported type %c of %s in tar stream, skipping\n",
+			type, name);
+		stream_free(entry);
+		stream_skip(data_left + data_pad);
+		data_left = data_pad = 0;
+		return tar_next();
+	}
+
+	/* only regular files have data to read */
+	if(!S_ISREG(entry->buf.st_mode) || entry->hardlink) {
+		stream_skip(data_left + data_pad);
+		data_left = data_pad = 0;
+	}
+
+	return entry;
+
+end:
+	free(longname);
+	free(longlink);
+	free(pax.path);
+	free(pax.linkpath);
+	data_left = data_pad = 0;
+	return NULL;
+}
+
+
+static unsigned long long cpio_number(char *field, int size, int base)
+{
+	char number[12];
+
+	memcpy(number, field, size);
+	number[size] = '\0';
+
+	return strtoull(number, NULL, base);
+}
+
+
+static struct cpio_link *cpio_lookup(unsigned long long dev,
+	unsigned long long ino)
+{
+	int hash = (ino ^ dev) & (STREAM_LINK_HASH - 1);
+	struct cpio_link *link;
+
+	for(link = cpio_link[hash]; link; link = link->next)
+		if(link->dev == dev && link->ino == ino)
+			return link;
+
+	link = malloc(sizeof(struct cpio_link));
+	if(link == NULL)
+		BAD_ERROR("Out of memory in cpio_lookup\n");
+
+	link->dev = dev;
+	link->ino = ino;
+	link->pathname = NULL;
+	link->pending = NULL;
+	link->next = cpio_link[hash];
+	cpio_link[hash] = link;
+
+	return link;
+}
+
+
+/* queue the held back links of link as hard links to its pathname */
+static void cpio_link_pending(struct cpio_link *link)
+{
+	while(link->pending) {
+		struct stream_entry *entry = link->pending;
+
+		link->pending = entry->next;
+		entry->hardlink = TRUE;
+		entry->linkname = strdup(link->pathname);
+		if(entry->linkname == NULL)
+			BAD_ERROR("Out of memory in cpio_link_pending\n");
+		queue_entry(entry);
+	}
+}
+
+
+/*
+ * At the trailer, links whose data never came were all empty, the first
+ * becomes the file and the others links to it
+ */
+static void cpio_link_trailer()
+{
+	int i;
+
+	for(i = 0; i < STREAM_LINK_HASH; i++) {
+		struct cpio_link *link;
+
+		for(link = cpio_link[i]; link; link = link->next) {
+			struct stream_entry *entry = link->pending;
+
+			if(entry == NULL)
+				continue;
+
+			link->pending = entry->next;
+			link->pathname = strdup(entry->pathname);
+			if(link->pathname == NULL)
+				BAD_ERROR("Out of memory in cpio_link_trailer"
+					"\n");
+			queue_entry(entry);
+			cpio_link_pending(link);
+		}
+	}
+}
+
+
+static struct stream_entry *cpio_next()
+{
+	char header[110], *name;
+	struct stream_entry *entry;
+	unsigned long long dev, ino, nlink, namesize, size;
+	int odc, res;
+
+	while(1) {
+		res = stream_get(header, 6);
+		if(res == 0)
+			BAD_ERROR("No trailer at end of cpio stream\n");
+		if(res != 6)
+			BAD_ERROR("Unexpected end of cpio stream\n");
+
+		odc = memcmp(header, "070707", 6) == 0;
+		if(!odc && memcmp(header, "070701", 6) != 0 &&
+				memcmp(header, "070702", 6) != 0)
+			BAD_ERROR("Bad header magic in cpio stream\n");
+
+		res = odc ? 70 : 104;
+		if(stream_get(header + 6, res) != res)
+			BAD_ERROR("Unexpected end of cpio stream\n");
+
+		if(odc) {
+			unsigned int rdev = cpio_number(header + 42, 6, 8);
+
+			dev = cpio_number(header + 6, 6, 8);
+			ino = cpio_number(header + 12, 6, 8);
+			nlink = cpio_number(header + 36, 6, 8);
+			namesize = cpio_number(header + 59, 6, 8);
+			size = cpio_number(header + 65, 11, 8);
+			entry = new_entry(NULL);
+			entry->buf.st_mode = cpio_number(header + 18, 6, 8);
+			entry->buf.st_uid = cpio_number(header + 24, 6, 8);
+			entry->buf.st_gid = cpio_number(header + 30, 6, 8);
+			entry->buf.st_mtime = cpio_number(header + 48, 11, 8);
+			entry->buf.st_rdev = makedev(rdev >> 8, rdev & 0xff);
+		} else {
+			ino = cpio_number(header + 6, 8, 16);
+			nlink = cpio_number(header + 38, 8, 16);
+			size = cpio_number(header + 54, 8, 16);
+			dev = cpio_number(header + 62, 8, 16) << 32 |
+				cpio_number(header + 70, 8, 16);
+			namesize = cpio_number(header + 94, 8, 16);
+			entry = new_entry(NULL);
+			entry->buf.st_mode = cpio_number(header + 14, 8, 16);
+			entry->buf.st_uid = cpio_number(header + 22, 8, 16);
+			entry->buf.st_gid = cpio_number(header + 30, 8, 16);
+			entry->buf.st_mtime = cpio_number(header + 46, 8, 16);
+			entry->buf.st_rdev = makedev(cpio_number(header + 78, 8,
+				16), cpio_number(header + 86, 8, 16));
+		}
+
+		if(namesize == 0)
+			BAD_ERROR("Bad name size in cpio stream\n");
+		name = entry->pathname = stream_string(namesize);
+		name[namesize - 1] = '\0';
+		if(!odc)
+			stream_skip((4 - ((110 + namesize) & 3)) & 3);
+		data_left = size;
+		data_pad = odc ? 0 : (4 - (size & 3)) & 3;
+
+		if(strcmp(name, "TRAILER!!!") == 0) {
+			stream_free(entry);
+			stream_skip(data_left + data_pad);
+			data_left = data_pad = 0;
+			cpio_link_trailer();
+			stream_ended = TRUE;
+			return NULL;
+		}
+
+		if(S_ISLNK(entry->buf.st_mode)) {
+			entry->linkname = stream_string(size);
+			stream_skip(data_pad);
+			data_pad = 0;
+		} else if(S_ISREG(entry->buf.st_mode)) {
+			entry->buf.st_size = size;
+
+			if(nlink > 1) {
+				struct cpio_link *link = cpio_lookup(dev, ino);
+
+				if(link->pathname) {
+					entry->hardlink = TRUE;
+					entry->linkname =
+						strdup(link->pathname);
+					if(entry->linkname == NULL)
+						BAD_ERROR("Out of memory in "
+							"cpio_next\n");
+				} else if(size == 0) {
+					/* newc, wait for the link with data */
+					entry->next = link->pending;
+					link->pending = entry;
+					continue;
+				} else {
+					link->pathname = strdup(name);
+					if(link->pathname == NULL)
+						BAD_ERROR("Out of memory in "
+							"cpio_next\n");
+					cpio_link_pending(link);
+				}
+			}
+		}
+
+		if(!S_ISREG(entry->buf.st_mode) || entry->hardlink) {
+			stream_skip(data_left + data_pad);
+			data_left = data_pad = 0;
+		}
+
+		return entry;
+	}
+}
+
+
+/*
+ * Returns the next entry in the stream, NULL at its end.  What's left of
+ * the previous entry's data is skipped
+ */
+struct stream_entry *stream_next()
+{
+	struct stream_entry *entry;
+
+	while(1) {
+		stream_skip(data_left + data_pad);
+		data_left = data_pad = 0;
+
+		if(queued) {
+			entry = queued;
+			queued = entry->next;
+			if(queued == NULL)
+				queued_tail = &queued;
+			entry->next = NULL;
+		} else if(stream_ended)
+			return NULL;
+		else if(stream_format == STREAM_TAR) {
+			entry = tar_next();
+			if(entry == NULL)
+				return NULL;
+		} else {
+			entry = cpio_next();
+			if(entry == NULL)
+				continue;
+		}
+
+		if(clean_pathname(entry->pathname) == FALSE ||
+				(entry->hardlink &&
+				clean_pathname(entry->linkname) == FALSE)) {
+			ERROR("Pathname with \"..\" in input stream, skipping "
+				"%s\n", entry->pathname);
+			stream_free(entry);
+			continue;
+		}
+
+		TRACE("stream_next: %s, mode %o, size %lld\n", entry->pathname,
+			entry->buf.st_mode, (long long) entry->buf.st_size);
+		return entry;
+	}
+}
+
+
+/*
+ * Start reading the stream on fd, the format is recognised from the first
+ * header.  Returns the format, or FALSE if it isn't tar or cpio
+ */
+int stream_open(int fd)
+{
+	stream_fd = fd;
+	stream_buffer = malloc(STREAM_BUFFER_SIZE);
+	if(stream_buffer == NULL)
+		BAD_ERROR("Out of memory in stream_open\n");
+
+	if(stream_fill(6) >= 6 && (memcmp(stream_buffer, "070701", 6) == 0 ||
+			memcmp(stream_buffer, "070702", 6) == 0 ||
+			memcmp(stream_buffer, "070707", 6) == 0))
+		stream_format = STREAM_CPIO;
+	else if(stream_fill(512) >= 512 && tar_checksum(stream_buffer))
+		stream_format = STREAM_TAR;
+	else
+		stream_format = FALSE;
+
+	return stream_format;
+}
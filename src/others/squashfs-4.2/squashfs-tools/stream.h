@@ -0,0 +1,56 @@
+#ifndef STREAM_H
+#define STREAM_H
+/*
+ * Create a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * stream.h
+ */
+
+#define STREAM_TAR		1
+#define STREAM_CPIO		2
+
+#define STREAM_BUFFER_SIZE	(1024 * 1024)
+#define STREAM_LINK_HASH	1024
+
+/* entries read ahead of the main thread */
+#define STREAM_QUEUE_SIZE	64
+
+struct inode_info;
+
+/*
+ * An entry read from the tar or cpio stream.  pathname is relative to the
+ * root of the filesystem ("" for the root itself), linkname is the target
+ * of a symlink, or of a hard link in which case hardlink is set.  The
+ * data of a regular file follows, and is read with stream_read()
+ */
+struct stream_entry {
+	char			*pathname;
+	char			*linkname;
+	int			hardlink;
+	struct stat		buf;
+	struct inode_info	*inode;
+	struct stream_entry	*next;
+};
+
+extern int stream_open(int);
+extern struct stream_entry *stream_next();
+extern int stream_read(void *, int);
+extern void stream_free(struct stream_entry *);
+#endif
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * traindict.c
+ *
+ * Train a zlib preset dictionary for filesystems of small blocks, for
+ * mksquashfs -Xdict and mkcramfs -D.  The sources are cut into blocks,
+ * and the dictionary is built from the segments whose substrings are
+ * found in the most blocks, as each block is compressed on its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "squashfs_fs.h"
+#include "gzip_wrapper.h"
+
+#define ERROR(s, args...)	fprintf(stderr, s, ## args)
+
+#define BAD_ERROR(s, args...) \
+		do {\
+			fprintf(stderr, "FATAL ERROR:" s, ## args);\
+			exit(1);\
+		} while(0)
+
+#define TRUE		1
+#define FALSE		0
+
+#define DEFAULT_BLOCK_SIZE	4096
+#define DEFAULT_MBYTES		64
+
+/*
+ * Substrings are scored by their first DMER bytes, and the dictionary
+ * is made of SEGMENT byte pieces of the sources
+ */
+#define DMER		8
+#define SEGMENT		64
+#define HASH_BITS	22
+#define HASH_SIZE	(1 << HASH_BITS)
+
+struct block {
+	unsigned char *data;
+	int size;
+};
+
+struct block *block = NULL;
+int blocks = 0, block_size = DEFAULT_BLOCK_SIZE;
+long long source_bytes = 0, source_max;
+
+/* how many blocks each substring is found in, 0 once it's in the dictionary */
+unsigned int *freq;
+unsigned int *last_block;
+unsigned short *active;
+
+
+void add_block(unsigned char *data, int size)
+{
+	if((blocks & 1023) == 0) {
+		block = realloc(block, (blocks + 1024) * sizeof(struct block));
+		if(block == NULL)
+			BAD_ERROR("Out of memory in add_block\n");
+	}
+
+	block[blocks].data = data;
+	block[blocks++].size = size;
+}
+
+
+void read_source(char *pathname)
+{
+	struct stat buf;
+	struct dirent *d;
+	DIR *dir;
+
+	if(source_bytes == source_max || lstat(pathname, &buf) == -1)
+		return;
+
+	if(S_ISREG(buf.st_mode) && buf.st_size) {
+		unsigned char *data;
+		int fd, offset, bytes = 0, size = buf.st_size > source_max -
+			source_bytes ? source_max - source_bytes : buf.st_size;
+
+		fd = open(pathname, O_RDONLY);
+		if(fd == -1) {
+			ERROR("traindict: can't open %s because %s\n", pathname,
+				strerror(errno));
+			return;
+		}
+
+		data = malloc(size);
+		if(data == NULL)
+			BAD_ERROR("Out of memory in read_source\n");
+
+		while(bytes < size) {
+			int res = read(fd, data + bytes, size - bytes);
+
+			if(res == -1 && errno == EINTR)
+				continue;
+			if(res < 1)
+				break;
+			bytes += res;
+		}
+		close(fd);
+
+		if(bytes == 0) {
+			free(data);
+			return;
+		}
+
+		/* files are cut into blocks as mksquashfs and mkcramfs do */
+		for(offset = 0; offset < bytes; offset += block_size)
+			add_block(data + offset, bytes - offset > block_size ?
+				block_size : bytes - offset);
+		source_bytes += bytes;
+		return;
+	}
+
+	if(!S_ISDIR(buf.st_mode) || (dir = opendir(pathname)) == NULL)
+		return;
+
+	while((d = readdir(dir)) != NULL) {
+		char *subpath;
+
+		if(strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+			continue;
+
+		subpath = malloc(strlen(pathname) + strlen(d->d_name) + 2);
+		if(subpath == NULL)
+			BAD_ERROR("Out of memory in read_source\n");
+		sprintf(subpath, "%s/%s", pathname, d->d_name);
+		read_source(subpath);
+		free(subpath);
+	}
+
+	closedir(dir);
+}
+
+
+static inline unsigned int hash(unsigned char *p)
+{
+	unsigned long long v = 0;
+	int i;
+
+	for(i = 0; i < DMER; i++)
+		v = (v << 8) | p[i];
+
+	return (v * 0x9e3779b97f4a7c15ULL) >> (64 - HASH_BITS);
+}
+
+
+/* a substring found in only one block doesn't help any other block */
+static inline unsigned int weight(unsigned int h)
+{
+	return freq[h] > 1 ? freq[h] - 1 : 0;
+}
+
+
+void count_substrings()
+{
+	int i, j;
+
+	for(i = 0; i < blocks; i++)
+		for(j = 0; j + DMER <= block[i].size; j++) {
+			unsigned int h = hash(block[i].data + j);
+
+			if(last_block[h] != i + 1) {
+				last_block[h] = i + 1;
+				freq[h]++;
+			}
+		}
+}
+
+
+/*
+ * Find the segment of blocks first to last - 1 whose distinct substrings
+ * have the highest total weight, sliding a window over each block.
+ * Returns the weight, and the segment in *best
+ */
+long long best_segment(int first, int last, unsigned char **best)
+{
+	long long score, best_score = 0;
+	int i, j, count = SEGMENT - DMER + 1;
+
+	for(i = first; i < last; i++) {
+		unsigned char *data = block[i].data;
+		int positions = block[i].size - DMER + 1;
+
+		if(block[i].size < SEGMENT)
+			continue;
+
+		score = 0;
+		for(j = 0; j < positions; j++) {
+			unsigned int h = hash(data + j);
+
+			if(active[h]++ == 0)
+				score += weight(h);
+
+			if(j >= count) {
+				h = hash(data + j - count);
+				if(--active[h] == 0)
+					score -= weight(h);
+			}
+
+			if(j >= count - 1 && score > best_score) {
+				best_score = score;
+				*best = data + j - count + 1;
+			}
+		}
+
+		for(j = positions > count ? positions - count : 0; j < positions;
+				j++)
+			active[hash(data + j)]--;
+	}
+
+	return best_score;
+}
+
+
+/*
+ * Cut the blocks into one epoch per dictionary segment, and take the
+ * best segment of each epoch, again until the dictionary is full.  The
+ * first segments taken go at the end of the dictionary, where they are
+ * the shortest distance from the data
+ */
+int train(unsigned char *dict, int dict_size)
+{
+	int epochs = dict_size / SEGMENT, pos = dict_size;
+	int epoch, found = TRUE;
+
+	if(epochs > blocks)
+		epochs = blocks;
+
+	while(found && pos >= SEGMENT) {
+		found = FALSE;
+
+		for(epoch = 0; epoch < epochs && pos >= SEGMENT; epoch++) {
+			unsigned char *seg;
+			int j;
+
+			if(best_segment((long long) blocks * epoch / epochs,
+					(long long) blocks * (epoch + 1) / epochs,
+					&seg) == 0)
+				continue;
+
+			pos -= SEGMENT;
+			memcpy(dict + pos, seg, SEGMENT);
+			for(j = 0; j + DMER <= SEGMENT; j++)
+				freq[hash(seg + j)] = 0;
+			found = TRUE;
+		}
+	}
+
+	return pos;
+}
+
+
+/* compressed size of the blocks, at most samples of them, at level 9 */
+long long compressed_bytes(unsigned char *dict, int dict_size, int samples)
+{
+	unsigned char *buffer = malloc(block_size * 2);
+	long long bytes = 0;
+	int i, step = blocks > samples ? blocks / samples : 1;
+	z_stream stream;
+
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = 0;
+
+	if(buffer == NULL || deflateInit(&stream, 9) != Z_OK)
+		BAD_ERROR("Out of memory in compressed_bytes\n");
+
+	for(i = 0; i < blocks; i += step) {
+		deflateReset(&stream);
+		if(dict)
+			deflateSetDictionary(&stream, dict, dict_size);
+		stream.next_in = block[i].data;
+		stream.avail_in = block[i].size;
+		stream.next_out = buffer;
+		stream.avail_out = block_size * 2;
+		if(deflate(&stream, Z_FINISH) != Z_STREAM_END)
+			BAD_ERROR("compressed_bytes: deflate failed\n");
+		bytes += stream.total_out < block[i].size ? stream.total_out :
+			block[i].size;
+	}
+
+	deflateEnd(&stream);
+	free(buffer);
+	return bytes;
+}
+
+
+void usage(char *name)
+{
+	ERROR("SYNTAX: %s source1 source2 ... dictionary [options]\n\n", name);
+	ERROR("Trains a zlib preset dictionary on the files under the "
+		"sources, for\nmksquashfs -Xdict and mkcramfs -D.\n\n");
+	ERROR("Options are\n");
+	ERROR("-b <block_size>\t\tblock size of the filesystem.  Default %d "
+		"bytes\n", DEFAULT_BLOCK_SIZE);
+	ERROR("-size <bytes>\t\tdictionary size, at most %d.  Default %d\n",
+		GZIP_DICT_MAX, GZIP_DICT_MAX);
+	ERROR("-max <Mbytes>\t\tread at most <Mbytes> of the sources.  Default "
+		"%d\n", DEFAULT_MBYTES);
+	exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int i, dest, fd, pos, dict_size = GZIP_DICT_MAX, mbytes = DEFAULT_MBYTES;
+	unsigned char dict[GZIP_DICT_MAX];
+	long long before, after;
+
+	for(dest = 1; dest < argc && argv[dest][0] != '-'; dest++);
+	dest--;
+	if(dest < 2)
+		usage(argv[0]);
+
+	for(i = dest + 1; i < argc; i++) {
+		if(strcmp(argv[i], "-b") == 0) {
+			char *b;
+
+			if(++i == argc)
+				usage(argv[0]);
+			block_size = strtol(argv[i], &b, 10);
+			if(*b == 'k' || *b == 'K')
+				block_size *= 1024, b++;
+			if(*b != '\0' || block_size < 1024 ||
+					block_size > SQUASHFS_FILE_MAX_SIZE) {
+				ERROR("%s: -b block size must be 1K to 1M\n",
+					argv[0]);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-size") == 0) {
+			if(++i == argc)
+				usage(argv[0]);
+			dict_size = atoi(argv[i]);
+			if(dict_size < SEGMENT || dict_size > GZIP_DICT_MAX) {
+				ERROR("%s: -size must be %d to %d bytes\n",
+					argv[0], SEGMENT, GZIP_DICT_MAX);
+				exit(1);
+			}
+		} else if(strcmp(argv[i], "-max") == 0) {
+			if(++i == argc)
+				usage(argv[0]);
+			mbytes = atoi(argv[i]);
+			if(mbytes < 1) {
+				ERROR("%s: -max should be 1 Mbyte or more\n",
+					argv[0]);
+				exit(1);
+			}
+		} else
+			usage(argv[0]);
+	}
+
+	source_max = (long long) mbytes << 20;
+	for(i = 1; i < dest; i++)
+		read_source(argv[i]);
+
+	if(blocks == 0)
+		BAD_ERROR("No data under the sources\n");
+
+	freq = calloc(HASH_SIZE, sizeof(unsigned int));
+	last_block = calloc(HASH_SIZE, sizeof(unsigned int));
+	active = calloc(HASH_SIZE, sizeof(unsigned short));
+	if(freq == NULL || last_block == NULL || active == NULL)
+		BAD_ERROR("Out of memory in main\n");
+
+	count_substrings();
+	pos = train(dict, dict_size);
+	if(pos == dict_size)
+		BAD_ERROR("No substrings are shared between blocks, a "
+			"dictionary won't help\n");
+
+	fd = open(argv[dest], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd == -1)
+		BAD_ERROR("Can't create %s because %s\n", argv[dest],
+			strerror(errno));
+	if(write(fd, dict + pos, dict_size - pos) != dict_size - pos ||
+			close(fd) == -1)
+		BAD_ERROR("Failed to write %s\n", argv[dest]);
+
+	before = compressed_bytes(NULL, 0, 4096);
+	after = compressed_bytes(dict + pos, dict_size - pos, 4096);
+
+	printf("%d byte dictionary with id 0x%08lx from %d blocks of %d "
+		"bytes\n", dict_size - pos, adler32(adler32(0L, Z_NULL, 0),
+		dict + pos, dict_size - pos), blocks, block_size);
+	printf("Sampled blocks compress to %lld bytes, %lld without it "
+		"(%.2f%%)\n", after, before, before ? (after - before) * 100.0 /
+		before : 0);
+
+	return 0;
+}
@@ -57,7 +57,7 @@ struct inode *read_inode_1(unsigned int start_block, unsigned int offset)
 {
 	static union squashfs_inode_header_1 header;
 	long long start = sBlk.s.inode_table_start + start_block;
-	int bytes = lookup_entry(inode_table_hash, start);
+	int bytes = lookup_entry(&inode_table_hash, start);
 	char *block_ptr = inode_table + bytes + offset;
 	static struct inode i;
 
@@ -218,7 +218,7 @@ struct dir *squashfs_opendir_1(unsigned int block_start, unsigned int offset,
 
 	*i = s_ops.read_inode(block_start, offset);
 	start = sBlk.s.directory_table_start + (*i)->start;
-	bytes = lookup_entry(directory_table_hash, start);
+	bytes = lookup_entry(&directory_table_hash, start);
 	if(bytes == -1)
 		EXIT_UNSQUASH("squashfs_opendir: directory block %d not "
 			"found!\n", block_start);
@@ -32,9 +32,7 @@ void read_block_list_2(unsigned int *block_list, char *block_ptr, int blocks)
 	TRACE("read_block_list: blocks %d\n", blocks);
 
 	if(swap) {
-		unsigned int sblock_list[blocks];
-		memcpy(sblock_list, block_ptr, blocks * sizeof(unsigned int));
-		SQUASHFS_SWAP_INTS_3(block_list, sblock_list, blocks);
+		SQUASHFS_SWAP_INTS_3(block_list, block_ptr, blocks);
 	} else
 		memcpy(block_list, block_ptr, blocks * sizeof(unsigned int));
 }
@@ -123,7 +121,7 @@ struct inode *read_inode_2(unsigned int start_block, unsigned int offset)
 {
 	static union squashfs_inode_header_2 header;
 	long long start = sBlk.s.inode_table_start + start_block;
-	int bytes = lookup_entry(inode_table_hash, start);
+	int bytes = lookup_entry(&inode_table_hash, start);
 	char *block_ptr = inode_table + bytes + offset;
 	static struct inode i;
 
@@ -82,25 +82,26 @@ int read_fragment_table_3()
 		}
 	}
 
-	if(swap) {
-		squashfs_fragment_entry_3 sfragment;
-		for(i = 0; i < sBlk.s.fragments; i++) {
-			SQUASHFS_SWAP_FRAGMENT_ENTRY_3((&sfragment),
-				(&fragment_table[i]));
-			memcpy((char *) &fragment_table[i], (char *) &sfragment,
-				sizeof(squashfs_fragment_entry_3));
-		}
-	}
-
 	return TRUE;
 }
 
 
+/*
+ * The fragment table is kept as it is on disk, and an entry of a
+ * byte-swapped filesystem is decoded when it's looked up
+ */
 void read_fragment_3(unsigned int fragment, long long *start_block, int *size)
 {
+	squashfs_fragment_entry_3 sfragment, *fragment_entry =
+		&fragment_table[fragment];
+
 	TRACE("read_fragment: reading fragment %d\n", fragment);
 
-	squashfs_fragment_entry_3 *fragment_entry = &fragment_table[fragment];
+	if(swap) {
+		SQUASHFS_SWAP_FRAGMENT_ENTRY_3(&sfragment, fragment_entry);
+		fragment_entry = &sfragment;
+	}
+
 	*start_block = fragment_entry->start_block;
 	*size = fragment_entry->size;
 }
@@ -110,7 +111,7 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 {
 	static union squashfs_inode_header_3 header;
 	long long start = sBlk.s.inode_table_start + start_block;
-	int bytes = lookup_entry(inode_table_hash, start);
+	int bytes = lookup_entry(&inode_table_hash, start);
 	char *block_ptr = inode_table + bytes + offset;
 	static struct inode i;
 
@@ -121,9 +122,7 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			start); 
 
 	if(swap) {
-		squashfs_base_inode_header_3 sinode;
-		memcpy(&sinode, block_ptr, sizeof(header.base));
-		SQUASHFS_SWAP_BASE_INODE_HEADER_3(&header.base, &sinode,
+		SQUASHFS_SWAP_BASE_INODE_HEADER_3(&header.base, block_ptr,
 			sizeof(squashfs_base_inode_header_3));
 	} else
 		memcpy(&header.base, block_ptr, sizeof(header.base));
@@ -142,10 +141,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			squashfs_dir_inode_header_3 *inode = &header.dir;
 
 			if(swap) {
-				squashfs_dir_inode_header_3 sinode;
-				memcpy(&sinode, block_ptr, sizeof(header.dir));
 				SQUASHFS_SWAP_DIR_INODE_HEADER_3(&header.dir,
-					&sinode);
+					block_ptr);
 			} else
 				memcpy(&header.dir, block_ptr,
 					sizeof(header.dir));
@@ -159,10 +156,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			squashfs_ldir_inode_header_3 *inode = &header.ldir;
 
 			if(swap) {
-				squashfs_ldir_inode_header_3 sinode;
-				memcpy(&sinode, block_ptr, sizeof(header.ldir));
 				SQUASHFS_SWAP_LDIR_INODE_HEADER_3(&header.ldir,
-					&sinode);
+					block_ptr);
 			} else
 				memcpy(&header.ldir, block_ptr,
 					sizeof(header.ldir));
@@ -176,10 +171,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			squashfs_reg_inode_header_3 *inode = &header.reg;
 
 			if(swap) {
-				squashfs_reg_inode_header_3 sinode;
-				memcpy(&sinode, block_ptr, sizeof(sinode));
 				SQUASHFS_SWAP_REG_INODE_HEADER_3(inode,
-					&sinode);
+					block_ptr);
 			} else
 				memcpy(inode, block_ptr, sizeof(*inode));
 
@@ -201,10 +194,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			squashfs_lreg_inode_header_3 *inode = &header.lreg;
 
 			if(swap) {
-				squashfs_lreg_inode_header_3 sinode;
-				memcpy(&sinode, block_ptr, sizeof(sinode));
 				SQUASHFS_SWAP_LREG_INODE_HEADER_3(inode,
-					&sinode);
+					block_ptr);
 			} else
 				memcpy(inode, block_ptr, sizeof(*inode));
 
@@ -227,10 +218,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 				&header.symlink;
 
 			if(swap) {
-				squashfs_symlink_inode_header_3 sinodep;
-				memcpy(&sinodep, block_ptr, sizeof(sinodep));
 				SQUASHFS_SWAP_SYMLINK_INODE_HEADER_3(inodep,
-					&sinodep);
+					block_ptr);
 			} else
 				memcpy(inodep, block_ptr, sizeof(*inodep));
 
@@ -250,10 +239,8 @@ struct inode *read_inode_3(unsigned int start_block, unsigned int offset)
 			squashfs_dev_inode_header_3 *inodep = &header.dev;
 
 			if(swap) {
-				squashfs_dev_inode_header_3 sinodep;
-				memcpy(&sinodep, block_ptr, sizeof(sinodep));
 				SQUASHFS_SWAP_DEV_INODE_HEADER_3(inodep,
-					&sinodep);
+					block_ptr);
 			} else
 				memcpy(inodep, block_ptr, sizeof(*inodep));
 
@@ -290,7 +277,7 @@ struct dir *squashfs_opendir_3(unsigned int block_start, unsigned int offset,
 
 	*i = s_ops.read_inode(block_start, offset);
 	start = sBlk.s.directory_table_start + (*i)->start;
-	bytes = lookup_entry(directory_table_hash, start);
+	bytes = lookup_entry(&directory_table_hash, start);
 
 	if(bytes == -1)
 		EXIT_UNSQUASH("squashfs_opendir: directory block %d not "
@@ -314,9 +301,8 @@ struct dir *squashfs_opendir_3(unsigned int block_start, unsigned int offset,
 
 	while(bytes < size) {			
 		if(swap) {
-			squashfs_dir_header_3 sdirh;
-			memcpy(&sdirh, directory_table + bytes, sizeof(sdirh));
-			SQUASHFS_SWAP_DIR_HEADER_3(&dirh, &sdirh);
+			SQUASHFS_SWAP_DIR_HEADER_3(&dirh,
+				directory_table + bytes);
 		} else
 			memcpy(&dirh, directory_table + bytes, sizeof(dirh));
 	
@@ -327,10 +313,8 @@ struct dir *squashfs_opendir_3(unsigned int block_start, unsigned int offset,
 
 		while(dir_count--) {
 			if(swap) {
-				squashfs_dir_entry_3 sdire;
-				memcpy(&sdire, directory_table + bytes,
-					sizeof(sdire));
-				SQUASHFS_SWAP_DIR_ENTRY_3(dire, &sdire);
+				SQUASHFS_SWAP_DIR_ENTRY_3(dire,
+					directory_table + bytes);
 			} else
 				memcpy(dire, directory_table + bytes,
 					sizeof(*dire));
@@ -24,6 +24,7 @@
 
 #include "unsquashfs.h"
 #include "squashfs_swap.h"
+#include "squashfs_view.h"
 #include "read_fs.h"
 
 static struct squashfs_fragment_entry *fragment_table;
@@ -70,9 +71,6 @@ int read_fragment_table_4()
 		}
 	}
 
-	for(i = 0; i < sBlk.s.fragments; i++) 
-		SQUASHFS_INSWAP_FRAGMENT_ENTRY(&fragment_table[i]);
-
 	return TRUE;
 }
 
@@ -83,176 +81,310 @@ void read_fragment_4(unsigned int fragment, long long *start_block, int *size)
 
 	struct squashfs_fragment_entry *fragment_entry;
 
+	/* the table is as read, it's only ever looked at here */
 	fragment_entry = &fragment_table[fragment];
-	*start_block = fragment_entry->start_block;
-	*size = fragment_entry->size;
+	*start_block = SQUASHFS_VIEW(fragment_entry,
+		struct squashfs_fragment_entry, start_block);
+	*size = SQUASHFS_VIEW(fragment_entry, struct squashfs_fragment_entry,
+		size);
 }
 
 
-struct inode *read_inode_4(unsigned int start_block, unsigned int offset)
+/*
+ * When reading metadata lazily the block list of a regular file can run
+ * past the copied inode header, read it into a buffer of its own
+ */
+static char *read_block_list_lazy(long long start, int offset, int header,
+	int blocks)
 {
-	static union squashfs_inode_header header;
-	long long start = sBlk.s.inode_table_start + start_block;
-	int bytes = lookup_entry(inode_table_hash, start);
-	char *block_ptr = inode_table + bytes + offset;
-	static struct inode i;
+	static char *block_list = NULL;
+	static int size = 0;
+	struct metadata_cursor cursor = { start, offset };
+
+	if(blocks * sizeof(unsigned int) > size) {
+		size = blocks * sizeof(unsigned int);
+		block_list = realloc(block_list, size);
+		if(block_list == NULL)
+			EXIT_UNSQUASH("read_inode: failed to malloc block "
+				"list\n");
+	}
 
-	TRACE("read_inode: reading inode [%d:%d]\n", start_block,  offset);
+	if(read_metadata(&cursor, NULL, header, FALSE) == FALSE ||
+			read_metadata(&cursor, block_list, blocks *
+			sizeof(unsigned int), FALSE) == FALSE)
+		EXIT_UNSQUASH("read_inode: failed to read block list\n");
 
-	if(bytes == -1)
-		EXIT_UNSQUASH("read_inode: inode table block %lld not found\n",
-			start); 		
+	return block_list;
+}
 
-	SQUASHFS_SWAP_BASE_INODE_HEADER(&header.base, block_ptr);
 
-	i.uid = (uid_t) id_table[header.base.uid];
-	i.gid = (uid_t) id_table[header.base.guid];
-	i.mode = lookup_type[header.base.inode_type] | header.base.mode;
-	i.type = header.base.inode_type;
-	i.time = header.base.mtime;
-	i.inode_number = header.base.inode_number;
+/* a field of the squashfs_<type>_inode_header at block_ptr */
+#define INODE(type, field) \
+	SQUASHFS_VIEW(block_ptr, struct squashfs_##type##_inode_header, field)
 
-	switch(header.base.inode_type) {
-		case SQUASHFS_DIR_TYPE: {
-			struct squashfs_dir_inode_header *inode = &header.dir;
+struct inode *read_inode_4(unsigned int start_block, unsigned int offset)
+{
+	static char lazy_header[sizeof(union squashfs_inode_header)];
+	long long start = sBlk.s.inode_table_start + start_block;
+	struct metadata_cursor cursor = { start, offset };
+	char *block_ptr;
+	static struct inode i;
+	int inode_type;
 
-			SQUASHFS_SWAP_DIR_INODE_HEADER(inode, block_ptr);
+	TRACE("read_inode: reading inode [%d:%d]\n", start_block,  offset);
 
-			i.data = inode->file_size;
-			i.offset = inode->offset;
-			i.start = inode->start_block;
+	if(lazy_metadata) {
+		/*
+		 * copy the largest possible inode header out of the metadata
+		 * LRU, the header fields are then read from the copy
+		 */
+		if(read_metadata(&cursor, lazy_header, sizeof(lazy_header),
+				TRUE) == FALSE)
+			EXIT_UNSQUASH("read_inode: failed to read inode "
+				"%lld:%d\n", start, offset);
+		block_ptr = lazy_header;
+	} else {
+		int bytes = lookup_entry(&inode_table_hash, start);
+
+		if(bytes == -1)
+			EXIT_UNSQUASH("read_inode: inode table block %lld not "
+				"found\n", start); 		
+		block_ptr = inode_table + bytes + offset;
+	}
+
+	inode_type = INODE(base, inode_type);
+	i.uid = (uid_t) id_table[INODE(base, uid)];
+	i.gid = (uid_t) id_table[INODE(base, guid)];
+	i.mode = lookup_type[inode_type] | INODE(base, mode);
+	i.type = inode_type;
+	i.time = INODE(base, mtime);
+	i.inode_number = INODE(base, inode_number);
+
+	switch(inode_type) {
+		case SQUASHFS_DIR_TYPE:
+			i.data = INODE(dir, file_size);
+			i.offset = INODE(dir, offset);
+			i.start = INODE(dir, start_block);
 			i.xattr = SQUASHFS_INVALID_XATTR;
 			break;
-		}
-		case SQUASHFS_LDIR_TYPE: {
-			struct squashfs_ldir_inode_header *inode = &header.ldir;
-
-			SQUASHFS_SWAP_LDIR_INODE_HEADER(inode, block_ptr);
-
-			i.data = inode->file_size;
-			i.offset = inode->offset;
-			i.start = inode->start_block;
-			i.xattr = inode->xattr;
+		case SQUASHFS_LDIR_TYPE:
+			i.data = INODE(ldir, file_size);
+			i.offset = INODE(ldir, offset);
+			i.start = INODE(ldir, start_block);
+			i.xattr = INODE(ldir, xattr);
 			break;
-		}
-		case SQUASHFS_FILE_TYPE: {
-			struct squashfs_reg_inode_header *inode = &header.reg;
-
-			SQUASHFS_SWAP_REG_INODE_HEADER(inode, block_ptr);
-
-			i.data = inode->file_size;
-			i.frag_bytes = inode->fragment == SQUASHFS_INVALID_FRAG
-				?  0 : inode->file_size % sBlk.s.block_size;
-			i.fragment = inode->fragment;
-			i.offset = inode->offset;
-			i.blocks = inode->fragment == SQUASHFS_INVALID_FRAG ?
+		case SQUASHFS_FILE_TYPE:
+			i.data = INODE(reg, file_size);
+			i.fragment = INODE(reg, fragment);
+			i.frag_bytes = i.fragment == SQUASHFS_INVALID_FRAG
+				?  0 : i.data % sBlk.s.block_size;
+			i.offset = INODE(reg, offset);
+			i.blocks = i.fragment == SQUASHFS_INVALID_FRAG ?
 				(i.data + sBlk.s.block_size - 1) >>
 				sBlk.s.block_log :
 				i.data >> sBlk.s.block_log;
-			i.start = inode->start_block;
+			i.start = INODE(reg, start_block);
 			i.sparse = 0;
-			i.block_ptr = block_ptr + sizeof(*inode);
+			i.block_ptr = lazy_metadata ?
+				read_block_list_lazy(start, offset,
+				sizeof(struct squashfs_reg_inode_header),
+				i.blocks) : block_ptr +
+				sizeof(struct squashfs_reg_inode_header);
 			i.xattr = SQUASHFS_INVALID_XATTR;
 			break;
-		}	
-		case SQUASHFS_LREG_TYPE: {
-			struct squashfs_lreg_inode_header *inode = &header.lreg;
-
-			SQUASHFS_SWAP_LREG_INODE_HEADER(inode, block_ptr);
-
-			i.data = inode->file_size;
-			i.frag_bytes = inode->fragment == SQUASHFS_INVALID_FRAG
-				?  0 : inode->file_size % sBlk.s.block_size;
-			i.fragment = inode->fragment;
-			i.offset = inode->offset;
-			i.blocks = inode->fragment == SQUASHFS_INVALID_FRAG ?
-				(inode->file_size + sBlk.s.block_size - 1) >>
+		case SQUASHFS_LREG_TYPE:
+			i.data = INODE(lreg, file_size);
+			i.fragment = INODE(lreg, fragment);
+			i.frag_bytes = i.fragment == SQUASHFS_INVALID_FRAG
+				?  0 : i.data % sBlk.s.block_size;
+			i.offset = INODE(lreg, offset);
+			i.blocks = i.fragment == SQUASHFS_INVALID_FRAG ?
+				(i.data + sBlk.s.block_size - 1) >>
 				sBlk.s.block_log :
-				inode->file_size >> sBlk.s.block_log;
-			i.start = inode->start_block;
-			i.sparse = inode->sparse != 0;
-			i.block_ptr = block_ptr + sizeof(*inode);
-			i.xattr = inode->xattr;
+				i.data >> sBlk.s.block_log;
+			i.start = INODE(lreg, start_block);
+			i.sparse = INODE(lreg, sparse) != 0;
+			i.block_ptr = lazy_metadata ?
+				read_block_list_lazy(start, offset,
+				sizeof(struct squashfs_lreg_inode_header),
+				i.blocks) : block_ptr +
+				sizeof(struct squashfs_lreg_inode_header);
+			i.xattr = INODE(lreg, xattr);
 			break;
-		}	
 		case SQUASHFS_SYMLINK_TYPE:
 		case SQUASHFS_LSYMLINK_TYPE: {
-			struct squashfs_symlink_inode_header *inode = &header.symlink;
+			int symlink_size = INODE(symlink, symlink_size);
 
-			SQUASHFS_SWAP_SYMLINK_INODE_HEADER(inode, block_ptr);
-
-			i.symlink = malloc(inode->symlink_size + 1);
+			i.symlink = malloc(symlink_size + 1);
 			if(i.symlink == NULL)
 				EXIT_UNSQUASH("read_inode: failed to malloc "
 					"symlink data\n");
-			strncpy(i.symlink, block_ptr +
-				sizeof(struct squashfs_symlink_inode_header),
-				inode->symlink_size);
-			i.symlink[inode->symlink_size] = '\0';
-			i.data = inode->symlink_size;
-
-			if(header.base.inode_type == SQUASHFS_LSYMLINK_TYPE)
-				SQUASHFS_SWAP_INTS(&i.xattr, block_ptr +
-					sizeof(struct squashfs_symlink_inode_header) +
-					inode->symlink_size, 1);
-			else
+			if(lazy_metadata) {
+				/*
+				 * the symlink can run past the copied header,
+				 * read it separately
+				 */
+				cursor.block = start;
+				cursor.offset = offset;
+				if(read_metadata(&cursor, NULL,
+						sizeof(struct squashfs_symlink_inode_header),
+						FALSE) == FALSE ||
+						read_metadata(&cursor,
+						i.symlink, symlink_size,
+						FALSE) == FALSE)
+					EXIT_UNSQUASH("read_inode: failed to "
+						"read symlink data\n");
+			} else
+				strncpy(i.symlink, block_ptr +
+					sizeof(struct squashfs_symlink_inode_header),
+					symlink_size);
+			i.symlink[symlink_size] = '\0';
+			i.data = symlink_size;
+
+			if(inode_type != SQUASHFS_LSYMLINK_TYPE)
 				i.xattr = SQUASHFS_INVALID_XATTR;
+			else if(lazy_metadata) {
+				char xattr[sizeof(i.xattr)];
+
+				if(read_metadata(&cursor, xattr, sizeof(xattr),
+						FALSE) == FALSE)
+					EXIT_UNSQUASH("read_inode: failed to "
+						"read symlink xattr\n");
+				i.xattr = squashfs_view_le32(xattr);
+			} else
+				i.xattr = squashfs_view_le32(block_ptr +
+					sizeof(struct squashfs_symlink_inode_header) +
+					symlink_size);
 			break;
 		}
  		case SQUASHFS_BLKDEV_TYPE:
-	 	case SQUASHFS_CHRDEV_TYPE: {
-			struct squashfs_dev_inode_header *inode = &header.dev;
-
-			SQUASHFS_SWAP_DEV_INODE_HEADER(inode, block_ptr);
-
-			i.data = inode->rdev;
+	 	case SQUASHFS_CHRDEV_TYPE:
+			i.data = INODE(dev, rdev);
 			i.xattr = SQUASHFS_INVALID_XATTR;
 			break;
-		}
  		case SQUASHFS_LBLKDEV_TYPE:
-	 	case SQUASHFS_LCHRDEV_TYPE: {
-			struct squashfs_ldev_inode_header *inode = &header.ldev;
-
-			SQUASHFS_SWAP_LDEV_INODE_HEADER(inode, block_ptr);
-
-			i.data = inode->rdev;
-			i.xattr = inode->xattr;
+	 	case SQUASHFS_LCHRDEV_TYPE:
+			i.data = INODE(ldev, rdev);
+			i.xattr = INODE(ldev, xattr);
 			break;
-		}
 		case SQUASHFS_FIFO_TYPE:
 		case SQUASHFS_SOCKET_TYPE:
 			i.data = 0;
 			i.xattr = SQUASHFS_INVALID_XATTR;
 			break;
 		case SQUASHFS_LFIFO_TYPE:
-		case SQUASHFS_LSOCKET_TYPE: {
-			struct squashfs_lipc_inode_header *inode = &header.lipc;
-
-			SQUASHFS_SWAP_LIPC_INODE_HEADER(inode, block_ptr);
-
+		case SQUASHFS_LSOCKET_TYPE:
 			i.data = 0;
-			i.xattr = inode->xattr;
+			i.xattr = INODE(lipc, xattr);
 			break;
-		}
 		default:
 			EXIT_UNSQUASH("Unknown inode type %d in read_inode!\n",
-				header.base.inode_type);
+				inode_type);
 	}
 	return &i;
 }
 
 
+/*
+ * Copy size bytes of directory data, either out of the decompressed
+ * directory table at *bytes or, when listing lazily, from the cursor
+ */
+static void read_directory_data(struct metadata_cursor *cursor, int *bytes,
+	void *dest, int size)
+{
+	if(lazy_metadata) {
+		if(read_metadata(cursor, dest, size, FALSE) == FALSE)
+			EXIT_UNSQUASH("squashfs_opendir: failed to read "
+				"directory\n");
+	} else
+		memcpy(dest, directory_table + *bytes, size);
+
+	*bytes += size;
+}
+
+
+/*
+ * As read_directory_data, but returning where the data is, in place in the
+ * directory table unless listing lazily, when it's copied to buffer
+ */
+static char *view_directory_data(struct metadata_cursor *cursor, int *bytes,
+	char *buffer, int size)
+{
+	char *data = buffer;
+
+	if(lazy_metadata) {
+		if(read_metadata(cursor, buffer, size, FALSE) == FALSE)
+			EXIT_UNSQUASH("squashfs_opendir: failed to read "
+				"directory\n");
+	} else
+		data = directory_table + *bytes;
+
+	*bytes += size;
+	return data;
+}
+
+#define DIR_HEADER(p, field) SQUASHFS_VIEW(p, struct squashfs_dir_header, field)
+#define DIR_ENTRY(p, field) SQUASHFS_VIEW(p, struct squashfs_dir_entry, field)
+
+
+static int compare_dir_ent(const void *a, const void *b)
+{
+	return strcmp(((struct dir_ent *) a)->name,
+		((struct dir_ent *) b)->name);
+}
+
+
+static struct dir *alloc_dir(struct inode *i)
+{
+	struct dir *dir = malloc(sizeof(struct dir));
+
+	if(dir == NULL)
+		EXIT_UNSQUASH("squashfs_opendir: malloc failed!\n");
+
+	dir->dir_count = 0;
+	dir->cur_entry = 0;
+	dir->mode = i->mode;
+	dir->uid = i->uid;
+	dir->guid = i->gid;
+	dir->mtime = i->time;
+	dir->xattr = i->xattr;
+	dir->dirs = NULL;
+
+	return dir;
+}
+
+
+static void add_dir_entry(struct dir *dir, unsigned int start_block,
+	unsigned int offset, unsigned int type, char *name)
+{
+	if((dir->dir_count % DIR_ENT_SIZE) == 0) {
+		struct dir_ent *new_dir = realloc(dir->dirs, (dir->dir_count +
+			DIR_ENT_SIZE) * sizeof(struct dir_ent));
+		if(new_dir == NULL)
+			EXIT_UNSQUASH("squashfs_opendir: realloc failed!\n");
+		dir->dirs = new_dir;
+	}
+
+	strcpy(dir->dirs[dir->dir_count].name, name);
+	dir->dirs[dir->dir_count].start_block = start_block;
+	dir->dirs[dir->dir_count].offset = offset;
+	dir->dirs[dir->dir_count].type = type;
+	dir->dir_count ++;
+}
+
+
 struct dir *squashfs_opendir_4(unsigned int block_start, unsigned int offset,
 	struct inode **i)
 {
-	struct squashfs_dir_header dirh;
-	char buffer[sizeof(struct squashfs_dir_entry) + SQUASHFS_NAME_LEN + 1]
-		__attribute__((aligned));
-	struct squashfs_dir_entry *dire = (struct squashfs_dir_entry *) buffer;
+	char name[SQUASHFS_NAME_LEN + 2];
+	char header_buffer[sizeof(struct squashfs_dir_header)];
+	char entry_buffer[sizeof(struct squashfs_dir_entry)];
+	char *header, *entry;
+	unsigned int start_block;
+	struct metadata_cursor cursor;
 	long long start;
 	int bytes;
-	int dir_count, size;
-	struct dir_ent *new_dir;
+	int dir_count, size, name_size;
 	struct dir *dir;
 
 	TRACE("squashfs_opendir: inode start block %d, offset %d\n",
@@ -260,64 +392,184 @@ struct dir *squashfs_opendir_4(unsigned int block_start, unsigned int offset,
 
 	*i = s_ops.read_inode(block_start, offset);
 	start = sBlk.s.directory_table_start + (*i)->start;
-	bytes = lookup_entry(directory_table_hash, start);
 
-	if(bytes == -1)
-		EXIT_UNSQUASH("squashfs_opendir: directory block %d not "
-			"found!\n", block_start);
+	if(lazy_metadata) {
+		cursor.block = start;
+		cursor.offset = (*i)->offset;
+		bytes = 0;
+	} else {
+		bytes = lookup_entry(&directory_table_hash, start);
 
-	bytes += (*i)->offset;
-	size = (*i)->data + bytes - 3;
+		if(bytes == -1)
+			EXIT_UNSQUASH("squashfs_opendir: directory block %d "
+				"not found!\n", block_start);
 
-	dir = malloc(sizeof(struct dir));
-	if(dir == NULL)
-		EXIT_UNSQUASH("squashfs_opendir: malloc failed!\n");
-
-	dir->dir_count = 0;
-	dir->cur_entry = 0;
-	dir->mode = (*i)->mode;
-	dir->uid = (*i)->uid;
-	dir->guid = (*i)->gid;
-	dir->mtime = (*i)->time;
-	dir->xattr = (*i)->xattr;
-	dir->dirs = NULL;
+		bytes += (*i)->offset;
+	}
+	size = (*i)->data + bytes - 3;
+	dir = alloc_dir(*i);
 
 	while(bytes < size) {			
-		SQUASHFS_SWAP_DIR_HEADER(&dirh, directory_table + bytes);
-	
-		dir_count = dirh.count + 1;
+		header = view_directory_data(&cursor, &bytes, header_buffer,
+			sizeof(header_buffer));
+		dir_count = DIR_HEADER(header, count) + 1;
+		start_block = DIR_HEADER(header, start_block);
 		TRACE("squashfs_opendir: Read directory header @ byte position "
 			"%d, %d directory entries\n", bytes, dir_count);
-		bytes += sizeof(dirh);
 
 		while(dir_count--) {
-			SQUASHFS_SWAP_DIR_ENTRY(dire, directory_table + bytes);
-
-			bytes += sizeof(*dire);
+			entry = view_directory_data(&cursor, &bytes,
+				entry_buffer, sizeof(entry_buffer));
+			name_size = DIR_ENTRY(entry, size);
 
-			memcpy(dire->name, directory_table + bytes,
-				dire->size + 1);
-			dire->name[dire->size + 1] = '\0';
+			read_directory_data(&cursor, &bytes, name,
+				name_size + 1);
+			name[name_size + 1] = '\0';
 			TRACE("squashfs_opendir: directory entry %s, inode "
-				"%d:%d, type %d\n", dire->name,
-				dirh.start_block, dire->offset, dire->type);
-			if((dir->dir_count % DIR_ENT_SIZE) == 0) {
-				new_dir = realloc(dir->dirs, (dir->dir_count +
-					DIR_ENT_SIZE) * sizeof(struct dir_ent));
-				if(new_dir == NULL)
-					EXIT_UNSQUASH("squashfs_opendir: "
-						"realloc failed!\n");
-				dir->dirs = new_dir;
-			}
-			strcpy(dir->dirs[dir->dir_count].name, dire->name);
-			dir->dirs[dir->dir_count].start_block =
-				dirh.start_block;
-			dir->dirs[dir->dir_count].offset = dire->offset;
-			dir->dirs[dir->dir_count].type = dire->type;
-			dir->dir_count ++;
-			bytes += dire->size + 1;
+				"%d:%d, type %d\n", name, start_block,
+				(int) DIR_ENTRY(entry, offset),
+				(int) DIR_ENTRY(entry, type));
+			add_dir_entry(dir, start_block, DIR_ENTRY(entry,
+				offset), DIR_ENTRY(entry, type), name);
+		}
+	}
+
+	return dir;
+}
+
+
+/*
+ * Position the cursor at the directory header covering name.  Extended
+ * directories carry an index giving the first name and position of each
+ * metadata block of the directory, so the entries before the block
+ * holding name need not be read
+ */
+static int dir_index_lookup(unsigned int block_start, unsigned int offset,
+	struct inode *i, char *name, struct metadata_cursor *cursor)
+{
+	struct squashfs_ldir_inode_header dir_inode;
+	struct squashfs_dir_index index;
+	char raw[sizeof(dir_inode)], index_name[SQUASHFS_NAME_LEN + 1];
+	struct metadata_cursor inode_cursor = {
+		sBlk.s.inode_table_start + block_start, offset };
+	int n, bytes = 0;
+
+	cursor->block = sBlk.s.directory_table_start + i->start;
+	cursor->offset = i->offset;
+
+	if(i->type != SQUASHFS_LDIR_TYPE)
+		return 0;
+
+	if(read_metadata(&inode_cursor, raw, sizeof(dir_inode), FALSE) ==
+			FALSE)
+		EXIT_UNSQUASH("squashfs_lookup: failed to read directory "
+			"inode\n");
+	SQUASHFS_SWAP_LDIR_INODE_HEADER(&dir_inode, raw);
+
+	for(n = 0; n < dir_inode.i_count; n++) {
+		if(read_metadata(&inode_cursor, raw, sizeof(index), FALSE) ==
+				FALSE)
+			EXIT_UNSQUASH("squashfs_lookup: failed to read "
+				"directory index\n");
+		SQUASHFS_SWAP_DIR_INDEX(&index, raw);
+
+		if(index.size >= SQUASHFS_NAME_LEN || read_metadata(
+				&inode_cursor, index_name, index.size + 1,
+				FALSE) == FALSE)
+			EXIT_UNSQUASH("squashfs_lookup: failed to read "
+				"directory index\n");
+		index_name[index.size + 1] = '\0';
+
+		if(strcmp(index_name, name) > 0)
+			break;
+
+		bytes = index.index;
+		cursor->block = sBlk.s.directory_table_start +
+			index.start_block;
+		cursor->offset = (index.index + i->offset) %
+			SQUASHFS_METADATA_SIZE;
+	}
+
+	return bytes;
+}
+
+
+/*
+ * Add the entry for name to dir, if present.  Directories are sorted, so
+ * the scan stops as soon as it passes where name would be
+ */
+static void lookup_name(struct dir *dir, unsigned int block_start,
+	unsigned int offset, struct inode *i, char *name)
+{
+	char entry_name[SQUASHFS_NAME_LEN + 2];
+	char header_buffer[sizeof(struct squashfs_dir_header)];
+	char entry_buffer[sizeof(struct squashfs_dir_entry)];
+	char *header, *entry;
+	unsigned int start_block;
+	struct metadata_cursor cursor;
+	int n, dir_count, bytes, name_size, size = i->data - 3;
+
+	for(n = 0; n < dir->dir_count; n++)
+		if(strcmp(dir->dirs[n].name, name) == 0)
+			return;
+
+	bytes = dir_index_lookup(block_start, offset, i, name, &cursor);
+
+	while(bytes < size) {
+		header = view_directory_data(&cursor, &bytes, header_buffer,
+			sizeof(header_buffer));
+		start_block = DIR_HEADER(header, start_block);
+
+		for(dir_count = DIR_HEADER(header, count) + 1; dir_count;
+				dir_count--) {
+			int res;
+
+			entry = view_directory_data(&cursor, &bytes,
+				entry_buffer, sizeof(entry_buffer));
+			name_size = DIR_ENTRY(entry, size);
+
+			read_directory_data(&cursor, &bytes, entry_name,
+				name_size + 1);
+			entry_name[name_size + 1] = '\0';
+
+			res = strcmp(entry_name, name);
+			if(res == 0)
+				add_dir_entry(dir, start_block,
+					DIR_ENTRY(entry, offset),
+					DIR_ENTRY(entry, type), entry_name);
+			if(res >= 0)
+				return;
 		}
 	}
+}
+
+
+/*
+ * Open a directory returning only the entries named in paths, which
+ * must all be literal names.  Used when extracting specific files so
+ * that only the directory and inode blocks on their paths are read
+ */
+struct dir *squashfs_lookup_4(unsigned int block_start, unsigned int offset,
+	struct inode **i, struct pathnames *paths)
+{
+	struct inode *inode;
+	struct dir *dir;
+	int n, name;
+
+	TRACE("squashfs_lookup: inode start block %d, offset %d\n",
+		block_start, offset);
+
+	*i = inode = s_ops.read_inode(block_start, offset);
+	dir = alloc_dir(inode);
+
+	for(n = 0; n < paths->count; n++)
+		for(name = 0; name < paths->path[n]->names; name++)
+			lookup_name(dir, block_start, offset, inode,
+				paths->path[n]->name[name].name);
+
+	/* return the entries in directory order, as squashfs_opendir does */
+	qsort(dir->dirs, dir->dir_count, sizeof(struct dir_ent),
+		compare_dir_ent);
 
 	return dir;
 }
@@ -28,10 +28,15 @@
 #include "read_fs.h"
 #include "compressor.h"
 #include "xattr.h"
+#include "queue.h"
+#include "contenthash.h"
+#include "cpus.h"
+#include "../../../fmkstats/fmkstats.h"
+#include "../../../fmkindex/fmkindex.h"
 
 #include <sys/types.h>
 
-struct cache *fragment_cache, *data_cache;
+struct cache *fragment_cache, *data_cache, *metadata_cache;
 struct queue *to_reader, *to_deflate, *to_writer, *from_writer;
 pthread_t *thread, *deflator_thread;
 pthread_mutex_t	fragment_mutex;
@@ -46,7 +51,7 @@ struct compressor *comp;
 int bytes = 0, swap, file_count = 0, dir_count = 0, sym_count = 0,
 	dev_count = 0, fifo_count = 0;
 char *inode_table = NULL, *directory_table = NULL;
-struct hash_table_entry *inode_table_hash[65536], *directory_table_hash[65536];
+struct hash_table inode_table_hash, directory_table_hash;
 int fd;
 unsigned int *uid_table, *guid_table;
 unsigned int cached_frag = SQUASHFS_INVALID_FRAG;
@@ -68,6 +73,70 @@ unsigned int total_blocks = 0, total_files = 0, total_inodes = 0;
 unsigned int cur_blocks = 0;
 int inode_number = 1;
 int no_xattrs = XATTR_DEF;
+char *fs_map = NULL;
+long long fs_map_size = 0;
+int lazy_metadata = FALSE, lookup_paths = FALSE;
+char *block_cache_dir = NULL;
+
+/*
+ * -resume <journal>.  The writer appends a record to the journal as each
+ * file is finished, and every JOURNAL_INTERVAL bytes of the larger files,
+ * so an extraction that is killed can be run again with the same journal
+ * and only writes what the journal doesn't have.  journal[] has a file's
+ * bytes already written by inode number, JOURNAL_DONE once it is whole.
+ * Records are written once the data they cover has been handed to the
+ * kernel, which outlives the process, but not the machine, going down
+ */
+#define JOURNAL_MAGIC		"UNSQJRN1"
+#define JOURNAL_INTERVAL	(64 << 20)
+#define JOURNAL_DONE		-1LL
+
+struct journal_header {
+	char			magic[8];
+	struct squashfs_super_block sb;
+};
+
+struct journal_record {
+	unsigned int		inode_number;
+	unsigned int		unused;
+	long long		bytes;
+};
+
+int journal_fd = -1;
+long long *journal = NULL;
+
+/* FMK_INDEX, the writer hashes each file as it writes it, see fmkindex.h */
+int index_prefix;
+
+/*
+ * With -pf the owners, set-id bits and device nodes, which only root can
+ * give the files extracted, are written to a pseudo file for mksquashfs -pf
+ * to put back instead.  The files themselves are left readable and
+ * writable by the user extracting them
+ */
+FILE *pseudo_file = NULL;
+int pseudo_prefix;
+
+#define PSEUDO_MODE(mode) (((mode) & 0777) | S_IRUSR | S_IWUSR | \
+	(S_ISDIR(mode) ? S_IXUSR : 0))
+
+/*
+ * -verify reads and decompresses everything an extraction would, through
+ * the same reader and deflator threads, checking every data block and
+ * fragment decompresses to the size its file expects, but writes nothing.
+ * The writer thread counts the corrupt files in verify_failed, the main
+ * thread the other errors in verify_errors.  -verify-hash also prints each
+ * file's content hash, pathnames relative to the root, less verify_prefix
+ */
+int verify = FALSE, verify_hash = FALSE, verify_errors = 0, verify_failed = 0;
+int verify_prefix;
+char *zero_block = NULL;
+
+/* fragments checked ahead of the one being waited for by -verify */
+#define VERIFY_FRAGMENTS_AHEAD	64
+char *dict_file = NULL;
+struct metadata_block metadata_lru[LAZY_METADATA_BLOCKS];
+unsigned int metadata_tick = 0;
 
 int lookup_type[] = {
 	0,
@@ -139,80 +208,26 @@ void sigalrm_handler()
 }
 
 
-struct queue *queue_init(int size)
+/* Called with the shard mutex held */
+void insert_hash_table(struct cache_shard *shard, struct cache_entry *entry)
 {
-	struct queue *queue = malloc(sizeof(struct queue));
-
-	if(queue == NULL)
-		EXIT_UNSQUASH("Out of memory in queue_init\n");
-
-	queue->data = malloc(sizeof(void *) * (size + 1));
-	if(queue->data == NULL)
-		EXIT_UNSQUASH("Out of memory in queue_init\n");
-
-	queue->size = size + 1;
-	queue->readp = queue->writep = 0;
-	pthread_mutex_init(&queue->mutex, NULL);
-	pthread_cond_init(&queue->empty, NULL);
-	pthread_cond_init(&queue->full, NULL);
-
-	return queue;
-}
+	int hash = CACHE_BUCKET(entry->cache, entry->block);
 
-
-void queue_put(struct queue *queue, void *data)
-{
-	int nextp;
-
-	pthread_mutex_lock(&queue->mutex);
-
-	while((nextp = (queue->writep + 1) % queue->size) == queue->readp)
-		pthread_cond_wait(&queue->full, &queue->mutex);
-
-	queue->data[queue->writep] = data;
-	queue->writep = nextp;
-	pthread_cond_signal(&queue->empty);
-	pthread_mutex_unlock(&queue->mutex);
-}
-
-
-void *queue_get(struct queue *queue)
-{
-	void *data;
-	pthread_mutex_lock(&queue->mutex);
-
-	while(queue->readp == queue->writep)
-		pthread_cond_wait(&queue->empty, &queue->mutex);
-
-	data = queue->data[queue->readp];
-	queue->readp = (queue->readp + 1) % queue->size;
-	pthread_cond_signal(&queue->full);
-	pthread_mutex_unlock(&queue->mutex);
-
-	return data;
-}
-
-
-/* Called with the cache mutex held */
-void insert_hash_table(struct cache *cache, struct cache_entry *entry)
-{
-	int hash = CALCULATE_HASH(entry->block);
-
-	entry->hash_next = cache->hash_table[hash];
-	cache->hash_table[hash] = entry;
+	entry->hash_next = shard->hash_table[hash];
+	shard->hash_table[hash] = entry;
 	entry->hash_prev = NULL;
 	if(entry->hash_next)
 		entry->hash_next->hash_prev = entry;
 }
 
 
-/* Called with the cache mutex held */
-void remove_hash_table(struct cache *cache, struct cache_entry *entry)
+/* Called with the shard mutex held */
+void remove_hash_table(struct cache_shard *shard, struct cache_entry *entry)
 {
 	if(entry->hash_prev)
 		entry->hash_prev->hash_next = entry->hash_next;
 	else
-		cache->hash_table[CALCULATE_HASH(entry->block)] =
+		shard->hash_table[CACHE_BUCKET(entry->cache, entry->block)] =
 			entry->hash_next;
 	if(entry->hash_next)
 		entry->hash_next->hash_prev = entry->hash_prev;
@@ -221,59 +236,83 @@ void remove_hash_table(struct cache *cache, struct cache_entry *entry)
 }
 
 
-/* Called with the cache mutex held */
-void insert_free_list(struct cache *cache, struct cache_entry *entry)
+/* Called with the shard mutex held */
+void insert_free_list(struct cache_shard *shard, struct cache_entry *entry)
 {
-	if(cache->free_list) {
-		entry->free_next = cache->free_list;
-		entry->free_prev = cache->free_list->free_prev;
-		cache->free_list->free_prev->free_next = entry;
-		cache->free_list->free_prev = entry;
+	if(shard->free_list) {
+		entry->free_next = shard->free_list;
+		entry->free_prev = shard->free_list->free_prev;
+		shard->free_list->free_prev->free_next = entry;
+		shard->free_list->free_prev = entry;
 	} else {
-		cache->free_list = entry;
+		shard->free_list = entry;
 		entry->free_prev = entry->free_next = entry;
 	}
 }
 
 
-/* Called with the cache mutex held */
-void remove_free_list(struct cache *cache, struct cache_entry *entry)
+/* Called with the shard mutex held */
+void remove_free_list(struct cache_shard *shard, struct cache_entry *entry)
 {
 	if(entry->free_prev == NULL && entry->free_next == NULL)
 		/* not in free list */
 		return;
 	else if(entry->free_prev == entry && entry->free_next == entry) {
 		/* only this entry in the free list */
-		cache->free_list = NULL;
+		shard->free_list = NULL;
 	} else {
 		/* more than one entry in the free list */
 		entry->free_next->free_prev = entry->free_prev;
 		entry->free_prev->free_next = entry->free_next;
-		if(cache->free_list == entry)
-			cache->free_list = entry->free_next;
+		if(shard->free_list == entry)
+			shard->free_list = entry->free_next;
 	}
 
 	entry->free_prev = entry->free_next = NULL;
 }
 
 
-struct cache *cache_init(int buffer_size, int max_buffers)
+struct cache *cache_init(int buffer_size, int max_buffers, int max_shards)
 {
+	int i, buckets;
 	struct cache *cache = malloc(sizeof(struct cache));
 
 	if(cache == NULL)
 		EXIT_UNSQUASH("Out of memory in cache_init\n");
 
-	cache->max_buffers = max_buffers;
+	/*
+	 * Split the cache into a power of two number of shards, each with
+	 * its own lock, hash table and free list.  Every shard must own at
+	 * least one buffer, so small caches get fewer shards.  Callers which
+	 * hold many buffers at once from one thread must ask for a single
+	 * shard, otherwise they can block on a full shard whose buffers only
+	 * they can release
+	 */
+	for(cache->shard_bits = 0; (2 << cache->shard_bits) <= max_shards &&
+			(2 << cache->shard_bits) <= max_buffers;
+			cache->shard_bits ++);
+	cache->shards = 1 << cache->shard_bits;
 	cache->buffer_size = buffer_size;
-	cache->count = 0;
-	cache->free_list = NULL;
-	memset(cache->hash_table, 0, sizeof(struct cache_entry *) * 65536);
-	cache->wait_free = FALSE;
-	cache->wait_pending = FALSE;
-	pthread_mutex_init(&cache->mutex, NULL);
-	pthread_cond_init(&cache->wait_for_free, NULL);
-	pthread_cond_init(&cache->wait_for_pending, NULL);
+	buckets = 65536 >> cache->shard_bits;
+
+	for(i = 0; i < cache->shards; i++) {
+		struct cache_shard *shard = &cache->shard[i];
+
+		shard->max_buffers = max_buffers / cache->shards +
+			(i < max_buffers % cache->shards);
+		shard->count = 0;
+		shard->free_list = NULL;
+		shard->hash_table = calloc(buckets,
+			sizeof(struct cache_entry *));
+		if(shard->hash_table == NULL)
+			EXIT_UNSQUASH("Out of memory in cache_init\n");
+		shard->wait_free = FALSE;
+		shard->wait_pending = FALSE;
+		shard->hits = shard->misses = shard->waits = 0;
+		pthread_mutex_init(&shard->mutex, NULL);
+		pthread_cond_init(&shard->wait_for_free, NULL);
+		pthread_cond_init(&shard->wait_for_pending, NULL);
+	}
 
 	return cache;
 }
@@ -286,14 +325,16 @@ struct cache_entry *cache_get(struct cache *cache, long long block, int size)
  	 * it is added and queued to the reader() and deflate() threads for
  	 * reading off disk and decompression.  The cache grows until max_blocks
  	 * is reached, once this occurs existing discarded blocks on the free
- 	 * list are reused
+ 	 * list are reused.  Only the shard owning the block is locked, so
+ 	 * lookups of unrelated blocks proceed in parallel
  	 */
-	int hash = CALCULATE_HASH(block);
+	struct cache_shard *shard = CACHE_SHARD(cache, block);
+	int hash = CACHE_BUCKET(cache, block);
 	struct cache_entry *entry;
 
-	pthread_mutex_lock(&cache->mutex);
+	pthread_mutex_lock(&shard->mutex);
 
-	for(entry = cache->hash_table[hash]; entry; entry = entry->hash_next)
+	for(entry = shard->hash_table[hash]; entry; entry = entry->hash_next)
 		if(entry->block == block)
 			break;
 
@@ -303,36 +344,41 @@ struct cache_entry *cache_get(struct cache *cache, long long block, int size)
  		 * if necessary remove from free list so it won't disappear
  		 */
 		entry->used ++;
-		remove_free_list(cache, entry);
-		pthread_mutex_unlock(&cache->mutex);
+		remove_free_list(shard, entry);
+		shard->hits ++;
+		pthread_mutex_unlock(&shard->mutex);
 	} else {
 		/*
  		 * not in the cache
 		 *
 		 * first try to allocate new block
 		 */
-		if(cache->count < cache->max_buffers) {
+		shard->misses ++;
+		if(shard->count < shard->max_buffers) {
 			entry = malloc(sizeof(struct cache_entry));
 			if(entry == NULL)
 				EXIT_UNSQUASH("Out of memory in cache_get\n");
-			entry->data = malloc(cache->buffer_size);
-			if(entry->data == NULL)
+			entry->buffer = malloc(cache->buffer_size);
+			if(entry->buffer == NULL)
 				EXIT_UNSQUASH("Out of memory in cache_get\n");
 			entry->cache = cache;
+			entry->shard = shard;
 			entry->free_prev = entry->free_next = NULL;
-			cache->count ++;
+			shard->count ++;
 		} else {
 			/*
 			 * try to get from free list
 			 */
-			while(cache->free_list == NULL) {
-				cache->wait_free = TRUE;
-				pthread_cond_wait(&cache->wait_for_free,
-					&cache->mutex);
+			if(shard->free_list == NULL)
+				shard->waits ++;
+			while(shard->free_list == NULL) {
+				shard->wait_free = TRUE;
+				pthread_cond_wait(&shard->wait_for_free,
+					&shard->mutex);
 			}
-			entry = cache->free_list;
-			remove_free_list(cache, entry);
-			remove_hash_table(cache, entry);
+			entry = shard->free_list;
+			remove_free_list(shard, entry);
+			remove_hash_table(shard, entry);
 		}
 
 		/*
@@ -340,16 +386,17 @@ struct cache_entry *cache_get(struct cache *cache, long long block, int size)
 		 */
 		entry->block = block;
 		entry->size = size;
+		entry->data = entry->buffer;
 		entry->used = 1;
 		entry->error = FALSE;
 		entry->pending = TRUE;
-		insert_hash_table(cache, entry);
+		insert_hash_table(shard, entry);
 
 		/*
 		 * queue to read thread to read and ultimately (via the
 		 * decompress threads) decompress the buffer
  		 */
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		queue_put(to_reader, entry);
 	}
 
@@ -365,7 +412,9 @@ void cache_block_ready(struct cache_entry *entry, int error)
  	 * If an error occurs reading or decompressing, the buffer also 
  	 * becomes ready but with an error...
  	 */
-	pthread_mutex_lock(&entry->cache->mutex);
+	struct cache_shard *shard = entry->shard;
+
+	pthread_mutex_lock(&shard->mutex);
 	entry->pending = FALSE;
 	entry->error = error;
 
@@ -373,12 +422,12 @@ void cache_block_ready(struct cache_entry *entry, int error)
 	 * if the wait_pending flag is set, one or more threads may be waiting
 	 * on this buffer
 	 */
-	if(entry->cache->wait_pending) {
-		entry->cache->wait_pending = FALSE;
-		pthread_cond_broadcast(&entry->cache->wait_for_pending);
+	if(shard->wait_pending) {
+		shard->wait_pending = FALSE;
+		pthread_cond_broadcast(&shard->wait_for_pending);
 	}
 
-	pthread_mutex_unlock(&entry->cache->mutex);
+	pthread_mutex_unlock(&shard->mutex);
 }
 
 
@@ -388,15 +437,19 @@ void cache_block_wait(struct cache_entry *entry)
 	 * wait for this cache entry to become ready, when reading and (if
 	 * necessary) decompression has taken place
 	 */
-	pthread_mutex_lock(&entry->cache->mutex);
+	struct cache_shard *shard = entry->shard;
+
+	pthread_mutex_lock(&shard->mutex);
+
+	if(entry->pending)
+		shard->waits ++;
 
 	while(entry->pending) {
-		entry->cache->wait_pending = TRUE;
-		pthread_cond_wait(&entry->cache->wait_for_pending,
-			&entry->cache->mutex);
+		shard->wait_pending = TRUE;
+		pthread_cond_wait(&shard->wait_for_pending, &shard->mutex);
 	}
 
-	pthread_mutex_unlock(&entry->cache->mutex);
+	pthread_mutex_unlock(&shard->mutex);
 }
 
 
@@ -408,23 +461,37 @@ void cache_block_put(struct cache_entry *entry)
  	 * accessible via the hash table it can be found getting a new lease of
  	 * life before it is reused.
  	 */
-	pthread_mutex_lock(&entry->cache->mutex);
+	struct cache_shard *shard = entry->shard;
+
+	pthread_mutex_lock(&shard->mutex);
 
 	entry->used --;
 	if(entry->used == 0) {
-		insert_free_list(entry->cache, entry);
+		insert_free_list(shard, entry);
 
 		/*
 		 * if the wait_free flag is set, one or more threads may be
 		 * waiting on this buffer
 		 */
-		if(entry->cache->wait_free) {
-			entry->cache->wait_free = FALSE;
-			pthread_cond_broadcast(&entry->cache->wait_for_free);
+		if(shard->wait_free) {
+			shard->wait_free = FALSE;
+			pthread_cond_broadcast(&shard->wait_for_free);
 		}
 	}
 
-	pthread_mutex_unlock(&entry->cache->mutex);
+	pthread_mutex_unlock(&shard->mutex);
+}
+
+
+void cache_stats(struct cache *cache, char *name)
+{
+	int i;
+
+	for(i = 0; i < cache->shards; i++)
+		TRACE("%s cache shard %d: %d buffers, %lld hits, %lld misses, "
+			"%lld waits\n", name, i, cache->shard[i].count,
+			cache->shard[i].hits, cache->shard[i].misses,
+			cache->shard[i].waits);
 }
 
 
@@ -443,100 +510,90 @@ char *modestr(char *str, int mode)
 }
 
 
-#define TOTALCHARS  25
-int print_filename(char *pathname, struct inode *inode)
+/*
+ * Metadata blocks are a few Kbytes apart on disk, so the low bits of
+ * their positions are poorly spread, and are mixed before being masked
+ */
+static inline unsigned int metadata_hash(long long start)
 {
-	char str[11], dummy[100], dummy2[100], *userstr, *groupstr;
-	int padchars;
-	struct passwd *user;
-	struct group *group;
-	struct tm *t;
+	return ((unsigned long long) start * 0x9e3779b97f4a7c15ULL) >> 32;
+}
 
-	if(short_ls) {
-		printf("%s\n", pathname);
-		return 1;
-	}
 
-	user = getpwuid(inode->uid);
-	if(user == NULL) {
-		sprintf(dummy, "%d", inode->uid);
-		userstr = dummy;
-	} else
-		userstr = user->pw_name;
-		 
-	group = getgrgid(inode->gid);
-	if(group == NULL) {
-		sprintf(dummy2, "%d", inode->gid);
-		groupstr = dummy2;
-	} else
-		groupstr = group->gr_name;
+static struct hash_table_entry *find_entry(struct hash_table *hash_table,
+	long long start)
+{
+	unsigned int mask = hash_table->size - 1;
+	unsigned int i = metadata_hash(start) & mask;
+
+	while(hash_table->entry[i].start != -1 &&
+			hash_table->entry[i].start != start)
+		i = (i + 1) & mask;
 
-	printf("%s %s/%s ", modestr(str, inode->mode), userstr, groupstr);
+	return &hash_table->entry[i];
+}
 
-	switch(inode->mode & S_IFMT) {
-		case S_IFREG:
-		case S_IFDIR:
-		case S_IFSOCK:
-		case S_IFIFO:
-		case S_IFLNK:
-			padchars = TOTALCHARS - strlen(userstr) -
-				strlen(groupstr);
 
-			printf("%*lld ", padchars > 0 ? padchars : 0,
-				inode->data);
-			break;
-		case S_IFCHR:
-		case S_IFBLK:
-			padchars = TOTALCHARS - strlen(userstr) -
-				strlen(groupstr) - 7; 
-
-			printf("%*s%3d,%3d ", padchars > 0 ? padchars : 0, " ",
-				(int) inode->data >> 8, (int) inode->data &
-				0xff);
-			break;
+static void grow_entries(struct hash_table *hash_table)
+{
+	struct hash_table_entry *old = hash_table->entry;
+	unsigned int i, size = hash_table->size;
+
+	hash_table->size = size ? size << 1 : 1024;
+	hash_table->entry = malloc(hash_table->size *
+		sizeof(struct hash_table_entry));
+	if(hash_table->entry == NULL)
+		EXIT_UNSQUASH("Out of memory in add_entry\n");
+
+	for(i = 0; i < hash_table->size; i++) {
+		hash_table->entry[i].start = -1;
+		hash_table->entry[i].bytes = -1;
 	}
 
-	t = localtime(&inode->time);
+	for(i = 0; i < size; i++)
+		if(old[i].start != -1)
+			*find_entry(hash_table, old[i].start) = old[i];
 
-	printf("%d-%02d-%02d %02d:%02d %s", t->tm_year + 1900, t->tm_mon + 1,
-		t->tm_mday, t->tm_hour, t->tm_min, pathname);
-	if((inode->mode & S_IFMT) == S_IFLNK)
-		printf(" -> %s", inode->symlink);
-	printf("\n");
-		
-	return 1;
+	free(old);
 }
-	
 
-void add_entry(struct hash_table_entry *hash_table[], long long start,
-	int bytes)
+
+void add_entry(struct hash_table *hash_table, long long start, int bytes)
 {
-	int hash = CALCULATE_HASH(start);
-	struct hash_table_entry *hash_table_entry;
+	struct hash_table_entry *entry;
 
-	hash_table_entry = malloc(sizeof(struct hash_table_entry));
-	if(hash_table_entry == NULL)
-		EXIT_UNSQUASH("Out of memory in add_entry\n");
+	if((hash_table->used + 1) * 2 > hash_table->size)
+		grow_entries(hash_table);
 
-	hash_table_entry->start = start;
-	hash_table_entry->bytes = bytes;
-	hash_table_entry->next = hash_table[hash];
-	hash_table[hash] = hash_table_entry;
+	entry = find_entry(hash_table, start);
+	if(entry->start == -1)
+		hash_table->used ++;
+	entry->start = start;
+	entry->bytes = bytes;
 }
 
 
-int lookup_entry(struct hash_table_entry *hash_table[], long long start)
+int lookup_entry(struct hash_table *hash_table, long long start)
 {
-	int hash = CALCULATE_HASH(start);
-	struct hash_table_entry *hash_table_entry;
+	if(hash_table->size == 0)
+		return -1;
+
+	return find_entry(hash_table, start)->bytes;
+}
 
-	for(hash_table_entry = hash_table[hash]; hash_table_entry;
-				hash_table_entry = hash_table_entry->next)
 
-		if(hash_table_entry->start == start)
-			return hash_table_entry->bytes;
+/*
+ * If the filesystem is mapped (-mmap) return a pointer to the requested
+ * bytes inside the mapping, otherwise, or if the bytes lie outside the
+ * filesystem, return NULL
+ */
+void *map_fs_bytes(long long byte, int bytes)
+{
+	if(fs_map == NULL || byte < 0 || bytes < 0 ||
+			byte + bytes > fs_map_size)
+		return NULL;
 
-	return -1;
+	return fs_map + byte;
 }
 
 
@@ -548,6 +605,17 @@ int read_fs_bytes(int fd, long long byte, int bytes, void *buff)
 	TRACE("read_bytes: reading from position 0x%llx, bytes %d\n", byte,
 		bytes);
 
+	if(fs_map) {
+		void *src = map_fs_bytes(byte, bytes);
+
+		if(src == NULL) {
+			ERROR("Read on filesystem failed because EOF\n");
+			return FALSE;
+		}
+		memcpy(buff, src, bytes);
+		return TRUE;
+	}
+
 	if(lseek(fd, off, SEEK_SET) == -1) {
 		ERROR("Lseek failed because %s\n", strerror(errno));
 		return FALSE;
@@ -593,14 +661,20 @@ int read_block(int fd, long long start, long long *next, void *block)
 	if(SQUASHFS_CHECK_DATA(sBlk.s.flags))
 		offset = 3;
 	if(SQUASHFS_COMPRESSED(c_byte)) {
-		char buffer[SQUASHFS_METADATA_SIZE];
+		char buffer[SQUASHFS_METADATA_SIZE], *src = buffer;
 		int error, res;
 
 		c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
-		if(read_fs_bytes(fd, start + offset, c_byte, buffer) == FALSE)
+		if(fs_map) {
+			/* decompress straight out of the mapping */
+			src = map_fs_bytes(start + offset, c_byte);
+			if(src == NULL)
+				goto failed;
+		} else if(read_fs_bytes(fd, start + offset, c_byte, buffer) ==
+				FALSE)
 			goto failed;
 
-		res = compressor_uncompress(comp, block, buffer, c_byte,
+		res = compressor_uncompress(comp, block, src, c_byte,
 			SQUASHFS_METADATA_SIZE, &error);
 
 		if(res == -1) {
@@ -626,6 +700,85 @@ failed:
 }
 
 
+/*
+ * Return the decompressed metadata block at start from the lazy listing
+ * LRU, decompressing it (and evicting the least recently used block) if
+ * it isn't present
+ */
+struct metadata_block *get_metadata_block(long long start)
+{
+	struct metadata_block *block, *victim = &metadata_lru[0];
+	int i;
+
+	for(i = 0; i < LAZY_METADATA_BLOCKS; i++) {
+		block = &metadata_lru[i];
+		if(block->length && block->start == start) {
+			block->tick = ++ metadata_tick;
+			return block;
+		}
+		if(block->tick < victim->tick)
+			victim = block;
+	}
+
+	TRACE("get_metadata_block: reading block 0x%llx\n", start);
+	victim->length = read_block(fd, start, &victim->next, victim->data);
+	if(victim->length == 0)
+		return NULL;
+	victim->start = start;
+	victim->tick = ++ metadata_tick;
+
+	return victim;
+}
+
+
+/*
+ * Copy bytes of metadata at the cursor into dest (or skip them if dest is
+ * NULL), following the chain into as many blocks as needed and leaving the
+ * cursor after the data.  If partial is set running off the end of the
+ * metadata is not an error and the rest of dest is zeroed, which lets
+ * callers read a maximum sized inode header
+ */
+int read_metadata(struct metadata_cursor *cursor, void *buffer, int bytes,
+	int partial)
+{
+	char *dest = buffer;
+
+	while(bytes) {
+		struct metadata_block *block = get_metadata_block(cursor->block);
+		int avail;
+
+		if(block == NULL) {
+			if(partial) {
+				if(dest)
+					memset(dest, 0, bytes);
+				return TRUE;
+			}
+			return FALSE;
+		}
+
+		avail = block->length - cursor->offset;
+		if(avail > bytes)
+			avail = bytes;
+		if(avail > 0) {
+			if(dest) {
+				memcpy(dest, block->data + cursor->offset,
+					avail);
+				dest += avail;
+			}
+			bytes -= avail;
+			cursor->offset += avail;
+		}
+
+		if(cursor->offset >= block->length) {
+			cursor->offset -= block->length;
+			cursor->block = block->next;
+		}
+	}
+
+	return TRUE;
+}
+
+
 int read_data_block(long long start, unsigned int size, char *block)
 {
 	int error, res;
@@ -636,10 +789,16 @@ int read_data_block(long long start, unsigned int size, char *block)
 		"uncompressed");
 
 	if(SQUASHFS_COMPRESSED_BLOCK(size)) {
-		if(read_fs_bytes(fd, start, c_byte, data) == FALSE)
+		char *src = data;
+
+		if(fs_map) {
+			src = map_fs_bytes(start, c_byte);
+			if(src == NULL)
+				goto failed;
+		} else if(read_fs_bytes(fd, start, c_byte, data) == FALSE)
 			goto failed;
 
-		res = compressor_uncompress(comp, block, data, c_byte,
+		res = compressor_uncompress(comp, block, src, c_byte,
 			block_size, &error);
 
 		if(res == -1) {
@@ -663,29 +822,117 @@ failed:
 }
 
 
-void uncompress_inode_table(long long start, long long end)
+/*
+ * Read the length header of the metadata block at start.  The on-disk size
+ * is returned in data block format, so the block can be passed through the
+ * reader and deflator threads, along with the position of the block data
+ */
+int read_metadata_header(long long start, long long *data, unsigned int *size)
 {
-	int size = 0, bytes = 0, res;
+	unsigned short c_byte;
+	int offset = SQUASHFS_CHECK_DATA(sBlk.s.flags) ? 3 : 2;
 
-	TRACE("uncompress_inode_table: start %lld, end %lld\n", start, end);
-	while(start < end) {
-		if(size - bytes < SQUASHFS_METADATA_SIZE) {
-			inode_table = realloc(inode_table, size +=
-				SQUASHFS_METADATA_SIZE);
-			if(inode_table == NULL)
-				EXIT_UNSQUASH("Out of memory in "
-					"uncompress_inode_table");
+	if(read_fs_bytes(fd, start, 2, &c_byte) == FALSE)
+		return FALSE;
+	if(swap)
+		c_byte = (c_byte >> 8) | ((c_byte & 0xff) << 8);
+
+	*data = start + offset;
+	*size = SQUASHFS_COMPRESSED_SIZE(c_byte) | (SQUASHFS_COMPRESSED(c_byte) ?
+		0 : SQUASHFS_COMPRESSED_BIT_BLOCK);
+
+	return TRUE;
+}
+
+
+/*
+ * Decompress the chain of metadata blocks between start and end into one
+ * contiguous table.  Up to METADATA_BUFFERS blocks are queued ahead to the
+ * reader and deflator threads so they decompress in parallel, and are
+ * reassembled here in disk order
+ */
+char *uncompress_metadata(long long start, long long end,
+	struct hash_table *hash_table, char *name)
+{
+	struct cache_entry *window[METADATA_BUFFERS];
+	long long window_start[METADATA_BUFFERS];
+	int head = 0, tail = 0, queued = 0, size = 0, bytes = 0;
+	char *table = NULL;
+
+	TRACE("%s: start %lld, end %lld\n", name, start, end);
+
+	while(start < end || queued) {
+		struct cache_entry *entry;
+
+		if(start < end && queued < METADATA_BUFFERS) {
+			long long data;
+			unsigned int c_byte;
+
+			TRACE("%s: queueing block 0x%llx\n", name, start);
+			if(read_metadata_header(start, &data, &c_byte) == FALSE)
+				EXIT_UNSQUASH("%s: failed to read block "
+					"0x%llx\n", name, start);
+
+			window_start[head] = start;
+			window[head] = cache_get(metadata_cache, data, c_byte);
+			head = (head + 1) % METADATA_BUFFERS;
+			queued ++;
+			start = data + SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
+			continue;
 		}
-		TRACE("uncompress_inode_table: reading block 0x%llx\n", start);
-		add_entry(inode_table_hash, start, bytes);
-		res = read_block(fd, start, &start, inode_table + bytes);
-		if(res == 0) {
-			free(inode_table);
-			EXIT_UNSQUASH("uncompress_inode_table: failed to read "
-				"block \n");
+
+		entry = window[tail];
+		cache_block_wait(entry);
+		if(entry->error)
+			EXIT_UNSQUASH("%s: failed to read block 0x%llx\n", name,
+				window_start[tail]);
+
+		if(size - bytes < SQUASHFS_METADATA_SIZE) {
+			table = realloc(table, size += SQUASHFS_METADATA_SIZE);
+			if(table == NULL)
+				EXIT_UNSQUASH("Out of memory in %s\n", name);
 		}
-		bytes += res;
+
+		add_entry(hash_table, window_start[tail], bytes);
+		memcpy(table + bytes, entry->data, entry->bytes);
+		bytes += entry->bytes;
+		cache_block_put(entry);
+		tail = (tail + 1) % METADATA_BUFFERS;
+		queued --;
+	}
+
+	return table;
+}
+
+
+void uncompress_inode_table(long long start, long long end)
+{
+	inode_table = uncompress_metadata(start, end, &inode_table_hash,
+		"uncompress_inode_table");
+}
+
+
+void add_pseudo_def(char *pathname, char type, int mode, uid_t uid,
+	gid_t guid, long long rdev)
+{
+	char *name = pathname + pseudo_prefix;
+
+	if(*name == '\0')
+		name = "/";
+
+	if(strpbrk(name, " \t\n\r\v\f")) {
+		ERROR("add_pseudo_def: %s can't be named in a pseudo file, "
+			"its owner and mode are lost\n", pathname);
+		return;
 	}
+
+	if(type == 'm')
+		fprintf(pseudo_file, "%s m %o %u %u\n", name, mode & 07777,
+			uid, guid);
+	else
+		fprintf(pseudo_file, "%s %c %o %u %u %u %u\n", name, type,
+			mode & 07777, uid, guid, (unsigned int) (rdev >> 8) &
+			0xff, (unsigned int) rdev & 0xff);
 }
 
 
@@ -702,7 +949,11 @@ int set_attributes(char *pathname, int mode, uid_t uid, gid_t guid, time_t time,
 		return FALSE;
 	}
 
-	if(root_process) {
+	if(pseudo_file) {
+		add_pseudo_def(pathname, 'm', mode, uid, guid, 0);
+		mode = PSEUDO_MODE(mode);
+		set_mode = TRUE;
+	} else if(root_process) {
 		if(chown(pathname, uid, guid) == -1) {
 			ERROR("set_attributes: failed to change uid and gids "
 				"on %s, because %s\n", pathname,
@@ -722,68 +973,276 @@ int set_attributes(char *pathname, int mode, uid_t uid, gid_t guid, time_t time,
 }
 
 
-int write_bytes(int fd, char *buff, int bytes)
+/*
+ * Regular file attributes are set through the still open file descriptor
+ * by the writer thread once the file's data has been written, which saves
+ * the pathname lookups of set_attributes()
+ */
+int set_file_attributes(int fd, struct squashfs_file *file)
 {
-	int res, count;
+	struct timeval times[2] = { { file->time, 0 }, { file->time, 0 } };
+	int mode = file->mode;
 
-	for(count = 0; count < bytes; count += res) {
-		res = write(fd, buff + count, bytes - count);
-		if(res == -1) {
-			if(errno != EINTR) {
-				ERROR("Write on output file failed because "
-					"%s\n", strerror(errno));
-				return -1;
-			}
-			res = 0;
+	write_xattr(file->pathname, file->xattr);
+
+	STATS_ADD(attributes, 1);
+	if(futimes(fd, times) == -1) {
+		ERROR("set_attributes: failed to set time on %s, because %s\n",
+			file->pathname, strerror(errno));
+		return FALSE;
+	}
+
+	if(pseudo_file) {
+		add_pseudo_def(file->pathname, 'm', mode, file->uid, file->gid,
+			0);
+		mode = PSEUDO_MODE(mode);
+	} else if(root_process) {
+		if(fchown(fd, file->uid, file->gid) == -1) {
+			ERROR("set_attributes: failed to change uid and gids "
+				"on %s, because %s\n", file->pathname,
+				strerror(errno));
+			return FALSE;
 		}
+	} else
+		mode &= ~07000;
+
+	if((force || pseudo_file || (mode & 07000)) &&
+			fchmod(fd, (mode_t) mode) == -1) {
+		ERROR("set_attributes: failed to change mode %s, because %s\n",
+			file->pathname, strerror(errno));
+		return FALSE;
 	}
 
-	return 0;
+	return TRUE;
 }
 
 
-int lseek_broken = FALSE;
+/*
+ * The writer gathers contiguous blocks of the file being written into
+ * a batch which is written with a single pwritev().  Holes in sparse
+ * files are simply skipped, pwritev() at the following offset leaves
+ * them unallocated
+ */
+struct iovec batch_iov[WRITE_BATCH];
+struct cache_entry *batch_entry[WRITE_BATCH];
+int batch_count = 0, batch_failed;
+off_t batch_offset, batch_bytes;
 char *zero_data = NULL;
 
-int write_block(int file_fd, char *buffer, int size, long long hole, int sparse)
+void release_batch()
 {
-	off_t off = hole;
+	int i;
 
-	if(hole) {
-		if(sparse && lseek_broken == FALSE) {
-			 int error = lseek(file_fd, off, SEEK_CUR);
-			 if(error == -1)
-				/* failed to seek beyond end of file */
-				lseek_broken = TRUE;
-		}
+	for(i = 0; i < batch_count; i++)
+		if(batch_entry[i])
+			cache_block_put(batch_entry[i]);
+
+	batch_count = batch_bytes = 0;
+}
+
+
+int flush_batch(int fd)
+{
+	struct iovec *iov = batch_iov;
+	int count = batch_count, res = TRUE;
 
-		if((sparse == FALSE || lseek_broken) && zero_data == NULL) {
-			if((zero_data = malloc(block_size)) == NULL)
-				EXIT_UNSQUASH("write_block: failed to alloc "
-					"zero data block\n");
-			memset(zero_data, 0, block_size);
+	while(count) {
+		long long start = STATS_START();
+		ssize_t written = pwritev(fd, iov, count, batch_offset);
+
+		STATS_ADD(pwritevs, 1);
+		STATS_TIME(write.usecs, start);
+
+		if(written == -1) {
+			if(errno == EINTR)
+				continue;
+			ERROR("Write on output file failed because %s\n",
+				strerror(errno));
+			res = FALSE;
+			break;
 		}
 
-		if(sparse == FALSE || lseek_broken) {
-			int blocks = (hole + block_size -1) / block_size;
-			int avail_bytes, i;
-			for(i = 0; i < blocks; i++, hole -= avail_bytes) {
-				avail_bytes = hole > block_size ? block_size :
-					hole;
-				if(write_bytes(file_fd, zero_data, avail_bytes)
-						== -1)
-					goto failure;
-			}
+		batch_offset += written;
+		STATS_ADD(write.bytes_out, written);
+		while(count && written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov ++;
+			count --;
+		}
+		if(count) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
 		}
 	}
 
-	if(write_bytes(file_fd, buffer, size) == -1)
-		goto failure;
+	release_batch();
+	return res;
+}
 
-	return TRUE;
 
-failure:
-	return FALSE;
+/*
+ * Add size bytes at offset to the batch, flushing it first if it is full
+ * or the bytes don't follow on from it.  Entry (possibly NULL) is released
+ * once the batch has been written
+ */
+int batch_write(int fd, char *buffer, int size, off_t offset,
+	struct cache_entry *entry)
+{
+	int res = TRUE;
+
+	if(batch_count && (batch_count == WRITE_BATCH ||
+			batch_offset + batch_bytes != offset))
+		res = flush_batch(fd);
+
+	if(batch_count == 0) {
+		batch_offset = offset;
+		batch_bytes = 0;
+	}
+
+	batch_iov[batch_count].iov_base = buffer;
+	batch_iov[batch_count].iov_len = size;
+	batch_entry[batch_count ++] = entry;
+	batch_bytes += size;
+	STATS_ADD(write.blocks, 1);
+	STATS_ADD(write.bytes_in, size);
+
+	return res;
+}
+
+
+int write_zeros(int fd, off_t offset, long long hole)
+{
+	int res = TRUE;
+
+	if(zero_data == NULL) {
+		if((zero_data = malloc(block_size)) == NULL)
+			EXIT_UNSQUASH("write_zeros: failed to alloc zero data "
+				"block\n");
+		memset(zero_data, 0, block_size);
+	}
+
+	while(hole && res) {
+		int size = hole > block_size ? block_size : hole;
+
+		res = batch_write(fd, zero_data, size, offset, NULL);
+		offset += size;
+		hole -= size;
+	}
+
+	return res;
+}
+
+
+/*
+ * Open the -resume journal, carrying on from it if it is a journal of
+ * this filesystem, and starting it afresh otherwise
+ */
+void journal_open(char *name)
+{
+	struct journal_header header;
+	struct journal_record *record;
+	struct stat buf;
+	char *data;
+	int i, records = 0, files = 0, partial = 0;
+	off_t offset;
+
+	journal = calloc(sBlk.s.inodes, sizeof(long long));
+	if(journal == NULL)
+		EXIT_UNSQUASH("journal_open: failed to allocate journal\n");
+
+	journal_fd = open(name, O_RDWR | O_CREAT, 0644);
+	if(journal_fd == -1 || fstat(journal_fd, &buf) == -1)
+		EXIT_UNSQUASH("journal_open: failed to open %s, because %s\n",
+			name, strerror(errno));
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+	memcpy(&header.sb, &sBlk.s, sizeof(sBlk.s));
+
+	if(buf.st_size >= sizeof(header)) {
+		data = malloc(buf.st_size);
+		if(data == NULL)
+			EXIT_UNSQUASH("journal_open: failed to allocate journal"
+				"\n");
+		if(pread(journal_fd, data, buf.st_size, 0) != buf.st_size)
+			EXIT_UNSQUASH("journal_open: failed to read %s\n",
+				name);
+
+		if(memcmp(data, &header, sizeof(header)) == 0) {
+			records = (buf.st_size - sizeof(header)) /
+				sizeof(struct journal_record);
+			record = (struct journal_record *) (data +
+				sizeof(header));
+			/* the destination is there from the last run */
+			force = TRUE;
+		} else
+			ERROR("%s is the journal of another filesystem, "
+				"starting it afresh\n", name);
+
+		for(i = 0; i < records; i++, record ++)
+			if(record->inode_number && record->inode_number <=
+					sBlk.s.inodes && journal[record->
+					inode_number - 1] != JOURNAL_DONE)
+				journal[record->inode_number - 1] =
+					record->bytes;
+
+		free(data);
+	}
+
+	for(i = 0; i < sBlk.s.inodes; i++)
+		if(journal[i] == JOURNAL_DONE)
+			files ++;
+		else if(journal[i])
+			partial ++;
+
+	if(files + partial)
+		printf("Resuming from %s, %d files written and %d partly\n",
+			name, files, partial);
+
+	/* drop a record torn by the kill, or another filesystem's journal */
+	offset = sizeof(header) + (off_t) records *
+		sizeof(struct journal_record);
+	if(ftruncate(journal_fd, offset) == -1 || pwrite(journal_fd, &header,
+			sizeof(header), 0) != sizeof(header) ||
+			lseek(journal_fd, offset, SEEK_SET) == -1)
+		EXIT_UNSQUASH("journal_open: failed to write %s, because %s\n",
+			name, strerror(errno));
+}
+
+
+/*
+ * Called by the writer thread only.  A journal which can't be written is
+ * given up on, rather than the extraction
+ */
+void journal_put(unsigned int inode_number, long long bytes)
+{
+	struct journal_record record = { inode_number, 0, bytes };
+
+	if(journal_fd == -1)
+		return;
+
+	if(write(journal_fd, &record, sizeof(record)) != sizeof(record)) {
+		ERROR("journal_put: failed to write the journal, because %s, "
+			"no longer journalling\n", strerror(errno));
+		close(journal_fd);
+		journal_fd = -1;
+	}
+}
+
+
+/*
+ * The bytes of a file the journal says were written on an earlier run,
+ * all of them once it's finished
+ */
+long long journal_written(struct inode *inode)
+{
+	long long bytes;
+
+	if(journal == NULL)
+		return 0;
+
+	bytes = journal[inode->inode_number - 1];
+	return bytes == JOURNAL_DONE ? inode->data : bytes;
 }
 
 
@@ -791,20 +1250,61 @@ int write_file(struct inode *inode, char *pathname)
 {
 	unsigned int file_fd, i;
 	unsigned int *block_list;
-	int file_end = inode->data / block_size;
-	long long start = inode->start;
+	int file_end = inode->data / block_size, skip;
+	long long start = inode->start, resume = 0;
 	struct squashfs_file *file;
+	struct stat buf;
 
 	TRACE("write_file: regular file, blocks %d\n", inode->blocks);
 
-	file_fd = open(pathname, O_CREAT | O_WRONLY | (force ? O_TRUNC : 0),
-		(mode_t) inode->mode & 0777);
-	if(file_fd == -1) {
-		ERROR("write_file: failed to create file %s, because %s\n",
-			pathname, strerror(errno));
+	if(inode->frag_bytes && (unsigned int) inode->fragment >=
+			sBlk.s.fragments) {
+		ERROR("write_file: file %s has fragment %d, but there are only "
+			"%d\n", pathname, inode->fragment, sBlk.s.fragments);
 		return FALSE;
 	}
 
+	if(journal && !verify) {
+		resume = journal[inode->inode_number - 1];
+
+		/* written whole by an earlier run, if it's still there */
+		if(resume == JOURNAL_DONE) {
+			if(lstat(pathname, &buf) == 0 && S_ISREG(buf.st_mode) &&
+					buf.st_size == inode->data) {
+				if(pseudo_file)
+					add_pseudo_def(pathname, 'm',
+						inode->mode, inode->uid,
+						inode->gid, 0);
+				if(fmk_index)
+					fmk_index_file(pathname, pathname +
+						index_prefix, inode->data,
+						inode->mode);
+				return TRUE;
+			}
+			resume = 0;
+		} else if(resume < 0 || resume >= inode->data ||
+				resume & (block_size - 1))
+			resume = 0;
+	}
+
+	if(verify)
+		file_fd = -1;
+	else {
+		/* carry on writing a file an earlier run got part way through */
+		file_fd = open(pathname, O_CREAT | O_WRONLY |
+			(force && resume == 0 ? O_TRUNC : 0),
+			(mode_t) inode->mode & 0777);
+		STATS_ADD(opens, 1);
+		if(file_fd == -1) {
+			ERROR("write_file: failed to create file %s, because "
+				"%s\n", pathname, strerror(errno));
+			return FALSE;
+		}
+		if(resume && fstat(file_fd, &buf) == 0 && buf.st_size == 0)
+			resume = 0;
+	}
+	skip = resume >> block_log;
+
 	block_list = malloc(inode->blocks * sizeof(unsigned int));
 	if(block_list == NULL)
 		EXIT_UNSQUASH("write_file: unable to malloc block list\n");
@@ -822,20 +1322,28 @@ int write_file(struct inode *inode, char *pathname)
  	 */
 	file->fd = file_fd;
 	file->file_size = inode->data;
+	file->resume = resume;
+	file->inode_number = inode->inode_number;
 	file->mode = inode->mode;
 	file->gid = inode->gid;
 	file->uid = inode->uid;
 	file->time = inode->time;
 	file->pathname = strdup(pathname);
-	file->blocks = inode->blocks + (inode->frag_bytes > 0);
+	file->blocks = inode->blocks - skip + (inode->frag_bytes > 0);
 	file->sparse = inode->sparse;
 	file->xattr = inode->xattr;
 	queue_put(to_writer, file);
 
 	for(i = 0; i < inode->blocks; i++) {
 		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[i]);
-		struct file_entry *block = malloc(sizeof(struct file_entry));
+		struct file_entry *block;
+
+		if(i < skip) {
+			start += c_byte;
+			continue;
+		}
 
+		block = malloc(sizeof(struct file_entry));
 		if(block == NULL)
 			EXIT_UNSQUASH("write_file: unable to malloc file\n");
 		block->offset = 0;
@@ -870,10 +1378,61 @@ int write_file(struct inode *inode, char *pathname)
 }
 
 
+/*
+ * -verify's create_inode(), only files have anything more to check, and
+ * the data of each inode is only checked once, whatever links it has
+ */
+int verify_inode(char *pathname, struct inode *i)
+{
+	if(created_inode[i->inode_number - 1])
+		return TRUE;
+
+	switch(i->type) {
+		case SQUASHFS_FILE_TYPE:
+		case SQUASHFS_LREG_TYPE:
+			if(write_file(i, pathname) == FALSE) {
+				verify_errors ++;
+				return FALSE;
+			}
+			file_count ++;
+			break;
+		case SQUASHFS_SYMLINK_TYPE:
+		case SQUASHFS_LSYMLINK_TYPE:
+			sym_count ++;
+			break;
+ 		case SQUASHFS_BLKDEV_TYPE:
+	 	case SQUASHFS_CHRDEV_TYPE:
+ 		case SQUASHFS_LBLKDEV_TYPE:
+	 	case SQUASHFS_LCHRDEV_TYPE:
+			dev_count ++;
+			break;
+		case SQUASHFS_FIFO_TYPE:
+		case SQUASHFS_LFIFO_TYPE:
+			fifo_count ++;
+			break;
+		case SQUASHFS_SOCKET_TYPE:
+		case SQUASHFS_LSOCKET_TYPE:
+			break;
+		default:
+			ERROR("Unknown inode type %d in %s\n", i->type,
+				pathname);
+			verify_errors ++;
+			return FALSE;
+	}
+
+	created_inode[i->inode_number - 1] = strdup(pathname);
+
+	return TRUE;
+}
+
+
 int create_inode(char *pathname, struct inode *i)
 {
 	TRACE("create_inode: pathname %s\n", pathname);
 
+	if(verify)
+		return verify_inode(pathname, i);
+
 	if(created_inode[i->inode_number - 1]) {
 		TRACE("create_inode: hard link\n");
 		if(force)
@@ -914,7 +1473,10 @@ int create_inode(char *pathname, struct inode *i)
 
 			write_xattr(pathname, i->xattr);
 	
-			if(root_process) {
+			if(pseudo_file)
+				add_pseudo_def(pathname, 'm', i->mode, i->uid,
+					i->gid, 0);
+			else if(root_process) {
 				if(lchown(pathname, i->uid, i->gid) == -1)
 					ERROR("create_inode: failed to change "
 						"uid and gids on %s, because "
@@ -931,7 +1493,13 @@ int create_inode(char *pathname, struct inode *i)
 			int chrdev = i->type == SQUASHFS_CHRDEV_TYPE;
 			TRACE("create_inode: dev, rdev 0x%llx\n", i->data);
 
-			if(root_process) {
+			if(pseudo_file) {
+				/* every link of it made by mksquashfs */
+				add_pseudo_def(pathname, chrdev ? 'c' : 'b',
+					i->mode, i->uid, i->gid, i->data);
+				dev_count ++;
+				return TRUE;
+			} else if(root_process) {
 				if(force)
 					unlink(pathname);
 
@@ -990,27 +1558,8 @@ int create_inode(char *pathname, struct inode *i)
 
 void uncompress_directory_table(long long start, long long end)
 {
-	int bytes = 0, size = 0, res;
-
-	TRACE("uncompress_directory_table: start %lld, end %lld\n", start, end);
-
-	while(start < end) {
-		if(size - bytes < SQUASHFS_METADATA_SIZE) {
-			directory_table = realloc(directory_table, size +=
-				SQUASHFS_METADATA_SIZE);
-			if(directory_table == NULL)
-				EXIT_UNSQUASH("Out of memory in "
-					"uncompress_directory_table\n");
-		}
-		TRACE("uncompress_directory_table: reading block 0x%llx\n",
-				start);
-		add_entry(directory_table_hash, start, bytes);
-		res = read_block(fd, start, &start, directory_table + bytes);
-		if(res == 0)
-			EXIT_UNSQUASH("uncompress_directory_table: failed to "
-				"read block\n");
-		bytes += res;
-	}
+	directory_table = uncompress_metadata(start, end, &directory_table_hash,
+		"uncompress_directory_table");
 }
 
 
@@ -1055,6 +1604,8 @@ void free_path(struct pathname *paths)
 {
 	int i;
 
+	path_matcher_free(paths->matcher);
+
 	for(i = 0; i < paths->names; i++) {
 		if(paths->name[i].paths)
 			free_path(paths->name[i].paths);
@@ -1085,6 +1636,7 @@ struct pathname *add_path(struct pathname *paths, char *target, char *alltarget)
 
 		paths->names = 0;
 		paths->name = NULL;
+		paths->matcher = NULL;
 	}
 
 	for(i = 0; i < paths->names; i++)
@@ -1095,6 +1647,8 @@ struct pathname *add_path(struct pathname *paths, char *target, char *alltarget)
 		/*
 		 * allocate new name entry
 		 */
+		path_matcher_free(paths->matcher);
+		paths->matcher = NULL;
 		paths->names ++;
 		paths->name = realloc(paths->name, (i + 1) *
 			sizeof(struct path_entry));
@@ -1203,13 +1757,23 @@ int matches(struct pathnames *paths, char *name, struct pathnames **new)
 
 	for(n = 0; n < paths->count; n++) {
 		struct pathname *path = paths->path[n];
-		for(i = 0; i < path->names; i++) {
-			int match = use_regex ?
-				regexec(path->name[i].preg, name, (size_t) 0,
-				NULL, 0) == 0 : fnmatch(path->name[i].name,
-				name, FNM_PATHNAME|FNM_PERIOD|FNM_EXTMATCH) ==
-				0;
-			if(match && path->name[i].paths == NULL)
+		int match[path->names], m, matches = 0;
+
+		if(use_regex) {
+			for(i = 0; i < path->names; i++)
+				if(regexec(path->name[i].preg, name, (size_t) 0,
+						NULL, 0) == 0)
+					match[matches ++] = i;
+		} else {
+			if(path->matcher == NULL && (path->matcher =
+					path_matcher_init(path)) == NULL)
+				EXIT_UNSQUASH("Out of memory in matches\n");
+			matches = path_match(path->matcher, name, match);
+		}
+
+		for(m = 0; m < matches; m++) {
+			i = match[m];
+			if(path->name[i].paths == NULL)
 				/*
 				 * match on a leaf component, any subdirectories
 				 * will implicitly match, therefore return an
@@ -1217,13 +1781,12 @@ int matches(struct pathnames *paths, char *name, struct pathnames **new)
 				 */
 				goto empty_set;
 
-			if(match)
-				/*
-				 * match on a non-leaf component, add any
-				 * subdirectories to the new set of
-				 * subdirectories to scan for this name
-				 */
-				*new = add_subdir(*new, path->name[i].paths);
+			/*
+			 * match on a non-leaf component, add any
+			 * subdirectories to the new set of
+			 * subdirectories to scan for this name
+			 */
+			*new = add_subdir(*new, path->name[i].paths);
 		}
 	}
 
@@ -1253,6 +1816,43 @@ empty_set:
 }
 
 
+/*
+ * Returns TRUE if every extract name is a literal name rather than a
+ * wildcard or regular expression, in which case directories can be
+ * searched by name rather than scanned
+ */
+int literal_path(struct pathname *paths)
+{
+	int i;
+
+	if(use_regex)
+		return FALSE;
+
+	for(i = 0; i < paths->names; i++) {
+		if(strpbrk(paths->name[i].name, "*?[\\") ||
+				strstr(paths->name[i].name, "(") ||
+				strcmp(paths->name[i].name, ".") == 0 ||
+				strcmp(paths->name[i].name, "..") == 0)
+			return FALSE;
+		if(paths->name[i].paths &&
+				literal_path(paths->name[i].paths) == FALSE)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+struct dir *open_dir(unsigned int start_block, unsigned int offset,
+	struct inode **i, struct pathnames *paths)
+{
+	if(paths && lookup_paths)
+		return s_ops.squashfs_lookup(start_block, offset, i, paths);
+
+	return s_ops.squashfs_opendir(start_block, offset, i);
+}
+
+
 void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 	struct pathnames *paths)
 {
@@ -1260,7 +1860,7 @@ void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 	char *name, pathname[1024];
 	struct pathnames *new;
 	struct inode *i;
-	struct dir *dir = s_ops.squashfs_opendir(start_block, offset, &i);
+	struct dir *dir = open_dir(start_block, offset, &i, paths);
 
 	while(squashfs_readdir(dir, &name, &start_block, &offset, &type)) {
 		struct inode *i;
@@ -1282,7 +1882,8 @@ void pre_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 				if(created_inode[i->inode_number - 1] == NULL) {
 					created_inode[i->inode_number - 1] =
 						(char *) i;
-					total_blocks += (i->data +
+					total_blocks += (i->data -
+						journal_written(i) +
 						(block_size - 1)) >> block_log;
 				}
 				total_files ++;
@@ -1304,12 +1905,13 @@ void dir_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 	char *name, pathname[1024];
 	struct pathnames *new;
 	struct inode *i;
-	struct dir *dir = s_ops.squashfs_opendir(start_block, offset, &i);
+	struct dir *dir = open_dir(start_block, offset, &i, paths);
 
 	if(lsonly || info)
 		print_filename(parent_name, i);
 
-	if(!lsonly && mkdir(parent_name, (mode_t) dir->mode) == -1 &&
+	if(!lsonly && !verify && mkdir(parent_name, (mode_t) (pseudo_file ?
+			PSEUDO_MODE(dir->mode) : dir->mode)) == -1 &&
 			(!force || errno != EEXIST)) {
 		ERROR("dir_scan: failed to make directory %s, because %s\n",
 			parent_name, strerror(errno));
@@ -1348,7 +1950,7 @@ void dir_scan(char *parent_name, unsigned int start_block, unsigned int offset,
 		free_subdir(new);
 	}
 
-	if(!lsonly)
+	if(!lsonly && !verify)
 		set_attributes(parent_name, dir->mode, dir->uid, dir->guid,
 			dir->mtime, dir->xattr, force);
 
@@ -1447,16 +2049,179 @@ void squashfs_stat(char *source)
 		TRACE("sBlk.guid_start 0x%llx\n", sBlk.guid_start);
 	}
 
-	if(sBlk.s.s_major > 1)
-		TRACE("sBlk.s.fragment_table_start 0x%llx\n\n",
-			sBlk.s.fragment_table_start);
+	if(sBlk.s.s_major > 1)
+		TRACE("sBlk.s.fragment_table_start 0x%llx\n\n",
+			sBlk.s.fragment_table_start);
+}
+
+
+/*
+ * Try comp on the first metadata block, it must decompress to a full
+ * block, or to the whole inode table when that is a single block
+ */
+int probe_comp(struct compressor *comp, char *src, int c_byte, int last)
+{
+	char block[SQUASHFS_METADATA_SIZE];
+	int error, res;
+
+	if(comp == NULL || !comp->supported || comp->uncompress == NULL)
+		return FALSE;
+
+	res = compressor_uncompress(comp, block, src, c_byte,
+		SQUASHFS_METADATA_SIZE, &error);
+
+	return res == SQUASHFS_METADATA_SIZE || (last && res > 0);
+}
+
+
+/*
+ * Read the first metadata block of the inode table, returns its compressed
+ * size, 0 if it is stored uncompressed, or -1 if it can't be read.  last is
+ * set if it's the whole inode table
+ */
+int read_first_block(char *buffer, int *last)
+{
+	unsigned short c_byte;
+	long long start = sBlk.s.inode_table_start;
+	int offset = SQUASHFS_CHECK_DATA(sBlk.s.flags) ? 3 : 2;
+
+	if(read_fs_bytes(fd, start, 2, &c_byte) == FALSE)
+		return -1;
+	if(swap)
+		c_byte = (c_byte >> 8) | ((c_byte & 0xff) << 8);
+
+	if(!SQUASHFS_COMPRESSED(c_byte))
+		return 0;
+
+	c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
+	if(c_byte == 0 || c_byte > SQUASHFS_METADATA_SIZE ||
+			read_fs_bytes(fd, start + offset, c_byte, buffer) == FALSE)
+		return -1;
+	*last = start + offset + c_byte == sBlk.s.directory_table_start;
+
+	return c_byte;
+}
+
+
+/*
+ * The decompressor of the first metadata block: the superblock's choice
+ * first, then every decompressor built in, then the block by block
+ * LZMA/zlib of the sqlzma forks and the size-less LZMA of the Broadcom
+ * forks.  NULL if none of them decompresses it
+ */
+struct compressor *trial_comp(char *buffer, int c_byte, int last)
+{
+	struct compressor *try;
+	int id;
+
+	if(probe_comp(comp, buffer, c_byte, last))
+		return comp;
+	for(id = 1; (try = lookup_compressor_id(id))->id; id++)
+		if(probe_comp(try, buffer, c_byte, last))
+			return try;
+	if(probe_comp(&sqlzma_comp_ops, buffer, c_byte, last))
+		return &sqlzma_comp_ops;
+	if(probe_comp(&lzma_nosize_comp_ops, buffer, c_byte, last))
+		return &lzma_nosize_comp_ops;
+
+	return NULL;
+}
+
+
+/*
+ * Identify the filesystem variant from the superblock and the first
+ * metadata block, so scripts can pick the right tools without trying
+ * every unsquashfs in turn.  Prints shell variable assignments and
+ * returns 0 if this unsquashfs can extract the filesystem, 2 if the
+ * compressor was only identified from its LZMA header, 1 otherwise
+ */
+int probe_fs(char *source)
+{
+	char buffer[SQUASHFS_METADATA_SIZE], *endian;
+	unsigned char *props = (unsigned char *) buffer;
+	int c_byte, last;
+	struct compressor *found = NULL;
+
+#if __BYTE_ORDER == __BIG_ENDIAN
+	endian = sBlk.s.s_major == 4 || swap ? "little" : "big";
+#else
+	endian = sBlk.s.s_major == 4 || !swap ? "little" : "big";
+#endif
+
+	printf("SQUASHFS_VERSION=%d.%d\n", sBlk.s.s_major, sBlk.s.s_minor);
+	printf("SQUASHFS_ENDIAN=%s\n", endian);
+	printf("SQUASHFS_BLOCK_SIZE=%d\n", sBlk.s.block_size);
+
+	c_byte = read_first_block(buffer, &last);
+	if(c_byte == -1)
+		goto failed;
+
+	if(c_byte == 0)
+		/* nothing to trial, go by the superblock */
+		found = comp;
+	else
+		found = trial_comp(buffer, c_byte, last);
+
+	if(found) {
+		printf("SQUASHFS_COMP=%s\n", found->name);
+		return 0;
+	}
+
+	/*
+	 * Nothing here decompresses it.  A valid LZMA properties byte (lc, lp
+	 * and pb) followed by a 32-bit dictionary size that's a power of two
+	 * is LZMA with a header this unsquashfs doesn't read, as written by
+	 * the vendor forks that drop the 8 byte uncompressed size
+	 */
+	if(c_byte > 5 && props[0] < 9 * 5 * 5) {
+		unsigned int dict = props[1] | (props[2] << 8) |
+			(props[3] << 16) | (props[4] << 24);
+
+		if(dict && (dict & (dict - 1)) == 0) {
+			printf("SQUASHFS_COMP=%s\n", props[9] || props[10] ||
+				props[11] || props[12] ? "lzma-nosize" :
+				"lzma");
+			return 2;
+		}
+	}
+
+	printf("SQUASHFS_COMP=unknown\n");
+	return 1;
+
+failed:
+	ERROR("Failed to read the first metadata block of %s\n", source);
+	return 1;
 }
 
 
+/*
+ * Magics of the 1.x, 2.x and 3.x filesystems, and the decompressor for
+ * each.  Those formats only defined gzip, the LZMA magic is written by
+ * the sqlzma mksquashfs forks.  Another vendor variant is supported by
+ * adding its magic and decompressor here, or to trial_comp() if it kept
+ * the standard magic
+ */
+static struct legacy_format {
+	unsigned int	magic;
+	int		swap;
+	char		*comp;
+} legacy_format[] = {
+	{ SQUASHFS_MAGIC, FALSE, "gzip" },
+	{ SQUASHFS_MAGIC_SWAP, TRUE, "gzip" },
+	{ SQUASHFS_MAGIC_LZMA, FALSE, "sqlzma" },
+	{ SQUASHFS_MAGIC_LZMA_SWAP, TRUE, "sqlzma" },
+	{ 0, FALSE, NULL }
+};
+
+
 int read_super(char *source)
 {
 	squashfs_super_block_3 sBlk_3;
 	struct squashfs_super_block sBlk_4;
+	struct legacy_format *format;
+	struct compressor *found;
+	char buffer[SQUASHFS_METADATA_SIZE];
+	int c_byte, last;
 
 	/*
 	 * Try to read a Squashfs 4 superblock
@@ -1476,6 +2241,7 @@ int read_super(char *source)
 		s_ops.read_block_list = read_block_list_2;
 		s_ops.read_inode = read_inode_4;
 		s_ops.read_uids_guids = read_uids_guids_4;
+		s_ops.squashfs_lookup = squashfs_lookup_4;
 		memcpy(&sBlk, &sBlk_4, sizeof(sBlk_4));
 
 		/*
@@ -1499,22 +2265,22 @@ int read_super(char *source)
 	/*
 	 * Check it is a SQUASHFS superblock
 	 */
-	swap = 0;
-	if(sBlk_3.s_magic != SQUASHFS_MAGIC && 
-			sBlk_3.s_magic != SQUASHFS_MAGIC_LZMA) {
-		if(sBlk_3.s_magic == SQUASHFS_MAGIC_SWAP || 
-				sBlk_3.s_magic == SQUASHFS_MAGIC_LZMA_SWAP) {
-			squashfs_super_block_3 sblk;
-			ERROR("Reading a different endian SQUASHFS filesystem "
-				"on %s\n", source);
-			SQUASHFS_SWAP_SUPER_BLOCK_3(&sblk, &sBlk_3);
-			memcpy(&sBlk_3, &sblk, sizeof(squashfs_super_block_3));
-			swap = 1;
-		} else  {
-			ERROR("Can't find a SQUASHFS superblock on %s\n",
-				source);
-			goto failed_mount;
-		}
+	for(format = legacy_format; format->magic; format++)
+		if(sBlk_3.s_magic == format->magic)
+			break;
+
+	if(format->magic == 0) {
+		ERROR("Can't find a SQUASHFS superblock on %s\n", source);
+		goto failed_mount;
+	}
+
+	swap = format->swap;
+	if(swap) {
+		squashfs_super_block_3 sblk;
+		ERROR("Reading a different endian SQUASHFS filesystem on %s\n",
+			source);
+		SQUASHFS_SWAP_SUPER_BLOCK_3(&sblk, &sBlk_3);
+		memcpy(&sBlk_3, &sblk, sizeof(squashfs_super_block_3));
 	}
 
 	sBlk.s.s_magic = sBlk_3.s_magic;
@@ -1578,13 +2344,20 @@ int read_super(char *source)
 		goto failed_mount;
 	}
 
+	comp = strcmp(format->comp, sqlzma_comp_ops.name) == 0 ?
+		&sqlzma_comp_ops : lookup_compressor(format->comp);
+
 	/*
-	 * 1.x, 2.x and 3.x filesystems use gzip compression.
+	 * Some vendor forks kept the standard magic but not zlib, the HG55x
+	 * firmware compresses with sqlzma and the Broadcom nb4 with size-less
+	 * LZMA.  Go by what decompresses the first metadata block, if that
+	 * isn't the magic's decompressor.  An LZMA block is read as sqlzma,
+	 * which also reads the zlib blocks those forks fall back to
 	 */
-	if (sBlk.s.s_magic == SQUASHFS_MAGIC_LZMA)
-		comp = lookup_compressor("lzma");
-	else
-		comp = lookup_compressor("gzip");
+	c_byte = read_first_block(buffer, &last);
+	if(c_byte > 0 && (found = trial_comp(buffer, c_byte, last)))
+		comp = found == lookup_compressor("lzma") ? &sqlzma_comp_ops :
+			found;
 
 	return TRUE;
 
@@ -1593,6 +2366,53 @@ failed_mount:
 }
 
 
+/*
+ * Give the compressor the -dict dictionary, and the options stored after
+ * a 4.0 superblock, which say what the data needs to be decompressed.
+ * The sqlzma 4.0 forks don't store compressor options.  Only gzip's are
+ * read, for the preset dictionary, those of the other compressors aren't
+ * needed to decompress and are skipped as they always were
+ */
+int read_compressor_options(char *source)
+{
+	char buffer[SQUASHFS_METADATA_SIZE];
+	int bytes = 0;
+
+	if(dict_file) {
+		char *args[] = { "-Xdict", dict_file };
+		int res = compressor_options(comp, args, 2);
+
+		if(res == -1)
+			ERROR("%s compression doesn't use a preset "
+				"dictionary\n", comp->name);
+		if(res < 0)
+			return FALSE;
+	}
+
+	if(sBlk.s.s_major != 4 || sBlk.s.s_magic == SQUASHFS_MAGIC_LZMA ||
+			comp->id != ZLIB_COMPRESSION)
+		return TRUE;
+
+	if(SQUASHFS_COMP_OPTS(sBlk.s.flags)) {
+		bytes = read_block(fd, sizeof(struct squashfs_super_block), NULL,
+			buffer);
+		if(bytes == 0) {
+			ERROR("Failed to read the compressor options of %s\n",
+				source);
+			return FALSE;
+		}
+	}
+
+	if(compressor_extract_options(comp, sBlk.s.block_size, buffer,
+			bytes) == -1) {
+		ERROR("Compressor failed to set compressor options\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
 struct pathname *process_extract_files(struct pathname *path, char *filename)
 {
 	FILE *fd;
@@ -1619,9 +2439,41 @@ void *reader(void *arg)
 {
 	while(1) {
 		struct cache_entry *entry = queue_get(to_reader);
-		int res = read_fs_bytes(fd, entry->block,
-			SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
-			entry->data);
+		int res;
+
+		entry->bytes = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size);
+		if(entry->bytes > entry->cache->buffer_size) {
+			ERROR("reader: block @0x%llx larger than buffer\n",
+				entry->block);
+			cache_block_ready(entry, TRUE);
+			continue;
+		}
+
+		if(fs_map) {
+			/*
+			 * nothing to read, compressed blocks are decompressed
+			 * from the mapping by the deflate threads, and
+			 * uncompressed blocks are used in place
+			 */
+			char *src = map_fs_bytes(entry->block,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size));
+
+			if(src && !SQUASHFS_COMPRESSED_BLOCK(entry->size))
+				entry->data = src;
+			res = src != NULL;
+		} else {
+			long long start = STATS_START();
+
+			res = read_fs_bytes(fd, entry->block,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
+				entry->data);
+			STATS_TIME(read.usecs, start);
+		}
+
+		STATS_ADD(read.blocks, 1);
+		STATS_ADD(read.bytes_in, entry->bytes);
+		if(!SQUASHFS_COMPRESSED_BLOCK(entry->size))
+			STATS_ADD(read.bytes_out, entry->bytes);
 
 		if(res && SQUASHFS_COMPRESSED_BLOCK(entry->size))
 			/*
@@ -1641,6 +2493,80 @@ void *reader(void *arg)
 }
 
 
+/*
+ * Get the next block queued by write_file().  Blocks already queued are
+ * batched, the batch is only written out when the writer would otherwise
+ * block, so the cache buffers it holds can never starve the reader
+ */
+struct file_entry *get_file_block(int fd)
+{
+	struct file_entry *block;
+
+	if(queue_get_nowait(to_writer, (void **) &block))
+		return block;
+
+	if(batch_count && flush_batch(fd) == FALSE)
+		batch_failed = TRUE;
+
+	return queue_get(to_writer);
+}
+
+
+/*
+ * -verify's writer, which waits for each of the file's blocks, read and
+ * decompressed ahead of it by the reader and deflator threads as for an
+ * extraction.  A data block must decompress to exactly the bytes the file
+ * has in it, a fragment to at least the end of the file's part of it
+ */
+void verify_file(struct squashfs_file *file)
+{
+	unsigned long long hash[2] = { 0, 0 };
+	int i, failed = FALSE;
+
+	for(i = 0; i < file->blocks; i++, cur_blocks ++) {
+		struct file_entry *block = queue_get(to_writer);
+		struct cache_entry *buffer = block->buffer;
+
+		if(buffer == NULL) { /* sparse file */
+			if(verify_hash)
+				content_hash_block(hash, zero_block,
+					block->size);
+			free(block);
+			continue;
+		}
+
+		cache_block_wait(buffer);
+
+		if(failed == FALSE && (buffer->error ||
+				(buffer->cache == data_cache ?
+				buffer->bytes != block->size :
+				buffer->bytes < block->offset + block->size))) {
+			ERROR("verify: %s block %d is corrupt\n",
+				file->pathname + verify_prefix, i);
+			failed = TRUE;
+		}
+
+		if(verify_hash && failed == FALSE)
+			content_hash_block(hash, buffer->data + block->offset,
+				block->size);
+
+		cache_block_put(buffer);
+		free(block);
+	}
+
+	if(failed)
+		verify_failed ++;
+	else if(verify_hash) {
+		content_hash_final(hash, file->file_size);
+		printf("%016llx%016llx  %s\n", hash[0], hash[1],
+			file->pathname + verify_prefix);
+	}
+
+	free(file->pathname);
+	free(file);
+}
+
+
 /*
  * writer thread.  This processes file write requests queued by the
  * write_file() routine.
@@ -1653,20 +2579,33 @@ void *writer(void *arg)
 		struct squashfs_file *file = queue_get(to_writer);
 		int file_fd;
 		long long hole = 0;
+		off_t offset, journalled;
 		int failed = FALSE;
-		int error;
+		long long fmk_start;
+		struct fmk_index_hash hash;
 
 		if(file == NULL) {
 			queue_put(from_writer, NULL);
 			continue;
 		}
 
+		if(verify) {
+			verify_file(file);
+			continue;
+		}
+
 		TRACE("writer: regular file, blocks %d\n", file->blocks);
 
 		file_fd = file->fd;
+		offset = journalled = file->resume;
+		batch_failed = FALSE;
+		/* a file carried on from -resume is hashed from the disk */
+		if(fmk_index && file->resume == 0)
+			fmk_index_start(&hash);
+		FMK_STAGE_BEGIN(write_file, fmk_start);
 
 		for(i = 0; i < file->blocks; i++, cur_blocks ++) {
-			struct file_entry *block = queue_get(to_writer);
+			struct file_entry *block = get_file_block(file_fd);
 
 			if(block->buffer == 0) { /* sparse file */
 				hole += block->size;
@@ -1676,60 +2615,102 @@ void *writer(void *arg)
 
 			cache_block_wait(block->buffer);
 
-			if(block->buffer->error)
+			if(block->buffer->error || batch_failed)
 				failed = TRUE;
 
-			if(failed)
+			if(failed) {
+				cache_block_put(block->buffer);
+				free(block);
 				continue;
+			}
+
+			if(hole && file->sparse == FALSE &&
+					write_zeros(file_fd, offset, hole) ==
+					FALSE)
+				failed = TRUE;
+			offset += hole;
+
+			if(fmk_index && file->resume == 0) {
+				fmk_index_zeros(&hash, hole);
+				fmk_index_data(&hash, block->buffer->data +
+					block->offset, block->size);
+			}
 
-			error = write_block(file_fd, block->buffer->data +
-				block->offset, block->size, hole, file->sparse);
+			if(batch_write(file_fd, block->buffer->data +
+					block->offset, block->size, offset,
+					block->buffer) == FALSE)
+				failed = TRUE;
 
-			if(error == FALSE) {
+			if(failed)
 				ERROR("writer: failed to write data block %d\n",
 					i);
-				failed = TRUE;
-			}
 
+			offset += block->size;
 			hole = 0;
-			cache_block_put(block->buffer);
 			free(block);
+
+			if(journal_fd != -1 && failed == FALSE &&
+					offset - journalled >= JOURNAL_INTERVAL) {
+				if(flush_batch(file_fd) == FALSE)
+					failed = TRUE;
+				else {
+					journalled = offset & ~((off_t)
+						block_size - 1);
+					journal_put(file->inode_number,
+						journalled);
+				}
+			}
 		}
 
 		if(hole && failed == FALSE) {
 			/*
 			 * corner case for hole extending to end of file
 			 */
-			if(file->sparse == FALSE ||
-					lseek(file_fd, hole, SEEK_CUR) == -1) {
-				/*
-				 * for files which we don't want to write
-				 * sparsely, or for broken lseeks which cannot
-				 * seek beyond end of file, write_block will do
-				 * the right thing
-				 */
-				hole --;
-				if(write_block(file_fd, "\0", 1, hole,
-						file->sparse) == FALSE) {
-					ERROR("writer: failed to write sparse "
-						"data block\n");
-					failed = TRUE;
-				}
-			} else if(ftruncate(file_fd, file->file_size) == -1) {
-				ERROR("writer: failed to write sparse data "
-					"block\n");
-				failed = TRUE;
+			if(file->sparse == FALSE)
+				failed = write_zeros(file_fd, offset, hole) ==
+					FALSE;
+			else {
+				STATS_ADD(ftruncates, 1);
+				if(ftruncate(file_fd, file->file_size) == -1)
+					/*
+					 * filesystems which can't extend a
+					 * file by truncation get the last
+					 * byte written
+					 */
+					failed = batch_write(file_fd, "\0", 1,
+						file->file_size - 1, NULL) ==
+						FALSE;
 			}
 		}
 
-		close(file_fd);
+		if(failed)
+			release_batch();
+		else if(batch_count && flush_batch(file_fd) == FALSE)
+			failed = TRUE;
+
 		if(failed == FALSE)
-			set_attributes(file->pathname, file->mode, file->uid,
-				file->gid, file->time, file->xattr, force);
-		else {
+			set_file_attributes(file_fd, file);
+		close(file_fd);
+		if(failed == FALSE && fmk_index) {
+			if(file->resume)
+				fmk_index_file(file->pathname, file->pathname +
+					index_prefix, file->file_size,
+					file->mode);
+			else {
+				fmk_index_zeros(&hash, hole);
+				fmk_index_add(&hash, file->pathname +
+					index_prefix, file->file_size,
+					file->mode);
+			}
+		}
+		STATS_ADD(closes, 1);
+		FMK_STAGE_END(write_file, fmk_start, file->file_size,
+			failed ? 0 : file->file_size);
+		if(failed) {
 			ERROR("Failed to write %s, skipping\n", file->pathname);
 			unlink(file->pathname);
-		}
+		} else
+			journal_put(file->inode_number, JOURNAL_DONE);
 		free(file->pathname);
 		free(file);
 
@@ -1737,26 +2718,173 @@ void *writer(void *arg)
 }
 
 
+/*
+ * Persistent block cache (-block-cache).  Decompressed data blocks and
+ * fragments are stored in <dir>/<compressor>/<xx>/<key>, where the key
+ * is derived from the compressed bytes, so a block which is unchanged
+ * between two filesystem images is only decompressed once
+ */
+void block_cache_key(char *pathname, char *source, int size)
+{
+	unsigned long long fnv = 0xcbf29ce484222325ULL, djb = 5381;
+	int i;
+
+	/*
+	 * two unrelated 64-bit hashes and the compressed size make an
+	 * accidental collision vanishingly unlikely
+	 */
+	for(i = 0; i < size; i++) {
+		unsigned char c = source[i];
+
+		fnv = (fnv ^ c) * 0x100000001b3ULL;
+		djb = ((djb << 5) + djb) ^ c;
+	}
+
+	sprintf(pathname, "%s/%s/%02x/%016llx%016llx-%x", block_cache_dir,
+		comp->name, (unsigned int) (fnv >> 56), fnv, djb, size);
+}
+
+
+int block_cache_lookup(char *pathname, char *dest, int avail)
+{
+	int res, count = 0, cache_fd = open(pathname, O_RDONLY);
+
+	if(cache_fd == -1)
+		return -1;
+
+	while(count < avail) {
+		res = read(cache_fd, dest + count, avail - count);
+		if(res == 0)
+			break;
+		if(res == -1) {
+			if(errno == EINTR)
+				continue;
+			count = -1;
+			break;
+		}
+		count += res;
+	}
+
+	close(cache_fd);
+	return count;
+}
+
+
+void block_cache_store(char *pathname, char *data, int size)
+{
+	char tmp[strlen(pathname) + 8], *dir = strrchr(pathname, '/');
+	int cache_fd, res, count;
+
+	*dir = '\0';
+	if(mkdir(pathname, 0755) == -1 && errno == ENOENT) {
+		char *comp_dir = strrchr(pathname, '/');
+
+		*comp_dir = '\0';
+		mkdir(pathname, 0755);
+		*comp_dir = '/';
+		mkdir(pathname, 0755);
+	}
+	*dir = '/';
+
+	/*
+	 * write to a temporary and rename it into place, so concurrent
+	 * runs never see a partially written block
+	 */
+	sprintf(tmp, "%s.XXXXXX", pathname);
+	cache_fd = mkstemp(tmp);
+	if(cache_fd == -1) {
+		TRACE("block_cache_store: failed to create %s, because %s\n",
+			tmp, strerror(errno));
+		return;
+	}
+
+	for(count = 0; count < size; count += res) {
+		res = write(cache_fd, data + count, size - count);
+		if(res == -1) {
+			if(errno == EINTR) {
+				res = 0;
+				continue;
+			}
+			break;
+		}
+	}
+
+	if(close(cache_fd) == -1 || count < size || rename(tmp, pathname) == -1)
+		unlink(tmp);
+}
+
+
 /*
  * decompress thread.  This decompresses buffers queued by the read thread
  */
 void *deflator(void *arg)
 {
-	char tmp[block_size];
+	char tmp[block_size > SQUASHFS_METADATA_SIZE ? block_size :
+		SQUASHFS_METADATA_SIZE];
+	void *stream = compressor_uncompress_init(comp, block_size);
 
 	while(1) {
 		struct cache_entry *entry = queue_get(to_deflate);
-		int error, res;
+		char pathname[block_cache_dir ? strlen(block_cache_dir) +
+			strlen(comp->name) + 48 : 1];
+		int error, res, cached = block_cache_dir &&
+			entry->cache != metadata_cache;
+		long long start = STATS_START(), fmk_start;
+
+		if(cached) {
+			block_cache_key(pathname, fs_map ? fs_map + entry->block :
+				entry->data,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size));
+			res = block_cache_lookup(pathname, tmp,
+				entry->cache->buffer_size);
+			if(res > 0) {
+				memcpy(entry->data, tmp, res);
+				entry->bytes = res;
+				STATS_ADD(block_cache.blocks, 1);
+				STATS_ADD(block_cache.bytes_in,
+					SQUASHFS_COMPRESSED_SIZE_BLOCK(
+					entry->size));
+				STATS_ADD(block_cache.bytes_out, res);
+				STATS_TIME(block_cache.usecs, start);
+				cache_block_ready(entry, FALSE);
+				continue;
+			}
+		}
 
-		res = compressor_uncompress(comp, tmp, entry->data,
-			SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size), block_size,
-			&error);
+		FMK_STAGE_BEGIN(decompress_block, fmk_start);
+		if(fs_map)
+			/*
+			 * source is the mapping, decompress directly into the
+			 * cache buffer
+			 */
+			res = compressor_uncompress_stream(comp, stream,
+				entry->data, fs_map + entry->block,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
+				entry->cache->buffer_size, &error);
+		else
+			res = compressor_uncompress_stream(comp, stream, tmp,
+				entry->data,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
+				entry->cache->buffer_size, &error);
+		FMK_STAGE_END(decompress_block, fmk_start,
+			SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size),
+			res == -1 ? 0 : res);
 
 		if(res == -1)
 			ERROR("%s uncompress failed with error code %d\n",
 				comp->name, error);
-		else
-			memcpy(entry->data, tmp, res);
+		else {
+			if(!fs_map)
+				memcpy(entry->data, tmp, res);
+			entry->bytes = res;
+			STATS_TIME(deflate.usecs, start);
+			STATS_ADD(deflate.blocks, 1);
+			STATS_ADD(deflate.bytes_in,
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size));
+			STATS_ADD(deflate.bytes_out, res);
+			if(cached)
+				block_cache_store(pathname, entry->data, res);
+		}
 
 		/*
 		 * block has been either successfully decompressed, or an error
@@ -1815,7 +2943,8 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 {
 	int i;
 	sigset_t sigmask, old_mask;
-	int all_buffers_size = fragment_buffer_size + data_buffer_size;
+	int all_buffers_size = fragment_buffer_size + data_buffer_size +
+		METADATA_BUFFERS;
 
 	sigemptyset(&sigmask);
 	sigaddset(&sigmask, SIGINT);
@@ -1826,27 +2955,8 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 #ifdef __CYGWIN__
 	processors = atoi(getenv("NUMBER_OF_PROCESSORS"));
 #else
-	if(processors == -1) {
-#ifndef linux
-		int mib[2];
-		size_t len = sizeof(processors);
-
-		mib[0] = CTL_HW;
-#ifdef HW_AVAILCPU
-		mib[1] = HW_AVAILCPU;
-#else
-		mib[1] = HW_NCPU;
-#endif
-
-		if(sysctl(mib, 2, &processors, &len, NULL, 0) == -1) {
-			ERROR("Failed to get number of available processors.  "
-				"Defaulting to 1\n");
-			processors = 1;
-		}
-#else
-		processors = sysconf(_SC_NPROCESSORS_ONLN);
-#endif
-	}
+	if(processors == -1)
+		processors = available_processors();
 #endif /* __CYGWIN__ */
 
 	thread = malloc((3 + processors) * sizeof(pthread_t));
@@ -1858,8 +2968,13 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 	to_deflate = queue_init(all_buffers_size);
 	to_writer = queue_init(1000);
 	from_writer = queue_init(1);
-	fragment_cache = cache_init(block_size, fragment_buffer_size);
-	data_cache = cache_init(block_size, data_buffer_size);
+	if(to_reader == NULL || to_deflate == NULL || to_writer == NULL ||
+			from_writer == NULL)
+		EXIT_UNSQUASH("Out of memory in queue_init\n");
+	fragment_cache = cache_init(block_size, fragment_buffer_size,
+		CACHE_SHARDS);
+	data_cache = cache_init(block_size, data_buffer_size, CACHE_SHARDS);
+	metadata_cache = cache_init(SQUASHFS_METADATA_SIZE, METADATA_BUFFERS, 1);
 	pthread_create(&thread[0], NULL, reader, NULL);
 	pthread_create(&thread[1], NULL, writer, NULL);
 	pthread_create(&thread[2], NULL, progress_thread, NULL);
@@ -1871,8 +2986,13 @@ void initialise_threads(int fragment_buffer_size, int data_buffer_size)
 			EXIT_UNSQUASH("Failed to create thread\n");
 	}
 
-	printf("Parallel unsquashfs: Using %d processor%s\n", processors,
-			processors == 1 ? "" : "s");
+	if(stats)
+		stats_init(to_reader, to_deflate, to_writer);
+
+	/* -ls0 and -ls-json output is only the listing */
+	if(list_format == LIST_HUMAN)
+		printf("Parallel unsquashfs: Using %d processor%s\n",
+			processors, processors == 1 ? "" : "s");
 
 	if(sigprocmask(SIG_SETMASK, &old_mask, NULL) == -1)
 		EXIT_UNSQUASH("Failed to set signal mask in intialise_threads"
@@ -1972,18 +3092,57 @@ void progress_bar(long long current, long long max, int columns)
 	printf("MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the"\
 		"\n");\
 	printf("GNU General Public License for more details.\n");
+/*
+ * -verify, decompress every fragment block, including any no file uses.
+ * Those the files used are mostly still in the fragment cache, the rest are
+ * fetched ahead so the deflator threads decompress them in parallel
+ */
+void verify_fragments(int buffers)
+{
+	struct cache_entry *ahead[VERIFY_FRAGMENTS_AHEAD];
+	int i, n = buffers < VERIFY_FRAGMENTS_AHEAD ? buffers :
+		VERIFY_FRAGMENTS_AHEAD;
+	unsigned int fragments = s_ops.read_fragment ? sBlk.s.fragments : 0;
+
+	for(i = 0; i < fragments + n; i++) {
+		if(i >= n) {
+			struct cache_entry *entry = ahead[i % n];
+
+			cache_block_wait(entry);
+			if(entry->error) {
+				ERROR("verify: fragment %d is corrupt\n",
+					i - n);
+				verify_errors ++;
+			}
+			cache_block_put(entry);
+		}
+
+		if(i < fragments) {
+			long long start;
+			int size;
+
+			s_ops.read_fragment(i, &start, &size);
+			ahead[i % n] = cache_get(fragment_cache, start, size);
+		}
+	}
+}
+
+
 int main(int argc, char *argv[])
 {
 	char *dest = "squashfs-root";
-	int i, stat_sys = FALSE, version = FALSE;
+	char *pseudo_name = NULL, *journal_name = NULL;
+	int i, stat_sys = FALSE, probe = FALSE, version = FALSE;
 	int n;
 	struct pathnames *paths = NULL;
 	struct pathname *path = NULL;
 	int fragment_buffer_size = FRAGMENT_BUFFER_DEFAULT;
 	int data_buffer_size = DATA_BUFFER_DEFAULT;
+	int use_mmap = FALSE;
 	char *b;
 
 	pthread_mutex_init(&screen_mutex, NULL);
+	fmk_stats_init("unsquashfs");
 	root_process = geteuid() == 0;
 	if(root_process)
 		umask(0);
@@ -2066,7 +3225,15 @@ int main(int argc, char *argv[])
 		else if(strcmp(argv[i], "-stat") == 0 ||
 				strcmp(argv[i], "-s") == 0)
 			stat_sys = TRUE;
-		else if(strcmp(argv[i], "-lls") == 0 ||
+		else if(strcmp(argv[i], "-probe") == 0)
+			probe = TRUE;
+		else if(strcmp(argv[i], "-ls0") == 0) {
+			lsonly = TRUE;
+			list_format = LIST_NUL;
+		} else if(strcmp(argv[i], "-ls-json") == 0) {
+			lsonly = TRUE;
+			list_format = LIST_JSON;
+		} else if(strcmp(argv[i], "-lls") == 0 ||
 				strcmp(argv[i], "-ll") == 0) {
 			lsonly = TRUE;
 			short_ls = FALSE;
@@ -2085,13 +3252,59 @@ int main(int argc, char *argv[])
 		} else if(strcmp(argv[i], "-regex") == 0 ||
 				strcmp(argv[i], "-r") == 0)
 			use_regex = TRUE;
+		else if(strcmp(argv[i], "-mmap") == 0 ||
+				strcmp(argv[i], "-m") == 0)
+			use_mmap = TRUE;
+		else if(strcmp(argv[i], "-stats") == 0)
+			stats = STATS_TEXT;
+		else if(strcmp(argv[i], "-stats-json") == 0)
+			stats = STATS_JSON;
+		else if(strcmp(argv[i], "-block-cache") == 0 ||
+				strcmp(argv[i], "-bc") == 0) {
+			if(++i == argc) {
+				fprintf(stderr, "%s: -block-cache missing "
+					"directory\n", argv[0]);
+				exit(1);
+			}
+			block_cache_dir = argv[i];
+		} else if(strcmp(argv[i], "-dict") == 0) {
+			if(++i == argc) {
+				fprintf(stderr, "%s: -dict missing dictionary\n",
+					argv[0]);
+				exit(1);
+			}
+			dict_file = argv[i];
+		} else if(strcmp(argv[i], "-pf") == 0) {
+			if(++i == argc) {
+				fprintf(stderr, "%s: -pf missing filename\n",
+					argv[0]);
+				exit(1);
+			}
+			pseudo_name = argv[i];
+		} else if(strcmp(argv[i], "-resume") == 0) {
+			if(++i == argc) {
+				fprintf(stderr, "%s: -resume missing journal\n",
+					argv[0]);
+				exit(1);
+			}
+			journal_name = argv[i];
+		} else if(strcmp(argv[i], "-verify") == 0)
+			verify = TRUE;
+		else if(strcmp(argv[i], "-verify-hash") == 0)
+			verify = verify_hash = TRUE;
 		else
 			goto options;
 	}
 
-	if(lsonly || info)
+	if(lsonly || info || verify_hash)
 		progress = FALSE;
 
+	if(verify && lsonly) {
+		ERROR("%s: -verify can't be used with -ls or -lls\n",
+			argv[0]);
+		exit(1);
+	}
+
 #ifdef SQUASHFS_TRACE
 	progress = FALSE;
 #endif
@@ -2124,10 +3337,18 @@ options:
 			ERROR("\t-ll[s]\t\t\tlist filesystem with file "
 				"attributes (like\n");
 			ERROR("\t\t\t\tls -l output), but don't unsquash\n");
+			ERROR("\t-ls0\t\t\tlist filesystem with each name "
+				"followed by\n\t\t\t\ta NUL, for xargs -0\n");
+			ERROR("\t-ls-json\t\tlist filesystem as one JSON "
+				"object per file\n\t\t\t\twith its "
+				"attributes\n");
 			ERROR("\t-f[orce]\t\tif file already exists then "
 				"overwrite\n");
 			ERROR("\t-s[tat]\t\t\tdisplay filesystem superblock "
 				"information\n");
+			ERROR("\t-probe\t\t\tidentify the filesystem variant "
+				"and compressor,\n\t\t\t\tprinted as shell "
+				"variables\n");
 			ERROR("\t-e[f] <extract file>\tlist of directories or "
 				"files to extract.\n\t\t\t\tOne per line\n");
 			ERROR("\t-da[ta-queue] <size>\tSet data queue to "
@@ -2140,6 +3361,34 @@ options:
 				"regular expressions\n");
 			ERROR("\t\t\t\trather than use the default shell "
 				"wildcard\n\t\t\t\texpansion (globbing)\n");
+			ERROR("\t-m[map]\t\t\tmap the filesystem into memory "
+				"and use blocks\n\t\t\t\tin place rather "
+				"than reading them\n");
+			ERROR("\t-stats\t\t\tafter unsquashing, report per "
+				"stage throughput,\n\t\t\t\tqueue occupancy "
+				"and cache hit rates\n");
+			ERROR("\t-stats-json\t\tas -stats, but report in "
+				"JSON\n");
+			ERROR("\t-bc|-block-cache <dir>\tkeep decompressed blocks "
+				"in <dir> and reuse\n\t\t\t\tthem when "
+				"extracting other filesystems\n");
+			ERROR("\t-dict <dictionary>\tthe preset dictionary the "
+				"filesystem was\n\t\t\t\tcompressed with "
+				"(mksquashfs -Xdict)\n");
+			ERROR("\t-pf <pseudo-file>\twrite owners, set-id bits "
+				"and devices to\n\t\t\t\t<pseudo-file> for "
+				"mksquashfs -pf, rather\n\t\t\t\tthan set them, "
+				"so root isn't needed\n");
+			ERROR("\t-resume <journal>\tjournal the files written "
+				"to <journal>,\n\t\t\t\tand skip those a "
+				"killed run with the\n\t\t\t\tsame journal "
+				"had written\n");
+			ERROR("\t-verify\t\t\tdecompress and check all the "
+				"filesystem's data\n\t\t\t\tand metadata, but "
+				"don't unsquash.  Exits\n\t\t\t\tnon-zero if "
+				"it's corrupt\n");
+			ERROR("\t-verify-hash\t\tas -verify, and print each "
+				"file's content\n\t\t\t\thash\n");
 			ERROR("\nDecompressors available:\n");
 			display_compressors("", "");
 		}
@@ -2155,6 +3404,27 @@ options:
 		exit(1);
 	}
 
+	if(block_cache_dir && mkdir(block_cache_dir, 0755) == -1 &&
+			errno != EEXIST) {
+		ERROR("Could not create block cache %s, because %s\n",
+			block_cache_dir, strerror(errno));
+		exit(1);
+	}
+
+	if(use_mmap) {
+		struct stat buf;
+
+		if(fstat(fd, &buf) == -1)
+			EXIT_UNSQUASH("Could not stat %s, because %s\n",
+				argv[i], strerror(errno));
+
+		fs_map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if(fs_map == MAP_FAILED)
+			EXIT_UNSQUASH("Could not mmap %s, because %s\n",
+				argv[i], strerror(errno));
+		fs_map_size = buf.st_size;
+	}
+
 	if(read_super(argv[i]) == FALSE)
 		exit(1);
 
@@ -2163,6 +3433,9 @@ options:
 		exit(0);
 	}
 
+	if(probe)
+		exit(probe_fs(argv[i]));
+
 	if(!comp->supported) {
 		ERROR("Filesystem uses %s compression, this is "
 			"unsupported by this version\n", comp->name);
@@ -2171,6 +3444,9 @@ options:
 		exit(1);
 	}
 
+	if(read_compressor_options(argv[i]) == FALSE)
+		exit(1);
+
 	block_size = sBlk.s.block_size;
 	block_log = sBlk.s.block_log;
 
@@ -2196,23 +3472,46 @@ options:
 
 	memset(created_inode, 0, sBlk.s.inodes * sizeof(char *));
 
+	if(journal_name && !lsonly && !verify)
+		journal_open(journal_name);
+
+	if(!lsonly && !verify) {
+		fmk_index_init("unsquashfs", argv[i]);
+		index_prefix = strlen(dest);
+	}
+
 	if(s_ops.read_uids_guids() == FALSE)
 		EXIT_UNSQUASH("failed to uid/gid table\n");
 
-	if(s_ops.read_fragment_table() == FALSE)
-		EXIT_UNSQUASH("failed to read fragment table\n");
+	/*
+	 * Listing a 4.0 filesystem, or extracting only literally named
+	 * files from it, only needs the inodes and directories actually
+	 * walked, so rather than decompressing the whole inode and
+	 * directory tables read metadata blocks on demand through a small
+	 * LRU.  Directories on the extract paths are then searched by name
+	 */
+	lookup_paths = path && s_ops.squashfs_lookup && literal_path(path);
+	lazy_metadata = (lsonly && sBlk.s.s_major == 4) || lookup_paths;
 
-	uncompress_inode_table(sBlk.s.inode_table_start,
-		sBlk.s.directory_table_start);
+	if(lazy_metadata == FALSE) {
+		uncompress_inode_table(sBlk.s.inode_table_start,
+			sBlk.s.directory_table_start);
+
+		uncompress_directory_table(sBlk.s.directory_table_start,
+			sBlk.s.fragment_table_start);
+	}
 
-	uncompress_directory_table(sBlk.s.directory_table_start,
-		sBlk.s.fragment_table_start);
+	/* fragments and xattrs aren't needed when listing */
+	if(lsonly == FALSE || lazy_metadata == FALSE) {
+		if(s_ops.read_fragment_table() == FALSE)
+			EXIT_UNSQUASH("failed to read fragment table\n");
 
-	if(no_xattrs)
-		sBlk.s.xattr_id_table_start = SQUASHFS_INVALID_BLK;
+		if(no_xattrs)
+			sBlk.s.xattr_id_table_start = SQUASHFS_INVALID_BLK;
 
-	if(read_xattrs_from_disk(fd, &sBlk.s) == 0)
-		EXIT_UNSQUASH("failed to read the xattr table\n");
+		if(read_xattrs_from_disk(fd, &sBlk.s) == 0)
+			EXIT_UNSQUASH("failed to read the xattr table\n");
+	}
 
 	if(path) {
 		paths = init_subdir();
@@ -2225,25 +3524,65 @@ options:
 	memset(created_inode, 0, sBlk.s.inodes * sizeof(char *));
 	inode_number = 1;
 
-	printf("%d inodes (%d blocks) to write\n\n", total_inodes,
-		total_inodes - total_files + total_blocks);
+	if(list_format == LIST_HUMAN)
+		printf("%d inodes (%d blocks) to write\n\n", total_inodes,
+			total_inodes - total_files + total_blocks);
 
 	if(progress)
 		enable_progress_bar();
 
+	if(verify_hash) {
+		zero_block = calloc(1, block_size);
+		if(zero_block == NULL)
+			EXIT_UNSQUASH("failed to allocate zero_block\n");
+	}
+	verify_prefix = strlen(dest) + 1;
+
+	if(pseudo_name && !lsonly && !verify) {
+		pseudo_file = fopen(pseudo_name, "w");
+		if(pseudo_file == NULL)
+			EXIT_UNSQUASH("failed to open pseudo file %s, because "
+				"%s\n", pseudo_name, strerror(errno));
+		pseudo_prefix = strlen(dest);
+	}
+
 	dir_scan(dest, SQUASHFS_INODE_BLK(sBlk.s.root_inode),
 		SQUASHFS_INODE_OFFSET(sBlk.s.root_inode), paths);
+	list_flush();
 
 	queue_put(to_writer, NULL);
 	queue_get(from_writer);
 
+	if(verify && paths == NULL)
+		verify_fragments(fragment_buffer_size);
+
+	if(journal_fd != -1)
+		close(journal_fd);
+
+	if(pseudo_file && fclose(pseudo_file) == EOF)
+		EXIT_UNSQUASH("failed to write pseudo file %s, because %s\n",
+			pseudo_name, strerror(errno));
+
+	cache_stats(data_cache, "data");
+	cache_stats(fragment_cache, "fragment");
+
 	if(progress) {
 		disable_progress_bar();
 		progress_bar(sym_count + dev_count + fifo_count + cur_blocks,
 			total_inodes - total_files + total_blocks, columns);
 	}
 
-	if(!lsonly) {
+	if(verify) {
+		printf("\n");
+		printf("verified %d files\n", file_count);
+		printf("verified %d directories\n", dir_count);
+		printf("verified %d symlinks\n", sym_count);
+		printf("verified %d devices\n", dev_count);
+		printf("verified %d fifos\n", fifo_count);
+		if(verify_errors + verify_failed)
+			printf("%d errors, %d of them corrupt files\n",
+				verify_errors + verify_failed, verify_failed);
+	} else if(!lsonly) {
 		printf("\n");
 		printf("created %d files\n", file_count);
 		printf("created %d directories\n", dir_count);
@@ -2252,5 +3591,8 @@ options:
 		printf("created %d fifos\n", fifo_count);
 	}
 
-	return 0;
+	if(stats)
+		stats_report(comp, data_cache, fragment_cache, metadata_cache);
+
+	return verify_errors + verify_failed ? 1 : 0;
 }
@@ -44,6 +44,7 @@
 #include <math.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #ifndef linux
 #ifndef __CYGWIN__
@@ -67,6 +68,7 @@
 #endif
 
 #include "squashfs_fs.h"
+#include "pathmatch.h"
 
 #ifdef SQUASHFS_TRACE
 #define TRACE(s, args...) \
@@ -112,10 +114,21 @@ struct super_block {
 	long long		guid_start;
 };
 
+/*
+ * Where each metadata block of the inode or directory table starts in the
+ * decompressed table, found by its position on disk.  The table is open
+ * addressed, a power of two in size and never more than half full, so
+ * lookups don't chase pointers and adding a block rarely allocates
+ */
 struct hash_table_entry {
 	long long	start;
 	int		bytes;
-	struct hash_table_entry *next;
+};
+
+struct hash_table {
+	struct hash_table_entry	*entry;
+	unsigned int		size;
+	unsigned int		used;
 };
 
 struct inode {
@@ -137,6 +150,8 @@ struct inode {
 	unsigned int xattr;
 };
 
+struct pathnames;
+
 typedef struct squashfs_operations {
 	struct dir *(*squashfs_opendir)(unsigned int block_start,
 		unsigned int offset, struct inode **i);
@@ -148,6 +163,10 @@ typedef struct squashfs_operations {
 	struct inode *(*read_inode)(unsigned int start_block,
 		unsigned int offset);
 	int (*read_uids_guids)();
+	/* optional, open a directory returning only the entries named */
+	struct dir *(*squashfs_lookup)(unsigned int block_start,
+		unsigned int offset, struct inode **i,
+		struct pathnames *paths);
 } squashfs_operations;
 
 struct test {
@@ -158,26 +177,65 @@ struct test {
 };
 
 
-/* Cache status struct.  Caches are used to keep
-  track of memory buffers passed between different threads */
-struct cache {
+/* maximum number of independently locked partitions in a cache */
+#define CACHE_SHARDS	16
+
+#define CACHE_SHARD(cache, block) \
+	(&(cache)->shard[CALCULATE_HASH(block) & ((cache)->shards - 1)])
+#define CACHE_BUCKET(cache, block) \
+	(CALCULATE_HASH(block) >> (cache)->shard_bits)
+
+/* Cache shard struct.  Each shard owns a slice of the cache's buffers
+  and hash buckets, protected by its own mutex */
+struct cache_shard {
 	int	max_buffers;
 	int	count;
-	int	buffer_size;
 	int	wait_free;
 	int	wait_pending;
 	pthread_mutex_t	mutex;
 	pthread_cond_t wait_for_free;
 	pthread_cond_t wait_for_pending;
 	struct cache_entry *free_list;
-	struct cache_entry *hash_table[65536];
+	struct cache_entry **hash_table;
+	long long hits;
+	long long misses;
+	long long waits;
+};
+
+/* Cache status struct.  Caches are used to keep
+  track of memory buffers passed between different threads */
+struct cache {
+	int	buffer_size;
+	int	shards;
+	int	shard_bits;
+	struct cache_shard shard[CACHE_SHARDS];
+};
+
+/* number of decompressed metadata blocks kept when listing lazily */
+#define LAZY_METADATA_BLOCKS 32
+
+/* decompressed metadata block held in the lazy listing LRU */
+struct metadata_block {
+	long long	start;
+	long long	next;
+	int		length;
+	unsigned int	tick;
+	char		data[SQUASHFS_METADATA_SIZE];
+};
+
+/* position of a read in the chain of metadata blocks */
+struct metadata_cursor {
+	long long	block;
+	int		offset;
 };
 
 /* struct describing a cache entry passed between threads */
 struct cache_entry {
 	struct cache *cache;
+	struct cache_shard *shard;
 	long long block;
 	int	size;
+	int	bytes;
 	int	used;
 	int error;
 	int	pending;
@@ -185,25 +243,55 @@ struct cache_entry {
 	struct cache_entry *hash_prev;
 	struct cache_entry *free_next;
 	struct cache_entry *free_prev;
+	char *buffer;
 	char *data;
 };
 
-/* struct describing queues used to pass data between threads */
-struct queue {
-	int	size;
-	int	readp;
-	int	writep;
-	pthread_mutex_t	mutex;
-	pthread_cond_t empty;
-	pthread_cond_t full;
-	void **data;
-};
-
 /* default size of fragment buffer in Mbytes */
 #define FRAGMENT_BUFFER_DEFAULT 256
 /* default size of data buffer in Mbytes */
 #define DATA_BUFFER_DEFAULT 256
 
+/* number of metadata blocks decompressed ahead of the table being built */
+#define METADATA_BUFFERS 64
+
+/* maximum number of buffers the writer gathers into one pwritev() */
+#define WRITE_BATCH 64
+
+/* -stats */
+#define STATS_NONE		0
+#define STATS_TEXT		1
+#define STATS_JSON		2
+#define STATS_HIST_BUCKETS	16
+#define STATS_SAMPLE_USECS	1000
+
+#define STATS_ADD(field, value) \
+	do { \
+		if(stats) \
+			__sync_fetch_and_add(&stats_count.field, value); \
+	} while(0)
+#define STATS_START()	(stats ? stats_usecs() : 0)
+#define STATS_TIME(field, start) STATS_ADD(field, stats_usecs() - (start))
+
+struct stage_stats {
+	long long	blocks;
+	long long	bytes_in;
+	long long	bytes_out;
+	long long	usecs;
+};
+
+struct stats {
+	struct stage_stats	read;
+	struct stage_stats	deflate;
+	struct stage_stats	block_cache;
+	struct stage_stats	write;
+	long long		opens;
+	long long		pwritevs;
+	long long		ftruncates;
+	long long		attributes;
+	long long		closes;
+};
+
 #define DIR_ENT_SIZE	16
 
 struct dir_ent	{
@@ -235,6 +323,9 @@ struct squashfs_file {
 	int fd;
 	int blocks;
 	long long file_size;
+	/* the bytes written by an earlier -resume run, blocks starts there */
+	long long resume;
+	unsigned int inode_number;
 	int mode;
 	uid_t uid;
 	gid_t gid;
@@ -244,41 +335,48 @@ struct squashfs_file {
 	unsigned int xattr;
 };
 
-struct path_entry {
-	char *name;
-	regex_t *preg;
-	struct pathname *paths;
-};
-
-struct pathname {
-	int names;
-	struct path_entry *name;
-};
-
-struct pathnames {
-	int count;
-	struct pathname *path[0];
-};
-#define PATHS_ALLOC_SIZE 10
 
 /* globals */
 extern struct super_block sBlk;
 extern squashfs_operations s_ops;
 extern int swap;
 extern char *inode_table, *directory_table;
-extern struct hash_table_entry *inode_table_hash[65536],
-	*directory_table_hash[65536];
+extern struct hash_table inode_table_hash, directory_table_hash;
 extern unsigned int *uid_table, *guid_table;
 extern pthread_mutex_t screen_mutex;
 extern int progress_enabled;
 extern int inode_number;
 extern int lookup_type[];
 extern int fd;
+extern int lazy_metadata;
+extern int info, short_ls;
 
 /* unsquashfs.c */
-extern int lookup_entry(struct hash_table_entry **, long long);
+extern int lookup_entry(struct hash_table *, long long);
+extern char *modestr(char *, int);
+extern void *map_fs_bytes(long long, int);
 extern int read_fs_bytes(int fd, long long, int, void *);
 extern int read_block(int, long long, long long *, void *);
+extern int read_metadata(struct metadata_cursor *, void *, int, int);
+
+/* unsquashfs_stats.c */
+struct queue;
+struct compressor;
+extern int stats;
+extern struct stats stats_count;
+extern long long stats_usecs();
+extern void stats_init(struct queue *, struct queue *, struct queue *);
+extern void stats_report(struct compressor *, struct cache *, struct cache *,
+	struct cache *);
+
+/* unsquashfs_list.c, the -ls formats */
+#define LIST_HUMAN	0
+#define LIST_NUL	1
+#define LIST_JSON	2
+
+extern int list_format;
+extern int print_filename(char *, struct inode *);
+extern void list_flush();
 
 /* unsquash-1.c */
 extern void read_block_list_1(unsigned int *, char *, int);
@@ -305,6 +403,8 @@ extern struct dir *squashfs_opendir_3(unsigned int, unsigned int,
 extern int read_fragment_table_4();
 extern void read_fragment_4(unsigned int, long long *, int *);
 extern struct inode *read_inode_4(unsigned int, unsigned int);
+extern struct dir *squashfs_lookup_4(unsigned int, unsigned int,
+	struct inode **, struct pathnames *);
 extern struct dir *squashfs_opendir_4(unsigned int, unsigned int,
 	struct inode **);
 extern int read_uids_guids_4();
@@ -0,0 +1,359 @@
+/*
+ * Unsquash a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * unsquashfs_list.c
+ *
+ * The -ls, -lls and -info output.  Listing big filesystems was mostly
+ * spent in getpwuid(), getgrgid() and localtime() for every file, so
+ * the names are looked up once per uid and gid, the date is formatted
+ * once per time, and the lines are gathered in a buffer written a chunk
+ * at a time.  -ls0 and -ls-json are for programs reading the listing.
+ */
+
+#include "unsquashfs.h"
+
+#define LIST_BUFFER_SIZE	(256 * 1024)
+#define ID_NAME_HASH		256
+#define TOTALCHARS		25
+
+struct id_name {
+	unsigned int	id;
+	char		*name;
+	struct id_name	*next;
+};
+
+int list_format = LIST_HUMAN;
+
+static char list_buffer[LIST_BUFFER_SIZE];
+static int list_bytes, line_flush = -1;
+static struct id_name *user_names[ID_NAME_HASH], *group_names[ID_NAME_HASH];
+
+
+static void write_out(char *buffer, int bytes)
+{
+	while(bytes) {
+		int res = write(STDOUT_FILENO, buffer, bytes);
+
+		if(res == -1) {
+			if(errno == EINTR)
+				continue;
+			EXIT_UNSQUASH("failed to write the listing, because "
+				"%s\n", strerror(errno));
+		}
+		buffer += res;
+		bytes -= res;
+	}
+}
+
+
+void list_flush()
+{
+	int bytes = list_bytes;
+
+	/* anything printf()ed earlier goes first */
+	fflush(stdout);
+
+	list_bytes = 0;
+	write_out(list_buffer, bytes);
+}
+
+
+static void list_write(char *data, int bytes)
+{
+	if(line_flush == -1) {
+		/* the lines are still seen as they come on a terminal */
+		line_flush = info || isatty(STDOUT_FILENO);
+		atexit(list_flush);
+	}
+
+	if(list_bytes + bytes > LIST_BUFFER_SIZE) {
+		list_flush();
+		if(bytes > LIST_BUFFER_SIZE) {
+			write_out(data, bytes);
+			return;
+		}
+	}
+
+	memcpy(list_buffer + list_bytes, data, bytes);
+	list_bytes += bytes;
+}
+
+
+static void list_str(char *str)
+{
+	list_write(str, strlen(str));
+}
+
+
+static void list_chr(char c)
+{
+	list_write(&c, 1);
+}
+
+
+static void list_pad(int chars)
+{
+	static char spaces[] = "                                ";
+
+	for(; chars > 0; chars -= sizeof(spaces) - 1)
+		list_write(spaces, chars < sizeof(spaces) - 1 ? chars :
+			sizeof(spaces) - 1);
+}
+
+
+/* as printf("%*lld") */
+static void list_num(long long num, int width)
+{
+	char buffer[24];
+	int i = sizeof(buffer);
+	unsigned long long n = num < 0 ? -(unsigned long long) num : num;
+
+	do
+		buffer[--i] = '0' + n % 10;
+	while(n /= 10);
+	if(num < 0)
+		buffer[--i] = '-';
+
+	list_pad(width - (int) (sizeof(buffer) - i));
+	list_write(buffer + i, sizeof(buffer) - i);
+}
+
+
+static void list_end(char terminator)
+{
+	list_chr(terminator);
+	if(line_flush)
+		list_flush();
+}
+
+
+static char *id_name(struct id_name *hash[], unsigned int id, int group)
+{
+	struct id_name *entry;
+	char *name = NULL, number[12];
+
+	for(entry = hash[id % ID_NAME_HASH]; entry; entry = entry->next)
+		if(entry->id == id)
+			return entry->name;
+
+	if(group) {
+		struct group *gr = getgrgid(id);
+
+		if(gr)
+			name = gr->gr_name;
+	} else {
+		struct passwd *pw = getpwuid(id);
+
+		if(pw)
+			name = pw->pw_name;
+	}
+
+	if(name == NULL) {
+		sprintf(number, "%d", (int) id);
+		name = number;
+	}
+
+	entry = malloc(sizeof(struct id_name));
+	if(entry == NULL || (entry->name = strdup(name)) == NULL)
+		EXIT_UNSQUASH("Out of memory in id_name\n");
+	entry->id = id;
+	entry->next = hash[id % ID_NAME_HASH];
+	hash[id % ID_NAME_HASH] = entry;
+
+	return entry->name;
+}
+
+
+/*
+ * Files in a filesystem mostly share a few times, often only one, so the
+ * last date is kept rather than converted again
+ */
+static char *date_str(time_t time)
+{
+	static char date[64];
+	static time_t last_time;
+	static int valid = FALSE;
+	struct tm *t;
+
+	if(valid && time == last_time)
+		return date;
+
+	t = localtime(&time);
+	if(t == NULL)
+		sprintf(date, "%lld", (long long) time);
+	else
+		sprintf(date, "%d-%02d-%02d %02d:%02d", t->tm_year + 1900,
+			t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min);
+
+	last_time = time;
+	valid = TRUE;
+	return date;
+}
+
+
+static void list_json_str(char *string)
+{
+	unsigned char *s = (unsigned char *) string;
+	char escape[8];
+
+	list_chr('"');
+	for(; *s; s++)
+		if(*s == '"' || *s == '\\') {
+			list_chr('\\');
+			list_chr(*s);
+		} else if(*s < 0x20) {
+			sprintf(escape, "\\u%04x", *s);
+			list_str(escape);
+		} else
+			list_chr(*s);
+	list_chr('"');
+}
+
+
+static char *type_name(int mode)
+{
+	switch(mode & S_IFMT) {
+	case S_IFREG:
+		return "file";
+	case S_IFDIR:
+		return "dir";
+	case S_IFLNK:
+		return "symlink";
+	case S_IFBLK:
+		return "block";
+	case S_IFCHR:
+		return "char";
+	case S_IFIFO:
+		return "fifo";
+	default:
+		return "socket";
+	}
+}
+
+
+/*
+ * One JSON object per line, the numbers as they're stored, and the
+ * names as they are, so they're only valid UTF-8 if the filesystem's were
+ */
+static void print_json(char *pathname, struct inode *inode)
+{
+	list_str("{\"path\": ");
+	list_json_str(pathname);
+	list_str(", \"type\": \"");
+	list_str(type_name(inode->mode));
+	list_str("\", \"mode\": ");
+	list_num(inode->mode & 07777, 0);
+	list_str(", \"uid\": ");
+	list_num(inode->uid, 0);
+	list_str(", \"gid\": ");
+	list_num(inode->gid, 0);
+
+	switch(inode->mode & S_IFMT) {
+	case S_IFCHR:
+	case S_IFBLK:
+		list_str(", \"major\": ");
+		list_num((int) inode->data >> 8, 0);
+		list_str(", \"minor\": ");
+		list_num((int) inode->data & 0xff, 0);
+		break;
+	default:
+		list_str(", \"size\": ");
+		list_num(inode->data, 0);
+	}
+
+	list_str(", \"mtime\": ");
+	list_num(inode->time, 0);
+	if((inode->mode & S_IFMT) == S_IFLNK) {
+		list_str(", \"target\": ");
+		list_json_str(inode->symlink);
+	}
+	list_chr('}');
+	list_end('\n');
+}
+
+
+int print_filename(char *pathname, struct inode *inode)
+{
+	char str[11], *userstr, *groupstr;
+	int padchars;
+
+	if(list_format == LIST_NUL) {
+		list_str(pathname);
+		list_end('\0');
+		return 1;
+	}
+
+	if(list_format == LIST_JSON) {
+		print_json(pathname, inode);
+		return 1;
+	}
+
+	if(short_ls) {
+		list_str(pathname);
+		list_end('\n');
+		return 1;
+	}
+
+	userstr = id_name(user_names, inode->uid, FALSE);
+	groupstr = id_name(group_names, inode->gid, TRUE);
+
+	list_str(modestr(str, inode->mode));
+	list_chr(' ');
+	list_str(userstr);
+	list_chr('/');
+	list_str(groupstr);
+	list_chr(' ');
+
+	switch(inode->mode & S_IFMT) {
+		case S_IFREG:
+		case S_IFDIR:
+		case S_IFSOCK:
+		case S_IFIFO:
+		case S_IFLNK:
+			padchars = TOTALCHARS - strlen(userstr) -
+				strlen(groupstr);
+
+			list_num(inode->data, padchars);
+			list_chr(' ');
+			break;
+		case S_IFCHR:
+		case S_IFBLK:
+			padchars = TOTALCHARS - strlen(userstr) -
+				strlen(groupstr) - 7;
+
+			list_pad(padchars > 1 ? padchars : 1);
+			list_num((int) inode->data >> 8, 3);
+			list_chr(',');
+			list_num((int) inode->data & 0xff, 3);
+			list_chr(' ');
+			break;
+	}
+
+	list_str(date_str(inode->time));
+	list_chr(' ');
+	list_str(pathname);
+	if((inode->mode & S_IFMT) == S_IFLNK) {
+		list_str(" -> ");
+		list_str(inode->symlink);
+	}
+	list_end('\n');
+
+	return 1;
+}
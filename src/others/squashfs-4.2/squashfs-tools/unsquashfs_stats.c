@@ -0,0 +1,236 @@
+/*
+ * Unsquash a squashfs filesystem.  This is a highly compressed read only
+ * filesystem.
+ *
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * unsquashfs_stats.c
+ *
+ * Throughput instrumentation for -stats.  The pipeline threads add to the
+ * counters in struct stats, and a sampling thread records how full the
+ * queues between the threads are, so the report shows which stage the
+ * extraction is waiting on.
+ */
+
+#include "unsquashfs.h"
+#include "compressor.h"
+#include "queue.h"
+
+int stats = STATS_NONE;
+struct stats stats_count;
+
+static struct queue_stats {
+	char			*name;
+	struct queue		*queue;
+	long long		samples;
+	long long		hist[STATS_HIST_BUCKETS];
+} queue_stats[3];
+
+static long long start_usecs;
+
+
+long long stats_usecs()
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+
+/*
+ * Bucket 0 counts samples where the queue was empty, bucket n samples
+ * holding 2^(n-1) to 2^n - 1 entries
+ */
+static int hist_bucket(int entries)
+{
+	int bucket = 0;
+
+	while(entries && bucket < STATS_HIST_BUCKETS - 1) {
+		entries >>= 1;
+		bucket ++;
+	}
+
+	return bucket;
+}
+
+
+static void *sample_thread(void *arg)
+{
+	struct timespec interval = { 0, STATS_SAMPLE_USECS * 1000 };
+	int i;
+
+	while(1) {
+		nanosleep(&interval, NULL);
+
+		for(i = 0; i < 3; i++) {
+			queue_stats[i].hist[hist_bucket(queue_count(
+				queue_stats[i].queue))] ++;
+			queue_stats[i].samples ++;
+		}
+	}
+
+	return NULL;
+}
+
+
+void stats_init(struct queue *to_reader, struct queue *to_deflate,
+	struct queue *to_writer)
+{
+	pthread_t thread;
+
+	queue_stats[0].name = "to_reader";
+	queue_stats[0].queue = to_reader;
+	queue_stats[1].name = "to_deflate";
+	queue_stats[1].queue = to_deflate;
+	queue_stats[2].name = "to_writer";
+	queue_stats[2].queue = to_writer;
+
+	start_usecs = stats_usecs();
+
+	if(pthread_create(&thread, NULL, sample_thread, NULL) != 0)
+		EXIT_UNSQUASH("Failed to create stats thread\n");
+}
+
+
+static void cache_totals(struct cache *cache, long long *hits,
+	long long *misses, long long *waits)
+{
+	int i;
+
+	*hits = *misses = *waits = 0;
+	if(cache == NULL)
+		return;
+
+	for(i = 0; i < cache->shards; i++) {
+		*hits += cache->shard[i].hits;
+		*misses += cache->shard[i].misses;
+		*waits += cache->shard[i].waits;
+	}
+}
+
+
+static double rate(long long bytes, long long usecs)
+{
+	return usecs ? bytes / (double) usecs : 0;
+}
+
+
+static void stage_report(char *name, struct stage_stats *stage, int json,
+	int last)
+{
+	if(json)
+		printf("    \"%s\": { \"blocks\": %lld, \"bytes_in\": %lld, "
+			"\"bytes_out\": %lld, \"usecs\": %lld }%s\n", name,
+			stage->blocks, stage->bytes_in, stage->bytes_out,
+			stage->usecs, last ? "" : ",");
+	else
+		printf("  %-12s %10lld blocks %14lld bytes in %14lld bytes "
+			"out %10.3f s %8.1f MB/s\n", name, stage->blocks,
+			stage->bytes_in, stage->bytes_out,
+			stage->usecs / 1000000.0, rate(stage->bytes_out,
+			stage->usecs));
+}
+
+
+static void queue_report(struct queue_stats *q, int json, int last)
+{
+	int i, top;
+
+	for(top = STATS_HIST_BUCKETS; top > 1 && q->hist[top - 1] == 0; top--);
+
+	if(json) {
+		printf("    \"%s\": { \"samples\": %lld, \"histogram\": [",
+			q->name, q->samples);
+		for(i = 0; i < top; i++)
+			printf("%s%lld", i ? ", " : " ", q->hist[i]);
+		printf(" ] }%s\n", last ? "" : ",");
+		return;
+	}
+
+	printf("  %-12s", q->name);
+	for(i = 0; i < top; i++)
+		printf(" %d%s:%.0f%%", i ? 1 << (i - 1) : 0, i ? "+" : "",
+			q->samples ? q->hist[i] * 100.0 / q->samples : 0);
+	printf("\n");
+}
+
+
+static void cache_report(char *name, struct cache *cache, int json, int last)
+{
+	long long hits, misses, waits;
+
+	cache_totals(cache, &hits, &misses, &waits);
+
+	if(json)
+		printf("    \"%s\": { \"hits\": %lld, \"misses\": %lld, "
+			"\"waits\": %lld }%s\n", name, hits, misses, waits,
+			last ? "" : ",");
+	else
+		printf("  %-12s %10lld hits %10lld misses %10lld waits "
+			"%6.1f%% hit rate\n", name, hits, misses, waits,
+			hits + misses ? hits * 100.0 / (hits + misses) : 0);
+}
+
+
+void stats_report(struct compressor *comp, struct cache *data_cache,
+	struct cache *fragment_cache, struct cache *metadata_cache)
+{
+	struct stats *s = &stats_count;
+	long long elapsed = stats_usecs() - start_usecs;
+	int json = stats == STATS_JSON, i;
+
+	if(json) {
+		printf("{\n  \"compressor\": \"%s\",\n  \"elapsed_usecs\": "
+			"%lld,\n  \"stages\": {\n", comp->name, elapsed);
+		stage_report("read", &s->read, TRUE, FALSE);
+		stage_report("decompress", &s->deflate, TRUE, FALSE);
+		stage_report("block_cache", &s->block_cache, TRUE, FALSE);
+		stage_report("write", &s->write, TRUE, TRUE);
+		printf("  },\n  \"queues\": {\n");
+		for(i = 0; i < 3; i++)
+			queue_report(&queue_stats[i], TRUE, i == 2);
+		printf("  },\n  \"caches\": {\n");
+		cache_report("data", data_cache, TRUE, FALSE);
+		cache_report("fragment", fragment_cache, TRUE, FALSE);
+		cache_report("metadata", metadata_cache, TRUE, TRUE);
+		printf("  },\n  \"writer_syscalls\": { \"open\": %lld, "
+			"\"pwritev\": %lld, \"ftruncate\": %lld, \"attributes\": "
+			"%lld, \"close\": %lld }\n}\n", s->opens, s->pwritevs,
+			s->ftruncates, s->attributes, s->closes);
+		return;
+	}
+
+	printf("\nExtraction statistics (%s, %.3f s elapsed):\n", comp->name,
+		elapsed / 1000000.0);
+	printf("Stages (time is summed over threads):\n");
+	stage_report("read", &s->read, FALSE, FALSE);
+	stage_report("decompress", &s->deflate, FALSE, FALSE);
+	stage_report("block-cache", &s->block_cache, FALSE, FALSE);
+	stage_report("write", &s->write, FALSE, TRUE);
+	printf("Queue occupancy (entries:share of samples, every %d us):\n",
+		STATS_SAMPLE_USECS);
+	for(i = 0; i < 3; i++)
+		queue_report(&queue_stats[i], FALSE, i == 2);
+	printf("Caches:\n");
+	cache_report("data", data_cache, FALSE, FALSE);
+	cache_report("fragment", fragment_cache, FALSE, FALSE);
+	cache_report("metadata", metadata_cache, FALSE, TRUE);
+	printf("Writer syscalls: %lld open, %lld pwritev, %lld ftruncate, "
+		"%lld attribute, %lld close\n", s->opens, s->pwritevs,
+		s->ftruncates, s->attributes, s->closes);
+}
@@ -34,6 +34,7 @@
 #include <dirent.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <sys/xattr.h>
 
 #include "squashfs_fs.h"
@@ -80,8 +81,12 @@ static int sxattr_ids = 0;
 /* xattr hash table for value duplicate detection */
 static struct xattr_list *dupl[65536];
 
-/* xattr hash table for id duplicate detection */
+/*
+ * xattr hash table for id duplicate detection.  The scan threads intern
+ * each file's xattrs as they stat it, so it's guarded by dupl_id_mutex
+ */
 static struct dupl_id *dupl_id[65536];
+static pthread_mutex_t dupl_id_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* file system globals from mksquashfs.c */
 extern int no_xattrs, noX;
@@ -122,23 +127,49 @@ static int get_prefix(struct xattr_list *xattr, char *name)
 }
 
 	
+/*
+ * Most files have a handful of short xattrs (an SELinux context, maybe a
+ * capability), so the name list and each value are first read into a
+ * buffer of the usual size, which saves the syscall asking for the size.
+ * Only if that's too small (ERANGE) is the size asked for
+ */
+static ssize_t get_xattr_value(char *filename, char *name, void **value)
+{
+	ssize_t vsize = XATTR_VALUE_GUESS;
+
+	while(1) {
+		*value = malloc(vsize ? vsize : 1);
+		if(*value == NULL) {
+			ERROR("Out of memory in read_attrs\n");
+			return -1;
+		}
+
+		vsize = lgetxattr(filename, name, *value, vsize);
+		if(vsize >= 0)
+			break;
+
+		free(*value);
+		if(errno != ERANGE || (vsize = lgetxattr(filename, name, NULL,
+				0)) < 0) {
+			/* ERANGE again means the xattr grew, try again */
+			ERROR("lgetxattr failed for %s in read_attrs, because "
+				"%s\n", filename, strerror(errno));
+			return -1;
+		}
+	}
+
+	return vsize;
+}
+
+
 static int read_xattrs_from_system(char *filename, struct xattr_list **xattrs)
 {
-	ssize_t size, vsize;
+	ssize_t size = XATTR_LIST_GUESS, vsize;
 	char *xattr_names, *p;
 	int i;
 	struct xattr_list *xattr_list = NULL;
 
 	while(1) {
-		size = llistxattr(filename, NULL, 0);
-		if(size <= 0) {
-			if(size < 0 && errno != ENOTSUP)
-				ERROR("llistxattr for %s failed in read_attrs,"
-					" because %s\n", filename,
-					strerror(errno));
-			return 0;
-		}
-
 		xattr_names = malloc(size);
 		if(xattr_names == NULL) {
 			ERROR("Out of memory in read_attrs\n");
@@ -146,20 +177,20 @@ static int read_xattrs_from_system(char *filename, struct xattr_list **xattrs)
 		}
 
 		size = llistxattr(filename, xattr_names, size);
-		if(size < 0) {
-			free(xattr_names);
-			if(errno == ERANGE)
-				/* xattr list grew?  Try again */
-				continue;
-			else {
+		if(size >= 0)
+			break;
+
+		free(xattr_names);
+		if(errno == ERANGE)
+			/* xattr list grew?  Try again */
+			size = llistxattr(filename, NULL, 0);
+		if(size <= 0) {
+			if(size < 0 && errno != ENOTSUP)
 				ERROR("llistxattr for %s failed in read_attrs,"
 					" because %s\n", filename,
 					strerror(errno));
-				return 0;
-			}
+			return 0;
 		}
-
-		break;
 	}
 
 	for(i = 0, p = xattr_names; p < xattr_names + size; i++) {
@@ -181,41 +212,11 @@ static int read_xattrs_from_system(char *filename, struct xattr_list **xattrs)
 			continue;
 		}
 
-		while(1) {
-			vsize = lgetxattr(filename, xattr_list[i].full_name,
-								NULL, 0);
-			if(vsize < 0) {
-				ERROR("lgetxattr failed for %s in read_attrs,"
-					" because %s\n", filename,
-					strerror(errno));
-				free(xattr_list[i].full_name);
-				goto failed;
-			}
-
-			xattr_list[i].value = malloc(vsize);
-			if(xattr_list[i].value == NULL) {
-				ERROR("Out of memory in read_attrs\n");
-				free(xattr_list[i].full_name);
-				goto failed;
-			}
-
-			vsize = lgetxattr(filename, xattr_list[i].full_name,
-						xattr_list[i].value, vsize);
-			if(vsize < 0) {
-				free(xattr_list[i].value);
-				if(errno == ERANGE)
-					/* xattr grew?  Try again */
-					continue;
-				else {
-					ERROR("lgetxattr failed for %s in "
-						"read_attrs, because %s\n",
-						filename, strerror(errno));
-					free(xattr_list[i].full_name);
-					goto failed;
-				}
-			}
-			
-			break;
+		vsize = get_xattr_value(filename, xattr_list[i].full_name,
+			&xattr_list[i].value);
+		if(vsize < 0) {
+			free(xattr_list[i].full_name);
+			goto failed;
 		}
 		xattr_list[i].vsize = vsize;
 
@@ -238,6 +239,18 @@ failed:
 }
 
 
+static void free_xattr_list(struct xattr_list *xattr_list, int xattrs)
+{
+	int i;
+
+	for(i = 0; i < xattrs; i++) {
+		free(xattr_list[i].full_name);
+		free(xattr_list[i].value);
+	}
+	free(xattr_list);
+}
+
+
 static int get_xattr_size(struct xattr_list *xattr)
 {
 	int size = sizeof(struct squashfs_xattr_entry) +
@@ -307,24 +320,40 @@ failed:
 }
 
 
+static unsigned int xattr_hash(void *data, int bytes, unsigned int hash)
+{
+	unsigned char *p = data;
+
+	while(bytes --)
+		hash = (hash ^ *p++) * 16777619;
+
+	return hash;
+}
+
+
+/*
+ * Look up the xattr list in the id duplicate table, adding it if it isn't
+ * there.  The lists are hashed (FNV-1a) on their names and values, and
+ * only lists with the same hash are compared
+ */
 static struct dupl_id *check_id_dupl(struct xattr_list *xattr_list, int xattrs)
 {
 	struct dupl_id *entry;
 	int i;
-	unsigned short checksum = 0;
+	unsigned int hash = 2166136261U;
 
-	/* compute checksum over all xattrs */
+	/* compute hash over all xattrs */
 	for(i = 0; i < xattrs; i++) {
 		struct xattr_list *xattr = &xattr_list[i];
 
-		checksum = get_checksum(xattr->full_name,
-					strlen(xattr->full_name), checksum);
-		checksum = get_checksum(xattr->value,
-					xattr->vsize, checksum);
+		hash = xattr_hash(xattr->full_name, strlen(xattr->full_name) +
+			1, hash);
+		hash = xattr_hash(xattr->value, xattr->vsize, hash);
+		hash = xattr_hash(&xattr->vsize, sizeof(xattr->vsize), hash);
 	}
 
-	for(entry = dupl_id[checksum]; entry; entry = entry->next) {
-		if (entry->xattrs != xattrs)
+	for(entry = dupl_id[hash & 0xffff]; entry; entry = entry->next) {
+		if (entry->hash != hash || entry->xattrs != xattrs)
 			continue;
 
 		for(i = 0; i < xattrs; i++) {
@@ -334,7 +363,9 @@ static struct dupl_id *check_id_dupl(struct xattr_list *xattr_list, int xattrs)
 			if(strcmp(xattr->full_name, dup_xattr->full_name))
 				break;
 
-			if(memcmp(xattr->value, dup_xattr->value, xattr->vsize))
+			if(xattr->vsize != dup_xattr->vsize || memcmp(
+					xattr->value, dup_xattr->value,
+					xattr->vsize))
 				break;
 		}
 		
@@ -352,8 +383,9 @@ static struct dupl_id *check_id_dupl(struct xattr_list *xattr_list, int xattrs)
 		entry->xattrs = xattrs;
 		entry->xattr_list = xattr_list;
 		entry->xattr_id = SQUASHFS_INVALID_XATTR;
-		entry->next = dupl_id[checksum];
-		dupl_id[checksum] = entry;
+		entry->hash = hash;
+		entry->next = dupl_id[hash & 0xffff];
+		dupl_id[hash & 0xffff] = entry;
 	}
 		
 	return entry;
@@ -497,21 +529,19 @@ failed:
 }
 
 
-int generate_xattrs(int xattrs, struct xattr_list *xattr_list)
+/*
+ * Add the interned xattr list to the xattr table, unless it's already been
+ * added, returning its xattr id
+ */
+static int generate_xattr_id(struct dupl_id *xattr_dupl)
 {
+	int xattrs = xattr_dupl->xattrs;
+	struct xattr_list *xattr_list = xattr_dupl->xattr_list;
 	int total_size, i;
 	int xattr_value_max;
 	void *xp;
 	long long xattr_disk;
-	struct dupl_id *xattr_dupl;
 
-	/*
-	 * check if the file xattrs are a complete duplicate of a pre-existing
-	 * id
-	 */
-	xattr_dupl = check_id_dupl(xattr_list, xattrs);
-	if (xattr_dupl == NULL)
-		return SQUASHFS_INVALID_XATTR;
 	if(xattr_dupl->xattr_id != SQUASHFS_INVALID_XATTR)
 		return xattr_dupl->xattr_id;
 	 
@@ -633,22 +663,69 @@ int generate_xattrs(int xattrs, struct xattr_list *xattr_list)
 }
 
 
+int generate_xattrs(int xattrs, struct xattr_list *xattr_list)
+{
+	struct dupl_id *xattr_dupl;
+
+	/*
+	 * check if the file xattrs are a complete duplicate of a pre-existing
+	 * id
+	 */
+	pthread_mutex_lock(&dupl_id_mutex);
+	xattr_dupl = check_id_dupl(xattr_list, xattrs);
+	pthread_mutex_unlock(&dupl_id_mutex);
+	if (xattr_dupl == NULL)
+		return SQUASHFS_INVALID_XATTR;
+
+	return generate_xattr_id(xattr_dupl);
+}
+
+
+/*
+ * Read the file's xattrs and intern them, returning the shared copy
+ * (NULL if the file has none).  Called by the scan threads as they stat
+ * each file, so on a labelled filesystem, where every file has xattrs,
+ * the reading and duplicate checking isn't a serial phase.  The xattr ids
+ * are allocated later, in inode order, by read_xattrs()
+ */
+void *scan_xattrs(char *filename)
+{
+	struct xattr_list *xattr_list;
+	struct dupl_id *xattr_dupl;
+	int xattrs = read_xattrs_from_system(filename, &xattr_list);
+
+	if(xattrs == 0)
+		return NULL;
+
+	pthread_mutex_lock(&dupl_id_mutex);
+	xattr_dupl = check_id_dupl(xattr_list, xattrs);
+	pthread_mutex_unlock(&dupl_id_mutex);
+
+	if(xattr_dupl == NULL || xattr_dupl->xattr_list != xattr_list)
+		/* a duplicate (or out of memory), the list isn't kept */
+		free_xattr_list(xattr_list, xattrs);
+
+	return xattr_dupl;
+}
+
+
 int read_xattrs(void *d)
 {
 	struct dir_ent *dir_ent = d;
 	struct inode_info *inode = dir_ent->inode;
-	char *filename = dir_ent->pathname;
-	struct xattr_list *xattr_list;
-	int xattrs;
+	struct dupl_id *xattr_dupl;
 
 	if(no_xattrs || IS_PSEUDO(inode) || inode->root_entry)
 		return SQUASHFS_INVALID_XATTR;
 
-	xattrs = read_xattrs_from_system(filename, &xattr_list);
-	if(xattrs == 0)
+	if(inode->xattr_scanned)
+		xattr_dupl = inode->xattrs;
+	else
+		xattr_dupl = scan_xattrs(dir_ent->pathname);
+	if(xattr_dupl == NULL)
 		return SQUASHFS_INVALID_XATTR;
 
-	return generate_xattrs(xattrs, xattr_list);
+	return generate_xattr_id(xattr_dupl);
 }
 
 
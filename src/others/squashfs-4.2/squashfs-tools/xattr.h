@@ -35,6 +35,10 @@
  * until it meets the target */
 #define XATTR_TARGET_MAX	65536
 
+/* initial buffer sizes for reading a file's xattr names and each value */
+#define XATTR_LIST_GUESS	1024
+#define XATTR_VALUE_GUESS	256
+
 #define IS_XATTR(a)		(a != SQUASHFS_INVALID_XATTR)
 
 struct xattr_list {
@@ -53,6 +57,7 @@ struct dupl_id {
 	struct xattr_list	*xattr_list;
 	int			xattrs;
 	int			xattr_id;
+	unsigned int		hash;
 	struct dupl_id		*next;
 };
 
@@ -66,6 +71,7 @@ extern int generate_xattrs(int, struct xattr_list *);
 #ifdef XATTR_SUPPORT
 extern int get_xattrs(int, struct squashfs_super_block *);
 extern int read_xattrs(void *);
+extern void *scan_xattrs(char *);
 extern long long write_xattrs();
 extern int save_xattrs();
 extern void restore_xattrs();
@@ -91,6 +97,12 @@ static inline int read_xattrs(void *dir_ent)
 }
 
 
+static inline void *scan_xattrs(char *filename)
+{
+	return NULL;
+}
+
+
 static inline long long write_xattrs()
 {
 	return SQUASHFS_INVALID_BLK;
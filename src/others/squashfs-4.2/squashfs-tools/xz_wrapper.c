@@ -251,6 +251,53 @@ static int xz_uncompress(void *dest, void *src, int size, int block_size,
 }
 
 
+static void *xz_uncompress_init(int block_size)
+{
+	lzma_stream *strm = malloc(sizeof(lzma_stream));
+
+	if(strm)
+		memset(strm, 0, sizeof(lzma_stream));
+	return strm;
+}
+
+
+/*
+ * Re-initialising the decoder on an existing lzma_stream lets liblzma
+ * reuse its allocations when the filter chain hasn't changed
+ */
+static int xz_uncompress_stream(void *stream, void *dest, void *src, int size,
+	int block_size, int *error)
+{
+	lzma_stream *strm = stream;
+	lzma_ret res = lzma_stream_decoder(strm, MEMLIMIT, 0);
+
+	if(res != LZMA_OK)
+		goto failed;
+
+	strm->next_in = src;
+	strm->avail_in = size;
+	strm->next_out = dest;
+	strm->avail_out = block_size;
+
+	res = lzma_code(strm, LZMA_FINISH);
+	if(res == LZMA_STREAM_END && strm->avail_in == 0) {
+		*error = LZMA_OK;
+		return (int) strm->total_out;
+	}
+
+failed:
+	*error = res;
+	return -1;
+}
+
+
+static void xz_uncompress_free(void *strm)
+{
+	lzma_end(strm);
+	free(strm);
+}
+
+
 void xz_usage()
 {
 	lzma_xz_usage(LZMA_OPT_XZ);
@@ -267,6 +314,9 @@ struct compressor xz_comp_ops = {
 	.init = xz_init,
 	.compress = xz_compress,
 	.uncompress = xz_uncompress,
+	.uncompress_init = xz_uncompress_init,
+	.uncompress_stream = xz_uncompress_stream,
+	.uncompress_free = xz_uncompress_free,
 	.options = xz_options,
 	.options_post = xz_options_post,
 	.dump_options = xz_dump_options,
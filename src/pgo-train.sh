@@ -0,0 +1,62 @@
+#!/bin/bash
+# Training runs of the profile-guided build, run by make pgo: the compression tools, built
+# with PGO=generate, pack and unpack a sample tree with each of their compressors, and by
+# exiting write the profiles the PGO=use build is optimised for (see opt.mk).
+#
+# The sample is this source tree unless another directory is given, its sources, makefiles and
+# the freshly built tools are much like the contents of a firmware's root file system.
+SAMPLE="${1:-.}"
+
+SQUASHFS_4_2="./others/squashfs-4.2/squashfs-tools"
+SQUASHFS_4_2_OFFICIAL="./others/squashfs-4.2-official"
+SQUASHFS_2_2_7Z="./others/squashfs-2.2-r2-7z"
+
+if [ ! -d "$SAMPLE" ]
+then
+	echo "Usage: $0 [sample directory]"
+	exit 1
+fi
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/pgo-train.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT
+
+# A copy, so the profiles being written don't change the sample under the tools
+cp -a "$SAMPLE" "$WORK/sample" || exit 1
+find "$WORK/sample" -name '*.gcda' -exec rm -f {} +
+
+# Runs a training command, which must succeed for its profile to be worth using
+function train()
+{
+	echo "Training: $*"
+	"$@" > /dev/null 2>"$WORK/err"
+	if [ $? -ne 0 ]
+	then
+		cat "$WORK/err"
+		echo "Training run failed: $*"
+		exit 1
+	fi
+}
+
+for comp in gzip lzma xz
+do
+	for tools in "$SQUASHFS_4_2" "$SQUASHFS_4_2_OFFICIAL"
+	do
+		train $tools/mksquashfs "$WORK/sample" "$WORK/fs" -comp $comp -noappend -no-progress
+		train $tools/unsquashfs -no-progress -dest "$WORK/root" "$WORK/fs"
+		rm -rf "$WORK/fs" "$WORK/root"
+	done
+done
+
+# The decompressors on their own, at each block size
+train $SQUASHFS_4_2/compbench "$WORK/sample" -comp gzip -comp lzma -comp sqlzma -comp xz -max 16
+
+train $SQUASHFS_2_2_7Z/mksquashfs "$WORK/sample" "$WORK/fs" -noappend
+train $SQUASHFS_2_2_7Z/unsquashfs -dest "$WORK/root" "$WORK/fs"
+rm -rf "$WORK/fs" "$WORK/root"
+
+train ./cramfs-2.x/mkcramfs "$WORK/sample" "$WORK/fs"
+train ./cramfs-2.x/cramfsck -x "$WORK/root" "$WORK/fs"
+train ./uncramfs/uncramfs "$WORK/root2" "$WORK/fs"
+rm -rf "$WORK/fs" "$WORK/root" "$WORK/root2"
+
+exit 0
@@ -35,87 +35,11 @@
 #include <endian.h>
 #include <byteswap.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "untrx.h"
 
-/*************************************************************************
-* IdentifySegment
-*
-* identifies segments (i.e. squashfs, cramfs) and their version numbers
-*
-**************************************************************************/
-SEGMENT_TYPE IdentifySegment(unsigned char *pData, unsigned int nLength)
-{
-	squashfs_super_block *sqblock=(squashfs_super_block *)pData;
-	cramfs_super *crblock=(cramfs_super *)pData;
-	
-	if(sqblock->s_magic==SQUASHFS_MAGIC 
-		|| sqblock->s_magic==SQUASHFS_MAGIC_SWAP
-		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT
-		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT_SWAP)
-	{		
-		fprintf(stderr, " SQUASHFS magic: 0x%x\n", sqblock->s_magic);
-		short major = READ16_LE(sqblock->s_major);
-		short minor = READ16_LE(sqblock->s_minor);
-		fprintf(stderr, " SQUASHFS version: %d.%d\n", major, minor);
-	
-		switch(major)
-		{
-			case 3:
-				switch (minor)
-				{
-					case 0:						
-						return SEGMENT_TYPE_SQUASHFS_3_0;
-					case 1:						
-						return SEGMENT_TYPE_SQUASHFS_3_1;			
-					case 2:
-						return SEGMENT_TYPE_SQUASHFS_3_2;
-					default:
-						return SEGMENT_TYPE_SQUASHFS_3_x;						
-				}
-			case 2:
-				switch (minor)
-				{
-					case 0:
-						return SEGMENT_TYPE_SQUASHFS_2_0;
-					case 1:
-						return SEGMENT_TYPE_SQUASHFS_2_1;
-					default:
-						return SEGMENT_TYPE_SQUASHFS_2_x;						
-				}
-			default:
-				return SEGMENT_TYPE_SQUASHFS_OTHER;				
-		}
-	}	
-	else if(crblock->magic==CRAMFS_MAGIC || crblock->magic==CRAMFS_MAGIC_SWAP)
-	{
-		return SEGMENT_TYPE_CRAMFS_x_x;	
-	}	
-	return SEGMENT_TYPE_UNTYPED;
-}
-
-/*************************************************************************
-* EmitSquashfsMagic
-*
-* writes the squashfs root block signature to a file, as a fix for
-* Brainslayer of DD-WRT deciding to change it to some arbitrary value
-* to break compatibility with this kit.
-*
-**************************************************************************/
-int EmitSquashfsMagic(squashfs_super_block *pSuper, char *pszOutFile)
-{
-	fprintf(stderr, "  Writing %s\n", pszOutFile);
-	FILE *fOut=fopen(pszOutFile,"wb");
-	if(!fOut) return 0;
-	if(fwrite(pSuper,1,4,fOut)!=4)
-	{
-		fclose(fOut);
-		return 0;
-	}
-	fclose(fOut);	
-	return 1;
-}
-
 /*************************************************************************
 * ShowUsage
 *
@@ -124,54 +48,60 @@ int EmitSquashfsMagic(squashfs_super_block *pSuper, char *pszOutFile)
 void ShowUsage()
 {			
 	fprintf(stderr, " ERROR: Invalid usage.\n"		
-		" USAGE: splitter3 binfile outfolder\n");	
+		" USAGE: splitter3 binfile outfolder\n"
+		"        splitter3 -b [-t threads] manifest|imagedir outfolder\n"
+		"  -b splits every image listed in manifest or found in imagedir\n"
+		"     into its own folder under outfolder on a pool of threads and\n"
+		"     prints a tab separated segment report\n");	
 	exit(9);
 }
 
 /*************************************************************************
-* main
+* ExtractImage
 *
+* splits one image into pszOutFolder, reporting its parts to fReport if
+* given.  Returns 0, or the exit code for the failure.
 *
 **************************************************************************/
-int main(int argc, char **argv)
+int ExtractImage(const char *pszImage, const char *pszFolder, FILE *fReport)
 {
-	fprintf(stderr, " splitter3 " _VERSION_ " - (c)2010 Jeremy Collake\n");
-	
-	if(argc<3)
+	Msg(" Opening %s\n", pszImage);
+	int fdIn=open(pszImage,O_RDONLY);
+	if(fdIn<0)
 	{
-		ShowUsage();
+		Msg(" ERROR opening %s\n", pszImage);
+		return 1;
 	}
 	
-	fprintf(stderr, " Opening %s\n", argv[1]);
-	FILE *fIn=fopen(argv[1],"rb");
-	if(!fIn)
-	{
-		fprintf(stderr, " ERROR opening %s\n", argv[1]);
-		exit(1);
-	}
-	
-	char *pszOutFolder=(char *)malloc(strlen(argv[2])+sizeof(char));
-	strcpy(pszOutFolder,argv[2]);
+	char *pszOutFolder=(char *)malloc(strlen(pszFolder)+sizeof(char));
+	strcpy(pszOutFolder,pszFolder);
 	if(pszOutFolder[strlen(pszOutFolder)-1]=='/')
 	{
 		pszOutFolder[strlen(pszOutFolder)-1]=0;		
 	}	
 	
-	fseek(fIn,0,SEEK_END);
-	size_t nFilesize=ftell(fIn);
-	fseek(fIn,0,SEEK_SET);		
-	unsigned char *pData=(unsigned char *)malloc(nFilesize);	
+	// map the image rather than reading it in; the parts are copied
+	// out of fdIn by the kernel and only the search looks at the data
+	struct stat st;
+	if(fstat(fdIn,&st)<0 || st.st_size<=4)
+	{
+		Msg(" ERROR reading %s\n", pszImage);		
+		close(fdIn);	
+		free(pszOutFolder);	
+		return 1;
+	}
+	size_t nFilesize=st.st_size;
+	unsigned char *pData=(unsigned char *)
+		mmap(NULL,nFilesize,PROT_READ,MAP_SHARED,fdIn,0);
 	unsigned char *pDataOrg=pData;
-	if(fread(pData,1,nFilesize,fIn)!=nFilesize)
+	if(pData==MAP_FAILED)
 	{
-		fprintf(stderr," ERROR reading %s\n", argv[1]);		
-		fclose(fIn);	
-		free(pDataOrg);
+		Msg(" ERROR reading %s\n", pszImage);		
+		close(fdIn);	
 		free(pszOutFolder);	
-		exit(1);
+		return 1;
 	}	
-	fclose(fIn);	
-	fprintf(stderr, " read %ld bytes\n", nFilesize);
+	Msg(" mapped %lu bytes\n", nFilesize);
 	
 	/* Extract the segments */
 	unsigned int nKernelLength=0;
@@ -182,16 +112,18 @@ int main(int argc, char **argv)
 		SEGMENT_TYPE segType=IdentifySegment(pDataOrg+nI,4);
 		if(segType!=SEGMENT_TYPE_UNTYPED)
 		{
-			fprintf(stderr, " Found segment type 0x%x", segType);
+			Msg(" Found segment type 0x%x", segType);
 			nKernelLength=nI;
 			break;
 		}
 	}
 	if(!nKernelLength)
 	{
-		fprintf(stderr, " ERROR: Could not locate any file system in image. Perhaps obfuscated or unknown FS");
-		free(pDataOrg);
-		exit(2);
+		Msg(" ERROR: Could not locate any file system in image. Perhaps obfuscated or unknown FS");
+		munmap(pDataOrg,nFilesize);
+		close(fdIn);
+		free(pszOutFolder);
+		return 2;
 	}	
 
 	// now go to last 4096 block of file, as the FS will end on this and trailer begin
@@ -199,7 +131,7 @@ int main(int argc, char **argv)
 	unsigned int nTrailerOffset=(nFilesize/4096)*4096;	// do safe method, 32-bit, 64-bit, any size ints
 	unsigned int nTrailerLength=nFilesize-nTrailerOffset;
 	unsigned int nFilesystemLength=nTrailerOffset-nKernelLength;
-	fprintf(stderr, 
+	Msg(
 		" Kernel length is %x\n File system length is %x\n Trailer is %x bytes\n", 
 		nKernelLength, nFilesystemLength, nTrailerLength);
 
@@ -209,8 +141,6 @@ int main(int argc, char **argv)
 
 	for(unsigned int nI=0;nI<3;nI++)
 	{
-		FILE *fOut;	
-
 		unsigned int nOffset,nLength;
 		switch(nI)
 		{
@@ -232,51 +162,55 @@ int main(int argc, char **argv)
 			
 		}
 			
-		switch(IdentifySegment(pDataOrg+nOffset,nLength))
+		short nMajor=0, nMinor=0;
+		SEGMENT_TYPE segType=IdentifySegment(pDataOrg+nOffset,nLength,
+			&nMajor,&nMinor);
+		switch(segType)
 		{
 			case SEGMENT_TYPE_SQUASHFS_3_0:
-				fprintf(stderr, "  SQUASHFS v3.0 image detected\n");	
+				Msg("  SQUASHFS v3.0 image detected\n");	
 				sprintf(pszTemp,"%s/squashfs_magic",pszOutFolder);								
 				if(!EmitSquashfsMagic((squashfs_super_block *)pData,pszTemp))
 				{
-					fprintf(stderr,"  ERROR - writing %s\n", pszTemp);
-					free(pDataOrg);
+					Msg("  ERROR - writing %s\n", pszTemp);
+					munmap(pDataOrg,nFilesize);
+					close(fdIn);
 					free(pszOutFolder);	
 					free(pszTemp);
-					exit(3);		
+					return 3;		
 				}				
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_0",pszOutFolder);				
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_1:
-				fprintf(stderr, "  SQUASHFS v3.1 image detected\n");
+				Msg("  SQUASHFS v3.1 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_1",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_2:
-				fprintf(stderr, "  SQUASHFS v3.2 image detected\n");
+				Msg("  SQUASHFS v3.2 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_2",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_x:
-				fprintf(stderr, "  SQUASHFS v3.x (>3.2) image detected\n");
+				Msg("  SQUASHFS v3.x (>3.2) image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_0:
-				fprintf(stderr, "  SQUASHFS v2.0 image detected\n");
+				Msg("  SQUASHFS v2.0 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_0",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_1:
-				fprintf(stderr, "  SQUASHFS v2.1 image detected\n");
+				Msg("  SQUASHFS v2.1 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_1",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_x:
-				fprintf(stderr, "  SQUASHFS v2.x image detected\n");
+				Msg("  SQUASHFS v2.x image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_OTHER:
-				fprintf(stderr, "  ! WARNING: Unknown squashfs version.\n");
+				Msg("  ! WARNING: Unknown squashfs version.\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-x_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_CRAMFS_x_x:
-				fprintf(stderr, "  CRAMFS v? image detected\n");
+				Msg("  CRAMFS v? image detected\n");
 				sprintf(pszTemp,"%s/cramfs-image-x_x",pszOutFolder);
 				break;				
 			default:
@@ -295,36 +229,67 @@ int main(int argc, char **argv)
 				}
 				break;			
 		}		
-		fprintf(stderr,"  Writing %s\n    size %u from offset %ld ...\n", 
+		Msg("  Writing %s\n    size %u from offset %ld ...\n", 
 			pszTemp, 
 			nLength,
 			pData-pDataOrg);		
 
-		fOut=fopen(pszTemp,"wb");
-		if(!fOut)
-		{
-			fprintf(stderr,"  ERROR could not open %s\n", pszTemp);
-			free(pDataOrg);
-			free(pszOutFolder);	
-			free(pszTemp);
-			exit(3);		
-		}				
-		if(!fwrite(pData,1,nLength,fOut))
+		if(!WriteSegment(fdIn,pData-pDataOrg,nLength,pszTemp))
 		{
-			fprintf(stderr," ERROR could not write %s\n", pszTemp);
-			fclose(fOut);
-			free(pDataOrg);
+			Msg(" ERROR could not write %s\n", pszTemp);
+			munmap(pDataOrg,nFilesize);
+			close(fdIn);
 			free(pszOutFolder);	
 			free(pszTemp);
-			exit(4);				
+			return 4;				
 		}
-		fclose(fOut);	
+		ReportSegment(fReport,pszImage,nI+1,pData-pDataOrg,nLength,
+			segType,nMajor,nMinor,pszTemp);
 		pData+=nLength;
 	}
 	
-	free(pDataOrg);
+	munmap(pDataOrg,nFilesize);
+	close(fdIn);
 	free(pszOutFolder);	
 	free(pszTemp);
-	printf("  Done!\n");
-	exit(0);
+	return 0;
+}
+
+/*************************************************************************
+* main
+*
+*
+**************************************************************************/
+int main(int argc, char **argv)
+{
+	fprintf(stderr, " splitter3 " _VERSION_ " - (c)2010 Jeremy Collake\n");
+	
+	if(argc>1 && !strcmp(argv[1],"-b"))
+	{
+		int nThreads=sysconf(_SC_NPROCESSORS_ONLN);
+		int nArg=2;
+		if(argc>nArg+1 && !strcmp(argv[nArg],"-t"))
+		{
+			nThreads=atoi(argv[nArg+1]);
+			nArg+=2;
+		}
+		if(argc-nArg<2)
+		{
+			ShowUsage();
+		}
+		g_bVerbose=false;
+		exit(RunBatch(argv[nArg],argv[nArg+1],nThreads,ExtractImage));
+	}
+	
+	if(argc<3)
+	{
+		ShowUsage();
+	}
+	
+	int nResult=ExtractImage(argv[1],argv[2],NULL);
+	if(!nResult)
+	{
+		printf("  Done!\n");
+	}
+	exit(nResult);
 }
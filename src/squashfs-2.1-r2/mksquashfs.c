@@ -38,6 +38,7 @@
 #include <signal.h>
 #include <setjmp.h>
 #include <sys/mman.h>
+#include <pthread.h>
 
 #include "mksquashfs.h"
 #include <squashfs_fs.h>
@@ -284,6 +285,168 @@ unsigned int mangle(char *d, char *s, int size, int block_size, int uncompressed
 }
 
 
+/*
+ * Parallel data block compression.  write_file() reads the blocks of a
+ * file a batch at a time and the deflator threads compress them, each into
+ * its own job buffer.  The compressed blocks are then laid out in file
+ * order, so the filesystem is the same whatever the number of threads
+ */
+struct queue {
+	int		size;
+	int		readp;
+	int		writep;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	empty;
+	pthread_cond_t	full;
+	void		**data;
+};
+
+struct deflate_job {
+	char		*input;
+	char		*output;
+	int		size;
+	unsigned int	c_byte;
+};
+
+/* blocks compressed per batch, for each deflator thread */
+#define DEFLATE_BATCH	4
+
+int processors = -1, deflate_batch, deflate_pending;
+pthread_t *deflator_thread;
+struct queue *to_deflate;
+struct deflate_job *deflate_job;
+pthread_mutex_t deflate_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t deflate_done = PTHREAD_COND_INITIALIZER;
+
+
+struct queue *queue_init(int size)
+{
+	struct queue *queue = malloc(sizeof(struct queue));
+
+	if(queue == NULL)
+		return NULL;
+
+	if((queue->data = malloc(sizeof(void *) * (size + 1))) == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	queue->size = size + 1;
+	queue->readp = queue->writep = 0;
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->empty, NULL);
+	pthread_cond_init(&queue->full, NULL);
+
+	return queue;
+}
+
+
+void queue_put(struct queue *queue, void *data)
+{
+	int nextp;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while((nextp = (queue->writep + 1) % queue->size) == queue->readp)
+		pthread_cond_wait(&queue->full, &queue->mutex);
+
+	queue->data[queue->writep] = data;
+	queue->writep = nextp;
+	pthread_cond_signal(&queue->empty);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+
+void *queue_get(struct queue *queue)
+{
+	void *data;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while(queue->readp == queue->writep)
+		pthread_cond_wait(&queue->empty, &queue->mutex);
+
+	data = queue->data[queue->readp];
+	queue->readp = (queue->readp + 1) % queue->size;
+	pthread_cond_signal(&queue->full);
+	pthread_mutex_unlock(&queue->mutex);
+
+	return data;
+}
+
+
+void *deflator(void *arg)
+{
+	while(1) {
+		struct deflate_job *job = queue_get(to_deflate);
+
+		job->c_byte = mangle(job->output, job->input, job->size, block_size, noD, 1);
+
+		pthread_mutex_lock(&deflate_mutex);
+		if(-- deflate_pending == 0)
+			pthread_cond_signal(&deflate_done);
+		pthread_mutex_unlock(&deflate_mutex);
+	}
+}
+
+
+/* compress the first count jobs, returning when they're all done */
+void deflate_blocks(int count)
+{
+	int i;
+
+	pthread_mutex_lock(&deflate_mutex);
+	deflate_pending = count;
+	pthread_mutex_unlock(&deflate_mutex);
+
+	for(i = 0; i < count; i++)
+		queue_put(to_deflate, &deflate_job[i]);
+
+	pthread_mutex_lock(&deflate_mutex);
+	while(deflate_pending)
+		pthread_cond_wait(&deflate_done, &deflate_mutex);
+	pthread_mutex_unlock(&deflate_mutex);
+}
+
+
+void initialise_threads()
+{
+	int i;
+	char *input, *output;
+	sigset_t sigmask, old_mask;
+
+	if(processors == -1)
+		processors = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+	deflate_batch = processors * DEFLATE_BATCH;
+	if((deflator_thread = malloc(processors * sizeof(pthread_t))) == NULL ||
+			(deflate_job = malloc(deflate_batch * sizeof(struct deflate_job))) == NULL ||
+			(input = malloc(deflate_batch * block_size)) == NULL ||
+			(output = malloc(deflate_batch * (block_size << 1))) == NULL ||
+			(to_deflate = queue_init(deflate_batch)) == NULL)
+		BAD_ERROR("Out of memory allocating deflator threads\n");
+
+	for(i = 0; i < deflate_batch; i++) {
+		deflate_job[i].input = input + i * block_size;
+		deflate_job[i].output = output + i * (block_size << 1);
+	}
+
+	/* leave the interrupt handling to the main thread */
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGINT);
+	sigaddset(&sigmask, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &sigmask, &old_mask);
+
+	for(i = 0; i < processors; i++)
+		if(pthread_create(&deflator_thread[i], NULL, deflator, NULL) != 0)
+			BAD_ERROR("Failed to create thread\n");
+
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+	printf("Parallel mksquashfs: Using %d processor%s\n", processors, processors == 1 ? "" : "s");
+}
+
+
 squashfs_base_inode_header *get_inode(int req_size)
 {
 	int data_space;
@@ -1104,7 +1267,7 @@ int write_file(squashfs_inode *inode, char *filename, long long size, int *dupli
 	unsigned int blocks = (read_size + block_size - 1) >> block_log;
 	unsigned int block_list[blocks], *block_listp = block_list;
 	char buff[block_size], *c_buffer;
-	int allocated_blocks = blocks, i, bbytes, whole_file = 1;
+	int allocated_blocks = blocks, i, j, batch, bbytes, whole_file = 1;
 	struct fragment *fragment;
 	struct file_info *dupl_ptr = NULL;
 	struct duplicate_buffer_handle handle;
@@ -1135,13 +1298,22 @@ int write_file(squashfs_inode *inode, char *filename, long long size, int *dupli
 	} while(!c_buffer);
 
 	for(start = bytes; block < blocks; file_bytes += bbytes) {
-		for(i = 0, bbytes = 0; (i < allocated_blocks) && (block < blocks); i++) {
-			int available_bytes = read_size - (block * block_size) > block_size ? block_size : read_size - (block * block_size);
-			if(read(file, buff, available_bytes) == -1)
-				goto read_err;
-			c_byte = mangle(c_buffer + bbytes, buff, available_bytes, block_size, noD, 1);
-			block_list[block ++] = c_byte;
-			bbytes += SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
+		for(i = 0, bbytes = 0; (i < allocated_blocks) && (block < blocks); i += batch) {
+			for(batch = 0; batch < deflate_batch && i + batch < allocated_blocks && block + batch < blocks; batch++) {
+				long long remaining = read_size - ((long long) (block + batch) * block_size);
+				struct deflate_job *job = &deflate_job[batch];
+
+				job->size = remaining > block_size ? block_size : remaining;
+				if(read(file, job->input, job->size) == -1)
+					goto read_err;
+			}
+			deflate_blocks(batch);
+			for(j = 0; j < batch; j++) {
+				c_byte = deflate_job[j].c_byte;
+				memcpy(c_buffer + bbytes, deflate_job[j].output, SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte));
+				block_list[block ++] = c_byte;
+				bbytes += SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
+			}
 		}
 		if(!whole_file) {
 			write_bytes(fd, bytes, bbytes, c_buffer);
@@ -1641,6 +1813,13 @@ int main(int argc, char *argv[])
 		 else if(strcmp(argv[i], "-always-use-fragments") == 0)
 			always_use_fragments = TRUE;
 
+		else if(strcmp(argv[i], "-processors") == 0) {
+			if((++i == argc) || (processors = strtol(argv[i], &b, 10), *b != '\0') || processors < 1) {
+				ERROR("%s: -processors missing or invalid processor number\n", argv[0]);
+				exit(1);
+			}
+		}
+
 		 else if(strcmp(argv[i], "-sort") == 0) {
 			if(++i == argc) {
 				ERROR("%s: -sort missing filename\n", argv[0]);
@@ -1747,6 +1926,8 @@ printOptions:
 			ERROR("-no-fragments\t\tdo not use fragments\n");
 			ERROR("-always-use-fragments\tuse fragment blocks for files larger than block size\n");
 			ERROR("-no-duplicates\t\tdo not perform duplicate checking\n");
+			ERROR("-processors <number>\tuse <number> processors to compress data blocks.  By\n");
+			ERROR("\t\t\tdefault the number of processors online\n");
 			ERROR("-noappend\t\tdo not append to existing filesystem\n");
 			ERROR("-keep-as-directory\tif one source directory is specified, create a root\n");
 			ERROR("\t\t\tdirectory containing that directory, rather than the\n");
@@ -1958,6 +2139,8 @@ printOptions:
 
 	block_offset = check_data ? 3 : 2;
 
+	initialise_threads();
+
 	if(stat(source_path[0], &buf) == -1) {
 		perror("Cannot stat source directory");
 		EXIT_MKSQUASHFS();
@@ -35,6 +35,8 @@
 #include <zlib.h>
 #include <sys/mman.h>
 #include <utime.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #ifndef linux
 #define __BYTE_ORDER BYTE_ORDER
@@ -64,6 +66,7 @@
 
 #define EXIT_UNSQUASH(s, args...)	do { \
 						fprintf(stderr, "FATAL ERROR aborting: "s, ## args); \
+						exit(1); \
 					} while(0)
 
 struct hash_table_entry {
@@ -78,13 +81,11 @@ struct hash_table_entry *inode_table_hash[65536], *directory_table_hash[65536];
 int fd;
 squashfs_fragment_entry *fragment_table;
 unsigned int *uid_table, *guid_table;
-unsigned int cached_frag = SQUASHFS_INVALID_FRAG;
-char *fragment_data;
-char *file_data;
-char *data;
 unsigned int block_size;
 int lsonly = FALSE, info = FALSE;
 char **created_inode;
+char *fs_map = NULL;
+long long fs_map_size = 0;
 
 #define CALCULATE_HASH(start)	(start & 0xffff)
 
@@ -120,12 +121,36 @@ int lookup_entry(struct hash_table_entry *hash_table[], int start)
 }
 
 
+/*
+ * With -mmap return a pointer to the bytes inside the mapped filesystem, or
+ * NULL if they lie outside it
+ */
+char *map_bytes(long long byte, int bytes)
+{
+	if(fs_map == NULL || byte < 0 || bytes < 0 || byte + bytes > fs_map_size) {
+		ERROR("map_bytes: read beyond end of filesystem\n");
+		return NULL;
+	}
+
+	return fs_map + byte;
+}
+
+
 int read_bytes(long long byte, int bytes, char *buff)
 {
 	off_t off = byte;
 
 	TRACE("read_bytes: reading from position 0x%llx, bytes %d\n", byte, bytes);
 
+	if(fs_map) {
+		char *src = map_bytes(byte, bytes);
+
+		if(src == NULL)
+			return FALSE;
+		memcpy(buff, src, bytes);
+		return TRUE;
+	}
+
 	if(lseek(fd, off, SEEK_SET) == -1) {
 		ERROR("Lseek failed because %s\b", strerror(errno));
 		return FALSE;
@@ -159,15 +184,18 @@ int read_block(long long start, long long *next, char *block, squashfs_super_blo
 	if(SQUASHFS_CHECK_DATA(sBlk->flags))
 		offset = 3;
 	if(SQUASHFS_COMPRESSED(c_byte)) {
-		char buffer[SQUASHFS_METADATA_SIZE];
+		char buffer[SQUASHFS_METADATA_SIZE], *src = buffer;
 		int res;
 		unsigned long bytes = SQUASHFS_METADATA_SIZE;
 
 		c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
-		if(read_bytes(start + offset, c_byte, buffer) == FALSE)
+		if(fs_map) {
+			if((src = map_bytes(start + offset, c_byte)) == NULL)
+				goto failed;
+		} else if(read_bytes(start + offset, c_byte, buffer) == FALSE)
 			goto failed;
 
-		if((res = uncompress((unsigned char *) block, &bytes, (const unsigned char *) buffer, c_byte)) != Z_OK) {
+		if((res = uncompress((unsigned char *) block, &bytes, (const unsigned char *) src, c_byte)) != Z_OK) {
 			if(res == Z_MEM_ERROR)
 				ERROR("zlib::uncompress failed, not enough memory\n");
 			else if(res == Z_BUF_ERROR)
@@ -195,40 +223,6 @@ failed:
 }
 
 
-int read_data_block(long long start, unsigned int size, char *block)
-{
-	int res;
-	unsigned long bytes = block_size;
-	int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(size);
-
-	TRACE("read_data_block: block @0x%llx, %d %s bytes\n", start, SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte), SQUASHFS_COMPRESSED_BLOCK(c_byte) ? "compressed" : "uncompressed");
-
-	if(SQUASHFS_COMPRESSED_BLOCK(size)) {
-		if(read_bytes(start, c_byte, data) == FALSE)
-			return 0;
-
-		if((res = uncompress((unsigned char *) block, &bytes, (const unsigned char *) data, c_byte)) != Z_OK) {
-			if(res == Z_MEM_ERROR)
-				ERROR("zlib::uncompress failed, not enough memory\n");
-			else if(res == Z_BUF_ERROR)
-				ERROR("zlib::uncompress failed, not enough room in output buffer\n");
-			else {
-				ERROR("zlib::uncompress failed, unknown error %d\n", res);
-				exit(1);
-			}
-			return 0;
-		}
-
-		return bytes;
-	} else {
-		if(read_bytes(start, c_byte, block) == FALSE)
-			return 0;
-
-		return c_byte;
-	}
-}
-
-
 void uncompress_inode_table(long long start, long long end, squashfs_super_block *sBlk)
 {
 	int size = 0, bytes = 0, res;
@@ -314,40 +308,440 @@ void read_fragment_table(squashfs_super_block *sBlk)
 		int length = read_block(fragment_table_index[i], NULL, ((char *) fragment_table) + (i * SQUASHFS_METADATA_SIZE), sBlk);
 		TRACE("Read fragment table block %d, from 0x%llx, length %d\n", i, fragment_table_index[i], length);
 	}
+}
 
-	if(swap) {
-		squashfs_fragment_entry sfragment;
-		for(i = 0; i < sBlk->fragments; i++) {
-			SQUASHFS_SWAP_FRAGMENT_ENTRY((&sfragment), (&fragment_table[i]));
-			memcpy((char *) &fragment_table[i], (char *) &sfragment, sizeof(squashfs_fragment_entry));
+
+/*
+ * Threaded read path, after the 4.x unsquashfs.  The main thread walks the
+ * directories and queues each file's blocks to the writer thread, looking
+ * them up in the data or fragment cache.  A block not in the cache is read
+ * by the reader thread and, if compressed, decompressed by one of the
+ * deflator threads, so decompression and writing overlap the scan
+ */
+struct queue {
+	int		size;
+	int		readp;
+	int		writep;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	empty;
+	pthread_cond_t	full;
+	void		**data;
+};
+
+struct cache_entry {
+	struct cache	*cache;
+	long long	block;
+	int		size;
+	int		bytes;
+	int		used;
+	int		error;
+	int		pending;
+	struct cache_entry *hash_next;
+	struct cache_entry *hash_prev;
+	struct cache_entry *free_next;
+	struct cache_entry *free_prev;
+	char		*data;
+};
+
+struct cache {
+	int		max_buffers;
+	int		count;
+	int		buffer_size;
+	pthread_mutex_t	mutex;
+	pthread_cond_t	wait_for_free;
+	pthread_cond_t	wait_for_pending;
+	struct cache_entry *free_list;
+	struct cache_entry *hash_table[65536];
+};
+
+/* a block, or the tail of a fragment, queued to the writer */
+struct file_entry {
+	int		offset;
+	int		size;
+	struct cache_entry *buffer;
+};
+
+/* a file queued to the writer, followed by its blocks */
+struct squashfs_file {
+	int		fd;
+	int		blocks;
+	unsigned int	mode;
+	unsigned int	uid;
+	unsigned int	guid;
+	unsigned int	mtime;
+	char		*pathname;
+};
+
+#define DATA_BUFFER_DEFAULT	256
+#define FRAGMENT_BUFFER_DEFAULT	256
+
+struct cache *fragment_cache, *data_cache;
+struct queue *to_reader, *to_deflate, *to_writer, *from_writer;
+pthread_t *thread, *deflator_thread;
+int processors = -1;
+
+
+struct queue *queue_init(int size)
+{
+	struct queue *queue = malloc(sizeof(struct queue));
+
+	if(queue == NULL)
+		return NULL;
+
+	if((queue->data = malloc(sizeof(void *) * (size + 1))) == NULL) {
+		free(queue);
+		return NULL;
+	}
+
+	queue->size = size + 1;
+	queue->readp = queue->writep = 0;
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->empty, NULL);
+	pthread_cond_init(&queue->full, NULL);
+
+	return queue;
+}
+
+
+void queue_put(struct queue *queue, void *data)
+{
+	int nextp;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while((nextp = (queue->writep + 1) % queue->size) == queue->readp)
+		pthread_cond_wait(&queue->full, &queue->mutex);
+
+	queue->data[queue->writep] = data;
+	queue->writep = nextp;
+	pthread_cond_signal(&queue->empty);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+
+void *queue_get(struct queue *queue)
+{
+	void *data;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while(queue->readp == queue->writep)
+		pthread_cond_wait(&queue->empty, &queue->mutex);
+
+	data = queue->data[queue->readp];
+	queue->readp = (queue->readp + 1) % queue->size;
+	pthread_cond_signal(&queue->full);
+	pthread_mutex_unlock(&queue->mutex);
+
+	return data;
+}
+
+
+struct cache *cache_init(int buffer_size, int max_buffers)
+{
+	struct cache *cache = malloc(sizeof(struct cache));
+
+	if(cache == NULL)
+		return NULL;
+
+	cache->max_buffers = max_buffers;
+	cache->buffer_size = buffer_size;
+	cache->count = 0;
+	cache->free_list = NULL;
+	memset(cache->hash_table, 0, sizeof(struct cache_entry *) * 65536);
+	pthread_mutex_init(&cache->mutex, NULL);
+	pthread_cond_init(&cache->wait_for_free, NULL);
+	pthread_cond_init(&cache->wait_for_pending, NULL);
+
+	return cache;
+}
+
+
+void insert_hash_table(struct cache *cache, struct cache_entry *entry)
+{
+	int hash = CALCULATE_HASH(entry->block);
+
+	entry->hash_next = cache->hash_table[hash];
+	cache->hash_table[hash] = entry;
+	entry->hash_prev = NULL;
+	if(entry->hash_next)
+		entry->hash_next->hash_prev = entry;
+}
+
+
+void remove_hash_table(struct cache *cache, struct cache_entry *entry)
+{
+	if(entry->hash_prev)
+		entry->hash_prev->hash_next = entry->hash_next;
+	else
+		cache->hash_table[CALCULATE_HASH(entry->block)] = entry->hash_next;
+	if(entry->hash_next)
+		entry->hash_next->hash_prev = entry->hash_prev;
+
+	entry->hash_prev = entry->hash_next = NULL;
+}
+
+
+void insert_free_list(struct cache *cache, struct cache_entry *entry)
+{
+	if(cache->free_list) {
+		entry->free_next = cache->free_list;
+		entry->free_prev = cache->free_list->free_prev;
+		cache->free_list->free_prev->free_next = entry;
+		cache->free_list->free_prev = entry;
+	} else {
+		cache->free_list = entry;
+		entry->free_prev = entry->free_next = entry;
+	}
+}
+
+
+void remove_free_list(struct cache *cache, struct cache_entry *entry)
+{
+	if(entry->free_prev == NULL && entry->free_next == NULL)
+		/* not in free list */
+		return;
+	else if(entry->free_prev == entry && entry->free_next == entry) {
+		/* only this entry in the free list */
+		cache->free_list = NULL;
+	} else {
+		/* more than one entry in the free list */
+		entry->free_next->free_prev = entry->free_prev;
+		entry->free_prev->free_next = entry->free_next;
+		if(cache->free_list == entry)
+			cache->free_list = entry->free_next;
+	}
+
+	entry->free_prev = entry->free_next = NULL;
+}
+
+
+/*
+ * Get the block from the cache, queueing it to the reader thread if it
+ * isn't there.  The caller waits for it with cache_block_wait()
+ */
+struct cache_entry *cache_get(struct cache *cache, long long block, int size)
+{
+	int hash = CALCULATE_HASH(block);
+	struct cache_entry *entry;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	for(entry = cache->hash_table[hash]; entry; entry = entry->hash_next)
+		if(entry->block == block)
+			break;
+
+	if(entry) {
+		/* found, it may still be pending but that's handled later */
+		if(entry->used == 0)
+			remove_free_list(cache, entry);
+		entry->used ++;
+		pthread_mutex_unlock(&cache->mutex);
+		return entry;
+	}
+
+	/* not in the cache, wait for a buffer to become free if they're all in use */
+	while(cache->free_list == NULL && cache->count == cache->max_buffers)
+		pthread_cond_wait(&cache->wait_for_free, &cache->mutex);
+
+	if(cache->count < cache->max_buffers) {
+		if((entry = malloc(sizeof(struct cache_entry))) == NULL || (entry->data = malloc(cache->buffer_size)) == NULL)
+			EXIT_UNSQUASH("cache_get: out of memory\n");
+		entry->cache = cache;
+		entry->free_prev = entry->free_next = NULL;
+		cache->count ++;
+	} else {
+		/* reuse the least recently used free buffer */
+		entry = cache->free_list;
+		remove_free_list(cache, entry);
+		remove_hash_table(cache, entry);
+	}
+
+	entry->block = block;
+	entry->size = size;
+	entry->used = 1;
+	entry->error = FALSE;
+	entry->pending = TRUE;
+	insert_hash_table(cache, entry);
+	pthread_mutex_unlock(&cache->mutex);
+
+	queue_put(to_reader, entry);
+
+	return entry;
+}
+
+
+void cache_block_ready(struct cache_entry *entry, int error)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	entry->pending = FALSE;
+	entry->error = error;
+	pthread_cond_broadcast(&entry->cache->wait_for_pending);
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+void cache_block_wait(struct cache_entry *entry)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	while(entry->pending)
+		pthread_cond_wait(&entry->cache->wait_for_pending, &entry->cache->mutex);
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+void cache_block_put(struct cache_entry *entry)
+{
+	pthread_mutex_lock(&entry->cache->mutex);
+	if(-- entry->used == 0) {
+		insert_free_list(entry->cache, entry);
+		pthread_cond_signal(&entry->cache->wait_for_free);
+	}
+	pthread_mutex_unlock(&entry->cache->mutex);
+}
+
+
+/*
+ * Read the compressed blocks in the order they were queued, passing them on
+ * to the deflators.  With -mmap the deflators decompress straight out of the
+ * mapping and only uncompressed blocks are copied here
+ */
+void *reader(void *arg)
+{
+	while(1) {
+		struct cache_entry *entry = queue_get(to_reader);
+		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size);
+
+		if(c_byte > entry->cache->buffer_size) {
+			ERROR("reader: block 0x%llx size %d too large\n", entry->block, c_byte);
+			cache_block_ready(entry, TRUE);
+		} else if(fs_map && SQUASHFS_COMPRESSED_BLOCK(entry->size))
+			queue_put(to_deflate, entry);
+		else if(read_bytes(entry->block, c_byte, entry->data) == FALSE)
+			cache_block_ready(entry, TRUE);
+		else if(SQUASHFS_COMPRESSED_BLOCK(entry->size))
+			queue_put(to_deflate, entry);
+		else {
+			entry->bytes = c_byte;
+			cache_block_ready(entry, FALSE);
 		}
 	}
 }
 
 
-char *read_fragment(unsigned int fragment)
+void *deflator(void *arg)
 {
-	TRACE("read_fragment: reading fragment %d\n", fragment);
+	char tmp[block_size];
+
+	while(1) {
+		struct cache_entry *entry = queue_get(to_deflate);
+		int c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(entry->size), res;
+		unsigned long bytes = block_size;
+		char *src = entry->data, *dest = tmp;
+
+		if(fs_map) {
+			/* decompress straight out of the mapping into the buffer */
+			src = map_bytes(entry->block, c_byte);
+			dest = entry->data;
+			if(src == NULL) {
+				cache_block_ready(entry, TRUE);
+				continue;
+			}
+		}
 
-	if(cached_frag == SQUASHFS_INVALID_FRAG || fragment != cached_frag) {
-		squashfs_fragment_entry *fragment_entry = &fragment_table[fragment];
-		if(read_data_block(fragment_entry->start_block, fragment_entry->size, fragment_data) == 0) {
-			ERROR("read_fragment: failed to read fragment %d\n", fragment);
-			cached_frag = SQUASHFS_INVALID_FRAG;
-			return NULL;
+		if((res = uncompress((unsigned char *) dest, &bytes, (const unsigned char *) src, c_byte)) != Z_OK) {
+			ERROR("zlib::uncompress failed on block 0x%llx, error %d\n", entry->block, res);
+			cache_block_ready(entry, TRUE);
+			continue;
+		}
+
+		if(dest == tmp)
+			memcpy(entry->data, tmp, bytes);
+		entry->bytes = bytes;
+		cache_block_ready(entry, FALSE);
+	}
+}
+
+
+/*
+ * Write each queued file once its blocks are ready, then set its attributes.
+ * A NULL file marks the end of the scan
+ */
+void *writer(void *arg)
+{
+	struct squashfs_file *file;
+	int i;
+
+	while((file = queue_get(to_writer)) != NULL) {
+		int failed = FALSE;
+
+		for(i = 0; i < file->blocks; i++) {
+			struct file_entry *block = queue_get(to_writer);
+			int size;
+
+			cache_block_wait(block->buffer);
+			size = block->size == -1 ? block->buffer->bytes : block->size;
+			if(!failed && block->buffer->error) {
+				ERROR("writer: failed to read data block 0x%llx\n", block->buffer->block);
+				failed = TRUE;
+			} else if(!failed && write(file->fd, block->buffer->data + block->offset, size) < size) {
+				ERROR("writer: failed to write file %s, because %s\n", file->pathname, strerror(errno));
+				failed = TRUE;
+			}
+			cache_block_put(block->buffer);
+			free(block);
 		}
-		cached_frag = fragment;
+
+		close(file->fd);
+		if(!failed)
+			set_attributes(file->pathname, file->mode, file->uid, file->guid, file->mtime, FALSE);
+		free(file->pathname);
+		free(file);
 	}
 
-	return fragment_data;
+	queue_put(from_writer, NULL);
+	return NULL;
+}
+
+
+void initialise_threads(int fragment_buffer_size, int data_buffer_size)
+{
+	int i, all_buffers_size = fragment_buffer_size + data_buffer_size;
+
+	if(processors == -1)
+		processors = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+	if((thread = malloc((2 + processors) * sizeof(pthread_t))) == NULL)
+		EXIT_UNSQUASH("Out of memory allocating thread descriptors\n");
+	deflator_thread = &thread[2];
+
+	to_reader = queue_init(all_buffers_size);
+	to_deflate = queue_init(all_buffers_size);
+	to_writer = queue_init(1000);
+	from_writer = queue_init(1);
+	fragment_cache = cache_init(block_size, fragment_buffer_size);
+	data_cache = cache_init(block_size, data_buffer_size);
+	if(to_reader == NULL || to_deflate == NULL || to_writer == NULL || from_writer == NULL ||
+			fragment_cache == NULL || data_cache == NULL)
+		EXIT_UNSQUASH("Out of memory allocating thread queues and caches\n");
+
+	pthread_create(&thread[0], NULL, reader, NULL);
+	pthread_create(&thread[1], NULL, writer, NULL);
+	for(i = 0; i < processors; i++)
+		if(pthread_create(&deflator_thread[i], NULL, deflator, NULL) != 0)
+			EXIT_UNSQUASH("Failed to create thread\n");
+
+	printf("Parallel unsquashfs: Using %d processor%s\n", processors, processors == 1 ? "" : "s");
 }
 
 
 int write_file(char *pathname, unsigned int fragment, unsigned int frag_bytes, unsigned int offset,
-unsigned int blocks, long long start, char *block_ptr, unsigned int mode)
+unsigned int blocks, long long start, char *block_ptr, unsigned int mode, unsigned int uid, unsigned int guid,
+unsigned int mtime)
 {
-	unsigned int file_fd, bytes, i;
+	int file_fd, i;
 	unsigned int *block_list;
+	struct squashfs_file *file;
 
 	TRACE("write_file: regular file, blocks %d\n", blocks);
 
@@ -357,9 +751,7 @@ unsigned int blocks, long long start, char *block_ptr, unsigned int mode)
 	}
 
 	if(swap) {
-		unsigned int sblock_list[blocks];
-		memcpy(sblock_list, block_ptr, blocks * sizeof(unsigned int));
-		SQUASHFS_SWAP_INTS(block_list, sblock_list, blocks);
+		SQUASHFS_SWAP_INTS(block_list, block_ptr, blocks);
 	} else
 		memcpy(block_list, block_ptr, blocks * sizeof(unsigned int));
 
@@ -370,39 +762,50 @@ unsigned int blocks, long long start, char *block_ptr, unsigned int mode)
 		return FALSE;
 	}
 
-	for(i = 0; i < blocks; i++) {
-		if((bytes = read_data_block(start, block_list[i], file_data)) == 0) {
-			ERROR("write_file: failed to read data block 0x%llx\n", start);
-			goto failure;
-		}
+	if((file = malloc(sizeof(struct squashfs_file))) == NULL || (file->pathname = strdup(pathname)) == NULL)
+		EXIT_UNSQUASH("write_file: unable to malloc file\n");
 
-		if(write(file_fd, file_data, bytes) < bytes) {
-			ERROR("write_file: failed to write data block 0x%llx\n", start);
-			goto failure;
-		}
+	file->fd = file_fd;
+	file->blocks = blocks + (frag_bytes != 0);
+	file->mode = mode;
+	file->uid = uid;
+	file->guid = guid;
+	file->mtime = mtime;
+	queue_put(to_writer, file);
 
+	/* the blocks follow the file on the writer queue, fetched as they're queued */
+	for(i = 0; i < blocks; i++) {
+		struct file_entry *block = malloc(sizeof(struct file_entry));
+
+		if(block == NULL)
+			EXIT_UNSQUASH("write_file: unable to malloc file entry\n");
+		block->offset = 0;
+		block->size = -1;
+		block->buffer = cache_get(data_cache, start, block_list[i]);
+		queue_put(to_writer, block);
 		start += SQUASHFS_COMPRESSED_SIZE_BLOCK(block_list[i]);
 	}
 
 	if(frag_bytes != 0) {
-		char *fragment_data = read_fragment(fragment);
+		squashfs_fragment_entry sfragment, *fragment_entry = &fragment_table[fragment];
+		struct file_entry *block = malloc(sizeof(struct file_entry));
 
-		if(fragment_data == NULL)
-			goto failure;
-
-		if(write(file_fd, fragment_data + offset, frag_bytes) < frag_bytes) {
-			ERROR("write_file: failed to write fragment %d\n", fragment);
-			goto failure;
+		if(block == NULL)
+			EXIT_UNSQUASH("write_file: unable to malloc file entry\n");
+		TRACE("write_file: fragment %d, offset %d, bytes %d\n", fragment, offset, frag_bytes);
+		/* the fragment table is kept as it is on disk, decode the entry if it's byte-swapped */
+		if(swap) {
+			SQUASHFS_SWAP_FRAGMENT_ENTRY((&sfragment), fragment_entry);
+			fragment_entry = &sfragment;
 		}
+		block->offset = offset;
+		block->size = frag_bytes;
+		block->buffer = cache_get(fragment_cache, fragment_entry->start_block, fragment_entry->size);
+		queue_put(to_writer, block);
 	}
 
-	close(file_fd);
-	return TRUE;
-
-failure:
-	close(file_fd);
 	free(block_list);
-	return FALSE;
+	return TRUE;
 }
 		
 
@@ -422,9 +825,7 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 	block_ptr = inode_table + bytes + offset;
 
 	if(swap) {
-		squashfs_base_inode_header sinode;
-		memcpy(&sinode, block_ptr, sizeof(header.base));
-		SQUASHFS_SWAP_BASE_INODE_HEADER(&header.base, &sinode, sizeof(squashfs_base_inode_header));
+		SQUASHFS_SWAP_BASE_INODE_HEADER(&header.base, block_ptr, sizeof(squashfs_base_inode_header));
 	} else
 		memcpy(&header.base, block_ptr, sizeof(header.base));
 
@@ -447,9 +848,7 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			squashfs_reg_inode_header *inode = &header.reg;
 
 			if(swap) {
-				squashfs_reg_inode_header sinode;
-				memcpy(&sinode, block_ptr, sizeof(sinode));
-				SQUASHFS_SWAP_REG_INODE_HEADER(inode, &sinode);
+				SQUASHFS_SWAP_REG_INODE_HEADER(inode, block_ptr);
 			} else
 				memcpy(inode, block_ptr, sizeof(*inode));
 
@@ -463,10 +862,8 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			TRACE("create_inode: regular file, file_size %lld, blocks %d\n", inode->file_size, blocks);
 
 			if(write_file(pathname, inode->fragment, frag_bytes, offset, blocks, start,
-					block_ptr + sizeof(*inode), inode->mode)) {
-				set_attributes(pathname, inode->mode, inode->uid, inode->guid, inode->mtime, FALSE);
+					block_ptr + sizeof(*inode), inode->mode, inode->uid, inode->guid, inode->mtime))
 				file_count ++;
-			}
 			break;
 		}	
 		case SQUASHFS_LREG_TYPE: {
@@ -477,9 +874,7 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			squashfs_lreg_inode_header *inode = &header.lreg;
 
 			if(swap) {
-				squashfs_lreg_inode_header sinode;
-				memcpy(&sinode, block_ptr, sizeof(sinode));
-				SQUASHFS_SWAP_LREG_INODE_HEADER(inode, &sinode);
+				SQUASHFS_SWAP_LREG_INODE_HEADER(inode, block_ptr);
 			} else
 				memcpy(inode, block_ptr, sizeof(*inode));
 
@@ -493,10 +888,8 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			TRACE("create_inode: regular file, file_size %lld, blocks %d\n", inode->file_size, blocks);
 
 			if(write_file(pathname, inode->fragment, frag_bytes, offset, blocks, start,
-					block_ptr + sizeof(*inode), inode->mode)) {
-				set_attributes(pathname, inode->mode, inode->uid, inode->guid, inode->mtime, FALSE);
+					block_ptr + sizeof(*inode), inode->mode, inode->uid, inode->guid, inode->mtime))
 				file_count ++;
-			}
 			break;
 		}	
 		case SQUASHFS_SYMLINK_TYPE: {
@@ -504,9 +897,7 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			char name[65536];
 
 			if(swap) {
-				squashfs_symlink_inode_header sinodep;
-				memcpy(&sinodep, block_ptr, sizeof(sinodep));
-				SQUASHFS_SWAP_SYMLINK_INODE_HEADER(inodep, &sinodep);
+				SQUASHFS_SWAP_SYMLINK_INODE_HEADER(inodep, block_ptr);
 			} else
 				memcpy(inodep, block_ptr, sizeof(*inodep));
 
@@ -537,9 +928,7 @@ int create_inode(char *pathname, unsigned int start_block, unsigned int offset,
 			squashfs_dev_inode_header *inodep = &header.dev;
 
 			if(swap) {
-				squashfs_dev_inode_header sinodep;
-				memcpy(&sinodep, block_ptr, sizeof(sinodep));
-				SQUASHFS_SWAP_DEV_INODE_HEADER(inodep, &sinodep);
+				SQUASHFS_SWAP_DEV_INODE_HEADER(inodep, block_ptr);
 			} else
 				memcpy(inodep, block_ptr, sizeof(*inodep));
 
@@ -650,9 +1039,7 @@ struct dir *squashfs_openddir(unsigned int block_start, unsigned int offset, squ
 	block_ptr = inode_table + bytes + offset;
 
 	if(swap) {
-		squashfs_dir_inode_header sinode;
-		memcpy(&sinode, block_ptr, sizeof(header.dir));
-		SQUASHFS_SWAP_DIR_INODE_HEADER(&header.dir, &sinode);
+		SQUASHFS_SWAP_DIR_INODE_HEADER(&header.dir, block_ptr);
 	} else
 		memcpy(&header.dir, block_ptr, sizeof(header.dir));
 
@@ -664,9 +1051,7 @@ struct dir *squashfs_openddir(unsigned int block_start, unsigned int offset, squ
 			break;
 		case SQUASHFS_LDIR_TYPE:
 			if(swap) {
-				squashfs_ldir_inode_header sinode;
-				memcpy(&sinode, block_ptr, sizeof(header.ldir));
-				SQUASHFS_SWAP_LDIR_INODE_HEADER(&header.ldir, &sinode);
+				SQUASHFS_SWAP_LDIR_INODE_HEADER(&header.ldir, block_ptr);
 			} else
 				memcpy(&header.ldir, block_ptr, sizeof(header.ldir));
 			block_start = header.ldir.start_block;
@@ -703,9 +1088,7 @@ struct dir *squashfs_openddir(unsigned int block_start, unsigned int offset, squ
 
 	while(bytes < size) {			
 		if(swap) {
-			squashfs_dir_header sdirh;
-			memcpy(&sdirh, directory_table + bytes, sizeof(sdirh));
-			SQUASHFS_SWAP_DIR_HEADER(&dirh, &sdirh);
+			SQUASHFS_SWAP_DIR_HEADER(&dirh, directory_table + bytes);
 		} else
 			memcpy(&dirh, directory_table + bytes, sizeof(dirh));
 	
@@ -715,9 +1098,7 @@ struct dir *squashfs_openddir(unsigned int block_start, unsigned int offset, squ
 
 		while(dir_count--) {
 			if(swap) {
-				squashfs_dir_entry sdire;
-				memcpy(&sdire, directory_table + bytes, sizeof(sdire));
-				SQUASHFS_SWAP_DIR_ENTRY(dire, &sdire);
+				SQUASHFS_SWAP_DIR_ENTRY(dire, directory_table + bytes);
 			} else
 				memcpy(dire, directory_table + bytes, sizeof(dire));
 			bytes += sizeof(*dire);
@@ -883,7 +1264,7 @@ int main(int argc, char *argv[])
 {
 	squashfs_super_block sBlk;
 	char *dest = "squashfs-root";
-	int i, version = FALSE;
+	int i, version = FALSE, use_mmap = FALSE;
 
 	for(i = 1; i < argc; i++) {
 		if(*argv[i] != '-')
@@ -895,6 +1276,14 @@ int main(int argc, char *argv[])
 			info = TRUE;
 		else if(strcmp(argv[i], "-ls") == 0)
 			lsonly = TRUE;
+		else if(strcmp(argv[i], "-mmap") == 0)
+			use_mmap = TRUE;
+		else if(strcmp(argv[i], "-processors") == 0) {
+			if(++i == argc || (processors = atoi(argv[i])) < 1) {
+				ERROR("%s: -processors missing or invalid processor number\n", argv[0]);
+				exit(1);
+			}
+		}
 		else if(strcmp(argv[i], "-dest") == 0) {
 			if(++i == argc)
 				goto options;
@@ -905,11 +1294,13 @@ int main(int argc, char *argv[])
 	if(i == argc) {
 		if(!version) {
 options:
-			ERROR("SYNTAX: %s [-ls | -dest] filesystem\n", argv[0]);
+			ERROR("SYNTAX: %s [-ls | -dest | -mmap | -processors] filesystem\n", argv[0]);
 			ERROR("\t-version\t\tprint version, licence and copyright information\n");
 			ERROR("\t-info\t\t\tprint files as they are unsquashed\n");
 			ERROR("\t-ls\t\t\tlist filesystem only\n");
 			ERROR("\t-dest <pathname>\tunsquash to <pathname>, default \"squashfs-root\"\n");
+			ERROR("\t-mmap\t\t\tmap the filesystem and use blocks in place\n");
+			ERROR("\t-processors <number>\tuse <number> deflator threads, default the number of processors\n");
 		}
 		exit(1);
 	}
@@ -919,18 +1310,21 @@ options:
 		exit(1);
 	}
 
+	if(use_mmap) {
+		struct stat buf;
+
+		if(fstat(fd, &buf) == -1 || (fs_map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0)) ==
+				MAP_FAILED) {
+			ERROR("Could not mmap %s, because %s\n", argv[i], strerror(errno));
+			exit(1);
+		}
+		fs_map_size = buf.st_size;
+	}
+
 	if(read_super(&sBlk, argv[i]) == FALSE)
 		exit(1);
 
 	block_size = sBlk.block_size;
-	if((fragment_data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate fragment_data\n");
-
-	if((file_data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate file_data");
-
-	if((data = malloc(block_size)) == NULL)
-		EXIT_UNSQUASH("failed to allocate datan\n");
 
 	if((created_inode = malloc(sBlk.inodes * sizeof(char *))) == NULL)
 		EXIT_UNSQUASH("failed to allocate created_inode\n");
@@ -942,8 +1336,14 @@ options:
 	uncompress_inode_table(sBlk.inode_table_start, sBlk.directory_table_start, &sBlk);
 	uncompress_directory_table(sBlk.directory_table_start, sBlk.fragment_table_start, &sBlk);
 
+	initialise_threads(FRAGMENT_BUFFER_DEFAULT, DATA_BUFFER_DEFAULT);
+
 	dir_scan(dest, SQUASHFS_INODE_BLK(sBlk.root_inode), SQUASHFS_INODE_OFFSET(sBlk.root_inode), &sBlk);
 
+	/* wait for the writer to drain the queued files */
+	queue_put(to_writer, NULL);
+	queue_get(from_writer);
+
 	if(!lsonly) {
 		printf("\n");
 		printf("created %d files\n", file_count);
@@ -16,11 +16,17 @@
 #include <getopt.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>	/* for copy_file_range() on older C libraries */
+#endif
+
 #include <netinet/in.h>		/* for network / host byte order conversions */
 
-#include "md5.h"
+#include "../../crcalc/md5.h"
+#include "../../fmkstats/fmkstats.h"
 
 
 #define PROGRAM_NAME	"tpl-tool"
@@ -55,6 +61,8 @@
 
 #define MD5SUM_LEN	16
 
+#define COPY_BUF_SIZE	65536		/* for streaming image parts */
+
 
 struct image_header {
 	uint32_t	header_version;
@@ -197,19 +205,27 @@ static struct device_info *get_device_info(uint32_t prod_id)
  * Helper function used to simplify checksum generation/verification code.
  *
  * Selects the appropriate key value (normal/bootldr), generates an
- * MD5 hash of the data specified and returns the result of comparing
- * the new MD5 hash with the original. A flag value controls restoration
- * of the original hash value.
+ * MD5 hash of the header at hdr followed by the rest of the len bytes
+ * of the image read from fd at offset, and returns the result of
+ * comparing the new MD5 hash with the original. A flag value controls
+ * restoration of the original hash value.
+ *
+ * The image is hashed as it is read, so only the header is ever held
+ * in memory. A short image never verifies.
  */
 
-static int checksum(char *buf, int len, int overwrite)
+static int checksum(int fd, off_t offset, struct image_header *hdr,
+		    uint32_t len, int overwrite)
 {
-	MD5_CTX ctx;
-	struct image_header *hdr;
+	md5_state_t ctx;
 	uint8_t old_checksum[MD5SUM_LEN];
+	char buf[COPY_BUF_SIZE];
+	uint32_t pos;
+	ssize_t n;
 	int ret;
+	long long start;
 
-	hdr = (struct image_header *)buf;
+	FMK_STAGE_BEGIN(checksum, start);
 	memcpy(old_checksum, hdr->image_checksum, MD5SUM_LEN);
 
 	if (ntohl(hdr->bootldr_length) == 0)
@@ -217,11 +233,24 @@ static int checksum(char *buf, int len, int overwrite)
 	else
 		memcpy(hdr->image_checksum, MD5Key_bootldr, MD5SUM_LEN);
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, buf, len);
-	MD5_Final(hdr->image_checksum, &ctx);
+	md5_init(&ctx);
+	pos = (len < sizeof(struct image_header)) ? len : sizeof(struct image_header);
+	md5_append(&ctx, (const md5_byte_t *)hdr, pos);
+
+	for (; pos < len; pos += n) {
+		n = (len - pos < COPY_BUF_SIZE) ? len - pos : COPY_BUF_SIZE;
+		n = pread(fd, buf, n, offset + pos);
+		if (n <= 0)
+			break;
+		md5_append(&ctx, (const md5_byte_t *)buf, n);
+	}
+
+	md5_finish(&ctx, hdr->image_checksum);
+	FMK_STAGE_END(checksum, start, pos, MD5SUM_LEN);
 
 	ret = memcmp(hdr->image_checksum, old_checksum, MD5SUM_LEN);
+	if (pos < len)
+		ret = -1;
 
 	if (!overwrite)
 		memcpy(hdr->image_checksum, old_checksum, MD5SUM_LEN);
@@ -275,31 +304,136 @@ static int read_to_buffer(struct file_info *fdata, char *buf)
 	return ret;
 }
 
-static int write_from_buffer(struct file_info *fdata, char *buf)
+static int read_header(int fd, off_t offset, struct image_header *hdr)
 {
-	FILE *fp;
+	if (pread(fd, hdr, sizeof(struct image_header), offset) != sizeof(struct image_header))
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
+
+static ssize_t sys_copy_file_range(int fd_in, off_t *off_in, int fd_out,
+				   off_t *off_out, size_t len)
+{
+#ifdef __NR_copy_file_range
+	loff_t in = *off_in, out = *off_out;
+	ssize_t n;
+
+	n = syscall(__NR_copy_file_range, fd_in, &in, fd_out, &out, len, 0);
+	*off_in = in;
+	*off_out = out;
+	return n;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ * Copies len bytes between two files at the offsets given without
+ * passing them through user space where the kernel can. Falls back
+ * to pread/pwrite on older kernels or across filesystems. Reading
+ * past the end of the input is an error.
+ */
+
+static int copy_range(int fd_in, off_t off_in, int fd_out, off_t off_out, uint32_t len)
+{
+	char buf[COPY_BUF_SIZE];
+	ssize_t n;
+	int fallback = 0;
+
+	while (len) {
+		if (!fallback) {
+			n = sys_copy_file_range(fd_in, &off_in, fd_out, &off_out, len);
+			if (n < 0 && (errno == ENOSYS || errno == EXDEV ||
+				      errno == EINVAL || errno == EOPNOTSUPP)) {
+				fallback = 1;
+				continue;
+			}
+		} else {
+			n = (len < COPY_BUF_SIZE) ? len : COPY_BUF_SIZE;
+			n = pread(fd_in, buf, n, off_in);
+			if (n > 0 && pwrite(fd_out, buf, n, off_out) != n)
+				n = -1;
+			if (n > 0) {
+				off_in += n;
+				off_out += n;
+			}
+		}
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return EXIT_FAILURE;
+		len -= n;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* Pads the gap between two parts of a new image with 0xff. */
+
+static int fill_range(int fd, off_t start, off_t end)
+{
+	char buf[COPY_BUF_SIZE];
+	ssize_t n;
+
+	memset(buf, 0xff, sizeof(buf));
+
+	for (; start < end; start += n) {
+		n = (end - start < COPY_BUF_SIZE) ? end - start : COPY_BUF_SIZE;
+		n = pwrite(fd, buf, n, start);
+		if (n < 0 && errno == EINTR)
+			n = 0;
+		else if (n <= 0)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* Writes fdata->size bytes of the image file fd from offset to a new part file. */
+
+static int write_from_file(struct file_info *fdata, int fd, off_t offset)
+{
+	int fd_out;
 	int ret = EXIT_FAILURE;
+	long long start;
 
-	fp = fopen(fdata->name, "w");
-	if (fp == NULL)
+	fd_out = open(fdata->name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd_out < 0)
 		goto out;
 
-	errno = 0;
-	fwrite(buf, fdata->size, 1, fp);
-	if (errno != 0)
-		goto out_flush;
-
-	ret = EXIT_SUCCESS;
+	FMK_STAGE_BEGIN(carve, start);
+	ret = copy_range(fd, offset, fd_out, 0, fdata->size);
+	FMK_STAGE_END(carve, start, fdata->size,
+		      ret == EXIT_SUCCESS ? fdata->size : 0);
 
- out_flush:
-	fflush(fp);
-	fclose(fp);
+	if (close(fd_out))
+		ret = EXIT_FAILURE;
 	if (ret != EXIT_SUCCESS)
 		unlink(fdata->name);
  out:
 	return ret;
 }
 
+/* Copies a part file into a new image at offset. */
+
+static int read_from_file(struct file_info *fdata, int fd, off_t offset)
+{
+	int fd_in;
+	int ret = EXIT_FAILURE;
+
+	fd_in = open(fdata->name, O_RDONLY);
+	if (fd_in < 0)
+		goto out;
+
+	ret = copy_range(fd_in, 0, fd, offset, fdata->size);
+	close(fd_in);
+ out:
+	return ret;
+}
+
 
 /*
  * Helper function used to output the image checksums and verification
@@ -336,9 +470,10 @@ static void print_checksum(char *label, uint8_t *chksum, int valid)
 
 static int show_image_header(char *fname_in)
 {
-	char *buf;
+	int fd;
 	struct file_info fdata;
-	struct image_header *hdr;
+	struct image_header header;
+	struct image_header *hdr = &header;
 	struct device_info *device;
 	int ret = EXIT_FAILURE;
 
@@ -349,34 +484,27 @@ static int show_image_header(char *fname_in)
 		goto out;
 	}
 
-	buf = malloc(fdata.size);
-	if (!buf) {
-		ERROR("Unable to allocate image buffer.");
-		goto out;
-	}
-
-	ret = read_to_buffer(&fdata, buf);
+	fd = open(fdata.name, O_RDONLY);
+	ret = (fd < 0) ? EXIT_FAILURE : read_header(fd, 0, hdr);
 	if (ret) {
 		ERROR("Unable to read image file \"%s\".", fdata.name);
-		goto out_free_buf;
+		goto out_close;
 	}
 
-	hdr = (struct image_header *)buf;
-
 	PRINT_STR("Filename", fdata.name);
 	PRINT_BOTH("Filesize", fdata.size);
 	printf("\n");
 
 	if (ntohl(hdr->header_version) != HEADER_VERSION) {
 		ERROR("Unsupported image header version (%u).", ntohl(hdr->header_version));
-		goto out_free_buf;
+		goto out_close;
 	}
 
 	PRINT_STR("Image Vendor", hdr->image_vendor);
 	PRINT_STR("Image Version", hdr->image_version);
 	PRINT_BOTH("Image Size", ntohl(hdr->image_length));
 
-	int tmp = (checksum(buf, fdata.size, 0)) ? 0 : 1;
+	int tmp = (checksum(fd, 0, hdr, fdata.size, 0)) ? 0 : 1;
 	print_checksum("Image Checksum", hdr->image_checksum, tmp);
 	printf("\n");
 
@@ -395,17 +523,21 @@ static int show_image_header(char *fname_in)
 		ntohs(hdr->fw_ver_minor), ntohs(hdr->fw_ver_point));
 
 
-	/* Display bootloader info and shift pointer to inner image */
+	/* Display bootloader info and read the inner image header */
 	if (ntohl(hdr->bootldr_length) != 0) {
 		PRINT_BOTH("Bootldr Offset", ntohl(hdr->bootldr_offset));
 		PRINT_BOTH("Bootldr Length", ntohl(hdr->bootldr_length));
 		printf("\n");
 
-		hdr = (struct image_header *)(buf + IMAGE2_OFFSET);
+		if (read_header(fd, IMAGE2_OFFSET, hdr)) {
+			ERROR("Unable to read image file \"%s\".", fdata.name);
+			ret = EXIT_FAILURE;
+			goto out_close;
+		}
 
 		PRINT_BOTH("Image2 Size", ntohl(hdr->image_length));
 
-		tmp = (checksum((char *)hdr, fdata.size - IMAGE2_OFFSET, 0)) ? 0 : 1;
+		tmp = (checksum(fd, IMAGE2_OFFSET, hdr, fdata.size - IMAGE2_OFFSET, 0)) ? 0 : 1;
 		print_checksum("Image2 Checksum", hdr->image_checksum, tmp);
 		printf("\n");
 	}
@@ -422,8 +554,9 @@ static int show_image_header(char *fname_in)
 	PRINT_BOTH("Rootfs Length", ntohl(hdr->rootfs_length));
 
 
- out_free_buf:
-	free(buf);
+ out_close:
+	if (fd >= 0)
+		close(fd);
  out:
 	return ret;
 }
@@ -440,16 +573,21 @@ static int show_image_header(char *fname_in)
  * <file>-rootfs
  * 
  * Where <file> is either the input filename or that specified with -o
+ *
+ * Only the headers are read into memory, the parts are copied straight
+ * from the image file.
  */
 
 static int extract_image(char *fname_in, char *fname_out)
 {
-	char *buf;
+	int fd;
 	char *new_name;
 	struct file_info fdata;
-	struct image_header *hdr;
+	struct image_header header;
+	struct image_header *hdr = &header;
 	struct device_info *device;
 	int buf_offset;
+	int img_offset = 0;
 	int bootldr_present = 0;
 	int ret = EXIT_FAILURE;
 
@@ -463,31 +601,25 @@ static int extract_image(char *fname_in, char *fname_out)
 		goto out;
 	}
 
-	buf = malloc(fdata.size);
-	if (!buf) {
-		ERROR("Unable to allocate image buffer.");
-		goto out;
-	}
-
-	ret = read_to_buffer(&fdata, buf);
+	fd = open(fdata.name, O_RDONLY);
+	ret = (fd < 0) ? EXIT_FAILURE : read_header(fd, 0, hdr);
 	if (ret) {
 		ERROR("Unable to read image file \"%s\".", fdata.name);
-		goto out_free_buf;
+		goto out_close;
 	}
-
-	hdr = (struct image_header *)buf;
+	ret = EXIT_FAILURE;
 
 
 	/* Check header version and hardware id */
 	if (ntohl(hdr->header_version) != HEADER_VERSION) {
 		ERROR("Unsupported image header version (%u).", ntohl(hdr->header_version));
-		goto out_free_buf;
+		goto out_close;
 	}
 
 	/* OpenWrt images are broken */
 	if (!strncasecmp(hdr->image_vendor, BAD_VENDOR, sizeof(hdr->image_vendor))) {
 		ERROR("OpenWrt images do not extract correctly.");
-		goto out_free_buf;
+		goto out_close;
 	}
 
 	device = get_device_info(ntohl(hdr->product_id));
@@ -497,7 +629,7 @@ static int extract_image(char *fname_in, char *fname_out)
 	}
 
 	/* Verify image checksum */
-	if (checksum(buf, fdata.size, 0)) {
+	if (checksum(fd, 0, hdr, fdata.size, 0)) {
 		WARN("Invalid Image Checksum.");
 		WARN("Component files may not be valid.");
 	}
@@ -507,7 +639,7 @@ static int extract_image(char *fname_in, char *fname_out)
 	new_name = malloc(strlen(fname_out) + 9);
 	if (!new_name) {
 		ERROR("Unable to allocate space for filenames.");
-		goto out_free_buf;
+		goto out_close;
 	}
 	fdata.name = new_name;
 
@@ -515,7 +647,7 @@ static int extract_image(char *fname_in, char *fname_out)
 	/* Save header block */
 	sprintf(fdata.name, "%s-header", fname_out);
 	fdata.size = sizeof(struct image_header);
-	ret = write_from_buffer(&fdata, buf);
+	ret = write_from_file(&fdata, fd, 0);
 	if (ret) {
 		ERROR("Unable to create image header file \"%s\".", fdata.name);
 		goto out_free_name;
@@ -527,7 +659,7 @@ static int extract_image(char *fname_in, char *fname_out)
 		fdata.size = ntohl(hdr->bootldr_length);
 		sprintf(fdata.name, "%s-bootldr", fname_out);
 
-		ret = write_from_buffer(&fdata, buf + sizeof(struct image_header));
+		ret = write_from_file(&fdata, fd, sizeof(struct image_header));
 		if (ret) {
 			ERROR("Unable to create bootloader file \"%s\".", fdata.name);
 			goto out_free_name;
@@ -535,11 +667,17 @@ static int extract_image(char *fname_in, char *fname_out)
 	}
 
 
-	/* Move pointer to inner image and verify checksum */
+	/* Move to inner image and verify checksum */
 	if (bootldr_present) {
-		hdr = (struct image_header *)(buf + IMAGE2_OFFSET);
+		img_offset = IMAGE2_OFFSET;
 
-		if (checksum((char *)hdr, ntohl(hdr->image_length), 0)) {
+		ret = read_header(fd, img_offset, hdr);
+		if (ret) {
+			ERROR("Unable to read image file \"%s\".", fname_in);
+			goto out_free_name;
+		}
+
+		if (checksum(fd, img_offset, hdr, ntohl(hdr->image_length), 0)) {
 			WARN("Invalid Image2 Checksum.");
 			WARN("kernel/rootfs files may not be valid.");
 		}
@@ -553,7 +691,7 @@ static int extract_image(char *fname_in, char *fname_out)
 	sprintf(fdata.name, "%s-kernel", fname_out);
 	fdata.size = ntohl(hdr->kernel_length);
 
-	ret = write_from_buffer(&fdata, ((char *)hdr) + buf_offset);
+	ret = write_from_file(&fdata, fd, img_offset + buf_offset);
 	if (ret) {
 		ERROR("Unable to create kernel file \"%s\".", fdata.name);
 		goto out_free_name;
@@ -568,7 +706,7 @@ static int extract_image(char *fname_in, char *fname_out)
 	sprintf(fdata.name, "%s-rootfs", fname_out);
 	fdata.size = ntohl(hdr->rootfs_length);
 
-	ret = write_from_buffer(&fdata, ((char *)hdr) + buf_offset);
+	ret = write_from_file(&fdata, fd, img_offset + buf_offset);
 	if (ret) {
 		ERROR("Unable to create rootfs file \"%s\".", fdata.name);
 		goto out_free_name;
@@ -579,8 +717,9 @@ static int extract_image(char *fname_in, char *fname_out)
 
  out_free_name:
 	free(new_name);
- out_free_buf:
-	free(buf);
+ out_close:
+	if (fd >= 0)
+		close(fd);
  out:
 	return ret;
 }
@@ -617,30 +756,38 @@ static int extract_image(char *fname_in, char *fname_out)
  * |     |     |    -------------------    |
  * |     |     |                           |
  * -----------------------------------------
+ *
+ * The parts are copied straight into the new image file and the gaps
+ * padded with 0xff, then the checksums are hashed from the file and the
+ * headers written last, inner one first.
  */
 
 static int build_image(char *fname_in, char *fname_out)
 {
+	int fd;
 	char *new_name;
-	char *hdr_buf;
-	char *img_buf;
+	char *out_name = NULL;
 	struct file_info fdata;
-	struct image_header *hdr;
+	struct file_info bootldr;
+	struct image_header header;
+	struct image_header *hdr = &header;
 	struct device_info *device;
 
 	struct {
-		struct image_header *hdr;
-		char *kernel_buf;
-		char *rootfs_buf;
+		struct image_header hdr;
+		uint32_t offset;
+		uint32_t kernel_offset;
+		uint32_t rootfs_offset;
 	} img;
 
 	struct {
-		struct image_header *hdr;
-		char *bootldr_buf;
+		struct image_header hdr;
+		uint32_t bootldr_offset;
 	} img_b;
 
 	int max_length;
 	int buf_size;
+	int bootldr_present;
 	int ret = EXIT_FAILURE;
 
 
@@ -651,6 +798,12 @@ static int build_image(char *fname_in, char *fname_out)
 	}
 	fdata.name = new_name;
 
+	bootldr.name = malloc(strlen(fname_in) + 9);
+	if (!bootldr.name) {
+		ERROR("Unable to allocate space for filenames.");
+		goto out_free_name;
+	}
+
 
 	/* Read image header file */
 	sprintf(fdata.name, "%s-header", fname_in);
@@ -665,36 +818,29 @@ static int build_image(char *fname_in, char *fname_out)
 		goto out_free_name;
 	}
 
-	hdr_buf = malloc(sizeof(struct image_header));
-	if (!hdr_buf) {
-		ERROR("Unable to allocate space for image header.");
-		goto out_free_name;
-	}
-
-	ret = read_to_buffer(&fdata, hdr_buf);
+	ret = read_to_buffer(&fdata, (char *)hdr);
 	if (ret) {
 		ERROR("Unable to read image header file \"%s\".", fdata.name);
-		goto out_free_hdr;
+		goto out_free_name;
 	}
-
-	hdr = (struct image_header *)hdr_buf;
+	ret = EXIT_FAILURE;
 
 
 	/* Header sanity checks */
 	if (ntohl(hdr->header_version) != HEADER_VERSION) {
 		ERROR("Unsupported image header version (%u).", ntohl(hdr->header_version));
-		goto out_free_hdr;
+		goto out_free_name;
 	}
 
 	if (ntohl(hdr->bootldr_offset) != 0) {
 		ERROR("Bootloader offset must be 0 (0x%08x).", ntohl(hdr->bootldr_offset));
-		goto out_free_hdr;
+		goto out_free_name;
 	}
 
 	/* OpenWrt images are broken */
 	if (!strncasecmp(hdr->image_vendor, BAD_VENDOR, sizeof(hdr->image_vendor))) {
 		ERROR("Rebuilding OpenWrt images is not supported.");
-		goto out_free_hdr;
+		goto out_free_name;
 	}
 
 	if (ntohl(hdr->kernel_offset) != sizeof(struct image_header))
@@ -704,7 +850,7 @@ static int build_image(char *fname_in, char *fname_out)
 		WARN("Non standard rootfs offset (0x%08x).", ntohl(hdr->rootfs_offset));
 
 
-	/* Get image size from device info or header and set buffer size */
+	/* Get image size from device info or header */
 	device = get_device_info(ntohl(hdr->product_id));
 	if (device) {
 		buf_size = device->flash_size + IMAGE2_OFFSET;
@@ -724,131 +870,143 @@ static int build_image(char *fname_in, char *fname_out)
 	}
 
 
-	/* Allocate buffer, set pointers and copy image header to buffer */
-	img_buf = malloc(buf_size);
-	if (!img_buf) {
-		ERROR("Unable to allocate image buffer.");
-		goto out_free_hdr;
-	}
-
-	memset(img_buf, 0xff, buf_size);
+	/*
+	 * The inner image starts the new image unless there is a
+	 * bootloader to go in front of it.
+	 */
+	sprintf(bootldr.name, "%s-bootldr", fname_in);
+	bootldr_present = get_file_size(&bootldr) ? 0 : 1;
 
-	img_b.hdr = (struct image_header *)img_buf;
-	img_b.bootldr_buf = img_buf + sizeof(struct image_header);
+	img_b.bootldr_offset = sizeof(struct image_header);
 
-	img.hdr = (struct image_header *)(img_buf + IMAGE2_OFFSET);
-	img.kernel_buf = ((char *)img.hdr) + ntohl(hdr->kernel_offset);
-	img.rootfs_buf = ((char *)img.hdr) + ntohl(hdr->rootfs_offset);
+	img.offset = bootldr_present ? IMAGE2_OFFSET : 0;
+	img.kernel_offset = img.offset + ntohl(hdr->kernel_offset);
+	img.rootfs_offset = img.offset + ntohl(hdr->rootfs_offset);
 
 	hdr->bootldr_length = 0;
-	memcpy((char *)img.hdr, (char *)hdr, sizeof(struct image_header));
+	memcpy(&img.hdr, hdr, sizeof(struct image_header));
+
 
+	/* Create new firmware image */
+	if (fname_out == NULL) {
+		out_name = malloc(strlen(fname_in) + 5);
+		if (!out_name) {
+			ERROR("Unable to allocate space for filenames.");
+			goto out_free_name;
+		}
+		sprintf(out_name, "%s-new", fname_in);
+		fname_out = out_name;
+	}
 
-	/* Read kernel image file */
+	fd = open(fname_out, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		ERROR("Unable to create image file \"%s\".", fname_out);
+		goto out_free_name;
+	}
+
+
+	/* Copy kernel image file */
 	sprintf(fdata.name, "%s-kernel", fname_in);
 	ret = get_file_size(&fdata);
 	if (ret) {
 		ERROR("Kernel file not found \"%s\".", fdata.name);
-		goto out_free_img;
+		goto out_close;
 	}
+	ret = EXIT_FAILURE;
 
-	int tmp = img.hdr->rootfs_offset - img.hdr->kernel_offset;
+	int tmp = ntohl(hdr->rootfs_offset) - ntohl(hdr->kernel_offset);
 	if (fdata.size > tmp) { 					/* Kernel size check */
 		ERROR("Kernel image too large for image layout.");
-		goto out_free_img;
+		goto out_close;
 	}
 
-	ret = read_to_buffer(&fdata, img.kernel_buf);
-	if (ret) {
+	if (fill_range(fd, img.offset + sizeof(struct image_header), img.kernel_offset) ||
+	    read_from_file(&fdata, fd, img.kernel_offset) ||
+	    fill_range(fd, img.kernel_offset + fdata.size, img.rootfs_offset)) {
 		ERROR("Unable to read kernel file \"%s\".", fdata.name);
-		goto out_free_img;
+		goto out_close;
 	}
-	img.hdr->kernel_length = htonl(fdata.size);
+	img.hdr.kernel_length = htonl(fdata.size);
 
 
-	/* Read root filesystem image file */
+	/* Copy root filesystem image file */
 	sprintf(fdata.name, "%s-rootfs", fname_in);
 	ret = get_file_size(&fdata);
 	if (ret) {
 		ERROR("Rootfs file not found \"%s\".", fdata.name);
-		goto out_free_img;
+		goto out_close;
 	}
+	ret = EXIT_FAILURE;
 
-	tmp = max_length - img.hdr->rootfs_offset;
+	tmp = max_length - ntohl(hdr->rootfs_offset);
 	if (fdata.size > tmp) {						/* Rootfs size check */
 		ERROR("Root filesystem too large for image layout.");
-		goto out_free_img;
+		goto out_close;
 	}
 
-	ret = read_to_buffer(&fdata, img.rootfs_buf);
-	if (ret) {
+	if (read_from_file(&fdata, fd, img.rootfs_offset) ||
+	    fill_range(fd, img.rootfs_offset + fdata.size, img.offset + max_length)) {
 		ERROR("Unable to read rootfs file \"%s\".", fdata.name);
-		goto out_free_img;
+		goto out_close;
 	}
-	img.hdr->rootfs_length = htonl(fdata.size);
+	img.hdr.rootfs_length = htonl(fdata.size);
 
 
 	/* Set image length and checksum */
-	img.hdr->image_length = htonl(max_length);
-	checksum((char *)img.hdr, max_length, 1);
+	img.hdr.image_length = htonl(max_length);
+	checksum(fd, img.offset, &img.hdr, max_length, 1);
+	if (pwrite(fd, &img.hdr, sizeof(struct image_header), img.offset) != sizeof(struct image_header)) {
+		ERROR("Unable to create image file \"%s\".", fname_out);
+		goto out_close;
+	}
 
 
-	/* read bootloader image file */
-	sprintf(fdata.name, "%s-bootldr", fname_in);
-	ret = get_file_size(&fdata);
-	if (ret && (ntohl(hdr->bootldr_length) != 0)) {
+	/* Copy bootloader image file */
+	if (!bootldr_present && (ntohl(hdr->bootldr_length) != 0)) {
 		WARN("Bootloader length set in header and no bootloader image file was found.");
 		WARN("Bootloader will be omitted from image.");
 	}
 
-	if (!ret) {
+	if (bootldr_present) {
 		/* Copy header from inner image */
-		memcpy((char *)img_b.hdr, (char *)img.hdr, sizeof(struct image_header));
+		memcpy(&img_b.hdr, &img.hdr, sizeof(struct image_header));
 
 		tmp = sizeof(struct image_header);
-		if ((tmp + fdata.size) > IMAGE2_OFFSET) {
+		if ((tmp + bootldr.size) > IMAGE2_OFFSET) {
 			ERROR("Bootloader image too large for image layout.");
-			goto out_free_img;
+			goto out_close;
 		}
 
-		ret = read_to_buffer(&fdata, img_b.bootldr_buf);
-		if (ret) {
-			ERROR("Unable to read bootloader file \"%s\".", fdata.name);
-			goto out_free_img;
+		if (read_from_file(&bootldr, fd, img_b.bootldr_offset) ||
+		    fill_range(fd, img_b.bootldr_offset + bootldr.size, IMAGE2_OFFSET)) {
+			ERROR("Unable to read bootloader file \"%s\".", bootldr.name);
+			goto out_close;
 		}
-		img_b.hdr->bootldr_length = htonl(fdata.size);
+		img_b.hdr.bootldr_length = htonl(bootldr.size);
 
 		/* Set image length and checksum */
-		img_b.hdr->image_length = htonl(buf_size);
-		checksum((char *)img_b.hdr, buf_size, 1);
-
-		/* Set image pointer and length for output */
-		img.hdr = img_b.hdr;
-		max_length = buf_size;
+		img_b.hdr.image_length = htonl(buf_size);
+		checksum(fd, 0, &img_b.hdr, buf_size, 1);
+		if (pwrite(fd, &img_b.hdr, sizeof(struct image_header), 0) != sizeof(struct image_header)) {
+			ERROR("Unable to create image file \"%s\".", fname_out);
+			goto out_close;
+		}
 	}
 
-	/* Save new firmware image */
-	if (fname_out != NULL)
-		fdata.name = fname_out;
-	else
-		sprintf(fdata.name, "%s-new", fname_in);
+	ret = EXIT_SUCCESS;
+	printf("Image file \"%s\" successfully rebuilt.\n", fname_out);
 
-	fdata.size = max_length;
-	ret = write_from_buffer(&fdata, (char *)img.hdr);
-	if (ret) {
-		ERROR("Unable to create image file \"%s\".", fdata.name);
-		goto out_free_img;
+ out_close:
+	if (close(fd) && ret == EXIT_SUCCESS) {
+		ERROR("Unable to create image file \"%s\".", fname_out);
+		ret = EXIT_FAILURE;
 	}
-
-	printf("Image file \"%s\" successfully rebuilt.\n", fdata.name);
-
- out_free_img:
-	free(img_buf);
-
- out_free_hdr:
-	free(hdr_buf);
+	if (ret != EXIT_SUCCESS)
+		unlink(fname_out);
 
  out_free_name:
+	free(out_name);
+	free(bootldr.name);
 	free(new_name);
 
  out:
@@ -856,6 +1014,8 @@ static int build_image(char *fname_in, char *fname_out)
 }
 
 
+
+
 /*
  * Main Entry Point.
  *
@@ -869,6 +1029,7 @@ int main(int argc, char *argv[])
 	int ret = EXIT_FAILURE;
 	int cmd, opt;
 
+	fmk_stats_init("tpl-tool");
 
 	while ( 1 ) {
 		opt = getopt(argc, argv, "b:x:s:o:h");
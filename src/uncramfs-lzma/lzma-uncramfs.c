@@ -19,6 +19,7 @@
 //#include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/mman.h>
 #include <sys/fcntl.h>
 #include <stdlib.h>
@@ -33,6 +34,7 @@ typedef unsigned int u32;
 
 // Cramfs definitions
 #include "cramfs.h"
+#include "../cramfs-2.x/cramfs_swap.h"
 #include "lzma-rg/SRC/7zip/Compress/LZMA_C/LzmaDecode.h"
 #include "lzma-rg/SRC/7zip/Compress/LZMA_C/decode.h"
 
@@ -46,6 +48,9 @@ static const char* progname = "uncramfs";
 static char *opt_devfile = NULL;
 static char *opt_idsfile = NULL;
 
+// Set for images in the other byte order, e.g. big-endian ones on x86
+static int swapped = 0;
+
 // Get version number from external file
 static const char*
 #include "VERSION"
@@ -77,47 +82,104 @@ static void usage(void)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Block pointers are in the byte order of the image
+u32 block_pointer(const u32* buffs, int block)
+{
+   return swapped ? bswap_32(buffs[block]) : buffs[block];
+}
+
 u32 compressed_size(const u8* base, const u8* data, u32 size)
 {
    const u32* buffs=(const u32*)(data);
    int nblocks=(size-1)/blksize+1;
-   const u8* buffend=base+*(buffs+nblocks-1);
    
    if (size == 0)
      return 0;
    else
-     return buffend-data;
+     return base+block_pointer(buffs, nblocks-1)-data;
 }
 
-int uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
+// Decode page 'block' of the file at data into page, which holds blksize
+// bytes.  Each page is a stream of its own, but the decoder keeps its
+// probability tables allocated from one page to the next.
+int uncompress_page(const u8* base, const u8* data, u32 size, int block,
+		    u8* page)
 {
-  printf("entering uncompress_data\n");
    const u32* buffs=(const u32*)(data);
    int nblocks=(size-1)/blksize+1;
-   const u8* buff=(const u8*)(buffs+nblocks);
-   const u8* nbuff;
-   int block=0;
-   uLongf len=size;
-   
+   const u8* buff=block ? base+block_pointer(buffs, block-1) : (const u8*)(buffs+nblocks);
+   const u8* nbuff=base+block_pointer(buffs, block);
+   u32 tran=(block == nblocks-1) ? size-block*blksize : blksize;
+
+   // A page without data is a hole
+   if (nbuff == buff) {
+      memset(page, 0, tran);
+      return tran;
+   }
+
+   if (nbuff < buff ||
+       lzma_decode(page, tran, (void*)buff, nbuff-buff) != tran) {
+      fprintf(stderr,"Uncompression failed\n");
+      return -1;
+   }
+   return tran;
+}
+
+int uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
+{
+   int nblocks=(size-1)/blksize+1;
+   int block;
+
    if (size == 0) {
      return 0;
    }
-   
-   for (;
-	block < nblocks;
-	++block, buff=nbuff, dstdata+=blksize, len-=blksize
-	) {
-      uLongf tran=(len < blksize) ? len : blksize;
-      nbuff=base+*(buffs+block);
-      printf("dstlen %d compresslen %d\n",tran,nbuff-buff);
-      if (lzma_decode(dstdata, tran, buff, nbuff-buff) == -2) {
-	 fprintf(stderr,"Uncompression failed");
+
+   for (block=0; block < nblocks; ++block, dstdata+=blksize) {
+      if (uncompress_page(base, data, size, block, dstdata) == -1)
+	 return -1;
+   }
+   return 0;
+}
+
+int write_all(int fd, const u8* buff, u32 len)
+{
+   while (len) {
+      ssize_t res=write(fd, buff, len);
+
+      if (res == -1) {
+	 if (errno == EINTR)
+	   continue;
+	 perror("write");
 	 return -1;
       }
-      else
-      {
-         return 0;
-      }
+      buff+=res;
+      len-=res;
+   }
+   return 0;
+}
+
+// Decode a file a page at a time into one reused page buffer, writing
+// each page out as soon as it is decoded
+int uncompress_file(const u8* base, const u8* data, u32 size, int fd)
+{
+   static u8* page=NULL;
+   int nblocks=(size-1)/blksize+1;
+   int block;
+
+   if (size == 0) {
+     return 0;
+   }
+
+   if (page == NULL && (page=malloc(blksize)) == NULL) {
+      perror("malloc");
+      return -1;
+   }
+
+   for (block=0; block < nblocks; ++block) {
+      int len=uncompress_page(base, data, size, block, page);
+
+      if (len == -1 || write_all(fd, page, len) == -1)
+	 return -1;
    }
    return 0;
 }
@@ -225,7 +287,6 @@ void do_file(const u8* base, u32 offset, u32 size,
 	     const char* path, const char* name, int mode)
 {
    int fd;
-   u8* file_data;
    const u8* srcdata;
    
    // Allow for uncompressed XIP executable
@@ -252,36 +313,22 @@ void do_file(const u8* base, u32 offset, u32 size,
    }
 
    // Make local copy
-   fd=open(path, O_CREAT|O_TRUNC|O_RDWR, mode);
+   fd=open(path, O_CREAT|O_TRUNC|O_WRONLY, mode);
    if (fd == -1) {
       perror("create");
       return;
    };
 
-   if (ftruncate(fd, size) == -1) {
-      perror("ftruncate");
-      close(fd);
-      return;
-   }
-   
-   file_data = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-   if (file_data == MAP_FAILED) {
-      perror("mmap");
-      close(fd);
-      return;
-   }
-
    // Allow for uncompressed XIP executable
    if (mode & S_ISVTX) {
-      memcpy(file_data, srcdata, size);
+      write_all(fd, srcdata, size);
    } else {
-      if(uncompress_data(base, base+offset, size, file_data) == -1)
+      if(uncompress_file(base, base+offset, size, fd) == -1)
       {
          printf("failed to decompress data\n");
       }
    }
    
-   munmap(file_data, size);
    close(fd);
 
 }
@@ -466,6 +513,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 		  const char* path)
 {
    struct cramfs_inode* de;
+   struct cramfs_inode inode;
    char* name;
    int namelen;
    u32 current=offset;
@@ -476,7 +524,10 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
       u32 nextoffset;
       
       de=(struct cramfs_inode*)(base+current);
-      namelen=de->namelen<<2;
+      inode=*de;
+      if (swapped)
+	cramfs_inode_to_host(&inode);
+      namelen=inode.namelen<<2;
       nextoffset=current+sizeof(struct cramfs_inode)+namelen;
       
       name=(char*)(de+1);
@@ -489,7 +540,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 	 namelen--;
       }
 
-      do_file_entry(base, dir, path, name, namelen, de);
+      do_file_entry(base, dir, path, name, namelen, &inode);
       
       current=nextoffset;
    }
@@ -500,7 +551,10 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
       u32 nextoffset;
       
       de=(struct cramfs_inode*)(base+current);
-      namelen=de->namelen<<2;
+      inode=*de;
+      if (swapped)
+	cramfs_inode_to_host(&inode);
+      namelen=inode.namelen<<2;
       nextoffset=current+sizeof(struct cramfs_inode)+namelen;
       
       name=(char*)(de+1);
@@ -513,7 +567,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 	 namelen--;
       }
 
-      do_dir_entry(base, dir, path, name, namelen, de);
+      do_dir_entry(base, dir, path, name, namelen, &inode);
       
       current=nextoffset;
    }
@@ -664,6 +718,7 @@ int main(int argc, char **argv)
    size_t fslen_ub;
    u8 const* rom_image;
    struct cramfs_super const* sb;
+   struct cramfs_inode root;
    int i;
 
    // Check the program usage
@@ -727,11 +782,15 @@ int main(int argc, char **argv)
    
    sb=(struct cramfs_super const*)(rom_image);
    // Check cramfs magic number and signature
-   if (CRAMFS_MAGIC != sb->magic ||
+   if ((CRAMFS_MAGIC != sb->magic && bswap_32(CRAMFS_MAGIC) != sb->magic) ||
        0 != memcmp(sb->signature, CRAMFS_SIGNATURE, sizeof(sb->signature))) {
       fprintf(stderr,"The image file doesn't have cramfs signatures\n");
       exit(1);
    }
+   swapped = sb->magic != CRAMFS_MAGIC;
+   root=sb->root;
+   if (swapped)
+     cramfs_inode_to_host(&root);
 
    // Set umask to 0 to let the image modes shine through
    umask(0);
@@ -743,15 +802,17 @@ int main(int argc, char **argv)
      printf("%02x", sb->fsid[i]);
    printf("]\n");
    printf("[Volume name: %s]\n", sb->name);
+   if (swapped)
+     printf("[Volume byte order: %s-endian]\n", CRAMFS_HOST_BIG_ENDIAN ? "little" : "big");
    printf("\n");
 
    clearstats();
    
    // Start doing...
    printf("do file entry \n");
-   do_file_entry(rom_image, dirname, "", "", 0, &sb->root);
+   do_file_entry(rom_image, dirname, "", "", 0, &root);
    printf("do dir entry\n");
-   do_dir_entry(rom_image, dirname, "", "", 0, &sb->root);
+   do_dir_entry(rom_image, dirname, "", "", 0, &root);
    
    //process_directory(rom_image, dirname, sb->root.offset<<2, sb->root.size, ".");
    
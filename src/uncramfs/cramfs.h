@@ -37,6 +37,10 @@ struct cramfs_super {
 	struct cramfs_inode root;	/* Root inode data */
 };
 
+/* Block size of mkcramfs -b, as log2(block size) - 12 */
+#define CRAMFS_FLAG_BLKSZ_MASK		0x00003800
+#define CRAMFS_FLAG_BLKSZ_SHIFT		11
+
 /*
  * Valid values in super.flags.  Currently we refuse to mount
  * if (flags & ~CRAMFS_SUPPORTED_FLAGS).  Maybe that should be
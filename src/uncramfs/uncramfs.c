@@ -7,9 +7,11 @@
 // Licensed according to the GNU GPL v2
 //
 
+#define _GNU_SOURCE
+
 // C things
 #include <stdio.h>
-//#include <stdlib.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -24,6 +26,9 @@
 
 // Application libraries
 #include <zlib.h>
+#include "../zbuf/zbuf.h"
+#include "../fmkstats/fmkstats.h"
+#include "../fmkpool/fmkpool.h"
 
 // Needed by cramfs
 typedef unsigned char u8;
@@ -32,16 +37,22 @@ typedef unsigned int u32;
 
 // Cramfs definitions
 #include "cramfs.h"
+#include "../cramfs-2.x/cramfs_swap.h"
 
 #define PAGE_CACHE_SIZE (4096)
 
-/* The kernel assumes PAGE_CACHE_SIZE as block size. */
+/* The kernel assumes PAGE_CACHE_SIZE as block size, mkcramfs -b sets
+   a larger one in the flags. */
 static unsigned int blksize = PAGE_CACHE_SIZE;
 
 static const char* progname = "uncramfs";
 
 static char *opt_devfile = NULL;
 static char *opt_idsfile = NULL;
+static int opt_threads = 0;
+
+// Set for images in the other byte order, e.g. big-endian ones on x86
+static int swapped = 0;
 
 // Get version number from external file
 static const char*
@@ -66,24 +77,32 @@ static void usage(void)
 {
    printf(
      "%s v%s by Andrew Stitcher\n"
-     "Usage: '%s [-d devfilename] [-m modefilename] dirname infile'\n"
+     "Usage: '%s [-d devfilename] [-m modefilename] [-t threads] dirname infile'\n"
      " where <dirname> is the root for the\n"
-     " uncompressed (output) filesystem.\n", progname, VERSION, progname);
+     " uncompressed (output) filesystem.\n"
+     " Files are written by <threads> threads, by default one per CPU\n"
+     " or FMK_PROCESSORS.\n"
+     "Decompressing with %s.\n", progname, VERSION, progname, zbuf_backend());
    exit(1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Block pointers are in the byte order of the image
+u32 block_pointer(const u32* buffs, int block)
+{
+   return swapped ? bswap_32(buffs[block]) : buffs[block];
+}
+
 u32 compressed_size(const u8* base, const u8* data, u32 size)
 {
    const u32* buffs=(const u32*)(data);
    int nblocks=(size-1)/blksize+1;
-   const u8* buffend=base+*(buffs+nblocks-1);
    
    if (size == 0)
      return 0;
    else
-     return buffend-data;
+     return base+block_pointer(buffs, nblocks-1)-data;
 }
 
 void uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
@@ -93,7 +112,7 @@ void uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
    const u8* buff=(const u8*)(buffs+nblocks);
    const u8* nbuff;
    int block=0;
-   uLongf len=size;
+   unsigned long len=size;
    
    if (size == 0) {
      return;
@@ -103,9 +122,9 @@ void uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
 	block < nblocks;
 	++block, buff=nbuff, dstdata+=blksize, len-=blksize
 	) {
-      uLongf tran=(len < blksize) ? len : blksize;
-      nbuff=base+*(buffs+block);
-      if (uncompress(dstdata, &tran, buff, nbuff-buff) != Z_OK) {
+      unsigned long tran=(len < blksize) ? len : blksize;
+      nbuff=base+block_pointer(buffs, block);
+      if (zbuf_uncompress(dstdata, &tran, buff, nbuff-buff) != Z_OK) {
 	 fprintf(stderr,"Uncompression failed");
 	 return;
       }
@@ -114,6 +133,178 @@ void uncompress_data(const u8* base, const u8* data, u32 size, u8* dstdata)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Regular files are created at their full size and listed by the
+// directory walk, and then written as tasks of the pool, see fmkpool.h
+struct file_job {
+   char* path;
+   const u8* base;
+   const u8* data;
+   u32 size;
+   int mode;
+};
+
+static struct file_job* jobs;
+static int njobs, jobs_size;
+static struct fmk_pool* pool;
+static u8** buffers;		// one for each slot of the pool
+
+void add_job(const char* path, const u8* base, const u8* data, u32 size, int mode)
+{
+   if (njobs == jobs_size) {
+      jobs_size = jobs_size ? jobs_size*2 : 256;
+      jobs = realloc(jobs, jobs_size*sizeof(struct file_job));
+      if (!jobs) {
+	 perror("realloc");
+	 exit(1);
+      }
+   }
+   jobs[njobs].path = strdup(path);
+   if (!jobs[njobs].path) {
+      perror("strdup");
+      exit(1);
+   }
+   jobs[njobs].base = base;
+   jobs[njobs].data = data;
+   jobs[njobs].size = size;
+   jobs[njobs].mode = mode;
+   njobs++;
+}
+
+// Word at a time, as most blocks that are zero at all are zero throughout
+int is_zero(const u8* buf, u32 len)
+{
+   const unsigned long* word;
+
+   for (; len && ((unsigned long)buf & (sizeof(long)-1)); --len)
+     if (*buf++)
+       return 0;
+   word=(const unsigned long*)buf;
+   for (; len >= 4*sizeof(long); len-=4*sizeof(long), word+=4)
+     if (word[0] | word[1] | word[2] | word[3])
+       return 0;
+   for (buf=(const u8*)word; len; --len)
+     if (*buf++)
+       return 0;
+   return 1;
+}
+
+int pwrite_all(int fd, const u8* buf, u32 len, u32 offset)
+{
+   while (len) {
+      ssize_t res = pwrite(fd, buf, len, offset);
+
+      if (res == -1) {
+	 if (errno == EINTR)
+	   continue;
+	 return -1;
+      }
+      buf += res;
+      len -= res;
+      offset += res;
+   }
+   return 0;
+}
+
+void extract_file(const struct file_job* job, u8* buffer)
+{
+   int fd=open(job->path, O_WRONLY);
+   long long fmk_start, fmk_block;
+
+   if (fd == -1) {
+      perror(job->path);
+      return;
+   }
+
+   FMK_STAGE_BEGIN(write_file, fmk_start);
+
+   // Allow for uncompressed XIP executable, written straight from the image
+   if (job->mode & S_ISVTX) {
+      if (pwrite_all(fd, job->data, job->size, 0) == -1)
+	perror(job->path);
+   } else if (job->size) {
+      // The same block pointer walk as compressed_size()
+      const u32* buffs=(const u32*)(job->data);
+      int nblocks=(job->size-1)/blksize+1;
+      const u8* buff=(const u8*)(buffs+nblocks);
+      const u8* nbuff;
+      int block;
+
+      for (block=0; block < nblocks; ++block, buff=nbuff) {
+	 u32 pos=block*blksize;
+	 unsigned long tran=(job->size-pos < blksize) ? job->size-pos : blksize;
+
+	 nbuff=job->base+block_pointer(buffs, block);
+
+	 // Holes, and blocks that were stored as zeros, are left as holes
+	 // in the sparse file
+	 if (nbuff == buff)
+	   continue;
+	 FMK_STAGE_BEGIN(decompress_block, fmk_block);
+	 if (zbuf_uncompress(buffer, &tran, buff, nbuff-buff) != Z_OK) {
+	    fprintf(stderr,"Uncompression failed: %s\n", job->path);
+	    break;
+	 }
+	 FMK_STAGE_END(decompress_block, fmk_block, nbuff-buff, tran);
+	 if (is_zero(buffer, tran))
+	   continue;
+	 if (pwrite_all(fd, buffer, tran, pos) == -1) {
+	    perror(job->path);
+	    break;
+	 }
+      }
+   }
+
+   // Set now that the data is in, which would otherwise clear the
+   // set-id bits, or couldn't be written for lack of S_IWUSR
+   if ((geteuid() == 0 || !opt_idsfile) &&
+       (job->mode & (S_ISGID|S_ISUID|S_ISVTX) || !(job->mode & S_IWUSR))) {
+      if (fchmod(fd, job->mode) == -1)
+	perror("chmod");
+   }
+   close(fd);
+   FMK_STAGE_END(write_file, fmk_start, job->size, job->size);
+}
+
+void extract_task(void* arg)
+{
+   extract_file((const struct file_job*)arg, buffers[fmk_pool_slot(pool)]);
+}
+
+void extract_files()
+{
+   struct fmk_pool_group group;
+   int i;
+
+   pool=fmk_pool_get(opt_threads);
+   buffers=malloc((fmk_pool_size(pool)+1)*sizeof(u8*));
+   if (buffers == NULL) {
+      perror("malloc");
+      exit(1);
+   }
+   for (i=0; i <= fmk_pool_size(pool); ++i) {
+      buffers[i]=malloc(blksize);
+      if (buffers[i] == NULL) {
+	 perror("malloc");
+	 exit(1);
+      }
+   }
+
+   // The main thread writes files too while it waits
+   fmk_pool_group_init(&group, pool);
+   for (i=0; i < njobs; ++i)
+     fmk_pool_submit(&group, extract_task, &jobs[i], FMK_POOL_NORMAL);
+   fmk_pool_wait(&group, 0);
+
+   for (i=0; i <= fmk_pool_size(pool); ++i)
+     free(buffers[i]);
+   free(buffers);
+   for (i=0; i < njobs; ++i)
+     free(jobs[i].path);
+   free(jobs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 int stats_totalsize;
 int stats_totalcsize;
 int stats_count;
@@ -215,8 +406,7 @@ void do_file(const u8* base, u32 offset, u32 size,
 	     const char* path, const char* name, int mode)
 {
    int fd;
-   u8* file_data;
-   const u8* srcdata;
+   const u8* srcdata=NULL;
    
    // Allow for uncompressed XIP executable
    if (mode & S_ISVTX) {
@@ -228,7 +418,7 @@ void do_file(const u8* base, u32 offset, u32 size,
       // blksize must be a power of 2 for the following to work, but it seems
       // quite likely.
  
-      srcdata=(const u8*)(((u32)(base+offset)+blksize-1) & ~(blksize-1));
+      srcdata=(const u8*)(((unsigned long)(base+offset)+blksize-1) & ~(blksize-1));
       printsize(size, srcdata+size-(base+offset));
       printf("%s", name);
    } else {
@@ -241,36 +431,23 @@ void do_file(const u8* base, u32 offset, u32 size,
       return;
    }
 
-   // Make local copy
-   fd=open(path, O_CREAT|O_TRUNC|O_RDWR, mode);
+   // Create the file at its full size, extract_files() writes it.  It
+   // is writable until then, whatever its mode, and sparse, so that
+   // zero blocks cost nothing to extract.
+   fd=open(path, O_CREAT|O_TRUNC|O_WRONLY, mode | S_IWUSR);
    if (fd == -1) {
       perror("create");
       return;
    };
 
-   if (ftruncate(fd, size) == -1) {
+   if (size && ftruncate(fd, size) == -1) {
       perror("ftruncate");
       close(fd);
       return;
    }
-   
-   file_data = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-   if (file_data == MAP_FAILED) {
-      perror("mmap");
-      close(fd);
-      return;
-   }
-
-   // Allow for uncompressed XIP executable
-   if (mode & S_ISVTX) {
-      memcpy(file_data, srcdata, size);
-   } else {
-      uncompress_data(base, base+offset, size, file_data);
-   }
-   
-   munmap(file_data, size);
    close(fd);
 
+   add_job(path, base, (mode & S_ISVTX) ? srcdata : base+offset, size, mode);
 }
 
 void do_directory(const u8* base, u32 offset, u32 size,
@@ -453,6 +630,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 		  const char* path)
 {
    struct cramfs_inode* de;
+   struct cramfs_inode inode;
    char* name;
    int namelen;
    u32 current=offset;
@@ -463,7 +641,10 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
       u32 nextoffset;
       
       de=(struct cramfs_inode*)(base+current);
-      namelen=de->namelen<<2;
+      inode=*de;
+      if (swapped)
+	cramfs_inode_to_host(&inode);
+      namelen=inode.namelen<<2;
       nextoffset=current+sizeof(struct cramfs_inode)+namelen;
       
       name=(char*)(de+1);
@@ -476,7 +657,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 	 namelen--;
       }
 
-      do_file_entry(base, dir, path, name, namelen, de);
+      do_file_entry(base, dir, path, name, namelen, &inode);
       
       current=nextoffset;
    }
@@ -487,7 +668,10 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
       u32 nextoffset;
       
       de=(struct cramfs_inode*)(base+current);
-      namelen=de->namelen<<2;
+      inode=*de;
+      if (swapped)
+	cramfs_inode_to_host(&inode);
+      namelen=inode.namelen<<2;
       nextoffset=current+sizeof(struct cramfs_inode)+namelen;
       
       name=(char*)(de+1);
@@ -500,7 +684,7 @@ void process_directory(const u8* base, const char* dir, u32 offset, u32 size,
 	 namelen--;
       }
 
-      do_dir_entry(base, dir, path, name, namelen, de);
+      do_dir_entry(base, dir, path, name, namelen, &inode);
       
       current=nextoffset;
    }
@@ -588,7 +772,8 @@ void do_file_entry(const u8* base,
       fclose(f);
    }
 
-   if (geteuid() == 0 || !opt_idsfile) {
+   // Regular files get their mode once written, in extract_file()
+   if ((geteuid() == 0 || !opt_idsfile) && !S_ISREG(inode->mode)) {
       if (inode->mode & (S_ISGID|S_ISUID|S_ISVTX)) {
         if (0 != chmod(pname, inode->mode)){
           perror("chmod");
@@ -651,43 +836,35 @@ int main(int argc, char **argv)
    size_t fslen_ub;
    u8 const* rom_image;
    struct cramfs_super const* sb;
+   struct cramfs_inode root;
    int i;
+   long long fmk_start;
 
    // Check the program usage
    if (argc)
      progname = argv[0];
-   if (argc != 3 && argc != 5 && argc != 7)
-     usage();
-
-   if (argc == 3) {
-      dirname=argv[1];
-      imagefile=argv[2];
-   } else if (argc == 5) {
-      if (strcmp(argv[1],"-d")==0) {
-         opt_devfile = argv[2];
-      } else if (strcmp(argv[1],"-m")==0) {
-         opt_idsfile = argv[2];
-      } else
-         usage();
-      dirname=argv[3];
-      imagefile=argv[4];
-   } else {
-      if (strcmp(argv[1],"-d")==0) {
-         opt_devfile = argv[2];
-      } else if (strcmp(argv[1],"-m")==0) {
-         opt_idsfile = argv[2];
-      } else
-         usage();
-
-      if (strcmp(argv[3],"-d")==0 && !opt_devfile) {
-         opt_devfile = argv[4];
-      } else if (strcmp(argv[3],"-m")==0 && !opt_idsfile) {
-         opt_idsfile = argv[4];
-      } else
-         usage();
-      dirname=argv[5];
-      imagefile=argv[6];
+   fmk_stats_init("uncramfs");
+   while ((i = getopt(argc, argv, "d:m:t:")) != -1) {
+      switch (i) {
+       case 'd':
+	 opt_devfile = optarg;
+	 break;
+       case 'm':
+	 opt_idsfile = optarg;
+	 break;
+       case 't':
+	 opt_threads = atoi(optarg);
+	 if (opt_threads < 1)
+	   usage();
+	 break;
+       default:
+	 usage();
+      }
    }
+   if (argc - optind != 2)
+     usage();
+   dirname=argv[optind];
+   imagefile=argv[optind+1];
    
    // Check the directory
    if (access(dirname, W_OK) == -1) {
@@ -714,11 +891,17 @@ int main(int argc, char **argv)
    
    sb=(struct cramfs_super const*)(rom_image);
    // Check cramfs magic number and signature
-   if (CRAMFS_MAGIC != sb->magic ||
+   if ((CRAMFS_MAGIC != sb->magic && bswap_32(CRAMFS_MAGIC) != sb->magic) ||
        0 != memcmp(sb->signature, CRAMFS_SIGNATURE, sizeof(sb->signature))) {
       fprintf(stderr,"The image file doesn't have cramfs signatures\n");
       exit(1);
    }
+   swapped = sb->magic != CRAMFS_MAGIC;
+   root=sb->root;
+   if (swapped)
+     cramfs_inode_to_host(&root);
+   blksize <<= ((swapped ? bswap_32(sb->flags) : sb->flags) & CRAMFS_FLAG_BLKSZ_MASK)
+     >> CRAMFS_FLAG_BLKSZ_SHIFT;
 
    // Set umask to 0 to let the image modes shine through
    umask(0);
@@ -730,13 +913,20 @@ int main(int argc, char **argv)
      printf("%02x", sb->fsid[i]);
    printf("]\n");
    printf("[Volume name: %s]\n", sb->name);
+   if (swapped)
+     printf("[Volume byte order: %s-endian]\n", CRAMFS_HOST_BIG_ENDIAN ? "little" : "big");
+   if (blksize != PAGE_CACHE_SIZE)
+     printf("[Volume block size: %u]\n", blksize);
    printf("\n");
 
    clearstats();
    
    // Start doing...
-   do_file_entry(rom_image, dirname, "", "", 0, &sb->root);
-   do_dir_entry(rom_image, dirname, "", "", 0, &sb->root);
+   FMK_STAGE_BEGIN(scan, fmk_start);
+   do_file_entry(rom_image, dirname, "", "", 0, &root);
+   do_dir_entry(rom_image, dirname, "", "", 0, &root);
+   FMK_STAGE_END(scan, fmk_start, fslen_ub, njobs);
+   extract_files();
    
    //process_directory(rom_image, dirname, sb->root.offset<<2, sb->root.size, ".");
    
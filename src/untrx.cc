@@ -34,86 +34,11 @@
 #include <endian.h>
 #include <byteswap.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "untrx.h"
-
-/*************************************************************************
-* IdentifySegment
-*
-* identifies segments (i.e. squashfs, cramfs) and their version numbers
-*
-**************************************************************************/
-SEGMENT_TYPE IdentifySegment(unsigned char *pData, unsigned long nLength)
-{
-	squashfs_super_block *sqblock=(squashfs_super_block *)pData;
-	cramfs_super *crblock=(cramfs_super *)pData;
-	
-	if(sqblock->s_magic==SQUASHFS_MAGIC 
-		|| sqblock->s_magic==SQUASHFS_MAGIC_SWAP
-		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT
-		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT_SWAP)
-	{		
-		fprintf(stderr, " SQUASHFS magic: 0x%x\n", sqblock->s_magic);
-		short major = READ16_LE(sqblock->s_major);
-		short minor = READ16_LE(sqblock->s_minor);
-		fprintf(stderr, " SQUASHFS version: %d.%d\n", major, minor);
-	
-		switch(major)
-		{
-			case 3:
-				switch (minor)
-				{
-					case 0:						
-						return SEGMENT_TYPE_SQUASHFS_3_0;
-					case 1:						
-						return SEGMENT_TYPE_SQUASHFS_3_1;			
-					case 2:
-						return SEGMENT_TYPE_SQUASHFS_3_2;
-					default:
-						return SEGMENT_TYPE_SQUASHFS_3_x;						
-				}
-			case 2:
-				switch (minor)
-				{
-					case 0:
-						return SEGMENT_TYPE_SQUASHFS_2_0;
-					case 1:
-						return SEGMENT_TYPE_SQUASHFS_2_1;
-					default:
-						return SEGMENT_TYPE_SQUASHFS_2_x;						
-				}
-			default:
-				return SEGMENT_TYPE_SQUASHFS_OTHER;				
-		}
-	}	
-	else if(crblock->magic==CRAMFS_MAGIC || crblock->magic==CRAMFS_MAGIC_SWAP)
-	{
-		return SEGMENT_TYPE_CRAMFS_x_x;	
-	}	
-	return SEGMENT_TYPE_UNTYPED;
-}
-
-/*************************************************************************
-* EmitSquashfsMagic
-*
-* writes the squashfs root block signature to a file, as a fix for
-* Brainslayer of DD-WRT deciding to change it to some arbitrary value
-* to break compatibility with this kit.
-*
-**************************************************************************/
-bool EmitSquashfsMagic(squashfs_super_block *pSuper, char *pszOutFile)
-{
-	fprintf(stderr, "  Writing %s\n", pszOutFile);
-	FILE *fOut=fopen(pszOutFile,"wb");
-	if(!fOut) return false;
-	if(fwrite(pSuper,1,4,fOut)!=4)
-	{
-		fclose(fOut);
-		return false;
-	}
-	fclose(fOut);	
-	return true;
-}
+#include "fmkstats/fmkstats.h"
 
 /*************************************************************************
 * ShowUsage
@@ -123,68 +48,77 @@ bool EmitSquashfsMagic(squashfs_super_block *pSuper, char *pszOutFile)
 void ShowUsage()
 {			
 	fprintf(stderr, " ERROR: Invalid usage.\n"		
-		" USAGE: untrx binfile outfolder\n");	
+		" USAGE: untrx binfile outfolder\n"
+		"        untrx -b [-t threads] manifest|imagedir outfolder\n"
+		"  -b extracts every image listed in manifest or found in imagedir\n"
+		"     into its own folder under outfolder on a pool of threads and\n"
+		"     prints a tab separated segment report\n");	
 	exit(9);
 }
 
 /*************************************************************************
-* main
+* ExtractImage
 *
+* splits one trx image into pszOutFolder, reporting its segments to
+* fReport if given.  Returns 0, or the exit code for the failure.
 *
 **************************************************************************/
-int main(int argc, char **argv)
+int ExtractImage(const char *pszImage, const char *pszFolder, FILE *fReport)
 {
-	fprintf(stderr, " untrx " _VERSION_ " - (c)2006-2010 Jeremy Collake\n");
-	
-	if(argc<3)
+	Msg(" Opening %s\n", pszImage);
+	int fdIn=open(pszImage,O_RDONLY);
+	if(fdIn<0)
 	{
-		ShowUsage();
+		Msg(" ERROR opening %s\n", pszImage);
+		return 1;
 	}
 	
-	fprintf(stderr, " Opening %s\n", argv[1]);
-	FILE *fIn=fopen(argv[1],"rb");
-	if(!fIn)
-	{
-		fprintf(stderr, " ERROR opening %s\n", argv[1]);
-		exit(1);
-	}
-	
-	char *pszOutFolder=(char *)malloc(strlen(argv[2])+sizeof(char));
-	strcpy(pszOutFolder,argv[2]);
+	char *pszOutFolder=(char *)malloc(strlen(pszFolder)+sizeof(char));
+	strcpy(pszOutFolder,pszFolder);
 	if(pszOutFolder[strlen(pszOutFolder)-1]=='/')
 	{
 		pszOutFolder[strlen(pszOutFolder)-1]=0;		
 	}	
 	
-	fseek(fIn,0,SEEK_END);
-	size_t nFilesize=ftell(fIn);
-	fseek(fIn,0,SEEK_SET);		
-	unsigned char *pData=(unsigned char *)malloc(nFilesize);	
+	// map the image rather than reading it in; segments are copied
+	// out of fdIn by the kernel and only the headers are looked at here
+	struct stat st;
+	if(fstat(fdIn,&st)<0 || (size_t)st.st_size<HDR0_SIZE)
+	{
+		Msg(" ERROR reading %s\n", pszImage);		
+		close(fdIn);	
+		free(pszOutFolder);	
+		return 1;
+	}
+	size_t nFilesize=st.st_size;
+	unsigned char *pData=(unsigned char *)
+		mmap(NULL,nFilesize,PROT_READ,MAP_SHARED,fdIn,0);
 	unsigned char *pDataOrg=pData;
-	if(fread(pData,1,nFilesize,fIn)!=nFilesize)
+	if(pData==MAP_FAILED)
 	{
-		fprintf(stderr," ERROR reading %s\n", argv[1]);		
-		fclose(fIn);	
-		free(pDataOrg);
+		Msg(" ERROR reading %s\n", pszImage);		
+		close(fdIn);	
 		free(pszOutFolder);	
-		exit(1);
+		return 1;
 	}	
-	fclose(fIn);	
-	fprintf(stderr, " read %lu bytes\n", nFilesize);
+	Msg(" mapped %lu bytes\n", nFilesize);
 	
 	// uf U2ND header present, skip past it (pData is preserved above)
 	unsigned long nDataSkip=0;
 	trx_header *trx=(trx_header *)pData;
 	if(READ32_LE(trx->magic)!=TRX_MAGIC)
 	{
-		pData+=U2ND_HEADER_SIZE;			
+		nDataSkip=U2ND_HEADER_SIZE;
+		pData+=nDataSkip;			
 		trx=(trx_header *)pData;	
-		if(READ32_LE(trx->magic)!=TRX_MAGIC)
+		if(nFilesize<nDataSkip+HDR0_SIZE
+			|| READ32_LE(trx->magic)!=TRX_MAGIC)
 		{
-			fprintf(stderr," ERROR trx header not found\n");
-			free(pDataOrg);
+			Msg(" ERROR trx header not found\n");
+			munmap(pDataOrg,nFilesize);
+			close(fdIn);
 			free(pszOutFolder);	
-			exit(2);			
+			return 2;			
 		}
 	}
 	
@@ -195,8 +129,6 @@ int main(int argc, char **argv)
 	/* Extract the segments */
 	for(int nI=0;nI<3 && READ32_LE(trx->offsets[nI]);nI++)
 	{
-		FILE *fOut;			
-		
 		unsigned long nEndOffset=0;
 		if(nI<2)
 		{
@@ -204,92 +136,145 @@ int main(int argc, char **argv)
 		}
 		if(!nEndOffset)
 		{
-			nEndOffset=nFilesize;
+			nEndOffset=nFilesize-nDataSkip;
 		}		
+		if(READ32_LE(trx->offsets[nI])>=nEndOffset
+			|| nEndOffset>nFilesize-nDataSkip)
+		{
+			Msg(" ERROR segment %d is outside the image\n", nI+1);
+			munmap(pDataOrg,nFilesize);
+			close(fdIn);
+			free(pszOutFolder);	
+			free(pszTemp);
+			return 4;
+		}
 		
-		switch(IdentifySegment(pData+READ32_LE(trx->offsets[nI]),
-			nEndOffset-READ32_LE(trx->offsets[nI])))
+		short nMajor=0, nMinor=0;
+		long long nStart;
+		FMK_STAGE_BEGIN(scan, nStart);
+		SEGMENT_TYPE segType=IdentifySegment(pData+READ32_LE(trx->offsets[nI]),
+			nEndOffset-READ32_LE(trx->offsets[nI]),&nMajor,&nMinor);
+		FMK_STAGE_END(scan, nStart, nEndOffset-READ32_LE(trx->offsets[nI]), 1);
+		switch(segType)
 		{
 			case SEGMENT_TYPE_SQUASHFS_3_0:
-				fprintf(stderr, "  SQUASHFS v3.0 image detected\n");	
+				Msg("  SQUASHFS v3.0 image detected\n");	
 				sprintf(pszTemp,"%s/squashfs_magic",pszOutFolder);								
 				if(!EmitSquashfsMagic((squashfs_super_block *)((char *)pData
 					+READ32_LE(trx->offsets[nI])),pszTemp))
 				{
-					fprintf(stderr,"  ERROR - writing %s\n", pszTemp);
-					free(pDataOrg);
+					Msg("  ERROR - writing %s\n", pszTemp);
+					munmap(pDataOrg,nFilesize);
+					close(fdIn);
 					free(pszOutFolder);	
 					free(pszTemp);
-					exit(3);		
+					return 3;		
 				}				
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_0",pszOutFolder);				
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_1:
-				fprintf(stderr, "  SQUASHFS v3.1 image detected\n");
+				Msg("  SQUASHFS v3.1 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_1",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_2:
-				fprintf(stderr, "  SQUASHFS v3.2 image detected\n");
+				Msg("  SQUASHFS v3.2 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_2",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_3_x:
-				fprintf(stderr, "  SQUASHFS v3.x (>3.2) image detected\n");
+				Msg("  SQUASHFS v3.x (>3.2) image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-3_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_0:
-				fprintf(stderr, "  SQUASHFS v2.0 image detected\n");
+				Msg("  SQUASHFS v2.0 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_0",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_1:
-				fprintf(stderr, "  SQUASHFS v2.1 image detected\n");
+				Msg("  SQUASHFS v2.1 image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_1",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_2_x:
-				fprintf(stderr, "  SQUASHFS v2.x image detected\n");
+				Msg("  SQUASHFS v2.x image detected\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-2_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_SQUASHFS_OTHER:
-				fprintf(stderr, "  ! WARNING: Unknown squashfs version.\n");
+				Msg("  ! WARNING: Unknown squashfs version.\n");
 				sprintf(pszTemp,"%s/squashfs-lzma-image-x_x",pszOutFolder);
 				break;
 			case SEGMENT_TYPE_CRAMFS_x_x:
-				fprintf(stderr, "  CRAMFS v? image detected\n");
+				Msg("  CRAMFS v? image detected\n");
 				sprintf(pszTemp,"%s/cramfs-image-x_x",pszOutFolder);
 				break;				
 			default:
 				sprintf(pszTemp,"%s/segment%d",pszOutFolder,nI+1);
 				break;			
 		}		
-		fprintf(stderr,"  Writing %s\n    size %ld from offset %d ...\n", 
+		Msg("  Writing %s\n    size %ld from offset %d ...\n", 
 			pszTemp, 
 			nEndOffset-READ32_LE(trx->offsets[nI]),
 			READ32_LE(trx->offsets[nI]));		
 
-		fOut=fopen(pszTemp,"wb");
-		if(!fOut)
-		{
-			fprintf(stderr,"  ERROR could not open %s\n", pszTemp);
-			free(pDataOrg);
-			free(pszOutFolder);	
-			free(pszTemp);
-			exit(3);		
-		}				
-		if(!fwrite(pData+READ32_LE(trx->offsets[nI]),1,
-			nEndOffset-READ32_LE(trx->offsets[nI]),fOut))
+		FMK_SCOPED_STAGE(carve, carveStage);
+		carveStage.in=nEndOffset-READ32_LE(trx->offsets[nI]);
+		if(!WriteSegment(fdIn,nDataSkip+READ32_LE(trx->offsets[nI]),
+			nEndOffset-READ32_LE(trx->offsets[nI]),pszTemp))
 		{
-			fprintf(stderr," ERROR could not write %s\n", pszTemp);
-			fclose(fOut);
-			free(pDataOrg);
+			Msg(" ERROR could not write %s\n", pszTemp);
+			munmap(pDataOrg,nFilesize);
+			close(fdIn);
 			free(pszOutFolder);	
 			free(pszTemp);
-			exit(4);				
+			return 4;				
 		}
-		fclose(fOut);	
+		carveStage.out=carveStage.in;
+		ReportSegment(fReport,pszImage,nI+1,
+			nDataSkip+READ32_LE(trx->offsets[nI]),
+			nEndOffset-READ32_LE(trx->offsets[nI]),
+			segType,nMajor,nMinor,pszTemp);
 	}
 	
-	free(pDataOrg);
+	munmap(pDataOrg,nFilesize);
+	close(fdIn);
 	free(pszOutFolder);	
 	free(pszTemp);
-	printf("  Done!\n");
-	exit(0);
+	return 0;
+}
+
+/*************************************************************************
+* main
+*
+*
+**************************************************************************/
+int main(int argc, char **argv)
+{
+	fprintf(stderr, " untrx " _VERSION_ " - (c)2006-2010 Jeremy Collake\n");
+	fmk_stats_init("untrx");
+	
+	if(argc>1 && !strcmp(argv[1],"-b"))
+	{
+		int nThreads=sysconf(_SC_NPROCESSORS_ONLN);
+		int nArg=2;
+		if(argc>nArg+1 && !strcmp(argv[nArg],"-t"))
+		{
+			nThreads=atoi(argv[nArg+1]);
+			nArg+=2;
+		}
+		if(argc-nArg<2)
+		{
+			ShowUsage();
+		}
+		g_bVerbose=false;
+		exit(RunBatch(argv[nArg],argv[nArg+1],nThreads,ExtractImage));
+	}
+	
+	if(argc<3)
+	{
+		ShowUsage();
+	}
+	
+	int nResult=ExtractImage(argv[1],argv[2],NULL);
+	if(!nResult)
+	{
+		printf("  Done!\n");
+	}
+	exit(nResult);
 }
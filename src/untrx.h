@@ -25,6 +25,15 @@
 #ifndef _UNTRX_H
 #define _UNTRX_H
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
 /*
 #ifdef __cplusplus
 extern "C"
@@ -203,6 +212,420 @@ struct cramfs_super {
 	//struct cramfs_inode root;	/* Root inode data */
 };
 
+/************************************************************
+	messages
+************************************************************/
+
+/* progress messages go to stderr unless batch mode turns them off */
+bool g_bVerbose=true;
+
+void Msg(const char *pszFormat, ...)
+{
+	if(!g_bVerbose) return;
+	va_list args;
+	va_start(args,pszFormat);
+	vfprintf(stderr,pszFormat,args);
+	va_end(args);
+}
+
+/************************************************************
+	segment detection
+************************************************************/
+
+/*************************************************************************
+* IdentifySegment
+*
+* identifies segments (i.e. squashfs, cramfs) and their version numbers,
+* which are also handed back for squashfs if pnMajor/pnMinor are given
+*
+**************************************************************************/
+SEGMENT_TYPE IdentifySegment(unsigned char *pData, unsigned long nLength,
+	short *pnMajor=NULL, short *pnMinor=NULL)
+{
+	squashfs_super_block *sqblock=(squashfs_super_block *)pData;
+	cramfs_super *crblock=(cramfs_super *)pData;
+	
+	if(sqblock->s_magic==SQUASHFS_MAGIC 
+		|| sqblock->s_magic==SQUASHFS_MAGIC_SWAP
+		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT
+		|| sqblock->s_magic==SQUASHFS_MAGIC_ALT_SWAP)
+	{		
+		Msg(" SQUASHFS magic: 0x%x\n", sqblock->s_magic);
+		short major = READ16_LE(sqblock->s_major);
+		short minor = READ16_LE(sqblock->s_minor);
+		Msg(" SQUASHFS version: %d.%d\n", major, minor);
+		if(pnMajor) *pnMajor=major;
+		if(pnMinor) *pnMinor=minor;
+	
+		switch(major)
+		{
+			case 3:
+				switch (minor)
+				{
+					case 0:						
+						return SEGMENT_TYPE_SQUASHFS_3_0;
+					case 1:						
+						return SEGMENT_TYPE_SQUASHFS_3_1;			
+					case 2:
+						return SEGMENT_TYPE_SQUASHFS_3_2;
+					default:
+						return SEGMENT_TYPE_SQUASHFS_3_x;						
+				}
+			case 2:
+				switch (minor)
+				{
+					case 0:
+						return SEGMENT_TYPE_SQUASHFS_2_0;
+					case 1:
+						return SEGMENT_TYPE_SQUASHFS_2_1;
+					default:
+						return SEGMENT_TYPE_SQUASHFS_2_x;						
+				}
+			default:
+				return SEGMENT_TYPE_SQUASHFS_OTHER;				
+		}
+	}	
+	else if(crblock->magic==CRAMFS_MAGIC || crblock->magic==CRAMFS_MAGIC_SWAP)
+	{
+		return SEGMENT_TYPE_CRAMFS_x_x;	
+	}	
+	return SEGMENT_TYPE_UNTYPED;
+}
+
+/*************************************************************************
+* EmitSquashfsMagic
+*
+* writes the squashfs root block signature to a file, as a fix for
+* Brainslayer of DD-WRT deciding to change it to some arbitrary value
+* to break compatibility with this kit.
+*
+**************************************************************************/
+bool EmitSquashfsMagic(squashfs_super_block *pSuper, char *pszOutFile)
+{
+	Msg("  Writing %s\n", pszOutFile);
+	FILE *fOut=fopen(pszOutFile,"wb");
+	if(!fOut) return false;
+	if(fwrite(pSuper,1,4,fOut)!=4)
+	{
+		fclose(fOut);
+		return false;
+	}
+	fclose(fOut);	
+	return true;
+}
+
+/*************************************************************************
+* ReportSegment
+*
+* writes one tab separated report line for a segment: image, segment
+* number, offset, size, type, version and output file
+*
+**************************************************************************/
+void ReportSegment(FILE *fReport, const char *pszImage, int nSegment,
+	unsigned long nOffset, unsigned long nLength, SEGMENT_TYPE segType,
+	short nMajor, short nMinor, const char *pszOutFile)
+{
+	if(!fReport) return;
+	fprintf(fReport,"%s\t%d\t%lu\t%lu\t", pszImage, nSegment, nOffset, nLength);
+	if(segType>=SEGMENT_TYPE_SQUASHFS_2_0 && segType<=SEGMENT_TYPE_SQUASHFS_OTHER)
+	{
+		fprintf(fReport,"squashfs\t%d.%d", nMajor, nMinor);
+	}
+	else if(segType==SEGMENT_TYPE_CRAMFS_x_x)
+	{
+		fprintf(fReport,"cramfs\t-");
+	}
+	else
+	{
+		fprintf(fReport,"data\t-");
+	}
+	fprintf(fReport,"\t%s\n", pszOutFile);
+}
+
+/************************************************************
+	segment output
+************************************************************/
+
+/* AppendSegment: copies nLength bytes at nOffset of fdIn to the current
+   position of fdOut inside the kernel, with copy_file_range (which
+   reflinks on btrfs and XFS), then sendfile, then plain read/write
+   where neither works for the pair of files */
+bool AppendSegment(int fdIn, off_t nOffset, size_t nLength, int fdOut)
+{
+	bool bKernel=true;
+	while(nLength)
+	{
+		ssize_t nDone=-1;
+		if(bKernel)
+		{
+			loff_t nIn=nOffset;
+			nDone=copy_file_range(fdIn,&nIn,fdOut,NULL,nLength,0);
+			if(nDone<0 && (errno==EXDEV || errno==ENOSYS
+				|| errno==EINVAL || errno==EOPNOTSUPP))
+			{
+				off_t nSend=nOffset;
+				nDone=sendfile(fdOut,fdIn,&nSend,nLength);
+				if(nDone<0 && (errno==EINVAL || errno==ENOSYS))
+				{
+					bKernel=false;
+				}
+			}
+		}
+		if(!bKernel)
+		{
+			char buf[65536];
+			nDone=pread(fdIn,buf,
+				nLength<sizeof(buf) ? nLength : sizeof(buf),nOffset);
+			if(nDone>0 && write(fdOut,buf,nDone)!=nDone)
+			{
+				nDone=-1;
+			}
+		}
+		if(nDone<0 && errno==EINTR) continue;
+		if(nDone<=0)
+		{
+			return false;
+		}
+		nOffset+=nDone;
+		nLength-=nDone;
+	}
+	return true;
+}
+
+/* WriteSegment: AppendSegment into a new file pszOutFile */
+bool WriteSegment(int fdIn, off_t nOffset, size_t nLength,
+	const char *pszOutFile)
+{
+	int fdOut=open(pszOutFile,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(fdOut<0) return false;
+
+	if(!AppendSegment(fdIn,nOffset,nLength,fdOut))
+	{
+		close(fdOut);
+		return false;
+	}
+	return close(fdOut)==0;
+}
+
+/************************************************************
+	batch mode
+************************************************************/
+
+/* the per-image work of a tool: extracts pszImage into pszOutFolder,
+   writes its report lines to fReport and returns its exit code */
+typedef int (*EXTRACT_FUNC)(const char *pszImage, const char *pszOutFolder,
+	FILE *fReport);
+
+typedef struct _BATCH_JOB
+{
+	char *pszImage;
+	char *pszReport;
+	size_t nReport;
+	int nResult;
+} BATCH_JOB;
+
+typedef struct _BATCH
+{
+	BATCH_JOB *pJobs;
+	size_t nJobs;
+	size_t nNext;
+	const char *pszOutFolder;
+	EXTRACT_FUNC pfnExtract;
+	pthread_mutex_t lock;
+} BATCH;
+
+/* BatchAdd: queues one image, growing the job array by doubling */
+bool BatchAdd(BATCH *pBatch, size_t *pnAlloc, const char *pszImage)
+{
+	if(pBatch->nJobs==*pnAlloc)
+	{
+		size_t nAlloc=*pnAlloc ? *pnAlloc*2 : 256;
+		BATCH_JOB *pJobs=(BATCH_JOB *)
+			realloc(pBatch->pJobs,nAlloc*sizeof(BATCH_JOB));
+		if(!pJobs) return false;
+		pBatch->pJobs=pJobs;
+		*pnAlloc=nAlloc;
+	}
+	BATCH_JOB *pJob=&pBatch->pJobs[pBatch->nJobs];
+	memset(pJob,0,sizeof(BATCH_JOB));
+	pJob->pszImage=strdup(pszImage);
+	if(!pJob->pszImage) return false;
+	pBatch->nJobs++;
+	return true;
+}
+
+/* BatchWorker: takes images off the batch until none are left; each
+   extracts into its own folder, named after the image path with the
+   slashes turned into underscores so equal file names keep apart */
+void *BatchWorker(void *pArg)
+{
+	BATCH *pBatch=(BATCH *)pArg;
+	size_t nFolder=strlen(pBatch->pszOutFolder);
+
+	for(;;)
+	{
+		pthread_mutex_lock(&pBatch->lock);
+		size_t nJob=pBatch->nNext++;
+		pthread_mutex_unlock(&pBatch->lock);
+		if(nJob>=pBatch->nJobs) break;
+
+		BATCH_JOB *pJob=&pBatch->pJobs[nJob];
+		const char *pszName=pJob->pszImage;
+		while(*pszName=='.' || *pszName=='/') pszName++;
+		char *pszFolder=(char *)malloc(nFolder+strlen(pszName)+2);
+		FILE *fReport=open_memstream(&pJob->pszReport,&pJob->nReport);
+		if(!pszFolder || !fReport)
+		{
+			pJob->nResult=-1;
+			if(fReport) fclose(fReport);
+			free(pszFolder);
+			continue;
+		}
+		sprintf(pszFolder,"%s/%s",pBatch->pszOutFolder,pszName);
+		for(char *p=pszFolder+nFolder+1;*p;p++)
+		{
+			if(*p=='/') *p='_';
+		}
+		if(mkdir(pszFolder,0755)<0 && errno!=EEXIST)
+		{
+			pJob->nResult=-1;
+		}
+		else
+		{
+			pJob->nResult=pBatch->pfnExtract(pJob->pszImage,pszFolder,fReport);
+		}
+		fclose(fReport);
+		free(pszFolder);
+	}
+	return NULL;
+}
+
+/*************************************************************************
+* RunBatch
+*
+* extracts every image named in a manifest (one path per line, blank
+* lines and #comments skipped) or found in a directory, on nThreads
+* threads.  The report goes to stdout in input order: a line per segment
+* as written by ReportSegment, or "image<TAB>error<TAB>code" for images
+* that failed.  Returns 0 if all images went through, else 1.
+*
+**************************************************************************/
+int RunBatch(const char *pszList, const char *pszOutFolder, int nThreads,
+	EXTRACT_FUNC pfnExtract)
+{
+	BATCH batch;
+	size_t nAlloc=0;
+	struct stat st;
+
+	memset(&batch,0,sizeof(batch));
+	batch.pszOutFolder=pszOutFolder;
+	batch.pfnExtract=pfnExtract;
+	pthread_mutex_init(&batch.lock,NULL);
+
+	if(stat(pszList,&st)<0)
+	{
+		fprintf(stderr," ERROR opening %s\n", pszList);
+		return 1;
+	}
+	if(S_ISDIR(st.st_mode))
+	{
+		struct dirent **ppEntries;
+		int nEntries=scandir(pszList,&ppEntries,NULL,alphasort);
+		if(nEntries<0)
+		{
+			fprintf(stderr," ERROR opening %s\n", pszList);
+			return 1;
+		}
+		char *pszPath=(char *)malloc(strlen(pszList)+NAME_MAX+2);
+		for(int nI=0;nI<nEntries;nI++)
+		{
+			struct stat stEntry;
+			sprintf(pszPath,"%s/%s",pszList,ppEntries[nI]->d_name);
+			if(stat(pszPath,&stEntry)==0 && S_ISREG(stEntry.st_mode))
+			{
+				BatchAdd(&batch,&nAlloc,pszPath);
+			}
+			free(ppEntries[nI]);
+		}
+		free(ppEntries);
+		free(pszPath);
+	}
+	else
+	{
+		FILE *fList=fopen(pszList,"r");
+		if(!fList)
+		{
+			fprintf(stderr," ERROR opening %s\n", pszList);
+			return 1;
+		}
+		char *pszLine=NULL;
+		size_t nLine=0;
+		ssize_t nRead;
+		while((nRead=getline(&pszLine,&nLine,fList))>=0)
+		{
+			while(nRead && (pszLine[nRead-1]=='\n' || pszLine[nRead-1]=='\r'))
+			{
+				pszLine[--nRead]=0;
+			}
+			if(nRead && pszLine[0]!='#')
+			{
+				BatchAdd(&batch,&nAlloc,pszLine);
+			}
+		}
+		free(pszLine);
+		fclose(fList);
+	}
+
+	if(nThreads<1)
+	{
+		nThreads=1;
+	}
+	if((size_t)nThreads>batch.nJobs)
+	{
+		nThreads=batch.nJobs ? batch.nJobs : 1;
+	}
+	pthread_t *pThreads=(pthread_t *)malloc(nThreads*sizeof(pthread_t));
+	int nStarted=0;
+	for(int nI=0;pThreads && nI<nThreads;nI++)
+	{
+		if(pthread_create(&pThreads[nStarted],NULL,BatchWorker,&batch)==0)
+		{
+			nStarted++;
+		}
+	}
+	if(!nStarted)
+	{
+		BatchWorker(&batch);
+	}
+	for(int nI=0;nI<nStarted;nI++)
+	{
+		pthread_join(pThreads[nI],NULL);
+	}
+	free(pThreads);
+
+	int nFailed=0;
+	for(size_t nI=0;nI<batch.nJobs;nI++)
+	{
+		BATCH_JOB *pJob=&batch.pJobs[nI];
+		if(pJob->nReport)
+		{
+			fwrite(pJob->pszReport,1,pJob->nReport,stdout);
+		}
+		if(pJob->nResult)
+		{
+			printf("%s\terror\t%d\n", pJob->pszImage, pJob->nResult);
+			nFailed++;
+		}
+		free(pJob->pszReport);
+		free(pJob->pszImage);
+	}
+	free(batch.pJobs);
+	pthread_mutex_destroy(&batch.lock);
+
+	fprintf(stderr," %lu images, %d failed\n", batch.nJobs, nFailed);
+	return nFailed ? 1 : 0;
+}
+
 /*
 #ifdef __cplusplus
 }
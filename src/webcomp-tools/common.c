@@ -7,9 +7,21 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <elf.h>
 #include "common.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* A string that may head the websRomPageIndex file name table, and the first reference to it */
+struct asp_candidate
+{
+	uint32_t vaddr;
+	int ref;
+};
+
 /* Given the physical and virtual section loading addresses, convert a virtual address to a physical file offset */
 uint32_t file_offset(uint32_t address, uint32_t virtual, uint32_t physical)
 {
@@ -30,41 +42,43 @@ uint32_t virtual_address(uint32_t offset, uint32_t virtual, uint32_t physical)
 	return address;
 }
 
-/* Check to see if the data offsets reported by next_entry make sense; this is used to detect if the new or old webcomp data structures are in use. */
+/* Check to see if the data offsets reported by entry_iter_next make sense; this is used to detect if the new or old webcomp data structures are in use. */
 int are_entry_offsets_valid(unsigned char *data, uint32_t size)
 {
 	int retval = 0;
-	struct entry_info *first = NULL;
+	struct entry_iter iter;
+	struct entry_info first;
 
-	first = next_entry(data, size);
-	if(first)
+	entry_iter_init(&iter, data, size);
+
+	if(entry_iter_next(&iter, &first))
 	{
-		if(first->offset == 0 && (first->size < first->name_ptr))
+		if(first.offset == 0 && (first.size < first.name_ptr))
 		{
 			retval = 1;
 		}
-
-		free(first);
 	}
 
-	next_entry(NULL, 0);
-
 	return retval;
 }
 
+/* Starts an iteration over the web file entries in data, which must stay valid for the length of the walk */
+void entry_iter_init(struct entry_iter *iter, unsigned char *data, uint32_t size)
+{
+	iter->data = data;
+	iter->size = size;
+	iter->n = 0;
+	iter->total_size = 0;
+}
 
-/* Returns the next web file entry */
-struct entry_info *next_entry(unsigned char *data, uint32_t size)
+/* Fills in info with the next web file entry. Returns 0 once the end of the array is reached. */
+int entry_iter_next(struct entry_iter *iter, struct entry_info *info)
 {
-	static int n = 0, total_size = 0;
 	uint32_t entry_size = 0, offset = 0, str_offset = 0;
-	struct entry_info *info = NULL;
 
-	if(data == NULL || size == 0)
+	if(iter->data == NULL || iter->size == 0)
 	{
-		n = 0;
-		total_size = 0;
-		return NULL;
+		return 0;
 	}
 
 	if(globals.use_new_format)
@@ -77,67 +91,116 @@ struct entry_info *next_entry(unsigned char *data, uint32_t size)
 	}
 
 	/* Calculate the offset into the array for the next entry */
-	offset = globals.index_address + (entry_size * n);
+	offset = globals.index_address + (entry_size * iter->n);
 
-	if(offset < size)
+	if(offset >= iter->size || (iter->size - offset) < entry_size)
 	{
-		info = malloc(sizeof(struct entry_info));
-		if(info)
-		{
-			memset(info, 0, sizeof(struct entry_info));
+		return 0;
+	}
 
-			/* Calculate the offset if this firmware uses the new structure format */
-			if(globals.use_new_format)
-			{
-				info->new_entry = (struct new_file_entry *) (data + offset);
-				info->name_ptr = info->new_entry->name;
-				info->size = info->new_entry->size;
-				info->offset = total_size;
-				/* Convert data to little endian, if necessary */
-				ntoh_struct(info);
-				info->size -= globals.key;
-			}
-			else
-			{
-				info->entry = (struct file_entry *) (data + offset);
-				info->size = info->entry->size;
-				info->offset = info->entry->offset;
-				info->name_ptr = info->entry->name;
-				/* Convert data to little endian, if necessary */
-				ntoh_struct(info);
-			}
-				
-			/* A NULL entry name signifies the end of the array */
-			if(info->name_ptr == 0)
+	memset(info, 0, sizeof(struct entry_info));
+
+	/* Calculate the offset if this firmware uses the new structure format */
+	if(globals.use_new_format)
+	{
+		info->new_entry = (struct new_file_entry *) (iter->data + offset);
+		info->name_ptr = info->new_entry->name;
+		info->size = info->new_entry->size;
+		info->offset = iter->total_size;
+		/* Convert data to little endian, if necessary */
+		ntoh_struct(info);
+		info->size -= globals.key;
+	}
+	else
+	{
+		info->entry = (struct file_entry *) (iter->data + offset);
+		info->size = info->entry->size;
+		info->offset = info->entry->offset;
+		info->name_ptr = info->entry->name;
+		/* Convert data to little endian, if necessary */
+		ntoh_struct(info);
+	}
+		
+	/* A NULL entry name signifies the end of the array */
+	if(info->name_ptr == 0)
+	{
+		return 0;
+	}
+
+	/* Get the physical offset of the file name string */
+	str_offset = file_offset(info->name_ptr, globals.tv_address, globals.tv_offset);
+
+	/* Sanity check */
+	if(str_offset >= iter->size)
+	{
+		return 0;
+	}
+
+	/* Point entry->name at the actual string */
+	info->name = (char *) (iter->data + str_offset);
+
+	/* Track the total size of the processed entries so far, and increment the entry count */
+	iter->total_size += info->size;
+	iter->n++;
+
+	return 1;
+}
+
+/* Parses the whole web file entry table once, so that key detection, extraction and restoration can all share it */
+int entry_index_load(struct entry_index *index, unsigned char *data, uint32_t size)
+{
+	struct entry_iter iter;
+	struct entry_info info, *tmp = NULL;
+	int alloc = 0;
+
+	memset(index, 0, sizeof(struct entry_index));
+	entry_iter_init(&iter, data, size);
+
+	while(entry_iter_next(&iter, &info))
+	{
+		if(index->count == alloc)
+		{
+			alloc = alloc ? alloc * 2 : 64;
+			tmp = realloc(index->entries, alloc * sizeof(struct entry_info));
+			if(!tmp)
 			{
-				free(info);
-				info = NULL;
+				perror("realloc");
+				entry_index_free(index);
+				return 0;
 			}
-			else
-			{
-				/* Get the physical offset of the file name string */
-				str_offset = file_offset(info->name_ptr, globals.tv_address, globals.tv_offset);
+			index->entries = tmp;
+		}
 
-				/* Sanity check */
-				if(str_offset >= size)
-				{
-					free(info);
-					info = NULL;
-				}
-				else
-				{
-					/* Point entry->name at the actual string */
-					info->name = (char *) (data + str_offset);
+		index->entries[index->count++] = info;
+	}
 
-					/* Track the total size of the processed entries so far, and increment the entry count */
-					total_size += info->size;
-					n++;
-				}
-			}
+	return index->count;
+}
+
+/* Applies a key found after the index was loaded without one; only entry sizes in the new format carry it */
+void entry_index_set_key(struct entry_index *index, uint32_t key)
+{
+	int i = 0;
+	uint32_t total_size = 0;
+
+	if(globals.use_new_format)
+	{
+		for(i=0; i<index->count; i++)
+		{
+			index->entries[i].size -= key;
+			index->entries[i].offset = total_size;
+			total_size += index->entries[i].size;
 		}
 	}
 
-	return info;
+	return;
+}
+
+/* Releases the entries of an index */
+void entry_index_free(struct entry_index *index)
+{
+	if(index->entries) free(index->entries);
+	memset(index, 0, sizeof(struct entry_index));
 }
 
 /* Get the virtual addresses and physical offsets of the program headers in the ELF file */
@@ -229,71 +292,122 @@ int parse_elf_header(unsigned char *data, size_t size)
 /* Get the virtual offset to the websRomPageIndex variable */
 int find_websRomPageIndex(char *data, size_t size)
 {
-	int i = 0, len = 0, poff = 0, tmpoff = 0, retval = 0;
+	int i = 0, len = 0, n = 0, best = -1, retval = 0;
+	size_t slots = 0, slot = 0;
 	struct file_entry entry = { 0 };
+	struct asp_candidate *candidates = NULL, *tmp = NULL;
+	int *table = NULL;
 	uint32_t string_vaddr = 0;
+	char *p = data, *start = NULL;
 
 	/* Index may have already been set by user. If so, trust the user. */
 	if(globals.index_address != 0)
 	{
-		retval = 1;
+		return 1;
 	}
-	else
+
+	/* 
+	 * Collect every string containing '.asp' in one forward pass. Each one longer than ASP_LEN 
+	 * could be the first file name in the table, the earliest in the binary being the best bet.
+	 */
+	while((p = find_mem(p, (data+size-p), ASP, strlen(ASP))) != NULL)
 	{
-		while(tmpoff < size)
+		/* Find the beginning of the string by looping backwards from the '.asp' until we get a non-ASCII character */
+		start = p;
+		while(start > data && is_ascii(start-1, 1))
 		{
-			/* Find the location of the first string that ends in '.asp'  */
-			tmpoff = find(ASP, (data+tmpoff), (size-tmpoff));
-
-			/* Find the beginning of the string by looping backwards from the '.asp' until we get a non-ASCII character */
-			while(is_ascii((data+tmpoff), 1))
-			{
-				tmpoff--;
-			}
-			tmpoff++;
+			start--;
+		}
 
-			len = strlen(data+tmpoff);
+		len = strnlen(start, (data+size-start));
 
-			if(len > ASP_LEN)
+		if(len > ASP_LEN)
+		{
+			tmp = realloc(candidates, (n+1) * sizeof(struct asp_candidate));
+			if(!tmp)
 			{
-				poff = tmpoff;
 				break;
 			}
-			else
+			candidates = tmp;
+
+			/* Convert the file offset to a virtual address, swapping its endianess if necessary */
+			string_vaddr = virtual_address(start-data, globals.tv_address, globals.tv_offset);
+			if(globals.endianess == BIG_ENDIAN)
 			{
-				tmpoff += len;
+				string_vaddr = htonl(string_vaddr);
 			}
+
+			candidates[n].vaddr = string_vaddr;
+			candidates[n].ref = -1;
+			n++;
 		}
-	
-		if(poff)
+
+		p = start + len;
+	}
+
+	if(n == 0)
+	{
+		goto end;
+	}
+
+	/* Hash the candidates' virtual addresses so one pass over the binary can look for all of them */
+	for(slots = 16; slots < (size_t) n * 2; slots *= 2);
+	table = malloc(slots * sizeof(int));
+	if(!table)
+	{
+		goto end;
+	}
+	memset(table, 0xFF, slots * sizeof(int));
+
+	for(i=0; i<n; i++)
+	{
+		slot = HASH_VADDR(candidates[i].vaddr, slots);
+		while(table[slot] != -1)
 		{
-			/* Convert the file offset to a virtual address */
-			string_vaddr = virtual_address(poff, globals.tv_address, globals.tv_offset);
+			slot = (slot + 1) & (slots - 1);
+		}
+		table[slot] = i;
+	}
 
-			/* Swap the virtual address endinaess, if necessary */
-			if(globals.endianess == BIG_ENDIAN)
+	/* Loop through the binary looking for references to the strings' virtual addresses */	
+	for(i=globals.tv_offset; i<(size-sizeof(struct file_entry)) && best != 0; i++)
+	{
+		memcpy((void *) &entry, data+i, sizeof(struct file_entry));
+
+		for(slot = HASH_VADDR(entry.name, slots); table[slot] != -1; slot = (slot + 1) & (slots - 1))
+		{
+			if(candidates[table[slot]].vaddr == entry.name)
 			{
-				string_vaddr = htonl(string_vaddr);
+				break;
 			}
+		}
 
-			/* Loop through the binary looking for references to the string's virtual address */	
-			for(i=globals.tv_offset; i<(size-sizeof(struct file_entry)); i++)
-			{
-				memcpy((void *) &entry, data+i, sizeof(struct file_entry));
+		if(table[slot] == -1 || candidates[table[slot]].ref != -1)
+		{
+			continue;
+		}
 
-				/* The first entry in the structure array should have an offset of zero and a size greater than zero */
-				if(entry.name == string_vaddr && 
-				  ((entry.offset == 0 && entry.size < entry.name) || 
-				   (entry.size > 0)))
-				{
-					globals.index_address = i;
-					retval = 1;
-					break;
-				}
+		/* The first entry in the structure array should have an offset of zero and a size greater than zero */
+		if((entry.offset == 0 && entry.size < entry.name) || (entry.size > 0))
+		{
+			candidates[table[slot]].ref = i;
+
+			if(best == -1 || table[slot] < best)
+			{
+				best = table[slot];
 			}
 		}
 	}
 
+	if(best != -1)
+	{
+		globals.index_address = candidates[best].ref;
+		retval = 1;
+	}
+
+end:
+	if(table) free(table);
+	if(candidates) free(candidates);
 	return retval;
 }
 
@@ -369,23 +483,79 @@ int is_ascii(char *data, int len)
 	return retval;
 }
 
+/* 
+ * Find a needle in a haystack, returning a pointer to the first match or NULL. With SSE2, 16 offsets 
+ * are checked at a time for the needle's first and last bytes, and only those matching both compared.
+ */
+char *find_mem(char *haystack, size_t size, char *needle, size_t len)
+{
+	size_t i = 0;
+	char *p = NULL;
+
+	if(!haystack || !needle || len == 0 || len > size)
+	{
+		return NULL;
+	}
+
+#ifdef __SSE2__
+	{
+		__m128i first = _mm_set1_epi8(needle[0]);
+		__m128i last = _mm_set1_epi8(needle[len-1]);
+		__m128i a, b;
+		unsigned int mask = 0;
+
+		for(i=0; i+len-1+16 <= size; i+=16)
+		{
+			a = _mm_loadu_si128((__m128i *) (haystack+i));
+			b = _mm_loadu_si128((__m128i *) (haystack+i+len-1));
+			mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+			while(mask)
+			{
+				p = haystack + i + __builtin_ctz(mask);
+				if(memcmp(p, needle, len) == 0)
+				{
+					return p;
+				}
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+
+	/* The rest a first byte at a time */
+	while(i+len <= size)
+	{
+		p = memchr(haystack+i, needle[0], size-len+1-i);
+		if(!p)
+		{
+			break;
+		}
+
+		if(memcmp(p, needle, len) == 0)
+		{
+			return p;
+		}
+
+		i = p - haystack + 1;
+	}
+
+	return NULL;
+}
+
 /* Find a needle in a haystack */
 int find(char *needle, char *haystack, size_t size)
 {
-        int i = 0, offset = 0, len = 0;
+        int offset = 0;
+	char *p = NULL;
 
         if(haystack && needle)
         {
-		len = strlen(needle);
-
-                for(i=0; i<(size-len); i++)
-                {
-                        if(memcmp(haystack+i, needle, len) == 0)
-                        {
-                                offset = i;
-                                break;
-                        }
-                }
+		p = find_mem(haystack, size, needle, strlen(needle));
+		if(p)
+		{
+			offset = p - haystack;
+		}
         }
 
         return offset;
@@ -443,6 +613,59 @@ end:
         return buffer;
 }
 
+/* Maps in the contents of a file, privately and read only or shared and writable for updating it in place */
+unsigned char *file_map(char *file, size_t *fsize, int writable)
+{
+	int fd = -1;
+	struct stat _fstat = { 0 };
+	unsigned char *data = NULL;
+
+	*fsize = 0;
+
+	fd = open(file, (writable ? O_RDWR : O_RDONLY));
+	if(fd == -1)
+	{
+		perror(file);
+		goto end;
+	}
+
+	if(fstat(fd, &_fstat) == -1)
+	{
+		perror(file);
+		goto end;
+	}
+
+	if(_fstat.st_size == 0)
+	{
+		fprintf(stderr, "%s: zero size file\n", file);
+		goto end;
+	}
+
+	data = mmap(NULL, _fstat.st_size, (writable ? PROT_READ | PROT_WRITE : PROT_READ), (writable ? MAP_SHARED : MAP_PRIVATE), fd, 0);
+	if(data == MAP_FAILED)
+	{
+		perror(file);
+		data = NULL;
+	}
+	else
+	{
+		*fsize = _fstat.st_size;
+	}
+
+end:
+	if(fd != -1) close(fd);
+	return data;
+}
+
+/* Undoes file_map */
+void file_unmap(unsigned char *data, size_t size)
+{
+	if(data && size)
+	{
+		munmap(data, size);
+	}
+}
+
 /* Writes data to the specified file */
 int file_write(char *file, unsigned char *data, size_t size)
 {
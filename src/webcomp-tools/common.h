@@ -11,6 +11,9 @@
 #define ELF_MAGIC		"\x7F\x45\x4C\x46"
 #define NUM_PROGRAM_HEADERS	2
 
+/* Slot of a virtual address in a power of two sized hash table */
+#define HASH_VADDR(v, slots)	(((uint32_t) (v) * 2654435761U) >> 7 & ((slots) - 1))
+
 #pragma pack(1)
 
 /* Used by later versions of DD-WRT */
@@ -50,19 +53,42 @@ struct global
 	uint32_t key;
 } globals;
 
+/* Cursor over the websRomPageIndex entries, kept on the caller's stack */
+struct entry_iter
+{
+	unsigned char *data;
+	uint32_t size;
+	uint32_t n;
+	uint32_t total_size;
+};
+
+/* Every web file entry of an httpd binary, as parsed by entry_index_load */
+struct entry_index
+{
+	struct entry_info *entries;
+	int count;
+};
+
 void mkdir_p(char *dir);
 char *make_path_safe(char *path);
 int is_ascii(char *data, int len);
 char *file_read(char *file, size_t *fsize);
+unsigned char *file_map(char *file, size_t *fsize, int writable);
+void file_unmap(unsigned char *data, size_t size);
 void ntoh_struct(struct entry_info *info);
 void hton_struct(struct entry_info *info);
 void hton_entries(struct entry_info *info);
 int find_websRomPageIndex(char *data, size_t size);
 int find(char *needle, char *haystack, size_t size);
+char *find_mem(char *haystack, size_t size, char *needle, size_t len);
 int parse_elf_header(unsigned char *data, size_t size);
 int file_write(char *file, unsigned char *data, size_t size);
 int are_entry_offsets_valid(unsigned char *data, uint32_t size);
-struct entry_info *next_entry(unsigned char *data, uint32_t size);
+void entry_iter_init(struct entry_iter *iter, unsigned char *data, uint32_t size);
+int entry_iter_next(struct entry_iter *iter, struct entry_info *info);
+int entry_index_load(struct entry_index *index, unsigned char *data, uint32_t size);
+void entry_index_set_key(struct entry_index *index, uint32_t key);
+void entry_index_free(struct entry_index *index);
 uint32_t file_offset(uint32_t address, uint32_t virtual, uint32_t physical);
 uint32_t virtual_address(uint32_t offset, uint32_t virtual, uint32_t physical);
 
@@ -5,36 +5,47 @@
  * 07 September 2011
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <libgen.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <pthread.h>
 #include "common.h"
 #include "webdecomp.h"
 
+/* The number of files extract() writes in parallel */
+static long jobs = 1;
+
 int main(int argc, char *argv[])
 {
-	char *httpd = NULL, *www = NULL, *dir = NULL;
+	char *httpd = NULL, *www = NULL, *dir = NULL, *list = NULL;
 	int retval = EXIT_FAILURE, action = NONE, long_opt_index = 0, n = 0;
+	uint32_t key = 0, index_address = 0;
 	char c = 0;
 
-	char *short_options = "b:w:d:k:i:erh";
+	char *short_options = "b:w:d:k:i:l:j:erh";
 	struct option long_options[] = {
 		{ "httpd", required_argument, NULL, 'b' },
 		{ "www", required_argument, NULL, 'w' },
 		{ "dir", required_argument, NULL, 'd' },
 		{ "key", optional_argument, NULL, 'k' },
 		{ "index", required_argument, NULL, 'i' },
+		{ "list", required_argument, NULL, 'l' },
+		{ "jobs", required_argument, NULL, 'j' },
 		{ "extract", no_argument, NULL, 'e' },
 		{ "restore", no_argument, NULL, 'r' },
 		{ "help", no_argument, NULL, 'h' },
 		{ 0, 0, 0, 0 }
 	};
 
-	memset((void *) &globals, 0, sizeof(globals));
-	
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
 	while((c = getopt_long(argc, argv, short_options, long_options, &long_opt_index)) != -1)
 	{
 		switch(c)
@@ -49,7 +60,13 @@ int main(int argc, char *argv[])
 				dir = strdup(optarg);
 				break;
 			case 'k':
-				globals.key = atoi(optarg);
+				key = atoi(optarg);
+				break;
+			case 'l':
+				list = strdup(optarg);
+				break;
+			case 'j':
+				jobs = atol(optarg);
 				break;
 			case 'e':
 				action = EXTRACT;
@@ -58,7 +75,7 @@ int main(int argc, char *argv[])
 				action = RESTORE;
 				break;
 			case 'i':
-				globals.index_address = atoi(optarg);
+				index_address = atoi(optarg);
 				break;
 			default:
 				usage(argv[0]);
@@ -67,82 +84,182 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if(jobs < 1)
+	{
+		jobs = 1;
+	}
+
 	/* Verify that all required options were specified  */
 	/* Keyfile is optional */
-	if(action == NONE || httpd == NULL || www == NULL)
+	if(action == NONE || (list == NULL && (httpd == NULL || www == NULL)))
 	{
 		usage(argv[0]);
 		goto end;
 	}
 
-	/* If no output directory was specified, use the default (www) */
-	if(!dir)
+	if(list)
 	{
-		dir = strdup(DEFAULT_OUTDIR);
+		n = process_list(list, action, key, index_address);
+	}
+	else
+	{
+		/* If no output directory was specified, use the default (www) */
+		n = process_image(httpd, www, (dir ? dir : DEFAULT_OUTDIR), action, key, index_address);
 	}
 
-	/* Detect the websRomIndex settings. This must be done before detecting the key. */
-	if(detect_settings(httpd))
+	if(n > 0)
 	{
-		/* If no explicit key was specified, try to detect it */
-		if(!globals.key)
-		{
-			detect_key(httpd, www);
-		}
+		retval = EXIT_SUCCESS;
+	}
+
+end:
+	if(httpd) free(httpd);
+	if(www) free(www);
+	if(dir) free(dir);
+	if(list) free(list);
+	return retval;
+}
+
+/* Extracts or restores the Web files of one DD-WRT image. Returns the number of files processed. */
+int process_image(char *httpd, char *www, char *dir, int action, uint32_t key, uint32_t index_address)
+{
+	int n = 0;
+	struct webcomp_image image;
+
+	/* Each image gets its own settings, starting from those given by the user */
+	memset((void *) &globals, 0, sizeof(globals));
+	globals.key = key;
+	globals.index_address = index_address;
 
-		/* Extract! */
-		if(action == EXTRACT)
+	/* Restoring updates the entry table in httpd in place */
+	if(image_open(&image, httpd, www, (action == RESTORE)))
+	{
+		/* Detect the websRomIndex settings. This must be done before detecting the key. */
+		if(detect_settings(&image))
 		{
-			n = extract(httpd, www, dir);
+			/* If no explicit key was specified, try to detect it */
+			if(!globals.key)
+			{
+				detect_key(&image);
+				entry_index_set_key(&image.index, globals.key);
+			}
+
+			/* Extract! */
+			if(action == EXTRACT)
+			{
+				n = extract(&image, dir);
+			}
+			/* Restore! */
+			else if(action == RESTORE)
+			{
+				n = restore(&image, dir);
+			}
 		}
-		/* Restore! */
-		else if(action == RESTORE)
+		else
 		{
-			n = restore(httpd, www, dir);
+			fprintf(stderr, "Failed to detect httpd settings!\n");
 		}
 	}
-	else
-	{
-		fprintf(stderr, "Failed to detect httpd settings!\n");
-	}
+
+	image_close(&image);
 
 	if(n > 0)
 	{
 		printf("\nProcessed %d Web files using key 0x%X\n\n", n, globals.key);
-		retval = EXIT_SUCCESS;
 	}
 	else
 	{
 		fprintf(stderr, "Failed to process Web files!\n");
 	}
 
-end:
-	if(httpd) free(httpd);
-	if(www) free(www);
-	if(dir) free(dir);
-	return retval;
+	return n;
 }
 
-/* Initializes everything for extract() and restore() */
-int detect_settings(char *httpd_file)
+/* Processes each "<httpd> <www> [directory]" line of a list file. Returns the number of images processed, or 0 if any failed. */
+int process_list(char *list, int action, uint32_t key, uint32_t index_address)
 {
-	int retval = 0;
-	size_t httpd_size = 0;
-	unsigned char *httpd = NULL;
+	FILE *fp = NULL;
+	int n = 0, failed = 0;
+	char line[FILENAME_MAX * 3] = { 0 };
+	char *httpd = NULL, *www = NULL, *dir = NULL;
 
-	httpd = (unsigned char *) file_read(httpd_file, &httpd_size);
+	fp = fopen(list, "r");
+	if(!fp)
+	{
+		perror(list);
+		return 0;
+	}
 
-	if(httpd && parse_elf_header(httpd, httpd_size))
+	while(fgets(line, sizeof(line), fp))
 	{
-		if(find_websRomPageIndex((char *) httpd, httpd_size))
+		httpd = strtok(line, " \t\r\n");
+		if(httpd == NULL || httpd[0] == '#')
+		{
+			continue;
+		}
+
+		www = strtok(NULL, " \t\r\n");
+		dir = strtok(NULL, " \t\r\n");
+
+		if(www == NULL)
+		{
+			fprintf(stderr, "%s: no www file given for '%s'\n", list, httpd);
+			failed++;
+			continue;
+		}
+
+		if(process_image(httpd, www, (dir ? dir : DEFAULT_OUTDIR), action, key, index_address) > 0)
+		{
+			n++;
+		}
+		else
+		{
+			failed++;
+		}
+	}
+
+	fclose(fp);
+	return (failed ? 0 : n);
+}
+
+/* Maps in the httpd and www files of an image, httpd writable if it is to be updated */
+int image_open(struct webcomp_image *image, char *httpd, char *www, int writable)
+{
+	memset(image, 0, sizeof(struct webcomp_image));
+
+	image->httpd_file = httpd;
+	image->www_file = www;
+	image->hdata = file_map(httpd, &image->hsize, writable);
+	image->wdata = file_map(www, &image->wsize, 0);
+
+	return (image->hdata != NULL && image->wdata != NULL);
+}
+
+/* Unmaps an image and frees its entry index */
+void image_close(struct webcomp_image *image)
+{
+	entry_index_free(&image->index);
+	file_unmap(image->hdata, image->hsize);
+	file_unmap(image->wdata, image->wsize);
+	memset(image, 0, sizeof(struct webcomp_image));
+}
+
+/* Initializes everything for extract() and restore(), including the entry index they share */
+int detect_settings(struct webcomp_image *image)
+{
+	int retval = 0;
+
+	if(parse_elf_header(image->hdata, image->hsize))
+	{
+		if(find_websRomPageIndex((char *) image->hdata, image->hsize))
 		{
 			/* If the entry offsets are not valid, then the firmware must be using the new webcomp structure format */
-			if(!are_entry_offsets_valid(httpd, httpd_size))
+			if(!are_entry_offsets_valid(image->hdata, image->hsize))
 			{
 				globals.use_new_format = 1;
 			}
 
-			retval = 1;
+			retval = (entry_index_load(&image->index, image->hdata, image->hsize) > 0);
 		}
 		else
 		{
@@ -154,245 +271,499 @@ int detect_settings(char *httpd_file)
 		fprintf(stderr, "Failed to parse ELF header!\n");
 	}
 
-	if(httpd) free(httpd);
 	return retval;
 }
 
 /* Dynamically detect the key offset to be subtracted from each entry size.  */
-void detect_key(char *httpd, char *www)
+void detect_key(struct webcomp_image *image)
 {
-	int total_size = 0, total_entries = 0;
-	size_t hsize = 0, wsize = 0;
-	unsigned char *hdata = NULL, *wdata = NULL;
-	struct entry_info *info = NULL;
+	int i = 0, total_size = 0, total_entries = 0;
 
-	hdata = (unsigned char *) file_read(httpd, &hsize);
-	wdata = (unsigned char *) file_read(www, &wsize);
+	for(i=0; i<image->index.count; i++)
+	{
+		total_size += image->index.entries[i].size;
+		total_entries++;
+	}
 
-	if(hdata && wdata)
+	/* This should always be evenly divisble. */
+	if(total_entries && ((total_size - image->wsize) % total_entries) == 0)
+	{
+		globals.key = ((total_size - image->wsize) / total_entries);
+	}
+	else
 	{
-		/* Reset the next_entry counters for entry processing */
-		next_entry(NULL, 0);
+		fprintf(stderr, "WARNING: Failed to determine key based on %d entries with a total size of %d / %d\n", total_entries, total_size, (int) image->wsize);
+		globals.key = 0;
+	}
 
-		while((info = next_entry(hdata, hsize)) != NULL)
+	return;
+}
+
+/* Writes one entry's data from the www file to path, with copy_file_range where possible. Returns 1 on success. */
+int extract_entry(struct webcomp_image *image, int wfd, struct entry_info *info, char *path)
+{
+	int fd = -1, retval = 0;
+	size_t left = info->size;
+	ssize_t n = 0;
+#ifdef WEBCOMP_COPY_RANGE
+	loff_t offset = info->offset;
+#endif
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(fd == -1)
+	{
+		perror(path);
+		return 0;
+	}
+
+#ifdef WEBCOMP_COPY_RANGE
+	/* Let the kernel copy file to file; stop at the first error and write the rest from the mapped www */
+	while(wfd != -1 && left > 0)
+	{
+		n = copy_file_range(wfd, &offset, fd, NULL, left, 0);
+		if(n <= 0)
 		{
-			total_size += info->size;
-			total_entries++;
+			break;
 		}
+		left -= n;
 	}
-	else
+#endif
+
+	while(left > 0)
 	{
-		fprintf(stderr, "WARNING: Failed to read required files '%s' and '%s'. Cannot determine key.\n", httpd, www);
+		n = write(fd, (image->wdata + info->offset + (info->size - left)), left);
+		if(n <= 0)
+		{
+			if(n == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			perror(path);
+			break;
+		}
+		left -= n;
 	}
 
-	/* Reset the next_entry counters for subsequent entry processing */
-	next_entry(NULL, 0);
+	if(left == 0)
+	{
+		retval = 1;
+	}
 
-	if(hdata) free(hdata);
-	if(wdata) free(wdata);
+	close(fd);
+	return retval;
+}
 
-	/* This should always be evenly divisble. */
-	if(total_entries && ((total_size - wsize) % total_entries) == 0)
+/* The entries being written by the extract() workers, handed out in order */
+struct extract_queue
+{
+	struct webcomp_image *image;
+	char **paths;
+	int *status;
+	int next;
+	int wfd;
+	pthread_mutex_t lock;
+};
+
+void *extract_worker(void *arg)
+{
+	struct extract_queue *q = arg;
+	int i = 0;
+
+	while(1)
 	{
-		globals.key = ((total_size - wsize) / total_entries);
+		pthread_mutex_lock(&q->lock);
+		i = q->next++;
+		pthread_mutex_unlock(&q->lock);
+
+		if(i >= q->image->index.count)
+		{
+			break;
+		}
+
+		if(q->status[i] == EXTRACT_PENDING)
+		{
+			q->status[i] = extract_entry(q->image, q->wfd, &q->image->index.entries[i], q->paths[i]) ? EXTRACT_OK : EXTRACT_FAILED;
+		}
 	}
-	else
+
+	return NULL;
+}
+
+int strcmp_ptr(const void *a, const void *b)
+{
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/* Creates every directory the entries need, each once; a directory that is the parent of the next one is left to it */
+void extract_mkdirs(char **paths, int count)
+{
+	int i = 0, n = 0;
+	size_t len = 0;
+	char **dirs = NULL, *dir = NULL;
+
+	dirs = malloc(count * sizeof(char *));
+	if(!dirs)
 	{
-		fprintf(stderr, "WARNING: Failed to determine key based on %d entries with a total size of %d / %d\n", total_entries, total_size, wsize);
-		globals.key = 0;
+		perror("malloc");
+		return;
 	}
 
-	return;
+	for(i=0; i<count; i++)
+	{
+		if(paths[i])
+		{
+			/* dirname() clobbers the string you pass it, so make a temporary one */
+			dirs[n] = strdup(paths[i]);
+			if(dirs[n])
+			{
+				dir = dirname(dirs[n]);
+				memmove(dirs[n], dir, strlen(dir) + 1);
+				n++;
+			}
+		}
+	}
+
+	qsort(dirs, n, sizeof(char *), strcmp_ptr);
+
+	for(i=0; i<n; i++)
+	{
+		len = strlen(dirs[i]);
+
+		if(i+1 < n && strncmp(dirs[i], dirs[i+1], len) == 0 && (dirs[i+1][len] == '/' || dirs[i+1][len] == '\0'))
+		{
+			continue;
+		}
+
+		mkdir_p(dirs[i]);
+	}
+
+	for(i=0; i<n; i++)
+	{
+		free(dirs[i]);
+	}
+	free(dirs);
 }
 
 /* Extract embedded file contents from binary file(s) */
-int extract(char *httpd, char *www, char *outdir)
+int extract(struct webcomp_image *image, char *outdir)
 {
-	int n = 0;
-	size_t hsize = 0, wsize = 0;
+	int i = 0, n = 0, count = image->index.count;
+	long nthreads = jobs;
 	struct entry_info *info = NULL;
-	unsigned char *hdata = NULL, *wdata = NULL;
-	char *dir_tmp = NULL, *path = NULL;
-
-	/* Read in the httpd and www files */
-	hdata = (unsigned char *) file_read(httpd, &hsize);
-	wdata = (unsigned char *) file_read(www, &wsize);
-	
-	if(hdata != NULL && wdata != NULL)
-	{
-		/* Create the output directory, if it doesn't already exist */
-		mkdir_p(outdir);
-
-		/* Change directories to the output directory */
-        	if(chdir(outdir) == -1)
-        	{
-                	perror(outdir);
-        	}
-		else 
-		{
-			/* Get the next entry until we get a blank entry */
-			while((info = next_entry(hdata, hsize)) != NULL)
-			{
-				/* Make sure the full file path is safe (i.e., it won't overwrite something critical on the host system) */
-				path = make_path_safe(info->name);
-				if(path)
-				{
-					/* dirname() clobbers the string you pass it, so make a temporary one */
-					dir_tmp = strdup(path);
-					mkdir_p(dirname(dir_tmp));
-					free(dir_tmp);
-
-					/* Sanity checks on our buffer offsets and sizes */
-					if(info->offset >= 0 && info->size >= 0 && (info->offset + info->size) <= wsize)
-					{
-						/* Write the data to disk */
-						if(!file_write(path, (wdata + info->offset), info->size))
-						{
-							fprintf(stderr, "ERROR: Failed to extract file '%s'\n", info->name);
-						}
-						else
-						{
-							/* Display the file name */
-							printf("%s\n", info->name);
-							n++;
-						}
-					}
-					else
-					{
-						fprintf(stderr, "ERROR: Bad file size/offset for %s [ %d %d ]\n", info->name, info->size, info->offset);
-					}
-
-					free(path);
-				}
-				else
-				{
-					fprintf(stderr, "File path '%s' is not safe! Skipping...\n", info->name);
-				}
+	struct extract_queue q;
+	pthread_t *threads = NULL;
+	char origdir[FILENAME_MAX] = { 0 };
 
-				free(info);
-			}
+	memset(&q, 0, sizeof(q));
+	q.image = image;
+	q.wfd = -1;
+	q.paths = calloc(count + 1, sizeof(char *));
+	q.status = calloc(count + 1, sizeof(int));
+	if(!q.paths || !q.status)
+	{
+		perror("calloc");
+		goto end;
+	}
+
+	/* Get the current working directory, so that relative paths of later images will still work */
+	getcwd((char *) &origdir, sizeof(origdir));
+
+#ifdef WEBCOMP_COPY_RANGE
+	/* Opened before changing directories, in case the www path is relative */
+	q.wfd = open(image->www_file, O_RDONLY);
+#endif
+
+	/* Create the output directory, if it doesn't already exist */
+	mkdir_p(outdir);
+
+	/* Change directories to the output directory */
+	if(chdir(outdir) == -1)
+	{
+		perror(outdir);
+		goto end;
+	}
+
+	for(i=0; i<count; i++)
+	{
+		info = &image->index.entries[i];
+
+		/* Make sure the full file path is safe (i.e., it won't overwrite something critical on the host system) */
+		q.paths[i] = make_path_safe(info->name);
+		if(!q.paths[i])
+		{
+			q.status[i] = EXTRACT_UNSAFE;
+		}
+		/* Sanity checks on our buffer offsets and sizes */
+		else if(info->offset > image->wsize || info->size > (image->wsize - info->offset))
+		{
+			q.status[i] = EXTRACT_BAD_SIZE;
 		}
 	}
-	else
+
+	/* Build the whole directory tree up front, so the workers only have files to write */
+	extract_mkdirs(q.paths, count);
+
+	if(nthreads > count)
 	{
-		printf("Failed to parse ELF header!\n");
+		nthreads = count ? count : 1;
 	}
 
-	if(hdata) free(hdata);
-	if(wdata) free(wdata);
+	threads = calloc(nthreads, sizeof(pthread_t));
+	pthread_mutex_init(&q.lock, NULL);
+
+	/* Fall back to doing it all from this thread if no workers could be started */
+	for(i=0; threads && i<nthreads; i++)
+	{
+		if(pthread_create(&threads[i], NULL, extract_worker, &q) != 0)
+		{
+			break;
+		}
+	}
+
+	if(i == 0)
+	{
+		extract_worker(&q);
+	}
+
+	while(i-- > 0)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&q.lock);
+
+	/* Report in table order, whatever order the files were written in */
+	for(i=0; i<count; i++)
+	{
+		info = &image->index.entries[i];
+
+		switch(q.status[i])
+		{
+			case EXTRACT_OK:
+				/* Display the file name */
+				printf("%s\n", info->name);
+				n++;
+				break;
+			case EXTRACT_FAILED:
+				fprintf(stderr, "ERROR: Failed to extract file '%s'\n", info->name);
+				break;
+			case EXTRACT_BAD_SIZE:
+				fprintf(stderr, "ERROR: Bad file size/offset for %s [ %d %d ]\n", info->name, info->size, info->offset);
+				break;
+			case EXTRACT_UNSAFE:
+				fprintf(stderr, "File path '%s' is not safe! Skipping...\n", info->name);
+				break;
+		}
+	}
+
+	if(chdir((char *) &origdir) == -1)
+	{
+		perror(origdir);
+	}
+
+end:
+	if(q.wfd != -1) close(q.wfd);
+	if(threads) free(threads);
+	if(q.paths)
+	{
+		for(i=0; i<count; i++)
+		{
+			if(q.paths[i]) free(q.paths[i]);
+		}
+		free(q.paths);
+	}
+	if(q.status) free(q.status);
 	return n;
 }
 
-/* Restore embedded file contents to binary file(s) */
-int restore(char *httpd, char *www, char *indir)
+/* Appends len bytes from the file open on in to out, with copy_file_range where possible. Returns 1 on success. */
+int restore_copy(int in, int out, size_t len)
 {
-	FILE *fp = NULL;
-	int n = 0, total = 0;
-	size_t hsize = 0, fsize = 0;
+	unsigned char buf[RESTORE_BUFSIZE];
+	size_t left = len;
+	ssize_t n = 0, done = 0, w = 0;
+
+#ifdef WEBCOMP_COPY_RANGE
+	while(left > 0)
+	{
+		n = copy_file_range(in, NULL, out, NULL, left, 0);
+		if(n <= 0)
+		{
+			break;
+		}
+		left -= n;
+	}
+#endif
+
+	/* Both advance the file offsets, so this picks up wherever copy_file_range stopped */
+	while(left > 0)
+	{
+		n = read(in, buf, (left < sizeof(buf) ? left : sizeof(buf)));
+		if(n <= 0)
+		{
+			if(n == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		for(done=0; done<n; done+=w)
+		{
+			w = write(out, buf+done, n-done);
+			if(w <= 0)
+			{
+				if(w == -1 && errno == EINTR)
+				{
+					w = 0;
+					continue;
+				}
+				return 0;
+			}
+		}
+
+		left -= n;
+	}
+
+	return (left == 0);
+}
+
+/* 
+ * Restore embedded file contents to binary file(s). The first pass lays out the new www blob from the sizes 
+ * of the input files and patches the entry table, the second streams the files into www one after another.
+ */
+int restore(struct webcomp_image *image, char *indir)
+{
+	int fd = -1, in = -1, i = 0, n = 0, count = image->index.count;
+	uint32_t total = 0;
+	struct stat st;
 	struct entry_info *info = NULL;
-	unsigned char *hdata = NULL, *fdata = NULL;
+	uint32_t *sizes = NULL;
+	char **paths = NULL;
 	char origdir[FILENAME_MAX] = { 0 };
-	char *path = NULL;	
 
-	/* Read in the httpd file */
-	hdata = (unsigned char *) file_read(httpd, &hsize);
-	
 	/* Get the current working directory */
 	getcwd((char *) &origdir, sizeof(origdir));
 
+	/* The www file is about to be rewritten; its old contents were only needed to detect the key */
+	file_unmap(image->wdata, image->wsize);
+	image->wdata = NULL;
+	image->wsize = 0;
+
+	paths = calloc(count + 1, sizeof(char *));
+	sizes = calloc(count + 1, sizeof(uint32_t));
+	if(!paths || !sizes)
+	{
+		perror("calloc");
+		goto end;
+	}
+
 	/* Open the www file for writing */
-	fp = fopen(www, "wb");
+	fd = open(image->www_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(fd == -1)
+	{
+		perror("restore");
+		goto end;
+	}
+
+	/* Change directories to the target directory */
+	if(chdir(indir) == -1)
+	{
+		perror(indir);
+		goto end;
+	}
 
-	if(hdata != NULL && fp != NULL)
+	for(i=0; i<count; i++)
 	{
-		/* Change directories to the target directory */
-        	if(chdir(indir) == -1)
-        	{
-                	perror(indir);
-        	}
-		else 
+		info = &image->index.entries[i];
+
+		/* Count the number of files we process */
+		n++;
+
+		/* Make sure the full file path is safe (i.e., it won't overwrite something critical on the host system) */
+		paths[i] = make_path_safe(info->name);
+		if(!paths[i])
 		{
-			/* Get the next entry until we get a blank entry */
-			while((info = next_entry(hdata, hsize)) != NULL)
-			{
-				/* Count the number of files we process */
-				n++;
-			
-				/* Make sure the full file path is safe (i.e., it won't overwrite something critical on the host system) */
-				path = make_path_safe(info->name);
-				if(path)
-				{
-					/* Display the file name */
-					printf("%s\n", info->name);
-
-					/* Read in the file */
-					fdata = (unsigned char *) file_read(path, &fsize);
-				
-					/* Update the entry size and file offset */
-					if(globals.use_new_format)
-					{
-						info->new_entry->size = fsize + globals.key;			
-					}
-					else
-					{
-						info->entry->size = fsize;
-						info->entry->offset = total;
-					}
-					
-					/* Byte swap, if necessary */
-					hton_entries(info);
-
-					/* Write the new file to the www blob file */
-					if(fdata)
-					{
-						if(fwrite(fdata, 1, fsize, fp) != fsize)
-						{
-							fprintf(stderr, "ERROR: Failed to restore file '%s'\n", info->name);
-						}
-						else
-						{
-							/* Update the total size written to the www blob */
-							total += fsize;
-						}
-	
-						free(fdata);
-					}
-	
-					free(path);
-				}
-				else
-				{
-					fprintf(stderr, "File path '%s' is not safe! Skipping...\n", info->name);
-				}
-		
-				free(info);
-			}
+			fprintf(stderr, "File path '%s' is not safe! Skipping...\n", info->name);
+			continue;
+		}
 
-			/* The www blob file always appears to be null byte terminated if its size is not even */
-			if((total % 2) != 0)
-			{
-				fwrite("\x00", 1, 1, fp);
-			}
+		/* A missing file is restored as an empty one */
+		if(stat(paths[i], &st) == -1)
+		{
+			perror(paths[i]);
+		}
+		else
+		{
+			sizes[i] = st.st_size;
+		}
 
-			/* Change back to our original directory, so that relative paths for httpd will still work */
-			if(chdir((char *) &origdir) != -1)
-			{
-				/* Write the modified httpd binary back to disk */
-				file_write(httpd, hdata, hsize);
-			}
-			else
+		/* Update the entry size and file offset; httpd is mapped shared, so this updates it on disk */
+		if(globals.use_new_format)
+		{
+			info->new_entry->size = sizes[i] + globals.key;
+		}
+		else
+		{
+			info->entry->size = sizes[i];
+			info->entry->offset = total;
+		}
+
+		/* Byte swap, if necessary */
+		hton_entries(info);
+
+		total += sizes[i];
+	}
+
+	for(i=0; i<count; i++)
+	{
+		if(!paths[i])
+		{
+			continue;
+		}
+
+		/* Display the file name */
+		printf("%s\n", image->index.entries[i].name);
+
+		/* Write the new file to the www blob file */
+		if(sizes[i] > 0)
+		{
+			in = open(paths[i], O_RDONLY);
+			if(in == -1 || !restore_copy(in, fd, sizes[i]))
 			{
-				perror(origdir);
+				fprintf(stderr, "ERROR: Failed to restore file '%s'\n", image->index.entries[i].name);
 			}
+
+			if(in != -1) close(in);
 		}
 	}
-	else
+
+	/* The www blob file always appears to be null byte terminated if its size is not even */
+	if((total % 2) != 0)
 	{
-		perror("restore");
+		if(write(fd, "\x00", 1) != 1)
+		{
+			perror("restore");
+		}
+	}
+
+	/* Change back to our original directory, so that relative paths of later images will still work */
+	if(chdir((char *) &origdir) == -1)
+	{
+		perror(origdir);
+	}
+
+end:
+	if(fd != -1) close(fd);
+	if(paths)
+	{
+		for(i=0; i<count; i++)
+		{
+			if(paths[i]) free(paths[i]);
+		}
+		free(paths);
 	}
-	
-	if(fp) fclose(fp);
-	if(hdata) free(hdata);
+	if(sizes) free(sizes);
 	return n;
 }
 
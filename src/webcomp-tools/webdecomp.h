@@ -4,11 +4,27 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include "common.h"
 
 #define NONE 	0
 #define EXTRACT 1
 #define RESTORE 2
 
+/* What became of each entry extract() was given */
+#define EXTRACT_PENDING		0
+#define EXTRACT_OK		1
+#define EXTRACT_FAILED		2
+#define EXTRACT_BAD_SIZE	3
+#define EXTRACT_UNSAFE		4
+
+/* restore() copies files through a buffer of this size when the kernel can't do it */
+#define RESTORE_BUFSIZE		(64 * 1024)
+
+/* copy_file_range() appeared in Linux 4.5 and glibc 2.27 */
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define WEBCOMP_COPY_RANGE
+#endif
+
 #define USAGE "\
 webdecomp v.0.5, (c) 2011, Craig Heffner\n\
 \n\
@@ -28,13 +44,36 @@ Additional Options:\n\
 \n\
 \t-i, --index=<offset>                  File offset of the websRomPageIndex structure array\n\
 \t-d, --dir=<directory>                 Web files directory [default: %s]\n\
+\t-j, --jobs=<n>                        Number of files to extract in parallel [default: online CPUs]\n\
+\t-l, --list=<file>                     Process each '<httpd> <www> [directory]' line of a file\n\
 \t-h, --help                            Show help\n\
 "
 
+/* The mapped httpd and www files of one DD-WRT image, and its parsed entry table */
+struct webcomp_image
+{
+	char *httpd_file;
+	char *www_file;
+	unsigned char *hdata;
+	size_t hsize;
+	unsigned char *wdata;
+	size_t wsize;
+	struct entry_index index;
+};
+
 void usage(char *progname);
-int restore(char *httpd, char *www, char *dir);
-int extract(char *httpd, char *www, char *outdir);
-int detect_settings(char *httpd_file);
-void detect_key(char *httpd, char *www);
+int process_image(char *httpd, char *www, char *dir, int action, uint32_t key, uint32_t index_address);
+int process_list(char *list, int action, uint32_t key, uint32_t index_address);
+int image_open(struct webcomp_image *image, char *httpd, char *www, int writable);
+void image_close(struct webcomp_image *image);
+int restore(struct webcomp_image *image, char *dir);
+int restore_copy(int in, int out, size_t len);
+int extract(struct webcomp_image *image, char *outdir);
+int extract_entry(struct webcomp_image *image, int wfd, struct entry_info *info, char *path);
+void extract_mkdirs(char **paths, int count);
+void *extract_worker(void *arg);
+int strcmp_ptr(const void *a, const void *b);
+int detect_settings(struct webcomp_image *image);
+void detect_key(struct webcomp_image *image);
 
 #endif
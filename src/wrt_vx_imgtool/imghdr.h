@@ -62,11 +62,12 @@
 // 
 //
 
-// todo: add defintions for 64-bit systems
+// fixed widths, so the header has the same layout on 64-bit systems
+#include <stdint.h>
 #ifndef DWORD
-#define DWORD unsigned long
-#define WORD unsigned short
-#define BYTE unsigned char
+#define DWORD uint32_t
+#define WORD uint16_t
+#define BYTE uint8_t
 #endif
 
 
@@ -48,6 +48,23 @@
 // for linux you should define this on g++ cmd line
 //#define _LINUX
 
+#ifdef _LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// glibc always defines BIG_ENDIAN, so go by the compiler's byte order
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define VX_BIG_ENDIAN
+#endif
+
 #ifdef _LINUX
 #define _strcmpi strcasecmp
 #define strcmpi strcasecmp
@@ -115,7 +132,7 @@ unsigned long flip_endian(unsigned long nValue)
 
 unsigned long big_endian_l(unsigned long nValue)
 {
-#ifdef BIG_ENDIAN
+#ifdef VX_BIG_ENDIAN
 	return nValue;
 #else
 	// my crappy endian switch
@@ -134,7 +151,7 @@ unsigned long big_endian_l(unsigned long nValue)
 
 unsigned short big_endian_s(unsigned short nValue)
 {
-#ifdef BIG_ENDIAN
+#ifdef VX_BIG_ENDIAN
 	return nValue;
 #else
 	// my crappy endian switch
@@ -146,28 +163,120 @@ unsigned short big_endian_s(unsigned short nValue)
 	return (unsigned short)nR;
 #endif
 }
+/////////////////////////////////////////////////////////////
+// SumBigEndianWords
+//
+// 32bit sum of nWords big endian 32bit integers at any alignment.
+// SSE2 keeps eight partial sums, byte swapping four words per
+// step; elsewhere four scalar partial sums are kept.
+//
+DWORD SumBigEndianWords(const unsigned char *p, unsigned long nWords)
+{
+	DWORD nSum=0;
+	unsigned long nI=0;
+#ifdef __SSE2__
+	__m128i vSum0=_mm_setzero_si128();
+	__m128i vSum1=_mm_setzero_si128();
+	for(;nI+8<=nWords;nI+=8,p+=32)
+	{
+		__m128i v0=_mm_loadu_si128((const __m128i *)p);
+		__m128i v1=_mm_loadu_si128((const __m128i *)(p+16));
+		// swap the bytes of each 16bit half, then the halves
+		v0=_mm_or_si128(_mm_slli_epi16(v0,8),_mm_srli_epi16(v0,8));
+		v1=_mm_or_si128(_mm_slli_epi16(v1,8),_mm_srli_epi16(v1,8));
+		v0=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v0,0xb1),0xb1);
+		v1=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v1,0xb1),0xb1);
+		vSum0=_mm_add_epi32(vSum0,v0);
+		vSum1=_mm_add_epi32(vSum1,v1);
+	}
+	DWORD nLanes[4];
+	_mm_storeu_si128((__m128i *)nLanes,_mm_add_epi32(vSum0,vSum1));
+	nSum=nLanes[0]+nLanes[1]+nLanes[2]+nLanes[3];
+#else
+	DWORD nSums[4]={0,0,0,0};
+	for(;nI+4<=nWords;nI+=4,p+=16)
+	{
+		for(int nJ=0;nJ<4;nJ++)
+		{
+			const unsigned char *q=p+nJ*4;
+			nSums[nJ]+=(DWORD)q[0]<<24|(DWORD)q[1]<<16|(DWORD)q[2]<<8|q[3];
+		}
+	}
+	nSum=nSums[0]+nSums[1]+nSums[2]+nSums[3];
+#endif
+	for(;nI<nWords;nI++,p+=4)
+	{
+		nSum+=(DWORD)p[0]<<24|(DWORD)p[1]<<16|(DWORD)p[2]<<8|p[3];
+	}
+	return nSum;
+}
+
+/////////////////////////////////////////////////////////////
+// VxChecksum
+//
+// running sum over an image given in pieces of any size, the
+// bytes of a word split between pieces kept until completed
+//
+typedef struct _VxChecksum
+{
+	DWORD nSum;
+	unsigned char cPartial[4];
+	unsigned int nPartial; // 0-3
+} VxChecksum;
+
+void ChecksumUpdate(VxChecksum *pChecksum, const unsigned char *p, unsigned long nSize)
+{
+	if(pChecksum->nPartial)
+	{
+		unsigned int nNeeded=4-pChecksum->nPartial;
+		if(nSize<nNeeded)
+		{
+			memcpy(pChecksum->cPartial+pChecksum->nPartial,p,nSize);
+			pChecksum->nPartial+=nSize;
+			return;
+		}
+		memcpy(pChecksum->cPartial+pChecksum->nPartial,p,nNeeded);
+		pChecksum->nSum+=SumBigEndianWords(pChecksum->cPartial,1);
+		pChecksum->nPartial=0;
+		p+=nNeeded;
+		nSize-=nNeeded;
+	}
+	pChecksum->nSum+=SumBigEndianWords(p,nSize/4);
+	p+=nSize&~3UL;
+	pChecksum->nPartial=nSize&3;
+	memcpy(pChecksum->cPartial,p,pChecksum->nPartial);
+}
+
 /////////////////////////////////////////////////////////////
 // Checksum_Linksys_WRT54Gv5_v6
 //
-// unsigned 32bit checksum of 32bit unsigned integer - endian neutral
+// unsigned 32bit checksum of 32bit unsigned integer - endian neutral,
+// a trailing partial word padded with zeros
 //
-unsigned long
-Checksum_Linksys_WRT54Gv5_v6(unsigned long *pStart, unsigned long *pEnd)
+DWORD Checksum_Linksys_WRT54Gv5_v6(VxChecksum *pChecksum)
 {
-	unsigned long nChecksum=0;
-	while(pStart<pEnd)
-	{        
-		nChecksum+=big_endian_l(*pStart++);        
+	DWORD nChecksum=pChecksum->nSum;
+	if(pChecksum->nPartial)
+	{
+		memset(pChecksum->cPartial+pChecksum->nPartial,0,4-pChecksum->nPartial);
+		nChecksum+=SumBigEndianWords(pChecksum->cPartial,1);
 	}
 	return ~(nChecksum-1); // return two's compliment
 }
 
+DWORD Checksum_Linksys_WRT54Gv5_v6(const unsigned char *pStart, unsigned long nSize)
+{
+	VxChecksum checksum={0};
+	ChecksumUpdate(&checksum,pStart,nSize);
+	return Checksum_Linksys_WRT54Gv5_v6(&checksum);
+}
+
 bool SanityChecks()
 {
-#ifndef BIG_ENDIAN
+#ifndef VX_BIG_ENDIAN
 	if(big_endian_l(0x11223344)==0x11223344)
 	{
-		printf("\n ! ERROR: Endianness not set correctly. Define BIG_ENDIAN.");
+		printf("\n ! ERROR: Endianness not set correctly. Define VX_BIG_ENDIAN.");
 		return false;
 	}
 #endif
@@ -241,32 +350,155 @@ int VxFileNameToId(const char *pszFilename)
 	return nR;
 }
 
-long EmitFile(unsigned char *pFirmwareImage, unsigned long nOffset, unsigned long nSize, const char *pszFilename)
+/////////////////////////////////////////////////////////////
+// MapFile / UnmapFile
+//
+// view of a whole file, mmapped on linux and read into a buffer
+// elsewhere. Writable views are shared, so changes go to the file.
+// return: NULL for error.
+//
+unsigned char *MapFile(const char *pszFilename, unsigned long *pnSize, bool bWritable)
 {
-	printf("\n   Writing file %s", pszFilename);
+	static unsigned char cEmpty;
+#ifdef _LINUX
+	int fd=open(pszFilename,bWritable?O_RDWR:O_RDONLY);
+	struct stat st;
+	if(fd<0 || fstat(fd,&st)<0)
+	{
+		if(fd>=0) close(fd);
+		return NULL;
+	}
+	*pnSize=st.st_size;
+	void *p=&cEmpty;
+	if(*pnSize)
+	{
+		p=mmap(NULL,*pnSize,bWritable?PROT_READ|PROT_WRITE:PROT_READ,MAP_SHARED,fd,0);
+	}
+	close(fd);
+	return p==MAP_FAILED?NULL:(unsigned char *)p;
+#else
+	FILE *f=fopen(pszFilename,bWritable?"r+b":"rb");
+	if(!f) return NULL;
+	fseek(f,0,SEEK_END);
+	*pnSize=ftell(f);
+	fseek(f,0,SEEK_SET);
+	unsigned char *p=&cEmpty;
+	if(*pnSize)
+	{
+		p=new unsigned char[*pnSize];
+		if(fread(p,1,*pnSize,f)!=*pnSize)
+		{
+			delete[] p;
+			p=NULL;
+		}
+	}
+	fclose(f);
+	return p;
+#endif
+}
+
+bool UnmapFile(const char *pszFilename, unsigned char *p, unsigned long nSize, bool bWritable)
+{
+	bool bR=true;
+	if(!nSize) return true;
+#ifdef _LINUX
+	if(bWritable && msync(p,nSize,MS_SYNC)<0) bR=false;
+	munmap(p,nSize);
+#else
+	if(bWritable)
+	{
+		FILE *f=fopen(pszFilename,"r+b");
+		if(!f || fwrite(p,1,nSize,f)!=nSize) bR=false;
+		if(f) fclose(f);
+	}
+	delete[] p;
+#endif
+	return bR;
+}
+
+/////////////////////////////////////////////////////////////
+// WriteChunks
+//
+// writes pieces of memory out as one file, with a single gathered
+// writev on linux
+//
+typedef struct _VxChunk
+{
+	const unsigned char *p;
+	unsigned long nSize;
+} VxChunk;
+
+long WriteChunks(const char *pszFilename, VxChunk *pChunks, int nChunks)
+{
+	long nTotal=0;
+#ifdef _LINUX
+	int fd=open(pszFilename,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(fd<0) return -1;
+	vector<struct iovec> vIov(nChunks);
+	for(int nI=0;nI<nChunks;nI++)
+	{
+		vIov[nI].iov_base=(void *)pChunks[nI].p;
+		vIov[nI].iov_len=pChunks[nI].nSize;
+		nTotal+=pChunks[nI].nSize;
+	}
+	// writev may stop short; carry on from where it did
+	struct iovec *pIov=&vIov[0];
+	int nLeft=nChunks;
+	while(nLeft)
+	{
+		ssize_t nDone=writev(fd,pIov,nLeft);
+		if(nDone<0)
+		{
+			close(fd);
+			return -1;
+		}
+		while(nLeft && (size_t)nDone>=pIov->iov_len)
+		{
+			nDone-=pIov->iov_len;
+			pIov++;
+			nLeft--;
+		}
+		if(nLeft)
+		{
+			pIov->iov_base=(char *)pIov->iov_base+nDone;
+			pIov->iov_len-=nDone;
+		}
+	}
+	if(close(fd)<0) return -1;
+#else
 	FILE *fOut=fopen(pszFilename,"wb");
-	if(!fOut)
+	if(!fOut) return -1;
+	for(int nI=0;nI<nChunks;nI++)
 	{
-		printf("\n ! ERROR: Opening %s", pszFilename);
-		return -1;
-	}	
-	unsigned char *p1=pFirmwareImage+nOffset;
-	if(fwrite(p1,1,nSize,fOut)!=nSize)
+		if(fwrite(pChunks[nI].p,1,pChunks[nI].nSize,fOut)!=pChunks[nI].nSize)
+		{
+			fclose(fOut);
+			return -1;
+		}
+		nTotal+=pChunks[nI].nSize;
+	}
+	if(fclose(fOut)) return -1;
+#endif
+	return nTotal;
+}
+
+long EmitFile(unsigned char *pFirmwareImage, unsigned long nOffset, unsigned long nSize, const char *pszFilename)
+{
+	printf("\n   Writing file %s", pszFilename);
+	VxChunk chunk={pFirmwareImage+nOffset,nSize};
+	if(WriteChunks(pszFilename,&chunk,1)<0)
 	{
 		printf("\n ! ERROR: Writing %s", pszFilename);
-		fclose(fOut);
 		return -1;
 	}
-
-	fclose(fOut);
 	return nSize;
 }
 
-void store_bigendian_l(unsigned long *pDest, unsigned long nValue)
+void store_bigendian_l(DWORD *pDest, DWORD nValue)
 {
 	*pDest=big_endian_l(nValue);
 }
-void store_bigendian_s(unsigned short *pDest, unsigned short nValue)
+void store_bigendian_s(WORD *pDest, WORD nValue)
 {
 	*pDest=big_endian_s(nValue);
 }
@@ -280,27 +512,27 @@ int BuildImage(vector<string> &vInputFiles, const char *pszOutFile, char *pszCod
 {
 	printf("\n\n Building firmware image %s", pszOutFile);
 
-	FILE *fOut=fopen(pszOutFile,"wb");
-	if(!fOut)
+	if(vInputFiles.size()>8)
 	{
-		printf("\n ! ERROR: Opening %s for writing", pszOutFile);
+		printf("\n ! ERROR: At most 8 files fit in the header");
 		return -1;
 	}
 
-	// first, calculate total size
+	// first, map the inputs and calculate total size
+	vector<unsigned char *> vMaps(vInputFiles.size());
+	vector<unsigned long> vSizes(vInputFiles.size());
 	unsigned long nFirmwareSize=sizeof(VxLinksysHeader);
+	unsigned long nMaxPad=0;
 	for(unsigned int nI=0;nI<vInputFiles.size();nI++)
 	{
-		FILE *fTest=fopen(vInputFiles[nI].c_str(),"rb");
-		if(!fTest)
+		vMaps[nI]=MapFile(vInputFiles[nI].c_str(),&vSizes[nI],false);
+		if(!vMaps[nI])
 		{
 			printf("\n ! ERROR: Opening %s", vInputFiles[nI].c_str());
-			fclose(fOut);
+			while(nI--) UnmapFile(vInputFiles[nI].c_str(),vMaps[nI],vSizes[nI],false);
 			return -1;
 		}
-		fseek(fTest,0,SEEK_END);
-		unsigned long nSize=
-			ftell(fTest);
+		unsigned long nSize=vSizes[nI];
 		printf("\n + Size of %s is %d bytes.", vInputFiles[nI].c_str(), nSize);
 
 		//todo: warn if size >
@@ -310,9 +542,9 @@ int BuildImage(vector<string> &vInputFiles, const char *pszOutFile, char *pszCod
 			printf("\n ! WARNING: BOOTROM.BIN must be %d bytes. Padding end to make correct size.", BOOTROM_SIZE);
 			printf("\n   Padding will be %d bytes in length.", nDifference);
 			nSize=BOOTROM_SIZE;
+			if(nDifference>nMaxPad) nMaxPad=nDifference;
 		}
 		nFirmwareSize+=nSize;
-		fclose(fTest);
 	}
 
 	// align to 32-bit boundary
@@ -320,10 +552,12 @@ int BuildImage(vector<string> &vInputFiles, const char *pszOutFile, char *pszCod
 	nFirmwareSize/=4;
 	nFirmwareSize*=4;
 
-	// allocate buffer
-	unsigned char *buffer=new unsigned char[nFirmwareSize];
-	memset(buffer,0,nFirmwareSize);
-	pVxLinksysHeader pHeader=(pVxLinksysHeader)buffer;
+	// the header, and zeros for the padding, are all that's buffered
+	VxLinksysHeader header;
+	memset(&header,0,sizeof(header));
+	pVxLinksysHeader pHeader=&header;
+	unsigned char *pZeros=new unsigned char[nMaxPad+4];
+	memset(pZeros,0,nMaxPad+4);
 
 	printf("\n + Building header");
 	// fill header	todo: don't use strcpy on longs..
@@ -358,34 +592,21 @@ int BuildImage(vector<string> &vInputFiles, const char *pszOutFile, char *pszCod
 	printf("\n + Setting trailer file sizes to 0.. (todo: add support?)");
 	// of course, they're already 0.. just saying that to remmeber about them
 
-	// now store file descriptors and read files
+	// now store file descriptors and lay out the pieces of the image,
+	// summing the files while they're still in cache
+	vector<VxChunk> vChunks;
+	VxChunk chunk={(unsigned char *)&header,sizeof(header)};
+	vChunks.push_back(chunk);
+	VxChecksum checksum={0};
 	unsigned long nCurrentPos=sizeof(VxLinksysHeader);
 	for(unsigned int nI=0;nI<vInputFiles.size();nI++)
 	{
 		printf("\n + Storing %s", vInputFiles[nI].c_str());
-		FILE *fTest=fopen(vInputFiles[nI].c_str(),"rb");
-		if(!fTest)
-		{
-			printf("\n ! ERROR: Opening %s", vInputFiles[nI].c_str());
-			delete buffer;
-			fclose(fOut);
-			return -1;
-		}
-		fseek(fTest,0,SEEK_END);
-		unsigned long nSize=
-			ftell(fTest);		
-		fseek(fTest,0,SEEK_SET);
-		unsigned char *tmp=new unsigned char[nSize];
-		if(fread(tmp,1,nSize,fTest)!=nSize)
-		{
-			printf("\n ! ERROR: Reading %s", vInputFiles[nI].c_str());
-			delete buffer;
-			delete tmp;
-			fclose(fOut);
-			return -1;
-		}
-		memcpy(buffer+nCurrentPos,tmp,nSize);
-		delete tmp;
+		unsigned long nSize=vSizes[nI];
+		chunk.p=vMaps[nI];
+		chunk.nSize=nSize;
+		vChunks.push_back(chunk);
+		ChecksumUpdate(&checksum,vMaps[nI],nSize);
 		nCurrentPos+=nSize;
 
 		// now store the descriptor
@@ -400,47 +621,60 @@ int BuildImage(vector<string> &vInputFiles, const char *pszOutFile, char *pszCod
 			if(nSize<BOOTROM_SIZE)
 			{				
 				unsigned long nDifference=BOOTROM_SIZE-nSize;
-				unsigned char *pPad=new unsigned char[nDifference];
 				printf("\n + Padding bootrom.bin with %d bytes", nDifference);
-				memset(pPad,0,nDifference);
-				memcpy(buffer+nCurrentPos,pPad,nDifference);
+				chunk.p=pZeros;
+				chunk.nSize=nDifference;
+				vChunks.push_back(chunk);
+				ChecksumUpdate(&checksum,pZeros,nDifference);
 				nSize=BOOTROM_SIZE;
 				nCurrentPos+=nDifference;
-				delete pPad;
 			}
 		}
 
-		fclose(fTest);
-
 		char szName[256];
 		VxFileIdToName(big_endian_l(pFileDescriptor->nFileId_BigEnd),szName,sizeof(szName));
 		printf("\n + Stored with file type %d (%s)", big_endian_l(pFileDescriptor->nFileId_BigEnd),szName);
 		store_bigendian_l(&pFileDescriptor->nFileSize_BigEnd,nSize);		
 	}
 
+	int nR=-1;
 	if(nCurrentPos>nFirmwareSize)
 	{
 		printf("\n ERROR: Sanity check fails. current pos > firmware size");
-		delete buffer;
-		fclose(fOut);
-		return -1;
+		goto done;
 	}
 
-	unsigned char *pEnd=buffer+nFirmwareSize;
-	store_bigendian_l(&pHeader->nChecksumBigEnd,Checksum_Linksys_WRT54Gv5_v6((unsigned long *)buffer,(unsigned long *)pEnd));
+	// zeros up to the 32-bit boundary
+	chunk.p=pZeros;
+	chunk.nSize=nFirmwareSize-nCurrentPos;
+	vChunks.push_back(chunk);
+
+	// the header goes in front of the files summed above: every
+	// piece but the first is summed, the header is a whole number
+	// of words, and the padding is zeros
+	{
+		VxChecksum headerChecksum={0};
+		ChecksumUpdate(&headerChecksum,(unsigned char *)&header,sizeof(header));
+		checksum.nSum+=headerChecksum.nSum;
+		store_bigendian_l(&pHeader->nChecksumBigEnd,Checksum_Linksys_WRT54Gv5_v6(&checksum));
+	}
 	printf("\n + Checksum is %08X", big_endian_l(pHeader->nChecksumBigEnd));
 
-	if(fwrite(buffer,1,nFirmwareSize,fOut)!=nFirmwareSize)
+	if(WriteChunks(pszOutFile,&vChunks[0],vChunks.size())!=(long)nFirmwareSize)
 	{
 		printf("\n ERROR: Writing firmware image to disk.");
-		delete buffer;
-		fclose(fOut);		
-		return -1;
+		goto done;
 	}
 	printf("\n Firmware size is %d bytes.", nFirmwareSize);
-	delete buffer;
-	fclose(fOut);
-	return nFirmwareSize;
+	nR=nFirmwareSize;
+
+done:
+	for(unsigned int nI=0;nI<vInputFiles.size();nI++)
+	{
+		UnmapFile(vInputFiles[nI].c_str(),vMaps[nI],vSizes[nI],false);
+	}
+	delete[] pZeros;
+	return nR;
 }
 
 
@@ -479,32 +713,29 @@ int ExtractImage(const char *pszInput, const char *pszOutFolder, bool bViewOnly)
 		szOutputFolder[0]=0;
 	}
 
-	FILE *fIn=fopen(pszInput,"rb");
-	if(!fIn)
+	unsigned long nFilesize;
+	unsigned char *buffer=MapFile(pszInput,&nFilesize,false);
+	if(!buffer)
 	{
 		printf("\n ERROR: Opening file %s", pszInput);
 		return -1;
 	}
-	fseek(fIn,0,SEEK_END);
-	long nFilesize=ftell(fIn);
-	fseek(fIn,0,SEEK_SET);
 	if(nFilesize<sizeof(VxLinksysHeader))
 	{
 		printf("\n ERROR: File too small: %s", pszInput);
+		UnmapFile(pszInput,buffer,nFilesize,false);
 		return -1;
 	}
 	printf("\n Firmare file size is %d bytes", nFilesize);
 
-	unsigned char *buffer=new unsigned char[nFilesize];
-	fread((void *)&buffer[0],1,nFilesize,fIn);	
 	pVxLinksysHeader pHeader=(pVxLinksysHeader)buffer;
 
-	unsigned long nChecksum=big_endian_l(pHeader->nChecksumBigEnd);
-	pHeader->nChecksumBigEnd=0;
-	unsigned char *pEnd=buffer+nFilesize;
-	unsigned long nCalculatedChecksum=Checksum_Linksys_WRT54Gv5_v6(
-		(unsigned long *)buffer,
-		(unsigned long *)pEnd);
+	// sum the image as is, then take the stored checksum back out
+	DWORD nChecksum=big_endian_l(pHeader->nChecksumBigEnd);
+	VxChecksum checksum={0};
+	ChecksumUpdate(&checksum,buffer,nFilesize);
+	checksum.nSum-=nChecksum;
+	DWORD nCalculatedChecksum=Checksum_Linksys_WRT54Gv5_v6(&checksum);
 
 	unsigned int cMonth=pHeader->cMonth;
 	unsigned int cDay=pHeader->cDay;
@@ -566,7 +797,12 @@ int ExtractImage(const char *pszInput, const char *pszOutFolder, bool bViewOnly)
 				sprintf(szIntFilename,"trailing_file_%d",nI);
 				string sFullpath=szOutputFolder;
 				sFullpath+=szIntFilename;
-				if(!EmitFile(buffer,nFilesizeSum,big_endian_l(pFileDescriptor->nFileSize_BigEnd),sFullpath.c_str()))
+				if(nFilesizeSum>nFilesize || nIntFilesize>nFilesize-nFilesizeSum)
+				{
+					nFileCount=-1;
+					printf("\n ERROR: File runs past the end of the firmware.");
+				}
+				else if(EmitFile(buffer,nFilesizeSum,nIntFilesize,sFullpath.c_str())<0)
 				{
 					nFileCount=-1;
 					printf("\n ERROR: Extracting file from firmware (disk/filesystem problem).");				
@@ -604,7 +840,12 @@ int ExtractImage(const char *pszInput, const char *pszOutFolder, bool bViewOnly)
 			}
 			string sFullpath=szOutputFolder;
 			sFullpath+=szIntFilename;
-			if(!EmitFile(buffer,nFilesizeSum,big_endian_l(pFileDescriptor->nFileSize_BigEnd),sFullpath.c_str()))
+			if(nFilesizeSum>nFilesize || nIntFilesize>nFilesize-nFilesizeSum)
+			{
+				nFileCount=-1;
+				printf("\n ERROR: File runs past the end of the firmware.");
+			}
+			else if(EmitFile(buffer,nFilesizeSum,nIntFilesize,sFullpath.c_str())<0)
 			{
 				nFileCount=-1;
 				printf("\n ERROR: Extracting file from firmware (disk/filesystem problem).");				
@@ -623,52 +864,45 @@ int ExtractImage(const char *pszInput, const char *pszOutFolder, bool bViewOnly)
 	}
 	*/
 
-	delete buffer;
-	fclose(fIn);		
+	UnmapFile(pszInput,buffer,nFilesize,false);
 	return nFileCount;	
 }
 
 int FixImage(const char *pszImage)
 {
 	printf("\n\n Fixing checksum on %s", pszImage);
-	FILE *fIn=fopen(pszImage,"r+b");
-	if(!fIn)
+	// only the checksum changes, so patch it in place
+	unsigned long nFilesize;
+	unsigned char *buffer=MapFile(pszImage,&nFilesize,true);
+	if(!buffer)
 	{
 		printf("\n ! ERROR: Opening image.");
 		return -1;
-	}
-	fseek(fIn,0,SEEK_END);
-	unsigned long nFilesize=ftell(fIn);
-	fseek(fIn,0,SEEK_SET);
-	unsigned char *buffer=new unsigned char[nFilesize];
-	if(fread(buffer,1,nFilesize,fIn)!=nFilesize)
+	}		
+	if(nFilesize<sizeof(VxLinksysHeader))
 	{
-		printf("\n ! ERROR: Reading image.");
-		delete buffer;
-		fclose(fIn);
+		printf("\n ! ERROR: Image too small.");
+		UnmapFile(pszImage,buffer,nFilesize,false);
 		return -1;
-	}		
+	}
 
 	pVxLinksysHeader pHeader=(pVxLinksysHeader)buffer;
 	printf("\n Original checksum was 0x%08X", big_endian_l(pHeader->nChecksumBigEnd));
 	pHeader->nChecksumBigEnd=0;
-	unsigned char *pEnd=buffer+nFilesize;
-	unsigned long nChecksum=Checksum_Linksys_WRT54Gv5_v6((unsigned long *)buffer, (unsigned long *)pEnd);
+	DWORD nChecksum=Checksum_Linksys_WRT54Gv5_v6(buffer,nFilesize);
 	store_bigendian_l(&pHeader->nChecksumBigEnd,nChecksum);
 	printf("\n New checksum is       0x%08X", big_endian_l(pHeader->nChecksumBigEnd));
 
-	fseek(fIn,0,SEEK_SET);
-	if(fwrite(buffer,1,nFilesize,fIn)!=nFilesize)
+	if(!UnmapFile(pszImage,buffer,nFilesize,true))
 	{
 		printf("\n ! ERROR: Writing image.");
-		delete buffer;
-		fclose(fIn);
 		return -1;	
 	}
-	fclose(fIn);
 	return 1;
 }
 
+// built with WRT_VX_IMGTOOL_LIB for the routines alone, see src/kernbench
+#ifndef WRT_VX_IMGTOOL_LIB
 int main(int argc, char* argv[])
 {
 	printf("\n WRT54G/GS v5-v6 firmware image builder, extractor, fixer, and viewer");
@@ -913,3 +1147,4 @@ showhelp:
 
 	return 0;
 }
+#endif
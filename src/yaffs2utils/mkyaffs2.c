@@ -26,6 +26,7 @@
 #include <dirent.h>
 #include <getopt.h>
 #include <string.h>
+#include <pthread.h>
 #include <libgen.h>
 #include <limits.h>
 #include <sys/stat.h>
@@ -45,11 +46,17 @@
 #include "endian_convert.h"
 #include "nand_ecclayout.h"
 
+#include "../fmkstats/fmkstats.h"
+#include "../fmkpool/fmkpool.h"
+
 #include "version.h"
 
 /*----------------------------------------------------------------------------*/
 
 #define MKYAFFS2_OBJTABLE_SIZE	4096
+#define MKYAFFS2_OUTBUF_CHUNKS	64	/* chunks gathered per write */
+#define MKYAFFS2_PIPE_JOBS	64	/* objects queued in pipelined mode */
+#define MKYAFFS2_PIPE_FILE_MAX	(1 << 20) /* largest file queued */
 
 #define MKYAFFS2_FLAGS_NONROOT	(1 << 0)
 #define MKYAFFS2_FLAGS_SHOWBAR	(1 << 1)
@@ -66,6 +73,13 @@
 #define MKYAFFS2_ISALLROOT	(mkyaffs2_flags & MKYAFFS2_FLAGS_ALLROOT)
 #define MKYAFFS2_ISVERBOSE	(mkyaffs2_flags & MKYAFFS2_FLAGS_VERBOSE)
 
+/*
+ * the tags of a chunk are packed by code written once with the byte
+ * order as a constant argument, and instantiated for each tags layout
+ * and byte order; main() picks one, so MKYAFFS2_ISENDIAN folds away.
+ */
+#define MKYAFFS2_INSTANCE	inline __attribute__((always_inline))
+
 #define MKYAFFS2_PRINTF(s, args...) \
 		do { \
 			if (!MKYAFFS2_ISVERBOSE && MKYAFFS2_ISSHOWBAR) { \
@@ -145,6 +159,25 @@ typedef struct mkyaffs2_fstree {
 	struct mkyaffs2_obj *root;
 } mkyaffs2_fstree_t;
 
+typedef struct mkyaffs2_job {
+	unsigned char *buf;		/* header chunk, then file chunks */
+	unsigned chunks;		/* chunks assembled in buf */
+	unsigned size;			/* chunks buf holds */
+	unsigned obj_id;
+	char *fpath;			/* file to read, NULL if none */
+	int error;
+	int done;
+} mkyaffs2_job_t;
+
+typedef struct mkyaffs2_pipe {
+	pthread_mutex_t mutex;
+	struct fmk_pool_group group;	/* the tasks reading the files */
+	struct mkyaffs2_job job[MKYAFFS2_PIPE_JOBS];
+	unsigned long emitted;		/* jobs written to the image */
+	unsigned long queued;		/* jobs queued by the walk */
+	int running;			/* the pipeline is in use */
+} mkyaffs2_pipe_t;
+
 /*----------------------------------------------------------------------------*/
 
 static unsigned mkyaffs2_flags = 0;
@@ -163,7 +196,15 @@ static char mkyaffs2_curfile[PATH_MAX + PATH_MAX] = {0};
 static nand_ecclayout_t *mkyaffs2_ecclayout = NULL;
 
 static unsigned mkyaffs2_bufsize = 0;
-static unsigned char *mkyaffs2_databuf = NULL;
+static unsigned char *mkyaffs2_databuf = NULL;	/* next chunk in outbuf */
+
+static unsigned char *mkyaffs2_outbuf = NULL;
+static unsigned mkyaffs2_outchunks = 0;
+
+static unsigned mkyaffs2_threads = 0;
+static struct mkyaffs2_pipe mkyaffs2_pipe = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
 
 static struct mkyaffs2_fstree mkyaffs2_objtree = {0};
 static struct list_head mkyaffs2_objtable[MKYAFFS2_OBJTABLE_SIZE];
@@ -315,12 +356,11 @@ mkyaffs2_objtree_exit (struct mkyaffs2_fstree *fst)
 
 /*----------------------------------------------------------------------------*/
 
-static void 
-mkyaffs2_packedtags1_ecc (struct yaffs_packed_tags1 *pt)
+static MKYAFFS2_INSTANCE void
+mkyaffs2_packedtags1_ecc (struct yaffs_packed_tags1 *pt, const int endian)
 {
 	unsigned char *b = ((union yaffs_tags_union *)pt)->as_bytes;
-	unsigned i, j;
-	unsigned ecc = 0, bit = 0;
+	unsigned ecc;
 
 	/* clear the ecc field */
 	if (MKYAFFS2_ISYAFFS1) {
@@ -336,16 +376,10 @@ mkyaffs2_packedtags1_ecc (struct yaffs_packed_tags1 *pt)
 		pt->ecc = 0;
 
 	/* calculate ecc */
-	for (i = 0; i < 8; i++) {
-		for (j = 1; j & 0xff; j <<= 1) {
-			bit++;
-			if (b[i] & j)
-				ecc ^= bit;
-		}
-	}
+	ecc = yaffs_ecc_calc_tags1(b);
 
 	/* write ecc back to tags */
-	if (MKYAFFS2_ISENDIAN) {
+	if (endian) {
 #if defined(__LITTLE_ENDIAN_BITFIELD)
 		b[6] |= ((ecc >> 6) & 0x3f);
 		b[7] |= ((ecc & 0x3f) << 2);
@@ -384,9 +418,10 @@ mkyaffs2_ptags2spare (unsigned char *spare, unsigned char *tag, size_t bytes,
 
 /*----------------------------------------------------------------------------*/
 
-static int
-mkyaffs2_assemble_ptags1(unsigned char *spare, struct yaffs_ext_tags *t,
-			 nand_ecclayout_t *ecclayout, int ecc)
+static MKYAFFS2_INSTANCE int
+mkyaffs2_assemble_ptags1_t (unsigned char *spare, struct yaffs_ext_tags *t,
+			    nand_ecclayout_t *ecclayout, int ecc,
+			    const int endian)
 {
 	ssize_t written;
 	struct yaffs_packed_tags1 pt1;
@@ -395,10 +430,10 @@ mkyaffs2_assemble_ptags1(unsigned char *spare, struct yaffs_ext_tags *t,
 	memset(&pt1, 0xff, sizeof(struct yaffs_packed_tags1));
 	yaffs_pack_tags1(&pt1, t);
 
-	if (MKYAFFS2_ISENDIAN)
+	if (endian)
 		packedtags1_endian_convert(&pt1, 0);
 
-	mkyaffs2_packedtags1_ecc(&pt1);
+	mkyaffs2_packedtags1_ecc(&pt1, endian);
 
 	written = mkyaffs2_ptags2spare(spare, (unsigned char *)&pt1,
 				       sizeof(struct yaffs_packed_tags1), l);
@@ -408,9 +443,10 @@ mkyaffs2_assemble_ptags1(unsigned char *spare, struct yaffs_ext_tags *t,
 	return written < sizeof(struct yaffs_packed_tags1);
 }
 
-static int
-mkyaffs2_assemble_ptags2(unsigned char *spare, struct yaffs_ext_tags *t,
-			 nand_ecclayout_t *ecclayout, int ecc)
+static MKYAFFS2_INSTANCE int
+mkyaffs2_assemble_ptags2_t (unsigned char *spare, struct yaffs_ext_tags *t,
+			    nand_ecclayout_t *ecclayout, int ecc,
+			    const int endian)
 {
 	ssize_t written;
 	struct yaffs_packed_tags2 pt2;
@@ -419,7 +455,7 @@ mkyaffs2_assemble_ptags2(unsigned char *spare, struct yaffs_ext_tags *t,
 	memset(&pt2, 0xff, sizeof(struct yaffs_packed_tags2));
 	yaffs_pack_tags2_tags_only(&pt2.t, t);
 
-	if (MKYAFFS2_ISENDIAN)
+	if (endian)
 		packedtags2_tagspart_endian_convert(&pt2);
 
 	if (ecc) {
@@ -427,7 +463,7 @@ mkyaffs2_assemble_ptags2(unsigned char *spare, struct yaffs_ext_tags *t,
 				     sizeof(struct yaffs_packed_tags2_tags_only),
 				     &pt2.ecc);
 
-		if (MKYAFFS2_ISENDIAN)
+		if (endian)
 			packedtags2_eccother_endian_convert(&pt2);
 	}
 
@@ -437,11 +473,55 @@ mkyaffs2_assemble_ptags2(unsigned char *spare, struct yaffs_ext_tags *t,
 	return written != sizeof(struct yaffs_packed_tags2);
 }
 
+#define MKYAFFS2_ASSEMBLE_PTAGS(name, layout, endian) \
+static int \
+name (unsigned char *spare, struct yaffs_ext_tags *t, \
+      nand_ecclayout_t *ecclayout, int ecc) \
+{ \
+	return layout(spare, t, ecclayout, ecc, endian); \
+}
+
+MKYAFFS2_ASSEMBLE_PTAGS(mkyaffs2_assemble_ptags1, mkyaffs2_assemble_ptags1_t, 0)
+MKYAFFS2_ASSEMBLE_PTAGS(mkyaffs2_assemble_ptags1_swap, mkyaffs2_assemble_ptags1_t, 1)
+MKYAFFS2_ASSEMBLE_PTAGS(mkyaffs2_assemble_ptags2, mkyaffs2_assemble_ptags2_t, 0)
+MKYAFFS2_ASSEMBLE_PTAGS(mkyaffs2_assemble_ptags2_swap, mkyaffs2_assemble_ptags2_t, 1)
+
+/*
+ * chunks are assembled in place in the output buffer, which is written
+ * out whenever it fills up and once more at the end.
+ */
 static int
-mkyaffs2_write_chunk (unsigned obj_id, unsigned chunk_id, unsigned bytes)
+mkyaffs2_flush_chunks (void)
 {
 	ssize_t written;
-	unsigned char *spare = mkyaffs2_databuf + mkyaffs2_chunksize;
+	size_t size = (size_t)mkyaffs2_outchunks * mkyaffs2_bufsize;
+
+	if (mkyaffs2_outchunks == 0)
+		return 0;
+
+	written = safe_write(mkyaffs2_image_fd, mkyaffs2_outbuf, size);
+
+	mkyaffs2_outchunks = 0;
+	mkyaffs2_databuf = mkyaffs2_outbuf;
+
+	if (written < 0 || (size_t)written != size) {
+		MKYAFFS2_DEBUG("write %u chunks failed: %s\n",
+				(unsigned)(size / mkyaffs2_bufsize),
+				strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * builds the spare (oob) of the chunk at buf, whose data is already there.
+ */
+static int
+mkyaffs2_assemble_chunk (unsigned char *buf, unsigned obj_id,
+			 unsigned chunk_id, unsigned bytes)
+{
+	unsigned char *spare = buf + mkyaffs2_chunksize;
 
 	struct yaffs_ext_tags tag;
 
@@ -470,32 +550,61 @@ mkyaffs2_write_chunk (unsigned obj_id, unsigned chunk_id, unsigned bytes)
 		return -1;
 	}
 
-	/* write a whole "chunk + spare" back to the image */
-	written = safe_write(mkyaffs2_image_fd,
-			     mkyaffs2_databuf, mkyaffs2_bufsize);
-	if (written != mkyaffs2_bufsize) {
-		MKYAFFS2_DEBUG("write chunk failed for obj %u chunk %u: %s\n",
-				obj_id, chunk_id, strerror(errno));
-		return -1;
-	}
+	return 0;
+}
 
+/*
+ * moves on to the next chunk of the output buffer.
+ */
+static int
+mkyaffs2_next_chunk (void)
+{
 	mkyaffs2_image_pages++;
+	mkyaffs2_databuf += mkyaffs2_bufsize;
+	if (++mkyaffs2_outchunks == MKYAFFS2_OUTBUF_CHUNKS)
+		return mkyaffs2_flush_chunks();
 
 	return 0;
 }
 
-static int 
-mkyaffs2_write_oh (struct yaffs_obj_hdr *oh, struct mkyaffs2_obj *obj)
+static int
+mkyaffs2_write_chunk (unsigned obj_id, unsigned chunk_id, unsigned bytes)
+{
+	if (mkyaffs2_assemble_chunk(mkyaffs2_databuf, obj_id, chunk_id, bytes))
+		return -1;
+
+	/* queue the whole "chunk + spare" for the image */
+	if (mkyaffs2_next_chunk()) {
+		MKYAFFS2_DEBUG("write chunk failed for obj %u chunk %u\n",
+				obj_id, chunk_id);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+mkyaffs2_assemble_oh (unsigned char *buf, struct yaffs_obj_hdr *oh,
+		      struct mkyaffs2_obj *obj)
 {
 	if (MKYAFFS2_ISENDIAN)
  	   	oh_endian_convert(oh);
 
 	/* copy header into the buffer */
-	memset(mkyaffs2_databuf, 0xff, mkyaffs2_chunksize);
-	memcpy(mkyaffs2_databuf, oh, sizeof(struct yaffs_obj_hdr));
+	memset(buf, 0xff, mkyaffs2_chunksize);
+	memcpy(buf, oh, sizeof(struct yaffs_obj_hdr));
+
+	return mkyaffs2_assemble_chunk(buf, obj->obj_id, 0, 0xffff);
+}
+
+static int 
+mkyaffs2_write_oh (struct yaffs_obj_hdr *oh, struct mkyaffs2_obj *obj)
+{
+	if (mkyaffs2_assemble_oh(mkyaffs2_databuf, oh, obj))
+		return -1;
 
 	/* write buffer */
-	return mkyaffs2_write_chunk(obj->obj_id, 0, 0xffff);
+	return mkyaffs2_next_chunk();
 }
 
 static int 
@@ -503,8 +612,8 @@ mkyaffs2_write_regfile (const char *fpath, struct mkyaffs2_obj *obj)
 {
 	int fd, retval = 0;
 	unsigned chunk = 0;
-	unsigned char *databuf = mkyaffs2_databuf;
 	ssize_t bytes;
+	long long fmk_start, fmk_bytes = 0;
 
 	fd = open(fpath, O_RDONLY);
 	if (fd < 0) {
@@ -512,8 +621,12 @@ mkyaffs2_write_regfile (const char *fpath, struct mkyaffs2_obj *obj)
 		return -1;
 	}
 
-	memset(databuf, 0xff, mkyaffs2_chunksize);
-	while((bytes = safe_read(fd, databuf, mkyaffs2_chunksize)) != 0) {
+	FMK_STAGE_BEGIN(write_file, fmk_start);
+
+	/* read straight into the output buffer */
+	memset(mkyaffs2_databuf, 0xff, mkyaffs2_chunksize);
+	while((bytes = safe_read(fd, mkyaffs2_databuf,
+				 mkyaffs2_chunksize)) != 0) {
 		if (bytes < 0) {
 			MKYAFFS2_DEBUG("error while reading file '%s': %s\n",
 					fpath, strerror(errno));
@@ -528,11 +641,263 @@ mkyaffs2_write_regfile (const char *fpath, struct mkyaffs2_obj *obj)
 					fpath, strerror(errno));
 			break;
 		}
+		fmk_bytes += bytes;
+
+		memset(mkyaffs2_databuf, 0xff, mkyaffs2_chunksize);
+	}
+
+	close(fd);
+	FMK_STAGE_END(write_file, fmk_start, fmk_bytes,
+		      (long long)chunk * mkyaffs2_bufsize);
+
+	return retval;
+}
+
+static int
+mkyaffs2_pipe_regfile (struct mkyaffs2_job *job)
+{
+	int fd, retval = 0;
+	unsigned char *buf;
+	ssize_t bytes;
+	long long fmk_start, fmk_bytes = 0;
+
+	fd = open(job->fpath, O_RDONLY);
+	if (fd < 0) {
+		MKYAFFS2_DEBUG("cannot open the file: '%s'\n", job->fpath);
+		return -1;
+	}
+
+	FMK_STAGE_BEGIN(write_file, fmk_start);
+
+	while (1) {
+		/* the file may have grown since it was looked at */
+		if (job->chunks == job->size) {
+			buf = realloc(job->buf, job->size * 2 *
+				      mkyaffs2_bufsize);
+			if (buf == NULL) {
+				retval = -1;
+				break;
+			}
+			job->buf = buf;
+			job->size *= 2;
+		}
+
+		buf = job->buf + job->chunks * mkyaffs2_bufsize;
+		memset(buf, 0xff, mkyaffs2_chunksize);
+		bytes = safe_read(fd, buf, mkyaffs2_chunksize);
+		if (bytes <= 0) {
+			if (bytes < 0) {
+				MKYAFFS2_DEBUG("error while reading file "
+					       "'%s': %s\n", job->fpath,
+					       strerror(errno));
+				retval = -1;
+			}
+			break;
+		}
 
-		memset(databuf, 0xff, mkyaffs2_chunksize);
+		retval = mkyaffs2_assemble_chunk(buf, job->obj_id,
+						 job->chunks, bytes);
+		if (retval)
+			break;
+
+		job->chunks++;
+		fmk_bytes += bytes;
 	}
 
 	close(fd);
+	FMK_STAGE_END(write_file, fmk_start, fmk_bytes,
+		      (long long)job->chunks * mkyaffs2_bufsize);
+
+	return retval;
+}
+
+/*
+ * pipelined mode: the tree walk queues every object in image order, with
+ * its header already assembled.  tasks of the pool (fmkpool.h) read regular
+ * files and assemble their chunks behind the header, and the walk emits the queue
+ * from its head as jobs are done, so the image comes out as in a single
+ * pass.  files over MKYAFFS2_PIPE_FILE_MAX are written by the walk itself
+ * once the queue has drained, which bounds the memory held by the queue.
+ */
+
+static void
+mkyaffs2_pipe_task (void *arg)
+{
+	struct mkyaffs2_pipe *p = &mkyaffs2_pipe;
+	struct mkyaffs2_job *job = arg;
+	int error = mkyaffs2_pipe_regfile(job);
+
+	pthread_mutex_lock(&p->mutex);
+	job->error = error;
+	job->done = 1;
+	pthread_mutex_unlock(&p->mutex);
+}
+
+/*
+ * emits the job at the head of the queue, waiting for it if wait is set;
+ * returns 1 when a job was emitted, 0 when none was and -1 on errors.
+ */
+static int
+mkyaffs2_pipe_emit (int wait)
+{
+	struct mkyaffs2_pipe *p = &mkyaffs2_pipe;
+	struct mkyaffs2_job *job;
+	unsigned n;
+	int retval = 1;
+
+	/* the walk reads files too while it waits, until one is done */
+	pthread_mutex_lock(&p->mutex);
+	while (p->emitted < p->queued &&
+	       !p->job[p->emitted % MKYAFFS2_PIPE_JOBS].done && wait) {
+		long pending = __sync_add_and_fetch(&p->group.pending, 0);
+
+		pthread_mutex_unlock(&p->mutex);
+		fmk_pool_wait(&p->group, pending > 0 ? pending - 1 : 0);
+		pthread_mutex_lock(&p->mutex);
+	}
+	if (p->emitted == p->queued ||
+	    !p->job[p->emitted % MKYAFFS2_PIPE_JOBS].done) {
+		pthread_mutex_unlock(&p->mutex);
+		return 0;
+	}
+	job = &p->job[p->emitted % MKYAFFS2_PIPE_JOBS];
+	pthread_mutex_unlock(&p->mutex);
+
+	for (n = 0; n < job->chunks && retval > 0; n++) {
+		memcpy(mkyaffs2_databuf, job->buf + n * mkyaffs2_bufsize,
+		       mkyaffs2_bufsize);
+		if (mkyaffs2_next_chunk())
+			retval = -1;
+	}
+
+	if (job->error) {
+		MKYAFFS2_ERROR("object %u: [FILE] '%s' (FAILED).\n",
+				job->obj_id, job->fpath);
+		retval = -1;
+	}
+
+	free(job->buf);
+	free(job->fpath);
+
+	pthread_mutex_lock(&p->mutex);
+	p->emitted++;
+	pthread_mutex_unlock(&p->mutex);
+
+	return retval;
+}
+
+static int
+mkyaffs2_pipe_drain (void)
+{
+	int retval;
+
+	while ((retval = mkyaffs2_pipe_emit(1)) > 0)
+		;
+
+	return retval;
+}
+
+/*
+ * queues obj with its header, and a regular file of size bytes at fpath
+ * to be read by a worker unless fpath is NULL.
+ */
+static int
+mkyaffs2_pipe_obj (struct yaffs_obj_hdr *oh, struct mkyaffs2_obj *obj,
+		   const char *fpath, off_t size)
+{
+	struct mkyaffs2_pipe *p = &mkyaffs2_pipe;
+	struct mkyaffs2_job *job;
+	unsigned char *buf;
+	unsigned chunks = 1;
+	char *path = NULL;
+	int retval;
+
+	/* emit what is done, and make room when the queue is full */
+	while ((retval = mkyaffs2_pipe_emit(0)) > 0)
+		;
+	while (retval == 0 && p->queued - p->emitted == MKYAFFS2_PIPE_JOBS)
+		retval = mkyaffs2_pipe_emit(1) < 0 ? -1 : 0;
+	if (retval < 0)
+		return -1;
+
+	if (fpath)
+		chunks += (size + mkyaffs2_chunksize - 1) / mkyaffs2_chunksize;
+
+	buf = malloc(chunks * mkyaffs2_bufsize);
+	if (buf == NULL || (fpath && (path = strdup(fpath)) == NULL)) {
+		MKYAFFS2_ERROR("cannot allocate memory for obj %u\n",
+			       obj->obj_id);
+		free(buf);
+		return -1;
+	}
+
+	if (mkyaffs2_assemble_oh(buf, oh, obj)) {
+		free(buf);
+		free(path);
+		return -1;
+	}
+
+	job = &p->job[p->queued % MKYAFFS2_PIPE_JOBS];
+	job->buf = buf;
+	job->size = chunks;
+	job->chunks = 1;
+	job->obj_id = obj->obj_id;
+	job->fpath = path;
+	job->error = 0;
+	job->done = (path == NULL);
+
+	pthread_mutex_lock(&p->mutex);
+	p->queued++;
+	pthread_mutex_unlock(&p->mutex);
+
+	if (path)
+		fmk_pool_submit(&p->group, mkyaffs2_pipe_task, job,
+				FMK_POOL_NORMAL);
+
+	return 0;
+}
+
+static void
+mkyaffs2_pipe_start (void)
+{
+	struct fmk_pool *pool;
+
+	/* fill the tags ecc tables before the workers share them */
+	if (MKYAFFS2_ISYAFFS1) {
+		unsigned char tags[8] = {0};
+		yaffs_ecc_calc_tags1(tags);
+	}
+
+	if (mkyaffs2_threads <= 1)
+		return;
+
+	pool = fmk_pool_get(mkyaffs2_threads);
+	if (fmk_pool_size(pool) == 0)
+		return;
+
+	fmk_pool_group_init(&mkyaffs2_pipe.group, pool);
+	mkyaffs2_pipe.running = 1;
+}
+
+static int
+mkyaffs2_pipe_stop (void)
+{
+	int retval;
+	struct mkyaffs2_pipe *p = &mkyaffs2_pipe;
+
+	if (!p->running)
+		return 0;
+
+	retval = mkyaffs2_pipe_drain();
+	fmk_pool_wait(&p->group, 0);
+
+	/* jobs left over after an error */
+	for (; p->emitted < p->queued; p->emitted++) {
+		free(p->job[p->emitted % MKYAFFS2_PIPE_JOBS].buf);
+		free(p->job[p->emitted % MKYAFFS2_PIPE_JOBS].fpath);
+	}
+
+	p->running = 0;
 
 	return retval;
 }
@@ -724,6 +1089,15 @@ write_obj:
 	if (obj->obj_id > YAFFS_MAX_OBJECT_ID)
 		MKYAFFS2_WARN("warning: too many files\n");
 
+	if (mkyaffs2_pipe.running) {
+		if (obj->type != YAFFS_OBJECT_TYPE_FILE)
+			return mkyaffs2_pipe_obj(&oh, obj, NULL, 0);
+		if (s.st_size <= MKYAFFS2_PIPE_FILE_MAX)
+			return mkyaffs2_pipe_obj(&oh, obj, fpath, s.st_size);
+		if (mkyaffs2_pipe_drain() < 0)
+			return -1;
+	}
+
 	retval = mkyaffs2_write_oh(&oh, obj);
 
 	if (obj->type == YAFFS_OBJECT_TYPE_FILE && !retval)
@@ -857,6 +1231,7 @@ mkyaffs2_create_image (const char *dirpath, const char *imgfile)
 	int retval;
 	struct stat statbuf;
 	struct mkyaffs2_obj *root;
+	long long fmk_start;
 
 	if (stat(dirpath, &statbuf) < 0 && !S_ISDIR(statbuf.st_mode)) {
 		MKYAFFS2_ERROR("ROOT is not a directory '%s'.\n", dirpath);
@@ -877,10 +1252,12 @@ mkyaffs2_create_image (const char *dirpath, const char *imgfile)
 
 	/* allocate working buffer */
 	mkyaffs2_bufsize = mkyaffs2_chunksize + mkyaffs2_sparesize;
-	mkyaffs2_databuf = (unsigned char *)malloc(mkyaffs2_bufsize);
-	if (mkyaffs2_databuf == NULL) {
+	mkyaffs2_outbuf = (unsigned char *)malloc(mkyaffs2_bufsize *
+						  MKYAFFS2_OUTBUF_CHUNKS);
+	mkyaffs2_databuf = mkyaffs2_outbuf;
+	if (mkyaffs2_outbuf == NULL) {
 		MKYAFFS2_ERROR("cannot allocate working buffer (%u bytes): %s",
-				mkyaffs2_chunksize + mkyaffs2_sparesize,
+				mkyaffs2_bufsize * MKYAFFS2_OUTBUF_CHUNKS,
 				strerror(errno));
 		retval = -1;
 		goto exit_and_out;
@@ -899,9 +1276,11 @@ mkyaffs2_create_image (const char *dirpath, const char *imgfile)
 	MKYAFFS2_PRINTF("stage 1: scanning directory '%s'... [*]",
 			mkyaffs2_curfile);
 
+	FMK_STAGE_BEGIN(scan, fmk_start);
 	retval = mkyaffs2_scan_dir(mkyaffs2_objtree.root);
 	if (retval < 0)
 		goto free_and_out;
+	FMK_STAGE_END(scan, fmk_start, 0, mkyaffs2_objtree.objs);
 
 	MKYAFFS2_PRINTF("\b\b\b[done]\nscanning complete, total objects: %u.\n",
 			mkyaffs2_objtree.objs);
@@ -913,12 +1292,19 @@ mkyaffs2_create_image (const char *dirpath, const char *imgfile)
 	MKYAFFS2_PROGRESS_INIT();
 
 	snprintf(mkyaffs2_curfile, PATH_MAX, "%s", dirpath);
+	mkyaffs2_pipe_start();
 	retval = mkyaffs2_assemble_objtree(mkyaffs2_objtree.root);
+	retval |= mkyaffs2_pipe_stop();
+	if (mkyaffs2_flush_chunks()) {
+		MKYAFFS2_ERROR("cannot write the image file: '%s'.\n",
+				imgfile);
+		retval = -1;
+	}
 
 free_and_out:
 	if (mkyaffs2_image_fd >= 0)
 		close(mkyaffs2_image_fd);
-	free(mkyaffs2_databuf);
+	free(mkyaffs2_outbuf);
 exit_and_out:
 	mkyaffs2_objtree_exit(&mkyaffs2_objtree);
 	mkyaffs2_objtable_exit();
@@ -935,6 +1321,7 @@ mkyaffs2_helper (void)
 	MKYAFFS2_HELP("Usage: mkyaffs2 [-h|--help] [-e|--endian] [-v|--verbose]\n"
 		      "                [-p|--pagesize pagesize] [-s|sparesize sparesize]\n"
 		      "                [-o|--oobimg oobimage] [--all-root] [--yaffs-ecclayout]\n"
+		      "                [-t|--threads threads]\n"
 		      "                dirname imgfile\n\n");
 	MKYAFFS2_HELP("Options:\n");
 	MKYAFFS2_HELP("  -h                 display this help message and exit.\n");
@@ -947,6 +1334,8 @@ mkyaffs2_helper (void)
 	MKYAFFS2_HELP("  -o oobimage        load external oob image file.\n");
 	MKYAFFS2_HELP("  --all-root         all files in the target system are owned by root.\n");
 	MKYAFFS2_HELP("  --yaffs-ecclayout  use yaffs oob scheme instead of the Linux MTD default.\n");
+	MKYAFFS2_HELP("  -t threads         threads to read files and assemble chunks with.\n"
+		      "                     (default: the number of processors)\n");
 
 	return -1;
 }
@@ -960,11 +1349,12 @@ main (int argc, char *argv[])
 	char *dirpath = NULL, *imgfile = NULL, *oobfile = NULL;
 	
 	int option, option_index;
-	static const char *short_options = "hvep:s:o:";
+	static const char *short_options = "hvep:s:o:t:";
 	static const struct option long_options[] = {
 		{"pagesize", 		required_argument, 	0, 'p'},
 		{"sparesize", 		required_argument, 	0, 's'},
 		{"oobimg",		required_argument,	0, 'o'},
+		{"threads",		required_argument,	0, 't'},
 		{"endian", 		no_argument, 		0, 'e'},
 		{"verbose", 		no_argument, 		0, 'v'},
 		{"all-root",		no_argument,		0, '0'},
@@ -974,6 +1364,7 @@ main (int argc, char *argv[])
 	};
 
 	mkyaffs2_chunksize = DEFAULT_CHUNKSIZE;
+	fmk_stats_init("mkyaffs2");
 
 	while ((option = getopt_long(argc, argv, short_options,
 				     long_options, &option_index)) != EOF) {
@@ -987,6 +1378,9 @@ main (int argc, char *argv[])
 		case 'o':
 			oobfile = optarg;
 			break;
+		case 't':
+			mkyaffs2_threads = strtoul(optarg, NULL, 10);
+			break;
 		case 'e':
 			mkyaffs2_flags |= MKYAFFS2_FLAGS_ENDIAN;
 			break;
@@ -1011,6 +1405,9 @@ main (int argc, char *argv[])
 	dirpath = argv[optind];
 	imgfile = argv[optind + 1];
 
+	if (mkyaffs2_threads == 0)
+		mkyaffs2_threads = fmk_pool_threads();
+
 	MKYAFFS2_PRINTF("mkyaffs2 %s: image building tool for YAFFS2.\n",
 			YAFFS2UTILS_VERSION);
 
@@ -1031,11 +1428,9 @@ main (int argc, char *argv[])
 	}
 
 	/* veridate the page size */
-	mkyaffs2_assemble_ptags = &mkyaffs2_assemble_ptags2;
 	switch (mkyaffs2_chunksize) {
 	case 512:
 		mkyaffs2_flags |= MKYAFFS2_FLAGS_YAFFS1;
-		mkyaffs2_assemble_ptags = &mkyaffs2_assemble_ptags1;
 		if (oobfile == NULL)
 			mkyaffs2_ecclayout = &nand_oob_16;
 		break;
@@ -1059,6 +1454,14 @@ main (int argc, char *argv[])
 		return -1;
 	}
 
+	/* the tags layout and byte order are known, which decides the packing */
+	if (MKYAFFS2_ISYAFFS1)
+		mkyaffs2_assemble_ptags = MKYAFFS2_ISENDIAN ?
+			&mkyaffs2_assemble_ptags1_swap : &mkyaffs2_assemble_ptags1;
+	else
+		mkyaffs2_assemble_ptags = MKYAFFS2_ISENDIAN ?
+			&mkyaffs2_assemble_ptags2_swap : &mkyaffs2_assemble_ptags2;
+
 	/* spare size */
 	if (!mkyaffs2_sparesize)
 		mkyaffs2_sparesize = mkyaffs2_chunksize / 32;
@@ -25,13 +25,20 @@
 #include "mtd-abi.h"
 #endif
 
-static nand_ecclayout_t nand_oob_16 = {
+/* not every tool including this uses every layout */
+#ifdef __GNUC__
+#define NAND_ECCLAYOUT_UNUSED	__attribute__((unused))
+#else
+#define NAND_ECCLAYOUT_UNUSED
+#endif
+
+static nand_ecclayout_t nand_oob_16 NAND_ECCLAYOUT_UNUSED = {
 	.eccbytes	= 6,
 	.eccpos		= {0, 1, 2, 3, 6, 7},
 	.oobfree	= {{.offset = 8, .length = 8}},
 };
 
-static nand_ecclayout_t nand_oob_64 = {
+static nand_ecclayout_t nand_oob_64 NAND_ECCLAYOUT_UNUSED = {
 	.eccbytes	= 24,
 	.eccpos		= {40, 41, 42, 43, 44, 45, 46, 47,
 			   48, 49, 50, 51, 52, 53, 54, 55,
@@ -39,7 +46,7 @@ static nand_ecclayout_t nand_oob_64 = {
 	.oobfree	= {{.offset = 2, .length = 38}},
 };
 
-static nand_ecclayout_t yaffs_nand_oob_64 = {
+static nand_ecclayout_t yaffs_nand_oob_64 NAND_ECCLAYOUT_UNUSED = {
 	.eccbytes	= 24,
 	.eccpos		= {40, 41, 42, 43, 44, 45, 46, 47,
 			   48, 49, 50, 51, 52, 53, 54, 55,
@@ -47,7 +54,7 @@ static nand_ecclayout_t yaffs_nand_oob_64 = {
 	.oobfree	= {{.offset = 0, .length = 40}},
 };
 
-static nand_ecclayout_t nand_oob_128 = {
+static nand_ecclayout_t nand_oob_128 NAND_ECCLAYOUT_UNUSED = {
 	.eccbytes	= 48,
 	.eccpos		= {
 			   80, 81, 82, 83, 84, 85, 86, 87,
@@ -59,7 +66,7 @@ static nand_ecclayout_t nand_oob_128 = {
 	.oobfree	= {{.offset = 2, .length = 78}}
 };
 
-static nand_ecclayout_t yaffs_nand_oob_128 = {
+static nand_ecclayout_t yaffs_nand_oob_128 NAND_ECCLAYOUT_UNUSED = {
 	.eccbytes	= 48,
 	.eccpos		= {
 			   80, 81, 82, 83, 84, 85, 86, 87,
@@ -71,6 +78,6 @@ static nand_ecclayout_t yaffs_nand_oob_128 = {
 	.oobfree	= {{.offset = 0, .length = 80}}
 };
 
-static nand_ecclayout_t nand_oob_user = {0};
+static nand_ecclayout_t nand_oob_user NAND_ECCLAYOUT_UNUSED = {0};
 
 #endif
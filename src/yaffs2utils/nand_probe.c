@@ -0,0 +1,262 @@
+/*
+ * yaffs2utils: Utilities to make/extract a YAFFS2/YAFFS1 image.
+ * Copyright (C) 2010-2011 Luen-Yung Lin <penguin.lin@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "configs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "yaffs_ecc.h"
+#include "yaffs_packedtags1.h"
+#include "yaffs_packedtags2.h"
+
+#include "endian_convert.h"
+#include "nand_ecclayout.h"
+#include "nand_probe.h"
+
+/*----------------------------------------------------------------------------*/
+
+#define NAND_PROBE_SAMPLES	512	/* pages read per geometry */
+#define NAND_PROBE_HEAD		64	/* leading pages all read, for headers */
+
+/*
+ * The page and spare sizes tried, each with the layouts nand_ecclayout.h
+ * has for it.  Spares larger than the layouts' are the 4K and 8K page
+ * parts with 224 and 448 byte OOBs; the tags only use the start.
+ */
+static const struct nand_probe_geometry {
+	unsigned chunksize;
+	unsigned sparesize;
+	nand_ecclayout_t *layout;
+	const char *name;
+} nand_probe_geometries[] = {
+	{512,	16,	&nand_oob_16,		"nand_oob_16"},
+	{2048,	64,	&nand_oob_64,		"nand_oob_64"},
+	{2048,	64,	&yaffs_nand_oob_64,	"yaffs_nand_oob_64"},
+	{4096,	128,	&nand_oob_128,		"nand_oob_128"},
+	{4096,	128,	&yaffs_nand_oob_128,	"yaffs_nand_oob_128"},
+	{4096,	224,	&nand_oob_128,		"nand_oob_128"},
+	{4096,	224,	&yaffs_nand_oob_128,	"yaffs_nand_oob_128"},
+	{8192,	256,	&nand_oob_128,		"nand_oob_128"},
+	{8192,	256,	&yaffs_nand_oob_128,	"yaffs_nand_oob_128"},
+	{8192,	448,	&nand_oob_128,		"nand_oob_128"},
+	{8192,	448,	&yaffs_nand_oob_128,	"yaffs_nand_oob_128"},
+	{16384,	512,	&nand_oob_128,		"nand_oob_128"},
+	{16384,	512,	&yaffs_nand_oob_128,	"yaffs_nand_oob_128"},
+};
+
+/*----------------------------------------------------------------------------*/
+
+static void
+nand_probe_spare2ptags (unsigned char *tag, const unsigned char *spare,
+			size_t bytes, const nand_ecclayout_t *ecclayout)
+{
+	unsigned i;
+	size_t copied = 0;
+
+	for (i = 0; i < 8 && copied < bytes; i++) {
+		size_t size = bytes - copied;
+
+		if (size > ecclayout->oobfree[i].length)
+			size = ecclayout->oobfree[i].length;
+
+		memcpy(tag, spare + ecclayout->oobfree[i].offset, size);
+
+		copied += size;
+		tag += size;
+	}
+}
+
+/* an object header with a known type, a parent and a terminated name */
+static int
+nand_probe_oh (const unsigned char *data, int endian)
+{
+	const struct yaffs_obj_hdr *oh = (const struct yaffs_obj_hdr *)data;
+	unsigned type, parent;
+
+	memcpy(&type, &oh->type, sizeof(type));
+	memcpy(&parent, &oh->parent_obj_id, sizeof(parent));
+	if (endian) {
+		type = ENDIAN_SWAP_32(type);
+		parent = ENDIAN_SWAP_32(parent);
+	}
+
+	return type >= YAFFS_OBJECT_TYPE_FILE &&
+	       type <= YAFFS_OBJECT_TYPE_SOCK &&
+	       parent >= 1 && parent <= YAFFS_MAX_OBJECT_ID &&
+	       memchr(oh->name, 0, sizeof(oh->name)) != NULL;
+}
+
+/*
+ * Scores the tags of one page as read through a geometry: -1 for erased
+ * pages, 0 for tags no yaffs would write, and more for sane tags, the
+ * more so when their ECC checks out or they head a valid object header.
+ * Sane tags alone score 1, so 2 and up means one of the latter held.
+ */
+static int
+nand_probe_chunk (const unsigned char *chunk,
+		  const struct nand_probe_geometry *g, int endian)
+{
+	struct yaffs_ext_tags t;
+	const unsigned char *spare = chunk + g->chunksize;
+	int score = 1;
+
+	if (g->chunksize == 512) {
+		struct yaffs_packed_tags1 pt1;
+
+		memset(&pt1, 0xff, sizeof(struct yaffs_packed_tags1));
+		nand_probe_spare2ptags((unsigned char *)&pt1, spare,
+				       sizeof(struct yaffs_packed_tags1),
+				       g->layout);
+		if (endian)
+			packedtags1_endian_convert(&pt1, 1);
+
+		yaffs_unpack_tags1(&t, &pt1);
+		if (!t.chunk_used)
+			return -1;
+		if (t.block_bad || (t.chunk_id && t.n_bytes > g->chunksize))
+			return 0;
+	}
+	else {
+		struct yaffs_packed_tags2 pt2;
+		struct yaffs_ecc_other ecc;
+
+		memset(&pt2, 0xff, sizeof(struct yaffs_packed_tags2));
+		nand_probe_spare2ptags((unsigned char *)&pt2, spare,
+				       sizeof(struct yaffs_packed_tags2),
+				       g->layout);
+		if (pt2.t.seq_number == 0xffffffff)
+			return -1;
+
+		if (endian)
+			packedtags2_eccother_endian_convert(&pt2);
+		yaffs_ecc_calc_other((unsigned char *)&pt2.t,
+				     sizeof(struct yaffs_packed_tags2_tags_only),
+				     &ecc);
+		if (yaffs_ecc_correct_other((unsigned char *)&pt2.t,
+				sizeof(struct yaffs_packed_tags2_tags_only),
+				&pt2.ecc, &ecc) == 0)
+			score++;
+
+		if (endian)
+			packedtags2_tagspart_endian_convert(&pt2);
+
+		yaffs_unpack_tags2_tags_only(&t, &pt2.t);
+		if (t.seq_number < YAFFS_LOWEST_SEQUENCE_NUMBER ||
+		    t.seq_number > YAFFS_HIGHEST_SEQUENCE_NUMBER ||
+		    (t.chunk_id && t.n_bytes > g->chunksize))
+			return 0;
+	}
+
+	if (t.obj_id < 1 || t.obj_id > YAFFS_MAX_OBJECT_ID)
+		return 0;
+
+	if (t.chunk_id == 0) {
+		if (!nand_probe_oh(chunk, endian))
+			return 0;
+		score += 2;
+	}
+
+	return score;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*
+ * Finds the page size, spare size, OOB layout and tags byte order of a
+ * flash dump by reading up to NAND_PROBE_SAMPLES pages, spread over the
+ * image, through every geometry the image size allows, in both byte
+ * orders.  The best scoring one wins, if most of its used pages had sane
+ * tags and at least one was an object header or passed its ECC.  Returns
+ * 0 and fills probe in, or -1 if nothing fits.
+ */
+int
+nand_probe (int fd, struct nand_probe *probe)
+{
+	unsigned i, endian, best = 0;
+	unsigned char *buf;
+	struct stat st;
+
+	if (fstat(fd, &st) < 0 || st.st_size <= 0)
+		return -1;
+
+	buf = malloc(16384 + 512);
+	if (buf == NULL)
+		return -1;
+
+	memset(probe, 0, sizeof(struct nand_probe));
+
+	for (i = 0; i < sizeof(nand_probe_geometries) /
+			sizeof(nand_probe_geometries[0]); i++) {
+		const struct nand_probe_geometry *g = &nand_probe_geometries[i];
+		size_t rawsize = g->chunksize + g->sparesize;
+		off_t chunks = st.st_size / rawsize, stride, c;
+
+		if (chunks == 0 || st.st_size % rawsize)
+			continue;
+
+		stride = chunks > NAND_PROBE_SAMPLES ?
+			 chunks / NAND_PROBE_SAMPLES : 1;
+
+		for (endian = 0; endian < 2; endian++) {
+			unsigned score = 0, valid = 0, used = 0, sure = 0;
+
+			for (c = 0; c < chunks;
+			     c += c < NAND_PROBE_HEAD ? 1 : stride) {
+				int s;
+
+				if (pread(fd, buf, rawsize, c * rawsize) !=
+				    (ssize_t)rawsize)
+					break;
+
+				s = nand_probe_chunk(buf, g, endian);
+				if (s < 0)
+					continue;
+
+				used++;
+				if (s > 0) {
+					valid++;
+					score += s;
+				}
+				if (s >= 2)
+					sure++;
+			}
+
+			if (!sure || valid * 2 <= used || score <= best)
+				continue;
+
+			best = score;
+			probe->chunksize = g->chunksize;
+			probe->sparesize = g->sparesize;
+			probe->flags = (g->chunksize == 512 ?
+					NAND_PROBE_YAFFS1 : 0) |
+				       (endian ? NAND_PROBE_ENDIAN : 0);
+			probe->layout = *g->layout;
+			probe->layout_name = g->name;
+			probe->valid = valid;
+			probe->used = used;
+		}
+	}
+
+	free(buf);
+
+	return best ? 0 : -1;
+}
@@ -0,0 +1,48 @@
+/*
+ * yaffs2utils: Utilities to make/extract a YAFFS2/YAFFS1 image.
+ * Copyright (C) 2010-2011 Luen-Yung Lin <penguin.lin@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __YAFFS2UTILS_NAND_PROBE_H__
+#define __YAFFS2UTILS_NAND_PROBE_H__
+
+#ifndef _HAVE_BROKEN_MTD_H
+#include <mtd/mtd-user.h>
+#else
+#include "mtd-abi.h"
+#endif
+
+#define NAND_PROBE_YAFFS1	(1 << 0)	/* 512 bytes pages, yaffs1 tags */
+#define NAND_PROBE_ENDIAN	(1 << 1)	/* tags of the other byte order */
+
+/*
+ * The geometry of a flash dump, found by nand_probe(): the page and
+ * spare sizes, the OOB layout the tags were read through, as unspare2
+ * saves it, and how many of the sampled pages had sane tags.
+ */
+struct nand_probe {
+	unsigned chunksize;
+	unsigned sparesize;
+	unsigned flags;
+	nand_ecclayout_t layout;
+	const char *layout_name;
+	unsigned valid;
+	unsigned used;
+};
+
+int nand_probe (int fd, struct nand_probe *probe);
+
+#endif
@@ -39,12 +39,14 @@
 
 #include "safe_rw.h"
 #include "endian_convert.h"
+#include "nand_probe.h"
 
 #include "version.h"
 
 /*----------------------------------------------------------------------------*/
 
 #define UNSPARE2_FLAGS_ENDIAN           0x01
+#define UNSPARE2_FLAGS_PROBE            0x02
 
 #define UNSPARE2_ISENDIAN       (unspare2_flags & UNSPARE2_FLAGS_ENDIAN)
 
@@ -103,10 +105,39 @@ unspare2_endian_convert (nand_ecclayout_t *oob)
 /*----------------------------------------------------------------------------*/
 
 static int
-unspare2_dump (const char *devfile, const char *imgfile)
+unspare2_save (nand_ecclayout_t *oob, const char *imgfile)
 {
 	int fd, retval = 0;
 	ssize_t written;
+
+	/* endian transform */
+	if (UNSPARE2_ISENDIAN)
+		unspare2_endian_convert(oob);
+
+	/* write data back to the file */
+	if ((fd = open(imgfile, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		retval = -1;
+		UNSPARE2_ERROR("cannot open the image %s\n", imgfile);
+	}
+
+	written = safe_write(fd, oob, sizeof(nand_ecclayout_t));
+	if (written != sizeof(nand_ecclayout_t)) {
+		retval = -1;
+		UNSPARE2_ERROR("write oob info back to image failed\n");
+	}
+
+	close(fd);
+
+	if (retval)
+		unlink(imgfile);
+
+	return retval;
+}
+
+static int
+unspare2_dump (const char *devfile, const char *imgfile)
+{
+	int fd, retval = 0;
 	nand_ecclayout_t oob;
 
 	/* get the ecc layout via ioctl() */
@@ -126,28 +157,34 @@ unspare2_dump (const char *devfile, const char *imgfile)
 	if (retval)
 		return retval;
 
-	/* endian transform */
-	if (UNSPARE2_ISENDIAN)
-		unspare2_endian_convert(&oob);
+	return unspare2_save(&oob, imgfile);
+}
 
-	/* write data back to the file */
-	if ((fd = open(imgfile, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
-		retval = -1;
-		UNSPARE2_ERROR("cannot open the image %s\n", imgfile);
-	}
+/* find the layout of a raw dump with its spares, for devices we lack */
+static int
+unspare2_probe (const char *dumpfile, const char *imgfile)
+{
+	int fd, retval;
+	struct nand_probe probe;
 
-	written = safe_write(fd, &oob, sizeof(nand_ecclayout_t));
-	if (written != sizeof(nand_ecclayout_t)) {
-		retval = -1;
-		UNSPARE2_ERROR("write oob info back to image failed\n");
+	if ((fd = open(dumpfile, O_RDONLY)) < 0) {
+		UNSPARE2_ERROR("cannot open the dump %s\n", dumpfile);
+		return -1;
 	}
 
+	retval = nand_probe(fd, &probe);
 	close(fd);
 
-	if (retval)
-		unlink(imgfile);
+	if (retval) {
+		UNSPARE2_ERROR("cannot find the geometry of %s\n", dumpfile);
+		return retval;
+	}
 
-	return retval;
+	UNSPARE2_PRINTF("%u bytes pages, %u bytes spares, %s, %s byte order\n",
+			probe.chunksize, probe.sparesize, probe.layout_name,
+			probe.flags & NAND_PROBE_ENDIAN ? "other" : "local");
+
+	return unspare2_save(&probe.layout, imgfile);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -156,10 +193,11 @@ static void
 unspare2_helper (void)
 {
 	UNSPARE2_HELP("unspare2 %s - A utility to extract the OOB layout\n\n", YAFFS2UTILS_VERSION);
-	UNSPARE2_HELP("Usage: unspare2 devfile imgfile\n\n");
+	UNSPARE2_HELP("Usage: unspare2 [-e] [-i] devfile imgfile\n\n");
 	UNSPARE2_HELP("options:\n");
 	UNSPARE2_HELP("  -h  display this help message and exit.\n");
 	UNSPARE2_HELP("  -e  convert the endian differed from the local machine.\n");
+	UNSPARE2_HELP("  -i  probe devfile as a raw dump with spares, not a device.\n");
 }
 
 /*----------------------------------------------------------------------------*/
@@ -171,10 +209,11 @@ main (int argc, char *argv[])
 	char *devpath, *imgpath;
 
 	int option, option_index;
-	static const char *short_options = "he";
+	static const char *short_options = "hei";
 	static const struct option long_options[] = {
 		{"help",	no_argument,	0, 'h'},
 		{"endian",	no_argument,	0, 'e'},
+		{"image",	no_argument,	0, 'i'},
 		{NULL,		no_argument,	0, '\0'},
 	};
 
@@ -185,6 +224,9 @@ main (int argc, char *argv[])
 		case 'e':
 			unspare2_flags |= UNSPARE2_FLAGS_ENDIAN;
 			break;
+		case 'i':
+			unspare2_flags |= UNSPARE2_FLAGS_PROBE;
+			break;
 		case 'h':
 			unspare2_helper();
 			return 0;
@@ -205,10 +247,15 @@ main (int argc, char *argv[])
 	UNSPARE2_PRINTF("unspare2 %s: OOB extracting tool for yaffs2utils\n",
 			YAFFS2UTILS_VERSION);
 
-	if (getuid() != 0)
-		UNSPARE2_WARN("warning: non-root users\n");
+	if (unspare2_flags & UNSPARE2_FLAGS_PROBE) {
+		retval = unspare2_probe(devpath, imgpath);
+	}
+	else {
+		if (getuid() != 0)
+			UNSPARE2_WARN("warning: non-root users\n");
 
-	retval = unspare2_dump(devpath, imgpath);
+		retval = unspare2_dump(devpath, imgpath);
+	}
 
 	UNSPARE2_PRINTF("\n");
 	if (!retval)
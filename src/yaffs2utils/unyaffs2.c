@@ -49,6 +49,11 @@
 #include "progress_bar.h"
 #include "endian_convert.h"
 #include "nand_ecclayout.h"
+#include "nand_probe.h"
+
+#include "../fmkstats/fmkstats.h"
+#include "../fmkindex/fmkindex.h"
+#include "../fmkpool/fmkpool.h"
 
 #include "version.h"
 
@@ -56,6 +61,11 @@
 
 #define UNYAFFS2_OBJTABLE_SIZE	4096
 #define UNYAFFS2_HARDLINK_MAX	127
+#define UNYAFFS2_BLOCK_CHUNKS	64	/* chunks per erase block */
+#define UNYAFFS2_SAMPLE_CHUNKS	16	/* smallest erase block in chunks */
+#define UNYAFFS2_QUEUE_SIZE	64	/* files waiting to be written */
+#define UNYAFFS2_SCAN_PARTS	4	/* scan tasks per thread */
+#define UNYAFFS2_JOURNAL_MAGIC	"UNYJRNL1"
 
 #define UNYAFFS2_FLAGS_NONROOT	(1 << 0)
 #define UNYAFFS2_FLAGS_SHOWBAR	(1 << 1)
@@ -70,6 +80,20 @@
 #define UNYAFFS2_ISYAFFSECC	(unyaffs2_flags & UNYAFFS2_FLAGS_YAFFSECC)
 #define UNYAFFS2_ISVERBOSE	(unyaffs2_flags & UNYAFFS2_FLAGS_VERBOSE)
 
+/*
+ * the per-chunk tag parsing and scan are written once with the tags
+ * layout and the byte order as constant arguments, and instantiated for
+ * each combination; main() picks the instantiations once, so their
+ * UNYAFFS2_ISYAFFS1 and UNYAFFS2_ISENDIAN tests fold away.
+ */
+#define UNYAFFS2_INSTANCE	inline __attribute__((always_inline))
+
+#ifdef __GNUC__
+#define UNYAFFS2_PREFETCH(p)	__builtin_prefetch(p)
+#else
+#define UNYAFFS2_PREFETCH(p)	do { } while (0)
+#endif
+
 #define UNYAFFS2_PRINTF(s, args...) \
 		do { \
 			if (!UNYAFFS2_ISVERBOSE && UNYAFFS2_ISSHOWBAR) { \
@@ -130,7 +154,6 @@
 
 typedef struct unyaffs2_file_var {
 	loff_t file_size;
-	off_t file_head;
 } unyaffs2_file_var_t;
 
 typedef struct unyaffs2_symlink_var {
@@ -145,6 +168,13 @@ typedef struct unyaffs2_dev_var {
 	unsigned rdev;
 } unyaffs2_dev_var_t;
 
+typedef struct unyaffs2_chunk {
+	unsigned chunk_id;
+	unsigned seq_number;
+	unsigned n_bytes;
+	off_t offset;			/* chunk offset in the image */
+} unyaffs2_chunk_t;
+
 typedef union unyaffs2_file_variant {
 	struct unyaffs2_file_var file;
 	struct unyaffs2_symlink_var symlink;
@@ -155,8 +185,14 @@ typedef union unyaffs2_file_variant {
 typedef struct unyaffs2_obj {
 	unsigned char valid:1;
 	unsigned char extracted:1;	/* 1 when extracted. */
+	unsigned char journalled:1;	/* written by an earlier -r run */
 
 	off_t hdr_off;			/* header offset in the image */
+	unsigned hdr_seq;		/* sequence number of the header */
+
+	struct unyaffs2_chunk *chunks;	/* data chunks, in image order */
+	unsigned nchunks;
+	unsigned chunks_size;
 
 	unsigned obj_id;
 	unsigned parent_id;
@@ -192,6 +228,25 @@ typedef struct unyaffs2_specfile {
 	struct list_head list;		/* specified files list */
 } unyaffs2_specfile_t;
 
+typedef struct unyaffs2_scan_tag {
+	unsigned obj_id;
+	unsigned chunk_id;		/* 0 for the header */
+	unsigned seq_number;
+	unsigned n_bytes;
+	off_t offset;			/* chunk offset in the image */
+} unyaffs2_scan_tag_t;
+
+#ifdef _HAVE_MMAP
+typedef struct unyaffs2_scan_range {
+	int error;
+	off_t start;			/* first chunk of the erase blocks */
+	off_t end;
+	struct unyaffs2_scan_tag *tags;	/* tags found, in image order */
+	unsigned ntags;
+	unsigned size;
+} unyaffs2_scan_range_t;
+#endif
+
 #ifdef _HAVE_MMAP
 typedef struct unyaffs2_mmap {
 	unsigned char *addr;
@@ -199,6 +254,27 @@ typedef struct unyaffs2_mmap {
 } unyaffs2_mmap_t;
 #endif
 
+typedef struct unyaffs2_file_job {
+	int fd;
+	struct unyaffs2_obj *obj;
+	char *path;			/* for FMK_INDEX, else NULL */
+} unyaffs2_file_job_t;
+
+/*
+ * -r journal: the header, then the obj_id of each file as it is written.
+ * Image order is kept by the obj tree, so a run killed part way through can
+ * be run again with the journal and skip the files it had written.
+ */
+typedef struct unyaffs2_journal_header {
+	char magic[8];
+	long long image_size;
+	long long image_mtime;
+	unsigned chunksize;
+	unsigned sparesize;
+	unsigned flags;			/* the layout flags */
+	unsigned unused;
+} unyaffs2_journal_header_t;
+
 /*----------------------------------------------------------------------------*/
 
 static unsigned unyaffs2_chunksize = 0;
@@ -208,10 +284,19 @@ static unsigned unyaffs2_flags = 0;
 
 static unsigned unyaffs2_image_objs = 0;
 
+static unsigned unyaffs2_threads = 0;
+
+/* the files are written by tasks of the pool, with a buffer per slot */
+static struct fmk_pool *unyaffs2_pool = NULL;
+static struct fmk_pool_group unyaffs2_writes;
+static unsigned char **unyaffs2_buffers = NULL;
+static int unyaffs2_write_errors = 0;
+
 static unsigned unyaffs2_bufsize = 0;
 static unsigned char *unyaffs2_databuf = NULL;
 
 static int unyaffs2_image_fd = -1;
+static int unyaffs2_journal_fd = -1;
 
 static char unyaffs2_curfile[PATH_MAX + PATH_MAX] = {0};
 static char unyaffs2_linkfile[PATH_MAX + PATH_MAX] = {0};
@@ -231,6 +316,15 @@ static void
 (*unyaffs2_extract_ptags) (struct yaffs_ext_tags *, unsigned char *,
 			   nand_ecclayout_t *, int) = NULL;
 
+struct unyaffs2_scan_tag;
+
+static int
+(*unyaffs2_scan_tags) (unsigned char *, off_t,
+		       struct unyaffs2_scan_tag *) = NULL;
+
+static int
+(*unyaffs2_scan_add) (struct unyaffs2_scan_tag *, unsigned char *) = NULL;
+
 /*----------------------------------------------------------------------------*/
 
 static struct unyaffs2_obj *
@@ -262,6 +356,7 @@ unyaffs2_obj_free (struct unyaffs2_obj *obj)
 	list_del(&obj->siblings);
 	list_del(&obj->hashlist);
 
+	free(obj->chunks);
 	free(obj);
 }
 
@@ -542,9 +637,10 @@ unyaffs2_spare2ptags (unsigned char *tag, unsigned char *spare, size_t bytes,
 	return copied;
 }
 
-static void
-unyaffs2_extract_ptags1 (struct yaffs_ext_tags *t, unsigned char *pt,
-			 nand_ecclayout_t *ecclayout, int ecc)
+static UNYAFFS2_INSTANCE void
+unyaffs2_extract_ptags1_t (struct yaffs_ext_tags *t, unsigned char *pt,
+			   nand_ecclayout_t *ecclayout, int ecc,
+			   const int endian)
 {
 	struct yaffs_packed_tags1 pt1;
 	nand_ecclayout_t *l = ecclayout ? ecclayout : unyaffs2_ecclayout;
@@ -553,15 +649,16 @@ unyaffs2_extract_ptags1 (struct yaffs_ext_tags *t, unsigned char *pt,
 	unyaffs2_spare2ptags((unsigned char *)&pt1, pt,
 			     sizeof(struct yaffs_packed_tags1), l);
 
-	if (UNYAFFS2_ISENDIAN)
+	if (endian)
 		packedtags1_endian_convert(&pt1, 1);
 
 	yaffs_unpack_tags1(t, &pt1);
 }
 
-static void
-unyaffs2_extract_ptags2 (struct yaffs_ext_tags *t, unsigned char *s,
-			 nand_ecclayout_t *ecclayout, int ecc)
+static UNYAFFS2_INSTANCE void
+unyaffs2_extract_ptags2_t (struct yaffs_ext_tags *t, unsigned char *s,
+			   nand_ecclayout_t *ecclayout, int ecc,
+			   const int endian)
 {
 	int result;
 	enum yaffs_ecc_result ecc_result = YAFFS_ECC_RESULT_NO_ERROR;
@@ -574,7 +671,7 @@ unyaffs2_extract_ptags2 (struct yaffs_ext_tags *t, unsigned char *s,
 			     sizeof(struct yaffs_packed_tags2), l);
 
 	if (pt2.t.seq_number != 0xffffffff && ecc) {
-		if (UNYAFFS2_ISENDIAN)
+		if (endian)
 			packedtags2_eccother_endian_convert(&pt2);
 
 		yaffs_ecc_calc_other((unsigned char *)&pt2.t,
@@ -600,7 +697,7 @@ unyaffs2_extract_ptags2 (struct yaffs_ext_tags *t, unsigned char *s,
 		}
 	}
 
-	if (UNYAFFS2_ISENDIAN)
+	if (endian)
 		packedtags2_tagspart_endian_convert(&pt2);
 
 	yaffs_unpack_tags2_tags_only(t, &pt2.t);
@@ -608,17 +705,63 @@ unyaffs2_extract_ptags2 (struct yaffs_ext_tags *t, unsigned char *s,
 	t->ecc_result = ecc_result;
 }
 
+#define UNYAFFS2_EXTRACT_PTAGS(name, layout, endian) \
+static void \
+name (struct yaffs_ext_tags *t, unsigned char *s, \
+      nand_ecclayout_t *ecclayout, int ecc) \
+{ \
+	layout(t, s, ecclayout, ecc, endian); \
+}
+
+UNYAFFS2_EXTRACT_PTAGS(unyaffs2_extract_ptags1, unyaffs2_extract_ptags1_t, 0)
+UNYAFFS2_EXTRACT_PTAGS(unyaffs2_extract_ptags1_swap, unyaffs2_extract_ptags1_t, 1)
+UNYAFFS2_EXTRACT_PTAGS(unyaffs2_extract_ptags2, unyaffs2_extract_ptags2_t, 0)
+UNYAFFS2_EXTRACT_PTAGS(unyaffs2_extract_ptags2_swap, unyaffs2_extract_ptags2_t, 1)
+
 static inline int
 unyaffs2_isempty (unsigned char *buf, unsigned size)
 {
-	while (size--) {
-		if (*buf != 0xff)
+	const unsigned long *word;
+
+	/* a word, four at a time, once buf is aligned */
+	for (; size && ((unsigned long)buf & (sizeof(long) - 1)); size--)
+		if (*buf++ != 0xff)
 			return 0;
-		buf++;
-	}
+
+	word = (const unsigned long *)buf;
+	for (; size >= 4 * sizeof(long); size -= 4 * sizeof(long), word += 4)
+		if (~(word[0] & word[1] & word[2] & word[3]))
+			return 0;
+
+	for (buf = (unsigned char *)word; size; size--)
+		if (*buf++ != 0xff)
+			return 0;
+
 	return 1;
 }
 
+/*
+ * yaffs programs the chunks of an erase block in order, so one whose
+ * first chunk has an erased spare is unused.  the first chunk of every
+ * UNYAFFS2_SAMPLE_CHUNKS chunks is looked at, which holds for erase
+ * blocks of that many chunks or more, and the last one as well.
+ */
+static inline int
+unyaffs2_block_isempty (unsigned char *block)
+{
+	unsigned n;
+
+	for (n = 0; n < UNYAFFS2_BLOCK_CHUNKS; n += UNYAFFS2_SAMPLE_CHUNKS) {
+		if (!unyaffs2_isempty(block + n * unyaffs2_bufsize +
+				      unyaffs2_chunksize, unyaffs2_sparesize))
+			return 0;
+	}
+
+	return unyaffs2_isempty(block + (UNYAFFS2_BLOCK_CHUNKS - 1) *
+				unyaffs2_bufsize + unyaffs2_chunksize,
+				unyaffs2_sparesize);
+}
+
 static inline loff_t
 unyaffs2_extract_oh_size (struct yaffs_obj_hdr *oh)
 {
@@ -828,14 +971,22 @@ unyaffs2_scan_img_status (unsigned status)
 	fflush(stdout);
 }
 
-static int
-unyaffs2_scan_chunk (unsigned char *buffer, off_t offset)
+/*
+ * the tags of a used chunk, which are all the scan keeps of it.
+ */
+static UNYAFFS2_INSTANCE int
+unyaffs2_scan_tags_t (unsigned char *buffer, off_t offset,
+		      struct unyaffs2_scan_tag *st, const int yaffs1,
+		      const int endian)
 {
-	struct yaffs_obj_hdr oh;
 	struct yaffs_ext_tags tag;
-	struct unyaffs2_obj *obj;
 
-	unyaffs2_extract_ptags(&tag, buffer + unyaffs2_chunksize, NULL, 1);
+	if (yaffs1)
+		unyaffs2_extract_ptags1_t(&tag, buffer + unyaffs2_chunksize,
+					  NULL, 1, endian);
+	else
+		unyaffs2_extract_ptags2_t(&tag, buffer + unyaffs2_chunksize,
+					  NULL, 1, endian);
 	if (tag.ecc_result == YAFFS_ECC_RESULT_UNFIXED) {
 		UNYAFFS2_DEBUG("invalid page skipped @ offset %lu\n", offset);
 		return 0;
@@ -849,53 +1000,253 @@ unyaffs2_scan_chunk (unsigned char *buffer, off_t offset)
 		return 0;
 	}
 
-	if (tag.chunk_id == 0) {
+	st->obj_id = tag.obj_id;
+	st->chunk_id = tag.chunk_id;
+	/* yaffs1 tags have no sequence number, the image order decides */
+	st->seq_number = yaffs1 ? 0 : tag.seq_number;
+	st->n_bytes = tag.n_bytes;
+	st->offset = offset;
+
+	return 1;
+}
+
+#define UNYAFFS2_SCAN_TAGS(name, yaffs1, endian) \
+static int \
+name (unsigned char *buffer, off_t offset, struct unyaffs2_scan_tag *st) \
+{ \
+	return unyaffs2_scan_tags_t(buffer, offset, st, yaffs1, endian); \
+}
+
+UNYAFFS2_SCAN_TAGS(unyaffs2_scan_tags1, 1, 0)
+UNYAFFS2_SCAN_TAGS(unyaffs2_scan_tags1_swap, 1, 1)
+UNYAFFS2_SCAN_TAGS(unyaffs2_scan_tags2, 0, 0)
+UNYAFFS2_SCAN_TAGS(unyaffs2_scan_tags2_swap, 0, 1)
+
+/*
+ * the chunk with the highest sequence number wins, as in the yaffs2 scan.
+ * of equal ones, the first header and the last data chunk in the image
+ * win, as they did before there were sequence numbers to look at.  data
+ * chunks are only listed here and sorted out when the file is written.
+ * a header in the local byte order is read where it is in the chunk.
+ */
+static UNYAFFS2_INSTANCE int
+unyaffs2_scan_add_t (struct unyaffs2_scan_tag *st, unsigned char *buffer,
+		     const int endian)
+{
+	struct yaffs_obj_hdr swapped, *oh;
+	struct unyaffs2_obj *obj;
+
+	obj = unyaffs2_objtable_find_alloc(st->obj_id);
+	if (obj == NULL) {
+		UNYAFFS2_ERROR("cannot allocate memory ");
+		UNYAFFS2_ERROR("for object %u\n", st->obj_id);
+		return -1;
+	}
+
+	if (st->chunk_id == 0) {
 	/* a new object */
-		obj = unyaffs2_objtable_find_alloc(tag.obj_id);
-		if (obj == NULL) {
-			UNYAFFS2_ERROR("cannot allocate memory ");
-			UNYAFFS2_ERROR("for object %u\n", tag.obj_id);
+		if (obj->valid && st->seq_number <= obj->hdr_seq) {
+			UNYAFFS2_DEBUG("skip duplicated object %u\n",
+				       st->obj_id);
 			return -1;
 		}
 
-		if (obj->valid) {
-			UNYAFFS2_DEBUG("skip duplicated object %u\n",
-				       tag.obj_id);
-			return -1;
+		if (obj->valid && obj->type == YAFFS_OBJECT_TYPE_SYMLINK &&
+		    obj->variant.symlink.alias != NULL) {
+			free(obj->variant.symlink.alias);
+			obj->variant.symlink.alias = NULL;
 		}
 
-		memcpy(&oh, unyaffs2_databuf, sizeof(struct yaffs_obj_hdr));
-		if (UNYAFFS2_ISENDIAN)
-			oh_endian_convert(&oh);
+		if (endian) {
+			memcpy(&swapped, buffer, sizeof(struct yaffs_obj_hdr));
+			oh_endian_convert(&swapped);
+			oh = &swapped;
+		}
+		else
+			oh = (struct yaffs_obj_hdr *)buffer;
 
 		/* extract oh to obj */
-		unyaffs2_oh2obj(obj, &oh);
-		obj->obj_id = tag.obj_id;
-		obj->hdr_off = offset;
-		obj->valid = 1;
+		unyaffs2_oh2obj(obj, oh);
+		obj->obj_id = st->obj_id;
+		obj->hdr_off = st->offset;
+		obj->hdr_seq = st->seq_number;
 
-		unyaffs2_image_objs++;
+		if (!obj->valid)
+			unyaffs2_image_objs++;
+		obj->valid = 1;
 	}
-	else if (tag.chunk_id == 1) {
-	/* the first data chunk of a object */
-		obj = unyaffs2_objtable_find_alloc(tag.obj_id);
-		if (obj == NULL) {
-			UNYAFFS2_ERROR("cannot allocate memory ");
-			UNYAFFS2_ERROR("for object %u\n", tag.obj_id);
-			return -1;
+	else {
+	/* a data chunk of a object */
+		if (obj->nchunks == obj->chunks_size) {
+			struct unyaffs2_chunk *chunks;
+			unsigned size = obj->chunks_size ?
+					obj->chunks_size * 2 : 16;
+
+			chunks = realloc(obj->chunks, size *
+					 sizeof(struct unyaffs2_chunk));
+			if (chunks == NULL) {
+				UNYAFFS2_ERROR("cannot allocate memory ");
+				UNYAFFS2_ERROR("for object %u\n", st->obj_id);
+				return -1;
+			}
+			obj->chunks = chunks;
+			obj->chunks_size = size;
 		}
 
-		obj->type = YAFFS_OBJECT_TYPE_FILE;
-		obj->variant.file.file_head = offset;
+		obj->chunks[obj->nchunks].chunk_id = st->chunk_id;
+		obj->chunks[obj->nchunks].seq_number = st->seq_number;
+		obj->chunks[obj->nchunks].n_bytes = st->n_bytes;
+		obj->chunks[obj->nchunks].offset = st->offset;
+		obj->nchunks++;
+
+		if (st->chunk_id == 1)
+			obj->type = YAFFS_OBJECT_TYPE_FILE;
 	}
 
 	return 0;
 }
 
+static int
+unyaffs2_scan_add_local (struct unyaffs2_scan_tag *st, unsigned char *buffer)
+{
+	return unyaffs2_scan_add_t(st, buffer, 0);
+}
+
+static int
+unyaffs2_scan_add_swap (struct unyaffs2_scan_tag *st, unsigned char *buffer)
+{
+	return unyaffs2_scan_add_t(st, buffer, 1);
+}
+
+static int
+unyaffs2_scan_chunk (unsigned char *buffer, off_t offset)
+{
+	struct unyaffs2_scan_tag st;
+
+	if (!unyaffs2_scan_tags(buffer, offset, &st))
+		return 0;
+
+	return unyaffs2_scan_add(&st, buffer);
+}
+
+#ifdef _HAVE_MMAP
+/*
+ * the tags of a run of erase blocks, parsed in place by one task.
+ */
+static void
+unyaffs2_scan_part (void *arg)
+{
+	struct unyaffs2_scan_range *t = arg;
+	struct unyaffs2_scan_tag *tags;
+	unsigned char *chunk;
+	off_t offset, block = UNYAFFS2_BLOCK_CHUNKS * unyaffs2_bufsize;
+
+	for (offset = t->start; offset < t->end;
+	     offset += unyaffs2_bufsize) {
+		chunk = unyaffs2_mmapinfo.addr + offset;
+		if ((offset / unyaffs2_bufsize) % UNYAFFS2_BLOCK_CHUNKS == 0 &&
+		    t->end - offset >= block && unyaffs2_block_isempty(chunk)) {
+			offset += block - unyaffs2_bufsize;
+			continue;
+		}
+
+		if (offset + unyaffs2_bufsize < t->end)
+			UNYAFFS2_PREFETCH(chunk + unyaffs2_bufsize +
+					  unyaffs2_chunksize);
+
+		if (unyaffs2_isempty(chunk + unyaffs2_chunksize,
+				     unyaffs2_sparesize))
+			continue;
+
+		if (t->ntags == t->size) {
+			t->size = t->size ? t->size * 2 : 256;
+			tags = realloc(t->tags, t->size *
+				       sizeof(struct unyaffs2_scan_tag));
+			if (tags == NULL) {
+				t->error = -1;
+				return;
+			}
+			t->tags = tags;
+		}
+
+		t->ntags += unyaffs2_scan_tags(chunk, offset,
+					       &t->tags[t->ntags]);
+	}
+}
+
+/*
+ * the erase blocks are split into several runs per thread, which the
+ * tasks of the pool scan as they are free, each keeping the tags it
+ * finds; they are merged into the object table afterwards in image order,
+ * so the result is the same as that of a single pass.
+ */
+static int
+unyaffs2_scan_img_threads (off_t chunks)
+{
+	struct unyaffs2_scan_range *range;
+	struct fmk_pool_group group;
+	off_t blocks, per_range;
+	unsigned n, i, ranges = unyaffs2_threads * UNYAFFS2_SCAN_PARTS;
+	int retval = 0;
+
+	blocks = (chunks + UNYAFFS2_BLOCK_CHUNKS - 1) / UNYAFFS2_BLOCK_CHUNKS;
+	if (ranges > blocks)
+		ranges = blocks;
+
+	range = calloc(ranges, sizeof(struct unyaffs2_scan_range));
+	if (range == NULL) {
+		UNYAFFS2_ERROR("cannot allocate memory for scan ranges\n");
+		return -1;
+	}
+
+	fmk_pool_group_init(&group, fmk_pool_get(unyaffs2_threads));
+	per_range = (blocks + ranges - 1) / ranges;
+	for (n = 0; n < ranges; n++) {
+		range[n].start = MIN(n * per_range * UNYAFFS2_BLOCK_CHUNKS,
+				     chunks) * unyaffs2_bufsize;
+		range[n].end = MIN((n + 1) * per_range *
+				   UNYAFFS2_BLOCK_CHUNKS, chunks) *
+			       unyaffs2_bufsize;
+		fmk_pool_submit(&group, unyaffs2_scan_part, &range[n],
+				FMK_POOL_NORMAL);
+	}
+	fmk_pool_wait(&group, 0);
+
+	for (n = 0; n < ranges; n++) {
+		if (range[n].error) {
+			UNYAFFS2_ERROR("cannot allocate memory for tags\n");
+			retval = -1;
+			break;
+		}
+	}
+
+	for (n = 0; n < ranges && !retval; n++)
+		for (i = 0; i < range[n].ntags; i++)
+			unyaffs2_scan_add(&range[n].tags[i],
+					  unyaffs2_mmapinfo.addr +
+					  range[n].tags[i].offset);
+
+	for (n = 0; n < ranges; n++)
+		free(range[n].tags);
+	free(range);
+
+	return retval;
+}
+#endif
+
+/*
+ * chunks whose spare is erased carry no tags, whatever their data, so
+ * only the spare is looked at before the tags are parsed from it, and
+ * erase blocks that are unused are passed over whole.
+ */
 static int
 unyaffs2_scan_img (void)
 {
-#ifndef _HAVE_MMAP
+#ifdef _HAVE_MMAP
+	unsigned char *chunk;
+	off_t block = UNYAFFS2_BLOCK_CHUNKS * unyaffs2_bufsize;
+	int retval;
+#else
 	ssize_t reads;
 #endif
 	off_t offset = 0, remains = 0;
@@ -910,15 +1261,42 @@ unyaffs2_scan_img (void)
 		UNYAFFS2_DEBUG("NULL mmap address.\n");
 		return 0;
 	}
-#endif
 
-#ifdef _HAVE_MMAP
+	/* scanned in place, once through */
+	madvise(unyaffs2_mmapinfo.addr, unyaffs2_mmapinfo.size,
+		MADV_SEQUENTIAL);
+
 	remains = unyaffs2_mmapinfo.size;
-	while (offset < unyaffs2_mmapinfo.size && remains >= unyaffs2_bufsize &&
-	       memcpy(unyaffs2_databuf,
-		      unyaffs2_mmapinfo.addr + offset, unyaffs2_bufsize)) {
-		if (memcmp(unyaffs2_databuf, 
-		    unyaffs2_mmapinfo.addr + offset, unyaffs2_bufsize)) {
+	if (unyaffs2_threads > 1) {
+		retval = unyaffs2_scan_img_threads(remains / unyaffs2_bufsize);
+		madvise(unyaffs2_mmapinfo.addr, unyaffs2_mmapinfo.size,
+			MADV_NORMAL);
+		return retval;
+	}
+
+	while (remains >= unyaffs2_bufsize) {
+		chunk = unyaffs2_mmapinfo.addr + offset;
+		if ((offset / unyaffs2_bufsize) % UNYAFFS2_BLOCK_CHUNKS == 0 &&
+		    remains >= block && unyaffs2_block_isempty(chunk)) {
+			offset += block;
+			remains -= block;
+			continue;
+		}
+
+		if (remains >= unyaffs2_bufsize * 2)
+			UNYAFFS2_PREFETCH(chunk + unyaffs2_bufsize +
+					  unyaffs2_chunksize);
+
+		if (!unyaffs2_isempty(chunk + unyaffs2_chunksize,
+				      unyaffs2_sparesize))
+			unyaffs2_scan_chunk(chunk, offset);
+
+		offset += unyaffs2_bufsize;
+		remains -= unyaffs2_bufsize;
+	}
+
+	/* the objects are extracted in any order */
+	madvise(unyaffs2_mmapinfo.addr, unyaffs2_mmapinfo.size, MADV_NORMAL);
 #else
 	remains = lseek(unyaffs2_image_fd, 0, SEEK_END);
 	offset = lseek(unyaffs2_image_fd, 0, SEEK_SET);
@@ -926,19 +1304,20 @@ unyaffs2_scan_img (void)
 	       (reads = safe_read(unyaffs2_image_fd,
 		unyaffs2_databuf, unyaffs2_bufsize)) != 0) {
 		if (reads != unyaffs2_bufsize) {
-#endif
 			/* parse image failed */
 			UNYAFFS2_ERROR("read image failed @ offset %lu.",
 					offset);
 			return -1;
 		}
 
-		if (!unyaffs2_isempty(unyaffs2_databuf, unyaffs2_bufsize))
+		if (!unyaffs2_isempty(unyaffs2_databuf + unyaffs2_chunksize,
+				      unyaffs2_sparesize))
 			unyaffs2_scan_chunk(unyaffs2_databuf, offset);
 
 		offset += unyaffs2_bufsize;
 		remains -= unyaffs2_bufsize;
 	}
+#endif
 
 	return 0;
 }
@@ -1035,90 +1414,249 @@ unyaffs2_build_objtree (void)
 
 /*----------------------------------------------------------------------------*/
 
-#ifdef _HAVE_MMAP
+/*
+ * files are written from the chunk lists kept by the scan, each chunk
+ * straight to its place in the file, by tasks of the pool (fmkpool.h)
+ * submitted as the tree walk creates the files.
+ */
+
 static int
-unyaffs2_extract_file_mmap (unsigned char *addr, size_t size, const char *fpath,
-			    struct unyaffs2_obj *obj)
+unyaffs2_chunk_cmp (const void *a, const void *b)
 {
-	int outfd;
-	unsigned char *outaddr, *curaddr, *endaddr = addr + size;
-	size_t bufsize = unyaffs2_chunksize + unyaffs2_sparesize;
-	size_t fsize = obj->variant.file.file_size, remains = 0, written = 0;
+	const struct unyaffs2_chunk *c1 = a, *c2 = b;
 
-	struct yaffs_ext_tags tag;
+	if (c1->chunk_id != c2->chunk_id)
+		return c1->chunk_id < c2->chunk_id ? -1 : 1;
+	if (c1->seq_number != c2->seq_number)
+		return c1->seq_number < c2->seq_number ? -1 : 1;
+	return c1->offset < c2->offset ? -1 : c1->offset > c2->offset;
+}
 
-	outfd = open(fpath, O_RDWR | O_CREAT | O_TRUNC, obj->mode);
-	if (outfd < 0) {
-		UNYAFFS2_DEBUG("cannot create file '%s'; %s\n",
-				fpath, strerror(errno));
-		return -1;
+static int
+unyaffs2_journal_load (struct stat *statbuf)
+{
+	off_t size, n = 0, i;
+	unsigned *ids = NULL, files = 0;
+	struct unyaffs2_obj *obj;
+	struct unyaffs2_journal_header hdr, old;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, UNYAFFS2_JOURNAL_MAGIC, sizeof(hdr.magic));
+	hdr.image_size = statbuf->st_size;
+	hdr.image_mtime = statbuf->st_mtime;
+	hdr.chunksize = unyaffs2_chunksize;
+	hdr.sparesize = unyaffs2_sparesize;
+	hdr.flags = unyaffs2_flags & (UNYAFFS2_FLAGS_YAFFS1 |
+		    UNYAFFS2_FLAGS_ENDIAN | UNYAFFS2_FLAGS_YAFFSECC);
+
+	size = lseek(unyaffs2_journal_fd, 0, SEEK_END);
+	if (size >= (off_t)sizeof(hdr) &&
+	    pread(unyaffs2_journal_fd, &old, sizeof(old), 0) == sizeof(old) &&
+	    !memcmp(&old, &hdr, sizeof(hdr))) {
+		n = (size - sizeof(hdr)) / sizeof(unsigned);
+		ids = malloc(n * sizeof(unsigned) + 1);
+		if (ids == NULL ||
+		    pread(unyaffs2_journal_fd, ids, n * sizeof(unsigned),
+			  sizeof(hdr)) != (ssize_t)(n * sizeof(unsigned))) {
+			free(ids);
+			return -1;
+		}
+
+		for (i = 0; i < n; i++) {
+			obj = unyaffs2_objtable_find(ids[i]);
+			if (obj != NULL && !obj->journalled) {
+				obj->journalled = 1;
+				files++;
+			}
+		}
+		free(ids);
+	}
+	else if (size > 0) {
+		UNYAFFS2_WARN("warning: the journal is of another image, "
+			      "starting it afresh.\n");
 	}
 
-	if (fsize == 0)
-		goto out;
+	/* drop an id torn by the kill, then append the ids after it */
+	if (ftruncate(unyaffs2_journal_fd, sizeof(hdr) + n * sizeof(unsigned)) ||
+	    pwrite(unyaffs2_journal_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+	    fcntl(unyaffs2_journal_fd, F_SETFL, O_APPEND) < 0)
+		return -1;
 
-	/* stretch the file */
-	if (lseek(outfd, fsize - 1, SEEK_SET) < 0 ||
-	    safe_write(outfd, "", 1) != 1) {
-		UNYAFFS2_DEBUG("cannot stretch the file '%s': %s\n",
-				fpath, strerror(errno));
-		goto out;
-	}
+	if (files)
+		UNYAFFS2_PRINTF("resuming, %u files were written before.\n",
+				files);
 
-	/* now mmap */
-	outaddr = mmap(NULL, fsize, PROT_WRITE | PROT_READ,
-		       MAP_SHARED, outfd, 0);
-	if (outaddr == MAP_FAILED) {
-		UNYAFFS2_DEBUG("cannot mmap the file '%s': %s\n",
-				fpath, strerror(errno));
-		goto out;
-	}
+	return 0;
+}
 
-	if (obj->variant.file.file_head == ~(off_t)0) {
-		UNYAFFS2_DEBUG("invalid head offset of file  '%s'\n", fpath);
-		goto out;
+static void
+unyaffs2_journal_put (struct unyaffs2_obj *obj)
+{
+	/* appends of an id are atomic, whichever writer makes them */
+	if (unyaffs2_journal_fd >= 0 &&
+	    write(unyaffs2_journal_fd, &obj->obj_id, sizeof(unsigned)) !=
+	    sizeof(unsigned)) {
+		UNYAFFS2_WARN("warning: cannot write the journal: %s\n",
+			      strerror(errno));
 	}
+}
+
+/* hash, for FMK_INDEX, is given the file's data, from the chunks in turn */
+static int
+unyaffs2_write_file (int fd, struct unyaffs2_obj *obj, unsigned char *buf,
+		     struct fmk_index_hash *hash)
+{
+	unsigned n;
+	size_t size;
+	off_t start, pos = 0, fsize = obj->variant.file.file_size;
+	unsigned char *data;
+	struct unyaffs2_chunk *c;
+	long long fmk_start;
 
-	addr += obj->variant.file.file_head;
-	curaddr = outaddr;
-	remains = fsize;
+	FMK_STAGE_BEGIN(write_file, fmk_start);
+	if (ftruncate(fd, fsize) < 0)
+		return -1;
 
-	while (addr < endaddr && remains > 0) {
-		unyaffs2_extract_ptags(&tag, addr + unyaffs2_chunksize,
-				       NULL, 0);
+	qsort(obj->chunks, obj->nchunks, sizeof(struct unyaffs2_chunk),
+	      unyaffs2_chunk_cmp);
 
-		written = remains < tag.n_bytes ? remains : tag.n_bytes;
-		memcpy(curaddr, addr, written);
-		if (memcmp(curaddr, addr, written)) {
-			UNYAFFS2_DEBUG("copy file failed '%s': %s\n",
-					fpath, strerror(errno));
+	for (n = 0; n < obj->nchunks; n++) {
+		c = &obj->chunks[n];
+
+		/* of the same chunk, the one sorted last wins */
+		if (n + 1 < obj->nchunks &&
+		    obj->chunks[n + 1].chunk_id == c->chunk_id)
+			continue;
+
+		start = (off_t)(c->chunk_id - 1) * unyaffs2_chunksize;
+		if (start >= fsize)
 			break;
+
+		size = MIN(c->n_bytes, unyaffs2_chunksize);
+		size = MIN(size, fsize - start);
+#ifdef _HAVE_MMAP
+		data = unyaffs2_mmapinfo.addr + c->offset;
+#else
+		if (pread(unyaffs2_image_fd, buf, size, c->offset) != (ssize_t)size)
+			return -1;
+		data = buf;
+#endif
+		if (pwrite(fd, data, size, start) != (ssize_t)size)
+			return -1;
+
+		if (hash) {
+			/* chunks missing or short read as ftruncate()'s zeros */
+			fmk_index_zeros(hash, start - pos);
+			fmk_index_data(hash, data, size);
+			pos = start + size;
 		}
+	}
+	FMK_STAGE_END(write_file, fmk_start, fsize, fsize);
+
+	if (hash)
+		fmk_index_zeros(hash, fsize - pos);
 
-		remains -= written;
-		curaddr += written;
-		addr += bufsize;
+	return 0;
+}
+
+static void
+unyaffs2_write_task (void *arg)
+{
+	struct unyaffs2_file_job *job = arg;
+	struct fmk_index_hash hash;
+	unsigned char *buf = unyaffs2_buffers[fmk_pool_slot(unyaffs2_pool)];
+
+	if (job->path)
+		fmk_index_start(&hash);
+
+	if (unyaffs2_write_file(job->fd, job->obj, buf,
+				job->path ? &hash : NULL) < 0) {
+		__sync_add_and_fetch(&unyaffs2_write_errors, 1);
+		close(job->fd);
 	}
+	else if (close(job->fd) == 0) {
+		unyaffs2_journal_put(job->obj);
+		if (job->path)
+			fmk_index_add(&hash, job->path,
+				      job->obj->variant.file.file_size,
+				      job->obj->mode);
+	}
+
+	free(job->path);
+	free(job);
+}
 
-	munmap(outaddr, fsize);
-out:
-	close(outfd);
+static void
+unyaffs2_writers_start (void)
+{
+	unsigned n, slots;
+
+	if (unyaffs2_threads <= 1)
+		return;
+
+	unyaffs2_pool = fmk_pool_get(unyaffs2_threads);
+	if (fmk_pool_size(unyaffs2_pool) == 0)
+		return;
+
+	/* the workers', and that of the thread walking the tree */
+	slots = fmk_pool_size(unyaffs2_pool) + 1;
+	unyaffs2_buffers = calloc(slots, sizeof(unsigned char *));
+	if (unyaffs2_buffers == NULL)
+		return;
 
-	return !(remains == 0);
+	for (n = 0; n < slots; n++) {
+		unyaffs2_buffers[n] = malloc(unyaffs2_chunksize);
+		if (unyaffs2_buffers[n] == NULL) {
+			while (n--)
+				free(unyaffs2_buffers[n]);
+			free(unyaffs2_buffers);
+			unyaffs2_buffers = NULL;
+			return;
+		}
+	}
+
+	fmk_pool_group_init(&unyaffs2_writes, unyaffs2_pool);
 }
-#else
+
 static int
-unyaffs2_extract_file (const int fd, const char *fpath,
-		       struct unyaffs2_obj *obj)
+unyaffs2_writers_stop (void)
 {
-	int outfd;
-	size_t written = 0, size = obj->variant.file.file_size;
-	ssize_t w, r;
+	unsigned n;
 
-	struct yaffs_ext_tags tag;
+	if (unyaffs2_buffers == NULL)
+		return 0;
+
+	fmk_pool_wait(&unyaffs2_writes, 0);
+
+	for (n = 0; n <= (unsigned)fmk_pool_size(unyaffs2_pool); n++)
+		free(unyaffs2_buffers[n]);
+	free(unyaffs2_buffers);
+	unyaffs2_buffers = NULL;
 
-	if (obj->type != YAFFS_OBJECT_TYPE_FILE)
+	if (unyaffs2_write_errors)
+		UNYAFFS2_ERROR("writing %d files failed.\n",
+			       unyaffs2_write_errors);
+
+	return unyaffs2_write_errors ? -1 : 0;
+}
+
+static int
+unyaffs2_extract_file (const char *fpath, struct unyaffs2_obj *obj)
+{
+	int outfd, retval;
+	struct stat statbuf;
+	struct fmk_index_hash hash;
+	struct unyaffs2_file_job *job;
+
+	/* written whole by an earlier run, if it's still there */
+	if (obj->journalled && lstat(fpath, &statbuf) == 0 &&
+	    S_ISREG(statbuf.st_mode) &&
+	    statbuf.st_size == obj->variant.file.file_size) {
+		if (fmk_index)
+			fmk_index_file(fpath, fpath, statbuf.st_size,
+				       obj->mode);
 		return 0;
+	}
 
 	outfd = open(fpath, O_WRONLY | O_CREAT | O_TRUNC, obj->mode);
 	if (outfd < 0) {
@@ -1127,42 +1665,35 @@ unyaffs2_extract_file (const int fd, const char *fpath,
 		return -1;
 	}
 
-	if (obj->variant.file.file_head == ~(off_t)0) {
-		UNYAFFS2_DEBUG("invalid head offset of file  '%s'\n", fpath);
-		goto out;
-	}
-
-	lseek(fd, obj->variant.file.file_head, SEEK_SET);
-
-	/* read image until the size is reached */
-	while (written < size &&
-	       (r = safe_read(fd, unyaffs2_databuf, unyaffs2_bufsize)) != 0)
-	{
-		if (r != unyaffs2_bufsize) {
-			UNYAFFS2_DEBUG("read image failed '%s': %s\n",
+	if (unyaffs2_buffers == NULL ||
+	    (job = malloc(sizeof(struct unyaffs2_file_job))) == NULL) {
+		if (fmk_index)
+			fmk_index_start(&hash);
+		retval = unyaffs2_write_file(outfd, obj, unyaffs2_databuf,
+					     fmk_index ? &hash : NULL);
+		if (retval)
+			UNYAFFS2_DEBUG("write file failed '%s': %s\n",
 					fpath, strerror(errno));
-			break;
+		if (close(outfd) == 0 && retval == 0) {
+			unyaffs2_journal_put(obj);
+			if (fmk_index)
+				fmk_index_add(&hash, fpath,
+					      obj->variant.file.file_size,
+					      obj->mode);
 		}
-
-		unyaffs2_extract_ptags(&tag,
-				       unyaffs2_databuf + unyaffs2_chunksize,
-				       NULL, 0);
-
-		w = safe_write(outfd, unyaffs2_databuf, tag.n_bytes);
-		if (w != tag.n_bytes) {
-			UNYAFFS2_DEBUG("write file failed '%s': %s",
-					fpath, strerror(errno));
-			break;
-		}
-
-		written += tag.n_bytes;
+		return retval;
 	}
 
-	close(outfd);
+	/* at most UNYAFFS2_QUEUE_SIZE files are left open, waiting */
+	job->fd = outfd;
+	job->obj = obj;
+	job->path = fmk_index ? strdup(fpath) : NULL;
+	fmk_pool_submit(&unyaffs2_writes, unyaffs2_write_task, job,
+			FMK_POOL_NORMAL);
+	fmk_pool_wait(&unyaffs2_writes, UNYAFFS2_QUEUE_SIZE);
 
-	return !(written == size);
+	return 0;
 }
-#endif
 
 static int unyaffs2_extract_obj (const char *fpath, struct unyaffs2_obj *obj);
 
@@ -1232,6 +1763,9 @@ unyaffs2_extract_hardlink (const char *fpath, struct unyaffs2_obj *obj)
 
 	switch (obj->type) {
 	case YAFFS_OBJECT_TYPE_FILE:
+		obj->chunks = equiv->chunks;
+		obj->nchunks = equiv->nchunks;
+		/* fall through */
 	case YAFFS_OBJECT_TYPE_SYMLINK:
 	case YAFFS_OBJECT_TYPE_CHR:
 	case YAFFS_OBJECT_TYPE_BLK:
@@ -1254,9 +1788,15 @@ unyaffs2_extract_hardlink (const char *fpath, struct unyaffs2_obj *obj)
 		UNYAFFS2_DEBUG("extract file content failed, restore it\n");
 		obj->type = YAFFS_OBJECT_TYPE_HARDLINK;
 		memcpy(&obj->variant, &variant, sizeof(variant));
+		obj->chunks = NULL;
+		obj->nchunks = 0;
 		unlink(fpath);
 	}
 	else {
+		if (obj->chunks == equiv->chunks) {
+			equiv->chunks = NULL;
+			equiv->nchunks = 0;
+		}
 		equiv->type = YAFFS_OBJECT_TYPE_HARDLINK;
 		memset(&equiv->variant, 0, sizeof(equiv->variant));
 		equiv->variant.hardlink.equiv_obj = obj;
@@ -1272,15 +1812,7 @@ unyaffs2_extract_obj (const char *fpath, struct unyaffs2_obj *obj)
 
 	switch (obj->type) {
 	case YAFFS_OBJECT_TYPE_FILE:
-		retval =
-#ifdef _HAVE_MMAP
-		unyaffs2_extract_file_mmap(unyaffs2_mmapinfo.addr,
-					   unyaffs2_mmapinfo.size,
-					   fpath, obj);
-#else
-		unyaffs2_extract_file(unyaffs2_image_fd,
-				      fpath, obj);
-#endif
+		retval = unyaffs2_extract_file(fpath, obj);
 		break;
 	case YAFFS_OBJECT_TYPE_DIRECTORY:
 		retval = unyaffs2_mkdir(fpath, 0755);
@@ -1299,6 +1831,9 @@ unyaffs2_extract_obj (const char *fpath, struct unyaffs2_obj *obj)
 	case YAFFS_OBJECT_TYPE_BLK:
 	case YAFFS_OBJECT_TYPE_FIFO:
 	case YAFFS_OBJECT_TYPE_SOCK:
+		/* left by the run a journal is resuming */
+		if (unyaffs2_journal_fd >= 0)
+			unlink(fpath);
 		retval = mknod(fpath, obj->mode,
 			       obj->variant.dev.rdev);
 		break;
@@ -1481,12 +2016,55 @@ unyaffs2_load_spare (const char *oobfile)
 
 /*----------------------------------------------------------------------------*/
 
+/* take the page size, spare size, oob layout and byte order of a dump */
+static int
+unyaffs2_probe_image (const char *imgfile)
+{
+	int fd, retval;
+	struct nand_probe probe;
+
+	if ((fd = open(imgfile, O_RDONLY)) < 0)
+		return -1;
+
+	retval = nand_probe(fd, &probe);
+	close(fd);
+
+	if (retval < 0) {
+		UNYAFFS2_WARN("warning: cannot probe the image geometry, "
+			      "trying the defaults.\n");
+		return -1;
+	}
+
+	unyaffs2_chunksize = probe.chunksize;
+	if (!unyaffs2_sparesize)
+		unyaffs2_sparesize = probe.sparesize;
+
+	if (probe.flags & NAND_PROBE_ENDIAN)
+		unyaffs2_flags |= UNYAFFS2_FLAGS_ENDIAN;
+	else
+		unyaffs2_flags &= ~UNYAFFS2_FLAGS_ENDIAN;
+
+	nand_oob_user = probe.layout;
+	unyaffs2_ecclayout = &nand_oob_user;
+
+	UNYAFFS2_PRINTF("probed: %u bytes pages, %u bytes spares, %s, "
+			"%s byte order (%u of %u sampled pages)\n",
+			probe.chunksize, probe.sparesize, probe.layout_name,
+			probe.flags & NAND_PROBE_ENDIAN ? "other" : "local",
+			probe.valid, probe.used);
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
 static int
 unyaffs2_extract_image (const char *imgfile, const char *dirpath)
 {
 	int retval = -1;
 	struct stat statbuf;
 	struct unyaffs2_obj *root;
+	long long fmk_start;
 
 	unyaffs2_image_fd = open(imgfile, O_RDONLY);
 	if (unyaffs2_image_fd < 0) {
@@ -1546,8 +2124,10 @@ unyaffs2_extract_image (const char *imgfile, const char *dirpath)
 	UNYAFFS2_PRINTF("\n");
 	UNYAFFS2_PRINTF("scanning image '%s'... [*]", imgfile);
 
+	FMK_STAGE_BEGIN(scan, fmk_start);
 	if (unyaffs2_scan_img() < 0)
 		goto exit_and_out;
+	FMK_STAGE_END(scan, fmk_start, statbuf.st_size, unyaffs2_image_objs);
 
 	UNYAFFS2_PRINTF("\b\b\b[done]\nscanning complete, total objects: %d\n",
 			unyaffs2_image_objs);
@@ -1563,6 +2143,12 @@ unyaffs2_extract_image (const char *imgfile, const char *dirpath)
 	UNYAFFS2_PRINTF("building complete, total objects: %d\n",
 			unyaffs2_objtree.objs);
 
+	if (unyaffs2_journal_fd >= 0 && unyaffs2_journal_load(&statbuf) < 0) {
+		UNYAFFS2_ERROR("cannot read or write the journal: %s\n",
+			       strerror(errno));
+		goto exit_and_out;
+	}
+
 	/* stage 2: extracting image */
 	UNYAFFS2_PRINTF("\n");
 	UNYAFFS2_PRINTF("extracting image into '%s'\n", dirpath);
@@ -1572,7 +2158,10 @@ unyaffs2_extract_image (const char *imgfile, const char *dirpath)
 
 	/* extract objs in the obj tree */
 	memset(unyaffs2_curfile, 0, sizeof(unyaffs2_curfile));
+	unyaffs2_writers_start();
 	retval = unyaffs2_extract_objtree(unyaffs2_objtree.root);
+	/* the files must be written before their times are set */
+	retval |= unyaffs2_writers_stop();
 
 	/* modify attr for objects in the objtree */
 	UNYAFFS2_PRINTF("\nmodify files attributes... [*]");
@@ -1622,18 +2211,25 @@ unyaffs2_helper (void)
 	UNYAFFS2_HELP("Usage: unyaffs2 [-h|--help] [-e|--endian] [-v|--verbose]\n"
 		      "                [-p|--pagesize pagesize] [-s|--sparesize sparesize]\n"
 		      "                [-o|--oobimg oobimage] [-f|--fileset file] [--yaffs-ecclayout]\n"
+		      "                [-t|--threads threads] [-r|--resume journal]\n"
 		      "                imgfile dirname\n\n");
 	UNYAFFS2_HELP("Options :\n");
 	UNYAFFS2_HELP("  -h                 display this help message and exit.\n");
 	UNYAFFS2_HELP("  -e                 convert endian differed from local machine.\n");
 	UNYAFFS2_HELP("  -v                 verbose details instead of progress bar.\n");
 	UNYAFFS2_HELP("  -p pagesize        page size of target device.\n"
-		      "                     (512|2048(default)|4096|(8192|16384) bytes)\n");
+		      "                     (512|2048|4096|(8192|16384) bytes; default:\n"
+		      "                     probed with the spare size, oob layout and\n"
+		      "                     endian from the image, else 2048)\n");
 	UNYAFFS2_HELP("  -s sparesize       spare size of target device.\n"
 		      "                     (default: pagesize/32 bytes; max: pagesize)\n");
 	UNYAFFS2_HELP("  -o oobimage        load external oob image file.\n");;
 	UNYAFFS2_HELP("  -f file            extract the specified file selection.\n");;
 	UNYAFFS2_HELP("  --yaffs-ecclayout  use yaffs oob scheme instead of the Linux MTD default.\n");
+	UNYAFFS2_HELP("  -t threads         threads to scan the image and write files with.\n"
+		      "                     (default: the number of processors)\n");
+	UNYAFFS2_HELP("  -r journal         record the files written in the journal, and\n"
+		      "                     skip those it has from a run that was killed.\n");
 
 	return -1;
 }
@@ -1645,14 +2241,17 @@ main (int argc, char* argv[])
 {
 	int retval;
 	char *imgfile = NULL, *dirpath = NULL, *oobfile = NULL;
+	char *journal = NULL;
 
 	int option, option_index;
-	static const char *short_options = "hvep:s:o:f:";
+	static const char *short_options = "hvep:s:o:f:t:r:";
 	static const struct option long_options[] = {
 		{"pagesize",		required_argument, 	0, 'p'},
 		{"sparesize",		required_argument,	0, 's'},
 		{"oobimg",		required_argument, 	0, 'o'},
 		{"fileset",		required_argument, 	0, 'f'},
+		{"threads",		required_argument, 	0, 't'},
+		{"resume",		required_argument, 	0, 'r'},
 		{"endian",		no_argument, 		0, 'e'},
 		{"verbose",		no_argument,	 	0, 'v'},
 		{"yaffs-ecclayout",	no_argument,	 	0, 'y'},
@@ -1660,7 +2259,7 @@ main (int argc, char* argv[])
 		{NULL,			no_argument,		0, '\0'},
 	};
 
-	unyaffs2_chunksize = DEFAULT_CHUNKSIZE;
+	fmk_stats_init("unyaffs2");
 
 	while ((option = getopt_long(argc, argv, short_options,
 				     long_options, &option_index)) != EOF) 
@@ -1675,6 +2274,12 @@ main (int argc, char* argv[])
 		case 'o':
 			oobfile = optarg;
 			break;
+		case 't':
+			unyaffs2_threads = strtol(optarg, NULL, 10);
+			break;
+		case 'r':
+			journal = optarg;
+			break;
 		case 'f':
 			retval = unyaffs2_specfile_insert(optarg);
 			if (retval) {
@@ -1705,6 +2310,9 @@ main (int argc, char* argv[])
 	imgfile = argv[optind];
 	dirpath = argv[optind + 1];
 
+	if (unyaffs2_threads == 0)
+		unyaffs2_threads = fmk_pool_threads();
+
 	UNYAFFS2_PRINTF("unyaffs2 %s: image extracting tool for YAFFS2.\n",
 			YAFFS2UTILS_VERSION);
 
@@ -1724,13 +2332,18 @@ main (int argc, char* argv[])
 		/* FIXME: verify for the various ecc layout */
 	}
 
+	/* given neither page size nor oob image, probe the dump for them */
+	if (!unyaffs2_chunksize && oobfile == NULL)
+		unyaffs2_probe_image(imgfile);
+
+	if (!unyaffs2_chunksize)
+		unyaffs2_chunksize = DEFAULT_CHUNKSIZE;
+
 	/* validate the page size */
-	unyaffs2_extract_ptags = &unyaffs2_extract_ptags2;
 	switch (unyaffs2_chunksize) {
 	case 512:
 		unyaffs2_flags |= UNYAFFS2_FLAGS_YAFFS1;
-		unyaffs2_extract_ptags = &unyaffs2_extract_ptags1;
-		if (oobfile == NULL)
+		if (unyaffs2_ecclayout == NULL)
 			unyaffs2_ecclayout = &nand_oob_16;
 		break;
 	case 2048:
@@ -1753,6 +2366,22 @@ main (int argc, char* argv[])
 		return -1;
 	}
 
+	/* the tags layout and byte order are known, which decides the scan */
+	if (UNYAFFS2_ISYAFFS1) {
+		unyaffs2_extract_ptags = UNYAFFS2_ISENDIAN ?
+			&unyaffs2_extract_ptags1_swap : &unyaffs2_extract_ptags1;
+		unyaffs2_scan_tags = UNYAFFS2_ISENDIAN ?
+			&unyaffs2_scan_tags1_swap : &unyaffs2_scan_tags1;
+	}
+	else {
+		unyaffs2_extract_ptags = UNYAFFS2_ISENDIAN ?
+			&unyaffs2_extract_ptags2_swap : &unyaffs2_extract_ptags2;
+		unyaffs2_scan_tags = UNYAFFS2_ISENDIAN ?
+			&unyaffs2_scan_tags2_swap : &unyaffs2_scan_tags2;
+	}
+	unyaffs2_scan_add = UNYAFFS2_ISENDIAN ?
+		&unyaffs2_scan_add_swap : &unyaffs2_scan_add_local;
+
 	/* spare size */
 	if (!unyaffs2_sparesize)
 		unyaffs2_sparesize = unyaffs2_chunksize / 32;
@@ -1763,7 +2392,20 @@ main (int argc, char* argv[])
 		return -1;
 	}
 
+	/* opened here, before unyaffs2_extract_image() changes directory */
+	if (journal) {
+		unyaffs2_journal_fd = open(journal, O_RDWR | O_CREAT, 0644);
+		if (unyaffs2_journal_fd < 0) {
+			UNYAFFS2_ERROR("cannot open the journal '%s': %s\n",
+				       journal, strerror(errno));
+			return -1;
+		}
+	}
+
+	fmk_index_init("unyaffs2", imgfile);
 	retval = unyaffs2_extract_image(imgfile, dirpath);
+	if (unyaffs2_journal_fd >= 0)
+		close(unyaffs2_journal_fd);
 	if (!retval) {
 		UNYAFFS2_PRINTF("\noperation complete,\n"
 				"files were extracted into '%s'.\n", dirpath);
@@ -21,6 +21,8 @@
  *
  */
 
+#include <string.h>
+
 #include "yaffs_utils.h"
 #include "yaffs_ecc.h"
 #include "yaffs_hweight.h"
@@ -68,7 +70,23 @@ static const unsigned char column_parity_table[] = {
 };
 
 
-/* Calculate the ECC for a 256-byte block of data */
+static inline unsigned yaffs_ecc_parity32(u32 x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return column_parity_table[x & 0xff] & 0x01;
+}
+
+/*
+ * Calculate the ECC for a 256-byte block of data
+ *
+ * The table entries are linear in the byte, so the column parity is that
+ * of all bytes XORed together, and line parity bit n is the parity of
+ * the bytes whose offset has bit n set.  Both are gathered a 32-bit word
+ * at a time: the word XOR gives the column parity and line bits 0 and 1,
+ * and the XORs of the words at offsets with bits 2..7 set give the rest.
+ * Line parity prime is line parity inverted when the block has odd parity.
+ */
 void yaffs_ecc_calc(const unsigned char *data, unsigned char *ecc)
 {
 	unsigned int i;
@@ -76,17 +94,30 @@ void yaffs_ecc_calc(const unsigned char *data, unsigned char *ecc)
 	unsigned char line_parity = 0;
 	unsigned char line_parity_prime = 0;
 	unsigned char t;
-	unsigned char b;
+	unsigned char b[4];
+	u32 w, all = 0, lp[6] = { 0, 0, 0, 0, 0, 0 };
+
+	for (i = 0; i < 64; i++) {
+		memcpy(&w, data + i * 4, 4);
+		all ^= w;
+		lp[0] ^= w & -(u32)(i & 0x01);
+		lp[1] ^= w & -(u32)((i >> 1) & 0x01);
+		lp[2] ^= w & -(u32)((i >> 2) & 0x01);
+		lp[3] ^= w & -(u32)((i >> 3) & 0x01);
+		lp[4] ^= w & -(u32)((i >> 4) & 0x01);
+		lp[5] ^= w & -(u32)((i >> 5) & 0x01);
+	}
 
-	for (i = 0; i < 256; i++) {
-		b = column_parity_table[*data++];
-		col_parity ^= b;
+	/* the bytes of the word XOR in memory order, whatever the host */
+	memcpy(b, &all, 4);
+	col_parity = column_parity_table[b[0] ^ b[1] ^ b[2] ^ b[3]];
 
-		if (b & 0x01) {	/* odd number of bits in the byte */
-			line_parity ^= i;
-			line_parity_prime ^= ~i;
-		}
-	}
+	line_parity = column_parity_table[b[1] ^ b[3]] & 0x01;
+	line_parity |= (column_parity_table[b[2] ^ b[3]] & 0x01) << 1;
+	for (i = 0; i < 6; i++)
+		line_parity |= yaffs_ecc_parity32(lp[i]) << (i + 2);
+
+	line_parity_prime = line_parity ^ ((col_parity & 0x01) ? 0xff : 0);
 
 	ecc[2] = (~col_parity) | 0x03;
 
@@ -130,6 +161,32 @@ void yaffs_ecc_calc(const unsigned char *data, unsigned char *ecc)
 
 }
 
+/*
+ * Calculate the 12-bit ECC of the 8 bytes of yaffs1 packed tags, which is
+ * the XOR of the 1-based positions of all the set bits.  The position
+ * table for each byte is filled once from the bit loop it replaces.
+ */
+unsigned yaffs_ecc_calc_tags1(const unsigned char *tags)
+{
+	static unsigned short table[8][256];
+	static int filled;
+	unsigned i, v, j, ecc = 0;
+
+	if (!filled) {
+		for (i = 0; i < 8; i++)
+			for (v = 0; v < 256; v++)
+				for (j = 0; j < 8; j++)
+					if (v & (1 << j))
+						table[i][v] ^= i * 8 + j + 1;
+		filled = 1;
+	}
+
+	for (i = 0; i < 8; i++)
+		ecc ^= table[i][tags[i]];
+
+	return ecc;
+}
+
 /* Correct the ECC on a 256 byte block of data */
 
 int yaffs_ecc_correct(unsigned char *data, unsigned char *read_ecc,
@@ -36,6 +36,8 @@ void yaffs_ecc_calc(const unsigned char *data, unsigned char *ecc);
 int yaffs_ecc_correct(unsigned char *data, unsigned char *read_ecc,
 		      const unsigned char *test_ecc);
 
+unsigned yaffs_ecc_calc_tags1(const unsigned char *tags);
+
 void yaffs_ecc_calc_other(const unsigned char *data, unsigned n_bytes,
 			  struct yaffs_ecc_other *ecc);
 int yaffs_ecc_correct_other(unsigned char *data, unsigned n_bytes,
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * zbuf.c
+ */
+
+#include <stdio.h>
+
+#include "zbuf.h"
+
+#if defined(ZBUF_LIBDEFLATE)
+
+#include <zlib.h>
+#include <libdeflate.h>
+
+/* One of each per thread, kept for the life of the thread */
+static __thread struct libdeflate_compressor *compressor;
+static __thread int compressor_level;
+static __thread struct libdeflate_decompressor *decompressor;
+
+int zbuf_compress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len, int level)
+{
+	size_t len;
+
+	if (level == Z_DEFAULT_COMPRESSION)
+		level = 6;
+	if (compressor == NULL || compressor_level != level) {
+		if (compressor)
+			libdeflate_free_compressor(compressor);
+		compressor = libdeflate_alloc_compressor(level);
+		if (compressor == NULL)
+			return Z_MEM_ERROR;
+		compressor_level = level;
+	}
+
+	len = libdeflate_zlib_compress(compressor, src, src_len, dest,
+		*dest_len);
+	if (len == 0)
+		return Z_BUF_ERROR;
+	*dest_len = len;
+	return Z_OK;
+}
+
+int zbuf_uncompress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len)
+{
+	size_t len;
+
+	if (decompressor == NULL) {
+		decompressor = libdeflate_alloc_decompressor();
+		if (decompressor == NULL)
+			return Z_MEM_ERROR;
+	}
+
+	switch (libdeflate_zlib_decompress(decompressor, src, src_len, dest,
+			*dest_len, &len)) {
+	case LIBDEFLATE_SUCCESS:
+		*dest_len = len;
+		return Z_OK;
+	case LIBDEFLATE_INSUFFICIENT_SPACE:
+		return Z_BUF_ERROR;
+	default:
+		return Z_DATA_ERROR;
+	}
+}
+
+const char *zbuf_backend(void)
+{
+	return "libdeflate " LIBDEFLATE_VERSION_STRING;
+}
+
+#elif defined(ZBUF_ZLIB_NG)
+
+/* zlib-ng's own API, which links alongside zlib as its names are zng_ */
+#include <zlib-ng.h>
+
+int zbuf_compress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len, int level)
+{
+	size_t len = *dest_len;
+	int err;
+
+	err = zng_compress2(dest, &len, src, src_len, level);
+	*dest_len = len;
+	return err;
+}
+
+int zbuf_uncompress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len)
+{
+	size_t len = *dest_len;
+	int err;
+
+	err = zng_uncompress(dest, &len, src, src_len);
+	*dest_len = len;
+	return err;
+}
+
+const char *zbuf_backend(void)
+{
+	static char name[32];
+
+	snprintf(name, sizeof(name), "zlib-ng %s", zlibng_version());
+	return name;
+}
+
+#else
+
+#include <string.h>
+#include <zlib.h>
+
+/*
+ * One of each per thread, kept for the life of the thread and reset for
+ * every buffer, rather than set up again as compress2() and uncompress()
+ * do.  deflateInit() makes the same stream compress2() does, so the
+ * output is the same.
+ */
+static __thread z_stream deflate_stream, inflate_stream;
+static __thread int deflate_level, deflate_ready, inflate_ready;
+
+int zbuf_compress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len, int level)
+{
+	int err;
+
+	if (deflate_ready && deflate_level != level) {
+		deflateEnd(&deflate_stream);
+		deflate_ready = 0;
+	}
+	if (!deflate_ready) {
+		memset(&deflate_stream, 0, sizeof(deflate_stream));
+		err = deflateInit(&deflate_stream, level);
+		if (err != Z_OK)
+			return err;
+		deflate_level = level;
+		deflate_ready = 1;
+	} else
+		deflateReset(&deflate_stream);
+
+	deflate_stream.next_in = (Bytef *) src;
+	deflate_stream.avail_in = src_len;
+	deflate_stream.next_out = dest;
+	deflate_stream.avail_out = *dest_len;
+
+	err = deflate(&deflate_stream, Z_FINISH);
+	if (err != Z_STREAM_END)
+		return err == Z_OK ? Z_BUF_ERROR : err;
+	*dest_len = deflate_stream.total_out;
+	return Z_OK;
+}
+
+int zbuf_uncompress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len)
+{
+	int err;
+
+	if (!inflate_ready) {
+		memset(&inflate_stream, 0, sizeof(inflate_stream));
+		err = inflateInit(&inflate_stream);
+		if (err != Z_OK)
+			return err;
+		inflate_ready = 1;
+	} else
+		inflateReset(&inflate_stream);
+
+	inflate_stream.next_in = (Bytef *) src;
+	inflate_stream.avail_in = src_len;
+	inflate_stream.next_out = dest;
+	inflate_stream.avail_out = *dest_len;
+
+	err = inflate(&inflate_stream, Z_FINISH);
+	if (err == Z_STREAM_END) {
+		*dest_len = inflate_stream.total_out;
+		return Z_OK;
+	}
+
+	/* report the same code uncompress() would */
+	if (err == Z_NEED_DICT || ((err == Z_OK || err == Z_BUF_ERROR) &&
+			inflate_stream.avail_out))
+		return Z_DATA_ERROR;
+	return err == Z_OK ? Z_BUF_ERROR : err;
+}
+
+const char *zbuf_backend(void)
+{
+	static char name[32];
+
+	snprintf(name, sizeof(name), "zlib %s", zlibVersion());
+	return name;
+}
+
+#endif
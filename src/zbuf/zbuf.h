@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2011
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * zbuf.h
+ */
+
+#ifndef ZBUF_H
+#define ZBUF_H
+
+/*
+ * Whole buffer zlib format (RFC 1950) compression, through the zlib,
+ * zlib-ng or libdeflate backend picked at build time (see zbuf.mk).
+ * Both return a zlib Z_ code, and take and give back lengths as
+ * compress2() and uncompress() do.  Preset dictionaries still need
+ * zlib's z_stream, which the callers keep for that case.
+ */
+extern int zbuf_compress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len, int level);
+extern int zbuf_uncompress(void *dest, unsigned long *dest_len,
+	const void *src, unsigned long src_len);
+
+/* The backend and its version, e.g. "libdeflate 1.19", for -v output */
+extern const char *zbuf_backend(void);
+
+#endif
@@ -0,0 +1,26 @@
+# The backend of the whole buffer zlib compression in zbuf.c, used by
+# mkcramfs, cramfsck, uncramfs and the squashfs 4.2 gzip compressor, e.g.
+#	make ZLIB_BACKEND=libdeflate
+# Variables given on the command line reach every sub-make.
+#
+# ZLIB_BACKEND	zlib (the default), zlib-ng for zlib-ng's own API, or
+#		libdeflate.  The images are the same zlib format either
+#		way, though zlib-ng and libdeflate compress to other bytes
+#
+# Makefiles building zbuf.c add ZBUF_FLAGS to its compiler flags and
+# ZBUF_LIBS to the links, ahead of -lz, which they still need.
+
+ZLIB_BACKEND ?= zlib
+
+ZBUF_FLAGS :=
+ZBUF_LIBS :=
+
+ifeq ($(ZLIB_BACKEND),libdeflate)
+ZBUF_FLAGS += -DZBUF_LIBDEFLATE
+ZBUF_LIBS += -ldeflate
+else ifeq ($(ZLIB_BACKEND),zlib-ng)
+ZBUF_FLAGS += -DZBUF_ZLIB_NG
+ZBUF_LIBS += -lz-ng
+else ifneq ($(ZLIB_BACKEND),zlib)
+$(error ZLIB_BACKEND must be zlib, zlib-ng or libdeflate)
+endif
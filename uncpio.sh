@@ -2,11 +2,16 @@
 
 FSIMG="$1"
 ROOTFS="$2"
+PSEUDO="$3"
 ROOTFS_CREATED=0
 
 if [ "$FSIMG" == "" ] || [ "$FSIMG" == "-h" ]
 then
-	echo "Usage: $(basename $0) <cpio archive> [output directory]\n"
+	echo "Usage: $(basename $0) <cpio archive> [output directory] [pseudo file]"
+	echo ""
+	echo "The archive may be compressed with gzip, xz or lzma, as an initramfs is. With a pseudo file,"
+	echo "it is extracted without root, the owners, set-id bits and device nodes going to the pseudo file."
+	echo "src/fmk-cpio -c [-p <pseudo file>] -z <gzip|xz|lzma> <directory> <archive> builds it again."
 	exit 1
 fi
 
@@ -17,6 +22,10 @@ fi
 
 FSIMG=$(readlink -f $FSIMG)
 ROOTFS=$(readlink -f $ROOTFS)
+if [ "$PSEUDO" != "" ]
+then
+	PSEUDO=$(readlink -f "$PSEUDO")
+fi
 
 if [ ! -e $ROOTFS ]
 then
@@ -24,7 +33,11 @@ then
 	ROOTFS_CREATED=1
 fi
 
-cd $ROOTFS && cpio -d -i --no-absolute-filenames < $FSIMG
+# Make sure we're operating out of the FMK directory
+cd $(dirname $(readlink -f $0))
+
+# fmk-cpio decodes a compressed archive as it reads it, and makes nothing outside $ROOTFS
+./src/fmk-cpio -x ${PSEUDO:+-p "$PSEUDO"} "$FSIMG" "$ROOTFS"
 
 if [ "$(ls $ROOTFS)" == "" ] && [ "$ROOTFS_CREATED" == "1" ]
 then
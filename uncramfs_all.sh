@@ -2,17 +2,16 @@
 
 FSIMG="$1"
 ROOTFS="$2"
-ENDIANESS="$3"
 MKFS=""
 
 function finish
 {
-	rm -f "$FSIMG.le"
 	echo "MKFS=\"$MKFS\""
 }
 
 if [ "$FSIMG" == "" ] || [ "$FSIMG" == "-h" ]
 then
+	# The byte order argument is still accepted, but the extractors read it from the superblock
 	echo "Usage: $(basename $0) <cramfs image> [output directory] [-be | -le]\n"
 	exit 1
 fi
@@ -22,14 +21,6 @@ then
 	SUDO="sudo"
 fi
 
-if [ "$ENDIANESS" == "" ]
-then
-	if [ "$(file $FSIMG | grep 'big endian')" != "" ]
-	then
-		ENDIANESS="-be"
-	fi
-fi
-
 if [ "$ROOTFS" == "" ]
 then
 	ROOTFS="./cramfs-root"
@@ -49,17 +40,11 @@ ROOTFS=$(readlink -f $ROOTFS)
 # Make sure we're operating out of the FMK directory
 cd $(dirname $(readlink -f $0))
 
-if [ "$ENDIANESS" == "-be" ]
-then
-	./src/cramfsswap/cramfsswap "$FSIMG" "$FSIMG.le"
-else
-	cp "$FSIMG" "$FSIMG.le"
-fi
-
-if [ -e "$FSIMG.le" ]
+# All of the extractors read images of either byte order as they are
+if [ -e "$FSIMG" ]
 then
 	# Try uncramfs-lzma first. If the LZMA decompression fails, it will exit with an error code.
-	./src/uncramfs-lzma/uncramfs-lzma "$ROOTFS" "$FSIMG.le" 2>/dev/null
+	./src/uncramfs-lzma/uncramfs-lzma "$ROOTFS" "$FSIMG" 2>/dev/null
 	if [ $? -eq 0 ]
 	then
 		nfiles=0
@@ -97,7 +82,7 @@ then
 		fi
 	fi
 
-	./src/cramfs-2.x/cramfsck -x "$ROOTFS" "$FSIMG.le" 2>/dev/null
+	./src/cramfs-2.x/cramfsck -x "$ROOTFS" "$FSIMG" 2>/dev/null
 	if [ $? -eq 0 ]
 	then
 		MKFS="./src/cramfs-2.x/mkcramfs"
@@ -105,7 +90,7 @@ then
 		exit 0
 	fi
 
-	./src/uncramfs/uncramfs "$ROOTFS" "$FSIMG.le" 2>/dev/null
+	./src/uncramfs/uncramfs "$ROOTFS" "$FSIMG" 2>/dev/null
 	if [ $? -eq 0 ]
 	then
 		MKFS="./src/cramfs-2.x/mkcramfs"
@@ -7,6 +7,7 @@ BINDIR=`dirname $0`
 . "$BINDIR/common.inc"
 IMG="$1"
 DIR="$2"
+PSEUDO="$3"
 
 ROOT="./src"
 # should order in ascending version, 
@@ -32,37 +33,32 @@ others/squashfs-3.4-nb4 \
 others/squashfs-4.2-official \
 others/squashfs-4.2 \
 others/squashfs-4.0-lzma \
-others/squashfs-4.0-realtek \
-others/squashfs-hg55x-bin"
+others/squashfs-4.0-realtek"
 TIMEOUT="60"
-MKFS=""
 
-function wait_for_complete()
+# Checks an extraction: something was extracted and, as most systems will
+# have busybox, a /bin/sh there is not an empty file
+function extracted_ok()
 {
-	I=0
-	PNAME="$1"
-
-	while [ $I -lt $TIMEOUT ]
-	do
-		sleep 1
-
-		if [ "$(pgrep $PNAME)" == "" ]
-		then
-			break
-		fi
-
-		((I=$I+1))
-	done
+	if [ ! -d "$1" ] || [ "$(ls "$1")" == "" ]
+	then
+		return 1
+	fi
 
-	if [ "$I" == "$TIMEOUT" ]
+	if [ -e "$1/bin/sh" ] && [ "$(wc -c < "$1/bin/sh")" == "0" ]
 	then
-		kill -9 $(pgrep $PNAME) 2>/dev/null
+		return 1
 	fi
+
+	return 0
 }
 
 if [ "$IMG" == "" ] || [ "$IMG" == "-h" ]
 then
-	echo "Usage: $0 <squashfs image> [output directory]"
+	echo "Usage: $0 <squashfs image> [output directory] [pseudo file]"
+	echo ""
+	echo "With a pseudo file, the image is extracted without root, the owners, set-id bits and"
+	echo "device nodes going to the pseudo file for mksquashfs -pf. Only SquashFS 4.x images can be extracted that way."
 	exit 1
 fi
 
@@ -81,14 +77,91 @@ fi
 
 IMG=$(readlink -f "$IMG")
 DIR=$(readlink -f "$DIR")
+if [ "$PSEUDO" != "" ]
+then
+	PSEUDO=$(readlink -f "$PSEUDO")
+fi
 
 # Make sure we're operating out of the FMK directory
 cd $(dirname $(readlink -f "$0"))
 
-MAJOR=$(./src/binwalk-1.0/src/bin/binwalk-script -m ./src/binwalk-*/src/binwalk/magic/binwalk -l 1024 "$IMG" | head -4 | tail -1 | sed -e 's/.*version //' | cut -d'.' -f1)
+# Probe the image once with the unified unsquashfs, which reads the
+# superblock and trial-decompresses the first metadata block.  If it can
+# extract the image, and we know which mksquashfs variant rebuilds it,
+# there's no need to try every unsquashfs below.
+PROBE="$ROOT/others/squashfs-4.2/unsquashfs"
+
+if [ -x "$PROBE" ]
+then
+	PROBED=$($PROBE -probe "$IMG" 2>/dev/null)
+	PROBE_STATUS=$?
+	eval $(echo "$PROBED" | grep '^SQUASHFS_[A-Z_]*=[A-Za-z0-9._-]*$')
+
+	if [ "$PROBE_STATUS" != "0" ]
+	then
+		SQUASHFS_COMP=""
+	fi
+
+	case "$SQUASHFS_VERSION:$SQUASHFS_COMP" in
+		4.0:gzip|4.0:lzo|4.0:xz)
+			PROBE_MKFS="$ROOT/others/squashfs-4.2/mksquashfs";;
+		3.1:gzip)
+			PROBE_MKFS="$ROOT/others/squashfs-3.2-r2/mksquashfs";;
+		3.1:sqlzma)
+			PROBE_MKFS="$ROOT/others/squashfs-3.2-r2-lzma/squashfs3.2-r2/squashfs-tools/mksquashfs";;
+		2.0:lzma-nosize)
+			PROBE_MKFS="$ROOT/others/squashfs-2.0-nb4/mksquashfs";;
+		*)
+			PROBE_MKFS="";;
+	esac
+
+	# Only the 4.x mksquashfs reads a pseudo file back
+	if [ "$PSEUDO" != "" ] && [ "$SQUASHFS_VERSION" != "4.0" ]
+	then
+		PROBE_MKFS=""
+	fi
+
+	if [ "$PROBE_MKFS" != "" ] && [ -e "$PROBE_MKFS" ]
+	then
+		echo -ne "\nProbed SquashFS $SQUASHFS_VERSION ($SQUASHFS_ENDIAN endian, $SQUASHFS_COMP), trying $PROBE... "
+
+		# FMK_PROCESSORS is set by extract-firmware.sh when several file systems are extracted at once
+		$PROBE ${FMK_PROCESSORS:+-processors $FMK_PROCESSORS} ${PSEUDO:+-pf "$PSEUDO"} -dest "$DIR" "$IMG" 2>/dev/null
+
+		if [ "$?" == "0" ] && [ -d "$DIR" ] && [ "$(ls "$DIR")" != "" ]
+		then
+			echo "File system sucessfully extracted!"
+			echo "MKFS=\"$PROBE_MKFS\""
+			exit 0
+		fi
+
+		rm -rf "$DIR"
+	fi
+fi
+
+# None of the others can write a pseudo file
+if [ "$PSEUDO" != "" ]
+then
+	rm -f "$PSEUDO"
+	echo "Can't extract this image without root."
+	exit 1
+fi
+
+# The probe above already read the version, if it could
+if [ "$SQUASHFS_VERSION" != "" ]
+then
+	MAJOR="${SQUASHFS_VERSION%%.*}"
+elif [ -x ./src/fmk-extract ]
+then
+	MAJOR=$(./src/fmk-extract -s "$IMG" | head -4 | tail -1 | sed -e 's/.*version //' | cut -d'.' -f1)
+else
+	MAJOR=$(./src/binwalk-1.0/src/bin/binwalk-script -m ./src/binwalk-*/src/binwalk/magic/binwalk -l 1024 "$IMG" | head -4 | tail -1 | sed -e 's/.*version //' | cut -d'.' -f1)
+fi
 
 echo -e "Attempting to extract SquashFS $MAJOR.X file system...\n"
 
+# Every unsquashfs for this version, in the order they are preferred
+CANDIDATES=""
 for SUBDIR in $SUBDIRS
 do
 	if [ "$(echo $SUBDIR | grep "$MAJOR\.")" == "" ]
@@ -97,74 +170,64 @@ do
 		continue
 	fi
 
-	unsquashfs="$ROOT/$SUBDIR/unsquashfs"
-	mksquashfs="$ROOT/$SUBDIR/mksquashfs"
-
-	if [ -e $unsquashfs-lzma ]; then
-		echo -ne "\nTrying $unsquashfs-lzma... "
-
-		$unsquashfs-lzma -dest "$DIR" "$IMG" 2>/dev/null &
-		#sleep $TIMEOUT && kill $! 1>&2 >/dev/null
-		wait_for_complete $unsquashfs-lzma
-		
-		if [ -d "$DIR" ]
-                then
-			if [ "$(ls "$DIR")" != "" ]
-			then
-				# Most systems will have busybox - make sure it's a non-zero file size
-				if [ -e "$DIR/bin/sh" ]
-				then
-					if [ "$(wc -c "$DIR/bin/sh" | cut -d' ' -f1)" != "0" ]
-					then
-						MKFS="$mksquashfs-lzma"
-					fi
-				else
-                        		MKFS="$mksquashfs-lzma"
-				fi
-			fi
-			
-			if [ "$MKFS" == "" ]
-			then
-				rm -rf "$DIR"
-			fi
-                fi
+	for unsquashfs in "$ROOT/$SUBDIR/unsquashfs-lzma" "$ROOT/$SUBDIR/unsquashfs"
+	do
+		if [ -e "$unsquashfs" ]
+		then
+			CANDIDATES="$CANDIDATES $unsquashfs"
+		fi
+	done
+done
+
+# List the image with all of them at once, each in a scratch directory of
+# its own.  A listing only decodes the superblock, inodes and directories,
+# which is what the variants disagree on, and is much cheaper than an
+# extraction.
+SCRATCH=$(mktemp -d "${TMPDIR:-/tmp}/unsquashfs_all.XXXXXX")
+trap 'kill ${PIDS[@]} 2>/dev/null; rm -rf "$SCRATCH"' EXIT
+
+N=0
+for unsquashfs in $CANDIDATES
+do
+	mkdir "$SCRATCH/$N"
+	timeout -s KILL $TIMEOUT "$unsquashfs" -ls -dest "$SCRATCH/$N/root" "$IMG" > "$SCRATCH/$N/ls" 2>/dev/null &
+	PIDS[$N]=$!
+	((N=$N+1))
+done
+
+# Take the candidates in order, so that an earlier variant still wins over a
+# later one that can also read the image.  The first one that listed any
+# entries without crashing or timing out does the one full extraction (some
+# older unsquashfs exit non-zero after a listing, so the status alone can't
+# tell).  The listings still running are cancelled once it has succeeded.
+N=0
+for unsquashfs in $CANDIDATES
+do
+	wait ${PIDS[$N]}
+	STATUS=$?
+	unset PIDS[$N]
+
+	if [ "$STATUS" -ge 128 ] || ! grep -q "^$SCRATCH/$N/root/" "$SCRATCH/$N/ls"
+	then
+		echo "Skipping $unsquashfs (can't list the image)..."
+		((N=$N+1))
+		continue
 	fi
-	if [ "$MKFS" == "" ] && [ -e $unsquashfs ]; then
-		echo -ne "\nTrying $unsquashfs... "
+	((N=$N+1))
 
-		$unsquashfs -dest "$DIR" "$IMG" 2>/dev/null &
-		#sleep $TIMEOUT && kill $! 1>&2 >/dev/null
-		wait_for_complete $unsquashfs
+	echo -ne "\nTrying $unsquashfs... "
 
-		if [ -d "$DIR" ]
-		then
-			if [ "$(ls "$DIR")" != "" ]
-			then
-				# Most systems will have busybox - make sure it's a non-zero file size
-				if [ -e "$DIR/bin/sh" ]
-				then
-					if [ "$(wc -c "$DIR/bin/sh" | cut -d' ' -f1)" != "0" ]
-					then
-						MKFS="$mksquashfs"
-					fi
-				else
-					MKFS="$mksquashfs"
-				fi
-			fi
-
-			if [ "$MKFS" == "" ]
-			then
-				rm -rf "$DIR"
-			fi
-		fi
-	fi	
+	timeout -s KILL $TIMEOUT "$unsquashfs" -dest "$DIR" "$IMG" 2>/dev/null
 
-	if [ "$MKFS" != "" ]
+	if extracted_ok "$DIR"
 	then
+		kill ${PIDS[@]} 2>/dev/null
 		echo "File system sucessfully extracted!"
-		echo "MKFS=\"$MKFS\""
+		echo "MKFS=\"${unsquashfs%/unsquashfs*}/mksquashfs${unsquashfs##*/unsquashfs}\""
 		exit 0
 	fi
+
+	rm -rf "$DIR"
 done
 
 echo "File extraction failed!"